@@ -0,0 +1,82 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/allocation_counter.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Allocations made by this thread. A plain thread_local integer needs no
+// dynamic initialization, so it is safe to use from operator new.
+thread_local int64_t allocations = 0;
+
+void* CountedAlloc(size_t size) {
+  ++allocations;
+  // malloc(0) may return null, which operator new must not.
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* CountedAllocOrThrow(size_t size) {
+  void* ptr = CountedAlloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAllocOrThrow(size); }
+
+void* operator new[](size_t size) { return CountedAllocOrThrow(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+// Only declared by the library when sized deallocation is enabled (C++14).
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+namespace opencensus {
+namespace common {
+
+AllocationCounter::AllocationCounter() : start_(allocations) {}
+
+int64_t AllocationCounter::count() const { return allocations - start_; }
+
+}  // namespace common
+}  // namespace opencensus
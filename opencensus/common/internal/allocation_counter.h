@@ -0,0 +1,69 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_ALLOCATION_COUNTER_H_
+#define OPENCENSUS_COMMON_INTERNAL_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+namespace opencensus {
+namespace common {
+
+// AllocationCounter counts the heap allocations made by the calling thread
+// while it is alive, so that tests can assert that hot paths do not allocate.
+// Linking this library replaces the global operator new and operator delete
+// with versions that forward to malloc() and free(); allocations made by
+// calling malloc() directly are not counted, but the library allocates only
+// through operator new (containers, std::string, std::make_shared).
+//
+// Example:
+//   EXPECT_EQ(0, AllocationsPerOperation([&] { span.AddAttribute("k", 1); }));
+//
+// Counters may be nested; each counts the allocations made during its own
+// lifetime. This class is not thread-safe and must be destroyed on the thread
+// that created it.
+class AllocationCounter final {
+ public:
+  AllocationCounter();
+
+  // The number of allocations made by this thread since construction.
+  int64_t count() const;
+
+ private:
+  AllocationCounter(const AllocationCounter&) = delete;
+  AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+  const int64_t start_;
+};
+
+// Calls 'op' 'warmup' times, so that caches and reusable buffers reach their
+// steady state, then returns the average number of allocations made per call
+// over the next 'iterations' calls.
+template <typename Op>
+double AllocationsPerOperation(const Op& op, int iterations = 100,
+                               int warmup = 10) {
+  for (int i = 0; i < warmup; ++i) {
+    op();
+  }
+  AllocationCounter counter;
+  for (int i = 0; i < iterations; ++i) {
+    op();
+  }
+  return static_cast<double>(counter.count()) / iterations;
+}
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_ALLOCATION_COUNTER_H_
@@ -0,0 +1,82 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/allocation_counter.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+// Allocates an int that the compiler cannot elide.
+void* volatile sink;
+void AllocateInt() {
+  std::unique_ptr<int> ptr(new int(1));
+  sink = ptr.get();
+}
+
+TEST(AllocationCounterTest, CountsAllocations) {
+  int64_t outer;
+  int64_t inner;
+  {
+    AllocationCounter counter;
+    AllocateInt();
+    {
+      AllocationCounter nested;
+      AllocateInt();
+      inner = nested.count();
+    }
+    AllocateInt();
+    outer = counter.count();
+  }
+  EXPECT_EQ(1, inner);
+  EXPECT_EQ(3, outer);
+}
+
+TEST(AllocationCounterTest, IgnoresOtherThreads) {
+  int64_t count;
+  {
+    AllocationCounter counter;
+    std::thread thread([]() {
+      for (int i = 0; i < 10; ++i) {
+        AllocateInt();
+      }
+    });
+    // Starting the thread allocates its state on this thread.
+    const int64_t started = counter.count();
+    thread.join();
+    count = counter.count() - started;
+  }
+  EXPECT_EQ(0, count);
+}
+
+TEST(AllocationCounterTest, AllocationsPerOperation) {
+  std::vector<int> buffer;
+  EXPECT_EQ(0, AllocationsPerOperation([&buffer]() {
+              // Allocates during warmup, then reuses the capacity.
+              buffer.assign(100, 1);
+              sink = buffer.data();
+            }));
+  EXPECT_EQ(1, AllocationsPerOperation(&AllocateInt));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,120 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_APPEND_ONLY_VECTOR_H_
+#define OPENCENSUS_COMMON_INTERNAL_APPEND_ONLY_VECTOR_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace opencensus {
+namespace common {
+
+// AppendOnlyVector is a vector that can only grow, and whose elements never
+// move, for registries that hand out indices and look them up far more often
+// than they add entries. Elements are stored in chunks of doubling size, so
+// reading an element is a wait-free indexed load that does not need a lock.
+//
+// push_back() calls must be serialized by the caller (typically under the
+// registry's mutex). operator[] may be called concurrently with push_back(),
+// for any index whose push_back() happens-before the read, e.g. because the
+// index was obtained from the registry.
+template <typename T>
+class AppendOnlyVector final {
+ public:
+  AppendOnlyVector() {
+    for (auto& chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~AppendOnlyVector() {
+    const size_t size = size_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+      (*this)[i].~T();
+    }
+    for (auto& chunk : chunks_) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  AppendOnlyVector(const AppendOnlyVector&) = delete;
+  AppendOnlyVector& operator=(const AppendOnlyVector&) = delete;
+
+  // Appends 'value' and returns its index.
+  size_t push_back(T value) {
+    const size_t index = size_.load(std::memory_order_relaxed);
+    int chunk;
+    size_t offset;
+    Locate(index, &chunk, &offset);
+    Storage* storage = chunks_[chunk].load(std::memory_order_relaxed);
+    if (storage == nullptr) {
+      storage = new Storage[kFirstChunkSize << chunk];
+      chunks_[chunk].store(storage, std::memory_order_release);
+    }
+    new (&storage[offset]) T(std::move(value));
+    size_.store(index + 1, std::memory_order_release);
+    return index;
+  }
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  const T& operator[](size_t index) const {
+    int chunk;
+    size_t offset;
+    Locate(index, &chunk, &offset);
+    const Storage* storage = chunks_[chunk].load(std::memory_order_acquire);
+    assert(storage != nullptr);
+    return *reinterpret_cast<const T*>(&storage[offset]);
+  }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  // Chunk c holds kFirstChunkSize << c elements, starting at index
+  // kFirstChunkSize * (2^c - 1).
+  static constexpr int kFirstChunkBits = 4;
+  static constexpr size_t kFirstChunkSize = size_t{1} << kFirstChunkBits;
+  static constexpr int kNumChunks = 32;
+
+  static void Locate(size_t index, int* chunk, size_t* offset) {
+    const uint64_t n = (index >> kFirstChunkBits) + 1;
+    *chunk = Log2Floor(n);
+    *offset = index - (((size_t{1} << *chunk) - 1) << kFirstChunkBits);
+  }
+
+  static int Log2Floor(uint64_t n) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(n);
+#else
+    int log = 0;
+    while (n >>= 1) ++log;
+    return log;
+#endif
+  }
+
+  std::atomic<Storage*> chunks_[kNumChunks];
+  std::atomic<size_t> size_{0};
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_APPEND_ONLY_VECTOR_H_
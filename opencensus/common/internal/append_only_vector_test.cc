@@ -0,0 +1,69 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/common/internal/append_only_vector.h"
+
+#include <string>
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+TEST(AppendOnlyVectorTest, PushBackAndIndex) {
+  AppendOnlyVector<std::string> vector;
+  EXPECT_EQ(0, vector.size());
+  constexpr int kNumElements = 1000;
+  for (int i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(i, vector.push_back(absl::StrCat("element", i)));
+  }
+  EXPECT_EQ(kNumElements, vector.size());
+  for (int i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(absl::StrCat("element", i), vector[i]);
+  }
+}
+
+TEST(AppendOnlyVectorTest, ElementsDoNotMove) {
+  AppendOnlyVector<std::string> vector;
+  vector.push_back("first");
+  const std::string* first = &vector[0];
+  for (int i = 0; i < 1000; ++i) {
+    vector.push_back("");
+  }
+  EXPECT_EQ(first, &vector[0]);
+  EXPECT_EQ("first", *first);
+}
+
+TEST(AppendOnlyVectorTest, ConcurrentReads) {
+  AppendOnlyVector<std::string> vector;
+  vector.push_back("0");
+  std::thread reader([&vector]() {
+    for (int i = 0; i < 10000; ++i) {
+      const size_t size = vector.size();
+      EXPECT_EQ(absl::StrCat(size - 1), vector[size - 1]);
+    }
+  });
+  for (int i = 1; i < 10000; ++i) {
+    vector.push_back(absl::StrCat(i));
+  }
+  reader.join();
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
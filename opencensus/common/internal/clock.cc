@@ -0,0 +1,103 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/clock.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "absl/base/internal/cycleclock.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+using ::absl::base_internal::CycleClock;
+
+constexpr int64_t kRecalibrationIntervalNanos = 1000000000;
+// A measured counter rate is only trusted within this relative error of the
+// nominal one; larger differences come from steps to the system clock.
+constexpr double kMaxRateError = 0.01;
+
+// The anchor pairs a counter value with the Unix time it was read at. It is
+// published with a seqlock: writers make seq odd while updating the fields.
+std::atomic<uint64_t> seq{0};
+std::atomic<int64_t> anchor_cycles{0};
+std::atomic<int64_t> anchor_nanos{0};
+// Nanoseconds per counter tick; 0 until the first calibration, or if there is
+// no usable counter.
+std::atomic<double> nanos_per_cycle{0};
+std::atomic<bool> recalibrating{false};
+
+// Re-anchors at the current time, measuring the counter rate since the old
+// anchor, and returns the current time. Readers that race with another
+// recalibration just return the time.
+absl::Time Recalibrate(int64_t old_cycles, int64_t old_nanos) {
+  const int64_t cycles = CycleClock::Now();
+  const absl::Time now = absl::Now();
+  if (recalibrating.exchange(true, std::memory_order_acquire)) {
+    return now;
+  }
+  const double frequency = CycleClock::Frequency();
+  if (frequency > 0) {
+    const double nominal_rate = 1e9 / frequency;
+    const int64_t nanos = absl::ToUnixNanos(now);
+    double rate = nominal_rate;
+    if (old_nanos != 0 && cycles > old_cycles && nanos > old_nanos) {
+      const double measured_rate =
+          static_cast<double>(nanos - old_nanos) / (cycles - old_cycles);
+      if (std::abs(measured_rate - nominal_rate) <=
+          kMaxRateError * nominal_rate) {
+        rate = measured_rate;
+      }
+    }
+    const uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchor_cycles.store(cycles, std::memory_order_relaxed);
+    anchor_nanos.store(nanos, std::memory_order_relaxed);
+    nanos_per_cycle.store(rate, std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+  }
+  recalibrating.store(false, std::memory_order_release);
+  return now;
+}
+
+}  // namespace
+
+absl::Time Clock::Now() {
+  const int64_t cycles = CycleClock::Now();
+  const uint64_t s = seq.load(std::memory_order_acquire);
+  const int64_t base_cycles = anchor_cycles.load(std::memory_order_relaxed);
+  const int64_t base_nanos = anchor_nanos.load(std::memory_order_relaxed);
+  const double rate = nanos_per_cycle.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if ((s & 1) != 0 || seq.load(std::memory_order_relaxed) != s) {
+    // An update is in progress.
+    return absl::Now();
+  }
+  const double elapsed_nanos = (cycles - base_cycles) * rate;
+  if (rate == 0 || elapsed_nanos < 0 ||
+      elapsed_nanos > kRecalibrationIntervalNanos) {
+    return Recalibrate(base_cycles, base_nanos);
+  }
+  return absl::FromUnixNanos(base_nanos + std::llround(elapsed_nanos));
+}
+
+}  // namespace common
+}  // namespace opencensus
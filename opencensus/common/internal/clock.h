@@ -0,0 +1,45 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_CLOCK_H_
+#define OPENCENSUS_COMMON_INTERNAL_CLOCK_H_
+
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+// Clock is a cheap source of wall time for timestamps taken on hot paths, such
+// as span starts, ends, and events. It reads the CPU cycle counter and converts
+// it to wall time from an anchor taken with absl::Now(). The anchor, and the
+// measured rate of the counter, are refreshed when a read finds them more than
+// a second old, so that timestamps follow the system clock (including steps
+// to it) to within that interval while costing one counter read otherwise.
+//
+// Timestamps from Clock and absl::Now() may differ by a small fraction of a
+// millisecond; do not mix them where ordering at that resolution matters.
+//
+// Clock is thread-safe.
+class Clock final {
+ public:
+  static absl::Time Now();
+
+ private:
+  Clock() = delete;
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_CLOCK_H_
@@ -0,0 +1,36 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/time/clock.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/common/internal/clock.h"
+
+namespace {
+
+void BM_AbslNow(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(absl::Now());
+  }
+}
+BENCHMARK(BM_AbslNow)->ThreadRange(1, 16);
+
+void BM_ClockNow(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(::opencensus::common::Clock::Now());
+  }
+}
+BENCHMARK(BM_ClockNow)->ThreadRange(1, 16);
+
+}  // namespace
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/clock.h"
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+// Tolerance for rounding and for the counter's drift within an anchor's
+// lifetime.
+constexpr absl::Duration kTolerance = absl::Milliseconds(20);
+
+TEST(ClockTest, TracksSystemClock) {
+  for (int i = 0; i < 3; ++i) {
+    const absl::Time before = absl::Now();
+    const absl::Time now = Clock::Now();
+    const absl::Time after = absl::Now();
+    EXPECT_LE(before - kTolerance, now);
+    EXPECT_GE(after + kTolerance, now);
+    // Cross the recalibration interval.
+    absl::SleepFor(absl::Milliseconds(600));
+  }
+}
+
+TEST(ClockTest, Advances) {
+  const absl::Time start = Clock::Now();
+  absl::SleepFor(absl::Milliseconds(50));
+  const absl::Duration elapsed = Clock::Now() - start;
+  EXPECT_LE(absl::Milliseconds(50) - kTolerance, elapsed);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
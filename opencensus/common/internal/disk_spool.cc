@@ -0,0 +1,207 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/disk_spool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+constexpr absl::Duration DiskSpool::kInitialBackoff;
+constexpr absl::Duration DiskSpool::kMaxBackoff;
+
+namespace {
+
+constexpr uint64_t kMagic = 0x6f6373706f6f6c31;  // "ocspool1"
+constexpr size_t kLengthSize = sizeof(uint32_t);
+// Written in place of a record's length when the record did not fit at the
+// end of the buffer and was written at the start instead. If fewer than
+// kLengthSize bytes are left at the end, the marker is implied.
+constexpr uint32_t kWrapMarker = 0xffffffff;
+
+}  // namespace
+
+// static
+std::unique_ptr<DiskSpool> DiskSpool::Open(const std::string& path,
+                                           size_t max_bytes,
+                                           std::string* error) {
+  const auto fail = [error](absl::string_view what) {
+    if (error != nullptr) {
+      *error = absl::StrCat(what, " failed: ", strerror(errno));
+    }
+    return nullptr;
+  };
+  if (max_bytes <= kLengthSize) {
+    if (error != nullptr) {
+      *error = "spool size too small";
+    }
+    return nullptr;
+  }
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return fail("open()");
+  }
+  const size_t mapping_size = sizeof(Header) + max_bytes;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      (static_cast<size_t>(st.st_size) != mapping_size &&
+       ftruncate(fd, mapping_size) != 0)) {
+    close(fd);
+    return fail("resizing spool file");
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return fail("mmap()");
+  }
+  return absl::WrapUnique(
+      new DiskSpool(fd, static_cast<char*>(mapping), mapping_size));
+}
+
+DiskSpool::DiskSpool(int fd, char* mapping, size_t mapping_size)
+    : fd_(fd),
+      mapping_(mapping),
+      mapping_size_(mapping_size),
+      header_(reinterpret_cast<Header*>(mapping)),
+      data_(mapping + sizeof(Header)) {
+  const uint64_t capacity = mapping_size - sizeof(Header);
+  // Start over if the file is new, or was written by a spool of another size.
+  if (header_->magic != kMagic || header_->capacity != capacity ||
+      header_->read_pos > capacity || header_->write_pos > capacity) {
+    header_->magic = kMagic;
+    header_->capacity = capacity;
+    header_->read_pos = 0;
+    header_->write_pos = 0;
+    header_->num_records = 0;
+  }
+}
+
+DiskSpool::~DiskSpool() {
+  munmap(mapping_, mapping_size_);
+  close(fd_);
+}
+
+bool DiskSpool::Append(absl::string_view record) {
+  const uint64_t capacity = header_->capacity;
+  if (record.size() >= kWrapMarker || record.size() + kLengthSize > capacity) {
+    return false;
+  }
+  const uint64_t size = record.size() + kLengthSize;
+  uint64_t pos;
+  bool wrap;
+  while (true) {
+    if (empty()) {
+      header_->read_pos = 0;
+      header_->write_pos = 0;
+    }
+    pos = header_->write_pos;
+    wrap = capacity - pos < size;
+    if (wrap) {
+      pos = 0;
+    }
+    if (!Overlaps(pos, size)) {
+      break;
+    }
+    PopFront();
+    ++num_dropped_;
+  }
+  if (wrap && capacity - header_->write_pos >= kLengthSize) {
+    memcpy(data_ + header_->write_pos, &kWrapMarker, kLengthSize);
+  }
+  const uint32_t length = record.size();
+  memcpy(data_ + pos, &length, kLengthSize);
+  memcpy(data_ + pos + kLengthSize, record.data(), record.size());
+  header_->write_pos = pos + size;
+  ++header_->num_records;
+  return true;
+}
+
+absl::string_view DiskSpool::Front() const {
+  uint32_t length;
+  const uint64_t pos = ReadPos(&length);
+  return absl::string_view(data_ + pos + kLengthSize, length);
+}
+
+void DiskSpool::PopFront() {
+  uint32_t length;
+  header_->read_pos = ReadPos(&length) + kLengthSize + length;
+  if (--header_->num_records == 0) {
+    header_->read_pos = 0;
+    header_->write_pos = 0;
+  } else {
+    // Keep read_pos at the start of a record, so that Overlaps() does not
+    // count a wrap-around marker as unread.
+    header_->read_pos = ReadPos(&length);
+  }
+}
+
+void DiskSpool::RecordSuccess() {
+  backoff_ = absl::ZeroDuration();
+  retry_time_ = absl::InfinitePast();
+}
+
+void DiskSpool::RecordFailure(absl::Time now) {
+  backoff_ = backoff_ == absl::ZeroDuration()
+                 ? kInitialBackoff
+                 : std::min(2 * backoff_, kMaxBackoff);
+  retry_time_ = now + backoff_;
+}
+
+uint64_t DiskSpool::ReadPos(uint32_t* length) const {
+  uint64_t pos = header_->read_pos;
+  if (header_->capacity - pos < kLengthSize) {
+    pos = 0;
+  } else {
+    memcpy(length, data_ + pos, kLengthSize);
+    if (*length == kWrapMarker) {
+      pos = 0;
+    }
+  }
+  memcpy(length, data_ + pos, kLengthSize);
+  return pos;
+}
+
+bool DiskSpool::Overlaps(uint64_t pos, uint64_t size) const {
+  if (empty()) {
+    return false;
+  }
+  const uint64_t read_pos = header_->read_pos;
+  const uint64_t write_pos = header_->write_pos;
+  if (read_pos < write_pos) {
+    // Unread records are in [read_pos, write_pos).
+    return pos < write_pos && pos + size > read_pos;
+  }
+  // Unread records are in [read_pos, capacity) and [0, write_pos).
+  return pos < write_pos || pos + size > read_pos;
+}
+
+}  // namespace common
+}  // namespace opencensus
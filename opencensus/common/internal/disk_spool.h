@@ -0,0 +1,117 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_DISK_SPOOL_H_
+#define OPENCENSUS_COMMON_INTERNAL_DISK_SPOOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+// DiskSpool is a size-capped FIFO of opaque records (serialized export
+// batches) kept in a memory-mapped file, so that exporters can hold on to
+// batches while their backend is unreachable without growing the heap, and
+// pick them up again after a restart. The file is a ring buffer: when a new
+// record does not fit, the oldest records are dropped to make room.
+//
+// DiskSpool also tracks when to retry the backend: after a failure, exporters
+// should spool new batches rather than sending them until BackingOff()
+// returns false, which happens after a delay that doubles with each
+// consecutive failure.
+//
+// Records are persisted by the kernel when the process exits or crashes, but
+// not synced to the device, so they may be lost if the machine goes down.
+//
+// DiskSpool is thread-compatible.
+class DiskSpool final {
+ public:
+  // The first and maximum delay before retrying after a failure.
+  static constexpr absl::Duration kInitialBackoff = absl::Seconds(10);
+  static constexpr absl::Duration kMaxBackoff = absl::Minutes(5);
+
+  // Opens (creating it if needed) the spool in the file at 'path', holding up
+  // to 'max_bytes' of records including a 4-byte header each. Records left in
+  // the file by an earlier spool of the same size are kept. Returns nullptr,
+  // setting *error (if not null), on failure.
+  static std::unique_ptr<DiskSpool> Open(const std::string& path,
+                                         size_t max_bytes,
+                                         std::string* error = nullptr);
+  ~DiskSpool();
+
+  DiskSpool(const DiskSpool&) = delete;
+  DiskSpool& operator=(const DiskSpool&) = delete;
+
+  // Appends 'record', dropping the oldest records if required to make room.
+  // Returns false if 'record' is larger than the spool.
+  bool Append(absl::string_view record);
+
+  bool empty() const { return header_->num_records == 0; }
+  uint64_t num_records() const { return header_->num_records; }
+  // The number of records dropped to make room since the spool was opened.
+  uint64_t num_dropped() const { return num_dropped_; }
+
+  // Returns the oldest record, which must exist. The data is in the mapping,
+  // and is invalidated by the next Append() or PopFront().
+  absl::string_view Front() const;
+  // Removes the oldest record, which must exist.
+  void PopFront();
+
+  // Whether exporters should not yet retry the backend at 'now'.
+  bool BackingOff(absl::Time now) const { return now < retry_time_; }
+  // Records the outcome of sending to the backend at 'now'.
+  void RecordSuccess();
+  void RecordFailure(absl::Time now);
+
+ private:
+  // The layout of the start of the file. Positions are offsets into the data
+  // that follows.
+  struct Header {
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t read_pos;
+    uint64_t write_pos;
+    uint64_t num_records;
+  };
+
+  DiskSpool(int fd, char* mapping, size_t mapping_size);
+
+  // Returns the position and length of the record at header_->read_pos,
+  // skipping the wrap-around marker if present.
+  uint64_t ReadPos(uint32_t* length) const;
+  // Whether a record of 'size' bytes (including its length) written at 'pos'
+  // would overwrite unread records.
+  bool Overlaps(uint64_t pos, uint64_t size) const;
+
+  const int fd_;
+  char* const mapping_;
+  const size_t mapping_size_;
+  Header* const header_;
+  char* const data_;
+  uint64_t num_dropped_ = 0;
+
+  absl::Duration backoff_ = absl::ZeroDuration();
+  absl::Time retry_time_ = absl::InfinitePast();
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_DISK_SPOOL_H_
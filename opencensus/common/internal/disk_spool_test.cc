@@ -0,0 +1,177 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/disk_spool.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+class DiskSpoolTest : public ::testing::Test {
+ protected:
+  DiskSpoolTest() {
+    const char* dir = std::getenv("TEST_TMPDIR");
+    path_ = absl::StrCat(dir == nullptr ? "/tmp" : dir, "/oc_disk_spool_test_",
+                         getpid());
+    unlink(path_.c_str());
+  }
+
+  ~DiskSpoolTest() override { unlink(path_.c_str()); }
+
+  std::unique_ptr<DiskSpool> Open(size_t max_bytes) {
+    std::string error;
+    auto spool = DiskSpool::Open(path_, max_bytes, &error);
+    EXPECT_NE(nullptr, spool) << error;
+    return spool;
+  }
+
+  std::string path_;
+};
+
+TEST_F(DiskSpoolTest, Fifo) {
+  auto spool = Open(1024);
+  EXPECT_TRUE(spool->empty());
+  EXPECT_TRUE(spool->Append("foo"));
+  EXPECT_TRUE(spool->Append(""));
+  EXPECT_TRUE(spool->Append("barbaz"));
+  EXPECT_EQ(3, spool->num_records());
+  EXPECT_EQ("foo", spool->Front());
+  spool->PopFront();
+  EXPECT_EQ("", spool->Front());
+  spool->PopFront();
+  EXPECT_EQ("barbaz", spool->Front());
+  spool->PopFront();
+  EXPECT_TRUE(spool->empty());
+  EXPECT_EQ(0, spool->num_dropped());
+}
+
+TEST_F(DiskSpoolTest, RecordsSurviveReopening) {
+  Open(1024)->Append("foo");
+  {
+    auto spool = Open(1024);
+    ASSERT_EQ(1, spool->num_records());
+    EXPECT_EQ("foo", spool->Front());
+    spool->Append("bar");
+  }
+  auto spool = Open(1024);
+  ASSERT_EQ(2, spool->num_records());
+  EXPECT_EQ("foo", spool->Front());
+  spool->PopFront();
+  EXPECT_EQ("bar", spool->Front());
+}
+
+TEST_F(DiskSpoolTest, ResizingClearsRecords) {
+  Open(1024)->Append("foo");
+  EXPECT_TRUE(Open(2048)->empty());
+}
+
+TEST_F(DiskSpoolTest, RecordTooLarge) {
+  auto spool = Open(16);
+  spool->Append("foo");
+  EXPECT_FALSE(spool->Append(std::string(13, 'a')));
+  EXPECT_EQ(1, spool->num_records());
+  EXPECT_TRUE(spool->Append(std::string(12, 'a')));
+  EXPECT_EQ(1, spool->num_records());
+  EXPECT_EQ(1, spool->num_dropped());
+}
+
+TEST_F(DiskSpoolTest, WrapsAroundDroppingOldest) {
+  // 3 records of 9 bytes fit; the 4th is written at the start, leaving 3 bytes
+  // at the end, which is too few for a wrap-around marker.
+  auto spool = Open(30);
+  spool->Append("aaaaa");
+  spool->Append("bbbbb");
+  spool->Append("ccccc");
+  spool->Append("ddddd");
+  EXPECT_EQ(1, spool->num_dropped());
+  EXPECT_EQ(3, spool->num_records());
+  EXPECT_EQ("bbbbb", spool->Front());
+  spool->PopFront();
+  EXPECT_EQ("ccccc", spool->Front());
+  spool->PopFront();
+  EXPECT_EQ("ddddd", spool->Front());
+}
+
+TEST_F(DiskSpoolTest, WrapAroundMarker) {
+  // As above, but with room for a marker after the 3rd record.
+  auto spool = Open(32);
+  spool->Append("aaaaa");
+  spool->Append("bbbbb");
+  spool->Append("ccccc");
+  spool->Append("ddddd");
+  EXPECT_EQ(1, spool->num_dropped());
+  spool->PopFront();
+  spool->PopFront();
+  EXPECT_EQ("ddddd", spool->Front());
+  // The space taken by the marker is free again once it has been read past.
+  spool->Append("eeeeeeeeee");
+  spool->Append("f");
+  EXPECT_EQ(1, spool->num_dropped());
+  EXPECT_EQ(3, spool->num_records());
+}
+
+TEST_F(DiskSpoolTest, MatchesDeque) {
+  auto spool = Open(100);
+  std::deque<std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3 == 2 && !expected.empty()) {
+      EXPECT_EQ(expected.front(), spool->Front());
+      spool->PopFront();
+      expected.pop_front();
+      continue;
+    }
+    const std::string record(i * 7 % 23, 'a' + i % 26);
+    const uint64_t dropped = spool->num_dropped();
+    ASSERT_TRUE(spool->Append(record));
+    expected.push_back(record);
+    for (uint64_t j = dropped; j < spool->num_dropped(); ++j) {
+      expected.pop_front();
+    }
+    ASSERT_EQ(expected.size(), spool->num_records());
+    EXPECT_EQ(expected.front(), spool->Front());
+  }
+}
+
+TEST_F(DiskSpoolTest, Backoff) {
+  auto spool = Open(16);
+  const absl::Time now = absl::UnixEpoch();
+  EXPECT_FALSE(spool->BackingOff(now));
+  spool->RecordFailure(now);
+  EXPECT_TRUE(spool->BackingOff(now + DiskSpool::kInitialBackoff / 2));
+  EXPECT_FALSE(spool->BackingOff(now + DiskSpool::kInitialBackoff));
+  spool->RecordFailure(now);
+  EXPECT_TRUE(spool->BackingOff(now + DiskSpool::kInitialBackoff));
+  EXPECT_FALSE(spool->BackingOff(now + 2 * DiskSpool::kInitialBackoff));
+  for (int i = 0; i < 20; ++i) {
+    spool->RecordFailure(now);
+  }
+  EXPECT_FALSE(spool->BackingOff(now + DiskSpool::kMaxBackoff));
+  spool->RecordSuccess();
+  EXPECT_FALSE(spool->BackingOff(now));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
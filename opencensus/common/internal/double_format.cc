@@ -0,0 +1,67 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/double_format.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "absl/base/macros.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+// Formats 'value' with 'precision' significant digits into 'buf', replacing
+// the locale's decimal separator, which may be several bytes, with '.'.
+// Returns the length.
+int Format(double value, int precision, char* buf, size_t size) {
+  const int len = snprintf(buf, size, "%.*g", precision, value);
+  // %g only writes digits, a sign, an exponent and the separator.
+  int out = 0;
+  bool in_separator = false;
+  for (int i = 0; i < len; ++i) {
+    const char c = buf[i];
+    if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == 'e') {
+      buf[out++] = c;
+      in_separator = false;
+    } else if (!in_separator) {
+      buf[out++] = '.';
+      in_separator = true;
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+void AppendRoundTripDouble(double value, std::string* output) {
+  ABSL_ASSERT(std::isfinite(value));
+  char buf[64];
+  int len = Format(value, 15, buf, sizeof(buf));
+  // SimpleAtod does not depend on the locale either.
+  double parsed;
+  if (!absl::SimpleAtod(absl::string_view(buf, len), &parsed) ||
+      parsed != value) {
+    len = Format(value, 17, buf, sizeof(buf));
+  }
+  output->append(buf, len);
+}
+
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,32 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_DOUBLE_FORMAT_H_
+#define OPENCENSUS_COMMON_INTERNAL_DOUBLE_FORMAT_H_
+
+#include <string>
+
+namespace opencensus {
+namespace common {
+
+// Appends the shorter of the %.15g and %.17g representations of 'value' that
+// parses back to it, always with '.' as the decimal separator whatever the
+// LC_NUMERIC locale, as the text formats of the exporters require. 'value'
+// must be finite: callers write NaN and infinities as their format does.
+void AppendRoundTripDouble(double value, std::string* output);
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_DOUBLE_FORMAT_H_
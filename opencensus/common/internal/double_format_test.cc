@@ -0,0 +1,65 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/double_format.h"
+
+#include <clocale>
+#include <limits>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+std::string Format(double value) {
+  std::string output;
+  AppendRoundTripDouble(value, &output);
+  return output;
+}
+
+TEST(DoubleFormatTest, ShortestRoundTrip) {
+  EXPECT_EQ("0", Format(0));
+  EXPECT_EQ("-1.5", Format(-1.5));
+  EXPECT_EQ("0.1", Format(0.1));
+  EXPECT_EQ("1e+300", Format(1e300));
+  // Needs 17 digits.
+  EXPECT_EQ("0.30000000000000004", Format(0.1 + 0.2));
+  EXPECT_EQ(std::numeric_limits<double>::min(),
+            std::stod(Format(std::numeric_limits<double>::min())));
+  EXPECT_EQ(std::numeric_limits<double>::max(),
+            std::stod(Format(std::numeric_limits<double>::max())));
+}
+
+TEST(DoubleFormatTest, IgnoresLocale) {
+  // Only checked where a locale with a comma separator is installed.
+  const char* const locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8",
+                                 "fr_FR.utf8"};
+  bool found = false;
+  for (const char* locale : locales) {
+    if (setlocale(LC_NUMERIC, locale) != nullptr) {
+      found = true;
+      break;
+    }
+  }
+  if (!found) return;
+  EXPECT_EQ("-1.5", Format(-1.5));
+  EXPECT_EQ("0.30000000000000004", Format(0.1 + 0.2));
+  setlocale(LC_NUMERIC, "C");
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
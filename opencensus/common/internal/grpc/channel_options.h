@@ -0,0 +1,59 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_GRPC_CHANNEL_OPTIONS_H_
+#define OPENCENSUS_COMMON_INTERNAL_GRPC_CHANNEL_OPTIONS_H_
+
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+// GrpcChannelOptions tune the channels returned by GetSharedChannels(). They
+// are kept free of gRPC types so that exporters' option structs can hold them.
+struct GrpcChannelOptions final {
+  // If true, requests are compressed with gzip.
+  bool gzip_compression = false;
+
+  // If positive, a keepalive ping is sent after this long without activity
+  // while calls are in flight, and the connection is closed if the ping is not
+  // acknowledged within keepalive_timeout.
+  absl::Duration keepalive_time = absl::ZeroDuration();
+  absl::Duration keepalive_timeout = absl::Seconds(20);
+
+  // If positive, the largest request and response messages allowed, in bytes.
+  int max_message_bytes = 0;
+
+  // The number of channels, each with its own connection, over which
+  // exporters spread their requests.
+  int num_channels = 1;
+
+  // If true, channels connect without TLS or credentials, e.g. to local fakes
+  // of the Google APIs in tests.
+  bool insecure = false;
+};
+
+inline bool operator==(const GrpcChannelOptions& a,
+                       const GrpcChannelOptions& b) {
+  return a.gzip_compression == b.gzip_compression &&
+         a.keepalive_time == b.keepalive_time &&
+         a.keepalive_timeout == b.keepalive_timeout &&
+         a.max_message_bytes == b.max_message_bytes &&
+         a.num_channels == b.num_channels && a.insecure == b.insecure;
+}
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_GRPC_CHANNEL_OPTIONS_H_
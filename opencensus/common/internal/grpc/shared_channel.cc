@@ -0,0 +1,98 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/grpc/shared_channel.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <grpc/compression.h>
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/support/channel_arguments.h>
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/grpc/with_user_agent.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+struct SharedChannels {
+  std::string target;
+  GrpcChannelOptions options;
+  std::vector<std::shared_ptr<grpc::Channel>> channels;
+};
+
+}  // namespace
+
+std::shared_ptr<grpc::ChannelCredentials> SharedGoogleDefaultCredentials() {
+  static const auto* credentials =
+      new std::shared_ptr<grpc::ChannelCredentials>(
+          grpc::GoogleDefaultCredentials());
+  return *credentials;
+}
+
+grpc::ChannelArguments MakeChannelArguments(const GrpcChannelOptions& options) {
+  grpc::ChannelArguments args = WithUserAgent();
+  if (options.gzip_compression) {
+    args.SetCompressionAlgorithm(GRPC_COMPRESS_GZIP);
+  }
+  if (options.keepalive_time > absl::ZeroDuration()) {
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS,
+                absl::ToInt64Milliseconds(options.keepalive_time));
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                absl::ToInt64Milliseconds(options.keepalive_timeout));
+  }
+  if (options.max_message_bytes > 0) {
+    args.SetMaxSendMessageSize(options.max_message_bytes);
+    args.SetMaxReceiveMessageSize(options.max_message_bytes);
+  }
+  if (options.num_channels > 1) {
+    // Otherwise channels with the same arguments share a connection.
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  }
+  return args;
+}
+
+std::vector<std::shared_ptr<grpc::Channel>> GetSharedChannels(
+    absl::string_view target, const GrpcChannelOptions& options) {
+  static auto* mu = new absl::Mutex;
+  static auto* shared = new std::vector<SharedChannels>;
+  absl::MutexLock l(mu);
+  for (const SharedChannels& entry : *shared) {
+    if (entry.target == target && entry.options == options) {
+      return entry.channels;
+    }
+  }
+  SharedChannels entry{std::string(target), options, {}};
+  const grpc::ChannelArguments args = MakeChannelArguments(options);
+  const std::shared_ptr<grpc::ChannelCredentials> credentials =
+      options.insecure ? grpc::InsecureChannelCredentials()
+                       : SharedGoogleDefaultCredentials();
+  for (int i = 0; i < std::max(1, options.num_channels); ++i) {
+    entry.channels.push_back(
+        grpc::CreateCustomChannel(entry.target, credentials, args));
+  }
+  shared->push_back(std::move(entry));
+  return shared->back().channels;
+}
+
+}  // namespace common
+}  // namespace opencensus
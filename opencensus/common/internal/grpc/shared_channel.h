@@ -0,0 +1,50 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_GRPC_SHARED_CHANNEL_H_
+#define OPENCENSUS_COMMON_INTERNAL_GRPC_SHARED_CHANNEL_H_
+
+#include <memory>
+#include <vector>
+
+#include <grpcpp/channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/support/channel_arguments.h>
+#include "absl/strings/string_view.h"
+#include "opencensus/common/internal/grpc/channel_options.h"
+
+namespace opencensus {
+namespace common {
+
+// Returns the process's GoogleDefaultCredentials, created once, so that
+// exporters share its token refreshes.
+std::shared_ptr<grpc::ChannelCredentials> SharedGoogleDefaultCredentials();
+
+// Returns the channel arguments for 'options', with the OpenCensus user agent
+// (see WithUserAgent()).
+grpc::ChannelArguments MakeChannelArguments(const GrpcChannelOptions& options);
+
+// Returns options.num_channels (at least 1) channels to 'target' with
+// SharedGoogleDefaultCredentials(), or insecure ones if options.insecure is
+// set. Exporters calling this with the same target and options share the
+// channels, and so their connections and TLS handshakes. With several
+// channels, each has its own connection, over which the caller should spread
+// its requests.
+std::vector<std::shared_ptr<grpc::Channel>> GetSharedChannels(
+    absl::string_view target, const GrpcChannelOptions& options);
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_GRPC_SHARED_CHANNEL_H_
@@ -0,0 +1,154 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/json_lines_writer.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "opencensus/common/internal/double_format.h"
+
+namespace opencensus {
+namespace common {
+
+JsonLinesWriter::JsonLinesWriter(int fd) : fd_(fd) {}
+
+void JsonLinesWriter::StartObject() {
+  Separate();
+  buffer_.push_back('{');
+  ++depth_;
+  need_comma_ = false;
+}
+
+void JsonLinesWriter::EndObject() {
+  buffer_.push_back('}');
+  need_comma_ = --depth_ > 0;
+  if (depth_ == 0) {
+    buffer_.push_back('\n');
+  }
+}
+
+void JsonLinesWriter::StartArray() {
+  Separate();
+  buffer_.push_back('[');
+  ++depth_;
+  need_comma_ = false;
+}
+
+void JsonLinesWriter::EndArray() {
+  buffer_.push_back(']');
+  --depth_;
+  need_comma_ = true;
+}
+
+void JsonLinesWriter::Key(absl::string_view key) {
+  String(key);
+  buffer_.push_back(':');
+  need_comma_ = false;
+}
+
+void JsonLinesWriter::String(absl::string_view value) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  Separate();
+  buffer_.push_back('"');
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        buffer_.append("\\\"");
+        break;
+      case '\\':
+        buffer_.append("\\\\");
+        break;
+      case '\n':
+        buffer_.append("\\n");
+        break;
+      case '\r':
+        buffer_.append("\\r");
+        break;
+      case '\t':
+        buffer_.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          buffer_.append("\\u00");
+          buffer_.push_back(kHex[c >> 4]);
+          buffer_.push_back(kHex[c & 0xf]);
+        } else {
+          buffer_.push_back(c);
+        }
+    }
+  }
+  buffer_.push_back('"');
+  need_comma_ = true;
+}
+
+void JsonLinesWriter::Int(int64_t value) {
+  Separate();
+  absl::StrAppend(&buffer_, value);
+  need_comma_ = true;
+}
+
+void JsonLinesWriter::Uint(uint64_t value) {
+  Separate();
+  absl::StrAppend(&buffer_, value);
+  need_comma_ = true;
+}
+
+void JsonLinesWriter::Double(double value) {
+  Separate();
+  need_comma_ = true;
+  if (!std::isfinite(value)) {
+    buffer_.append("null");
+    return;
+  }
+  AppendRoundTripDouble(value, &buffer_);
+}
+
+void JsonLinesWriter::Bool(bool value) {
+  Separate();
+  buffer_.append(value ? "true" : "false");
+  need_comma_ = true;
+}
+
+bool JsonLinesWriter::Flush() {
+  const char* data = buffer_.data();
+  size_t remaining = buffer_.size();
+  bool ok = true;
+  while (remaining > 0) {
+    const ssize_t written = write(fd_, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      ok = false;
+      break;
+    }
+    data += written;
+    remaining -= written;
+  }
+  buffer_.clear();
+  return ok;
+}
+
+void JsonLinesWriter::Separate() {
+  if (need_comma_) {
+    buffer_.push_back(',');
+  }
+}
+
+}  // namespace common
+}  // namespace opencensus
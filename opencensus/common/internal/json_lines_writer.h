@@ -0,0 +1,81 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_JSON_LINES_WRITER_H_
+#define OPENCENSUS_COMMON_INTERNAL_JSON_LINES_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+// JsonLinesWriter builds JSON-lines output (one JSON object per line) in a
+// reusable buffer and writes it to a file descriptor with a single write(2)
+// per Flush(), retrying only on partial writes and EINTR. Exporters flush once
+// per batch, so output from concurrent writers to the same descriptor is not
+// interleaved within a batch (up to PIPE_BUF bytes for pipes), and the buffer
+// is not reallocated once it has grown to the batch size.
+//
+// Values are written in order; commas and the newline after each top-level
+// object are inserted automatically. Non-finite doubles, which JSON cannot
+// represent, are written as null.
+//
+// JsonLinesWriter is thread-compatible.
+class JsonLinesWriter final {
+ public:
+  explicit JsonLinesWriter(int fd);
+
+  JsonLinesWriter(const JsonLinesWriter&) = delete;
+  JsonLinesWriter& operator=(const JsonLinesWriter&) = delete;
+
+  void StartObject();
+  // Ends an object; ending a top-level object ends the line.
+  void EndObject();
+  void StartArray();
+  void EndArray();
+
+  // Writes the key of the next member of the current object.
+  void Key(absl::string_view key);
+
+  void String(absl::string_view value);
+  void Int(int64_t value);
+  void Uint(uint64_t value);
+  void Double(double value);
+  void Bool(bool value);
+
+  // The output buffered since the last Flush().
+  absl::string_view buffer() const { return buffer_; }
+
+  // Writes the buffered output and clears the buffer, keeping its storage.
+  // Returns false if the write failed; the output is discarded either way.
+  bool Flush();
+
+ private:
+  // Writes a comma if a value precedes this one at the current level.
+  void Separate();
+
+  const int fd_;
+  std::string buffer_;
+  int depth_ = 0;
+  bool need_comma_ = false;
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_JSON_LINES_WRITER_H_
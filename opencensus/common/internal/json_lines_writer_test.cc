@@ -0,0 +1,100 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/json_lines_writer.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+TEST(JsonLinesWriterTest, WritesObjectsAsLines) {
+  JsonLinesWriter writer(-1);
+  writer.StartObject();
+  writer.Key("name");
+  writer.String("a");
+  writer.Key("values");
+  writer.StartArray();
+  writer.Int(-1);
+  writer.Uint(std::numeric_limits<uint64_t>::max());
+  writer.Bool(true);
+  writer.EndArray();
+  writer.Key("nested");
+  writer.StartObject();
+  writer.EndObject();
+  writer.EndObject();
+  writer.StartObject();
+  writer.Key("x");
+  writer.Double(0.1);
+  writer.EndObject();
+  EXPECT_EQ(
+      "{\"name\":\"a\",\"values\":[-1,18446744073709551615,true],"
+      "\"nested\":{}}\n{\"x\":0.1}\n",
+      writer.buffer());
+}
+
+TEST(JsonLinesWriterTest, EscapesStrings) {
+  JsonLinesWriter writer(-1);
+  writer.String(std::string("\"\\\n\t\x01\0", 6));
+  EXPECT_EQ("\"\\\"\\\\\\n\\t\\u0001\\u0000\"", writer.buffer());
+}
+
+TEST(JsonLinesWriterTest, Doubles) {
+  JsonLinesWriter writer(-1);
+  writer.StartArray();
+  writer.Double(1.5);
+  writer.Double(1.0 / 3);
+  writer.Double(std::numeric_limits<double>::infinity());
+  writer.Double(std::numeric_limits<double>::quiet_NaN());
+  writer.EndArray();
+  EXPECT_EQ("[1.5,0.33333333333333331,null,null]", writer.buffer());
+}
+
+TEST(JsonLinesWriterTest, FlushWritesAndClears) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  JsonLinesWriter writer(fds[1]);
+  writer.StartObject();
+  writer.Key("k");
+  writer.Int(1);
+  writer.EndObject();
+  EXPECT_TRUE(writer.Flush());
+  EXPECT_TRUE(writer.buffer().empty());
+  // Nothing buffered: no write.
+  EXPECT_TRUE(writer.Flush());
+  close(fds[1]);
+  char buf[64];
+  const ssize_t n = read(fds[0], buf, sizeof(buf));
+  close(fds[0]);
+  ASSERT_GT(n, 0);
+  EXPECT_EQ("{\"k\":1}\n", std::string(buf, n));
+}
+
+TEST(JsonLinesWriterTest, FlushFailure) {
+  JsonLinesWriter writer(-1);
+  writer.Int(1);
+  EXPECT_FALSE(writer.Flush());
+  EXPECT_TRUE(writer.buffer().empty());
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,63 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/memory_resource.h"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+class NewDelete final : public MemoryResource {
+ public:
+  void* Allocate(size_t bytes, size_t /*alignment*/) override {
+    return ::operator new(bytes);
+  }
+  void Deallocate(void* p, size_t /*bytes*/, size_t /*alignment*/) override {
+    ::operator delete(p);
+  }
+};
+
+constexpr int kNumSubsystems =
+    static_cast<int>(MemorySubsystem::kSpanStores) + 1;
+
+// Null entries stand for NewDeleteResource(), so that no initialization
+// order issue arises for containers created during static initialization.
+std::atomic<MemoryResource*> resources[kNumSubsystems];
+
+}  // namespace
+
+MemoryResource* NewDeleteResource() {
+  // Never destroyed, since containers may free memory during exit.
+  static MemoryResource* resource = new NewDelete;
+  return resource;
+}
+
+void SetMemoryResource(MemorySubsystem subsystem, MemoryResource* resource) {
+  resources[static_cast<int>(subsystem)].store(resource,
+                                               std::memory_order_release);
+}
+
+MemoryResource* GetMemoryResource(MemorySubsystem subsystem) {
+  MemoryResource* resource =
+      resources[static_cast<int>(subsystem)].load(std::memory_order_acquire);
+  return resource != nullptr ? resource : NewDeleteResource();
+}
+
+}  // namespace common
+}  // namespace opencensus
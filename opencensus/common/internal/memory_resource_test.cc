@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/memory_resource.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+class CountingResource : public MemoryResource {
+ public:
+  void* Allocate(size_t bytes, size_t alignment) override {
+    EXPECT_LE(alignment, alignof(std::max_align_t));
+    bytes_ += bytes;
+    return ::operator new(bytes);
+  }
+  void Deallocate(void* p, size_t bytes, size_t /*alignment*/) override {
+    bytes_ -= bytes;
+    ::operator delete(p);
+  }
+
+  int64_t bytes() const { return bytes_; }
+
+ private:
+  std::atomic<int64_t> bytes_{0};
+};
+
+template <typename T>
+using ViewsAllocator = ResourceAllocator<T, MemorySubsystem::kStatsViews>;
+
+TEST(MemoryResourceTest, DefaultIsNewDelete) {
+  EXPECT_EQ(NewDeleteResource(),
+            GetMemoryResource(MemorySubsystem::kStatsDeltas));
+  EXPECT_EQ(NewDeleteResource(), ViewsAllocator<int>().resource());
+}
+
+TEST(MemoryResourceTest, ContainersAllocateFromTheirSubsystem) {
+  CountingResource resource;
+  SetMemoryResource(MemorySubsystem::kStatsViews, &resource);
+  {
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                       ViewsAllocator<std::pair<const int, int>>>
+        map;
+    for (int i = 0; i < 100; ++i) {
+      map[i] = i;
+    }
+    EXPECT_GT(resource.bytes(),
+              static_cast<int64_t>(100 * sizeof(std::pair<const int, int>)));
+    // Other subsystems are unaffected.
+    EXPECT_EQ(NewDeleteResource(),
+              GetMemoryResource(MemorySubsystem::kSpanStores));
+  }
+  EXPECT_EQ(0, resource.bytes());
+  SetMemoryResource(MemorySubsystem::kStatsViews, nullptr);
+  EXPECT_EQ(NewDeleteResource(),
+            GetMemoryResource(MemorySubsystem::kStatsViews));
+}
+
+TEST(MemoryResourceTest, ContainersKeepTheirResource) {
+  CountingResource resource;
+  SetMemoryResource(MemorySubsystem::kStatsViews, &resource);
+  std::vector<int, ViewsAllocator<int>> old_vector(10);
+  SetMemoryResource(MemorySubsystem::kStatsViews, nullptr);
+  std::vector<int, ViewsAllocator<int>> new_vector(20);
+  EXPECT_EQ(static_cast<int64_t>(10 * sizeof(int)), resource.bytes());
+
+  // Memory is freed by the resource it came from, wherever it moves.
+  new_vector.swap(old_vector);
+  EXPECT_EQ(&resource, new_vector.get_allocator().resource());
+  new_vector = std::vector<int, ViewsAllocator<int>>();
+  EXPECT_EQ(0, resource.bytes());
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,177 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/overhead_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/random.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+constexpr int kNumOperations = 4;
+
+// The most distinct call sites tracked. Costs of further names are attributed
+// to kOtherName, so that high-cardinality span names cannot grow the profile
+// without bound.
+constexpr size_t kMaxCallSites = 1000;
+constexpr char kOtherName[] = "(other)";
+
+struct Cost {
+  uint64_t sampled_calls = 0;
+  absl::Duration sampled_time;
+  absl::Duration max_time;
+  absl::Duration estimated_total_time;
+};
+
+class Profile {
+ public:
+  static Profile* Get() {
+    static Profile* global_profile = new Profile;
+    return global_profile;
+  }
+
+  void Add(OverheadProfiler::Operation operation, absl::string_view name,
+           absl::Duration cost, uint32_t period) LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    auto key = std::make_pair(operation, std::string(name));
+    auto it = costs_.find(key);
+    if (it == costs_.end()) {
+      if (costs_.size() >= kMaxCallSites) {
+        key.second = kOtherName;
+      }
+      it = costs_.emplace(std::move(key), Cost()).first;
+    }
+    Cost& entry = it->second;
+    ++entry.sampled_calls;
+    entry.sampled_time += cost;
+    entry.max_time = std::max(entry.max_time, cost);
+    entry.estimated_total_time += cost * period;
+  }
+
+  std::vector<OverheadProfiler::CallSite> GetCallSites() const
+      LOCKS_EXCLUDED(mu_) {
+    std::vector<OverheadProfiler::CallSite> call_sites;
+    {
+      absl::MutexLock l(&mu_);
+      call_sites.reserve(costs_.size());
+      for (const auto& entry : costs_) {
+        call_sites.push_back({entry.first.first, entry.first.second,
+                              entry.second.sampled_calls,
+                              entry.second.sampled_time, entry.second.max_time,
+                              entry.second.estimated_total_time});
+      }
+    }
+    std::sort(call_sites.begin(), call_sites.end(),
+              [](const OverheadProfiler::CallSite& a,
+                 const OverheadProfiler::CallSite& b) {
+                return a.estimated_total_time > b.estimated_total_time;
+              });
+    return call_sites;
+  }
+
+  void Reset() LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    costs_.clear();
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<std::pair<OverheadProfiler::Operation, std::string>,
+                      Cost>
+      costs_ GUARDED_BY(mu_);
+};
+
+// The number of calls to each operation the calling thread makes before it
+// times one, counting down to 1.
+thread_local uint32_t calls_until_sample[kNumOperations] = {};
+
+}  // namespace
+
+std::atomic<uint32_t> OverheadProfiler::period_{0};
+
+// static
+void OverheadProfiler::SetSamplingPeriod(uint32_t period) {
+  period_.store(period, std::memory_order_relaxed);
+}
+
+// static
+uint32_t OverheadProfiler::sampling_period() {
+  return period_.load(std::memory_order_relaxed);
+}
+
+// static
+std::vector<OverheadProfiler::CallSite> OverheadProfiler::GetCallSites() {
+  return Profile::Get()->GetCallSites();
+}
+
+// static
+void OverheadProfiler::Reset() { Profile::Get()->Reset(); }
+
+// static
+absl::string_view OverheadProfiler::OperationName(Operation operation) {
+  switch (operation) {
+    case Operation::kRecord:
+      return "record";
+    case Operation::kStartSpan:
+      return "start_span";
+    case Operation::kAddAttribute:
+      return "add_attribute";
+    case Operation::kEndSpan:
+      return "end_span";
+  }
+  return "";
+}
+
+// static
+void OverheadProfiler::Add(Operation operation, absl::string_view name,
+                           absl::Duration cost) {
+  const uint32_t period = period_.load(std::memory_order_relaxed);
+  if (period == 0) {
+    // Profiling was turned off during the call.
+    return;
+  }
+  Profile::Get()->Add(operation, name, cost, period);
+}
+
+// static
+bool OverheadProfiler::SampleSlow(Operation operation, uint32_t period) {
+  uint32_t& countdown = calls_until_sample[static_cast<int>(operation)];
+  if (countdown > 1) {
+    --countdown;
+    return false;
+  }
+  // Draw the next interval uniformly from [1, 2 * period - 1], whose mean is
+  // the period, so that samples do not alias with periodic call patterns.
+  countdown =
+      1 + static_cast<uint32_t>(Random::GetRandom()->GenerateRandom64() %
+                                (2 * static_cast<uint64_t>(period) - 1));
+  return true;
+}
+
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,149 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_OVERHEAD_PROFILER_H_
+#define OPENCENSUS_COMMON_INTERNAL_OVERHEAD_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+// **WARNING** This code is subject to change. Do not rely on its API or
+// implementation functioning in the current manner.
+//
+// OverheadProfiler measures what instrumentation costs its callers. While
+// enabled, it times a random sample of calls to stats::Record() (including
+// BoundMeasure::Record()), Span::StartSpan(), Span::AddAttribute(), and
+// Span::End(), and attributes the time spent in each to the measure or span
+// name involved. The summary then shows which call sites account for most of
+// the overhead.
+//
+// Profiling is off by default; while off, each instrumented call pays one
+// relaxed atomic load. While on, sampled calls also take a mutex to record
+// their cost, so the sampling period should be large enough (e.g. 1000) that
+// the profiler does not distort what it measures.
+//
+// Costs are wall time on the calling thread, which matches CPU time unless the
+// thread was descheduled or blocked (e.g. on a contended stats shard) during
+// the call.
+//
+// This class is thread-safe.
+class OverheadProfiler final {
+ public:
+  // The instrumented operations.
+  enum class Operation {
+    kRecord,
+    kStartSpan,
+    kAddAttribute,
+    kEndSpan,
+  };
+
+  // The cost of one operation on one measure or span name.
+  struct CallSite {
+    Operation operation;
+    // The measure name for kRecord, or the span name otherwise.
+    std::string name;
+    // The number of calls timed.
+    uint64_t sampled_calls;
+    // The total and largest time spent in the timed calls. A Record() call
+    // with several measurements splits its time evenly between them.
+    absl::Duration sampled_time;
+    absl::Duration max_time;
+    // sampled_time scaled up by the sampling period in effect for each
+    // sample: an estimate of the time spent in all calls.
+    absl::Duration estimated_total_time;
+  };
+
+  // Sets the profiler to time one in 'period' calls on average, or turns it
+  // off if 'period' is 0. Changing the period does not clear collected data.
+  static void SetSamplingPeriod(uint32_t period);
+  static uint32_t sampling_period();
+
+  // Returns the cost collected since the last Reset(), sorted by
+  // estimated_total_time, largest first.
+  static std::vector<CallSite> GetCallSites();
+
+  // Discards all collected data.
+  static void Reset();
+
+  // Returns the lowercase name of 'operation', e.g. "record".
+  static absl::string_view OperationName(Operation operation);
+
+  // --- For use by the library's instrumented calls ---
+
+  // Returns true if the calling thread should time its current call to
+  // 'operation'.
+  static bool ShouldSample(Operation operation) {
+    const uint32_t period = period_.load(std::memory_order_relaxed);
+    return period != 0 && SampleSlow(operation, period);
+  }
+
+  // Adds one timed call to 'operation' on 'name'.
+  static void Add(Operation operation, absl::string_view name,
+                  absl::Duration cost);
+
+ private:
+  OverheadProfiler() = delete;
+
+  static bool SampleSlow(Operation operation, uint32_t period);
+
+  static std::atomic<uint32_t> period_;
+};
+
+// ProfiledScope times the enclosing call if the profiler samples it.
+// Typical usage:
+//
+//   void Span::End() const {
+//     ProfiledScope profile(OverheadProfiler::Operation::kEndSpan);
+//     ...
+//     if (profile.sampled()) profile.Finish(span_impl_->name());
+//   }
+class ProfiledScope final {
+ public:
+  explicit ProfiledScope(OverheadProfiler::Operation operation)
+      : operation_(operation),
+        sampled_(OverheadProfiler::ShouldSample(operation)) {
+    if (sampled_) {
+      start_ = absl::Now();
+    }
+  }
+
+  bool sampled() const { return sampled_; }
+
+  // Returns the time since construction. Requires sampled().
+  absl::Duration Elapsed() const { return absl::Now() - start_; }
+
+  // Attributes the time since construction to 'name'. Requires sampled().
+  void Finish(absl::string_view name) const {
+    OverheadProfiler::Add(operation_, name, Elapsed());
+  }
+
+ private:
+  const OverheadProfiler::Operation operation_;
+  const bool sampled_;
+  absl::Time start_;
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_OVERHEAD_PROFILER_H_
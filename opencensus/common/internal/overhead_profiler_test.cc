@@ -0,0 +1,125 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/overhead_profiler.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+using Operation = OverheadProfiler::Operation;
+
+class OverheadProfilerTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    OverheadProfiler::SetSamplingPeriod(0);
+    OverheadProfiler::Reset();
+  }
+};
+
+TEST_F(OverheadProfilerTest, DisabledByDefault) {
+  EXPECT_EQ(0, OverheadProfiler::sampling_period());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_FALSE(OverheadProfiler::ShouldSample(Operation::kRecord));
+  }
+  const ProfiledScope scope(Operation::kEndSpan);
+  EXPECT_FALSE(scope.sampled());
+  OverheadProfiler::Add(Operation::kEndSpan, "span", absl::Microseconds(1));
+  EXPECT_TRUE(OverheadProfiler::GetCallSites().empty());
+}
+
+TEST_F(OverheadProfilerTest, AggregatesPerCallSite) {
+  OverheadProfiler::SetSamplingPeriod(1);
+  OverheadProfiler::Add(Operation::kRecord, "m", absl::Microseconds(1));
+  OverheadProfiler::Add(Operation::kRecord, "m", absl::Microseconds(3));
+  OverheadProfiler::Add(Operation::kStartSpan, "m", absl::Microseconds(2));
+  OverheadProfiler::SetSamplingPeriod(10);
+  OverheadProfiler::Add(Operation::kEndSpan, "span", absl::Microseconds(2));
+
+  const std::vector<OverheadProfiler::CallSite> call_sites =
+      OverheadProfiler::GetCallSites();
+  ASSERT_EQ(3, call_sites.size());
+  // Sorted by estimated total time.
+  EXPECT_EQ(Operation::kEndSpan, call_sites[0].operation);
+  EXPECT_EQ("span", call_sites[0].name);
+  EXPECT_EQ(absl::Microseconds(20), call_sites[0].estimated_total_time);
+  EXPECT_EQ(Operation::kRecord, call_sites[1].operation);
+  EXPECT_EQ("m", call_sites[1].name);
+  EXPECT_EQ(2, call_sites[1].sampled_calls);
+  EXPECT_EQ(absl::Microseconds(4), call_sites[1].sampled_time);
+  EXPECT_EQ(absl::Microseconds(3), call_sites[1].max_time);
+  EXPECT_EQ(absl::Microseconds(4), call_sites[1].estimated_total_time);
+  EXPECT_EQ(Operation::kStartSpan, call_sites[2].operation);
+
+  OverheadProfiler::Reset();
+  EXPECT_TRUE(OverheadProfiler::GetCallSites().empty());
+}
+
+TEST_F(OverheadProfilerTest, ScopeRecordsElapsedTime) {
+  OverheadProfiler::SetSamplingPeriod(1);
+  {
+    const ProfiledScope scope(Operation::kAddAttribute);
+    ASSERT_TRUE(scope.sampled());
+    scope.Finish("span");
+  }
+  const std::vector<OverheadProfiler::CallSite> call_sites =
+      OverheadProfiler::GetCallSites();
+  ASSERT_EQ(1, call_sites.size());
+  EXPECT_EQ(Operation::kAddAttribute, call_sites[0].operation);
+  EXPECT_EQ(1, call_sites[0].sampled_calls);
+  EXPECT_GE(call_sites[0].sampled_time, absl::ZeroDuration());
+}
+
+TEST_F(OverheadProfilerTest, SamplesAtPeriod) {
+  constexpr int kPeriod = 10;
+  constexpr int kCalls = 100000;
+  OverheadProfiler::SetSamplingPeriod(kPeriod);
+  int sampled = 0;
+  for (int i = 0; i < kCalls; ++i) {
+    if (OverheadProfiler::ShouldSample(Operation::kRecord)) {
+      ++sampled;
+    }
+  }
+  EXPECT_NEAR(kCalls / kPeriod, sampled, kCalls / kPeriod / 10);
+}
+
+TEST_F(OverheadProfilerTest, LimitsCallSites) {
+  OverheadProfiler::SetSamplingPeriod(1);
+  for (int i = 0; i < 1010; ++i) {
+    OverheadProfiler::Add(Operation::kStartSpan, absl::StrCat("span", i),
+                          absl::Microseconds(1));
+  }
+  const std::vector<OverheadProfiler::CallSite> call_sites =
+      OverheadProfiler::GetCallSites();
+  EXPECT_EQ(1001, call_sites.size());
+  EXPECT_EQ("(other)", call_sites[0].name);
+  EXPECT_EQ(10, call_sites[0].sampled_calls);
+}
+
+TEST(OverheadProfilerOperationTest, OperationName) {
+  EXPECT_EQ("record", OverheadProfiler::OperationName(Operation::kRecord));
+  EXPECT_EQ("end_span", OverheadProfiler::OperationName(Operation::kEndSpan));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,63 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_PROBES_H_
+#define OPENCENSUS_COMMON_INTERNAL_PROBES_H_
+
+// OPENCENSUS_PROBE<N>(name, args...) marks a USDT (SystemTap/DTrace style)
+// static probe named 'name' in the "opencensus" provider, so that tools such
+// as bpftrace and perf can see when the library harvests, merges and exports
+// without recompiling, e.g.
+//
+//   bpftrace -e 'usdt:./server:opencensus:stats_export_begin { ... }'
+//
+// Probes are compiled in by builds that define OPENCENSUS_USDT (e.g. bazel
+// --config=usdt), which needs <sys/sdt.h> (systemtap-sdt-dev). An unattached
+// probe is a single nop, though its arguments, which must be integers or
+// pointers, are still evaluated: pass values the code computes anyway. Without
+// OPENCENSUS_USDT probes expand to nothing and their arguments are not
+// evaluated.
+//
+// The probes are:
+//   delta_swap_begin(), delta_swap_end(sequence): DeltaProducer harvests.
+//   delta_consume_begin(sequence), delta_consume_end(sequence, tag_sets):
+//     merging or publishing one harvested delta.
+//   stats_merge_begin(sequence, num_deltas), stats_merge_end(sequence):
+//     StatsManager merges into the views.
+//   stats_export_begin(final_export), stats_export_end(all_exported): stats
+//     exports to the push handlers.
+//   ended_spans_flush(num_spans): staged ended spans handed to the stores.
+//   span_export_batch_begin(num_spans), span_export_batch_end(num_spans):
+//     converting and posting one batch to the span export handlers.
+//   export_rpc_begin(exporter, rpc), export_rpc_end(exporter, rpc, status):
+//     an exporter's export request, where 'exporter' is its name as in the
+//     self metrics, 'rpc' identifies the request while it is in flight and
+//     'status' is the gRPC status code or HTTP response code (0 if none).
+
+#ifdef OPENCENSUS_USDT
+#include <sys/sdt.h>
+
+#define OPENCENSUS_PROBE0(name) DTRACE_PROBE(opencensus, name)
+#define OPENCENSUS_PROBE1(name, a1) DTRACE_PROBE1(opencensus, name, a1)
+#define OPENCENSUS_PROBE2(name, a1, a2) DTRACE_PROBE2(opencensus, name, a1, a2)
+#define OPENCENSUS_PROBE3(name, a1, a2, a3) \
+  DTRACE_PROBE3(opencensus, name, a1, a2, a3)
+#else
+#define OPENCENSUS_PROBE0(name) static_cast<void>(0)
+#define OPENCENSUS_PROBE1(name, a1) static_cast<void>(0)
+#define OPENCENSUS_PROBE2(name, a1, a2) static_cast<void>(0)
+#define OPENCENSUS_PROBE3(name, a1, a2, a3) static_cast<void>(0)
+#endif
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_PROBES_H_
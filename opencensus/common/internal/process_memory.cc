@@ -0,0 +1,59 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/process_memory.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define OPENCENSUS_HAS_MALLINFO2 1
+#endif
+
+namespace opencensus {
+namespace common {
+
+int64_t ResidentMemoryBytes() {
+  FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr) {
+    return 0;
+  }
+  // The fields are total program size and resident set size, in pages.
+  long size_pages = 0;
+  long resident_pages = 0;
+  const int fields =
+      std::fscanf(statm, "%ld %ld", &size_pages, &resident_pages);
+  std::fclose(statm);
+  if (fields != 2) {
+    return 0;
+  }
+  return static_cast<int64_t>(resident_pages) * sysconf(_SC_PAGESIZE);
+}
+
+int64_t HeapBytesInUse() {
+#ifdef OPENCENSUS_HAS_MALLINFO2
+  const struct mallinfo2 info = mallinfo2();
+  // Small allocations come from the arenas, large ones are mmapped.
+  return static_cast<int64_t>(info.uordblks + info.hblkhd);
+#else
+  return 0;
+#endif
+}
+
+}  // namespace common
+}  // namespace opencensus
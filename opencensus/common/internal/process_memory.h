@@ -0,0 +1,39 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_PROCESS_MEMORY_H_
+#define OPENCENSUS_COMMON_INTERNAL_PROCESS_MEMORY_H_
+
+#include <cstdint>
+
+namespace opencensus {
+namespace common {
+
+// Readings of the process's memory, for benchmarks that estimate memory
+// footprints from the difference between two readings. Each returns 0 where it
+// is not supported.
+
+// The resident set size in bytes, read from /proc/self/statm (Linux). Since the
+// allocator reuses freed memory before growing the heap, this only grows once
+// earlier allocations have been reused.
+int64_t ResidentMemoryBytes();
+
+// The bytes allocated from the heap and not yet freed, including the
+// allocator's per-allocation overhead (glibc 2.33 and later).
+int64_t HeapBytesInUse();
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_PROCESS_MEMORY_H_
@@ -14,39 +14,123 @@
 
 #include "opencensus/common/internal/random.h"
 
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
 #include <cstring>
 
+#include "absl/base/optimization.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "opencensus/common/internal/scheduler.h"
 
 namespace opencensus {
 namespace common {
 
+namespace {
+
+// xoshiro256** (see http://prng.di.unimi.it/): fast, with 256 bits of state,
+// and passes common statistical tests.
+class FastGenerator {
+ public:
+  explicit FastGenerator(uint64_t seed) {
+    // Expand the seed with splitmix64, as recommended by the authors.
+    for (uint64_t& s : state_) {
+      seed += 0x9e3779b97f4a7c15;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      s = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t Next() {
+    const uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 45);
+    return result;
+  }
+
+ private:
+  static uint64_t Rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t state_[4];
+};
+
+}  // namespace
+
 uint64_t Generator::Random64() {
   absl::MutexLock l(&mu_);
   return rng_();
 }
 
+Random::Random() {
+  Scheduler::Get()->AddForkHandler({[this] { PrepareFork(); },
+                                    [this] { ParentAfterFork(); },
+                                    [this] { ChildAfterFork(); }, nullptr});
+}
+
+uint64_t Random::GenerateValue() {
+  struct ThreadGenerator {
+    uint64_t generation;
+    FastGenerator gen;
+  };
+  // Random is a singleton, so all threads seed from the same gen_.
+  static thread_local ThreadGenerator thread_gen{
+      generation_.load(std::memory_order_relaxed),
+      FastGenerator(gen_.Random64())};
+  const uint64_t generation = generation_.load(std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(thread_gen.generation != generation)) {
+    // Forked since the thread's generator was seeded.
+    thread_gen = {generation, FastGenerator(gen_.Random64())};
+  }
+  return thread_gen.gen.Next();
+}
+
+void Random::PrepareFork() { gen_.mu_.Lock(); }
+
+void Random::ParentAfterFork() { gen_.mu_.Unlock(); }
+
+void Random::ChildAfterFork() {
+  Scheduler::ReinitMutexInChild(&gen_.mu_);
+  // Mix in the pid, which differs between siblings forked at the same time.
+  uint64_t seed =
+      gen_.rng_() ^ static_cast<uint64_t>(absl::GetCurrentTimeNanos());
+#if !defined(_WIN32)
+  seed ^= static_cast<uint64_t>(getpid()) << 32;
+#endif
+  gen_.rng_.seed(seed);
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
 Random* Random::GetRandom() {
   static auto* const global_random = new Random;
   return global_random;
 }
 
-uint32_t Random::GenerateRandom32() { return gen_.Random64(); }
+uint32_t Random::GenerateRandom32() { return GenerateValue(); }
 
-uint64_t Random::GenerateRandom64() { return gen_.Random64(); }
+uint64_t Random::GenerateRandom64() { return GenerateValue(); }
 
 float Random::GenerateRandomFloat() {
-  return static_cast<float>(gen_.Random64()) / static_cast<float>(UINT64_MAX);
+  return static_cast<float>(GenerateValue()) / static_cast<float>(UINT64_MAX);
 }
 
 double Random::GenerateRandomDouble() {
-  return static_cast<double>(gen_.Random64()) / static_cast<double>(UINT64_MAX);
+  return static_cast<double>(GenerateValue()) / static_cast<double>(UINT64_MAX);
 }
 
 void Random::GenerateRandomBuffer(uint8_t* buf, size_t buf_size) {
-  absl::MutexLock l(&gen_.mu_);
   for (size_t i = 0; i < buf_size; i += sizeof(uint64_t)) {
-    uint64_t value = gen_.rng_();
+    uint64_t value = GenerateValue();
     if (i + sizeof(uint64_t) <= buf_size) {
       memcpy(&buf[i], &value, sizeof(uint64_t));
     } else {
@@ -15,6 +15,7 @@
 #ifndef OPENCENSUS_COMMON_INTERNAL_RANDOM_H_
 #define OPENCENSUS_COMMON_INTERNAL_RANDOM_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <random>
@@ -40,6 +41,12 @@ class Generator {
   std::mt19937_64 rng_ GUARDED_BY(mu_);
 };
 
+// Random generates pseudo-random numbers without locking: each thread uses its
+// own xoshiro256** generator, seeded from a shared Generator on the thread's
+// first call. In a forked child the shared Generator is reseeded and every
+// thread's generator is reseeded on its next call, so that siblings forked
+// from one parent do not generate the same IDs. The numbers are not suitable
+// for cryptographic use.
 class Random {
  public:
   // Initializes and returns a singleton Random generator.
@@ -60,15 +67,26 @@ class Random {
  private:
   friend class RandomTest;
 
-  Random() = default;
+  Random();
 
   Random(const Random&) = delete;
   Random(Random&&) = delete;
   Random& operator=(const Random&) = delete;
   Random& operator=(Random&&) = delete;
 
+  // Returns the next value of the calling thread's generator.
   uint64_t GenerateValue();
+
+  // Fork handlers (see Scheduler::ForkHandler).
+  void PrepareFork() EXCLUSIVE_LOCK_FUNCTION(gen_.mu_);
+  void ParentAfterFork() UNLOCK_FUNCTION(gen_.mu_);
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+
+  // Seeds the threads' generators.
   Generator gen_;
+  // Incremented in each forked child; threads whose generators were seeded in
+  // an earlier generation reseed them.
+  std::atomic<uint64_t> generation_{0};
 };
 
 }  // namespace common
@@ -33,7 +33,7 @@ void BM_Random64(benchmark::State& state) {
     ::opencensus::common::Random::GetRandom()->GenerateRandom64();
   }
 }
-BENCHMARK(BM_Random64);
+BENCHMARK(BM_Random64)->ThreadRange(1, 16);
 
 void BM_RandomBuffer(benchmark::State& state) {
   const size_t size = state.range(0);
@@ -44,6 +44,7 @@ void BM_RandomBuffer(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_RandomBuffer)->Range(1, 16);
+BENCHMARK(BM_RandomBuffer)->Arg(8)->ThreadRange(1, 16);
 
 }  // namespace
 BENCHMARK_MAIN();
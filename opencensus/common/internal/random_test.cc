@@ -13,6 +13,15 @@
 // limitations under the License.
 
 #include "opencensus/common/internal/random.h"
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <thread>
+
 #include "gtest/gtest.h"
 
 namespace opencensus {
@@ -33,5 +42,52 @@ TEST(RandomTest, GenerateValues) {
   }
 }
 
+TEST(RandomTest, ThreadsGenerateDistinctValues) {
+  Random* rand = Random::GetRandom();
+  uint64_t values[2];
+  std::thread t1([&]() { values[0] = rand->GenerateRandom64(); });
+  std::thread t2([&]() { values[1] = rand->GenerateRandom64(); });
+  t1.join();
+  t2.join();
+  EXPECT_NE(values[0], values[1]);
+}
+
+#if !defined(_WIN32)
+TEST(RandomTest, ForkedChildGeneratesDifferentValues) {
+  Random* rand = Random::GetRandom();
+  // Seed this thread's generator before forking.
+  rand->GenerateRandom64();
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  const pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    close(fds[0]);
+    uint64_t values[2];
+    values[0] = rand->GenerateRandom64();
+    std::thread t([&]() { values[1] = rand->GenerateRandom64(); });
+    t.join();
+    const bool written =
+        write(fds[1], values, sizeof(values)) == sizeof(values);
+    _exit(written ? 0 : 1);
+  }
+  close(fds[1]);
+  uint64_t parent_values[2];
+  parent_values[0] = rand->GenerateRandom64();
+  std::thread t([&]() { parent_values[1] = rand->GenerateRandom64(); });
+  t.join();
+  uint64_t child_values[2];
+  ASSERT_EQ(sizeof(child_values), read(fds[0], child_values,
+                                       sizeof(child_values)));
+  close(fds[0]);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_NE(parent_values[0], child_values[0]);
+  EXPECT_NE(parent_values[1], child_values[1]);
+}
+#endif
+
 }  // namespace common
 }  // namespace opencensus
@@ -0,0 +1,371 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/scheduler.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#include <time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+// The id of the task running on this thread, or 0.
+thread_local uint64_t current_task = 0;
+
+// The CPU time of the calling thread, or 0 if it cannot be measured.
+int64_t ThreadCpuTimeNanos() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+#endif
+  return 0;
+}
+
+}  // namespace
+
+constexpr absl::Duration Scheduler::kCoalescingWindow;
+
+// static
+Scheduler* Scheduler::Get() {
+  static Scheduler* global_scheduler = new Scheduler;
+  return global_scheduler;
+}
+
+Scheduler::Scheduler() {
+#if !defined(_WIN32)
+  pthread_atfork(&PrepareFork, &ParentAfterFork, &ChildAfterFork);
+#endif
+}
+
+void Scheduler::SetExecutor(Executor executor) {
+  absl::MutexLock l(&mu_);
+  if (!started_) {
+    executor_ = std::move(executor);
+  }
+}
+
+void Scheduler::SetManualMode() {
+  absl::MutexLock l(&mu_);
+  if (!started_ && !mode_fixed_) {
+    manual_mode_ = true;
+  }
+}
+
+bool Scheduler::manual_mode() {
+  absl::MutexLock l(&mu_);
+  mode_fixed_ = true;
+  return manual_mode_;
+}
+
+uint64_t Scheduler::AddTask(Task task, absl::Time first_run) {
+  Executor executor;
+  uint64_t id;
+  {
+    absl::MutexLock l(&mu_);
+    id = next_id_++;
+    TaskState& state = tasks_[id];
+    state.task = std::move(task);
+    state.next_run = first_run;
+    tasks_changed_ = true;
+    mode_fixed_ = true;
+    if (started_ || manual_mode_) {
+      return id;
+    }
+    started_ = true;
+    executor = executor_;
+  }
+  // Start the thread outside mu_, in case the executor runs the loop before
+  // returning.
+  StartThread(executor);
+  return id;
+}
+
+void Scheduler::StartThread(const Executor& executor) {
+  std::function<void()> loop = [this] { Run(); };
+  if (executor) {
+    executor(std::move(loop));
+  } else {
+    std::thread(std::move(loop)).detach();
+  }
+}
+
+void Scheduler::Wake(uint64_t id) {
+  if (id == current_task) {
+    return;
+  }
+  absl::MutexLock l(&mu_);
+  auto it = tasks_.find(id);
+  if (it != tasks_.end()) {
+    it->second.woken = true;
+    tasks_changed_ = true;
+  }
+}
+
+void Scheduler::RemoveTask(uint64_t id) {
+  absl::MutexLock l(&mu_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end()) {
+    return;
+  }
+  if (id != current_task) {
+    TaskState* state = &it->second;
+    mu_.Await(absl::Condition(
+        +[](TaskState* state) { return !state->running; }, state));
+  }
+  tasks_.erase(id);
+  tasks_changed_ = true;
+}
+
+void Scheduler::RunTaskNow(uint64_t id) {
+  absl::MutexLock l(&mu_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end()) {
+    return;
+  }
+  const std::pair<const Scheduler*, const TaskState*> scheduler_and_task(
+      this, &it->second);
+  mu_.Await(absl::Condition(&CanRunTask, &scheduler_and_task));
+  RunTask(it);
+  // Restart the thread's wait for the task's new schedule.
+  tasks_changed_ = true;
+}
+
+absl::Time Scheduler::RunDueTasks() {
+  absl::MutexLock l(&mu_);
+  if (!forking_ && NextRunTime() <= absl::Now()) {
+    RunTasksDueBy(absl::Now() + kCoalescingWindow);
+  }
+  return NextRunTime();
+}
+
+absl::Time Scheduler::NextRunTime() const {
+  absl::Time next_run = absl::InfiniteFuture();
+  for (const auto& entry : tasks_) {
+    const TaskState& state = entry.second;
+    if (state.running) {
+      continue;
+    }
+    next_run = std::min(next_run,
+                        state.woken ? absl::InfinitePast() : state.next_run);
+  }
+  return next_run;
+}
+
+void Scheduler::Run() {
+  mu_.Lock();
+  while (true) {
+    tasks_changed_ = false;
+    if (forking_) {
+      mu_.Await(absl::Condition(this, &Scheduler::NotForking));
+      continue;
+    }
+    const absl::Time next_run = NextRunTime();
+    if (next_run > absl::Now()) {
+      // Sleep until the next task is due, restarting the wait if the tasks
+      // change.
+      mu_.AwaitWithDeadline(absl::Condition(&tasks_changed_), next_run);
+      continue;
+    }
+    // Run every task due within the coalescing window.
+    RunTasksDueBy(absl::Now() + kCoalescingWindow);
+  }
+}
+
+void Scheduler::RunTasksDueBy(absl::Time horizon) {
+  std::vector<uint64_t> due;
+  for (const auto& entry : tasks_) {
+    const TaskState& state = entry.second;
+    if (!state.running && (state.woken || state.next_run <= horizon)) {
+      due.push_back(entry.first);
+    }
+  }
+  for (const uint64_t id : due) {
+    // Tasks may be removed, or start running elsewhere, while mu_ is released,
+    // and must not start while preparing to fork.
+    if (forking_) {
+      return;
+    }
+    auto it = tasks_.find(id);
+    if (it != tasks_.end() && !it->second.running) {
+      RunTask(it);
+    }
+  }
+}
+
+void Scheduler::RunTask(std::map<uint64_t, TaskState>::iterator it) {
+  TaskState& state = it->second;
+  state.woken = false;
+  state.running = true;
+  // Tasks may run others with RunTaskNow().
+  const uint64_t enclosing_task = current_task;
+  current_task = it->first;
+  mu_.Unlock();
+  const int64_t start_cpu_nanos =
+      enclosing_task == 0 ? ThreadCpuTimeNanos() : 0;
+  const absl::Time next_run = state.task();
+  if (enclosing_task == 0) {
+    task_cpu_nanos_.fetch_add(ThreadCpuTimeNanos() - start_cpu_nanos,
+                              std::memory_order_relaxed);
+  }
+  mu_.Lock();
+  current_task = enclosing_task;
+  state.running = false;
+  state.next_run = next_run;
+}
+
+void Scheduler::AddForkHandler(ForkHandler handler) {
+  absl::MutexLock l(&mu_);
+  fork_handlers_.push_back(std::move(handler));
+}
+
+// static
+void Scheduler::AbandonThread(std::thread* thread) {
+  if (thread->joinable()) {
+    // Destroying a joinable std::thread terminates, so move it to a handle
+    // that is never destroyed.
+    new std::thread(std::move(*thread));
+  }
+}
+
+// static
+void Scheduler::ReinitMutexInChild(absl::Mutex* mu) {
+  // The old mutex is not destroyed, since that would inspect its waiters. Its
+  // deadlock detection node is removed, so that the entries for it left in
+  // this thread's held locks do not match the new mutex.
+  mu->ForgetDeadlockInfo();
+  new (mu) absl::Mutex;
+}
+
+bool Scheduler::NoTaskRunning() const {
+  for (const auto& entry : tasks_) {
+    if (entry.second.running && entry.first != current_task) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// static
+bool Scheduler::CanRunTask(
+    const std::pair<const Scheduler*, const TaskState*>* scheduler_and_task) {
+  return !scheduler_and_task->first->forking_ &&
+         !scheduler_and_task->second->running;
+}
+
+// static
+void Scheduler::PrepareFork() {
+  Scheduler* scheduler = Get();
+  std::vector<ForkHandler> handlers;
+  {
+    absl::MutexLock l(&scheduler->mu_);
+    scheduler->forking_ = true;
+    scheduler->mu_.Await(absl::Condition(scheduler, &Scheduler::NoTaskRunning));
+    handlers = scheduler->fork_handlers_;
+  }
+  // The handlers acquire mutexes that are held while waking the scheduler, so
+  // mu_ must be acquired after them.
+  for (const ForkHandler& handler : handlers) {
+    if (handler.prepare) {
+      handler.prepare();
+    }
+  }
+  // mu_ is held across fork(), and released by the other handlers.
+  scheduler->mu_.Lock();
+  scheduler->prepared_fork_handlers_ = std::move(handlers);
+}
+
+// static
+void Scheduler::ParentAfterFork() {
+  Scheduler* scheduler = Get();
+  const std::vector<ForkHandler> handlers =
+      std::move(scheduler->prepared_fork_handlers_);
+  scheduler->prepared_fork_handlers_.clear();
+  scheduler->mu_.Unlock();
+  for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
+    if (it->parent) {
+      it->parent();
+    }
+  }
+  absl::MutexLock l(&scheduler->mu_);
+  scheduler->forking_ = false;
+  scheduler->tasks_changed_ = true;
+}
+
+// static
+void Scheduler::ChildAfterFork() {
+  Scheduler* scheduler = Get();
+  const std::vector<ForkHandler> handlers =
+      std::move(scheduler->prepared_fork_handlers_);
+  scheduler->prepared_fork_handlers_.clear();
+  // The thread did not survive the fork. No tasks are running, except perhaps
+  // one on this thread, which finishes as usual.
+  scheduler->started_ = false;
+  scheduler->forking_ = false;
+  scheduler->restart_after_fork_.store(true, std::memory_order_release);
+  ReinitMutexInChild(&scheduler->mu_);
+  for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
+    if (it->child) {
+      it->child();
+    }
+  }
+}
+
+void Scheduler::DoRestartAfterFork() {
+  if (!restart_after_fork_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  std::vector<std::function<void()>> restarts;
+  Executor executor;
+  bool start = false;
+  {
+    absl::MutexLock l(&mu_);
+    for (const ForkHandler& handler : fork_handlers_) {
+      if (handler.restart) {
+        restarts.push_back(handler.restart);
+      }
+    }
+    if (!started_ && !manual_mode_ && !tasks_.empty()) {
+      started_ = true;
+      start = true;
+      executor = executor_;
+    }
+  }
+  if (start) {
+    StartThread(executor);
+  }
+  for (const auto& restart : restarts) {
+    restart();
+  }
+}
+
+}  // namespace common
+}  // namespace opencensus
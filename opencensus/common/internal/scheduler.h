@@ -0,0 +1,221 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_SCHEDULER_H_
+#define OPENCENSUS_COMMON_INTERNAL_SCHEDULER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace common {
+
+// Scheduler runs the library's periodic background work (stats harvests and
+// span exports) as timed tasks on one shared thread, instead of a thread per
+// loop. When the thread wakes up, it runs every task due within
+// kCoalescingWindow, so that tasks with similar schedules share wakeups.
+//
+// Tasks must not block for long, since they delay each other; work that waits
+// on handlers runs on the handlers' own threads.
+//
+// In manual mode (see SetManualMode()) there is no thread: the application
+// runs tasks by calling RunDueTasks() from its own loop, and exporters call
+// their handlers on the calling thread.
+//
+// The scheduler also coordinates fork() (through pthread_atfork()) for the
+// components that own background threads or mutexes taken on background
+// threads, which register a ForkHandler: before fork, it waits for running
+// tasks to return and holds off new ones, and the handlers acquire their
+// components' mutexes, so that the child gets consistent state. In the child,
+// where only the forking thread exists, the handlers release the mutexes and
+// discard the parent's threads and queued data; threads are restarted lazily,
+// by the first RestartAfterFork() call, which the library makes when spans end
+// and stats are recorded.
+//
+// This class is thread-safe.
+class Scheduler final {
+ public:
+  // Tasks due up to this long after the earliest due task run with it.
+  static constexpr absl::Duration kCoalescingWindow = absl::Milliseconds(50);
+
+  // A task returns the time of its next run. Since runs may come early, by
+  // Wake() or by up to kCoalescingWindow, tasks should check what is due.
+  typedef std::function<absl::Time()> Task;
+
+  // Starts the scheduler's thread: called once (and again in a forked child)
+  // with the loop that runs all tasks, which never returns.
+  typedef std::function<void(std::function<void()> loop)> Executor;
+
+  static Scheduler* Get();
+
+  // Sets how the scheduler's thread is started, e.g. to run it on a thread
+  // pinned to a chosen CPU. By default, the loop runs on a new std::thread.
+  // Only takes effect if called before the library schedules its first task
+  // (i.e. before recording stats or registering a span exporter).
+  void SetExecutor(Executor executor) LOCKS_EXCLUDED(mu_);
+
+  // Switches to manual mode, for applications (e.g. event-loop servers) that
+  // want no background threads: the scheduler's thread is never started, and
+  // stats and span handlers export on the thread that runs the task exporting
+  // to them. Must be called before the library schedules its first task; has
+  // no effect after manual_mode() is first read.
+  void SetManualMode() LOCKS_EXCLUDED(mu_);
+  bool manual_mode() LOCKS_EXCLUDED(mu_);
+
+  // Runs, on the calling thread, every task that has been woken or is due
+  // within kCoalescingWindow and is not already running. Returns when it
+  // should next be called: the time the next task is due, or InfinitePast()
+  // if a task was woken meanwhile. Intended for manual mode.
+  absl::Time RunDueTasks() LOCKS_EXCLUDED(mu_);
+
+  // Adds 'task', first run at 'first_run', starting the thread if needed.
+  // Returns an id for Wake() and RemoveTask().
+  uint64_t AddTask(Task task, absl::Time first_run) LOCKS_EXCLUDED(mu_);
+
+  // Runs task 'id' as soon as possible; if it is running, runs it again once
+  // it returns. Has no effect when called by the task itself.
+  void Wake(uint64_t id) LOCKS_EXCLUDED(mu_);
+
+  // Removes task 'id', first waiting for it to return if it is running
+  // (unless called by the task itself).
+  void RemoveTask(uint64_t id) LOCKS_EXCLUDED(mu_);
+
+  // Runs task 'id' on the calling thread, first waiting for it to return if it
+  // is running. Must not be called by the task itself.
+  void RunTaskNow(uint64_t id) LOCKS_EXCLUDED(mu_);
+
+  // Returns the CPU time the running threads have spent in tasks since the
+  // process started, measured with the thread CPU clock where available (and
+  // as zero elsewhere). Tasks run by other tasks count once, with the task
+  // that ran them.
+  absl::Duration TaskCpuTime() const {
+    return absl::Nanoseconds(task_cpu_nanos_.load(std::memory_order_relaxed));
+  }
+
+  struct ForkHandler {
+    // Called in the parent before fork(), with no task running, to acquire the
+    // component's mutexes.
+    std::function<void()> prepare;
+    // Called in the parent after fork(), to release them.
+    std::function<void()> parent;
+    // Called in the child after fork(), to release them (with
+    // ReinitMutexInChild()) and discard what belongs to the parent, such as
+    // its threads (see AbandonThread()) and data queued for export. Must not
+    // start threads.
+    std::function<void()> child;
+    // If not null, called by the first RestartAfterFork() in the child,
+    // holding no locks, to restart the component's threads.
+    std::function<void()> restart;
+  };
+
+  // Adds 'handler'. Prepare handlers are called in the order added, and parent
+  // and child handlers in reverse.
+  void AddForkHandler(ForkHandler handler) LOCKS_EXCLUDED(mu_);
+
+  // In a child forked since the last call, restarts the scheduler's thread
+  // (unless in manual mode) and calls the restart handlers. Otherwise this is
+  // a single atomic load, cheap enough for the library's hot paths.
+  void RestartAfterFork() {
+    if (ABSL_PREDICT_FALSE(
+            restart_after_fork_.load(std::memory_order_acquire))) {
+      DoRestartAfterFork();
+    }
+  }
+
+  // For child handlers: forgets '*thread', which belonged to the parent,
+  // without joining or detaching it (as neither is possible), leaving it not
+  // joinable.
+  static void AbandonThread(std::thread* thread);
+
+  // For child handlers: releases '*mu', which the handler's prepare acquired,
+  // by reinitializing it. Unlocking it is not safe, since absl::Mutex queues
+  // its waiters in the mutex itself, and the parent's threads waiting for it
+  // do not exist in the child.
+  static void ReinitMutexInChild(absl::Mutex* mu);
+
+ private:
+  struct TaskState {
+    Task task;
+    absl::Time next_run;
+    bool woken = false;
+    bool running = false;
+  };
+
+  Scheduler();
+
+  // The pthread_atfork() handlers. mu_ is held from the end of PrepareFork()
+  // to the start of the others.
+  static void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  static void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  static void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void DoRestartAfterFork() LOCKS_EXCLUDED(mu_);
+  // Starts the thread running Run() with 'executor', or a new std::thread.
+  void StartThread(const Executor& executor);
+  // Conditions for mu_. Tasks running on the calling thread (which may fork)
+  // are not counted.
+  bool NoTaskRunning() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  bool NotForking() const EXCLUSIVE_LOCKS_REQUIRED(mu_) { return !forking_; }
+  static bool CanRunTask(
+      const std::pair<const Scheduler*, const TaskState*>* scheduler_and_task)
+      NO_THREAD_SAFETY_ANALYSIS;
+
+  void Run() LOCKS_EXCLUDED(mu_);
+  // Runs the tasks that are woken or due by 'horizon' and not running,
+  // releasing mu_ while each runs.
+  void RunTasksDueBy(absl::Time horizon) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Runs the task of 'it', which must not be running, releasing mu_ while it
+  // runs.
+  void RunTask(std::map<uint64_t, TaskState>::iterator it)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns when the next task should run.
+  absl::Time NextRunTime() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  Executor executor_ GUARDED_BY(mu_);
+  bool started_ GUARDED_BY(mu_) = false;
+  bool manual_mode_ GUARDED_BY(mu_) = false;
+  // Set once manual_mode_ has been read, after which it cannot change.
+  bool mode_fixed_ GUARDED_BY(mu_) = false;
+  // Set when the tasks change, to restart the thread's wait.
+  bool tasks_changed_ GUARDED_BY(mu_) = false;
+  uint64_t next_id_ GUARDED_BY(mu_) = 1;
+  // Keyed by id. Entries do not move, so the thread can run a task without
+  // holding mu_ while RemoveTask() waits for it.
+  std::map<uint64_t, TaskState> tasks_ GUARDED_BY(mu_);
+
+  // Set from before fork() until after it, while tasks must not start.
+  bool forking_ GUARDED_BY(mu_) = false;
+  std::vector<ForkHandler> fork_handlers_ GUARDED_BY(mu_);
+  // The handlers prepared for the fork in progress.
+  std::vector<ForkHandler> prepared_fork_handlers_ GUARDED_BY(mu_);
+  // Set in a forked child until RestartAfterFork() runs.
+  std::atomic<bool> restart_after_fork_{false};
+  // See TaskCpuTime().
+  std::atomic<int64_t> task_cpu_nanos_{0};
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_SCHEDULER_H_
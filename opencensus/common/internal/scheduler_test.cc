@@ -0,0 +1,180 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/scheduler.h"
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+std::atomic<bool> loop_ran_on_executor{false};
+
+// Must run first, since the executor only applies before the first task.
+TEST(SchedulerTest, UsesExecutor) {
+  Scheduler::Get()->SetExecutor([](std::function<void()> loop) {
+    std::thread([loop] {
+      loop_ran_on_executor = true;
+      loop();
+    }).detach();
+  });
+  absl::Notification done;
+  const uint64_t id = Scheduler::Get()->AddTask(
+      [&done] {
+        done.Notify();
+        return absl::InfiniteFuture();
+      },
+      absl::Now());
+  done.WaitForNotification();
+  EXPECT_TRUE(loop_ran_on_executor);
+  Scheduler::Get()->RemoveTask(id);
+}
+
+TEST(SchedulerTest, RunsAtScheduledTimes) {
+  std::atomic<int> runs{0};
+  absl::Notification done;
+  const uint64_t id = Scheduler::Get()->AddTask(
+      [&] {
+        if (++runs == 3) {
+          done.Notify();
+        }
+        return absl::Now() + absl::Milliseconds(10);
+      },
+      absl::Now());
+  done.WaitForNotification();
+  Scheduler::Get()->RemoveTask(id);
+  const int final_runs = runs;
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_EQ(final_runs, runs);
+}
+
+TEST(SchedulerTest, Wake) {
+  absl::Notification done;
+  const uint64_t id = Scheduler::Get()->AddTask(
+      [&] {
+        done.Notify();
+        return absl::InfiniteFuture();
+      },
+      absl::Now() + absl::Hours(1));
+  Scheduler::Get()->Wake(id);
+  // Would time out if the task did not run early.
+  done.WaitForNotification();
+  Scheduler::Get()->RemoveTask(id);
+}
+
+TEST(SchedulerTest, CoalescesWakeups) {
+  const absl::Time start = absl::Now();
+  const absl::Time first = start + absl::Milliseconds(100);
+  const absl::Time second = first + Scheduler::kCoalescingWindow / 2;
+  absl::Notification first_done;
+  absl::Notification second_done;
+  absl::Time second_ran;
+  const uint64_t id1 = Scheduler::Get()->AddTask(
+      [&] {
+        first_done.Notify();
+        return absl::InfiniteFuture();
+      },
+      first);
+  const uint64_t id2 = Scheduler::Get()->AddTask(
+      [&] {
+        second_ran = absl::Now();
+        second_done.Notify();
+        return absl::InfiniteFuture();
+      },
+      second);
+  first_done.WaitForNotification();
+  second_done.WaitForNotification();
+  // The second task ran in the first task's wakeup, before it was due.
+  EXPECT_LT(second_ran, second);
+  Scheduler::Get()->RemoveTask(id1);
+  Scheduler::Get()->RemoveTask(id2);
+}
+
+#if !defined(_WIN32)
+// Global, since fork handlers cannot be removed.
+std::atomic<int> fork_prepares{0};
+std::atomic<int> fork_parents{0};
+std::atomic<int> fork_children{0};
+std::atomic<int> fork_restarts{0};
+
+TEST(SchedulerTest, Fork) {
+  Scheduler::Get()->AddForkHandler(
+      {[] { ++fork_prepares; }, [] { ++fork_parents; },
+       [] { ++fork_children; }, [] { ++fork_restarts; }});
+  std::atomic<int> runs{0};
+  const uint64_t id = Scheduler::Get()->AddTask(
+      [&runs] {
+        ++runs;
+        return absl::Now() + absl::Milliseconds(1);
+      },
+      absl::Now());
+  // Waits until the task runs 'n' more times, returning false on timeout.
+  const auto wait_for_runs = [&runs](int n) {
+    const int target = runs + n;
+    const absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (runs < target) {
+      if (absl::Now() > deadline) {
+        return false;
+      }
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    return true;
+  };
+  ASSERT_TRUE(wait_for_runs(1));
+
+  const pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    // Report failures in the child through its exit code.
+    if (fork_children != 1 || fork_restarts != 0) {
+      _exit(1);
+    }
+    Scheduler::Get()->RestartAfterFork();
+    Scheduler::Get()->RestartAfterFork();
+    if (fork_restarts != 1) {
+      _exit(2);
+    }
+    // The scheduler's thread was restarted.
+    _exit(wait_for_runs(2) ? 0 : 3);
+  }
+  EXPECT_EQ(1, fork_prepares);
+  EXPECT_EQ(1, fork_parents);
+  EXPECT_EQ(0, fork_children);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  // The parent's thread keeps running tasks.
+  EXPECT_TRUE(wait_for_runs(2));
+  Scheduler::Get()->RemoveTask(id);
+}
+#endif
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,54 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/common/internal/self_metrics.h"
+
+#include <atomic>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+namespace {
+
+std::atomic<SelfMetricSink> sink{nullptr};
+
+// Set while the calling thread is inside the sink.
+thread_local bool in_sink = false;
+
+}  // namespace
+
+void SetSelfMetricSink(SelfMetricSink new_sink) {
+  sink.store(new_sink, std::memory_order_release);
+}
+
+bool SelfMetricsEnabled() {
+  return sink.load(std::memory_order_acquire) != nullptr;
+}
+
+void RecordSelfMetric(SelfMetric metric, double value,
+                      absl::string_view label) {
+  const SelfMetricSink current = sink.load(std::memory_order_acquire);
+  if (current == nullptr || in_sink) {
+    return;
+  }
+  in_sink = true;
+  current(metric, value, label);
+  in_sink = false;
+}
+
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,91 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_SELF_METRICS_H_
+#define OPENCENSUS_COMMON_INTERNAL_SELF_METRICS_H_
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+// The library's own metrics, recorded by the stats and trace pipelines and by
+// exporters so that a pipeline falling behind is visible. The stats library
+// exports them as the opencensus.io/internal/* views (see
+// StatsConfig::RegisterInternalViewsForExport()); this hook lets libraries
+// that do not depend on stats record them.
+enum class SelfMetric {
+  // Spans dropped before export, by the span exporter's queues or by an export
+  // handler. Value: a count.
+  kSpansDropped,
+  // Spans queued for conversion when an export cycle starts. Value: a count.
+  kSpanExportQueueDepth,
+  // The halvings of the default sampler's probability applied by the span
+  // exporter's backlog feedback, at the start of each export cycle while it is
+  // enabled. Value: a count.
+  kSpanBacklogHalvings,
+  // Time to merge one harvested delta into views. Value: milliseconds.
+  kMergeDeltaLatency,
+  // Distinct tag sets in one harvested delta. Value: a count.
+  kDeltaTagSets,
+  // How late a scheduled harvest started. Value: milliseconds.
+  kHarvestLag,
+  // Time to collect view data and wait for the stats export handlers. Value:
+  // milliseconds.
+  kStatsExportLatency,
+  // Stats export handlers that overran their deadline. Value: a count.
+  kStatsExportOverruns,
+  // Latency of one exporter RPC. Value: milliseconds.
+  kExporterRpcLatency,
+  // Failed exporter RPCs. Value: a count.
+  kExporterRpcErrors,
+  // The rows held by a view, and their approximate bytes, after a harvest.
+  // Label: the view name. Value: a count or bytes.
+  kViewRows,
+  kViewBytes,
+  // The approximate bytes held by the delta being recorded ("active") and the
+  // buffers kept for reuse from merged deltas ("last"), after a harvest.
+  // Label: "active" or "last". Value: bytes.
+  kDeltaBytes,
+  // The spans held by a span store, and their approximate bytes, at the start
+  // of each export cycle. Label: "running", "local", or "export_queue".
+  // Value: a count or bytes.
+  kSpanStoreSpans,
+  kSpanStoreBytes,
+};
+
+// Receives self-metric values. 'label' names the exporter for the
+// kExporterRpc* metrics, or what is measured as listed above, and is empty
+// otherwise.
+typedef void (*SelfMetricSink)(SelfMetric metric, double value,
+                               absl::string_view label);
+
+// Installs 'sink' (or, if null, stops recording). Thread-safe.
+void SetSelfMetricSink(SelfMetricSink sink);
+
+// Returns true if a sink is installed, so that callers can skip computing
+// self-metrics that are costly to measure. Thread-safe.
+bool SelfMetricsEnabled();
+
+// Passes 'value' to the installed sink, if any. This costs one atomic load
+// when no sink is installed. Calls made by the sink itself are dropped, so
+// recording a self-metric never recurses. Thread-safe.
+void RecordSelfMetric(SelfMetric metric, double value,
+                      absl::string_view label = absl::string_view());
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_SELF_METRICS_H_
@@ -0,0 +1,76 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/common/internal/self_metrics.h"
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+using ::testing::ElementsAre;
+
+std::vector<std::tuple<SelfMetric, double, std::string>>* records =
+    new std::vector<std::tuple<SelfMetric, double, std::string>>;
+
+void RecordingSink(SelfMetric metric, double value,
+                   absl::string_view exporter) {
+  records->emplace_back(metric, value, std::string(exporter));
+}
+
+void RecursingSink(SelfMetric metric, double value,
+                   absl::string_view exporter) {
+  records->emplace_back(metric, value, std::string(exporter));
+  RecordSelfMetric(metric, value + 1, exporter);
+}
+
+TEST(SelfMetricsTest, RecordsToSink) {
+  records->clear();
+  RecordSelfMetric(SelfMetric::kSpansDropped, 1);
+  EXPECT_FALSE(SelfMetricsEnabled());
+  SetSelfMetricSink(&RecordingSink);
+  EXPECT_TRUE(SelfMetricsEnabled());
+  RecordSelfMetric(SelfMetric::kSpansDropped, 2);
+  RecordSelfMetric(SelfMetric::kExporterRpcLatency, 3.5, "zipkin");
+  SetSelfMetricSink(nullptr);
+  EXPECT_FALSE(SelfMetricsEnabled());
+  RecordSelfMetric(SelfMetric::kSpansDropped, 4);
+  EXPECT_THAT(*records,
+              ElementsAre(std::make_tuple(SelfMetric::kSpansDropped, 2, ""),
+                          std::make_tuple(SelfMetric::kExporterRpcLatency,
+                                          3.5, "zipkin")));
+}
+
+TEST(SelfMetricsTest, DoesNotRecurse) {
+  records->clear();
+  SetSelfMetricSink(&RecursingSink);
+  RecordSelfMetric(SelfMetric::kHarvestLag, 1);
+  RecordSelfMetric(SelfMetric::kHarvestLag, 5);
+  SetSelfMetricSink(nullptr);
+  EXPECT_THAT(*records,
+              ElementsAre(std::make_tuple(SelfMetric::kHarvestLag, 1, ""),
+                          std::make_tuple(SelfMetric::kHarvestLag, 5, "")));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -19,14 +19,31 @@
 #include <string>
 #include <vector>
 
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "opencensus/common/internal/hash_mix.h"
 
 namespace opencensus {
 namespace common {
 
+// Hashes a sequence of strings. Transparent, so that containers keyed by
+// std::vector<std::string> can be searched with a
+// Span<const absl::string_view> without copying the strings.
 struct StringVectorHash {
+  using is_transparent = void;
+
   std::size_t operator()(const std::vector<std::string>& container) const {
-    std::hash<std::string> hasher;
+    return Hash(container);
+  }
+  std::size_t operator()(absl::Span<const absl::string_view> container) const {
+    return Hash(container);
+  }
+
+ private:
+  template <typename Container>
+  static std::size_t Hash(const Container& container) {
+    absl::Hash<absl::string_view> hasher;
     HashMix mixer;
     for (const auto& elem : container) {
       mixer.Mix(hasher(elem));
@@ -35,6 +52,24 @@ struct StringVectorHash {
   }
 };
 
+// Compares sequences of strings, transparently as for StringVectorHash.
+struct StringVectorEqual {
+  using is_transparent = void;
+
+  template <typename T, typename U>
+  bool operator()(const T& a, const U& b) const {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (absl::string_view(a[i]) != absl::string_view(b[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
 }  // namespace common
 }  // namespace opencensus
 
@@ -0,0 +1,57 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/common/internal/string_vector_hash.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+TEST(StringVectorHashTest, TransparentLookup) {
+  const std::vector<std::string> strings = {"a", "bc"};
+  const std::vector<absl::string_view> views = {"a", "bc"};
+  EXPECT_EQ(StringVectorHash()(strings),
+            StringVectorHash()(absl::Span<const absl::string_view>(views)));
+  EXPECT_TRUE(StringVectorEqual()(strings, views));
+  EXPECT_FALSE(StringVectorEqual()(strings, std::vector<std::string>({"a"})));
+}
+
+TEST(StringVectorHashTest, EveryElementContributes) {
+  // Vectors differing only in an early element must not collide.
+  std::unordered_set<std::size_t> hashes;
+  constexpr int kNumVectors = 100;
+  for (int i = 0; i < kNumVectors; ++i) {
+    hashes.insert(StringVectorHash()(
+        std::vector<std::string>({absl::StrCat("value", i), "last"})));
+  }
+  EXPECT_EQ(kNumVectors, hashes.size());
+}
+
+TEST(StringVectorHashTest, OrderMatters) {
+  EXPECT_NE(StringVectorHash()(std::vector<std::string>({"a", "b"})),
+            StringVectorHash()(std::vector<std::string>({"b", "a"})));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,87 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/unix_datagram_sender.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+UnixDatagramSender::UnixDatagramSender(absl::string_view path) {
+  memset(&addr_, 0, sizeof(addr_));
+  addr_.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr_.sun_path)) {
+    return;
+  }
+  memcpy(addr_.sun_path, path.data(), path.size());
+  addr_len_ = offsetof(sockaddr_un, sun_path) + path.size() + 1;
+  fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd_ >= 0) {
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+  }
+}
+
+UnixDatagramSender::~UnixDatagramSender() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool UnixDatagramSender::Send(absl::string_view header,
+                              absl::string_view payload, std::string* error) {
+  if (fd_ < 0) {
+    if (error != nullptr) {
+      *error = addr_len_ == 0 ? "invalid socket path" : "socket() failed";
+    }
+    return false;
+  }
+  iovec iov[2];
+  iov[0].iov_base = const_cast<char*>(header.data());
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = const_cast<char*>(payload.data());
+  iov[1].iov_len = payload.size();
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &addr_;
+  msg.msg_namelen = addr_len_;
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0) {
+    if (error != nullptr) {
+      *error = absl::StrCat("sendmsg() failed: ", strerror(errno));
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace common
+}  // namespace opencensus
@@ -0,0 +1,60 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_INTERNAL_UNIX_DATAGRAM_SENDER_H_
+#define OPENCENSUS_COMMON_INTERNAL_UNIX_DATAGRAM_SENDER_H_
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace common {
+
+// UnixDatagramSender sends datagrams to a local agent listening on a Unix
+// domain datagram socket. Sends never block: datagrams are dropped if the
+// agent is not running or its receive buffer is full, so a slow agent cannot
+// stall the exporting thread. Each send is addressed to the socket path, so
+// a restarted agent is picked up without reconnecting.
+//
+// UnixDatagramSender is thread-compatible.
+class UnixDatagramSender final {
+ public:
+  // 'path' must fit in sockaddr_un::sun_path; otherwise every send fails.
+  explicit UnixDatagramSender(absl::string_view path);
+  ~UnixDatagramSender();
+
+  UnixDatagramSender(const UnixDatagramSender&) = delete;
+  UnixDatagramSender& operator=(const UnixDatagramSender&) = delete;
+
+  // Sends 'header' followed by 'payload' as one datagram, without copying
+  // them together. Returns false, setting *error (if not null), if the
+  // datagram was dropped.
+  bool Send(absl::string_view header, absl::string_view payload,
+            std::string* error = nullptr);
+
+ private:
+  int fd_ = -1;
+  sockaddr_un addr_;
+  socklen_t addr_len_ = 0;
+};
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_INTERNAL_UNIX_DATAGRAM_SENDER_H_
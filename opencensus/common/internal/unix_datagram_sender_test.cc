@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/common/internal/unix_datagram_sender.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace common {
+namespace {
+
+class UnixDatagramSenderTest : public ::testing::Test {
+ protected:
+  UnixDatagramSenderTest()
+      // Test temporary directories may exceed the socket path limit.
+      : path_(absl::StrCat("/tmp/oc_agent_test_", getpid(), ".sock")) {}
+
+  ~UnixDatagramSenderTest() override {
+    if (fd_ >= 0) {
+      close(fd_);
+      unlink(path_.c_str());
+    }
+  }
+
+  void Bind() {
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(fd_, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ASSERT_LT(path_.size(), sizeof(addr.sun_path));
+    memcpy(addr.sun_path, path_.data(), path_.size());
+    unlink(path_.c_str());
+    ASSERT_EQ(0, bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  }
+
+  std::string Receive() {
+    char buf[256];
+    const ssize_t n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+    return n < 0 ? "" : std::string(buf, n);
+  }
+
+  const std::string path_;
+  int fd_ = -1;
+};
+
+TEST_F(UnixDatagramSenderTest, SendsHeaderAndPayload) {
+  Bind();
+  UnixDatagramSender sender(path_);
+  EXPECT_TRUE(sender.Send("ab", "cde"));
+  EXPECT_TRUE(sender.Send("", "f"));
+  EXPECT_EQ("abcde", Receive());
+  EXPECT_EQ("f", Receive());
+}
+
+TEST_F(UnixDatagramSenderTest, DropsWithoutAgent) {
+  UnixDatagramSender sender(path_);
+  std::string error;
+  EXPECT_FALSE(sender.Send("ab", "cde", &error));
+  EXPECT_FALSE(error.empty());
+
+  // A later agent is picked up.
+  Bind();
+  EXPECT_TRUE(sender.Send("ab", "cde"));
+  EXPECT_EQ("abcde", Receive());
+}
+
+TEST_F(UnixDatagramSenderTest, InvalidPath) {
+  UnixDatagramSender sender(std::string(sizeof(sockaddr_un::sun_path), 'a'));
+  std::string error;
+  EXPECT_FALSE(sender.Send("ab", "cde", &error));
+  EXPECT_EQ("invalid socket path", error);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace opencensus
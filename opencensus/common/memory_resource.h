@@ -0,0 +1,114 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_COMMON_MEMORY_RESOURCE_H_
+#define OPENCENSUS_COMMON_MEMORY_RESOURCE_H_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace opencensus {
+namespace common {
+
+// MemoryResource is the source of memory for the library's large internal
+// containers, so that they can be placed in huge-page arenas or the arenas of
+// another allocator (e.g. tcmalloc or jemalloc) rather than scattered across
+// the heap. It plays the role of std::pmr::memory_resource, which is not
+// available in C++11.
+//
+// Implementations must be thread-safe.
+class MemoryResource {
+ public:
+  virtual ~MemoryResource() = default;
+
+  // Returns at least 'bytes' bytes aligned to 'alignment', which is a power of
+  // 2 no greater than alignof(std::max_align_t). Must not return nullptr.
+  virtual void* Allocate(size_t bytes, size_t alignment) = 0;
+  // Frees memory returned by Allocate() with the same 'bytes' and
+  // 'alignment'.
+  virtual void Deallocate(void* p, size_t bytes, size_t alignment) = 0;
+};
+
+// The groups of containers whose memory can be placed separately.
+enum class MemorySubsystem {
+  // The rows of the stats recording buffers (deltas), written on every
+  // Record() and read by each harvest.
+  kStatsDeltas,
+  // The rows of view data, read by every export and scrape.
+  kStatsViews,
+  // The running and sampled span stores.
+  kSpanStores,
+};
+
+// Returns the resource that allocates with operator new and frees with
+// operator delete, which every subsystem uses by default.
+MemoryResource* NewDeleteResource();
+
+// Sets the resource that containers of 'subsystem' created from now on
+// allocate from; nullptr restores NewDeleteResource(). This should be called
+// at initialization, before the library is used. Containers created earlier
+// keep the resource they were created with, so a resource must never be
+// destroyed once set.
+void SetMemoryResource(MemorySubsystem subsystem, MemoryResource* resource);
+MemoryResource* GetMemoryResource(MemorySubsystem subsystem);
+
+// A standard allocator drawing from the resource of 'kSubsystem' as of its
+// construction, for the containers of that subsystem. Copies, and containers
+// moved or swapped, keep the resource their memory came from.
+template <typename T, MemorySubsystem kSubsystem>
+class ResourceAllocator {
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+  template <typename U>
+  struct rebind {
+    typedef ResourceAllocator<U, kSubsystem> other;
+  };
+
+  ResourceAllocator() : resource_(GetMemoryResource(kSubsystem)) {}
+  template <typename U>
+  ResourceAllocator(const ResourceAllocator<U, kSubsystem>& other)
+      : resource_(other.resource()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(resource_->Allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* p, size_t n) {
+    resource_->Deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  MemoryResource* resource() const { return resource_; }
+
+ private:
+  MemoryResource* resource_;
+};
+
+template <typename T, typename U, MemorySubsystem kSubsystem>
+bool operator==(const ResourceAllocator<T, kSubsystem>& a,
+                const ResourceAllocator<U, kSubsystem>& b) {
+  return a.resource() == b.resource();
+}
+
+template <typename T, typename U, MemorySubsystem kSubsystem>
+bool operator!=(const ResourceAllocator<T, kSubsystem>& a,
+                const ResourceAllocator<U, kSubsystem>& b) {
+  return a.resource() != b.resource();
+}
+
+}  // namespace common
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_COMMON_MEMORY_RESOURCE_H_
@@ -0,0 +1,73 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_CONTEXT_BIND_CONTEXT_H_
+#define OPENCENSUS_CONTEXT_BIND_CONTEXT_H_
+
+#include <type_traits>
+#include <utility>
+
+#include "opencensus/context/context.h"
+#include "opencensus/context/with_context.h"
+
+namespace opencensus {
+namespace context {
+
+// ContextBoundCallable wraps a callable so that it runs with a given Context
+// installed, for propagating Contexts through thread pools and executors. It
+// is the templated counterpart of Context::Wrap(): it stores the callable by
+// value without type erasure, so it supports move-only callables and does not
+// allocate, and holding the Context costs a pointer copy.
+//
+// Example usage:
+//   pool.Schedule(opencensus::context::BindContext(std::move(task)));
+template <typename F>
+class ContextBoundCallable {
+ public:
+  ContextBoundCallable(Context ctx, F fn)
+      : ctx_(std::move(ctx)), fn_(std::move(fn)) {}
+
+  // Runs the callable with the bound Context installed.
+  template <typename... Args>
+  typename std::result_of<F&(Args&&...)>::type operator()(Args&&... args) {
+    WithContext wc(ctx_);
+    return fn_(std::forward<Args>(args)...);
+  }
+
+  const Context& context() const { return ctx_; }
+
+ private:
+  Context ctx_;
+  F fn_;
+};
+
+// Returns 'fn' bound to 'ctx'.
+template <typename F>
+ContextBoundCallable<typename std::decay<F>::type> BindContext(Context ctx,
+                                                              F&& fn) {
+  return ContextBoundCallable<typename std::decay<F>::type>(
+      std::move(ctx), std::forward<F>(fn));
+}
+
+// Returns 'fn' bound to the current Context.
+template <typename F>
+ContextBoundCallable<typename std::decay<F>::type> BindContext(F&& fn) {
+  return BindContext(Context::Current(), std::forward<F>(fn));
+}
+
+}  // namespace context
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_CONTEXT_BIND_CONTEXT_H_
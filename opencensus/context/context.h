@@ -15,7 +15,9 @@
 #ifndef OPENCENSUS_CONTEXT_CONTEXT_H_
 #define OPENCENSUS_CONTEXT_CONTEXT_H_
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <string>
 
 #include "opencensus/tags/tag_map.h"
@@ -33,8 +35,12 @@ class WithSpan;
 namespace context {
 
 // Context holds information specific to an operation, such as a TagMap and
-// Span. Each thread has a currently active Context. Contexts are conceptually
-// immutable: the contents of a Context cannot be modified in-place.
+// Span. Each thread has a currently active Context. Contexts are immutable: the
+// contents of a Context cannot be modified in-place, so copies share them, and
+// copying a Context (e.g. in Wrap()) only copies a pointer and increments a
+// reference count. WithSpan installs a Context that borrows its Span without
+// copying it; copying such a Context copies the Span out, so copies never
+// outlive the WithSpan.
 //
 // This is a draft implementation of Context, and we chose to depend on TagMap
 // and Span directly. In future, the implementation will change, so only rely
@@ -46,10 +52,19 @@ class Context {
   static const Context& Current();
 
   // Context is copiable and movable.
-  Context(const Context&) = default;
-  Context(Context&&) = default;
-  Context& operator=(const Context&) = default;
-  Context& operator=(Context&&) = default;
+  Context(const Context& other) : node_(other.Share()) {}
+  Context(Context&& other) : node_(other.node_) { other.node_ = nullptr; }
+  Context& operator=(const Context& other) {
+    Context copy(other);
+    swap(*this, copy);
+    return *this;
+  }
+  Context& operator=(Context&& other) {
+    Context moved(std::move(other));
+    swap(*this, moved);
+    return *this;
+  }
+  ~Context() { Unref(); }
 
   // Returns an std::function wrapped to run with a copy of this Context.
   std::function<void()> Wrap(std::function<void()> fn) const;
@@ -59,21 +74,93 @@ class Context {
   std::string DebugString() const;
 
  private:
-  // Creates a default Context.
-  Context();
+  // The contents of a non-default Context, shared by all of its copies. The
+  // TagMap is shared separately so that a Context derived by replacing only
+  // the Span does not copy it.
+  //
+  // A borrowed Node is owned by a WithSpan: it points to the caller's Span and
+  // to the tags of the Context it replaced (which the WithSpan keeps alive),
+  // and is not reference counted.
+  struct Node {
+    // Creates a borrowed Node for 'span' on top of 'parent' (nullptr for a
+    // default Context).
+    Node(const Node* parent, const opencensus::trace::Span* span)
+        : borrowed(true),
+          tags(parent == nullptr ? nullptr : parent->tags),
+          span(span) {}
+
+    const bool borrowed;
+    std::atomic<int> refcount{1};
+    // nullptr, or pointing to nullptr, if empty.
+    const std::shared_ptr<const opencensus::tags::TagMap>* tags;
+    const opencensus::trace::Span* span;
+
+   protected:
+    Node() : borrowed(false), tags(nullptr), span(nullptr) {}
+  };
+  // A heap-allocated Node holding its own tags and Span, deleted with its last
+  // reference.
+  struct OwnedNode : Node {
+    OwnedNode(std::shared_ptr<const opencensus::tags::TagMap> tags,
+              opencensus::trace::Span span)
+        : owned_tags(std::move(tags)), owned_span(std::move(span)) {
+      this->tags = &owned_tags;
+      this->span = &owned_span;
+    }
+
+    const std::shared_ptr<const opencensus::tags::TagMap> owned_tags;
+    const opencensus::trace::Span owned_span;
+  };
+
+  // Creates a default Context, with no tags and a blank Span. This does not
+  // allocate, and is constexpr so that each thread's current Context is
+  // constant-initialized.
+  constexpr Context() : node_(nullptr) {}
+  explicit Context(Node* node) : node_(node) {}
 
   static Context* InternalMutableCurrent();
-  friend void swap(Context& a, Context& b);
+  friend void swap(Context& a, Context& b) {
+    Node* const node = a.node_;
+    a.node_ = b.node_;
+    b.node_ = node;
+  }
+
+  const opencensus::tags::TagMap& tags() const;
+  const opencensus::trace::Span& span() const;
+  // Return a copy of this Context with the tags or Span replaced.
+  Context ReplaceTags(opencensus::tags::TagMap tags) const;
+  Context ReplaceSpan(const opencensus::trace::Span& span) const;
+
+  // Returns node_ with a reference added, or an OwnedNode copy of it if it is
+  // borrowed.
+  Node* Share() const {
+    if (node_ == nullptr) return nullptr;
+    if (node_->borrowed) return Promote();
+    node_->refcount.fetch_add(1, std::memory_order_relaxed);
+    return node_;
+  }
+  Node* Promote() const;
+  void Unref() const {
+    if (node_ != nullptr && !node_->borrowed &&
+        node_->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete static_cast<OwnedNode*>(node_);
+    }
+  }
+  // Returns the shared TagMap of node_, which may be nullptr.
+  std::shared_ptr<const opencensus::tags::TagMap> SharedTags() const {
+    return node_ == nullptr || node_->tags == nullptr ? nullptr : *node_->tags;
+  }
 
   friend class ContextTestPeer;
+  friend class CoroutineContext;
   friend class WithContext;
   friend class ::opencensus::tags::ContextPeer;
   friend class ::opencensus::tags::WithTagMap;
   friend class ::opencensus::trace::ContextPeer;
   friend class ::opencensus::trace::WithSpan;
 
-  opencensus::tags::TagMap tags_;
-  opencensus::trace::Span span_;
+  // nullptr for a default Context.
+  Node* node_;
 };
 
 }  // namespace context
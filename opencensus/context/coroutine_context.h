@@ -0,0 +1,196 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_CONTEXT_COROUTINE_CONTEXT_H_
+#define OPENCENSUS_CONTEXT_COROUTINE_CONTEXT_H_
+
+// Requires C++20 coroutines; empty otherwise.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+#include "opencensus/context/context.h"
+
+namespace opencensus {
+namespace context {
+
+// CoroutineContext gives a C++20 coroutine its own Context, installed
+// whenever the coroutine runs and removed whenever it suspends, so that the
+// Context follows the coroutine across threads instead of leaking into (or
+// being taken from) whichever thread resumes it. Each suspension and
+// resumption swaps two pointers: nothing is allocated or reference counted.
+//
+// The coroutine starts with the Context current where it was created. Changes
+// made while it runs (e.g. by WithSpan) stay with the coroutine, and the
+// resuming thread's Context is restored when it suspends.
+//
+// To use it, add a CoroutineContext to the coroutine's promise type and route
+// the promise's suspension points through it:
+//
+//   struct promise_type {
+//     opencensus::context::CoroutineContext context;
+//
+//     auto initial_suspend() { return context.Initial(std::suspend_always()); }
+//     auto final_suspend() noexcept {
+//       return context.Final(std::suspend_always());
+//     }
+//     template <typename Awaitable>
+//     auto await_transform(Awaitable&& awaitable) {
+//       return context.Await(std::forward<Awaitable>(awaitable));
+//     }
+//     ...
+//   };
+//
+// Every co_await in the coroutine must go through Await(); co_yield goes
+// through the promise's yield_value(), which should likewise return
+// Await(...) of its awaiter. If an awaiter's await_suspend() throws, the
+// coroutine continues with the resuming thread's Context.
+//
+// WithContext, WithSpan and WithTagMap check in debug builds that they are
+// destroyed on the thread that created them, so they must not be held across
+// a co_await that may resume on another thread.
+//
+// CoroutineContext is thread-compatible: the coroutine's suspension points
+// order its calls.
+class CoroutineContext final {
+ public:
+  // Captures the current Context for the coroutine.
+  CoroutineContext() : ctx_(Context::Current()) {}
+
+  CoroutineContext(const CoroutineContext&) = delete;
+  CoroutineContext& operator=(const CoroutineContext&) = delete;
+
+  // Wraps the awaiter returned by the promise's initial_suspend(), installing
+  // the coroutine's Context when the body starts.
+  template <typename Awaiter>
+  auto Initial(Awaiter&& awaiter) {
+    return InitialAwaiter<std::decay_t<Awaiter>>{
+        std::forward<Awaiter>(awaiter), this};
+  }
+
+  // Wraps the awaiter returned by the promise's final_suspend(), restoring the
+  // resuming thread's Context once the body has finished.
+  template <typename Awaiter>
+  auto Final(Awaiter&& awaiter) noexcept {
+    return FinalAwaiter<std::decay_t<Awaiter>>{std::forward<Awaiter>(awaiter),
+                                               this};
+  }
+
+  // Wraps the operand of a co_await (or the awaiter of a co_yield), removing
+  // the coroutine's Context while it is suspended. An awaiter passed by
+  // reference is referenced rather than copied; like any operand of co_await,
+  // it lives until the co_await completes.
+  template <typename Awaitable>
+  auto Await(Awaitable&& awaitable) {
+    using AwaiterT = decltype(GetAwaiter(std::forward<Awaitable>(awaitable)));
+    return SuspendAwaiter<AwaiterT>{
+        GetAwaiter(std::forward<Awaitable>(awaitable)), this};
+  }
+
+ private:
+  // Swaps the coroutine's Context with the thread's. ctx_ holds the coroutine's
+  // Context while it is suspended, and the resuming thread's while it runs.
+  void Swap() {
+    using std::swap;
+    swap(*Context::InternalMutableCurrent(), ctx_);
+  }
+
+  // Applies operator co_await, if the awaitable has one. Returns a reference
+  // to the awaitable otherwise.
+  template <typename Awaitable>
+  static decltype(auto) GetAwaiter(Awaitable&& awaitable) {
+    if constexpr (requires {
+                    std::forward<Awaitable>(awaitable).operator co_await();
+                  }) {
+      return std::forward<Awaitable>(awaitable).operator co_await();
+    } else if constexpr (requires {
+                           operator co_await(
+                               std::forward<Awaitable>(awaitable));
+                         }) {
+      return operator co_await(std::forward<Awaitable>(awaitable));
+    } else {
+      return std::forward<Awaitable>(awaitable);
+    }
+  }
+
+  template <typename Awaiter>
+  struct InitialAwaiter {
+    bool await_ready() { return awaiter.await_ready(); }
+    template <typename Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> handle) {
+      return awaiter.await_suspend(handle);
+    }
+    decltype(auto) await_resume() {
+      context->Swap();
+      return awaiter.await_resume();
+    }
+
+    Awaiter awaiter;
+    CoroutineContext* context;
+  };
+
+  template <typename Awaiter>
+  struct FinalAwaiter {
+    // Called before the coroutine suspends or is destroyed.
+    bool await_ready() noexcept {
+      context->Swap();
+      return awaiter.await_ready();
+    }
+    template <typename Promise>
+    decltype(auto) await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      return awaiter.await_suspend(handle);
+    }
+    decltype(auto) await_resume() noexcept { return awaiter.await_resume(); }
+
+    Awaiter awaiter;
+    CoroutineContext* context;
+  };
+
+  // Awaiter may be a reference.
+  template <typename Awaiter>
+  struct SuspendAwaiter {
+    bool await_ready() { return awaiter.await_ready(); }
+    // Once the coroutine is suspended another thread may resume it, so the
+    // Context is swapped out before the handle is passed on.
+    template <typename Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> handle) {
+      context->Swap();
+      suspended = true;
+      return awaiter.await_suspend(handle);
+    }
+    // Not preceded by await_suspend() if await_ready() returned true.
+    decltype(auto) await_resume() {
+      if (suspended) {
+        context->Swap();
+      }
+      return awaiter.await_resume();
+    }
+
+    Awaiter awaiter;
+    CoroutineContext* context;
+    bool suspended = false;
+  };
+
+  Context ctx_;
+};
+
+}  // namespace context
+}  // namespace opencensus
+
+#endif  // defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#endif  // OPENCENSUS_CONTEXT_COROUTINE_CONTEXT_H_
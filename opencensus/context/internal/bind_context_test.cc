@@ -0,0 +1,89 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/context/bind_context.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+#include "opencensus/context/context.h"
+#include "opencensus/tags/context_util.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+
+// Not in namespace ::opencensus::context in order to better reflect what user
+// code should look like.
+
+namespace {
+
+opencensus::tags::TagMap ExampleTagMap() {
+  static const auto k1 = opencensus::tags::TagKey::Register("key1");
+  return opencensus::tags::TagMap({{k1, "v1"}});
+}
+
+// A move-only callable that returns the value it holds.
+class MoveOnlyFn {
+ public:
+  explicit MoveOnlyFn(int value) : value_(absl::make_unique<int>(value)) {}
+  MoveOnlyFn(MoveOnlyFn&&) = default;
+
+  int operator()(int addend) {
+    EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
+    return *value_ + addend;
+  }
+
+ private:
+  std::unique_ptr<int> value_;
+};
+
+TEST(BindContextTest, MoveOnlyCallable) {
+  auto fn = [] {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    return opencensus::context::BindContext(MoveOnlyFn(1));
+  }();
+  EXPECT_TRUE(opencensus::tags::GetCurrentTagMap().tags().empty());
+  EXPECT_EQ(3, fn(2));
+  EXPECT_TRUE(opencensus::tags::GetCurrentTagMap().tags().empty());
+}
+
+TEST(BindContextTest, RunsOnAnotherThread) {
+  bool ran = false;
+  std::thread t;
+  {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    t = std::thread(opencensus::context::BindContext([&ran]() {
+      EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
+      ran = true;
+    }));
+  }
+  t.join();
+  EXPECT_TRUE(ran);
+}
+
+TEST(BindContextTest, ExplicitContext) {
+  opencensus::context::Context ctx = opencensus::context::Context::Current();
+  opencensus::tags::WithTagMap wt(ExampleTagMap());
+  auto fn = opencensus::context::BindContext(ctx, []() {
+    EXPECT_TRUE(opencensus::tags::GetCurrentTagMap().tags().empty());
+  });
+  fn();
+  EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
+}
+
+}  // namespace
@@ -15,6 +15,7 @@
 #include "opencensus/context/context.h"
 
 #include <functional>
+#include <memory>
 #include <utility>
 
 #include "absl/strings/str_cat.h"
@@ -22,19 +23,9 @@
 #include "opencensus/tags/tag_map.h"
 #include "opencensus/trace/span.h"
 
-#if defined(_MSC_VER)
-#define TLS __declspec(thread)
-#else
-#define TLS __thread
-#endif
-
 namespace opencensus {
 namespace context {
 
-Context::Context()
-    : tags_(opencensus::tags::TagMap({})),
-      span_(opencensus::trace::Span::BlankSpan()) {}
-
 // static
 const Context& Context::Current() { return *InternalMutableCurrent(); }
 
@@ -48,21 +39,46 @@ std::function<void()> Context::Wrap(std::function<void()> fn) const {
 
 std::string Context::DebugString() const {
   return absl::StrCat("ctx@", absl::Hex(this),
-                      " span=", span_.context().ToString(),
-                      ", tags=", tags_.DebugString());
+                      " span=", span().context().ToString(),
+                      ", tags=", tags().DebugString());
 }
 
 // static
 Context* Context::InternalMutableCurrent() {
-  static TLS Context* thread_ctx = nullptr;
-  if (thread_ctx == nullptr) thread_ctx = new Context;
-  return thread_ctx;
+  // Constant-initialized, so that access needs no lazy allocation, and
+  // destroyed when the thread exits, releasing whatever tags and Span it still
+  // holds. It must not be used by the destructors of thread_local objects
+  // destroyed after it.
+  static thread_local Context thread_ctx;
+  return &thread_ctx;
+}
+
+const opencensus::tags::TagMap& Context::tags() const {
+  static const opencensus::tags::TagMap* empty_tags =
+      new opencensus::tags::TagMap({});
+  return node_ == nullptr || node_->tags == nullptr || *node_->tags == nullptr
+             ? *empty_tags
+             : **node_->tags;
+}
+
+const opencensus::trace::Span& Context::span() const {
+  static const opencensus::trace::Span* blank_span =
+      new opencensus::trace::Span(opencensus::trace::Span::BlankSpan());
+  return node_ == nullptr ? *blank_span : *node_->span;
+}
+
+Context Context::ReplaceTags(opencensus::tags::TagMap tags) const {
+  return Context(new OwnedNode(
+      std::make_shared<const opencensus::tags::TagMap>(std::move(tags)),
+      span()));
+}
+
+Context Context::ReplaceSpan(const opencensus::trace::Span& span) const {
+  return Context(new OwnedNode(SharedTags(), span));
 }
 
-void swap(Context& a, Context& b) {
-  using std::swap;
-  swap(a.span_, b.span_);
-  swap(a.tags_, b.tags_);
+Context::Node* Context::Promote() const {
+  return new OwnedNode(SharedTags(), *node_->span);
 }
 
 }  // namespace context
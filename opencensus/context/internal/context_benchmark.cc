@@ -12,10 +12,28 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#endif
+#include <deque>
 #include <functional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "benchmark/benchmark.h"
+#include "opencensus/context/bind_context.h"
 #include "opencensus/context/context.h"
+#include "opencensus/context/coroutine_context.h"
+#include "opencensus/context/with_context.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/with_span.h"
 
 namespace opencensus {
 namespace context {
@@ -47,6 +65,258 @@ void BM_WrapDefaultContext(benchmark::State& state) {
 }
 BENCHMARK(BM_WrapDefaultContext);
 
+// Returns an example TagMap.
+opencensus::tags::TagMap Tags() {
+  static const auto k1 = opencensus::tags::TagKey::Register("key1");
+  static const auto k2 = opencensus::tags::TagKey::Register("key2");
+  static const auto k3 = opencensus::tags::TagKey::Register("key3");
+  return opencensus::tags::TagMap({{k1, "val1"}, {k2, "val2"}, {k3, "val3"}});
+}
+
+void BM_CopyContextWithTagsAndSpan(benchmark::State& state) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  opencensus::tags::WithTagMap wt(Tags());
+  opencensus::trace::WithSpan ws(span);
+  Context ctx = Context::Current();
+  for (auto _ : state) {
+    Context copy = ctx;
+    benchmark::DoNotOptimize(copy);
+  }
+  span.End();
+}
+BENCHMARK(BM_CopyContextWithTagsAndSpan);
+
+void BM_WrapContextWithTagsAndSpan(benchmark::State& state) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  opencensus::tags::WithTagMap wt(Tags());
+  opencensus::trace::WithSpan ws(span);
+  std::function<void()> fn = []() {};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Context::Current().Wrap(fn));
+  }
+  span.End();
+}
+BENCHMARK(BM_WrapContextWithTagsAndSpan);
+
+// Capturing and restoring a Context, as when hopping between callbacks.
+void BM_WithContextWithTagsAndSpan(benchmark::State& state) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  Context ctx = Context::Current();
+  {
+    opencensus::tags::WithTagMap wt(Tags());
+    opencensus::trace::WithSpan ws(span);
+    ctx = Context::Current();
+  }
+  for (auto _ : state) {
+    WithContext wc(ctx);
+  }
+  span.End();
+}
+BENCHMARK(BM_WithContextWithTagsAndSpan);
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+// A coroutine that suspends forever, resumed by hand. With kPropagate its
+// promise carries a CoroutineContext.
+template <bool kPropagate>
+class Loop {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  struct Empty {};
+  struct promise_type {
+    std::conditional_t<kPropagate, CoroutineContext, Empty> context;
+
+    Loop get_return_object() { return Loop(Handle::from_promise(*this)); }
+    auto initial_suspend() {
+      if constexpr (kPropagate) {
+        return context.Initial(std::suspend_never());
+      } else {
+        return std::suspend_never();
+      }
+    }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    template <typename Awaitable>
+    auto await_transform(Awaitable&& awaitable) {
+      if constexpr (kPropagate) {
+        return context.Await(std::forward<Awaitable>(awaitable));
+      } else {
+        return std::forward<Awaitable>(awaitable);
+      }
+    }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+
+  ~Loop() { handle_.destroy(); }
+  void Resume() { handle_.resume(); }
+
+ private:
+  explicit Loop(Handle handle) : handle_(handle) {}
+  Handle handle_;
+};
+
+template <bool kPropagate>
+Loop<kPropagate> Suspender() {
+  while (true) {
+    co_await std::suspend_always();
+  }
+}
+
+// Resuming a coroutine and letting it suspend again, with and without
+// swapping in its Context; compare with BM_WrapContextWithTagsAndSpan.
+template <bool kPropagate>
+void BM_CoroutineResume(benchmark::State& state) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  opencensus::tags::WithTagMap wt(Tags());
+  opencensus::trace::WithSpan ws(span);
+  Loop<kPropagate> loop = Suspender<kPropagate>();
+  for (auto _ : state) {
+    loop.Resume();
+  }
+  span.End();
+}
+BENCHMARK_TEMPLATE(BM_CoroutineResume, false);
+BENCHMARK_TEMPLATE(BM_CoroutineResume, true);
+
+#endif  // defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+// A minimal thread pool of type-erased tasks, as executors commonly are.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      absl::MutexLock l(&mu_);
+      shutdown_ = true;
+    }
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Schedule(std::function<void()> task) {
+    absl::MutexLock l(&mu_);
+    tasks_.push_back(std::move(task));
+    ++pending_;
+  }
+
+  // Blocks until all scheduled tasks have run.
+  void Wait() {
+    absl::MutexLock l(&mu_);
+    mu_.Await(absl::Condition(this, &ThreadPool::Done));
+  }
+
+ private:
+  bool Done() const EXCLUSIVE_LOCKS_REQUIRED(mu_) { return pending_ == 0; }
+  bool HasWork() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return shutdown_ || !tasks_.empty();
+  }
+
+  void Run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        absl::MutexLock l(&mu_);
+        mu_.Await(absl::Condition(this, &ThreadPool::HasWork));
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+      absl::MutexLock l(&mu_);
+      --pending_;
+    }
+  }
+
+  absl::Mutex mu_;
+  std::deque<std::function<void()>> tasks_ GUARDED_BY(mu_);
+  int pending_ GUARDED_BY(mu_) = 0;
+  bool shutdown_ GUARDED_BY(mu_) = false;
+  std::vector<std::thread> threads_;
+};
+
+constexpr int kNumPoolThreads = 4;
+
+// Schedules state.range(0) tasks through a ThreadPool with a Context holding
+// tags and a Span propagated by 'schedule'.
+template <typename ScheduleFn>
+void ThreadPoolBenchmark(benchmark::State& state, ScheduleFn schedule) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  opencensus::tags::WithTagMap wt(Tags());
+  opencensus::trace::WithSpan ws(span);
+  ThreadPool pool(kNumPoolThreads);
+  for (auto _ : state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      schedule(&pool);
+    }
+    pool.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  span.End();
+}
+
+void ScheduleWithoutContext(ThreadPool* pool) {
+  pool->Schedule([]() {});
+}
+
+void ScheduleWrapped(ThreadPool* pool) {
+  pool->Schedule(Context::Current().Wrap([]() {}));
+}
+
+void ScheduleBound(ThreadPool* pool) {
+  pool->Schedule(BindContext([]() {}));
+}
+
+void BM_ThreadPoolWithoutContext(benchmark::State& state) {
+  ThreadPoolBenchmark(state, ScheduleWithoutContext);
+}
+BENCHMARK(BM_ThreadPoolWithoutContext)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_ThreadPoolWrap(benchmark::State& state) {
+  ThreadPoolBenchmark(state, ScheduleWrapped);
+}
+BENCHMARK(BM_ThreadPoolWrap)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_ThreadPoolBindContext(benchmark::State& state) {
+  ThreadPoolBenchmark(state, ScheduleBound);
+}
+BENCHMARK(BM_ThreadPoolBindContext)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Starting a thread per task, with a Context propagated into it, as pools that
+// grow and shrink with load do; each thread's Context is released when it
+// exits. Run from several threads at once.
+void BM_ThreadChurn(benchmark::State& state) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  opencensus::tags::WithTagMap wt(Tags());
+  opencensus::trace::WithSpan ws(span);
+  const std::function<void()> task = Context::Current().Wrap(
+      []() { benchmark::DoNotOptimize(Context::Current()); });
+  for (auto _ : state) {
+    std::thread thread(task);
+    thread.join();
+  }
+  span.End();
+}
+BENCHMARK(BM_ThreadChurn)->ThreadRange(1, 8)->UseRealTime();
+
 }  // namespace
 }  // namespace context
 }  // namespace opencensus
@@ -16,6 +16,7 @@
 
 #include <functional>
 #include <iostream>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "opencensus/tags/context_util.h"
@@ -27,11 +28,30 @@
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/with_span.h"
 
+namespace opencensus {
+namespace context {
+
+class ContextTestPeer {
+ public:
+  // Makes a copy of 'ctx' current, without restoring the previous Context.
+  static void SetCurrent(const Context& ctx) {
+    *Context::InternalMutableCurrent() = ctx;
+  }
+  static int RefCount(const Context& ctx) {
+    return ctx.node_->refcount.load(std::memory_order_relaxed);
+  }
+};
+
+}  // namespace context
+}  // namespace opencensus
+
 // Not in namespace ::opencensus::context in order to better reflect what user
 // code should look like.
 
 namespace {
 
+using opencensus::context::ContextTestPeer;
+
 void LogCurrentContext() {
   const std::string s = opencensus::context::Context::Current().DebugString();
   std::cout << "  current: " << s << "\n";
@@ -54,6 +74,19 @@ TEST(ContextTest, DefaultContext) {
   ExpectEmptyContext();
 }
 
+TEST(ContextTest, ThreadExitReleasesContext) {
+  opencensus::tags::WithTagMap wt(ExampleTagMap());
+  const opencensus::context::Context ctx =
+      opencensus::context::Context::Current();
+  const int refcount = ContextTestPeer::RefCount(ctx);
+  std::thread thread([&ctx]() {
+    ContextTestPeer::SetCurrent(ctx);
+    EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
+  });
+  thread.join();
+  EXPECT_EQ(refcount, ContextTestPeer::RefCount(ctx));
+}
+
 void Callback1(const opencensus::trace::Span& expected_span) {
   EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
   EXPECT_EQ(expected_span.context(),
@@ -99,4 +132,42 @@ TEST(ContextTest, WrappedFnIsCopiable) {
   fn2();
 }
 
+TEST(ContextTest, CapturedContextIsImmutable) {
+  auto span = opencensus::trace::Span::StartSpan("MySpan");
+  std::function<void()> fn;
+  {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    fn = opencensus::context::Context::Current().Wrap(
+        []() { Callback1(opencensus::trace::Span::BlankSpan()); });
+    // Later scopes install new Contexts rather than modifying the captured one.
+    opencensus::trace::WithSpan ws(span);
+    opencensus::tags::WithTagMap wt2(opencensus::tags::TagMap({}));
+    fn();
+  }
+  span.End();
+}
+
+TEST(ContextTest, NestedBorrowedSpans) {
+  auto span1 = opencensus::trace::Span::StartSpan("Span1");
+  auto span2 = opencensus::trace::Span::StartSpan("Span2", &span1);
+  std::function<void()> fn;
+  {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    opencensus::trace::WithSpan ws1(span1);
+    {
+      // The inner WithSpan finds the tags through the outer one.
+      opencensus::trace::WithSpan ws2(span2);
+      Callback1(span2);
+      // Wrap() copies the borrowed Span, so fn can outlive both WithSpans.
+      fn = opencensus::context::Context::Current().Wrap(
+          [span2]() { Callback1(span2); });
+    }
+    Callback1(span1);
+  }
+  ExpectEmptyContext();
+  fn();
+  span2.End();
+  span1.End();
+}
+
 }  // namespace
@@ -0,0 +1,193 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/context/coroutine_context.h"
+
+// The tests only run when built as C++20.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <thread>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "opencensus/tags/context_util.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+
+// Not in namespace ::opencensus::context in order to better reflect what user
+// code should look like.
+
+namespace {
+
+opencensus::tags::TagMap ExampleTagMap() {
+  static const auto k1 = opencensus::tags::TagKey::Register("key1");
+  return opencensus::tags::TagMap({{k1, "v1"}});
+}
+
+opencensus::tags::TagMap OtherTagMap() {
+  static const auto k2 = opencensus::tags::TagKey::Register("key2");
+  return opencensus::tags::TagMap({{k2, "v2"}});
+}
+
+bool CurrentTagsEmpty() {
+  return opencensus::tags::GetCurrentTagMap().tags().empty();
+}
+
+// A minimal eagerly started coroutine type whose frame is destroyed with it.
+class Task {
+ public:
+  struct promise_type {
+    opencensus::context::CoroutineContext context;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    auto initial_suspend() { return context.Initial(std::suspend_never()); }
+    auto final_suspend() noexcept {
+      return context.Final(std::suspend_always());
+    }
+    template <typename Awaitable>
+    auto await_transform(Awaitable&& awaitable) {
+      return context.Await(std::forward<Awaitable>(awaitable));
+    }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+
+  Task(Task&& other) : handle_(std::exchange(other.handle_, nullptr)) {}
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool done() const { return handle_.done(); }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Resumes the coroutine on a new thread, which records whether its own
+// Context is empty once the coroutine suspends again.
+struct ResumeOnNewThread {
+  bool await_ready() { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    *thread = std::thread([handle, this]() {
+      handle.resume();
+      *thread_tags_empty = CurrentTagsEmpty();
+    });
+  }
+  void await_resume() {}
+
+  std::thread* thread;
+  bool* thread_tags_empty;
+};
+
+// Suspends until resumed by hand.
+struct Suspend {
+  bool await_ready() { return false; }
+  void await_suspend(std::coroutine_handle<> handle) { *out = handle; }
+  void await_resume() {}
+
+  std::coroutine_handle<>* out;
+};
+
+TEST(CoroutineContextTest, FollowsCoroutineAcrossThreads) {
+  std::thread thread;
+  bool thread_tags_empty = false;
+  bool resumed_with_tags = false;
+  auto coroutine = [&]() -> Task {
+    co_await ResumeOnNewThread{&thread, &thread_tags_empty};
+    resumed_with_tags =
+        ExampleTagMap() == opencensus::tags::GetCurrentTagMap();
+  };
+  Task task = [&]() {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    return coroutine();
+  }();
+  thread.join();
+  EXPECT_TRUE(task.done());
+  EXPECT_TRUE(resumed_with_tags);
+  EXPECT_TRUE(thread_tags_empty);
+  EXPECT_TRUE(CurrentTagsEmpty());
+}
+
+TEST(CoroutineContextTest, RestoresResumerContext) {
+  std::coroutine_handle<> handle;
+  bool first_has_tags = false;
+  bool second_has_tags = false;
+  auto coroutine = [&]() -> Task {
+    first_has_tags = ExampleTagMap() == opencensus::tags::GetCurrentTagMap();
+    co_await Suspend{&handle};
+    second_has_tags = ExampleTagMap() == opencensus::tags::GetCurrentTagMap();
+  };
+  Task task = [&]() {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    return coroutine();
+  }();
+  EXPECT_TRUE(first_has_tags);
+  EXPECT_TRUE(CurrentTagsEmpty());
+  {
+    // The resumer's Context is set aside while the coroutine runs, and
+    // restored when it finishes.
+    opencensus::tags::WithTagMap wt(OtherTagMap());
+    handle.resume();
+    EXPECT_EQ(OtherTagMap(), opencensus::tags::GetCurrentTagMap());
+  }
+  EXPECT_TRUE(task.done());
+  EXPECT_TRUE(second_has_tags);
+}
+
+TEST(CoroutineContextTest, ReadyAwaiterKeepsContext) {
+  bool has_tags = false;
+  auto coroutine = [&]() -> Task {
+    co_await std::suspend_never();
+    has_tags = ExampleTagMap() == opencensus::tags::GetCurrentTagMap();
+  };
+  Task task = [&]() {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    return coroutine();
+  }();
+  EXPECT_TRUE(task.done());
+  EXPECT_TRUE(has_tags);
+  EXPECT_TRUE(CurrentTagsEmpty());
+}
+
+TEST(CoroutineContextTest, ChangesStayWithCoroutine) {
+  std::coroutine_handle<> handle;
+  bool kept_change = false;
+  auto coroutine = [&]() -> Task {
+    // Held across a suspension that resumes on the same thread.
+    opencensus::tags::WithTagMap wt(OtherTagMap());
+    co_await Suspend{&handle};
+    kept_change = OtherTagMap() == opencensus::tags::GetCurrentTagMap();
+  };
+  Task task = coroutine();
+  EXPECT_TRUE(CurrentTagsEmpty());
+  {
+    opencensus::tags::WithTagMap wt(ExampleTagMap());
+    handle.resume();
+    EXPECT_EQ(ExampleTagMap(), opencensus::tags::GetCurrentTagMap());
+  }
+  EXPECT_TRUE(task.done());
+  EXPECT_TRUE(kept_change);
+  EXPECT_TRUE(CurrentTagsEmpty());
+}
+
+}  // namespace
+
+#endif  // defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
@@ -0,0 +1,62 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_AGENT_AGENT_EXPORTER_H_
+#define OPENCENSUS_EXPORTERS_STATS_AGENT_AGENT_EXPORTER_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+struct AgentOptions {
+  // The Unix domain datagram socket the local agent listens on.
+  std::string socket_path = "/var/run/opencensus/agent.sock";
+
+  // The service.name resource attribute, and any other resource attributes.
+  std::string service_name;
+  std::unordered_map<std::string, std::string> resource_attributes;
+
+  // Views are grouped into records of about this many bytes; a larger view is
+  // sent in a record of its own. It should be below the socket's send buffer
+  // size (net.core.wmem_default on Linux).
+  size_t max_record_bytes = 64 << 10;
+};
+
+// Forwards stats for registered views (see opencensus/stats/stats_exporter.h)
+// to an agent on the same host, which batches and exports them for all of the
+// host's processes.
+//
+// Each record is one datagram: a version byte (1), a type byte (2 for
+// metrics), and a serialized opentelemetry.proto.collector.metrics.v1
+// ExportMetricsServiceRequest of cumulative metrics. Records are dropped,
+// without blocking, if the agent is not running or not keeping up.
+// AgentExporter is thread-safe.
+class AgentExporter {
+ public:
+  // Registers the exporter.
+  static void Register(const AgentOptions& opts);
+
+ private:
+  AgentExporter() = delete;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_AGENT_AGENT_EXPORTER_H_
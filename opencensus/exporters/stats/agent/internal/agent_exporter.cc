@@ -0,0 +1,154 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/agent/agent_exporter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/common/internal/unix_datagram_sender.h"
+#include "opencensus/exporters/stats/otlp/internal/otlp_utils.h"
+#include "opencensus/stats/stats.h"
+#include "opentelemetry/proto/collector/metrics/v1/metrics_service.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+constexpr char kRecordHeader[] = {1, 2};
+// The size of the arena block kept across records.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "agent_stats";
+
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
+}
+
+class Handler : public ::opencensus::stats::StatsExporter::Handler {
+ public:
+  explicit Handler(const AgentOptions& opts);
+
+  void ExportViewData(
+      const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                  opencensus::stats::ViewData>>& data) override
+      LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Starts a new record on arena_.
+  void StartRecord() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Sends the current record, if it holds any metrics.
+  void Send() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const AgentOptions opts_;
+  absl::Mutex mu_;
+  opencensus::common::UnixDatagramSender sender_ GUARDED_BY(mu_);
+  std::unique_ptr<char[]> arena_block_ GUARDED_BY(mu_);
+  google::protobuf::Arena arena_ GUARDED_BY(mu_);
+  otlp::collector::metrics::v1::ExportMetricsServiceRequest* request_
+      GUARDED_BY(mu_) = nullptr;
+  otlp::metrics::v1::ScopeMetrics* scope_metrics_ GUARDED_BY(mu_) = nullptr;
+  size_t record_bytes_ GUARDED_BY(mu_) = 0;
+  // Reused serialization buffer.
+  std::string buffer_ GUARDED_BY(mu_);
+  int64_t dropped_records_ GUARDED_BY(mu_) = 0;
+};
+
+Handler::Handler(const AgentOptions& opts)
+    : opts_(opts),
+      sender_(opts.socket_path),
+      arena_block_(new char[kArenaInitialBlockSize]),
+      arena_(ArenaOptionsWithBlock(arena_block_.get())) {}
+
+void Handler::ExportViewData(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data) {
+  absl::MutexLock l(&mu_);
+  StartRecord();
+  for (const auto& datum : data) {
+    const size_t metric_bytes =
+        AddMetric(datum.first, datum.second, scope_metrics_)->ByteSizeLong();
+    // Leave room for the metric's tag and length.
+    record_bytes_ += metric_bytes + 8;
+    if (record_bytes_ >= opts_.max_record_bytes) {
+      Send();
+      StartRecord();
+    }
+  }
+  Send();
+}
+
+void Handler::StartRecord() {
+  // Keeps the initial block for the next record.
+  arena_.Reset();
+  request_ = google::protobuf::Arena::CreateMessage<
+      otlp::collector::metrics::v1::ExportMetricsServiceRequest>(&arena_);
+  otlp::metrics::v1::ResourceMetrics* resource_metrics =
+      request_->add_resource_metrics();
+  SetResource(opts_.service_name, opts_.resource_attributes,
+              resource_metrics->mutable_resource());
+  scope_metrics_ = resource_metrics->add_scope_metrics();
+  SetScope(scope_metrics_);
+  record_bytes_ = request_->ByteSizeLong();
+}
+
+void Handler::Send() {
+  if (scope_metrics_->metrics_size() == 0) {
+    return;
+  }
+  buffer_.clear();
+  request_->AppendToString(&buffer_);
+  std::string error;
+  if (!sender_.Send(absl::string_view(kRecordHeader, sizeof(kRecordHeader)),
+                    buffer_, &error)) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    // Only report the first of a run of drops, e.g. while the agent is down.
+    if (dropped_records_++ == 0) {
+      std::cerr << "Dropping stats for the agent at " << opts_.socket_path
+                << ": " << error << "\n";
+    }
+  } else {
+    dropped_records_ = 0;
+  }
+}
+
+}  // namespace
+
+// static
+void AgentExporter::Register(const AgentOptions& opts) {
+  opencensus::stats::StatsExporter::RegisterPushHandler(
+      absl::make_unique<Handler>(opts));
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,191 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/otlp/otlp_exporter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/common/internal/grpc/status.h"
+#include "opencensus/common/internal/grpc/with_user_agent.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/stats/otlp/internal/otlp_utils.h"
+#include "opencensus/stats/stats.h"
+#include "opentelemetry/proto/collector/metrics/v1/metrics_service.grpc.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+// The size of the arena block kept across exports.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "otlp_stats";
+
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
+}
+
+// Returns the number of data points in 'metric'.
+int NumDataPoints(const otlp::metrics::v1::Metric& metric) {
+  switch (metric.data_case()) {
+    case otlp::metrics::v1::Metric::kGauge:
+      return metric.gauge().data_points_size();
+    case otlp::metrics::v1::Metric::kSum:
+      return metric.sum().data_points_size();
+    case otlp::metrics::v1::Metric::kHistogram:
+      return metric.histogram().data_points_size();
+    case otlp::metrics::v1::Metric::kExponentialHistogram:
+      return metric.exponential_histogram().data_points_size();
+    case otlp::metrics::v1::Metric::kSummary:
+      return metric.summary().data_points_size();
+    case otlp::metrics::v1::Metric::DATA_NOT_SET:
+      break;
+  }
+  return 0;
+}
+
+class Handler : public ::opencensus::stats::StatsExporter::Handler {
+ public:
+  Handler(const OtlpOptions& opts,
+          const std::shared_ptr<grpc::Channel>& channel);
+
+  void ExportViewData(
+      const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                  opencensus::stats::ViewData>>& data) override
+      LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Starts a new request on arena_.
+  void StartRequest() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Sends the current request, if it holds any metrics.
+  void Send() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const OtlpOptions opts_;
+  const std::unique_ptr<otlp::collector::metrics::v1::MetricsService::Stub>
+      stub_;
+  absl::Mutex mu_;
+  std::unique_ptr<char[]> arena_block_ GUARDED_BY(mu_);
+  google::protobuf::Arena arena_ GUARDED_BY(mu_);
+  otlp::collector::metrics::v1::ExportMetricsServiceRequest* request_
+      GUARDED_BY(mu_) = nullptr;
+  otlp::metrics::v1::ScopeMetrics* scope_metrics_ GUARDED_BY(mu_) = nullptr;
+  int num_data_points_ GUARDED_BY(mu_) = 0;
+};
+
+Handler::Handler(const OtlpOptions& opts,
+                 const std::shared_ptr<grpc::Channel>& channel)
+    : opts_(opts),
+      stub_(otlp::collector::metrics::v1::MetricsService::NewStub(channel)),
+      arena_block_(new char[kArenaInitialBlockSize]),
+      arena_(ArenaOptionsWithBlock(arena_block_.get())) {}
+
+void Handler::ExportViewData(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data) {
+  const int max_data_points = std::max(1, opts_.max_batch_data_points);
+  absl::MutexLock l(&mu_);
+  StartRequest();
+  for (const auto& datum : data) {
+    num_data_points_ +=
+        NumDataPoints(*AddMetric(datum.first, datum.second, scope_metrics_));
+    if (num_data_points_ >= max_data_points) {
+      Send();
+      StartRequest();
+    }
+  }
+  Send();
+}
+
+void Handler::StartRequest() {
+  // Keeps the initial block for the next request.
+  arena_.Reset();
+  request_ = google::protobuf::Arena::CreateMessage<
+      otlp::collector::metrics::v1::ExportMetricsServiceRequest>(&arena_);
+  otlp::metrics::v1::ResourceMetrics* resource_metrics =
+      request_->add_resource_metrics();
+  SetResource(opts_.service_name, opts_.resource_attributes,
+              resource_metrics->mutable_resource());
+  scope_metrics_ = resource_metrics->add_scope_metrics();
+  SetScope(scope_metrics_);
+  num_data_points_ = 0;
+}
+
+void Handler::Send() {
+  if (scope_metrics_->metrics_size() == 0) {
+    return;
+  }
+  grpc::ClientContext context;
+  const absl::Time start_time = absl::Now();
+  context.set_deadline(absl::ToChronoTime(start_time + opts_.rpc_deadline));
+  if (opts_.gzip_compression) {
+    context.set_compression_algorithm(GRPC_COMPRESS_GZIP);
+  }
+  otlp::collector::metrics::v1::ExportMetricsServiceResponse response;
+  OPENCENSUS_PROBE2(export_rpc_begin, kExporterName, &context);
+  const grpc::Status status = stub_->Export(&context, *request_, &response);
+  OPENCENSUS_PROBE3(export_rpc_end, kExporterName, &context,
+                    static_cast<int>(status.error_code()));
+  opencensus::common::RecordSelfMetric(
+      opencensus::common::SelfMetric::kExporterRpcLatency,
+      absl::ToDoubleMilliseconds(absl::Now() - start_time), kExporterName);
+  if (!status.ok()) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    std::cerr << "OTLP metrics export of " << num_data_points_
+              << " data points failed: " << opencensus::common::ToString(status)
+              << "\n";
+  } else if (response.has_partial_success() &&
+             response.partial_success().rejected_data_points() > 0) {
+    std::cerr << "OTLP receiver rejected "
+              << response.partial_success().rejected_data_points()
+              << " data points: " << response.partial_success().error_message()
+              << "\n";
+  }
+}
+
+}  // namespace
+
+// static
+void OtlpExporter::Register(const OtlpOptions& opts) {
+  auto channel = ::grpc::CreateCustomChannel(
+      opts.endpoint,
+      opts.use_tls ? ::grpc::SslCredentials(::grpc::SslCredentialsOptions())
+                   : ::grpc::InsecureChannelCredentials(),
+      ::opencensus::common::WithUserAgent());
+  opencensus::stats::StatsExporter::RegisterPushHandler(
+      absl::make_unique<Handler>(opts, channel));
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
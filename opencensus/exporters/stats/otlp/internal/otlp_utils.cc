@@ -0,0 +1,264 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/otlp/internal/otlp_utils.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/common/version.h"
+#include "opencensus/stats/stats.h"
+#include "opentelemetry/proto/common/v1/common.pb.h"
+#include "opentelemetry/proto/metrics/v1/metrics.pb.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+constexpr char kServiceNameKey[] = "service.name";
+constexpr char kScopeName[] = "opencensus-cpp";
+
+using RepeatedKeyValue =
+    ::google::protobuf::RepeatedPtrField<otlp::common::v1::KeyValue>;
+
+otlp::common::v1::AnyValue* AddAttribute(absl::string_view key,
+                                         RepeatedKeyValue* attributes) {
+  otlp::common::v1::KeyValue* attribute = attributes->Add();
+  attribute->set_key(key.data(), key.size());
+  return attribute->mutable_value();
+}
+
+// Adds a data point for the row with 'tag_values' to 'points', setting its
+// attributes and times.
+template <typename PointT>
+PointT* AddPoint(const opencensus::stats::ViewDescriptor& descriptor,
+                 const opencensus::stats::ViewData& data,
+                 const std::vector<std::string>& tag_values,
+                 ::google::protobuf::RepeatedPtrField<PointT>* points) {
+  PointT* point = points->Add();
+  RepeatedKeyValue* attributes = point->mutable_attributes();
+  attributes->Reserve(descriptor.columns().size());
+  for (int i = 0; i < descriptor.columns().size(); ++i) {
+    AddAttribute(descriptor.columns()[i].name(), attributes)
+        ->set_string_value(tag_values[i]);
+  }
+  point->set_start_time_unix_nano(absl::ToUnixNanos(data.start_time()));
+  point->set_time_unix_nano(absl::ToUnixNanos(data.end_time()));
+  return point;
+}
+
+void SetValue(double value, otlp::metrics::v1::NumberDataPoint* point) {
+  point->set_as_double(value);
+}
+void SetValue(int64_t value, otlp::metrics::v1::NumberDataPoint* point) {
+  point->set_as_int(value);
+}
+
+template <typename DataValueT>
+void AddNumberPoints(
+    const opencensus::stats::ViewDescriptor& descriptor,
+    const opencensus::stats::ViewData& data,
+    const opencensus::stats::ViewData::DataMap<DataValueT>& rows,
+    ::google::protobuf::RepeatedPtrField<otlp::metrics::v1::NumberDataPoint>*
+        points) {
+  points->Reserve(rows.size());
+  for (const auto& row : rows) {
+    SetValue(row.second, AddPoint(descriptor, data, row.first, points));
+  }
+}
+
+void AddNumberPoints(
+    const opencensus::stats::ViewDescriptor& descriptor,
+    const opencensus::stats::ViewData& data,
+    ::google::protobuf::RepeatedPtrField<otlp::metrics::v1::NumberDataPoint>*
+        points) {
+  switch (data.type()) {
+    case opencensus::stats::ViewData::Type::kDouble:
+      AddNumberPoints(descriptor, data, data.double_data(), points);
+      return;
+    case opencensus::stats::ViewData::Type::kInt64:
+      AddNumberPoints(descriptor, data, data.int_data(), points);
+      return;
+    case opencensus::stats::ViewData::Type::kDistribution:
+    case opencensus::stats::ViewData::Type::kExponentialHistogram:
+      break;
+  }
+  ABSL_ASSERT(false && "Bad ViewData type for a number metric.");
+}
+
+void SetHistogramPoint(const opencensus::stats::Distribution& value,
+                       otlp::metrics::v1::HistogramDataPoint* point) {
+  point->set_count(value.count());
+  point->set_sum(value.count() * value.mean());
+  if (value.count() > 0) {
+    point->set_min(value.min());
+    point->set_max(value.max());
+  }
+  // Both use the lower boundaries of all but the first (underflow) bucket.
+  for (const double boundary : value.bucket_boundaries().lower_boundaries()) {
+    point->add_explicit_bounds(boundary);
+  }
+  for (const uint64_t count : value.bucket_counts()) {
+    point->add_bucket_counts(count);
+  }
+}
+
+void SetBuckets(
+    const opencensus::stats::ExponentialHistogram::Buckets& from,
+    otlp::metrics::v1::ExponentialHistogramDataPoint::Buckets* to) {
+  to->set_offset(from.offset);
+  for (const uint64_t count : from.counts) {
+    to->add_bucket_counts(count);
+  }
+}
+
+// OTLP exponential buckets include their upper rather than their lower bound;
+// the difference is ignored, as for Stackdriver.
+void SetExponentialHistogramPoint(
+    const opencensus::stats::ExponentialHistogram& value,
+    otlp::metrics::v1::ExponentialHistogramDataPoint* point) {
+  point->set_count(value.count());
+  point->set_sum(value.sum());
+  if (value.count() > 0) {
+    point->set_min(value.min());
+    point->set_max(value.max());
+  }
+  point->set_scale(value.scale());
+  point->set_zero_count(value.zero_count());
+  SetBuckets(value.positive_buckets(), point->mutable_positive());
+  SetBuckets(value.negative_buckets(), point->mutable_negative());
+}
+
+void SetSummaryPoint(const opencensus::stats::ExponentialHistogram& value,
+                     const std::vector<double>& quantiles,
+                     otlp::metrics::v1::SummaryDataPoint* point) {
+  point->set_count(value.count());
+  point->set_sum(value.sum());
+  if (value.count() == 0) {
+    return;
+  }
+  for (const double q : quantiles) {
+    otlp::metrics::v1::SummaryDataPoint::ValueAtQuantile* quantile =
+        point->add_quantile_values();
+    quantile->set_quantile(q);
+    quantile->set_value(value.Quantile(q));
+  }
+}
+
+}  // namespace
+
+void SetResource(
+    absl::string_view service_name,
+    const std::unordered_map<std::string, std::string>& attributes,
+    otlp::resource::v1::Resource* resource) {
+  RepeatedKeyValue* resource_attributes = resource->mutable_attributes();
+  if (!service_name.empty()) {
+    AddAttribute(kServiceNameKey, resource_attributes)
+        ->set_string_value(service_name.data(), service_name.size());
+  }
+  for (const auto& attr : attributes) {
+    AddAttribute(attr.first, resource_attributes)
+        ->set_string_value(attr.second);
+  }
+}
+
+void SetScope(otlp::metrics::v1::ScopeMetrics* scope_metrics) {
+  scope_metrics->mutable_scope()->set_name(kScopeName);
+  scope_metrics->mutable_scope()->set_version(OPENCENSUS_VERSION);
+}
+
+otlp::metrics::v1::Metric* AddMetric(
+    const opencensus::stats::ViewDescriptor& descriptor,
+    const opencensus::stats::ViewData& data,
+    otlp::metrics::v1::ScopeMetrics* scope_metrics) {
+  otlp::metrics::v1::Metric* metric = scope_metrics->add_metrics();
+  metric->set_name(descriptor.name());
+  metric->set_description(descriptor.description());
+  const opencensus::stats::Aggregation& aggregation = descriptor.aggregation();
+  metric->set_unit(aggregation.type() ==
+                           opencensus::stats::Aggregation::Type::kCount
+                       ? "1"
+                       : descriptor.measure_descriptor().units());
+  switch (aggregation.type()) {
+    case opencensus::stats::Aggregation::Type::kCount:
+    case opencensus::stats::Aggregation::Type::kSum: {
+      otlp::metrics::v1::Sum* sum = metric->mutable_sum();
+      sum->set_aggregation_temporality(
+          otlp::metrics::v1::AGGREGATION_TEMPORALITY_CUMULATIVE);
+      // Sums decrease if negative values are recorded.
+      sum->set_is_monotonic(aggregation.type() ==
+                            opencensus::stats::Aggregation::Type::kCount);
+      AddNumberPoints(descriptor, data, sum->mutable_data_points());
+      break;
+    }
+    case opencensus::stats::Aggregation::Type::kLastValue:
+    case opencensus::stats::Aggregation::Type::kDistinctCount:
+      AddNumberPoints(descriptor, data,
+                      metric->mutable_gauge()->mutable_data_points());
+      break;
+    case opencensus::stats::Aggregation::Type::kDistribution: {
+      otlp::metrics::v1::Histogram* histogram = metric->mutable_histogram();
+      histogram->set_aggregation_temporality(
+          otlp::metrics::v1::AGGREGATION_TEMPORALITY_CUMULATIVE);
+      histogram->mutable_data_points()->Reserve(
+          data.distribution_data().size());
+      for (const auto& row : data.distribution_data()) {
+        SetHistogramPoint(row.second,
+                          AddPoint(descriptor, data, row.first,
+                                   histogram->mutable_data_points()));
+      }
+      break;
+    }
+    case opencensus::stats::Aggregation::Type::kExponentialHistogram: {
+      otlp::metrics::v1::ExponentialHistogram* histogram =
+          metric->mutable_exponential_histogram();
+      histogram->set_aggregation_temporality(
+          otlp::metrics::v1::AGGREGATION_TEMPORALITY_CUMULATIVE);
+      histogram->mutable_data_points()->Reserve(
+          data.exponential_histogram_data().size());
+      for (const auto& row : data.exponential_histogram_data()) {
+        SetExponentialHistogramPoint(
+            row.second, AddPoint(descriptor, data, row.first,
+                                 histogram->mutable_data_points()));
+      }
+      break;
+    }
+    case opencensus::stats::Aggregation::Type::kQuantiles: {
+      otlp::metrics::v1::Summary* summary = metric->mutable_summary();
+      summary->mutable_data_points()->Reserve(
+          data.exponential_histogram_data().size());
+      for (const auto& row : data.exponential_histogram_data()) {
+        SetSummaryPoint(row.second, aggregation.quantiles(),
+                        AddPoint(descriptor, data, row.first,
+                                 summary->mutable_data_points()));
+      }
+      break;
+    }
+  }
+  return metric;
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,53 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_OTLP_INTERNAL_OTLP_UTILS_H_
+#define OPENCENSUS_EXPORTERS_STATS_OTLP_INTERNAL_OTLP_UTILS_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/stats.h"
+#include "opentelemetry/proto/metrics/v1/metrics.pb.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+// Sets the attributes of 'resource' to 'service_name' (as service.name, if not
+// empty) and 'attributes'.
+void SetResource(
+    absl::string_view service_name,
+    const std::unordered_map<std::string, std::string>& attributes,
+    opentelemetry::proto::resource::v1::Resource* resource);
+
+// Sets the instrumentation scope of 'scope_metrics' to this library.
+void SetScope(opentelemetry::proto::metrics::v1::ScopeMetrics* scope_metrics);
+
+// Converts each row of 'data' into a cumulative data point of a metric named
+// after the view, added to 'scope_metrics'. Count and sum views become sums,
+// last value views gauges, distribution views histograms, exponential
+// histogram views exponential histograms, and quantiles views summaries.
+opentelemetry::proto::metrics::v1::Metric* AddMetric(
+    const opencensus::stats::ViewDescriptor& descriptor,
+    const opencensus::stats::ViewData& data,
+    opentelemetry::proto::metrics::v1::ScopeMetrics* scope_metrics);
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_OTLP_INTERNAL_OTLP_UTILS_H_
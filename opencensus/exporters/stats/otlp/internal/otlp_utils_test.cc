@@ -0,0 +1,204 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/otlp/internal/otlp_utils.h"
+
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opentelemetry/proto/metrics/v1/metrics.pb.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+using ::opencensus::stats::testing::TestUtils;
+using ::testing::ElementsAre;
+
+TEST(OtlpUtilsTest, SetResource) {
+  otlp::resource::v1::Resource resource;
+  SetResource("service", {{"host", "localhost"}}, &resource);
+  ASSERT_EQ(2, resource.attributes_size());
+  EXPECT_EQ("service.name", resource.attributes(0).key());
+  EXPECT_EQ("service", resource.attributes(0).value().string_value());
+  EXPECT_EQ("host", resource.attributes(1).key());
+  EXPECT_EQ("localhost", resource.attributes(1).value().string_value());
+}
+
+TEST(OtlpUtilsTest, AddMetricSumDouble) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "otlp_sum_double", "", "ms");
+  const auto tag_key = opencensus::tags::TagKey::Register("foo");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("sum_view")
+          .set_description("description")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum())
+          .add_column(tag_key);
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{"v1"}, 1.5}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  EXPECT_EQ("sum_view", metric.name());
+  EXPECT_EQ("description", metric.description());
+  EXPECT_EQ("ms", metric.unit());
+  ASSERT_TRUE(metric.has_sum());
+  EXPECT_EQ(otlp::metrics::v1::AGGREGATION_TEMPORALITY_CUMULATIVE,
+            metric.sum().aggregation_temporality());
+  EXPECT_FALSE(metric.sum().is_monotonic());
+  ASSERT_EQ(1, metric.sum().data_points_size());
+  const auto& point = metric.sum().data_points(0);
+  EXPECT_EQ(1.5, point.as_double());
+  ASSERT_EQ(1, point.attributes_size());
+  EXPECT_EQ("foo", point.attributes(0).key());
+  EXPECT_EQ("v1", point.attributes(0).value().string_value());
+  EXPECT_EQ(absl::ToUnixNanos(data.start_time()),
+            point.start_time_unix_nano());
+  EXPECT_EQ(absl::ToUnixNanos(data.end_time()), point.time_unix_nano());
+}
+
+TEST(OtlpUtilsTest, AddMetricCount) {
+  const auto measure =
+      opencensus::stats::MeasureDouble::Register("otlp_count", "", "ms");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("count_view")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count());
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{}, 1.5}, {{}, 2.5}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  EXPECT_EQ("1", metric.unit());
+  ASSERT_TRUE(metric.has_sum());
+  EXPECT_TRUE(metric.sum().is_monotonic());
+  ASSERT_EQ(1, metric.sum().data_points_size());
+  EXPECT_EQ(2, metric.sum().data_points(0).as_int());
+}
+
+TEST(OtlpUtilsTest, AddMetricLastValueInt) {
+  const auto measure =
+      opencensus::stats::MeasureInt64::Register("otlp_last_value", "", "By");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("last_value_view")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::LastValue());
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{}, 3}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  ASSERT_TRUE(metric.has_gauge());
+  ASSERT_EQ(1, metric.gauge().data_points_size());
+  EXPECT_EQ(3, metric.gauge().data_points(0).as_int());
+}
+
+TEST(OtlpUtilsTest, AddMetricDistribution) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "otlp_distribution", "", "ms");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("distribution_view")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({0, 10})));
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{}, -1}, {{}, 5}, {{}, 7}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  ASSERT_TRUE(metric.has_histogram());
+  ASSERT_EQ(1, metric.histogram().data_points_size());
+  const auto& point = metric.histogram().data_points(0);
+  EXPECT_EQ(3, point.count());
+  EXPECT_DOUBLE_EQ(11, point.sum());
+  EXPECT_EQ(-1, point.min());
+  EXPECT_EQ(7, point.max());
+  EXPECT_THAT(point.explicit_bounds(), ElementsAre(0, 10));
+  EXPECT_THAT(point.bucket_counts(), ElementsAre(1, 2, 0));
+}
+
+TEST(OtlpUtilsTest, AddMetricExponentialHistogram) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "otlp_exponential_histogram", "", "ms");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("exponential_histogram_view")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(
+              opencensus::stats::Aggregation::ExponentialHistogram());
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{}, -2}, {{}, 0}, {{}, 4}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  ASSERT_TRUE(metric.has_exponential_histogram());
+  ASSERT_EQ(1, metric.exponential_histogram().data_points_size());
+  const auto& point = metric.exponential_histogram().data_points(0);
+  const auto& histogram = data.exponential_histogram_data().begin()->second;
+  EXPECT_EQ(3, point.count());
+  EXPECT_EQ(2, point.sum());
+  EXPECT_EQ(histogram.scale(), point.scale());
+  EXPECT_EQ(1, point.zero_count());
+  EXPECT_EQ(histogram.positive_buckets().offset, point.positive().offset());
+  EXPECT_THAT(point.positive().bucket_counts(), ElementsAre(1));
+  EXPECT_EQ(histogram.negative_buckets().offset, point.negative().offset());
+  EXPECT_THAT(point.negative().bucket_counts(), ElementsAre(1));
+}
+
+TEST(OtlpUtilsTest, AddMetricQuantiles) {
+  const auto measure =
+      opencensus::stats::MeasureDouble::Register("otlp_quantiles", "", "ms");
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("quantiles_view")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(
+              opencensus::stats::Aggregation::Quantiles({0, 1}));
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(descriptor, {{{}, 1}, {{}, 3}});
+  otlp::metrics::v1::ScopeMetrics scope_metrics;
+  const otlp::metrics::v1::Metric& metric =
+      *AddMetric(descriptor, data, &scope_metrics);
+
+  ASSERT_TRUE(metric.has_summary());
+  ASSERT_EQ(1, metric.summary().data_points_size());
+  const auto& point = metric.summary().data_points(0);
+  EXPECT_EQ(2, point.count());
+  EXPECT_EQ(4, point.sum());
+  ASSERT_EQ(2, point.quantile_values_size());
+  EXPECT_EQ(0, point.quantile_values(0).quantile());
+  EXPECT_EQ(1, point.quantile_values(0).value());
+  EXPECT_EQ(1, point.quantile_values(1).quantile());
+  EXPECT_EQ(3, point.quantile_values(1).value());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,67 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_OTLP_OTLP_EXPORTER_H_
+#define OPENCENSUS_EXPORTERS_STATS_OTLP_OTLP_EXPORTER_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+struct OtlpOptions {
+  // The address of the OTLP/gRPC receiver, e.g. an OpenTelemetry Collector.
+  std::string endpoint = "localhost:4317";
+
+  // If true, the channel uses TLS with the default roots; otherwise it is
+  // insecure, as is usual for a collector on the local host.
+  bool use_tls = false;
+
+  // The service.name resource attribute, and any other resource attributes.
+  std::string service_name;
+  std::unordered_map<std::string, std::string> resource_attributes;
+
+  // The RPC deadline to use when exporting.
+  absl::Duration rpc_deadline = absl::Seconds(5);
+
+  // If true, requests are gzip-compressed.
+  bool gzip_compression = true;
+
+  // Each export is split into requests of whole views holding about
+  // max_batch_data_points data points (rows) each. Exports happen at the
+  // interval set with StatsExporter::SetInterval().
+  int max_batch_data_points = 1000;
+};
+
+// Exports stats for registered views (see opencensus/stats/stats_exporter.h) to
+// an OpenTelemetry Protocol (OTLP) receiver over gRPC, as cumulative metrics.
+// OtlpExporter is thread-safe.
+class OtlpExporter {
+ public:
+  // Registers the exporter.
+  static void Register(const OtlpOptions& opts);
+
+ private:
+  OtlpExporter() = delete;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_OTLP_OTLP_EXPORTER_H_
@@ -0,0 +1,127 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_utils.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "prometheus/metric_family.h"
+
+// Measures converting view data to prometheus-cpp MetricFamilies and to the
+// text exposition format, without serving it. Each benchmark takes the number
+// of rows and tag keys of the view, and whether it is a distribution (with 20
+// buckets) or a sum.
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+using ::opencensus::stats::testing::TestUtils;
+
+opencensus::stats::MeasureDouble BenchmarkMeasure() {
+  static const opencensus::stats::MeasureDouble measure =
+      opencensus::stats::MeasureDouble::Register("prometheus_benchmark", "",
+                                                 "ms");
+  return measure;
+}
+
+// Records into a view with the given shape and returns its data.
+std::pair<opencensus::stats::ViewDescriptor, opencensus::stats::ViewData>
+MakeViewData(int num_rows, int num_keys, bool distribution) {
+  auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name(absl::StrCat("prometheus_benchmark/", num_rows, "/",
+                                 num_keys, "/", distribution))
+          .set_measure(BenchmarkMeasure().GetDescriptor().name())
+          .set_aggregation(
+              distribution
+                  ? opencensus::stats::Aggregation::Distribution(
+                        opencensus::stats::BucketBoundaries::Exponential(
+                            20, 1, 2))
+                  : opencensus::stats::Aggregation::Sum())
+          .set_description("A view for benchmarking.");
+  std::vector<opencensus::tags::TagKey> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(
+        opencensus::tags::TagKey::Register(absl::StrCat("key", i)));
+    descriptor.add_column(keys.back());
+  }
+  opencensus::stats::View view(descriptor);
+  std::vector<std::pair<opencensus::tags::TagMap,
+                        std::vector<opencensus::stats::Measurement>>>
+      batch;
+  for (int row = 0; row < num_rows; ++row) {
+    std::vector<std::pair<opencensus::tags::TagKey, std::string>> tags;
+    for (const auto& key : keys) {
+      tags.emplace_back(key, absl::StrCat("value", row));
+    }
+    batch.emplace_back(
+        opencensus::tags::TagMap(std::move(tags)),
+        std::vector<opencensus::stats::Measurement>(
+            {{BenchmarkMeasure(), static_cast<double>(row % 1000)}}));
+  }
+  opencensus::stats::RecordBatch(batch);
+  TestUtils::Flush();
+  return {descriptor, view.GetData()};
+}
+
+void BM_SetMetricFamily(benchmark::State& state) {
+  const auto data =
+      MakeViewData(state.range(0), state.range(1), state.range(2) != 0);
+  PrometheusNameCache names;
+  for (auto _ : state) {
+    prometheus::MetricFamily metric_family;
+    SetMetricFamily(names.Get(data.first), data.second, &metric_family);
+    benchmark::DoNotOptimize(metric_family.metric.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetMetricFamily)
+    ->ArgNames({"rows", "keys", "distribution"})
+    ->ArgsProduct({{1, 100, 10000}, {1, 4}, {0, 1}});
+
+void BM_TextWriter(benchmark::State& state) {
+  const std::vector<
+      std::pair<opencensus::stats::ViewDescriptor, opencensus::stats::ViewData>>
+      data = {
+          MakeViewData(state.range(0), state.range(1), state.range(2) != 0)};
+  PrometheusTextWriter writer;
+  std::string output;
+  for (auto _ : state) {
+    writer.Write(data, &output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * output.size());
+}
+BENCHMARK(BM_TextWriter)
+    ->ArgNames({"rows", "keys", "distribution"})
+    ->ArgsProduct({{1, 100, 10000}, {1, 4}, {0, 1}});
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
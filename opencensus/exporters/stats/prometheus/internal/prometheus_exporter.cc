@@ -14,9 +14,17 @@
 
 #include "opencensus/exporters/stats/prometheus/prometheus_exporter.h"
 
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_proto.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
 #include "opencensus/exporters/stats/prometheus/internal/prometheus_utils.h"
 #include "opencensus/stats/stats.h"
 #include "prometheus/metric_family.h"
@@ -25,13 +33,103 @@ namespace opencensus {
 namespace exporters {
 namespace stats {
 
+PrometheusExporter::PrometheusExporter()
+    : PrometheusExporter(absl::ZeroDuration()) {}
+
+PrometheusExporter::PrometheusExporter(absl::Duration min_rebuild_interval)
+    : min_rebuild_interval_(min_rebuild_interval),
+      names_(absl::make_unique<PrometheusNameCache>()),
+      text_writer_(absl::make_unique<PrometheusTextWriter>()),
+      open_metrics_writer_(absl::make_unique<PrometheusTextWriter>(
+          PrometheusTextFormat::kOpenMetrics)),
+      proto_writer_(absl::make_unique<PrometheusProtoWriter>()) {}
+
+PrometheusExporter::~PrometheusExporter() = default;
+
+bool PrometheusExporter::IsFresh(absl::Time built) const {
+  return min_rebuild_interval_ > absl::ZeroDuration() &&
+         absl::Now() - built < min_rebuild_interval_;
+}
+
 std::vector<prometheus::MetricFamily> PrometheusExporter::Collect() {
-  const auto data = opencensus::stats::StatsExporter::GetViewData();
-  std::vector<prometheus::MetricFamily> output(data.size());
-  for (int i = 0; i < data.size(); ++i) {
-    SetMetricFamily(data[i].first, data[i].second, &output[i]);
+  if (min_rebuild_interval_ <= absl::ZeroDuration()) {
+    const auto data = opencensus::stats::StatsExporter::GetViewData();
+    std::vector<prometheus::MetricFamily> output(data.size());
+    absl::MutexLock l(&mu_);
+    for (int i = 0; i < data.size(); ++i) {
+      SetMetricFamily(names_->Get(data[i].first), data[i].second, &output[i]);
+    }
+    names_->EvictUnused();
+    return output;
+  }
+  absl::MutexLock l(&mu_);
+  if (!IsFresh(families_built_)) {
+    const auto data = opencensus::stats::StatsExporter::GetViewData();
+    families_.clear();
+    families_.resize(data.size());
+    for (int i = 0; i < data.size(); ++i) {
+      SetMetricFamily(names_->Get(data[i].first), data[i].second,
+                      &families_[i]);
+    }
+    names_->EvictUnused();
+    families_built_ = absl::Now();
+  }
+  return families_;
+}
+
+void PrometheusExporter::CollectText(std::string* output) {
+  CollectExposition(PrometheusExposition::kText, output);
+}
+
+void PrometheusExporter::CollectOpenMetricsText(std::string* output) {
+  CollectExposition(PrometheusExposition::kOpenMetrics, output);
+}
+
+void PrometheusExporter::CollectProtobuf(std::string* output) {
+  CollectExposition(PrometheusExposition::kProtobuf, output);
+}
+
+absl::string_view PrometheusExporter::CollectForAccept(
+    absl::string_view accept, std::string* output) {
+  const PrometheusExposition exposition = NegotiateExposition(accept);
+  CollectExposition(exposition, output);
+  return ExpositionContentType(exposition);
+}
+
+void PrometheusExporter::CollectExposition(PrometheusExposition exposition,
+                                           std::string* output) {
+  if (min_rebuild_interval_ <= absl::ZeroDuration()) {
+    const auto data = opencensus::stats::StatsExporter::GetViewData();
+    absl::MutexLock l(&mu_);
+    WriteExposition(exposition, data, output);
+    return;
+  }
+  absl::MutexLock l(&mu_);
+  CachedExposition& cached = expositions_[static_cast<int>(exposition)];
+  if (!IsFresh(cached.built)) {
+    WriteExposition(exposition, opencensus::stats::StatsExporter::GetViewData(),
+                    &cached.output);
+    cached.built = absl::Now();
+  }
+  *output = cached.output;
+}
+
+void PrometheusExporter::WriteExposition(
+    PrometheusExposition exposition,
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data,
+    std::string* output) {
+  switch (exposition) {
+    case PrometheusExposition::kText:
+      text_writer_->Write(data, output);
+      return;
+    case PrometheusExposition::kOpenMetrics:
+      open_metrics_writer_->Write(data, output);
+      return;
+    case PrometheusExposition::kProtobuf:
+      proto_writer_->Write(data, output);
+      return;
   }
-  return output;
 }
 
 }  // namespace stats
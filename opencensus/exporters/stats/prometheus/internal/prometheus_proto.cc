@@ -0,0 +1,456 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_proto.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/trace/span_context.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+// Field numbers from io.prometheus.client's metrics.proto.
+namespace field {
+constexpr int kFamilyName = 1;
+constexpr int kFamilyHelp = 2;
+constexpr int kFamilyType = 3;
+constexpr int kFamilyMetric = 4;
+constexpr int kMetricLabel = 1;
+constexpr int kMetricGauge = 2;
+constexpr int kMetricCounter = 3;
+constexpr int kMetricSummary = 4;
+constexpr int kMetricUntyped = 5;
+constexpr int kMetricTimestampMs = 6;
+constexpr int kMetricHistogram = 7;
+constexpr int kLabelName = 1;
+constexpr int kLabelValue = 2;
+// Gauge, Counter and Untyped all hold their value in field 1.
+constexpr int kScalarValue = 1;
+constexpr int kSampleCount = 1;
+constexpr int kSampleSum = 2;
+constexpr int kSummaryQuantile = 3;
+constexpr int kQuantileQuantile = 1;
+constexpr int kQuantileValue = 2;
+constexpr int kHistogramBucket = 3;
+constexpr int kBucketCumulativeCount = 1;
+constexpr int kBucketUpperBound = 2;
+constexpr int kBucketExemplar = 3;
+constexpr int kExemplarLabel = 1;
+constexpr int kExemplarValue = 2;
+constexpr int kExemplarTimestamp = 3;
+constexpr int kTimestampSeconds = 1;
+constexpr int kTimestampNanos = 2;
+}  // namespace field
+
+// MetricType values.
+enum MetricType {
+  kCounter = 0,
+  kGauge = 1,
+  kSummary = 2,
+  kUntyped = 3,
+  kHistogram = 4,
+};
+
+MetricType TypeOf(const opencensus::stats::Aggregation& aggregation) {
+  switch (aggregation.type()) {
+    case opencensus::stats::Aggregation::Type::kCount:
+      return kCounter;
+    case opencensus::stats::Aggregation::Type::kSum:
+      return kUntyped;
+    case opencensus::stats::Aggregation::Type::kLastValue:
+    case opencensus::stats::Aggregation::Type::kDistinctCount:
+      return kGauge;
+    case opencensus::stats::Aggregation::Type::kDistribution:
+    case opencensus::stats::Aggregation::Type::kExponentialHistogram:
+      return kHistogram;
+    case opencensus::stats::Aggregation::Type::kQuantiles:
+      return kSummary;
+  }
+  ABSL_ASSERT(false && "Bad Aggregation type.");
+  return kUntyped;
+}
+
+enum WireType {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+};
+
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+// ProtoEncoder appends protobuf wire format to an output string. Nested
+// messages are encoded into the writer's per-depth scratch strings and
+// appended to their parent, length-prefixed, when they end.
+class ProtoEncoder {
+ public:
+  ProtoEncoder(std::vector<std::string>* messages, std::string* output)
+      : messages_(messages), output_(output) {}
+
+  void Varint(int field, uint64_t value) {
+    Tag(field, kVarint);
+    AppendVarint(value, current());
+  }
+
+  void Double(int field, double value) {
+    Tag(field, kFixed64);
+    uint64_t bits;
+    static_assert(sizeof(bits) == sizeof(value), "double is not 64 bits");
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) {
+      current()->push_back(static_cast<char>(bits >> (8 * i)));
+    }
+  }
+
+  void Bytes(int field, absl::string_view value) {
+    Tag(field, kLengthDelimited);
+    AppendVarint(value.size(), current());
+    current()->append(value.data(), value.size());
+  }
+
+  // Appends already-encoded fields.
+  void Raw(absl::string_view encoded) {
+    current()->append(encoded.data(), encoded.size());
+  }
+
+  void BeginMessage() {
+    ++depth_;
+    if (messages_->size() < depth_) messages_->resize(depth_);
+    current()->clear();
+  }
+
+  // Ends the current message, appending it to its parent as 'field'.
+  void EndMessage(int field) {
+    const std::string& message = *current();
+    --depth_;
+    Bytes(field, message);
+  }
+
+  // Ends the current top-level message, appending it to the output prefixed
+  // with its length, as the delimited exposition format requires.
+  void EndDelimited() {
+    const std::string& message = *current();
+    --depth_;
+    AppendVarint(message.size(), output_);
+    output_->append(message);
+  }
+
+ private:
+  std::string* current() {
+    return depth_ == 0 ? output_ : &(*messages_)[depth_ - 1];
+  }
+
+  void Tag(int field, WireType type) {
+    AppendVarint((static_cast<uint64_t>(field) << 3) | type, current());
+  }
+
+  std::vector<std::string>* const messages_;
+  std::string* const output_;
+  size_t depth_ = 0;
+};
+
+// Returns a LabelPair encoded as a complete field 'field'.
+std::string EncodeLabel(int field, absl::string_view name,
+                        absl::string_view value) {
+  std::vector<std::string> messages;
+  std::string label;
+  ProtoEncoder encoder(&messages, &label);
+  encoder.BeginMessage();
+  encoder.Bytes(field::kLabelName, name);
+  encoder.Bytes(field::kLabelValue, value);
+  encoder.EndMessage(field);
+  return label;
+}
+
+void Bucket(double upper_bound, uint64_t cumulative_count,
+            const opencensus::stats::Exemplar* exemplar,
+            ProtoEncoder* encoder) {
+  encoder->BeginMessage();
+  encoder->Varint(field::kBucketCumulativeCount, cumulative_count);
+  encoder->Double(field::kBucketUpperBound, upper_bound);
+  if (exemplar != nullptr && exemplar->span_context.IsValid()) {
+    encoder->BeginMessage();
+    encoder->Raw(EncodeLabel(field::kExemplarLabel, "trace_id",
+                             exemplar->span_context.trace_id().ToHex()));
+    encoder->Raw(EncodeLabel(field::kExemplarLabel, "span_id",
+                             exemplar->span_context.span_id().ToHex()));
+    encoder->Double(field::kExemplarValue, exemplar->value);
+    const int64_t nanos = absl::ToUnixNanos(exemplar->timestamp);
+    encoder->BeginMessage();
+    encoder->Varint(field::kTimestampSeconds, nanos / 1000000000);
+    encoder->Varint(field::kTimestampNanos, nanos % 1000000000);
+    encoder->EndMessage(field::kExemplarTimestamp);
+    encoder->EndMessage(field::kBucketExemplar);
+  }
+  encoder->EndMessage(field::kHistogramBucket);
+}
+
+int ScalarField(const opencensus::stats::Aggregation& aggregation) {
+  switch (TypeOf(aggregation)) {
+    case kCounter:
+      return field::kMetricCounter;
+    case kGauge:
+      return field::kMetricGauge;
+    default:
+      return field::kMetricUntyped;
+  }
+}
+
+void WriteValue(double value, const opencensus::stats::Aggregation& aggregation,
+                ProtoEncoder* encoder) {
+  encoder->BeginMessage();
+  encoder->Double(field::kScalarValue, value);
+  encoder->EndMessage(ScalarField(aggregation));
+}
+
+void WriteValue(int64_t value,
+                const opencensus::stats::Aggregation& aggregation,
+                ProtoEncoder* encoder) {
+  WriteValue(static_cast<double>(value), aggregation, encoder);
+}
+
+void WriteValue(const opencensus::stats::Distribution& value,
+                const opencensus::stats::Aggregation& aggregation
+                    ABSL_ATTRIBUTE_UNUSED,
+                ProtoEncoder* encoder) {
+  encoder->BeginMessage();
+  encoder->Varint(field::kSampleCount, value.count());
+  encoder->Double(field::kSampleSum, value.count() * value.mean());
+  // We use lower boundaries plus an underflow bucket; Prometheus uses upper
+  // boundaries, including a +Inf boundary.
+  const auto& lower_boundaries = value.bucket_boundaries().lower_boundaries();
+  const auto& exemplars = value.exemplars();
+  uint64_t cumulative_count = 0;
+  for (int i = 0; i < value.bucket_boundaries().num_buckets(); ++i) {
+    cumulative_count += value.bucket_counts()[i];
+    Bucket(i < lower_boundaries.size()
+               ? lower_boundaries[i]
+               : std::numeric_limits<double>::infinity(),
+           cumulative_count, exemplars.empty() ? nullptr : &exemplars[i],
+           encoder);
+  }
+  encoder->EndMessage(field::kMetricHistogram);
+}
+
+void WriteValue(const opencensus::stats::ExponentialHistogram& value,
+                const opencensus::stats::Aggregation& aggregation,
+                ProtoEncoder* encoder) {
+  encoder->BeginMessage();
+  encoder->Varint(field::kSampleCount, value.count());
+  encoder->Double(field::kSampleSum, value.sum());
+  if (aggregation.type() ==
+      opencensus::stats::Aggregation::Type::kQuantiles) {
+    for (const double q : aggregation.quantiles()) {
+      encoder->BeginMessage();
+      encoder->Double(field::kQuantileQuantile, q);
+      encoder->Double(field::kQuantileValue, value.Quantile(q));
+      encoder->EndMessage(field::kSummaryQuantile);
+    }
+    encoder->EndMessage(field::kMetricSummary);
+    return;
+  }
+  // As in the text format, negative buckets are emitted from the most
+  // negative, followed by zero and the positive buckets, and +Inf.
+  const auto& negative = value.negative_buckets();
+  const auto& positive = value.positive_buckets();
+  uint64_t cumulative_count = 0;
+  for (int k = negative.counts.size() - 1; k >= 0; --k) {
+    cumulative_count += negative.counts[k];
+    Bucket(-value.LowerBound(negative.offset + k), cumulative_count, nullptr,
+           encoder);
+  }
+  cumulative_count += value.zero_count();
+  Bucket(0, cumulative_count, nullptr, encoder);
+  for (int k = 0; k < positive.counts.size(); ++k) {
+    cumulative_count += positive.counts[k];
+    Bucket(value.LowerBound(positive.offset + k + 1), cumulative_count,
+           nullptr, encoder);
+  }
+  Bucket(std::numeric_limits<double>::infinity(), cumulative_count, nullptr,
+         encoder);
+  encoder->EndMessage(field::kMetricHistogram);
+}
+
+// ColumnarViewData holds scalar values directly and others by pointer.
+template <typename T>
+const T& RowValue(const T& value) {
+  return value;
+}
+template <typename T>
+const T& RowValue(const T* value) {
+  return *value;
+}
+
+template <typename T>
+void WriteMetrics(const opencensus::stats::ColumnarViewData& data,
+                  const std::vector<T>& values,
+                  const opencensus::stats::Aggregation& aggregation,
+                  const std::vector<std::string>& label_names,
+                  int64_t timestamp_ms, ProtoEncoder* encoder) {
+  // Encode each distinct tag value once, rather than once per metric.
+  std::vector<std::vector<std::string>> encoded(data.num_columns());
+  for (size_t column = 0; column < data.num_columns(); ++column) {
+    const auto& dictionary = data.dictionary(column);
+    encoded[column].reserve(dictionary.size());
+    for (const absl::string_view value : dictionary) {
+      encoded[column].push_back(
+          EncodeLabel(field::kMetricLabel, label_names[column], value));
+    }
+  }
+  for (size_t row = 0; row < data.num_rows(); ++row) {
+    encoder->BeginMessage();
+    for (size_t column = 0; column < data.num_columns(); ++column) {
+      encoder->Raw(encoded[column][data.codes(column)[row]]);
+    }
+    WriteValue(RowValue(values[row]), aggregation, encoder);
+    encoder->Varint(field::kMetricTimestampMs,
+                    static_cast<uint64_t>(timestamp_ms));
+    encoder->EndMessage(field::kFamilyMetric);
+  }
+}
+
+void WriteFamily(const PrometheusViewNames& names,
+                 const opencensus::stats::ViewData& view_data,
+                 ProtoEncoder* encoder) {
+  const opencensus::stats::ColumnarViewData data(view_data);
+  const auto& aggregation = names.descriptor.aggregation();
+  const int64_t timestamp_ms = absl::ToUnixMillis(view_data.end_time());
+  encoder->BeginMessage();
+  encoder->Bytes(field::kFamilyName, names.name);
+  encoder->Bytes(field::kFamilyHelp, names.descriptor.description());
+  encoder->Varint(field::kFamilyType, TypeOf(aggregation));
+  switch (data.type()) {
+    case opencensus::stats::ViewData::Type::kDouble:
+      WriteMetrics(data, data.double_values(), aggregation, names.label_names,
+                   timestamp_ms, encoder);
+      break;
+    case opencensus::stats::ViewData::Type::kInt64:
+      WriteMetrics(data, data.int_values(), aggregation, names.label_names,
+                   timestamp_ms, encoder);
+      break;
+    case opencensus::stats::ViewData::Type::kDistribution:
+      WriteMetrics(data, data.distribution_values(), aggregation,
+                   names.label_names, timestamp_ms, encoder);
+      break;
+    case opencensus::stats::ViewData::Type::kExponentialHistogram:
+      WriteMetrics(data, data.exponential_histogram_values(), aggregation,
+                   names.label_names, timestamp_ms, encoder);
+      break;
+  }
+  encoder->EndDelimited();
+}
+
+// Returns 'value' without surrounding whitespace and double quotes.
+absl::string_view ParameterValue(absl::string_view value) {
+  value = absl::StripAsciiWhitespace(value);
+  if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+    value = value.substr(1, value.size() - 2);
+  }
+  return value;
+}
+
+}  // namespace
+
+PrometheusExposition NegotiateExposition(absl::string_view accept) {
+  PrometheusExposition best = PrometheusExposition::kText;
+  double best_quality = 0;
+  for (const absl::string_view range : absl::StrSplit(accept, ',')) {
+    const std::vector<absl::string_view> parts = absl::StrSplit(range, ';');
+    const absl::string_view type = absl::StripAsciiWhitespace(parts[0]);
+    double quality = 1;
+    bool metric_family_proto = false;
+    bool delimited = false;
+    for (size_t i = 1; i < parts.size(); ++i) {
+      const std::pair<absl::string_view, absl::string_view> parameter =
+          absl::StrSplit(parts[i], absl::MaxSplits('=', 1));
+      const absl::string_view key = absl::StripAsciiWhitespace(parameter.first);
+      const absl::string_view value = ParameterValue(parameter.second);
+      if (absl::EqualsIgnoreCase(key, "q")) {
+        if (!absl::SimpleAtod(value, &quality)) quality = 0;
+      } else if (absl::EqualsIgnoreCase(key, "proto")) {
+        metric_family_proto = value == "io.prometheus.client.MetricFamily";
+      } else if (absl::EqualsIgnoreCase(key, "encoding")) {
+        delimited = absl::EqualsIgnoreCase(value, "delimited");
+      }
+    }
+    PrometheusExposition exposition;
+    if (absl::EqualsIgnoreCase(type, "application/vnd.google.protobuf")) {
+      if (!metric_family_proto || !delimited) continue;
+      exposition = PrometheusExposition::kProtobuf;
+    } else if (absl::EqualsIgnoreCase(type, "application/openmetrics-text")) {
+      exposition = PrometheusExposition::kOpenMetrics;
+    } else {
+      continue;
+    }
+    // Expositions are declared in increasing order of preference.
+    if (quality > best_quality ||
+        (quality == best_quality && quality > 0 && exposition > best)) {
+      best = exposition;
+      best_quality = quality;
+    }
+  }
+  return best;
+}
+
+absl::string_view ExpositionContentType(PrometheusExposition exposition) {
+  switch (exposition) {
+    case PrometheusExposition::kText:
+      return "text/plain; version=0.0.4; charset=utf-8";
+    case PrometheusExposition::kOpenMetrics:
+      return "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    case PrometheusExposition::kProtobuf:
+      return "application/vnd.google.protobuf; "
+             "proto=io.prometheus.client.MetricFamily; encoding=delimited";
+  }
+  ABSL_ASSERT(false && "Bad PrometheusExposition.");
+  return "";
+}
+
+void PrometheusProtoWriter::Write(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data,
+    std::string* output) {
+  output->clear();
+  ProtoEncoder encoder(&messages_, output);
+  for (const auto& view : data) {
+    WriteFamily(names_.Get(view.first), view.second, &encoder);
+  }
+  names_.EvictUnused();
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
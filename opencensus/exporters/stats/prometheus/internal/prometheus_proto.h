@@ -0,0 +1,71 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_PROTO_H_
+#define OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_PROTO_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
+#include "opencensus/stats/stats.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+// The exposition formats a scrape can be answered in.
+enum class PrometheusExposition {
+  kText,
+  kOpenMetrics,
+  // Length-delimited io.prometheus.client.MetricFamily messages.
+  kProtobuf,
+};
+
+// Returns the exposition preferred by an HTTP Accept header, falling back to
+// kText if it accepts none of the others. Ties in quality are broken in favor
+// of kProtobuf, then kOpenMetrics, as the Prometheus server itself does.
+PrometheusExposition NegotiateExposition(absl::string_view accept);
+
+// Returns the Content-Type header of responses in 'exposition'.
+absl::string_view ExpositionContentType(PrometheusExposition exposition);
+
+// PrometheusProtoWriter writes view data directly in the protobuf exposition
+// format, encoding the wire format itself rather than building
+// io.prometheus.client messages, so that it needs no protobuf dependency.
+// Histogram buckets carry their exemplars.
+//
+// PrometheusProtoWriter is thread-compatible.
+class PrometheusProtoWriter final {
+ public:
+  // Replaces the contents of *output (reusing its capacity) with the
+  // exposition of 'data'.
+  void Write(const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                         opencensus::stats::ViewData>>& data,
+             std::string* output);
+
+ private:
+  PrometheusNameCache names_;
+  // The message being encoded at each nesting depth below the output, since
+  // each must be length-prefixed when complete. Reused across calls.
+  std::vector<std::string> messages_;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_PROTO_H_
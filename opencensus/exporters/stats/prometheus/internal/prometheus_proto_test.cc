@@ -0,0 +1,250 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_proto.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opencensus/trace/trace_options.h"
+
+using opencensus::stats::testing::TestUtils;
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+uint64_t ReadVarint(absl::string_view* input) {
+  uint64_t value = 0;
+  for (int shift = 0; !input->empty(); shift += 7) {
+    const uint8_t byte = (*input)[0];
+    input->remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) break;
+  }
+  return value;
+}
+
+// A decoded message: the values of each field, as the raw bytes of
+// length-delimited fields, the value of varints, and the bits of fixed64s.
+struct Message {
+  std::multimap<int, std::string> bytes;
+  std::multimap<int, uint64_t> numbers;
+
+  std::string Bytes(int field) const {
+    auto it = bytes.find(field);
+    return it == bytes.end() ? "" : it->second;
+  }
+  uint64_t Varint(int field) const {
+    auto it = numbers.find(field);
+    return it == numbers.end() ? 0 : it->second;
+  }
+  double Double(int field) const {
+    const uint64_t bits = Varint(field);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  std::vector<Message> Messages(int field) const;
+};
+
+Message Parse(absl::string_view input) {
+  Message message;
+  while (!input.empty()) {
+    const uint64_t tag = ReadVarint(&input);
+    const int field = tag >> 3;
+    switch (tag & 7) {
+      case 0:
+        message.numbers.emplace(field, ReadVarint(&input));
+        break;
+      case 1: {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+          bits |= static_cast<uint64_t>(static_cast<uint8_t>(input[i]))
+                  << (8 * i);
+        }
+        input.remove_prefix(8);
+        message.numbers.emplace(field, bits);
+        break;
+      }
+      case 2: {
+        const uint64_t size = ReadVarint(&input);
+        message.bytes.emplace(field, std::string(input.substr(0, size)));
+        input.remove_prefix(size);
+        break;
+      }
+      default:
+        ADD_FAILURE() << "Unexpected wire type " << (tag & 7);
+        return message;
+    }
+  }
+  return message;
+}
+
+std::vector<Message> Message::Messages(int field) const {
+  std::vector<Message> messages;
+  auto range = bytes.equal_range(field);
+  for (auto it = range.first; it != range.second; ++it) {
+    messages.push_back(Parse(it->second));
+  }
+  return messages;
+}
+
+// Splits the delimited exposition into MetricFamily messages.
+std::vector<Message> ParseDelimited(absl::string_view input) {
+  std::vector<Message> families;
+  while (!input.empty()) {
+    const uint64_t size = ReadVarint(&input);
+    families.push_back(Parse(input.substr(0, size)));
+    input.remove_prefix(size);
+  }
+  return families;
+}
+
+TEST(NegotiateExpositionTest, PicksHighestQuality) {
+  EXPECT_EQ(PrometheusExposition::kText, NegotiateExposition(""));
+  EXPECT_EQ(PrometheusExposition::kText,
+            NegotiateExposition("text/plain;version=0.0.4;q=0.5,*/*;q=0.1"));
+  EXPECT_EQ(PrometheusExposition::kOpenMetrics,
+            NegotiateExposition("application/openmetrics-text;version=1.0.0,"
+                                "text/plain;version=0.0.4;q=0.5"));
+  EXPECT_EQ(PrometheusExposition::kProtobuf,
+            NegotiateExposition(
+                "application/vnd.google.protobuf;"
+                "proto=io.prometheus.client.MetricFamily;encoding=delimited;"
+                "q=0.7,text/plain;version=0.0.4;q=0.3"));
+  // Equal qualities prefer protobuf.
+  EXPECT_EQ(PrometheusExposition::kProtobuf,
+            NegotiateExposition("application/openmetrics-text, "
+                                "application/vnd.google.protobuf; "
+                                "proto=\"io.prometheus.client.MetricFamily\"; "
+                                "encoding=delimited"));
+  // Protobuf of another message or encoding is not ours.
+  EXPECT_EQ(PrometheusExposition::kText,
+            NegotiateExposition("application/vnd.google.protobuf;"
+                                "proto=io.prometheus.client.MetricFamily;"
+                                "encoding=text"));
+  // q=0 excludes a type.
+  EXPECT_EQ(PrometheusExposition::kText,
+            NegotiateExposition("application/openmetrics-text;q=0"));
+}
+
+TEST(PrometheusProtoWriterTest, Count) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "proto_measure_count", "", "units");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test/proto_count")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .set_description("Counts.")
+          .add_column(opencensus::tags::TagKey::Register("foo.bar"));
+  const opencensus::stats::ViewData data = TestUtils::MakeViewData(
+      view_descriptor, {{{"v1"}, 1.0}, {{"v1"}, 3.0}});
+
+  PrometheusProtoWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor, data}}, &output);
+  const std::vector<Message> families = ParseDelimited(output);
+  ASSERT_EQ(1, families.size());
+  EXPECT_EQ("test_proto_count_units", families[0].Bytes(1));
+  EXPECT_EQ("Counts.", families[0].Bytes(2));
+  EXPECT_EQ(0, families[0].Varint(3));  // COUNTER
+  const std::vector<Message> metrics = families[0].Messages(4);
+  ASSERT_EQ(1, metrics.size());
+  const std::vector<Message> labels = metrics[0].Messages(1);
+  ASSERT_EQ(1, labels.size());
+  EXPECT_EQ("foo_bar", labels[0].Bytes(1));
+  EXPECT_EQ("v1", labels[0].Bytes(2));
+  EXPECT_EQ(2, Parse(metrics[0].Bytes(3)).Double(1));
+  EXPECT_EQ(0, metrics[0].Varint(6));
+
+  // Writing again replaces the output.
+  const std::string first_output = output;
+  writer.Write({{view_descriptor, data}}, &output);
+  EXPECT_EQ(first_output, output);
+}
+
+TEST(PrometheusProtoWriterTest, DistributionWithExemplar) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "proto_measure_distribution", "", "ms");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_proto_distribution")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({10})));
+  const uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8,
+                              9, 10, 11, 12, 13, 14, 15, 16};
+  const uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t sampled[] = {1};
+  const opencensus::trace::SpanContext span_context(
+      (opencensus::trace::TraceId(trace_id)),
+      (opencensus::trace::SpanId(span_id)),
+      (opencensus::trace::TraceOptions(sampled)));
+
+  PrometheusProtoWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor,
+                 TestUtils::MakeViewDataWithExemplars(
+                     view_descriptor, {{{}, 12.5}}, span_context,
+                     absl::UnixEpoch() + absl::Milliseconds(1500))}},
+               &output);
+  const std::vector<Message> families = ParseDelimited(output);
+  ASSERT_EQ(1, families.size());
+  EXPECT_EQ(4, families[0].Varint(3));  // HISTOGRAM
+  const std::vector<Message> metrics = families[0].Messages(4);
+  ASSERT_EQ(1, metrics.size());
+  EXPECT_TRUE(metrics[0].Messages(1).empty());
+  const Message histogram = Parse(metrics[0].Bytes(7));
+  EXPECT_EQ(1, histogram.Varint(1));
+  EXPECT_EQ(12.5, histogram.Double(2));
+  const std::vector<Message> buckets = histogram.Messages(3);
+  ASSERT_EQ(2, buckets.size());
+  EXPECT_EQ(0, buckets[0].Varint(1));
+  EXPECT_EQ(10, buckets[0].Double(2));
+  EXPECT_TRUE(buckets[0].Messages(3).empty());
+  EXPECT_EQ(1, buckets[1].Varint(1));
+  EXPECT_TRUE(std::isinf(buckets[1].Double(2)));
+  const std::vector<Message> exemplars = buckets[1].Messages(3);
+  ASSERT_EQ(1, exemplars.size());
+  const std::vector<Message> exemplar_labels = exemplars[0].Messages(1);
+  ASSERT_EQ(2, exemplar_labels.size());
+  EXPECT_EQ("trace_id", exemplar_labels[0].Bytes(1));
+  EXPECT_EQ("0102030405060708090a0b0c0d0e0f10", exemplar_labels[0].Bytes(2));
+  EXPECT_EQ("span_id", exemplar_labels[1].Bytes(1));
+  EXPECT_EQ("0102030405060708", exemplar_labels[1].Bytes(2));
+  EXPECT_EQ(12.5, exemplars[0].Double(2));
+  const Message timestamp = Parse(exemplars[0].Bytes(3));
+  EXPECT_EQ(1, timestamp.Varint(1));
+  EXPECT_EQ(500000000, timestamp.Varint(2));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,424 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/double_format.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/trace/span_context.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+absl::string_view TypeName(opencensus::stats::Aggregation::Type type,
+                           PrometheusTextFormat format) {
+  switch (type) {
+    case opencensus::stats::Aggregation::Type::kCount:
+      return "counter";
+    case opencensus::stats::Aggregation::Type::kSum:
+      return format == PrometheusTextFormat::kOpenMetrics ? "unknown"
+                                                          : "untyped";
+    case opencensus::stats::Aggregation::Type::kLastValue:
+    case opencensus::stats::Aggregation::Type::kDistinctCount:
+      return "gauge";
+    case opencensus::stats::Aggregation::Type::kDistribution:
+    case opencensus::stats::Aggregation::Type::kExponentialHistogram:
+      return "histogram";
+    case opencensus::stats::Aggregation::Type::kQuantiles:
+      return "summary";
+  }
+  ABSL_ASSERT(false && "Bad Aggregation type.");
+  return "untyped";
+}
+
+// Appends 'value', escaping backslashes and newlines, and double quotes if
+// 'escape_quotes'.
+void AppendEscaped(absl::string_view value, bool escape_quotes,
+                   std::string* output) {
+  for (const char c : value) {
+    switch (c) {
+      case '\\':
+        output->append("\\\\");
+        break;
+      case '\n':
+        output->append("\\n");
+        break;
+      case '"':
+        output->append(escape_quotes ? "\\\"" : "\"");
+        break;
+      default:
+        output->push_back(c);
+    }
+  }
+}
+
+// Appends 'value' as Prometheus writes floats.
+void AppendDouble(double value, std::string* output) {
+  if (std::isnan(value)) {
+    output->append("NaN");
+    return;
+  }
+  if (std::isinf(value)) {
+    output->append(value > 0 ? "+Inf" : "-Inf");
+    return;
+  }
+  opencensus::common::AppendRoundTripDouble(value, output);
+}
+
+void AppendValue(double value, std::string* output) {
+  AppendDouble(value, output);
+}
+
+void AppendValue(int64_t value, std::string* output) {
+  char buf[absl::numbers_internal::kFastToBufferSize];
+  output->append(buf, absl::numbers_internal::FastIntToBuffer(value, buf));
+}
+
+void AppendValue(uint64_t value, std::string* output) {
+  char buf[absl::numbers_internal::kFastToBufferSize];
+  output->append(buf, absl::numbers_internal::FastIntToBuffer(value, buf));
+}
+
+// Appends 'time' as OpenMetrics does, in seconds since the epoch, to
+// millisecond precision.
+void AppendSeconds(absl::Time time, std::string* output) {
+  AppendDouble(absl::ToUnixMillis(time) / 1000.0, output);
+}
+
+// Writes the samples of one row. 'labels' are the row's encoded labels, each
+// the label name followed by '="', the escaped value, and '"'.
+class RowWriter {
+ public:
+  RowWriter(absl::string_view name,
+            const std::vector<const std::string*>& labels,
+            absl::string_view timestamp, PrometheusTextFormat format,
+            std::string* output)
+      : name_(name),
+        labels_(labels),
+        timestamp_(timestamp),
+        format_(format),
+        output_(output) {}
+
+  PrometheusTextFormat format() const { return format_; }
+
+  // Appends a sample of the metric family name plus 'suffix', with an extra
+  // label if 'extra_label' is not empty.
+  template <typename T>
+  void Sample(absl::string_view suffix, T value,
+              absl::string_view extra_label = "",
+              absl::string_view extra_value = "") {
+    AppendSample(suffix, value, extra_label, extra_value);
+    output_->push_back('\n');
+  }
+
+  // Appends a histogram bucket, followed by 'exemplar' in the OpenMetrics
+  // format if it has a valid span context.
+  void Bucket(double upper_bound, uint64_t cumulative_count,
+              const opencensus::stats::Exemplar* exemplar = nullptr) {
+    bound_.clear();
+    AppendDouble(upper_bound, &bound_);
+    FormattedBucket(bound_, cumulative_count, exemplar);
+  }
+  // As above, with the upper bound already formatted.
+  void FormattedBucket(absl::string_view bound, uint64_t cumulative_count,
+                       const opencensus::stats::Exemplar* exemplar) {
+    AppendSample("_bucket", cumulative_count, "le", bound);
+    if (format_ == PrometheusTextFormat::kOpenMetrics && exemplar != nullptr &&
+        exemplar->span_context.IsValid()) {
+      output_->append(" # {trace_id=\"");
+      output_->append(exemplar->span_context.trace_id().ToHex());
+      output_->append("\",span_id=\"");
+      output_->append(exemplar->span_context.span_id().ToHex());
+      output_->append("\"} ");
+      AppendDouble(exemplar->value, output_);
+      output_->push_back(' ');
+      AppendSeconds(exemplar->timestamp, output_);
+    }
+    output_->push_back('\n');
+  }
+
+ private:
+  // Appends a sample line without the terminating newline.
+  template <typename T>
+  void AppendSample(absl::string_view suffix, T value,
+                    absl::string_view extra_label,
+                    absl::string_view extra_value) {
+    output_->append(name_.data(), name_.size());
+    output_->append(suffix.data(), suffix.size());
+    if (!labels_.empty() || !extra_label.empty()) {
+      output_->push_back('{');
+      for (size_t i = 0; i < labels_.size(); ++i) {
+        if (i > 0) output_->push_back(',');
+        output_->append(*labels_[i]);
+      }
+      if (!extra_label.empty()) {
+        if (!labels_.empty()) output_->push_back(',');
+        output_->append(extra_label.data(), extra_label.size());
+        output_->append("=\"");
+        output_->append(extra_value.data(), extra_value.size());
+        output_->push_back('"');
+      }
+      output_->push_back('}');
+    }
+    output_->push_back(' ');
+    AppendValue(value, output_);
+    output_->push_back(' ');
+    output_->append(timestamp_.data(), timestamp_.size());
+  }
+
+  const absl::string_view name_;
+  const std::vector<const std::string*>& labels_;
+  const absl::string_view timestamp_;
+  const PrometheusTextFormat format_;
+  std::string* const output_;
+  // Scratch space for formatting bucket bounds.
+  std::string bound_;
+};
+
+void WriteRow(double value, const PrometheusViewNames& names
+                                  ABSL_ATTRIBUTE_UNUSED,
+              RowWriter* writer) {
+  writer->Sample("", value);
+}
+
+void WriteRow(int64_t value, const PrometheusViewNames& names,
+              RowWriter* writer) {
+  // OpenMetrics names counter samples with a "_total" suffix.
+  writer->Sample(writer->format() == PrometheusTextFormat::kOpenMetrics &&
+                         names.descriptor.aggregation().type() ==
+                             opencensus::stats::Aggregation::Type::kCount
+                     ? "_total"
+                     : "",
+                 value);
+}
+
+void WriteRow(const opencensus::stats::Distribution& value,
+              const PrometheusViewNames& names, RowWriter* writer) {
+  const auto& exemplars = value.exemplars();
+  const int num_buckets = value.bucket_boundaries().num_buckets();
+  ABSL_ASSERT(names.bucket_labels.size() == num_buckets);
+  uint64_t cumulative_count = 0;
+  for (int i = 0; i < num_buckets; ++i) {
+    cumulative_count += value.bucket_counts()[i];
+    writer->FormattedBucket(names.bucket_labels[i], cumulative_count,
+                            exemplars.empty() ? nullptr : &exemplars[i]);
+  }
+  writer->Sample("_sum", value.count() * value.mean());
+  writer->Sample("_count", value.count());
+}
+
+void WriteRow(const opencensus::stats::ExponentialHistogram& value,
+              const PrometheusViewNames& names, RowWriter* writer) {
+  const auto& aggregation = names.descriptor.aggregation();
+  if (aggregation.type() ==
+      opencensus::stats::Aggregation::Type::kQuantiles) {
+    std::string quantile;
+    for (const double q : aggregation.quantiles()) {
+      quantile.clear();
+      AppendDouble(q, &quantile);
+      writer->Sample("", value.Quantile(q), "quantile", quantile);
+    }
+  } else {
+    // Prometheus buckets are cumulative with inclusive upper bounds, so the
+    // negative buckets are emitted from the most negative, followed by zero
+    // and the positive buckets, and +Inf.
+    const auto& negative = value.negative_buckets();
+    const auto& positive = value.positive_buckets();
+    uint64_t cumulative_count = 0;
+    for (int k = negative.counts.size() - 1; k >= 0; --k) {
+      cumulative_count += negative.counts[k];
+      writer->Bucket(-value.LowerBound(negative.offset + k), cumulative_count);
+    }
+    cumulative_count += value.zero_count();
+    writer->Bucket(0, cumulative_count);
+    for (int k = 0; k < positive.counts.size(); ++k) {
+      cumulative_count += positive.counts[k];
+      writer->Bucket(value.LowerBound(positive.offset + k + 1),
+                     cumulative_count);
+    }
+    writer->Bucket(std::numeric_limits<double>::infinity(), cumulative_count);
+  }
+  writer->Sample("_sum", value.sum());
+  writer->Sample("_count", value.count());
+}
+
+// ColumnarViewData holds scalar values directly and others by pointer.
+template <typename T>
+const T& RowValue(const T& value) {
+  return value;
+}
+template <typename T>
+const T& RowValue(const T* value) {
+  return *value;
+}
+
+template <typename T>
+void WriteRows(const opencensus::stats::ColumnarViewData& data,
+               const std::vector<T>& values, const PrometheusViewNames& names,
+               absl::string_view timestamp, PrometheusTextFormat format,
+               std::string* output) {
+  // Encode each distinct tag value once, rather than once per sample line.
+  std::vector<std::vector<std::string>> encoded(data.num_columns());
+  for (size_t column = 0; column < data.num_columns(); ++column) {
+    const auto& dictionary = data.dictionary(column);
+    encoded[column].resize(dictionary.size());
+    for (size_t i = 0; i < dictionary.size(); ++i) {
+      std::string& label = encoded[column][i];
+      label = names.label_prefixes[column];
+      AppendEscaped(dictionary[i], true, &label);
+      label.push_back('"');
+    }
+  }
+  std::vector<const std::string*> labels(data.num_columns());
+  for (size_t row = 0; row < data.num_rows(); ++row) {
+    for (size_t column = 0; column < data.num_columns(); ++column) {
+      labels[column] = &encoded[column][data.codes(column)[row]];
+    }
+    RowWriter writer(names.name, labels, timestamp, format, output);
+    WriteRow(RowValue(values[row]), names, &writer);
+  }
+}
+
+void AppendView(const PrometheusViewNames& names,
+                const opencensus::stats::ViewData& view_data,
+                PrometheusTextFormat format, std::string* output) {
+  const opencensus::stats::ColumnarViewData data(view_data);
+  output->append(names.header);
+  // Prometheus timestamps are in milliseconds; OpenMetrics ones in seconds.
+  std::string timestamp;
+  if (format == PrometheusTextFormat::kOpenMetrics) {
+    AppendSeconds(view_data.end_time(), &timestamp);
+  } else {
+    AppendValue(absl::ToUnixMillis(view_data.end_time()), &timestamp);
+  }
+  switch (data.type()) {
+    case opencensus::stats::ViewData::Type::kDouble:
+      WriteRows(data, data.double_values(), names, timestamp, format, output);
+      break;
+    case opencensus::stats::ViewData::Type::kInt64:
+      WriteRows(data, data.int_values(), names, timestamp, format, output);
+      break;
+    case opencensus::stats::ViewData::Type::kDistribution:
+      WriteRows(data, data.distribution_values(), names, timestamp, format,
+                output);
+      break;
+    case opencensus::stats::ViewData::Type::kExponentialHistogram:
+      WriteRows(data, data.exponential_histogram_values(), names, timestamp,
+                format, output);
+      break;
+  }
+}
+
+}  // namespace
+
+std::string SanitizeName(absl::string_view name) {
+  std::string sanitized(name);
+  std::replace_if(sanitized.begin(), sanitized.end(),
+                  [](char c) { return !::isalnum(c); }, '_');
+  return sanitized;
+}
+
+const PrometheusViewNames& PrometheusNameCache::Get(
+    const opencensus::stats::ViewDescriptor& descriptor) {
+  auto it = entries_.find(descriptor.name());
+  if (it == entries_.end() || it->second.names.descriptor != descriptor) {
+    PrometheusViewNames names;
+    names.descriptor = descriptor;
+    // TODO(sturdy): convert common units into base units (e.g. ms->s).
+    names.name = SanitizeName(absl::StrCat(
+        descriptor.name(), "_", descriptor.measure_descriptor().units()));
+    absl::StrAppend(&names.header, "# HELP ", names.name, " ");
+    // OpenMetrics escapes quotes in help text as well as in label values.
+    AppendEscaped(descriptor.description(),
+                  format_ == PrometheusTextFormat::kOpenMetrics,
+                  &names.header);
+    absl::StrAppend(&names.header, "\n# TYPE ", names.name, " ",
+                    TypeName(descriptor.aggregation().type(), format_), "\n");
+    names.label_names.reserve(descriptor.num_columns());
+    names.label_prefixes.reserve(descriptor.num_columns());
+    for (const auto& column : descriptor.columns()) {
+      names.label_names.push_back(SanitizeName(column.name()));
+      names.label_prefixes.push_back(
+          absl::StrCat(names.label_names.back(), "=\""));
+    }
+    if (descriptor.aggregation().type() ==
+        opencensus::stats::Aggregation::Type::kDistribution) {
+      // We use lower boundaries plus an underflow bucket; Prometheus uses
+      // upper boundaries, including a +Inf boundary.
+      const auto& boundaries = descriptor.aggregation().bucket_boundaries();
+      names.bucket_upper_bounds = boundaries.lower_boundaries();
+      names.bucket_upper_bounds.push_back(
+          std::numeric_limits<double>::infinity());
+      names.bucket_labels.resize(names.bucket_upper_bounds.size());
+      for (size_t i = 0; i < names.bucket_labels.size(); ++i) {
+        AppendDouble(names.bucket_upper_bounds[i], &names.bucket_labels[i]);
+      }
+    }
+    if (it == entries_.end()) {
+      it = entries_.emplace(descriptor.name(), Entry{std::move(names), false})
+               .first;
+    } else {
+      it->second.names = std::move(names);
+    }
+  }
+  it->second.used = true;
+  return it->second.names;
+}
+
+void PrometheusNameCache::EvictUnused() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.used) {
+      it->second.used = false;
+      ++it;
+    } else {
+      it = entries_.erase(it);
+    }
+  }
+}
+
+void PrometheusTextWriter::Write(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data,
+    std::string* output) {
+  output->clear();
+  for (const auto& view : data) {
+    AppendView(names_.Get(view.first), view.second, format_, output);
+  }
+  if (format_ == PrometheusTextFormat::kOpenMetrics) {
+    output->append("# EOF\n");
+  }
+  names_.EvictUnused();
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,116 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_TEXT_H_
+#define OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_TEXT_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/stats.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+// Replaces non-alphanumeric characters with underscores to satisfy
+// Prometheus's name requirements.
+std::string SanitizeName(absl::string_view name);
+
+// The text exposition formats written by PrometheusTextWriter.
+enum class PrometheusTextFormat {
+  // The Prometheus text format, version 0.0.4.
+  kPrometheus,
+  // OpenMetrics 1.0.0, which also carries the exemplars of histogram buckets.
+  kOpenMetrics,
+};
+
+// The sanitized Prometheus names of a view.
+struct PrometheusViewNames {
+  opencensus::stats::ViewDescriptor descriptor;
+  // The metric family name.
+  std::string name;
+  std::vector<std::string> label_names;
+  // The "# HELP" and "# TYPE" lines of the cache's text format.
+  std::string header;
+  // The label names, each followed by '="', for the text format.
+  std::vector<std::string> label_prefixes;
+  // For Distribution views, the Prometheus upper bound of each bucket (the
+  // next bucket's lower boundary, or +Inf for the last), and the same
+  // formatted as "le" label values, shared by every row.
+  std::vector<double> bucket_upper_bounds;
+  std::vector<std::string> bucket_labels;
+};
+
+// PrometheusNameCache caches the PrometheusViewNames of each exported view,
+// since descriptors rarely change between exports. A view's entry is replaced
+// when its descriptor changes (e.g. the view was removed and added again), and
+// dropped once it is no longer exported.
+//
+// PrometheusNameCache is thread-compatible.
+class PrometheusNameCache final {
+ public:
+  explicit PrometheusNameCache(
+      PrometheusTextFormat format = PrometheusTextFormat::kPrometheus)
+      : format_(format) {}
+
+  // Returns the names of 'descriptor', computing them if that view is new or
+  // its descriptor has changed. The reference is valid until EvictUnused().
+  const PrometheusViewNames& Get(
+      const opencensus::stats::ViewDescriptor& descriptor);
+
+  // Drops views that have not been passed to Get() since the last call.
+  void EvictUnused();
+
+ private:
+  struct Entry {
+    PrometheusViewNames names;
+    bool used;
+  };
+
+  const PrometheusTextFormat format_;
+  // Keyed by view name.
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+// PrometheusTextWriter writes view data directly in a text exposition format,
+// without building prometheus-cpp MetricFamily objects.
+//
+// PrometheusTextWriter is thread-compatible.
+class PrometheusTextWriter final {
+ public:
+  explicit PrometheusTextWriter(
+      PrometheusTextFormat format = PrometheusTextFormat::kPrometheus)
+      : format_(format), names_(format) {}
+
+  // Replaces the contents of *output (reusing its capacity) with the
+  // exposition of 'data'.
+  void Write(const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                         opencensus::stats::ViewData>>& data,
+             std::string* output);
+
+ private:
+  const PrometheusTextFormat format_;
+  PrometheusNameCache names_;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_INTERNAL_PROMETHEUS_TEXT_H_
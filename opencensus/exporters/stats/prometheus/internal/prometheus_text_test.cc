@@ -0,0 +1,293 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opencensus/trace/trace_options.h"
+
+using opencensus::stats::testing::TestUtils;
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+TEST(SanitizeNameTest, ReplacesNonAlphanumerics) {
+  EXPECT_EQ("foo_bar_1_", SanitizeName("foo/bar.1-"));
+}
+
+TEST(PrometheusNameCacheTest, CachesNames) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_cache", "", "ms");
+  auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test.cache")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .add_column(opencensus::tags::TagKey::Register("foo.bar"));
+  PrometheusNameCache cache;
+  const PrometheusViewNames* names = &cache.Get(view_descriptor);
+  EXPECT_EQ("test_cache_ms", names->name);
+  EXPECT_THAT(names->label_names, ::testing::ElementsAre("foo_bar"));
+  EXPECT_THAT(names->label_prefixes, ::testing::ElementsAre("foo_bar=\""));
+  cache.EvictUnused();
+  EXPECT_EQ(names, &cache.Get(view_descriptor));
+  cache.EvictUnused();
+
+  // Changing the descriptor recomputes the names.
+  view_descriptor.add_column(opencensus::tags::TagKey::Register("baz"));
+  EXPECT_THAT(cache.Get(view_descriptor).label_names,
+              ::testing::ElementsAre("foo_bar", "baz"));
+  cache.EvictUnused();
+
+  // A view that is not used between evictions is dropped; the next Get()
+  // computes its names again.
+  cache.EvictUnused();
+  EXPECT_THAT(cache.Get(view_descriptor).label_names,
+              ::testing::ElementsAre("foo_bar", "baz"));
+}
+
+TEST(PrometheusTextWriterTest, Count) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_count", "", "units");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test/count")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .set_description("Line 1\nLine \"2\"")
+          .add_column(opencensus::tags::TagKey::Register("foo"))
+          .add_column(opencensus::tags::TagKey::Register("bar.baz"));
+  const opencensus::stats::ViewData data = TestUtils::MakeViewData(
+      view_descriptor,
+      {{{"v1", "v1"}, 1.0}, {{"v1", "v1"}, 3.0}, {{"v1", "a\"b\\c"}, 2.0}});
+
+  PrometheusTextWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor, data}}, &output);
+  // Rows are not ordered.
+  const std::vector<std::string> lines =
+      absl::StrSplit(output, '\n', absl::SkipEmpty());
+  ASSERT_EQ(4, lines.size());
+  EXPECT_EQ("# HELP test_count_units Line 1\\nLine \"2\"", lines[0]);
+  EXPECT_EQ("# TYPE test_count_units counter", lines[1]);
+  EXPECT_THAT(
+      std::vector<std::string>(lines.begin() + 2, lines.end()),
+      ::testing::UnorderedElementsAre(
+          "test_count_units{foo=\"v1\",bar_baz=\"v1\"} 2 0",
+          "test_count_units{foo=\"v1\",bar_baz=\"a\\\"b\\\\c\"} 1 0"));
+
+  // Writing again replaces the output.
+  const std::string first_output = output;
+  writer.Write({{view_descriptor, data}}, &output);
+  EXPECT_EQ(first_output, output);
+}
+
+TEST(PrometheusTextWriterTest, SumWithoutColumns) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_sum", "", "By");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_sum")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum());
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewData(view_descriptor, {{{}, 0.1}, {{}, 2.5}});
+
+  PrometheusTextWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor, data}}, &output);
+  EXPECT_EQ(
+      "# HELP test_sum_By \n"
+      "# TYPE test_sum_By untyped\n"
+      "test_sum_By 2.6 0\n",
+      output);
+}
+
+TEST(PrometheusTextWriterTest, Distribution) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_distribution", "", "ms");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_distribution")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({0, 10})))
+          .add_column(opencensus::tags::TagKey::Register("foo"));
+  const opencensus::stats::ViewData data = TestUtils::MakeViewData(
+      view_descriptor, {{{"v1"}, -1}, {{"v1"}, 1}, {{"v1"}, 3}, {{"v1"}, 11}});
+
+  PrometheusTextWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor, data}}, &output);
+  EXPECT_EQ(
+      "# HELP test_distribution_ms \n"
+      "# TYPE test_distribution_ms histogram\n"
+      "test_distribution_ms_bucket{foo=\"v1\",le=\"0\"} 1 0\n"
+      "test_distribution_ms_bucket{foo=\"v1\",le=\"10\"} 3 0\n"
+      "test_distribution_ms_bucket{foo=\"v1\",le=\"+Inf\"} 4 0\n"
+      "test_distribution_ms_sum{foo=\"v1\"} 14 0\n"
+      "test_distribution_ms_count{foo=\"v1\"} 4 0\n",
+      output);
+}
+
+TEST(PrometheusTextWriterTest, ChangedAndRemovedViews) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_changed", "", "1");
+  auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_changed")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .add_column(opencensus::tags::TagKey::Register("foo"));
+  PrometheusTextWriter writer;
+  std::string output;
+  writer.Write(
+      {{view_descriptor,
+        TestUtils::MakeViewData(view_descriptor, {{{"v1"}, 1.0}})}},
+      &output);
+  EXPECT_EQ(
+      "# HELP test_changed_1 \n"
+      "# TYPE test_changed_1 counter\n"
+      "test_changed_1{foo=\"v1\"} 1 0\n",
+      output);
+
+  // A view re-registered under the same name with a different descriptor does
+  // not use the old names.
+  view_descriptor.set_aggregation(opencensus::stats::Aggregation::Sum())
+      .set_description("sum");
+  writer.Write(
+      {{view_descriptor,
+        TestUtils::MakeViewData(view_descriptor, {{{"v1"}, 2.0}})}},
+      &output);
+  EXPECT_EQ(
+      "# HELP test_changed_1 sum\n"
+      "# TYPE test_changed_1 untyped\n"
+      "test_changed_1{foo=\"v1\"} 2 0\n",
+      output);
+
+  writer.Write({}, &output);
+  EXPECT_EQ("", output);
+}
+
+TEST(PrometheusTextWriterTest, OpenMetrics) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_open_metrics", "", "ms");
+  const auto count_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_open_metrics_count")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .set_description("A \"count\"");
+  const auto sum_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_open_metrics_sum")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum());
+  const auto distribution_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_open_metrics_distribution")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({10})));
+  const uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8,
+                              9, 10, 11, 12, 13, 14, 15, 16};
+  const uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t sampled[] = {1};
+  const opencensus::trace::SpanContext span_context(
+      (opencensus::trace::TraceId(trace_id)),
+      (opencensus::trace::SpanId(span_id)),
+      (opencensus::trace::TraceOptions(sampled)));
+
+  PrometheusTextWriter writer(PrometheusTextFormat::kOpenMetrics);
+  std::string output;
+  writer.Write(
+      {{count_descriptor,
+        TestUtils::MakeViewData(count_descriptor, {{{}, 1.0}})},
+       {sum_descriptor, TestUtils::MakeViewData(sum_descriptor, {{{}, 1.5}})},
+       {distribution_descriptor,
+        TestUtils::MakeViewDataWithExemplars(
+            distribution_descriptor, {{{}, 12.5}}, span_context,
+            absl::UnixEpoch() + absl::Milliseconds(1500))}},
+      &output);
+  EXPECT_EQ(
+      "# HELP test_open_metrics_count_ms A \\\"count\\\"\n"
+      "# TYPE test_open_metrics_count_ms counter\n"
+      "test_open_metrics_count_ms_total 1 0\n"
+      "# HELP test_open_metrics_sum_ms \n"
+      "# TYPE test_open_metrics_sum_ms unknown\n"
+      "test_open_metrics_sum_ms 1.5 0\n"
+      "# HELP test_open_metrics_distribution_ms \n"
+      "# TYPE test_open_metrics_distribution_ms histogram\n"
+      "test_open_metrics_distribution_ms_bucket{le=\"10\"} 0 0\n"
+      "test_open_metrics_distribution_ms_bucket{le=\"+Inf\"} 1 0 # "
+      "{trace_id=\"0102030405060708090a0b0c0d0e0f10\","
+      "span_id=\"0102030405060708\"} 12.5 1.5\n"
+      "test_open_metrics_distribution_ms_sum 12.5 0\n"
+      "test_open_metrics_distribution_ms_count 1 0\n"
+      "# EOF\n",
+      output);
+}
+
+TEST(PrometheusTextWriterTest, PrometheusFormatOmitsExemplars) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "text_measure_no_exemplars", "", "ms");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_no_exemplars")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({})));
+  const uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8,
+                              9, 10, 11, 12, 13, 14, 15, 16};
+  const uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t sampled[] = {1};
+  const opencensus::trace::SpanContext span_context(
+      (opencensus::trace::TraceId(trace_id)),
+      (opencensus::trace::SpanId(span_id)),
+      (opencensus::trace::TraceOptions(sampled)));
+
+  PrometheusTextWriter writer;
+  std::string output;
+  writer.Write({{view_descriptor, TestUtils::MakeViewDataWithExemplars(
+                                      view_descriptor, {{{}, 1}},
+                                      span_context, absl::UnixEpoch())}},
+               &output);
+  EXPECT_EQ(
+      "# HELP test_no_exemplars_ms \n"
+      "# TYPE test_no_exemplars_ms histogram\n"
+      "test_no_exemplars_ms_bucket{le=\"+Inf\"} 1 0\n"
+      "test_no_exemplars_ms_sum 1 0\n"
+      "test_no_exemplars_ms_count 1 0\n",
+      output);
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
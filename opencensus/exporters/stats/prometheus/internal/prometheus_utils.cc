@@ -14,7 +14,6 @@
 
 #include "opencensus/exporters/stats/prometheus/internal/prometheus_utils.h"
 
-#include <cctype>
 #include <cstdint>
 #include <limits>
 #include <string>
@@ -22,9 +21,8 @@
 #include <vector>
 
 #include "absl/base/macros.h"
-#include "absl/strings/str_cat.h"
-#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
 #include "opencensus/stats/stats.h"
 #include "prometheus/metric_type.h"
 
@@ -34,15 +32,6 @@ namespace stats {
 
 namespace {
 
-// Replaces non-alphanumeric characters with underscores to satisfy
-// Prometheus's name requirements.
-std::string SanitizeName(absl::string_view name) {
-  std::string sanitized(name);
-  std::replace_if(sanitized.begin(), sanitized.end(),
-                  [](char c) { return !::isalnum(c); }, '_');
-  return sanitized;
-}
-
 prometheus::MetricType MetricType(opencensus::stats::Aggregation::Type type) {
   switch (type) {
     case opencensus::stats::Aggregation::Type::kCount:
@@ -50,15 +39,22 @@ prometheus::MetricType MetricType(opencensus::stats::Aggregation::Type type) {
     case opencensus::stats::Aggregation::Type::kSum:
       return prometheus::MetricType::Untyped;
     case opencensus::stats::Aggregation::Type::kLastValue:
+    case opencensus::stats::Aggregation::Type::kDistinctCount:
       return prometheus::MetricType::Gauge;
     case opencensus::stats::Aggregation::Type::kDistribution:
+    case opencensus::stats::Aggregation::Type::kExponentialHistogram:
       return prometheus::MetricType::Histogram;
+    case opencensus::stats::Aggregation::Type::kQuantiles:
+      return prometheus::MetricType::Summary;
   }
   ABSL_ASSERT(false && "Bad MetricType.");
   return prometheus::MetricType::Untyped;
 }
 
+// The names are needed only for the quantiles of summaries and the precomputed
+// bucket bounds of histograms.
 void SetValue(double value, prometheus::MetricType type,
+              const PrometheusViewNames& names ABSL_ATTRIBUTE_UNUSED,
               prometheus::ClientMetric* metric) {
   if (type == prometheus::MetricType::Untyped) {
     metric->untyped.value = value;
@@ -69,6 +65,7 @@ void SetValue(double value, prometheus::MetricType type,
 }
 
 void SetValue(int64_t value, prometheus::MetricType type,
+              const PrometheusViewNames& names ABSL_ATTRIBUTE_UNUSED,
               prometheus::ClientMetric* metric) {
   switch (type) {
     case prometheus::MetricType::Counter: {
@@ -90,28 +87,71 @@ void SetValue(int64_t value, prometheus::MetricType type,
 
 void SetValue(const opencensus::stats::Distribution& value,
               prometheus::MetricType type ABSL_ATTRIBUTE_UNUSED,
+              const PrometheusViewNames& names,
               prometheus::ClientMetric* metric) {
   auto& histogram = metric->histogram;
   histogram.sample_count = value.count();
   histogram.sample_sum = value.count() * value.mean();
 
+  const int num_buckets = value.bucket_boundaries().num_buckets();
+  ABSL_ASSERT(names.bucket_upper_bounds.size() == num_buckets);
   int64_t cumulative_count = 0;
-  histogram.bucket.reserve(value.bucket_boundaries().num_buckets());
-  for (int i = 0; i < value.bucket_boundaries().num_buckets(); ++i) {
+  histogram.bucket.resize(num_buckets);
+  for (int i = 0; i < num_buckets; ++i) {
     cumulative_count += value.bucket_counts()[i];
-    histogram.bucket.emplace_back();
     histogram.bucket[i].cumulative_count = cumulative_count;
-    // We use lower boundaries plus an underflow bucket; Prometheus uses upper
-    // boundaries, including a +Inf boundary.
-    histogram.bucket[i].upper_bound =
-        i < value.bucket_boundaries().lower_boundaries().size()
-            ? value.bucket_boundaries().lower_boundaries()[i]
-            : std::numeric_limits<double>::infinity();
+    histogram.bucket[i].upper_bound = names.bucket_upper_bounds[i];
   }
 }
 
+void SetValue(const opencensus::stats::ExponentialHistogram& value,
+              prometheus::MetricType type, const PrometheusViewNames& names,
+              prometheus::ClientMetric* metric) {
+  if (type == prometheus::MetricType::Summary) {
+    const auto& aggregation = names.descriptor.aggregation();
+    auto& summary = metric->summary;
+    summary.sample_count = value.count();
+    summary.sample_sum = value.sum();
+    summary.quantile.reserve(aggregation.quantiles().size());
+    for (const double q : aggregation.quantiles()) {
+      summary.quantile.emplace_back();
+      summary.quantile.back().quantile = q;
+      summary.quantile.back().value = value.Quantile(q);
+    }
+    return;
+  }
+  ABSL_ASSERT(type == prometheus::MetricType::Histogram);
+  auto& histogram = metric->histogram;
+  histogram.sample_count = value.count();
+  histogram.sample_sum = value.sum();
+
+  // Prometheus buckets are cumulative with inclusive upper bounds, so the
+  // negative buckets are emitted from the most negative, followed by zero and
+  // the positive buckets, and +Inf.
+  const auto& negative = value.negative_buckets();
+  const auto& positive = value.positive_buckets();
+  histogram.bucket.reserve(negative.counts.size() + positive.counts.size() +
+                           2);
+  uint64_t cumulative_count = 0;
+  const auto add_bucket = [&histogram, &cumulative_count](double upper_bound,
+                                                          uint64_t count) {
+    cumulative_count += count;
+    histogram.bucket.emplace_back();
+    histogram.bucket.back().cumulative_count = cumulative_count;
+    histogram.bucket.back().upper_bound = upper_bound;
+  };
+  for (int k = negative.counts.size() - 1; k >= 0; --k) {
+    add_bucket(-value.LowerBound(negative.offset + k), negative.counts[k]);
+  }
+  add_bucket(0, value.zero_count());
+  for (int k = 0; k < positive.counts.size(); ++k) {
+    add_bucket(value.LowerBound(positive.offset + k + 1), positive.counts[k]);
+  }
+  add_bucket(std::numeric_limits<double>::infinity(), 0);
+}
+
 template <typename T>
-void SetData(const opencensus::stats::ViewDescriptor& descriptor,
+void SetData(const PrometheusViewNames& names,
              const opencensus::stats::ViewData::DataMap<T>& data, int64_t time,
              prometheus::MetricType type,
              prometheus::MetricFamily* metric_family) {
@@ -120,12 +160,12 @@ void SetData(const opencensus::stats::ViewDescriptor& descriptor,
     metric_family->metric.emplace_back();
     prometheus::ClientMetric& metric = metric_family->metric.back();
     metric.timestamp_ms = time;
-    metric.label.resize(descriptor.num_columns());
-    for (int i = 0; i < descriptor.num_columns(); ++i) {
-      metric.label[i].name = SanitizeName(descriptor.columns()[i].name());
+    metric.label.resize(names.label_names.size());
+    for (int i = 0; i < names.label_names.size(); ++i) {
+      metric.label[i].name = names.label_names[i];
       metric.label[i].value = row.first[i];
     }
-    SetValue(row.second, type, &metric);
+    SetValue(row.second, type, names, &metric);
   }
 }
 
@@ -134,26 +174,36 @@ void SetData(const opencensus::stats::ViewDescriptor& descriptor,
 void SetMetricFamily(const opencensus::stats::ViewDescriptor& descriptor,
                      const opencensus::stats::ViewData& data,
                      prometheus::MetricFamily* metric_family) {
+  PrometheusNameCache names;
+  SetMetricFamily(names.Get(descriptor), data, metric_family);
+}
+
+void SetMetricFamily(const PrometheusViewNames& names,
+                     const opencensus::stats::ViewData& data,
+                     prometheus::MetricFamily* metric_family) {
   const prometheus::MetricType type =
-      MetricType(descriptor.aggregation().type());
-  // TODO(sturdy): convert common units into base units (e.g. ms->s).
-  metric_family->name = SanitizeName(absl::StrCat(
-      descriptor.name(), "_", descriptor.measure_descriptor().units()));
-  metric_family->help = descriptor.description();
+      MetricType(names.descriptor.aggregation().type());
+  metric_family->name = names.name;
+  metric_family->help = names.descriptor.description();
   metric_family->type = type;
 
   const int64_t time = absl::ToUnixMillis(data.end_time());
   switch (data.type()) {
     case opencensus::stats::ViewData::Type::kDouble: {
-      SetData(descriptor, data.double_data(), time, type, metric_family);
+      SetData(names, data.double_data(), time, type, metric_family);
       break;
     }
     case opencensus::stats::ViewData::Type::kInt64: {
-      SetData(descriptor, data.int_data(), time, type, metric_family);
+      SetData(names, data.int_data(), time, type, metric_family);
       break;
     }
     case opencensus::stats::ViewData::Type::kDistribution: {
-      SetData(descriptor, data.distribution_data(), time, type, metric_family);
+      SetData(names, data.distribution_data(), time, type, metric_family);
+      break;
+    }
+    case opencensus::stats::ViewData::Type::kExponentialHistogram: {
+      SetData(names, data.exponential_histogram_data(), time, type,
+              metric_family);
       break;
     }
   }
@@ -18,6 +18,7 @@
 #include <utility>
 #include <vector>
 
+#include "opencensus/exporters/stats/prometheus/internal/prometheus_text.h"
 #include "opencensus/stats/stats.h"
 #include "prometheus/metric_family.h"
 
@@ -30,6 +31,11 @@ void SetMetricFamily(const opencensus::stats::ViewDescriptor& descriptor,
                      const opencensus::stats::ViewData& data,
                      prometheus::MetricFamily* metric_family);
 
+// As above, using the precomputed names of data's view.
+void SetMetricFamily(const PrometheusViewNames& names,
+                     const opencensus::stats::ViewData& data,
+                     prometheus::MetricFamily* metric_family);
+
 }  // namespace stats
 }  // namespace exporters
 }  // namespace opencensus
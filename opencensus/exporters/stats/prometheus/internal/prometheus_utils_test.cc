@@ -565,6 +565,36 @@ TEST(StackdriverUtilsTest, MakeTimeSeriesDistributionDouble) {
                                                   infinity())))))))))));
 }
 
+TEST(SetMetricFamilyTest, Quantiles) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "measure_quantiles_double", "", "units");
+  const auto tag_key = opencensus::tags::TagKey::Register("foo");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_descriptor")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(
+              opencensus::stats::Aggregation::Quantiles({0, 0.5, 1}))
+          .add_column(tag_key);
+  const opencensus::stats::ViewData data = TestUtils::MakeViewData(
+      view_descriptor, {{{"v1"}, 1.0}, {{"v1"}, 2.0}, {{"v1"}, 9.0}});
+  prometheus::MetricFamily actual;
+  SetMetricFamily(view_descriptor, data, &actual);
+
+  EXPECT_EQ(prometheus::MetricType::Summary, actual.type);
+  ASSERT_EQ(1, actual.metric.size());
+  const auto& summary = actual.metric[0].summary;
+  EXPECT_EQ(3, summary.sample_count);
+  EXPECT_DOUBLE_EQ(12, summary.sample_sum);
+  ASSERT_EQ(3, summary.quantile.size());
+  EXPECT_EQ(0, summary.quantile[0].quantile);
+  EXPECT_DOUBLE_EQ(1, summary.quantile[0].value);
+  EXPECT_EQ(0.5, summary.quantile[1].quantile);
+  EXPECT_NEAR(2, summary.quantile[1].value, 0.1);
+  EXPECT_EQ(1, summary.quantile[2].quantile);
+  EXPECT_DOUBLE_EQ(9, summary.quantile[2].value);
+}
+
 }  // namespace
 }  // namespace stats
 }  // namespace exporters
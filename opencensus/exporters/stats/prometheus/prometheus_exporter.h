@@ -15,9 +15,15 @@
 #ifndef OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_PROMETHEUS_EXPORTER_H_
 #define OPENCENSUS_EXPORTERS_STATS_PROMETHEUS_PROMETHEUS_EXPORTER_H_
 
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "opencensus/stats/stats.h"
 #include "prometheus/collectable.h"
 #include "prometheus/metric_family.h"
@@ -26,6 +32,11 @@ namespace opencensus {
 namespace exporters {
 namespace stats {
 
+enum class PrometheusExposition;
+class PrometheusNameCache;
+class PrometheusProtoWriter;
+class PrometheusTextWriter;
+
 // The PrometheusExporter is a Collectable that exposes all views registered
 // with the opencensus StatsExporter to the Prometheus cpp client library. To
 // use with the Prometheus client library:
@@ -36,12 +47,90 @@ namespace stats {
 //
 // Alternatively, client applications that do not use the default Exposer can
 // call Collect() directly and use the serializers in the Prometheus client
-// library to expose their own Prometheus endpoint.
+// library to expose their own Prometheus endpoint. Those that only need the
+// text exposition format can call CollectText() instead, which writes it
+// directly without building MetricFamily objects, or CollectOpenMetricsText()
+// for the OpenMetrics format, which also links histogram buckets to sampled
+// traces through exemplars. CollectProtobuf() writes the protobuf format,
+// which is the cheapest for the Prometheus server to parse on large targets,
+// and CollectForAccept() picks a format from the scrape's Accept header:
+//
+//   std::string body;
+//   const absl::string_view content_type =
+//       exporter.CollectForAccept(request.header("Accept"), &body);
+//
+// When several Prometheus servers scrape the same process, construct the
+// exporter with a minimum rebuild interval: each output format is then built
+// at most once per interval, and scrapes within it (including ones that
+// arrive while it is being built) are served that result.
 //
 // PrometheusExporter is thread-safe.
 class PrometheusExporter final : public ::prometheus::Collectable {
  public:
+  PrometheusExporter();
+  // Scrapes less than 'min_rebuild_interval' after the last rebuild of the
+  // same format return the cached result instead of snapshotting all views
+  // again. A zero interval (the default) rebuilds on every call.
+  explicit PrometheusExporter(absl::Duration min_rebuild_interval);
+  ~PrometheusExporter() override;
+
   std::vector<prometheus::MetricFamily> Collect() override;
+
+  // Replaces the contents of *output with all views in the Prometheus text
+  // exposition format (version 0.0.4). Passing the same string on each call
+  // reuses its capacity.
+  void CollectText(std::string* output);
+
+  // Like CollectText(), but in the OpenMetrics text format (version 1.0.0),
+  // with the exemplar of each Distribution bucket, for serving requests that
+  // accept "application/openmetrics-text".
+  void CollectOpenMetricsText(std::string* output);
+
+  // Like CollectText(), but as length-delimited
+  // io.prometheus.client.MetricFamily protocol buffers, with the exemplar of
+  // each Distribution bucket.
+  void CollectProtobuf(std::string* output);
+
+  // Writes all views to *output in the format that best matches an HTTP
+  // Accept header, defaulting to the text format, and returns the response's
+  // Content-Type.
+  absl::string_view CollectForAccept(absl::string_view accept,
+                                     std::string* output);
+
+ private:
+  // A built exposition and when it was built.
+  struct CachedExposition {
+    std::string output;
+    absl::Time built = absl::InfinitePast();
+  };
+
+  void CollectExposition(PrometheusExposition exposition, std::string* output);
+  void WriteExposition(PrometheusExposition exposition,
+                       const std::vector<
+                           std::pair<opencensus::stats::ViewDescriptor,
+                                     opencensus::stats::ViewData>>& data,
+                       std::string* output) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if the output built at 'built' may be served now.
+  bool IsFresh(absl::Time built) const;
+
+  const absl::Duration min_rebuild_interval_;
+
+  // Held while building, so that concurrent scrapes wait for one build and
+  // then share its result rather than building their own.
+  absl::Mutex mu_;
+  // Cache the sanitized names of each view across calls.
+  std::unique_ptr<PrometheusNameCache> names_ GUARDED_BY(mu_);
+  std::unique_ptr<PrometheusTextWriter> text_writer_ GUARDED_BY(mu_);
+  std::unique_ptr<PrometheusTextWriter> open_metrics_writer_ GUARDED_BY(mu_);
+  std::unique_ptr<PrometheusProtoWriter> proto_writer_ GUARDED_BY(mu_);
+
+  // The last output of each format, only kept with a nonzero
+  // min_rebuild_interval_.
+  std::vector<prometheus::MetricFamily> families_ GUARDED_BY(mu_);
+  absl::Time families_built_ GUARDED_BY(mu_) = absl::InfinitePast();
+  // Indexed by PrometheusExposition.
+  CachedExposition expositions_[3] GUARDED_BY(mu_);
 };
 
 }  // namespace stats
@@ -15,9 +15,12 @@
 #include "opencensus/exporters/stats/stackdriver/stackdriver_exporter.h"
 
 #include <algorithm>
-#include <cmath>
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <grpcpp/grpcpp.h>
@@ -25,11 +28,17 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "google/monitoring/v3/metric_service.grpc.pb.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/empty.pb.h"
+#include "opencensus/common/internal/disk_spool.h"
+#include "opencensus/common/internal/grpc/channel_options.h"
+#include "opencensus/common/internal/grpc/shared_channel.h"
 #include "opencensus/common/internal/grpc/status.h"
-#include "opencensus/common/internal/grpc/with_user_agent.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/self_metrics.h"
 #include "opencensus/exporters/stats/stackdriver/internal/stackdriver_utils.h"
 #include "opencensus/stats/stats.h"
 
@@ -39,128 +48,544 @@ namespace stats {
 
 namespace {
 
-constexpr char kGoogleStackdriverStatsAddress[] = "monitoring.googleapis.com";
 constexpr char kProjectIdPrefix[] = "projects/";
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "stackdriver_stats";
 // Stackdriver limits a single CreateTimeSeries request to 200 series.
-constexpr int kTimeSeriesBatchSize = 200;
+constexpr int kMaxTimeSeriesBatchSize = 200;
+// The size of the arena block kept across exports.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
+// The maximum number of spooled requests resent by each export, so that the
+// backlog after an outage is drained gradually.
+constexpr size_t kMaxReplayedRequests = 64;
+
+std::vector<std::unique_ptr<google::monitoring::v3::MetricService::Stub>>
+MakeStubs(absl::string_view address,
+          const opencensus::common::GrpcChannelOptions& options) {
+  std::vector<std::unique_ptr<google::monitoring::v3::MetricService::Stub>>
+      stubs;
+  for (const auto& channel :
+       opencensus::common::GetSharedChannels(address, options)) {
+    stubs.push_back(google::monitoring::v3::MetricService::NewStub(channel));
+  }
+  return stubs;
+}
+
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
+}
+
+// Sends CreateTimeSeries requests asynchronously through 'stubs' in turn,
+// keeping at most opts.max_concurrent_rpcs in flight and retrying those that
+// fail with transient errors. Requests that still fail are appended to
+// 'spool', if not null.
+//
+// Thread-compatible.
+class TimeSeriesSender final {
+ public:
+  TimeSeriesSender(
+      const StackdriverOptions& opts,
+      const std::vector<
+          std::unique_ptr<google::monitoring::v3::MetricService::Stub>>& stubs,
+      opencensus::common::DiskSpool* spool)
+      : opts_(opts), stubs_(stubs), spool_(spool) {}
+
+  // Waits for all requests to complete.
+  ~TimeSeriesSender();
+
+  // Starts sending 'request', which must outlive this, first waiting for a
+  // request to complete if the maximum number are in flight.
+  void Send(const google::monitoring::v3::CreateTimeSeriesRequest* request);
+
+  // Waits for all requests to complete.
+  void WaitForAll();
+
+  // Whether any request completed so far failed with a transient error after
+  // retrying.
+  bool transient_failure() const { return transient_failure_; }
+
+ private:
+  struct Rpc {
+    const google::monitoring::v3::CreateTimeSeriesRequest* request;
+    int attempts = 0;
+    // The start of the current attempt.
+    absl::Time start_time;
+    // When backing off before a retry, the time to retry at; otherwise the
+    // request is in cq_.
+    absl::Time retry_at = absl::InfiniteFuture();
+    // A ClientContext may not be reused, so each attempt gets a new one.
+    std::unique_ptr<grpc::ClientContext> context;
+    std::unique_ptr<
+        grpc::ClientAsyncResponseReader<google::protobuf::Empty>>
+        reader;
+    google::protobuf::Empty response;
+    grpc::Status status;
+  };
+
+  void Start(Rpc* rpc);
+  // Starts the retries that are due, and returns the time of the next one.
+  absl::Time StartDueRetries();
+  // Waits for an in-flight request to complete, and either schedules its retry
+  // or releases it, or for a retry to become due and starts it. Other requests
+  // complete while one backs off.
+  void WaitForOne();
+
+  const StackdriverOptions& opts_;
+  const std::vector<
+      std::unique_ptr<google::monitoring::v3::MetricService::Stub>>& stubs_;
+  // The index in stubs_ of the stub for the next attempt.
+  size_t next_stub_ = 0;
+  opencensus::common::DiskSpool* const spool_;
+  grpc::CompletionQueue cq_;
+  // Including requests backing off before a retry.
+  std::vector<std::unique_ptr<Rpc>> in_flight_;
+  // The number of requests in cq_.
+  int num_started_ = 0;
+  bool transient_failure_ = false;
+};
+
+TimeSeriesSender::~TimeSeriesSender() {
+  WaitForAll();
+  cq_.Shutdown();
+  void* tag;
+  bool ok;
+  while (cq_.Next(&tag, &ok)) {
+  }
+}
+
+void TimeSeriesSender::Send(
+    const google::monitoring::v3::CreateTimeSeriesRequest* request) {
+  while (in_flight_.size() >= std::max(1, opts_.max_concurrent_rpcs)) {
+    WaitForOne();
+  }
+  in_flight_.push_back(absl::make_unique<Rpc>());
+  in_flight_.back()->request = request;
+  Start(in_flight_.back().get());
+}
+
+void TimeSeriesSender::WaitForAll() {
+  while (!in_flight_.empty()) {
+    WaitForOne();
+  }
+}
+
+void TimeSeriesSender::Start(Rpc* rpc) {
+  ++rpc->attempts;
+  ++num_started_;
+  rpc->retry_at = absl::InfiniteFuture();
+  OPENCENSUS_PROBE2(export_rpc_begin, kExporterName, rpc);
+  rpc->start_time = absl::Now();
+  rpc->context = absl::make_unique<grpc::ClientContext>();
+  rpc->context->set_deadline(
+      absl::ToChronoTime(absl::Now() + opts_.rpc_deadline));
+  rpc->reader = stubs_[next_stub_]->AsyncCreateTimeSeries(
+      rpc->context.get(), *rpc->request, &cq_);
+  next_stub_ = (next_stub_ + 1) % stubs_.size();
+  rpc->reader->Finish(&rpc->response, &rpc->status, rpc);
+}
+
+absl::Time TimeSeriesSender::StartDueRetries() {
+  const absl::Time now = absl::Now();
+  absl::Time next_retry = absl::InfiniteFuture();
+  for (const auto& rpc : in_flight_) {
+    if (rpc->retry_at <= now) {
+      Start(rpc.get());
+    } else {
+      next_retry = std::min(next_retry, rpc->retry_at);
+    }
+  }
+  return next_retry;
+}
+
+void TimeSeriesSender::WaitForOne() {
+  const absl::Time next_retry = StartDueRetries();
+  if (num_started_ == 0) {
+    // All requests are backing off.
+    absl::SleepFor(next_retry - absl::Now());
+    StartDueRetries();
+    return;
+  }
+  void* tag;
+  bool ok;
+  // InfiniteFuture() converts to time_point::max(), which gRPC treats as no
+  // deadline.
+  switch (cq_.AsyncNext(&tag, &ok, absl::ToChronoTime(next_retry))) {
+    case grpc::CompletionQueue::SHUTDOWN:
+      in_flight_.clear();
+      return;
+    case grpc::CompletionQueue::TIMEOUT:
+      StartDueRetries();
+      return;
+    case grpc::CompletionQueue::GOT_EVENT:
+      break;
+  }
+  --num_started_;
+  Rpc* rpc = static_cast<Rpc*>(tag);
+  OPENCENSUS_PROBE3(export_rpc_end, kExporterName, rpc,
+                    static_cast<int>(rpc->status.error_code()));
+  opencensus::common::RecordSelfMetric(
+      opencensus::common::SelfMetric::kExporterRpcLatency,
+      absl::ToDoubleMilliseconds(absl::Now() - rpc->start_time),
+      kExporterName);
+  const grpc::StatusCode code = rpc->status.error_code();
+  if (ok && (code == grpc::StatusCode::UNAVAILABLE ||
+             code == grpc::StatusCode::RESOURCE_EXHAUSTED) &&
+      rpc->attempts <= opts_.max_retries) {
+    // Clamped so that large max_retries do not overflow the shift.
+    rpc->retry_at =
+        absl::Now() + opts_.retry_initial_backoff *
+                          (int64_t{1} << std::min(rpc->attempts - 1, 30));
+    return;
+  }
+  if (ok && !rpc->status.ok()) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    std::cerr << "CreateTimeSeries request failed: "
+              << opencensus::common::ToString(rpc->status) << "\n";
+    // Invalid requests would fail again, so only those that did not get
+    // through are spooled.
+    if (code == grpc::StatusCode::UNAVAILABLE ||
+        code == grpc::StatusCode::RESOURCE_EXHAUSTED ||
+        code == grpc::StatusCode::DEADLINE_EXCEEDED) {
+      transient_failure_ = true;
+      if (spool_ != nullptr &&
+          !spool_->Append(rpc->request->SerializeAsString())) {
+        std::cerr << "CreateTimeSeries request too large to spool.\n";
+      }
+    }
+  }
+  in_flight_.erase(std::find_if(
+      in_flight_.begin(), in_flight_.end(),
+      [rpc](const std::unique_ptr<Rpc>& p) { return p.get() == rpc; }));
+}
 
 class Handler : public ::opencensus::stats::StatsExporter::Handler {
  public:
   explicit Handler(const StackdriverOptions& opts);
+  // Waits for the descriptor creations in flight.
+  ~Handler() override;
 
   void ExportViewData(
       const std::vector<std::pair<opencensus::stats::ViewDescriptor,
                                   opencensus::stats::ViewData>>& data)
-      LOCKS_EXCLUDED(mu_) override;
+      LOCKS_EXCLUDED(mu_, views_mu_) override;
+
+  void ViewAdded(const opencensus::stats::ViewDescriptor& descriptor)
+      LOCKS_EXCLUDED(views_mu_) override;
 
  private:
-  // Registers 'descriptor' with Stackdriver if no view by that name has been
-  // registered by this, and adds it to registered_descriptors_ if successful.
-  // Returns true if the view has already been registered or registration is
-  // successful, and false if the registration fails or the name has already
-  // been registered with different parameters.
-  bool MaybeRegisterView(const opencensus::stats::ViewDescriptor& descriptor)
-      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // A view known to this exporter, and its metric type, which is computed
+  // once rather than on every export. Entries are never removed, and only
+  // 'created' and 'creating' change once added, so the rest can be read
+  // without holding views_mu_.
+  struct RegisteredView {
+    opencensus::stats::ViewDescriptor descriptor;
+    std::string metric_type;
+    // Set once the metric descriptor has been created or listed.
+    bool created = false;
+    // Set while a CreateMetricDescriptor request is in flight.
+    bool creating = false;
+  };
+
+  // A CreateMetricDescriptor request in flight, which is its own tag on
+  // creation_cq_.
+  struct Creation {
+    std::string view_name;
+    absl::Time start_time;
+    ::grpc::ClientContext context;
+    std::unique_ptr<
+        ::grpc::ClientAsyncResponseReader<google::api::MetricDescriptor>>
+        reader;
+    google::api::MetricDescriptor response;
+    ::grpc::Status status;
+  };
+
+  // Adds 'descriptor' to views_, unless a view by that name is known, and
+  // starts creating its metric descriptor unless it was listed. Returns the
+  // entry for the name.
+  RegisteredView* AddView(const opencensus::stats::ViewDescriptor& descriptor)
+      EXCLUSIVE_LOCKS_REQUIRED(views_mu_);
+  void StartCreation(RegisteredView* view) EXCLUSIVE_LOCKS_REQUIRED(views_mu_);
+  // Handles the creations that have completed, without waiting for others.
+  void PollCreations() LOCKS_EXCLUDED(views_mu_);
+  // Returns the view to export 'descriptor' as, or nullptr if its metric
+  // descriptor has not been created yet (starting to create it again if an
+  // earlier creation failed) or the name is known with different parameters.
+  const RegisteredView* FindExportableView(
+      const opencensus::stats::ViewDescriptor& descriptor)
+      EXCLUSIVE_LOCKS_REQUIRED(views_mu_);
+  // Fills listed_descriptors_ from ListMetricDescriptors requests.
+  void ListMetricDescriptors() EXCLUSIVE_LOCKS_REQUIRED(views_mu_);
 
   const StackdriverOptions opts_;
   const std::string project_id_;
-  const std::unique_ptr<google::monitoring::v3::MetricService::Stub> stub_;
+  // One stub per channel (see StackdriverOptions::channel_options). Metric
+  // descriptors are managed through the first.
+  const std::vector<
+      std::unique_ptr<google::monitoring::v3::MetricService::Stub>>
+      stubs_;
   mutable absl::Mutex mu_;
-  std::unordered_map<std::string, opencensus::stats::ViewDescriptor>
-      registered_descriptors_ GUARDED_BY(mu_);
+  // Holds the requests of an export. It is reset after each export, keeping
+  // its initial block.
+  std::unique_ptr<char[]> arena_block_ GUARDED_BY(mu_);
+  google::protobuf::Arena arena_ GUARDED_BY(mu_);
+  // Null unless opts_.spool_path is set and the spool could be opened.
+  std::unique_ptr<opencensus::common::DiskSpool> spool_ GUARDED_BY(mu_);
+
+  // Guards the views, which ViewAdded() updates while an export may be in
+  // progress.
+  mutable absl::Mutex views_mu_ ACQUIRED_AFTER(mu_);
+  std::unordered_map<std::string, RegisteredView> views_ GUARDED_BY(views_mu_);
+  // The metric descriptors listed at startup, by type.
+  std::unordered_map<std::string, google::api::MetricDescriptor>
+      listed_descriptors_ GUARDED_BY(views_mu_);
+  std::unordered_map<Creation*, std::unique_ptr<Creation>> creations_
+      GUARDED_BY(views_mu_);
+  ::grpc::CompletionQueue creation_cq_;
 };
 
 Handler::Handler(const StackdriverOptions& opts)
     : opts_(opts),
       project_id_(absl::StrCat(kProjectIdPrefix, opts.project_id)),
-      stub_(google::monitoring::v3::MetricService::NewStub(
-          ::grpc::CreateCustomChannel(kGoogleStackdriverStatsAddress,
-                                      ::grpc::GoogleDefaultCredentials(),
-                                      ::opencensus::common::WithUserAgent()))) {
+      stubs_(MakeStubs(opts.address, opts.channel_options)),
+      arena_block_(new char[kArenaInitialBlockSize]),
+      arena_(ArenaOptionsWithBlock(arena_block_.get())) {
+  if (!opts_.spool_path.empty()) {
+    absl::MutexLock l(&mu_);
+    std::string error;
+    spool_ = opencensus::common::DiskSpool::Open(opts_.spool_path,
+                                                 opts_.spool_max_bytes, &error);
+    if (spool_ == nullptr) {
+      std::cerr << "Failed to open spool \"" << opts_.spool_path
+                << "\": " << error << "\n";
+    }
+  }
+  if (opts_.list_metric_descriptors) {
+    absl::MutexLock l(&views_mu_);
+    ListMetricDescriptors();
+  }
+}
+
+Handler::~Handler() {
+  creation_cq_.Shutdown();
+  void* tag;
+  bool ok;
+  while (creation_cq_.Next(&tag, &ok)) {
+  }
+}
+
+void Handler::ViewAdded(const opencensus::stats::ViewDescriptor& descriptor) {
+  absl::MutexLock l(&views_mu_);
+  AddView(descriptor);
 }
 
 void Handler::ExportViewData(
     const std::vector<std::pair<opencensus::stats::ViewDescriptor,
                                 opencensus::stats::ViewData>>& data) {
-  // TODO: refactor to avoid copying the timeseries.
+  PollCreations();
   absl::MutexLock l(&mu_);
-  std::vector<google::monitoring::v3::TimeSeries> time_series;
-  for (const auto& datum : data) {
-    if (!MaybeRegisterView(datum.first)) {
-      continue;
+  const int batch_size =
+      std::max(1, std::min(opts_.max_batch_size, kMaxTimeSeriesBatchSize));
+  // While backing off after requests failed, new requests are spooled
+  // rather than sent.
+  opencensus::common::DiskSpool* const spool = spool_.get();
+  const bool backing_off = spool != nullptr && spool->BackingOff(absl::Now());
+  {
+    TimeSeriesSender sender(opts_, stubs_, spool);
+    int num_sent = 0;
+    const auto send =
+        [spool, backing_off, &sender, &num_sent](
+            const google::monitoring::v3::CreateTimeSeriesRequest* request) {
+          if (!backing_off) {
+            sender.Send(request);
+            ++num_sent;
+          } else if (!spool->Append(request->SerializeAsString())) {
+            std::cerr << "CreateTimeSeries request too large to spool.\n";
+          }
+        };
+    if (!backing_off && spool != nullptr) {
+      // Spooled requests are older, so they go first.
+      for (size_t n = std::min<size_t>(spool->num_records(),
+                                       kMaxReplayedRequests);
+           n > 0; --n) {
+        auto* request = google::protobuf::Arena::CreateMessage<
+            google::monitoring::v3::CreateTimeSeriesRequest>(&arena_);
+        const absl::string_view record = spool->Front();
+        const bool parsed =
+            request->ParseFromArray(record.data(), record.size());
+        // Popped before sending, since a failed send appends to the spool.
+        spool->PopFront();
+        if (parsed) {
+          send(request);
+        }
+      }
+    }
+    google::monitoring::v3::CreateTimeSeriesRequest* request = nullptr;
+    // Time series are converted one view at a time and added to requests,
+    // which are sent as soon as they are full.
+    for (const auto& datum : data) {
+      const RegisteredView* view;
+      {
+        absl::MutexLock views_lock(&views_mu_);
+        view = FindExportableView(datum.first);
+      }
+      if (view == nullptr) {
+        continue;
+      }
+      for (auto* time_series :
+           MakeTimeSeries(datum.first, view->metric_type, datum.second,
+                          opts_.opencensus_task, project_id_, &arena_)) {
+        if (request == nullptr) {
+          request = google::protobuf::Arena::CreateMessage<
+              google::monitoring::v3::CreateTimeSeriesRequest>(&arena_);
+          request->set_name(project_id_);
+        }
+        request->mutable_time_series()->AddAllocated(time_series);
+        if (request->time_series_size() == batch_size) {
+          send(request);
+          request = nullptr;
+        }
+      }
     }
-    const auto view_time_series =
-        MakeTimeSeries(datum.first, datum.second, opts_.opencensus_task);
-    time_series.insert(time_series.end(), view_time_series.begin(),
-                       view_time_series.end());
-  }
-
-  const int num_rpcs =
-      ceil(static_cast<double>(time_series.size()) / kTimeSeriesBatchSize);
-
-  std::vector<grpc::Status> status(num_rpcs);
-  std::vector<grpc::ClientContext> ctx(num_rpcs);
-  // We can safely re-use an empty response--it is never updated.
-  google::protobuf::Empty response;
-  grpc::CompletionQueue cq;
-
-  for (int rpc_index = 0; rpc_index < num_rpcs; ++rpc_index) {
-    auto request = google::monitoring::v3::CreateTimeSeriesRequest();
-    request.set_name(project_id_);
-    const int batch_end = std::min(static_cast<int>(time_series.size()),
-                                   (rpc_index + 1) * kTimeSeriesBatchSize);
-    for (int i = rpc_index * kTimeSeriesBatchSize; i < batch_end; ++i) {
-      *request.add_time_series() = time_series[i];
+    if (request != nullptr) {
+      send(request);
+    }
+    sender.WaitForAll();
+    if (spool != nullptr && num_sent > 0) {
+      if (sender.transient_failure()) {
+        spool->RecordFailure(absl::Now());
+      } else {
+        spool->RecordSuccess();
+      }
     }
-    ctx[rpc_index].set_deadline(
-        absl::ToChronoTime(absl::Now() + opts_.rpc_deadline));
-    auto rpc(stub_->AsyncCreateTimeSeries(&ctx[rpc_index], request, &cq));
-    rpc->Finish(&response, &status[rpc_index], (void*)(uintptr_t)rpc_index);
   }
+  // The sender has waited for all requests to complete.
+  arena_.Reset();
+}
 
-  cq.Shutdown();
+Handler::RegisteredView* Handler::AddView(
+    const opencensus::stats::ViewDescriptor& descriptor) {
+  const auto it = views_.find(descriptor.name());
+  if (it != views_.end()) {
+    return &it->second;
+  }
+  RegisteredView* view = &views_[descriptor.name()];
+  view->descriptor = descriptor;
+  view->metric_type = MakeType(descriptor.name());
+  const auto listed = listed_descriptors_.find(view->metric_type);
+  if (listed != listed_descriptors_.end()) {
+    google::api::MetricDescriptor expected;
+    SetMetricDescriptor(project_id_, descriptor, &expected);
+    if (MetricDescriptorMatches(expected, listed->second)) {
+      view->created = true;
+      return view;
+    }
+  }
+  StartCreation(view);
+  return view;
+}
+
+void Handler::StartCreation(RegisteredView* view) {
+  google::monitoring::v3::CreateMetricDescriptorRequest request;
+  request.set_name(project_id_);
+  SetMetricDescriptor(project_id_, view->descriptor,
+                      request.mutable_metric_descriptor());
+  auto creation = absl::make_unique<Creation>();
+  creation->view_name = view->descriptor.name();
+  creation->start_time = absl::Now();
+  creation->context.set_deadline(
+      absl::ToChronoTime(creation->start_time + opts_.rpc_deadline));
+  creation->reader = stubs_.front()->AsyncCreateMetricDescriptor(
+      &creation->context, request, &creation_cq_);
+  creation->reader->Finish(&creation->response, &creation->status,
+                           creation.get());
+  view->creating = true;
+  Creation* const tag = creation.get();
+  creations_.emplace(tag, std::move(creation));
+}
+
+void Handler::PollCreations() {
   void* tag;
   bool ok;
-  while (cq.Next(&tag, &ok)) {
-    if (ok) {
-      const auto& s = status[(uintptr_t)tag];
-      if (!s.ok()) {
-        std::cerr << "CreateTimeSeries request failed: "
-                  << opencensus::common::ToString(s) << "\n";
-      }
+  while (creation_cq_.AsyncNext(&tag, &ok, std::chrono::system_clock::now()) ==
+         ::grpc::CompletionQueue::GOT_EVENT) {
+    absl::MutexLock l(&views_mu_);
+    const auto it = creations_.find(static_cast<Creation*>(tag));
+    if (it == creations_.end()) {
+      continue;
+    }
+    const Creation& creation = *it->second;
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcLatency,
+        absl::ToDoubleMilliseconds(absl::Now() - creation.start_time),
+        kExporterName);
+    RegisteredView& view = views_.at(creation.view_name);
+    view.creating = false;
+    if (ok && creation.status.ok()) {
+      view.created = true;
+    } else {
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+          kExporterName);
+      std::cerr << "CreateMetricDescriptor request failed: "
+                << opencensus::common::ToString(creation.status) << "\n";
     }
+    creations_.erase(it);
   }
 }
 
-bool Handler::MaybeRegisterView(
+const Handler::RegisteredView* Handler::FindExportableView(
     const opencensus::stats::ViewDescriptor& descriptor) {
-  const auto& it = registered_descriptors_.find(descriptor.name());
-  if (it != registered_descriptors_.end()) {
-    if (it->second != descriptor) {
-      std::cerr << "Not exporting altered view: " << descriptor.DebugString()
-                << "\nAlready registered as: " << it->second.DebugString()
-                << "\n";
-      return false;
+  // Views not added through ViewAdded(), such as callback gauges, are added
+  // on their first export.
+  RegisteredView* view = AddView(descriptor);
+  if (view->descriptor != descriptor) {
+    std::cerr << "Not exporting altered view: " << descriptor.DebugString()
+              << "\nAlready registered as: " << view->descriptor.DebugString()
+              << "\n";
+    return nullptr;
+  }
+  if (!view->created) {
+    if (!view->creating) {
+      StartCreation(view);
     }
-    return true;
+    return nullptr;
   }
+  return view;
+}
 
-  auto request = google::monitoring::v3::CreateMetricDescriptorRequest();
+void Handler::ListMetricDescriptors() {
+  google::monitoring::v3::ListMetricDescriptorsRequest request;
   request.set_name(project_id_);
-  SetMetricDescriptor(project_id_, descriptor,
-                      request.mutable_metric_descriptor());
-  ::grpc::ClientContext context;
-  context.set_deadline(absl::ToChronoTime(absl::Now() + opts_.rpc_deadline));
-  google::api::MetricDescriptor response;
-  ::grpc::Status status =
-      stub_->CreateMetricDescriptor(&context, request, &response);
-  if (!status.ok()) {
-    std::cerr << "CreateMetricDescriptor request failed: "
-              << opencensus::common::ToString(status) << "\n";
-    return false;
-  }
-  registered_descriptors_.emplace_hint(it, descriptor.name(), descriptor);
-  return true;
+  request.set_filter(
+      absl::StrCat("metric.type = starts_with(\"", MakeType(""), "\")"));
+  do {
+    ::grpc::ClientContext context;
+    const absl::Time start_time = absl::Now();
+    context.set_deadline(absl::ToChronoTime(start_time + opts_.rpc_deadline));
+    google::monitoring::v3::ListMetricDescriptorsResponse response;
+    const ::grpc::Status status =
+        stubs_.front()->ListMetricDescriptors(&context, request, &response);
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcLatency,
+        absl::ToDoubleMilliseconds(absl::Now() - start_time), kExporterName);
+    if (!status.ok()) {
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+          kExporterName);
+      std::cerr << "ListMetricDescriptors request failed: "
+                << opencensus::common::ToString(status) << "\n";
+      return;
+    }
+    for (auto& descriptor : *response.mutable_metric_descriptors()) {
+      std::string type = descriptor.type();
+      listed_descriptors_[std::move(type)] = std::move(descriptor);
+    }
+    request.set_page_token(response.next_page_token());
+  } while (!request.page_token().empty());
 }
 
 }  // namespace
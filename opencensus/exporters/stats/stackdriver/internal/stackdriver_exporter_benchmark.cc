@@ -0,0 +1,185 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/common/internal/process_memory.h"
+#include "opencensus/exporters/stats/stackdriver/stackdriver_exporter.h"
+#include "opencensus/exporters/testing/fake_metric_service.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+// Measures the exporter end to end against an in-process fake of Cloud
+// Monitoring: each iteration runs one export of a view with the given number
+// of rows, which returns once every CreateTimeSeries request has completed.
+// Each benchmark also takes the fake's latency in milliseconds, the percentage
+// of requests it fails as unavailable, and its quota in time series per second
+// (0 for none). Requests are not retried, so that each time series is answered
+// for once. Besides throughput, counters report the time series accepted and
+// rejected by the fake, those dropped without being sent (while backing off
+// after failures), and the growth of the heap and resident memory over the
+// run.
+
+namespace opencensus {
+namespace stats {
+
+class StatsExporterTest {
+ public:
+  static constexpr auto& ExportForTesting = StatsExporter::ExportForTesting;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+using ::opencensus::exporters::testing::FakeMetricService;
+using ::opencensus::exporters::testing::FaultInjector;
+using ::opencensus::exporters::testing::FaultOptions;
+using ::opencensus::stats::testing::TestUtils;
+
+// How long a benchmark waits for its view's metric descriptor to be created.
+constexpr absl::Duration kDescriptorTimeout = absl::Seconds(10);
+
+opencensus::stats::MeasureDouble BenchmarkMeasure() {
+  static const opencensus::stats::MeasureDouble measure =
+      opencensus::stats::MeasureDouble::Register(
+          "stackdriver_exporter_benchmark", "", "ms");
+  return measure;
+}
+
+opencensus::tags::TagKey BenchmarkKey() {
+  static const opencensus::tags::TagKey key =
+      opencensus::tags::TagKey::Register("key");
+  return key;
+}
+
+// Starts the fake and registers the exporter with it, once per process.
+FakeMetricService* GetService() {
+  static FakeMetricService* service = []() {
+    FakeMetricService* service = FakeMetricService::Start().release();
+    if (service == nullptr) {
+      std::cerr << "Cannot start the fake metric service.\n";
+      std::abort();
+    }
+    StackdriverOptions options;
+    options.project_id = "benchmark-project";
+    options.opencensus_task = "benchmark-task";
+    options.max_retries = 0;
+    options.address = service->address();
+    options.channel_options.insecure = true;
+    StackdriverExporter::Register(options);
+    return service;
+  }();
+  return service;
+}
+
+// Registers a view with 'num_rows' rows for export and waits for its metric
+// descriptor to be created. Returns false if it was not in time.
+bool RegisterView(FakeMetricService* service,
+                  const opencensus::stats::ViewDescriptor& descriptor,
+                  int num_rows) {
+  const uint64_t created = service->metric_descriptors_created();
+  descriptor.RegisterForExport();
+  std::vector<std::pair<opencensus::tags::TagMap,
+                        std::vector<opencensus::stats::Measurement>>>
+      batch;
+  for (int row = 0; row < num_rows; ++row) {
+    batch.emplace_back(
+        opencensus::tags::TagMap({{BenchmarkKey(), absl::StrCat(row)}}),
+        std::vector<opencensus::stats::Measurement>(
+            {{BenchmarkMeasure(), static_cast<double>(row)}}));
+  }
+  opencensus::stats::RecordBatch(batch);
+  TestUtils::Flush();
+  const absl::Time deadline = absl::Now() + kDescriptorTimeout;
+  while (service->metric_descriptors_created() == created) {
+    if (absl::Now() > deadline) return false;
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  return true;
+}
+
+void BM_Export(benchmark::State& state) {
+  FakeMetricService* service = GetService();
+  const int num_rows = state.range(0);
+  const auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name(absl::StrCat("stackdriver_exporter_benchmark/", num_rows))
+          .set_measure(BenchmarkMeasure().GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum())
+          .add_column(BenchmarkKey());
+  service->faults()->SetOptions(FaultOptions());
+  if (!RegisterView(service, descriptor, num_rows)) {
+    state.SkipWithError("Timed out creating the metric descriptor.");
+    return;
+  }
+  FaultOptions options;
+  options.latency = absl::Milliseconds(state.range(1));
+  options.error_rate = state.range(2) / 100.0;
+  options.max_items_per_second = state.range(3);
+  service->faults()->SetOptions(options);
+  service->faults()->ResetCounts();
+
+  const int64_t heap_before = common::HeapBytesInUse();
+  const int64_t rss_before = common::ResidentMemoryBytes();
+  uint64_t exported = 0;
+  for (auto _ : state) {
+    opencensus::stats::StatsExporterTest::ExportForTesting();
+    exported += num_rows;
+  }
+  const FaultInjector::Counts counts = service->faults()->counts();
+  opencensus::stats::StatsExporter::RemoveView(descriptor.name());
+  state.SetItemsProcessed(exported);
+  state.counters["accepted"] = counts.accepted_items;
+  state.counters["rejected"] = counts.rejected_items;
+  state.counters["dropped"] =
+      exported - counts.accepted_items - counts.rejected_items;
+  state.counters["heap_growth"] = common::HeapBytesInUse() - heap_before;
+  state.counters["rss_growth"] = common::ResidentMemoryBytes() - rss_before;
+}
+BENCHMARK(BM_Export)
+    ->ArgNames({"rows", "latency_ms", "error_pct", "quota"})
+    ->Args({100, 0, 0, 0})
+    ->Args({1000, 0, 0, 0})
+    ->Args({1000, 20, 0, 0})
+    ->Args({1000, 100, 0, 0})
+    ->Args({1000, 0, 10, 0})
+    ->Args({1000, 0, 50, 0})
+    ->Args({1000, 0, 0, 10000})
+    ->Args({1000, 20, 10, 10000})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -14,7 +14,9 @@
 
 #include "opencensus/exporters/stats/stackdriver/internal/stackdriver_utils.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "absl/base/internal/sysinfo.h"
 #include "absl/base/macros.h"
@@ -27,8 +29,12 @@
 #include "google/api/monitored_resource.pb.h"
 #include "google/monitoring/v3/common.pb.h"
 #include "google/monitoring/v3/metric.pb.h"
+#include "google/monitoring/v3/span_context.pb.h"
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/timestamp.pb.h"
 #include "opencensus/stats/stats.h"
+#include "opencensus/trace/span_context.h"
 
 namespace opencensus {
 namespace exporters {
@@ -42,10 +48,6 @@ constexpr char kOpenCensusTaskKey[] = "opencensus_task";
 constexpr char kOpenCensusTaskDescription[] = "OpenCensus task identifier";
 constexpr char kDefaultResourceType[] = "global";
 
-std::string MakeType(absl::string_view view_name) {
-  return absl::StrCat(kCustomMetricDomain, view_name);
-}
-
 // Creates a name in the format described in
 // https://cloud.google.com/monitoring/api/ref_v3/rest/v3/projects.metricDescriptors/create
 std::string MakeName(absl::string_view project_name,
@@ -71,6 +73,7 @@ google::api::MetricDescriptor::ValueType GetValueType(
     const opencensus::stats::ViewDescriptor& descriptor) {
   switch (descriptor.aggregation().type()) {
     case opencensus::stats::Aggregation::Type::kCount:
+    case opencensus::stats::Aggregation::Type::kDistinctCount:
       return google::api::MetricDescriptor::INT64;
     case opencensus::stats::Aggregation::Type::kSum:
     case opencensus::stats::Aggregation::Type::kLastValue:
@@ -81,6 +84,8 @@ google::api::MetricDescriptor::ValueType GetValueType(
           return google::api::MetricDescriptor::INT64;
       }
     case opencensus::stats::Aggregation::Type::kDistribution:
+    case opencensus::stats::Aggregation::Type::kExponentialHistogram:
+    case opencensus::stats::Aggregation::Type::kQuantiles:
       return google::api::MetricDescriptor::DISTRIBUTION;
   }
   ABSL_ASSERT(false && "Bad descriptor type.");
@@ -126,31 +131,130 @@ void SetTypedValue(const opencensus::stats::Distribution& value,
   }
 }
 
+void SetTypedValue(const opencensus::stats::ExponentialHistogram& value,
+                   google::api::MetricDescriptor::ValueType type,
+                   google::monitoring::v3::TypedValue* proto) {
+  ABSL_ASSERT(type == google::api::MetricDescriptor::DISTRIBUTION);
+  auto* distribution_proto = proto->mutable_distribution_value();
+  distribution_proto->set_count(value.count());
+  if (value.count() == 0) {
+    return;
+  }
+  distribution_proto->set_mean(value.sum() / value.count());
+  // The histogram does not track the sum of squared deviation, and Stackdriver
+  // does not support exponential buckets with negative values, so this exports
+  // the populated buckets as explicit buckets, from the most negative.
+  const auto& negative = value.negative_buckets();
+  const auto& positive = value.positive_buckets();
+  auto* buckets =
+      distribution_proto->mutable_bucket_options()->mutable_explicit_buckets();
+  // Stackdriver buckets include their lower bound, as ExponentialHistogram's
+  // positive buckets do; the (small) difference for negative buckets is
+  // ignored. The underflow bucket is always empty.
+  distribution_proto->add_bucket_counts(0);
+  for (int k = negative.counts.size() - 1; k >= 0; --k) {
+    buckets->add_bounds(-value.LowerBound(negative.offset + k + 1));
+    distribution_proto->add_bucket_counts(negative.counts[k]);
+  }
+  buckets->add_bounds(0);
+  distribution_proto->add_bucket_counts(value.zero_count());
+  for (int k = 0; k < positive.counts.size(); ++k) {
+    buckets->add_bounds(value.LowerBound(positive.offset + k));
+    distribution_proto->add_bucket_counts(positive.counts[k]);
+  }
+  if (!positive.counts.empty()) {
+    // Otherwise the zero bucket is the overflow bucket.
+    buckets->add_bounds(
+        value.LowerBound(positive.offset +
+                         static_cast<int>(positive.counts.size())));
+    distribution_proto->add_bucket_counts(0);
+  }
+}
+
+// Adds the exemplars of 'value' to the distribution in *proto, in bucket (and
+// so value) order, as Stackdriver requires.
+void SetExemplars(const opencensus::stats::Distribution& value,
+                  absl::string_view project_name,
+                  google::monitoring::v3::TypedValue* proto) {
+  for (const auto& exemplar : value.exemplars()) {
+    if (!exemplar.span_context.IsValid()) {
+      continue;
+    }
+    auto* exemplar_proto =
+        proto->mutable_distribution_value()->add_exemplars();
+    exemplar_proto->set_value(exemplar.value);
+    SetTimestamp(exemplar.timestamp, exemplar_proto->mutable_timestamp());
+    if (!project_name.empty()) {
+      google::monitoring::v3::SpanContext span_context;
+      span_context.set_span_name(absl::StrCat(
+          project_name, "/traces/", exemplar.span_context.trace_id().ToHex(),
+          "/spans/", exemplar.span_context.span_id().ToHex()));
+      exemplar_proto->add_attachments()->PackFrom(span_context);
+    }
+  }
+}
+
+// Other types have no exemplars.
 template <typename DataValueT>
-std::vector<google::monitoring::v3::TimeSeries> DataToTimeSeries(
+void SetExemplars(const DataValueT& value ABSL_ATTRIBUTE_UNUSED,
+                  absl::string_view project_name ABSL_ATTRIBUTE_UNUSED,
+                  google::monitoring::v3::TypedValue* proto
+                      ABSL_ATTRIBUTE_UNUSED) {}
+
+template <typename DataValueT>
+std::vector<google::monitoring::v3::TimeSeries*> DataToTimeSeries(
     const opencensus::stats::ViewDescriptor& view_descriptor,
     const opencensus::stats::ViewData::DataMap<DataValueT>& data,
-    const google::monitoring::v3::TimeSeries& base_time_series) {
+    const google::monitoring::v3::TimeSeries& base_time_series,
+    absl::string_view project_name, google::protobuf::Arena* arena) {
   const google::api::MetricDescriptor::ValueType type =
       GetValueType(view_descriptor);
-  std::vector<google::monitoring::v3::TimeSeries> vector;
+  std::vector<google::monitoring::v3::TimeSeries*> vector;
+  vector.reserve(data.size());
   for (const auto& row : data) {
-    vector.push_back(base_time_series);
-    auto& time_series = vector.back();
+    auto* time_series = google::protobuf::Arena::CreateMessage<
+        google::monitoring::v3::TimeSeries>(arena);
+    vector.push_back(time_series);
+    *time_series = base_time_series;
     for (int i = 0; i < view_descriptor.columns().size(); ++i) {
-      (*time_series.mutable_metric()
+      (*time_series->mutable_metric()
             ->mutable_labels())[view_descriptor.columns()[i].name()] =
           row.first[i];
     }
     // The point is already created in the base_time_series to set the times.
-    SetTypedValue(row.second, type,
-                  time_series.mutable_points(0)->mutable_value());
+    auto* value = time_series->mutable_points(0)->mutable_value();
+    SetTypedValue(row.second, type, value);
+    SetExemplars(row.second, project_name, value);
   }
   return vector;
 }
 
 }  // namespace
 
+std::string MakeType(absl::string_view view_name) {
+  return absl::StrCat(kCustomMetricDomain, view_name);
+}
+
+bool MetricDescriptorMatches(const google::api::MetricDescriptor& expected,
+                             const google::api::MetricDescriptor& existing) {
+  if (expected.type() != existing.type() ||
+      expected.metric_kind() != existing.metric_kind() ||
+      expected.value_type() != existing.value_type() ||
+      expected.unit() != existing.unit() ||
+      expected.labels_size() != existing.labels_size()) {
+    return false;
+  }
+  std::vector<absl::string_view> expected_keys;
+  std::vector<absl::string_view> existing_keys;
+  for (int i = 0; i < expected.labels_size(); ++i) {
+    expected_keys.push_back(expected.labels(i).key());
+    existing_keys.push_back(existing.labels(i).key());
+  }
+  std::sort(expected_keys.begin(), expected_keys.end());
+  std::sort(existing_keys.begin(), existing_keys.end());
+  return expected_keys == existing_keys;
+}
+
 void SetMetricDescriptor(
     absl::string_view project_name,
     const opencensus::stats::ViewDescriptor& view_descriptor,
@@ -161,9 +265,12 @@ void SetMetricDescriptor(
   for (const auto& tag_key : view_descriptor.columns()) {
     SetLabelDescriptor(tag_key.name(), metric_descriptor->add_labels());
   }
+  const opencensus::stats::Aggregation::Type aggregation_type =
+      view_descriptor.aggregation().type();
   metric_descriptor->set_metric_kind(
-      view_descriptor.aggregation().type() ==
-              opencensus::stats::Aggregation::Type::kLastValue
+      aggregation_type == opencensus::stats::Aggregation::Type::kLastValue ||
+              aggregation_type ==
+                  opencensus::stats::Aggregation::Type::kDistinctCount
           ? google::api::MetricDescriptor::GAUGE
           : google::api::MetricDescriptor::CUMULATIVE);
   metric_descriptor->set_value_type(GetValueType(view_descriptor));
@@ -178,9 +285,33 @@ std::vector<google::monitoring::v3::TimeSeries> MakeTimeSeries(
     const opencensus::stats::ViewDescriptor& view_descriptor,
     const opencensus::stats::ViewData& data,
     absl::string_view opencensus_task) {
+  return MakeTimeSeries(view_descriptor, MakeType(view_descriptor.name()), data,
+                        opencensus_task);
+}
+
+std::vector<google::monitoring::v3::TimeSeries> MakeTimeSeries(
+    const opencensus::stats::ViewDescriptor& view_descriptor,
+    absl::string_view metric_type, const opencensus::stats::ViewData& data,
+    absl::string_view opencensus_task) {
+  std::vector<google::monitoring::v3::TimeSeries> time_series;
+  for (auto* row_time_series :
+       MakeTimeSeries(view_descriptor, metric_type, data, opencensus_task,
+                      /*project_name=*/"", nullptr)) {
+    time_series.emplace_back();
+    time_series.back().Swap(row_time_series);
+    delete row_time_series;
+  }
+  return time_series;
+}
+
+std::vector<google::monitoring::v3::TimeSeries*> MakeTimeSeries(
+    const opencensus::stats::ViewDescriptor& view_descriptor,
+    absl::string_view metric_type, const opencensus::stats::ViewData& data,
+    absl::string_view opencensus_task, absl::string_view project_name,
+    google::protobuf::Arena* arena) {
   // Set values that are common across all the rows.
   auto base_time_series = google::monitoring::v3::TimeSeries();
-  base_time_series.mutable_metric()->set_type(MakeType(view_descriptor.name()));
+  base_time_series.mutable_metric()->set_type(std::string(metric_type));
   base_time_series.mutable_resource()->set_type(kDefaultResourceType);
   auto* interval = base_time_series.add_points()->mutable_interval();
   SetTimestamp(data.start_time(), interval->mutable_start_time());
@@ -191,13 +322,17 @@ std::vector<google::monitoring::v3::TimeSeries> MakeTimeSeries(
   switch (data.type()) {
     case opencensus::stats::ViewData::Type::kDouble:
       return DataToTimeSeries(view_descriptor, data.double_data(),
-                              base_time_series);
+                              base_time_series, project_name, arena);
     case opencensus::stats::ViewData::Type::kInt64:
       return DataToTimeSeries(view_descriptor, data.int_data(),
-                              base_time_series);
+                              base_time_series, project_name, arena);
     case opencensus::stats::ViewData::Type::kDistribution:
       return DataToTimeSeries(view_descriptor, data.distribution_data(),
-                              base_time_series);
+                              base_time_series, project_name, arena);
+    case opencensus::stats::ViewData::Type::kExponentialHistogram:
+      return DataToTimeSeries(view_descriptor,
+                              data.exponential_histogram_data(),
+                              base_time_series, project_name, arena);
   }
   ABSL_ASSERT(false && "Bad ViewData.type().");
   return {};
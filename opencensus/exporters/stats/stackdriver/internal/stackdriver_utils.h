@@ -15,11 +15,13 @@
 #ifndef OPENCENSUS_EXPORTERS_STATS_INTERNAL_STACKDRIVER_UTILS_H_
 #define OPENCENSUS_EXPORTERS_STATS_INTERNAL_STACKDRIVER_UTILS_H_
 
+#include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
 #include "google/api/metric.pb.h"
 #include "google/monitoring/v3/metric.pb.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/timestamp.pb.h"
 #include "opencensus/stats/stats.h"
 
@@ -34,11 +36,37 @@ void SetMetricDescriptor(
     const opencensus::stats::ViewDescriptor& view_descriptor,
     google::api::MetricDescriptor* metric_descriptor);
 
+// Returns the Stackdriver metric type of the view named 'view_name'.
+std::string MakeType(absl::string_view view_name);
+
+// Returns true if 'existing' (e.g. as listed by Stackdriver) describes the
+// same metric as 'expected' (as set by SetMetricDescriptor()): the same type,
+// kind, value type, unit, and label keys, in any order. Descriptions are not
+// compared.
+bool MetricDescriptorMatches(const google::api::MetricDescriptor& expected,
+                             const google::api::MetricDescriptor& existing);
+
 // Converts each row of 'data' into TimeSeries.
 std::vector<google::monitoring::v3::TimeSeries> MakeTimeSeries(
     const opencensus::stats::ViewDescriptor& view_descriptor,
     const opencensus::stats::ViewData& data, absl::string_view opencensus_task);
 
+// As above, with the view's precomputed MakeType(view_descriptor.name()).
+std::vector<google::monitoring::v3::TimeSeries> MakeTimeSeries(
+    const opencensus::stats::ViewDescriptor& view_descriptor,
+    absl::string_view metric_type, const opencensus::stats::ViewData& data,
+    absl::string_view opencensus_task);
+
+// As above, allocating each TimeSeries on 'arena'. If 'arena' is null, the
+// caller takes ownership of the TimeSeries. The exemplars of Distribution
+// buckets carry the names of their Spans in 'project_name' (in the format
+// "projects/project_id"), and are exported without them if it is empty.
+std::vector<google::monitoring::v3::TimeSeries*> MakeTimeSeries(
+    const opencensus::stats::ViewDescriptor& view_descriptor,
+    absl::string_view metric_type, const opencensus::stats::ViewData& data,
+    absl::string_view opencensus_task, absl::string_view project_name,
+    google::protobuf::Arena* arena);
+
 void SetTimestamp(absl::Time time, google::protobuf::Timestamp* proto);
 
 }  // namespace stats
@@ -0,0 +1,208 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "google/monitoring/v3/metric.pb.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/exporters/stats/stackdriver/internal/stackdriver_utils.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+// Measures converting view data to TimeSeries and serializing them, without
+// any network I/O, against encoding it with ViewDataEncoder. Each benchmark
+// takes the number of rows and tag keys of the view, whether it is a
+// distribution (with 20 buckets) or a sum, and whether the TimeSeries are
+// allocated on an arena as the exporter does. The "bytes_per_row" counter
+// compares the encoded sizes.
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+using ::opencensus::stats::testing::TestUtils;
+
+opencensus::stats::MeasureDouble BenchmarkMeasure() {
+  static const opencensus::stats::MeasureDouble measure =
+      opencensus::stats::MeasureDouble::Register("stackdriver_benchmark", "",
+                                                 "ms");
+  return measure;
+}
+
+// Returns the descriptor of a view with the given shape.
+opencensus::stats::ViewDescriptor MakeDescriptor(int num_rows, int num_keys,
+                                                 bool distribution) {
+  auto descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name(absl::StrCat("stackdriver_benchmark/", num_rows, "/",
+                                 num_keys, "/", distribution))
+          .set_measure(BenchmarkMeasure().GetDescriptor().name())
+          .set_aggregation(
+              distribution
+                  ? opencensus::stats::Aggregation::Distribution(
+                        opencensus::stats::BucketBoundaries::Exponential(
+                            20, 1, 2))
+                  : opencensus::stats::Aggregation::Sum())
+          .set_description("A view for benchmarking.");
+  for (int i = 0; i < num_keys; ++i) {
+    descriptor.add_column(
+        opencensus::tags::TagKey::Register(absl::StrCat("key", i)));
+  }
+  return descriptor;
+}
+
+// Records a value into every 'step'th of 'num_rows' rows of 'descriptor''s
+// view.
+void RecordRows(const opencensus::stats::ViewDescriptor& descriptor,
+                int num_rows, int step) {
+  std::vector<std::pair<opencensus::tags::TagMap,
+                        std::vector<opencensus::stats::Measurement>>>
+      batch;
+  for (int row = 0; row < num_rows; row += step) {
+    std::vector<std::pair<opencensus::tags::TagKey, std::string>> tags;
+    for (const auto& key : descriptor.columns()) {
+      tags.emplace_back(key, absl::StrCat("value", row));
+    }
+    batch.emplace_back(
+        opencensus::tags::TagMap(std::move(tags)),
+        std::vector<opencensus::stats::Measurement>(
+            {{BenchmarkMeasure(), static_cast<double>(row % 1000)}}));
+  }
+  opencensus::stats::RecordBatch(batch);
+  TestUtils::Flush();
+}
+
+// Records into a view with the given shape and returns its data.
+std::pair<opencensus::stats::ViewDescriptor, opencensus::stats::ViewData>
+MakeViewData(int num_rows, int num_keys, bool distribution) {
+  const auto descriptor = MakeDescriptor(num_rows, num_keys, distribution);
+  opencensus::stats::View view(descriptor);
+  RecordRows(descriptor, num_rows, 1);
+  return {descriptor, view.GetData()};
+}
+
+void BM_MakeTimeSeries(benchmark::State& state) {
+  const auto data =
+      MakeViewData(state.range(0), state.range(1), state.range(2) != 0);
+  const bool use_arena = state.range(3) != 0;
+  const std::string metric_type = MakeType(data.first.name());
+  std::string serialized;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    const std::vector<google::monitoring::v3::TimeSeries*> time_series =
+        MakeTimeSeries(data.first, metric_type, data.second, "benchmark-task",
+                       "projects/benchmark", use_arena ? &arena : nullptr);
+    for (const auto* series : time_series) {
+      series->SerializeToString(&serialized);
+      benchmark::DoNotOptimize(serialized.data());
+      bytes += serialized.size();
+      if (!use_arena) delete series;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(bytes);
+  state.counters["bytes_per_row"] =
+      static_cast<double>(bytes) / (state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MakeTimeSeries)
+    ->ArgNames({"rows", "keys", "distribution", "arena"})
+    ->ArgsProduct({{1, 100, 10000}, {1, 4}, {0, 1}, {0, 1}});
+
+// Encoding the view's data as a full frame.
+void BM_EncodeViewData(benchmark::State& state) {
+  const auto data =
+      MakeViewData(state.range(0), state.range(1), state.range(2) != 0);
+  opencensus::stats::ViewDataEncoder encoder(data.first);
+  std::string encoded;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    encoded.clear();
+    encoder.EncodeFull(data.second, &encoded);
+    benchmark::DoNotOptimize(encoded.data());
+    bytes += encoded.size();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(bytes);
+  state.counters["bytes_per_row"] =
+      static_cast<double>(bytes) / (state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeViewData)
+    ->ArgNames({"rows", "keys", "distribution"})
+    ->ArgsProduct({{1, 100, 10000}, {1, 4}, {0, 1}});
+
+// Encoding a delta frame against a snapshot in which one row in 100 differs.
+void BM_EncodeViewDataDelta(benchmark::State& state) {
+  const auto descriptor =
+      MakeDescriptor(state.range(0), state.range(1), state.range(2) != 0);
+  opencensus::stats::View view(descriptor);
+  RecordRows(descriptor, state.range(0), 1);
+  const opencensus::stats::ViewData previous = view.GetData();
+  RecordRows(descriptor, state.range(0), 100);
+  const opencensus::stats::ViewData current = view.GetData();
+  std::string encoded;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    opencensus::stats::ViewDataEncoder encoder(descriptor);
+    encoder.Encode(previous, &encoded);
+    encoded.clear();
+    state.ResumeTiming();
+    encoder.Encode(current, &encoded);
+    benchmark::DoNotOptimize(encoded.data());
+    bytes += encoded.size();
+    encoded.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(bytes);
+  state.counters["bytes_per_row"] =
+      static_cast<double>(bytes) / (state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeViewDataDelta)
+    ->ArgNames({"rows", "keys", "distribution"})
+    ->ArgsProduct({{100, 10000}, {1, 4}, {0, 1}});
+
+// Decoding a full frame of the view's data.
+void BM_DecodeViewData(benchmark::State& state) {
+  const auto data =
+      MakeViewData(state.range(0), state.range(1), state.range(2) != 0);
+  opencensus::stats::ViewDataEncoder encoder(data.first);
+  std::string encoded;
+  encoder.EncodeFull(data.second, &encoded);
+  for (auto _ : state) {
+    opencensus::stats::ViewDataDecoder decoder(data.first);
+    const bool ok = decoder.Decode(encoded);
+    benchmark::DoNotOptimize(ok);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_DecodeViewData)
+    ->ArgNames({"rows", "keys", "distribution"})
+    ->ArgsProduct({{1, 100, 10000}, {1, 4}, {0, 1}});
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
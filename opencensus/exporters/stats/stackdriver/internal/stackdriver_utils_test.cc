@@ -24,11 +24,16 @@
 #include "google/api/metric.pb.h"
 #include "google/api/monitored_resource.pb.h"
 #include "google/monitoring/v3/common.pb.h"
+#include "google/monitoring/v3/span_context.pb.h"
 #include "google/protobuf/timestamp.pb.h"
 #include "gtest/gtest.h"
 #include "opencensus/exporters/stats/stackdriver/internal/time_series_matcher.h"
 #include "opencensus/stats/stats.h"
 #include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opencensus/trace/trace_options.h"
 
 using opencensus::stats::testing::TestUtils;
 
@@ -172,6 +177,33 @@ TEST(StackdriverUtilsTest, SetMetricDescriptorDescription) {
   EXPECT_EQ(description, metric_descriptor.description());
 }
 
+TEST(StackdriverUtilsTest, MetricDescriptorMatches) {
+  const auto tag_key_1 = opencensus::tags::TagKey::Register("foo");
+  const auto tag_key_2 = opencensus::tags::TagKey::Register("bar");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("example.com/matched_metric")
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .add_column(tag_key_1)
+          .add_column(tag_key_2);
+  google::api::MetricDescriptor expected;
+  SetMetricDescriptor("projects/test-id", view_descriptor, &expected);
+
+  google::api::MetricDescriptor existing = expected;
+  existing.set_description("edited");
+  existing.mutable_labels()->SwapElements(1, 2);
+  EXPECT_TRUE(MetricDescriptorMatches(expected, existing));
+
+  existing.set_unit("By");
+  EXPECT_FALSE(MetricDescriptorMatches(expected, existing));
+  existing = expected;
+  existing.mutable_labels()->RemoveLast();
+  EXPECT_FALSE(MetricDescriptorMatches(expected, existing));
+  existing = expected;
+  existing.set_metric_kind(google::api::MetricDescriptor::GAUGE);
+  EXPECT_FALSE(MetricDescriptorMatches(expected, existing));
+}
+
 TEST(StackdriverUtilsTest, MakeTimeSeriesSumDouble) {
   const auto measure =
       opencensus::stats::MeasureDouble::Register("measure_sum_double", "", "");
@@ -350,6 +382,51 @@ TEST(StackdriverUtilsTest, MakeTimeSeriesDistributionDouble) {
                                                   distribution2)));
 }
 
+TEST(StackdriverUtilsTest, MakeTimeSeriesDistributionExemplars) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "measure_distribution_exemplars", "", "");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("test_exemplars")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({0})));
+  const uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8,
+                              9, 10, 11, 12, 13, 14, 15, 16};
+  const uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t sampled[] = {1};
+  const opencensus::trace::SpanContext span_context(
+      (opencensus::trace::TraceId(trace_id)),
+      (opencensus::trace::SpanId(span_id)),
+      (opencensus::trace::TraceOptions(sampled)));
+  const opencensus::stats::ViewData data =
+      TestUtils::MakeViewDataWithExemplars(
+          view_descriptor, {{{}, 3.0}, {{}, -1.0}}, span_context,
+          absl::FromUnixSeconds(100));
+  const std::vector<google::monitoring::v3::TimeSeries*> time_series =
+      MakeTimeSeries(view_descriptor, "test_type", data, "test_task",
+                     "projects/test-id", nullptr);
+  ASSERT_EQ(1, time_series.size());
+  const auto& distribution =
+      time_series[0]->points(0).value().distribution_value();
+  // One exemplar per populated bucket, in bucket order.
+  ASSERT_EQ(2, distribution.exemplars_size());
+  EXPECT_EQ(-1, distribution.exemplars(0).value());
+  EXPECT_EQ(3, distribution.exemplars(1).value());
+  EXPECT_EQ(100, distribution.exemplars(1).timestamp().seconds());
+  ASSERT_EQ(1, distribution.exemplars(1).attachments_size());
+  google::monitoring::v3::SpanContext span_context_proto;
+  ASSERT_TRUE(distribution.exemplars(1).attachments(0).UnpackTo(
+      &span_context_proto));
+  EXPECT_EQ(
+      "projects/test-id/traces/0102030405060708090a0b0c0d0e0f10/spans/"
+      "0102030405060708",
+      span_context_proto.span_name());
+  for (auto* series : time_series) {
+    delete series;
+  }
+}
+
 }  // namespace
 }  // namespace stats
 }  // namespace exporters
@@ -20,6 +20,7 @@
 #include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "opencensus/common/internal/grpc/channel_options.h"
 
 namespace opencensus {
 namespace exporters {
@@ -36,10 +37,52 @@ struct StackdriverOptions {
 
   // The RPC deadline to use when exporting to Stackdriver.
   absl::Duration rpc_deadline = absl::Seconds(5);
+
+  // The maximum number of time series sent in each CreateTimeSeries request.
+  // Stackdriver accepts at most 200.
+  int max_batch_size = 200;
+
+  // The maximum number of CreateTimeSeries requests in flight at once. Time
+  // series are converted as earlier requests complete, so this also bounds
+  // the memory used by an export.
+  int max_concurrent_rpcs = 4;
+
+  // The number of times a request failing with UNAVAILABLE or
+  // RESOURCE_EXHAUSTED is retried, waiting retry_initial_backoff before the
+  // first retry and doubling the wait for each subsequent one.
+  int max_retries = 2;
+  absl::Duration retry_initial_backoff = absl::Milliseconds(500);
+
+  // If not empty, requests that still fail with UNAVAILABLE,
+  // RESOURCE_EXHAUSTED, or DEADLINE_EXCEEDED after retrying (or that are made
+  // while backing off after such a failure) are kept in a memory-mapped file
+  // at this path, holding at most spool_max_bytes, and resent by later
+  // exports. Spooled requests survive restarts.
+  std::string spool_path;
+  size_t spool_max_bytes = 64 << 20;
+
+  // If true, Register() lists the metric descriptors this exporter creates in
+  // the project (waiting up to rpc_deadline for each page), and views whose
+  // descriptor is listed unchanged are exported without creating it again,
+  // so that restarts do not re-create every descriptor.
+  bool list_metric_descriptors = false;
+
+  // The address of the API. Other addresses are for testing, e.g. against the
+  // fakes in opencensus/exporters/testing with channel_options.insecure set.
+  std::string address = "monitoring.googleapis.com";
+
+  // Compression, keepalive, message size and connection count of the gRPC
+  // channels, which are shared with other exporters to the same address that
+  // use the same options.
+  opencensus::common::GrpcChannelOptions channel_options;
 };
 
 // Exports stats for registered views (see opencensus/stats/stats_exporter.h) to
-// Stackdriver. StackdriverExporter is thread-safe.
+// Stackdriver. The metric descriptor of each view is created asynchronously
+// when the view is registered for export (or when the exporter is, for views
+// registered before it), with all creations in flight at once; a view is not
+// exported until its descriptor has been created, and creations that failed
+// are retried on each export. StackdriverExporter is thread-safe.
 class StackdriverExporter {
  public:
   // Registers the exporter.
@@ -0,0 +1,235 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/statsd/statsd_exporter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/stats/statsd/internal/statsd_writer.h"
+#include "opencensus/stats/stats.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "statsd";
+// Packets sent per sendmmsg() call.
+constexpr size_t kMaxBatch = 64;
+
+// Resolves 'address' (see StatsdOptions) into *addr. Returns false, with a
+// message in *error, if it is invalid.
+bool ResolveAddress(absl::string_view address, sockaddr_storage* addr,
+                    socklen_t* addr_len, std::string* error) {
+  memset(addr, 0, sizeof(*addr));
+  if (absl::ConsumePrefix(&address, "unix:")) {
+    sockaddr_un* un = reinterpret_cast<sockaddr_un*>(addr);
+    if (address.empty() || address.size() >= sizeof(un->sun_path)) {
+      *error = "invalid socket path";
+      return false;
+    }
+    un->sun_family = AF_UNIX;
+    memcpy(un->sun_path, address.data(), address.size());
+    *addr_len = offsetof(sockaddr_un, sun_path) + address.size() + 1;
+    return true;
+  }
+  const size_t colon = address.rfind(':');
+  if (colon == absl::string_view::npos) {
+    *error = "missing port";
+    return false;
+  }
+  std::string host(address.substr(0, colon));
+  const std::string port(address.substr(colon + 1));
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+  addrinfo* result = nullptr;
+  const int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+  if (status != 0) {
+    *error = gai_strerror(status);
+    return false;
+  }
+  memcpy(addr, result->ai_addr, result->ai_addrlen);
+  *addr_len = result->ai_addrlen;
+  freeaddrinfo(result);
+  return true;
+}
+
+class Handler : public ::opencensus::stats::StatsExporter::Handler {
+ public:
+  explicit Handler(const StatsdOptions& opts);
+  ~Handler() override;
+
+  void ExportViewData(
+      const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                  opencensus::stats::ViewData>>& data) override;
+
+  bool ExportChangedRowsOnly() const override { return true; }
+  absl::Duration ExportInterval() const override {
+    return opts_.export_interval;
+  }
+
+ private:
+  // Sends the writer's packets. Returns the number dropped.
+  size_t SendPackets(std::string* error);
+
+  // Exports are serialized per handler, so the members need no locking.
+  const StatsdOptions opts_;
+  StatsdWriter writer_;
+  int fd_ = -1;
+  sockaddr_storage addr_;
+  socklen_t addr_len_ = 0;
+  std::string address_error_;
+  int64_t dropped_exports_ = 0;
+#ifdef __linux__
+  // Preallocated per-packet headers for sendmmsg().
+  std::vector<mmsghdr> messages_;
+  std::vector<iovec> iovecs_;
+#endif
+};
+
+Handler::Handler(const StatsdOptions& opts)
+    : opts_(opts), writer_(opts.prefix, opts.dogstatsd, opts.max_packet_size) {
+  if (!ResolveAddress(opts_.address, &addr_, &addr_len_, &address_error_)) {
+    return;
+  }
+  fd_ = socket(addr_.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    address_error_ = std::string("socket() failed: ") + strerror(errno);
+    return;
+  }
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+#ifdef __linux__
+  messages_.resize(kMaxBatch);
+  iovecs_.resize(kMaxBatch);
+#endif
+}
+
+Handler::~Handler() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void Handler::ExportViewData(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data) {
+  writer_.Write(data);
+  if (writer_.num_packets() == 0) {
+    return;
+  }
+  std::string error = address_error_;
+  const size_t dropped =
+      fd_ < 0 ? writer_.num_packets() : SendPackets(&error);
+  if (dropped > 0) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    // Only report the first of a run of drops, e.g. while the daemon is down.
+    if (dropped_exports_++ == 0) {
+      std::cerr << "Dropped " << dropped << " of "
+                << writer_.num_packets() << " StatsD packets for "
+                << opts_.address << ": " << error << "\n";
+    }
+  } else {
+    dropped_exports_ = 0;
+  }
+}
+
+size_t Handler::SendPackets(std::string* error) {
+  const size_t num_packets = writer_.num_packets();
+  size_t sent = 0;
+  size_t dropped = 0;
+  while (sent + dropped < num_packets) {
+    const size_t next = sent + dropped;
+#ifdef __linux__
+    const size_t batch = std::min(kMaxBatch, num_packets - next);
+    for (size_t i = 0; i < batch; ++i) {
+      const absl::string_view packet = writer_.packet(next + i);
+      iovecs_[i].iov_base = const_cast<char*>(packet.data());
+      iovecs_[i].iov_len = packet.size();
+      memset(&messages_[i], 0, sizeof(messages_[i]));
+      messages_[i].msg_hdr.msg_name = &addr_;
+      messages_[i].msg_hdr.msg_namelen = addr_len_;
+      messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+      messages_[i].msg_hdr.msg_iovlen = 1;
+    }
+    int result;
+    do {
+      result = sendmmsg(fd_, messages_.data(), batch,
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (result < 0 && errno == EINTR);
+#else
+    const absl::string_view packet = writer_.packet(next);
+    ssize_t result;
+    do {
+      result = sendto(fd_, packet.data(), packet.size(), MSG_DONTWAIT,
+                      reinterpret_cast<const sockaddr*>(&addr_), addr_len_);
+    } while (result < 0 && errno == EINTR);
+    if (result >= 0) result = 1;
+#endif
+    if (result < 0) {
+      const int send_errno = errno;
+      *error = std::string("send failed: ") + strerror(send_errno);
+      // Only a packet that is too large fails alone; otherwise (e.g. when
+      // the socket buffer is full) drop the rest of the export.
+      if (send_errno != EMSGSIZE) {
+        dropped = num_packets - sent;
+        break;
+      }
+      ++dropped;
+      continue;
+    }
+    sent += result;
+  }
+  return dropped;
+}
+
+}  // namespace
+
+// static
+void StatsdExporter::Register(const StatsdOptions& opts) {
+  opencensus::stats::StatsExporter::RegisterPushHandler(
+      absl::make_unique<Handler>(opts));
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
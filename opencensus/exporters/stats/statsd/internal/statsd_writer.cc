@@ -0,0 +1,229 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/statsd/internal/statsd_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/double_format.h"
+#include "opencensus/stats/stats.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+namespace {
+
+// Appends 'value', replacing the characters that delimit the fields of a
+// line (and, if 'dot', '.', which separates the components of a plain StatsD
+// name) with underscores.
+void AppendSanitized(absl::string_view value, bool dot, std::string* output) {
+  for (const char c : value) {
+    switch (c) {
+      case ':':
+      case '|':
+      case '@':
+      case '#':
+      case ',':
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        output->push_back('_');
+        break;
+      case '.':
+        output->push_back(dot ? '_' : '.');
+        break;
+      default:
+        output->push_back(c);
+    }
+  }
+}
+
+}  // namespace
+
+StatsdWriter::StatsdWriter(absl::string_view prefix, bool dogstatsd,
+                           size_t max_packet_size)
+    : prefix_(prefix),
+      dogstatsd_(dogstatsd),
+      max_packet_size_(max_packet_size) {
+  buffer_.reserve(max_packet_size_);
+}
+
+void StatsdWriter::Write(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data) {
+  buffer_.clear();
+  packet_ends_.clear();
+  for (const auto& view : data) {
+    const opencensus::stats::ViewData& view_data = view.second;
+    ViewState& state = views_[view.first.name()];
+    if (state.start_time != view_data.start_time()) {
+      state.start_time = view_data.start_time();
+      state.rows.clear();
+    }
+    switch (view_data.type()) {
+      case opencensus::stats::ViewData::Type::kDouble:
+        WriteRows(view.first, view_data.double_data(), &state);
+        break;
+      case opencensus::stats::ViewData::Type::kInt64:
+        WriteRows(view.first, view_data.int_data(), &state);
+        break;
+      case opencensus::stats::ViewData::Type::kDistribution:
+        WriteRows(view.first, view_data.distribution_data(), &state);
+        break;
+      case opencensus::stats::ViewData::Type::kExponentialHistogram:
+        WriteRows(view.first, view_data.exponential_histogram_data(), &state);
+        break;
+    }
+  }
+  const size_t packet_start = packet_ends_.empty() ? 0 : packet_ends_.back();
+  if (buffer_.size() > packet_start) {
+    packet_ends_.push_back(buffer_.size());
+  }
+}
+
+template <typename T>
+void StatsdWriter::WriteRows(
+    const opencensus::stats::ViewDescriptor& descriptor,
+    const opencensus::stats::ViewData::DataMap<T>& rows, ViewState* state) {
+  std::string key;
+  for (const auto& row : rows) {
+    name_ = prefix_;
+    AppendSanitized(descriptor.name(), false, &name_);
+    tags_.clear();
+    key.clear();
+    for (size_t i = 0; i < row.first.size(); ++i) {
+      if (i > 0) key.push_back('\0');
+      key.append(row.first[i]);
+      if (dogstatsd_) {
+        tags_.append(i == 0 ? "|#" : ",");
+        AppendSanitized(descriptor.columns()[i].name(), false, &tags_);
+        tags_.push_back(':');
+        AppendSanitized(row.first[i], false, &tags_);
+      } else {
+        name_.push_back('.');
+        AppendSanitized(row.first[i], true, &name_);
+      }
+    }
+    WriteRow(name_, row.second, descriptor.aggregation(), &state->rows[key]);
+  }
+}
+
+void StatsdWriter::WriteRow(absl::string_view name, double value,
+                            const opencensus::stats::Aggregation& aggregation,
+                            LastValues* last) {
+  // StatsD has no representation of NaN or infinities. Such rows are skipped,
+  // keeping the last counter value so that later deltas are unaffected.
+  if (!std::isfinite(value)) return;
+  if (aggregation.type() == opencensus::stats::Aggregation::Type::kLastValue ||
+      aggregation.type() ==
+          opencensus::stats::Aggregation::Type::kDistinctCount) {
+    AddLine(name, "", value, "g");
+    return;
+  }
+  // A value below the last one means the row was reset.
+  const double delta = value >= last->count ? value - last->count : value;
+  last->count = value;
+  if (delta != 0) {
+    AddLine(name, "", delta, "c");
+  }
+}
+
+void StatsdWriter::WriteRow(absl::string_view name, int64_t value,
+                            const opencensus::stats::Aggregation& aggregation,
+                            LastValues* last) {
+  WriteRow(name, static_cast<double>(value), aggregation, last);
+}
+
+void StatsdWriter::WriteRow(absl::string_view name,
+                            const opencensus::stats::Distribution& value,
+                            const opencensus::stats::Aggregation& aggregation
+                                ABSL_ATTRIBUTE_UNUSED,
+                            LastValues* last) {
+  WriteHistogram(name, value.count(), value.count() * value.mean(), last);
+}
+
+void StatsdWriter::WriteRow(
+    absl::string_view name,
+    const opencensus::stats::ExponentialHistogram& value,
+    const opencensus::stats::Aggregation& aggregation, LastValues* last) {
+  if (aggregation.type() ==
+      opencensus::stats::Aggregation::Type::kQuantiles) {
+    std::string suffix;
+    for (const double q : aggregation.quantiles()) {
+      suffix = ".p";
+      opencensus::common::AppendRoundTripDouble(q * 100, &suffix);
+      // Keep the quantile a single name component.
+      for (size_t i = 2; i < suffix.size(); ++i) {
+        if (suffix[i] == '.') suffix[i] = '_';
+      }
+      AddLine(name, suffix, value.Quantile(q), "g");
+    }
+  }
+  WriteHistogram(name, value.count(), value.sum(), last);
+}
+
+void StatsdWriter::WriteHistogram(absl::string_view name, double count,
+                                  double sum, LastValues* last) {
+  // As for counters, a row whose sum is not finite is skipped.
+  if (!std::isfinite(sum)) return;
+  // A count below the last one means the row was reset.
+  const bool reset = count < last->count;
+  const double count_delta = reset ? count : count - last->count;
+  const double sum_delta = reset ? sum : sum - last->sum;
+  last->count = count;
+  last->sum = sum;
+  if (count_delta != 0) {
+    AddLine(name, ".count", count_delta, "c");
+    AddLine(name, ".sum", sum_delta, "c");
+  }
+}
+
+void StatsdWriter::AddLine(absl::string_view name, absl::string_view suffix,
+                           double value, absl::string_view type) {
+  // StatsD has no representation of NaN or infinities (e.g. quantiles of an
+  // empty histogram).
+  if (!std::isfinite(value)) return;
+  line_.assign(name.data(), name.size());
+  line_.append(suffix.data(), suffix.size());
+  line_.push_back(':');
+  opencensus::common::AppendRoundTripDouble(value, &line_);
+  line_.push_back('|');
+  line_.append(type.data(), type.size());
+  line_.append(tags_);
+
+  const size_t packet_start = packet_ends_.empty() ? 0 : packet_ends_.back();
+  const size_t packet_size = buffer_.size() - packet_start;
+  if (packet_size > 0) {
+    if (packet_size + 1 + line_.size() > max_packet_size_) {
+      packet_ends_.push_back(buffer_.size());
+    } else {
+      buffer_.push_back('\n');
+    }
+  }
+  // A line longer than max_packet_size_ is sent in a packet of its own.
+  buffer_.append(line_);
+}
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
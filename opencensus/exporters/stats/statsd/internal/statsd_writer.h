@@ -0,0 +1,116 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_STATSD_INTERNAL_STATSD_WRITER_H_
+#define OPENCENSUS_EXPORTERS_STATS_STATSD_INTERNAL_STATSD_WRITER_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/stats.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+// StatsdWriter converts exports of view data into StatsD lines, as described
+// in statsd_exporter.h, packed into packets. Counters are sent as the change
+// since the previous Write(), so the writer keeps the last value of each
+// counter row; a view whose start time changes (i.e. that was reset) starts
+// over from zero.
+//
+// StatsdWriter is thread-compatible.
+class StatsdWriter final {
+ public:
+  StatsdWriter(absl::string_view prefix, bool dogstatsd,
+               size_t max_packet_size);
+
+  // Replaces the packets with the lines for 'data'. Rows whose counters have
+  // not changed are omitted.
+  void Write(const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                         opencensus::stats::ViewData>>& data);
+
+  size_t num_packets() const { return packet_ends_.size(); }
+  absl::string_view packet(size_t i) const {
+    const size_t start = i == 0 ? 0 : packet_ends_[i - 1];
+    return absl::string_view(buffer_.data() + start, packet_ends_[i] - start);
+  }
+
+ private:
+  // The last exported counter values of a row: the value of a Count or Sum
+  // view, or the count and sum of a histogram.
+  struct LastValues {
+    double count = 0;
+    double sum = 0;
+  };
+  struct ViewState {
+    absl::Time start_time;
+    // Keyed by the row's tag values, joined with '\0'.
+    std::unordered_map<std::string, LastValues> rows;
+  };
+
+  template <typename T>
+  void WriteRows(const opencensus::stats::ViewDescriptor& descriptor,
+                 const opencensus::stats::ViewData::DataMap<T>& rows,
+                 ViewState* state);
+  void WriteRow(absl::string_view name, double value,
+                const opencensus::stats::Aggregation& aggregation,
+                LastValues* last);
+  void WriteRow(absl::string_view name, int64_t value,
+                const opencensus::stats::Aggregation& aggregation,
+                LastValues* last);
+  void WriteRow(absl::string_view name,
+                const opencensus::stats::Distribution& value,
+                const opencensus::stats::Aggregation& aggregation,
+                LastValues* last);
+  void WriteRow(absl::string_view name,
+                const opencensus::stats::ExponentialHistogram& value,
+                const opencensus::stats::Aggregation& aggregation,
+                LastValues* last);
+  // Writes counters of the change in a histogram's count and sum.
+  void WriteHistogram(absl::string_view name, double count, double sum,
+                      LastValues* last);
+
+  // Appends the line "<name><suffix>:<value>|<type><tags>", starting a new
+  // packet first if it would not fit in the current one.
+  void AddLine(absl::string_view name, absl::string_view suffix, double value,
+               absl::string_view type);
+
+  const std::string prefix_;
+  const bool dogstatsd_;
+  const size_t max_packet_size_;
+
+  // Keyed by view name.
+  std::unordered_map<std::string, ViewState> views_;
+
+  // The packets, back to back, reused across calls.
+  std::string buffer_;
+  std::vector<size_t> packet_ends_;
+  // The current row's encoded tags ("|#k:v,..." for DogStatsD) and its
+  // metric name.
+  std::string tags_;
+  std::string name_;
+  std::string line_;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_STATSD_INTERNAL_STATSD_WRITER_H_
@@ -0,0 +1,174 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/stats/statsd/internal/statsd_writer.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+using opencensus::stats::testing::TestUtils;
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+namespace {
+
+// Returns the lines of all packets.
+std::vector<std::string> Lines(const StatsdWriter& writer) {
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < writer.num_packets(); ++i) {
+    for (absl::string_view line : absl::StrSplit(writer.packet(i), '\n')) {
+      lines.emplace_back(line);
+    }
+  }
+  return lines;
+}
+
+TEST(StatsdWriterTest, CountersAreDeltas) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "statsd_measure_count", "", "1");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("statsd/count")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Count())
+          .add_column(opencensus::tags::TagKey::Register("method"));
+
+  StatsdWriter writer("app.", true, 1432);
+  writer.Write({{view_descriptor,
+                 TestUtils::MakeViewData(view_descriptor,
+                                         {{{"Get"}, 1.0}, {{"Get"}, 1.0}})}});
+  EXPECT_THAT(Lines(writer),
+              ::testing::ElementsAre("app.statsd/count:2|c|#method:Get"));
+
+  writer.Write(
+      {{view_descriptor,
+        TestUtils::MakeViewData(
+            view_descriptor,
+            {{{"Get"}, 1.0}, {{"Get"}, 1.0}, {{"Get"}, 1.0}, {{"a|b"}, 1.0}})}});
+  EXPECT_THAT(Lines(writer), ::testing::UnorderedElementsAre(
+                                 "app.statsd/count:1|c|#method:Get",
+                                 "app.statsd/count:1|c|#method:a_b"));
+
+  // Unchanged rows are omitted.
+  writer.Write(
+      {{view_descriptor,
+        TestUtils::MakeViewData(
+            view_descriptor,
+            {{{"Get"}, 1.0}, {{"Get"}, 1.0}, {{"Get"}, 1.0}, {{"a|b"}, 1.0}})}});
+  EXPECT_EQ(0, writer.num_packets());
+}
+
+TEST(StatsdWriterTest, GaugesAndHistograms) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "statsd_measure_histogram", "", "ms");
+  const auto last_value_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("last")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::LastValue());
+  const auto distribution_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("latency")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({10})))
+          .add_column(opencensus::tags::TagKey::Register("host"));
+
+  // Plain StatsD puts tag values in the name.
+  StatsdWriter writer("", false, 1432);
+  writer.Write(
+      {{last_value_descriptor,
+        TestUtils::MakeViewData(last_value_descriptor, {{{}, 2.5}})},
+       {distribution_descriptor,
+        TestUtils::MakeViewData(distribution_descriptor,
+                                {{{"a.b"}, 1.0}, {{"a.b"}, 2.5}})}});
+  EXPECT_THAT(Lines(writer),
+              ::testing::ElementsAre("last:2.5|g", "latency.a_b.count:2|c",
+                                     "latency.a_b.sum:3.5|c"));
+}
+
+TEST(StatsdWriterTest, SkipsNonFiniteValues) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "statsd_measure_non_finite", "", "1");
+  const auto sum_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("sum")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum());
+  const auto last_value_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("last")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::LastValue());
+
+  StatsdWriter writer("", true, 1432);
+  writer.Write({{sum_descriptor,
+                 TestUtils::MakeViewData(sum_descriptor, {{{}, 2.0}})}});
+  EXPECT_THAT(Lines(writer), ::testing::ElementsAre("sum:2|c"));
+  writer.Write(
+      {{sum_descriptor,
+        TestUtils::MakeViewData(
+            sum_descriptor, {{{}, std::numeric_limits<double>::infinity()}})},
+       {last_value_descriptor,
+        TestUtils::MakeViewData(
+            last_value_descriptor,
+            {{{}, std::numeric_limits<double>::quiet_NaN()}})}});
+  EXPECT_EQ(0, writer.num_packets());
+  // The skipped value does not affect the next delta.
+  writer.Write({{sum_descriptor,
+                 TestUtils::MakeViewData(sum_descriptor, {{{}, 3.0}})}});
+  EXPECT_THAT(Lines(writer), ::testing::ElementsAre("sum:1|c"));
+}
+
+TEST(StatsdWriterTest, PacksLinesIntoPackets) {
+  const auto measure = opencensus::stats::MeasureDouble::Register(
+      "statsd_measure_packets", "", "1");
+  const auto view_descriptor =
+      opencensus::stats::ViewDescriptor()
+          .set_name("sum")
+          .set_measure(measure.GetDescriptor().name())
+          .set_aggregation(opencensus::stats::Aggregation::Sum())
+          .add_column(opencensus::tags::TagKey::Register("k"));
+
+  // Each line is "sum:1|c|#k:N" (12 bytes), so two fit in 25 bytes.
+  StatsdWriter writer("", true, 25);
+  writer.Write({{view_descriptor,
+                 TestUtils::MakeViewData(view_descriptor, {{{"1"}, 1.0},
+                                                           {{"2"}, 1.0},
+                                                           {{"3"}, 1.0},
+                                                           {{"4"}, 1.0},
+                                                           {{"5"}, 1.0}})}});
+  // Rows are not ordered.
+  ASSERT_EQ(3, writer.num_packets());
+  EXPECT_EQ(25, writer.packet(0).size());
+  EXPECT_EQ(25, writer.packet(1).size());
+  EXPECT_EQ(12, writer.packet(2).size());
+  EXPECT_THAT(Lines(writer),
+              ::testing::UnorderedElementsAre("sum:1|c|#k:1", "sum:1|c|#k:2",
+                                              "sum:1|c|#k:3", "sum:1|c|#k:4",
+                                              "sum:1|c|#k:5"));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,75 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_STATS_STATSD_STATSD_EXPORTER_H_
+#define OPENCENSUS_EXPORTERS_STATS_STATSD_STATSD_EXPORTER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace exporters {
+namespace stats {
+
+struct StatsdOptions {
+  // Where the StatsD daemon listens: "host:port" for UDP (e.g.
+  // "127.0.0.1:8125" or "[::1]:8125"), or "unix:" followed by the path of a
+  // Unix domain datagram socket. Hosts must be numeric addresses.
+  std::string address = "127.0.0.1:8125";
+
+  // If true, tags are sent as DogStatsD tags ("|#key:value,..."); otherwise,
+  // for plain StatsD, each tag value is appended to the metric name as a
+  // '.'-separated component.
+  bool dogstatsd = true;
+
+  // Prepended to each view name to form the metric name.
+  std::string prefix;
+
+  // Lines are packed into datagrams of at most this many bytes. The default
+  // fits in an Ethernet MTU over UDP; Unix domain sockets allow much larger
+  // datagrams (e.g. 8192).
+  size_t max_packet_size = 1432;
+
+  // How often to export.
+  absl::Duration export_interval = absl::Seconds(10);
+};
+
+// Exports stats for registered views (see opencensus/stats/stats_exporter.h)
+// to a StatsD or DogStatsD daemon, e.g. a sidecar, as lines over UDP or a Unix
+// domain datagram socket.
+//
+// Count and Sum views are sent as counters of the change in each row since
+// the previous export, and LastValue views as gauges. Distribution and
+// exponential histogram views are sent as counters of the change in their
+// count and sum ("<name>.count", "<name>.sum"), and Quantiles views also as a
+// gauge per quantile ("<name>.p99"). Lines are packed into as few datagrams
+// as fit, and each export is sent with a few sendmmsg() calls. Datagrams are
+// dropped, without blocking, if the daemon is not keeping up.
+// StatsdExporter is thread-safe.
+class StatsdExporter {
+ public:
+  // Registers the exporter.
+  static void Register(const StatsdOptions& opts);
+
+ private:
+  StatsdExporter() = delete;
+};
+
+}  // namespace stats
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_STATS_STATSD_STATSD_EXPORTER_H_
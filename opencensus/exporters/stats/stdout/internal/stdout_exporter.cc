@@ -24,7 +24,9 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "opencensus/common/internal/json_lines_writer.h"
 #include "opencensus/stats/stats.h"
 
 namespace opencensus {
@@ -38,15 +40,21 @@ std::string DataToString(double data) { return absl::StrCat(": ", data, "\n"); }
 std::string DataToString(int64_t data) {
   return absl::StrCat(": ", data, "\n");
 }
-std::string DataToString(const opencensus::stats::Distribution& data) {
+std::string IndentDebugString(const std::string& debug_string) {
   std::string output = "\n";
-  std::vector<std::string> lines = absl::StrSplit(data.DebugString(), '\n');
+  std::vector<std::string> lines = absl::StrSplit(debug_string, '\n');
   // Add indent.
   for (const auto& line : lines) {
     absl::StrAppend(&output, "    ", line, "\n");
   }
   return output;
 }
+std::string DataToString(const opencensus::stats::Distribution& data) {
+  return IndentDebugString(data.DebugString());
+}
+std::string DataToString(const opencensus::stats::ExponentialHistogram& data) {
+  return IndentDebugString(data.DebugString());
+}
 
 class Handler : public opencensus::stats::StatsExporter::Handler {
  public:
@@ -85,6 +93,11 @@ void Handler::ExportViewData(
         ExportViewDataImpl(datum.first, view_data.start_time(),
                            view_data.end_time(), view_data.distribution_data());
         break;
+      case opencensus::stats::ViewData::Type::kExponentialHistogram:
+        ExportViewDataImpl(datum.first, view_data.start_time(),
+                           view_data.end_time(),
+                           view_data.exponential_histogram_data());
+        break;
     }
   }
   stream_->flush();
@@ -117,6 +130,159 @@ void Handler::ExportViewDataImpl(
   *stream_ << output;
 }
 
+// Exports are serialized per handler, so the writer needs no locking.
+class JsonLinesHandler : public opencensus::stats::StatsExporter::Handler {
+ public:
+  explicit JsonLinesHandler(int fd) : writer_(fd) {}
+
+  void ExportViewData(
+      const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                  opencensus::stats::ViewData>>& data) override;
+
+ private:
+  template <typename DataValueT>
+  void ExportViewDataImpl(
+      const opencensus::stats::ViewDescriptor& descriptor,
+      absl::Time start_time, absl::Time end_time,
+      const opencensus::stats::ViewData::DataMap<DataValueT>& data);
+
+  // Writes the value of a row.
+  void WriteValue(double value);
+  void WriteValue(int64_t value);
+  void WriteValue(const opencensus::stats::Distribution& value);
+  void WriteValue(const opencensus::stats::ExponentialHistogram& value);
+
+  opencensus::common::JsonLinesWriter writer_;
+};
+
+void JsonLinesHandler::ExportViewData(
+    const std::vector<std::pair<opencensus::stats::ViewDescriptor,
+                                opencensus::stats::ViewData>>& data) {
+  for (const auto& datum : data) {
+    const auto& view_data = datum.second;
+    switch (view_data.type()) {
+      case opencensus::stats::ViewData::Type::kDouble:
+        ExportViewDataImpl(datum.first, view_data.start_time(),
+                           view_data.end_time(), view_data.double_data());
+        break;
+      case opencensus::stats::ViewData::Type::kInt64:
+        ExportViewDataImpl(datum.first, view_data.start_time(),
+                           view_data.end_time(), view_data.int_data());
+        break;
+      case opencensus::stats::ViewData::Type::kDistribution:
+        ExportViewDataImpl(datum.first, view_data.start_time(),
+                           view_data.end_time(), view_data.distribution_data());
+        break;
+      case opencensus::stats::ViewData::Type::kExponentialHistogram:
+        ExportViewDataImpl(datum.first, view_data.start_time(),
+                           view_data.end_time(),
+                           view_data.exponential_histogram_data());
+        break;
+    }
+  }
+  writer_.Flush();
+}
+
+template <typename DataValueT>
+void JsonLinesHandler::ExportViewDataImpl(
+    const opencensus::stats::ViewDescriptor& descriptor, absl::Time start_time,
+    absl::Time end_time,
+    const opencensus::stats::ViewData::DataMap<DataValueT>& data) {
+  for (const auto& row : data) {
+    writer_.StartObject();
+    writer_.Key("view");
+    writer_.String(descriptor.name());
+    writer_.Key("start_time_unix_nanos");
+    writer_.Int(absl::ToUnixNanos(start_time));
+    writer_.Key("end_time_unix_nanos");
+    writer_.Int(absl::ToUnixNanos(end_time));
+    writer_.Key("tags");
+    writer_.StartObject();
+    for (int i = 0; i < descriptor.columns().size(); ++i) {
+      writer_.Key(descriptor.columns()[i].name());
+      writer_.String(row.first[i]);
+    }
+    writer_.EndObject();
+    WriteValue(row.second);
+    writer_.EndObject();
+  }
+}
+
+void JsonLinesHandler::WriteValue(double value) {
+  writer_.Key("value");
+  writer_.Double(value);
+}
+
+void JsonLinesHandler::WriteValue(int64_t value) {
+  writer_.Key("value");
+  writer_.Int(value);
+}
+
+void JsonLinesHandler::WriteValue(
+    const opencensus::stats::Distribution& value) {
+  writer_.Key("distribution");
+  writer_.StartObject();
+  writer_.Key("count");
+  writer_.Uint(value.count());
+  writer_.Key("mean");
+  writer_.Double(value.mean());
+  writer_.Key("sum_of_squared_deviation");
+  writer_.Double(value.sum_of_squared_deviation());
+  writer_.Key("min");
+  writer_.Double(value.min());
+  writer_.Key("max");
+  writer_.Double(value.max());
+  writer_.Key("bucket_boundaries");
+  writer_.StartArray();
+  for (const double boundary : value.bucket_boundaries().lower_boundaries()) {
+    writer_.Double(boundary);
+  }
+  writer_.EndArray();
+  writer_.Key("bucket_counts");
+  writer_.StartArray();
+  for (const uint64_t count : value.bucket_counts()) {
+    writer_.Uint(count);
+  }
+  writer_.EndArray();
+  writer_.EndObject();
+}
+
+void JsonLinesHandler::WriteValue(
+    const opencensus::stats::ExponentialHistogram& value) {
+  writer_.Key("exponential_histogram");
+  writer_.StartObject();
+  writer_.Key("count");
+  writer_.Uint(value.count());
+  writer_.Key("sum");
+  writer_.Double(value.sum());
+  writer_.Key("min");
+  writer_.Double(value.min());
+  writer_.Key("max");
+  writer_.Double(value.max());
+  writer_.Key("scale");
+  writer_.Int(value.scale());
+  writer_.Key("zero_count");
+  writer_.Uint(value.zero_count());
+  const auto write_buckets =
+      [this](absl::string_view key,
+             const opencensus::stats::ExponentialHistogram::Buckets& buckets) {
+        writer_.Key(key);
+        writer_.StartObject();
+        writer_.Key("offset");
+        writer_.Int(buckets.offset);
+        writer_.Key("counts");
+        writer_.StartArray();
+        for (const uint64_t count : buckets.counts) {
+          writer_.Uint(count);
+        }
+        writer_.EndArray();
+        writer_.EndObject();
+      };
+  write_buckets("positive_buckets", value.positive_buckets());
+  write_buckets("negative_buckets", value.negative_buckets());
+  writer_.EndObject();
+}
+
 }  // namespace
 
 // static
@@ -125,6 +291,12 @@ void StdoutExporter::Register(std::ostream* stream) {
       absl::make_unique<Handler>(stream));
 }
 
+// static
+void StdoutExporter::RegisterJsonLines(int fd) {
+  opencensus::stats::StatsExporter::RegisterPushHandler(
+      absl::make_unique<JsonLinesHandler>(fd));
+}
+
 }  // namespace stats
 }  // namespace exporters
 }  // namespace opencensus
@@ -14,8 +14,11 @@
 
 #include "opencensus/exporters/stats/stdout/stdout_exporter.h"
 
+#include <unistd.h>
+
 #include <iostream>
 #include <sstream>
+#include <string>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -39,7 +42,7 @@ namespace {
 using ::testing::HasSubstr;
 
 TEST(StdoutExporterTest, Export) {
-  std::stringstream s;
+  static std::stringstream s;  // The handler stays registered.
   ::opencensus::exporters::stats::StdoutExporter::Register(&s);
 
   auto key = ::opencensus::tags::TagKey::Register("test_key");
@@ -63,4 +66,42 @@ TEST(StdoutExporterTest, Export) {
   EXPECT_THAT(str, HasSubstr("123456"));
 }
 
+TEST(StdoutExporterTest, ExportJsonLines) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  ::opencensus::exporters::stats::StdoutExporter::RegisterJsonLines(fds[1]);
+
+  auto key = ::opencensus::tags::TagKey::Register("json_key");
+  auto measure = ::opencensus::stats::MeasureInt64::Register(
+      "example.com/Test/JsonMeasure", "Test description.", "1");
+  auto descriptor =
+      ::opencensus::stats::ViewDescriptor()
+          .set_name("example.com/Test/JsonView")
+          .set_measure("example.com/Test/JsonMeasure")
+          .set_aggregation(opencensus::stats::Aggregation::Distribution(
+              opencensus::stats::BucketBoundaries::Explicit({10})))
+          .add_column(key);
+  descriptor.RegisterForExport();
+  ::opencensus::stats::Record({{measure, 4}}, {{key, "\"quoted\""}});
+  ::opencensus::stats::Record({{measure, 12}}, {{key, "\"quoted\""}});
+
+  ::opencensus::stats::testing::TestUtils::Flush();
+  ::opencensus::stats::StatsExporterTest::ExportForTesting();
+  close(fds[1]);
+  std::string str;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+    str.append(buf, n);
+  }
+  close(fds[0]);
+  std::cout << str;
+
+  EXPECT_THAT(str, HasSubstr("{\"view\":\"example.com/Test/JsonView\","));
+  EXPECT_THAT(str, HasSubstr("\"tags\":{\"json_key\":\"\\\"quoted\\\"\"},"
+                             "\"distribution\":{\"count\":2,\"mean\":8,"));
+  EXPECT_THAT(str, HasSubstr("\"bucket_boundaries\":[10],"
+                             "\"bucket_counts\":[1,1]}}\n"));
+}
+
 }  // namespace
@@ -25,7 +25,12 @@ namespace stats {
 class StdoutExporter {
  public:
   StdoutExporter() = delete;
+  // Writes a human-readable summary of each view to 'stream'.
   static void Register(std::ostream* stream = &std::cout);
+  // Writes each row of each view as a JSON object on its own line to file
+  // descriptor 'fd', which must stay open. Each export is written with a
+  // single write(2) from a buffer reused across exports.
+  static void RegisterJsonLines(int fd = 1);
 };
 
 }  // namespace stats
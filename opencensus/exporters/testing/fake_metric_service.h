@@ -0,0 +1,106 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TESTING_FAKE_METRIC_SERVICE_H_
+#define OPENCENSUS_EXPORTERS_TESTING_FAKE_METRIC_SERVICE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+#include "google/api/metric.pb.h"
+#include "google/monitoring/v3/metric_service.grpc.pb.h"
+#include "google/protobuf/empty.pb.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+// FakeMetricService is an in-process gRPC server implementing the Cloud
+// Monitoring v3 methods used by the Stackdriver stats exporter, for load and
+// fault-injection testing. CreateTimeSeries requests are answered as decided
+// by faults(), failing with UNAVAILABLE or RESOURCE_EXHAUSTED; their items
+// are time series. CreateMetricDescriptor always succeeds and
+// ListMetricDescriptors lists none, so that views are ready for export
+// whatever the faults. Other methods are not implemented.
+//
+// Example:
+//   auto service = FakeMetricService::Start();
+//   StackdriverOptions options;
+//   options.address = service->address();
+//   options.channel_options.insecure = true;
+//
+// FakeMetricService is thread-safe.
+class FakeMetricService final {
+ public:
+  // Starts serving on a free local port. Returns nullptr if the server cannot
+  // be started.
+  static std::unique_ptr<FakeMetricService> Start(
+      const FaultOptions& options = FaultOptions());
+
+  // Stops serving, cancelling requests in progress.
+  ~FakeMetricService();
+
+  FakeMetricService(const FakeMetricService&) = delete;
+  FakeMetricService& operator=(const FakeMetricService&) = delete;
+
+  // The address to connect to, e.g. "127.0.0.1:12345".
+  const std::string& address() const { return address_; }
+
+  FaultInjector* faults() { return &service_.faults; }
+
+  // The number of CreateMetricDescriptor requests served.
+  uint64_t metric_descriptors_created() const {
+    return service_.metric_descriptors_created.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class Service final : public google::monitoring::v3::MetricService::Service {
+   public:
+    explicit Service(const FaultOptions& options) : faults(options) {}
+
+    grpc::Status ListMetricDescriptors(
+        grpc::ServerContext* context,
+        const google::monitoring::v3::ListMetricDescriptorsRequest* request,
+        google::monitoring::v3::ListMetricDescriptorsResponse* response)
+        override;
+    grpc::Status CreateMetricDescriptor(
+        grpc::ServerContext* context,
+        const google::monitoring::v3::CreateMetricDescriptorRequest* request,
+        google::api::MetricDescriptor* response) override;
+    grpc::Status CreateTimeSeries(
+        grpc::ServerContext* context,
+        const google::monitoring::v3::CreateTimeSeriesRequest* request,
+        google::protobuf::Empty* response) override;
+
+    FaultInjector faults;
+    std::atomic<uint64_t> metric_descriptors_created{0};
+  };
+
+  explicit FakeMetricService(const FaultOptions& options)
+      : service_(options) {}
+
+  Service service_;
+  std::string address_;
+  std::unique_ptr<grpc::Server> server_;
+};
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TESTING_FAKE_METRIC_SERVICE_H_
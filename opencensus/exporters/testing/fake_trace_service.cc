@@ -0,0 +1,72 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/testing/fake_trace_service.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+#include "absl/strings/str_cat.h"
+#include "google/devtools/cloudtrace/v2/tracing.grpc.pb.h"
+#include "google/protobuf/empty.pb.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+// static
+std::unique_ptr<FakeTraceService> FakeTraceService::Start(
+    const FaultOptions& options) {
+  std::unique_ptr<FakeTraceService> fake(new FakeTraceService(options));
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(),
+                           &port);
+  builder.RegisterService(&fake->service_);
+  fake->server_ = builder.BuildAndStart();
+  if (fake->server_ == nullptr || port == 0) {
+    return nullptr;
+  }
+  fake->address_ = absl::StrCat("127.0.0.1:", port);
+  return fake;
+}
+
+FakeTraceService::~FakeTraceService() {
+  if (server_ != nullptr) {
+    server_->Shutdown(std::chrono::system_clock::now());
+  }
+}
+
+grpc::Status FakeTraceService::Service::BatchWriteSpans(
+    grpc::ServerContext* /*context*/,
+    const google::devtools::cloudtrace::v2::BatchWriteSpansRequest* request,
+    google::protobuf::Empty* /*response*/) {
+  switch (faults.Admit(request->spans_size(), request->ByteSizeLong())) {
+    case FaultInjector::Outcome::kAccept:
+      break;
+    case FaultInjector::Outcome::kUnavailable:
+      return grpc::Status(grpc::StatusCode::UNAVAILABLE, "injected fault");
+    case FaultInjector::Outcome::kQuotaExceeded:
+      return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                          "injected quota limit");
+  }
+  return grpc::Status::OK;
+}
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,86 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TESTING_FAKE_TRACE_SERVICE_H_
+#define OPENCENSUS_EXPORTERS_TESTING_FAKE_TRACE_SERVICE_H_
+
+#include <memory>
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+#include "google/devtools/cloudtrace/v2/tracing.grpc.pb.h"
+#include "google/protobuf/empty.pb.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+// FakeTraceService is an in-process gRPC server implementing the Cloud Trace
+// v2 BatchWriteSpans method, for load and fault-injection testing of the
+// Stackdriver trace exporter. Each request is answered as decided by
+// faults(), failing with UNAVAILABLE or RESOURCE_EXHAUSTED; its items are
+// spans. CreateSpan is not implemented.
+//
+// Example:
+//   auto service = FakeTraceService::Start();
+//   StackdriverOptions options;
+//   options.address = service->address();
+//   options.channel_options.insecure = true;
+//
+// FakeTraceService is thread-safe.
+class FakeTraceService final {
+ public:
+  // Starts serving on a free local port. Returns nullptr if the server cannot
+  // be started.
+  static std::unique_ptr<FakeTraceService> Start(
+      const FaultOptions& options = FaultOptions());
+
+  // Stops serving, cancelling requests in progress.
+  ~FakeTraceService();
+
+  FakeTraceService(const FakeTraceService&) = delete;
+  FakeTraceService& operator=(const FakeTraceService&) = delete;
+
+  // The address to connect to, e.g. "127.0.0.1:12345".
+  const std::string& address() const { return address_; }
+
+  FaultInjector* faults() { return &service_.faults; }
+
+ private:
+  class Service final
+      : public google::devtools::cloudtrace::v2::TraceService::Service {
+   public:
+    explicit Service(const FaultOptions& options) : faults(options) {}
+
+    grpc::Status BatchWriteSpans(
+        grpc::ServerContext* context,
+        const google::devtools::cloudtrace::v2::BatchWriteSpansRequest* request,
+        google::protobuf::Empty* response) override;
+
+    FaultInjector faults;
+  };
+
+  explicit FakeTraceService(const FaultOptions& options) : service_(options) {}
+
+  Service service_;
+  std::string address_;
+  std::unique_ptr<grpc::Server> server_;
+};
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TESTING_FAKE_TRACE_SERVICE_H_
@@ -0,0 +1,368 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/testing/fake_zipkin_collector.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+namespace {
+
+constexpr size_t kMaxHeadBytes = 16 * 1024;
+constexpr int kListenBacklog = 64;
+
+void SetError(std::string* error, absl::string_view what) {
+  if (error != nullptr) {
+    *error = absl::StrCat(what, ": ", strerror(errno));
+  }
+}
+
+bool SendAll(int fd, absl::string_view data) {
+  while (!data.empty()) {
+    const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data.remove_prefix(sent);
+  }
+  return true;
+}
+
+// Reads from 'fd', appending to *buffer, until *buffer holds at least 'size'
+// bytes. Returns false if the connection was closed first.
+bool ReadAtLeast(int fd, size_t size, std::string* buffer) {
+  char chunk[16 * 1024];
+  while (buffer->size() < size) {
+    const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) {
+      return false;
+    }
+    buffer->append(chunk, received);
+  }
+  return true;
+}
+
+// The parts of a request head the collector uses.
+struct RequestHead {
+  std::string method;
+  size_t content_length = 0;
+  bool chunked = false;
+  bool gzip = false;
+  bool expect_continue = false;
+  bool close = false;
+  std::string content_type;
+};
+
+bool ParseHead(absl::string_view head, RequestHead* request) {
+  std::vector<absl::string_view> lines = absl::StrSplit(head, "\r\n");
+  if (lines.empty()) return false;
+  std::vector<absl::string_view> request_line =
+      absl::StrSplit(lines[0], ' ', absl::SkipEmpty());
+  if (request_line.size() != 3) return false;
+  request->method = std::string(request_line[0]);
+  request->close = request_line[2] == "HTTP/1.0";
+  for (size_t i = 1; i < lines.size(); ++i) {
+    const size_t colon = lines[i].find(':');
+    if (colon == absl::string_view::npos) continue;
+    const std::string name =
+        absl::AsciiStrToLower(lines[i].substr(0, colon));
+    const absl::string_view value =
+        absl::StripAsciiWhitespace(lines[i].substr(colon + 1));
+    if (name == "content-length") {
+      if (!absl::SimpleAtoi(value, &request->content_length)) return false;
+    } else if (name == "transfer-encoding") {
+      request->chunked = absl::EqualsIgnoreCase(value, "chunked");
+    } else if (name == "content-encoding") {
+      request->gzip = absl::EqualsIgnoreCase(value, "gzip");
+    } else if (name == "expect") {
+      request->expect_continue = absl::EqualsIgnoreCase(value, "100-continue");
+    } else if (name == "connection") {
+      request->close = absl::EqualsIgnoreCase(value, "close");
+    } else if (name == "content-type") {
+      request->content_type = std::string(value);
+    }
+  }
+  return true;
+}
+
+bool Gunzip(absl::string_view compressed, std::string* out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 16 selects the gzip wrapper.
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) return false;
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+  char chunk[16 * 1024];
+  int result;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(chunk);
+    stream.avail_out = sizeof(chunk);
+    result = inflate(&stream, Z_NO_FLUSH);
+    if (result != Z_OK && result != Z_STREAM_END) break;
+    out->append(chunk, sizeof(chunk) - stream.avail_out);
+  } while (result != Z_STREAM_END);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+bool ReadVarint(absl::string_view* data, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !data->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+std::string Response(absl::string_view status, bool close) {
+  return absl::StrCat("HTTP/1.1 ", status,
+                      "\r\nContent-Length: 0\r\nConnection: ",
+                      close ? "close" : "keep-alive", "\r\n\r\n");
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<FakeZipkinCollector> FakeZipkinCollector::Start(
+    const FaultOptions& options, std::string* error) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    SetError(error, "socket() failed");
+    return nullptr;
+  }
+  socklen_t addr_len = sizeof(addr);
+  int wake_fds[2];
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    SetError(error, "bind() failed");
+  } else if (listen(fd, kListenBacklog) != 0) {
+    SetError(error, "listen() failed");
+  } else if (getsockname(fd, reinterpret_cast<sockaddr*>(&addr),
+                         &addr_len) != 0) {
+    SetError(error, "getsockname() failed");
+  } else if (pipe(wake_fds) != 0) {
+    SetError(error, "pipe() failed");
+  } else {
+    return std::unique_ptr<FakeZipkinCollector>(new FakeZipkinCollector(
+        options, fd, ntohs(addr.sin_port), wake_fds[0], wake_fds[1]));
+  }
+  close(fd);
+  return nullptr;
+}
+
+FakeZipkinCollector::FakeZipkinCollector(const FaultOptions& options,
+                                         int listen_fd, int port,
+                                         int wake_read_fd, int wake_write_fd)
+    : faults_(options),
+      listen_fd_(listen_fd),
+      port_(port),
+      wake_read_fd_(wake_read_fd),
+      wake_write_fd_(wake_write_fd),
+      thread_(&FakeZipkinCollector::Run, this) {}
+
+FakeZipkinCollector::~FakeZipkinCollector() {
+  const char wake = 0;
+  while (write(wake_write_fd_, &wake, 1) < 0 && errno == EINTR) {
+  }
+  thread_.join();
+  std::vector<std::thread> threads;
+  {
+    absl::MutexLock l(&mu_);
+    shutdown_ = true;
+    // Wakes the threads blocked reading; each closes its own fd.
+    for (const int fd : connection_fds_) {
+      shutdown(fd, SHUT_RDWR);
+    }
+    threads.swap(connection_threads_);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  close(listen_fd_);
+  close(wake_read_fd_);
+  close(wake_write_fd_);
+}
+
+std::string FakeZipkinCollector::url() const {
+  return absl::StrCat("http://127.0.0.1:", port_, "/api/v2/spans");
+}
+
+// static
+int FakeZipkinCollector::CountSpans(absl::string_view body,
+                                    absl::string_view content_type) {
+  if (absl::StrContains(content_type, "protobuf")) {
+    // A ListOfSpans: each span is field 1, length-delimited.
+    int spans = 0;
+    while (!body.empty()) {
+      uint64_t tag;
+      uint64_t length;
+      if (!ReadVarint(&body, &tag) || tag != ((1 << 3) | 2) ||
+          !ReadVarint(&body, &length) || length > body.size()) {
+        return -1;
+      }
+      body.remove_prefix(length);
+      ++spans;
+    }
+    return spans;
+  }
+  // A JSON array of spans, each with one "traceId" (annotations and
+  // endpoints have none).
+  int spans = 0;
+  for (size_t pos = body.find("\"traceId\""); pos != absl::string_view::npos;
+       pos = body.find("\"traceId\"", pos + 1)) {
+    ++spans;
+  }
+  return spans;
+}
+
+void FakeZipkinCollector::Run() {
+  pollfd fds[2];
+  fds[0].fd = listen_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = wake_read_fd_;
+  fds[1].events = POLLIN;
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    if ((fds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+    const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) continue;
+    absl::MutexLock l(&mu_);
+    connection_fds_.push_back(fd);
+    connection_threads_.emplace_back(&FakeZipkinCollector::ServeConnection,
+                                     this, fd);
+  }
+}
+
+void FakeZipkinCollector::ServeConnection(int fd) {
+  std::string buffer;
+  std::string body;
+  while (true) {
+    size_t head_end;
+    while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+      if (buffer.size() > kMaxHeadBytes ||
+          !ReadAtLeast(fd, buffer.size() + 1, &buffer)) {
+        head_end = std::string::npos;
+        break;
+      }
+    }
+    if (head_end == std::string::npos) break;
+    RequestHead request;
+    const bool parsed =
+        ParseHead(absl::string_view(buffer).substr(0, head_end), &request);
+    buffer.erase(0, head_end + 4);
+    if (!parsed || request.chunked) {
+      // Without a length, the body cannot be skipped.
+      SendAll(fd, Response(parsed ? "411 Length Required" : "400 Bad Request",
+                           true));
+      break;
+    }
+    if (request.expect_continue &&
+        !SendAll(fd, "HTTP/1.1 100 Continue\r\n\r\n")) {
+      break;
+    }
+    if (!ReadAtLeast(fd, request.content_length, &buffer)) break;
+    body.assign(buffer, 0, request.content_length);
+    buffer.erase(0, request.content_length);
+
+    std::string status;
+    if (request.method != "POST") {
+      status = "405 Method Not Allowed";
+    } else {
+      std::string decompressed;
+      int spans = -1;
+      if (!request.gzip) {
+        spans = CountSpans(body, request.content_type);
+      } else if (Gunzip(body, &decompressed)) {
+        spans = CountSpans(decompressed, request.content_type);
+      }
+      if (spans < 0) {
+        status = "400 Bad Request";
+      } else {
+        switch (faults_.Admit(spans, body.size())) {
+          case FaultInjector::Outcome::kAccept:
+            status = "202 Accepted";
+            break;
+          case FaultInjector::Outcome::kUnavailable:
+            status = "503 Service Unavailable";
+            break;
+          case FaultInjector::Outcome::kQuotaExceeded:
+            status = "429 Too Many Requests";
+            break;
+        }
+      }
+    }
+    if (!SendAll(fd, Response(status, request.close)) || request.close) {
+      break;
+    }
+  }
+  absl::MutexLock l(&mu_);
+  // After shutdown_, the destructor owns the list of fds.
+  if (!shutdown_) {
+    for (size_t i = 0; i < connection_fds_.size(); ++i) {
+      if (connection_fds_[i] == fd) {
+        connection_fds_[i] = connection_fds_.back();
+        connection_fds_.pop_back();
+        break;
+      }
+    }
+  }
+  close(fd);
+}
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,103 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TESTING_FAKE_ZIPKIN_COLLECTOR_H_
+#define OPENCENSUS_EXPORTERS_TESTING_FAKE_ZIPKIN_COLLECTOR_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+// FakeZipkinCollector is an in-process HTTP server that accepts spans as a
+// Zipkin collector's POST /api/v2/spans does, for load and fault-injection
+// testing of the Zipkin exporter. Each request is answered as decided by
+// faults(): "202 Accepted", "503 Service Unavailable" or "429 Too Many
+// Requests". The spans in a request are counted, not decoded: bodies may be
+// JSON or zipkin.proto3.ListOfSpans, and gzip-compressed.
+//
+// Each connection is served on a thread of its own, with keep-alive, so that
+// concurrent requests wait out their latency concurrently; threads are joined
+// when the collector is destroyed. Only local connections are accepted.
+//
+// Example:
+//   auto collector = FakeZipkinCollector::Start();
+//   ZipkinExporterOptions options(collector->url());
+//   ...
+//   collector->faults()->SetOptions(slow_options);
+//
+// FakeZipkinCollector is thread-safe.
+class FakeZipkinCollector final {
+ public:
+  // Starts serving on a free port. Returns nullptr, setting *error (if not
+  // null), if it cannot listen.
+  static std::unique_ptr<FakeZipkinCollector> Start(
+      const FaultOptions& options = FaultOptions(),
+      std::string* error = nullptr);
+
+  // Stops serving, closing open connections.
+  ~FakeZipkinCollector();
+
+  FakeZipkinCollector(const FakeZipkinCollector&) = delete;
+  FakeZipkinCollector& operator=(const FakeZipkinCollector&) = delete;
+
+  int port() const { return port_; }
+  // The URL to export spans to, e.g. "http://127.0.0.1:12345/api/v2/spans".
+  std::string url() const;
+
+  // Decides and counts the outcome of each request; its items are spans.
+  FaultInjector* faults() { return &faults_; }
+
+  // Returns the number of spans in a request body as sent with
+  // 'content_type' (uncompressed), or -1 if it is malformed.
+  static int CountSpans(absl::string_view body, absl::string_view content_type);
+
+ private:
+  FakeZipkinCollector(const FaultOptions& options, int listen_fd, int port,
+                      int wake_read_fd, int wake_write_fd);
+
+  // Accepts connections until the destructor writes to the wake pipe.
+  void Run() LOCKS_EXCLUDED(mu_);
+  // Serves requests on 'fd' until the client or the destructor closes it.
+  void ServeConnection(int fd) LOCKS_EXCLUDED(mu_);
+
+  FaultInjector faults_;
+  const int listen_fd_;
+  const int port_;
+  const int wake_read_fd_;
+  const int wake_write_fd_;
+
+  absl::Mutex mu_;
+  // Set by the destructor, which then shuts down the open connections.
+  bool shutdown_ GUARDED_BY(mu_) = false;
+  std::vector<int> connection_fds_ GUARDED_BY(mu_);
+  std::vector<std::thread> connection_threads_ GUARDED_BY(mu_);
+
+  std::thread thread_;
+};
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TESTING_FAKE_ZIPKIN_COLLECTOR_H_
@@ -0,0 +1,124 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/testing/fault_injector.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/random.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+FaultInjector::FaultInjector(const FaultOptions& options)
+    : options_(options),
+      quota_(options.max_items_per_second),
+      quota_refilled_(absl::Now()) {}
+
+void FaultInjector::SetOptions(const FaultOptions& options) {
+  absl::MutexLock l(&mu_);
+  options_ = options;
+  quota_ = options.max_items_per_second;
+  quota_refilled_ = absl::Now();
+}
+
+FaultInjector::Outcome FaultInjector::Admit(uint64_t items, uint64_t bytes) {
+  common::Random* random = common::Random::GetRandom();
+  absl::Duration latency;
+  {
+    absl::MutexLock l(&mu_);
+    latency = options_.latency;
+    if (options_.latency_jitter > absl::ZeroDuration()) {
+      latency += options_.latency_jitter * random->GenerateRandomDouble();
+    }
+  }
+  if (latency > absl::ZeroDuration()) {
+    absl::SleepFor(latency);
+  }
+  absl::MutexLock l(&mu_);
+  ++counts_.requests;
+  Outcome outcome = Outcome::kAccept;
+  if (options_.error_rate > 0 &&
+      random->GenerateRandomDouble() < options_.error_rate) {
+    outcome = Outcome::kUnavailable;
+  } else if (options_.max_items_per_second > 0) {
+    RefillQuota(absl::Now());
+    if (quota_ >= std::min<double>(items, options_.max_items_per_second)) {
+      quota_ -= items;
+    } else {
+      outcome = Outcome::kQuotaExceeded;
+    }
+  }
+  switch (outcome) {
+    case Outcome::kAccept:
+      ++counts_.accepted_requests;
+      counts_.accepted_items += items;
+      counts_.accepted_bytes += bytes;
+      break;
+    case Outcome::kUnavailable:
+      ++counts_.unavailable_requests;
+      counts_.rejected_items += items;
+      break;
+    case Outcome::kQuotaExceeded:
+      ++counts_.quota_exceeded_requests;
+      counts_.rejected_items += items;
+      break;
+  }
+  return outcome;
+}
+
+void FaultInjector::RefillQuota(absl::Time now) {
+  const double elapsed = absl::ToDoubleSeconds(now - quota_refilled_);
+  if (elapsed <= 0) return;
+  quota_ = std::min(options_.max_items_per_second,
+                    quota_ + elapsed * options_.max_items_per_second);
+  quota_refilled_ = now;
+}
+
+FaultInjector::Counts FaultInjector::counts() const {
+  absl::MutexLock l(&mu_);
+  return counts_;
+}
+
+void FaultInjector::ResetCounts() {
+  absl::MutexLock l(&mu_);
+  counts_ = Counts();
+}
+
+bool FaultInjector::WaitForItems(uint64_t items, absl::Time deadline) const {
+  struct Args {
+    const Counts* counts;
+    uint64_t items;
+  };
+  absl::MutexLock l(&mu_);
+  Args args = {&counts_, items};
+  return mu_.AwaitWithDeadline(
+      absl::Condition(
+          +[](Args* args) {
+            return args->counts->accepted_items +
+                       args->counts->rejected_items >=
+                   args->items;
+          },
+          &args),
+      deadline);
+}
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
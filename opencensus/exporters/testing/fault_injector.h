@@ -0,0 +1,105 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TESTING_FAULT_INJECTOR_H_
+#define OPENCENSUS_EXPORTERS_TESTING_FAULT_INJECTOR_H_
+
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+
+// FaultOptions describe how a fake backend degrades the requests it serves.
+struct FaultOptions {
+  // Each request is answered after 'latency', plus a uniformly random extra
+  // delay of up to 'latency_jitter'.
+  absl::Duration latency = absl::ZeroDuration();
+  absl::Duration latency_jitter = absl::ZeroDuration();
+
+  // The fraction of requests failed as unavailable (gRPC UNAVAILABLE, HTTP
+  // 503).
+  double error_rate = 0;
+
+  // If positive, the items (spans or time series) accepted per second.
+  // Requests that would exceed it are rejected as over quota (gRPC
+  // RESOURCE_EXHAUSTED, HTTP 429). Up to a second's worth can be accepted at
+  // once; a larger request is accepted once a second's worth is available,
+  // and is then paid for by the requests that follow.
+  double max_items_per_second = 0;
+};
+
+// FaultInjector decides the outcome of each request to a fake backend, as
+// configured by FaultOptions, and counts the outcomes, so that exporters'
+// throughput, retries and drops can be measured against slow, failing or
+// throttled backends. The fake collectors in this directory each hold one.
+//
+// FaultInjector is thread-safe.
+class FaultInjector final {
+ public:
+  enum class Outcome { kAccept, kUnavailable, kQuotaExceeded };
+
+  struct Counts {
+    uint64_t requests = 0;
+    uint64_t accepted_requests = 0;
+    uint64_t accepted_items = 0;
+    uint64_t accepted_bytes = 0;
+    uint64_t unavailable_requests = 0;
+    uint64_t quota_exceeded_requests = 0;
+    // The items of the rejected requests.
+    uint64_t rejected_items = 0;
+  };
+
+  explicit FaultInjector(const FaultOptions& options = FaultOptions());
+
+  // Replaces the options, e.g. between benchmark runs. Requests already
+  // waiting out their latency are unaffected.
+  void SetOptions(const FaultOptions& options) LOCKS_EXCLUDED(mu_);
+
+  // Waits for the request's latency, then decides whether a request of
+  // 'items' items in 'bytes' bytes is accepted, and counts it. Concurrent
+  // requests wait concurrently.
+  Outcome Admit(uint64_t items, uint64_t bytes) LOCKS_EXCLUDED(mu_);
+
+  Counts counts() const LOCKS_EXCLUDED(mu_);
+  void ResetCounts() LOCKS_EXCLUDED(mu_);
+
+  // Waits until at least 'items' items have been accepted or rejected since
+  // the counts were last reset, or until 'deadline'. Returns true if they
+  // have.
+  bool WaitForItems(uint64_t items, absl::Time deadline) const
+      LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Adds the quota accrued since the last refill. Requires holding mu_.
+  void RefillQuota(absl::Time now) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  FaultOptions options_ GUARDED_BY(mu_);
+  Counts counts_ GUARDED_BY(mu_);
+  // The items that can be accepted now; negative after a request larger than
+  // a second's worth.
+  double quota_ GUARDED_BY(mu_);
+  absl::Time quota_refilled_ GUARDED_BY(mu_);
+};
+
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TESTING_FAULT_INJECTOR_H_
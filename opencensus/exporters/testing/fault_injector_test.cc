@@ -0,0 +1,101 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/testing/fault_injector.h"
+
+#include <thread>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace exporters {
+namespace testing {
+namespace {
+
+TEST(FaultInjectorTest, AcceptsByDefault) {
+  FaultInjector faults;
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(3, 100));
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(2, 50));
+  const FaultInjector::Counts counts = faults.counts();
+  EXPECT_EQ(2, counts.requests);
+  EXPECT_EQ(2, counts.accepted_requests);
+  EXPECT_EQ(5, counts.accepted_items);
+  EXPECT_EQ(150, counts.accepted_bytes);
+  EXPECT_EQ(0, counts.rejected_items);
+
+  faults.ResetCounts();
+  EXPECT_EQ(0, faults.counts().requests);
+}
+
+TEST(FaultInjectorTest, ErrorRate) {
+  FaultOptions options;
+  options.error_rate = 1;
+  FaultInjector faults(options);
+  EXPECT_EQ(FaultInjector::Outcome::kUnavailable, faults.Admit(3, 100));
+  const FaultInjector::Counts counts = faults.counts();
+  EXPECT_EQ(1, counts.unavailable_requests);
+  EXPECT_EQ(0, counts.accepted_items);
+  EXPECT_EQ(3, counts.rejected_items);
+
+  faults.SetOptions(FaultOptions());
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(3, 100));
+}
+
+TEST(FaultInjectorTest, Quota) {
+  FaultOptions options;
+  options.max_items_per_second = 10;
+  FaultInjector faults(options);
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(8, 0));
+  EXPECT_EQ(FaultInjector::Outcome::kQuotaExceeded, faults.Admit(8, 0));
+  const FaultInjector::Counts counts = faults.counts();
+  EXPECT_EQ(1, counts.quota_exceeded_requests);
+  EXPECT_EQ(8, counts.accepted_items);
+  EXPECT_EQ(8, counts.rejected_items);
+}
+
+TEST(FaultInjectorTest, RequestLargerThanQuotaIsAcceptedWhenFull) {
+  FaultOptions options;
+  options.max_items_per_second = 10;
+  FaultInjector faults(options);
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(100, 0));
+  // The quota is now in debt for ten seconds.
+  EXPECT_EQ(FaultInjector::Outcome::kQuotaExceeded, faults.Admit(1, 0));
+}
+
+TEST(FaultInjectorTest, Latency) {
+  FaultOptions options;
+  options.latency = absl::Milliseconds(20);
+  FaultInjector faults(options);
+  const absl::Time start = absl::Now();
+  EXPECT_EQ(FaultInjector::Outcome::kAccept, faults.Admit(1, 0));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(20));
+}
+
+TEST(FaultInjectorTest, WaitForItems) {
+  FaultInjector faults;
+  EXPECT_FALSE(faults.WaitForItems(2, absl::Now()));
+  std::thread t([&faults]() {
+    faults.Admit(1, 0);
+    faults.Admit(1, 0);
+  });
+  EXPECT_TRUE(faults.WaitForItems(2, absl::InfiniteFuture()));
+  t.join();
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace exporters
+}  // namespace opencensus
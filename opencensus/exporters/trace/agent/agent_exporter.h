@@ -0,0 +1,60 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_AGENT_AGENT_EXPORTER_H_
+#define OPENCENSUS_EXPORTERS_TRACE_AGENT_AGENT_EXPORTER_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+struct AgentOptions {
+  // The Unix domain datagram socket the local agent listens on.
+  std::string socket_path = "/var/run/opencensus/agent.sock";
+
+  // The service.name resource attribute, and any other resource attributes.
+  std::string service_name;
+  std::unordered_map<std::string, std::string> resource_attributes;
+
+  // Spans are split into records of about this many bytes. It should be below
+  // the socket's send buffer size (net.core.wmem_default on Linux).
+  size_t max_record_bytes = 64 << 10;
+};
+
+// Forwards spans to an agent on the same host, which batches and exports
+// them for all of the host's processes. This moves TLS, connection, and most
+// serialization costs out of the application.
+//
+// Each record is one datagram: a version byte (1), a type byte (1 for spans),
+// and a serialized opentelemetry.proto.collector.trace.v1
+// ExportTraceServiceRequest. Records are dropped, without blocking, if the
+// agent is not running or not keeping up.
+class AgentExporter {
+ public:
+  // Registers the exporter.
+  static void Register(const AgentOptions& opts);
+
+ private:
+  AgentExporter() = delete;
+};
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_AGENT_AGENT_EXPORTER_H_
@@ -0,0 +1,149 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/agent/agent_exporter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/common/internal/unix_datagram_sender.h"
+#include "opencensus/exporters/trace/otlp/internal/otlp_utils.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opentelemetry/proto/collector/trace/v1/trace_service.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+constexpr char kRecordHeader[] = {1, 1};
+// The size of the arena block kept across records.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "agent_trace";
+
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
+}
+
+class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  explicit Handler(const AgentOptions& opts);
+
+  // Called only from the SpanExporter's thread.
+  void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
+      override;
+
+ private:
+  // Starts a new record on arena_.
+  void StartRecord();
+  // Sends the current record, if it holds any spans.
+  void Send();
+
+  const AgentOptions opts_;
+  opencensus::common::UnixDatagramSender sender_;
+  std::unique_ptr<char[]> arena_block_;
+  google::protobuf::Arena arena_;
+  otlp::collector::trace::v1::ExportTraceServiceRequest* request_ = nullptr;
+  otlp::trace::v1::ScopeSpans* scope_spans_ = nullptr;
+  size_t record_bytes_ = 0;
+  // Reused serialization buffer.
+  std::string buffer_;
+  int64_t dropped_records_ = 0;
+};
+
+Handler::Handler(const AgentOptions& opts)
+    : opts_(opts),
+      sender_(opts.socket_path),
+      arena_block_(new char[kArenaInitialBlockSize]),
+      arena_(ArenaOptionsWithBlock(arena_block_.get())) {}
+
+void Handler::Export(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
+  StartRecord();
+  for (const auto& span : spans) {
+    const size_t span_bytes = AddSpan(span, scope_spans_)->ByteSizeLong();
+    // Leave room for the span's tag and length.
+    record_bytes_ += span_bytes + 8;
+    if (record_bytes_ >= opts_.max_record_bytes) {
+      Send();
+      StartRecord();
+    }
+  }
+  Send();
+}
+
+void Handler::StartRecord() {
+  // Keeps the initial block for the next record.
+  arena_.Reset();
+  request_ = google::protobuf::Arena::CreateMessage<
+      otlp::collector::trace::v1::ExportTraceServiceRequest>(&arena_);
+  otlp::trace::v1::ResourceSpans* resource_spans =
+      request_->add_resource_spans();
+  SetResource(opts_.service_name, opts_.resource_attributes,
+              resource_spans->mutable_resource());
+  scope_spans_ = resource_spans->add_scope_spans();
+  SetScope(scope_spans_);
+  record_bytes_ = request_->ByteSizeLong();
+}
+
+void Handler::Send() {
+  if (scope_spans_->spans_size() == 0) {
+    return;
+  }
+  buffer_.clear();
+  request_->AppendToString(&buffer_);
+  std::string error;
+  if (!sender_.Send(absl::string_view(kRecordHeader, sizeof(kRecordHeader)),
+                    buffer_, &error)) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kSpansDropped,
+        scope_spans_->spans_size());
+    // Only report the first of a run of drops, e.g. while the agent is down.
+    if (dropped_records_++ == 0) {
+      std::cerr << "Dropping spans for the agent at " << opts_.socket_path
+                << ": " << error << "\n";
+    }
+  } else {
+    dropped_records_ = 0;
+  }
+}
+
+}  // namespace
+
+// static
+void AgentExporter::Register(const AgentOptions& opts) {
+  ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
+      absl::make_unique<Handler>(opts));
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,381 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/jaeger/internal/jaeger_encoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+namespace {
+
+// Compact protocol types.
+enum CompactType : uint8_t {
+  kBoolTrue = 1,
+  kBoolFalse = 2,
+  kI32 = 5,
+  kI64 = 6,
+  kBinary = 8,
+  kList = 9,
+  kStruct = 12,
+};
+
+// jaeger.thrift's TagType and SpanRefType.
+enum TagType { kTagString = 0, kTagBool = 2, kTagLong = 3 };
+enum SpanRefType { kChildOf = 0, kFollowsFrom = 1 };
+
+// The compact protocol's message header for a oneway call: the protocol id,
+// then the version (1) in the low 5 bits and the message type (4, ONEWAY) in
+// the high 3 bits.
+constexpr char kMessageHeader[] = {static_cast<char>(0x82),
+                                   static_cast<char>(0x81)};
+constexpr char kEmitBatch[] = "emitBatch";
+
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+// CompactWriter appends the fields of a struct, and of structs nested in it,
+// in the compact Thrift protocol, which encodes each field id as the delta
+// from the previous one in the same struct.
+class CompactWriter {
+ public:
+  explicit CompactWriter(std::string* output) : output_(output) {}
+
+  void I32(int16_t id, int32_t value) {
+    Field(id, kI32);
+    AppendVarint(ZigZag(value), output_);
+  }
+  void I64(int16_t id, int64_t value) {
+    Field(id, kI64);
+    AppendVarint(ZigZag(value), output_);
+  }
+  void Bool(int16_t id, bool value) {
+    Field(id, value ? kBoolTrue : kBoolFalse);
+  }
+  void String(int16_t id, absl::string_view value) {
+    Field(id, kBinary);
+    AppendVarint(value.size(), output_);
+    output_->append(value.data(), value.size());
+  }
+
+  void BeginStructField(int16_t id) {
+    Field(id, kStruct);
+    BeginStruct();
+  }
+  // Starts a list of 'size' structs; each is then written between
+  // BeginStruct() and EndStruct().
+  void BeginStructList(int16_t id, size_t size) {
+    Field(id, kList);
+    if (size < 15) {
+      output_->push_back(static_cast<char>((size << 4) | kStruct));
+    } else {
+      output_->push_back(static_cast<char>(0xF0 | kStruct));
+      AppendVarint(size, output_);
+    }
+  }
+  void BeginStruct() {
+    last_ids_.push_back(last_id_);
+    last_id_ = 0;
+  }
+  void EndStruct() {
+    Stop();
+    last_id_ = last_ids_.back();
+    last_ids_.pop_back();
+  }
+  // Ends the outermost struct.
+  void Stop() { output_->push_back(0); }
+
+ private:
+  void Field(int16_t id, CompactType type) {
+    const int delta = id - last_id_;
+    if (delta > 0 && delta <= 15) {
+      output_->push_back(static_cast<char>((delta << 4) | type));
+    } else {
+      output_->push_back(static_cast<char>(type));
+      AppendVarint(ZigZag(id), output_);
+    }
+    last_id_ = id;
+  }
+
+  std::string* const output_;
+  int16_t last_id_ = 0;
+  std::vector<int16_t> last_ids_;
+};
+
+// Returns the big-endian value of 8 bytes.
+int64_t BigEndian64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value = (value << 8) | bytes[i];
+  }
+  return static_cast<int64_t>(value);
+}
+
+int64_t SpanIdValue(const ::opencensus::trace::SpanId& id) {
+  uint8_t bytes[::opencensus::trace::SpanId::kSize];
+  id.CopyTo(bytes);
+  return BigEndian64(bytes);
+}
+
+// Sets *high and *low to the halves of 'id'.
+void TraceIdValues(const ::opencensus::trace::TraceId& id, int64_t* high,
+                   int64_t* low) {
+  uint8_t bytes[::opencensus::trace::TraceId::kSize];
+  id.CopyTo(bytes);
+  *high = BigEndian64(bytes);
+  *low = BigEndian64(bytes + 8);
+}
+
+void WriteTag(absl::string_view key, absl::string_view value,
+              CompactWriter* writer) {
+  writer->BeginStruct();
+  writer->String(1, key);
+  writer->I32(2, kTagString);
+  writer->String(3, value);
+  writer->EndStruct();
+}
+
+void WriteTag(absl::string_view key, int64_t value, CompactWriter* writer) {
+  writer->BeginStruct();
+  writer->String(1, key);
+  writer->I32(2, kTagLong);
+  writer->I64(6, value);
+  writer->EndStruct();
+}
+
+void WriteTag(absl::string_view key, bool value, CompactWriter* writer) {
+  writer->BeginStruct();
+  writer->String(1, key);
+  writer->I32(2, kTagBool);
+  writer->Bool(5, value);
+  writer->EndStruct();
+}
+
+void WriteTag(absl::string_view key,
+              const ::opencensus::trace::exporter::AttributeValue& value,
+              CompactWriter* writer) {
+  switch (value.type()) {
+    case ::opencensus::trace::AttributeValueRef::Type::kString:
+      WriteTag(key, absl::string_view(value.string_value()), writer);
+      return;
+    case ::opencensus::trace::AttributeValueRef::Type::kBool:
+      WriteTag(key, value.bool_value(), writer);
+      return;
+    case ::opencensus::trace::AttributeValueRef::Type::kInt:
+      WriteTag(key, value.int_value(), writer);
+      return;
+  }
+  ABSL_ASSERT(false && "Unknown AttributeValue type");
+}
+
+void WriteSpan(const ::opencensus::trace::exporter::SpanData& span,
+               CompactWriter* writer) {
+  int64_t trace_id_high;
+  int64_t trace_id_low;
+  TraceIdValues(span.context().trace_id(), &trace_id_high, &trace_id_low);
+  writer->I64(1, trace_id_low);
+  writer->I64(2, trace_id_high);
+  writer->I64(3, SpanIdValue(span.context().span_id()));
+  writer->I64(4, span.parent_span_id().IsValid()
+                     ? SpanIdValue(span.parent_span_id())
+                     : 0);
+  writer->String(5, span.name());
+
+  if (!span.links().empty()) {
+    writer->BeginStructList(6, span.links().size());
+    for (const auto& link : span.links()) {
+      int64_t link_high;
+      int64_t link_low;
+      TraceIdValues(link.trace_id(), &link_high, &link_low);
+      writer->BeginStruct();
+      writer->I32(1, link.type() == ::opencensus::trace::exporter::Link::
+                                        Type::kParentLinkedSpan
+                         ? kChildOf
+                         : kFollowsFrom);
+      writer->I64(2, link_low);
+      writer->I64(3, link_high);
+      writer->I64(4, SpanIdValue(link.span_id()));
+      writer->EndStruct();
+    }
+  }
+
+  // Exported spans are sampled.
+  writer->I32(7, 1);
+  writer->I64(8, absl::ToUnixMicros(span.start_time()));
+  writer->I64(9,
+              absl::ToInt64Microseconds(span.end_time() - span.start_time()));
+
+  const bool error = !span.status().ok();
+  const size_t num_tags = span.attributes().size() + (error ? 3 : 0);
+  if (num_tags > 0) {
+    writer->BeginStructList(10, num_tags);
+    for (const auto& attribute : span.attributes()) {
+      WriteTag(attribute.first, attribute.second, writer);
+    }
+    if (error) {
+      WriteTag("error", true, writer);
+      WriteTag("status.code",
+               static_cast<int64_t>(span.status().CanonicalCode()), writer);
+      WriteTag("status.message",
+               absl::string_view(span.status().error_message()), writer);
+    }
+  }
+
+  const auto& annotations = span.annotations().events();
+  const auto& message_events = span.message_events().events();
+  if (!annotations.empty() || !message_events.empty()) {
+    writer->BeginStructList(11, annotations.size() + message_events.size());
+    for (const auto& annotation : annotations) {
+      writer->BeginStruct();
+      writer->I64(1, absl::ToUnixMicros(annotation.timestamp()));
+      writer->BeginStructList(2, 1 + annotation.event().attributes().size());
+      WriteTag("message", annotation.event().description(), writer);
+      for (const auto& attribute : annotation.event().attributes()) {
+        WriteTag(attribute.first, attribute.second, writer);
+      }
+      writer->EndStruct();
+    }
+    for (const auto& event : message_events) {
+      writer->BeginStruct();
+      writer->I64(1, absl::ToUnixMicros(event.timestamp()));
+      writer->BeginStructList(2, 4);
+      WriteTag("message.type",
+               event.event().type() ==
+                       ::opencensus::trace::exporter::MessageEvent::Type::SENT
+                   ? absl::string_view("SENT")
+                   : absl::string_view("RECEIVED"),
+               writer);
+      WriteTag("message.id", static_cast<int64_t>(event.event().id()), writer);
+      WriteTag("message.compressed_size",
+               static_cast<int64_t>(event.event().compressed_size()), writer);
+      WriteTag("message.uncompressed_size",
+               static_cast<int64_t>(event.event().uncompressed_size()),
+               writer);
+      writer->EndStruct();
+    }
+  }
+  writer->Stop();
+}
+
+}  // namespace
+
+JaegerEncoder::JaegerEncoder(
+    absl::string_view service_name,
+    const std::unordered_map<std::string, std::string>& process_tags) {
+  CompactWriter writer(&process_);
+  writer.String(1, service_name);
+  if (!process_tags.empty()) {
+    writer.BeginStructList(2, process_tags.size());
+    for (const auto& tag : process_tags) {
+      WriteTag(tag.first, absl::string_view(tag.second), &writer);
+    }
+  }
+  writer.Stop();
+}
+
+void JaegerEncoder::StartPacket(uint32_t sequence_id, size_t num_spans,
+                                std::string* packet) {
+  packet->clear();
+  packet->append(kMessageHeader, sizeof(kMessageHeader));
+  AppendVarint(sequence_id, packet);
+  AppendVarint(sizeof(kEmitBatch) - 1, packet);
+  packet->append(kEmitBatch, sizeof(kEmitBatch) - 1);
+  // The arguments struct, holding the batch as field 1.
+  CompactWriter writer(packet);
+  writer.BeginStructField(1);
+  writer.BeginStructField(1);
+  packet->append(process_, 0, process_.size() - 1);
+  writer.EndStruct();
+  writer.BeginStructList(2, num_spans);
+}
+
+size_t JaegerEncoder::Encode(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+    size_t max_packet_size, std::vector<std::string>* packets,
+    size_t* num_dropped) {
+  // The packet without spans. The sequence id and the list size each grow by
+  // at most 4 bytes, and the batch and arguments structs end with 2 stops.
+  std::string empty;
+  StartPacket(0, 0, &empty);
+  const size_t overhead = empty.size() + 4 + 4 + 2;
+
+  // Encode the spans, dropping those that do not fit in a packet of their own.
+  *num_dropped = 0;
+  size_t num_spans = 0;
+  if (spans_.size() < spans.size()) spans_.resize(spans.size());
+  for (const auto& span : spans) {
+    std::string* encoded = &spans_[num_spans];
+    encoded->clear();
+    CompactWriter writer(encoded);
+    WriteSpan(span, &writer);
+    if (overhead + encoded->size() > max_packet_size) {
+      ++*num_dropped;
+    } else {
+      ++num_spans;
+    }
+  }
+
+  size_t num_packets = 0;
+  size_t begin = 0;
+  while (begin < num_spans) {
+    size_t end = begin + 1;
+    size_t size = overhead + spans_[begin].size();
+    while (end < num_spans && size + spans_[end].size() <= max_packet_size) {
+      size += spans_[end].size();
+      ++end;
+    }
+    if (packets->size() <= num_packets) packets->resize(num_packets + 1);
+    std::string* packet = &(*packets)[num_packets++];
+    StartPacket(sequence_id_++, end - begin, packet);
+    for (size_t i = begin; i < end; ++i) {
+      packet->append(spans_[i]);
+    }
+    // End the batch and the arguments struct.
+    packet->push_back(0);
+    packet->push_back(0);
+    begin = end;
+  }
+  return num_packets;
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
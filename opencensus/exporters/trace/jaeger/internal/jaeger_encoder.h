@@ -0,0 +1,82 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_JAEGER_INTERNAL_JAEGER_ENCODER_H_
+#define OPENCENSUS_EXPORTERS_TRACE_JAEGER_INTERNAL_JAEGER_ENCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/trace/exporter/span_data.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+// Encodes spans as Agent.emitBatch() calls, from
+// https://github.com/jaegertracing/jaeger-idl/blob/master/thrift/agent.thrift,
+// in the compact Thrift protocol, writing the wire format directly. The
+// fields used are:
+//
+//   struct Tag { 1: string key; 2: TagType vType; 3: string vStr;
+//                5: bool vBool; 6: i64 vLong }
+//   struct Log { 1: i64 timestamp; 2: list<Tag> fields }
+//   struct SpanRef { 1: SpanRefType refType; 2: i64 traceIdLow;
+//                    3: i64 traceIdHigh; 4: i64 spanId }
+//   struct Span { 1: i64 traceIdLow; 2: i64 traceIdHigh; 3: i64 spanId;
+//                 4: i64 parentSpanId; 5: string operationName;
+//                 6: list<SpanRef> references; 7: i32 flags;
+//                 8: i64 startTime; 9: i64 duration; 10: list<Tag> tags;
+//                 11: list<Log> logs }
+//   struct Process { 1: string serviceName; 2: list<Tag> tags }
+//   struct Batch { 1: Process process; 2: list<Span> spans }
+//
+// JaegerEncoder is thread-compatible.
+class JaegerEncoder final {
+ public:
+  JaegerEncoder(
+      absl::string_view service_name,
+      const std::unordered_map<std::string, std::string>& process_tags);
+
+  // Encodes 'spans' into the first elements of *packets (reusing their
+  // capacity), each a complete emitBatch() message of as many spans as fit in
+  // max_packet_size bytes. Returns the number of packets. Spans that do not
+  // fit in a packet of their own are skipped and counted in *num_dropped.
+  size_t Encode(
+      const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+      size_t max_packet_size, std::vector<std::string>* packets,
+      size_t* num_dropped);
+
+ private:
+  // Replaces *packet with the message header and the batch up to the spans'
+  // list header, for a batch of 'num_spans' spans.
+  void StartPacket(uint32_t sequence_id, size_t num_spans,
+                   std::string* packet);
+
+  // The encoded Process struct, which is the same for every batch.
+  std::string process_;
+  // The encoding of each span, as a list element.
+  std::vector<std::string> spans_;
+  uint32_t sequence_id_ = 0;
+};
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_JAEGER_INTERNAL_JAEGER_ENCODER_H_
@@ -0,0 +1,178 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/jaeger/internal/jaeger_encoder.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace exporter {
+
+class SpanExporterTestPeer {
+ public:
+  static constexpr auto& ExportForTesting = SpanExporter::ExportForTesting;
+};
+
+}  // namespace exporter
+}  // namespace trace
+}  // namespace opencensus
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+using ::opencensus::trace::exporter::SpanData;
+
+class Collector : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  explicit Collector(std::vector<SpanData>* spans) : spans_(spans) {}
+  void Export(const std::vector<SpanData>& spans) override {
+    spans_->insert(spans_->end(), spans.begin(), spans.end());
+  }
+
+ private:
+  std::vector<SpanData>* const spans_;
+};
+
+// Returns ended spans with the given names.
+std::vector<SpanData> MakeSpans(const std::vector<std::string>& names) {
+  static std::vector<SpanData>* collected = [] {
+    auto* spans = new std::vector<SpanData>;
+    ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
+        absl::make_unique<Collector>(spans));
+    return spans;
+  }();
+  static ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  for (const auto& name : names) {
+    auto span = ::opencensus::trace::Span::StartSpan(name, nullptr, opts);
+    span.AddAttribute("key", "value");
+    span.AddAnnotation("annotation");
+    span.End();
+  }
+  collected->clear();
+  ::opencensus::trace::exporter::SpanExporterTestPeer::ExportForTesting();
+  return *collected;
+}
+
+// The start of a packet for service "svc" without process tags, up to the
+// spans' list header: the message header, the sequence id, the method name,
+// the arguments and batch struct fields, the process, and the list field.
+std::string PacketPrefix(char sequence_id, size_t num_spans) {
+  std::string prefix = "\x82\x81";
+  prefix.push_back(sequence_id);
+  prefix.append("\x09" "emitBatch");
+  prefix.append("\x1c\x1c\x18\x03" "svc");
+  prefix.push_back('\0');
+  prefix.push_back('\x19');
+  prefix.push_back(static_cast<char>((num_spans << 4) | 0x0c));
+  return prefix;
+}
+
+bool HasEnd(absl::string_view packet) {
+  return absl::EndsWith(packet, absl::string_view("\0\0\0", 3));
+}
+
+TEST(JaegerEncoderTest, EncodesBatch) {
+  const std::vector<SpanData> spans = MakeSpans({"Span1", "Span2"});
+  ASSERT_EQ(2, spans.size());
+
+  JaegerEncoder encoder("svc", {});
+  std::vector<std::string> packets;
+  size_t num_dropped;
+  ASSERT_EQ(1, encoder.Encode(spans, 65000, &packets, &num_dropped));
+  EXPECT_EQ(0, num_dropped);
+  EXPECT_TRUE(absl::StartsWith(packets[0], PacketPrefix(0, 2)));
+  // Each span, then the batch and the arguments, end with a stop.
+  EXPECT_TRUE(HasEnd(packets[0]));
+  EXPECT_THAT(packets[0], ::testing::HasSubstr("Span1"));
+  EXPECT_THAT(packets[0], ::testing::HasSubstr("Span2"));
+  EXPECT_THAT(packets[0], ::testing::HasSubstr("annotation"));
+
+  // Sequence ids increase across calls.
+  ASSERT_EQ(1, encoder.Encode(spans, 65000, &packets, &num_dropped));
+  EXPECT_TRUE(absl::StartsWith(packets[0], PacketPrefix(1, 2)));
+}
+
+TEST(JaegerEncoderTest, EncodesProcessTags) {
+  JaegerEncoder encoder("svc", {{"hostname", "h1"}});
+  std::vector<std::string> packets;
+  size_t num_dropped;
+  ASSERT_EQ(1, encoder.Encode(MakeSpans({"Span"}), 65000, &packets,
+                              &num_dropped));
+  // The process has a list of one Tag struct.
+  EXPECT_THAT(packets[0], ::testing::HasSubstr(
+                              "\x18\x03" "svc" "\x19\x1c\x18\x08" "hostname"));
+  EXPECT_THAT(packets[0], ::testing::HasSubstr("h1"));
+}
+
+TEST(JaegerEncoderTest, PacksSpansIntoPackets) {
+  const std::string long_name(100, 'x');
+  const std::vector<SpanData> spans =
+      MakeSpans({long_name, long_name, long_name, long_name, long_name});
+  ASSERT_EQ(5, spans.size());
+
+  JaegerEncoder encoder("svc", {});
+  std::vector<std::string> packets;
+  size_t num_dropped;
+  const size_t max_packet_size = 500;
+  const size_t num_packets =
+      encoder.Encode(spans, max_packet_size, &packets, &num_dropped);
+  EXPECT_EQ(0, num_dropped);
+  ASSERT_GT(num_packets, 1);
+  ASSERT_LT(num_packets, 5);
+  size_t num_spans = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    EXPECT_LE(packets[i].size(), max_packet_size);
+    EXPECT_TRUE(HasEnd(packets[i]));
+    const size_t packet_spans =
+        static_cast<unsigned char>(packets[i][PacketPrefix(0, 0).size() - 1]) >>
+        4;
+    EXPECT_TRUE(
+        absl::StartsWith(packets[i], PacketPrefix(i, packet_spans)));
+    num_spans += packet_spans;
+  }
+  EXPECT_EQ(5, num_spans);
+}
+
+TEST(JaegerEncoderTest, DropsOversizeSpans) {
+  const std::vector<SpanData> spans =
+      MakeSpans({"small", std::string(1000, 'x'), "small"});
+
+  JaegerEncoder encoder("svc", {});
+  std::vector<std::string> packets;
+  size_t num_dropped;
+  ASSERT_EQ(1, encoder.Encode(spans, 500, &packets, &num_dropped));
+  EXPECT_EQ(1, num_dropped);
+  EXPECT_TRUE(absl::StartsWith(packets[0], PacketPrefix(0, 2)));
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
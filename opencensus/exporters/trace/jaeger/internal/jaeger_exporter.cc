@@ -0,0 +1,159 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/jaeger/jaeger_exporter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/trace/jaeger/internal/jaeger_encoder.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+namespace {
+
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "jaeger";
+
+// Returns a nonblocking UDP socket connected to 'address' ("host:port"), or
+// -1, setting *error.
+int Connect(const std::string& address, std::string* error) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    *error = "missing port";
+    return -1;
+  }
+  std::string host = address.substr(0, colon);
+  const std::string port = address.substr(colon + 1);
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_NUMERICSERV;
+  addrinfo* result = nullptr;
+  const int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+  if (status != 0) {
+    *error = gai_strerror(status);
+    return -1;
+  }
+  int fd = socket(result->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+    *error = absl::StrCat("socket setup failed: ", strerror(errno));
+    if (fd >= 0) close(fd);
+    fd = -1;
+  } else {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  freeaddrinfo(result);
+  return fd;
+}
+
+// Exports are serialized per handler, so the members need no locking.
+class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  explicit Handler(const JaegerExporterOptions& options)
+      : options_(options),
+        encoder_(options.service_name, options.process_tags),
+        fd_(Connect(options.agent_address, &socket_error_)) {}
+
+  ~Handler() override {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  void Export(const std::vector<::opencensus::trace::exporter::SpanData>&
+                  spans) override;
+
+ private:
+  const JaegerExporterOptions options_;
+  JaegerEncoder encoder_;
+  std::string socket_error_;
+  const int fd_;
+  // Reused across exports.
+  std::vector<std::string> packets_;
+  int64_t failed_exports_ = 0;
+};
+
+void Handler::Export(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
+  size_t num_dropped;
+  const size_t num_packets = encoder_.Encode(
+      spans, options_.max_packet_size, &packets_, &num_dropped);
+  std::string error;
+  if (num_dropped > 0) {
+    error = "span larger than max_packet_size";
+  }
+  size_t failed_packets = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    ssize_t sent = -1;
+    if (fd_ >= 0) {
+      do {
+        sent = send(fd_, packets_[i].data(), packets_[i].size(),
+                    MSG_DONTWAIT | MSG_NOSIGNAL);
+      } while (sent < 0 && errno == EINTR);
+    }
+    if (sent < 0) {
+      ++failed_packets;
+      error = fd_ < 0 ? socket_error_
+                      : absl::StrCat("send() failed: ", strerror(errno));
+    }
+  }
+  if (num_dropped > 0 || failed_packets > 0) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    if (num_dropped > 0) {
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kSpansDropped, num_dropped);
+    }
+    // Only report the first of a run of failures, e.g. while the agent is
+    // down.
+    if (failed_exports_++ == 0) {
+      std::cerr << "Dropping spans for the Jaeger agent at "
+                << options_.agent_address << ": " << error << "\n";
+    }
+  } else {
+    failed_exports_ = 0;
+  }
+}
+
+}  // namespace
+
+// static
+void JaegerExporter::Register(const JaegerExporterOptions& options) {
+  ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
+      absl::make_unique<Handler>(options));
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,57 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_JAEGER_JAEGER_EXPORTER_H_
+#define OPENCENSUS_EXPORTERS_TRACE_JAEGER_JAEGER_EXPORTER_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+struct JaegerExporterOptions {
+  // The "host:port" of the Jaeger agent's compact Thrift UDP endpoint.
+  std::string agent_address = "127.0.0.1:6831";
+
+  // The service name of the process, and any other process tags.
+  std::string service_name;
+  std::unordered_map<std::string, std::string> process_tags;
+
+  // Spans are packed into datagrams of at most this many bytes, the agent's
+  // default maximum packet size. A span too large for a datagram of its own
+  // is dropped.
+  size_t max_packet_size = 65000;
+};
+
+// Exports spans to a Jaeger agent, usually on the same host, as emitBatch()
+// calls in the compact Thrift protocol over UDP. As many spans as fit are
+// packed into each datagram. Datagrams are dropped, without blocking, if the
+// agent is not keeping up.
+// JaegerExporter is thread-safe.
+class JaegerExporter {
+ public:
+  static void Register(const JaegerExporterOptions& options);
+
+ private:
+  JaegerExporter() = delete;
+};
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_JAEGER_JAEGER_EXPORTER_H_
@@ -0,0 +1,176 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/otlp/otlp_exporter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/common/internal/grpc/status.h"
+#include "opencensus/common/internal/grpc/with_user_agent.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/trace/otlp/internal/otlp_utils.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opentelemetry/proto/collector/trace/v1/trace_service.grpc.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+// The size of the arena block kept across requests.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "otlp_trace";
+
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
+}
+
+class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  Handler(const OtlpOptions& opts,
+          const std::shared_ptr<grpc::Channel>& channel);
+  ~Handler() override;
+
+  // Called only from the SpanExporter's thread, so the pending request needs
+  // no locking.
+  void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
+      override;
+
+ private:
+  // Starts a new pending request on arena_.
+  void StartRequest();
+  // Sends the pending request, if it holds any spans, and starts a new one.
+  void Flush();
+
+  const OtlpOptions opts_;
+  std::unique_ptr<otlp::collector::trace::v1::TraceService::Stub> stub_;
+  std::unique_ptr<char[]> arena_block_;
+  google::protobuf::Arena arena_;
+  otlp::collector::trace::v1::ExportTraceServiceRequest* request_ = nullptr;
+  otlp::trace::v1::ScopeSpans* scope_spans_ = nullptr;
+  size_t pending_bytes_ = 0;
+  // When the oldest pending span was buffered.
+  absl::Time pending_since_;
+};
+
+Handler::Handler(const OtlpOptions& opts,
+                 const std::shared_ptr<grpc::Channel>& channel)
+    : opts_(opts),
+      stub_(otlp::collector::trace::v1::TraceService::NewStub(channel)),
+      arena_block_(new char[kArenaInitialBlockSize]),
+      arena_(ArenaOptionsWithBlock(arena_block_.get())) {
+  StartRequest();
+}
+
+Handler::~Handler() { Flush(); }
+
+void Handler::Export(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
+  const int max_spans = std::max(1, opts_.max_batch_spans);
+  for (const auto& span : spans) {
+    if (scope_spans_->spans_size() == 0) {
+      pending_since_ = absl::Now();
+    }
+    pending_bytes_ += AddSpan(span, scope_spans_)->ByteSizeLong();
+    if (scope_spans_->spans_size() >= max_spans ||
+        pending_bytes_ >= opts_.max_batch_bytes) {
+      Flush();
+    }
+  }
+  if (scope_spans_->spans_size() > 0 &&
+      absl::Now() - pending_since_ >= opts_.flush_interval) {
+    Flush();
+  }
+}
+
+void Handler::StartRequest() {
+  request_ = google::protobuf::Arena::CreateMessage<
+      otlp::collector::trace::v1::ExportTraceServiceRequest>(&arena_);
+  otlp::trace::v1::ResourceSpans* resource_spans =
+      request_->add_resource_spans();
+  SetResource(opts_.service_name, opts_.resource_attributes,
+              resource_spans->mutable_resource());
+  scope_spans_ = resource_spans->add_scope_spans();
+  SetScope(scope_spans_);
+  pending_bytes_ = 0;
+}
+
+void Handler::Flush() {
+  if (scope_spans_->spans_size() > 0) {
+    grpc::ClientContext context;
+    const absl::Time start_time = absl::Now();
+    context.set_deadline(absl::ToChronoTime(start_time + opts_.rpc_deadline));
+    if (opts_.gzip_compression) {
+      context.set_compression_algorithm(GRPC_COMPRESS_GZIP);
+    }
+    otlp::collector::trace::v1::ExportTraceServiceResponse response;
+    OPENCENSUS_PROBE2(export_rpc_begin, kExporterName, &context);
+    const grpc::Status status = stub_->Export(&context, *request_, &response);
+    OPENCENSUS_PROBE3(export_rpc_end, kExporterName, &context,
+                      static_cast<int>(status.error_code()));
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcLatency,
+        absl::ToDoubleMilliseconds(absl::Now() - start_time), kExporterName);
+    if (!status.ok()) {
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+      std::cerr << "OTLP trace export of " << scope_spans_->spans_size()
+                << " spans failed: " << opencensus::common::ToString(status)
+                << "\n";
+    } else if (response.has_partial_success() &&
+               response.partial_success().rejected_spans() > 0) {
+      std::cerr << "OTLP receiver rejected "
+                << response.partial_success().rejected_spans()
+                << " spans: " << response.partial_success().error_message()
+                << "\n";
+    }
+  }
+  // Keeps the initial block for the next request.
+  arena_.Reset();
+  StartRequest();
+}
+
+}  // namespace
+
+// static
+void OtlpExporter::Register(const OtlpOptions& opts) {
+  auto channel = ::grpc::CreateCustomChannel(
+      opts.endpoint,
+      opts.use_tls ? ::grpc::SslCredentials(::grpc::SslCredentialsOptions())
+                   : ::grpc::InsecureChannelCredentials(),
+      ::opencensus::common::WithUserAgent());
+  ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
+      absl::make_unique<Handler>(opts, channel));
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,200 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/otlp/internal/otlp_utils.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/common/version.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opentelemetry/proto/common/v1/common.pb.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+#include "opentelemetry/proto/trace/v1/trace.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+
+constexpr char kServiceNameKey[] = "service.name";
+constexpr char kScopeName[] = "opencensus-cpp";
+constexpr char kMessageEventName[] = "message";
+constexpr char kMessageTypeKey[] = "message.type";
+constexpr char kMessageIdKey[] = "message.id";
+constexpr char kMessageCompressedSizeKey[] = "message.compressed_size";
+constexpr char kMessageUncompressedSizeKey[] = "message.uncompressed_size";
+
+using RepeatedKeyValue =
+    ::google::protobuf::RepeatedPtrField<otlp::common::v1::KeyValue>;
+
+uint64_t UnixNanos(absl::Time t) {
+  return static_cast<uint64_t>(absl::ToUnixNanos(t));
+}
+
+void SetTraceId(const ::opencensus::trace::TraceId& id, std::string* bytes) {
+  uint8_t buf[::opencensus::trace::TraceId::kSize];
+  id.CopyTo(buf);
+  bytes->assign(reinterpret_cast<const char*>(buf), sizeof(buf));
+}
+
+void SetSpanId(const ::opencensus::trace::SpanId& id, std::string* bytes) {
+  uint8_t buf[::opencensus::trace::SpanId::kSize];
+  id.CopyTo(buf);
+  bytes->assign(reinterpret_cast<const char*>(buf), sizeof(buf));
+}
+
+otlp::common::v1::AnyValue* AddAttribute(absl::string_view key,
+                                         RepeatedKeyValue* attributes) {
+  otlp::common::v1::KeyValue* attribute = attributes->Add();
+  attribute->set_key(key.data(), key.size());
+  return attribute->mutable_value();
+}
+
+void ConvertAttributes(
+    const std::unordered_map<
+        std::string, ::opencensus::trace::exporter::AttributeValue>& from,
+    RepeatedKeyValue* to) {
+  to->Reserve(to->size() + from.size());
+  for (const auto& attr : from) {
+    otlp::common::v1::AnyValue* value = AddAttribute(attr.first, to);
+    using Type = ::opencensus::trace::exporter::AttributeValue::Type;
+    switch (attr.second.type()) {
+      case Type::kString:
+        value->set_string_value(attr.second.string_value());
+        break;
+      case Type::kBool:
+        value->set_bool_value(attr.second.bool_value());
+        break;
+      case Type::kInt:
+        value->set_int_value(attr.second.int_value());
+        break;
+    }
+  }
+}
+
+void ConvertTimeEvents(const ::opencensus::trace::exporter::SpanData& span,
+                       otlp::trace::v1::Span* proto_span) {
+  proto_span->mutable_events()->Reserve(
+      span.annotations().events().size() +
+      span.message_events().events().size());
+  for (const auto& annotation : span.annotations().events()) {
+    otlp::trace::v1::Span::Event* event = proto_span->add_events();
+    event->set_time_unix_nano(UnixNanos(annotation.timestamp()));
+    const absl::string_view description = annotation.event().description();
+    event->set_name(description.data(), description.size());
+    ConvertAttributes(annotation.event().attributes(),
+                      event->mutable_attributes());
+  }
+  for (const auto& message : span.message_events().events()) {
+    otlp::trace::v1::Span::Event* event = proto_span->add_events();
+    event->set_time_unix_nano(UnixNanos(message.timestamp()));
+    event->set_name(kMessageEventName);
+    RepeatedKeyValue* attributes = event->mutable_attributes();
+    AddAttribute(kMessageTypeKey, attributes)
+        ->set_string_value(
+            message.event().type() ==
+                    ::opencensus::trace::exporter::MessageEvent::Type::SENT
+                ? "SENT"
+                : "RECEIVED");
+    AddAttribute(kMessageIdKey, attributes)
+        ->set_int_value(message.event().id());
+    AddAttribute(kMessageCompressedSizeKey, attributes)
+        ->set_int_value(message.event().compressed_size());
+    AddAttribute(kMessageUncompressedSizeKey, attributes)
+        ->set_int_value(message.event().uncompressed_size());
+  }
+  proto_span->set_dropped_events_count(
+      span.annotations().dropped_events_count() +
+      span.message_events().dropped_events_count());
+}
+
+void ConvertLinks(const ::opencensus::trace::exporter::SpanData& span,
+                  otlp::trace::v1::Span* proto_span) {
+  proto_span->mutable_links()->Reserve(span.links().size());
+  for (const auto& span_link : span.links()) {
+    otlp::trace::v1::Span::Link* link = proto_span->add_links();
+    SetTraceId(span_link.trace_id(), link->mutable_trace_id());
+    SetSpanId(span_link.span_id(), link->mutable_span_id());
+    ConvertAttributes(span_link.attributes(), link->mutable_attributes());
+  }
+  proto_span->set_dropped_links_count(span.num_links_dropped());
+}
+
+}  // namespace
+
+void SetResource(
+    absl::string_view service_name,
+    const std::unordered_map<std::string, std::string>& attributes,
+    otlp::resource::v1::Resource* resource) {
+  RepeatedKeyValue* resource_attributes = resource->mutable_attributes();
+  if (!service_name.empty()) {
+    AddAttribute(kServiceNameKey, resource_attributes)
+        ->set_string_value(service_name.data(), service_name.size());
+  }
+  for (const auto& attr : attributes) {
+    AddAttribute(attr.first, resource_attributes)
+        ->set_string_value(attr.second);
+  }
+}
+
+void SetScope(otlp::trace::v1::ScopeSpans* scope_spans) {
+  scope_spans->mutable_scope()->set_name(kScopeName);
+  scope_spans->mutable_scope()->set_version(OPENCENSUS_VERSION);
+}
+
+otlp::trace::v1::Span* AddSpan(
+    const ::opencensus::trace::exporter::SpanData& span,
+    otlp::trace::v1::ScopeSpans* scope_spans) {
+  otlp::trace::v1::Span* proto_span = scope_spans->add_spans();
+  SetTraceId(span.context().trace_id(), proto_span->mutable_trace_id());
+  SetSpanId(span.context().span_id(), proto_span->mutable_span_id());
+  // Root spans have no parent_span_id.
+  if (span.parent_span_id().IsValid()) {
+    SetSpanId(span.parent_span_id(), proto_span->mutable_parent_span_id());
+  }
+  proto_span->set_name(span.name().data(), span.name().size());
+  proto_span->set_start_time_unix_nano(UnixNanos(span.start_time()));
+  proto_span->set_end_time_unix_nano(UnixNanos(span.end_time()));
+
+  ConvertAttributes(span.attributes(), proto_span->mutable_attributes());
+  proto_span->set_dropped_attributes_count(span.num_attributes_dropped());
+  ConvertTimeEvents(span, proto_span);
+  ConvertLinks(span, proto_span);
+
+  // OTLP only distinguishes errors; the canonical code is kept in the message.
+  if (span.status().ok()) {
+    proto_span->mutable_status()->set_code(
+        otlp::trace::v1::Status::STATUS_CODE_OK);
+  } else {
+    proto_span->mutable_status()->set_code(
+        otlp::trace::v1::Status::STATUS_CODE_ERROR);
+    proto_span->mutable_status()->set_message(span.status().ToString());
+  }
+  return proto_span;
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
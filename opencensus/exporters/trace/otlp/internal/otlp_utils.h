@@ -0,0 +1,50 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_OTLP_INTERNAL_OTLP_UTILS_H_
+#define OPENCENSUS_EXPORTERS_TRACE_OTLP_INTERNAL_OTLP_UTILS_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+#include "opentelemetry/proto/trace/v1/trace.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+// Sets the attributes of 'resource' to 'service_name' (as service.name, if not
+// empty) and 'attributes'.
+void SetResource(
+    absl::string_view service_name,
+    const std::unordered_map<std::string, std::string>& attributes,
+    opentelemetry::proto::resource::v1::Resource* resource);
+
+// Sets the instrumentation scope of 'scope_spans' to this library.
+void SetScope(opentelemetry::proto::trace::v1::ScopeSpans* scope_spans);
+
+// Converts 'span' to OTLP, adding it to 'scope_spans'. Message events become
+// events named "message" with the message.* attributes used by OpenTelemetry.
+opentelemetry::proto::trace::v1::Span* AddSpan(
+    const ::opencensus::trace::exporter::SpanData& span,
+    opentelemetry::proto::trace::v1::ScopeSpans* scope_spans);
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_OTLP_INTERNAL_OTLP_UTILS_H_
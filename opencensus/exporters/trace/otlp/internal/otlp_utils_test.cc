@@ -0,0 +1,167 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/exporters/trace/otlp/internal/otlp_utils.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opentelemetry/proto/resource/v1/resource.pb.h"
+#include "opentelemetry/proto/trace/v1/trace.pb.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+namespace otlp = ::opentelemetry::proto;
+using ::opencensus::trace::SpanContext;
+using ::opencensus::trace::SpanId;
+using ::opencensus::trace::TraceId;
+using ::opencensus::trace::exporter::Annotation;
+using ::opencensus::trace::exporter::AttributeValue;
+using ::opencensus::trace::exporter::Link;
+using ::opencensus::trace::exporter::MessageEvent;
+using ::opencensus::trace::exporter::SpanData;
+using ::opencensus::trace::exporter::Status;
+
+constexpr uint8_t kTraceId[] = {1, 2,  3,  4,  5,  6,  7,  8,
+                                9, 10, 11, 12, 13, 14, 15, 16};
+constexpr uint8_t kSpanId[] = {1, 1, 1, 1, 1, 1, 1, 1};
+constexpr uint8_t kParentSpanId[] = {2, 2, 2, 2, 2, 2, 2, 2};
+
+using Attributes = std::unordered_map<std::string, AttributeValue>;
+
+SpanData MakeSpan(SpanId parent_span_id, Status status) {
+  const absl::Time start = absl::FromUnixSeconds(1000);
+  std::vector<SpanData::TimeEvent<Annotation>> annotations;
+  annotations.emplace_back(
+      start + absl::Milliseconds(1),
+      Annotation("annotation",
+                 Attributes({{"key", AttributeValue(
+                                         ::opencensus::trace::
+                                             AttributeValueRef("value"))}})));
+  std::vector<SpanData::TimeEvent<MessageEvent>> message_events;
+  message_events.emplace_back(
+      start + absl::Milliseconds(2),
+      MessageEvent(MessageEvent::Type::SENT, 3, 4, 5));
+  std::vector<Link> links;
+  links.emplace_back(SpanContext(TraceId(kTraceId), SpanId(kParentSpanId)),
+                     Link::Type::kParentLinkedSpan);
+  return SpanData(
+      "span", SpanContext(TraceId(kTraceId), SpanId(kSpanId)), parent_span_id,
+      SpanData::TimeEvents<Annotation>(std::move(annotations), 1),
+      SpanData::TimeEvents<MessageEvent>(std::move(message_events), 2),
+      std::move(links), 3,
+      Attributes(
+          {{"int", AttributeValue(::opencensus::trace::AttributeValueRef(4))},
+           {"bool",
+            AttributeValue(::opencensus::trace::AttributeValueRef(true))}}),
+      5, true, start, start + absl::Seconds(1), status, false);
+}
+
+TEST(OtlpUtilsTest, SetResource) {
+  otlp::resource::v1::Resource resource;
+  SetResource("service", {{"host", "localhost"}}, &resource);
+  ASSERT_EQ(2, resource.attributes_size());
+  EXPECT_EQ("service.name", resource.attributes(0).key());
+  EXPECT_EQ("service", resource.attributes(0).value().string_value());
+  EXPECT_EQ("host", resource.attributes(1).key());
+  EXPECT_EQ("localhost", resource.attributes(1).value().string_value());
+
+  otlp::resource::v1::Resource no_service;
+  SetResource("", {}, &no_service);
+  EXPECT_EQ(0, no_service.attributes_size());
+}
+
+TEST(OtlpUtilsTest, AddSpan) {
+  otlp::trace::v1::ScopeSpans scope_spans;
+  SetScope(&scope_spans);
+  EXPECT_EQ("opencensus-cpp", scope_spans.scope().name());
+  const otlp::trace::v1::Span& span =
+      *AddSpan(MakeSpan(SpanId(kParentSpanId), Status()), &scope_spans);
+  ASSERT_EQ(1, scope_spans.spans_size());
+
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(kTraceId), 16),
+            span.trace_id());
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(kSpanId), 8),
+            span.span_id());
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(kParentSpanId), 8),
+            span.parent_span_id());
+  EXPECT_EQ("span", span.name());
+  EXPECT_EQ(1000000000000, span.start_time_unix_nano());
+  EXPECT_EQ(1001000000000, span.end_time_unix_nano());
+
+  ASSERT_EQ(2, span.attributes_size());
+  for (const auto& attribute : span.attributes()) {
+    if (attribute.key() == "int") {
+      EXPECT_EQ(4, attribute.value().int_value());
+    } else {
+      EXPECT_EQ("bool", attribute.key());
+      EXPECT_TRUE(attribute.value().bool_value());
+    }
+  }
+  EXPECT_EQ(5, span.dropped_attributes_count());
+
+  ASSERT_EQ(2, span.events_size());
+  EXPECT_EQ("annotation", span.events(0).name());
+  EXPECT_EQ(1000001000000, span.events(0).time_unix_nano());
+  ASSERT_EQ(1, span.events(0).attributes_size());
+  EXPECT_EQ("value", span.events(0).attributes(0).value().string_value());
+  EXPECT_EQ("message", span.events(1).name());
+  ASSERT_EQ(4, span.events(1).attributes_size());
+  EXPECT_EQ("message.type", span.events(1).attributes(0).key());
+  EXPECT_EQ("SENT", span.events(1).attributes(0).value().string_value());
+  EXPECT_EQ(3, span.events(1).attributes(1).value().int_value());
+  EXPECT_EQ(4, span.events(1).attributes(2).value().int_value());
+  EXPECT_EQ(5, span.events(1).attributes(3).value().int_value());
+  EXPECT_EQ(3, span.dropped_events_count());
+
+  ASSERT_EQ(1, span.links_size());
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(kParentSpanId), 8),
+            span.links(0).span_id());
+  EXPECT_EQ(3, span.dropped_links_count());
+
+  EXPECT_EQ(otlp::trace::v1::Status::STATUS_CODE_OK, span.status().code());
+}
+
+TEST(OtlpUtilsTest, AddRootSpanWithError) {
+  otlp::trace::v1::ScopeSpans scope_spans;
+  const otlp::trace::v1::Span& span = *AddSpan(
+      MakeSpan(SpanId(),
+               Status(::opencensus::trace::StatusCode::NOT_FOUND, "missing")),
+      &scope_spans);
+  EXPECT_TRUE(span.parent_span_id().empty());
+  EXPECT_EQ(otlp::trace::v1::Status::STATUS_CODE_ERROR, span.status().code());
+  EXPECT_THAT(span.status().message(), ::testing::HasSubstr("missing"));
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
@@ -14,18 +14,26 @@
 
 #include "opencensus/exporters/trace/stackdriver/stackdriver_exporter.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <grpcpp/grpcpp.h>
-#include "absl/base/macros.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
+#include "absl/types/span.h"
 #include "google/devtools/cloudtrace/v2/tracing.grpc.pb.h"
+#include "google/protobuf/arena.h"
+#include "opencensus/common/internal/grpc/shared_channel.h"
 #include "opencensus/common/internal/grpc/status.h"
-#include "opencensus/common/internal/grpc/with_user_agent.h"
-#include "opencensus/common/version.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/trace/stackdriver/internal/stackdriver_utils.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/span_exporter.h"
 
@@ -34,237 +42,187 @@ namespace exporters {
 namespace trace {
 namespace {
 
-constexpr size_t kAttributeStringLen = 256;
-constexpr size_t kAnnotationStringLen = 256;
-constexpr size_t kDisplayNameStringLen = 128;
-constexpr char kGoogleStackdriverTraceAddress[] = "cloudtrace.googleapis.com";
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "stackdriver_trace";
+// The size of the arena block kept across exports.
+constexpr size_t kArenaInitialBlockSize = 64 << 10;
 
-constexpr char kAgentKey[] = "g.co/agent";
-constexpr char kAgentValue[] = "opencensus-cpp [" OPENCENSUS_VERSION "]";
-
-bool Validate(const google::protobuf::Timestamp& t) {
-  const auto sec = t.seconds();
-  const auto ns = t.nanos();
-  // sec must be [0001-01-01T00:00:00Z, 9999-12-31T23:59:59.999999999Z]
-  if (sec < -62135596800 || sec > 253402300799) {
-    return false;
-  }
-  if (ns < 0 || ns > 999999999) {
-    return false;
-  }
-  return true;
+google::protobuf::ArenaOptions ArenaOptionsWithBlock(char* block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaInitialBlockSize;
+  return options;
 }
 
-bool EncodeTimestampProto(absl::Time t, google::protobuf::Timestamp* proto) {
-  const int64_t s = absl::ToUnixSeconds(t);
-  proto->set_seconds(s);
-  proto->set_nanos((t - absl::FromUnixSeconds(s)) / absl::Nanoseconds(1));
-  return Validate(*proto);
-}
+class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  Handler(const StackdriverOptions& opts,
+          const std::vector<std::shared_ptr<grpc::Channel>>& channels);
+  ~Handler() override;
 
-void SetTruncatableString(
-    absl::string_view str, size_t max_len,
-    ::google::devtools::cloudtrace::v2::TruncatableString* t_str) {
-  if (str.size() > max_len) {
-    t_str->set_value(std::string(str.substr(0, max_len)));
-    t_str->set_truncated_byte_count(str.size() - max_len);
-  } else {
-    t_str->set_value(std::string(str));
-    t_str->set_truncated_byte_count(0);
-  }
-}
+  void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
+      override;
+
+ private:
+  // A BatchWriteSpans request, built on the batch's arena, and the state of
+  // its RPC. Batches are reused across exports.
+  struct Batch {
+    Batch()
+        : arena_block(new char[kArenaInitialBlockSize]),
+          arena(ArenaOptionsWithBlock(arena_block.get())) {}
+
+    std::unique_ptr<char[]> arena_block;
+    google::protobuf::Arena arena;
+    ::google::devtools::cloudtrace::v2::BatchWriteSpansRequest* request =
+        nullptr;
+    // A ClientContext may not be reused, so each RPC gets a new one.
+    std::unique_ptr<grpc::ClientContext> context;
+    absl::Time start_time;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<google::protobuf::Empty>>
+        reader;
+    google::protobuf::Empty response;
+    grpc::Status status;
+  };
+
+  // Returns a batch holding an empty request, or nullptr if
+  // opts_.max_in_flight_batches are in flight.
+  std::unique_ptr<Batch> AcquireBatch() LOCKS_EXCLUDED(mu_);
+  // Clears 'batch' and makes it available to AcquireBatch().
+  void ReleaseBatch(std::unique_ptr<Batch> batch) LOCKS_EXCLUDED(mu_);
+  // Sends the request of 'batch', asynchronously if opts_.async_export.
+  void Send(std::unique_ptr<Batch> batch);
+  // Waits for asynchronous requests to complete, until cq_ is shut down.
+  void HandleCompletions();
 
-::google::devtools::cloudtrace::v2::Span_Link_Type ConvertLinkType(
-    ::opencensus::trace::exporter::Link::Type type) {
-  switch (type) {
-    case ::opencensus::trace::exporter::Link::Type::kChildLinkedSpan:
-      return ::google::devtools::cloudtrace::v2::
-          Span_Link_Type_CHILD_LINKED_SPAN;
-    case ::opencensus::trace::exporter::Link::Type::kParentLinkedSpan:
-      return ::google::devtools::cloudtrace::v2::
-          Span_Link_Type_PARENT_LINKED_SPAN;
+  const StackdriverOptions opts_;
+  // One stub per channel, used in turn by Send().
+  std::vector<
+      std::unique_ptr<google::devtools::cloudtrace::v2::TraceService::Stub>>
+      stubs_;
+  // Only accessed by Send(), on the export thread.
+  size_t next_stub_ = 0;
+  absl::Mutex mu_;
+  int num_in_flight_ GUARDED_BY(mu_) = 0;
+  std::vector<std::unique_ptr<Batch>> idle_batches_ GUARDED_BY(mu_);
+  grpc::CompletionQueue cq_;
+  // Runs HandleCompletions() if opts_.async_export.
+  std::thread completion_thread_;
+};
+
+Handler::Handler(const StackdriverOptions& opts,
+                 const std::vector<std::shared_ptr<grpc::Channel>>& channels)
+    : opts_(opts) {
+  for (const auto& channel : channels) {
+    stubs_.push_back(
+        ::google::devtools::cloudtrace::v2::TraceService::NewStub(channel));
+  }
+  if (opts_.async_export) {
+    completion_thread_ = std::thread(&Handler::HandleCompletions, this);
   }
-  return ::google::devtools::cloudtrace::v2::Span_Link_Type_TYPE_UNSPECIFIED;
 }
 
-::google::devtools::cloudtrace::v2::Span_TimeEvent_MessageEvent_Type
-ConvertMessageType(::opencensus::trace::exporter::MessageEvent::Type type) {
-  using Type = ::opencensus::trace::exporter::MessageEvent::Type;
-  switch (type) {
-    case Type::SENT:
-      return ::google::devtools::cloudtrace::v2::
-          Span_TimeEvent_MessageEvent_Type_SENT;
-    case Type::RECEIVED:
-      return ::google::devtools::cloudtrace::v2::
-          Span_TimeEvent_MessageEvent_Type_RECEIVED;
+Handler::~Handler() {
+  cq_.Shutdown();
+  if (completion_thread_.joinable()) {
+    completion_thread_.join();
+  } else {
+    HandleCompletions();
   }
-  return ::google::devtools::cloudtrace::v2::
-      Span_TimeEvent_MessageEvent_Type_TYPE_UNSPECIFIED;
 }
 
-using AttributeMap =
-    ::google::protobuf::Map<std::string,
-                            ::google::devtools::cloudtrace::v2::AttributeValue>;
-void PopulateAttributes(
-    const std::unordered_map<
-        std::string, ::opencensus::trace::exporter::AttributeValue>& attributes,
-    AttributeMap* attribute_map) {
-  for (const auto& attr : attributes) {
-    using Type = ::opencensus::trace::exporter::AttributeValue::Type;
-    switch (attr.second.type()) {
-      case Type::kString:
-        SetTruncatableString(
-            attr.second.string_value(), kAttributeStringLen,
-            (*attribute_map)[attr.first].mutable_string_value());
-        break;
-      case Type::kBool:
-        (*attribute_map)[attr.first].set_bool_value(attr.second.bool_value());
-        break;
-      case Type::kInt:
-        (*attribute_map)[attr.first].set_int_value(attr.second.int_value());
-        break;
+void Handler::Export(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
+  const size_t max_spans = std::max(1, opts_.max_spans_per_request);
+  const absl::Span<const ::opencensus::trace::exporter::SpanData> all_spans(
+      spans);
+  for (size_t begin = 0; begin < spans.size(); begin += max_spans) {
+    const auto batch_spans = all_spans.subspan(begin, max_spans);
+    std::unique_ptr<Batch> batch = AcquireBatch();
+    if (batch == nullptr) {
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kSpansDropped, batch_spans.size());
+      std::cerr << "Dropping " << batch_spans.size()
+                << " spans: too many BatchWriteSpans requests in flight.\n";
+      continue;
     }
+    ConvertSpans(batch_spans, opts_.project_id, batch->request);
+    Send(std::move(batch));
   }
 }
 
-void ConvertAttributes(const ::opencensus::trace::exporter::SpanData& span,
-                       ::google::devtools::cloudtrace::v2::Span* proto_span) {
-  ::google::devtools::cloudtrace::v2::Span::Attributes attributes;
-  PopulateAttributes(span.attributes(),
-                     proto_span->mutable_attributes()->mutable_attribute_map());
-  proto_span->mutable_attributes()->set_dropped_attributes_count(
-      span.num_attributes_dropped());
-}
-
-void ConvertTimeEvents(const ::opencensus::trace::exporter::SpanData& span,
-                       ::google::devtools::cloudtrace::v2::Span* proto_span) {
-  for (const auto& annotation : span.annotations().events()) {
-    auto event = proto_span->mutable_time_events()->add_time_event();
-
-    // Encode Timestamp
-    EncodeTimestampProto(annotation.timestamp(), event->mutable_time());
-
-    // Populate annotation.
-    SetTruncatableString(annotation.event().description(), kAnnotationStringLen,
-                         event->mutable_annotation()->mutable_description());
-    PopulateAttributes(annotation.event().attributes(),
-                       event->mutable_annotation()
-                           ->mutable_attributes()
-                           ->mutable_attribute_map());
+std::unique_ptr<Handler::Batch> Handler::AcquireBatch() {
+  std::unique_ptr<Batch> batch;
+  {
+    absl::MutexLock l(&mu_);
+    if (num_in_flight_ >= std::max(1, opts_.max_in_flight_batches)) {
+      return nullptr;
+    }
+    ++num_in_flight_;
+    if (!idle_batches_.empty()) {
+      batch = std::move(idle_batches_.back());
+      idle_batches_.pop_back();
+    }
   }
-
-  for (const auto& message : span.message_events().events()) {
-    auto event = proto_span->mutable_time_events()->add_time_event();
-
-    // Encode Timestamp
-    EncodeTimestampProto(message.timestamp(), event->mutable_time());
-
-    // Populate message event.
-    event->mutable_message_event()->set_type(
-        ConvertMessageType(message.event().type()));
-    event->mutable_message_event()->set_id(message.event().id());
-    event->mutable_message_event()->set_uncompressed_size_bytes(
-        message.event().uncompressed_size());
-    event->mutable_message_event()->set_compressed_size_bytes(
-        message.event().compressed_size());
+  if (batch == nullptr) {
+    batch = absl::make_unique<Batch>();
   }
-
-  proto_span->mutable_time_events()->set_dropped_annotations_count(
-      span.annotations().dropped_events_count());
-  proto_span->mutable_time_events()->set_dropped_message_events_count(
-      span.message_events().dropped_events_count());
+  batch->request = google::protobuf::Arena::CreateMessage<
+      ::google::devtools::cloudtrace::v2::BatchWriteSpansRequest>(
+      &batch->arena);
+  batch->request->set_name(absl::StrCat("projects/", opts_.project_id));
+  return batch;
 }
 
-void ConvertLinks(const ::opencensus::trace::exporter::SpanData& span,
-                  ::google::devtools::cloudtrace::v2::Span* proto_span) {
-  proto_span->mutable_links()->set_dropped_links_count(
-      span.num_links_dropped());
-  for (const auto& span_link : span.links()) {
-    auto link = proto_span->mutable_links()->add_link();
-    link->set_trace_id(span_link.trace_id().ToHex());
-    link->set_span_id(span_link.span_id().ToHex());
-    link->set_type(ConvertLinkType(span_link.type()));
-    PopulateAttributes(
-        span_link.attributes(),
-        proto_span->mutable_attributes()->mutable_attribute_map());
+void Handler::ReleaseBatch(std::unique_ptr<Batch> batch) {
+  OPENCENSUS_PROBE3(export_rpc_end, kExporterName, batch.get(),
+                    static_cast<int>(batch->status.error_code()));
+  opencensus::common::RecordSelfMetric(
+      opencensus::common::SelfMetric::kExporterRpcLatency,
+      absl::ToDoubleMilliseconds(absl::Now() - batch->start_time),
+      kExporterName);
+  if (!batch->status.ok()) {
+    opencensus::common::RecordSelfMetric(
+        opencensus::common::SelfMetric::kExporterRpcErrors, 1, kExporterName);
+    std::cerr << "BatchWriteSpans failed: "
+              << opencensus::common::ToString(batch->status) << "\n";
   }
+  batch->reader.reset();
+  batch->context.reset();
+  batch->request = nullptr;
+  batch->status = grpc::Status::OK;
+  // Keeps the initial block for the next request.
+  batch->arena.Reset();
+  absl::MutexLock l(&mu_);
+  --num_in_flight_;
+  idle_batches_.push_back(std::move(batch));
 }
 
-void ConvertSpans(
-    const std::vector<::opencensus::trace::exporter::SpanData>& spans,
-    absl::string_view project_id,
-    ::google::devtools::cloudtrace::v2::BatchWriteSpansRequest* request) {
-  for (const auto& from_span : spans) {
-    auto to_span = request->add_spans();
-    SetTruncatableString(from_span.name(), kDisplayNameStringLen,
-                         to_span->mutable_display_name());
-    to_span->set_name(absl::StrCat("projects/", project_id, "/traces/",
-                                   from_span.context().trace_id().ToHex(),
-                                   "/spans/",
-                                   from_span.context().span_id().ToHex()));
-    to_span->set_span_id(from_span.context().span_id().ToHex());
-    to_span->set_parent_span_id(from_span.parent_span_id().ToHex());
-
-    // The start time of the span.
-    EncodeTimestampProto(from_span.start_time(), to_span->mutable_start_time());
-
-    // The end time of the span.
-    EncodeTimestampProto(from_span.end_time(), to_span->mutable_end_time());
-
-    // Export Attributes
-    ConvertAttributes(from_span, to_span);
-
-    // Export Time Events.
-    ConvertTimeEvents(from_span, to_span);
-
-    // Export Links.
-    ConvertLinks(from_span, to_span);
-
-    // True if the parent is on a different process.
-    to_span->mutable_same_process_as_parent_span()->set_value(
-        !from_span.has_remote_parent());
-
-    // The status of the span.
-    to_span->mutable_status()->set_code(
-        static_cast<int32_t>(from_span.status().CanonicalCode()));
-    to_span->mutable_status()->set_message(from_span.status().error_message());
-
-    // Add agent attribute.
-    SetTruncatableString(
-        kAgentValue, kAttributeStringLen,
-        (*to_span->mutable_attributes()->mutable_attribute_map())[kAgentKey]
-            .mutable_string_value());
+void Handler::Send(std::unique_ptr<Batch> batch) {
+  batch->context = absl::make_unique<grpc::ClientContext>();
+  batch->start_time = absl::Now();
+  batch->context->set_deadline(
+      absl::ToChronoTime(batch->start_time + opts_.rpc_deadline));
+  auto* stub = stubs_[next_stub_].get();
+  next_stub_ = (next_stub_ + 1) % stubs_.size();
+  OPENCENSUS_PROBE2(export_rpc_begin, kExporterName, batch.get());
+  if (!opts_.async_export) {
+    batch->status = stub->BatchWriteSpans(
+        batch->context.get(), *batch->request, &batch->response);
+    ReleaseBatch(std::move(batch));
+    return;
   }
+  // Owned by the completion queue until HandleCompletions() receives it.
+  Batch* rpc = batch.release();
+  rpc->reader =
+      stub->AsyncBatchWriteSpans(rpc->context.get(), *rpc->request, &cq_);
+  rpc->reader->Finish(&rpc->response, &rpc->status, rpc);
 }
 
-class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
- public:
-  Handler(const StackdriverOptions& opts,
-          const std::shared_ptr<grpc::Channel>& channel)
-      : opts_(opts),
-        stub_(::google::devtools::cloudtrace::v2::TraceService::NewStub(
-            channel)) {}
-
-  void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
-      override;
-
- private:
-  const StackdriverOptions opts_;
-  std::unique_ptr<google::devtools::cloudtrace::v2::TraceService::Stub> stub_;
-};
-
-void Handler::Export(
-    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
-  ::google::devtools::cloudtrace::v2::BatchWriteSpansRequest request;
-  request.set_name(absl::StrCat("projects/", opts_.project_id));
-  ConvertSpans(spans, opts_.project_id, &request);
-  ::google::protobuf::Empty response;
-  grpc::ClientContext context;
-  context.set_deadline(absl::ToChronoTime(absl::Now() + opts_.rpc_deadline));
-  grpc::Status status = stub_->BatchWriteSpans(&context, request, &response);
-  if (!status.ok()) {
-    std::cerr << "BatchWriteSpans failed: "
-              << opencensus::common::ToString(status) << "\n";
+void Handler::HandleCompletions() {
+  void* tag;
+  bool ok;
+  while (cq_.Next(&tag, &ok)) {
+    ReleaseBatch(std::unique_ptr<Batch>(static_cast<Batch*>(tag)));
   }
 }
 
@@ -272,11 +230,10 @@ void Handler::Export(
 
 // static
 void StackdriverExporter::Register(const StackdriverOptions& opts) {
-  auto channel = ::grpc::CreateCustomChannel(
-      kGoogleStackdriverTraceAddress, ::grpc::GoogleDefaultCredentials(),
-      ::opencensus::common::WithUserAgent());
   ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
-      absl::make_unique<Handler>(opts, channel));
+      absl::make_unique<Handler>(
+          opts, ::opencensus::common::GetSharedChannels(opts.address,
+                                                        opts.channel_options)));
 }
 
 // static, DEPRECATED
@@ -0,0 +1,162 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/common/internal/process_memory.h"
+#include "opencensus/exporters/testing/fake_trace_service.h"
+#include "opencensus/exporters/testing/fault_injector.h"
+#include "opencensus/exporters/trace/stackdriver/stackdriver_exporter.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+
+// Measures the exporter end to end against an in-process fake of Cloud Trace:
+// spans are posted to the exporter's queue with SpanExporter::ExportSpans(),
+// and each iteration waits until the fake has answered for all of them. Each
+// benchmark takes the fake's latency in milliseconds, the percentage of
+// requests it fails as unavailable, and its quota in spans per second (0 for
+// none). Besides throughput, counters report the spans accepted and rejected
+// by the fake, the spans dropped by the exporter's queue, and the growth of
+// the heap and resident memory over the run.
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+using ::opencensus::exporters::testing::FakeTraceService;
+using ::opencensus::exporters::testing::FaultInjector;
+using ::opencensus::exporters::testing::FaultOptions;
+using ::opencensus::trace::SpanContext;
+using ::opencensus::trace::SpanId;
+using ::opencensus::trace::TraceId;
+using ::opencensus::trace::exporter::Annotation;
+using ::opencensus::trace::exporter::AttributeValue;
+using ::opencensus::trace::exporter::Link;
+using ::opencensus::trace::exporter::MessageEvent;
+using ::opencensus::trace::exporter::SpanData;
+using ::opencensus::trace::exporter::SpanExporter;
+using ::opencensus::trace::exporter::Status;
+
+constexpr int kSpansPerBatch = 128;
+constexpr int kBatchesPerIteration = 8;
+// How long an iteration waits for the fake to answer for its spans.
+constexpr absl::Duration kDeliveryTimeout = absl::Seconds(30);
+
+std::vector<SpanData> MakeSpans(int num_spans) {
+  const absl::Time start = absl::Now();
+  std::vector<SpanData> spans;
+  spans.reserve(num_spans);
+  for (int i = 0; i < num_spans; ++i) {
+    uint8_t trace_id[TraceId::kSize] = {1};
+    uint8_t span_id[SpanId::kSize] = {2};
+    trace_id[1] = span_id[1] = static_cast<uint8_t>(i);
+    spans.emplace_back(
+        "/service.Benchmark/Method",
+        SpanContext(TraceId(trace_id), SpanId(span_id)), SpanId(),
+        SpanData::TimeEvents<Annotation>({}, 0),
+        SpanData::TimeEvents<MessageEvent>({}, 0), std::vector<Link>(), 0,
+        std::unordered_map<std::string, AttributeValue>(), 0, true, start,
+        start + absl::Milliseconds(5), Status(), false);
+  }
+  return spans;
+}
+
+// Starts the fake and registers the exporter with it, once per process.
+FakeTraceService* GetService() {
+  static FakeTraceService* service = []() {
+    FakeTraceService* service = FakeTraceService::Start().release();
+    if (service == nullptr) {
+      std::cerr << "Cannot start the fake trace service.\n";
+      std::abort();
+    }
+    StackdriverOptions options;
+    options.project_id = "benchmark-project";
+    options.address = service->address();
+    options.channel_options.insecure = true;
+    StackdriverExporter::Register(options);
+    return service;
+  }();
+  return service;
+}
+
+void BM_Export(benchmark::State& state) {
+  FakeTraceService* service = GetService();
+  FaultOptions options;
+  options.latency = absl::Milliseconds(state.range(0));
+  options.error_rate = state.range(1) / 100.0;
+  options.max_items_per_second = state.range(2);
+  service->faults()->SetOptions(options);
+  service->faults()->ResetCounts();
+  const std::vector<SpanData> spans = MakeSpans(kSpansPerBatch);
+
+  const uint64_t dropped_before = SpanExporter::NumDroppedSpans();
+  const int64_t heap_before = common::HeapBytesInUse();
+  const int64_t rss_before = common::ResidentMemoryBytes();
+  uint64_t posted = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < kBatchesPerIteration; ++i) {
+      SpanExporter::ExportSpans(spans);
+    }
+    posted += kSpansPerBatch * kBatchesPerIteration;
+    const uint64_t dropped = SpanExporter::NumDroppedSpans() - dropped_before;
+    if (!service->faults()->WaitForItems(posted - dropped,
+                                         absl::Now() + kDeliveryTimeout)) {
+      state.SkipWithError("Timed out waiting for the fake trace service.");
+      break;
+    }
+  }
+  const FaultInjector::Counts counts = service->faults()->counts();
+  state.SetItemsProcessed(posted);
+  state.counters["accepted"] = counts.accepted_items;
+  state.counters["rejected"] = counts.rejected_items;
+  state.counters["dropped"] = SpanExporter::NumDroppedSpans() - dropped_before;
+  state.counters["heap_growth"] = common::HeapBytesInUse() - heap_before;
+  state.counters["rss_growth"] = common::ResidentMemoryBytes() - rss_before;
+}
+BENCHMARK(BM_Export)
+    ->ArgNames({"latency_ms", "error_pct", "quota"})
+    ->Args({0, 0, 0})
+    ->Args({20, 0, 0})
+    ->Args({100, 0, 0})
+    ->Args({0, 10, 0})
+    ->Args({0, 50, 0})
+    ->Args({0, 0, 10000})
+    ->Args({20, 10, 10000})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,38 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_STACKDRIVER_INTERNAL_STACKDRIVER_UTILS_H_
+#define OPENCENSUS_EXPORTERS_TRACE_STACKDRIVER_INTERNAL_STACKDRIVER_UTILS_H_
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/devtools/cloudtrace/v2/tracing.pb.h"
+#include "opencensus/trace/exporter/span_data.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+// Appends 'spans' to request->spans(), named under 'project_id'.
+void ConvertSpans(
+    absl::Span<const ::opencensus::trace::exporter::SpanData> spans,
+    absl::string_view project_id,
+    ::google::devtools::cloudtrace::v2::BatchWriteSpansRequest* request);
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_STACKDRIVER_INTERNAL_STACKDRIVER_UTILS_H_
@@ -20,6 +20,7 @@
 #include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "opencensus/common/internal/grpc/channel_options.h"
 
 namespace opencensus {
 namespace exporters {
@@ -31,6 +32,28 @@ struct StackdriverOptions {
 
   // The RPC deadline to use when exporting to Stackdriver.
   absl::Duration rpc_deadline = absl::Seconds(5);
+
+  // If true, requests are sent asynchronously and a background thread waits
+  // for them to complete, so that slow RPCs do not delay the export thread
+  // (which is shared with other trace exporters).
+  bool async_export = false;
+
+  // The maximum number of spans sent in each BatchWriteSpans request; larger
+  // exports are split.
+  int max_spans_per_request = 1000;
+
+  // The maximum number of requests in flight when async_export is set. Spans
+  // that would exceed it are dropped rather than delaying the export thread.
+  int max_in_flight_batches = 4;
+
+  // The address of the API. Other addresses are for testing, e.g. against the
+  // fakes in opencensus/exporters/testing with channel_options.insecure set.
+  std::string address = "cloudtrace.googleapis.com";
+
+  // Compression, keepalive, message size and connection count of the gRPC
+  // channels, which are shared with other exporters to the same address that
+  // use the same options.
+  opencensus::common::GrpcChannelOptions channel_options;
 };
 
 class StackdriverExporter {
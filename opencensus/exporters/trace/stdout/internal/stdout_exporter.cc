@@ -15,10 +15,18 @@
 #include "opencensus/exporters/trace/stdout/stdout_exporter.h"
 
 #include <iostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/json_lines_writer.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/span_exporter.h"
 
@@ -43,6 +51,142 @@ class Handler : public ::opencensus::trace::exporter::SpanExporter::Handler {
   std::ostream* stream_;
 };
 
+// Exports are serialized per handler, so the writer needs no locking.
+class JsonLinesHandler
+    : public ::opencensus::trace::exporter::SpanExporter::Handler {
+ public:
+  explicit JsonLinesHandler(int fd) : writer_(fd) {}
+
+  void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
+      override;
+
+ private:
+  void WriteTime(absl::string_view key, absl::Time time);
+  void WriteAttributes(
+      const std::unordered_map<std::string,
+                               ::opencensus::trace::exporter::AttributeValue>&
+          attributes);
+
+  ::opencensus::common::JsonLinesWriter writer_;
+};
+
+void JsonLinesHandler::Export(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
+  using ::opencensus::trace::exporter::Link;
+  using ::opencensus::trace::exporter::MessageEvent;
+  for (const auto& span : spans) {
+    writer_.StartObject();
+    writer_.Key("name");
+    writer_.String(span.name());
+    writer_.Key("trace_id");
+    writer_.String(span.context().trace_id().ToHex());
+    writer_.Key("span_id");
+    writer_.String(span.context().span_id().ToHex());
+    writer_.Key("parent_span_id");
+    writer_.String(span.parent_span_id().ToHex());
+    writer_.Key("has_remote_parent");
+    writer_.Bool(span.has_remote_parent());
+    WriteTime("start_time_unix_nanos", span.start_time());
+    WriteTime("end_time_unix_nanos", span.end_time());
+    writer_.Key("status");
+    writer_.StartObject();
+    writer_.Key("code");
+    writer_.Int(span.status().CanonicalCode());
+    writer_.Key("message");
+    writer_.String(span.status().error_message());
+    writer_.EndObject();
+
+    WriteAttributes(span.attributes());
+    writer_.Key("dropped_attributes_count");
+    writer_.Int(span.num_attributes_dropped());
+
+    writer_.Key("annotations");
+    writer_.StartArray();
+    for (const auto& annotation : span.annotations().events()) {
+      writer_.StartObject();
+      WriteTime("time_unix_nanos", annotation.timestamp());
+      writer_.Key("description");
+      writer_.String(annotation.event().description());
+      WriteAttributes(annotation.event().attributes());
+      writer_.EndObject();
+    }
+    writer_.EndArray();
+    writer_.Key("dropped_annotations_count");
+    writer_.Int(span.annotations().dropped_events_count());
+
+    writer_.Key("message_events");
+    writer_.StartArray();
+    for (const auto& message_event : span.message_events().events()) {
+      const MessageEvent& event = message_event.event();
+      writer_.StartObject();
+      WriteTime("time_unix_nanos", message_event.timestamp());
+      writer_.Key("type");
+      writer_.String(event.type() == MessageEvent::Type::SENT ? "SENT"
+                                                              : "RECEIVED");
+      writer_.Key("id");
+      writer_.Uint(event.id());
+      writer_.Key("compressed_size");
+      writer_.Uint(event.compressed_size());
+      writer_.Key("uncompressed_size");
+      writer_.Uint(event.uncompressed_size());
+      writer_.EndObject();
+    }
+    writer_.EndArray();
+    writer_.Key("dropped_message_events_count");
+    writer_.Int(span.message_events().dropped_events_count());
+
+    writer_.Key("links");
+    writer_.StartArray();
+    for (const auto& link : span.links()) {
+      writer_.StartObject();
+      writer_.Key("trace_id");
+      writer_.String(link.trace_id().ToHex());
+      writer_.Key("span_id");
+      writer_.String(link.span_id().ToHex());
+      writer_.Key("type");
+      writer_.String(link.type() == Link::Type::kChildLinkedSpan
+                         ? "CHILD_LINKED_SPAN"
+                         : "PARENT_LINKED_SPAN");
+      WriteAttributes(link.attributes());
+      writer_.EndObject();
+    }
+    writer_.EndArray();
+    writer_.Key("dropped_links_count");
+    writer_.Int(span.num_links_dropped());
+    writer_.EndObject();
+  }
+  writer_.Flush();
+}
+
+void JsonLinesHandler::WriteTime(absl::string_view key, absl::Time time) {
+  writer_.Key(key);
+  writer_.Int(absl::ToUnixNanos(time));
+}
+
+void JsonLinesHandler::WriteAttributes(
+    const std::unordered_map<std::string,
+                             ::opencensus::trace::exporter::AttributeValue>&
+        attributes) {
+  using Type = ::opencensus::trace::exporter::AttributeValue::Type;
+  writer_.Key("attributes");
+  writer_.StartObject();
+  for (const auto& attribute : attributes) {
+    writer_.Key(attribute.first);
+    switch (attribute.second.type()) {
+      case Type::kString:
+        writer_.String(attribute.second.string_value());
+        break;
+      case Type::kBool:
+        writer_.Bool(attribute.second.bool_value());
+        break;
+      case Type::kInt:
+        writer_.Int(attribute.second.int_value());
+        break;
+    }
+  }
+  writer_.EndObject();
+}
+
 }  // namespace
 
 // static
@@ -51,6 +195,12 @@ void StdoutExporter::Register(std::ostream* stream) {
       absl::make_unique<Handler>(stream));
 }
 
+// static
+void StdoutExporter::RegisterJsonLines(int fd) {
+  ::opencensus::trace::exporter::SpanExporter::RegisterHandler(
+      absl::make_unique<JsonLinesHandler>(fd));
+}
+
 }  // namespace trace
 }  // namespace exporters
 }  // namespace opencensus
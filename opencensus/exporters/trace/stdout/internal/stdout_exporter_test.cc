@@ -14,9 +14,16 @@
 
 #include "opencensus/exporters/trace/stdout/stdout_exporter.h"
 
+#include <unistd.h>
+
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/time/clock.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -41,9 +48,10 @@ class SpanExporterTestPeer {
 namespace {
 
 using ::testing::HasSubstr;
+using ::testing::StartsWith;
 
 TEST(StdoutExporterTest, Export) {
-  std::stringstream s;
+  static std::stringstream s;  // The handler stays registered.
   ::opencensus::exporters::trace::StdoutExporter::Register(&s);
   static ::opencensus::trace::AlwaysSampler sampler;
   ::opencensus::trace::StartSpanOptions opts = {&sampler};
@@ -62,4 +70,41 @@ TEST(StdoutExporterTest, Export) {
   EXPECT_THAT(str, HasSubstr("Needle."));
 }
 
+TEST(StdoutExporterTest, ExportJsonLines) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  ::opencensus::exporters::trace::StdoutExporter::RegisterJsonLines(fds[1]);
+  static ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+
+  auto span = ::opencensus::trace::Span::StartSpan("JsonSpan", nullptr, opts);
+  span.AddAttribute("key", "quoted \"value\"");
+  span.AddAnnotation("Line\nbreak.", {{"count", 3}});
+  span.End();
+
+  opencensus::trace::exporter::SpanExporterTestPeer::ExportForTesting();
+  close(fds[1]);
+  std::string str;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+    str.append(buf, n);
+  }
+  close(fds[0]);
+  std::cout << str;
+
+  std::string line;
+  for (const auto& l : absl::StrSplit(str, '\n')) {
+    if (absl::StrContains(l, "\"JsonSpan\"")) line = std::string(l);
+  }
+  EXPECT_THAT(line, StartsWith("{\"name\":\"JsonSpan\",\"trace_id\":\""));
+  EXPECT_THAT(line, HasSubstr(absl::StrCat("\"span_id\":\"",
+                                           span.context().span_id().ToHex(),
+                                           "\"")));
+  EXPECT_THAT(line, HasSubstr("\"key\":\"quoted \\\"value\\\"\""));
+  EXPECT_THAT(line, HasSubstr("\"description\":\"Line\\nbreak.\","
+                              "\"attributes\":{\"count\":3}"));
+  EXPECT_THAT(line, HasSubstr("\"status\":{\"code\":0,\"message\":\"\"}"));
+}
+
 }  // namespace
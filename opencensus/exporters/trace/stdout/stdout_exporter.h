@@ -24,7 +24,12 @@ namespace trace {
 class StdoutExporter {
  public:
   StdoutExporter() = delete;
+  // Writes each span's human-readable DebugString() to 'stream'.
   static void Register(std::ostream* stream = &std::cout);
+  // Writes each span as a JSON object on its own line to file descriptor
+  // 'fd', which must stay open. Each exported batch is written with a single
+  // write(2) from a buffer reused across batches.
+  static void RegisterJsonLines(int fd = 1);
 };
 
 }  // namespace trace
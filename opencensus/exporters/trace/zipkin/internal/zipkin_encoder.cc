@@ -0,0 +1,399 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/exporters/trace/zipkin/internal/zipkin_encoder.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "absl/base/macros.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/span_data.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+namespace {
+
+typedef JsonEncoder::Writer JsonWriter;
+
+void WriteString(absl::string_view value, JsonWriter* writer) {
+  writer->String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+}
+
+// Writes the lowercase hex encoding of a TraceId or SpanId.
+template <typename IdT>
+void WriteId(const IdT& id, JsonWriter* writer) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  uint8_t bytes[IdT::kSize];
+  id.CopyTo(bytes);
+  char hex[2 * IdT::kSize];
+  for (size_t i = 0; i < IdT::kSize; ++i) {
+    hex[2 * i] = kHexDigits[bytes[i] >> 4];
+    hex[2 * i + 1] = kHexDigits[bytes[i] & 0xf];
+  }
+  writer->String(hex, 2 * IdT::kSize);
+}
+
+void AppendAttributeValue(
+    const ::opencensus::trace::exporter::AttributeValue& value,
+    std::string* output) {
+  switch (value.type()) {
+    case ::opencensus::trace::AttributeValueRef::Type::kString:
+      output->append(value.string_value());
+      return;
+    case ::opencensus::trace::AttributeValueRef::Type::kBool:
+      output->append(value.bool_value() ? "true" : "false");
+      return;
+    case ::opencensus::trace::AttributeValueRef::Type::kInt:
+      absl::StrAppend(output, value.int_value());
+      return;
+  }
+  ABSL_ASSERT(false && "Unknown AttributeValue type");
+}
+
+void AppendAnnotationText(
+    const ::opencensus::trace::exporter::Annotation& annotation,
+    std::string* output) {
+  output->append(annotation.description().data(),
+                 annotation.description().size());
+  if (annotation.attributes().empty()) {
+    return;
+  }
+  output->append(" (");
+  size_t count = 0;
+  for (const auto& attribute : annotation.attributes()) {
+    absl::StrAppend(output, attribute.first, ":");
+    AppendAttributeValue(attribute.second, output);
+    if (++count < annotation.attributes().size()) {
+      output->append(", ");
+    }
+  }
+  output->push_back(')');
+}
+
+void AppendMessageEventText(
+    const ::opencensus::trace::exporter::MessageEvent& event,
+    std::string* output) {
+  absl::StrAppend(
+      output,
+      event.type() == ::opencensus::trace::exporter::MessageEvent::Type::SENT
+          ? "SENT"
+          : "RECEIVED",
+      "/", event.id(), "/", event.compressed_size());
+}
+
+// Appends 'value' as a protobuf base-128 varint.
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+// The protobuf wire types used by zipkin.proto3.
+enum WireType { kVarint = 0, kFixed64 = 1, kLengthDelimited = 2 };
+
+void AppendTag(int field, WireType type, std::string* output) {
+  AppendVarint((field << 3) | type, output);
+}
+
+// Appends a string, bytes, or embedded message field, omitting it if empty as
+// proto3 does.
+void AppendBytesField(int field, absl::string_view value,
+                      std::string* output) {
+  if (value.empty()) return;
+  AppendTag(field, kLengthDelimited, output);
+  AppendVarint(value.size(), output);
+  output->append(value.data(), value.size());
+}
+
+void AppendVarintField(int field, uint64_t value, std::string* output) {
+  if (value == 0) return;
+  AppendTag(field, kVarint, output);
+  AppendVarint(value, output);
+}
+
+void AppendFixed64Field(int field, uint64_t value, std::string* output) {
+  if (value == 0) return;
+  AppendTag(field, kFixed64, output);
+  for (int i = 0; i < 8; ++i) {
+    output->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+template <typename IdT>
+void AppendIdField(int field, const IdT& id, std::string* output) {
+  uint8_t bytes[IdT::kSize];
+  id.CopyTo(bytes);
+  AppendBytesField(field,
+                   absl::string_view(reinterpret_cast<const char*>(bytes),
+                                     IdT::kSize),
+                   output);
+}
+
+}  // namespace
+
+size_t JsonEncoder::Encode(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+    const ZipkinExporterOptions::Service& service, size_t max_bytes,
+    std::vector<std::string>* batches) {
+  size_t num_batches = 0;
+  std::string* batch = nullptr;
+  for (const auto& span : spans) {
+    buffer_.Clear();
+    JsonWriter writer(buffer_);
+    SerializeSpan(span, service, &writer);
+    // Adding the span takes a separator, and the batch a closing ']'.
+    if (batch != nullptr && max_bytes > 0 &&
+        batch->size() + buffer_.GetSize() + 2 > max_bytes) {
+      batch->push_back(']');
+      batch = nullptr;
+    }
+    if (batch == nullptr) {
+      if (num_batches == batches->size()) {
+        batches->emplace_back();
+      }
+      batch = &(*batches)[num_batches++];
+      batch->assign(1, '[');
+    } else {
+      batch->push_back(',');
+    }
+    batch->append(buffer_.GetString(), buffer_.GetSize());
+  }
+  if (batch != nullptr) {
+    batch->push_back(']');
+  }
+  return num_batches;
+}
+
+void JsonEncoder::WriteAttributeValue(
+    const ::opencensus::trace::exporter::AttributeValue& value,
+    JsonWriter* writer) {
+  if (value.type() == ::opencensus::trace::AttributeValueRef::Type::kString) {
+    WriteString(value.string_value(), writer);
+    return;
+  }
+  scratch_.clear();
+  AppendAttributeValue(value, &scratch_);
+  WriteString(scratch_, writer);
+}
+
+void JsonEncoder::WriteAnnotation(
+    const ::opencensus::trace::exporter::Annotation& annotation,
+    JsonWriter* writer) {
+  if (annotation.attributes().empty()) {
+    WriteString(annotation.description(), writer);
+    return;
+  }
+  scratch_.clear();
+  AppendAnnotationText(annotation, &scratch_);
+  WriteString(scratch_, writer);
+}
+
+void JsonEncoder::WriteMessageEvent(
+    const ::opencensus::trace::exporter::MessageEvent& event,
+    JsonWriter* writer) {
+  scratch_.clear();
+  AppendMessageEventText(event, &scratch_);
+  WriteString(scratch_, writer);
+}
+
+void JsonEncoder::SerializeSpan(
+    const ::opencensus::trace::exporter::SpanData& span,
+    const ZipkinExporterOptions::Service& service, JsonWriter* writer) {
+  writer->StartObject();
+
+  writer->Key("name");
+  WriteString(span.name(), writer);
+
+  writer->Key("traceId");
+  WriteId(span.context().trace_id(), writer);
+
+  if (span.parent_span_id().IsValid()) {
+    writer->Key("parentId");
+    WriteId(span.parent_span_id(), writer);
+  }
+
+  writer->Key("id");
+  WriteId(span.context().span_id(), writer);
+
+  // Write endpoint.  OpenCensus does not support this by default.
+  writer->Key("localEndpoint");
+  writer->StartObject();
+  writer->Key("serviceName");
+  WriteString(service.service_name, writer);
+  if (service.af_type == ZipkinExporterOptions::AddressFamily::kIpv6) {
+    writer->Key("ipv6");
+  } else {
+    writer->Key("ipv4");
+  }
+  WriteString(service.ip_address, writer);
+  writer->EndObject();
+
+  if (!span.annotations().events().empty()) {
+    writer->Key("annotations");
+    writer->StartArray();
+    for (const auto& annotation : span.annotations().events()) {
+      writer->StartObject();
+      writer->Key("timestamp");
+      writer->Int64(absl::ToUnixMicros(annotation.timestamp()));
+      writer->Key("value");
+      WriteAnnotation(annotation.event(), writer);
+      writer->EndObject();
+    }
+    writer->EndArray(span.annotations().events().size());
+  }
+
+  if (!span.message_events().events().empty()) {
+    writer->Key("annotations");
+    writer->StartArray();
+    for (const auto& event : span.message_events().events()) {
+      writer->StartObject();
+      writer->Key("timestamp");
+      writer->Int64(absl::ToUnixMicros(event.timestamp()));
+      writer->Key("value");
+      WriteMessageEvent(event.event(), writer);
+      writer->EndObject();
+    }
+    writer->EndArray(span.message_events().events().size());
+  }
+
+  if (!span.attributes().empty()) {
+    writer->Key("tags");
+    writer->StartObject();
+    for (const auto& attribute : span.attributes()) {
+      WriteString(attribute.first, writer);
+      WriteAttributeValue(attribute.second, writer);
+    }
+    writer->EndObject();
+  }
+
+  writer->Key("timestamp");
+  writer->Int64(absl::ToUnixMicros(span.start_time()));
+
+  writer->Key("duration");
+  writer->Int64(absl::ToInt64Microseconds(span.end_time() - span.start_time()));
+
+  writer->EndObject();
+}
+
+size_t ProtoEncoder::Encode(
+    const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+    const ZipkinExporterOptions::Service& service, size_t max_bytes,
+    std::vector<std::string>* batches) {
+  endpoint_.clear();
+  AppendBytesField(1, service.service_name, &endpoint_);
+  char address[sizeof(in6_addr)];
+  const bool ipv6 =
+      service.af_type == ZipkinExporterOptions::AddressFamily::kIpv6;
+  if (inet_pton(ipv6 ? AF_INET6 : AF_INET, service.ip_address.c_str(),
+                address) == 1) {
+    AppendBytesField(
+        ipv6 ? 3 : 2,
+        absl::string_view(address, ipv6 ? sizeof(in6_addr) : sizeof(in_addr)),
+        &endpoint_);
+  }
+
+  size_t num_batches = 0;
+  std::string* batch = nullptr;
+  for (const auto& span : spans) {
+    SerializeSpan(span);
+    // The span's tag is 1 byte, and its length at most 10.
+    if (batch != nullptr && max_bytes > 0 &&
+        batch->size() + span_.size() + 11 > max_bytes) {
+      batch = nullptr;
+    }
+    if (batch == nullptr) {
+      if (num_batches == batches->size()) {
+        batches->emplace_back();
+      }
+      batch = &(*batches)[num_batches++];
+      batch->clear();
+    }
+    // An empty span is still a repeated element.
+    AppendTag(1, kLengthDelimited, batch);
+    AppendVarint(span_.size(), batch);
+    batch->append(span_);
+  }
+  return num_batches;
+}
+
+void ProtoEncoder::SerializeSpan(
+    const ::opencensus::trace::exporter::SpanData& span) {
+  span_.clear();
+  AppendIdField(1, span.context().trace_id(), &span_);
+  if (span.parent_span_id().IsValid()) {
+    AppendIdField(2, span.parent_span_id(), &span_);
+  }
+  AppendIdField(3, span.context().span_id(), &span_);
+  AppendBytesField(5, span.name(), &span_);
+  AppendFixed64Field(6, absl::ToUnixMicros(span.start_time()), &span_);
+  AppendVarintField(
+      7, absl::ToInt64Microseconds(span.end_time() - span.start_time()),
+      &span_);
+  AppendBytesField(8, endpoint_, &span_);
+
+  for (const auto& annotation : span.annotations().events()) {
+    message_.clear();
+    AppendFixed64Field(1, absl::ToUnixMicros(annotation.timestamp()),
+                       &message_);
+    scratch_.clear();
+    AppendAnnotationText(annotation.event(), &scratch_);
+    AppendBytesField(2, scratch_, &message_);
+    AppendBytesField(10, message_, &span_);
+  }
+  for (const auto& event : span.message_events().events()) {
+    message_.clear();
+    AppendFixed64Field(1, absl::ToUnixMicros(event.timestamp()), &message_);
+    scratch_.clear();
+    AppendMessageEventText(event.event(), &scratch_);
+    AppendBytesField(2, scratch_, &message_);
+    AppendBytesField(10, message_, &span_);
+  }
+
+  for (const auto& attribute : span.attributes()) {
+    message_.clear();
+    AppendBytesField(1, attribute.first, &message_);
+    if (attribute.second.type() ==
+        ::opencensus::trace::AttributeValueRef::Type::kString) {
+      AppendBytesField(2, attribute.second.string_value(), &message_);
+    } else {
+      scratch_.clear();
+      AppendAttributeValue(attribute.second, &scratch_);
+      AppendBytesField(2, scratch_, &message_);
+    }
+    // Map entries are always written, even when both fields are empty.
+    AppendTag(11, kLengthDelimited, &span_);
+    AppendVarint(message_.size(), &span_);
+    span_.append(message_);
+  }
+}
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
@@ -0,0 +1,112 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_EXPORTERS_TRACE_ZIPKIN_INTERNAL_ZIPKIN_ENCODER_H_
+#define OPENCENSUS_EXPORTERS_TRACE_ZIPKIN_INTERNAL_ZIPKIN_ENCODER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "opencensus/exporters/trace/zipkin/zipkin_exporter.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+
+// Encodes spans as Zipkin v2 JSON, reusing its buffers across calls.
+//
+// JsonEncoder is thread-compatible.
+class JsonEncoder final {
+ public:
+  typedef rapidjson::Writer<rapidjson::StringBuffer> Writer;
+
+  // Encodes 'spans' as JSON arrays into the first elements of *batches
+  // (reusing their capacity), starting a new array instead of letting one
+  // exceed max_bytes (if nonzero) unless it would hold a single span. Returns
+  // the number of arrays.
+  size_t Encode(
+      const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+      const ZipkinExporterOptions::Service& service, size_t max_bytes,
+      std::vector<std::string>* batches);
+
+ private:
+  void SerializeSpan(const ::opencensus::trace::exporter::SpanData& span,
+                     const ZipkinExporterOptions::Service& service,
+                     Writer* writer);
+  void WriteAnnotation(
+      const ::opencensus::trace::exporter::Annotation& annotation,
+      Writer* writer);
+  void WriteMessageEvent(
+      const ::opencensus::trace::exporter::MessageEvent& event,
+      Writer* writer);
+  void WriteAttributeValue(
+      const ::opencensus::trace::exporter::AttributeValue& value,
+      Writer* writer);
+
+  // Holds the JSON of one span.
+  rapidjson::StringBuffer buffer_;
+  // Used to format string values that are built from several parts.
+  std::string scratch_;
+};
+
+// Encodes spans as a zipkin.proto3.ListOfSpans, from
+// https://github.com/openzipkin/zipkin-api/blob/master/zipkin.proto, writing
+// the wire format directly rather than building messages. The fields used
+// are:
+//
+//   message ListOfSpans { repeated Span spans = 1; }
+//   message Span {
+//     bytes trace_id = 1; bytes parent_id = 2; bytes id = 3;
+//     string name = 5; fixed64 timestamp = 6; uint64 duration = 7;
+//     Endpoint local_endpoint = 8; repeated Annotation annotations = 10;
+//     map<string, string> tags = 11;
+//   }
+//   message Endpoint {
+//     string service_name = 1; bytes ipv4 = 2; bytes ipv6 = 3;
+//   }
+//   message Annotation { fixed64 timestamp = 1; string value = 2; }
+//
+// ProtoEncoder is thread-compatible.
+class ProtoEncoder final {
+ public:
+  // As JsonEncoder::Encode(), but each batch is a serialized ListOfSpans.
+  size_t Encode(
+      const std::vector<::opencensus::trace::exporter::SpanData>& spans,
+      const ZipkinExporterOptions::Service& service, size_t max_bytes,
+      std::vector<std::string>* batches);
+
+ private:
+  void SerializeSpan(const ::opencensus::trace::exporter::SpanData& span);
+
+  // The serialized local endpoint, which is the same for every span.
+  std::string endpoint_;
+  // Hold the serialized span, and an annotation or tag within it.
+  std::string span_;
+  std::string message_;
+  std::string scratch_;
+};
+
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_EXPORTERS_TRACE_ZIPKIN_INTERNAL_ZIPKIN_ENCODER_H_
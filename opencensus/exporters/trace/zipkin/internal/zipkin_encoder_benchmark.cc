@@ -0,0 +1,130 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/exporters/trace/zipkin/internal/zipkin_encoder.h"
+#include "opencensus/exporters/trace/zipkin/zipkin_exporter.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+
+// Measures encoding spans as Zipkin JSON and proto3, without any network I/O.
+// Each benchmark takes the number of spans per batch and the number of
+// attributes and annotations per span.
+
+namespace opencensus {
+namespace exporters {
+namespace trace {
+namespace {
+
+using ::opencensus::trace::AttributeValueRef;
+using ::opencensus::trace::SpanContext;
+using ::opencensus::trace::SpanId;
+using ::opencensus::trace::TraceId;
+using ::opencensus::trace::exporter::Annotation;
+using ::opencensus::trace::exporter::AttributeValue;
+using ::opencensus::trace::exporter::MessageEvent;
+using ::opencensus::trace::exporter::SpanData;
+using ::opencensus::trace::exporter::Status;
+
+std::vector<SpanData> MakeSpans(int num_spans, int num_attributes,
+                                int num_annotations) {
+  const absl::Time start = absl::FromUnixSeconds(1000);
+  std::vector<SpanData> spans;
+  spans.reserve(num_spans);
+  for (int i = 0; i < num_spans; ++i) {
+    uint8_t trace_id[TraceId::kSize] = {1};
+    uint8_t span_id[SpanId::kSize] = {2};
+    trace_id[1] = span_id[1] = static_cast<uint8_t>(i);
+    std::unordered_map<std::string, AttributeValue> attributes;
+    for (int j = 0; j < num_attributes; ++j) {
+      attributes.emplace(absl::StrCat("attribute", j),
+                         j % 2 == 0 ? AttributeValue(AttributeValueRef(j))
+                                    : AttributeValue(AttributeValueRef(
+                                          "attribute value")));
+    }
+    std::vector<SpanData::TimeEvent<Annotation>> annotations;
+    for (int j = 0; j < num_annotations; ++j) {
+      annotations.emplace_back(
+          start + absl::Microseconds(j),
+          Annotation(absl::StrCat("annotation ", j),
+                     {{"key", AttributeValue(AttributeValueRef("value"))}}));
+    }
+    std::vector<SpanData::TimeEvent<MessageEvent>> message_events;
+    message_events.emplace_back(
+        start, MessageEvent(MessageEvent::Type::SENT, i, 100, 50));
+    spans.emplace_back(
+        "/service.Benchmark/Method",
+        SpanContext(TraceId(trace_id), SpanId(span_id)), SpanId(),
+        SpanData::TimeEvents<Annotation>(std::move(annotations), 0),
+        SpanData::TimeEvents<MessageEvent>(std::move(message_events), 0),
+        std::vector<::opencensus::trace::exporter::Link>(), 0,
+        std::move(attributes), 0, true, start, start + absl::Milliseconds(5),
+        Status(), false);
+  }
+  return spans;
+}
+
+ZipkinExporterOptions::Service MakeService() {
+  ZipkinExporterOptions::Service service;
+  service.service_name = "benchmark";
+  service.af_type = ZipkinExporterOptions::AddressFamily::kIpv4;
+  service.ip_address = "10.0.0.1";
+  return service;
+}
+
+template <typename Encoder>
+void BM_Encode(benchmark::State& state) {
+  const std::vector<SpanData> spans =
+      MakeSpans(state.range(0), state.range(1), state.range(2));
+  const ZipkinExporterOptions::Service service = MakeService();
+  Encoder encoder;
+  std::vector<std::string> batches;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    // With no size limit, every span goes into the first batch.
+    encoder.Encode(spans, service, /*max_bytes=*/0, &batches);
+    benchmark::DoNotOptimize(batches[0].data());
+    bytes += batches[0].size();
+  }
+  state.SetItemsProcessed(state.iterations() * spans.size());
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_TEMPLATE(BM_Encode, JsonEncoder)
+    ->ArgNames({"spans", "attributes", "annotations"})
+    ->ArgsProduct({{1, 64, 512}, {0, 8, 32}, {0, 4}});
+BENCHMARK_TEMPLATE(BM_Encode, ProtoEncoder)
+    ->ArgNames({"spans", "attributes", "annotations"})
+    ->ArgsProduct({{1, 64, 512}, {0, 8, 32}, {0, 4}});
+
+}  // namespace
+}  // namespace trace
+}  // namespace exporters
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
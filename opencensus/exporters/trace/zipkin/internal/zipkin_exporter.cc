@@ -16,14 +16,25 @@
 
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <curl/curl.h>
-#include <rapidjson/prettywriter.h>
-#include <rapidjson/stringbuffer.h>
+#include <zlib.h>
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
-#include "absl/strings/str_cat.h"
-#include "opencensus/trace/exporter/attribute_value.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/disk_spool.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/exporters/trace/zipkin/internal/zipkin_encoder.h"
 #include "opencensus/trace/exporter/span_exporter.h"
 
 namespace opencensus {
@@ -33,145 +44,35 @@ namespace trace {
 namespace {
 
 constexpr char kZipkinLib[] = "zipkin/2.0";
+// The opencensus_exporter tag value of this exporter's self-metrics.
+constexpr char kExporterName[] = "zipkin";
 constexpr char ipv4_loopback[] = "127.0.0.1";
 constexpr char ipv6_loopback[] = "::1";
-
-std::string SerializeMessageEvent(
-    const ::opencensus::trace::exporter::MessageEvent& event) {
-  return absl::StrCat(
-      event.type() == ::opencensus::trace::exporter::MessageEvent::Type::SENT
-          ? "SENT"
-          : "RECEIVED",
-      "/", event.id(), "/", event.compressed_size());
-}
-
-std::string AttributeValueToString(
-    const ::opencensus::trace::exporter::AttributeValue& value) {
-  switch (value.type()) {
-    case ::opencensus::trace::AttributeValueRef::Type::kString:
-      return value.string_value();
-      break;
-    case ::opencensus::trace::AttributeValueRef::Type::kBool:
-      return value.bool_value() ? "true" : "false";
-      break;
-    case ::opencensus::trace::AttributeValueRef::Type::kInt:
-      return std::to_string(value.int_value());
-      break;
+// The maximum number of spooled requests resent by each export, so that the
+// backlog after an outage is drained gradually.
+constexpr size_t kMaxReplayedRequests = 64;
+
+// Replaces *compressed (reusing its capacity) with 'data' compressed in the
+// gzip format. Returns false on failure.
+bool Gzip(absl::string_view data, std::string* compressed) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   /*windowBits=*/15 + 16, /*memLevel=*/8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
   }
-  ABSL_ASSERT(false && "Unknown AttributeValue type");
-  return "";
-}
-
-std::string SerializeAnnotation(
-    const ::opencensus::trace::exporter::Annotation& annotation) {
-  std::string annotation_str(annotation.description());
-  if (!annotation.attributes().empty()) {
-    absl::StrAppend(&annotation_str, " (");
-    size_t count = 0;
-    for (const auto& attribute : annotation.attributes()) {
-      absl::StrAppend(&annotation_str, attribute.first, ":",
-                      AttributeValueToString(attribute.second));
-
-      if (++count < annotation.attributes().size()) {
-        absl::StrAppend(&annotation_str, ", ");
-      }
-    }
-    absl::StrAppend(&annotation_str, ")");
+  compressed->resize(deflateBound(&stream, data.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*compressed)[0]);
+  stream.avail_out = compressed->size();
+  const int result = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    return false;
   }
-  return annotation_str;
-}
-
-void SerializeJson(const ::opencensus::trace::exporter::SpanData& span,
-                   const ZipkinExporterOptions::Service& service,
-                   rapidjson::Writer<rapidjson::StringBuffer>* writer) {
-  writer->StartObject();
-
-  writer->Key("name");
-  writer->String(std::string(span.name()));
-
-  writer->Key("traceId");
-  writer->String(span.context().trace_id().ToHex());
-
-  if (span.parent_span_id().IsValid()) {
-    writer->Key("parentId");
-    writer->String(span.parent_span_id().ToHex());
-  }
-
-  writer->Key("id");
-  writer->String(span.context().span_id().ToHex());
-
-  // Write endpoint.  OpenCensus does not support this by default.
-  writer->Key("localEndpoint");
-  writer->StartObject();
-  writer->Key("serviceName");
-  writer->String(service.service_name);
-  if (service.af_type == ZipkinExporterOptions::AddressFamily::kIpv6) {
-    writer->Key("ipv6");
-  } else {
-    writer->Key("ipv4");
-  }
-  writer->String(service.ip_address);
-  writer->EndObject();
-
-  if (!span.annotations().events().empty()) {
-    writer->Key("annotations");
-    writer->StartArray();
-    for (const auto& annotation : span.annotations().events()) {
-      writer->StartObject();
-      writer->Key("timestamp");
-      writer->Int64(absl::ToUnixMicros(annotation.timestamp()));
-      writer->Key("value");
-      writer->String(SerializeAnnotation(annotation.event()));
-      writer->EndObject();
-    }
-    writer->EndArray(span.annotations().events().size());
-  }
-
-  if (!span.message_events().events().empty()) {
-    writer->Key("annotations");
-    writer->StartArray();
-    for (const auto& event : span.message_events().events()) {
-      writer->StartObject();
-      writer->Key("timestamp");
-      writer->Int64(absl::ToUnixMicros(event.timestamp()));
-      writer->Key("value");
-      writer->String(SerializeMessageEvent(event.event()));
-      writer->EndObject();
-    }
-    writer->EndArray(span.message_events().events().size());
-  }
-
-  if (!span.attributes().empty()) {
-    writer->Key("tags");
-    writer->StartObject();
-    for (const auto& attribute : span.attributes()) {
-      writer->String(attribute.first);
-      writer->String(AttributeValueToString(attribute.second));
-    }
-    writer->EndObject();
-  }
-
-  writer->Key("timestamp");
-  writer->Int64(absl::ToUnixMicros(span.start_time()));
-
-  writer->Key("duration");
-  writer->Int64(absl::ToInt64Microseconds(span.end_time() - span.start_time()));
-
-  writer->EndObject();
-}
-
-std::string EncodeJson(
-    const std::vector<::opencensus::trace::exporter::SpanData>& spans,
-    const ZipkinExporterOptions::Service& service) {
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-
-  writer.StartArray();
-  for (const auto& span : spans) {
-    SerializeJson(span, service, &writer);
-  }
-  writer.EndArray();
-  return buffer.GetString();
+  compressed->resize(stream.total_out);
+  return true;
 }
 
 std::string GetIpAddressHelper(ZipkinExporterOptions::AddressFamily af_type,
@@ -231,10 +132,10 @@ CurlEnv* CurlEnv::Get() {
   return g_curl_env;
 }
 
-CURLcode CurlSendMessage(const uint8_t* data,
-                         const ZipkinExporterOptions& options, size_t size,
-                         const struct curl_slist* headers, CURL* curl,
-                         char* err_msg) {
+// Sets the options that are the same for every request.
+CURLcode CurlSetOptions(const ZipkinExporterOptions& options,
+                        const struct curl_slist* headers, CURL* curl,
+                        char* err_msg) {
   CURLcode res;
 
   if ((res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers)) != CURLE_OK) {
@@ -256,14 +157,6 @@ CURLcode CurlSendMessage(const uint8_t* data,
     // Failed to set http user agent.
     return res;
   }
-  if ((res = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, size)) != CURLE_OK) {
-    // Failed to set http body size.
-    return res;
-  }
-  if ((res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data)) != CURLE_OK) {
-    // Failed to set http body data.
-    return res;
-  }
   if ((res = curl_easy_setopt(
            curl, CURLOPT_CONNECTTIMEOUT,
            absl::ToInt64Milliseconds(options.connect_timeout))) != CURLE_OK) {
@@ -280,8 +173,12 @@ CURLcode CurlSendMessage(const uint8_t* data,
     // Failed to disable signals.
     return res;
   }
+  if ((res = curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1)) != CURLE_OK) {
+    // Failed to enable TCP keep-alive.
+    return res;
+  }
 
-  if (options.proxy.empty()) {
+  if (!options.proxy.empty()) {
     if ((res = curl_easy_setopt(curl, CURLOPT_PROXY, options.proxy.c_str())) !=
         CURLE_OK) {
       // Failed to set proxy.
@@ -314,59 +211,293 @@ CURLcode CurlSendMessage(const uint8_t* data,
     }
   }
 
-  // Sending HTTP request to url.
-  res = curl_easy_perform(curl);
-
-  return res;
+  return CURLE_OK;
 }
 
 class ZipkinExportHandler
     : public ::opencensus::trace::exporter::SpanExporter::Handler {
  public:
-  explicit ZipkinExportHandler(const ZipkinExporterOptions& options)
-      : options_(options) {}
+  explicit ZipkinExportHandler(const ZipkinExporterOptions& options);
+  ~ZipkinExportHandler() override;
 
   void Export(const std::vector<::opencensus::trace::exporter::SpanData>& spans)
       override;
 
-  // Send HTTP message to zipkin endpoint using libcurl.
-  void SendMessage(const std::string& msg, size_t size) const;
-
   ZipkinExporterOptions options_;
   ZipkinExporterOptions::Service service_;
-};
 
-void ZipkinExportHandler::SendMessage(const std::string& msg,
-                                      size_t size) const {
-  char err_msg[CURL_ERROR_SIZE] = {0};
-  CURL* curl = curl_easy_init();
-  struct curl_slist* headers = nullptr;
+ private:
+  // An easy handle and the body of the request it is sending. Handles are
+  // reused across requests so that curl keeps connections (and any TLS
+  // sessions) alive.
+  struct Connection {
+    CURL* curl = nullptr;
+    char err_msg[CURL_ERROR_SIZE] = {0};
+    std::string body;
+    // When the request in flight was started.
+    absl::Time start_time;
+  };
+
+  // Sends batches_[0, num_batches), and up to kMaxReplayedRequests spooled
+  // requests, using up to options_.max_concurrent_requests connections at
+  // once, and waits for all of them to complete. While backing off, the
+  // batches are spooled instead.
+  void SendBatches(size_t num_batches) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Replaces *body with the request body for 'batch', reusing the buffers of
+  // both. Returns false on failure.
+  bool MakeBody(std::string* batch, std::string* body)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Starts sending connection->body on 'connection'. Returns false on failure.
+  bool StartRequest(Connection* connection) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Appends the request body 'body' to spool_.
+  void Spool(absl::string_view body) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  absl::Mutex mu_;
+  // Null if creating it failed.
+  CURLM* multi_ GUARDED_BY(mu_) = nullptr;
+  struct curl_slist* headers_ GUARDED_BY(mu_) = nullptr;
+  std::vector<std::unique_ptr<Connection>> connections_ GUARDED_BY(mu_);
+  std::vector<Connection*> idle_connections_ GUARDED_BY(mu_);
+  JsonEncoder json_encoder_ GUARDED_BY(mu_);
+  ProtoEncoder proto_encoder_ GUARDED_BY(mu_);
+  // Request bodies, reused across exports.
+  std::vector<std::string> batches_ GUARDED_BY(mu_);
+  // Null unless options_.spool_path is set and the spool could be opened.
+  std::unique_ptr<opencensus::common::DiskSpool> spool_ GUARDED_BY(mu_);
+  // Spooled requests start with this byte, which identifies the encoding and
+  // compression of the body that follows.
+  char spool_tag_;
+  std::string spool_record_ GUARDED_BY(mu_);
+};
 
-  if (!curl) {
-    std::cerr << "ZipkinExporter: failed to create curl handle.\n";
+ZipkinExportHandler::ZipkinExportHandler(const ZipkinExporterOptions& options)
+    : options_(options),
+      spool_tag_(static_cast<char>('a' +
+                                   2 * static_cast<int>(options.encoding) +
+                                   options.gzip_compression)) {
+  absl::MutexLock l(&mu_);
+  if (!options_.spool_path.empty()) {
+    std::string error;
+    spool_ = opencensus::common::DiskSpool::Open(
+        options_.spool_path, options_.spool_max_bytes, &error);
+    if (spool_ == nullptr) {
+      std::cerr << "ZipkinExporter: failed to open spool \""
+                << options_.spool_path << "\": " << error << "\n";
+    }
+  }
+  multi_ = curl_multi_init();
+  if (!multi_) {
+    std::cerr << "ZipkinExporter: failed to create curl multi handle.\n";
     return;
   }
+  // This is required for the server to recognize the message's encoding.
+  headers_ = curl_slist_append(
+      headers_,
+      options_.encoding == ZipkinExporterOptions::Encoding::kProto3
+          ? "Content-Type: application/x-protobuf"
+          : "Content-Type: application/json");
+  if (options_.gzip_compression) {
+    headers_ = curl_slist_append(headers_, "Content-Encoding: gzip");
+  }
+  const size_t num_connections =
+      std::max<size_t>(1, options_.max_concurrent_requests);
+  for (size_t i = 0; i < num_connections; ++i) {
+    auto connection = absl::make_unique<Connection>();
+    connection->curl = curl_easy_init();
+    if (!connection->curl) {
+      std::cerr << "ZipkinExporter: failed to create curl handle.\n";
+      break;
+    }
+    const CURLcode res = CurlSetOptions(options_, headers_, connection->curl,
+                                        connection->err_msg);
+    if (res != CURLE_OK) {
+      std::cerr << "ZipkinExporter: curl error: " << curl_easy_strerror(res)
+                << " (configuring \"" << options_.url << "\")\n";
+      curl_easy_cleanup(connection->curl);
+      break;
+    }
+    curl_easy_setopt(connection->curl, CURLOPT_PRIVATE, connection.get());
+    idle_connections_.push_back(connection.get());
+    connections_.push_back(std::move(connection));
+  }
+}
+
+ZipkinExportHandler::~ZipkinExportHandler() {
+  absl::MutexLock l(&mu_);
+  for (const auto& connection : connections_) {
+    curl_easy_cleanup(connection->curl);
+  }
+  if (multi_) {
+    curl_multi_cleanup(multi_);
+  }
+  curl_slist_free_all(headers_);
+}
 
-  // This is required for the server to recognize that it is a json encoded
-  // message.
-  headers = curl_slist_append(headers, "Content-Type: application/json");
-  CURLcode res = CurlSendMessage(reinterpret_cast<const uint8_t*>(msg.data()),
-                                 options_, size, headers, curl, err_msg);
-  if (res != CURLE_OK) {
+bool ZipkinExportHandler::MakeBody(std::string* batch, std::string* body) {
+  if (options_.gzip_compression) {
+    if (!Gzip(*batch, body)) {
+      std::cerr << "ZipkinExporter: failed to compress request.\n";
+      return false;
+    }
+  } else {
+    // The batch gets the previous body's buffer for its next use.
+    body->swap(*batch);
+  }
+  return true;
+}
+
+bool ZipkinExportHandler::StartRequest(Connection* connection) {
+  CURLcode res;
+  if ((res = curl_easy_setopt(connection->curl, CURLOPT_POSTFIELDSIZE,
+                              static_cast<long>(connection->body.size()))) !=
+          CURLE_OK ||
+      (res = curl_easy_setopt(connection->curl, CURLOPT_POSTFIELDS,
+                              connection->body.data())) != CURLE_OK) {
     std::cerr << "ZipkinExporter: curl error: " << curl_easy_strerror(res)
               << " (sending to \"" << options_.url << "\")\n";
+    return false;
   }
+  const CURLMcode mres = curl_multi_add_handle(multi_, connection->curl);
+  if (mres != CURLM_OK) {
+    std::cerr << "ZipkinExporter: curl error: " << curl_multi_strerror(mres)
+              << " (sending to \"" << options_.url << "\")\n";
+    return false;
+  }
+  connection->start_time = absl::Now();
+  OPENCENSUS_PROBE2(export_rpc_begin, kExporterName, connection);
+  return true;
+}
 
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+void ZipkinExportHandler::Spool(absl::string_view body) {
+  spool_record_.assign(1, spool_tag_);
+  spool_record_.append(body.data(), body.size());
+  if (!spool_->Append(spool_record_)) {
+    std::cerr << "ZipkinExporter: request too large to spool.\n";
+  }
+}
+
+void ZipkinExportHandler::SendBatches(size_t num_batches) {
+  if (spool_ != nullptr && spool_->BackingOff(absl::Now())) {
+    std::string body;
+    for (size_t i = 0; i < num_batches; ++i) {
+      if (MakeBody(&batches_[i], &body)) {
+        Spool(body);
+      }
+    }
+    return;
+  }
+  size_t num_replayed =
+      spool_ == nullptr
+          ? 0
+          : std::min<size_t>(spool_->num_records(), kMaxReplayedRequests);
+  const bool any_requests = num_batches > 0 || num_replayed > 0;
+  // Whether any request failed in a way that is worth retrying later.
+  bool transient_failure = false;
+  size_t next_batch = 0;
+  size_t num_in_flight = 0;
+  while (next_batch < num_batches || num_replayed > 0 || num_in_flight > 0) {
+    while ((next_batch < num_batches || num_replayed > 0) &&
+           !idle_connections_.empty()) {
+      Connection* connection = idle_connections_.back();
+      if (num_replayed > 0) {
+        // Spooled requests are older, so they go first.
+        --num_replayed;
+        const absl::string_view record = spool_->Front();
+        const bool usable = !record.empty() && record[0] == spool_tag_;
+        if (usable) {
+          connection->body.assign(record.data() + 1, record.size() - 1);
+        }
+        spool_->PopFront();
+        if (!usable) {
+          // Spooled by an exporter with other options.
+          continue;
+        }
+      } else if (!MakeBody(&batches_[next_batch++], &connection->body)) {
+        opencensus::common::RecordSelfMetric(
+            opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+            kExporterName);
+        continue;
+      }
+      if (StartRequest(connection)) {
+        idle_connections_.pop_back();
+        ++num_in_flight;
+      } else {
+        opencensus::common::RecordSelfMetric(
+            opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+            kExporterName);
+      }
+    }
+    int running;
+    curl_multi_perform(multi_, &running);
+    CURLMsg* msg;
+    int queued;
+    while ((msg = curl_multi_info_read(multi_, &queued)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) continue;
+      Connection* connection;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &connection);
+      opencensus::common::RecordSelfMetric(
+          opencensus::common::SelfMetric::kExporterRpcLatency,
+          absl::ToDoubleMilliseconds(absl::Now() - connection->start_time),
+          kExporterName);
+      long http_code = 0;
+      if (msg->data.result != CURLE_OK) {
+        opencensus::common::RecordSelfMetric(
+            opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+            kExporterName);
+        std::cerr << "ZipkinExporter: curl error: "
+                  << curl_easy_strerror(msg->data.result) << " (sending to \""
+                  << options_.url << "\")\n";
+      } else {
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE,
+                          &http_code);
+        if (http_code >= 400) {
+          opencensus::common::RecordSelfMetric(
+              opencensus::common::SelfMetric::kExporterRpcErrors, 1,
+              kExporterName);
+          std::cerr << "ZipkinExporter: HTTP status " << http_code
+                    << " (sending to \"" << options_.url << "\")\n";
+        }
+      }
+      OPENCENSUS_PROBE3(export_rpc_end, kExporterName, connection, http_code);
+      // Requests rejected as invalid would fail again, so only those that
+      // did not reach the server or found it unavailable are spooled.
+      if (msg->data.result != CURLE_OK || http_code == 429 ||
+          http_code >= 500) {
+        transient_failure = true;
+        if (spool_ != nullptr) {
+          Spool(connection->body);
+        }
+      }
+      curl_multi_remove_handle(multi_, msg->easy_handle);
+      idle_connections_.push_back(connection);
+      --num_in_flight;
+    }
+    if (num_in_flight > 0) {
+      curl_multi_wait(multi_, nullptr, 0, /*timeout_ms=*/100, nullptr);
+    }
+  }
+  if (spool_ != nullptr && any_requests) {
+    if (transient_failure) {
+      spool_->RecordFailure(absl::Now());
+    } else {
+      spool_->RecordSuccess();
+    }
+  }
 }
 
 void ZipkinExportHandler::Export(
     const std::vector<::opencensus::trace::exporter::SpanData>& spans) {
-  if (!spans.empty()) {
-    std::string msg = EncodeJson(spans, service_);
-    SendMessage(msg, msg.size());
+  absl::MutexLock l(&mu_);
+  if (connections_.empty()) {
+    return;
   }
+  const size_t num_batches =
+      options_.encoding == ZipkinExporterOptions::Encoding::kProto3
+          ? proto_encoder_.Encode(spans, service_, options_.max_batch_bytes,
+                                  &batches_)
+          : json_encoder_.Encode(spans, service_, options_.max_batch_bytes,
+                                 &batches_);
+  SendBatches(num_batches);
 }
 
 }  // namespace
@@ -42,6 +42,28 @@ struct ZipkinExporterOptions {
   // The maximum timeout for HTTP request. The default request timeout is 15
   // seconds.
   absl::Duration request_timeout = absl::Seconds(15);
+  // The encoding of request bodies: JSON, or the smaller and cheaper to
+  // produce zipkin.proto3.ListOfSpans protobuf (sent as
+  // "application/x-protobuf").
+  enum class Encoding : uint8_t { kJson, kProto3 };
+  Encoding encoding = Encoding::kJson;
+  // If true, request bodies are gzip-compressed and sent with
+  // "Content-Encoding: gzip".
+  bool gzip_compression = false;
+  // The maximum size in bytes of the (uncompressed) body sent in each request;
+  // larger exports are split into several requests. A single span larger than
+  // this is still sent. 0 means no limit.
+  size_t max_batch_bytes = 0;
+  // The maximum number of requests sent concurrently when an export is split
+  // into several.
+  size_t max_concurrent_requests = 1;
+  // If not empty, requests that fail because the server is unreachable or
+  // overloaded (or that are made while backing off after such a failure) are
+  // kept in a memory-mapped file at this path, holding at most
+  // spool_max_bytes, and resent once the server is back. Spooled requests
+  // survive restarts, as long as the encoding and compression are unchanged.
+  std::string spool_path;
+  size_t spool_max_bytes = 64 << 20;
   // Service name used by zipkin collector.
   std::string service_name;
   // Address family to be reported to zipkin collector.
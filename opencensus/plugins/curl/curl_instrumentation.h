@@ -0,0 +1,119 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_PLUGINS_CURL_CURL_INSTRUMENTATION_H_
+#define OPENCENSUS_PLUGINS_CURL_CURL_INSTRUMENTATION_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/span.h"
+
+namespace opencensus {
+namespace plugins {
+namespace curl {
+
+// CurlInstrumentation instruments the HTTP requests made with one curl easy
+// handle. Each request runs in a client span, a child of the current span,
+// whose context is sent in a "traceparent" header, and records the
+// opencensus.io/http/client measures (roundtrip latency, and bytes sent and
+// received) under the request's method and response status.
+//
+// The traceparent header lives in a header list node owned by the
+// CurlInstrumentation, which is rewritten in place for each request and is
+// linked in front of the caller's headers, so instrumenting a request does
+// not allocate headers. Measures are bound once per method and status.
+//
+// Usage:
+//   CURL* curl = curl_easy_init();
+//   CurlInstrumentation instrumentation(curl);
+//   instrumentation.SetHeaders(headers);  // Instead of CURLOPT_HTTPHEADER.
+//   curl_easy_setopt(curl, CURLOPT_URL, "http://example.com/");
+//   instrumentation.StartRequest("GET", "example.com/");
+//   instrumentation.EndRequest(curl_easy_perform(curl));
+//
+// CurlInstrumentation is thread-compatible, like the curl handle.
+class CurlInstrumentation final {
+ public:
+  // 'curl' must outlive the CurlInstrumentation.
+  explicit CurlInstrumentation(CURL* curl);
+  ~CurlInstrumentation();
+
+  CurlInstrumentation(const CurlInstrumentation&) = delete;
+  CurlInstrumentation& operator=(const CurlInstrumentation&) = delete;
+
+  // Sets the headers sent after the traceparent header on every request. This
+  // replaces setting CURLOPT_HTTPHEADER on the handle, which would drop the
+  // traceparent header. 'headers' are not owned, and must remain valid until
+  // the last request using them ends.
+  void SetHeaders(const struct curl_slist* headers);
+
+  // Starts the span, named 'span_name', of a request with HTTP method
+  // 'method' (e.g. "GET"), and sets the handle's headers to send its context.
+  // Call just before curl_easy_perform() (or adding the handle to a multi
+  // handle). 'method' should come from a small set of values, since it is a
+  // tag value.
+  void StartRequest(absl::string_view method, absl::string_view span_name);
+
+  // Ends the request started by StartRequest(), which completed with 'result',
+  // recording its stats and ending its span.
+  void EndRequest(CURLcode result);
+
+  // The span of the request in progress, or of the last request if none is.
+  const opencensus::trace::Span& span() const { return span_; }
+  // The headers set on the handle: the traceparent header followed by those
+  // passed to SetHeaders().
+  const struct curl_slist* headers() const { return &traceparent_node_; }
+
+  // Registers the opencensus.io/http/client views (latency and completed
+  // requests by method and status, and bytes sent and received by method) for
+  // export.
+  static void RegisterViewsForExport();
+
+ private:
+  struct BoundStats;
+
+  // Returns the bound measures for the current method and 'status', creating
+  // them on first use.
+  const BoundStats& StatsFor(long status);
+
+  static constexpr char kHeaderPrefix[] = "traceparent: ";
+  static constexpr int kHeaderPrefixLen = sizeof(kHeaderPrefix) - 1;
+
+  CURL* const curl_;
+  // "traceparent: <header>", NUL-terminated; traceparent_node_.data points to
+  // it.
+  char traceparent_[kHeaderPrefixLen +
+                    opencensus::trace::propagation::kTraceParentHeaderLen + 1];
+  struct curl_slist traceparent_node_;
+
+  std::string method_;
+  absl::Time start_time_;
+  opencensus::trace::Span span_;
+  // Searched linearly, since a handle makes requests with few distinct
+  // methods and statuses.
+  std::vector<std::unique_ptr<BoundStats>> stats_;
+};
+
+}  // namespace curl
+}  // namespace plugins
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_PLUGINS_CURL_CURL_INSTRUMENTATION_H_
@@ -0,0 +1,286 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/plugins/curl/curl_instrumentation.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/trace/attribute_value_ref.h"
+#include "opencensus/trace/context_util.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/status_code.h"
+
+namespace opencensus {
+namespace plugins {
+namespace curl {
+
+using opencensus::stats::Aggregation;
+using opencensus::stats::BucketBoundaries;
+using opencensus::stats::MeasureDefinition;
+using opencensus::stats::MeasureDescriptor;
+using opencensus::stats::ViewDefinition;
+using opencensus::trace::StatusCode;
+
+namespace {
+
+enum Measures { kRoundtripLatency, kSentBytes, kReceivedBytes };
+
+constexpr MeasureDefinition kMeasures[] = {
+    {"opencensus.io/http/client/roundtrip_latency",
+     "Time between the start of a request and the end of its response.", "ms",
+     MeasureDescriptor::Type::kDouble},
+    {"opencensus.io/http/client/sent_bytes",
+     "Total bytes sent in request bodies.", "By",
+     MeasureDescriptor::Type::kInt64},
+    {"opencensus.io/http/client/received_bytes",
+     "Total bytes received in response bodies.", "By",
+     MeasureDescriptor::Type::kInt64},
+};
+
+enum TagKeys { kMethod, kStatus };
+
+constexpr const char* kTagKeys[] = {"http_client_method",
+                                     "http_client_status"};
+
+constexpr int kMethodColumns[] = {kMethod};
+constexpr int kMethodStatusColumns[] = {kMethod, kStatus};
+
+Aggregation LatencyDistribution() {
+  return Aggregation::Distribution(BucketBoundaries::Explicit(
+      {0,   1,   2,   3,   4,    5,    6,    8,    10,   13,    16,    20,
+       25,  30,  40,  50,  65,   80,   100,  130,  160,  200,   250,   300,
+       400, 500, 650, 800, 1000, 2000, 5000, 10000, 20000, 50000, 100000}));
+}
+
+Aggregation BytesDistribution() {
+  // 0, then powers of 4 from 1KiB to 4GiB.
+  std::vector<double> boundaries = {0};
+  for (double bound = 1024; bound <= 4294967296.0; bound *= 4) {
+    boundaries.push_back(bound);
+  }
+  return Aggregation::Distribution(
+      BucketBoundaries::Explicit(std::move(boundaries)));
+}
+
+constexpr ViewDefinition kViews[] = {
+    {"opencensus.io/http/client/roundtrip_latency",
+     "Distribution of HTTP client request latency, by method and status.",
+     kRoundtripLatency, &LatencyDistribution, kMethodStatusColumns},
+    {"opencensus.io/http/client/completed_count",
+     "Count of completed HTTP client requests, by method and status.",
+     kRoundtripLatency, &Aggregation::Count, kMethodStatusColumns},
+    {"opencensus.io/http/client/sent_bytes",
+     "Distribution of bytes sent per HTTP client request, by method.",
+     kSentBytes, &BytesDistribution, kMethodColumns},
+    {"opencensus.io/http/client/received_bytes",
+     "Distribution of bytes received per HTTP client request, by method.",
+     kReceivedBytes, &BytesDistribution, kMethodColumns},
+};
+
+const opencensus::stats::StatsDefinitions& Definitions() {
+  static const opencensus::stats::StatsDefinitions* definitions =
+      new opencensus::stats::StatsDefinitions(kMeasures, kTagKeys, kViews);
+  return *definitions;
+}
+
+// The status recorded for requests that failed without a response.
+constexpr long kNoResponse = -1;
+
+// Maps an HTTP status to a canonical code, as the OpenCensus HTTP
+// specification does.
+StatusCode HttpStatusToCode(long status) {
+  if (status >= 200 && status < 400) {
+    return StatusCode::OK;
+  }
+  switch (status) {
+    case 400:
+      return StatusCode::INVALID_ARGUMENT;
+    case 401:
+      return StatusCode::UNAUTHENTICATED;
+    case 403:
+      return StatusCode::PERMISSION_DENIED;
+    case 404:
+      return StatusCode::NOT_FOUND;
+    case 429:
+      return StatusCode::RESOURCE_EXHAUSTED;
+    case 501:
+      return StatusCode::UNIMPLEMENTED;
+    case 503:
+      return StatusCode::UNAVAILABLE;
+    case 504:
+      return StatusCode::DEADLINE_EXCEEDED;
+  }
+  if (status >= 400 && status < 500) {
+    return StatusCode::INVALID_ARGUMENT;
+  }
+  if (status >= 500 && status < 600) {
+    return StatusCode::INTERNAL;
+  }
+  return StatusCode::UNKNOWN;
+}
+
+StatusCode CurlResultToCode(CURLcode result) {
+  switch (result) {
+    case CURLE_OPERATION_TIMEDOUT:
+      return StatusCode::DEADLINE_EXCEEDED;
+    case CURLE_COULDNT_RESOLVE_PROXY:
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+      return StatusCode::UNAVAILABLE;
+    case CURLE_ABORTED_BY_CALLBACK:
+      return StatusCode::CANCELLED;
+    default:
+      return StatusCode::UNKNOWN;
+  }
+}
+
+int64_t GetSize(CURL* curl, CURLINFO info) {
+  curl_off_t size = 0;
+  if (curl_easy_getinfo(curl, info, &size) != CURLE_OK) {
+    return 0;
+  }
+  return size;
+}
+
+}  // namespace
+
+constexpr char CurlInstrumentation::kHeaderPrefix[];
+constexpr int CurlInstrumentation::kHeaderPrefixLen;
+
+struct CurlInstrumentation::BoundStats {
+  BoundStats(absl::string_view method, long status)
+      : method(method),
+        status(status),
+        tags({{Definitions().tag_key(kMethod), method},
+              {Definitions().tag_key(kStatus),
+               status == kNoResponse ? "error" : absl::StrCat(status)}}),
+        latency(Definitions().measure_double(kRoundtripLatency), tags),
+        sent_bytes(Definitions().measure_int64(kSentBytes), tags),
+        received_bytes(Definitions().measure_int64(kReceivedBytes), tags) {}
+
+  const std::string method;
+  const long status;
+  const opencensus::tags::TagMap tags;
+  const opencensus::stats::BoundMeasure<double> latency;
+  const opencensus::stats::BoundMeasure<int64_t> sent_bytes;
+  const opencensus::stats::BoundMeasure<int64_t> received_bytes;
+};
+
+CurlInstrumentation::CurlInstrumentation(CURL* curl)
+    : curl_(curl), span_(opencensus::trace::Span::BlankSpan()) {
+  Definitions();
+  std::memcpy(traceparent_, kHeaderPrefix, kHeaderPrefixLen);
+  // Filled in by each request.
+  std::memset(traceparent_ + kHeaderPrefixLen, '0',
+              opencensus::trace::propagation::kTraceParentHeaderLen);
+  traceparent_[sizeof(traceparent_) - 1] = '\0';
+  traceparent_node_.data = traceparent_;
+  traceparent_node_.next = nullptr;
+}
+
+CurlInstrumentation::~CurlInstrumentation() {
+  // The handle must not keep using the node once it is gone.
+  curl_easy_setopt(curl_, CURLOPT_HTTPHEADER,
+                   static_cast<struct curl_slist*>(nullptr));
+}
+
+void CurlInstrumentation::SetHeaders(const struct curl_slist* headers) {
+  // curl does not modify the list, but takes a non-const pointer.
+  traceparent_node_.next = const_cast<struct curl_slist*>(headers);
+}
+
+void CurlInstrumentation::StartRequest(absl::string_view method,
+                                       absl::string_view span_name) {
+  method_.assign(method.data(), method.size());
+  start_time_ = absl::Now();
+  const opencensus::trace::Span& parent = opencensus::trace::GetCurrentSpan();
+  // Span is copy- but not move-assignable.
+  const opencensus::trace::Span span = opencensus::trace::Span::StartSpan(
+      span_name, parent.context().IsValid() ? &parent : nullptr);
+  span_ = span;
+  opencensus::trace::propagation::ToTraceParentHeader(
+      span_.context(), traceparent_ + kHeaderPrefixLen);
+  curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, &traceparent_node_);
+}
+
+void CurlInstrumentation::EndRequest(CURLcode result) {
+  const double latency_ms =
+      absl::ToDoubleMilliseconds(absl::Now() - start_time_);
+  long status = kNoResponse;
+  if (result == CURLE_OK &&
+      curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status) != CURLE_OK) {
+    status = kNoResponse;
+  }
+  const BoundStats& stats = StatsFor(status);
+  stats.latency.Record(latency_ms);
+  stats.sent_bytes.Record(GetSize(curl_, CURLINFO_SIZE_UPLOAD_T));
+  stats.received_bytes.Record(GetSize(curl_, CURLINFO_SIZE_DOWNLOAD_T));
+
+  if (span_.IsRecording()) {
+    span_.AddAttribute(opencensus::trace::StaticString("http.method"),
+                       method_);
+    const char* url = nullptr;
+    if (curl_easy_getinfo(curl_, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK &&
+        url != nullptr) {
+      span_.AddAttribute(opencensus::trace::StaticString("http.url"), url);
+    }
+    if (status != kNoResponse) {
+      span_.AddAttribute(opencensus::trace::StaticString("http.status_code"),
+                         static_cast<int64_t>(status));
+    }
+  }
+  if (result != CURLE_OK) {
+    span_.SetStatus(CurlResultToCode(result), curl_easy_strerror(result));
+  } else {
+    span_.SetStatus(HttpStatusToCode(status));
+  }
+  span_.End();
+}
+
+const CurlInstrumentation::BoundStats& CurlInstrumentation::StatsFor(
+    long status) {
+  for (const auto& stats : stats_) {
+    if (stats->status == status && stats->method == method_) {
+      return *stats;
+    }
+  }
+  stats_.push_back(absl::make_unique<BoundStats>(method_, status));
+  return *stats_.back();
+}
+
+// static
+void CurlInstrumentation::RegisterViewsForExport() {
+  Definitions().RegisterViewsForExport();
+}
+
+}  // namespace curl
+}  // namespace plugins
+}  // namespace opencensus
@@ -0,0 +1,123 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/plugins/curl/curl_instrumentation.h"
+
+#include <cstdio>
+#include <string>
+
+#include <curl/curl.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/with_span.h"
+
+namespace opencensus {
+namespace plugins {
+namespace curl {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+size_t DiscardBody(char* data, size_t size, size_t nmemb, void* userdata) {
+  return size * nmemb;
+}
+
+class CurlInstrumentationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    curl_ = curl_easy_init();
+    ASSERT_NE(nullptr, curl_);
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &DiscardBody);
+  }
+  void TearDown() override { curl_easy_cleanup(curl_); }
+
+  CURL* curl_ = nullptr;
+};
+
+TEST_F(CurlInstrumentationTest, InjectsTraceParent) {
+  static opencensus::trace::AlwaysSampler sampler;
+  const auto parent =
+      opencensus::trace::Span::StartSpan("parent", nullptr, {&sampler});
+  struct curl_slist* headers = curl_slist_append(nullptr, "Accept: */*");
+  {
+    CurlInstrumentation instrumentation(curl_);
+    instrumentation.SetHeaders(headers);
+    for (int i = 0; i < 2; ++i) {
+      opencensus::trace::WithSpan with_span(parent);
+      instrumentation.StartRequest("GET", "request");
+      const opencensus::trace::Span& span = instrumentation.span();
+      EXPECT_EQ(parent.context().trace_id(), span.context().trace_id());
+      // The header is rewritten in place for each request.
+      EXPECT_EQ(absl::StrCat("traceparent: ",
+                             opencensus::trace::propagation::
+                                 ToTraceParentHeader(span.context())),
+                instrumentation.headers()->data);
+      EXPECT_EQ(headers, instrumentation.headers()->next);
+      instrumentation.EndRequest(CURLE_OK);
+    }
+  }
+  curl_slist_free_all(headers);
+}
+
+TEST_F(CurlInstrumentationTest, RecordsStats) {
+  CurlInstrumentation::RegisterViewsForExport();
+  const std::string path =
+      absl::StrCat(::testing::TempDir(), "/curl_test_file");
+  FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  std::fputs("0123456789", file);
+  std::fclose(file);
+
+  CurlInstrumentation instrumentation(curl_);
+  curl_easy_setopt(curl_, CURLOPT_URL, absl::StrCat("file://", path).c_str());
+  instrumentation.StartRequest("GET_FILE", "read file");
+  instrumentation.EndRequest(curl_easy_perform(curl_));
+  // A failed request is recorded with status "error".
+  curl_easy_setopt(curl_, CURLOPT_URL,
+                   absl::StrCat("file://", path, ".missing").c_str());
+  instrumentation.StartRequest("GET_FILE", "read missing file");
+  instrumentation.EndRequest(curl_easy_perform(curl_));
+  opencensus::stats::testing::TestUtils::Flush();
+
+  const auto key = opencensus::tags::TagKey::Register("http_client_method");
+  const auto completed = opencensus::stats::StatsExporter::GetViewData(
+      "opencensus.io/http/client/completed_count", {{key, "GET_FILE"}});
+  ASSERT_TRUE(completed.has_value());
+  EXPECT_THAT(completed->second.int_data(),
+              ::testing::UnorderedElementsAre(
+                  Pair(ElementsAre("GET_FILE", "0"), 1),
+                  Pair(ElementsAre("GET_FILE", "error"), 1)));
+  const auto received = opencensus::stats::StatsExporter::GetViewData(
+      "opencensus.io/http/client/received_bytes", {{key, "GET_FILE"}});
+  ASSERT_TRUE(received.has_value());
+  ASSERT_EQ(1, received->second.distribution_data().size());
+  const auto& distribution =
+      received->second.distribution_data().begin()->second;
+  EXPECT_EQ(2, distribution.count());
+  EXPECT_DOUBLE_EQ(5, distribution.mean());
+}
+
+}  // namespace
+}  // namespace curl
+}  // namespace plugins
+}  // namespace opencensus
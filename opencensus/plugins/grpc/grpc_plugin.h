@@ -0,0 +1,91 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_PLUGINS_GRPC_GRPC_PLUGIN_H_
+#define OPENCENSUS_PLUGINS_GRPC_GRPC_PLUGIN_H_
+
+#include <memory>
+#include <utility>
+
+#include <grpcpp/support/client_interceptor.h>
+#include <grpcpp/support/server_interceptor.h>
+
+#include "opencensus/trace/span.h"
+
+namespace opencensus {
+namespace plugins {
+namespace grpc {
+
+// Interceptors that instrument gRPC calls with OpenCensus: each RPC records the
+// standard grpc.io client or server measures under its method and status
+// tags, and runs in a span named "Sent.<service>/<method>" (client) or
+// "Recv.<service>/<method>" (server). Clients send the current span's context
+// in the "grpc-trace-bin" header and the current tags in "grpc-tags-bin";
+// servers parent their spans on, and record under, what they receive. Servers
+// only accept tags whose keys they have registered (e.g. as view columns), so
+// clients cannot add keys to the server's registry.
+//
+// Method names, span names, and tags are resolved once per method, and the
+// measures once per method and status, so an RPC without propagated tags
+// records through cached handles without building any strings or TagMaps.
+//
+// Do not combine these with gRPC's own OpenCensus plugin
+// (grpc::RegisterOpenCensusPlugin()), which registers the same measures.
+//
+// Usage:
+//   std::vector<std::unique_ptr<
+//       grpc::experimental::ClientInterceptorFactoryInterface>> interceptors;
+//   interceptors.push_back(
+//       opencensus::plugins::grpc::MakeClientInterceptorFactory());
+//   auto channel = grpc::experimental::CreateCustomChannelWithInterceptors(
+//       target, credentials, grpc::ChannelArguments(),
+//       std::move(interceptors));
+//
+//   std::vector<std::unique_ptr<
+//       grpc::experimental::ServerInterceptorFactoryInterface>> creators;
+//   creators.push_back(
+//       opencensus::plugins::grpc::MakeServerInterceptorFactory());
+//   builder.experimental().SetInterceptorCreators(std::move(creators));
+std::unique_ptr<::grpc::experimental::ClientInterceptorFactoryInterface>
+MakeClientInterceptorFactory();
+std::unique_ptr<::grpc::experimental::ServerInterceptorFactoryInterface>
+MakeServerInterceptorFactory();
+
+// Registers the standard grpc.io client and server views (latency, completed
+// RPCs, and bytes and messages per RPC, by method) for export.
+void RegisterRpcViewsForExport();
+
+namespace internal {
+// The type ServerRpcInfo::server_context() returns. In newer gRPC versions it
+// is the common base class of the sync and callback server contexts.
+typedef decltype(std::declval<::grpc::experimental::ServerRpcInfo&>()
+                     .server_context()) ServerContextPointer;
+
+opencensus::trace::Span GetServerSpan(ServerContextPointer context);
+}  // namespace internal
+
+// Returns the span of the server RPC handled under 'context' (a ServerContext,
+// or a CallbackServerContext for callback services), for starting child spans
+// in the handler, or a blank span if the RPC is not instrumented or has
+// finished.
+template <typename ServerContextT>
+opencensus::trace::Span GetServerSpan(const ServerContextT* context) {
+  return internal::GetServerSpan(const_cast<ServerContextT*>(context));
+}
+
+}  // namespace grpc
+}  // namespace plugins
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_PLUGINS_GRPC_GRPC_PLUGIN_H_
@@ -0,0 +1,314 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/plugins/grpc/grpc_plugin.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <grpcpp/client_context.h>
+#include <grpcpp/server_context.h>
+#include <grpcpp/support/client_interceptor.h>
+#include <grpcpp/support/interceptor.h>
+#include <grpcpp/support/server_interceptor.h>
+#include <grpcpp/support/status.h>
+#include <grpcpp/support/string_ref.h>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/plugins/grpc/internal/rpc_stats.h"
+#include "opencensus/tags/context_util.h"
+#include "opencensus/tags/propagation/grpc_tags_bin.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/trace/context_util.h"
+#include "opencensus/trace/propagation/grpc_trace_bin.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/status_code.h"
+
+namespace opencensus {
+namespace plugins {
+namespace grpc {
+
+using ::grpc::experimental::InterceptionHookPoints;
+using ::grpc::experimental::InterceptorBatchMethods;
+
+using internal::ServerContextPointer;
+
+namespace {
+
+constexpr char kTraceHeader[] = "grpc-trace-bin";
+constexpr char kTagsHeader[] = "grpc-tags-bin";
+
+absl::string_view ToStringView(const ::grpc::string_ref& s) {
+  return absl::string_view(s.data(), s.size());
+}
+
+// The spans of running server RPCs, keyed by ServerContextPointer, for
+// GetServerSpan().
+class ServerSpans final {
+ public:
+  static ServerSpans* Get() {
+    static ServerSpans* global_server_spans = new ServerSpans;
+    return global_server_spans;
+  }
+
+  void Add(const void* context,
+           const opencensus::trace::Span& span) LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    spans_.emplace(context, span);
+  }
+
+  void Remove(const void* context) LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    spans_.erase(context);
+  }
+
+  opencensus::trace::Span Find(const void* context) const
+      LOCKS_EXCLUDED(mu_) {
+    absl::ReaderMutexLock l(&mu_);
+    const auto it = spans_.find(context);
+    if (it == spans_.end()) {
+      return opencensus::trace::Span::BlankSpan();
+    }
+    return it->second;
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<const void*, opencensus::trace::Span>
+      spans_ GUARDED_BY(mu_);
+};
+
+// Starts a span for the RPC named 'method' that is a child of the current
+// span, if it is valid.
+opencensus::trace::Span StartClientSpan(const MethodInfo& method) {
+  const opencensus::trace::Span& parent = opencensus::trace::GetCurrentSpan();
+  return opencensus::trace::Span::StartSpan(
+      method.span_name(), parent.context().IsValid() ? &parent : nullptr);
+}
+
+// A ClientInterceptor instruments one client RPC. It is created on the thread
+// starting the RPC, so it takes the parent span and tags from the current
+// context then.
+class ClientInterceptor final : public ::grpc::experimental::Interceptor {
+ public:
+  explicit ClientInterceptor(const MethodInfo& method)
+      : method_(method),
+        start_time_(absl::Now()),
+        tags_(opencensus::tags::GetCurrentTagMap()),
+        span_(StartClientSpan(method)) {}
+
+  void Intercept(InterceptorBatchMethods* methods) override {
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::PRE_SEND_INITIAL_METADATA)) {
+      std::multimap<std::string, std::string>* metadata =
+          methods->GetSendInitialMetadata();
+      metadata->emplace(kTraceHeader,
+                        opencensus::trace::propagation::ToGrpcTraceBinHeader(
+                            span_.context()));
+      if (!tags_.tag_views().empty()) {
+        metadata->emplace(
+            kTagsHeader,
+            opencensus::tags::propagation::ToGrpcTagsBinHeader(tags_));
+      }
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::PRE_SEND_MESSAGE)) {
+      ++totals_.sent_messages;
+      const ::grpc::ByteBuffer* message = methods->GetSerializedSendMessage();
+      if (message != nullptr) {
+        totals_.sent_bytes += message->Length();
+      }
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::POST_RECV_MESSAGE) &&
+        methods->GetRecvMessage() != nullptr) {
+      // Failed reads (e.g. at the end of a stream) have no message.
+      ++totals_.received_messages;
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::POST_RECV_STATUS)) {
+      const ::grpc::Status& status = *methods->GetRecvStatus();
+      totals_.latency_ms =
+          absl::ToDoubleMilliseconds(absl::Now() - start_time_);
+      method_.Record(status.error_code(), totals_, tags_);
+      span_.SetStatus(
+          static_cast<opencensus::trace::StatusCode>(status.error_code()),
+          status.error_message());
+      span_.End();
+    }
+    methods->Proceed();
+  }
+
+ private:
+  const MethodInfo& method_;
+  const absl::Time start_time_;
+  const opencensus::tags::TagMap tags_;
+  const opencensus::trace::Span span_;
+  RpcTotals totals_ = {0, 0, 0, 0};
+};
+
+// A ServerInterceptor instruments one server RPC, from its creation when the
+// call arrives until the status is sent.
+class ServerInterceptor final : public ::grpc::experimental::Interceptor {
+ public:
+  ServerInterceptor(const MethodInfo& method, ServerContextPointer context)
+      : method_(method),
+        context_(context),
+        start_time_(absl::Now()),
+        span_(opencensus::trace::Span::BlankSpan()),
+        tags_({}) {}
+
+  ~ServerInterceptor() override {
+    if (!finished_) {
+      // The RPC ended without a status, e.g. because it was cancelled.
+      Finish(::grpc::StatusCode::CANCELLED, "");
+    }
+    if (context_ != nullptr) {
+      ServerSpans::Get()->Remove(context_);
+    }
+  }
+
+  void Intercept(InterceptorBatchMethods* methods) override {
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::POST_RECV_INITIAL_METADATA)) {
+      StartSpan(*methods->GetRecvInitialMetadata());
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::POST_RECV_MESSAGE) &&
+        methods->GetRecvMessage() != nullptr) {
+      ++totals_.received_messages;
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::PRE_SEND_MESSAGE)) {
+      ++totals_.sent_messages;
+      const ::grpc::ByteBuffer* message = methods->GetSerializedSendMessage();
+      if (message != nullptr) {
+        totals_.sent_bytes += message->Length();
+      }
+    }
+    if (methods->QueryInterceptionHookPoint(
+            InterceptionHookPoints::PRE_SEND_STATUS)) {
+      const ::grpc::Status status = methods->GetSendStatus();
+      Finish(status.error_code(), status.error_message());
+    }
+    methods->Proceed();
+  }
+
+ private:
+  void StartSpan(
+      const std::multimap<::grpc::string_ref, ::grpc::string_ref>& metadata) {
+    opencensus::trace::SpanContext parent;
+    const auto trace_header = metadata.find(kTraceHeader);
+    if (trace_header != metadata.end()) {
+      parent = opencensus::trace::propagation::FromGrpcTraceBinHeader(
+          ToStringView(trace_header->second));
+    }
+    // Only keys this process has registered are kept: decoding never registers
+    // the client's keys.
+    const auto tags_header = metadata.find(kTagsHeader);
+    if (tags_header != metadata.end()) {
+      opencensus::tags::TagMap tags({});
+      if (opencensus::tags::propagation::FromGrpcTagsBinHeader(
+              ToStringView(tags_header->second), &tags)) {
+        tags_ = std::move(tags);
+      }
+    }
+    // Span is copy- but not move-assignable.
+    const opencensus::trace::Span span =
+        parent.IsValid()
+            ? opencensus::trace::Span::StartSpanWithRemoteParent(
+                  method_.span_name(), parent)
+            : opencensus::trace::Span::StartSpan(method_.span_name());
+    span_ = span;
+    if (context_ != nullptr) {
+      ServerSpans::Get()->Add(context_, span_);
+    }
+  }
+
+  void Finish(int code, const std::string& message) {
+    finished_ = true;
+    totals_.latency_ms = absl::ToDoubleMilliseconds(absl::Now() - start_time_);
+    method_.Record(code, totals_, tags_);
+    span_.SetStatus(static_cast<opencensus::trace::StatusCode>(code),
+                    message);
+    span_.End();
+  }
+
+  const MethodInfo& method_;
+  const ServerContextPointer context_;
+  const absl::Time start_time_;
+  opencensus::trace::Span span_;
+  opencensus::tags::TagMap tags_;
+  RpcTotals totals_ = {0, 0, 0, 0};
+  bool finished_ = false;
+};
+
+class ClientInterceptorFactory final
+    : public ::grpc::experimental::ClientInterceptorFactoryInterface {
+ public:
+  ::grpc::experimental::Interceptor* CreateClientInterceptor(
+      ::grpc::experimental::ClientRpcInfo* info) override {
+    return new ClientInterceptor(
+        MethodCache::Get(RpcSide::kClient)->Find(info->method()));
+  }
+};
+
+class ServerInterceptorFactory final
+    : public ::grpc::experimental::ServerInterceptorFactoryInterface {
+ public:
+  ::grpc::experimental::Interceptor* CreateServerInterceptor(
+      ::grpc::experimental::ServerRpcInfo* info) override {
+    return new ServerInterceptor(
+        MethodCache::Get(RpcSide::kServer)->Find(info->method()),
+        info->server_context());
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<::grpc::experimental::ClientInterceptorFactoryInterface>
+MakeClientInterceptorFactory() {
+  RpcStatsDefinitions();
+  return absl::make_unique<ClientInterceptorFactory>();
+}
+
+std::unique_ptr<::grpc::experimental::ServerInterceptorFactoryInterface>
+MakeServerInterceptorFactory() {
+  RpcStatsDefinitions();
+  return absl::make_unique<ServerInterceptorFactory>();
+}
+
+void RegisterRpcViewsForExport() {
+  RpcStatsDefinitions().RegisterViewsForExport();
+}
+
+namespace internal {
+
+opencensus::trace::Span GetServerSpan(ServerContextPointer context) {
+  return ServerSpans::Get()->Find(context);
+}
+
+}  // namespace internal
+
+}  // namespace grpc
+}  // namespace plugins
+}  // namespace opencensus
@@ -0,0 +1,337 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/plugins/grpc/internal/rpc_stats.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace plugins {
+namespace grpc {
+
+using opencensus::stats::Aggregation;
+using opencensus::stats::BucketBoundaries;
+using opencensus::stats::MeasureDefinition;
+using opencensus::stats::MeasureDescriptor;
+using opencensus::stats::ViewDefinition;
+
+namespace {
+
+enum Measures {
+  kClientRoundtripLatency,
+  kClientSentBytesPerRpc,
+  kClientSentMessagesPerRpc,
+  kClientReceivedMessagesPerRpc,
+  kServerServerLatency,
+  kServerSentBytesPerRpc,
+  kServerSentMessagesPerRpc,
+  kServerReceivedMessagesPerRpc,
+};
+
+constexpr MeasureDefinition kMeasures[] = {
+    {"grpc.io/client/roundtrip_latency",
+     "Time between first byte of request sent to last byte of response "
+     "received, or terminal error.",
+     "ms", MeasureDescriptor::Type::kDouble},
+    {"grpc.io/client/sent_bytes_per_rpc",
+     "Total bytes sent across all request messages per RPC.", "By",
+     MeasureDescriptor::Type::kInt64},
+    {"grpc.io/client/sent_messages_per_rpc",
+     "Number of messages sent in the RPC.", "1",
+     MeasureDescriptor::Type::kInt64},
+    {"grpc.io/client/received_messages_per_rpc",
+     "Number of response messages received per RPC.", "1",
+     MeasureDescriptor::Type::kInt64},
+    {"grpc.io/server/server_latency",
+     "Time between first byte of request received to last byte of response "
+     "sent, or terminal error.",
+     "ms", MeasureDescriptor::Type::kDouble},
+    {"grpc.io/server/sent_bytes_per_rpc",
+     "Total bytes sent across all response messages per RPC.", "By",
+     MeasureDescriptor::Type::kInt64},
+    {"grpc.io/server/sent_messages_per_rpc",
+     "Number of messages sent in the RPC.", "1",
+     MeasureDescriptor::Type::kInt64},
+    {"grpc.io/server/received_messages_per_rpc",
+     "Number of request messages received per RPC.", "1",
+     MeasureDescriptor::Type::kInt64},
+};
+
+enum TagKeys { kClientMethod, kClientStatus, kServerMethod, kServerStatus };
+
+constexpr const char* kTagKeys[] = {"grpc_client_method",
+                                     "grpc_client_status",
+                                     "grpc_server_method",
+                                     "grpc_server_status"};
+
+constexpr int kClientMethodColumns[] = {kClientMethod};
+constexpr int kClientMethodStatusColumns[] = {kClientMethod, kClientStatus};
+constexpr int kServerMethodColumns[] = {kServerMethod};
+constexpr int kServerMethodStatusColumns[] = {kServerMethod, kServerStatus};
+
+Aggregation LatencyDistribution() {
+  return Aggregation::Distribution(BucketBoundaries::Explicit(
+      {0,   0.01, 0.05, 0.1,  0.3,   0.6,   0.8,   1,     2,   3,   4,
+       5,   6,    8,    10,   13,    16,    20,    25,    30,  40,  50,
+       65,  80,   100,  130,  160,   200,   250,   300,   400, 500, 650,
+       800, 1000, 2000, 5000, 10000, 20000, 50000, 100000}));
+}
+
+Aggregation BytesDistribution() {
+  // 0, then powers of 4 from 1KiB to 4GiB.
+  std::vector<double> boundaries = {0};
+  for (double bound = 1024; bound <= 4294967296.0; bound *= 4) {
+    boundaries.push_back(bound);
+  }
+  return Aggregation::Distribution(
+      BucketBoundaries::Explicit(std::move(boundaries)));
+}
+
+Aggregation CountDistribution() {
+  // 0, then powers of 2 from 1 to 65536.
+  std::vector<double> boundaries = {0};
+  for (double bound = 1; bound <= 65536; bound *= 2) {
+    boundaries.push_back(bound);
+  }
+  return Aggregation::Distribution(
+      BucketBoundaries::Explicit(std::move(boundaries)));
+}
+
+constexpr ViewDefinition kViews[] = {
+    {"grpc.io/client/roundtrip_latency/cumulative",
+     "Cumulative distribution of client RPC latency, by method.",
+     kClientRoundtripLatency, &LatencyDistribution, kClientMethodColumns},
+    {"grpc.io/client/completed_rpcs/cumulative",
+     "Cumulative count of completed client RPCs, by method and status.",
+     kClientRoundtripLatency, &Aggregation::Count, kClientMethodStatusColumns},
+    {"grpc.io/client/sent_bytes_per_rpc/cumulative",
+     "Cumulative distribution of bytes sent per client RPC, by method.",
+     kClientSentBytesPerRpc, &BytesDistribution, kClientMethodColumns},
+    {"grpc.io/client/sent_messages_per_rpc/cumulative",
+     "Cumulative distribution of messages sent per client RPC, by method.",
+     kClientSentMessagesPerRpc, &CountDistribution, kClientMethodColumns},
+    {"grpc.io/client/received_messages_per_rpc/cumulative",
+     "Cumulative distribution of messages received per client RPC, by "
+     "method.",
+     kClientReceivedMessagesPerRpc, &CountDistribution, kClientMethodColumns},
+    {"grpc.io/server/server_latency/cumulative",
+     "Cumulative distribution of server RPC latency, by method.",
+     kServerServerLatency, &LatencyDistribution, kServerMethodColumns},
+    {"grpc.io/server/completed_rpcs/cumulative",
+     "Cumulative count of completed server RPCs, by method and status.",
+     kServerServerLatency, &Aggregation::Count, kServerMethodStatusColumns},
+    {"grpc.io/server/sent_bytes_per_rpc/cumulative",
+     "Cumulative distribution of bytes sent per server RPC, by method.",
+     kServerSentBytesPerRpc, &BytesDistribution, kServerMethodColumns},
+    {"grpc.io/server/sent_messages_per_rpc/cumulative",
+     "Cumulative distribution of messages sent per server RPC, by method.",
+     kServerSentMessagesPerRpc, &CountDistribution, kServerMethodColumns},
+    {"grpc.io/server/received_messages_per_rpc/cumulative",
+     "Cumulative distribution of messages received per server RPC, by "
+     "method.",
+     kServerReceivedMessagesPerRpc, &CountDistribution, kServerMethodColumns},
+};
+
+constexpr const char* kStatusNames[kNumStatusCodes] = {
+    "OK",
+    "CANCELLED",
+    "UNKNOWN",
+    "INVALID_ARGUMENT",
+    "DEADLINE_EXCEEDED",
+    "NOT_FOUND",
+    "ALREADY_EXISTS",
+    "PERMISSION_DENIED",
+    "RESOURCE_EXHAUSTED",
+    "FAILED_PRECONDITION",
+    "ABORTED",
+    "OUT_OF_RANGE",
+    "UNIMPLEMENTED",
+    "INTERNAL",
+    "UNAVAILABLE",
+    "DATA_LOSS",
+    "UNAUTHENTICATED",
+};
+
+// Returns 'status' if it is a canonical code, and UNKNOWN otherwise.
+int CanonicalStatus(int status) {
+  return status >= 0 && status < kNumStatusCodes ? status : 2;
+}
+
+// The measure of each RpcTotals field on each side.
+struct SideMeasures {
+  int latency;
+  int sent_bytes;
+  int sent_messages;
+  int received_messages;
+  int method_key;
+  int status_key;
+};
+
+constexpr SideMeasures kClientMeasures = {
+    kClientRoundtripLatency,       kClientSentBytesPerRpc,
+    kClientSentMessagesPerRpc,     kClientReceivedMessagesPerRpc,
+    kClientMethod,                 kClientStatus};
+constexpr SideMeasures kServerMeasures = {
+    kServerServerLatency,          kServerSentBytesPerRpc,
+    kServerSentMessagesPerRpc,     kServerReceivedMessagesPerRpc,
+    kServerMethod,                 kServerStatus};
+
+const SideMeasures& MeasuresFor(RpcSide side) {
+  return side == RpcSide::kClient ? kClientMeasures : kServerMeasures;
+}
+
+// gRPC method names start with a '/', which span names omit.
+absl::string_view StripSlash(absl::string_view method) {
+  if (!method.empty() && method[0] == '/') {
+    method.remove_prefix(1);
+  }
+  return method;
+}
+
+}  // namespace
+
+const opencensus::stats::StatsDefinitions& RpcStatsDefinitions() {
+  static const opencensus::stats::StatsDefinitions* definitions =
+      new opencensus::stats::StatsDefinitions(kMeasures, kTagKeys, kViews);
+  return *definitions;
+}
+
+MethodStatusStats::MethodStatusStats(RpcSide side, absl::string_view method,
+                                     absl::string_view status)
+    : tags({{RpcStatsDefinitions().tag_key(MeasuresFor(side).method_key),
+             method},
+            {RpcStatsDefinitions().tag_key(MeasuresFor(side).status_key),
+             status}}),
+      latency(RpcStatsDefinitions().measure_double(MeasuresFor(side).latency),
+              tags),
+      sent_bytes(
+          RpcStatsDefinitions().measure_int64(MeasuresFor(side).sent_bytes),
+          tags),
+      sent_messages(
+          RpcStatsDefinitions().measure_int64(MeasuresFor(side).sent_messages),
+          tags),
+      received_messages(RpcStatsDefinitions().measure_int64(
+                            MeasuresFor(side).received_messages),
+                        tags) {}
+
+MethodInfo::MethodInfo(RpcSide side, absl::string_view method)
+    : side_(side),
+      method_(method),
+      span_name_(absl::StrCat(side == RpcSide::kClient ? "Sent." : "Recv.",
+                              StripSlash(method))) {
+  for (auto& stats : stats_) {
+    stats.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+void MethodInfo::Record(int status, const RpcTotals& totals,
+                        const opencensus::tags::TagMap& tags) const {
+  status = CanonicalStatus(status);
+  if (tags.tag_views().empty()) {
+    const MethodStatusStats& stats = StatsForStatus(status);
+    stats.latency.Record(totals.latency_ms);
+    stats.sent_bytes.Record(totals.sent_bytes);
+    stats.sent_messages.Record(totals.sent_messages);
+    stats.received_messages.Record(totals.received_messages);
+    return;
+  }
+  const opencensus::stats::StatsDefinitions& definitions =
+      RpcStatsDefinitions();
+  const SideMeasures& measures = MeasuresFor(side_);
+  opencensus::stats::Record(
+      {{definitions.measure_double(measures.latency), totals.latency_ms},
+       {definitions.measure_int64(measures.sent_bytes), totals.sent_bytes},
+       {definitions.measure_int64(measures.sent_messages),
+        totals.sent_messages},
+       {definitions.measure_int64(measures.received_messages),
+        totals.received_messages}},
+      tags.WithAdditionalTags(
+          {{definitions.tag_key(measures.method_key), method_},
+           {definitions.tag_key(measures.status_key), kStatusNames[status]}}));
+}
+
+const MethodStatusStats& MethodInfo::StatsForStatus(int status) const {
+  const MethodStatusStats* stats =
+      stats_[status].load(std::memory_order_acquire);
+  if (stats != nullptr) {
+    return *stats;
+  }
+  absl::MutexLock l(&mu_);
+  stats = stats_[status].load(std::memory_order_relaxed);
+  if (stats == nullptr) {
+    // Leaked, like the MethodInfo itself, since recording threads may still
+    // hold it.
+    stats = new MethodStatusStats(side_, method_, kStatusNames[status]);
+    stats_[status].store(stats, std::memory_order_release);
+  }
+  return *stats;
+}
+
+// static
+MethodCache* MethodCache::Get(RpcSide side) {
+  static MethodCache* client_cache = new MethodCache(RpcSide::kClient);
+  static MethodCache* server_cache = new MethodCache(RpcSide::kServer);
+  return side == RpcSide::kClient ? client_cache : server_cache;
+}
+
+const MethodInfo& MethodCache::Find(const char* method) {
+  struct Entry {
+    const MethodCache* cache;
+    const char* method;
+    const MethodInfo* info;
+  };
+  constexpr int kNumEntries = 16;
+  static thread_local std::array<Entry, kNumEntries> entries;
+  Entry& entry = entries[(reinterpret_cast<uintptr_t>(method) >> 3) %
+                         kNumEntries];
+  // The pointer may have been reused for another name (e.g. by a generic
+  // stub), so a hit still checks the name.
+  if (entry.cache == this && entry.method == method &&
+      std::strcmp(entry.info->method().c_str(), method) == 0) {
+    return *entry.info;
+  }
+  const MethodInfo& info = FindSlow(method);
+  entry = {this, method, &info};
+  return info;
+}
+
+const MethodInfo& MethodCache::FindSlow(absl::string_view method) {
+  absl::MutexLock l(&mu_);
+  auto it = methods_.find(method);
+  if (it == methods_.end()) {
+    it = methods_
+             .emplace(std::string(method),
+                      absl::make_unique<MethodInfo>(side_, method))
+             .first;
+  }
+  return *it->second;
+}
+
+}  // namespace grpc
+}  // namespace plugins
+}  // namespace opencensus
@@ -0,0 +1,135 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_PLUGINS_GRPC_INTERNAL_RPC_STATS_H_
+#define OPENCENSUS_PLUGINS_GRPC_INTERNAL_RPC_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace plugins {
+namespace grpc {
+
+enum class RpcSide { kClient, kServer };
+
+// The number of canonical status codes; codes outside [0, kNumStatusCodes) are
+// recorded as UNKNOWN.
+constexpr int kNumStatusCodes = 17;
+
+// Returns the measures, tag keys, and views of the RPC stats, registering them
+// on first use.
+const opencensus::stats::StatsDefinitions& RpcStatsDefinitions();
+
+// The totals of one RPC, recorded when it ends.
+struct RpcTotals {
+  double latency_ms;
+  int64_t sent_bytes;
+  int64_t sent_messages;
+  int64_t received_messages;
+};
+
+// The bound measures of one method and status, recording under the method and
+// status tags.
+struct MethodStatusStats {
+  MethodStatusStats(RpcSide side, absl::string_view method,
+                    absl::string_view status);
+
+  const opencensus::tags::TagMap tags;
+  const opencensus::stats::BoundMeasure<double> latency;
+  const opencensus::stats::BoundMeasure<int64_t> sent_bytes;
+  const opencensus::stats::BoundMeasure<int64_t> sent_messages;
+  const opencensus::stats::BoundMeasure<int64_t> received_messages;
+};
+
+// MethodInfo holds what the interceptors need for every RPC of a method: its
+// span name and tags, and the bound measures for each status, which are
+// created on first use of the status.
+//
+// MethodInfo is thread-safe.
+class MethodInfo final {
+ public:
+  MethodInfo(RpcSide side, absl::string_view method);
+
+  MethodInfo(const MethodInfo&) = delete;
+  MethodInfo& operator=(const MethodInfo&) = delete;
+
+  // The full method name, e.g. "/package.Service/Method".
+  const std::string& method() const { return method_; }
+  // The span name, e.g. "Sent.package.Service/Method" for clients.
+  const std::string& span_name() const { return span_name_; }
+
+  // Records 'totals' for an RPC of this method that ended with 'status'. If
+  // 'tags' (the tags propagated with the RPC) is not empty, the values are
+  // recorded under 'tags' plus the method and status tags; otherwise, they are
+  // recorded through the bound measures, without building a TagMap.
+  void Record(int status, const RpcTotals& totals,
+              const opencensus::tags::TagMap& tags) const LOCKS_EXCLUDED(mu_);
+
+ private:
+  // 'status' must be a canonical code.
+  const MethodStatusStats& StatsForStatus(int status) const
+      LOCKS_EXCLUDED(mu_);
+
+  const RpcSide side_;
+  const std::string method_;
+  const std::string span_name_;
+
+  mutable absl::Mutex mu_;
+  // Null until first used; entries are never replaced or freed.
+  mutable std::array<std::atomic<const MethodStatusStats*>, kNumStatusCodes>
+      stats_;
+};
+
+// MethodCache maps method names to their MethodInfos, creating each on first
+// use. The gRPC code generator gives each method's calls the same name
+// pointer, so lookups first check a small per-thread cache keyed by the
+// pointer, which holds the last MethodInfo returned for each of a few
+// pointers. Only on a miss is the name hashed and the global map locked.
+//
+// MethodCache is thread-safe.
+class MethodCache final {
+ public:
+  // Returns the client or server cache, which is never destroyed.
+  static MethodCache* Get(RpcSide side);
+
+  // 'method' must be non-null.
+  const MethodInfo& Find(const char* method) LOCKS_EXCLUDED(mu_);
+
+ private:
+  explicit MethodCache(RpcSide side) : side_(side) {}
+
+  const MethodInfo& FindSlow(absl::string_view method) LOCKS_EXCLUDED(mu_);
+
+  const RpcSide side_;
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, std::unique_ptr<MethodInfo>> methods_
+      GUARDED_BY(mu_);
+};
+
+}  // namespace grpc
+}  // namespace plugins
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_PLUGINS_GRPC_INTERNAL_RPC_STATS_H_
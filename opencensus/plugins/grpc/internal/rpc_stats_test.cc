@@ -0,0 +1,91 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/plugins/grpc/internal/rpc_stats.h"
+
+#include <cstring>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace plugins {
+namespace grpc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(MethodCacheTest, FindsByName) {
+  MethodCache* cache = MethodCache::Get(RpcSide::kClient);
+  const MethodInfo& info = cache->Find("/test.Service/Find");
+  EXPECT_EQ("/test.Service/Find", info.method());
+  EXPECT_EQ("Sent.test.Service/Find", info.span_name());
+  EXPECT_EQ(&info, &cache->Find("/test.Service/Find"));
+  // A name at another address finds the same MethodInfo.
+  char name[] = "/test.Service/Find";
+  EXPECT_EQ(&info, &cache->Find(name));
+  // A pointer reused for another name does not.
+  std::strcpy(name, "/test.Service/Get");
+  EXPECT_EQ("/test.Service/Get", cache->Find(name).method());
+
+  EXPECT_EQ("Recv.test.Service/Find",
+            MethodCache::Get(RpcSide::kServer)
+                ->Find("/test.Service/Find")
+                .span_name());
+}
+
+TEST(MethodInfoTest, Record) {
+  RpcStatsDefinitions().RegisterViewsForExport();
+  const MethodInfo& info =
+      MethodCache::Get(RpcSide::kClient)->Find("/test.Service/Record");
+  info.Record(0, {1.5, 10, 1, 2}, {});
+  info.Record(0, {2.5, 20, 1, 2}, {});
+  // Codes outside the canonical range are recorded as UNKNOWN.
+  info.Record(100, {1, 0, 1, 0}, {});
+  const auto key = opencensus::tags::TagKey::Register("rpc_stats_test_key");
+  info.Record(5, {1, 0, 1, 0}, {{key, "value"}});
+  opencensus::stats::testing::TestUtils::Flush();
+
+  const auto method_key =
+      opencensus::tags::TagKey::Register("grpc_client_method");
+  const auto completed = opencensus::stats::StatsExporter::GetViewData(
+      "grpc.io/client/completed_rpcs/cumulative",
+      {{method_key, "/test.Service/Record"}});
+  ASSERT_TRUE(completed.has_value());
+  EXPECT_THAT(
+      completed->second.int_data(),
+      UnorderedElementsAre(
+          Pair(ElementsAre("/test.Service/Record", "OK"), 2),
+          Pair(ElementsAre("/test.Service/Record", "UNKNOWN"), 1),
+          Pair(ElementsAre("/test.Service/Record", "NOT_FOUND"), 1)));
+  const auto bytes = opencensus::stats::StatsExporter::GetViewData(
+      "grpc.io/client/sent_bytes_per_rpc/cumulative",
+      {{method_key, "/test.Service/Record"}});
+  ASSERT_TRUE(bytes.has_value());
+  ASSERT_EQ(1, bytes->second.distribution_data().size());
+  const auto& distribution = bytes->second.distribution_data().begin()->second;
+  EXPECT_EQ(4, distribution.count());
+  EXPECT_DOUBLE_EQ(7.5, distribution.mean());
+}
+
+}  // namespace
+}  // namespace grpc
+}  // namespace plugins
+}  // namespace opencensus
@@ -15,6 +15,7 @@
 #ifndef OPENCENSUS_STATS_BUCKET_BOUNDARIES_H_
 #define OPENCENSUS_STATS_BUCKET_BOUNDARIES_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -24,9 +25,15 @@ namespace stats {
 
 // BucketBoundaries defines the bucket boundaries for distribution
 // aggregations.
-// BucketBoundaries is a value type, and is thread-compatible.
+// BucketBoundaries is a value type, and is thread-compatible. The boundaries
+// are immutable and shared between copies, so copying a BucketBoundaries (or
+// an Aggregation or ViewDescriptor holding one) does not copy them.
 class BucketBoundaries final {
  public:
+  // Moves are copies, so that a moved-from BucketBoundaries remains usable.
+  BucketBoundaries(const BucketBoundaries&) = default;
+  BucketBoundaries& operator=(const BucketBoundaries&) = default;
+
   // Creates a BucketBoundaries with num_finite_buckets each 'width' wide,
   // as well as an underflow and overflow bucket. 'offset' is the lower bound of
   // the first finite bucket, so finite bucket i (1 <= i <= num_finite_buckets)
@@ -53,30 +60,54 @@ class BucketBoundaries final {
   static BucketBoundaries Explicit(std::vector<double> boundaries);
 
   // The number of buckets in a Distribution using this bucketer.
-  int num_buckets() const { return lower_boundaries_.size() + 1; }
+  int num_buckets() const { return lower_boundaries_->size() + 1; }
   // The index of the bucket for a given value, in [0, num_buckets() - 1].
+  // This is constant-time for Linear and Exponential boundaries.
   int BucketForValue(double value) const;
 
   const std::vector<double>& lower_boundaries() const {
-    return lower_boundaries_;
+    return *lower_boundaries_;
   }
 
   std::string DebugString() const;
 
   bool operator==(const BucketBoundaries& other) const {
-    return lower_boundaries_ == other.lower_boundaries_;
+    return lower_boundaries_ == other.lower_boundaries_ ||
+           *lower_boundaries_ == *other.lower_boundaries_;
   }
   bool operator!=(const BucketBoundaries& other) const {
     return !(*this == other);
   }
 
  private:
+  // How the boundaries were constructed, which determines how BucketForValue()
+  // finds buckets. This does not affect equality.
+  enum class Layout { kExplicit, kLinear, kExponential };
+
   BucketBoundaries(std::vector<double> lower_boundaries)
-      : lower_boundaries_(std::move(lower_boundaries)) {}
+      : lower_boundaries_(std::make_shared<const std::vector<double>>(
+            std::move(lower_boundaries))) {}
+  BucketBoundaries(std::vector<double> lower_boundaries, Layout layout,
+                   double origin, double inverse_step)
+      : lower_boundaries_(std::make_shared<const std::vector<double>>(
+            std::move(lower_boundaries))),
+        layout_(layout),
+        origin_(origin),
+        inverse_step_(inverse_step) {}
+
+  // Corrects 'estimate' of the bucket for 'value' to match lower_boundaries_
+  // exactly, since the boundaries accumulate floating-point error.
+  int AdjustBucket(double value, double estimate) const;
 
   // The lower bound of each bucket, excluding the underflow bucket but
-  // including the overflow bucket.
-  std::vector<double> lower_boundaries_;
+  // including the overflow bucket. Never null.
+  std::shared_ptr<const std::vector<double>> lower_boundaries_;
+
+  Layout layout_ = Layout::kExplicit;
+  // For kLinear, the offset; for kExponential, the scale.
+  double origin_ = 0;
+  // For kLinear, 1 / width; for kExponential, 1 / log(growth_factor).
+  double inverse_step_ = 0;
 };
 
 }  // namespace stats
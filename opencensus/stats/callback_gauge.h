@@ -0,0 +1,91 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_CALLBACK_GAUGE_H_
+#define OPENCENSUS_STATS_CALLBACK_GAUGE_H_
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+// CallbackGauge exports a value the application already tracks, such as the
+// length of a queue, by calling a function whenever views are exported (by
+// push handlers or StatsExporter::GetViewData()) rather than by recording it.
+// Exports therefore see the value as of the export, with no recording cost in
+// between.
+//
+// The value is exported as the row for the values of 'tags' of a cumulative
+// view named 'name', with LastValue aggregation of 'measure' and the keys of
+// 'tags' as its columns. Gauges with the same name are exported as rows of a
+// single view, and must have the same measure and tag keys. The name should
+// not be that of a view registered for export. e.g.:
+//
+//   static CallbackGauge<int64_t>* queue_length = new CallbackGauge<int64_t>(
+//       "example.com/queue_length", QueueLengthMeasure(),
+//       [] { return WorkQueue()->size(); }, {{queue_key, "work"}});
+//
+// or, reading an object, which must outlive the gauge:
+//
+//   CallbackGauge<int64_t> queue_length("example.com/queue_length",
+//                                       QueueLengthMeasure(), &queue,
+//                                       &Queue::size, {{queue_key, "work"}});
+//
+// The function is called on exporting threads, possibly concurrently, and
+// must be thread-safe, cheap, and must not create or destroy gauges or views.
+// It is not called once the destructor has returned.
+//
+// CallbackGauge is thread-safe.
+template <typename MeasureT>
+class CallbackGauge final {
+ public:
+  CallbackGauge(absl::string_view name, Measure<MeasureT> measure,
+                std::function<MeasureT()> callback,
+                opencensus::tags::TagMap tags = {});
+  // Exports 'getter' (e.g. a const member function) called on '*object'.
+  template <typename ObjectT, typename GetterT>
+  CallbackGauge(absl::string_view name, Measure<MeasureT> measure,
+                const ObjectT* object, GetterT getter,
+                opencensus::tags::TagMap tags = {})
+      : CallbackGauge(name, measure, BindObject<ObjectT>(object, getter),
+                      std::move(tags)) {}
+  // Waits for any call of the function in progress to return.
+  ~CallbackGauge();
+
+  CallbackGauge(const CallbackGauge&) = delete;
+  CallbackGauge& operator=(const CallbackGauge&) = delete;
+
+ private:
+  template <typename ObjectT>
+  static std::function<MeasureT()> BindObject(
+      const ObjectT* object, std::function<MeasureT(const ObjectT&)> getter) {
+    return [object, getter]() { return getter(*object); };
+  }
+
+  const uint64_t id_;
+};
+
+extern template class CallbackGauge<double>;
+extern template class CallbackGauge<int64_t>;
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_CALLBACK_GAUGE_H_
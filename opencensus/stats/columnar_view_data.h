@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_COLUMNAR_VIEW_DATA_H_
+#define OPENCENSUS_STATS_COLUMNAR_VIEW_DATA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/view_data.h"
+
+namespace opencensus {
+namespace stats {
+
+// ColumnarViewData is a column-oriented view of the rows of a ViewData, for
+// exporters. The tag values of each column are dictionary-encoded, so that an
+// exporter can encode each distinct value once (e.g. as an escaped label) and
+// reuse the encoding for every row with that value, and the row values are
+// held in a dense array rather than in the nodes of the ViewData's map.
+//
+// Rows are in an unspecified order, which is the same for the codes of every
+// column and for the values. Tag values and non-scalar values point into the
+// ViewData, of which ColumnarViewData keeps a (shallow) copy.
+//
+// ColumnarViewData is immutable, and thus thread-safe.
+class ColumnarViewData final {
+ public:
+  explicit ColumnarViewData(const ViewData& data);
+
+  const ViewData& view_data() const { return data_; }
+  ViewData::Type type() const { return data_.type(); }
+
+  size_t num_rows() const { return num_rows_; }
+  // The number of tag columns, or 0 if there are no rows.
+  size_t num_columns() const { return columns_.size(); }
+
+  // The distinct tag values of 'column', in order of first appearance.
+  const std::vector<absl::string_view>& dictionary(size_t column) const {
+    return columns_[column].dictionary;
+  }
+  // The index in dictionary(column) of each row's tag value in 'column'.
+  const std::vector<uint32_t>& codes(size_t column) const {
+    return columns_[column].codes;
+  }
+  absl::string_view tag_value(size_t row, size_t column) const {
+    return columns_[column].dictionary[columns_[column].codes[row]];
+  }
+
+  // The value of each row. Only the array for type() is populated.
+  const std::vector<double>& double_values() const { return double_values_; }
+  const std::vector<int64_t>& int_values() const { return int_values_; }
+  const std::vector<const Distribution*>& distribution_values() const {
+    return distribution_values_;
+  }
+  const std::vector<const ExponentialHistogram*>&
+  exponential_histogram_values() const {
+    return exponential_histogram_values_;
+  }
+
+ private:
+  struct Column {
+    std::vector<absl::string_view> dictionary;
+    std::vector<uint32_t> codes;
+  };
+
+  // Encodes the rows of 'map', appending their values with 'add_value'.
+  template <typename DataValueT, typename AddValue>
+  void AddRows(const ViewData::DataMap<DataValueT>& map, AddValue add_value);
+
+  const ViewData data_;
+  size_t num_rows_ = 0;
+  std::vector<Column> columns_;
+  std::vector<double> double_values_;
+  std::vector<int64_t> int_values_;
+  std::vector<const Distribution*> distribution_values_;
+  std::vector<const ExponentialHistogram*> exponential_histogram_values_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_COLUMNAR_VIEW_DATA_H_
@@ -20,7 +20,9 @@
 #include <string>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/trace/span_context.h"
 
 namespace opencensus {
 namespace stats {
@@ -30,10 +32,21 @@ namespace testing {
 class TestUtils;
 }
 
+// An Exemplar is a value recorded into a Distribution bucket, together with the
+// sampled Span that was current when it was recorded, linking the bucket to a
+// representative trace.
+struct Exemplar {
+  double value = 0;
+  absl::Time timestamp;
+  opencensus::trace::SpanContext span_context;
+};
+
 // A Distribution object holds a summary of a stream of double values (e.g. all
 // values for one measure and set of tags). It stores both a statistical summary
 // (mean, sum of squared deviation, and range) and a histogram recording the
-// number of values in each bucket (as defined by a BucketBoundaries).
+// number of values in each bucket (as defined by a BucketBoundaries). Values
+// recorded while a sampled Span is current also leave an Exemplar in their
+// bucket.
 // This corresponds to a Stackdriver Distribution metric
 // (https://cloud.google.com/monitoring/api/ref_v3/rest/v3/TypedValue#Distribution).
 // Distribution is thread-compatible.
@@ -49,6 +62,11 @@ class Distribution final {
 
   const BucketBoundaries& bucket_boundaries() const { return *buckets_; }
 
+  // The most recent Exemplar of each bucket, indexed as bucket_counts(), or
+  // empty if no exemplars were recorded. Buckets without an exemplar hold one
+  // with an invalid span_context.
+  const std::vector<Exemplar>& exemplars() const { return exemplars_; }
+
   // A string representation of the Distribution's data suitable for human
   // consumption.
   std::string DebugString() const;
@@ -56,6 +74,8 @@ class Distribution final {
  private:
   friend class ViewDataImpl;  // ViewDataImpl populates data directly.
   friend class MeasureData;
+  friend class ViewDataDecoder;  // ViewDataDecoder rebuilds decoded data.
+  friend class ViewSnapshot;     // ViewSnapshot restores saved data.
   friend class testing::TestUtils;
 
   // buckets must outlive the Distribution.
@@ -76,6 +96,8 @@ class Distribution final {
   // The counts of values in the buckets listed in buckets_. Size is
   // buckets_->num_buckets().
   std::vector<uint64_t> bucket_counts_;
+  // Empty until the first exemplar is added, then buckets_->num_buckets().
+  std::vector<Exemplar> exemplars_;
 };
 
 }  // namespace stats
@@ -0,0 +1,129 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_EXPONENTIAL_HISTOGRAM_H_
+#define OPENCENSUS_STATS_EXPONENTIAL_HISTOGRAM_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace opencensus {
+namespace stats {
+
+// Forward declaration of friend.
+namespace testing {
+class TestUtils;
+}
+
+// An ExponentialHistogram holds a histogram of a stream of double values whose
+// bucket boundaries are powers of base() = 2^(2^-scale()). Positive bucket i
+// holds values in [base^i, base^(i+1)), and negative bucket i holds values in
+// (-base^(i+1), -base^i]; zeros (and NaNs) are counted separately. Every bucket
+// therefore has the same relative width, and values are estimated to within a
+// relative error of (base - 1) / (base + 1).
+//
+// Only the range of buckets between the smallest and largest populated index
+// is stored. When that range would exceed max_buckets(), the scale is reduced
+// (halving resolution by merging adjacent pairs of buckets) until it fits, so
+// the histogram never needs boundaries chosen in advance.
+//
+// ExponentialHistogram is thread-compatible.
+class ExponentialHistogram final {
+ public:
+  // The finest and coarsest scales used. At kMaxScale, base() is about
+  // 1 + 6.6e-7; at kMinScale, all finite doubles fit in 2 buckets.
+  static constexpr int kMaxScale = 20;
+  static constexpr int kMinScale = -11;
+
+  // A contiguous range of buckets: counts[k] is the count of bucket
+  // offset + k.
+  struct Buckets {
+    int offset = 0;
+    std::vector<uint64_t> counts;
+  };
+
+  uint64_t count() const { return count_; }
+  double sum() const { return sum_; }
+  double min() const { return min_; }
+  double max() const { return max_; }
+
+  int scale() const { return scale_; }
+  int max_buckets() const { return max_buckets_; }
+  // The ratio between consecutive bucket boundaries.
+  double base() const;
+  // The lower magnitude boundary of bucket 'index' at the current scale, i.e.
+  // base()^index.
+  double LowerBound(int index) const;
+
+  // Estimates the value at quantile 'q' (clamped to [0, 1]) of the values
+  // added, to within a relative error of (base() - 1) / (base() + 1) of a value
+  // whose rank is q * (count() - 1). Quantiles 0 and 1 return min() and max()
+  // exactly. Returns NaN if the histogram is empty.
+  double Quantile(double q) const;
+
+  uint64_t zero_count() const { return zero_count_; }
+  const Buckets& positive_buckets() const { return positive_; }
+  const Buckets& negative_buckets() const { return negative_; }
+
+  // A string representation of the histogram's data suitable for human
+  // consumption.
+  std::string DebugString() const;
+
+ private:
+  friend class ViewDataImpl;
+  friend class MeasureData;
+  friend class ViewDataDecoder;
+  friend class ViewSnapshot;
+  friend class testing::TestUtils;
+
+  // max_buckets is the limit for each of the positive and negative ranges; it
+  // is clamped to at least 2.
+  explicit ExponentialHistogram(int max_buckets);
+
+  // Adds 'count' copies of 'value'.
+  void Add(double value, uint64_t count = 1);
+  // Adds all values in 'other' to this, reducing the scale to the coarser of
+  // the two scales, or further if required to fit max_buckets().
+  void Merge(const ExponentialHistogram& other);
+  // Clears all data, keeping allocated storage.
+  void Reset();
+  // Multiplies the count of every value by 'factor', as if each had been
+  // added 'factor' times.
+  void Scale(uint64_t factor);
+
+  // Adds 'count' to the bucket 'index' (at the current scale) of 'buckets',
+  // downscaling first if required.
+  void AddToBuckets(int index, uint64_t count, Buckets* buckets);
+  // Reduces scale_ by 'delta', merging buckets in both ranges.
+  void Downscale(int delta);
+
+  int max_buckets_;
+  int scale_ = kMaxScale;
+
+  uint64_t count_ = 0;
+  double sum_ = 0;
+  double min_ = std::numeric_limits<double>::infinity();
+  double max_ = -std::numeric_limits<double>::infinity();
+
+  uint64_t zero_count_ = 0;
+  Buckets positive_;
+  Buckets negative_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_EXPONENTIAL_HISTOGRAM_H_
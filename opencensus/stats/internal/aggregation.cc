@@ -17,6 +17,7 @@
 #include <cassert>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 
 namespace opencensus {
 namespace stats {
@@ -32,6 +33,15 @@ std::string Aggregation::DebugString() const {
                           bucket_boundaries_.DebugString());
     case Type::kLastValue:
       return "Last Value";
+    case Type::kExponentialHistogram:
+      return absl::StrCat("Exponential histogram with at most ", max_buckets_,
+                          " buckets");
+    case Type::kQuantiles:
+      return absl::StrCat("Quantiles ", absl::StrJoin(quantiles_, ", "),
+                          " with at most ", max_buckets_, " buckets");
+    case Type::kDistinctCount:
+      return absl::StrCat("Distinct count of ", distinct_key_->name(),
+                          " with precision ", precision_);
   }
   assert(false && "Invalid Aggregation type.");
   return "BAD TYPE";
@@ -0,0 +1,88 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tracks the steady-state heap allocations of recording, so that changes which
+// add allocations are caught.
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/allocation_counter.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/stats/view.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::opencensus::common::AllocationsPerOperation;
+
+constexpr char kMeasureName[] = "test_measure";
+
+MeasureDouble TestMeasure() {
+  static const auto measure = MeasureDouble::Register(kMeasureName, "", "");
+  return measure;
+}
+
+opencensus::tags::TagKey TestKey() {
+  static const auto key = opencensus::tags::TagKey::Register("key");
+  return key;
+}
+
+class AllocationTest : public ::testing::Test {
+ protected:
+  void SetUp() override { TestMeasure(); }
+
+  View view_{ViewDescriptor()
+                 .set_measure(kMeasureName)
+                 .set_name("distribution")
+                 .set_aggregation(Aggregation::Distribution(
+                     BucketBoundaries::Explicit({0, 10, 100})))
+                 .add_column(TestKey())};
+};
+
+TEST_F(AllocationTest, Record) {
+  const opencensus::tags::TagMap tags({{TestKey(), "value"}});
+  EXPECT_EQ(0, AllocationsPerOperation([&tags]() {
+              Record({{TestMeasure(), 1.0}}, tags);
+            }));
+  // Recording a tag set again after a harvest reuses its row.
+  testing::TestUtils::Flush();
+  int64_t count;
+  {
+    common::AllocationCounter counter;
+    Record({{TestMeasure(), 1.0}}, tags);
+    count = counter.count();
+  }
+  EXPECT_EQ(0, count);
+}
+
+TEST_F(AllocationTest, RecordWithoutTags) {
+  EXPECT_EQ(0, AllocationsPerOperation(
+                   []() { Record({{TestMeasure(), 1.0}}); }));
+}
+
+TEST_F(AllocationTest, BoundMeasure) {
+  const BoundMeasure<double> bound(TestMeasure(), {{TestKey(), "value"}});
+  EXPECT_EQ(0, AllocationsPerOperation([&bound]() { bound.Record(1.0); }));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
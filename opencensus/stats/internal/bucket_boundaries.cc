@@ -15,6 +15,7 @@
 #include "opencensus/stats/bucket_boundaries.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 
@@ -25,11 +26,10 @@
 namespace opencensus {
 namespace stats {
 
+
 // Class-level todos:
 // TODO: Consider lazy generation of storage buckets, to save memory
 // when few buckets are populated.
-// TODO: Share bucketers, or at least the lower_boundaries_ vector, to
-// reduce allocation/copying for copies of Aggregation objects.
 
 // static
 BucketBoundaries BucketBoundaries::Linear(int num_finite_buckets, double offset,
@@ -40,7 +40,11 @@ BucketBoundaries BucketBoundaries::Linear(int num_finite_buckets, double offset,
     boundaries[i] = boundary;
     boundary += width;
   }
-  return BucketBoundaries(std::move(boundaries));
+  if (!(width > 0) || !std::isfinite(offset) || !std::isfinite(boundary)) {
+    return BucketBoundaries(std::move(boundaries));
+  }
+  return BucketBoundaries(std::move(boundaries), Layout::kLinear, offset,
+                          1 / width);
 }
 
 // static
@@ -53,7 +57,11 @@ BucketBoundaries BucketBoundaries::Exponential(int num_finite_buckets,
     boundaries[i] = upper_bound;
     upper_bound *= growth_factor;
   }
-  return BucketBoundaries(std::move(boundaries));
+  if (!(scale > 0) || !(growth_factor > 1) || !std::isfinite(upper_bound)) {
+    return BucketBoundaries(std::move(boundaries));
+  }
+  return BucketBoundaries(std::move(boundaries), Layout::kExponential, scale,
+                          1 / std::log(growth_factor));
 }
 
 // static
@@ -68,13 +76,57 @@ BucketBoundaries BucketBoundaries::Explicit(std::vector<double> boundaries) {
 }
 
 int BucketBoundaries::BucketForValue(double value) const {
-  return std::upper_bound(lower_boundaries_.begin(), lower_boundaries_.end(),
-                          value) -
-         lower_boundaries_.begin();
+  // All paths return the number of boundaries not greater than value (i.e. the
+  // index std::upper_bound would return), including for NaN.
+  switch (layout_) {
+    case Layout::kLinear:
+      return AdjustBucket(value, std::floor((value - origin_) * inverse_step_) +
+                                     1);
+    case Layout::kExponential:
+      // lower_boundaries_[0] is 0, and lower_boundaries_[i] for i >= 1 is
+      // approximately scale * growth_factor ^ (i - 1).
+      if (value < origin_) {
+        return value < 0 ? 0 : 1;
+      }
+      return AdjustBucket(
+          value, std::floor(std::log(value / origin_) * inverse_step_) + 2);
+    case Layout::kExplicit:
+      break;
+  }
+  const std::vector<double>& lower_boundaries = *lower_boundaries_;
+  if (lower_boundaries.empty()) {
+    return 0;
+  }
+  // A binary search whose steps compile to conditional moves rather than
+  // branches, which mispredict when values are spread across buckets.
+  const double* first = lower_boundaries.data();
+  size_t length = lower_boundaries.size();
+  while (length > 1) {
+    const size_t half = length / 2;
+    first += value < first[half] ? 0 : half;
+    length -= half;
+  }
+  return first - lower_boundaries.data() + !(value < *first);
+}
+
+int BucketBoundaries::AdjustBucket(double value, double estimate) const {
+  const std::vector<double>& lower_boundaries = *lower_boundaries_;
+  const int size = lower_boundaries.size();
+  // Written so that NaN estimates (from NaN values) go to the overflow bucket.
+  int bucket = estimate > 0 ? (estimate < size ? static_cast<int>(estimate)
+                                               : size)
+                            : (estimate <= 0 ? 0 : size);
+  while (bucket > 0 && value < lower_boundaries[bucket - 1]) {
+    --bucket;
+  }
+  while (bucket < size && !(value < lower_boundaries[bucket])) {
+    ++bucket;
+  }
+  return bucket;
 }
 
 std::string BucketBoundaries::DebugString() const {
-  return absl::StrCat("Buckets: ", absl::StrJoin(lower_boundaries_, ","));
+  return absl::StrCat("Buckets: ", absl::StrJoin(*lower_boundaries_, ","));
 }
 
 }  // namespace stats
@@ -0,0 +1,76 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "opencensus/stats/bucket_boundaries.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// Values in uniformly random buckets, so that lookups are not predictable.
+std::vector<double> MakeValues(const BucketBoundaries& boundaries) {
+  const std::vector<double>& lower = boundaries.lower_boundaries();
+  std::mt19937 gen;
+  std::uniform_int_distribution<int> bucket(0, lower.size());
+  std::uniform_real_distribution<double> fraction(0, 1);
+  std::vector<double> values(4096);
+  for (double& value : values) {
+    const int i = bucket(gen);
+    const double low = i == 0 ? lower.front() - 1 : lower[i - 1];
+    const double high = i == static_cast<int>(lower.size()) ? lower.back() + 1 : lower[i];
+    value = low + (high - low) * fraction(gen);
+  }
+  return values;
+}
+
+void RunBucketForValue(benchmark::State& state,
+                       const BucketBoundaries& boundaries) {
+  const std::vector<double> values = MakeValues(boundaries);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(boundaries.BucketForValue(values[i]));
+    i = (i + 1) % values.size();
+  }
+}
+
+void BM_BucketForValueLinear(benchmark::State& state) {
+  RunBucketForValue(state, BucketBoundaries::Linear(state.range(0), 0, 1));
+}
+BENCHMARK(BM_BucketForValueLinear)->Arg(8)->Arg(64)->Arg(1024);
+
+void BM_BucketForValueExponential(benchmark::State& state) {
+  RunBucketForValue(state,
+                    BucketBoundaries::Exponential(state.range(0), 1, 1.5));
+}
+BENCHMARK(BM_BucketForValueExponential)->Arg(8)->Arg(64)->Arg(1024);
+
+void BM_BucketForValueExplicit(benchmark::State& state) {
+  std::vector<double> lower_boundaries;
+  for (int i = 0; i < state.range(0); ++i) {
+    lower_boundaries.push_back(i * i);
+  }
+  RunBucketForValue(state,
+                    BucketBoundaries::Explicit(std::move(lower_boundaries)));
+}
+BENCHMARK(BM_BucketForValueExplicit)->Arg(8)->Arg(32)->Arg(64)->Arg(1024);
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
+BENCHMARK_MAIN();
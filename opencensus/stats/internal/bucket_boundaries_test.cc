@@ -14,6 +14,12 @@
 
 #include "opencensus/stats/bucket_boundaries.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -68,6 +74,74 @@ TEST(BucketBoundariesTest, BucketForValueEmptyBuckets) {
   EXPECT_EQ(0, bucket_boundaries.BucketForValue(1000));
 }
 
+// Checks that BucketForValue agrees with a binary search over
+// lower_boundaries() for values on, between, and around every boundary.
+void ExpectMatchesBinarySearch(const BucketBoundaries& bucket_boundaries) {
+  const std::vector<double>& lower = bucket_boundaries.lower_boundaries();
+  std::vector<double> values = {-std::numeric_limits<double>::infinity(),
+                                std::numeric_limits<double>::infinity(),
+                                std::numeric_limits<double>::lowest(),
+                                std::numeric_limits<double>::max(), -1, 0, 1};
+  for (const double boundary : lower) {
+    values.push_back(boundary);
+    values.push_back(std::nextafter(boundary, -HUGE_VAL));
+    values.push_back(std::nextafter(boundary, HUGE_VAL));
+    values.push_back(boundary * 1.5);
+    values.push_back(boundary - 0.5);
+  }
+  for (const double value : values) {
+    EXPECT_EQ(std::upper_bound(lower.begin(), lower.end(), value) -
+                  lower.begin(),
+              bucket_boundaries.BucketForValue(value))
+        << "value " << value;
+  }
+  EXPECT_EQ(bucket_boundaries.num_buckets() - 1,
+            bucket_boundaries.BucketForValue(
+                std::numeric_limits<double>::quiet_NaN()));
+}
+
+TEST(BucketBoundariesTest, BucketForValueLinear) {
+  ExpectMatchesBinarySearch(BucketBoundaries::Linear(0, 1, 1));
+  ExpectMatchesBinarySearch(BucketBoundaries::Linear(10, -5, 1));
+  ExpectMatchesBinarySearch(BucketBoundaries::Linear(1000, 0.1, 0.1));
+  ExpectMatchesBinarySearch(BucketBoundaries::Linear(100, 1e10, 1e-3));
+  ExpectMatchesBinarySearch(BucketBoundaries::Linear(5, 3, 0));
+}
+
+TEST(BucketBoundariesTest, BucketForValueExponential) {
+  ExpectMatchesBinarySearch(BucketBoundaries::Exponential(0, 1, 2));
+  ExpectMatchesBinarySearch(BucketBoundaries::Exponential(20, 1, 2));
+  ExpectMatchesBinarySearch(BucketBoundaries::Exponential(50, 0.001, 1.1));
+  ExpectMatchesBinarySearch(BucketBoundaries::Exponential(300, 1e-100, 3));
+  ExpectMatchesBinarySearch(BucketBoundaries::Exponential(5, 1, 1));
+}
+
+TEST(BucketBoundariesTest, BucketForValueExplicit) {
+  ExpectMatchesBinarySearch(BucketBoundaries::Explicit({-3, 0, 0, 2.5, 100}));
+  std::vector<double> boundaries;
+  for (int i = 0; i < 100; ++i) {
+    boundaries.push_back(i * i);
+  }
+  ExpectMatchesBinarySearch(BucketBoundaries::Explicit(boundaries));
+}
+
+TEST(BucketBoundariesTest, LayoutDoesNotAffectEquality) {
+  EXPECT_EQ(BucketBoundaries::Linear(2, 0, 1),
+            BucketBoundaries::Explicit({0, 1, 2}));
+  EXPECT_EQ(BucketBoundaries::Exponential(2, 1, 2),
+            BucketBoundaries::Explicit({0, 1, 2}));
+}
+
+TEST(BucketBoundariesTest, CopiesShareBoundaries) {
+  const BucketBoundaries boundaries = BucketBoundaries::Explicit({0, 1, 2});
+  BucketBoundaries copy = boundaries;
+  EXPECT_EQ(&boundaries.lower_boundaries(), &copy.lower_boundaries());
+  // Moves are copies.
+  const BucketBoundaries moved = std::move(copy);
+  EXPECT_EQ(&boundaries.lower_boundaries(), &moved.lower_boundaries());
+  EXPECT_EQ(boundaries, copy);
+}
+
 TEST(BucketBoundariesDeathTest, NonMonotonicExplicit) {
   const std::initializer_list<double> boundaries = {0, -1, 1};
   EXPECT_DEBUG_DEATH(
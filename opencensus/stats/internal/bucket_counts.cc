@@ -0,0 +1,140 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/bucket_counts.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/macros.h"
+#include "absl/types/span.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace opencensus {
+namespace stats {
+
+void AddBucketCounts(absl::Span<const int64_t> src, absl::Span<uint64_t> dst) {
+  ABSL_ASSERT(dst.size() >= src.size());
+  const int64_t* in = src.data();
+  uint64_t* out = dst.data();
+  const size_t size = src.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  // Two independent adds of two counts each per iteration.
+  for (; i + 4 <= size; i += 4) {
+    const __m128i in0 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i in1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 2));
+    __m128i* out0 = reinterpret_cast<__m128i*>(out + i);
+    __m128i* out1 = reinterpret_cast<__m128i*>(out + i + 2);
+    _mm_storeu_si128(out0, _mm_add_epi64(_mm_loadu_si128(out0), in0));
+    _mm_storeu_si128(out1, _mm_add_epi64(_mm_loadu_si128(out1), in1));
+  }
+#endif
+  for (; i < size; ++i) {
+    out[i] += in[i];
+  }
+}
+
+void AddBucketCounts(absl::Span<const int64_t> src, absl::Span<double> dst) {
+  ABSL_ASSERT(dst.size() >= src.size());
+  const int64_t* in = src.data();
+  double* out = dst.data();
+  const size_t size = src.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  // SSE2 has no 64-bit integer to double conversion, so each count's 32-bit
+  // halves are placed in the mantissas of 2^84 and 2^52, and the exponents
+  // subtracted out: (2^84 + high * 2^32 - 2^84 - 2^52) + (2^52 + low). Only
+  // the final add rounds.
+  const __m128i low_mask = _mm_set1_epi64x(0xffffffff);
+  const __m128i low_exponent = _mm_set1_epi64x(0x4330000000000000);  // 2^52
+  const __m128i high_exponent = _mm_set1_epi64x(0x4530000000000000);  // 2^84
+  const __m128d bias =
+      _mm_castsi128_pd(_mm_set1_epi64x(0x4530000000100000));  // 2^84 + 2^52
+  for (; i + 2 <= size; i += 2) {
+    const __m128i counts =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128d low = _mm_castsi128_pd(
+        _mm_or_si128(_mm_and_si128(counts, low_mask), low_exponent));
+    const __m128d high = _mm_castsi128_pd(
+        _mm_or_si128(_mm_srli_epi64(counts, 32), high_exponent));
+    const __m128d values = _mm_add_pd(_mm_sub_pd(high, bias), low);
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), values));
+  }
+#endif
+  for (; i < size; ++i) {
+    out[i] += in[i];
+  }
+}
+
+void AddBucketCounts(absl::Span<const uint32_t> src,
+                     absl::Span<uint64_t> dst) {
+  ABSL_ASSERT(dst.size() >= src.size());
+  const uint32_t* in = src.data();
+  uint64_t* out = dst.data();
+  const size_t size = src.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  // Zero-extends four counts to 64 bits by interleaving them with zeros.
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= size; i += 4) {
+    const __m128i counts =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i* out0 = reinterpret_cast<__m128i*>(out + i);
+    __m128i* out1 = reinterpret_cast<__m128i*>(out + i + 2);
+    _mm_storeu_si128(out0, _mm_add_epi64(_mm_loadu_si128(out0),
+                                         _mm_unpacklo_epi32(counts, zero)));
+    _mm_storeu_si128(out1, _mm_add_epi64(_mm_loadu_si128(out1),
+                                         _mm_unpackhi_epi32(counts, zero)));
+  }
+#endif
+  for (; i < size; ++i) {
+    out[i] += in[i];
+  }
+}
+
+void AddBucketCounts(absl::Span<const uint32_t> src, absl::Span<double> dst) {
+  ABSL_ASSERT(dst.size() >= src.size());
+  const uint32_t* in = src.data();
+  double* out = dst.data();
+  const size_t size = src.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  // A 32-bit count placed in the mantissa of 2^52 converts exactly, as in the
+  // low half above.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i exponent = _mm_set1_epi64x(0x4330000000000000);  // 2^52
+  const __m128d bias = _mm_castsi128_pd(exponent);
+  for (; i + 2 <= size; i += 2) {
+    const __m128i counts =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+    const __m128d values = _mm_sub_pd(
+        _mm_castsi128_pd(
+            _mm_or_si128(_mm_unpacklo_epi32(counts, zero), exponent)),
+        bias);
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), values));
+  }
+#endif
+  for (; i < size; ++i) {
+    out[i] += in[i];
+  }
+}
+
+}  // namespace stats
+}  // namespace opencensus
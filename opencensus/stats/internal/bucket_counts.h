@@ -0,0 +1,47 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_BUCKET_COUNTS_H_
+#define OPENCENSUS_STATS_INTERNAL_BUCKET_COUNTS_H_
+
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace stats {
+
+// Merging histograms adds bucket counts element by element for every row of
+// every Distribution view at each harvest, so these kernels add several counts
+// per instruction where the target supports it (SSE2 on x86-64), falling back
+// to scalar loops elsewhere.
+
+// Adds src[i] to dst[i] for each i < src.size(). Requires
+// dst.size() >= src.size().
+void AddBucketCounts(absl::Span<const int64_t> src, absl::Span<uint64_t> dst);
+
+// As above, converting the counts to double, which requires them to be
+// non-negative. Each conversion rounds to the nearest double, as
+// static_cast<double> does.
+void AddBucketCounts(absl::Span<const int64_t> src, absl::Span<double> dst);
+
+// As above, for the 32-bit counts of a MeasureData whose counts have not
+// outgrown them.
+void AddBucketCounts(absl::Span<const uint32_t> src, absl::Span<uint64_t> dst);
+void AddBucketCounts(absl::Span<const uint32_t> src, absl::Span<double> dst);
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_BUCKET_COUNTS_H_
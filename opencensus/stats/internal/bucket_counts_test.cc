@@ -0,0 +1,100 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/bucket_counts.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+TEST(BucketCountsTest, AddToUint64) {
+  // Sizes on either side of the vector width exercise the scalar tail.
+  for (int size = 0; size < 10; ++size) {
+    std::vector<int64_t> src(size);
+    std::vector<uint64_t> dst(size + 1, 5);
+    for (int i = 0; i < size; ++i) {
+      src[i] = i * 3;
+    }
+    AddBucketCounts(src, absl::MakeSpan(dst));
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(5 + i * 3, dst[i]);
+    }
+    // Elements past src.size() are untouched.
+    EXPECT_EQ(5, dst[size]);
+  }
+}
+
+TEST(BucketCountsTest, AddToDouble) {
+  for (int size = 0; size < 10; ++size) {
+    std::vector<int64_t> src(size);
+    std::vector<double> dst(size + 1, 0.5);
+    for (int i = 0; i < size; ++i) {
+      src[i] = i * 3;
+    }
+    AddBucketCounts(src, absl::MakeSpan(dst));
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(0.5 + i * 3, dst[i]);
+    }
+    EXPECT_EQ(0.5, dst[size]);
+  }
+}
+
+TEST(BucketCountsTest, DoubleConversionRounds) {
+  // Counts needing more than 32 bits, or more than a double's 53, convert as
+  // static_cast<double> does.
+  const std::vector<int64_t> src = {
+      int64_t{1} << 32,
+      (int64_t{1} << 32) + 1,
+      (int64_t{1} << 53) + 1,
+      (int64_t{1} << 62) + 12345,
+      std::numeric_limits<int64_t>::max(),
+      0,
+  };
+  std::vector<double> dst(src.size());
+  AddBucketCounts(src, absl::MakeSpan(dst));
+  for (size_t i = 0; i < src.size(); ++i) {
+    EXPECT_EQ(static_cast<double>(src[i]), dst[i]) << i;
+  }
+}
+
+TEST(BucketCountsTest, AddUint32) {
+  for (int size = 0; size < 10; ++size) {
+    std::vector<uint32_t> src(size);
+    std::vector<uint64_t> dst(size + 1, 5);
+    std::vector<double> dst_double(size + 1, 0.5);
+    for (int i = 0; i < size; ++i) {
+      src[i] = std::numeric_limits<uint32_t>::max() - i;
+    }
+    AddBucketCounts(src, absl::MakeSpan(dst));
+    AddBucketCounts(src, absl::MakeSpan(dst_double));
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(uint64_t{5} + src[i], dst[i]);
+      EXPECT_EQ(0.5 + src[i], dst_double[i]);
+    }
+    EXPECT_EQ(5, dst[size]);
+    EXPECT_EQ(0.5, dst_double[size]);
+  }
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
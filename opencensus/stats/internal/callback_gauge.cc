@@ -0,0 +1,84 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/callback_gauge.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/stats_exporter_impl.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+template <typename MeasureT>
+ViewDescriptor GaugeDescriptor(absl::string_view name,
+                               Measure<MeasureT> measure,
+                               const opencensus::tags::TagMap& tags) {
+  ViewDescriptor descriptor = ViewDescriptor()
+                                  .set_name(name)
+                                  .set_measure(measure.GetDescriptor().name())
+                                  .set_aggregation(Aggregation::LastValue())
+                                  .set_description(
+                                      measure.GetDescriptor().description());
+  for (const auto& tag : tags.tag_views()) {
+    descriptor.add_column(tag.first);
+  }
+  return descriptor;
+}
+
+std::vector<std::string> TagValues(const opencensus::tags::TagMap& tags) {
+  std::vector<std::string> values;
+  values.reserve(tags.tag_views().size());
+  for (const auto& tag : tags.tag_views()) {
+    values.emplace_back(tag.second);
+  }
+  return values;
+}
+
+void AddValue(double value, MeasureData* data) { data->Add(value); }
+void AddValue(int64_t value, MeasureData* data) { data->AddInt64(value); }
+
+}  // namespace
+
+template <typename MeasureT>
+CallbackGauge<MeasureT>::CallbackGauge(absl::string_view name,
+                                       Measure<MeasureT> measure,
+                                       std::function<MeasureT()> callback,
+                                       opencensus::tags::TagMap tags)
+    : id_(StatsExporterImpl::Get()->AddGauge(
+          GaugeDescriptor(name, measure, tags), TagValues(tags),
+          [callback](MeasureData* data) { AddValue(callback(), data); })) {}
+
+template <typename MeasureT>
+CallbackGauge<MeasureT>::~CallbackGauge() {
+  StatsExporterImpl::Get()->RemoveGauge(id_);
+}
+
+template class CallbackGauge<double>;
+template class CallbackGauge<int64_t>;
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,80 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/columnar_view_data.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/view_data.h"
+
+namespace opencensus {
+namespace stats {
+
+template <typename DataValueT, typename AddValue>
+void ColumnarViewData::AddRows(const ViewData::DataMap<DataValueT>& map,
+                               AddValue add_value) {
+  num_rows_ = map.size();
+  if (map.empty()) return;
+  columns_.resize(map.begin()->first.size());
+  // Maps each column's values to their codes.
+  std::vector<absl::flat_hash_map<absl::string_view, uint32_t>> codes(
+      columns_.size());
+  for (Column& column : columns_) {
+    column.codes.reserve(num_rows_);
+  }
+  for (const auto& row : map) {
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      Column& column = columns_[i];
+      const auto inserted =
+          codes[i].emplace(row.first[i], column.dictionary.size());
+      if (inserted.second) {
+        column.dictionary.push_back(row.first[i]);
+      }
+      column.codes.push_back(inserted.first->second);
+    }
+    add_value(row.second);
+  }
+}
+
+ColumnarViewData::ColumnarViewData(const ViewData& data) : data_(data) {
+  switch (data_.type()) {
+    case ViewData::Type::kDouble:
+      AddRows(data_.double_data(),
+              [this](double value) { double_values_.push_back(value); });
+      break;
+    case ViewData::Type::kInt64:
+      AddRows(data_.int_data(),
+              [this](int64_t value) { int_values_.push_back(value); });
+      break;
+    case ViewData::Type::kDistribution:
+      AddRows(data_.distribution_data(), [this](const Distribution& value) {
+        distribution_values_.push_back(&value);
+      });
+      break;
+    case ViewData::Type::kExponentialHistogram:
+      AddRows(data_.exponential_histogram_data(),
+              [this](const ExponentialHistogram& value) {
+                exponential_histogram_values_.push_back(&value);
+              });
+      break;
+  }
+}
+
+}  // namespace stats
+}  // namespace opencensus
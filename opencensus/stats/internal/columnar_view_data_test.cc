@@ -0,0 +1,107 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/columnar_view_data.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::testing::UnorderedElementsAre;
+
+ViewDescriptor TwoColumnDescriptor(const Aggregation& aggregation) {
+  static const MeasureDouble measure =
+      MeasureDouble::Register("columnar_measure", "", "");
+  return ViewDescriptor()
+      .set_name("view")
+      .set_measure(measure.GetDescriptor().name())
+      .set_aggregation(aggregation)
+      .add_column(opencensus::tags::TagKey::Register("method"))
+      .add_column(opencensus::tags::TagKey::Register("status"));
+}
+
+TEST(ColumnarViewDataTest, DictionaryEncodesColumns) {
+  const ViewData data = testing::TestUtils::MakeViewData(
+      TwoColumnDescriptor(Aggregation::Sum()),
+      {{{"get", "ok"}, 1}, {{"put", "ok"}, 2}, {{"get", "error"}, 4}});
+  const ColumnarViewData columnar(data);
+  ASSERT_EQ(ViewData::Type::kDouble, columnar.type());
+  ASSERT_EQ(3, columnar.num_rows());
+  ASSERT_EQ(2, columnar.num_columns());
+  EXPECT_THAT(columnar.dictionary(0), UnorderedElementsAre("get", "put"));
+  EXPECT_THAT(columnar.dictionary(1), UnorderedElementsAre("ok", "error"));
+  ASSERT_EQ(3, columnar.codes(0).size());
+  ASSERT_EQ(3, columnar.double_values().size());
+  EXPECT_TRUE(columnar.int_values().empty());
+
+  // Decoding the columns gives back the rows.
+  std::map<std::vector<std::string>, double> rows;
+  for (size_t row = 0; row < columnar.num_rows(); ++row) {
+    rows[{std::string(columnar.tag_value(row, 0)),
+          std::string(columnar.tag_value(row, 1))}] =
+        columnar.double_values()[row];
+  }
+  EXPECT_THAT(rows,
+              UnorderedElementsAre(
+                  std::make_pair(std::vector<std::string>{"get", "ok"}, 1),
+                  std::make_pair(std::vector<std::string>{"put", "ok"}, 2),
+                  std::make_pair(std::vector<std::string>{"get", "error"}, 4)));
+}
+
+TEST(ColumnarViewDataTest, Distribution) {
+  const BucketBoundaries buckets = BucketBoundaries::Explicit({10});
+  const ViewData data = testing::TestUtils::MakeViewData(
+      TwoColumnDescriptor(Aggregation::Distribution(buckets)),
+      {{{"get", "ok"}, 1}, {{"get", "ok"}, 20}, {{"put", "ok"}, 5}});
+  const ColumnarViewData columnar(data);
+  ASSERT_EQ(2, columnar.num_rows());
+  EXPECT_EQ(1, columnar.dictionary(1).size());
+  ASSERT_EQ(2, columnar.distribution_values().size());
+  for (size_t row = 0; row < columnar.num_rows(); ++row) {
+    const std::vector<std::string> key = {
+        std::string(columnar.tag_value(row, 0)),
+        std::string(columnar.tag_value(row, 1))};
+    // The values point into the ViewData.
+    EXPECT_EQ(&data.distribution_data().at(key),
+              columnar.distribution_values()[row]);
+  }
+}
+
+TEST(ColumnarViewDataTest, Empty) {
+  const ViewData data = testing::TestUtils::MakeViewData(
+      TwoColumnDescriptor(Aggregation::Count()), {});
+  const ColumnarViewData columnar(data);
+  EXPECT_EQ(0, columnar.num_rows());
+  EXPECT_EQ(0, columnar.num_columns());
+  EXPECT_TRUE(columnar.int_values().empty());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
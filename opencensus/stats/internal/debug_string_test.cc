@@ -32,6 +32,10 @@ TEST(DebugStringTest, Aggregation) {
   EXPECT_NE("", Aggregation::Count().DebugString());
   EXPECT_NE("", Aggregation::Sum().DebugString());
   EXPECT_NE("", Aggregation::LastValue().DebugString());
+  EXPECT_PRED_FORMAT2(::testing::IsSubstring, "17",
+                      Aggregation::ExponentialHistogram(17).DebugString());
+  EXPECT_PRED_FORMAT2(::testing::IsSubstring, "0.99",
+                      Aggregation::Quantiles({0.5, 0.99}).DebugString());
 
   const BucketBoundaries buckets = BucketBoundaries::Explicit({0, 1});
   EXPECT_PRED_FORMAT2(::testing::IsSubstring, buckets.DebugString(),
@@ -14,129 +14,1116 @@
 
 #include "opencensus/stats/internal/delta_producer.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/random.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/common/internal/self_metrics.h"
 #include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/internal/interval_buckets.h"
 #include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/stats/internal/stats_fork_handler.h"
 #include "opencensus/stats/internal/stats_manager.h"
+#include "opencensus/tags/tag_key.h"
 
 namespace opencensus {
 namespace stats {
 
-void Delta::Record(std::initializer_list<Measurement> measurements,
-                   opencensus::tags::TagMap tags) {
+namespace {
+
+// The maximum number of shards of the active delta. Each shard duplicates the
+// rows recorded into it until the next harvest, so this bounds the memory
+// overhead of sharding on machines with many cores.
+constexpr size_t kMaxShards = 32;
+
+// The number of cleared delta buffers kept for reuse. More are allocated if
+// swaps outpace merging.
+constexpr size_t kNumDeltaBuffers = 2;
+
+// How many ShardIndex() calls a thread makes between reading its CPU, so that
+// a thread that migrates moves to a shard of its new CPU.
+constexpr uint32_t kShardRefreshCalls = 256;
+
+// Returns the CPU the calling thread is running on, or -1 if unknown.
+int CurrentCpu() {
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+// The configuration of deltas before any measures are registered.
+const std::shared_ptr<const DeltaConfig>& EmptyDeltaConfig() {
+  static const auto* config =
+      new std::shared_ptr<const DeltaConfig>(std::make_shared<DeltaConfig>());
+  return *config;
+}
+
+// Records the memory held by views and recording buffers as self-metrics.
+void RecordMemoryUsage() {
+  const StatsMemoryUsage usage = StatsConfig::GetMemoryUsage();
+  for (const StatsMemoryUsage::View& view : usage.views) {
+    common::RecordSelfMetric(common::SelfMetric::kViewRows, view.rows,
+                             view.name);
+    common::RecordSelfMetric(common::SelfMetric::kViewBytes, view.bytes,
+                             view.name);
+  }
+  common::RecordSelfMetric(common::SelfMetric::kDeltaBytes,
+                           usage.active_delta.bytes, "active");
+  common::RecordSelfMetric(common::SelfMetric::kDeltaBytes,
+                           usage.last_delta.bytes, "last");
+}
+
+}  // namespace
+
+Delta::Delta() : config_(EmptyDeltaConfig()) {}
+
+void Delta::Record(absl::Span<const Measurement> measurements,
+                   const opencensus::tags::TagMap& tags,
+                   const ExemplarAttachment* attachment) {
+  if (AnyHasViews(measurements)) {
+    RecordToRow(measurements, FindOrAddRow(tags), attachment);
+  }
+}
+
+bool Delta::AnyHasViews(absl::Span<const Measurement> measurements) const {
+  for (const auto& measurement : measurements) {
+    const uint64_t index = MeasureRegistryImpl::IdToIndex(measurement.id_);
+    ABSL_ASSERT(index < config_->measures.size());
+    if (config_->measures[index].has_views) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<MeasureData>* Delta::FindOrAddRow(
+    const opencensus::tags::TagMap& tags) {
+  if (!tags.HasOnlyKeys(config_->columns)) {
+    return FindOrAddProjectedRow(tags.WithOnlyKeys(config_->columns));
+  }
+  return FindOrAddProjectedRow(tags);
+}
+
+std::vector<MeasureData>* Delta::FindOrAddProjectedRow(
+    const opencensus::tags::TagMap& tags) {
   auto it = delta_.find(tags);
   if (it == delta_.end()) {
     it = delta_.emplace_hint(it, std::piecewise_construct,
-                             std::make_tuple(std::move(tags)),
+                             std::forward_as_tuple(tags),
                              std::make_tuple(std::vector<MeasureData>()));
-    it->second.reserve(registered_boundaries_.size());
-    for (const auto& boundaries_for_measure : registered_boundaries_) {
-      it->second.emplace_back(boundaries_for_measure);
+    it->second.reserve(config_->measures.size());
+    for (const auto& config_for_measure : config_->measures) {
+      it->second.emplace_back(config_for_measure.boundaries,
+                              config_for_measure.exponential_max_buckets);
     }
   }
+  return &it->second;
+}
+
+void Delta::RecordToRow(absl::Span<const Measurement> measurements,
+                        std::vector<MeasureData>* row,
+                        const ExemplarAttachment* attachment) {
   for (const auto& measurement : measurements) {
     const uint64_t index = MeasureRegistryImpl::IdToIndex(measurement.id_);
-    ABSL_ASSERT(index < registered_boundaries_.size());
+    ABSL_ASSERT(index < config_->measures.size());
+    if (!config_->measures[index].has_views) {
+      continue;
+    }
     switch (MeasureRegistryImpl::IdToType(measurement.id_)) {
       case MeasureDescriptor::Type::kDouble:
-        it->second[index].Add(measurement.value_double_);
+        (*row)[index].Add(measurement.value_double_, attachment);
         break;
       case MeasureDescriptor::Type::kInt64:
-        it->second[index].Add(measurement.value_int_);
+        (*row)[index].AddInt64(measurement.value_int_, attachment);
+        break;
+    }
+  }
+}
+
+void Delta::RecordInt64Values(uint64_t index,
+                              const opencensus::tags::TagMap& tags,
+                              uint64_t count, int64_t sum) {
+  // Deltas that have not yet been configured have no measures.
+  if (count == 0 || index >= config_->measures.size() ||
+      !config_->measures[index].has_views) {
+    return;
+  }
+  (*FindOrAddRow(tags))[index].AddInt64Values(count, sum);
+}
+
+bool Delta::ResetForReuse() {
+  bool found_data = false;
+  for (auto it = delta_.begin(); it != delta_.end();) {
+    bool has_data = false;
+    for (const auto& data : it->second) {
+      if (data.count() != 0) {
+        has_data = true;
         break;
+      }
+    }
+    if (has_data) {
+      found_data = true;
+      for (auto& data : it->second) {
+        data.Reset();
+      }
+      ++it;
+    } else {
+      it = delta_.erase(it);
     }
   }
+  return found_data;
 }
 
-void Delta::clear() {
-  registered_boundaries_.clear();
-  delta_.clear();
+size_t Delta::ApproximateBytes() const {
+  // Each node of delta_ holds the entry and a next pointer. TagMaps only
+  // allocate beyond kInlineTags tags.
+  size_t bytes = sizeof(*this) + delta_.bucket_count() * sizeof(void*);
+  for (const auto& row : delta_) {
+    bytes += sizeof(row) + sizeof(void*) +
+             row.second.capacity() * sizeof(MeasureData);
+    const size_t num_tags = row.first.tag_views().size();
+    if (num_tags > opencensus::tags::TagMap::kInlineTags) {
+      bytes += num_tags * sizeof(row.first.tag_views()[0]);
+    }
+    for (const auto& data : row.second) {
+      bytes += data.HeapBytes();
+    }
+  }
+  return bytes;
 }
 
-void Delta::SwapAndReset(
-    std::vector<std::vector<BucketBoundaries>>& registered_boundaries,
-    Delta* other) {
-  registered_boundaries_.swap(other->registered_boundaries_);
+void Delta::Reserve(size_t num_tag_sets) {
+  // reserve() may shrink the table.
+  if (num_tag_sets > delta_.bucket_count() * delta_.max_load_factor()) {
+    delta_.reserve(num_tag_sets);
+  }
+}
+
+void Delta::SwapAndReset(const std::shared_ptr<const DeltaConfig>& config,
+                         Delta* other) {
+  config_.swap(other->config_);
   delta_.swap(other->delta_);
-  delta_.clear();
-  registered_boundaries_ = registered_boundaries;
+  if (config_ != config) {
+    delta_.clear();
+    config_ = config;
+  }
+}
+
+constexpr size_t ActiveMeasures::kWordsPerChunk;
+constexpr uint64_t ActiveMeasures::kMeasuresPerChunk;
+constexpr size_t ActiveMeasures::kMaxChunks;
+
+ActiveMeasures::~ActiveMeasures() {
+  for (auto& chunk : chunks_) {
+    delete chunk.load(std::memory_order_relaxed);
+  }
 }
 
+bool ActiveMeasures::ContainsAny(
+    absl::Span<const Measurement> measurements) const {
+  for (const auto& measurement : measurements) {
+    if (Contains(MeasureRegistryImpl::IdToIndex(measurement.id_))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ActiveMeasures::Set(uint64_t index, bool active) {
+  const uint64_t chunk_index = index / kMeasuresPerChunk;
+  if (chunk_index >= kMaxChunks) {
+    return;
+  }
+  Chunk* chunk = chunks_[chunk_index].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    if (!active) {
+      return;
+    }
+    // Value-initialized, so all bits start clear.
+    chunk = new Chunk();
+    chunks_[chunk_index].store(chunk, std::memory_order_release);
+  }
+  const uint64_t bit = index % kMeasuresPerChunk;
+  std::atomic<uint64_t>& word = chunk->words[bit / 64];
+  const uint64_t mask = uint64_t{1} << (bit % 64);
+  if (active) {
+    word.fetch_or(mask, std::memory_order_relaxed);
+  } else {
+    word.fetch_and(~mask, std::memory_order_relaxed);
+  }
+}
+
+constexpr uint64_t MeasureSampling::kMeasuresPerChunk;
+constexpr size_t MeasureSampling::kMaxChunks;
+
+MeasureSampling::~MeasureSampling() {
+  for (auto& chunk : chunks_) {
+    delete chunk.load(std::memory_order_relaxed);
+  }
+}
+
+uint32_t MeasureSampling::one_in(uint64_t index) const {
+  const uint64_t chunk_index = index / kMeasuresPerChunk;
+  if (chunk_index >= kMaxChunks) {
+    return 1;
+  }
+  const Chunk* chunk = chunks_[chunk_index].load(std::memory_order_acquire);
+  if (chunk == nullptr) {
+    return 1;
+  }
+  return std::max<uint32_t>(
+      chunk->one_in[index % kMeasuresPerChunk].load(std::memory_order_relaxed),
+      1);
+}
+
+void MeasureSampling::Set(uint64_t index, uint32_t one_in) {
+  const uint64_t chunk_index = index / kMeasuresPerChunk;
+  if (chunk_index >= kMaxChunks) {
+    return;
+  }
+  // Keeps the countdowns' lengths within range.
+  one_in = std::min<uint32_t>(one_in, uint32_t{1} << 31);
+  const uint32_t stored = one_in > 1 ? one_in : 0;
+  Chunk* chunk = chunks_[chunk_index].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    if (stored == 0) {
+      return;
+    }
+    // Value-initialized, so no measure starts sampled.
+    chunk = new Chunk();
+    chunks_[chunk_index].store(chunk, std::memory_order_release);
+  }
+  const uint32_t previous = chunk->one_in[index % kMeasuresPerChunk].exchange(
+      stored, std::memory_order_relaxed);
+  if (previous == 0 && stored != 0) {
+    num_sampled_.fetch_add(1, std::memory_order_relaxed);
+  } else if (previous != 0 && stored == 0) {
+    num_sampled_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+bool MeasureSampling::KeepSlow(uint64_t index) const {
+  const uint32_t rate = one_in(index);
+  if (rate == 1) {
+    return true;
+  }
+  // The recordings this thread has left to skip before keeping one, plus one,
+  // by measure index; 0 until the thread first records the measure.
+  thread_local std::vector<uint32_t> countdowns;
+  if (index >= countdowns.size()) {
+    countdowns.resize(index + 1);
+  }
+  uint32_t& countdown = countdowns[index];
+  if (countdown == 0) {
+    // Starts part way through a run, so that threads recording the measure
+    // only a few times are not all kept.
+    countdown = 1 + common::Random::GetRandom()->GenerateRandom32() % rate;
+  }
+  if (--countdown > 0) {
+    return false;
+  }
+  // Runs are uniform in [1, 2N-1], averaging N.
+  countdown = 1 + common::Random::GetRandom()->GenerateRandom32() %
+                      (2 * rate - 1);
+  return true;
+}
+
+absl::Span<const Measurement> MeasureSampling::SampleSlow(
+    absl::Span<const Measurement> measurements,
+    std::vector<Measurement>* kept) const {
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    if (KeepSlow(MeasureRegistryImpl::IdToIndex(measurements[i].id_))) {
+      continue;
+    }
+    // Copies only once one is skipped, deciding for the rest as they are
+    // copied.
+    // Measurement is not assignable, so the vector is rebuilt.
+    kept->clear();
+    for (size_t j = 0; j < i; ++j) {
+      kept->push_back(measurements[j]);
+    }
+    for (++i; i < measurements.size(); ++i) {
+      if (KeepSlow(MeasureRegistryImpl::IdToIndex(measurements[i].id_))) {
+        kept->push_back(measurements[i]);
+      }
+    }
+    return *kept;
+  }
+  return measurements;
+}
+
+CounterCells::CounterCells(uint64_t measure_index,
+                           opencensus::tags::TagMap tags, size_t num_shards)
+    : measure_index_(measure_index),
+      tags_(std::move(tags)),
+      cells_(num_shards) {}
+
+void CounterCells::Drain(Delta* delta) {
+  uint64_t count = 0;
+  int64_t sum = 0;
+  for (Cell& cell : cells_) {
+    count += cell.count.exchange(0, std::memory_order_relaxed);
+    sum += cell.sum.exchange(0, std::memory_order_relaxed);
+  }
+  delta->RecordInt64Values(measure_index_, tags_, count, sum);
+}
+
+BoundTags::BoundTags(opencensus::tags::TagMap tags)
+    : tags_(std::move(tags)), cache_(DeltaProducer::Get()->num_shards()) {}
+
 DeltaProducer* DeltaProducer::Get() {
   static DeltaProducer* global_delta_producer = new DeltaProducer;
   return global_delta_producer;
 }
 
-void DeltaProducer::AddMeasure() {
-  delta_mu_.Lock();
-  absl::MutexLock harvester_lock(&harvester_mu_);
-  registered_boundaries_.push_back({});
+void DeltaProducer::AddMeasures(int num_measures) {
+  absl::MutexLock l(&delta_mu_);
+  DeltaConfig* config = MutableConfig();
+  config->measures.resize(config->measures.size() + num_measures);
+  num_views_.resize(num_views_.size() + num_measures, 0);
+  measures_disabled_.resize(measures_disabled_.size() + num_measures, false);
+  config_sequences_.resize(config_sequences_.size() + num_measures, 0);
+  // Deltas recorded before the new measure are merged asynchronously--the
+  // StatsManager handles deltas with fewer measures than are registered.
   SwapDeltas();
-  delta_mu_.Unlock();
-  ConsumeLastDelta();
 }
 
 void DeltaProducer::AddBoundaries(uint64_t index,
                                   const BucketBoundaries& boundaries) {
-  delta_mu_.Lock();
-  auto& measure_boundaries = registered_boundaries_[index];
+  absl::MutexLock l(&delta_mu_);
+  const auto& measure_boundaries = config_->measures[index].boundaries;
   if (std::find(measure_boundaries.begin(), measure_boundaries.end(),
-                boundaries) == measure_boundaries.end()) {
+                boundaries) != measure_boundaries.end()) {
+    return;
+  }
+  MutableConfig()->measures[index].boundaries.push_back(boundaries);
+  config_sequences_[index] = SwapDeltas();
+}
+
+void DeltaProducer::AddExponentialHistogram(uint64_t index, int max_buckets) {
+  absl::MutexLock l(&delta_mu_);
+  if (max_buckets <= config_->measures[index].exponential_max_buckets) {
+    return;
+  }
+  MutableConfig()->measures[index].exponential_max_buckets = max_buckets;
+  config_sequences_[index] = SwapDeltas();
+}
+
+uint64_t DeltaProducer::AddView(
+    uint64_t index, const std::vector<opencensus::tags::TagKey>& columns) {
+  absl::MutexLock l(&delta_mu_);
+  bool columns_added = false;
+  for (const auto& column : columns) {
+    columns_added |= num_views_by_column_[column]++ == 0;
+  }
+  const bool first_view = num_views_[index]++ == 0;
+  if (first_view) {
+    if (!harvesting_) {
+      StartHarvesting();
+    }
+    if (!measures_disabled_[index]) {
+      MutableConfig()->measures[index].has_views = true;
+      active_measures_.Set(index, true);
+    }
+  }
+  if (columns_added) {
+    UpdateColumns();
+  }
+  if (first_view || columns_added) {
+    const uint64_t sequence = SwapDeltas();
+    // Data recorded without the new columns must not reach the new view, nor
+    // may data queued before the measure's last view was removed.
+    if (first_view) {
+      config_sequences_[index] = sequence;
+    }
+    if (columns_added) {
+      columns_sequence_ = sequence;
+    }
+  }
+  return std::max(config_sequences_[index], columns_sequence_);
+}
+
+void DeltaProducer::RemoveView(
+    uint64_t index, const std::vector<opencensus::tags::TagKey>& columns) {
+  absl::MutexLock l(&delta_mu_);
+  bool columns_removed = false;
+  for (const auto& column : columns) {
+    auto it = num_views_by_column_.find(column);
+    ABSL_ASSERT(it != num_views_by_column_.end() && it->second > 0);
+    if (--it->second == 0) {
+      num_views_by_column_.erase(it);
+      columns_removed = true;
+    }
+  }
+  ABSL_ASSERT(num_views_[index] > 0);
+  const bool last_view = --num_views_[index] == 0;
+  if (!columns_removed && !last_view) {
+    return;
+  }
+  if (last_view && !measures_disabled_[index]) {
+    MutableConfig()->measures[index].has_views = false;
+    active_measures_.Set(index, false);
+  }
+  if (columns_removed) {
+    UpdateColumns();
+  }
+  SwapDeltas();
+}
+
+void DeltaProducer::SetMeasureSampling(uint64_t index, uint32_t one_in) {
+  absl::MutexLock l(&delta_mu_);
+  one_in = std::max<uint32_t>(one_in, 1);
+  if (index >= config_->measures.size() ||
+      config_->measures[index].sample_one_in == one_in) {
+    return;
+  }
+  MutableConfig()->measures[index].sample_one_in = one_in;
+  sampling_.Set(index, one_in);
+  // Data recorded at the previous rate is merged with the previous delta.
+  SwapDeltas();
+}
+
+void DeltaProducer::SetMeasureDisabled(uint64_t index, bool disabled) {
+  absl::MutexLock l(&delta_mu_);
+  // Measures are added to the StatsManager first.
+  if (index >= measures_disabled_.size() ||
+      measures_disabled_[index] == disabled) {
+    return;
+  }
+  measures_disabled_[index] = disabled;
+  if (num_views_[index] == 0) {
+    return;
+  }
+  MutableConfig()->measures[index].has_views = !disabled;
+  active_measures_.Set(index, !disabled);
+  // Batches recording other measures too stop at the next delta.
+  SwapDeltas();
+}
+
+DeltaConfig* DeltaProducer::MutableConfig() {
+  auto config = std::make_shared<DeltaConfig>(*config_);
+  DeltaConfig* mutable_config = config.get();
+  config_ = std::move(config);
+  return mutable_config;
+}
+
+void DeltaProducer::UpdateColumns() {
+  std::vector<opencensus::tags::TagKey>& columns = MutableConfig()->columns;
+  columns.clear();
+  for (const auto& column_and_count : num_views_by_column_) {
+    columns.push_back(column_and_count.first);
+  }
+}
+
+void DeltaProducer::Record(absl::Span<const Measurement> measurements,
+                           const opencensus::tags::TagMap& tags,
+                           const ExemplarAttachment* attachment) {
+  common::Scheduler::Get()->RestartAfterFork();
+  if (!AnyHasViews(measurements)) {
+    return;
+  }
+  Shard* shard = shards_[ShardIndex()].get();
+  size_t num_added;
+  {
+    absl::MutexLock l(&shard->mu);
+    const size_t num_tag_sets = shard->delta.delta().size();
+    shard->delta.Record(measurements, tags, attachment);
+    num_added = shard->delta.delta().size() - num_tag_sets;
+  }
+  AddPendingTagSets(num_added);
+}
+
+void DeltaProducer::RecordBatch(
+    absl::Span<const std::pair<opencensus::tags::TagMap,
+                               std::vector<Measurement>>>
+        batch) {
+  common::Scheduler::Get()->RestartAfterFork();
+  std::vector<Measurement> kept;
+  if (std::none_of(
+          batch.begin(), batch.end(),
+          [this](const std::pair<opencensus::tags::TagMap,
+                                 std::vector<Measurement>>& element) {
+            return AnyHasViews(element.second);
+          })) {
+    return;
+  }
+  Shard* shard = shards_[ShardIndex()].get();
+  size_t num_added;
+  {
+    absl::MutexLock l(&shard->mu);
+    const size_t num_tag_sets = shard->delta.delta().size();
+    for (const auto& tags_and_measurements : batch) {
+      if (!shard->delta.AnyHasViews(tags_and_measurements.second)) {
+        continue;
+      }
+      const absl::Span<const Measurement> measurements =
+          sampling_.Sample(tags_and_measurements.second, &kept);
+      if (measurements.empty()) {
+        continue;
+      }
+      shard->delta.RecordToRow(
+          measurements, shard->delta.FindOrAddRow(tags_and_measurements.first));
+    }
+    num_added = shard->delta.delta().size() - num_tag_sets;
+  }
+  AddPendingTagSets(num_added);
+}
+
+void DeltaProducer::RecordBatchAt(
+    absl::Span<const TimedMeasurements> batch) {
+  std::shared_ptr<const DeltaConfig> config;
+  uint64_t sequence;
+  {
+    absl::MutexLock l(&delta_mu_);
+    if (!harvesting_) {
+      return;  // There are no views yet.
+    }
+    config = config_;
+    // The data is recorded with the active delta's configuration, so it is
+    // merged into the views that will merge the active delta.
     absl::MutexLock harvester_lock(&harvester_mu_);
-    measure_boundaries.push_back(boundaries);
-    SwapDeltas();
-    delta_mu_.Unlock();
-    ConsumeLastDelta();
-  } else {
-    delta_mu_.Unlock();
+    sequence = queued_sequence_ + 1;
+  }
+  // Group the elements by time, truncated to the finest bucket interval of
+  // interval views, keeping their order within each group.
+  const absl::Duration granularity =
+      IntervalBuckets::BucketInterval(absl::ZeroDuration());
+  std::vector<std::pair<absl::Time, size_t>> order;
+  order.reserve(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (AnyHasViews(batch[i].measurements)) {
+      order.emplace_back(
+          absl::UnixEpoch() +
+              absl::Floor(batch[i].time - absl::UnixEpoch(), granularity),
+          i);
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  Delta delta;
+  Delta empty;
+  delta.SwapAndReset(config, &empty);
+  StatsManager* manager = StatsManager::Get();
+  std::vector<Measurement> kept;
+  auto it = order.begin();
+  while (it != order.end()) {
+    const absl::Time time = it->first;
+    for (; it != order.end() && it->first == time; ++it) {
+      const TimedMeasurements& element = batch[it->second];
+      if (!delta.AnyHasViews(element.measurements)) {
+        continue;
+      }
+      const absl::Span<const Measurement> measurements =
+          sampling_.Sample(element.measurements, &kept);
+      if (!measurements.empty()) {
+        delta.RecordToRow(measurements, delta.FindOrAddRow(element.tags));
+      }
+    }
+    manager->MergeDeltaAt(delta, sequence, time);
+    delta.ResetForReuse();
+  }
+}
+
+void DeltaProducer::Record(absl::Span<const Measurement> measurements,
+                           BoundTags* bound,
+                           const ExemplarAttachment* attachment) {
+  common::Scheduler::Get()->RestartAfterFork();
+  if (!AnyHasViews(measurements)) {
+    return;
   }
+  const size_t index = ShardIndex();
+  Shard* shard = shards_[index].get();
+  BoundTags::CacheEntry& entry = bound->cache_[index];
+  size_t num_added = 0;
+  {
+    absl::MutexLock l(&shard->mu);
+    if (!shard->delta.AnyHasViews(measurements)) {
+      return;
+    }
+    if (entry.generation != shard->generation) {
+      const size_t num_tag_sets = shard->delta.delta().size();
+      entry.row = shard->delta.FindOrAddRow(bound->tags_);
+      entry.generation = shard->generation;
+      num_added = shard->delta.delta().size() - num_tag_sets;
+    }
+    shard->delta.RecordToRow(measurements, entry.row, attachment);
+  }
+  AddPendingTagSets(num_added);
+}
+
+void DeltaProducer::AddCounter(CounterCells* cells) {
+  absl::MutexLock l(&delta_mu_);
+  counters_.push_back(cells);
 }
 
-void DeltaProducer::Record(std::initializer_list<Measurement> measurements,
-                           opencensus::tags::TagMap tags) {
+void DeltaProducer::RemoveCounter(CounterCells* cells) {
   absl::MutexLock l(&delta_mu_);
-  active_delta_.Record(measurements, std::move(tags));
+  counters_.erase(std::find(counters_.begin(), counters_.end(), cells));
+  Shard* shard = shards_[ShardIndex()].get();
+  absl::MutexLock shard_lock(&shard->mu);
+  cells->Drain(&shard->delta);
+}
+
+void DeltaProducer::PublishTo(SharedDeltas* shared) {
+  absl::MutexLock l(&harvester_mu_);
+  publish_to_ = shared;
+}
+
+void DeltaProducer::CollectFrom(SharedDeltas* shared) {
+  absl::MutexLock l(&delta_mu_);
+  collect_from_ = shared;
+}
+
+void DeltaProducer::RecordSelf(absl::Span<const Measurement> measurements,
+                               const opencensus::tags::TagMap& tags) {
+  if (!AnyHasViews(measurements)) {
+    return;
+  }
+  std::vector<Measurement> kept;
+  measurements = sampling_.Sample(measurements, &kept);
+  if (measurements.empty()) {
+    return;
+  }
+  absl::MutexLock l(&self_shard_->mu);
+  self_shard_->delta.Record(measurements, tags);
 }
 
 void DeltaProducer::Flush() {
+  uint64_t sequence;
+  {
+    absl::MutexLock l(&delta_mu_);
+    sequence = SwapDeltas();
+  }
+  WaitForConsumed(sequence);
+}
+
+void DeltaProducer::SetHarvestParams(const HarvestParams& params) {
+  absl::MutexLock l(&harvester_mu_);
+  harvest_params_ = params;
+  harvest_params_updated_ = true;
+  max_pending_tag_sets_.store(params.max_pending_tag_sets,
+                              std::memory_order_relaxed);
+  const size_t per_shard = ExpectedTagSetsPerShard();
+  if (per_shard != 0) {
+    for (const auto& shard : shards_) {
+      absl::MutexLock shard_lock(&shard->mu);
+      shard->delta.Reserve(per_shard);
+    }
+    for (auto& buffer : free_buffers_) {
+      ReserveBuffer(&buffer);
+    }
+  }
+  WakeHarvestTask();
+}
+
+size_t DeltaProducer::ExpectedTagSetsPerShard() const {
+  // Recording threads are spread over the shards by CPU.
+  return (harvest_params_.expected_tag_sets + shards_.size() - 1) /
+         shards_.size();
+}
+
+void DeltaProducer::ReserveBuffer(std::vector<Delta>* buffer) {
+  const size_t per_shard = ExpectedTagSetsPerShard();
+  if (per_shard == 0) {
+    return;
+  }
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    (*buffer)[i].Reserve(per_shard);
+  }
+}
+
+void DeltaProducer::PrewarmTagSets(
+    absl::Span<const opencensus::tags::TagMap> tag_sets) {
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    shard->delta.Reserve(shard->delta.delta().size() + tag_sets.size());
+    for (const auto& tags : tag_sets) {
+      shard->delta.FindOrAddRow(tags);
+    }
+  }
+}
+
+void DeltaProducer::SetHarvestIntervalScale(int scale) {
+  absl::MutexLock l(&harvester_mu_);
+  scale = std::max(scale, 1);
+  if (scale == harvest_interval_scale_) {
+    return;
+  }
+  harvest_interval_scale_ = scale;
+  harvest_params_updated_ = true;
+  WakeHarvestTask();
+}
+
+void DeltaProducer::GetMemoryUsage(StatsMemoryUsage::Delta* active,
+                                   StatsMemoryUsage::Delta* last) const {
+  const auto add = [](const Delta& delta, StatsMemoryUsage::Delta* usage) {
+    usage->tag_sets += delta.delta().size();
+    usage->bytes += delta.ApproximateBytes();
+  };
+  *active = StatsMemoryUsage::Delta();
+  *last = StatsMemoryUsage::Delta();
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    add(shard->delta, active);
+  }
+  {
+    absl::MutexLock l(&self_shard_->mu);
+    add(self_shard_->delta, active);
+  }
+  // The buffer being merged is at the front of queue_, and only reaches
+  // free_buffers_ once the harvest task is done with it.
+  absl::MutexLock l(&harvester_mu_);
+  for (const auto& buffer : free_buffers_) {
+    for (const Delta& delta : buffer) {
+      add(delta, last);
+    }
+  }
+}
+
+void DeltaProducer::PrepareFork() {
   delta_mu_.Lock();
-  absl::MutexLock harvester_lock(&harvester_mu_);
-  SwapDeltas();
+  harvester_mu_.Lock();
+  for (const auto& shard : shards_) {
+    shard->mu.Lock();
+  }
+  self_shard_->mu.Lock();
+}
+
+void DeltaProducer::ParentAfterFork() {
+  self_shard_->mu.Unlock();
+  for (const auto& shard : shards_) {
+    shard->mu.Unlock();
+  }
+  harvester_mu_.Unlock();
   delta_mu_.Unlock();
-  ConsumeLastDelta();
+}
+
+void DeltaProducer::ChildAfterFork() {
+  const auto reset = [this](Shard* shard) {
+    Delta empty;
+    shard->delta.SwapAndReset(config_, &empty);
+    ++shard->generation;
+    common::Scheduler::ReinitMutexInChild(&shard->mu);
+  };
+  reset(self_shard_.get());
+  for (const auto& shard : shards_) {
+    reset(shard.get());
+  }
+  Delta empty;
+  for (CounterCells* counter : counters_) {
+    counter->Drain(&empty);
+  }
+  pending_tag_sets_.store(0, std::memory_order_relaxed);
+  // Nothing waits for the queued deltas in the child, so they are dropped
+  // rather than merged; SwapDeltas() replaces the buffers as needed.
+  queue_.clear();
+  consumed_sequence_ = queued_sequence_;
+  harvest_requested_ = false;
+  common::Scheduler::ReinitMutexInChild(&harvester_mu_);
+  common::Scheduler::ReinitMutexInChild(&delta_mu_);
+}
+
+void DeltaProducer::AddPendingTagSets(size_t num_added) {
+  if (num_added == 0) {
+    return;
+  }
+  const uint64_t max = max_pending_tag_sets_.load(std::memory_order_relaxed);
+  const uint64_t total =
+      pending_tag_sets_.fetch_add(num_added, std::memory_order_relaxed) +
+      num_added;
+  // Only the Record() call that crosses the threshold requests a harvest.
+  if (max != 0 && total > max && total - num_added <= max) {
+    {
+      absl::MutexLock l(&harvester_mu_);
+      harvest_requested_ = true;
+    }
+    WakeHarvestTask();
+  }
+}
+
+// static
+std::vector<std::unique_ptr<DeltaProducer::Shard>> DeltaProducer::MakeShards() {
+  const size_t num_shards = std::max<size_t>(
+      1, std::min<size_t>(kMaxShards, std::thread::hardware_concurrency()));
+  std::vector<std::unique_ptr<DeltaProducer::Shard>> shards;
+  shards.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    shards.push_back(absl::make_unique<DeltaProducer::Shard>());
+  }
+  return shards;
 }
 
 DeltaProducer::DeltaProducer()
-    : harvester_thread_(&DeltaProducer::RunHarvesterLoop, this) {}
+    : config_(EmptyDeltaConfig()),
+      shards_(MakeShards()),
+      self_shard_(absl::make_unique<Shard>()),
+      free_buffers_(kNumDeltaBuffers, std::vector<Delta>(shards_.size() + 1)) {
+  RegisterStatsForkHandler();
+}
+
+size_t DeltaProducer::ShardIndex() const {
+  static std::atomic<size_t> next_shard(0);
+  static const size_t num_cpus =
+      std::max(1u, std::thread::hardware_concurrency());
+  struct ThreadShard {
+    size_t index = 0;
+    bool assigned = false;
+    uint32_t calls_until_refresh = 0;
+  };
+  static thread_local ThreadShard thread_shard;
+  if (thread_shard.calls_until_refresh == 0) {
+    thread_shard.calls_until_refresh = kShardRefreshCalls;
+    const int cpu = CurrentCpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < num_cpus) {
+      // Consecutive CPUs, which are usually on the same node, share shards.
+      thread_shard.index = cpu * shards_.size() / num_cpus;
+      thread_shard.assigned = true;
+    } else if (!thread_shard.assigned) {
+      thread_shard.index =
+          next_shard.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+      thread_shard.assigned = true;
+    }
+  }
+  --thread_shard.calls_until_refresh;
+  return thread_shard.index;
+}
 
-void DeltaProducer::SwapDeltas() {
-  ABSL_ASSERT(last_delta_.delta().empty() && "Last delta was not consumed.");
-  active_delta_.SwapAndReset(registered_boundaries_, &last_delta_);
+void DeltaProducer::StartHarvesting() {
+  harvesting_ = true;
+  last_harvest_time_ = absl::Now();
+  {
+    absl::MutexLock l(&harvester_mu_);
+    harvest_interval_ = BaseHarvestInterval();
+  }
+  // The task may run before this returns, but waits for delta_mu_ to harvest.
+  harvest_task_.store(
+      common::Scheduler::Get()->AddTask([this] { return RunHarvest(); },
+                                        last_harvest_time_ + harvest_interval_),
+      std::memory_order_release);
 }
 
-void DeltaProducer::ConsumeLastDelta() {
-  StatsManager::Get()->MergeDelta(last_delta_);
-  last_delta_.clear();
+void DeltaProducer::WakeHarvestTask() {
+  const uint64_t task = harvest_task_.load(std::memory_order_acquire);
+  if (task != 0) {
+    common::Scheduler::Get()->Wake(task);
+  }
 }
 
-void DeltaProducer::RunHarvesterLoop() {
-  absl::Time next_harvest_time = absl::Now() + harvest_interval_;
-  while (true) {
+uint64_t DeltaProducer::SwapDeltas() {
+  if (!harvesting_) {
+    // Nothing has been recorded, so there is nothing to queue.
+    const auto reset = [this](Shard* shard) {
+      absl::MutexLock l(&shard->mu);
+      Delta empty;
+      shard->delta.SwapAndReset(config_, &empty);
+      ++shard->generation;
+    };
+    for (const auto& shard : shards_) {
+      reset(shard.get());
+    }
+    reset(self_shard_.get());
+    // Discard values recorded while there were no views.
+    Delta empty;
+    for (CounterCells* counter : counters_) {
+      counter->Drain(&empty);
+    }
+    if (collect_from_ != nullptr) {
+      collect_from_->Drain(&empty);
+    }
+    absl::MutexLock l(&harvester_mu_);
+    return queued_sequence_;
+  }
+  OPENCENSUS_PROBE0(delta_swap_begin);
+  uint64_t sequence;
+  {
+    absl::MutexLock l(&harvester_mu_);
+    if (free_buffers_.empty()) {
+      free_buffers_.emplace_back(shards_.size() + 1);
+      ReserveBuffer(&free_buffers_.back());
+    }
+    queue_.push_back(std::move(free_buffers_.back()));
+    free_buffers_.pop_back();
+    std::vector<Delta>& buffer = queue_.back();
+    // Hold all shard locks while swapping so that the harvested deltas form a
+    // consistent snapshot and all shards switch configuration together.
+    for (const auto& shard : shards_) {
+      shard->mu.Lock();
+    }
+    self_shard_->mu.Lock();
+    for (CounterCells* counter : counters_) {
+      counter->Drain(&shards_.front()->delta);
+    }
+    if (collect_from_ != nullptr) {
+      collect_from_->Drain(&shards_.front()->delta);
+    }
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      shards_[i]->delta.SwapAndReset(config_, &buffer[i]);
+      ++shards_[i]->generation;
+    }
+    self_shard_->delta.SwapAndReset(config_, &buffer.back());
+    pending_tag_sets_.store(0, std::memory_order_relaxed);
+    self_shard_->mu.Unlock();
+    for (const auto& shard : shards_) {
+      shard->mu.Unlock();
+    }
+    sequence = ++queued_sequence_;
+  }
+  OPENCENSUS_PROBE1(delta_swap_end, sequence);
+  // Wake the harvest task to merge the queued delta.
+  WakeHarvestTask();
+  return sequence;
+}
+
+bool DeltaProducer::ConsumeQueuedDeltas() {
+  bool found_data = false;
+  harvester_mu_.Lock();
+  while (!queue_.empty()) {
+    std::vector<Delta>& buffer = queue_.front();
+    const uint64_t sequence = consumed_sequence_ + 1;
+    const HarvestParams params = harvest_params_;
+    SharedDeltas* const publish_to = publish_to_;
+    harvester_mu_.Unlock();
+    OPENCENSUS_PROBE1(delta_consume_begin, sequence);
+    size_t num_tag_sets = 0;
+    const absl::Time merge_start = absl::Now();
+    std::vector<const Delta*> deltas;
+    deltas.reserve(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (!buffer[i].delta().empty()) {
+        num_tag_sets += buffer[i].delta().size();
+        deltas.push_back(&buffer[i]);
+      }
+    }
+    if (publish_to != nullptr) {
+      for (const Delta* delta : deltas) {
+        publish_to->Publish(*delta);
+      }
+    } else if (!deltas.empty()) {
+      StatsManager::Get()->MergeDeltas(deltas, sequence, params);
+    }
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      // Rows kept from earlier harvests may be present without data.
+      found_data |= buffer[i].ResetForReuse();
+    }
+    if (num_tag_sets > 0) {
+      // Recorded into the next self delta, which is not measured itself.
+      common::RecordSelfMetric(
+          common::SelfMetric::kMergeDeltaLatency,
+          absl::ToDoubleMilliseconds(absl::Now() - merge_start));
+      common::RecordSelfMetric(common::SelfMetric::kDeltaTagSets,
+                               num_tag_sets);
+    }
+    Delta& self_delta = buffer.back();
+    if (!self_delta.delta().empty()) {
+      if (publish_to != nullptr) {
+        publish_to->Publish(self_delta);
+      } else {
+        const Delta* const self_deltas[] = {&self_delta};
+        StatsManager::Get()->MergeDeltas(self_deltas, sequence);
+      }
+    }
+    self_delta.ResetForReuse();
+    OPENCENSUS_PROBE2(delta_consume_end, sequence, num_tag_sets);
+    harvester_mu_.Lock();
+    if (free_buffers_.size() < kNumDeltaBuffers) {
+      // Queued when the parameters changed, perhaps.
+      ReserveBuffer(&buffer);
+      free_buffers_.push_back(std::move(buffer));
+    }
+    queue_.pop_front();
+    ++consumed_sequence_;
+  }
+  harvester_mu_.Unlock();
+  return found_data;
+}
+
+void DeltaProducer::WaitForConsumed(uint64_t sequence) {
+  const uint64_t task = harvest_task_.load(std::memory_order_acquire);
+  if (task != 0 && common::Scheduler::Get()->manual_mode()) {
+    // No thread will run the harvest task.
+    common::Scheduler::Get()->RunTaskNow(task);
+  }
+  absl::MutexLock l(&harvester_mu_);
+  // SwapDeltas() woke the harvest task to consume the delta.
+  const std::pair<const DeltaProducer*, uint64_t> args(this, sequence);
+  harvester_mu_.Await(absl::Condition(&DeltaProducer::IsConsumed, &args));
+}
+
+// static
+bool DeltaProducer::IsConsumed(
+    const std::pair<const DeltaProducer*, uint64_t>* producer_and_sequence) {
+  return producer_and_sequence->first->consumed_sequence_ >=
+         producer_and_sequence->second;
+}
+
+absl::Time DeltaProducer::RunHarvest() {
+  bool harvest_due;
+  {
+    absl::MutexLock l(&harvester_mu_);
+    // If the parameters change, restart the wait with the new interval.
+    if (harvest_params_updated_) {
+      harvest_params_updated_ = false;
+      harvest_interval_ = BaseHarvestInterval();
+    }
+    // The scheduler may run the task early to share a wakeup.
+    harvest_due = harvest_requested_ ||
+                  absl::Now() + common::Scheduler::kCoalescingWindow >=
+                      last_harvest_time_ + harvest_interval_;
+    harvest_requested_ = false;
+  }
+
+  if (harvest_due) {
+    // Measure the next interval from the start of this harvest, so that the
+    // time spent merging does not delay the schedule.
     const absl::Time now = absl::Now();
-    absl::SleepFor(next_harvest_time - now);
-    // Account for the possibility that the last harvest took longer than
-    // harvest_interval_ and we are already past next_harvest_time.
-    next_harvest_time = std::max(next_harvest_time, now) + harvest_interval_;
-    Flush();
+    const absl::Duration lag = now - (last_harvest_time_ + harvest_interval_);
+    if (lag > absl::ZeroDuration()) {
+      common::RecordSelfMetric(common::SelfMetric::kHarvestLag,
+                               absl::ToDoubleMilliseconds(lag));
+    }
+    last_harvest_time_ = now;
+    absl::MutexLock l(&delta_mu_);
+    SwapDeltas();
+  }
+  const bool found_data = ConsumeQueuedDeltas();
+  if (harvest_due && common::SelfMetricsEnabled()) {
+    // Measuring walks every row, so it is only done when the self-metrics are
+    // exported.
+    RecordMemoryUsage();
+  }
+
+  if (harvest_due) {
+    absl::MutexLock l(&harvester_mu_);
+    if (found_data ||
+        harvest_params_.max_idle_interval <= harvest_params_.interval) {
+      harvest_interval_ = BaseHarvestInterval();
+    } else {
+      harvest_interval_ =
+          std::min(2 * harvest_interval_, MaxIdleHarvestInterval());
+    }
   }
+  return last_harvest_time_ + harvest_interval_;
 }
 
 }  // namespace stats
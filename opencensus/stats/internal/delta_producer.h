@@ -15,113 +15,658 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_DELTA_PRODUCER_H_
 #define OPENCENSUS_STATS_INTERNAL_DELTA_PRODUCER_H_
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
-#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/memory_resource.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/distribution.h"
 #include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_config.h"
+#include "opencensus/tags/tag_key.h"
 #include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
 
+// The configuration deltas are recorded with: the MeasureDataConfig required
+// by the registered views, indexed by measure, and the tag keys used as
+// columns by any view, sorted. A DeltaConfig is immutable once published and
+// shared by every delta recorded with it, so harvests swap a pointer rather
+// than copying it, and detect configuration changes by pointer comparison.
+struct DeltaConfig {
+  std::vector<MeasureDataConfig> measures;
+  std::vector<opencensus::tags::TagKey> columns;
+};
+
 // Delta is thread-compatible.
 class Delta final {
  public:
-  void Record(std::initializer_list<Measurement> measurements,
-              opencensus::tags::TagMap tags);
-
-  // Swaps registered_boundaries_ and delta_ with *other, clears delta_, and
-  // updates registered_boundaries_.
-  void SwapAndReset(
-      std::vector<std::vector<BucketBoundaries>>& registered_boundaries,
-      Delta* other);
-
-  // Clears registered_boundaries_ and delta_.
-  void clear();
-
-  const std::unordered_map<opencensus::tags::TagMap, std::vector<MeasureData>,
-                           opencensus::tags::TagMap::Hash>&
-  delta() const {
-    return delta_;
-  }
+  // Starts with an empty configuration, which records nothing.
+  Delta();
+  // Records 'measurements' of measures with views; adds no row if there are
+  // none. If 'attachment' is not null, the values become exemplars.
+  void Record(absl::Span<const Measurement> measurements,
+              const opencensus::tags::TagMap& tags,
+              const ExemplarAttachment* attachment = nullptr);
+
+  // Returns true if any of 'measurements' is of a measure with views.
+  bool AnyHasViews(absl::Span<const Measurement> measurements) const;
+
+  // Returns the row for 'tags', adding an empty row if none exists. Rows are
+  // keyed only on the tags used as columns by some view, so tags no view uses
+  // (e.g. request IDs) do not multiply rows. 'tags' is only copied when a row
+  // is added, so recording to an existing row does not allocate unless 'tags'
+  // has keys that are not columns. The returned pointer is valid until the
+  // delta is swapped or cleared.
+  std::vector<MeasureData>* FindOrAddRow(const opencensus::tags::TagMap& tags);
+
+  // Adds 'measurements' of measures with views to 'row', which must have been
+  // returned by FindOrAddRow() since the last swap.
+  void RecordToRow(absl::Span<const Measurement> measurements,
+                   std::vector<MeasureData>* row,
+                   const ExemplarAttachment* attachment = nullptr);
+
+  // Swaps the configuration and delta_ with *other. If the rows received from
+  // *other were built for a configuration other than 'config' (which must not
+  // be null), clears them and switches to 'config'; otherwise they are kept
+  // for reuse.
+  void SwapAndReset(const std::shared_ptr<const DeltaConfig>& config,
+                    Delta* other);
+
+  // Adds 'count' values summing to 'sum' of the int64 measure 'index' under
+  // 'tags', if the measure has views.
+  void RecordInt64Values(uint64_t index, const opencensus::tags::TagMap& tags,
+                         uint64_t count, int64_t sum);
+
+  // Prepares a consumed delta for reuse: rows that received no data are
+  // evicted and all other rows are zeroed in place, so that tag sets recorded
+  // in consecutive harvests do not reallocate their rows. Returns true if any
+  // row had data.
+  bool ResetForReuse();
+
+  // Makes room for 'num_tag_sets' rows without rehashing.
+  void Reserve(size_t num_tag_sets);
+
+  // Approximates the bytes held by the delta's rows, including their tags and
+  // histograms.
+  size_t ApproximateBytes() const;
+
+  // The configuration the delta's rows were recorded with.
+  const DeltaConfig& config() const { return *config_; }
+
+  // Allocated from the kStatsDeltas memory resource (see
+  // common::SetMemoryResource()).
+  typedef std::unordered_map<
+      opencensus::tags::TagMap, std::vector<MeasureData>,
+      opencensus::tags::TagMap::Hash,
+      std::equal_to<opencensus::tags::TagMap>,
+      common::ResourceAllocator<
+          std::pair<const opencensus::tags::TagMap, std::vector<MeasureData>>,
+          common::MemorySubsystem::kStatsDeltas>>
+      Rows;
+
+  const Rows& delta() const { return delta_; }
 
  private:
-  // A copy of registered_boundaries_ in the DeltaProducer as of when the
-  // delta was started.
-  std::vector<std::vector<BucketBoundaries>> registered_boundaries_;
+  // Looks up 'tags', which must have only keys in config_->columns, adding a
+  // row holding a copy of 'tags' if none exists.
+  std::vector<MeasureData>* FindOrAddProjectedRow(
+      const opencensus::tags::TagMap& tags);
+
+  // The DeltaProducer's configuration as of when the delta was started. Never
+  // null.
+  std::shared_ptr<const DeltaConfig> config_;
 
   // The actual data. Each MeasureData[] contains one element for each
-  // registered measure.
-  std::unordered_map<opencensus::tags::TagMap, std::vector<MeasureData>,
-                     opencensus::tags::TagMap::Hash>
-      delta_;
+  // registered measure. MeasureData refer to config_'s boundaries, which the
+  // rows' delta keeps alive.
+  Rows delta_;
+};
+
+// ActiveMeasures is the set of measures with views, which recording threads
+// check before taking any lock. It is a bitmap by measure index, allocated in
+// chunks that are never freed, so that reads need no synchronization with
+// growth.
+//
+// Contains() and ContainsAny() are thread-safe; calls to Set() must be
+// serialized.
+class ActiveMeasures final {
+ public:
+  ActiveMeasures() = default;
+  ~ActiveMeasures();
+  ActiveMeasures(const ActiveMeasures&) = delete;
+  ActiveMeasures& operator=(const ActiveMeasures&) = delete;
+
+  // Measures past the bitmap's capacity are always reported as active, leaving
+  // the check to the delta.
+  bool Contains(uint64_t index) const {
+    const uint64_t chunk_index = index / kMeasuresPerChunk;
+    if (chunk_index >= kMaxChunks) {
+      return true;
+    }
+    const Chunk* chunk = chunks_[chunk_index].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      return false;
+    }
+    const uint64_t bit = index % kMeasuresPerChunk;
+    return (chunk->words[bit / 64].load(std::memory_order_relaxed) >>
+            (bit % 64)) &
+           1;
+  }
+  bool ContainsAny(absl::Span<const Measurement> measurements) const;
+
+  void Set(uint64_t index, bool active);
+
+ private:
+  static constexpr size_t kWordsPerChunk = 64;
+  static constexpr uint64_t kMeasuresPerChunk = kWordsPerChunk * 64;
+  // Enough for 2^20 measures.
+  static constexpr size_t kMaxChunks = 256;
+
+  struct Chunk {
+    std::atomic<uint64_t> words[kWordsPerChunk];
+  };
+
+  std::array<std::atomic<Chunk*>, kMaxChunks> chunks_{};
+};
+
+// MeasureSampling holds the rate at which each measure's recordings are
+// sampled (see DeltaProducer::SetMeasureSampling()), by measure index,
+// allocated like ActiveMeasures so that recording threads read it without
+// synchronization. A thread keeps one in N of its recordings of a measure
+// sampled 1 in N: it counts down from a random length averaging N, drawn after
+// each recording kept, so that skipped recordings draw no random numbers and
+// periodic recording patterns do not bias which are kept.
+//
+// Sample(), Keep() and one_in() are thread-safe; calls to Set() must be
+// serialized.
+class MeasureSampling final {
+ public:
+  MeasureSampling() = default;
+  ~MeasureSampling();
+  MeasureSampling(const MeasureSampling&) = delete;
+  MeasureSampling& operator=(const MeasureSampling&) = delete;
+
+  // Returns 'measurements' less those this thread skips. The kept
+  // measurements are copied into '*kept' only if any are skipped.
+  absl::Span<const Measurement> Sample(
+      absl::Span<const Measurement> measurements,
+      std::vector<Measurement>* kept) const {
+    if (num_sampled_.load(std::memory_order_relaxed) == 0) {
+      return measurements;
+    }
+    return SampleSlow(measurements, kept);
+  }
+  // Returns whether this thread keeps its next recording of measure 'index'.
+  bool Keep(uint64_t index) const {
+    return num_sampled_.load(std::memory_order_relaxed) == 0 ||
+           KeepSlow(index);
+  }
+
+  // Returns N for measure 'index' sampled 1 in N, or 1 if it is not sampled.
+  uint32_t one_in(uint64_t index) const;
+  void Set(uint64_t index, uint32_t one_in);
+
+ private:
+  static constexpr uint64_t kMeasuresPerChunk = 4096;
+  // Enough for 2^20 measures; measures past that are not sampled.
+  static constexpr size_t kMaxChunks = 256;
+
+  struct Chunk {
+    // 0 for measures that are not sampled.
+    std::atomic<uint32_t> one_in[kMeasuresPerChunk];
+  };
+
+  absl::Span<const Measurement> SampleSlow(
+      absl::Span<const Measurement> measurements,
+      std::vector<Measurement>* kept) const;
+  bool KeepSlow(uint64_t index) const;
+
+  std::array<std::atomic<Chunk*>, kMaxChunks> chunks_{};
+  // The number of measures sampled, so that Sample() returns at once if none
+  // are.
+  std::atomic<uint64_t> num_sampled_{0};
+};
+
+// BoundTags is a TagMap with a cached location of its row in each shard of
+// the active delta, so that repeated recording under the same tags avoids
+// hashing and comparing the TagMap. Cache entries are revalidated once per
+// harvest.
+//
+// BoundTags is thread-safe; each cache entry is guarded by the mutex of the
+// corresponding shard.
+class BoundTags final {
+ public:
+  explicit BoundTags(opencensus::tags::TagMap tags);
+
+  const opencensus::tags::TagMap& tags() const { return tags_; }
+
+ private:
+  friend class DeltaProducer;
+
+  struct CacheEntry {
+    // The shard generation 'row' is valid for; 0 is never a valid generation.
+    uint64_t generation = 0;
+    std::vector<MeasureData>* row = nullptr;
+  };
+
+  const opencensus::tags::TagMap tags_;
+  // One entry per shard of the DeltaProducer.
+  std::vector<CacheEntry> cache_;
+};
+
+// CounterCells accumulates the values recorded through a BoundCounter: a count
+// and sum per shard of the active delta, kept on separate cache lines, which
+// are moved into the delta when it is swapped.
+//
+// Add() is thread-safe; Drain() must be serialized (it is called under the
+// DeltaProducer's delta_mu_).
+class CounterCells final {
+ public:
+  CounterCells(uint64_t measure_index, opencensus::tags::TagMap tags,
+               size_t num_shards);
+
+  CounterCells(const CounterCells&) = delete;
+  CounterCells& operator=(const CounterCells&) = delete;
+
+  uint64_t measure_index() const { return measure_index_; }
+
+  void Add(size_t shard, int64_t value) {
+    Cell& cell = cells_[shard];
+    cell.sum.fetch_add(value, std::memory_order_relaxed);
+    cell.count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Moves the accumulated values into 'delta'. A value added concurrently may
+  // have its sum and count drained by consecutive calls.
+  void Drain(Delta* delta);
+
+ private:
+  // Padded to two cache lines: the vector's storage is not aligned to a line,
+  // so this keeps the counters of neighbouring cells at least a line apart.
+  struct Cell {
+    std::atomic<int64_t> sum{0};
+    std::atomic<uint64_t> count{0};
+    char padding[128 - sizeof(std::atomic<int64_t>) -
+                 sizeof(std::atomic<uint64_t>)];
+  };
+
+  const uint64_t measure_index_;
+  const opencensus::tags::TagMap tags_;
+  std::vector<Cell> cells_;
+};
+
+// SharedDeltas accumulates deltas across the processes of a prefork server
+// (see shared_stats.h): publishing processes add their harvested deltas, and
+// the collecting process moves what has been added into its own.
+class SharedDeltas {
+ public:
+  virtual ~SharedDeltas() = default;
+
+  // Adds the data of 'delta'.
+  virtual void Publish(const Delta& delta) = 0;
+  // Moves the data added since the last call into 'delta'.
+  virtual void Drain(Delta* delta) = 0;
 };
 
 // DeltaProducer is thread-safe.
+//
+// To avoid contention between recording threads, the active delta is sharded:
+// each thread records into one of a fixed number of shards, each with its own
+// mutex. Shards are assigned by ranges of consecutive CPUs (re-read every few
+// hundred records, and round-robin where the CPU is unknown), so that on
+// multi-socket machines threads share shards, and hence cache lines, only with
+// threads on the same node. Rows are allocated by the recording threads and
+// each shard swaps with the same slot of every delta buffer, so rows kept for
+// reuse stay with their shard; under the usual first-touch NUMA policy they
+// live on the shard's node.
+//
+// Flushing swaps all shards into one of a few pre-allocated delta buffers and
+// queues it; the harvest task merges queued buffers into the StatsManager
+// in order. Swapping never waits for merges, so neither recording nor
+// configuration changes block behind a merge.
+//
+// Queued deltas are numbered in order. A configuration change applies from the
+// delta after the one it swaps out, and views only merge deltas recorded with
+// the configuration they need (see AddView()), so registering a view never
+// waits for earlier deltas to be merged.
+//
+// Nothing is recorded for measures without views (or disabled by
+// SetMeasureDisabled()): Record() returns before taking any lock if none of
+// its measurements has views. The harvest task is
+// only started when the first view is added.
 class DeltaProducer final {
  public:
   // Returns a pointer to the singleton DeltaProducer.
   static DeltaProducer* Get();
 
-  // Adds a new Measure.
-  void AddMeasure();
+  // Adds 'num_measures' new Measures.
+  void AddMeasures(int num_measures = 1)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
 
   // Adds a new BucketBoundaries for the measure 'index' if it does not already
-  // exist.
-  void AddBoundaries(uint64_t index, const BucketBoundaries& boundaries);
+  // exist, applying from the next delta.
+  void AddBoundaries(uint64_t index, const BucketBoundaries& boundaries)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Ensures that the measure 'index' tracks an ExponentialHistogram with at
+  // least 'max_buckets' buckets, applying from the next delta if the
+  // configuration changes.
+  void AddExponentialHistogram(uint64_t index, int max_buckets)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Count a view of the measure 'index' with 'columns' being added or
+  // removed. Data for the measure is recorded only while it has views, and
+  // only under the tags used as columns by some view.
+  //
+  // AddView() must be called after any AddBoundaries() or
+  // AddExponentialHistogram() for the view. It returns the sequence number of
+  // the last delta that may have been recorded without the measure's current
+  // configuration or columns; the view must only merge later deltas.
+  uint64_t AddView(uint64_t index,
+                   const std::vector<opencensus::tags::TagKey>& columns)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+  void RemoveView(uint64_t index,
+                  const std::vector<opencensus::tags::TagKey>& columns)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Stops recording the measure 'index' as if it had no views, or resumes if
+  // 'disabled' is false, applying from the next delta. Its views remain
+  // counted.
+  void SetMeasureDisabled(uint64_t index, bool disabled)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Keeps only 1 in 'one_in' recordings of the measure 'index' (all of them if
+  // 'one_in' is at most 1), applying from the next delta, whose configuration
+  // has the rate so that merges scale the data back up. Recording threads
+  // may briefly sample at the previous rate.
+  void SetMeasureSampling(uint64_t index, uint32_t one_in)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Returns 'measurements' less those skipped by the sampling of their
+  // measures, for callers to skip work (e.g. reading the tags from the
+  // context) before Record(), which records whatever it is passed. The kept
+  // measurements are copied into '*kept' only if any are skipped.
+  absl::Span<const Measurement> Sample(
+      absl::Span<const Measurement> measurements,
+      std::vector<Measurement>* kept) const {
+    return sampling_.Sample(measurements, kept);
+  }
+  // Returns whether to record the next measurement of the measure 'index', as
+  // Sample() would for it alone.
+  bool KeepRecording(uint64_t index) const { return sampling_.Keep(index); }
 
-  void Record(std::initializer_list<Measurement> measurements,
-              opencensus::tags::TagMap tags) LOCKS_EXCLUDED(delta_mu_);
+  // If 'attachment' is not null, the values recorded become exemplars. 'tags'
+  // is copied only if it adds a row to the delta.
+  void Record(absl::Span<const Measurement> measurements,
+              const opencensus::tags::TagMap& tags,
+              const ExemplarAttachment* attachment = nullptr);
+
+  // Records each element of 'batch' under its TagMap, acquiring the delta only
+  // once.
+  void RecordBatch(
+      absl::Span<const std::pair<opencensus::tags::TagMap,
+                                 std::vector<Measurement>>>
+          batch);
+
+  // Records 'batch' with the active delta's configuration into a delta per
+  // quarter second, each merged directly into the StatsManager as of that
+  // time, bypassing the shards and the harvest queue.
+  void RecordBatchAt(absl::Span<const TimedMeasurements> batch)
+      LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Records under bound->tags(), using and updating bound's cached row for the
+  // calling thread's shard.
+  void Record(absl::Span<const Measurement> measurements,
+              BoundTags* bound,
+              const ExemplarAttachment* attachment = nullptr);
+
+  // Registers 'cells', whose values are moved into the active delta whenever
+  // it is swapped, until RemoveCounter(), which moves any remaining values.
+  void AddCounter(CounterCells* cells) LOCKS_EXCLUDED(delta_mu_);
+  void RemoveCounter(CounterCells* cells) LOCKS_EXCLUDED(delta_mu_);
+
+  // Adds 'value' to the calling thread's shard of 'cells'.
+  void AddToCounter(CounterCells* cells, int64_t value) {
+    if (sampling_.Keep(cells->measure_index())) {
+      cells->Add(ShardIndex(), value);
+    }
+  }
 
-  // Flushes the active delta and blocks until it is harvested.
+  // While 'shared' is set (it may be null), harvested deltas, including
+  // self-metrics, are published to it instead of being merged into this
+  // process's views. 'shared' must outlive its use.
+  void PublishTo(SharedDeltas* shared) LOCKS_EXCLUDED(harvester_mu_);
+  // While 'shared' is set (it may be null), each harvest drains it into the
+  // delta being swapped out, so its data is merged into this process's views
+  // like data recorded here. 'shared' must outlive its use.
+  void CollectFrom(SharedDeltas* shared) LOCKS_EXCLUDED(delta_mu_);
+
+  // Records into a separate delta holding the library's own metrics (see
+  // self_stats.h). It is harvested with the active delta, but does not trigger
+  // harvests or count as recorded data for HarvestParams::max_idle_interval.
+  void RecordSelf(absl::Span<const Measurement> measurements,
+                  const opencensus::tags::TagMap& tags);
+
+  // Returns true if any of 'measurements' is of a measure with views, for
+  // callers to skip work (e.g. reading the tags from the context) before
+  // Record(), which checks again. May briefly lag AddView() and RemoveView().
+  bool AnyHasViews(absl::Span<const Measurement> measurements) const {
+    return active_measures_.ContainsAny(measurements);
+  }
+
+  // Returns the number of shards of the active delta.
+  size_t num_shards() const { return shards_.size(); }
+
+  // Flushes the active delta and blocks until it is harvested. In the
+  // scheduler's manual mode, harvests on the calling thread.
   void Flush() LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
 
+  // Also reserves the active delta and the buffers kept for reuse for
+  // params.expected_tag_sets, divided among the shards.
+  void SetHarvestParams(const HarvestParams& params)
+      LOCKS_EXCLUDED(harvester_mu_);
+
+  // Adds an empty row for each of 'tag_sets' to every shard of the active
+  // delta (see StatsConfig::PrewarmTagSets()).
+  void PrewarmTagSets(absl::Span<const opencensus::tags::TagMap> tag_sets);
+
+  // Multiplies HarvestParams::interval and max_idle_interval by 'scale' (at
+  // least 1), e.g. to harvest less often under overload.
+  void SetHarvestIntervalScale(int scale) LOCKS_EXCLUDED(harvester_mu_);
+
+  // Returns the tag sets and approximate bytes of the active delta (including
+  // self-metrics) and of the buffers kept for reuse from merged deltas, whose
+  // rows are kept between harvests. Buffers queued for merging are not
+  // counted.
+  void GetMemoryUsage(StatsMemoryUsage::Delta* active,
+                      StatsMemoryUsage::Delta* last) const
+      LOCKS_EXCLUDED(harvester_mu_);
+
+  // For the stats fork handler (see stats_fork_handler.h). The child discards
+  // the active and queued deltas.
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+
  private:
   DeltaProducer();
 
-  // Flushing has two stages: swapping active_delta_ to last_delta_ and
-  // consuming last_delta_. Callers should release delta_mu_ before calling
-  // ConsumeLastDelta so that Record() is blocked for as little time as
-  // possible. SwapDeltas should never be called without then calling
-  // ConsumeLastDelta--otherwise the delta will be lost.
-  void SwapDeltas() EXCLUSIVE_LOCKS_REQUIRED(delta_mu_, harvester_mu_);
-  void ConsumeLastDelta() EXCLUSIVE_LOCKS_REQUIRED(harvester_mu_)
-      LOCKS_EXCLUDED(delta_mu_);
-
-  // Loops flushing the active delta (calling SwapDeltas and ConsumeLastDelta())
-  // every harvest_interval_.
-  void RunHarvesterLoop();
-
-  const absl::Duration harvest_interval_ = absl::Seconds(5);
-
-  // Guards the active delta and its configuration. Anything that changes the
-  // delta configuration (e.g. adding a measure or BucketBoundaries) must
-  // acquire delta_mu_, update configuration, and call SwapDeltas() before
-  // releasing delta_mu_ to prevent Record() from accessing the delta with
-  // mismatched configuration.
+  // A shard of the active delta. Shards are individually heap-allocated, and
+  // padded by a cache line on both sides since allocations are packed back to
+  // back, so that their mutexes do not share cache lines.
+  struct Shard {
+    char pad0[64];
+    absl::Mutex mu;
+    Delta delta GUARDED_BY(mu);
+    // Incremented whenever delta is swapped, invalidating BoundTags caches.
+    uint64_t generation GUARDED_BY(mu) = 1;
+    char pad1[64];
+  };
+
+  static std::vector<std::unique_ptr<Shard>> MakeShards();
+
+  // Returns the index of the shard the calling thread records into.
+  size_t ShardIndex() const;
+
+  // The rows to reserve in each shard's delta for
+  // harvest_params_.expected_tag_sets.
+  size_t ExpectedTagSetsPerShard() const
+      EXCLUSIVE_LOCKS_REQUIRED(harvester_mu_);
+  // Reserves the shards' deltas in 'buffer'.
+  void ReserveBuffer(std::vector<Delta>* buffer)
+      EXCLUSIVE_LOCKS_REQUIRED(harvester_mu_);
+
+  // Replaces config_ with a copy for modification, which is published to the
+  // deltas by the next SwapDeltas(). Since the boundaries are shared, the copy
+  // is shallow.
+  DeltaConfig* MutableConfig() EXCLUSIVE_LOCKS_REQUIRED(delta_mu_);
+  // Rebuilds the configuration's columns from num_views_by_column_.
+  void UpdateColumns() EXCLUSIVE_LOCKS_REQUIRED(delta_mu_);
+
+  // Adds the harvest task, on the first view.
+  void StartHarvesting() EXCLUSIVE_LOCKS_REQUIRED(delta_mu_)
+      LOCKS_EXCLUDED(harvester_mu_);
+  void WakeHarvestTask();
+
+  // Accounts for 'num_added' new tag sets in the active delta, requesting an
+  // early harvest if that crosses harvest_params_.max_pending_tag_sets.
+  void AddPendingTagSets(size_t num_added) LOCKS_EXCLUDED(harvester_mu_);
+
+  // Flushing has two stages: swapping the active shards into a buffer queued
+  // for merging, and consuming queued buffers in the harvest task.
+  //
+  // SwapDeltas() swaps the active shards into a free buffer (allocating one if
+  // all pre-allocated buffers are queued) and returns the sequence number of
+  // the queued delta. It never waits for merges. Before harvesting starts, the
+  // shards (which hold no data) are reset in place instead.
+  uint64_t SwapDeltas() EXCLUSIVE_LOCKS_REQUIRED(delta_mu_)
+      LOCKS_EXCLUDED(harvester_mu_);
+  // Merges all queued buffers in order, passing each delta's sequence number
+  // to StatsManager::MergeDeltas(). Only called by the harvest task.
+  // Returns true if any data was consumed.
+  bool ConsumeQueuedDeltas() LOCKS_EXCLUDED(harvester_mu_);
+  // harvest_params_.interval and max_idle_interval, scaled by
+  // harvest_interval_scale_.
+  absl::Duration BaseHarvestInterval() const
+      EXCLUSIVE_LOCKS_REQUIRED(harvester_mu_) {
+    return harvest_params_.interval * harvest_interval_scale_;
+  }
+  absl::Duration MaxIdleHarvestInterval() const
+      EXCLUSIVE_LOCKS_REQUIRED(harvester_mu_) {
+    return harvest_params_.max_idle_interval * harvest_interval_scale_;
+  }
+
+  // Blocks until the delta with 'sequence' has been consumed. In the
+  // scheduler's manual mode, runs the harvest task on the calling thread.
+  void WaitForConsumed(uint64_t sequence) LOCKS_EXCLUDED(harvester_mu_);
+  // absl::Condition predicate for WaitForConsumed(). Requires holding
+  // harvester_mu_.
+  static bool IsConsumed(
+      const std::pair<const DeltaProducer*, uint64_t>* producer_and_sequence)
+      NO_THREAD_SAFETY_ANALYSIS;
+
+  // The harvest task, run on the shared common::Scheduler: swaps the active
+  // delta when due as configured by harvest_params_ (or when requested), and
+  // consumes swapped deltas, being woken whenever one is queued. Returns the
+  // time of the next scheduled harvest.
+  absl::Time RunHarvest() LOCKS_EXCLUDED(delta_mu_, harvester_mu_);
+
+  // Guards the delta configuration. Anything that changes the delta
+  // configuration (e.g. adding a measure or BucketBoundaries) must acquire
+  // delta_mu_, update configuration, and call SwapDeltas() before releasing
+  // delta_mu_ to prevent Record() from accessing the delta with mismatched
+  // configuration. Changes that views depend on also record the returned
+  // sequence number in config_sequences_ or columns_sequence_.
   mutable absl::Mutex delta_mu_;
 
-  // The BucketBoundaries of each registered view with Distribution aggregation,
-  // by measure. Array indices in the outer array correspond to measure indices.
-  std::vector<std::vector<BucketBoundaries>> registered_boundaries_
+  // The configuration required by the registered views. Never null.
+  std::shared_ptr<const DeltaConfig> config_ GUARDED_BY(delta_mu_);
+  // The number of views of each measure.
+  std::vector<int> num_views_ GUARDED_BY(delta_mu_);
+  // Whether each measure is disabled (see SetMeasureDisabled()). A measure is
+  // recorded while it has views and is not disabled.
+  std::vector<bool> measures_disabled_ GUARDED_BY(delta_mu_);
+  // The sequence number of the last delta recorded before each measure's
+  // configuration last changed, and likewise before a column was last added.
+  std::vector<uint64_t> config_sequences_ GUARDED_BY(delta_mu_);
+  uint64_t columns_sequence_ GUARDED_BY(delta_mu_) = 0;
+  // The number of views using each tag key as a column, for the keys with a
+  // nonzero count.
+  std::map<opencensus::tags::TagKey, int> num_views_by_column_
       GUARDED_BY(delta_mu_);
-  Delta active_delta_ GUARDED_BY(delta_mu_);
+  bool harvesting_ GUARDED_BY(delta_mu_) = false;
+  // The registered BoundCounters' cells.
+  std::vector<CounterCells*> counters_ GUARDED_BY(delta_mu_);
+  // See CollectFrom().
+  SharedDeltas* collect_from_ GUARDED_BY(delta_mu_) = nullptr;
+
+  // The shards of the active delta. The vector itself is not modified after
+  // construction; each shard's delta is guarded by its own mutex, which is
+  // acquired after delta_mu_ and harvester_mu_.
+  const std::vector<std::unique_ptr<Shard>> shards_;
+  // Holds self-metrics, swapped with the shards into the last Delta of each
+  // buffer.
+  const std::unique_ptr<Shard> self_shard_;
 
-  // Guards the last_delta_; acquired by the main thread when triggering a
-  // flush.
+  // Guards the harvest configuration, the queue indices, and waits for
+  // consumption.
   mutable absl::Mutex harvester_mu_ ACQUIRED_AFTER(delta_mu_);
-  // TODO: consider making this a lockless queue to avoid blocking the main
-  // thread when calling a flush during harvesting.
-  Delta last_delta_ GUARDED_BY(harvester_mu_);
-  std::thread harvester_thread_ GUARDED_BY(harvester_mu_);
+  HarvestParams harvest_params_ GUARDED_BY(harvester_mu_);
+  // Set when the harvest task should harvest before the interval elapses.
+  bool harvest_requested_ GUARDED_BY(harvester_mu_) = false;
+  // Set when harvest_params_ changed since the harvest task last read it.
+  bool harvest_params_updated_ GUARDED_BY(harvester_mu_) = false;
+  // See SetHarvestIntervalScale().
+  int harvest_interval_scale_ GUARDED_BY(harvester_mu_) = 1;
+  // See PublishTo().
+  SharedDeltas* publish_to_ GUARDED_BY(harvester_mu_) = nullptr;
+
+  // Swapped-out deltas queued for merging, oldest first, each holding one Delta
+  // per shard followed by that of self_shard_. The front buffer is accessed by
+  // the harvest task without holding harvester_mu_ while it is merged
+  // (which is safe since pushing to a deque does not invalidate references);
+  // other buffers are only accessed while holding harvester_mu_.
+  std::deque<std::vector<Delta>> queue_ GUARDED_BY(harvester_mu_);
+  // Cleared buffers ready for reuse.
+  std::vector<std::vector<Delta>> free_buffers_ GUARDED_BY(harvester_mu_);
+  // The sequence number of the most recently consumed delta.
+  uint64_t consumed_sequence_ GUARDED_BY(harvester_mu_) = 0;
+  // The sequence number of the most recently queued delta.
+  uint64_t queued_sequence_ GUARDED_BY(harvester_mu_) = 0;
+
+  // Copy of harvest_params_.max_pending_tag_sets for recording threads.
+  std::atomic<uint64_t> max_pending_tag_sets_{0};
+  // The number of tag sets in the active delta, summed over shards.
+  std::atomic<uint64_t> pending_tag_sets_{0};
+  // The measures with views, as of the last AddView() or RemoveView(). Each
+  // delta's configuration says what it records; this only lets recording
+  // threads skip measurements early.
+  ActiveMeasures active_measures_;
+  // The sampling rate of each measure, as of the last SetMeasureSampling().
+  MeasureSampling sampling_;
+
+  // Only accessed by the harvest task, except for initialization by
+  // StartHarvesting().
+  absl::Time last_harvest_time_;
+  absl::Duration harvest_interval_;
+  // The id of the harvest task, or 0 before StartHarvesting().
+  std::atomic<uint64_t> harvest_task_{0};
 };
 
 }  // namespace stats
@@ -0,0 +1,130 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/distinct_count_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// Hashes 'value' with 64-bit FNV-1a followed by the SplitMix64 finalizer, which
+// spreads FNV's weak high bits over all 64. Unlike absl::Hash, the result is
+// the same in every process, so that sketches can be merged across processes.
+uint64_t Hash(absl::string_view value) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char c : value) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+  return hash ^ (hash >> 31);
+}
+
+// Returns the number of leading zeros of 'x', which is not 0.
+int LeadingZeros(uint64_t x) {
+  int zeros = 0;
+  for (uint64_t bit = uint64_t{1} << 63; (x & bit) == 0; bit >>= 1) {
+    ++zeros;
+  }
+  return zeros;
+}
+
+}  // namespace
+
+constexpr int DistinctCountSketch::kMinPrecision;
+constexpr int DistinctCountSketch::kMaxPrecision;
+
+DistinctCountSketch::DistinctCountSketch(int precision)
+    : precision_(std::max(kMinPrecision, std::min(kMaxPrecision, precision))),
+      registers_(size_t{1} << precision_, 0),
+      inverse_sum_(registers_.size()),
+      zero_registers_(registers_.size()) {}
+
+void DistinctCountSketch::Add(absl::string_view value) {
+  const uint64_t hash = Hash(value);
+  const size_t index = hash >> (64 - precision_);
+  // The remaining bits, with a sentinel bit so that the rank is bounded.
+  const uint64_t rest =
+      (hash << precision_) | (uint64_t{1} << (precision_ - 1));
+  const uint8_t rank = LeadingZeros(rest) + 1;
+  uint8_t& reg = registers_[index];
+  if (rank <= reg) {
+    return;
+  }
+  if (reg == 0) {
+    --zero_registers_;
+  }
+  inverse_sum_ += std::ldexp(1.0, -rank) - std::ldexp(1.0, -reg);
+  reg = rank;
+}
+
+void DistinctCountSketch::Merge(const DistinctCountSketch& other) {
+  ABSL_ASSERT(other.precision_ == precision_);
+  if (other.precision_ != precision_) {
+    return;
+  }
+  for (size_t i = 0; i < registers_.size(); ++i) {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+  UpdateSums();
+}
+
+int64_t DistinctCountSketch::Estimate() const {
+  const double m = registers_.size();
+  double alpha;
+  switch (precision_) {
+    case 4:
+      alpha = 0.673;
+      break;
+    case 5:
+      alpha = 0.697;
+      break;
+    case 6:
+      alpha = 0.709;
+      break;
+    default:
+      alpha = 0.7213 / (1 + 1.079 / m);
+  }
+  double estimate = alpha * m * m / inverse_sum_;
+  // Use linear counting for small cardinalities, where it is more accurate.
+  if (estimate <= 2.5 * m && zero_registers_ > 0) {
+    estimate = m * std::log(m / zero_registers_);
+  }
+  return std::llround(estimate);
+}
+
+void DistinctCountSketch::UpdateSums() {
+  inverse_sum_ = 0;
+  zero_registers_ = 0;
+  for (const uint8_t reg : registers_) {
+    inverse_sum_ += std::ldexp(1.0, -reg);
+    if (reg == 0) {
+      ++zero_registers_;
+    }
+  }
+}
+
+}  // namespace stats
+}  // namespace opencensus
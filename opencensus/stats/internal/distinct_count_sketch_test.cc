@@ -0,0 +1,77 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/distinct_count_sketch.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+TEST(DistinctCountSketchTest, Empty) {
+  DistinctCountSketch sketch(12);
+  EXPECT_EQ(12, sketch.precision());
+  EXPECT_EQ(0, sketch.Estimate());
+}
+
+TEST(DistinctCountSketchTest, ClampsPrecision) {
+  EXPECT_EQ(DistinctCountSketch::kMinPrecision,
+            DistinctCountSketch(0).precision());
+  EXPECT_EQ(DistinctCountSketch::kMaxPrecision,
+            DistinctCountSketch(64).precision());
+}
+
+TEST(DistinctCountSketchTest, SmallCountsAreExact) {
+  DistinctCountSketch sketch(12);
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    for (int i = 0; i < 10; ++i) {
+      sketch.Add(absl::StrCat("user", i));
+    }
+  }
+  EXPECT_EQ(10, sketch.Estimate());
+}
+
+TEST(DistinctCountSketchTest, LargeCounts) {
+  for (const int64_t count : {1000, 100000, 1000000}) {
+    DistinctCountSketch sketch(12);
+    for (int64_t i = 0; i < count; ++i) {
+      sketch.Add(absl::StrCat("user", i));
+    }
+    // Within four standard errors.
+    EXPECT_NEAR(count, sketch.Estimate(), 4 * 0.0163 * count) << count;
+  }
+}
+
+TEST(DistinctCountSketchTest, Merge) {
+  DistinctCountSketch a(10);
+  DistinctCountSketch b(10);
+  DistinctCountSketch both(10);
+  for (int i = 0; i < 20000; ++i) {
+    const std::string value = absl::StrCat(i);
+    (i % 2 == 0 ? a : b).Add(value);
+    if (i % 4 == 0) b.Add(value);
+    both.Add(value);
+  }
+  a.Merge(b);
+  EXPECT_NEAR(both.Estimate(), a.Estimate(), 1);
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/internal/bucket_counts.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// The histogram merge loop, as run for each row of a Distribution view at each
+// harvest, for state.range(0) buckets.
+void BM_AddBucketCountsToUint64(benchmark::State& state) {
+  const std::vector<int64_t> src(state.range(0), 3);
+  std::vector<uint64_t> dst(state.range(0));
+  for (auto _ : state) {
+    AddBucketCounts(src, absl::MakeSpan(dst));
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBucketCountsToUint64)->Range(8, 512);
+
+void BM_AddBucketCountsToDouble(benchmark::State& state) {
+  const std::vector<int64_t> src(state.range(0), 3);
+  std::vector<double> dst(state.range(0));
+  for (auto _ : state) {
+    AddBucketCounts(src, absl::MakeSpan(dst));
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBucketCountsToDouble)->Range(8, 512);
+
+// The scalar loop the kernels replace, for comparison.
+void BM_AddBucketCountsScalar(benchmark::State& state) {
+  const std::vector<int64_t> src(state.range(0), 3);
+  std::vector<uint64_t> dst(state.range(0));
+  for (auto _ : state) {
+    for (size_t i = 0; i < src.size(); ++i) {
+      dst[i] += src[i];
+    }
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddBucketCountsScalar)->Range(8, 512);
+
+// Merges MeasureData with a 50-bucket histogram into state.range(0) rows'
+// Distributions, as a harvest of a view with that many rows does.
+void BM_MergeDistributionRows(benchmark::State& state) {
+  const std::vector<BucketBoundaries> boundaries = {
+      BucketBoundaries::Exponential(50, 1, 1.2)};
+  MeasureData data(boundaries);
+  for (int i = 0; i < 1000; ++i) {
+    data.Add(i);
+  }
+  std::vector<Distribution> rows;
+  rows.reserve(state.range(0));
+  for (int i = 0; i < state.range(0); ++i) {
+    rows.push_back(testing::TestUtils::MakeDistribution(&boundaries.front()));
+  }
+  for (auto _ : state) {
+    for (Distribution& row : rows) {
+      data.AddToDistribution(&row);
+    }
+  }
+  benchmark::DoNotOptimize(rows.data());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MergeDistributionRows)->Range(1, 1 << 14);
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,253 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/exponential_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+
+namespace opencensus {
+namespace stats {
+
+constexpr int ExponentialHistogram::kMaxScale;
+constexpr int ExponentialHistogram::kMinScale;
+
+namespace {
+
+// Returns floor(value / 2^shift), without relying on the implementation-defined
+// behavior of right-shifting negative numbers.
+int FloorShift(int value, int shift) {
+  return value >= 0 ? value >> shift : ~(~value >> shift);
+}
+
+// Returns the index of the bucket containing 'magnitude' (which must be
+// positive) at 'scale': floor(log2(magnitude) * 2^scale). At non-positive
+// scales this uses only the binary exponent.
+int BucketIndex(double magnitude, int scale) {
+  int exponent;
+  // magnitude = fraction * 2^exponent, with fraction in [0.5, 1). Infinity is
+  // placed in the bucket of the largest finite value.
+  const double fraction = std::frexp(
+      std::min(magnitude, std::numeric_limits<double>::max()), &exponent);
+  --exponent;
+  if (scale <= 0) {
+    return FloorShift(exponent, -scale);
+  }
+  const int sub_buckets = 1 << scale;
+  const int sub_bucket =
+      static_cast<int>(std::log2(2 * fraction) * sub_buckets);
+  return exponent * sub_buckets +
+         std::min(std::max(sub_bucket, 0), sub_buckets - 1);
+}
+
+// Merges the buckets of 'buckets' by a factor of 2^delta, in place.
+void DownscaleBuckets(int delta, ExponentialHistogram::Buckets* buckets) {
+  if (buckets->counts.empty()) {
+    return;
+  }
+  const int old_offset = buckets->offset;
+  const int new_offset = FloorShift(old_offset, delta);
+  const int size = buckets->counts.size();
+  // Each new index is no greater than the old index it is merged from, so
+  // merging in increasing order never overwrites unmerged counts.
+  for (int k = 1; k < size; ++k) {
+    const int j = FloorShift(old_offset + k, delta) - new_offset;
+    if (j != k) {
+      buckets->counts[j] += buckets->counts[k];
+      buckets->counts[k] = 0;
+    }
+  }
+  buckets->counts.resize(FloorShift(old_offset + size - 1, delta) - new_offset +
+                         1);
+  buckets->offset = new_offset;
+}
+
+}  // namespace
+
+ExponentialHistogram::ExponentialHistogram(int max_buckets)
+    : max_buckets_(std::max(max_buckets, 2)) {}
+
+double ExponentialHistogram::base() const {
+  return std::exp2(std::ldexp(1.0, -scale_));
+}
+
+double ExponentialHistogram::LowerBound(int index) const {
+  return std::exp2(std::ldexp(static_cast<double>(index), -scale_));
+}
+
+double ExponentialHistogram::Quantile(double q) const {
+  if (count_ == 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  // The extremes are tracked exactly.
+  if (q <= 0) {
+    return min_;
+  }
+  if (q >= 1) {
+    return max_;
+  }
+  // The midpoint of a bucket in relative terms: the estimate for values in
+  // [lower, lower * base) is 2 * lower * base / (1 + base).
+  const double b = base();
+  const double midpoint_factor = 2 * b / (1 + b);
+  const double rank = q * (count_ - 1);
+  uint64_t seen = 0;
+  double estimate = max_;
+  bool found = false;
+  // Negative values, from the most negative.
+  for (int k = static_cast<int>(negative_.counts.size()) - 1; k >= 0 && !found;
+       --k) {
+    seen += negative_.counts[k];
+    if (rank < seen) {
+      estimate = -LowerBound(negative_.offset + k) * midpoint_factor;
+      found = true;
+    }
+  }
+  if (!found) {
+    seen += zero_count_;
+    if (rank < seen) {
+      estimate = 0;
+      found = true;
+    }
+  }
+  for (size_t k = 0; k < positive_.counts.size() && !found; ++k) {
+    seen += positive_.counts[k];
+    if (rank < seen) {
+      estimate =
+          LowerBound(positive_.offset + static_cast<int>(k)) * midpoint_factor;
+      found = true;
+    }
+  }
+  return std::min(std::max(estimate, min_), max_);
+}
+
+void ExponentialHistogram::Add(double value, uint64_t count) {
+  count_ += count;
+  sum_ += value * count;
+  min_ = std::min(value, min_);
+  max_ = std::max(value, max_);
+  if (value > 0) {
+    AddToBuckets(BucketIndex(value, scale_), count, &positive_);
+  } else if (value < 0) {
+    AddToBuckets(BucketIndex(-value, scale_), count, &negative_);
+  } else {
+    zero_count_ += count;
+  }
+}
+
+void ExponentialHistogram::Merge(const ExponentialHistogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  zero_count_ += other.zero_count_;
+  if (other.scale_ < scale_) {
+    Downscale(scale_ - other.scale_);
+  }
+  const std::pair<const Buckets*, Buckets*> ranges[] = {
+      {&other.positive_, &positive_}, {&other.negative_, &negative_}};
+  for (const auto& range : ranges) {
+    const Buckets& source = *range.first;
+    for (size_t k = 0; k < source.counts.size(); ++k) {
+      if (source.counts[k] != 0) {
+        // scale_ may decrease while adding, so the shift is recomputed.
+        const int index = source.offset + static_cast<int>(k);
+        AddToBuckets(FloorShift(index, other.scale_ - scale_),
+                     source.counts[k], range.second);
+      }
+    }
+  }
+}
+
+void ExponentialHistogram::Reset() {
+  scale_ = kMaxScale;
+  count_ = 0;
+  sum_ = 0;
+  min_ = std::numeric_limits<double>::infinity();
+  max_ = -std::numeric_limits<double>::infinity();
+  zero_count_ = 0;
+  positive_.counts.clear();
+  negative_.counts.clear();
+}
+
+void ExponentialHistogram::Scale(uint64_t factor) {
+  count_ *= factor;
+  sum_ *= factor;
+  zero_count_ *= factor;
+  for (uint64_t& count : positive_.counts) {
+    count *= factor;
+  }
+  for (uint64_t& count : negative_.counts) {
+    count *= factor;
+  }
+}
+
+void ExponentialHistogram::AddToBuckets(int index, uint64_t count,
+                                        Buckets* buckets) {
+  if (buckets->counts.empty()) {
+    buckets->offset = index;
+    buckets->counts.push_back(count);
+    return;
+  }
+  const int low = std::min(index, buckets->offset);
+  const int high = std::max(
+      index, buckets->offset + static_cast<int>(buckets->counts.size()) - 1);
+  int delta = 0;
+  while (static_cast<int64_t>(FloorShift(high, delta)) -
+             FloorShift(low, delta) + 1 >
+         max_buckets_) {
+    ++delta;
+  }
+  if (delta > 0) {
+    Downscale(delta);
+    index = FloorShift(index, delta);
+  }
+  if (index < buckets->offset) {
+    buckets->counts.insert(buckets->counts.begin(), buckets->offset - index, 0);
+    buckets->offset = index;
+  } else if (static_cast<size_t>(index - buckets->offset) >=
+             buckets->counts.size()) {
+    buckets->counts.resize(index - buckets->offset + 1);
+  }
+  buckets->counts[index - buckets->offset] += count;
+}
+
+void ExponentialHistogram::Downscale(int delta) {
+  delta = std::min(delta, scale_ - kMinScale);
+  DownscaleBuckets(delta, &positive_);
+  DownscaleBuckets(delta, &negative_);
+  scale_ -= delta;
+}
+
+std::string ExponentialHistogram::DebugString() const {
+  return absl::StrCat(
+      "count: ", count_, " sum: ", sum_, " min: ", min_, " max: ", max_,
+      " scale: ", scale_, " zero count: ", zero_count_,
+      "\npositive buckets from index ", positive_.offset, ": ",
+      absl::StrJoin(positive_.counts, ", "), "\nnegative buckets from index ",
+      negative_.offset, ": ", absl::StrJoin(negative_.counts, ", "));
+}
+
+}  // namespace stats
+}  // namespace opencensus
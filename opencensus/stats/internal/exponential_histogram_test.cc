@@ -0,0 +1,202 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/exponential_histogram.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+uint64_t TotalCount(const ExponentialHistogram::Buckets& buckets) {
+  return std::accumulate(buckets.counts.begin(), buckets.counts.end(),
+                         uint64_t{0});
+}
+
+TEST(ExponentialHistogramTest, Empty) {
+  const ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(10);
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(10, histogram.max_buckets());
+  EXPECT_EQ(ExponentialHistogram::kMaxScale, histogram.scale());
+  EXPECT_TRUE(histogram.positive_buckets().counts.empty());
+  EXPECT_TRUE(histogram.negative_buckets().counts.empty());
+}
+
+TEST(ExponentialHistogramTest, Statistics) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(10);
+  testing::TestUtils::AddToExponentialHistogram(&histogram, 3);
+  testing::TestUtils::AddToExponentialHistogram(&histogram, 0);
+  testing::TestUtils::AddToExponentialHistogram(&histogram, -2);
+  EXPECT_EQ(3, histogram.count());
+  EXPECT_DOUBLE_EQ(1, histogram.sum());
+  EXPECT_DOUBLE_EQ(-2, histogram.min());
+  EXPECT_DOUBLE_EQ(3, histogram.max());
+  EXPECT_EQ(1, histogram.zero_count());
+  EXPECT_EQ(1, TotalCount(histogram.positive_buckets()));
+  EXPECT_EQ(1, TotalCount(histogram.negative_buckets()));
+}
+
+TEST(ExponentialHistogramTest, BucketContainsValue) {
+  for (const double value : {1e-300, 0.001, 0.75, 1.0, 1.5, 2.0, 3.0, 1e10,
+                             std::numeric_limits<double>::max()}) {
+    ExponentialHistogram histogram =
+        testing::TestUtils::MakeExponentialHistogram(10);
+    testing::TestUtils::AddToExponentialHistogram(&histogram, value);
+    testing::TestUtils::AddToExponentialHistogram(&histogram, -value);
+    for (const auto* buckets :
+         {&histogram.positive_buckets(), &histogram.negative_buckets()}) {
+      ASSERT_EQ(1, buckets->counts.size());
+      // LowerBound() is computed with exp2, which is not exact.
+      EXPECT_LE(histogram.LowerBound(buckets->offset), value * (1 + 1e-12))
+          << value;
+      EXPECT_GT(histogram.LowerBound(buckets->offset + 1), value * (1 - 1e-12))
+          << value;
+    }
+  }
+}
+
+TEST(ExponentialHistogramTest, DownscalesToFit) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(4);
+  for (const double value : {1, 2, 3, 4}) {
+    testing::TestUtils::AddToExponentialHistogram(&histogram, value);
+  }
+  // At scale 1 the values are in buckets 0, 2, 3, and 4, which do not fit.
+  EXPECT_EQ(0, histogram.scale());
+  EXPECT_DOUBLE_EQ(2, histogram.base());
+  EXPECT_EQ(0, histogram.positive_buckets().offset);
+  EXPECT_THAT(histogram.positive_buckets().counts,
+              ::testing::ElementsAre(1, 2, 1));
+}
+
+TEST(ExponentialHistogramTest, WideRange) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(20);
+  for (int i = 0; i < 1000; ++i) {
+    testing::TestUtils::AddToExponentialHistogram(&histogram,
+                                                  std::pow(1.1, i - 500));
+  }
+  EXPECT_LE(histogram.positive_buckets().counts.size(), 20);
+  EXPECT_EQ(1000, TotalCount(histogram.positive_buckets()));
+  const auto& buckets = histogram.positive_buckets();
+  EXPECT_LE(histogram.LowerBound(buckets.offset), std::pow(1.1, -500));
+  EXPECT_GT(histogram.LowerBound(buckets.offset + buckets.counts.size()),
+            std::pow(1.1, 499));
+}
+
+TEST(ExponentialHistogramTest, InfinityAndNaN) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(10);
+  testing::TestUtils::AddToExponentialHistogram(
+      &histogram, std::numeric_limits<double>::infinity());
+  testing::TestUtils::AddToExponentialHistogram(
+      &histogram, std::numeric_limits<double>::quiet_NaN());
+  EXPECT_EQ(2, histogram.count());
+  EXPECT_EQ(1, TotalCount(histogram.positive_buckets()));
+  EXPECT_EQ(1, histogram.zero_count());
+}
+
+TEST(ExponentialHistogramTest, Quantile) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(160);
+  EXPECT_TRUE(std::isnan(histogram.Quantile(0.5)));
+  for (int i = 1; i <= 10000; ++i) {
+    testing::TestUtils::AddToExponentialHistogram(&histogram, i);
+  }
+  const double b = histogram.base();
+  const double relative_error = (b - 1) / (b + 1);
+  EXPECT_LT(relative_error, 0.05);
+  for (const double q : {0.01, 0.5, 0.9, 0.99, 0.999}) {
+    const double expected = 1 + q * 9999;
+    EXPECT_NEAR(expected, histogram.Quantile(q),
+                expected * relative_error + 1)
+        << q;
+  }
+  EXPECT_EQ(1, histogram.Quantile(0));
+  EXPECT_EQ(10000, histogram.Quantile(1));
+  EXPECT_EQ(10000, histogram.Quantile(2));
+}
+
+TEST(ExponentialHistogramTest, QuantileWithNegativesAndZeros) {
+  ExponentialHistogram histogram =
+      testing::TestUtils::MakeExponentialHistogram(160);
+  for (const double value : {-100, -10, 0, 0, 10, 100}) {
+    testing::TestUtils::AddToExponentialHistogram(&histogram, value);
+  }
+  const double b = histogram.base();
+  const double relative_error = (b - 1) / (b + 1);
+  EXPECT_EQ(-100, histogram.Quantile(0));
+  EXPECT_NEAR(-10, histogram.Quantile(0.2), 10 * relative_error);
+  EXPECT_EQ(0, histogram.Quantile(0.5));
+  EXPECT_NEAR(10, histogram.Quantile(0.8), 10 * relative_error);
+  EXPECT_EQ(100, histogram.Quantile(1));
+}
+
+TEST(ExponentialHistogramTest, MergeMatchesDirectAdds) {
+  ExponentialHistogram low = testing::TestUtils::MakeExponentialHistogram(16);
+  ExponentialHistogram high = testing::TestUtils::MakeExponentialHistogram(16);
+  ExponentialHistogram all = testing::TestUtils::MakeExponentialHistogram(16);
+  for (int i = 1; i <= 10; ++i) {
+    testing::TestUtils::AddToExponentialHistogram(&low, i);
+    testing::TestUtils::AddToExponentialHistogram(&low, -i);
+    testing::TestUtils::AddToExponentialHistogram(&all, i);
+    testing::TestUtils::AddToExponentialHistogram(&all, -i);
+  }
+  for (int i = 1000; i <= 1010; ++i) {
+    testing::TestUtils::AddToExponentialHistogram(&high, i);
+    testing::TestUtils::AddToExponentialHistogram(&all, i);
+  }
+  ExponentialHistogram merged =
+      testing::TestUtils::MakeExponentialHistogram(16);
+  testing::TestUtils::MergeExponentialHistogram(low, &merged);
+  testing::TestUtils::MergeExponentialHistogram(high, &merged);
+
+  EXPECT_EQ(all.count(), merged.count());
+  EXPECT_DOUBLE_EQ(all.sum(), merged.sum());
+  EXPECT_EQ(all.min(), merged.min());
+  EXPECT_EQ(all.max(), merged.max());
+  EXPECT_EQ(all.scale(), merged.scale());
+  EXPECT_EQ(all.positive_buckets().offset, merged.positive_buckets().offset);
+  EXPECT_EQ(all.positive_buckets().counts, merged.positive_buckets().counts);
+  EXPECT_EQ(all.negative_buckets().offset, merged.negative_buckets().offset);
+  EXPECT_EQ(all.negative_buckets().counts, merged.negative_buckets().counts);
+}
+
+TEST(ExponentialHistogramTest, MergeIntoSmallerMaxBuckets) {
+  ExponentialHistogram source =
+      testing::TestUtils::MakeExponentialHistogram(100);
+  for (int i = 1; i <= 100; ++i) {
+    testing::TestUtils::AddToExponentialHistogram(&source, i);
+  }
+  ExponentialHistogram destination =
+      testing::TestUtils::MakeExponentialHistogram(5);
+  testing::TestUtils::MergeExponentialHistogram(source, &destination);
+  EXPECT_LT(destination.scale(), source.scale());
+  EXPECT_LE(destination.positive_buckets().counts.size(), 5);
+  EXPECT_EQ(100, TotalCount(destination.positive_buckets()));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,278 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/interval_buckets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace stats {
+
+constexpr int IntervalBuckets::kNumWindowBuckets;
+constexpr int IntervalBuckets::kNumSlots;
+
+namespace {
+
+int64_t UnixNanos(absl::Time time) {
+  return absl::ToInt64Nanoseconds(time - absl::UnixEpoch());
+}
+
+}  // namespace
+
+IntervalBuckets::IntervalBuckets(absl::Duration interval, absl::Time now)
+    : bucket_interval_nanos_(
+          absl::ToInt64Nanoseconds(BucketInterval(interval))) {
+  const int64_t now_nanos = UnixNanos(now);
+  const int64_t nanos_into_bucket = NanosIntoBucket(now_nanos);
+  current_bucket_start_nanos_ = now_nanos - nanos_into_bucket;
+  initial_bucket_fraction_filled_ =
+      1 - static_cast<double>(nanos_into_bucket) / bucket_interval_nanos_;
+}
+
+// static
+absl::Duration IntervalBuckets::BucketInterval(absl::Duration interval) {
+  return absl::Nanoseconds(absl::ToInt64Nanoseconds(
+      std::max(interval, absl::Seconds(1)) / kNumWindowBuckets));
+}
+
+// static
+bool IntervalBuckets::Nest(absl::Duration a, absl::Duration b) {
+  const int64_t a_nanos = absl::ToInt64Nanoseconds(BucketInterval(a));
+  const int64_t b_nanos = absl::ToInt64Nanoseconds(BucketInterval(b));
+  // Buckets are aligned to the epoch, so they nest if one interval divides
+  // the other.
+  return std::max(a_nanos, b_nanos) % std::min(a_nanos, b_nanos) == 0;
+}
+
+int IntervalBuckets::Advance(absl::Time now) {
+  const int64_t buckets_ahead = BucketsAhead(UnixNanos(now));
+  if (buckets_ahead == 0) {
+    return 0;
+  }
+  current_bucket_start_nanos_ += buckets_ahead * bucket_interval_nanos_;
+  current_slot_ = (current_slot_ + buckets_ahead % kNumSlots) % kNumSlots;
+  const int advanced = static_cast<int>(
+      std::min<int64_t>(buckets_ahead, kNumSlots));
+  buckets_advanced_ = std::min(kNumSlots, buckets_advanced_ + advanced);
+  if (buckets_advanced_ == kNumSlots) {
+    // The initial bucket's slot has been reused.
+    initial_bucket_fraction_filled_ = 1;
+  }
+  return advanced;
+}
+
+int IntervalBuckets::BucketsBehind(absl::Time time) const {
+  const int64_t time_nanos = UnixNanos(time);
+  if (time_nanos >= current_bucket_start_nanos_) {
+    return 0;
+  }
+  // Compared before subtracting, so that distant times cannot overflow.
+  if (time_nanos <
+      current_bucket_start_nanos_ - kNumSlots * bucket_interval_nanos_) {
+    return kNumSlots;
+  }
+  return static_cast<int>(
+      (current_bucket_start_nanos_ - time_nanos + bucket_interval_nanos_ - 1) /
+      bucket_interval_nanos_);
+}
+
+IntervalBuckets::Weights IntervalBuckets::SlotWeights(absl::Time now) const {
+  Weights weights;
+  weights.fill(0);
+  const int64_t now_nanos = UnixNanos(now);
+  const int64_t buckets_ahead = BucketsAhead(now_nanos);
+  if (buckets_ahead >= kNumSlots) {
+    return weights;
+  }
+  // The window ending at 'now' covers the buckets up to the current one in
+  // full, and part of the oldest.
+  const int num_full = kNumSlots - 1 - static_cast<int>(buckets_ahead);
+  for (int i = 0; i < num_full; ++i) {
+    weights[Slot(i)] = 1;
+  }
+  // Interpolate the part of the oldest bucket's interval that is still in the
+  // window, unless the oldest bucket was only partly filled to begin with.
+  const double requested_bucket_portion =
+      static_cast<double>(NanosIntoBucket(now_nanos)) / bucket_interval_nanos_;
+  weights[Slot(num_full)] = std::min(
+      1.0, (1 - requested_bucket_portion) / initial_bucket_fraction_filled_);
+  return weights;
+}
+
+int64_t IntervalBuckets::BucketsAhead(int64_t now_nanos) const {
+  if (now_nanos < current_bucket_start_nanos_) {
+    return 0;
+  }
+  return (now_nanos - current_bucket_start_nanos_) / bucket_interval_nanos_;
+}
+
+int64_t IntervalBuckets::NanosIntoBucket(int64_t now_nanos) const {
+  // Buckets are aligned to the epoch, so this is now_nanos modulo the
+  // interval, rounded towards negative infinity for times before the epoch.
+  const int64_t remainder = now_nanos % bucket_interval_nanos_;
+  return remainder < 0 ? remainder + bucket_interval_nanos_ : remainder;
+}
+
+IntervalRow::IntervalRow(int num_doubles, int num_counts, int num_levels)
+    : num_doubles_(num_doubles),
+      num_counts_(num_counts),
+      num_levels_(num_levels),
+      doubles_(num_slots() * num_doubles),
+      counts_(num_slots() * num_counts) {}
+
+void IntervalRow::Clear(int slot) {
+  const absl::Span<double> slot_doubles = doubles(slot);
+  std::fill(slot_doubles.begin(), slot_doubles.end(), 0);
+  const absl::Span<uint64_t> slot_counts = counts(slot);
+  std::fill(slot_counts.begin(), slot_counts.end(), 0);
+}
+
+void IntervalRow::Clear(int last_slot, int num_slots, int level) {
+  // The slots are [first_slot, last_slot], or if that range wraps below slot
+  // 0, [0, last_slot] and [first_slot + kNumSlots, kNumSlots), offset to the
+  // level's ring.
+  const int ring_begin = LevelSlot(level, 0);
+  const int ring_end = LevelSlot(level + 1, 0);
+  const int first_slot = last_slot + 1 - num_slots;
+  const int front_end = ring_begin + last_slot + 1;
+  const int front_begin = ring_begin + std::max(first_slot, 0);
+  const int back_begin =
+      ring_begin + (first_slot < 0 ? first_slot + IntervalBuckets::kNumSlots
+                                   : IntervalBuckets::kNumSlots);
+  std::fill(doubles_.begin() + front_begin * num_doubles_,
+            doubles_.begin() + front_end * num_doubles_, 0);
+  std::fill(doubles_.begin() + back_begin * num_doubles_,
+            doubles_.begin() + ring_end * num_doubles_, 0);
+  std::fill(counts_.begin() + front_begin * num_counts_,
+            counts_.begin() + front_end * num_counts_, 0);
+  std::fill(counts_.begin() + back_begin * num_counts_,
+            counts_.begin() + ring_end * num_counts_, 0);
+}
+
+void IntervalRow::InsertLevel(int level) {
+  const int slot = LevelSlot(level, 0);
+  doubles_.insert(doubles_.begin() + slot * num_doubles_,
+                  IntervalBuckets::kNumSlots * num_doubles_, 0);
+  counts_.insert(counts_.begin() + slot * num_counts_,
+                 IntervalBuckets::kNumSlots * num_counts_, 0);
+  ++num_levels_;
+}
+
+void IntervalRow::AddSlot(int from, int to) {
+  const absl::Span<const double> from_doubles = doubles(from);
+  const absl::Span<double> to_doubles = doubles(to);
+  for (int i = 0; i < num_doubles_; ++i) {
+    to_doubles[i] += from_doubles[i];
+  }
+  const absl::Span<const uint64_t> from_counts = counts(from);
+  const absl::Span<uint64_t> to_counts = counts(to);
+  for (int i = 0; i < num_counts_; ++i) {
+    to_counts[i] += from_counts[i];
+  }
+}
+
+void IntervalRow::AddDistributionSlot(int from, int to) {
+  const absl::Span<const uint64_t> from_counts = counts(from);
+  const absl::Span<uint64_t> to_counts = counts(to);
+  if (from_counts[0] == 0) {
+    return;
+  }
+  const absl::Span<const double> from_doubles = doubles(from);
+  const absl::Span<double> to_doubles = doubles(to);
+  if (to_counts[0] == 0) {
+    std::copy(from_doubles.begin(), from_doubles.end(), to_doubles.begin());
+  } else {
+    // Combine statistics using the parallel algorithm, as DistributionInto().
+    const double from_count = from_counts[0];
+    const double to_count = to_counts[0];
+    const double total_count = from_count + to_count;
+    const double delta = from_doubles[0] - to_doubles[0];
+    to_doubles[1] +=
+        from_doubles[1] + delta * delta * to_count * from_count / total_count;
+    to_doubles[0] += delta * from_count / total_count;
+    to_doubles[2] = std::min(to_doubles[2], from_doubles[2]);
+    to_doubles[3] = std::max(to_doubles[3], from_doubles[3]);
+  }
+  for (int i = 0; i < num_counts_; ++i) {
+    to_counts[i] += from_counts[i];
+  }
+}
+
+double IntervalRow::WeightedDouble(int index,
+                                   absl::Span<const double> weights) const {
+  double sum = 0;
+  for (int slot = 0; slot < num_slots(); ++slot) {
+    if (weights[slot] != 0) {
+      sum += weights[slot] * doubles(slot)[index];
+    }
+  }
+  return sum;
+}
+
+double IntervalRow::WeightedCount(int index,
+                                  absl::Span<const double> weights) const {
+  double sum = 0;
+  for (int slot = 0; slot < num_slots(); ++slot) {
+    if (weights[slot] != 0) {
+      sum += weights[slot] * counts(slot)[index];
+    }
+  }
+  return sum;
+}
+
+void IntervalRow::DistributionInto(
+    absl::Span<const double> weights, uint64_t* count, double* mean,
+    double* sum_of_squared_deviation, double* min, double* max,
+    absl::Span<uint64_t> histogram_buckets) const {
+  double total_count = 0;
+  *mean = 0;
+  *sum_of_squared_deviation = 0;
+  *min = std::numeric_limits<double>::infinity();
+  *max = -std::numeric_limits<double>::infinity();
+  std::fill(histogram_buckets.begin(), histogram_buckets.end(), 0);
+  for (int slot = 0; slot < num_slots(); ++slot) {
+    const absl::Span<const uint64_t> slot_counts = counts(slot);
+    // Skip empty slots, whose min and max are not meaningful.
+    if (weights[slot] == 0 || slot_counts[0] == 0) {
+      continue;
+    }
+    const absl::Span<const double> slot_doubles = doubles(slot);
+    // Combine statistics using the parallel algorithm.
+    const double slot_count = slot_counts[0] * weights[slot];
+    const double delta = slot_doubles[0] - *mean;
+    *sum_of_squared_deviation +=
+        slot_doubles[1] * weights[slot] +
+        delta * delta * total_count * slot_count / (total_count + slot_count);
+    *mean = (*mean * total_count + slot_doubles[0] * slot_count) /
+            (total_count + slot_count);
+    total_count += slot_count;
+    *min = std::min(*min, slot_doubles[2]);
+    *max = std::max(*max, slot_doubles[3]);
+    // Only slots holding the window's oldest bucket have a fractional weight,
+    // so rounding each slot's contribution is close to rounding the total.
+    for (int i = 0; i < histogram_buckets.size(); ++i) {
+      histogram_buckets[i] += std::llround(slot_counts[i + 1] * weights[slot]);
+    }
+  }
+  *count = std::llround(total_count);
+}
+
+}  // namespace stats
+}  // namespace opencensus
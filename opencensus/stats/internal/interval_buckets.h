@@ -0,0 +1,187 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_INTERVAL_BUCKETS_H_
+#define OPENCENSUS_STATS_INTERNAL_INTERVAL_BUCKETS_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace stats {
+
+// IntervalBuckets is the bucket clock shared by all rows of an interval view.
+// Like common::StatsObject, it divides the view's window into
+// kNumWindowBuckets buckets aligned to multiples of the bucket interval since
+// the Unix epoch, and keeps one bucket more than that so that reads can
+// interpolate the oldest bucket rather than sawtoothing with the bucket
+// period. Each row (an IntervalRow) stores the data of each bucket in a slot;
+// since all rows share the clock, advancing it is done once per view rather
+// than for each row on every add. Times are kept as integer nanoseconds since
+// the epoch, so that the Advance() on every merge divides integers rather than
+// absl::Durations.
+//
+// Thread-compatible.
+class IntervalBuckets final {
+ public:
+  static constexpr int kNumWindowBuckets = 4;
+  static constexpr int kNumSlots = kNumWindowBuckets + 1;
+
+  // The weight of each slot's data in a read, indexed by slot.
+  typedef std::array<double, kNumSlots> Weights;
+
+  // Creates a clock for a window of 'interval' (rounded up to 1 second if
+  // smaller), starting at 'now'.
+  IntervalBuckets(absl::Duration interval, absl::Time now);
+
+  // The bucket interval of a clock for a window of 'interval'.
+  static absl::Duration BucketInterval(absl::Duration interval);
+  // Returns true if the buckets of windows 'a' and 'b' nest: each bucket of
+  // the coarser window is made up of whole buckets of the finer one, so that
+  // data kept in the finer buckets can be rolled up into the coarser ones.
+  static bool Nest(absl::Duration a, absl::Duration b);
+
+  absl::Duration bucket_interval() const {
+    return absl::Nanoseconds(bucket_interval_nanos_);
+  }
+
+  // The slot holding the current bucket.
+  int current_slot() const { return current_slot_; }
+  // The slot holding the bucket 'n' (< kNumSlots) buckets before the current
+  // one.
+  int Slot(int n) const { return (current_slot_ + kNumSlots - n) % kNumSlots; }
+
+  // Advances the current bucket to the one containing 'now', if that is later.
+  // Returns the number k of buckets advanced, capped at kNumSlots; rows must
+  // clear slots Slot(0) through Slot(k - 1) before adding more data.
+  int Advance(absl::Time now);
+
+  // Returns the number of buckets the bucket containing 'time' is before the
+  // current one, capped at kNumSlots, or 0 if it is not before it. Data for a
+  // bucket less than kNumSlots before the current one is added to its slot,
+  // Slot(BucketsBehind(time)).
+  int BucketsBehind(absl::Time time) const;
+
+  // Returns the weight with which each slot's data counts towards the window
+  // ending at 'now', which should not be before the current bucket.
+  Weights SlotWeights(absl::Time now) const;
+
+ private:
+  // The number of whole bucket intervals 'now_nanos' is past the start of the
+  // current bucket, or 0 if it is before it.
+  int64_t BucketsAhead(int64_t now_nanos) const;
+  // The time since the start of the bucket containing 'now_nanos'.
+  int64_t NanosIntoBucket(int64_t now_nanos) const;
+
+  const int64_t bucket_interval_nanos_;
+  int current_slot_ = 0;
+  int64_t current_bucket_start_nanos_;
+  // The number of buckets advanced since construction, saturating at
+  // kNumSlots.
+  int buckets_advanced_ = 0;
+  // The portion of the first bucket after construction (which may have started
+  // before the view did) that was covered, or 1 once that bucket has left the
+  // ring. See common::StatsObject for why this matters.
+  double initial_bucket_fraction_filled_;
+};
+
+// IntervalRow holds the data of one row of an interval view: num_doubles()
+// double stats and num_counts() integer stats for each slot of the view's
+// IntervalBuckets. A row may hold several levels, each a ring of kNumSlots
+// slots for its own IntervalBuckets, so that views of several windows can
+// share rows; slots are numbered across levels, level by level (see
+// LevelSlot()).
+//
+// Thread-compatible.
+class IntervalRow final {
+ public:
+  IntervalRow(int num_doubles, int num_counts, int num_levels = 1);
+
+  // The row slot of ring slot 'slot' of 'level'.
+  static int LevelSlot(int level, int slot) {
+    return level * IntervalBuckets::kNumSlots + slot;
+  }
+
+  int num_doubles() const { return num_doubles_; }
+  int num_counts() const { return num_counts_; }
+  int num_levels() const { return num_levels_; }
+  int num_slots() const { return num_levels_ * IntervalBuckets::kNumSlots; }
+
+  absl::Span<double> doubles(int slot) {
+    return absl::Span<double>(doubles_.data() + slot * num_doubles_,
+                              num_doubles_);
+  }
+  absl::Span<const double> doubles(int slot) const {
+    return absl::Span<const double>(doubles_.data() + slot * num_doubles_,
+                                    num_doubles_);
+  }
+  absl::Span<uint64_t> counts(int slot) {
+    return absl::Span<uint64_t>(counts_.data() + slot * num_counts_,
+                                num_counts_);
+  }
+  absl::Span<const uint64_t> counts(int slot) const {
+    return absl::Span<const uint64_t>(counts_.data() + slot * num_counts_,
+                                      num_counts_);
+  }
+
+  // Zeroes the data in 'slot'.
+  void Clear(int slot);
+  // Zeroes the data in the 'num_slots' (at most kNumSlots) ring slots of
+  // 'level' up to and including 'last_slot', wrapping around from slot 0 to
+  // the last slot, as IntervalBuckets::Advance() requires. The slots are
+  // cleared with at most two contiguous fills of each array.
+  void Clear(int last_slot, int num_slots, int level = 0);
+
+  // Inserts an empty level before 'level' (or after the last level, if
+  // 'level' is num_levels()).
+  void InsertLevel(int level);
+
+  // Adds the data in row slot 'from' to row slot 'to': elementwise for
+  // AddSlot(), and for AddDistributionSlot() as distributions in the layout
+  // described at DistributionInto().
+  void AddSlot(int from, int to);
+  void AddDistributionSlot(int from, int to);
+
+  // Returns the sum over slots of double stat 'index' (or integer stat 'index'
+  // for WeightedCount()), scaled by 'weights', which has one weight per row
+  // slot.
+  double WeightedDouble(int index, absl::Span<const double> weights) const;
+  double WeightedCount(int index, absl::Span<const double> weights) const;
+
+  // Combines the distribution held in each slot, scaled by 'weights'. Requires
+  // the layout used by interval distribution views: doubles are mean, sum of
+  // squared deviation, min, and max; counts are the count followed by the
+  // histogram buckets. Counts are rounded to the nearest integer.
+  void DistributionInto(absl::Span<const double> weights,
+                        uint64_t* count, double* mean,
+                        double* sum_of_squared_deviation, double* min,
+                        double* max,
+                        absl::Span<uint64_t> histogram_buckets) const;
+
+ private:
+  int num_doubles_;
+  int num_counts_;
+  int num_levels_;
+  std::vector<double> doubles_;
+  std::vector<uint64_t> counts_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_INTERVAL_BUCKETS_H_
@@ -0,0 +1,290 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/interval_buckets.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(IntervalBucketsTest, BucketInterval) {
+  EXPECT_EQ(absl::Seconds(15),
+            IntervalBuckets(absl::Minutes(1), absl::UnixEpoch())
+                .bucket_interval());
+  // Rounded up to 1 second.
+  EXPECT_EQ(absl::Milliseconds(250),
+            IntervalBuckets(absl::Milliseconds(1), absl::UnixEpoch())
+                .bucket_interval());
+}
+
+TEST(IntervalBucketsTest, AdvanceAlignsToEpoch) {
+  const absl::Time start = absl::UnixEpoch() + absl::Seconds(20);
+  IntervalBuckets buckets(absl::Minutes(1), start);
+  EXPECT_EQ(0, buckets.current_slot());
+  // The first bucket is [15s, 30s).
+  EXPECT_EQ(0, buckets.Advance(absl::UnixEpoch() + absl::Seconds(29)));
+  EXPECT_EQ(0, buckets.current_slot());
+  EXPECT_EQ(1, buckets.Advance(absl::UnixEpoch() + absl::Seconds(30)));
+  EXPECT_EQ(1, buckets.current_slot());
+  EXPECT_EQ(0, buckets.Slot(1));
+  EXPECT_EQ(2, buckets.Advance(absl::UnixEpoch() + absl::Seconds(60)));
+  EXPECT_EQ(3, buckets.current_slot());
+  // Earlier times do not move the clock back.
+  EXPECT_EQ(0, buckets.Advance(start));
+  EXPECT_EQ(3, buckets.current_slot());
+  // Advancing past the whole ring stales every slot.
+  EXPECT_EQ(IntervalBuckets::kNumSlots,
+            buckets.Advance(absl::UnixEpoch() + absl::Hours(1)));
+}
+
+TEST(IntervalBucketsTest, BucketsBehind) {
+  const absl::Time epoch = absl::UnixEpoch();
+  IntervalBuckets buckets(absl::Minutes(1), epoch + absl::Seconds(65));
+  // The current bucket is [60s, 75s).
+  EXPECT_EQ(0, buckets.BucketsBehind(epoch + absl::Seconds(60)));
+  EXPECT_EQ(0, buckets.BucketsBehind(epoch + absl::Seconds(100)));
+  EXPECT_EQ(1, buckets.BucketsBehind(epoch + absl::Seconds(59)));
+  EXPECT_EQ(1, buckets.BucketsBehind(epoch + absl::Seconds(45)));
+  EXPECT_EQ(4, buckets.BucketsBehind(epoch));
+  EXPECT_EQ(IntervalBuckets::kNumSlots,
+            buckets.BucketsBehind(epoch - absl::Seconds(1)));
+  EXPECT_EQ(IntervalBuckets::kNumSlots,
+            buckets.BucketsBehind(absl::InfinitePast()));
+}
+
+TEST(IntervalBucketsTest, SlotWeights) {
+  const absl::Time start = absl::UnixEpoch();
+  IntervalBuckets buckets(absl::Minutes(1), start);
+  EXPECT_THAT(buckets.SlotWeights(start), ElementsAre(1, 1, 1, 1, 1));
+  // Halfway through the current bucket, half of the oldest bucket is still in
+  // the window.
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(7.5)),
+              ElementsAre(1, 0.5, 1, 1, 1));
+  // Reads ahead of the clock drop the buckets that would have been cleared.
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(15)),
+              ElementsAre(1, 0, 1, 1, 1));
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(45)),
+              ElementsAre(1, 0, 0, 0, 1));
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(75)),
+              ElementsAre(0, 0, 0, 0, 0));
+
+  buckets.Advance(start + absl::Seconds(15));
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(15)),
+              ElementsAre(1, 1, 1, 1, 1));
+  EXPECT_THAT(buckets.SlotWeights(start + absl::Seconds(18)),
+              ElementsAre(1, 1, 0.8, 1, 1));
+}
+
+TEST(IntervalBucketsTest, PartialInitialBucket) {
+  // The first bucket is [0s, 15s), but only covers [7.5s, 15s).
+  const absl::Time start = absl::UnixEpoch() + absl::Seconds(7.5);
+  IntervalBuckets buckets(absl::Minutes(1), start);
+  const absl::Time later = absl::UnixEpoch() + absl::Seconds(67.5);
+  buckets.Advance(later);
+  EXPECT_EQ(4, buckets.current_slot());
+  // Half of the first bucket's interval is in the window, which is all of the
+  // time it covered.
+  EXPECT_THAT(buckets.SlotWeights(later), ElementsAre(1, 1, 1, 1, 1));
+  EXPECT_THAT(buckets.SlotWeights(later + absl::Seconds(3.75)),
+              ElementsAre(0.5, 1, 1, 1, 1));
+
+  // Once the first bucket leaves the ring, the oldest bucket is interpolated
+  // as usual.
+  buckets.Advance(later + absl::Seconds(15));
+  EXPECT_EQ(0, buckets.current_slot());
+  EXPECT_THAT(buckets.SlotWeights(later + absl::Seconds(15)),
+              ElementsAre(1, 0.5, 1, 1, 1));
+}
+
+TEST(IntervalRowTest, WeightedSums) {
+  IntervalRow row(1, 1);
+  for (int slot = 0; slot < IntervalBuckets::kNumSlots; ++slot) {
+    row.doubles(slot)[0] = 1.5;
+    row.counts(slot)[0] = 2;
+  }
+  row.Clear(1);
+  EXPECT_EQ(0, row.doubles(1)[0]);
+  EXPECT_EQ(0, row.counts(1)[0]);
+
+  const IntervalBuckets::Weights weights = {1, 1, 1, 1, 0.5};
+  EXPECT_DOUBLE_EQ(1.5 * 3.5, row.WeightedDouble(0, weights));
+  EXPECT_DOUBLE_EQ(2 * 3.5, row.WeightedCount(0, weights));
+}
+
+TEST(IntervalRowTest, ClearRange) {
+  IntervalRow row(2, 1);
+  const auto fill = [&row]() {
+    for (int slot = 0; slot < IntervalBuckets::kNumSlots; ++slot) {
+      row.doubles(slot)[0] = 1;
+      row.doubles(slot)[1] = 1;
+      row.counts(slot)[0] = 1;
+    }
+  };
+  const auto cleared = [&row]() {
+    std::vector<int> slots;
+    for (int slot = 0; slot < IntervalBuckets::kNumSlots; ++slot) {
+      if (row.doubles(slot)[0] == 0) {
+        EXPECT_EQ(0, row.doubles(slot)[1]);
+        EXPECT_EQ(0, row.counts(slot)[0]);
+        slots.push_back(slot);
+      } else {
+        EXPECT_EQ(1, row.doubles(slot)[1]);
+        EXPECT_EQ(1, row.counts(slot)[0]);
+      }
+    }
+    return slots;
+  };
+  fill();
+  row.Clear(3, 2);
+  EXPECT_THAT(cleared(), ElementsAre(2, 3));
+  fill();
+  // Wraps around to the last slots.
+  row.Clear(1, 3);
+  EXPECT_THAT(cleared(), ElementsAre(0, 1, 4));
+  fill();
+  row.Clear(2, IntervalBuckets::kNumSlots);
+  EXPECT_THAT(cleared(), ElementsAre(0, 1, 2, 3, 4));
+}
+
+TEST(IntervalBucketsTest, BeforeEpoch) {
+  // Buckets stay aligned to multiples of the interval before the epoch.
+  const absl::Time start = absl::UnixEpoch() - absl::Seconds(20);
+  IntervalBuckets buckets(absl::Minutes(1), start);
+  // The first bucket is [-30s, -15s).
+  EXPECT_EQ(0, buckets.Advance(absl::UnixEpoch() - absl::Seconds(16)));
+  EXPECT_EQ(1, buckets.Advance(absl::UnixEpoch() - absl::Seconds(15)));
+  EXPECT_THAT(buckets.SlotWeights(absl::UnixEpoch() - absl::Seconds(15)),
+              ElementsAre(1, 1, 1, 1, 1));
+}
+
+TEST(IntervalRowTest, DistributionInto) {
+  // Doubles are mean, sum of squared deviation, min, and max; counts are the
+  // count and 2 histogram buckets.
+  IntervalRow row(4, 3);
+  // {1, 3} in slot 0 and {5} in slot 2.
+  row.doubles(0)[0] = 2;
+  row.doubles(0)[1] = 2;
+  row.doubles(0)[2] = 1;
+  row.doubles(0)[3] = 3;
+  row.counts(0)[0] = 2;
+  row.counts(0)[1] = 2;
+  row.doubles(2)[0] = 5;
+  row.doubles(2)[2] = 5;
+  row.doubles(2)[3] = 5;
+  row.counts(2)[0] = 1;
+  row.counts(2)[2] = 1;
+
+  const IntervalBuckets::Weights weights = {1, 1, 1, 1, 1};
+  uint64_t count;
+  double mean;
+  double sum_of_squared_deviation;
+  double min;
+  double max;
+  std::vector<uint64_t> histogram(2);
+  row.DistributionInto(weights, &count, &mean, &sum_of_squared_deviation,
+                       &min, &max, absl::Span<uint64_t>(histogram));
+  EXPECT_EQ(3, count);
+  EXPECT_DOUBLE_EQ(3, mean);
+  EXPECT_DOUBLE_EQ(8, sum_of_squared_deviation);
+  EXPECT_EQ(1, min);
+  EXPECT_EQ(5, max);
+  EXPECT_THAT(histogram, ElementsAre(2, 1));
+
+  // Dropping slot 2 leaves only {1, 3}.
+  const IntervalBuckets::Weights partial_weights = {1, 1, 0, 1, 1};
+  row.DistributionInto(partial_weights, &count, &mean,
+                       &sum_of_squared_deviation, &min, &max,
+                       absl::Span<uint64_t>(histogram));
+  EXPECT_EQ(2, count);
+  EXPECT_DOUBLE_EQ(2, mean);
+  EXPECT_DOUBLE_EQ(2, sum_of_squared_deviation);
+  EXPECT_EQ(1, min);
+  EXPECT_EQ(3, max);
+  EXPECT_THAT(histogram, ElementsAre(2, 0));
+}
+
+TEST(IntervalBucketsTest, Nest) {
+  // 15-second buckets make up 150-second and 15-minute ones.
+  EXPECT_TRUE(IntervalBuckets::Nest(absl::Minutes(1), absl::Minutes(10)));
+  EXPECT_TRUE(IntervalBuckets::Nest(absl::Hours(1), absl::Minutes(1)));
+  // But not 22.5-second ones.
+  EXPECT_FALSE(IntervalBuckets::Nest(absl::Minutes(1), absl::Seconds(90)));
+  // Windows are rounded up to 1 second.
+  EXPECT_TRUE(
+      IntervalBuckets::Nest(absl::Milliseconds(1), absl::Milliseconds(3)));
+}
+
+TEST(IntervalRowTest, Levels) {
+  IntervalRow row(1, 1, 2);
+  EXPECT_EQ(2 * IntervalBuckets::kNumSlots, row.num_slots());
+  for (int slot = 0; slot < row.num_slots(); ++slot) {
+    row.doubles(slot)[0] = slot;
+    row.counts(slot)[0] = slot;
+  }
+  // Clears ring slots 0, 1, and 4 of level 1.
+  row.Clear(1, 3, 1);
+  EXPECT_EQ(4, row.counts(4)[0]);
+  EXPECT_EQ(0, row.counts(IntervalRow::LevelSlot(1, 0))[0]);
+  EXPECT_EQ(0, row.counts(IntervalRow::LevelSlot(1, 1))[0]);
+  EXPECT_EQ(7, row.counts(IntervalRow::LevelSlot(1, 2))[0]);
+  EXPECT_EQ(0, row.doubles(IntervalRow::LevelSlot(1, 4))[0]);
+
+  row.AddSlot(2, IntervalRow::LevelSlot(1, 2));
+  EXPECT_EQ(9, row.counts(IntervalRow::LevelSlot(1, 2))[0]);
+  EXPECT_EQ(9, row.doubles(IntervalRow::LevelSlot(1, 2))[0]);
+
+  row.InsertLevel(1);
+  EXPECT_EQ(3, row.num_levels());
+  EXPECT_EQ(4, row.counts(4)[0]);
+  EXPECT_EQ(0, row.counts(IntervalRow::LevelSlot(1, 2))[0]);
+  EXPECT_EQ(9, row.counts(IntervalRow::LevelSlot(2, 2))[0]);
+  EXPECT_EQ(8, row.doubles(IntervalRow::LevelSlot(2, 3))[0]);
+}
+
+TEST(IntervalRowTest, AddDistributionSlot) {
+  IntervalRow row(4, 3);
+  // {1, 3} in slot 0 and {5} in slot 1.
+  row.doubles(0)[0] = 2;
+  row.doubles(0)[1] = 2;
+  row.doubles(0)[2] = 1;
+  row.doubles(0)[3] = 3;
+  row.counts(0)[0] = 2;
+  row.counts(0)[1] = 2;
+  row.doubles(1)[0] = 5;
+  row.doubles(1)[2] = 5;
+  row.doubles(1)[3] = 5;
+  row.counts(1)[0] = 1;
+  row.counts(1)[2] = 1;
+
+  row.AddDistributionSlot(0, 1);
+  EXPECT_THAT(row.doubles(1), ElementsAre(3, 8, 1, 5));
+  EXPECT_THAT(row.counts(1), ElementsAre(3, 2, 1));
+  // Adding to an empty slot copies.
+  row.AddDistributionSlot(0, 2);
+  EXPECT_THAT(row.doubles(2), ElementsAre(2, 2, 1, 3));
+  EXPECT_THAT(row.counts(2), ElementsAre(2, 2, 0));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,141 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/kill_switch_file.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/stats/stats_config.h"
+#include "opencensus/trace/trace_config.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// Reads the file at 'path' into *contents, which is left empty if the file
+// does not exist. Returns false if it cannot be read.
+bool ReadFile(const std::string& path, std::string* contents) {
+  contents->clear();
+  FILE* file = std::fopen(path.c_str(), "r");
+  if (file == nullptr) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    std::cerr << "Failed to open kill switch file \"" << path
+              << "\": " << strerror(errno) << "\n";
+    return false;
+  }
+  char buf[4096];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+    contents->append(buf, n);
+  }
+  const bool ok = !std::ferror(file);
+  std::fclose(file);
+  if (!ok) {
+    std::cerr << "Failed to read kill switch file \"" << path << "\"\n";
+  }
+  return ok;
+}
+
+// Parses and applies the kill switches in 'contents'. Applies nothing and
+// returns false if a line is invalid.
+bool Apply(const std::string& path, absl::string_view contents) {
+  std::vector<std::string> measures;
+  std::vector<std::string> views;
+  std::vector<std::string> span_names;
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    const std::vector<absl::string_view> parts =
+        absl::StrSplit(line, absl::MaxSplits(' ', 1));
+    const absl::string_view name =
+        parts.size() == 2 ? absl::StripAsciiWhitespace(parts[1]) : "";
+    std::vector<std::string>* names = nullptr;
+    if (parts[0] == "measure") {
+      names = &measures;
+    } else if (parts[0] == "view") {
+      names = &views;
+    } else if (parts[0] == "span") {
+      names = &span_names;
+    }
+    if (names == nullptr || name.empty()) {
+      std::cerr << "Ignoring kill switch file \"" << path
+                << "\" with invalid line: " << line << "\n";
+      return false;
+    }
+    names->emplace_back(name);
+  }
+  StatsConfig::SetDisabledMeasures(measures);
+  StatsConfig::SetDisabledViews(views);
+  opencensus::trace::TraceConfig::SetDisabledSpanNames(span_names);
+  return true;
+}
+
+struct KillSwitchFile {
+  // Applies the file if it has changed since it was last read, so that
+  // unchanged rereads do not touch every measure. Returns the time of the
+  // next reload.
+  absl::Time Reload() {
+    std::string new_contents;
+    if (ReadFile(path, &new_contents) && new_contents != contents) {
+      contents = std::move(new_contents);
+      Apply(path, contents);
+    }
+    return absl::Now() + interval;
+  }
+
+  const std::string path;
+  const absl::Duration interval;
+  // The contents last read.
+  std::string contents;
+};
+
+}  // namespace
+
+bool EnableKillSwitchFile(absl::string_view path, absl::Duration interval) {
+  static std::atomic<bool> enabled(false);
+  if (enabled.exchange(true)) {
+    std::cerr << "EnableKillSwitchFile() called more than once.\n";
+    return false;
+  }
+  // Lives as long as the process, since the task is never removed.
+  KillSwitchFile* file = new KillSwitchFile{std::string(path), interval, ""};
+  const bool applied = ReadFile(file->path, &file->contents) &&
+                       Apply(file->path, file->contents);
+  if (interval > absl::ZeroDuration()) {
+    common::Scheduler::Get()->AddTask([file]() { return file->Reload(); },
+                                      absl::Now() + interval);
+  }
+  return applied;
+}
+
+}  // namespace stats
+}  // namespace opencensus
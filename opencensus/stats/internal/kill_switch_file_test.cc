@@ -0,0 +1,92 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/kill_switch_file.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/view.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+void WriteFile(const std::string& path, absl::string_view contents) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  std::fwrite(contents.data(), 1, contents.size(), file);
+  std::fclose(file);
+}
+
+bool SpanRecords(absl::string_view name) {
+  static opencensus::trace::AlwaysSampler sampler;
+  auto span = opencensus::trace::Span::StartSpan(name, nullptr, {&sampler});
+  span.End();
+  return span.IsRecording();
+}
+
+TEST(KillSwitchFileTest, AppliesAndReloads) {
+  const MeasureDouble measure =
+      MeasureDouble::Register("kill_switch_test_measure", "", "");
+  View view(ViewDescriptor()
+                .set_measure("kill_switch_test_measure")
+                .set_name("kill_switch_test_view")
+                .set_aggregation(Aggregation::Count()));
+  const char* dir = std::getenv("TEST_TMPDIR");
+  const std::string path = absl::StrCat(
+      dir == nullptr ? "/tmp" : dir, "/oc_kill_switch_file_test_", getpid());
+  WriteFile(path,
+            "# Shed load.\n"
+            "measure kill_switch_test_measure\n"
+            "\n"
+            "span Disabled Span\n");
+
+  ASSERT_TRUE(EnableKillSwitchFile(path, absl::Milliseconds(10)));
+  EXPECT_FALSE(EnableKillSwitchFile(path));
+  EXPECT_FALSE(DeltaProducer::Get()->AnyHasViews({{measure, 1.0}}));
+  EXPECT_FALSE(SpanRecords("Disabled Span"));
+  EXPECT_TRUE(SpanRecords("Enabled Span"));
+
+  // An invalid file is ignored.
+  WriteFile(path, "measure kill_switch_test_measure\nbogus\n");
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_FALSE(SpanRecords("Disabled Span"));
+
+  // Removing the file enables everything.
+  unlink(path.c_str());
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (!SpanRecords("Disabled Span") && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_TRUE(SpanRecords("Disabled Span"));
+  EXPECT_TRUE(DeltaProducer::Get()->AnyHasViews({{measure, 1.0}}));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
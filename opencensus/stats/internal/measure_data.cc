@@ -16,41 +16,158 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #include "absl/base/macros.h"
+#include "absl/base/optimization.h"
 #include "absl/types/span.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/internal/bucket_counts.h"
 
 namespace opencensus {
 namespace stats {
 
-MeasureData::MeasureData(absl::Span<const BucketBoundaries> boundaries)
-    : boundaries_(boundaries) {
-  histograms_.reserve(boundaries_.size());
-  for (const auto& b : boundaries_) {
-    histograms_.emplace_back(b.num_buckets());
+namespace {
+
+size_t TotalNumBuckets(absl::Span<const BucketBoundaries> boundaries) {
+  size_t num_buckets = 0;
+  for (const auto& b : boundaries) {
+    num_buckets += b.num_buckets();
   }
+  return num_buckets;
 }
 
-void MeasureData::Add(double value) {
+}  // namespace
+
+MeasureData::MeasureData(absl::Span<const BucketBoundaries> boundaries,
+                         int exponential_max_buckets)
+    : boundaries_(boundaries),
+      track_distribution_(!boundaries.empty()),
+      track_exponential_histogram_(exponential_max_buckets != 0),
+      histogram_counts_(TotalNumBuckets(boundaries)),
+      exponential_histogram_(exponential_max_buckets) {}
+
+void MeasureData::Add(double value, const ExemplarAttachment* attachment) {
   last_value_ = value;
-  // Update using the method of provisional means.
   ++count_;
   ABSL_ASSERT(count_ > 0 && "Histogram count overflow.");
-  const double old_mean = mean_;
-  mean_ += (value - mean_) / count_;
-  sum_of_squared_deviation_ =
-      sum_of_squared_deviation_ + (value - old_mean) * (value - mean_);
+  sum_ += value;
+  AddToStatistics(value, attachment);
+}
+
+void MeasureData::AddInt64(int64_t value,
+                           const ExemplarAttachment* attachment) {
+  int_last_value_ = value;
+  ++count_;
+  ABSL_ASSERT(count_ > 0 && "Histogram count overflow.");
+  int_sum_ += value;
+  AddToStatistics(static_cast<double>(value), attachment);
+}
+
+void MeasureData::AddInt64Values(uint64_t count, int64_t sum) {
+  if (count == 0) {
+    return;
+  }
+  count_ += count;
+  int_sum_ += sum;
+  const double mean = static_cast<double>(sum) / count;
+  int_last_value_ = std::llround(mean);
+  if (track_distribution_) {
+    // Combine with 'count' values of 'mean' using the parallel algorithm.
+    const double delta = mean - mean_;
+    sum_of_squared_deviation_ +=
+        delta * delta * (count_ - count) * count / count_;
+    mean_ += delta * count / count_;
+    min_ = std::min(mean, min_);
+    max_ = std::max(mean, max_);
+    size_t offset = 0;
+    for (const auto& boundaries : boundaries_) {
+      AddToBucket(offset + boundaries.BucketForValue(mean), count);
+      offset += boundaries.num_buckets();
+    }
+  }
+  if (track_exponential_histogram_) {
+    exponential_histogram_.Add(mean, count);
+  }
+}
+
+void MeasureData::AddToStatistics(double value,
+                                  const ExemplarAttachment* attachment) {
+  if (track_distribution_) {
+    // Update using the method of provisional means.
+    const double old_mean = mean_;
+    mean_ += (value - mean_) / count_;
+    sum_of_squared_deviation_ =
+        sum_of_squared_deviation_ + (value - old_mean) * (value - mean_);
 
-  min_ = std::min(value, min_);
-  max_ = std::max(value, max_);
+    min_ = std::min(value, min_);
+    max_ = std::max(value, max_);
 
-  for (int i = 0; i < boundaries_.size(); ++i) {
-    ++histograms_[i][boundaries_[i].BucketForValue(value)];
+    if (attachment != nullptr && exemplars_.empty()) {
+      exemplars_.resize(histogram_counts_.size());
+    }
+    size_t offset = 0;
+    for (const auto& boundaries : boundaries_) {
+      const size_t index = offset + boundaries.BucketForValue(value);
+      AddToBucket(index, 1);
+      if (attachment != nullptr) {
+        Exemplar& exemplar = exemplars_[index];
+        exemplar.value = value;
+        exemplar.timestamp = attachment->timestamp;
+        exemplar.span_context = attachment->span_context;
+      }
+      offset += boundaries.num_buckets();
+    }
+  }
+  if (track_exponential_histogram_) {
+    exponential_histogram_.Add(value);
+  }
+}
+
+void MeasureData::Reset() {
+  last_value_ = std::numeric_limits<double>::quiet_NaN();
+  count_ = 0;
+  sum_ = 0;
+  int_last_value_ = 0;
+  int_sum_ = 0;
+  mean_ = 0;
+  sum_of_squared_deviation_ = 0;
+  min_ = std::numeric_limits<double>::infinity();
+  max_ = -std::numeric_limits<double>::infinity();
+  std::fill(histogram_counts_.begin(), histogram_counts_.end(), 0);
+  wide_histogram_counts_.clear();
+  std::fill(exemplars_.begin(), exemplars_.end(), Exemplar());
+  exponential_histogram_.Reset();
+}
+
+void MeasureData::Scale(uint32_t factor) {
+  count_ *= factor;
+  sum_ *= factor;
+  int_sum_ *= factor;
+  sum_of_squared_deviation_ *= factor;
+  if (factor > 1 && !histogram_counts_widened() &&
+      !histogram_counts_.empty() &&
+      *std::max_element(histogram_counts_.begin(), histogram_counts_.end()) >
+          std::numeric_limits<uint32_t>::max() / factor) {
+    WidenHistogramCounts();
+  }
+  if (histogram_counts_widened()) {
+    for (int64_t& count : wide_histogram_counts_) {
+      count *= factor;
+    }
+  } else {
+    for (uint32_t& count : histogram_counts_) {
+      count *= factor;
+    }
+  }
+  if (track_exponential_histogram_) {
+    exponential_histogram_.Scale(factor);
   }
 }
 
@@ -60,6 +177,26 @@ void MeasureData::AddToDistribution(Distribution* distribution) const {
                     &distribution->sum_of_squared_deviation_,
                     &distribution->min_, &distribution->max_,
                     absl::Span<uint64_t>(distribution->bucket_counts_));
+  if (exemplars_.empty()) {
+    return;
+  }
+  const int offset = HistogramOffset(distribution->bucket_boundaries());
+  if (offset < 0) {
+    return;
+  }
+  std::vector<Exemplar>& exemplars = distribution->exemplars_;
+  if (exemplars.empty()) {
+    exemplars.resize(distribution->bucket_counts_.size());
+  }
+  for (size_t i = 0; i < exemplars.size(); ++i) {
+    const Exemplar& exemplar = exemplars_[offset + i];
+    // Deltas from different shards may be merged out of order.
+    if (exemplar.span_context.IsValid() &&
+        (!exemplars[i].span_context.IsValid() ||
+         exemplar.timestamp >= exemplars[i].timestamp)) {
+      exemplars[i] = exemplar;
+    }
+  }
 }
 
 template <typename T>
@@ -87,25 +224,170 @@ void MeasureData::AddToDistribution(const BucketBoundaries& boundaries,
     *max = std::max(*max, max_);
   }
 
-  int histogram_index =
-      std::find(boundaries_.begin(), boundaries_.end(), boundaries) -
-      boundaries_.begin();
-  if (histogram_index >= histograms_.size()) {
-    std::cerr << "No matching BucketBoundaries in AddToDistribution\n";
-    ABSL_ASSERT(false);
-    // Add to the underflow bucket, to avoid downstream errors from the sum of
-    // bucket counts not matching the total count.
-    histogram_buckets[0] += count_;
-  } else {
-    for (int i = 0; i < histograms_[histogram_index].size(); ++i) {
-      histogram_buckets[i] += histograms_[histogram_index][i];
+  const int offset = HistogramOffset(boundaries);
+  if (offset >= 0) {
+    if (histogram_counts_widened()) {
+      AddBucketCounts(absl::MakeConstSpan(wide_histogram_counts_)
+                          .subspan(offset, boundaries.num_buckets()),
+                      histogram_buckets);
+    } else {
+      AddBucketCounts(absl::MakeConstSpan(histogram_counts_)
+                          .subspan(offset, boundaries.num_buckets()),
+                      histogram_buckets);
+    }
+    return;
+  }
+  std::cerr << "No matching BucketBoundaries in AddToDistribution\n";
+  ABSL_ASSERT(false);
+  // Add to the underflow bucket, to avoid downstream errors from the sum of
+  // bucket counts not matching the total count.
+  histogram_buckets[0] += count_;
+}
+
+void MeasureData::AddToBucket(size_t index, uint64_t count) {
+  if (ABSL_PREDICT_TRUE(!histogram_counts_widened())) {
+    uint32_t& narrow = histogram_counts_[index];
+    if (ABSL_PREDICT_TRUE(count <=
+                          std::numeric_limits<uint32_t>::max() - narrow)) {
+      narrow += static_cast<uint32_t>(count);
+      return;
+    }
+    WidenHistogramCounts();
+  }
+  wide_histogram_counts_[index] += count;
+}
+
+void MeasureData::WidenHistogramCounts() {
+  wide_histogram_counts_.assign(histogram_counts_.begin(),
+                                histogram_counts_.end());
+}
+
+int MeasureData::HistogramOffset(const BucketBoundaries& boundaries) const {
+  int offset = 0;
+  for (const auto& b : boundaries_) {
+    if (b == boundaries) {
+      return offset;
     }
+    offset += b.num_buckets();
+  }
+  return -1;
+}
+
+void MeasureData::AddToExponentialHistogram(
+    ExponentialHistogram* histogram) const {
+  ABSL_ASSERT(track_exponential_histogram_ &&
+              "MeasureData is not tracking an exponential histogram.");
+  histogram->Merge(exponential_histogram_);
+}
+
+size_t MeasureData::HeapBytes() const {
+  return histogram_counts_.capacity() * sizeof(uint32_t) +
+         wide_histogram_counts_.capacity() * sizeof(int64_t) +
+         exemplars_.capacity() * sizeof(Exemplar) +
+         (exponential_histogram_.positive_buckets().counts.capacity() +
+          exponential_histogram_.negative_buckets().counts.capacity()) *
+             sizeof(uint64_t);
+}
+
+// static
+MeasureData::Summary MeasureData::EmptySummary() {
+  Summary summary;
+  summary.count = 0;
+  summary.sum = 0;
+  summary.int_sum = 0;
+  summary.last_value = std::numeric_limits<double>::quiet_NaN();
+  summary.int_last_value = 0;
+  summary.mean = 0;
+  summary.sum_of_squared_deviation = 0;
+  summary.min = std::numeric_limits<double>::infinity();
+  summary.max = -std::numeric_limits<double>::infinity();
+  return summary;
+}
+
+void MeasureData::AddToSummary(Summary* summary,
+                               absl::Span<int64_t> histogram) const {
+  if (count_ == 0) {
+    return;
+  }
+  // Without distribution statistics, treat the values as all equal to their
+  // mean.
+  const double mean = track_distribution_ ? mean_ : sum() / count_;
+  const double sum_of_squared_deviation =
+      track_distribution_ ? sum_of_squared_deviation_ : 0;
+  const double new_count = static_cast<double>(summary->count + count_);
+  const double new_mean =
+      summary->mean + (mean - summary->mean) * count_ / new_count;
+  summary->sum_of_squared_deviation +=
+      sum_of_squared_deviation + summary->count * std::pow(summary->mean, 2) +
+      count_ * std::pow(mean, 2) - new_count * std::pow(new_mean, 2);
+  summary->mean = new_mean;
+  summary->count += count_;
+  summary->sum += sum_;
+  summary->int_sum += int_sum_;
+  summary->last_value = last_value_;
+  summary->int_last_value = int_last_value_;
+  summary->min = std::min(summary->min, track_distribution_ ? min_ : mean);
+  summary->max = std::max(summary->max, track_distribution_ ? max_ : mean);
+  if (!histogram.empty()) {
+    ABSL_ASSERT(histogram.size() == histogram_counts_.size());
+    if (histogram_counts_widened()) {
+      for (size_t i = 0; i < histogram.size(); ++i) {
+        histogram[i] += wide_histogram_counts_[i];
+      }
+    } else {
+      for (size_t i = 0; i < histogram.size(); ++i) {
+        histogram[i] += histogram_counts_[i];
+      }
+    }
+  }
+}
+
+void MeasureData::AddSummary(const Summary& summary,
+                             absl::Span<const int64_t> histogram) {
+  if (summary.count == 0) {
+    return;
+  }
+  const uint64_t old_count = count_;
+  count_ += summary.count;
+  sum_ += summary.sum;
+  int_sum_ += summary.int_sum;
+  last_value_ = summary.last_value;
+  int_last_value_ = summary.int_last_value;
+  if (track_distribution_) {
+    const double new_mean =
+        mean_ + (summary.mean - mean_) * summary.count / count_;
+    sum_of_squared_deviation_ += summary.sum_of_squared_deviation +
+                                 old_count * std::pow(mean_, 2) +
+                                 summary.count * std::pow(summary.mean, 2) -
+                                 count_ * std::pow(new_mean, 2);
+    mean_ = new_mean;
+    min_ = std::min(min_, summary.min);
+    max_ = std::max(max_, summary.max);
+    if (histogram.size() == histogram_counts_.size()) {
+      for (size_t i = 0; i < histogram.size(); ++i) {
+        AddToBucket(i, histogram[i]);
+      }
+    } else {
+      size_t offset = 0;
+      for (const auto& boundaries : boundaries_) {
+        AddToBucket(offset + boundaries.BucketForValue(summary.mean),
+                    summary.count);
+        offset += boundaries.num_buckets();
+      }
+    }
+  }
+  if (track_exponential_histogram_) {
+    exponential_histogram_.Add(summary.mean, summary.count);
   }
 }
 
 template void MeasureData::AddToDistribution(const BucketBoundaries&, double*,
                                              double*, double*, double*, double*,
                                              absl::Span<double>) const;
+template void MeasureData::AddToDistribution(const BucketBoundaries&,
+                                             uint64_t*, double*, double*,
+                                             double*, double*,
+                                             absl::Span<uint64_t>) const;
 
 }  // namespace stats
 }  // namespace opencensus
@@ -15,34 +15,106 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_MEASURE_DATA_H_
 #define OPENCENSUS_STATS_INTERNAL_MEASURE_DATA_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/trace/span_context.h"
 
 namespace opencensus {
 namespace stats {
 
+// The aggregations MeasureData tracks for one measure beyond the summary
+// statistics, as required by the views registered on that measure.
+struct MeasureDataConfig {
+  // The BucketBoundaries of each view with Distribution aggregation.
+  std::vector<BucketBoundaries> boundaries;
+  // The largest max_buckets() of any view with ExponentialHistogram
+  // aggregation, or 0 if there are none.
+  int exponential_max_buckets = 0;
+  // Whether any view uses the measure and it is not disabled. Data for
+  // measures without views is not recorded.
+  bool has_views = false;
+  // Only 1 in this many recordings of the measure are kept (see
+  // StatsConfig::SetMeasureSampling()), so its data is scaled by this when
+  // merged.
+  uint32_t sample_one_in = 1;
+
+  bool operator==(const MeasureDataConfig& other) const {
+    return boundaries == other.boundaries &&
+           exponential_max_buckets == other.exponential_max_buckets &&
+           has_views == other.has_views &&
+           sample_one_in == other.sample_one_in;
+  }
+  bool operator!=(const MeasureDataConfig& other) const {
+    return !(*this == other);
+  }
+};
+
+// The sampled Span that was current when values were recorded, and the time
+// of recording, which make those values exemplars.
+struct ExemplarAttachment {
+  opencensus::trace::SpanContext span_context;
+  absl::Time timestamp;
+};
+
 // MeasureData tracks all aggregations for a single measure, including
 // histograms for a number of different BucketBoundaries.
 //
+// The last value, count, and sum are always tracked, the latter two exactly
+// for int64 measures, whose values are added with AddInt64(). The remaining
+// statistics of a Distribution (mean, sum of squared deviation, min, and max)
+// are only tracked with at least one BucketBoundaries, which every
+// Distribution view registers, so that measures with only Count, Sum, and
+// LastValue views record with a few adds.
+//
 // MeasureData is thread-compatible.
 class MeasureData final {
  public:
-  MeasureData(absl::Span<const BucketBoundaries> boundaries);
+  // If exponential_max_buckets is nonzero, an ExponentialHistogram with that
+  // many buckets is also tracked. Distribution statistics are tracked if
+  // 'boundaries' is non-empty.
+  MeasureData(absl::Span<const BucketBoundaries> boundaries,
+              int exponential_max_buckets = 0);
+
+  // If 'attachment' is not null and distribution statistics are tracked, the
+  // value replaces the exemplar of its bucket in each histogram.
+  void Add(double value, const ExemplarAttachment* attachment = nullptr);
+  // Adds a value of an int64 measure. The sum and last value are kept as
+  // integers, so that Sum and LastValue views of int64 measures are exact.
+  void AddInt64(int64_t value,
+                const ExemplarAttachment* attachment = nullptr);
+  // Adds 'count' values of an int64 measure summing to 'sum', whose
+  // individual values are not known. The count and sum are exact; the other
+  // statistics (including the last value) treat the values as all equal to
+  // their mean.
+  void AddInt64Values(uint64_t count, int64_t sum);
+
+  // Resets all statistics to their initial values, keeping allocated storage.
+  void Reset();
 
-  void Add(double value);
+  // Multiplies the count of every value by 'factor', as if each had been
+  // added 'factor' times, e.g. to stand for the values not sampled. The
+  // mean, min, max, last value, and exemplars are unchanged.
+  void Scale(uint32_t factor);
 
   double last_value() const { return last_value_; }
   uint64_t count() const { return count_; }
-  double sum() const { return count_ * mean_; }
+  double sum() const { return sum_ + int_sum_; }
+  // The last value and sum of the values added with AddInt64().
+  int64_t int_last_value() const { return int_last_value_; }
+  int64_t int_sum() const { return int_sum_; }
 
-  // Adds this to 'distribution'. Requires that
+  // Adds this to 'distribution', including exemplars newer than those it
+  // holds. Requires that
   // distribution->bucket_boundaries() be in the set of boundaries passed to
-  // this on construction.
+  // this on construction (which is therefore non-empty).
   void AddToDistribution(Distribution* distribution) const;
 
   // Adds this to a distribution by pointers to individual elements.
@@ -52,22 +124,99 @@ class MeasureData final {
                          double* min, double* max,
                          absl::Span<T> histogram_buckets) const;
 
+  // Merges this into 'histogram'. Requires that this was constructed with a
+  // nonzero exponential_max_buckets.
+  void AddToExponentialHistogram(ExponentialHistogram* histogram) const;
+
+  // The bytes allocated for histogram buckets and exemplars.
+  size_t HeapBytes() const;
+
+  // The statistics of a MeasureData as plain values, for accumulating them
+  // outside the process (see shared_stats.h). Exemplars and the exponential
+  // histogram are not included.
+  struct Summary {
+    uint64_t count;
+    double sum;
+    int64_t int_sum;
+    double last_value;
+    int64_t int_last_value;
+    double mean;
+    double sum_of_squared_deviation;
+    double min;
+    double max;
+  };
+  // Returns the Summary of no values.
+  static Summary EmptySummary();
+  // The number of histogram buckets, over all the boundaries passed on
+  // construction.
+  size_t num_histogram_buckets() const { return histogram_counts_.size(); }
+
+  // Adds this to 'summary', and its histogram counts, laid out in the order of
+  // the boundaries passed on construction, to 'histogram', unless that is
+  // empty. Requires that 'histogram' be empty or have
+  // num_histogram_buckets() elements.
+  void AddToSummary(Summary* summary, absl::Span<int64_t> histogram) const;
+  // Adds the values summarized by 'summary'. If 'histogram' has
+  // num_histogram_buckets() elements, it holds their histogram counts as
+  // written by AddToSummary() for the same boundaries; otherwise histograms
+  // (and the exponential histogram) treat the values as all equal to their
+  // mean.
+  void AddSummary(const Summary& summary, absl::Span<const int64_t> histogram);
+
  private:
   const absl::Span<const BucketBoundaries> boundaries_;
+  // Updates the statistics beyond the count and sum, after the count has been
+  // incremented.
+  void AddToStatistics(double value, const ExemplarAttachment* attachment);
+  // Adds 'count' to histogram bucket 'index', widening the counts first if
+  // the bucket would overflow 32 bits.
+  void AddToBucket(size_t index, uint64_t count);
+  // Copies histogram_counts_ into wide_histogram_counts_, which holds the
+  // counts from then until Reset().
+  void WidenHistogramCounts();
+  bool histogram_counts_widened() const {
+    return !wide_histogram_counts_.empty();
+  }
+  // Returns the offset of the buckets of 'boundaries' in histogram_counts_, or
+  // -1 if 'boundaries' is not tracked.
+  int HistogramOffset(const BucketBoundaries& boundaries) const;
+
+  const bool track_distribution_;
+  const bool track_exponential_histogram_;
 
   double last_value_ = std::numeric_limits<double>::quiet_NaN();
   uint64_t count_ = 0;
+  double sum_ = 0;
+  int64_t int_last_value_ = 0;
+  int64_t int_sum_ = 0;
+  // Only updated if track_distribution_.
   double mean_ = 0;
   double sum_of_squared_deviation_ = 0;
   double min_ = std::numeric_limits<double>::infinity();
   double max_ = -std::numeric_limits<double>::infinity();
-  std::vector<std::vector<int64_t>> histograms_;
+  // The bucket counts for each of boundaries_, concatenated in order, so that
+  // all histograms share a single allocation. A delta rarely counts 2^32
+  // values in one bucket, so the counts are 32 bits, halving the footprint of
+  // the histograms recorded into, until one would overflow; from then until
+  // Reset() the counts are in wide_histogram_counts_ instead, which is
+  // otherwise empty.
+  std::vector<uint32_t> histogram_counts_;
+  std::vector<int64_t> wide_histogram_counts_;
+  // The most recent exemplar of each bucket, laid out as histogram_counts_.
+  // Empty until the first exemplar, so that rows never recorded under a
+  // sampled Span do not allocate it.
+  std::vector<Exemplar> exemplars_;
+  ExponentialHistogram exponential_histogram_;
 };
 
 extern template void MeasureData::AddToDistribution(const BucketBoundaries&,
                                                     double*, double*, double*,
                                                     double*, double*,
                                                     absl::Span<double>) const;
+extern template void MeasureData::AddToDistribution(const BucketBoundaries&,
+                                                    uint64_t*, double*, double*,
+                                                    double*, double*,
+                                                    absl::Span<uint64_t>) const;
 
 }  // namespace stats
 }  // namespace opencensus
@@ -0,0 +1,77 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// Returns state.range(0) distinct BucketBoundaries with 40 buckets each.
+std::vector<BucketBoundaries> MakeBoundaries(const benchmark::State& state) {
+  std::vector<BucketBoundaries> boundaries;
+  for (int i = 0; i < state.range(0); ++i) {
+    boundaries.push_back(BucketBoundaries::Linear(40, 1, i + 1));
+  }
+  return boundaries;
+}
+
+// Constructing MeasureData happens once per tag set per harvest.
+void BM_MeasureDataConstruct(benchmark::State& state) {
+  const std::vector<BucketBoundaries> boundaries = MakeBoundaries(state);
+  for (auto _ : state) {
+    MeasureData data(boundaries);
+    benchmark::DoNotOptimize(&data);
+  }
+}
+BENCHMARK(BM_MeasureDataConstruct)->Range(0, 8);
+
+void BM_MeasureDataAdd(benchmark::State& state) {
+  const std::vector<BucketBoundaries> boundaries = MakeBoundaries(state);
+  MeasureData data(boundaries);
+  double value = 0;
+  for (auto _ : state) {
+    data.Add(value);
+    value = value > 100 ? 0 : value + 1.5;
+  }
+  benchmark::DoNotOptimize(&data);
+}
+BENCHMARK(BM_MeasureDataAdd)->Range(0, 8);
+
+void BM_MeasureDataAddToDistribution(benchmark::State& state) {
+  const std::vector<BucketBoundaries> boundaries = MakeBoundaries(state);
+  MeasureData data(boundaries);
+  for (int i = 0; i < 100; ++i) {
+    data.Add(i);
+  }
+  Distribution distribution =
+      testing::TestUtils::MakeDistribution(&boundaries.back());
+  for (auto _ : state) {
+    data.AddToDistribution(&distribution);
+  }
+  benchmark::DoNotOptimize(&distribution);
+}
+BENCHMARK(BM_MeasureDataAddToDistribution)->Range(1, 8);
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -16,15 +16,22 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <numeric>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/distribution.h"
 #include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
+#include "opencensus/trace/trace_options.h"
 
 namespace opencensus {
 namespace stats {
@@ -61,6 +68,135 @@ TEST(MeasureDataTest, MultipleHistograms) {
   EXPECT_THAT(distribution2.bucket_counts(), ::testing::ElementsAre(2, 1));
 }
 
+TEST(MeasureDataTest, Reset) {
+  std::vector<BucketBoundaries> buckets = {BucketBoundaries::Explicit({0, 10})};
+  MeasureData data(buckets);
+  data.Add(-1);
+  data.Add(11);
+  data.Reset();
+  EXPECT_EQ(0, data.count());
+  EXPECT_EQ(0, data.sum());
+
+  data.Add(5);
+  Distribution distribution = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&distribution);
+  EXPECT_EQ(1, distribution.count());
+  EXPECT_DOUBLE_EQ(5, distribution.mean());
+  EXPECT_DOUBLE_EQ(5, distribution.min());
+  EXPECT_DOUBLE_EQ(5, distribution.max());
+  EXPECT_DOUBLE_EQ(0, distribution.sum_of_squared_deviation());
+  EXPECT_THAT(distribution.bucket_counts(), ::testing::ElementsAre(0, 1, 0));
+}
+
+TEST(MeasureDataTest, Scale) {
+  std::vector<BucketBoundaries> buckets = {BucketBoundaries::Explicit({0, 10})};
+  MeasureData data(buckets);
+  data.Add(-1);
+  data.Add(5);
+  data.Scale(3);
+  EXPECT_EQ(6, data.count());
+  EXPECT_DOUBLE_EQ(12, data.sum());
+
+  Distribution distribution = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&distribution);
+  EXPECT_EQ(6, distribution.count());
+  EXPECT_DOUBLE_EQ(2, distribution.mean());
+  EXPECT_THAT(distribution.bucket_counts(), ::testing::ElementsAre(3, 3, 0));
+}
+
+TEST(MeasureDataTest, BucketCountsWidenOnOverflow) {
+  std::vector<BucketBoundaries> buckets = {BucketBoundaries::Explicit({0, 10})};
+  MeasureData data(buckets);
+  const size_t narrow_bytes = data.HeapBytes();
+  const uint64_t max32 = std::numeric_limits<uint32_t>::max();
+  data.AddInt64Values(max32, 5 * static_cast<int64_t>(max32));
+  data.Add(-1);
+  EXPECT_EQ(narrow_bytes, data.HeapBytes());
+  // The next value in the full bucket widens the counts.
+  data.Add(5);
+  EXPECT_LT(narrow_bytes, data.HeapBytes());
+  data.Scale(2);
+
+  Distribution distribution = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&distribution);
+  EXPECT_EQ(2 * (max32 + 2), distribution.count());
+  EXPECT_THAT(distribution.bucket_counts(),
+              ::testing::ElementsAre(2, 2 * (max32 + 1), 0));
+
+  // Reset returns to 32-bit counts.
+  data.Reset();
+  data.Add(5);
+  Distribution reset = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&reset);
+  EXPECT_THAT(reset.bucket_counts(), ::testing::ElementsAre(0, 1, 0));
+}
+
+TEST(MeasureDataTest, Int64Values) {
+  std::vector<BucketBoundaries> buckets = {BucketBoundaries::Explicit({0, 10})};
+  MeasureData data(buckets);
+  data.AddInt64(2);
+  data.AddInt64Values(3, 15);
+  data.AddInt64Values(0, 0);
+  EXPECT_EQ(4, data.count());
+  EXPECT_EQ(17, data.int_sum());
+  EXPECT_EQ(5, data.int_last_value());
+
+  // The three values are treated as 5 each.
+  Distribution distribution = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&distribution);
+  EXPECT_EQ(4, distribution.count());
+  EXPECT_DOUBLE_EQ(4.25, distribution.mean());
+  EXPECT_DOUBLE_EQ(2, distribution.min());
+  EXPECT_DOUBLE_EQ(5, distribution.max());
+  EXPECT_DOUBLE_EQ(6.75, distribution.sum_of_squared_deviation());
+  EXPECT_THAT(distribution.bucket_counts(), ::testing::ElementsAre(0, 4, 0));
+}
+
+TEST(MeasureDataTest, Exemplars) {
+  std::vector<BucketBoundaries> buckets = {BucketBoundaries::Explicit({0, 10})};
+  MeasureData data(buckets);
+  const uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8,
+                              9, 10, 11, 12, 13, 14, 15, 16};
+  const uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const uint8_t sampled[] = {1};
+  const opencensus::trace::SpanContext span_context(
+      (opencensus::trace::TraceId(trace_id)),
+      (opencensus::trace::SpanId(span_id)),
+      (opencensus::trace::TraceOptions(sampled)));
+  const ExemplarAttachment first{span_context,
+                                 absl::UnixEpoch() + absl::Seconds(1)};
+  const ExemplarAttachment second{span_context,
+                                  absl::UnixEpoch() + absl::Seconds(2)};
+  data.Add(1, &first);
+  data.Add(2, &second);
+  data.Add(3);
+  data.Add(11, &first);
+
+  Distribution distribution = testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&distribution);
+  ASSERT_EQ(3, distribution.exemplars().size());
+  EXPECT_FALSE(distribution.exemplars()[0].span_context.IsValid());
+  // The latest exemplar of each bucket is kept.
+  EXPECT_EQ(2, distribution.exemplars()[1].value);
+  EXPECT_EQ(second.timestamp, distribution.exemplars()[1].timestamp);
+  EXPECT_EQ(span_context, distribution.exemplars()[1].span_context);
+  EXPECT_EQ(11, distribution.exemplars()[2].value);
+
+  // Older exemplars do not replace newer ones when merging.
+  MeasureData older(buckets);
+  older.Add(5, &first);
+  older.AddToDistribution(&distribution);
+  EXPECT_EQ(2, distribution.exemplars()[1].value);
+
+  data.Reset();
+  data.Add(5);
+  Distribution reset_distribution =
+      testing::TestUtils::MakeDistribution(&buckets[0]);
+  data.AddToDistribution(&reset_distribution);
+  ASSERT_EQ(3, reset_distribution.exemplars().size());
+  EXPECT_FALSE(reset_distribution.exemplars()[1].span_context.IsValid());
+}
+
 TEST(MeasureDataTest, DistributionStatistics) {
   BucketBoundaries buckets = BucketBoundaries::Explicit({});
   MeasureData data(absl::MakeSpan(&buckets, 1));
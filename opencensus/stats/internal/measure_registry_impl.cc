@@ -14,11 +14,23 @@
 
 #include "opencensus/stats/internal/measure_registry_impl.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "opencensus/stats/internal/delta_producer.h"
 #include "opencensus/stats/internal/stats_manager.h"
 #include "opencensus/stats/measure_descriptor.h"
+#include "opencensus/stats/stats_definitions.h"
 
 namespace opencensus {
 namespace stats {
@@ -33,6 +45,8 @@ constexpr uint64_t kTypeMask = 0x4000000000000000ull;
 constexpr uint64_t kDoubleType = 0x0000000000000000ull;
 constexpr uint64_t kIntType = 0x4000000000000000ull;
 
+constexpr size_t kInitialNameTableSize = 64;
+
 }  // namespace
 
 // static
@@ -42,6 +56,18 @@ MeasureRegistryImpl* MeasureRegistryImpl::Get() {
   return global_measure_registry_impl;
 }
 
+MeasureRegistryImpl::NameTable::NameTable(size_t size)
+    : mask_(size - 1), slots_(new std::atomic<uint64_t>[size]) {
+  for (size_t i = 0; i < size; ++i) {
+    slots_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+MeasureRegistryImpl::MeasureRegistryImpl() {
+  name_tables_.push_back(absl::make_unique<NameTable>(kInitialNameTableSize));
+  name_table_.store(name_tables_.back().get(), std::memory_order_release);
+}
+
 template <>
 MeasureDouble MeasureRegistryImpl::Register(absl::string_view name,
                                             absl::string_view description,
@@ -50,7 +76,7 @@ MeasureDouble MeasureRegistryImpl::Register(absl::string_view name,
       name, description, units, MeasureDescriptor::Type::kDouble)));
   if (measure.IsValid()) {
     StatsManager::Get()->AddMeasure(measure);
-    DeltaProducer::Get()->AddMeasure();
+    DeltaProducer::Get()->AddMeasures();
   }
   return measure;
 }
@@ -63,75 +89,153 @@ MeasureInt64 MeasureRegistryImpl::Register(absl::string_view name,
       name, description, units, MeasureDescriptor::Type::kInt64)));
   if (measure.IsValid()) {
     StatsManager::Get()->AddMeasure(measure);
-    DeltaProducer::Get()->AddMeasure();
+    DeltaProducer::Get()->AddMeasures();
   }
   return measure;
 }
 
+std::vector<uint64_t> MeasureRegistryImpl::RegisterAll(
+    absl::Span<const MeasureDefinition> measures) {
+  std::vector<uint64_t> ids;
+  ids.reserve(measures.size());
+  {
+    absl::MutexLock l(&mu_);
+    for (const auto& measure : measures) {
+      ids.push_back(RegisterLocked(MeasureDescriptor(
+          measure.name, measure.description, measure.units, measure.type)));
+    }
+  }
+  int num_valid = 0;
+  for (const uint64_t id : ids) {
+    if (!IdValid(id)) {
+      continue;
+    }
+    if (IdToType(id) == MeasureDescriptor::Type::kDouble) {
+      StatsManager::Get()->AddMeasure(MeasureDouble(id));
+    } else {
+      StatsManager::Get()->AddMeasure(MeasureInt64(id));
+    }
+    ++num_valid;
+  }
+  // One delta swap for the whole batch, rather than one per measure.
+  if (num_valid > 0) {
+    DeltaProducer::Get()->AddMeasures(num_valid);
+  }
+  return ids;
+}
+
 uint64_t MeasureRegistryImpl::RegisterImpl(MeasureDescriptor descriptor) {
   absl::MutexLock l(&mu_);
+  return RegisterLocked(std::move(descriptor));
+}
+
+uint64_t MeasureRegistryImpl::RegisterLocked(MeasureDescriptor descriptor) {
   if (descriptor.name().empty()) {
     std::cerr << "Attempt to register measure with empty name\n";
     return CreateMeasureId(0, false, descriptor.type());
   }
-  const auto it = id_map_.find(descriptor.name());
-  if (it != id_map_.end()) {
+  if (FindId(descriptor.name()) != 0) {
     std::cerr << "Attempt to register measure with already-registered name: "
               << descriptor.DebugString() << "\n";
     return CreateMeasureId(0, false, descriptor.type());
   }
   const uint64_t id =
       CreateMeasureId(registered_descriptors_.size(), true, descriptor.type());
-  id_map_.emplace_hint(it, descriptor.name(), id);
+  // The descriptor is added first, so that lookups finding the id can read
+  // it.
   registered_descriptors_.push_back(std::move(descriptor));
+  const NameTable* table = name_table_.load(std::memory_order_relaxed);
+  if (2 * (num_names_ + 1) > table->size()) {
+    auto larger = absl::make_unique<NameTable>(2 * table->size());
+    for (size_t i = 0; i < table->size(); ++i) {
+      const uint64_t existing = table->slot(i).load(std::memory_order_relaxed);
+      if (existing != 0) {
+        InsertId(existing, *larger);
+      }
+    }
+    InsertId(id, *larger);
+    name_table_.store(larger.get(), std::memory_order_release);
+    name_tables_.push_back(std::move(larger));
+  } else {
+    InsertId(id, *table);
+  }
+  ++num_names_;
   return id;
 }
 
+uint64_t MeasureRegistryImpl::FindId(absl::string_view name) const {
+  const NameTable* table = name_table_.load(std::memory_order_acquire);
+  for (size_t i = absl::Hash<absl::string_view>()(name);; ++i) {
+    // Pairs with the release in InsertId(), so that the descriptor of the id
+    // is visible.
+    const uint64_t id = table->slot(i).load(std::memory_order_acquire);
+    if (id == 0) {
+      return 0;
+    }
+    if (registered_descriptors_[IdToIndex(id)].name() == name) {
+      return id;
+    }
+  }
+}
+
+void MeasureRegistryImpl::InsertId(uint64_t id, const NameTable& table) const {
+  const absl::string_view name = registered_descriptors_[IdToIndex(id)].name();
+  for (size_t i = absl::Hash<absl::string_view>()(name);; ++i) {
+    std::atomic<uint64_t>& slot = table.slot(i);
+    if (slot.load(std::memory_order_relaxed) == 0) {
+      slot.store(id, std::memory_order_release);
+      return;
+    }
+  }
+}
+
 const MeasureDescriptor& MeasureRegistryImpl::GetDescriptorByName(
     absl::string_view name) const {
-  absl::ReaderMutexLock l(&mu_);
-  const auto it = id_map_.find(std::string(name));
-  if (it == id_map_.end()) {
+  const uint64_t id = FindId(name);
+  if (id == 0) {
     static const MeasureDescriptor default_descriptor =
         MeasureDescriptor("", "", "", MeasureDescriptor::Type::kDouble);
     return default_descriptor;
-  } else {
-    return registered_descriptors_[IdToIndex(it->second)];
   }
+  return registered_descriptors_[IdToIndex(id)];
 }
 
 MeasureDouble MeasureRegistryImpl::GetMeasureDoubleByName(
     absl::string_view name) const {
-  absl::ReaderMutexLock l(&mu_);
-  const auto it = id_map_.find(std::string(name));
-  if (it == id_map_.end()) {
+  const uint64_t id = FindId(name);
+  if (id == 0) {
     return MeasureDouble(
         CreateMeasureId(0, false, MeasureDescriptor::Type::kDouble));
-  } else {
-    return MeasureDouble(it->second);
   }
+  return MeasureDouble(id);
 }
 
 MeasureInt64 MeasureRegistryImpl::GetMeasureInt64ByName(
     absl::string_view name) const {
-  absl::ReaderMutexLock l(&mu_);
-  const auto it = id_map_.find(std::string(name));
-  if (it == id_map_.end()) {
+  const uint64_t id = FindId(name);
+  if (id == 0) {
     return MeasureInt64(
         CreateMeasureId(0, false, MeasureDescriptor::Type::kDouble));
-  } else {
-    return MeasureInt64(it->second);
   }
+  return MeasureInt64(id);
+}
+
+const MeasureDescriptor& MeasureRegistryImpl::GetDescriptor(
+    const Measurement& measurement) const {
+  if (!IdValid(measurement.id_)) {
+    static const MeasureDescriptor default_descriptor =
+        MeasureDescriptor("", "", "", MeasureDescriptor::Type::kDouble);
+    return default_descriptor;
+  }
+  return registered_descriptors_[IdToIndex(measurement.id_)];
 }
 
 uint64_t MeasureRegistryImpl::GetIdByName(absl::string_view name) const {
-  absl::ReaderMutexLock l(&mu_);
-  const auto it = id_map_.find(std::string(name));
-  if (it == id_map_.end()) {
+  const uint64_t id = FindId(name);
+  if (id == 0) {
     return CreateMeasureId(0, false, MeasureDescriptor::Type::kDouble);
-  } else {
-    return it->second;
   }
+  return id;
 }
 
 // static
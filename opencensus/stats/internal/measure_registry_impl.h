@@ -15,21 +15,26 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_MEASURE_REGISTRY_IMPL_H_
 #define OPENCENSUS_STATS_INTERNAL_MEASURE_REGISTRY_IMPL_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <string>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/append_only_vector.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/stats/measure_descriptor.h"
+#include "opencensus/stats/stats_definitions.h"
 
 namespace opencensus {
 namespace stats {
 
 // MeasureRegistryImpl implements MeasureRegistry and holds internal-only
-// helpers for Measure.
+// helpers for Measure. Registration takes a mutex; lookups, by id or by name,
+// do not.
 // MeasureRegistryImpl is thread-safe.
 class MeasureRegistryImpl {
  public:
@@ -40,21 +45,31 @@ class MeasureRegistryImpl {
                              absl::string_view description,
                              absl::string_view units) LOCKS_EXCLUDED(mu_);
 
-  const MeasureDescriptor& GetDescriptorByName(absl::string_view name) const
-      LOCKS_EXCLUDED(mu_);
+  // Registers 'measures' in one batch, returning their ids in order. Names
+  // that are empty or already registered get invalid ids, as in Register().
+  std::vector<uint64_t> RegisterAll(
+      absl::Span<const MeasureDefinition> measures) LOCKS_EXCLUDED(mu_);
 
-  MeasureDouble GetMeasureDoubleByName(absl::string_view name) const
-      LOCKS_EXCLUDED(mu_);
-  MeasureInt64 GetMeasureInt64ByName(absl::string_view name) const
-      LOCKS_EXCLUDED(mu_);
+  const MeasureDescriptor& GetDescriptorByName(absl::string_view name) const;
+
+  MeasureDouble GetMeasureDoubleByName(absl::string_view name) const;
+  MeasureInt64 GetMeasureInt64ByName(absl::string_view name) const;
 
   // The following methods are for internal use by the library, and not exposed
   // in the public MeasureRegistry.
-  uint64_t GetIdByName(absl::string_view name) const LOCKS_EXCLUDED(mu_);
+  uint64_t GetIdByName(absl::string_view name) const;
 
+  // Does not lock, since registered descriptors never change or move.
   template <typename MeasureT>
-  const MeasureDescriptor& GetDescriptor(Measure<MeasureT> measure) const
-      LOCKS_EXCLUDED(mu_);
+  const MeasureDescriptor& GetDescriptor(Measure<MeasureT> measure) const;
+  // Returns the descriptor of the measure 'measurement' records to. Does not
+  // lock.
+  const MeasureDescriptor& GetDescriptor(const Measurement& measurement) const;
+  // Returns the descriptor of the measure with index 'index', which must have
+  // been registered. Does not lock.
+  const MeasureDescriptor& GetDescriptorByIndex(uint64_t index) const {
+    return registered_descriptors_[index];
+  }
 
   // Measure ids contain a sequential index, a validity bit, and a
   // type bit; these functions access the individual parts.
@@ -66,19 +81,51 @@ class MeasureRegistryImpl {
   static uint64_t MeasureToIndex(Measure<MeasureT> measure);
 
  private:
-  MeasureRegistryImpl() = default;
+  // An open-addressing hash table from measure names to ids, which can be
+  // probed without locking while ids are inserted. Each slot holds the id of a
+  // registered measure, whose name is read from registered_descriptors_, or 0
+  // if empty (valid ids are never 0).
+  class NameTable {
+   public:
+    // 'size' must be a power of 2.
+    explicit NameTable(size_t size);
+
+    size_t size() const { return mask_ + 1; }
+    std::atomic<uint64_t>& slot(size_t index) const {
+      return slots_[index & mask_];
+    }
+
+   private:
+    const size_t mask_;
+    const std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+  };
+
+  MeasureRegistryImpl();
 
   uint64_t RegisterImpl(MeasureDescriptor descriptor) LOCKS_EXCLUDED(mu_);
+  uint64_t RegisterLocked(MeasureDescriptor descriptor)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the id registered for 'name', or 0 if there is none.
+  uint64_t FindId(absl::string_view name) const;
+  // Adds 'id' to 'table', which must have an empty slot. Requires holding mu_
+  // while 'table' is published.
+  void InsertId(uint64_t id, const NameTable& table) const;
 
   static uint64_t CreateMeasureId(uint64_t index, bool is_valid,
                                   MeasureDescriptor::Type type);
 
   mutable absl::Mutex mu_;
   // The registered MeasureDescriptors. Measure id are indexes into this
-  // vector plus some flags in the high bits.
-  std::vector<MeasureDescriptor> registered_descriptors_ GUARDED_BY(mu_);
-  // A map from measure names to IDs.
-  std::unordered_map<std::string, uint64_t> id_map_ GUARDED_BY(mu_);
+  // vector plus some flags in the high bits. Appends are guarded by mu_; reads
+  // are not.
+  common::AppendOnlyVector<MeasureDescriptor> registered_descriptors_;
+  // The table for name lookups. It is replaced by one of twice the size when
+  // half full; replaced tables stay in name_tables_, since lookups may still
+  // be probing them, which at most doubles the memory used.
+  std::atomic<const NameTable*> name_table_;
+  std::vector<std::unique_ptr<NameTable>> name_tables_ GUARDED_BY(mu_);
+  size_t num_names_ GUARDED_BY(mu_) = 0;
 };
 
 template <>
@@ -94,7 +141,6 @@ MeasureInt64 MeasureRegistryImpl::Register(absl::string_view name,
 template <typename MeasureT>
 const MeasureDescriptor& MeasureRegistryImpl::GetDescriptor(
     Measure<MeasureT> measure) const {
-  absl::ReaderMutexLock l(&mu_);
   if (!measure.IsValid()) {
     static const MeasureDescriptor default_descriptor =
         MeasureDescriptor("", "", "", MeasureDescriptor::Type::kDouble);
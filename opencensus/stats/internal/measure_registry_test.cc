@@ -14,7 +14,13 @@
 
 #include "opencensus/stats/measure_registry.h"
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "opencensus/stats/measure.h"
@@ -147,6 +153,40 @@ TEST(MeasureRegistryTest, GetMeasureByNameWithWrongTypeFails) {
   EXPECT_NE(measure_int.GetDescriptor(), measure_int_mistyped.GetDescriptor());
 }
 
+TEST(MeasureRegistryTest, ManyMeasuresWithConcurrentLookups) {
+  // Enough measures to grow the name table several times, while another thread
+  // looks up the names registered so far.
+  constexpr int kNumMeasures = 1000;
+  std::vector<std::string> names;
+  for (int i = 0; i < kNumMeasures; ++i) {
+    names.push_back(MakeUniqueName());
+  }
+  std::atomic<int> num_registered(0);
+  absl::Notification done;
+  std::thread reader([&]() {
+    while (!done.HasBeenNotified()) {
+      const int n = num_registered.load();
+      for (int i = 0; i < n; ++i) {
+        ASSERT_EQ(names[i],
+                  MeasureRegistry::GetDescriptorByName(names[i]).name());
+      }
+    }
+  });
+  std::vector<MeasureDouble> measures;
+  for (int i = 0; i < kNumMeasures; ++i) {
+    measures.push_back(MeasureDouble::Register(names[i], "", ""));
+    num_registered.store(i + 1);
+  }
+  done.Notify();
+  reader.join();
+
+  for (int i = 0; i < kNumMeasures; ++i) {
+    EXPECT_EQ(measures[i], MeasureRegistry::GetMeasureDoubleByName(names[i]));
+    EXPECT_FALSE(
+        MeasureRegistry::GetMeasureDoubleByName(names[i] + "x").IsValid());
+  }
+}
+
 }  // namespace
 }  // namespace stats
 }  // namespace opencensus
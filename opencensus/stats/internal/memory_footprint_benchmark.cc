@@ -0,0 +1,229 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the memory held per view row and per recorded tag set, and the
+// cost of registering measures and views. Memory is reported as estimated by
+// StatsConfig::GetMemoryUsage() ("approx_bytes_per_*"), as the growth of the
+// heap including allocator overhead ("heap_bytes_per_*"), and as the growth of
+// the resident set ("rss_bytes_per_*"), which stays near zero while memory
+// freed by earlier iterations is reused.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/common/internal/process_memory.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_config.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/stats/view.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::opencensus::common::HeapBytesInUse;
+using ::opencensus::common::ResidentMemoryBytes;
+
+// Generates unique measure names, since measures cannot be unregistered.
+std::string MakeUniqueName() {
+  static int counter;
+  return absl::StrCat("footprint", counter++);
+}
+
+// Generates 'n' tag values that have not been recorded before, so that each
+// creates a new row.
+std::vector<std::string> MakeUniqueValues(int n) {
+  static int counter;
+  std::vector<std::string> values(n);
+  for (int i = 0; i < n; ++i) {
+    values[i] = absl::StrCat("value", counter++);
+  }
+  return values;
+}
+
+opencensus::tags::TagKey FootprintKey() {
+  static const auto key = opencensus::tags::TagKey::Register("footprint_key");
+  return key;
+}
+
+Aggregation MakeAggregation(int type) {
+  switch (type) {
+    case 0:
+      return Aggregation::Count();
+    case 1:
+      return Aggregation::Distribution(BucketBoundaries::Exponential(10, 1, 2));
+    default:
+      return Aggregation::ExponentialHistogram(160);
+  }
+}
+
+// Records state.range(0) new tag sets into the active delta and reports the
+// bytes per tag set. Harvesting is deferred so that the tag sets accumulate.
+// Each tag set holds data for every registered measure, so this runs first,
+// before the other benchmarks register more.
+void BM_DeltaTagSetMemory(benchmark::State& state) {
+  const int num_tag_sets = state.range(0);
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  StatsConfig::SetHarvestParams(params);
+  const std::string name = MakeUniqueName();
+  const MeasureDouble measure = MeasureDouble::Register(name, "", "");
+  View view(ViewDescriptor()
+                .set_measure(name)
+                .set_name(name)
+                .set_aggregation(Aggregation::Count())
+                .add_column(FootprintKey()));
+  int64_t approximate_bytes = 0;
+  int64_t heap_bytes = 0;
+  int64_t resident_bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    testing::TestUtils::Flush();
+    const std::vector<std::string> values = MakeUniqueValues(num_tag_sets);
+    const int64_t start_approximate =
+        StatsConfig::GetMemoryUsage().active_delta.bytes;
+    state.ResumeTiming();
+
+    const int64_t start_heap = HeapBytesInUse();
+    const int64_t start = ResidentMemoryBytes();
+    for (const std::string& value : values) {
+      Record({{measure, 1.0}}, {{FootprintKey(), value}});
+    }
+    resident_bytes += ResidentMemoryBytes() - start;
+    heap_bytes += HeapBytesInUse() - start_heap;
+
+    state.PauseTiming();
+    approximate_bytes +=
+        StatsConfig::GetMemoryUsage().active_delta.bytes - start_approximate;
+    state.ResumeTiming();
+  }
+  testing::TestUtils::Flush();
+  StatsConfig::SetHarvestParams(HarvestParams());
+  const double tag_sets = static_cast<double>(num_tag_sets) * state.iterations();
+  state.counters["approx_bytes_per_tag_set"] = approximate_bytes / tag_sets;
+  state.counters["heap_bytes_per_tag_set"] = heap_bytes / tag_sets;
+  state.counters["rss_bytes_per_tag_set"] = resident_bytes / tag_sets;
+}
+BENCHMARK(BM_DeltaTagSetMemory)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+// Fills a new view with state.range(1) rows and reports the bytes per row.
+// state.range(0) selects a count, distribution, or exponential histogram view.
+// The heap and resident set growth also include the rows the recording
+// buffers keep for reuse, and the interned tag values.
+void BM_ViewRowMemory(benchmark::State& state) {
+  const int num_rows = state.range(1);
+  int64_t approximate_bytes = 0;
+  int64_t heap_bytes = 0;
+  int64_t resident_bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    const std::string name = MakeUniqueName();
+    const MeasureDouble measure = MeasureDouble::Register(name, "", "");
+    const std::vector<std::string> values = MakeUniqueValues(num_rows);
+    state.ResumeTiming();
+
+    View view(ViewDescriptor()
+                  .set_measure(name)
+                  .set_name(name)
+                  .set_aggregation(MakeAggregation(state.range(0)))
+                  .add_column(FootprintKey()));
+    const int64_t start_heap = HeapBytesInUse();
+    const int64_t start = ResidentMemoryBytes();
+    for (const std::string& value : values) {
+      Record({{measure, 1.0}}, {{FootprintKey(), value}});
+    }
+    testing::TestUtils::Flush();
+    resident_bytes += ResidentMemoryBytes() - start;
+    heap_bytes += HeapBytesInUse() - start_heap;
+
+    state.PauseTiming();
+    for (const StatsMemoryUsage::View& usage :
+         StatsConfig::GetMemoryUsage().views) {
+      if (usage.name == name) {
+        approximate_bytes += usage.bytes;
+      }
+    }
+    state.ResumeTiming();
+  }
+  const double rows = static_cast<double>(num_rows) * state.iterations();
+  state.counters["approx_bytes_per_row"] = approximate_bytes / rows;
+  state.counters["heap_bytes_per_row"] = heap_bytes / rows;
+  state.counters["rss_bytes_per_row"] = resident_bytes / rows;
+}
+BENCHMARK(BM_ViewRowMemory)
+    ->ArgNames({"aggregation", "rows"})
+    ->ArgsProduct({{0, 1, 2}, {1000, 10000, 100000}})
+    ->Unit(benchmark::kMillisecond);
+
+// Registers state.range(0) measures, each with state.range(1) distribution
+// views, as a process does at startup. Registering a measure or a view with
+// new bucket boundaries swaps the active delta, so the cost grows with the
+// number of measures already registered.
+void BM_RegisterMeasuresAndViews(benchmark::State& state) {
+  const int num_measures = state.range(0);
+  const int views_per_measure = state.range(1);
+  std::vector<std::unique_ptr<View>> views;
+  for (auto _ : state) {
+    state.PauseTiming();
+    views.clear();
+    std::vector<std::string> names(num_measures);
+    for (std::string& name : names) {
+      name = MakeUniqueName();
+    }
+    state.ResumeTiming();
+
+    for (const std::string& name : names) {
+      MeasureDouble::Register(name, "", "");
+      for (int i = 0; i < views_per_measure; ++i) {
+        views.push_back(absl::make_unique<View>(
+            ViewDescriptor()
+                .set_measure(name)
+                .set_name(absl::StrCat(name, "_", i))
+                .set_aggregation(Aggregation::Distribution(
+                    BucketBoundaries::Exponential(10, 1, i + 2)))
+                .add_column(FootprintKey())));
+      }
+    }
+  }
+  views.clear();
+  state.counters["registration_latency_us"] = benchmark::Counter(
+      num_measures * (1 + views_per_measure) * 1e-6,
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_RegisterMeasuresAndViews)
+    ->ArgNames({"measures", "views_per_measure"})
+    ->ArgsProduct({{10, 100, 1000}, {0, 1, 4}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/overhead_governor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/overhead_profiler.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/overhead_governor_impl.h"
+#include "opencensus/trace/trace_config.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// Harvest intervals grow with the level up to 2^kMaxHarvestScaleShift, so that
+// view data is not delayed indefinitely.
+constexpr int kMaxHarvestScaleShift = 3;
+
+std::atomic<int> current_level(0);
+
+// The time OverheadProfiler estimates was spent in all instrumented calls
+// since its last Reset().
+absl::Duration ProfiledTime() {
+  absl::Duration total;
+  for (const auto& call_site : common::OverheadProfiler::GetCallSites()) {
+    total += call_site.estimated_total_time;
+  }
+  return total;
+}
+
+struct GovernorTask {
+  // Measures the overhead since the last check and updates the level. Returns
+  // the time of the next check.
+  absl::Time Check() {
+    const absl::Time now = absl::Now();
+    const absl::Duration profiled = ProfiledTime();
+    const absl::Duration task_cpu = common::Scheduler::Get()->TaskCpuTime();
+    // If the profiler was reset, count what it collected since.
+    const absl::Duration foreground =
+        profiled >= last_profiled ? profiled - last_profiled : profiled;
+    current_level.store(governor.Update(foreground + task_cpu - last_task_cpu,
+                                        now - last_check),
+                        std::memory_order_relaxed);
+    last_check = now;
+    last_profiled = profiled;
+    last_task_cpu = task_cpu;
+    return now + interval;
+  }
+
+  OverheadGovernor governor;
+  const absl::Duration interval;
+  absl::Time last_check;
+  absl::Duration last_profiled;
+  absl::Duration last_task_cpu;
+};
+
+}  // namespace
+
+OverheadGovernor::OverheadGovernor(const OverheadGovernorParams& params)
+    : cpu_budget_(params.cpu_budget),
+      max_level_(std::min(std::max(params.max_level, 0), 63)) {}
+
+int OverheadGovernor::Update(absl::Duration overhead, absl::Duration elapsed) {
+  if (elapsed <= absl::ZeroDuration()) {
+    return level_;
+  }
+  const double fraction = absl::FDivDuration(overhead, elapsed);
+  int level = level_;
+  if (fraction > cpu_budget_) {
+    level = std::min(level + 1, max_level_);
+  } else if (fraction < cpu_budget_ / 2) {
+    level = std::max(level - 1, 0);
+  }
+  if (level != level_) {
+    level_ = level;
+    ApplyLevel(level);
+  }
+  return level_;
+}
+
+// static
+void OverheadGovernor::ApplyLevel(int level) {
+  opencensus::trace::TraceConfig::SetSamplingReduction(level);
+  DeltaProducer::Get()->SetHarvestIntervalScale(
+      1 << std::min(level, kMaxHarvestScaleShift));
+}
+
+bool EnableOverheadGovernor(const OverheadGovernorParams& params) {
+  if (params.check_interval <= absl::ZeroDuration()) {
+    std::cerr << "EnableOverheadGovernor(): check_interval must be positive.\n";
+    return false;
+  }
+  static std::atomic<bool> enabled(false);
+  if (enabled.exchange(true)) {
+    std::cerr << "EnableOverheadGovernor() called more than once.\n";
+    return false;
+  }
+  if (common::OverheadProfiler::sampling_period() == 0) {
+    common::OverheadProfiler::SetSamplingPeriod(
+        params.profiler_sampling_period);
+  }
+  // Lives as long as the process, since the task is never removed.
+  GovernorTask* task =
+      new GovernorTask{OverheadGovernor(params), params.check_interval,
+                       absl::Now(), ProfiledTime(),
+                       common::Scheduler::Get()->TaskCpuTime()};
+  common::Scheduler::Get()->AddTask([task]() { return task->Check(); },
+                                    task->last_check + task->interval);
+  return true;
+}
+
+int OverheadGovernorLevel() {
+  return current_level.load(std::memory_order_relaxed);
+}
+
+}  // namespace stats
+}  // namespace opencensus
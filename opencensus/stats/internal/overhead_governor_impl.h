@@ -0,0 +1,49 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_OVERHEAD_GOVERNOR_IMPL_H_
+#define OPENCENSUS_STATS_INTERNAL_OVERHEAD_GOVERNOR_IMPL_H_
+
+#include "absl/time/time.h"
+#include "opencensus/stats/overhead_governor.h"
+
+namespace opencensus {
+namespace stats {
+
+// OverheadGovernor implements the level changes of EnableOverheadGovernor(),
+// separately from measuring the overhead so that they can be tested. It is
+// only used by the governor's task, and is not thread-safe.
+class OverheadGovernor final {
+ public:
+  explicit OverheadGovernor(const OverheadGovernorParams& params);
+
+  // Adjusts the level for 'overhead' CPU time spent over 'elapsed', and
+  // applies it if it changed. Returns the new level.
+  int Update(absl::Duration overhead, absl::Duration elapsed);
+
+  int level() const { return level_; }
+
+  // Sets the sampling reduction and harvest interval scale for 'level'.
+  static void ApplyLevel(int level);
+
+ private:
+  const double cpu_budget_;
+  const int max_level_;
+  int level_ = 0;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_OVERHEAD_GOVERNOR_IMPL_H_
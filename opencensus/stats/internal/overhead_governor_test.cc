@@ -0,0 +1,100 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/overhead_governor.h"
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/internal/overhead_governor_impl.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/trace_config.h"
+#include "opencensus/trace/trace_params.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+int SampledRootSpans(int n) {
+  int sampled = 0;
+  for (int i = 0; i < n; ++i) {
+    auto span = opencensus::trace::Span::StartSpan("GovernedSpan");
+    sampled += span.IsSampled();
+    span.End();
+  }
+  return sampled;
+}
+
+TEST(OverheadGovernorTest, StepsLevelWithHysteresis) {
+  OverheadGovernorParams params;
+  params.cpu_budget = 0.1;
+  params.max_level = 2;
+  OverheadGovernor governor(params);
+  const absl::Duration elapsed = absl::Seconds(1);
+
+  EXPECT_EQ(1, governor.Update(absl::Milliseconds(200), elapsed));
+  EXPECT_EQ(2, governor.Update(absl::Milliseconds(200), elapsed));
+  EXPECT_EQ(2, governor.Update(absl::Milliseconds(200), elapsed));
+  // Between half the budget and the budget, the level holds.
+  EXPECT_EQ(2, governor.Update(absl::Milliseconds(80), elapsed));
+  EXPECT_EQ(1, governor.Update(absl::Milliseconds(20), elapsed));
+  EXPECT_EQ(0, governor.Update(absl::Milliseconds(20), elapsed));
+  EXPECT_EQ(0, governor.Update(absl::ZeroDuration(), elapsed));
+  // An empty interval changes nothing.
+  EXPECT_EQ(0, governor.Update(absl::Seconds(1), absl::ZeroDuration()));
+}
+
+TEST(OverheadGovernorTest, LevelReducesDefaultSampling) {
+  static opencensus::trace::AlwaysSampler always_sampler;
+  opencensus::trace::TraceConfig::SetCurrentTraceParams(
+      opencensus::trace::TraceParams{
+          32, 32, 128, 128, opencensus::trace::ProbabilitySampler(1.0)});
+  EXPECT_EQ(100, SampledRootSpans(100));
+
+  OverheadGovernor::ApplyLevel(40);
+  EXPECT_EQ(0, SampledRootSpans(100));
+  // Children of sampled spans and explicit samplers are unaffected.
+  auto root = opencensus::trace::Span::StartSpan("Root", nullptr,
+                                                 {&always_sampler});
+  auto child = opencensus::trace::Span::StartSpan("Child", &root);
+  EXPECT_TRUE(child.IsSampled());
+  child.End();
+  root.End();
+
+  OverheadGovernor::ApplyLevel(0);
+  EXPECT_EQ(100, SampledRootSpans(100));
+}
+
+TEST(OverheadGovernorTest, RaisesLevelOverBudget) {
+  OverheadGovernorParams params;
+  params.check_interval = absl::ZeroDuration();
+  EXPECT_FALSE(EnableOverheadGovernor(params));
+
+  // The governor's own checks exceed a negligible budget.
+  params.cpu_budget = 1e-12;
+  params.check_interval = absl::Milliseconds(10);
+  params.max_level = 2;
+  ASSERT_TRUE(EnableOverheadGovernor(params));
+  EXPECT_FALSE(EnableOverheadGovernor(params));
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (OverheadGovernorLevel() < 2 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(2, OverheadGovernorLevel());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -14,24 +14,154 @@
 
 #include "opencensus/stats/recording.h"
 
-#include <initializer_list>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/clock.h"
+#include "opencensus/common/internal/overhead_profiler.h"
 #include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/measure_registry_impl.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/tags/context_util.h"
 #include "opencensus/tags/tag_map.h"
+#include "opencensus/trace/context_util.h"
+#include "opencensus/trace/span_context.h"
 
 namespace opencensus {
 namespace stats {
 
-void Record(std::initializer_list<Measurement> measurements) {
-  DeltaProducer::Get()->Record(measurements,
-                               opencensus::tags::GetCurrentTagMap());
+namespace {
+
+// Attributes the cost of a sampled Record() call evenly to its measures.
+void FinishProfile(const common::ProfiledScope& profile,
+                   absl::Span<const Measurement> measurements) {
+  if (measurements.size() == 0) {
+    return;
+  }
+  const absl::Duration cost =
+      profile.Elapsed() / static_cast<int64_t>(measurements.size());
+  const MeasureRegistryImpl* registry = MeasureRegistryImpl::Get();
+  for (const Measurement& measurement : measurements) {
+    common::OverheadProfiler::Add(common::OverheadProfiler::Operation::kRecord,
+                                  registry->GetDescriptor(measurement).name(),
+                                  cost);
+  }
+}
+
+// If the current Span is sampled, fills in *attachment from it and returns it,
+// so that the values recorded become exemplars linked to its trace. Otherwise
+// returns nullptr, without reading the clock.
+const ExemplarAttachment* CurrentExemplarAttachment(
+    ExemplarAttachment* attachment) {
+  const opencensus::trace::SpanContext& context =
+      opencensus::trace::GetCurrentSpan().context();
+  if (!context.trace_options().IsSampled()) {
+    return nullptr;
+  }
+  attachment->span_context = context;
+  attachment->timestamp = opencensus::common::Clock::Now();
+  return attachment;
+}
+
+}  // namespace
+
+#ifndef OPENCENSUS_NOOP
+void Record(absl::Span<const Measurement> measurements) {
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kRecord);
+  DeltaProducer* producer = DeltaProducer::Get();
+  // Skip reading the context's tags if they would not be used.
+  if (producer->AnyHasViews(measurements)) {
+    std::vector<Measurement> kept;
+    const absl::Span<const Measurement> sampled =
+        producer->Sample(measurements, &kept);
+    if (!sampled.empty()) {
+      ExemplarAttachment attachment;
+      producer->Record(sampled, opencensus::tags::GetCurrentTagMap(),
+                       CurrentExemplarAttachment(&attachment));
+    }
+  }
+  if (profile.sampled()) {
+    FinishProfile(profile, measurements);
+  }
+}
+
+void Record(absl::Span<const Measurement> measurements,
+            const opencensus::tags::TagMap& tags) {
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kRecord);
+  DeltaProducer* producer = DeltaProducer::Get();
+  if (producer->AnyHasViews(measurements)) {
+    std::vector<Measurement> kept;
+    const absl::Span<const Measurement> sampled =
+        producer->Sample(measurements, &kept);
+    if (!sampled.empty()) {
+      ExemplarAttachment attachment;
+      producer->Record(sampled, tags, CurrentExemplarAttachment(&attachment));
+    }
+  }
+  if (profile.sampled()) {
+    FinishProfile(profile, measurements);
+  }
+}
+
+void RecordBatch(
+    absl::Span<const std::pair<opencensus::tags::TagMap,
+                               std::vector<Measurement>>>
+        batch) {
+  DeltaProducer::Get()->RecordBatch(batch);
+}
+
+void RecordBatchAt(absl::Span<const TimedMeasurements> batch) {
+  DeltaProducer::Get()->RecordBatchAt(batch);
+}
+#endif  // OPENCENSUS_NOOP
+
+template <typename MeasureT>
+BoundMeasure<MeasureT>::BoundMeasure(Measure<MeasureT> measure,
+                                     opencensus::tags::TagMap tags)
+    : measure_(measure), bound_tags_(new BoundTags(std::move(tags))) {}
+
+template <typename MeasureT>
+BoundMeasure<MeasureT>::~BoundMeasure() = default;
+
+template <typename MeasureT>
+void BoundMeasure<MeasureT>::RecordMeasurement(Measurement measurement) const {
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kRecord);
+  DeltaProducer* producer = DeltaProducer::Get();
+  if (producer->AnyHasViews({measurement}) &&
+      producer->KeepRecording(
+          MeasureRegistryImpl::MeasureToIndex(measure_))) {
+    ExemplarAttachment attachment;
+    producer->Record({measurement}, bound_tags_.get(),
+                     CurrentExemplarAttachment(&attachment));
+  }
+  if (profile.sampled()) {
+    FinishProfile(profile, {measurement});
+  }
+}
+
+template class BoundMeasure<double>;
+template class BoundMeasure<int64_t>;
+
+BoundCounter::BoundCounter(MeasureInt64 measure, opencensus::tags::TagMap tags)
+    : cells_(new CounterCells(MeasureRegistryImpl::MeasureToIndex(measure),
+                              std::move(tags),
+                              DeltaProducer::Get()->num_shards())) {
+  DeltaProducer::Get()->AddCounter(cells_.get());
+}
+
+BoundCounter::~BoundCounter() {
+  DeltaProducer::Get()->RemoveCounter(cells_.get());
 }
 
-void Record(std::initializer_list<Measurement> measurements,
-            opencensus::tags::TagMap tags) {
-  DeltaProducer::Get()->Record(measurements, std::move(tags));
+void BoundCounter::Add(int64_t value) const {
+  DeltaProducer::Get()->AddToCounter(cells_.get(), value);
 }
 
 }  // namespace stats
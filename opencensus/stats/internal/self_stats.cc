@@ -0,0 +1,251 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "opencensus/stats/internal/self_stats.h"
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+struct SelfStats {
+  SelfStats();
+
+  const MeasureInt64 spans_dropped;
+  const MeasureInt64 span_export_queue_depth;
+  const MeasureInt64 span_backlog_halvings;
+  const MeasureDouble merge_delta_latency;
+  const MeasureInt64 delta_tag_sets;
+  const MeasureDouble harvest_lag;
+  const MeasureDouble stats_export_latency;
+  const MeasureInt64 stats_export_overruns;
+  const MeasureDouble exporter_rpc_latency;
+  const MeasureInt64 exporter_rpc_errors;
+  const MeasureInt64 view_rows;
+  const MeasureInt64 view_bytes;
+  const MeasureInt64 delta_bytes;
+  const MeasureInt64 span_store_spans;
+  const MeasureInt64 span_store_bytes;
+  const opencensus::tags::TagKey exporter_key;
+  const opencensus::tags::TagKey view_key;
+  const opencensus::tags::TagKey delta_key;
+  const opencensus::tags::TagKey span_store_key;
+};
+
+SelfStats::SelfStats()
+    : spans_dropped(MeasureInt64::Register(
+          kSelfSpansDropped, "Spans dropped before export.", "1")),
+      span_export_queue_depth(MeasureInt64::Register(
+          kSelfSpanExportQueueDepth,
+          "Spans queued for export at the start of each export cycle.", "1")),
+      span_backlog_halvings(MeasureInt64::Register(
+          kSelfSpanBacklogHalvings,
+          "Halvings of the sampling probability for the span export backlog.",
+          "1")),
+      merge_delta_latency(MeasureDouble::Register(
+          kSelfMergeDeltaLatency,
+          "Time to merge a harvested delta of recorded stats into views.",
+          "ms")),
+      delta_tag_sets(MeasureInt64::Register(
+          kSelfDeltaTagSets, "Distinct tag sets in a harvested delta.", "1")),
+      harvest_lag(MeasureDouble::Register(
+          kSelfHarvestLag, "How late scheduled stats harvests started.",
+          "ms")),
+      stats_export_latency(MeasureDouble::Register(
+          kSelfStatsExportLatency,
+          "Time to collect view data and run the stats export handlers.",
+          "ms")),
+      stats_export_overruns(MeasureInt64::Register(
+          kSelfStatsExportOverruns,
+          "Stats export handlers that overran their export deadline.", "1")),
+      exporter_rpc_latency(MeasureDouble::Register(
+          kSelfExporterRpcLatency, "Latency of exporter RPCs.", "ms")),
+      exporter_rpc_errors(MeasureInt64::Register(
+          kSelfExporterRpcErrors, "Failed exporter RPCs.", "1")),
+      view_rows(MeasureInt64::Register(kSelfViewRows,
+                                       "Rows held by a view.", "1")),
+      view_bytes(MeasureInt64::Register(
+          kSelfViewBytes, "Approximate bytes held by a view's data.", "By")),
+      delta_bytes(MeasureInt64::Register(
+          kSelfDeltaBytes,
+          "Approximate bytes held by the stats recording buffers.", "By")),
+      span_store_spans(MeasureInt64::Register(
+          kSelfSpanStoreSpans, "Spans held by a span store.", "1")),
+      span_store_bytes(MeasureInt64::Register(
+          kSelfSpanStoreBytes, "Approximate bytes held by a span store.",
+          "By")),
+      exporter_key(opencensus::tags::TagKey::Register(kSelfExporterKey)),
+      view_key(opencensus::tags::TagKey::Register(kSelfViewKey)),
+      delta_key(opencensus::tags::TagKey::Register(kSelfDeltaKey)),
+      span_store_key(opencensus::tags::TagKey::Register(kSelfSpanStoreKey)) {}
+
+const SelfStats& GetSelfStats() {
+  static const SelfStats* self_stats = new SelfStats;
+  return *self_stats;
+}
+
+void RecordSelfStat(common::SelfMetric metric, double value,
+                    absl::string_view label) {
+  const SelfStats& stats = GetSelfStats();
+  DeltaProducer* producer = DeltaProducer::Get();
+  const int64_t count = static_cast<int64_t>(value);
+  switch (metric) {
+    case common::SelfMetric::kSpansDropped:
+      producer->RecordSelf({{stats.spans_dropped, count}}, {});
+      return;
+    case common::SelfMetric::kSpanExportQueueDepth:
+      producer->RecordSelf({{stats.span_export_queue_depth, count}}, {});
+      return;
+    case common::SelfMetric::kSpanBacklogHalvings:
+      producer->RecordSelf({{stats.span_backlog_halvings, count}}, {});
+      return;
+    case common::SelfMetric::kMergeDeltaLatency:
+      producer->RecordSelf({{stats.merge_delta_latency, value}}, {});
+      return;
+    case common::SelfMetric::kDeltaTagSets:
+      producer->RecordSelf({{stats.delta_tag_sets, count}}, {});
+      return;
+    case common::SelfMetric::kHarvestLag:
+      producer->RecordSelf({{stats.harvest_lag, value}}, {});
+      return;
+    case common::SelfMetric::kStatsExportLatency:
+      producer->RecordSelf({{stats.stats_export_latency, value}}, {});
+      return;
+    case common::SelfMetric::kStatsExportOverruns:
+      producer->RecordSelf({{stats.stats_export_overruns, count}}, {});
+      return;
+    case common::SelfMetric::kExporterRpcLatency:
+      producer->RecordSelf({{stats.exporter_rpc_latency, value}},
+                           {{stats.exporter_key, label}});
+      return;
+    case common::SelfMetric::kExporterRpcErrors:
+      producer->RecordSelf({{stats.exporter_rpc_errors, count}},
+                           {{stats.exporter_key, label}});
+      return;
+    case common::SelfMetric::kViewRows:
+      producer->RecordSelf({{stats.view_rows, count}},
+                           {{stats.view_key, label}});
+      return;
+    case common::SelfMetric::kViewBytes:
+      producer->RecordSelf({{stats.view_bytes, count}},
+                           {{stats.view_key, label}});
+      return;
+    case common::SelfMetric::kDeltaBytes:
+      producer->RecordSelf({{stats.delta_bytes, count}},
+                           {{stats.delta_key, label}});
+      return;
+    case common::SelfMetric::kSpanStoreSpans:
+      producer->RecordSelf({{stats.span_store_spans, count}},
+                           {{stats.span_store_key, label}});
+      return;
+    case common::SelfMetric::kSpanStoreBytes:
+      producer->RecordSelf({{stats.span_store_bytes, count}},
+                           {{stats.span_store_key, label}});
+      return;
+  }
+}
+
+void RegisterView(absl::string_view name, const Aggregation& aggregation,
+                  absl::string_view description) {
+  ViewDescriptor()
+      .set_name(name)
+      .set_measure(name)
+      .set_aggregation(aggregation)
+      .set_description(description)
+      .RegisterForExport();
+}
+
+void RegisterLabeledView(absl::string_view name,
+                         const Aggregation& aggregation,
+                         absl::string_view description,
+                         opencensus::tags::TagKey key) {
+  ViewDescriptor()
+      .set_name(name)
+      .set_measure(name)
+      .set_aggregation(aggregation)
+      .set_description(description)
+      .add_column(key)
+      .RegisterForExport();
+}
+
+}  // namespace
+
+void RegisterSelfStatsViewsForExport() {
+  static const bool registered = [] {
+    const SelfStats& stats = GetSelfStats();
+    // 0.01ms to about 10s.
+    const Aggregation latency = Aggregation::Distribution(
+        BucketBoundaries::Exponential(20, 0.01, 2));
+    // 1 to about 1M.
+    const Aggregation size =
+        Aggregation::Distribution(BucketBoundaries::Exponential(20, 1, 2));
+    RegisterView(kSelfSpansDropped, Aggregation::Sum(),
+                 "Cumulative spans dropped before export.");
+    RegisterView(kSelfSpanExportQueueDepth, size,
+                 "Distribution of the span export queue depth.");
+    RegisterView(kSelfSpanBacklogHalvings, Aggregation::LastValue(),
+                 "Halvings of the sampling probability for the span export "
+                 "backlog.");
+    RegisterView(kSelfMergeDeltaLatency, latency,
+                 "Distribution of stats merge latency.");
+    RegisterView(kSelfDeltaTagSets, size,
+                 "Distribution of tag sets per stats harvest.");
+    RegisterView(kSelfHarvestLag, latency,
+                 "Distribution of stats harvest lag.");
+    RegisterView(kSelfStatsExportLatency, latency,
+                 "Distribution of stats export latency.");
+    RegisterView(kSelfStatsExportOverruns, Aggregation::Sum(),
+                 "Cumulative stats export handler overruns.");
+    RegisterLabeledView(kSelfExporterRpcLatency, latency,
+                        "Distribution of exporter RPC latency by exporter.",
+                        stats.exporter_key);
+    RegisterLabeledView(kSelfExporterRpcErrors, Aggregation::Sum(),
+                        "Cumulative failed exporter RPCs by exporter.",
+                        stats.exporter_key);
+    RegisterLabeledView(kSelfViewRows, Aggregation::LastValue(),
+                        "Rows held by each view.", stats.view_key);
+    RegisterLabeledView(kSelfViewBytes, Aggregation::LastValue(),
+                        "Approximate bytes held by each view's data.",
+                        stats.view_key);
+    RegisterLabeledView(kSelfDeltaBytes, Aggregation::LastValue(),
+                        "Approximate bytes held by the active and last "
+                        "stats recording buffers.",
+                        stats.delta_key);
+    RegisterLabeledView(kSelfSpanStoreSpans, Aggregation::LastValue(),
+                        "Spans held by each span store.",
+                        stats.span_store_key);
+    RegisterLabeledView(kSelfSpanStoreBytes, Aggregation::LastValue(),
+                        "Approximate bytes held by each span store.",
+                        stats.span_store_key);
+    common::SetSelfMetricSink(&RecordSelfStat);
+    return true;
+  }();
+  (void)registered;
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,65 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OPENCENSUS_STATS_INTERNAL_SELF_STATS_H_
+#define OPENCENSUS_STATS_INTERNAL_SELF_STATS_H_
+
+namespace opencensus {
+namespace stats {
+
+// The names of the library's own measures, each with a view of the same name.
+// See common::SelfMetric for what they measure.
+constexpr char kSelfSpansDropped[] =
+    "opencensus.io/internal/trace/dropped_spans";
+constexpr char kSelfSpanExportQueueDepth[] =
+    "opencensus.io/internal/trace/export_queue_depth";
+constexpr char kSelfSpanBacklogHalvings[] =
+    "opencensus.io/internal/trace/backlog_sampling_halvings";
+constexpr char kSelfMergeDeltaLatency[] =
+    "opencensus.io/internal/stats/merge_delta_latency";
+constexpr char kSelfDeltaTagSets[] =
+    "opencensus.io/internal/stats/delta_tag_sets";
+constexpr char kSelfHarvestLag[] = "opencensus.io/internal/stats/harvest_lag";
+constexpr char kSelfStatsExportLatency[] =
+    "opencensus.io/internal/stats/export_latency";
+constexpr char kSelfStatsExportOverruns[] =
+    "opencensus.io/internal/stats/export_overruns";
+constexpr char kSelfExporterRpcLatency[] =
+    "opencensus.io/internal/exporter/rpc_latency";
+constexpr char kSelfExporterRpcErrors[] =
+    "opencensus.io/internal/exporter/rpc_errors";
+constexpr char kSelfViewRows[] = "opencensus.io/internal/stats/view_rows";
+constexpr char kSelfViewBytes[] = "opencensus.io/internal/stats/view_bytes";
+constexpr char kSelfDeltaBytes[] = "opencensus.io/internal/stats/delta_bytes";
+constexpr char kSelfSpanStoreSpans[] =
+    "opencensus.io/internal/trace/span_store_spans";
+constexpr char kSelfSpanStoreBytes[] =
+    "opencensus.io/internal/trace/span_store_bytes";
+// The tag keys of the exporter RPC, view memory, delta memory, and span store
+// views.
+constexpr char kSelfExporterKey[] = "opencensus_exporter";
+constexpr char kSelfViewKey[] = "opencensus_view";
+constexpr char kSelfDeltaKey[] = "opencensus_delta";
+constexpr char kSelfSpanStoreKey[] = "opencensus_span_store";
+
+// Registers the self-stats measures and views if not already registered, and
+// installs the common::SelfMetric sink recording them through
+// DeltaProducer::RecordSelf().
+void RegisterSelfStatsViewsForExport();
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_SELF_STATS_H_
@@ -0,0 +1,83 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/shared_stats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/shared_stats_region.h"
+#include "opencensus/stats/internal/stats_exporter_impl.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// Set once by Initialize() and never freed, since processes forked from the
+// one that mapped it use it for their lifetime.
+std::atomic<SharedStatsRegion*> region{nullptr};
+
+}  // namespace
+
+// static
+bool SharedStats::Initialize(const SharedStatsOptions& options) {
+  if (region.load(std::memory_order_acquire) != nullptr) {
+    return false;
+  }
+  std::unique_ptr<SharedStatsRegion> created = SharedStatsRegion::Create(
+      options.max_rows, options.max_key_bytes, options.max_histogram_buckets);
+  if (created == nullptr) {
+    return false;
+  }
+  SharedStatsRegion* expected = nullptr;
+  if (!region.compare_exchange_strong(expected, created.get(),
+                                      std::memory_order_acq_rel)) {
+    return false;
+  }
+  created.release();
+  return true;
+}
+
+// static
+bool SharedStats::StartPublishing() {
+  SharedStatsRegion* shared = region.load(std::memory_order_acquire);
+  if (shared == nullptr) {
+    return false;
+  }
+  StatsExporterImpl::Get()->StopExports();
+  DeltaProducer::Get()->PublishTo(shared);
+  return true;
+}
+
+// static
+bool SharedStats::StartCollecting() {
+  SharedStatsRegion* shared = region.load(std::memory_order_acquire);
+  if (shared == nullptr) {
+    return false;
+  }
+  DeltaProducer::Get()->CollectFrom(shared);
+  return true;
+}
+
+// static
+uint64_t SharedStats::NumDroppedRows() {
+  SharedStatsRegion* shared = region.load(std::memory_order_acquire);
+  return shared == nullptr ? 0 : shared->num_dropped();
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,397 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/shared_stats_region.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+// The atomics below are used across processes, which requires them to be
+// lock-free.
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "SharedStatsRegion requires lock-free atomics");
+
+struct SharedStatsRegion::Header {
+  uint64_t max_rows;
+  uint64_t max_key_bytes;
+  uint64_t max_buckets;
+  std::atomic<uint64_t> num_rows;
+  std::atomic<uint64_t> num_dropped;
+};
+
+// Followed by the key, of up to max_key_bytes, and max_buckets histogram
+// counts.
+struct SharedStatsRegion::Row {
+  enum State : uint32_t { kUnpublished = 0, kReady };
+
+  // Set once the row is published in the index, for Drain().
+  std::atomic<uint32_t> state;
+  std::atomic<uint32_t> lock;
+  uint64_t hash;
+  // Identifies the bucket boundaries of the histogram counts, or 0 if the row
+  // has none. The fields up to the summary, and the key, are written before
+  // the row is published and never change.
+  uint64_t layout;
+  uint32_t key_size;
+  uint32_t num_buckets;
+  MeasureData::Summary summary;
+
+  char* key() { return reinterpret_cast<char*>(this + 1); }
+  const char* key() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+namespace {
+
+constexpr size_t kCacheLine = 64;
+// Spins before giving up on a row lock, yielding after the first few.
+constexpr int kLockSpins = 1000;
+constexpr int kLockSpinsBeforeYield = 16;
+
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// 64-bit FNV-1a, which unlike absl::Hash is the same in every process.
+uint64_t Fnv1a(const void* data, size_t size,
+               uint64_t hash = 0xcbf29ce484222325ull) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Identifies the histogram layout of a measure with 'boundaries', or returns 0
+// if it has none.
+uint64_t HistogramLayout(const std::vector<BucketBoundaries>& boundaries) {
+  if (boundaries.empty()) {
+    return 0;
+  }
+  uint64_t hash = Fnv1a(nullptr, 0);
+  for (const auto& b : boundaries) {
+    const uint64_t size = b.lower_boundaries().size();
+    hash = Fnv1a(&size, sizeof(size), hash);
+    hash = Fnv1a(b.lower_boundaries().data(), size * sizeof(double), hash);
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+void AppendString(absl::string_view s, std::string* key) {
+  const uint32_t size = s.size();
+  key->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  key->append(s.data(), s.size());
+}
+
+// Reads a string written by AppendString() from the front of *key.
+bool ConsumeString(absl::string_view* key, absl::string_view* s) {
+  uint32_t size;
+  if (key->size() < sizeof(size)) {
+    return false;
+  }
+  memcpy(&size, key->data(), sizeof(size));
+  key->remove_prefix(sizeof(size));
+  if (key->size() < size) {
+    return false;
+  }
+  *s = key->substr(0, size);
+  key->remove_prefix(size);
+  return true;
+}
+
+bool TryLock(std::atomic<uint32_t>* lock) {
+  for (int i = 0; i < kLockSpins; ++i) {
+    if (lock->load(std::memory_order_relaxed) == 0 &&
+        lock->exchange(1, std::memory_order_acquire) == 0) {
+      return true;
+    }
+    if (i >= kLockSpinsBeforeYield) {
+      sched_yield();
+    }
+  }
+  return false;
+}
+
+void Unlock(std::atomic<uint32_t>* lock) {
+  lock->store(0, std::memory_order_release);
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<SharedStatsRegion> SharedStatsRegion::Create(
+    size_t max_rows, size_t max_key_bytes, size_t max_histogram_buckets) {
+  // Keep the index at most half full.
+  size_t num_slots = 1;
+  while (num_slots < 2 * max_rows) {
+    num_slots *= 2;
+  }
+  const size_t row_stride =
+      RoundUp(sizeof(Row) + RoundUp(max_key_bytes, sizeof(int64_t)) +
+                  max_histogram_buckets * sizeof(int64_t),
+              kCacheLine);
+  const size_t rows_offset =
+      RoundUp(RoundUp(sizeof(Header), kCacheLine) +
+                  num_slots * sizeof(std::atomic<uint32_t>),
+              kCacheLine);
+  const size_t size = rows_offset + max_rows * row_stride;
+  // Anonymous shared memory is zero-filled and only committed when touched.
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+  Header* header = new (base) Header;
+  header->max_rows = max_rows;
+  header->max_key_bytes = max_key_bytes;
+  header->max_buckets = max_histogram_buckets;
+  header->num_rows.store(0, std::memory_order_relaxed);
+  header->num_dropped.store(0, std::memory_order_relaxed);
+  return absl::WrapUnique(new SharedStatsRegion(base, size, num_slots,
+                                                rows_offset, row_stride));
+}
+
+SharedStatsRegion::SharedStatsRegion(void* base, size_t size, size_t num_slots,
+                                     size_t rows_offset, size_t row_stride)
+    : base_(base),
+      size_(size),
+      header_(static_cast<Header*>(base)),
+      slots_(reinterpret_cast<std::atomic<uint32_t>*>(
+          static_cast<char*>(base) + RoundUp(sizeof(Header), kCacheLine))),
+      num_slots_(num_slots),
+      rows_(static_cast<char*>(base) + rows_offset),
+      row_stride_(row_stride) {}
+
+SharedStatsRegion::~SharedStatsRegion() { munmap(base_, size_); }
+
+uint64_t SharedStatsRegion::num_rows() const {
+  return std::min(header_->num_rows.load(std::memory_order_relaxed),
+                  header_->max_rows);
+}
+
+uint64_t SharedStatsRegion::num_dropped() const {
+  return header_->num_dropped.load(std::memory_order_relaxed);
+}
+
+SharedStatsRegion::Row* SharedStatsRegion::row(size_t index) const {
+  return reinterpret_cast<Row*>(rows_ + index * row_stride_);
+}
+
+int64_t* SharedStatsRegion::buckets(Row* r) const {
+  return reinterpret_cast<int64_t*>(
+      r->key() + RoundUp(header_->max_key_bytes, sizeof(int64_t)));
+}
+
+SharedStatsRegion::Row* SharedStatsRegion::FindOrAddRow(absl::string_view key,
+                                                        uint64_t hash,
+                                                        uint64_t layout,
+                                                        uint32_t num_buckets) {
+  // A row allocated for 'key' but not yet published in the index.
+  uint32_t added = 0;
+  const size_t mask = num_slots_ - 1;
+  for (size_t i = 0; i < num_slots_; ++i) {
+    std::atomic<uint32_t>& slot = slots_[(hash + i) & mask];
+    uint32_t entry = slot.load(std::memory_order_acquire);
+    if (entry == 0) {
+      if (added == 0) {
+        const uint64_t index =
+            header_->num_rows.fetch_add(1, std::memory_order_relaxed);
+        if (index >= header_->max_rows) {
+          return nullptr;
+        }
+        added = index + 1;
+        Row* r = row(index);
+        r->hash = hash;
+        r->layout = layout;
+        r->key_size = key.size();
+        r->num_buckets = num_buckets;
+        r->summary = MeasureData::EmptySummary();
+        memcpy(r->key(), key.data(), key.size());
+      }
+      if (slot.compare_exchange_strong(entry, added,
+                                       std::memory_order_acq_rel)) {
+        Row* r = row(added - 1);
+        r->state.store(Row::kReady, std::memory_order_release);
+        return r;
+      }
+      // Another process published a row in the slot; 'entry' holds it.
+    }
+    Row* r = row(entry - 1);
+    if (r->hash == hash && absl::string_view(r->key(), r->key_size) == key) {
+      // A row allocated here for the same key is never published, and so
+      // never drained.
+      return r;
+    }
+  }
+  return nullptr;
+}
+
+void SharedStatsRegion::Publish(const Delta& delta) {
+  const DeltaConfig& config = delta.config();
+  const MeasureRegistryImpl* registry = MeasureRegistryImpl::Get();
+  // Layouts are computed once per measure per call.
+  std::vector<uint64_t> layouts(config.measures.size(), 0);
+  std::vector<bool> have_layouts(config.measures.size(), false);
+  uint64_t num_dropped = 0;
+  for (const auto& entry : delta.delta()) {
+    const std::vector<MeasureData>& row_data = entry.second;
+    for (size_t index = 0; index < row_data.size(); ++index) {
+      const MeasureData& data = row_data[index];
+      if (data.count() == 0 || index >= config.measures.size() ||
+          !config.measures[index].has_views) {
+        continue;
+      }
+      key_.clear();
+      AppendString(registry->GetDescriptorByIndex(index).name(), &key_);
+      for (const auto& tag : entry.first.tag_views()) {
+        AppendString(tag.first.name(), &key_);
+        AppendString(tag.second, &key_);
+      }
+      if (key_.size() > header_->max_key_bytes) {
+        ++num_dropped;
+        continue;
+      }
+      if (!have_layouts[index]) {
+        have_layouts[index] = true;
+        layouts[index] =
+            data.num_histogram_buckets() <= header_->max_buckets
+                ? HistogramLayout(config.measures[index].boundaries)
+                : 0;
+      }
+      const uint64_t layout = layouts[index];
+      const uint32_t num_buckets =
+          layout == 0 ? 0 : data.num_histogram_buckets();
+      Row* r = FindOrAddRow(key_, Fnv1a(key_.data(), key_.size()), layout,
+                            num_buckets);
+      if (r == nullptr || !TryLock(&r->lock)) {
+        ++num_dropped;
+        continue;
+      }
+      // Without a matching layout the row's histogram counts fall short of its
+      // count, which Drain() detects.
+      const bool add_histogram =
+          layout != 0 && r->layout == layout && r->num_buckets == num_buckets;
+      data.AddToSummary(&r->summary,
+                        add_histogram
+                            ? absl::Span<int64_t>(buckets(r), num_buckets)
+                            : absl::Span<int64_t>());
+      Unlock(&r->lock);
+    }
+  }
+  if (num_dropped > 0) {
+    header_->num_dropped.fetch_add(num_dropped, std::memory_order_relaxed);
+  }
+}
+
+const SharedStatsRegion::ParsedKey* SharedStatsRegion::GetParsedKey(
+    size_t index, const Row& row) {
+  if (parsed_keys_.size() <= index) {
+    parsed_keys_.resize(index + 1);
+  }
+  if (parsed_keys_[index] != nullptr) {
+    return parsed_keys_[index].get();
+  }
+  absl::string_view key(row.key(), row.key_size);
+  absl::string_view name;
+  if (!ConsumeString(&key, &name)) {
+    return nullptr;
+  }
+  const uint64_t id = MeasureRegistryImpl::Get()->GetIdByName(name);
+  if (!MeasureRegistryImpl::IdValid(id)) {
+    // The measure may be registered later.
+    return nullptr;
+  }
+  std::vector<std::pair<opencensus::tags::TagKey, std::string>> tags;
+  absl::string_view tag_key;
+  absl::string_view tag_value;
+  while (ConsumeString(&key, &tag_key) && ConsumeString(&key, &tag_value)) {
+    tags.emplace_back(opencensus::tags::TagKey::Register(tag_key),
+                      std::string(tag_value));
+  }
+  parsed_keys_[index] = absl::make_unique<ParsedKey>(
+      ParsedKey{MeasureRegistryImpl::IdToIndex(id),
+                opencensus::tags::TagMap(std::move(tags))});
+  return parsed_keys_[index].get();
+}
+
+void SharedStatsRegion::Drain(Delta* delta) {
+  const DeltaConfig& config = delta->config();
+  const size_t num_rows = this->num_rows();
+  for (size_t index = 0; index < num_rows; ++index) {
+    Row* r = row(index);
+    if (r->state.load(std::memory_order_acquire) != Row::kReady) {
+      continue;
+    }
+    if (!TryLock(&r->lock)) {
+      continue;
+    }
+    const MeasureData::Summary summary = r->summary;
+    if (summary.count == 0) {
+      Unlock(&r->lock);
+      continue;
+    }
+    r->summary = MeasureData::EmptySummary();
+    int64_t* counts = buckets(r);
+    histogram_.assign(counts, counts + r->num_buckets);
+    std::fill(counts, counts + r->num_buckets, 0);
+    Unlock(&r->lock);
+
+    const ParsedKey* key = GetParsedKey(index, *r);
+    if (key == nullptr || key->measure_index >= config.measures.size() ||
+        !config.measures[key->measure_index].has_views) {
+      continue;
+    }
+    // Use the histogram only if it has this process's layout and every value
+    // was counted in it.
+    int64_t histogram_count = 0;
+    for (int64_t count : histogram_) {
+      histogram_count += count;
+    }
+    const bool use_histogram =
+        r->layout != 0 &&
+        r->layout ==
+            HistogramLayout(config.measures[key->measure_index].boundaries) &&
+        static_cast<uint64_t>(histogram_count) == summary.count;
+    std::vector<MeasureData>* row_data = delta->FindOrAddRow(key->tags);
+    (*row_data)[key->measure_index].AddSummary(
+        summary, use_histogram ? absl::Span<const int64_t>(histogram_)
+                               : absl::Span<const int64_t>());
+  }
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,121 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_SHARED_STATS_REGION_H_
+#define OPENCENSUS_STATS_INTERNAL_SHARED_STATS_REGION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+// SharedStatsRegion accumulates deltas in memory shared by a process and the
+// children it forks, as an array of rows keyed on a measure name and tag set,
+// indexed by an open-addressing hash table of row numbers. Each row holds a
+// MeasureData::Summary and histogram counts, guarded by a spinlock in the row.
+// Rows are added by the first process to publish their key and never removed,
+// so that the key of a row never changes once published; publishers and the
+// collector only lock a row to add to or drain its values. A process that dies holding a row's lock leaves the row locked:
+// later attempts to lock it give up after a bounded wait, and its data is
+// dropped.
+//
+// Histogram counts are shared only between processes whose views give the
+// measure the same bucket boundaries; otherwise the collector sees the values
+// as all equal to their mean, as it does for the exponential histogram.
+// Exemplars are not shared.
+//
+// Publish() and Drain() are safe to call concurrently from any processes
+// sharing the region, except that Drain() must only be called by one thread
+// of one process at a time.
+class SharedStatsRegion final : public SharedDeltas {
+ public:
+  // Maps a region for 'max_rows' rows, each with a key (the measure name and
+  // tags) of up to 'max_key_bytes' bytes and up to 'max_histogram_buckets'
+  // histogram buckets, which is inherited by processes forked afterwards.
+  // Memory is only committed for rows that are used. Returns nullptr if the
+  // region cannot be mapped.
+  static std::unique_ptr<SharedStatsRegion> Create(
+      size_t max_rows, size_t max_key_bytes, size_t max_histogram_buckets);
+  ~SharedStatsRegion() override;
+
+  SharedStatsRegion(const SharedStatsRegion&) = delete;
+  SharedStatsRegion& operator=(const SharedStatsRegion&) = delete;
+
+  // Adds the data of each measure with views in 'delta'. Data for rows that
+  // cannot be added (the table is full or the key too long) or locked is
+  // dropped and counted in num_dropped().
+  void Publish(const Delta& delta) override;
+  // Moves the data of each row into 'delta', for the measures that have views
+  // in its configuration; the data of other measures is discarded.
+  void Drain(Delta* delta) override;
+
+  // The number of rows added, by all processes.
+  uint64_t num_rows() const;
+  // The number of measure rows of published deltas that were dropped, by all
+  // processes.
+  uint64_t num_dropped() const;
+
+ private:
+  struct Header;
+  struct Row;
+
+  // A drained row's measure and tags, parsed from its key once.
+  struct ParsedKey {
+    uint64_t measure_index;
+    opencensus::tags::TagMap tags;
+  };
+
+  SharedStatsRegion(void* base, size_t size, size_t num_slots,
+                    size_t rows_offset, size_t row_stride);
+
+  Row* row(size_t index) const;
+  // The histogram counts of 'r'.
+  int64_t* buckets(Row* r) const;
+  // Returns the row for 'key', adding it with 'layout' and 'num_buckets' if it
+  // does not exist, or nullptr if the table is full.
+  Row* FindOrAddRow(absl::string_view key, uint64_t hash, uint64_t layout,
+                    uint32_t num_buckets);
+  // Returns the parsed key of the row 'index', or nullptr if its measure is
+  // not registered in this process.
+  const ParsedKey* GetParsedKey(size_t index, const Row& row);
+
+  void* const base_;
+  const size_t size_;
+  Header* const header_;
+  // The index: row number + 1, or 0 for an empty slot.
+  std::atomic<uint32_t>* const slots_;
+  const size_t num_slots_;
+  char* const rows_;
+  const size_t row_stride_;
+
+  // Scratch space for Publish(), which is only called by the harvest task.
+  std::string key_;
+  // Only accessed by Drain(). parsed_keys_ is indexed by row.
+  std::vector<int64_t> histogram_;
+  std::vector<std::unique_ptr<ParsedKey>> parsed_keys_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_SHARED_STATS_REGION_H_
@@ -0,0 +1,193 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/shared_stats_region.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+MeasureDouble TestMeasure() {
+  static const MeasureDouble measure =
+      MeasureDouble::Register("shared_stats_region_test/latency", "", "ms");
+  return measure;
+}
+
+opencensus::tags::TagKey MethodKey() {
+  static const auto key = opencensus::tags::TagKey::Register("method");
+  return key;
+}
+
+// Returns a configuration recording TestMeasure() with 'boundaries', under
+// the method tag.
+std::shared_ptr<const DeltaConfig> MakeConfig(
+    std::vector<BucketBoundaries> boundaries) {
+  auto config = std::make_shared<DeltaConfig>();
+  const uint64_t index = MeasureRegistryImpl::MeasureToIndex(TestMeasure());
+  config->measures.resize(index + 1);
+  config->measures[index].has_views = true;
+  config->measures[index].boundaries = std::move(boundaries);
+  config->columns = {MethodKey()};
+  return config;
+}
+
+std::unique_ptr<Delta> MakeDelta(
+    const std::shared_ptr<const DeltaConfig>& config) {
+  auto delta = std::unique_ptr<Delta>(new Delta);
+  Delta empty;
+  delta->SwapAndReset(config, &empty);
+  return delta;
+}
+
+const MeasureData* FindData(const Delta& delta,
+                            const opencensus::tags::TagMap& tags) {
+  const auto it = delta.delta().find(tags);
+  if (it == delta.delta().end()) return nullptr;
+  return &it->second[MeasureRegistryImpl::MeasureToIndex(TestMeasure())];
+}
+
+std::vector<uint64_t> Histogram(const MeasureData& data,
+                                const BucketBoundaries& boundaries) {
+  uint64_t count = 0;
+  double mean = 0;
+  double sum_of_squared_deviation = 0;
+  double min = 0;
+  double max = 0;
+  std::vector<uint64_t> buckets(boundaries.num_buckets());
+  data.AddToDistribution(boundaries, &count, &mean, &sum_of_squared_deviation,
+                         &min, &max, absl::Span<uint64_t>(buckets));
+  return buckets;
+}
+
+TEST(SharedStatsRegionTest, PublishAndDrain) {
+  const BucketBoundaries boundaries = BucketBoundaries::Explicit({10});
+  const auto config = MakeConfig({boundaries});
+  auto region = SharedStatsRegion::Create(16, 256, 16);
+  ASSERT_NE(nullptr, region);
+
+  auto delta = MakeDelta(config);
+  const opencensus::tags::TagMap get({{MethodKey(), "Get"}});
+  delta->Record({{TestMeasure(), 5.0}, {TestMeasure(), 15.0}}, get);
+  region->Publish(*delta);
+  region->Publish(*delta);
+  EXPECT_EQ(1, region->num_rows());
+
+  auto drained = MakeDelta(config);
+  region->Drain(drained.get());
+  const MeasureData* data = FindData(*drained, get);
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(4, data->count());
+  EXPECT_DOUBLE_EQ(40, data->sum());
+  EXPECT_THAT(Histogram(*data, boundaries), ::testing::ElementsAre(2, 2));
+
+  // Draining moves the data.
+  auto empty = MakeDelta(config);
+  region->Drain(empty.get());
+  EXPECT_TRUE(empty->delta().empty());
+  EXPECT_EQ(0, region->num_dropped());
+}
+
+TEST(SharedStatsRegionTest, PublishesFromChildProcesses) {
+  const BucketBoundaries boundaries = BucketBoundaries::Explicit({10});
+  const auto config = MakeConfig({boundaries});
+  auto region = SharedStatsRegion::Create(16, 256, 16);
+  ASSERT_NE(nullptr, region);
+
+  const int kChildren = 3;
+  for (int i = 0; i < kChildren; ++i) {
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      auto delta = MakeDelta(config);
+      delta->Record({{TestMeasure(), 1.0 + i * 10}},
+                    {{MethodKey(), i == 0 ? "Get" : "Put"}});
+      region->Publish(*delta);
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+  }
+
+  auto drained = MakeDelta(config);
+  region->Drain(drained.get());
+  const MeasureData* get = FindData(*drained, {{MethodKey(), "Get"}});
+  const MeasureData* put = FindData(*drained, {{MethodKey(), "Put"}});
+  ASSERT_NE(nullptr, get);
+  ASSERT_NE(nullptr, put);
+  EXPECT_EQ(1, get->count());
+  EXPECT_EQ(2, put->count());
+  EXPECT_DOUBLE_EQ(32, put->sum());
+  EXPECT_THAT(Histogram(*put, boundaries), ::testing::ElementsAre(0, 2));
+}
+
+TEST(SharedStatsRegionTest, OtherBoundariesCountTheMean) {
+  const BucketBoundaries published = BucketBoundaries::Explicit({10});
+  const BucketBoundaries collected = BucketBoundaries::Explicit({1, 100});
+  auto region = SharedStatsRegion::Create(16, 256, 16);
+  ASSERT_NE(nullptr, region);
+
+  auto delta = MakeDelta(MakeConfig({published}));
+  const opencensus::tags::TagMap tags({{MethodKey(), "Get"}});
+  delta->Record({{TestMeasure(), 5.0}, {TestMeasure(), 15.0}}, tags);
+  region->Publish(*delta);
+
+  auto drained = MakeDelta(MakeConfig({collected}));
+  region->Drain(drained.get());
+  const MeasureData* data = FindData(*drained, tags);
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(2, data->count());
+  // Both values count in the bucket of their mean, 10.
+  EXPECT_THAT(Histogram(*data, collected), ::testing::ElementsAre(0, 2, 0));
+}
+
+TEST(SharedStatsRegionTest, DropsRowsPastCapacity) {
+  const auto config = MakeConfig({});
+  auto region = SharedStatsRegion::Create(1, 256, 0);
+  ASSERT_NE(nullptr, region);
+
+  auto delta = MakeDelta(config);
+  delta->Record({{TestMeasure(), 1.0}}, {{MethodKey(), "Get"}});
+  delta->Record({{TestMeasure(), 1.0}}, {{MethodKey(), "Put"}});
+  region->Publish(*delta);
+  EXPECT_EQ(1, region->num_rows());
+  EXPECT_EQ(1, region->num_dropped());
+
+  auto drained = MakeDelta(config);
+  region->Drain(drained.get());
+  EXPECT_EQ(1, drained->delta().size());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,308 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A long-running soak of stats and tracing, for finding slow leaks and
+// unbounded growth that short benchmarks miss. Worker threads record
+// measurements under churning tag values and start spans with churning names,
+// each inside a WithTagMap and WithSpan, and exit after a while to be replaced
+// by new threads, so that per-thread state (e.g. each thread's Context) is
+// created and destroyed throughout. The stats and span exporters stall
+// periodically, as during a backend outage. Every report interval the process
+// prints its resident and heap memory alongside the sizes of the library's
+// stores: view rows and bytes, recording buffer tag sets, span names in the
+// running and local span stores, and the spans awaiting export.
+//
+// Usage: soak_benchmark [hours [threads [max_rss_growth_mb]]]
+//
+// Runs for 'hours' (default 1, fractions allowed) with 'threads' worker
+// threads (default 4). Memory is expected to level off once the tag values
+// and span names have all been seen and the views have reached their row
+// limits: if 'max_rss_growth_mb' is given, the run fails if the resident set
+// grows by more than that between the end of the warmup (the first tenth of
+// the run) and the end of the run.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/common/internal/process_memory.h"
+#include "opencensus/common/internal/random.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_config.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/internal/local_span_store.h"
+#include "opencensus/trace/internal/running_span_store.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/with_span.h"
+
+namespace opencensus {
+namespace {
+
+// How many operations a worker thread runs before it exits and is replaced,
+// and how often it runs them, so that the load is steady rather than as much
+// as the machine allows.
+constexpr int kOperationsPerThread = 10000;
+constexpr absl::Duration kOperationInterval = absl::Microseconds(200);
+// Tag values are drawn from this many, more than the views keep rows for.
+constexpr uint32_t kNumTagValues = 1000000;
+// Span names are drawn from this many.
+constexpr uint32_t kNumSpanNames = 10000;
+// The row limit of the capped view.
+constexpr int kMaxRows = 1000;
+// How long rows of the expiring view last without data.
+constexpr absl::Duration kRowTtl = absl::Minutes(1);
+// Every kStallPeriod, the exporters stall for kStallDuration.
+constexpr absl::Duration kStallPeriod = absl::Minutes(5);
+constexpr absl::Duration kStallDuration = absl::Seconds(30);
+constexpr absl::Duration kReportInterval = absl::Seconds(10);
+
+std::atomic<bool> exporters_stalled{false};
+std::atomic<bool> stopping{false};
+std::atomic<uint64_t> threads_started{0};
+std::atomic<uint64_t> spans_ended{0};
+std::atomic<uint64_t> spans_exported{0};
+
+// Blocks the calling exporter thread while the exporters are stalled.
+void WaitWhileStalled() {
+  while (exporters_stalled.load(std::memory_order_relaxed) &&
+         !stopping.load(std::memory_order_relaxed)) {
+    absl::SleepFor(absl::Milliseconds(100));
+  }
+}
+
+class StallingSpanHandler : public trace::exporter::SpanExporter::Handler {
+ public:
+  void Export(const std::vector<trace::exporter::SpanData>& spans) override {
+    WaitWhileStalled();
+    spans_exported.fetch_add(spans.size(), std::memory_order_relaxed);
+  }
+};
+
+class StallingStatsHandler : public stats::StatsExporter::Handler {
+ public:
+  void ExportViewData(
+      const std::vector<std::pair<stats::ViewDescriptor, stats::ViewData>>&
+      /*data*/) override {
+    WaitWhileStalled();
+  }
+  absl::Duration ExportInterval() const override { return absl::Seconds(1); }
+};
+
+stats::MeasureDouble SoakMeasure() {
+  static const stats::MeasureDouble measure =
+      stats::MeasureDouble::Register("soak/latency", "", "ms");
+  return measure;
+}
+
+tags::TagKey SoakKey() {
+  static const tags::TagKey key = tags::TagKey::Register("soak_key");
+  return key;
+}
+
+void RegisterViews() {
+  stats::ViewDescriptor()
+      .set_name("soak/capped")
+      .set_measure("soak/latency")
+      .set_aggregation(stats::Aggregation::Count())
+      .add_column(SoakKey())
+      .set_max_rows(kMaxRows)
+      .RegisterForExport();
+  stats::ViewDescriptor()
+      .set_name("soak/expiring")
+      .set_measure("soak/latency")
+      .set_aggregation(stats::Aggregation::Sum())
+      .add_column(SoakKey())
+      .set_row_ttl(kRowTtl)
+      .RegisterForExport();
+  stats::ViewDescriptor()
+      .set_name("soak/distribution")
+      .set_measure("soak/latency")
+      .set_aggregation(stats::Aggregation::Distribution(
+          stats::BucketBoundaries::Exponential(20, 0.01, 2)))
+      .RegisterForExport();
+}
+
+void RunWorker() {
+  static trace::AlwaysSampler sampler;
+  threads_started.fetch_add(1, std::memory_order_relaxed);
+  common::Random* random = common::Random::GetRandom();
+  absl::Time next_operation = absl::Now();
+  for (int i = 0;
+       i < kOperationsPerThread && !stopping.load(std::memory_order_relaxed);
+       ++i) {
+    const tags::TagMap tags(
+        {{SoakKey(),
+          absl::StrCat("value", random->GenerateRandom32() % kNumTagValues)}});
+    tags::WithTagMap with_tags(tags);
+    trace::Span span = trace::Span::StartSpan(
+        absl::StrCat("soak/span", random->GenerateRandom32() % kNumSpanNames),
+        nullptr, {&sampler});
+    {
+      trace::WithSpan with_span(span);
+      span.AddAnnotation("operation");
+      stats::Record({{SoakMeasure(), random->GenerateRandomDouble() * 100}});
+    }
+    span.End();
+    spans_ended.fetch_add(1, std::memory_order_relaxed);
+    next_operation += kOperationInterval;
+    absl::SleepFor(next_operation - absl::Now());
+  }
+}
+
+// Runs a worker on each of 'num_threads' threads, replacing each as it exits,
+// until stopping is set.
+void ChurnThreads(int num_threads) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([]() {
+      while (!stopping.load(std::memory_order_relaxed)) {
+        std::thread worker(RunWorker);
+        worker.join();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+struct Sample {
+  int64_t rss_bytes;
+  int64_t heap_bytes;
+  int64_t view_rows = 0;
+  int64_t view_bytes = 0;
+  int64_t delta_tag_sets;
+  size_t running_span_names;
+  size_t local_span_names;
+  int64_t span_backlog;
+};
+
+Sample TakeSample() {
+  Sample sample;
+  sample.rss_bytes = common::ResidentMemoryBytes();
+  sample.heap_bytes = common::HeapBytesInUse();
+  const stats::StatsMemoryUsage usage = stats::StatsConfig::GetMemoryUsage();
+  for (const auto& view : usage.views) {
+    sample.view_rows += view.rows;
+    sample.view_bytes += view.bytes;
+  }
+  sample.delta_tag_sets =
+      usage.active_delta.tag_sets + usage.last_delta.tag_sets;
+  sample.running_span_names = trace::exporter::RunningSpanStore::GetSummary()
+                                  .per_span_name_summary.size();
+  sample.local_span_names = trace::exporter::LocalSpanStore::GetSummary()
+                                .per_span_name_summary.size();
+  sample.span_backlog = static_cast<int64_t>(
+      spans_ended.load(std::memory_order_relaxed) -
+      spans_exported.load(std::memory_order_relaxed) -
+      trace::exporter::SpanExporter::NumDroppedSpans());
+  return sample;
+}
+
+void PrintSample(absl::Duration elapsed, const Sample& sample) {
+  std::printf(
+      "t=%.0fs rss_mb=%.1f heap_mb=%.1f view_rows=%lld view_kb=%.1f "
+      "delta_tag_sets=%lld running_span_names=%zu local_span_names=%zu "
+      "span_backlog=%lld spans_dropped=%llu threads=%llu stalled=%d\n",
+      absl::ToDoubleSeconds(elapsed), sample.rss_bytes / 1048576.0,
+      sample.heap_bytes / 1048576.0,
+      static_cast<long long>(sample.view_rows), sample.view_bytes / 1024.0,
+      static_cast<long long>(sample.delta_tag_sets), sample.running_span_names,
+      sample.local_span_names, static_cast<long long>(sample.span_backlog),
+      static_cast<unsigned long long>(
+          trace::exporter::SpanExporter::NumDroppedSpans()),
+      static_cast<unsigned long long>(
+          threads_started.load(std::memory_order_relaxed)),
+      exporters_stalled.load(std::memory_order_relaxed) ? 1 : 0);
+  std::fflush(stdout);
+}
+
+}  // namespace
+}  // namespace opencensus
+
+int main(int argc, char** argv) {
+  double hours = 1;
+  int num_threads = 4;
+  double max_rss_growth_mb = 0;
+  if (argc > 4 || (argc > 1 && !absl::SimpleAtod(argv[1], &hours)) ||
+      (argc > 2 && !absl::SimpleAtoi(argv[2], &num_threads)) ||
+      (argc > 3 && !absl::SimpleAtod(argv[3], &max_rss_growth_mb))) {
+    std::fprintf(stderr,
+                 "Usage: %s [hours [threads [max_rss_growth_mb]]]\n", argv[0]);
+    return 2;
+  }
+  const absl::Duration duration = absl::Hours(hours);
+  num_threads = std::max(num_threads, 1);
+
+  opencensus::trace::exporter::SpanExporter::RegisterHandler(
+      absl::make_unique<opencensus::StallingSpanHandler>());
+  opencensus::stats::StatsExporter::RegisterPushHandler(
+      absl::make_unique<opencensus::StallingStatsHandler>());
+  opencensus::SoakMeasure();
+  opencensus::RegisterViews();
+
+  const absl::Time start = absl::Now();
+  std::thread churn(opencensus::ChurnThreads, num_threads);
+  int64_t warm_rss_bytes = -1;
+  for (absl::Duration elapsed = absl::ZeroDuration(); elapsed < duration;
+       elapsed = absl::Now() - start) {
+    const absl::Duration in_period = elapsed % opencensus::kStallPeriod;
+    opencensus::exporters_stalled.store(
+        in_period >= opencensus::kStallPeriod - opencensus::kStallDuration,
+        std::memory_order_relaxed);
+    const opencensus::Sample sample = opencensus::TakeSample();
+    opencensus::PrintSample(elapsed, sample);
+    if (warm_rss_bytes < 0 && elapsed >= duration / 10) {
+      warm_rss_bytes = sample.rss_bytes;
+    }
+    absl::SleepFor(std::min(opencensus::kReportInterval, duration - elapsed));
+  }
+  opencensus::stopping = true;
+  opencensus::exporters_stalled = false;
+  churn.join();
+
+  const opencensus::Sample sample = opencensus::TakeSample();
+  opencensus::PrintSample(absl::Now() - start, sample);
+  if (warm_rss_bytes < 0) {
+    warm_rss_bytes = sample.rss_bytes;
+  }
+  const double growth_mb = (sample.rss_bytes - warm_rss_bytes) / 1048576.0;
+  std::printf("rss_growth_after_warmup_mb=%.1f\n", growth_mb);
+  if (max_rss_growth_mb > 0 && growth_mb > max_rss_growth_mb) {
+    std::printf("FAILED: resident memory grew by more than %.1f MB\n",
+                max_rss_growth_mb);
+    return 1;
+  }
+  return 0;
+}
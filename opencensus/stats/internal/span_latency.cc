@@ -0,0 +1,118 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/span_latency.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/internal/span_end_hook.h"
+#include "opencensus/trace/status_code.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// The BoundMeasure of each span name and status seen so far. Span names are
+// interned, so the keys refer to them rather than copying them.
+class SpanLatencyRecorder {
+ public:
+  static SpanLatencyRecorder* Get() {
+    static SpanLatencyRecorder* recorder = new SpanLatencyRecorder;
+    return recorder;
+  }
+
+  void Record(absl::string_view name, trace::StatusCode code,
+              absl::Duration latency) LOCKS_EXCLUDED(mu_) {
+    const double ms = absl::ToDoubleMilliseconds(latency);
+    const Key key(name, code);
+    {
+      absl::ReaderMutexLock l(&mu_);
+      const auto it = bound_.find(key);
+      if (it != bound_.end()) {
+        it->second->Record(ms);
+        return;
+      }
+    }
+    absl::MutexLock l(&mu_);
+    std::unique_ptr<BoundMeasure<double>>& bound = bound_[key];
+    if (bound == nullptr) {
+      bound.reset(new BoundMeasure<double>(
+          measure_,
+          opencensus::tags::TagMap(
+              {{name_key_, std::string(name)},
+               {status_key_,
+                std::string(trace::exporter::Status(code, "")
+                                .CanonicalCodeString())}})));
+    }
+    bound->Record(ms);
+  }
+
+ private:
+  typedef std::pair<absl::string_view, trace::StatusCode> Key;
+
+  SpanLatencyRecorder()
+      : measure_(MeasureDouble::Register(kSpanLatencyMeasureName,
+                                         "Latency of ended spans.", "ms")),
+        name_key_(opencensus::tags::TagKey::Register(kSpanNameTagKey)),
+        status_key_(opencensus::tags::TagKey::Register(kSpanStatusTagKey)) {
+    // 0.01ms to about 3min.
+    ViewDescriptor()
+        .set_name(kSpanLatencyMeasureName)
+        .set_measure(kSpanLatencyMeasureName)
+        .set_aggregation(Aggregation::Distribution(
+            BucketBoundaries::Exponential(25, 0.01, 2)))
+        .add_column(name_key_)
+        .add_column(status_key_)
+        .set_description("Distribution of span latency by name and status.")
+        .RegisterForExport();
+  }
+
+  const MeasureDouble measure_;
+  const opencensus::tags::TagKey name_key_;
+  const opencensus::tags::TagKey status_key_;
+  absl::Mutex mu_;
+  absl::flat_hash_map<Key, std::unique_ptr<BoundMeasure<double>>> bound_
+      GUARDED_BY(mu_);
+};
+
+void RecordSpanLatency(absl::string_view name, trace::StatusCode code,
+                       absl::Duration latency) {
+  SpanLatencyRecorder::Get()->Record(name, code, latency);
+}
+
+}  // namespace
+
+void RegisterSpanLatencyViewForExport() {
+  SpanLatencyRecorder::Get();
+  trace::SetSpanEndHook(&RecordSpanLatency);
+}
+
+}  // namespace stats
+}  // namespace opencensus
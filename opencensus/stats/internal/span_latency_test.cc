@@ -0,0 +1,77 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/span_latency.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/status_code.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+TEST(SpanLatencyTest, RecordsEndedSpans) {
+  RegisterSpanLatencyViewForExport();
+  static trace::AlwaysSampler always_sampler;
+  static trace::NeverSampler never_sampler;
+  for (int i = 0; i < 2; ++i) {
+    auto span =
+        trace::Span::StartSpan("SpanLatencyOk", nullptr, {&always_sampler});
+    absl::SleepFor(absl::Milliseconds(5));
+    span.End();
+  }
+  auto failed =
+      trace::Span::StartSpan("SpanLatencyFailed", nullptr, {&always_sampler});
+  failed.SetStatus(trace::StatusCode::DEADLINE_EXCEEDED);
+  failed.End();
+  // Not recording, so not measured.
+  trace::Span::StartSpan("SpanLatencyUnsampled", nullptr, {&never_sampler})
+      .End();
+  testing::TestUtils::Flush();
+
+  const auto all_data = StatsExporter::GetViewData();
+  const ViewData* data = nullptr;
+  for (const auto& view_data : all_data) {
+    if (view_data.first.name() == kSpanLatencyMeasureName) {
+      data = &view_data.second;
+    }
+  }
+  ASSERT_NE(nullptr, data);
+  const auto& rows = data->distribution_data();
+  const std::vector<std::string> ok_row = {"SpanLatencyOk", "OK"};
+  ASSERT_EQ(1, rows.count(ok_row));
+  EXPECT_EQ(2, rows.at(ok_row).count());
+  EXPECT_GE(rows.at(ok_row).mean(), 5);
+  const std::vector<std::string> failed_row = {"SpanLatencyFailed",
+                                               "DEADLINE_EXCEEDED"};
+  ASSERT_EQ(1, rows.count(failed_row));
+  EXPECT_EQ(1, rows.at(failed_row).count());
+  for (const auto& row : rows) {
+    EXPECT_NE("SpanLatencyUnsampled", row.first[0]);
+  }
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,72 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_config.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/self_stats.h"
+#include "opencensus/stats/internal/stats_manager.h"
+#include "opencensus/stats/internal/stats_persistence.h"
+
+namespace opencensus {
+namespace stats {
+
+void StatsConfig::SetHarvestParams(const HarvestParams& params) {
+  DeltaProducer::Get()->SetHarvestParams(params);
+}
+
+void StatsConfig::PrewarmTagSets(
+    const std::vector<opencensus::tags::TagMap>& tag_sets) {
+  DeltaProducer::Get()->PrewarmTagSets(tag_sets);
+}
+
+void StatsConfig::RegisterInternalViewsForExport() {
+  RegisterSelfStatsViewsForExport();
+}
+
+StatsMemoryUsage StatsConfig::GetMemoryUsage() {
+  StatsMemoryUsage usage;
+  usage.views = StatsManager::Get()->GetViewMemoryUsage();
+  DeltaProducer::Get()->GetMemoryUsage(&usage.active_delta, &usage.last_delta);
+  return usage;
+}
+
+bool StatsConfig::EnablePersistence(absl::string_view path,
+                                    absl::Duration interval) {
+  return StatsPersistence::Get()->Enable(path, interval);
+}
+
+void StatsConfig::SetDisabledMeasures(const std::vector<std::string>& names) {
+  StatsManager::Get()->SetDisabledMeasures(names);
+}
+
+void StatsConfig::SetDisabledViews(const std::vector<std::string>& names) {
+  StatsManager::Get()->SetDisabledViews(names);
+}
+
+void StatsConfig::SetMeasureSampling(
+    const std::vector<std::pair<std::string, uint32_t>>& rates) {
+  StatsManager::Get()->SetMeasureSampling(rates);
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,380 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_config.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/self_stats.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/stats/view.h"
+#include "opencensus/tags/tag_key.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+constexpr char kMeasureName[] = "test_measure";
+
+MeasureDouble TestMeasure() {
+  static const auto measure = MeasureDouble::Register(kMeasureName, "", "");
+  return measure;
+}
+
+// Polls until '*view' has 'num_rows' rows, returning false on timeout.
+bool WaitForRows(View* view, size_t num_rows) {
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (absl::Now() < deadline) {
+    if (view->GetData().int_data().size() == num_rows) {
+      return true;
+    }
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  return false;
+}
+
+class StatsConfigTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    StatsConfig::SetHarvestParams(HarvestParams());
+    StatsConfig::SetDisabledMeasures({});
+    StatsConfig::SetDisabledViews({});
+    StatsConfig::SetMeasureSampling({});
+  }
+
+  const opencensus::tags::TagKey key_ =
+      opencensus::tags::TagKey::Register("key");
+};
+
+TEST_F(StatsConfigTest, Interval) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("count")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  HarvestParams params;
+  params.interval = absl::Milliseconds(10);
+  StatsConfig::SetHarvestParams(params);
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  EXPECT_TRUE(WaitForRows(&view, 1));
+}
+
+TEST_F(StatsConfigTest, MaxPendingTagSets) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("count")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  params.max_pending_tag_sets = 3;
+  StatsConfig::SetHarvestParams(params);
+  // Finish any harvest that became due under the previous parameters.
+  testing::TestUtils::Flush();
+  for (int i = 0; i < 3; ++i) {
+    Record({{TestMeasure(), 1.0}}, {{key_, absl::StrCat("value", i)}});
+  }
+  // The threshold has not been crossed yet.
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_TRUE(view.GetData().int_data().empty());
+  Record({{TestMeasure(), 1.0}}, {{key_, "value3"}});
+  EXPECT_TRUE(WaitForRows(&view, 4));
+}
+
+TEST_F(StatsConfigTest, IdleBackoff) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("count")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  HarvestParams params;
+  params.interval = absl::Milliseconds(10);
+  params.max_idle_interval = absl::Milliseconds(80);
+  StatsConfig::SetHarvestParams(params);
+  // Let the interval back off, then check that data is still harvested.
+  absl::SleepFor(absl::Milliseconds(300));
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  EXPECT_TRUE(WaitForRows(&view, 1));
+}
+
+TEST_F(StatsConfigTest, DisabledMeasures) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("count")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  const std::vector<std::string> row = {"value"};
+  StatsConfig::SetDisabledMeasures({kMeasureName});
+  EXPECT_FALSE(DeltaProducer::Get()->AnyHasViews({{TestMeasure(), 1.0}}));
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_TRUE(view.GetData().int_data().empty());
+
+  StatsConfig::SetDisabledMeasures({});
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_EQ(1, view.GetData().int_data().at(row));
+}
+
+TEST_F(StatsConfigTest, DisabledViews) {
+  TestMeasure();
+  View count(ViewDescriptor()
+                 .set_measure(kMeasureName)
+                 .set_name("count")
+                 .set_aggregation(Aggregation::Count())
+                 .add_column(key_));
+  View sum(ViewDescriptor()
+               .set_measure(kMeasureName)
+               .set_name("sum")
+               .set_aggregation(Aggregation::Sum())
+               .add_column(key_));
+  const std::vector<std::string> row = {"value"};
+  StatsConfig::SetDisabledViews({"count"});
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_TRUE(count.GetData().int_data().empty());
+  EXPECT_EQ(1, sum.GetData().double_data().at(row));
+
+  // With all of its views disabled, the measure is not recorded.
+  StatsConfig::SetDisabledViews({"count", "sum"});
+  EXPECT_FALSE(DeltaProducer::Get()->AnyHasViews({{TestMeasure(), 1.0}}));
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_EQ(1, sum.GetData().double_data().at(row));
+
+  // Views created while disabled start disabled.
+  View count2(ViewDescriptor()
+                  .set_measure(kMeasureName)
+                  .set_name("count")
+                  .set_aggregation(Aggregation::Count())
+                  .add_column(key_));
+  EXPECT_FALSE(DeltaProducer::Get()->AnyHasViews({{TestMeasure(), 1.0}}));
+
+  StatsConfig::SetDisabledViews({});
+  Record({{TestMeasure(), 1.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_EQ(1, count.GetData().int_data().at(row));
+  EXPECT_EQ(2, sum.GetData().double_data().at(row));
+}
+
+TEST_F(StatsConfigTest, MeasureSampling) {
+  TestMeasure();
+  View count(ViewDescriptor()
+                 .set_measure(kMeasureName)
+                 .set_name("count")
+                 .set_aggregation(Aggregation::Count())
+                 .add_column(key_));
+  View sum(ViewDescriptor()
+               .set_measure(kMeasureName)
+               .set_name("sum")
+               .set_aggregation(Aggregation::Sum())
+               .add_column(key_));
+  const std::vector<std::string> row = {"value"};
+  StatsConfig::SetMeasureSampling({{kMeasureName, 10}});
+  for (int i = 0; i < 10000; ++i) {
+    Record({{TestMeasure(), 2.0}}, {{key_, "value"}});
+  }
+  testing::TestUtils::Flush();
+  // About 1000 recordings are kept, each counted 10 times.
+  const int64_t sampled_count = count.GetData().int_data().at(row);
+  EXPECT_EQ(0, sampled_count % 10);
+  EXPECT_NEAR(10000, sampled_count, 2000);
+  EXPECT_DOUBLE_EQ(2.0 * sampled_count, sum.GetData().double_data().at(row));
+  EXPECT_EQ(10, count.GetData().sample_one_in());
+
+  StatsConfig::SetMeasureSampling({});
+  Record({{TestMeasure(), 2.0}}, {{key_, "value"}});
+  testing::TestUtils::Flush();
+  EXPECT_EQ(sampled_count + 1, count.GetData().int_data().at(row));
+  EXPECT_EQ(1, count.GetData().sample_one_in());
+}
+
+TEST_F(StatsConfigTest, MergeThreads) {
+  std::vector<MeasureInt64> measures;
+  std::vector<std::unique_ptr<View>> views;
+  for (int i = 0; i < 8; ++i) {
+    const std::string name = absl::StrCat("merge_threads_measure", i);
+    measures.push_back(MeasureInt64::Register(name, "", ""));
+    views.push_back(absl::make_unique<View>(
+        ViewDescriptor()
+            .set_measure(name)
+            .set_name(absl::StrCat(name, "_sum"))
+            .set_aggregation(Aggregation::Sum())
+            .add_column(key_)));
+  }
+  HarvestParams params;
+  params.merge_threads = 3;
+  StatsConfig::SetHarvestParams(params);
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      Record({{measures[i], i}}, {{key_, absl::StrCat("value", j)}});
+    }
+  }
+  testing::TestUtils::Flush();
+  for (int i = 0; i < 8; ++i) {
+    const auto data = views[i]->GetData().int_data();
+    ASSERT_EQ(10, data.size());
+    EXPECT_EQ(i, data.at(std::vector<std::string>{"value0"}));
+  }
+}
+
+TEST_F(StatsConfigTest, ConsistentChunkedMerge) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("count")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  params.merge_chunk_size = 1;
+  StatsConfig::SetHarvestParams(params);
+  testing::TestUtils::Flush();
+  constexpr int kNumTagSets = 200;
+  for (int i = 0; i < kNumTagSets; ++i) {
+    Record({{TestMeasure(), 1.0}}, {{key_, absl::StrCat("value", i)}});
+  }
+  std::atomic<bool> done(false);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      // Reads never see part of the harvest.
+      const size_t num_rows = view.GetData().int_data().size();
+      EXPECT_TRUE(num_rows == 0 || num_rows == kNumTagSets) << num_rows;
+    }
+  });
+  testing::TestUtils::Flush();
+  done = true;
+  reader.join();
+  EXPECT_EQ(kNumTagSets, view.GetData().int_data().size());
+}
+
+TEST_F(StatsConfigTest, MemoryUsage) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("memory_usage")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_));
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  StatsConfig::SetHarvestParams(params);
+  testing::TestUtils::Flush();
+  for (int i = 0; i < 3; ++i) {
+    Record({{TestMeasure(), 1.0}}, {{key_, absl::StrCat("value", i)}});
+  }
+  const StatsMemoryUsage recorded = StatsConfig::GetMemoryUsage();
+  EXPECT_GE(recorded.active_delta.tag_sets, 3);
+  EXPECT_GT(recorded.active_delta.bytes, 0);
+
+  testing::TestUtils::Flush();
+  const StatsMemoryUsage merged = StatsConfig::GetMemoryUsage();
+  // The merged tag sets are kept for reuse by the next harvest.
+  EXPECT_GE(merged.last_delta.tag_sets, 3);
+  bool found = false;
+  for (const StatsMemoryUsage::View& usage : merged.views) {
+    if (usage.name == "memory_usage") {
+      found = true;
+      EXPECT_EQ(3, usage.rows);
+      EXPECT_GT(usage.bytes, 0);
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST_F(StatsConfigTest, CapacityHints) {
+  TestMeasure();
+  View view(ViewDescriptor()
+                .set_measure(kMeasureName)
+                .set_name("capacity_hints")
+                .set_aggregation(Aggregation::Count())
+                .add_column(key_)
+                .set_expected_rows(1000));
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  params.expected_tag_sets = 1000;
+  StatsConfig::SetHarvestParams(params);
+  testing::TestUtils::Flush();
+  StatsConfig::PrewarmTagSets({{{key_, "value0"}}, {{key_, "value1"}}});
+  EXPECT_GE(StatsConfig::GetMemoryUsage().active_delta.tag_sets, 2);
+
+  // Prewarmed rows without data do not reach the view.
+  Record({{TestMeasure(), 1.0}}, {{key_, "value0"}});
+  testing::TestUtils::Flush();
+  EXPECT_EQ(1, view.GetData().int_data().size());
+  EXPECT_EQ(1, view.GetData().int_data().at({"value0"}));
+}
+
+TEST_F(StatsConfigTest, InternalViews) {
+  StatsConfig::RegisterInternalViewsForExport();
+  bool exported = false;
+  for (const auto& data : StatsExporter::GetViewData()) {
+    exported |= data.first.name() == kSelfExporterRpcErrors;
+  }
+  EXPECT_TRUE(exported);
+
+  View view(ViewDescriptor()
+                .set_measure(kSelfExporterRpcErrors)
+                .set_name("rpc_errors")
+                .set_aggregation(Aggregation::Sum())
+                .add_column(opencensus::tags::TagKey::Register(
+                    kSelfExporterKey)));
+  HarvestParams params;
+  params.interval = absl::Milliseconds(10);
+  StatsConfig::SetHarvestParams(params);
+  common::RecordSelfMetric(common::SelfMetric::kExporterRpcErrors, 2, "test");
+  ASSERT_TRUE(WaitForRows(&view, 1));
+  EXPECT_EQ(2, view.GetData().int_data().at(std::vector<std::string>{"test"}));
+
+  // Each harvest records the rows of every view. 'view' shares its data with
+  // the exported view, which is reported under the exported name.
+  View rows_view(ViewDescriptor()
+                     .set_measure(kSelfViewRows)
+                     .set_name("view_rows")
+                     .set_aggregation(Aggregation::LastValue())
+                     .add_column(opencensus::tags::TagKey::Register(
+                         kSelfViewKey)));
+  // A harvest that ran before the error was merged may have recorded 0 rows,
+  // so wait for the value of a later one.
+  const std::vector<std::string> row = {kSelfExporterRpcErrors};
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while ((rows_view.GetData().int_data().count(row) == 0 ||
+          rows_view.GetData().int_data().at(row) != 1) &&
+         absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  ASSERT_EQ(1, rows_view.GetData().int_data().count(row));
+  EXPECT_EQ(1, rows_view.GetData().int_data().at(row));
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
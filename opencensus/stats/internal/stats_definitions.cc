@@ -0,0 +1,70 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_definitions.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+
+namespace opencensus {
+namespace stats {
+
+StatsDefinitions::StatsDefinitions(
+    absl::Span<const MeasureDefinition> measures,
+    absl::Span<const char* const> tag_keys,
+    absl::Span<const ViewDefinition> views) {
+  measure_ids_ = MeasureRegistryImpl::Get()->RegisterAll(measures);
+
+  tag_keys_.reserve(tag_keys.size());
+  for (const char* name : tag_keys) {
+    tag_keys_.push_back(opencensus::tags::TagKey::Register(name));
+  }
+
+  views_.reserve(views.size());
+  for (const auto& view : views) {
+    ViewDescriptor descriptor;
+    descriptor.set_name(view.name)
+        .set_description(view.description)
+        .set_measure(measures[view.measure].name)
+        .set_aggregation(view.aggregation());
+    for (const int column : view.columns) {
+      descriptor.add_column(tag_keys_[column]);
+    }
+    views_.push_back(std::move(descriptor));
+  }
+}
+
+void StatsDefinitions::RegisterViewsForExport() const {
+  for (const auto& view : views_) {
+    view.RegisterForExport();
+  }
+}
+
+// Measure<MeasureT>::IsValid() checks the type as well as validity.
+MeasureDouble StatsDefinitions::measure_double(int index) const {
+  return MeasureDouble(measure_ids_[index]);
+}
+
+MeasureInt64 StatsDefinitions::measure_int64(int index) const {
+  return MeasureInt64(measure_ids_[index]);
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,119 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_definitions.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/measure_descriptor.h"
+#include "opencensus/stats/measure_registry.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+enum Measures { kLatency, kRequests };
+constexpr MeasureDefinition kMeasures[] = {
+    {"definitions/latency", "Latency.", "ms", MeasureDescriptor::Type::kDouble},
+    {"definitions/requests", "Requests.", "1",
+     MeasureDescriptor::Type::kInt64},
+};
+
+enum TagKeys { kMethod, kStatus };
+constexpr const char* kTagKeys[] = {"method", "status"};
+
+constexpr int kByMethod[] = {kMethod};
+constexpr int kByStatusAndMethod[] = {kStatus, kMethod};
+enum Views { kLatencySum, kRequestCount };
+constexpr ViewDefinition kViews[] = {
+    {"definitions/latency/sum", "Total latency.", kLatency, &Aggregation::Sum,
+     kByMethod},
+    {"definitions/requests/count", "Requests.", kRequests, &Aggregation::Count,
+     kByStatusAndMethod},
+};
+
+const StatsDefinitions& Definitions() {
+  static const StatsDefinitions* definitions = [] {
+    auto* definitions = new StatsDefinitions(kMeasures, kTagKeys, kViews);
+    definitions->RegisterViewsForExport();
+    return definitions;
+  }();
+  return *definitions;
+}
+
+TEST(StatsDefinitionsTest, RegistersMeasuresAndTagKeys) {
+  const StatsDefinitions& definitions = Definitions();
+  EXPECT_TRUE(definitions.measure_double(kLatency).IsValid());
+  EXPECT_EQ(definitions.measure_double(kLatency),
+            MeasureRegistry::GetMeasureDoubleByName("definitions/latency"));
+  EXPECT_EQ("Latency.",
+            definitions.measure_double(kLatency).GetDescriptor().description());
+  EXPECT_TRUE(definitions.measure_int64(kRequests).IsValid());
+  EXPECT_EQ(MeasureDescriptor::Type::kInt64,
+            definitions.measure_int64(kRequests).GetDescriptor().type());
+  // Measures of the other type are invalid.
+  EXPECT_FALSE(definitions.measure_int64(kLatency).IsValid());
+  EXPECT_FALSE(definitions.measure_double(kRequests).IsValid());
+
+  EXPECT_EQ("status", definitions.tag_key(kStatus).name());
+  EXPECT_EQ("definitions/requests/count",
+            definitions.view(kRequestCount).name());
+  EXPECT_EQ(Aggregation::Count(),
+            definitions.view(kRequestCount).aggregation());
+  EXPECT_EQ(2, definitions.view(kRequestCount).num_columns());
+  EXPECT_EQ(definitions.tag_key(kStatus),
+            definitions.view(kRequestCount).columns()[0]);
+}
+
+TEST(StatsDefinitionsTest, RecordsToViews) {
+  const StatsDefinitions& definitions = Definitions();
+  Record({{definitions.measure_double(kLatency), 2.5},
+          {definitions.measure_int64(kRequests), 1}},
+         {{definitions.tag_key(kMethod), "get"},
+          {definitions.tag_key(kStatus), "ok"}});
+  Record({{definitions.measure_double(kLatency), 1.0}},
+         {{definitions.tag_key(kMethod), "get"}});
+  testing::TestUtils::Flush();
+
+  const auto latency = StatsExporter::GetViewData("definitions/latency/sum");
+  ASSERT_TRUE(latency.has_value());
+  EXPECT_THAT(latency->second.double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("get"), 3.5)));
+  const auto requests =
+      StatsExporter::GetViewData("definitions/requests/count");
+  ASSERT_TRUE(requests.has_value());
+  EXPECT_THAT(requests->second.int_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("ok", "get"), 1)));
+}
+
+TEST(StatsDefinitionsTest, DuplicateMeasuresAreInvalid) {
+  Definitions();
+  constexpr MeasureDefinition kDuplicate[] = {
+      {"definitions/new", "", "1", MeasureDescriptor::Type::kInt64},
+      {"definitions/latency", "", "ms", MeasureDescriptor::Type::kDouble},
+  };
+  const StatsDefinitions duplicate(kDuplicate, {}, {});
+  EXPECT_TRUE(duplicate.measure_int64(0).IsValid());
+  EXPECT_FALSE(duplicate.measure_double(1).IsValid());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -15,21 +15,60 @@
 #include "opencensus/stats/stats_exporter.h"
 #include "opencensus/stats/internal/stats_exporter_impl.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/random.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/common/internal/self_metrics.h"
 #include "opencensus/stats/internal/aggregation_window.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/stats_fork_handler.h"
+#include "opencensus/stats/internal/view_data_impl.h"
 #include "opencensus/stats/view_data.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
 
+namespace {
+
+constexpr absl::Duration kMinExportInterval = absl::Seconds(1);
+
+bool HasRows(const ViewData& data) {
+  switch (data.type()) {
+    case ViewData::Type::kDouble:
+      return !data.double_data().empty();
+    case ViewData::Type::kInt64:
+      return !data.int_data().empty();
+    case ViewData::Type::kDistribution:
+      return !data.distribution_data().empty();
+    case ViewData::Type::kExponentialHistogram:
+      return !data.exponential_histogram_data().empty();
+  }
+  return false;
+}
+
+}  // namespace
+
 // static
 StatsExporterImpl* StatsExporterImpl::Get() {
   static StatsExporterImpl* global_stats_exporter_impl =
@@ -37,46 +76,338 @@ StatsExporterImpl* StatsExporterImpl::Get() {
   return global_stats_exporter_impl;
 }
 
+StatsExporterImpl::StatsExporterImpl() { RegisterStatsForkHandler(); }
+
 void StatsExporterImpl::AddView(const ViewDescriptor& view) {
+  auto added = std::make_shared<opencensus::stats::View>(view);
+  std::shared_ptr<View> replaced;
   absl::MutexLock l(&mu_);
-  views_[view.name()] = absl::make_unique<opencensus::stats::View>(view);
+  replaced = PublishView(view.name(), std::move(added));
+  last_exported_data_.erase(view.name());
+  for (const auto& handler : handlers_) {
+    handler.worker->mutable_handler()->ViewAdded(view);
+  }
 }
 
 void StatsExporterImpl::RemoveView(absl::string_view name) {
+  std::shared_ptr<View> removed;
+  absl::MutexLock l(&mu_);
+  removed = PublishView(std::string(name), nullptr);
+  last_exported_data_.erase(std::string(name));
+}
+
+std::shared_ptr<const StatsExporterImpl::ViewMap> StatsExporterImpl::views()
+    const {
+  absl::MutexLock l(&views_mu_);
+  return views_;
+}
+
+std::shared_ptr<View> StatsExporterImpl::PublishView(
+    const std::string& name, std::shared_ptr<View> view) {
+  const std::shared_ptr<const ViewMap> old_views = views();
+  auto new_views = std::make_shared<ViewMap>(*old_views);
+  std::shared_ptr<View> replaced;
+  auto it = new_views->find(name);
+  if (it != new_views->end()) {
+    replaced = std::move(it->second);
+    new_views->erase(it);
+  }
+  if (view != nullptr) {
+    new_views->emplace(name, std::move(view));
+  }
+  absl::MutexLock l(&views_mu_);
+  views_ = std::move(new_views);
+  return replaced;
+}
+
+uint64_t StatsExporterImpl::AddGauge(const ViewDescriptor& descriptor,
+                                     std::vector<std::string> tag_values,
+                                     std::function<void(MeasureData*)> read) {
+  auto gauge = std::make_shared<Gauge>(descriptor, std::move(tag_values),
+                                       std::move(read), absl::Now());
   absl::MutexLock l(&mu_);
-  views_.erase(std::string(name));
+  const uint64_t id = next_gauge_id_++;
+  gauges_.emplace(id, std::move(gauge));
+  return id;
+}
+
+void StatsExporterImpl::RemoveGauge(uint64_t id) {
+  std::shared_ptr<Gauge> gauge;
+  {
+    absl::MutexLock l(&mu_);
+    auto it = gauges_.find(id);
+    if (it == gauges_.end()) {
+      return;
+    }
+    gauge = std::move(it->second);
+    gauges_.erase(it);
+    const std::string& name = gauge->descriptor.name();
+    if (std::none_of(gauges_.begin(), gauges_.end(),
+                     [&name](const std::pair<const uint64_t,
+                                             std::shared_ptr<Gauge>>& other) {
+                       return other.second->descriptor.name() == name;
+                     })) {
+      last_exported_data_.erase(name);
+    }
+  }
+  // Outside mu_, so that exports calling other gauges are not blocked.
+  absl::MutexLock l(&gauge->mu);
+  gauge->removed = true;
 }
 
 void StatsExporterImpl::RegisterPushHandler(
     std::unique_ptr<StatsExporter::Handler> handler) {
+  common::Scheduler::Get()->RestartAfterFork();
+  auto worker = std::make_shared<HandlerWorker>(std::move(handler));
+  // Start at a random phase of the interval.
+  const absl::Time first_export_time =
+      absl::Now() +
+      worker->interval() * common::Random::GetRandom()->GenerateRandomDouble();
   absl::MutexLock l(&mu_);
-  handlers_.push_back(std::move(handler));
-  if (!thread_started_) {
-    StartExportThread();
+  for (const auto& view : *views()) {
+    worker->mutable_handler()->ViewAdded(view.second->descriptor());
+  }
+  handlers_.push_back({std::move(worker), first_export_time});
+  handlers_changed_ = true;
+  if (!export_started_) {
+    StartExportLoop();
+  } else if (export_task_ != 0) {
+    // Reschedule for the new handler's first export.
+    common::Scheduler::Get()->Wake(export_task_);
   }
 }
 
 std::vector<std::pair<ViewDescriptor, ViewData>>
 StatsExporterImpl::GetViewData() {
-  absl::ReaderMutexLock l(&mu_);
+  ExportData gauge_data = ReadGauges();
+  const std::shared_ptr<const ViewMap> views = this->views();
   std::vector<std::pair<ViewDescriptor, ViewData>> data;
-  data.reserve(views_.size());
-  for (const auto& view : views_) {
+  data.reserve(views->size() + gauge_data.size());
+  for (const auto& view : *views) {
     data.emplace_back(view.second->descriptor(), view.second->GetData());
   }
+  std::move(gauge_data.begin(), gauge_data.end(), std::back_inserter(data));
   return data;
 }
 
+absl::optional<std::pair<ViewDescriptor, ViewData>>
+StatsExporterImpl::GetViewData(absl::string_view name,
+                               const opencensus::tags::TagMap& filter) {
+  {
+    const std::shared_ptr<const ViewMap> views = this->views();
+    const auto it = views->find(std::string(name));
+    if (it != views->end()) {
+      return std::make_pair(it->second->descriptor(),
+                            it->second->GetData(filter));
+    }
+  }
+  ExportData gauge_data = ReadGauges(name);
+  if (gauge_data.empty()) {
+    return absl::nullopt;
+  }
+  const ViewDescriptor& descriptor = gauge_data.front().first;
+  return std::make_pair(
+      descriptor,
+      ViewData(gauge_data.front().second.impl_->MatchingRows(
+          ViewDataImpl::MakeRowFilter(descriptor, filter))));
+}
+
+std::vector<std::string> StatsExporterImpl::GetViewNames() {
+  std::vector<std::string> names;
+  const std::shared_ptr<const ViewMap> views = this->views();
+  {
+    absl::ReaderMutexLock l(&mu_);
+    names.reserve(views->size() + gauges_.size());
+    for (const auto& view : *views) {
+      names.push_back(view.first);
+    }
+    for (const auto& gauge : gauges_) {
+      names.push_back(gauge.second->descriptor.name());
+    }
+  }
+  std::sort(names.begin(), names.end());
+  // Several gauges may be rows of one view.
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+  return names;
+}
+
 void StatsExporterImpl::Export() {
-  absl::ReaderMutexLock l(&mu_);
-  std::vector<std::pair<ViewDescriptor, ViewData>> data;
-  data.reserve(views_.size());
-  for (const auto& view : views_) {
-    data.emplace_back(view.second->descriptor(), view.second->GetData());
+  std::vector<std::shared_ptr<HandlerWorker>> handlers;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    for (const auto& handler : handlers_) {
+      handlers.push_back(handler.worker);
+    }
   }
-  for (auto& handler : handlers_) {
-    handler->ExportViewData(data);
+  ExportTo(handlers);
+}
+
+bool StatsExporterImpl::Shutdown(absl::Time deadline) {
+  // An export the thread already started is waited for by ExportTo().
+  return ExportTo(StopExportLoop(), /*final_export=*/true, deadline);
+}
+
+void StatsExporterImpl::StopExports() { StopExportLoop(); }
+
+std::vector<std::shared_ptr<StatsExporterImpl::HandlerWorker>>
+StatsExporterImpl::StopExportLoop() {
+  std::vector<std::shared_ptr<HandlerWorker>> handlers;
+  uint64_t export_task;
+  {
+    absl::MutexLock l(&mu_);
+    shutdown_ = true;
+    // Wake the export thread so that it exits, and keep
+    // RegisterPushHandler() from starting it.
+    handlers_changed_ = true;
+    export_started_ = true;
+    export_task = export_task_;
+    export_task_ = 0;
+    for (const auto& handler : handlers_) {
+      handlers.push_back(handler.worker);
+    }
+  }
+  if (export_task != 0) {
+    // Outside mu_, which the task acquires.
+    common::Scheduler::Get()->RemoveTask(export_task);
+  }
+  return handlers;
+}
+
+bool StatsExporterImpl::ExportTo(
+    const std::vector<std::shared_ptr<HandlerWorker>>& handlers,
+    bool final_export, absl::Time final_deadline) {
+  if (handlers.empty()) {
+    return true;
+  }
+  OPENCENSUS_PROBE1(stats_export_begin, final_export);
+  const absl::Time start = absl::Now();
+  // Merge data still pending in the DeltaProducer, which would otherwise only
+  // be exported at the next export after it is harvested.
+  DeltaProducer::Get()->Flush();
+  ExportData gauge_data = ReadGauges();
+  auto data = std::make_shared<ExportData>();
+  auto changed_data = std::make_shared<ExportData>();
+  // Snapshot the views without holding mu_, so that view registration and
+  // other exports do not wait for the copies.
+  const std::shared_ptr<const ViewMap> views = this->views();
+  data->reserve(views->size() + gauge_data.size());
+  for (const auto& view : *views) {
+    data->emplace_back(view.second->descriptor(), view.second->GetData());
+  }
+  std::move(gauge_data.begin(), gauge_data.end(), std::back_inserter(*data));
+  {
+    // Takes an exclusive lock since ChangedRows() updates last_exported_data_.
+    absl::MutexLock l(&mu_);
+    bool any_changed_rows_only = false;
+    for (const auto& handler : handlers) {
+      any_changed_rows_only |= handler->handler().ExportChangedRowsOnly();
+    }
+    if (any_changed_rows_only) {
+      *changed_data = ChangedRows(*data);
+    } else {
+      // Don't hold on to snapshots no handler needs, which would make the next
+      // write to each view copy its data.
+      last_exported_data_.clear();
+    }
+  }
+  const absl::Time now = absl::Now();
+  bool all_exported = true;
+  std::vector<HandlerWorker*> started;
+  started.reserve(handlers.size());
+  for (const auto& handler : handlers) {
+    const absl::Time deadline = std::min(
+        final_deadline,
+        now +
+            std::min(handler->interval(), handler->handler().ExportDeadline()));
+    if (handler->Post(
+            handler->handler().ExportChangedRowsOnly() ? changed_data : data,
+            deadline,
+            final_export ? final_deadline : absl::InfinitePast())) {
+      started.push_back(handler.get());
+    } else {
+      all_exported = false;
+    }
+  }
+  for (HandlerWorker* handler : started) {
+    all_exported &= handler->Wait();
+  }
+  common::RecordSelfMetric(common::SelfMetric::kStatsExportLatency,
+                           absl::ToDoubleMilliseconds(absl::Now() - start));
+  OPENCENSUS_PROBE1(stats_export_end, all_exported);
+  return all_exported;
+}
+
+StatsExporterImpl::ExportData StatsExporterImpl::ReadGauges(
+    absl::string_view name) {
+  std::vector<std::shared_ptr<Gauge>> gauges;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    gauges.reserve(gauges_.size());
+    for (const auto& gauge : gauges_) {
+      if (name.empty() || gauge.second->descriptor.name() == name) {
+        gauges.push_back(gauge.second);
+      }
+    }
+  }
+  const absl::Time now = absl::Now();
+  // Gauges with the same name are rows of one view, in order of registration.
+  std::vector<std::shared_ptr<ViewDataImpl>> views;
+  std::vector<const ViewDescriptor*> descriptors;
+  std::unordered_map<std::string, size_t> view_index;
+  MeasureData data({});
+  std::vector<absl::string_view> tag_values;
+  for (const auto& gauge : gauges) {
+    absl::ReaderMutexLock l(&gauge->mu);
+    if (gauge->removed) {
+      continue;
+    }
+    data.Reset();
+    gauge->read(&data);
+    const auto it =
+        view_index.emplace(gauge->descriptor.name(), views.size()).first;
+    if (it->second == views.size()) {
+      views.push_back(
+          std::make_shared<ViewDataImpl>(gauge->start_time, gauge->descriptor));
+      descriptors.push_back(&gauge->descriptor);
+    }
+    tag_values.assign(gauge->tag_values.begin(), gauge->tag_values.end());
+    views[it->second]->Merge(tag_values, data, now);
+  }
+  ExportData gauge_data;
+  gauge_data.reserve(views.size());
+  for (size_t i = 0; i < views.size(); ++i) {
+    // Gauges outlive 'descriptors' through 'gauges'.
+    gauge_data.emplace_back(*descriptors[i], ViewData(std::move(views[i])));
+  }
+  return gauge_data;
+}
+
+std::vector<std::pair<ViewDescriptor, ViewData>> StatsExporterImpl::ChangedRows(
+    const std::vector<std::pair<ViewDescriptor, ViewData>>& data) {
+  std::vector<std::pair<ViewDescriptor, ViewData>> changed_data;
+  for (const auto& datum : data) {
+    const ViewDescriptor& descriptor = datum.first;
+    if (datum.second.impl_->aggregation_window().type() !=
+        AggregationWindow::Type::kCumulative) {
+      changed_data.push_back(datum);
+      continue;
+    }
+    auto it = last_exported_data_.find(descriptor.name());
+    if (it == last_exported_data_.end()) {
+      changed_data.push_back(datum);
+      last_exported_data_.emplace(descriptor.name(), datum.second);
+      continue;
+    }
+    ViewData changed(
+        datum.second.impl_->ChangedRowsSince(*it->second.impl_));
+    // ViewData is not assignable, so replace the entry.
+    last_exported_data_.erase(it);
+    last_exported_data_.emplace(descriptor.name(), datum.second);
+    if (HasRows(changed)) {
+      changed_data.emplace_back(descriptor, changed);
+    }
   }
+  return changed_data;
 }
 
 void StatsExporterImpl::ClearHandlersForTesting() {
@@ -84,21 +415,244 @@ void StatsExporterImpl::ClearHandlersForTesting() {
   handlers_.clear();
 }
 
-void StatsExporterImpl::StartExportThread() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  t_ = std::thread(&StatsExporterImpl::RunWorkerLoop, this);
-  thread_started_ = true;
+std::vector<int64_t> StatsExporterImpl::HandlerOverrunsForTesting() {
+  absl::ReaderMutexLock l(&mu_);
+  std::vector<int64_t> overruns;
+  for (const auto& handler : handlers_) {
+    overruns.push_back(handler.worker->overruns());
+  }
+  return overruns;
+}
+
+StatsExporterImpl::HandlerWorker::HandlerWorker(
+    std::unique_ptr<StatsExporter::Handler> handler)
+    : handler_(std::move(handler)),
+      interval_(std::max(handler_->ExportInterval(), kMinExportInterval)) {
+  if (!common::Scheduler::Get()->manual_mode()) {
+    thread_ = std::thread(&StatsExporterImpl::HandlerWorker::Run, this);
+  }
+}
+
+StatsExporterImpl::HandlerWorker::~HandlerWorker() {
+  {
+    absl::MutexLock l(&mu_);
+    shutdown_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool StatsExporterImpl::HandlerWorker::Post(
+    std::shared_ptr<const ExportData> data, absl::Time deadline,
+    absl::Time busy_deadline) {
+  absl::MutexLock l(&mu_);
+  if (busy_ &&
+      !mu_.AwaitWithDeadline(absl::Condition(this, &HandlerWorker::Idle),
+                             busy_deadline)) {
+    Overrun();
+    return false;
+  }
+  busy_ = true;
+  deadline_ = deadline;
+  if (thread_.joinable()) {
+    pending_ = std::move(data);
+    return true;
+  }
+  mu_.Unlock();
+  handler_->ExportViewDataBatch(std::move(data));
+  mu_.Lock();
+  busy_ = false;
+  late_ = absl::Now() > deadline;
+  if (late_) {
+    Overrun();
+  }
+  return true;
+}
+
+bool StatsExporterImpl::HandlerWorker::Wait() {
+  absl::MutexLock l(&mu_);
+  if (!mu_.AwaitWithDeadline(absl::Condition(this, &HandlerWorker::Idle),
+                             deadline_)) {
+    Overrun();
+    return false;
+  }
+  return !late_;
+}
+
+int64_t StatsExporterImpl::HandlerWorker::overruns() const {
+  absl::MutexLock l(&mu_);
+  return overruns_;
+}
+
+void StatsExporterImpl::HandlerWorker::Run() {
+  while (true) {
+    std::shared_ptr<const ExportData> data;
+    {
+      absl::MutexLock l(&mu_);
+      mu_.Await(absl::Condition(this, &HandlerWorker::ReadyOrShutdown));
+      if (shutdown_) {
+        return;
+      }
+      data = std::move(pending_);
+      pending_ = nullptr;
+    }
+    handler_->ExportViewDataBatch(std::move(data));
+    absl::MutexLock l(&mu_);
+    busy_ = false;
+  }
+}
+
+void StatsExporterImpl::HandlerWorker::PrepareFork() { mu_.Lock(); }
+
+void StatsExporterImpl::HandlerWorker::ParentAfterFork() { mu_.Unlock(); }
+
+void StatsExporterImpl::HandlerWorker::ChildAfterFork() {
+  common::Scheduler::AbandonThread(&thread_);
+  pending_ = nullptr;
+  busy_ = false;
+  common::Scheduler::ReinitMutexInChild(&mu_);
+}
+
+void StatsExporterImpl::HandlerWorker::RestartAfterFork() {
+  if (thread_.joinable() || common::Scheduler::Get()->manual_mode()) {
+    return;
+  }
+  {
+    absl::MutexLock l(&mu_);
+    if (shutdown_) {
+      return;
+    }
+  }
+  thread_ = std::thread(&StatsExporterImpl::HandlerWorker::Run, this);
+}
+
+void StatsExporterImpl::HandlerWorker::Overrun() {
+  ++overruns_;
+  common::RecordSelfMetric(common::SelfMetric::kStatsExportOverruns, 1);
+  std::cerr << "Stats export handler overran its export deadline ("
+            << overruns_ << " overruns).\n";
+}
+
+void StatsExporterImpl::PrepareFork() {
+  mu_.Lock();
+  views_mu_.Lock();
+  for (const auto& handler : handlers_) {
+    handler.worker->PrepareFork();
+  }
+  for (const auto& gauge : gauges_) {
+    gauge.second->mu.Lock();
+  }
+}
+
+void StatsExporterImpl::ParentAfterFork() {
+  for (const auto& gauge : gauges_) {
+    gauge.second->mu.Unlock();
+  }
+  for (const auto& handler : handlers_) {
+    handler.worker->ParentAfterFork();
+  }
+  views_mu_.Unlock();
+  mu_.Unlock();
+}
+
+void StatsExporterImpl::ChildAfterFork() {
+  for (const auto& gauge : gauges_) {
+    common::Scheduler::ReinitMutexInChild(&gauge.second->mu);
+  }
+  for (const auto& handler : handlers_) {
+    handler.worker->ChildAfterFork();
+  }
+  common::Scheduler::AbandonThread(&t_);
+  // The views' data restarts in the child.
+  last_exported_data_.clear();
+  common::Scheduler::ReinitMutexInChild(&views_mu_);
+  common::Scheduler::ReinitMutexInChild(&mu_);
+}
+
+void StatsExporterImpl::RestartAfterFork() {
+  absl::MutexLock l(&mu_);
+  if (shutdown_) {
+    return;
+  }
+  for (const auto& handler : handlers_) {
+    handler.worker->RestartAfterFork();
+  }
+  // In manual mode, the export loop is a scheduler task.
+  if (export_started_ && export_task_ == 0 && !t_.joinable()) {
+    t_ = std::thread(&StatsExporterImpl::RunWorkerLoop, this);
+  }
+}
+
+void StatsExporterImpl::StartExportLoop() {
+  export_started_ = true;
+  if (common::Scheduler::Get()->manual_mode()) {
+    export_task_ = common::Scheduler::Get()->AddTask(
+        [this] { return RunExportTask(); }, NextExportTime());
+  } else {
+    t_ = std::thread(&StatsExporterImpl::RunWorkerLoop, this);
+  }
+}
+
+std::vector<std::shared_ptr<StatsExporterImpl::HandlerWorker>>
+StatsExporterImpl::TakeDueHandlers(absl::Time now) {
+  std::vector<std::shared_ptr<HandlerWorker>> due;
+  for (auto& handler : handlers_) {
+    if (handler.next_export_time > now) {
+      continue;
+    }
+    due.push_back(handler.worker);
+    // Keep the handler's phase. In case the last export took longer than the
+    // interval, skip the missed exports.
+    const absl::Duration interval = handler.worker->interval();
+    absl::Duration remainder;
+    handler.next_export_time +=
+        (absl::IDivDuration(now - handler.next_export_time, interval,
+                            &remainder) +
+         1) *
+        interval;
+  }
+  return due;
+}
+
+absl::Time StatsExporterImpl::NextExportTime() const {
+  absl::Time next_export_time = absl::InfiniteFuture();
+  for (const auto& handler : handlers_) {
+    next_export_time = std::min(next_export_time, handler.next_export_time);
+  }
+  return next_export_time;
 }
 
 void StatsExporterImpl::RunWorkerLoop() {
-  absl::Time next_export_time = absl::Now() + export_interval_;
   while (true) {
-    // SleepFor() returns immediately when given a negative duration.
-    absl::SleepFor(next_export_time - absl::Now());
-    // In case the last export took longer than the export interval, we
-    // calculate the next time from now.
-    next_export_time = absl::Now() + export_interval_;
-    Export();
+    std::vector<std::shared_ptr<HandlerWorker>> due;
+    {
+      absl::MutexLock l(&mu_);
+      // Sleep until the next handler is due, restarting the wait if a handler
+      // is registered. Exit once Shutdown() is called.
+      do {
+        if (shutdown_) {
+          return;
+        }
+        handlers_changed_ = false;
+      } while (mu_.AwaitWithDeadline(absl::Condition(&handlers_changed_),
+                                     NextExportTime()));
+      due = TakeDueHandlers(absl::Now());
+    }
+    ExportTo(due);
+  }
+}
+
+absl::Time StatsExporterImpl::RunExportTask() {
+  std::vector<std::shared_ptr<HandlerWorker>> due;
+  {
+    absl::MutexLock l(&mu_);
+    // The scheduler may run the task early to share a wakeup.
+    due = TakeDueHandlers(absl::Now() + common::Scheduler::kCoalescingWindow);
   }
+  ExportTo(due);
+  absl::MutexLock l(&mu_);
+  return NextExportTime();
 }
 
 void StatsExporter::RemoveView(absl::string_view name) {
@@ -113,6 +667,19 @@ std::vector<std::pair<ViewDescriptor, ViewData>> StatsExporter::GetViewData() {
   return StatsExporterImpl::Get()->GetViewData();
 }
 
+absl::optional<std::pair<ViewDescriptor, ViewData>> StatsExporter::GetViewData(
+    absl::string_view name, const opencensus::tags::TagMap& filter) {
+  return StatsExporterImpl::Get()->GetViewData(name, filter);
+}
+
+std::vector<std::string> StatsExporter::GetViewNames() {
+  return StatsExporterImpl::Get()->GetViewNames();
+}
+
+bool StatsExporter::Shutdown(absl::Time deadline) {
+  return StatsExporterImpl::Get()->Shutdown(deadline);
+}
+
 void StatsExporter::ExportForTesting() { StatsExporterImpl::Get()->Export(); }
 
 void StatsExporter::ClearHandlersForTesting() {
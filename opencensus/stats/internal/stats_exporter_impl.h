@@ -15,17 +15,27 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_STATS_EXPORTER_IMPL_H_
 #define OPENCENSUS_STATS_INTERNAL_STATS_EXPORTER_IMPL_H_
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "opencensus/stats/internal/aggregation_window.h"
+#include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/stats_exporter.h"
 #include "opencensus/stats/view_data.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -38,35 +48,218 @@ class StatsExporterImpl {
 
   void RemoveView(absl::string_view name);
 
+  // Registers a callback gauge, exported as the row for 'tag_values' of a view
+  // with 'descriptor' whose data 'read' adds to a MeasureData at each export.
+  // Returns an id for RemoveGauge().
+  uint64_t AddGauge(const ViewDescriptor& descriptor,
+                    std::vector<std::string> tag_values,
+                    std::function<void(MeasureData*)> read) LOCKS_EXCLUDED(mu_);
+  // Removes a gauge, waiting for any call of its 'read' in progress to return.
+  void RemoveGauge(uint64_t id) LOCKS_EXCLUDED(mu_);
+
   // Adds a handler, which cannot be subsequently removed (except by
-  // ClearHandlersForTesting()). The background thread is started when the
-  // first handler is registered.
+  // ClearHandlersForTesting()). The export loop is started when the first
+  // handler is registered: on a thread of its own, or in the scheduler's manual
+  // mode as a common::Scheduler task.
   void RegisterPushHandler(std::unique_ptr<StatsExporter::Handler> handler);
 
   std::vector<std::pair<ViewDescriptor, ViewData>> GetViewData();
+  // See StatsExporter::GetViewData(name, filter).
+  absl::optional<std::pair<ViewDescriptor, ViewData>> GetViewData(
+      absl::string_view name, const opencensus::tags::TagMap& filter)
+      LOCKS_EXCLUDED(mu_);
+  // See StatsExporter::GetViewNames().
+  std::vector<std::string> GetViewNames() LOCKS_EXCLUDED(mu_);
 
+  // Exports to all handlers now, regardless of their schedules.
   void Export();
 
+  // Stops the export loop and runs a final export to all handlers. See
+  // StatsExporter::Shutdown().
+  bool Shutdown(absl::Time deadline) LOCKS_EXCLUDED(mu_);
+  // Stops the export loop without a final export, for processes whose data is
+  // exported by another (see SharedStats::StartPublishing()).
+  void StopExports() LOCKS_EXCLUDED(mu_);
+
   void ClearHandlersForTesting();
 
+  // The number of overruns of each handler, in order of registration.
+  std::vector<int64_t> HandlerOverrunsForTesting();
+
+  // For the stats fork handler (see stats_fork_handler.h). The child drops the
+  // parent's threads and the exports in progress on them, and
+  // RestartAfterFork() starts new threads (unless in manual mode).
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void RestartAfterFork() LOCKS_EXCLUDED(mu_);
+
  private:
-  StatsExporterImpl() {}
+  typedef std::vector<std::pair<ViewDescriptor, ViewData>> ExportData;
+  // The registered views by name. Each published ViewMap is immutable; views
+  // are shared so that snapshots keep the views they list.
+  typedef std::unordered_map<std::string, std::shared_ptr<View>> ViewMap;
+
+  // HandlerWorker runs a handler's exports on a thread of its own, so that a
+  // slow handler does not delay the others. In the scheduler's manual mode, it
+  // has no thread and exports on the thread calling Post().
+  class HandlerWorker {
+   public:
+    explicit HandlerWorker(std::unique_ptr<StatsExporter::Handler> handler);
+    // Waits for any export in progress to return.
+    ~HandlerWorker();
+
+    const StatsExporter::Handler& handler() const { return *handler_; }
+    StatsExporter::Handler* mutable_handler() { return handler_.get(); }
+    absl::Duration interval() const { return interval_; }
+
+    // Starts exporting 'data', due by 'deadline', and returns true, unless the
+    // previous export is still in progress at 'busy_deadline', in which case
+    // counts an overrun and returns false. Without a thread, returns once the
+    // export does.
+    bool Post(std::shared_ptr<const ExportData> data, absl::Time deadline,
+              absl::Time busy_deadline = absl::InfinitePast())
+        LOCKS_EXCLUDED(mu_);
+    // Waits until the export started by the last Post() returns or its
+    // deadline passes, counting an overrun in the latter case. Returns true if
+    // the export returned.
+    bool Wait() LOCKS_EXCLUDED(mu_);
+
+    int64_t overruns() const LOCKS_EXCLUDED(mu_);
+
+    // For StatsExporterImpl's fork handler.
+    void PrepareFork() EXCLUSIVE_LOCK_FUNCTION(mu_);
+    void ParentAfterFork() UNLOCK_FUNCTION(mu_);
+    void ChildAfterFork() UNLOCK_FUNCTION(mu_);
+    void RestartAfterFork() LOCKS_EXCLUDED(mu_);
+
+   private:
+    void Run() LOCKS_EXCLUDED(mu_);
+    // Conditions for mu_.
+    bool Idle() const EXCLUSIVE_LOCKS_REQUIRED(mu_) { return !busy_; }
+    bool ReadyOrShutdown() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return pending_ != nullptr || shutdown_;
+    }
+    // Counts and logs an overrun.
+    void Overrun() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    const std::unique_ptr<StatsExporter::Handler> handler_;
+    const absl::Duration interval_;
+
+    mutable absl::Mutex mu_;
+    // The data to export next, if the thread has not yet picked it up.
+    std::shared_ptr<const ExportData> pending_ GUARDED_BY(mu_);
+    // Whether an export has been posted and not yet returned.
+    bool busy_ GUARDED_BY(mu_) = false;
+    absl::Time deadline_ GUARDED_BY(mu_);
+    int64_t overruns_ GUARDED_BY(mu_) = 0;
+    bool shutdown_ GUARDED_BY(mu_) = false;
+    // Whether the last export without a thread returned after its deadline.
+    bool late_ GUARDED_BY(mu_) = false;
+
+    // Not started in manual mode.
+    std::thread thread_;
+  };
+
+  // Registers the fork handler.
+  StatsExporterImpl();
+
+  struct Gauge {
+    Gauge(const ViewDescriptor& descriptor, std::vector<std::string> tag_values,
+          std::function<void(MeasureData*)> read, absl::Time start_time)
+        : descriptor(descriptor),
+          tag_values(std::move(tag_values)),
+          read(std::move(read)),
+          start_time(start_time) {}
+
+    const ViewDescriptor descriptor;
+    const std::vector<std::string> tag_values;
+    const std::function<void(MeasureData*)> read;
+    const absl::Time start_time;
+    // Held shared while calling 'read', so that RemoveGauge() can wait for
+    // calls in progress.
+    absl::Mutex mu;
+    bool removed GUARDED_BY(mu) = false;
+  };
+
+  struct RegisteredHandler {
+    // shared_ptr so that exports can use the worker without holding mu_.
+    std::shared_ptr<HandlerWorker> worker;
+    absl::Time next_export_time;
+  };
+
+  void StartExportLoop() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Stops the export loop and keeps it from starting, returning the handlers.
+  std::vector<std::shared_ptr<HandlerWorker>> StopExportLoop()
+      LOCKS_EXCLUDED(mu_);
+
+  // Flushes recorded data, then exports a snapshot of all views to 'handlers'
+  // and waits for them to return or overrun. For the final export at shutdown,
+  // exports are also due by 'final_deadline', and handlers still busy with an
+  // earlier export are waited for until then rather than skipped. Returns true
+  // if every handler exported in time.
+  bool ExportTo(const std::vector<std::shared_ptr<HandlerWorker>>& handlers,
+                bool final_export = false,
+                absl::Time final_deadline = absl::InfiniteFuture())
+      LOCKS_EXCLUDED(mu_);
+
+  // Calls every gauge (only those named 'name', if it is not empty), returning
+  // the data of each gauge view. Since gauges may be slow, they are called
+  // without holding mu_.
+  ExportData ReadGauges(absl::string_view name = "") LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of each view in 'data' that changed since they were last
+  // passed to this, for handlers that export changed rows only.
+  std::vector<std::pair<ViewDescriptor, ViewData>> ChangedRows(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  void StartExportThread() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns the current view set, which readers iterate without holding any
+  // lock.
+  std::shared_ptr<const ViewMap> views() const LOCKS_EXCLUDED(views_mu_);
+  // Publishes a copy of the view set with 'name' replaced by 'view', or
+  // removed if 'view' is null. Returns the view replaced, if any, for the
+  // caller to release outside mu_.
+  std::shared_ptr<View> PublishView(const std::string& name,
+                                    std::shared_ptr<View> view)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) LOCKS_EXCLUDED(views_mu_);
 
-  // Loops forever, calling Export() every export_interval_.
-  void RunWorkerLoop();
+  // Returns the handlers due at 'now', advancing their next export times.
+  std::vector<std::shared_ptr<HandlerWorker>> TakeDueHandlers(absl::Time now)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  absl::Time NextExportTime() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  const absl::Duration export_interval_ = absl::Seconds(10);
+  // Loops until Shutdown() is called, exporting to each handler when it is due.
+  void RunWorkerLoop() LOCKS_EXCLUDED(mu_);
+  // One pass of the loop, run as a scheduler task in manual mode. Returns the
+  // time of the next export.
+  absl::Time RunExportTask() LOCKS_EXCLUDED(mu_);
 
   mutable absl::Mutex mu_;
 
-  std::vector<std::unique_ptr<StatsExporter::Handler>> handlers_
-      GUARDED_BY(mu_);
-  std::unordered_map<std::string, std::unique_ptr<View>> views_ GUARDED_BY(mu_);
+  std::vector<RegisteredHandler> handlers_ GUARDED_BY(mu_);
+  // Set when a handler is registered, to wake the export loop.
+  bool handlers_changed_ GUARDED_BY(mu_) = false;
+  // Guards only the pointer to the view set, so that exports, reads and view
+  // registration never wait on each other for longer than its copy. Changes
+  // to the view set are serialized by mu_.
+  mutable absl::Mutex views_mu_ ACQUIRED_AFTER(mu_);
+  std::shared_ptr<const ViewMap> views_ GUARDED_BY(views_mu_) =
+      std::make_shared<const ViewMap>();
+  // The data of each cumulative view at the last export, if any handlers export
+  // changed rows only. Since snapshots share data until it is next written,
+  // only views that were recorded to are copied.
+  std::unordered_map<std::string, ViewData> last_exported_data_ GUARDED_BY(mu_);
+  // shared_ptr so that ReadGauges() can call gauges without holding mu_.
+  std::map<uint64_t, std::shared_ptr<Gauge>> gauges_ GUARDED_BY(mu_);
+  uint64_t next_gauge_id_ GUARDED_BY(mu_) = 1;
 
-  bool thread_started_ GUARDED_BY(mu_) = false;
+  bool export_started_ GUARDED_BY(mu_) = false;
+  // Set by Shutdown() to stop the export loop.
+  bool shutdown_ GUARDED_BY(mu_) = false;
   std::thread t_ GUARDED_BY(mu_);
+  // The export task's id, in manual mode.
+  uint64_t export_task_ GUARDED_BY(mu_) = 0;
 };
 
 }  // namespace stats
@@ -0,0 +1,105 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_exporter.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/view_descriptor.h"
+
+// Manual mode must be set before the library schedules any task, so these
+// tests are separate from stats_exporter_test.
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// SumExporter keeps the last exported sum of a single-row view, and the thread
+// it was exported on.
+class SumExporter : public StatsExporter::Handler {
+ public:
+  static SumExporter* Register() {
+    auto handler = absl::make_unique<SumExporter>();
+    SumExporter* exporter = handler.get();
+    StatsExporter::RegisterPushHandler(std::move(handler));
+    return exporter;
+  }
+
+  double sum() const {
+    absl::MutexLock l(&mu_);
+    return sum_;
+  }
+
+  std::thread::id export_thread() const {
+    absl::MutexLock l(&mu_);
+    return export_thread_;
+  }
+
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
+    absl::MutexLock l(&mu_);
+    export_thread_ = std::this_thread::get_id();
+    for (const auto& datum : data) {
+      for (const auto& row : datum.second.double_data()) {
+        sum_ = row.second;
+      }
+    }
+  }
+
+  absl::Duration ExportInterval() const override { return absl::Seconds(1); }
+
+ private:
+  mutable absl::Mutex mu_;
+  double sum_ GUARDED_BY(mu_) = 0;
+  std::thread::id export_thread_ GUARDED_BY(mu_);
+};
+
+TEST(StatsExporterManualTest, ExportsOnCallingThread) {
+  common::Scheduler::Get()->SetManualMode();
+  const MeasureDouble measure =
+      MeasureDouble::Register("opencensus.io/test/manual", "", "1");
+  ViewDescriptor()
+      .set_name("opencensus.io/test/manual_sum")
+      .set_measure("opencensus.io/test/manual")
+      .set_aggregation(Aggregation::Sum())
+      .RegisterForExport();
+  SumExporter* exporter = SumExporter::Register();
+  Record({{measure, 2.0}});
+
+  // Nothing is exported until the application runs the tasks.
+  absl::SleepFor(absl::Milliseconds(1100));
+  EXPECT_EQ(0, exporter->sum());
+  const absl::Time give_up = absl::Now() + absl::Seconds(10);
+  while (exporter->sum() == 0 && absl::Now() < give_up) {
+    const absl::Time next_run = common::Scheduler::Get()->RunDueTasks();
+    absl::SleepFor(std::min(absl::Milliseconds(10), next_run - absl::Now()));
+  }
+  EXPECT_EQ(2, exporter->sum());
+  EXPECT_EQ(std::this_thread::get_id(), exporter->export_thread());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,105 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/stats_exporter.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/view_descriptor.h"
+
+// Shutdown() is permanent, so these tests are separate from
+// stats_exporter_test.
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// GatedExporter keeps the last exported sum of a single-row view, blocking in
+// ExportViewData() while its gate is closed.
+class GatedExporter : public StatsExporter::Handler {
+ public:
+  static GatedExporter* Register() {
+    auto handler = absl::make_unique<GatedExporter>();
+    GatedExporter* gated = handler.get();
+    StatsExporter::RegisterPushHandler(std::move(handler));
+    return gated;
+  }
+
+  void SetOpen(bool open) {
+    absl::MutexLock l(&mu_);
+    open_ = open;
+  }
+
+  double sum() const {
+    absl::MutexLock l(&mu_);
+    return sum_;
+  }
+
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
+    absl::MutexLock l(&mu_);
+    mu_.Await(absl::Condition(&open_));
+    for (const auto& datum : data) {
+      for (const auto& row : datum.second.double_data()) {
+        sum_ = row.second;
+      }
+    }
+  }
+
+  // Only export on shutdown.
+  absl::Duration ExportInterval() const override { return absl::Hours(1); }
+
+ private:
+  mutable absl::Mutex mu_;
+  bool open_ GUARDED_BY(mu_) = true;
+  double sum_ GUARDED_BY(mu_) = 0;
+};
+
+TEST(StatsExporterShutdownTest, ExportsRecordedData) {
+  const MeasureDouble measure =
+      MeasureDouble::Register("opencensus.io/test/shutdown", "", "1");
+  ViewDescriptor()
+      .set_name("opencensus.io/test/shutdown_sum")
+      .set_measure("opencensus.io/test/shutdown")
+      .set_aggregation(Aggregation::Sum())
+      .RegisterForExport();
+  GatedExporter* exporter = GatedExporter::Register();
+
+  Record({{measure, 2.0}});
+  EXPECT_TRUE(StatsExporter::Shutdown(absl::Now() + absl::Seconds(10)));
+  EXPECT_EQ(2, exporter->sum());
+
+  // A blocked handler makes Shutdown() give up at the deadline.
+  Record({{measure, 3.0}});
+  exporter->SetOpen(false);
+  EXPECT_FALSE(StatsExporter::Shutdown(absl::Now() + absl::Milliseconds(50)));
+  EXPECT_EQ(2, exporter->sum());
+  // The next final export waits for the blocked one.
+  exporter->SetOpen(true);
+  Record({{measure, 4.0}});
+  EXPECT_TRUE(StatsExporter::Shutdown(absl::Now() + absl::Seconds(10)));
+  EXPECT_EQ(9, exporter->sum());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -14,19 +14,28 @@
 
 #include "opencensus/stats/stats_exporter.h"
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "opencensus/stats/callback_gauge.h"
 #include "opencensus/stats/internal/set_aggregation_window.h"
+#include "opencensus/stats/internal/stats_exporter_impl.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/stats/measure_descriptor.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/testing/test_utils.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
 
 namespace opencensus {
 namespace stats {
@@ -34,14 +43,21 @@ namespace stats {
 // A mock exporter that assigns exported data to the provided pointer.
 class MockExporter : public StatsExporter::Handler {
  public:
+  // By default, the interval is long enough that only explicit exports reach
+  // the exporter during a test.
   static void Register(
-      std::vector<std::pair<ViewDescriptor, ViewData>>* output) {
+      std::vector<std::pair<ViewDescriptor, ViewData>>* output,
+      bool changed_rows_only = false,
+      absl::Duration interval = absl::Hours(1)) {
     opencensus::stats::StatsExporter::RegisterPushHandler(
-        absl::make_unique<MockExporter>(output));
+        absl::make_unique<MockExporter>(output, changed_rows_only, interval));
   }
 
-  MockExporter(std::vector<std::pair<ViewDescriptor, ViewData>>* output)
-      : output_(output) {}
+  MockExporter(std::vector<std::pair<ViewDescriptor, ViewData>>* output,
+               bool changed_rows_only, absl::Duration interval)
+      : output_(output),
+        changed_rows_only_(changed_rows_only),
+        interval_(interval) {}
 
   void ExportViewData(
       const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
@@ -52,8 +68,77 @@ class MockExporter : public StatsExporter::Handler {
     }
   }
 
+  bool ExportChangedRowsOnly() const override { return changed_rows_only_; }
+  absl::Duration ExportInterval() const override { return interval_; }
+
  private:
   std::vector<std::pair<ViewDescriptor, ViewData>>* output_;
+  const bool changed_rows_only_;
+  const absl::Duration interval_;
+};
+
+// An exporter that blocks in ExportViewData() until 'release' is notified.
+class BlockingExporter : public StatsExporter::Handler {
+ public:
+  BlockingExporter(absl::Notification* release, std::atomic<int>* num_exports)
+      : release_(release), num_exports_(num_exports) {}
+
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
+    ++*num_exports_;
+    release_->WaitForNotification();
+  }
+
+  absl::Duration ExportInterval() const override { return absl::Hours(1); }
+  absl::Duration ExportDeadline() const override {
+    return absl::Milliseconds(50);
+  }
+
+ private:
+  absl::Notification* release_;
+  std::atomic<int>* num_exports_;
+};
+
+// An exporter that records the names of the views it is told were added.
+class ViewAddedExporter : public StatsExporter::Handler {
+ public:
+  explicit ViewAddedExporter(std::vector<std::string>* added)
+      : added_(added) {}
+
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {}
+  void ViewAdded(const ViewDescriptor& descriptor) override {
+    added_->push_back(descriptor.name());
+  }
+  absl::Duration ExportInterval() const override { return absl::Hours(1); }
+
+ private:
+  std::vector<std::string>* added_;
+};
+
+// An exporter that retains the data it is passed, as an asynchronous exporter
+// would.
+class RetainingExporter : public StatsExporter::Handler {
+ public:
+  typedef std::shared_ptr<
+      const std::vector<std::pair<ViewDescriptor, ViewData>>>
+      Batch;
+
+  explicit RetainingExporter(std::vector<Batch>* batches)
+      : batches_(batches) {}
+
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
+    ADD_FAILURE() << "ExportViewData() called instead of "
+                     "ExportViewDataBatch().";
+  }
+  void ExportViewDataBatch(Batch data) override {
+    batches_->push_back(std::move(data));
+  }
+  absl::Duration ExportInterval() const override { return absl::Hours(1); }
+
+ private:
+  std::vector<Batch>* batches_;
 };
 
 constexpr char kMeasureId[] = "test_measure_id";
@@ -107,6 +192,16 @@ TEST_F(StatsExporterTest, AddView) {
                                               ::testing::Key(descriptor2_)));
 }
 
+TEST_F(StatsExporterTest, ViewAdded) {
+  std::vector<std::string> added;
+  descriptor1_.RegisterForExport();
+  StatsExporter::RegisterPushHandler(
+      absl::make_unique<ViewAddedExporter>(&added));
+  EXPECT_THAT(added, ::testing::ElementsAre("id1"));
+  descriptor2_.RegisterForExport();
+  EXPECT_THAT(added, ::testing::ElementsAre("id1", "id2"));
+}
+
 TEST_F(StatsExporterTest, UpdateView) {
   std::vector<std::pair<ViewDescriptor, ViewData>> exported_data;
   MockExporter::Register(&exported_data);
@@ -149,6 +244,23 @@ TEST_F(StatsExporterTest, MultipleExporters) {
               ::testing::UnorderedElementsAre(::testing::Key(descriptor1_)));
 }
 
+TEST_F(StatsExporterTest, HandlersShareRetainedData) {
+  std::vector<RetainingExporter::Batch> batches_1;
+  StatsExporter::RegisterPushHandler(
+      absl::make_unique<RetainingExporter>(&batches_1));
+  std::vector<RetainingExporter::Batch> batches_2;
+  StatsExporter::RegisterPushHandler(
+      absl::make_unique<RetainingExporter>(&batches_2));
+  descriptor1_.RegisterForExport();
+  Export();
+  ASSERT_EQ(1, batches_1.size());
+  ASSERT_EQ(1, batches_2.size());
+  // The data is built once, and outlives the export.
+  EXPECT_EQ(batches_1[0].get(), batches_2[0].get());
+  EXPECT_THAT(*batches_1[0],
+              ::testing::UnorderedElementsAre(::testing::Key(descriptor1_)));
+}
+
 TEST_F(StatsExporterTest, IntervalViewRejected) {
   std::vector<std::pair<ViewDescriptor, ViewData>> exported_data;
   MockExporter::Register(&exported_data);
@@ -161,13 +273,227 @@ TEST_F(StatsExporterTest, IntervalViewRejected) {
   EXPECT_TRUE(exported_data.empty());
 }
 
-TEST_F(StatsExporterTest, TimedExport) {
+TEST_F(StatsExporterTest, ChangedRowsOnly) {
+  const auto key = opencensus::tags::TagKey::Register("key");
+  ViewDescriptor descriptor = ViewDescriptor()
+                                  .set_name("changed_rows")
+                                  .set_measure(kMeasureId)
+                                  .set_aggregation(Aggregation::Count())
+                                  .add_column(key);
+  std::vector<std::pair<ViewDescriptor, ViewData>> full_data;
+  std::vector<std::pair<ViewDescriptor, ViewData>> changed_data;
+  MockExporter::Register(&full_data);
+  MockExporter::Register(&changed_data, true);
+  descriptor.RegisterForExport();
+  descriptor2_.RegisterForExport();
+
+  Record({{TestMeasure(), 1.0}}, {{key, "a"}});
+  Record({{TestMeasure(), 1.0}}, {{key, "b"}});
+  testing::TestUtils::Flush();
+  Export();
+  // Everything is new on the first export.
+  ASSERT_EQ(2, changed_data.size());
+  full_data.clear();
+  changed_data.clear();
+
+  Record({{TestMeasure(), 1.0}}, {{key, "a"}});
+  testing::TestUtils::Flush();
+  Export();
+  ASSERT_EQ(2, full_data.size());
+  // descriptor2_ also has a single row, which changed.
+  ASSERT_EQ(2, changed_data.size());
+  for (const auto& datum : changed_data) {
+    if (datum.first == descriptor) {
+      EXPECT_THAT(datum.second.int_data(),
+                  ::testing::ElementsAre(
+                      ::testing::Pair(::testing::ElementsAre("a"), 2)));
+    }
+  }
+  for (const auto& datum : full_data) {
+    if (datum.first == descriptor) {
+      EXPECT_THAT(datum.second.int_data(),
+                  ::testing::UnorderedElementsAre(
+                      ::testing::Pair(::testing::ElementsAre("a"), 2),
+                      ::testing::Pair(::testing::ElementsAre("b"), 1)));
+    }
+  }
+  full_data.clear();
+  changed_data.clear();
+
+  // Views with no changes are omitted.
+  Export();
+  EXPECT_EQ(2, full_data.size());
+  EXPECT_TRUE(changed_data.empty());
+  StatsExporter::RemoveView(descriptor.name());
+}
+
+// A value read by a CallbackGauge through a member function.
+class Queue {
+ public:
+  explicit Queue(int length) : length_(length) {}
+  int length() const { return length_; }
+
+ private:
+  const int length_;
+};
+
+TEST_F(StatsExporterTest, CallbackGauge) {
+  const auto key = opencensus::tags::TagKey::Register("key");
+  static const MeasureInt64 length_measure =
+      MeasureInt64::Register("test_gauge_measure", "", "1");
   std::vector<std::pair<ViewDescriptor, ViewData>> exported_data;
   MockExporter::Register(&exported_data);
-  descriptor1_.RegisterForExport();
-  absl::SleepFor(absl::Seconds(11));
+
+  std::atomic<int64_t> length(1);
+  const Queue other_queue(3);
+  CallbackGauge<double> double_gauge("double_gauge", TestMeasure(),
+                                     [] { return 2.5; });
+  {
+    CallbackGauge<int64_t> gauge(
+        "length", length_measure, [&length] { return length.load(); },
+        {{key, "a"}});
+    CallbackGauge<int64_t> other_gauge("length", length_measure, &other_queue,
+                                       &Queue::length, {{key, "b"}});
+    const ViewDescriptor descriptor =
+        ViewDescriptor()
+            .set_name("length")
+            .set_measure("test_gauge_measure")
+            .set_aggregation(Aggregation::LastValue())
+            .add_column(key);
+
+    // Gauges are read at each export, without recording.
+    length = 2;
+    auto data = StatsExporter::GetViewData();
+    ASSERT_EQ(2, data.size());
+    for (const auto& datum : data) {
+      if (datum.first.name() == "length") {
+        EXPECT_EQ(descriptor, datum.first);
+        EXPECT_THAT(datum.second.int_data(),
+                    ::testing::UnorderedElementsAre(
+                        ::testing::Pair(::testing::ElementsAre("a"), 2),
+                        ::testing::Pair(::testing::ElementsAre("b"), 3)));
+      } else {
+        EXPECT_EQ("double_gauge", datum.first.name());
+        EXPECT_THAT(datum.second.double_data(),
+                    ::testing::ElementsAre(::testing::Pair(
+                        ::testing::ElementsAre(), 2.5)));
+      }
+    }
+    length = 4;
+    Export();
+    ASSERT_EQ(2, exported_data.size());
+    for (const auto& datum : exported_data) {
+      if (datum.first.name() == "length") {
+        EXPECT_THAT(datum.second.int_data(),
+                    ::testing::Contains(
+                        ::testing::Pair(::testing::ElementsAre("a"), 4)));
+      }
+    }
+    exported_data.clear();
+  }
+
+  // Destroyed gauges are not exported.
+  EXPECT_THAT(StatsExporter::GetViewData(),
+              ::testing::ElementsAre(::testing::Key(::testing::Property(
+                  &ViewDescriptor::name, "double_gauge"))));
+  Export();
   EXPECT_THAT(exported_data,
-              ::testing::UnorderedElementsAre(::testing::Key(descriptor1_)));
+              ::testing::ElementsAre(::testing::Key(::testing::Property(
+                  &ViewDescriptor::name, "double_gauge"))));
+}
+
+TEST_F(StatsExporterTest, GetViewDataByName) {
+  const auto key = opencensus::tags::TagKey::Register("key");
+  const ViewDescriptor descriptor = ViewDescriptor()
+                                        .set_name("by_name")
+                                        .set_measure(kMeasureId)
+                                        .set_aggregation(Aggregation::Count())
+                                        .add_column(key);
+  descriptor.RegisterForExport();
+  descriptor2_.RegisterForExport();
+  Record({{TestMeasure(), 1.0}}, {{key, "a"}});
+  Record({{TestMeasure(), 1.0}}, {{key, "a"}});
+  Record({{TestMeasure(), 1.0}}, {{key, "b"}});
+  testing::TestUtils::Flush();
+
+  const auto data = StatsExporter::GetViewData("by_name");
+  ASSERT_TRUE(data.has_value());
+  EXPECT_EQ(descriptor, data->first);
+  EXPECT_THAT(data->second.int_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a"), 2),
+                  ::testing::Pair(::testing::ElementsAre("b"), 1)));
+
+  // ViewData is not assignable, so each read needs a variable of its own.
+  const auto filtered = StatsExporter::GetViewData("by_name", {{key, "a"}});
+  ASSERT_TRUE(filtered.has_value());
+  EXPECT_THAT(filtered->second.int_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a"), 2)));
+
+  // Callback gauges can be read by name too.
+  CallbackGauge<double> gauge("by_name_gauge", TestMeasure(),
+                              [] { return 1.5; }, {{key, "a"}});
+  const auto gauge_b =
+      StatsExporter::GetViewData("by_name_gauge", {{key, "b"}});
+  ASSERT_TRUE(gauge_b.has_value());
+  EXPECT_TRUE(gauge_b->second.double_data().empty());
+  const auto gauge_a =
+      StatsExporter::GetViewData("by_name_gauge", {{key, "a"}});
+  ASSERT_TRUE(gauge_a.has_value());
+  EXPECT_THAT(gauge_a->second.double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a"), 1.5)));
+
+  EXPECT_FALSE(StatsExporter::GetViewData("unregistered").has_value());
+  StatsExporter::RemoveView(descriptor.name());
+}
+
+TEST_F(StatsExporterTest, GetViewNames) {
+  descriptor2_.RegisterForExport();
+  descriptor1_.RegisterForExport();
+  CallbackGauge<double> gauge_a("gauge", TestMeasure(), [] { return 1.0; });
+  CallbackGauge<double> gauge_b("gauge", TestMeasure(), [] { return 2.0; });
+  // Sorted, with each gauge view once.
+  EXPECT_THAT(StatsExporter::GetViewNames(),
+              ::testing::ElementsAre("gauge", "id1", "id2"));
+}
+
+TEST_F(StatsExporterTest, SlowHandler) {
+  absl::Notification release;
+  std::atomic<int> num_exports(0);
+  StatsExporter::RegisterPushHandler(
+      absl::make_unique<BlockingExporter>(&release, &num_exports));
+  std::vector<std::pair<ViewDescriptor, ViewData>> exported_data;
+  MockExporter::Register(&exported_data);
+  descriptor1_.RegisterForExport();
+
+  // The blocked handler delays the export only until its deadline.
+  const absl::Time start = absl::Now();
+  Export();
+  EXPECT_LT(absl::Now() - start, absl::Seconds(5));
+  EXPECT_EQ(1, exported_data.size());
+  // The blocked handler is skipped while it is still exporting.
+  Export();
+  EXPECT_EQ(2, exported_data.size());
+  EXPECT_THAT(StatsExporterImpl::Get()->HandlerOverrunsForTesting(),
+              ::testing::ElementsAre(2, 0));
+
+  release.Notify();
+  // Waits for the blocked handler to return.
+  StatsExporterImpl::Get()->ClearHandlersForTesting();
+  EXPECT_EQ(1, num_exports);
+}
+
+TEST_F(StatsExporterTest, TimedExport) {
+  std::vector<std::pair<ViewDescriptor, ViewData>> exported_data;
+  MockExporter::Register(&exported_data, false, absl::Seconds(1));
+  descriptor1_.RegisterForExport();
+  // The first export is within the first second, at a random phase.
+  absl::SleepFor(absl::Seconds(2.5));
+  EXPECT_THAT(exported_data, ::testing::Each(::testing::Key(descriptor1_)));
+  EXPECT_GE(exported_data.size(), 2);
+  EXPECT_LE(exported_data.size(), 3);
 }
 
 }  // namespace stats
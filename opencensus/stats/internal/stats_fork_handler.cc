@@ -0,0 +1,52 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/stats_fork_handler.h"
+
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/stats_exporter_impl.h"
+#include "opencensus/stats/internal/stats_manager.h"
+
+namespace opencensus {
+namespace stats {
+
+void RegisterStatsForkHandler() {
+  // The handlers run long after construction, so the Get() calls do not
+  // recurse into a constructor calling this.
+  static const bool registered = [] {
+    common::Scheduler::Get()->AddForkHandler(
+        {[] {
+           StatsExporterImpl::Get()->PrepareFork();
+           StatsManager::Get()->PrepareFork();
+           DeltaProducer::Get()->PrepareFork();
+         },
+         [] {
+           DeltaProducer::Get()->ParentAfterFork();
+           StatsManager::Get()->ParentAfterFork();
+           StatsExporterImpl::Get()->ParentAfterFork();
+         },
+         [] {
+           DeltaProducer::Get()->ChildAfterFork();
+           StatsManager::Get()->ChildAfterFork();
+           StatsExporterImpl::Get()->ChildAfterFork();
+         },
+         [] { StatsExporterImpl::Get()->RestartAfterFork(); }});
+    return true;
+  }();
+  static_cast<void>(registered);
+}
+
+}  // namespace stats
+}  // namespace opencensus
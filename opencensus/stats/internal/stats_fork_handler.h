@@ -0,0 +1,38 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_STATS_FORK_HANDLER_H_
+#define OPENCENSUS_STATS_INTERNAL_STATS_FORK_HANDLER_H_
+
+namespace opencensus {
+namespace stats {
+
+// Registers, once, the common::Scheduler fork handler for StatsExporterImpl,
+// StatsManager and DeltaProducer, each of which calls this on construction.
+// There is a single handler so that their mutexes are acquired in the order
+// the library nests them (the exporter adds views holding its mutex, which
+// take the StatsManager's and DeltaProducer's), whichever is constructed
+// first.
+//
+// The child keeps the registered views and handlers, but starts their data
+// afresh from the fork, so that prefork servers do not report the parent's
+// data from every child: the recorded data not yet harvested and the views'
+// aggregated data are discarded. The exporter's threads are restarted by the
+// first RestartAfterFork().
+void RegisterStatsForkHandler();
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_STATS_FORK_HANDLER_H_
@@ -14,18 +14,28 @@
 
 #include "opencensus/stats/internal/stats_manager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/memory/memory.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/scheduler.h"
 #include "opencensus/stats/aggregation.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/interval_buckets.h"
 #include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/stats/internal/stats_fork_handler.h"
+#include "opencensus/stats/internal/stats_persistence.h"
 #include "opencensus/stats/view_descriptor.h"
 #include "opencensus/tags/tag_key.h"
 #include "opencensus/tags/tag_map.h"
@@ -35,20 +45,118 @@ namespace stats {
 
 // TODO: See if it is possible to replace AssertHeld() with function
 // annotations.
-// TODO: Optimize selecting/sorting tag values for each view.
+
+namespace {
+
+// Returns the tag keys whose values a view of 'descriptor' needs recorded: its
+// columns and, for DistinctCount, the counted key.
+std::vector<opencensus::tags::TagKey> RecordedKeys(
+    const ViewDescriptor& descriptor) {
+  std::vector<opencensus::tags::TagKey> keys = descriptor.columns();
+  if (descriptor.aggregation().distinct_key().has_value()) {
+    keys.push_back(*descriptor.aggregation().distinct_key());
+  }
+  return keys;
+}
+
+}  // namespace
 
 // ========================================================================== //
 // StatsManager::ViewInformation
 
 StatsManager::ViewInformation::ViewInformation(const ViewDescriptor& descriptor,
-                                               absl::Mutex* mu)
-    : descriptor_(descriptor), mu_(mu), data_(absl::Now(), descriptor) {}
+                                               absl::Mutex* mu,
+                                               uint64_t last_skipped_delta,
+                                               std::unique_ptr<ViewDataImpl>
+                                                   restored_data)
+    : descriptor_(descriptor),
+      last_skipped_delta_(last_skipped_delta),
+      mu_(mu),
+      data_(restored_data != nullptr
+                ? std::shared_ptr<ViewDataImpl>(std::move(restored_data))
+                : std::make_shared<ViewDataImpl>(absl::Now(), descriptor)) {
+  const std::vector<opencensus::tags::TagKey>& columns = descriptor_.columns();
+  sorted_columns_.reserve(columns.size());
+  for (int i = 0; i < columns.size(); ++i) {
+    sorted_columns_.emplace_back(columns[i], i);
+  }
+  std::sort(sorted_columns_.begin(), sorted_columns_.end());
+  if (descriptor_.aggregation_window_.type() ==
+      AggregationWindow::Type::kInterval) {
+    interval_windows_.push_back(descriptor_.aggregation_window_.duration());
+  }
+}
 
 bool StatsManager::ViewInformation::Matches(
     const ViewDescriptor& descriptor) const {
-  return descriptor.aggregation() == descriptor_.aggregation() &&
-         descriptor.aggregation_window_ == descriptor_.aggregation_window_ &&
-         descriptor.columns() == descriptor_.columns();
+  if (descriptor.aggregation() != descriptor_.aggregation() ||
+      descriptor.columns() != descriptor_.columns() ||
+      descriptor.max_rows() != descriptor_.max_rows() ||
+      descriptor.top_k() != descriptor_.top_k() ||
+      descriptor.top_k_column() != descriptor_.top_k_column() ||
+      descriptor.row_ttl() != descriptor_.row_ttl()) {
+    return false;
+  }
+  if (descriptor.aggregation_window_ == descriptor_.aggregation_window_) {
+    return true;
+  }
+  // Rollups read their parent's data for its window only.
+  if (descriptor.aggregation_window_.type() !=
+          AggregationWindow::Type::kInterval ||
+      descriptor_.aggregation_window_.type() !=
+          AggregationWindow::Type::kInterval ||
+      rollup_parent_ != nullptr) {
+    return false;
+  }
+  mu_->AssertHeld();
+  for (const absl::Duration window : interval_windows_) {
+    if (!IntervalBuckets::Nest(window,
+                               descriptor.aggregation_window_.duration())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StatsManager::ViewInformation::RollsUpInto(
+    const ViewDescriptor& descriptor) const {
+  mu_->AssertHeld();
+  // Delta data is reset by each read, so it cannot be read for two views.
+  if (rollup_parent_ != nullptr ||
+      descriptor.aggregation() != descriptor_.aggregation() ||
+      descriptor.aggregation().type() == Aggregation::Type::kLastValue ||
+      descriptor.aggregation().type() == Aggregation::Type::kDistinctCount ||
+      descriptor.aggregation_window_ != descriptor_.aggregation_window_ ||
+      descriptor.aggregation_window_.type() ==
+          AggregationWindow::Type::kDelta ||
+      descriptor.max_rows() != descriptor_.max_rows() ||
+      descriptor.top_k() != descriptor_.top_k() ||
+      descriptor.top_k_column() != descriptor_.top_k_column() ||
+      descriptor.row_ttl() != descriptor_.row_ttl()) {
+    return false;
+  }
+  const std::vector<opencensus::tags::TagKey>& columns = descriptor_.columns();
+  for (const auto& column : descriptor.columns()) {
+    if (std::find(columns.begin(), columns.end(), column) == columns.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void StatsManager::ViewInformation::SetRollUpParent(ViewInformation* parent) {
+  mu_->AssertHeld();
+  rollup_parent_ = parent;
+  parent->AddConsumer(parent->descriptor_);
+  const std::vector<opencensus::tags::TagKey>& columns =
+      parent->descriptor_.columns();
+  rollup_columns_.clear();
+  for (const auto& column : descriptor_.columns()) {
+    rollup_columns_.push_back(
+        std::find(columns.begin(), columns.end(), column) - columns.begin());
+  }
+  // Any restored data is superseded by the parent's.
+  data_ = std::make_shared<ViewDataImpl>(absl::Now(), descriptor_);
 }
 
 int StatsManager::ViewInformation::num_consumers() const {
@@ -56,9 +164,20 @@ int StatsManager::ViewInformation::num_consumers() const {
   return num_consumers_;
 }
 
-void StatsManager::ViewInformation::AddConsumer() {
+void StatsManager::ViewInformation::AddConsumer(
+    const ViewDescriptor& descriptor) {
   mu_->AssertHeld();
   ++num_consumers_;
+  if (descriptor.aggregation_window_.type() !=
+      AggregationWindow::Type::kInterval) {
+    return;
+  }
+  const absl::Duration window = descriptor.aggregation_window_.duration();
+  if (std::find(interval_windows_.begin(), interval_windows_.end(), window) ==
+      interval_windows_.end()) {
+    interval_windows_.push_back(window);
+    MutableData()->AddIntervalWindow(window, absl::Now());
+  }
 }
 
 int StatsManager::ViewInformation::RemoveConsumer() {
@@ -66,33 +185,215 @@ int StatsManager::ViewInformation::RemoveConsumer() {
   return --num_consumers_;
 }
 
+void StatsManager::ViewInformation::SetSampleOneIn(uint32_t one_in) {
+  mu_->AssertHeld();
+  if (data_->sample_one_in() != one_in) {
+    MutableData()->set_sample_one_in(one_in);
+  }
+}
+
 void StatsManager::ViewInformation::MergeMeasureData(
     const opencensus::tags::TagMap& tags, const MeasureData& data,
     absl::Time now) {
   mu_->AssertHeld();
-  std::vector<std::string> tag_values(descriptor_.columns().size());
-  for (int i = 0; i < tag_values.size(); ++i) {
-    const opencensus::tags::TagKey column = descriptor_.columns()[i];
-    for (const auto& tag : tags.tags()) {
-      if (tag.first == column) {
-        tag_values[i] = std::string(tag.second);
+  tag_values_.assign(sorted_columns_.size(), absl::string_view());
+  // Both the tags and sorted_columns_ are sorted by key, so a single merge
+  // pass projects the tags onto the columns.
+  const auto& tag_list = tags.tag_views();
+  auto tag = tag_list.begin();
+  for (const auto& column : sorted_columns_) {
+    while (tag != tag_list.end() && tag->first < column.first) {
+      ++tag;
+    }
+    if (tag == tag_list.end()) {
+      break;
+    }
+    if (tag->first == column.first) {
+      tag_values_[column.second] = tag->second;
+    }
+  }
+  const absl::optional<opencensus::tags::TagKey>& distinct_key =
+      descriptor_.aggregation().distinct_key();
+  if (distinct_key.has_value()) {
+    // Recordings without the counted tag have no value to count.
+    for (const auto& tag : tag_list) {
+      if (tag.first == *distinct_key) {
+        MutableData()->MergeDistinct(tag_values_, tag.second, now);
         break;
       }
     }
+    return;
+  }
+  MutableData()->Merge(tag_values_, data, now);
+}
+
+void StatsManager::ViewInformation::ExpireRows(absl::Time now) {
+  mu_->AssertHeld();
+  // Check first, to avoid copying shared data when nothing expires.
+  if (data_->HasExpiredRows(now)) {
+    MutableData()->ExpireRows(now);
+  }
+}
+
+void StatsManager::ViewInformation::ResetData(absl::Time now) {
+  mu_->AssertHeld();
+  // Snapshots sharing the old data keep it.
+  data_ = std::make_shared<ViewDataImpl>(now, descriptor_);
+  ++generation_;
+  for (const absl::Duration window : interval_windows_) {
+    data_->AddIntervalWindow(window, now);
+  }
+  delta_buffer_ = nullptr;
+  if (published_ != nullptr) {
+    // Reads see the reset, and later the rest of the merge.
+    published_ = data_;
+  }
+}
+
+void StatsManager::ViewInformation::BeginMerge(bool consistent) {
+  mu_->AssertHeld();
+  if (!consistent) return;
+  merging_ = true;
+  if (descriptor_.aggregation_window_.type() !=
+      AggregationWindow::Type::kDelta) {
+    // Sharing data_ makes the merge write to a copy.
+    published_ = data_;
+  }
+}
+
+void StatsManager::ViewInformation::EndMerge() {
+  mu_->AssertHeld();
+  merging_ = false;
+  published_ = nullptr;
+}
+
+StatsMemoryUsage::View StatsManager::ViewInformation::MemoryUsage() const {
+  mu_->AssertHeld();
+  StatsMemoryUsage::View usage;
+  usage.name = descriptor_.name();
+  usage.rows = data_->num_rows();
+  usage.bytes = sizeof(*this) + data_->ApproximateBytes();
+  if (delta_buffer_ != nullptr) {
+    usage.bytes += delta_buffer_->ApproximateBytes();
+  }
+  absl::MutexLock l(&cache_mu_);
+  for (const IntervalSnapshot& snapshot : interval_cache_) {
+    usage.bytes += snapshot.data->ApproximateBytes();
+  }
+  return usage;
+}
+
+std::shared_ptr<const ViewDataImpl> StatsManager::ViewInformation::GetData(
+    const ViewDescriptor& descriptor) {
+  if (rollup_parent_ != nullptr) {
+    return rollup_parent_->GetData(rollup_parent_->descriptor_)
+        ->RollUp(rollup_columns_);
+  }
+  if (descriptor_.aggregation_window_.type() ==
+      AggregationWindow::Type::kDelta) {
+    // Taking the delta resets the data, which requires an exclusive lock.
+    absl::MutexLock l(mu_);
+    mu_->Await(absl::Condition(
+        +[](bool* merging) { return !*merging; }, &merging_));
+    const absl::Time now = absl::Now();
+    if (delta_buffer_ == nullptr || delta_buffer_.use_count() != 1) {
+      delta_buffer_ = std::make_shared<ViewDataImpl>(now, descriptor_);
+    } else {
+      // As in MutableData(), pairs with the release in the previous delta's
+      // destruction.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    MutableData()->TakeDeltaAndReset(now, delta_buffer_.get());
+    return delta_buffer_;
+  }
+  absl::ReaderMutexLock l(mu_);
+  const std::shared_ptr<ViewDataImpl>& data =
+      published_ != nullptr ? published_ : data_;
+  if (data->type() == ViewDataImpl::Type::kInterval) {
+    return IntervalData(*data, descriptor.aggregation_window_.duration(),
+                        absl::Now());
   }
-  data_.Merge(tag_values, data, now);
+  return data;
 }
 
-std::unique_ptr<ViewDataImpl> StatsManager::ViewInformation::GetData() {
+std::shared_ptr<const ViewDataImpl> StatsManager::ViewInformation::GetData(
+    const ViewDescriptor& descriptor, const ViewDataImpl::RowFilter& filter) {
+  if (rollup_parent_ != nullptr ||
+      descriptor_.aggregation_window_.type() ==
+          AggregationWindow::Type::kDelta) {
+    return GetData(descriptor)->MatchingRows(filter);
+  }
   absl::ReaderMutexLock l(mu_);
-  if (data_.type() == ViewDataImpl::Type::kStatsObject) {
-    return absl::make_unique<ViewDataImpl>(data_, absl::Now());
-  } else if (descriptor_.aggregation_window_.type() ==
-             AggregationWindow::Type::kDelta) {
-    return data_.GetDeltaAndReset(absl::Now());
-  } else {
-    return absl::make_unique<ViewDataImpl>(data_);
+  const std::shared_ptr<ViewDataImpl>& data =
+      published_ != nullptr ? published_ : data_;
+  if (data->type() == ViewDataImpl::Type::kInterval) {
+    return std::make_shared<ViewDataImpl>(
+        *data, descriptor.aggregation_window_.duration(), absl::Now(),
+        &filter);
   }
+  return data->MatchingRows(filter);
+}
+
+std::shared_ptr<const ViewDataImpl>
+StatsManager::ViewInformation::IntervalData(const ViewDataImpl& data,
+                                            absl::Duration window,
+                                            absl::Time now) {
+  mu_->AssertReaderHeld();
+  // Reads later in the current bucket weigh the oldest bucket less; reusing a
+  // snapshot for up to 1% of the bucket interval (and at most a second) keeps
+  // that drift under 1% of the oldest bucket's data.
+  const absl::Duration bucket_interval =
+      IntervalBuckets::BucketInterval(window);
+  const absl::Duration max_age =
+      std::min(bucket_interval / 100, absl::Seconds(1));
+  const int64_t bucket_nanos = absl::ToInt64Nanoseconds(bucket_interval);
+  {
+    absl::MutexLock l(&cache_mu_);
+    for (const IntervalSnapshot& snapshot : interval_cache_) {
+      if (snapshot.window == window) {
+        if (snapshot.generation == generation_ && now >= snapshot.time &&
+            now - snapshot.time <= max_age &&
+            absl::ToUnixNanos(now) / bucket_nanos ==
+                absl::ToUnixNanos(snapshot.time) / bucket_nanos) {
+          return snapshot.data;
+        }
+        break;
+      }
+    }
+  }
+  std::shared_ptr<const ViewDataImpl> result =
+      std::make_shared<ViewDataImpl>(data, window, now);
+  absl::MutexLock l(&cache_mu_);
+  IntervalSnapshot* entry = nullptr;
+  for (IntervalSnapshot& snapshot : interval_cache_) {
+    if (snapshot.window == window) {
+      entry = &snapshot;
+      break;
+    }
+  }
+  if (entry == nullptr) {
+    interval_cache_.emplace_back();
+    entry = &interval_cache_.back();
+    entry->window = window;
+  }
+  entry->time = now;
+  entry->generation = generation_;
+  entry->data = result;
+  return result;
+}
+
+ViewDataImpl* StatsManager::ViewInformation::MutableData() {
+  mu_->AssertHeld();
+  ++generation_;
+  // Snapshots are only taken under *mu_, so if no snapshot shares data_ none
+  // can start to until *mu_ is released.
+  if (data_.use_count() != 1) {
+    data_ = std::make_shared<ViewDataImpl>(*data_);
+  }
+  // Pairs with the release in the last snapshot's destruction, so that its
+  // reads happen before our writes.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return data_.get();
 }
 
 // ==========================================================================
@@ -100,29 +401,145 @@ std::unique_ptr<ViewDataImpl> StatsManager::ViewInformation::GetData() {
 
 void StatsManager::MeasureInformation::MergeMeasureData(
     const opencensus::tags::TagMap& tags, const MeasureData& data,
-    absl::Time now) {
-  mu_->AssertHeld();
+    uint64_t sequence, absl::Time now) {
+  mu_.AssertHeld();
   for (auto& view : views_) {
-    view->MergeMeasureData(tags, data, now);
+    if (view->MergesDelta(sequence)) {
+      view->MergeMeasureData(tags, data, now);
+    }
+  }
+}
+
+void StatsManager::MeasureInformation::MergeDeltas(
+    size_t index, absl::Span<const Delta* const> deltas, uint64_t sequence,
+    absl::Time now, const HarvestParams& params) {
+  mu_.Lock();
+  const uint64_t chunk_size = params.merge_chunk_size;
+  if (chunk_size != 0) {
+    for (auto& view : views_) {
+      if (view->MergesDelta(sequence)) {
+        view->BeginMerge(params.consistent_merge_reads);
+      }
+    }
+  }
+  uint64_t merged_in_chunk = 0;
+  for (const Delta* delta : deltas) {
+    // Every row of a delta has an entry for every measure in the delta's
+    // configuration, which may not yet include the latest measures.
+    if (delta->delta().empty() ||
+        index >= delta->delta().begin()->second.size()) {
+      continue;
+    }
+    const uint32_t one_in = delta->config().measures[index].sample_one_in;
+    for (auto& view : views_) {
+      if (view->MergesDelta(sequence)) {
+        view->SetSampleOneIn(one_in);
+      }
+    }
+    for (const auto& data_for_tagset : delta->delta()) {
+      // Only add data if there is data for this tagset/measure combination,
+      // to avoid creating spurious empty rows.
+      if (data_for_tagset.second[index].count() != 0) {
+        if (one_in > 1) {
+          // Each recording kept stands for 'one_in' recordings.
+          MeasureData scaled = data_for_tagset.second[index];
+          scaled.Scale(one_in);
+          MergeMeasureData(data_for_tagset.first, scaled, sequence, now);
+        } else {
+          MergeMeasureData(data_for_tagset.first,
+                           data_for_tagset.second[index], sequence, now);
+        }
+        if (chunk_size != 0 && ++merged_in_chunk == chunk_size) {
+          merged_in_chunk = 0;
+          // Views may be added or removed while the lock is released. Added
+          // views do not merge this delta, as for views added before it.
+          mu_.Unlock();
+          // Give waiting readers a chance to take the lock before we retake
+          // it.
+          std::this_thread::yield();
+          mu_.Lock();
+        }
+      }
+    }
+  }
+  // Expire after merging, so that rows updated in this delta survive.
+  ExpireRows(now);
+  if (chunk_size != 0) {
+    for (auto& view : views_) {
+      view->EndMerge();
+    }
+  }
+  mu_.Unlock();
+}
+
+void StatsManager::MeasureInformation::ExpireRows(absl::Time now) {
+  mu_.AssertHeld();
+  for (auto& view : views_) {
+    view->ExpireRows(now);
+  }
+}
+
+void StatsManager::MeasureInformation::ResetData(absl::Time now) {
+  mu_.AssertHeld();
+  for (auto& view : views_) {
+    view->ResetData(now);
+  }
+}
+
+void StatsManager::MeasureInformation::AddMemoryUsage(
+    std::vector<StatsMemoryUsage::View>* views) const {
+  absl::MutexLock l(&mu_);
+  for (const auto& view : views_) {
+    views->push_back(view->MemoryUsage());
   }
 }
 
 StatsManager::ViewInformation* StatsManager::MeasureInformation::AddConsumer(
-    const ViewDescriptor& descriptor) {
-  mu_->AssertHeld();
+    const ViewDescriptor& descriptor, uint64_t last_skipped_delta,
+    std::unique_ptr<ViewDataImpl> restored_data, bool disabled) {
+  mu_.AssertHeld();
   for (auto& view : views_) {
     if (view->Matches(descriptor)) {
-      view->AddConsumer();
+      view->AddConsumer(descriptor);
       return view.get();
     }
   }
-  views_.emplace_back(new ViewInformation(descriptor, mu_));
+  std::unique_ptr<ViewInformation> view(new ViewInformation(
+      descriptor, &mu_, last_skipped_delta, std::move(restored_data)));
+  if (descriptor.rollup()) {
+    for (auto& parent : views_) {
+      if (parent->RollsUpInto(descriptor)) {
+        view->SetRollUpParent(parent.get());
+        break;
+      }
+    }
+  }
+  view->set_disabled(disabled);
+  views_.push_back(std::move(view));
   return views_.back().get();
 }
 
+void StatsManager::MeasureInformation::SetDisabledViews(
+    const absl::flat_hash_set<std::string>& names) {
+  mu_.AssertHeld();
+  for (auto& view : views_) {
+    view->set_disabled(names.contains(view->view_descriptor().name()));
+  }
+}
+
+bool StatsManager::MeasureInformation::AllViewsDisabled() const {
+  mu_.AssertHeld();
+  for (const auto& view : views_) {
+    if (!view->disabled()) {
+      return false;
+    }
+  }
+  return !views_.empty();
+}
+
 void StatsManager::MeasureInformation::RemoveView(
     const ViewInformation* handle) {
-  mu_->AssertHeld();
+  mu_.AssertHeld();
   for (auto it = views_.begin(); it != views_.end(); ++it) {
     if (it->get() == handle) {
       ABSL_ASSERT((*it)->num_consumers() == 0);
@@ -144,27 +561,101 @@ StatsManager* StatsManager::Get() {
   return global_stats_manager;
 }
 
-void StatsManager::MergeDelta(const Delta& delta) {
-  absl::MutexLock l(&mu_);
-  absl::Time now = absl::Now();
+StatsManager::StatsManager() { RegisterStatsForkHandler(); }
+
+void StatsManager::PrepareFork() {
+  kill_switch_mu_.Lock();
+  mu_.Lock();
+  for (const auto& measure : measures_) {
+    measure->mu()->Lock();
+  }
+}
+
+void StatsManager::ParentAfterFork() {
+  for (const auto& measure : measures_) {
+    measure->mu()->Unlock();
+  }
+  mu_.Unlock();
+  kill_switch_mu_.Unlock();
+}
+
+void StatsManager::ChildAfterFork() {
+  const absl::Time now = absl::Now();
+  for (const auto& measure : measures_) {
+    measure->ResetData(now);
+    common::Scheduler::ReinitMutexInChild(measure->mu());
+  }
+  common::Scheduler::ReinitMutexInChild(&mu_);
+  common::Scheduler::ReinitMutexInChild(&kill_switch_mu_);
+}
+
+void StatsManager::MergeDeltas(absl::Span<const Delta* const> deltas,
+                               uint64_t sequence, const HarvestParams& params) {
+  OPENCENSUS_PROBE2(stats_merge_begin, sequence, deltas.size());
+  absl::ReaderMutexLock l(&mu_);
+  const absl::Time now = absl::Now();
   // Measures are added to the StatsManager before the DeltaProducer, so there
   // should never be measures in the delta missing from measures_.
-  for (const auto& data_for_tagset : delta.delta()) {
-    for (int i = 0; i < data_for_tagset.second.size(); ++i) {
-      // Only add data if there is data for this tagset/measure combination, to
-      // avoid creating spurious empty rows.
-      if (data_for_tagset.second[i].count() != 0) {
-        measures_[i].MergeMeasureData(data_for_tagset.first,
-                                      data_for_tagset.second[i], now);
-      }
+  for (const Delta* delta : deltas) {
+    ABSL_ASSERT(delta->delta().empty() ||
+                delta->delta().begin()->second.size() <= measures_.size());
+  }
+  // The reader lock keeps measures_ stable until the helpers are joined. Each
+  // thread takes the next unmerged measure, so that a few measures with many
+  // views or tag sets do not leave the other threads idle.
+  std::vector<MeasureInformation*> measures;
+  measures.reserve(measures_.size());
+  for (const auto& measure : measures_) {
+    measures.push_back(measure.get());
+  }
+  std::atomic<size_t> next_measure(0);
+  const auto merge = [&]() {
+    for (size_t i = next_measure.fetch_add(1, std::memory_order_relaxed);
+         i < measures.size();
+         i = next_measure.fetch_add(1, std::memory_order_relaxed)) {
+      measures[i]->MergeDeltas(i, deltas, sequence, now, params);
     }
+  };
+  const size_t num_helpers =
+      std::min<size_t>(std::max(params.merge_threads, 1),
+                       std::max<size_t>(measures.size(), 1)) -
+      1;
+  std::vector<std::thread> helpers;
+  helpers.reserve(num_helpers);
+  for (size_t i = 0; i < num_helpers; ++i) {
+    helpers.emplace_back(merge);
   }
+  merge();
+  for (auto& helper : helpers) {
+    helper.join();
+  }
+  OPENCENSUS_PROBE1(stats_merge_end, sequence);
+}
+
+void StatsManager::MergeDeltaAt(const Delta& delta, uint64_t sequence,
+                                absl::Time time) {
+  absl::ReaderMutexLock l(&mu_);
+  const Delta* const deltas[] = {&delta};
+  const HarvestParams params;
+  for (size_t i = 0; i < measures_.size(); ++i) {
+    measures_[i]->MergeDeltas(i, deltas, sequence, time, params);
+  }
+}
+
+std::vector<StatsMemoryUsage::View> StatsManager::GetViewMemoryUsage() const {
+  std::vector<StatsMemoryUsage::View> views;
+  absl::ReaderMutexLock l(&mu_);
+  for (const auto& measure : measures_) {
+    measure->AddMemoryUsage(&views);
+  }
+  return views;
 }
 
 template <typename MeasureT>
 void StatsManager::AddMeasure(Measure<MeasureT> measure) {
   absl::MutexLock l(&mu_);
-  measures_.emplace_back(MeasureInformation(&mu_));
+  measures_.push_back(absl::make_unique<MeasureInformation>(
+      MeasureRegistryImpl::Get()->GetDescriptor(measure).name()));
   ABSL_ASSERT(measures_.size() ==
               MeasureRegistryImpl::MeasureToIndex(measure) + 1);
 }
@@ -180,28 +671,170 @@ StatsManager::ViewInformation* StatsManager::AddConsumer(
               << descriptor.DebugString() << "\n";
     return nullptr;
   }
+  const bool uses_exponential_histogram =
+      descriptor.aggregation().type() ==
+          Aggregation::Type::kExponentialHistogram ||
+      descriptor.aggregation().type() == Aggregation::Type::kQuantiles;
+  if (uses_exponential_histogram && descriptor.aggregation_window_.type() ==
+                                        AggregationWindow::Type::kInterval) {
+    std::cerr << "ExponentialHistogram and Quantiles aggregations do not "
+                 "support interval aggregation windows:\n"
+              << descriptor.DebugString() << "\n";
+    return nullptr;
+  }
+  if (descriptor.aggregation().type() == Aggregation::Type::kDistinctCount &&
+      descriptor.aggregation_window_.type() ==
+          AggregationWindow::Type::kInterval) {
+    std::cerr << "DistinctCount aggregations do not support interval "
+                 "aggregation windows:\n"
+              << descriptor.DebugString() << "\n";
+    return nullptr;
+  }
+  if (descriptor.top_k() > 0 &&
+      (descriptor.aggregation().type() == Aggregation::Type::kLastValue ||
+       descriptor.aggregation().type() == Aggregation::Type::kDistinctCount ||
+       descriptor.aggregation_window_.type() ==
+           AggregationWindow::Type::kInterval ||
+       std::find(descriptor.columns().begin(), descriptor.columns().end(),
+                 *descriptor.top_k_column()) == descriptor.columns().end())) {
+    std::cerr << "top_k requires one of the view's columns, and does not "
+                 "support LastValue or DistinctCount aggregations or interval "
+                 "aggregation windows:\n"
+              << descriptor.DebugString() << "\n";
+    return nullptr;
+  }
   const uint64_t index = MeasureRegistryImpl::IdToIndex(descriptor.measure_id_);
-  // We need to call this outside of the locked portion to avoid a deadlock when
-  // the DeltaProducer flushes the old delta. We call it before adding the view
-  // to avoid errors from the old delta not having a histogram for the new view.
+  absl::MutexLock kill_switch_lock(&kill_switch_mu_);
+  // Settle whether the measure is disabled before AddView() may start
+  // recording it.
+  UpdateMeasureDisabled(index);
+  UpdateMeasureSampling(index);
+  // We call these outside of the locked portion since they take the
+  // DeltaProducer's locks. The view skips deltas recorded before the
+  // configuration it needs, which may still be queued for merging.
   if (descriptor.aggregation().type() == Aggregation::Type::kDistribution) {
     DeltaProducer::Get()->AddBoundaries(
         index, descriptor.aggregation().bucket_boundaries());
+  } else if (uses_exponential_histogram) {
+    DeltaProducer::Get()->AddExponentialHistogram(
+        index, descriptor.aggregation().max_buckets());
   }
-  absl::MutexLock l(&mu_);
-  return measures_[index].AddConsumer(descriptor);
+  // Likewise, start recording the measure before adding the view.
+  const uint64_t last_skipped_delta =
+      DeltaProducer::Get()->AddView(index, RecordedKeys(descriptor));
+  // Only used if there is no matching view already, whose data is newer.
+  std::unique_ptr<ViewDataImpl> restored_data =
+      StatsPersistence::Get()->Restore(descriptor);
+  ViewInformation* handle;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    MeasureInformation& measure = *measures_[index];
+    absl::MutexLock measure_lock(measure.mu());
+    handle = measure.AddConsumer(descriptor, last_skipped_delta,
+                                 std::move(restored_data),
+                                 disabled_views_.contains(descriptor.name()));
+  }
+  UpdateMeasureDisabled(index);
+  return handle;
 }
 
 void StatsManager::RemoveConsumer(ViewInformation* handle) {
-  absl::MutexLock l(&mu_);
-  const int num_consumers_remaining = handle->RemoveConsumer();
-  ABSL_ASSERT(num_consumers_remaining >= 0);
-  if (num_consumers_remaining == 0) {
-    const auto& descriptor = handle->view_descriptor();
-    const uint64_t index =
-        MeasureRegistryImpl::IdToIndex(descriptor.measure_id_);
-    measures_[index].RemoveView(handle);
+  const uint64_t index =
+      MeasureRegistryImpl::IdToIndex(handle->view_descriptor().measure_id_);
+  // Copied, since the handle may be deleted.
+  const std::vector<opencensus::tags::TagKey> columns =
+      RecordedKeys(handle->view_descriptor());
+  absl::MutexLock kill_switch_lock(&kill_switch_mu_);
+  {
+    absl::ReaderMutexLock l(&mu_);
+    MeasureInformation& measure = *measures_[index];
+    absl::MutexLock measure_lock(measure.mu());
+    const int num_consumers_remaining = handle->RemoveConsumer();
+    ABSL_ASSERT(num_consumers_remaining >= 0);
+    if (num_consumers_remaining == 0) {
+      ViewInformation* const parent = handle->rollup_parent();
+      measure.RemoveView(handle);
+      // Release the rollup's consumer of its parent.
+      if (parent != nullptr && parent->RemoveConsumer() == 0) {
+        measure.RemoveView(parent);
+      }
+    }
+  }
+  DeltaProducer::Get()->RemoveView(index, columns);
+  UpdateMeasureDisabled(index);
+}
+
+void StatsManager::SetDisabledMeasures(const std::vector<std::string>& names) {
+  absl::MutexLock kill_switch_lock(&kill_switch_mu_);
+  disabled_measures_ =
+      absl::flat_hash_set<std::string>(names.begin(), names.end());
+  size_t num_measures;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    num_measures = measures_.size();
+  }
+  for (size_t index = 0; index < num_measures; ++index) {
+    UpdateMeasureDisabled(index);
+  }
+}
+
+void StatsManager::SetDisabledViews(const std::vector<std::string>& names) {
+  absl::MutexLock kill_switch_lock(&kill_switch_mu_);
+  disabled_views_ =
+      absl::flat_hash_set<std::string>(names.begin(), names.end());
+  size_t num_measures;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    num_measures = measures_.size();
+    for (const auto& measure : measures_) {
+      absl::MutexLock measure_lock(measure->mu());
+      measure->SetDisabledViews(disabled_views_);
+    }
+  }
+  for (size_t index = 0; index < num_measures; ++index) {
+    UpdateMeasureDisabled(index);
+  }
+}
+
+void StatsManager::SetMeasureSampling(
+    const std::vector<std::pair<std::string, uint32_t>>& rates) {
+  absl::MutexLock kill_switch_lock(&kill_switch_mu_);
+  measure_sampling_ =
+      absl::flat_hash_map<std::string, uint32_t>(rates.begin(), rates.end());
+  size_t num_measures;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    num_measures = measures_.size();
+  }
+  for (size_t index = 0; index < num_measures; ++index) {
+    UpdateMeasureSampling(index);
+  }
+}
+
+void StatsManager::UpdateMeasureSampling(uint64_t index) {
+  uint32_t one_in = 1;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    const auto it = measure_sampling_.find(measures_[index]->name());
+    if (it != measure_sampling_.end()) {
+      one_in = it->second;
+    }
+  }
+  // Outside mu_, since this takes the DeltaProducer's locks.
+  DeltaProducer::Get()->SetMeasureSampling(index, one_in);
+}
+
+void StatsManager::UpdateMeasureDisabled(uint64_t index) {
+  bool disabled;
+  {
+    absl::ReaderMutexLock l(&mu_);
+    const MeasureInformation& measure = *measures_[index];
+    absl::MutexLock measure_lock(measure.mu());
+    disabled = disabled_measures_.contains(measure.name()) ||
+               measure.AllViewsDisabled();
   }
+  // Outside mu_, since this takes the DeltaProducer's locks.
+  DeltaProducer::Get()->SetMeasureDisabled(index, disabled);
 }
 
 }  // namespace stats
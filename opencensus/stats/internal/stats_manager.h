@@ -15,17 +15,24 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_STATS_MANAGER_H_
 #define OPENCENSUS_STATS_INTERNAL_STATS_MANAGER_H_
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
-#include "opencensus/common/internal/stats_object.h"
 #include "opencensus/stats/distribution.h"
 #include "opencensus/stats/internal/delta_producer.h"
 #include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/internal/view_data_impl.h"
 #include "opencensus/stats/measure.h"
+#include "opencensus/stats/stats_config.h"
 #include "opencensus/stats/view_descriptor.h"
 #include "opencensus/tags/tag_key.h"
 #include "opencensus/tags/tag_map.h"
@@ -43,16 +50,36 @@ class StatsManager final {
   // external mutex, which most non-const member functions require holding.
   class ViewInformation {
    public:
-    ViewInformation(const ViewDescriptor& descriptor, absl::Mutex* mu);
+    // The view merges deltas with sequence numbers after 'last_skipped_delta'
+    // (see DeltaProducer::AddView()). It starts with 'restored_data' if not
+    // null, and otherwise empty.
+    ViewInformation(const ViewDescriptor& descriptor, absl::Mutex* mu,
+                    uint64_t last_skipped_delta,
+                    std::unique_ptr<ViewDataImpl> restored_data);
 
     // Returns true if this ViewInformation can be used to provide data for
     // 'descriptor' (i.e. shares measure, aggregation, aggregation window, and
-    // columns; this does not compare view name and description).
+    // columns; this does not compare view name and description). Interval
+    // views of different windows match if their buckets nest with those of
+    // every window of this (see IntervalBuckets::Nest()), and share one store
+    // of rows. Requires holding *mu_.
     bool Matches(const ViewDescriptor& descriptor) const;
 
+    // Returns true if this ViewInformation can provide the data of the rollup
+    // view 'descriptor' (see ViewDescriptor::set_rollup()) by aggregating its
+    // rows. Requires holding *mu_.
+    bool RollsUpInto(const ViewDescriptor& descriptor) const;
+    // Makes this a rollup of 'parent', which RollsUpInto() this view's
+    // descriptor: GetData() aggregates the parent's data rather than this
+    // view merging data itself. Adds a consumer of 'parent' until this
+    // ViewInformation is removed. Requires holding *mu_.
+    void SetRollUpParent(ViewInformation* parent);
+    ViewInformation* rollup_parent() const { return rollup_parent_; }
+
     int num_consumers() const;
-    // Increments the consumer count. Requires holding *mu_.
-    void AddConsumer();
+    // Increments the consumer count, adding the window of 'descriptor', which
+    // must match, if it is a new interval window. Requires holding *mu_.
+    void AddConsumer(const ViewDescriptor& descriptor);
     // Decrements the consumer count and returns the resulting count. Requires
     // holding *mu_.
     int RemoveConsumer();
@@ -60,32 +87,157 @@ class StatsManager final {
     // Adds 'data' under 'tags' as of 'now'. Requires holding *mu_;
     void MergeMeasureData(const opencensus::tags::TagMap& tags,
                           const MeasureData& data, absl::Time now);
+    // Records that the data merged next was sampled 1 in 'one_in' (see
+    // ViewData::sample_one_in()). Requires holding *mu_.
+    void SetSampleOneIn(uint32_t one_in);
+
+    // Removes rows past the view's row_ttl() as of 'now'. Requires holding
+    // *mu_.
+    void ExpireRows(absl::Time now);
+
+    // Discards all data, restarting the view at 'now'. Requires holding *mu_.
+    void ResetData(absl::Time now);
+
+    // Bracket a merge that releases *mu_ between chunks. If 'consistent', reads
+    // until EndMerge() see the data as of BeginMerge() (or, for delta views,
+    // wait for EndMerge()). Require holding *mu_.
+    void BeginMerge(bool consistent);
+    void EndMerge();
 
-    // Retrieves a copy of the data.
-    std::unique_ptr<ViewDataImpl> GetData() LOCKS_EXCLUDED(*mu_);
+    // Returns the rows and approximate bytes of data_, the cached interval
+    // snapshots and, for delta views, delta_buffer_. Snapshots returned by
+    // GetData() are not counted once data_ no longer shares them. Requires
+    // holding *mu_.
+    StatsMemoryUsage::View MemoryUsage() const LOCKS_EXCLUDED(cache_mu_);
+
+    // Retrieves a snapshot of the data for the consumer with 'descriptor',
+    // whose aggregation window selects the window of interval data.
+    // Cumulative data is shared with the ViewInformation rather than copied;
+    // it is copied only if the snapshot is still alive when the data is next
+    // written to. Delta data is moved into delta_buffer_, whose storage is
+    // reused by the next delta if the snapshot has been released by then.
+    // Interval snapshots are cached (see interval_cache_), so repeated reads
+    // of a window share one.
+    std::shared_ptr<const ViewDataImpl> GetData(
+        const ViewDescriptor& descriptor) LOCKS_EXCLUDED(*mu_, cache_mu_);
+    // Retrieves only the rows matching 'filter'. These are copied rather than
+    // shared, so that later writes do not copy the rest of the data. Delta
+    // data is taken and reset as by GetData().
+    std::shared_ptr<const ViewDataImpl> GetData(
+        const ViewDescriptor& descriptor,
+        const ViewDataImpl::RowFilter& filter)
+        LOCKS_EXCLUDED(*mu_, cache_mu_);
 
     const ViewDescriptor& view_descriptor() const { return descriptor_; }
 
+    // Returns true if the delta numbered 'sequence' should be merged into the
+    // view. Requires holding *mu_.
+    bool MergesDelta(uint64_t sequence) const {
+      return !disabled_ && rollup_parent_ == nullptr &&
+             sequence > last_skipped_delta_;
+    }
+
+    // A disabled view merges no deltas, keeping its earlier data. Require
+    // holding *mu_.
+    bool disabled() const { return disabled_; }
+    void set_disabled(bool disabled) { disabled_ = disabled; }
+
    private:
     const ViewDescriptor descriptor_;
+    const uint64_t last_skipped_delta_;
+    // The view's columns paired with their indices, sorted by key (in the
+    // same order as TagMap::tag_views()) so that MergeMeasureData() can select
+    // the row's tag values in one pass.
+    std::vector<std::pair<opencensus::tags::TagKey, int>> sorted_columns_;
 
     absl::Mutex* const mu_;  // Not owned.
     // The number of View objects backed by this ViewInformation, for
     // reference-counted GC.
     int num_consumers_ GUARDED_BY(*mu_) = 1;
+    // If not null, the view whose data this view's is aggregated from. Set
+    // before the handle is returned, and not changed after.
+    ViewInformation* rollup_parent_ = nullptr;
+    // The indices of this view's columns among the parent's.
+    std::vector<int> rollup_columns_;
+    // For interval views, the windows of all consumers so far, which data_
+    // keeps levels for. Windows are kept after their consumers are removed.
+    std::vector<absl::Duration> interval_windows_ GUARDED_BY(*mu_);
 
     // Possible types of stored data.
     enum class DataType { kDouble, kUint64, kDistribution, kInterval };
     static DataType DataTypeForDescriptor(const ViewDescriptor& descriptor);
 
-    ViewDataImpl data_ GUARDED_BY(*mu_);
+    // Returns data_ for writing, first replacing it with a private copy if any
+    // snapshots returned by GetData() share it. Requires holding *mu_.
+    ViewDataImpl* MutableData();
+
+    // Returns the snapshot of interval window 'window' of 'data' as of 'now',
+    // from interval_cache_ if it holds one that is still current. Requires
+    // holding a reader lock on *mu_.
+    std::shared_ptr<const ViewDataImpl> IntervalData(
+        const ViewDataImpl& data, absl::Duration window, absl::Time now)
+        LOCKS_EXCLUDED(cache_mu_);
+
+    std::shared_ptr<ViewDataImpl> data_ GUARDED_BY(*mu_);
+    // During a consistent chunked merge, the data as of its start, returned
+    // by GetData() instead of data_.
+    std::shared_ptr<ViewDataImpl> published_ GUARDED_BY(*mu_);
+    // Whether a consistent chunked merge is in progress.
+    bool merging_ GUARDED_BY(*mu_) = false;
+    bool disabled_ GUARDED_BY(*mu_) = false;
+    // The last delta returned by GetData(), for delta views.
+    std::shared_ptr<ViewDataImpl> delta_buffer_ GUARDED_BY(*mu_);
+    // Incremented whenever data_ is written to or replaced, so that cached
+    // snapshots of it can be checked.
+    uint64_t generation_ GUARDED_BY(*mu_) = 0;
+
+    // A snapshot of one interval window, as of 'time' and generation_
+    // 'generation'.
+    struct IntervalSnapshot {
+      absl::Duration window;
+      absl::Time time;
+      uint64_t generation;
+      std::shared_ptr<const ViewDataImpl> data;
+    };
+    // The last snapshot of each window read. Scrapers and exporters often read
+    // a view within moments of each other, and building an interval snapshot
+    // weighs every row's buckets, so a snapshot is reused until the data is
+    // written to, its window's current bucket ends, or its interpolation of
+    // the oldest bucket drifts (see IntervalData()). Reads only hold a reader
+    // lock on *mu_, so the cache has a mutex of its own, acquired after *mu_.
+    mutable absl::Mutex cache_mu_;
+    std::vector<IntervalSnapshot> interval_cache_ GUARDED_BY(cache_mu_);
+    // Scratch space for the tag values of the row being recorded, reused to
+    // avoid an allocation per record. The views point into the recorded
+    // TagMap and are only valid during MergeMeasureData.
+    std::vector<absl::string_view> tag_values_ GUARDED_BY(*mu_);
   };
 
  public:
   static StatsManager* Get();
 
-  // Merges all data from 'delta' at the present time.
-  void MergeDelta(const Delta& delta) LOCKS_EXCLUDED(mu_);
+  // Merges all data from 'deltas', the shards of the queued delta numbered
+  // 'sequence', at the present time into the views that merge it. Each measure
+  // is merged under its own lock, so exporters reading other measures are not
+  // blocked, and in chunks as set by params.merge_chunk_size. Measures are
+  // divided among params.merge_threads threads: the calling thread and
+  // merge_threads - 1 helper threads, which are started for the merge and
+  // joined before returning.
+  void MergeDeltas(absl::Span<const Delta* const> deltas, uint64_t sequence,
+                   const HarvestParams& params = HarvestParams())
+      LOCKS_EXCLUDED(mu_);
+
+  // Merges 'delta', recorded outside the harvest cycle with the configuration
+  // of the delta numbered 'sequence', as of 'time' rather than the present
+  // (see RecordBatchAt()) into the views that merge that delta. Measures are
+  // merged one at a time on the calling thread.
+  void MergeDeltaAt(const Delta& delta, uint64_t sequence, absl::Time time)
+      LOCKS_EXCLUDED(mu_);
+
+  // Returns the memory usage of each view's data. Each measure's lock is held
+  // only while its views are measured.
+  std::vector<StatsMemoryUsage::View> GetViewMemoryUsage() const
+      LOCKS_EXCLUDED(mu_);
 
   // Adds a measure--this is necessary for views to be added under that measure.
   template <typename MeasureT>
@@ -100,34 +252,118 @@ class StatsManager final {
   // that was the last consumer.
   void RemoveConsumer(ViewInformation* handle) LOCKS_EXCLUDED(mu_);
 
+  // Replace the names of the disabled measures and views (see
+  // StatsConfig::SetDisabledMeasures() and SetDisabledViews()). A measure is
+  // not recorded while it is disabled or all of its views are.
+  void SetDisabledMeasures(const std::vector<std::string>& names)
+      LOCKS_EXCLUDED(kill_switch_mu_, mu_);
+  void SetDisabledViews(const std::vector<std::string>& names)
+      LOCKS_EXCLUDED(kill_switch_mu_, mu_);
+  // Replaces the sampling rates of measures by name (see
+  // StatsConfig::SetMeasureSampling()).
+  void SetMeasureSampling(
+      const std::vector<std::pair<std::string, uint32_t>>& rates)
+      LOCKS_EXCLUDED(kill_switch_mu_, mu_);
+
+  // For the stats fork handler (see stats_fork_handler.h). The child discards
+  // the data of every view.
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+
  private:
+  // Registers the fork handler.
+  StatsManager();
+
   // MeasureInformation stores all ViewInformation objects for a given measure.
+  // Each MeasureInformation has its own mutex, guarding its views and their
+  // data, so that operations on different measures do not contend.
   class MeasureInformation {
    public:
-    explicit MeasureInformation(absl::Mutex* mu) : mu_(mu) {}
+    explicit MeasureInformation(absl::string_view name) : name_(name) {}
 
-    // Merges measure_data into all views under this measure. Requires holding
-    // *mu_;
+    // The measure's name, owned by the MeasureRegistry.
+    absl::string_view name() const { return name_; }
+
+    // Merges measure_data, from the delta numbered 'sequence', into all views
+    // under this measure that merge that delta. Requires holding *mu();
     void MergeMeasureData(const opencensus::tags::TagMap& tags,
-                          const MeasureData& data, absl::Time now);
+                          const MeasureData& data, uint64_t sequence,
+                          absl::Time now);
+
+    // Removes expired rows from all views under this measure. Requires holding
+    // *mu().
+    void ExpireRows(absl::Time now);
+
+    // Discards the data of all views under this measure. Requires holding
+    // *mu().
+    void ResetData(absl::Time now);
 
-    ViewInformation* AddConsumer(const ViewDescriptor& descriptor);
+    // Adds a consumer to a matching view, or else adds a view skipping deltas
+    // up to 'last_skipped_delta' and starting with 'restored_data' (if not
+    // null), disabled if 'disabled'.
+    ViewInformation* AddConsumer(const ViewDescriptor& descriptor,
+                                 uint64_t last_skipped_delta,
+                                 std::unique_ptr<ViewDataImpl> restored_data,
+                                 bool disabled);
     void RemoveView(const ViewInformation* handle);
 
+    // Disables the views whose names are in 'names' and enables the others.
+    // Requires holding *mu().
+    void SetDisabledViews(const absl::flat_hash_set<std::string>& names);
+
+    // Returns true if the measure has views and all are disabled. Requires
+    // holding *mu().
+    bool AllViewsDisabled() const;
+
+    absl::Mutex* mu() const { return &mu_; }
+
+    // Merges the data for this measure, the 'index'th in the registry, from
+    // 'deltas' and then expires rows. Acquires *mu(), releasing it between
+    // chunks of params.merge_chunk_size tag sets if that is non-zero.
+    void MergeDeltas(size_t index, absl::Span<const Delta* const> deltas,
+                     uint64_t sequence, absl::Time now,
+                     const HarvestParams& params) LOCKS_EXCLUDED(mu_);
+
+    // Appends the memory usage of each view under this measure to 'views'.
+    void AddMemoryUsage(std::vector<StatsMemoryUsage::View>* views) const
+        LOCKS_EXCLUDED(mu_);
+
    private:
-    absl::Mutex* const mu_;  // Not owned.
+    const absl::string_view name_;
+    mutable absl::Mutex mu_;
     // View objects hold a pointer to ViewInformation directly, so we do not
     // need fast lookup--lookup is only needed for view removal.
-    std::vector<std::unique_ptr<ViewInformation>> views_ GUARDED_BY(*mu_);
+    std::vector<std::unique_ptr<ViewInformation>> views_ GUARDED_BY(mu_);
   };
 
-  // TODO: PERF: Global synchronization is only needed for adding or
-  // removing measures--we can reduce recording contention by claiming a reader
-  // lock on mu_ and a writer lock on a measure-specific mutex.
+  // Guards the set of registered measures. Adding a measure requires a writer
+  // lock; all other operations take a reader lock on mu_ and a writer lock on
+  // the affected measure's mutex.
+  // mu_ is always acquired before any measure's mutex.
   mutable absl::Mutex mu_;
 
-  // All registered measures.
-  std::vector<MeasureInformation> measures_ GUARDED_BY(mu_);
+  // All registered measures. MeasureInformation is held by pointer because its
+  // mutex is not movable.
+  std::vector<std::unique_ptr<MeasureInformation>> measures_ GUARDED_BY(mu_);
+
+  // Tells the DeltaProducer whether to record the measure 'index', from its
+  // name and views.
+  void UpdateMeasureDisabled(uint64_t index)
+      EXCLUSIVE_LOCKS_REQUIRED(kill_switch_mu_) LOCKS_EXCLUDED(mu_);
+  // Tells the DeltaProducer the sampling rate of the measure 'index'.
+  void UpdateMeasureSampling(uint64_t index)
+      EXCLUSIVE_LOCKS_REQUIRED(kill_switch_mu_) LOCKS_EXCLUDED(mu_);
+
+  // Serializes changes to the disabled names and to views, so that each
+  // measure's state in the DeltaProducer follows the last change. Acquired
+  // before mu_.
+  absl::Mutex kill_switch_mu_ ACQUIRED_BEFORE(mu_);
+  absl::flat_hash_set<std::string> disabled_measures_
+      GUARDED_BY(kill_switch_mu_);
+  absl::flat_hash_set<std::string> disabled_views_ GUARDED_BY(kill_switch_mu_);
+  absl::flat_hash_map<std::string, uint32_t> measure_sampling_
+      GUARDED_BY(kill_switch_mu_);
 };
 
 extern template void StatsManager::AddMeasure(MeasureDouble measure);
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -23,8 +25,12 @@
 #include "opencensus/stats/internal/set_aggregation_window.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/stats/recording.h"
+#include "opencensus/stats/stats_config.h"
+#include "opencensus/stats/testing/test_utils.h"
 #include "opencensus/stats/view.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -180,6 +186,224 @@ void BM_RecordBatched(benchmark::State& state) {
 }
 BENCHMARK(BM_RecordBatched);
 
+// Benchmarks recording a batch of work items, each with its own tags, either
+// with one RecordBatch() call (state.range(0) == 1) or by looping over
+// Record().
+void BM_RecordBatch(benchmark::State& state) {
+  const bool use_record_batch = state.range(0);
+  const int batch_size = state.range(1);
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  const std::string measure_name = MakeUniqueName();
+  const MeasureDouble measure = MeasureDouble::Register(measure_name, "", "");
+  View view(ViewDescriptor()
+                .set_measure(measure_name)
+                .set_name(absl::StrCat("distribution_", measure_name))
+                .set_aggregation(Aggregation::Distribution(
+                    BucketBoundaries::Exponential(10, 10, 2)))
+                .add_column(tag_key_1));
+
+  std::vector<std::pair<opencensus::tags::TagMap, std::vector<Measurement>>>
+      batch;
+  batch.reserve(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    batch.emplace_back(
+        opencensus::tags::TagMap({{tag_key_1, absl::StrCat("value", i % 10)}}),
+        std::vector<Measurement>({{measure, static_cast<double>(i)}}));
+  }
+  for (auto _ : state) {
+    if (use_record_batch) {
+      RecordBatch(batch);
+    } else {
+      for (const auto& item : batch) {
+        Record(item.second, item.first);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_RecordBatch)->RangeMultiplier(10)->Ranges({{0, 1}, {10, 10000}});
+
+// Benchmarks backfilling a batch of timestamped work items into an interval
+// view with RecordBatchAt(), spread over state.range(0) seconds of the last
+// minute.
+void BM_RecordBatchAt(benchmark::State& state) {
+  const int num_seconds = state.range(0);
+  const int batch_size = 10000;
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  const std::string measure_name = MakeUniqueName();
+  const MeasureDouble measure = MeasureDouble::Register(measure_name, "", "");
+  ViewDescriptor descriptor =
+      ViewDescriptor()
+          .set_measure(measure_name)
+          .set_name(absl::StrCat("distribution_", measure_name))
+          .set_aggregation(Aggregation::Distribution(
+              BucketBoundaries::Exponential(10, 10, 2)))
+          .add_column(tag_key_1);
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(1)),
+                       &descriptor);
+  View view(descriptor);
+
+  const absl::Time now = absl::Now();
+  std::vector<TimedMeasurements> batch;
+  batch.reserve(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    batch.push_back(
+        {now - absl::Seconds(i % num_seconds),
+         opencensus::tags::TagMap({{tag_key_1, absl::StrCat("value", i % 10)}}),
+         {{measure, static_cast<double>(i)}}});
+  }
+  for (auto _ : state) {
+    RecordBatchAt(batch);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_RecordBatchAt)->Arg(1)->Arg(10)->Arg(60);
+
+// Benchmarks recording through pre-bound measures with a small number of tag
+// combinations, matching BM_RecordBatched's views.
+void BM_RecordBound(benchmark::State& state) {
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  const std::string measure_name = MakeUniqueName();
+  const MeasureDouble measure = MeasureDouble::Register(measure_name, "", "");
+  std::vector<std::unique_ptr<View>> views;
+  views.push_back(absl::make_unique<View>(
+      ViewDescriptor()
+          .set_measure(measure_name)
+          .set_name(absl::StrCat("count_", measure_name))
+          .set_aggregation(Aggregation::Count())
+          .add_column(tag_key_1)));
+  views.push_back(absl::make_unique<View>(
+      ViewDescriptor()
+          .set_measure(measure_name)
+          .set_name(absl::StrCat("distribution_", measure_name))
+          .set_aggregation(Aggregation::Distribution(
+              BucketBoundaries::Exponential(10, 10, 2)))
+          .add_column(tag_key_1)));
+
+  std::vector<std::unique_ptr<BoundMeasure<double>>> bound;
+  for (int i = 0; i < 10; ++i) {
+    bound.push_back(absl::make_unique<BoundMeasure<double>>(
+        measure, opencensus::tags::TagMap(
+                     {{tag_key_1, absl::StrCat("value", i)}})));
+  }
+  int iteration = 0;
+  for (auto _ : state) {
+    bound[iteration % bound.size()]->Record(static_cast<double>(iteration));
+    ++iteration;
+  }
+}
+BENCHMARK(BM_RecordBound);
+
+// Benchmarks recording under the current context's tags, which are looked up
+// in the delta without being copied.
+void BM_RecordWithContextTags(benchmark::State& state) {
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  const std::string measure_name = MakeUniqueName();
+  const MeasureDouble measure = MeasureDouble::Register(measure_name, "", "");
+  View view(ViewDescriptor()
+                .set_measure(measure_name)
+                .set_name(absl::StrCat("count_", measure_name))
+                .set_aggregation(Aggregation::Count())
+                .add_column(tag_key_1));
+  const opencensus::tags::WithTagMap with_tags(
+      opencensus::tags::TagMap({{tag_key_1, "value"}}));
+  int iteration = 0;
+  for (auto _ : state) {
+    Record({{measure, static_cast<double>(iteration)}});
+    ++iteration;
+  }
+}
+BENCHMARK(BM_RecordWithContextTags);
+
+// Adds to BoundCounters of an int64 measure with Count and Sum views, for
+// comparison with BM_RecordBound.
+void BM_RecordBoundCounter(benchmark::State& state) {
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  const std::string measure_name = MakeUniqueName();
+  const MeasureInt64 measure = MeasureInt64::Register(measure_name, "", "");
+  std::vector<std::unique_ptr<View>> views;
+  views.push_back(absl::make_unique<View>(
+      ViewDescriptor()
+          .set_measure(measure_name)
+          .set_name(absl::StrCat("count_", measure_name))
+          .set_aggregation(Aggregation::Count())
+          .add_column(tag_key_1)));
+  views.push_back(absl::make_unique<View>(
+      ViewDescriptor()
+          .set_measure(measure_name)
+          .set_name(absl::StrCat("sum_", measure_name))
+          .set_aggregation(Aggregation::Sum())
+          .add_column(tag_key_1)));
+
+  std::vector<std::unique_ptr<BoundCounter>> counters;
+  for (int i = 0; i < 10; ++i) {
+    counters.push_back(absl::make_unique<BoundCounter>(
+        measure, opencensus::tags::TagMap(
+                     {{tag_key_1, absl::StrCat("value", i)}})));
+  }
+  int iteration = 0;
+  for (auto _ : state) {
+    counters[iteration % counters.size()]->Add(iteration);
+    ++iteration;
+  }
+}
+BENCHMARK(BM_RecordBoundCounter)->ThreadRange(1, 16);
+
+// Benchmarks harvesting 1000 tag sets for each of 50 measures with 10 views
+// each, against HarvestParams::merge_threads. Only the harvest is timed.
+void BM_MergeThreads(benchmark::State& state) {
+  constexpr int kNumMeasures = 50;
+  constexpr int kViewsPerMeasure = 10;
+  constexpr int kNumTagSets = 1000;
+  const opencensus::tags::TagKey tag_key_1 =
+      opencensus::tags::TagKey::Register("tag_key_1");
+  std::vector<MeasureDouble> measures;
+  std::vector<std::unique_ptr<View>> views;
+  for (int i = 0; i < kNumMeasures; ++i) {
+    const std::string measure_name = MakeUniqueName();
+    measures.push_back(MeasureDouble::Register(measure_name, "", ""));
+    for (int j = 0; j < kViewsPerMeasure; ++j) {
+      views.push_back(absl::make_unique<View>(
+          ViewDescriptor()
+              .set_measure(measure_name)
+              .set_name(absl::StrCat("view_", measure_name, "_", j))
+              .set_aggregation(Aggregation::Distribution(
+                  BucketBoundaries::Exponential(10, 1, 2)))
+              .add_column(tag_key_1)
+              .add_column(opencensus::tags::TagKey::Register(
+                  absl::StrCat("view_key_", j)))));
+    }
+  }
+  std::vector<opencensus::tags::TagMap> tag_maps;
+  for (int i = 0; i < kNumTagSets; ++i) {
+    tag_maps.push_back(
+        opencensus::tags::TagMap({{tag_key_1, absl::StrCat("value", i)}}));
+  }
+  std::vector<Measurement> measurements;
+  for (const auto& measure : measures) {
+    measurements.push_back({measure, 1.0});
+  }
+  HarvestParams params;
+  params.interval = absl::Hours(1);
+  params.merge_threads = state.range(0);
+  StatsConfig::SetHarvestParams(params);
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (const auto& tags : tag_maps) {
+      Record(measurements, tags);
+    }
+    state.ResumeTiming();
+    testing::TestUtils::Flush();
+  }
+  StatsConfig::SetHarvestParams(HarvestParams());
+}
+BENCHMARK(BM_MergeThreads)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
 // TODO: Other useful benchmarks:
 //  - Multithreaded recording against one/different measures.
 //  - Recording with parameterized numbers of tag keys.
@@ -0,0 +1,257 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks Record() under contention: many threads recording against shared
+// views while a background thread harvests, as an exporter would. The pinned
+// variant spreads the threads evenly over the CPUs, so that on multi-socket
+// machines they record from every node.
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/bucket_boundaries.h"
+#include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/recording.h"
+#include "opencensus/stats/view.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+// The maximum number of tags per record.
+constexpr int kMaxTags = 4;
+// One in this many Record() calls is timed for the latency percentiles, so
+// that reading the clock does not dominate the measurement.
+constexpr int kLatencySampleInterval = 16;
+// The pause between harvests by the background thread.
+constexpr absl::Duration kHarvestInterval = absl::Milliseconds(10);
+
+// Generates unique measure names. Since the registry does not support
+// unregistering, all measure names must be different across test cases.
+std::string MakeUniqueName() {
+  static std::atomic<int> counter(0);
+  return absl::StrCat("contention_", counter++);
+}
+
+// The views and harvester shared by the threads of one benchmark run. Thread 0
+// creates it before the timed loop (which all threads start together), and the
+// last thread to finish destroys it.
+class Fixture {
+ public:
+  Fixture(int num_threads, int num_views, int num_buckets)
+      : tag_keys_(MakeTagKeys()),
+        measure_(MeasureDouble::Register(MakeUniqueName(), "", "")),
+        remaining_threads_(num_threads) {
+    for (int i = 0; i < num_views; ++i) {
+      // The view-specific column keeps the StatsManager from merging views.
+      ViewDescriptor descriptor =
+          ViewDescriptor()
+              .set_measure(measure_.GetDescriptor().name())
+              .set_name(absl::StrCat(measure_.GetDescriptor().name(), "_", i))
+              .set_aggregation(Aggregation::Distribution(
+                  BucketBoundaries::Exponential(num_buckets, 1, 1.5)))
+              .add_column(opencensus::tags::TagKey::Register(
+                  absl::StrCat("contention_view_key_", i)));
+      for (const auto& key : tag_keys_) {
+        descriptor.add_column(key);
+      }
+      views_.push_back(absl::make_unique<View>(descriptor));
+    }
+    harvester_ = std::thread([this] {
+      while (!stop_.load(std::memory_order_relaxed)) {
+        DeltaProducer::Get()->Flush();
+        for (const auto& view : views_) {
+          benchmark::DoNotOptimize(view->GetData());
+        }
+        absl::SleepFor(kHarvestInterval);
+      }
+    });
+  }
+
+  ~Fixture() {
+    stop_ = true;
+    harvester_.join();
+  }
+
+  // Returns true for the last thread to finish.
+  bool ThreadDone() { return --remaining_threads_ == 0; }
+
+  const std::vector<opencensus::tags::TagKey>& tag_keys() const {
+    return tag_keys_;
+  }
+  MeasureDouble measure() const { return measure_; }
+
+ private:
+  static std::vector<opencensus::tags::TagKey> MakeTagKeys() {
+    std::vector<opencensus::tags::TagKey> keys;
+    for (int i = 0; i < kMaxTags; ++i) {
+      keys.push_back(opencensus::tags::TagKey::Register(
+          absl::StrCat("contention_key_", i)));
+    }
+    return keys;
+  }
+
+  const std::vector<opencensus::tags::TagKey> tag_keys_;
+  const MeasureDouble measure_;
+  std::vector<std::unique_ptr<View>> views_;
+  std::atomic<int> remaining_threads_;
+  std::atomic<bool> stop_{false};
+  std::thread harvester_;
+};
+
+Fixture* fixture = nullptr;
+
+// Returns the 'p'th percentile of 'samples', reordering them.
+double Percentile(std::vector<int64_t>* samples, double p) {
+  if (samples->empty()) {
+    return 0;
+  }
+  const size_t rank = std::min(samples->size() - 1,
+                               static_cast<size_t>(p * samples->size()));
+  std::nth_element(samples->begin(), samples->begin() + rank, samples->end());
+  return (*samples)[rank];
+}
+
+// Pins the calling thread to a CPU for its lifetime, restoring its previous
+// affinity on destruction. Thread i of n gets CPU i * num_cpus / n, so that the
+// threads are spread over all nodes (which usually number their CPUs
+// contiguously). Does nothing outside Linux.
+class ScopedPin {
+ public:
+  ScopedPin(int thread_index, int num_threads) {
+#ifdef __linux__
+    const unsigned num_cpus =
+        std::max(1u, std::thread::hardware_concurrency());
+    pinned_ = pthread_getaffinity_np(pthread_self(), sizeof(previous_),
+                                     &previous_) == 0;
+    if (pinned_) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(static_cast<unsigned>(thread_index) * num_cpus / num_threads,
+              &cpus);
+      pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#endif
+  }
+  ~ScopedPin() {
+#ifdef __linux__
+    if (pinned_) {
+      pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+    }
+#endif
+  }
+
+ private:
+#ifdef __linux__
+  bool pinned_ = false;
+  cpu_set_t previous_;
+#endif
+};
+
+// Arguments are the number of tags per record (at most kMaxTags), the number
+// of distinct tag sets recorded, the number of views of the measure, and the
+// number of finite buckets of each view's distribution.
+void BM_RecordContention(benchmark::State& state) {
+  const int num_tags = state.range(0);
+  const int num_tag_sets = state.range(1);
+  if (state.thread_index() == 0) {
+    fixture = new Fixture(state.threads(), state.range(2), state.range(3));
+  }
+  // Each thread starts at a different tag set, so that threads with many
+  // distinct sets rarely record to the same row at once.
+  std::vector<std::vector<std::string>> tag_values(num_tag_sets);
+  for (int i = 0; i < num_tag_sets; ++i) {
+    for (int j = 0; j < num_tags; ++j) {
+      tag_values[i].push_back(absl::StrCat("value_", i, "_", j));
+    }
+  }
+  std::vector<int64_t> latencies_ns;
+  int iteration = state.thread_index() * 7919;
+  for (auto _ : state) {
+    const std::vector<std::string>& values =
+        tag_values[iteration % num_tag_sets];
+    std::vector<std::pair<opencensus::tags::TagKey, std::string>> tags;
+    tags.reserve(num_tags);
+    for (int j = 0; j < num_tags; ++j) {
+      tags.emplace_back(fixture->tag_keys()[j], values[j]);
+    }
+    if (iteration % kLatencySampleInterval == 0) {
+      const auto start = std::chrono::steady_clock::now();
+      Record({{fixture->measure(), static_cast<double>(iteration % 100)}},
+             opencensus::tags::TagMap(std::move(tags)));
+      latencies_ns.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+    } else {
+      Record({{fixture->measure(), static_cast<double>(iteration % 100)}},
+             opencensus::tags::TagMap(std::move(tags)));
+    }
+    ++iteration;
+  }
+  state.counters["records"] = benchmark::Counter(
+      state.iterations(), benchmark::Counter::kIsRate);
+  // Percentiles are per thread, averaged over threads.
+  state.counters["p50_ns"] = benchmark::Counter(
+      Percentile(&latencies_ns, 0.5), benchmark::Counter::kAvgThreads);
+  state.counters["p99_ns"] = benchmark::Counter(
+      Percentile(&latencies_ns, 0.99), benchmark::Counter::kAvgThreads);
+  if (fixture->ThreadDone()) {
+    delete fixture;
+    fixture = nullptr;
+  }
+}
+BENCHMARK(BM_RecordContention)
+    ->ArgNames({"tags", "tag_sets", "views", "buckets"})
+    ->ArgsProduct({{1, kMaxTags}, {1, 1000}, {1, 8}, {10, 100}})
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+void BM_RecordContentionPinned(benchmark::State& state) {
+  const ScopedPin pin(state.thread_index(), state.threads());
+  BM_RecordContention(state);
+}
+BENCHMARK(BM_RecordContentionPinned)
+    ->ArgNames({"tags", "tag_sets", "views", "buckets"})
+    ->ArgsProduct({{1, kMaxTags}, {1, 1000}, {1}, {10}})
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -12,9 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "opencensus/stats/internal/delta_producer.h"
+#include "opencensus/stats/internal/measure_data.h"
+#include "opencensus/stats/internal/measure_registry_impl.h"
+#include "opencensus/stats/internal/stats_manager.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/stats/recording.h"
 #include "opencensus/stats/testing/test_utils.h"
@@ -22,6 +39,9 @@
 #include "opencensus/tags/tag_key.h"
 #include "opencensus/tags/tag_map.h"
 #include "opencensus/tags/with_tag_map.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/with_span.h"
 
 namespace opencensus {
 namespace stats {
@@ -89,6 +109,31 @@ TEST_F(StatsManagerTest, Count) {
           ::testing::Pair(::testing::ElementsAre("value1", "value2"), 1.0)));
 }
 
+TEST_F(StatsManagerTest, ColumnsInAnyOrder) {
+  // Columns are projected by key regardless of their order in the view, and
+  // may be repeated.
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("columns_in_any_order")
+                                       .set_aggregation(Aggregation::Count())
+                                       .add_column(key3_)
+                                       .add_column(key1_)
+                                       .add_column(key2_)
+                                       .add_column(key3_);
+  View view(view_descriptor);
+
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}, {key3_, "value3"}});
+  Record({{FirstMeasure(), 1.0}}, {{key2_, "value2"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value3", "value1",
+                                                         "", "value3"),
+                                  1),
+                  ::testing::Pair(::testing::ElementsAre("", "", "value2", ""),
+                                  1)));
+}
+
 TEST_F(StatsManagerTest, CountTagsFromContext) {
   ViewDescriptor view_descriptor = ViewDescriptor()
                                        .set_measure(kFirstMeasureId)
@@ -262,6 +307,148 @@ TEST_F(StatsManagerTest, Distribution) {
               ::testing::ElementsAre(1, 0));
 }
 
+TEST_F(StatsManagerTest, Exemplars) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kSecondMeasureId)
+          .set_name("exemplars")
+          .set_aggregation(
+              Aggregation::Distribution(BucketBoundaries::Explicit({10})));
+  View view(view_descriptor);
+
+  static ::opencensus::trace::AlwaysSampler always_sampler;
+  static ::opencensus::trace::NeverSampler never_sampler;
+  auto sampled_span = ::opencensus::trace::Span::StartSpan(
+      "Sampled", /*parent=*/nullptr, {&always_sampler});
+  auto unsampled_span = ::opencensus::trace::Span::StartSpan(
+      "Unsampled", /*parent=*/nullptr, {&never_sampler});
+  {
+    ::opencensus::trace::WithSpan ws(unsampled_span);
+    Record({{SecondMeasure(), 5}});
+  }
+  {
+    ::opencensus::trace::WithSpan ws(sampled_span);
+    Record({{SecondMeasure(), 15}});
+  }
+  sampled_span.End();
+  unsampled_span.End();
+  testing::TestUtils::Flush();
+
+  const ViewData data = view.GetData();
+  ASSERT_EQ(1, data.distribution_data().size());
+  const Distribution& distribution = data.distribution_data().begin()->second;
+  EXPECT_THAT(distribution.bucket_counts(), ::testing::ElementsAre(1, 1));
+  ASSERT_EQ(2, distribution.exemplars().size());
+  EXPECT_FALSE(distribution.exemplars()[0].span_context.IsValid());
+  EXPECT_EQ(15, distribution.exemplars()[1].value);
+  EXPECT_EQ(sampled_span.context(), distribution.exemplars()[1].span_context);
+}
+
+TEST_F(StatsManagerTest, ExponentialHistogram) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kSecondMeasureId)
+          .set_name("exponential_histogram")
+          .set_aggregation(Aggregation::ExponentialHistogram(4))
+          .add_column(key1_);
+  View view(view_descriptor);
+  ASSERT_EQ(ViewData::Type::kExponentialHistogram, view.GetData().type());
+  EXPECT_TRUE(view.GetData().exponential_histogram_data().empty());
+
+  Record({{SecondMeasure(), 1}, {SecondMeasure(), 2}, {SecondMeasure(), 3}});
+  testing::TestUtils::Flush();
+  Record({{SecondMeasure(), 4}, {SecondMeasure(), 0}});
+  testing::TestUtils::Flush();
+  const opencensus::stats::ViewData data = view.GetData();
+  ASSERT_EQ(1, data.exponential_histogram_data().size());
+  const ExponentialHistogram& histogram =
+      data.exponential_histogram_data().find({""})->second;
+  EXPECT_EQ(5, histogram.count());
+  EXPECT_DOUBLE_EQ(10, histogram.sum());
+  EXPECT_EQ(1, histogram.zero_count());
+  EXPECT_EQ(0, histogram.scale());
+  EXPECT_THAT(histogram.positive_buckets().counts,
+              ::testing::ElementsAre(1, 2, 1));
+}
+
+TEST_F(StatsManagerTest, Quantiles) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("quantiles")
+          .set_aggregation(Aggregation::Quantiles({0.5, 0.99}));
+  View view(view_descriptor);
+  ASSERT_EQ(ViewData::Type::kExponentialHistogram, view.GetData().type());
+
+  // Recorded across several deltas, which are merged into the view's sketch.
+  for (int i = 1; i <= 1000; ++i) {
+    Record({{FirstMeasure(), static_cast<double>(i)}});
+    if (i % 250 == 0) {
+      testing::TestUtils::Flush();
+    }
+  }
+  const opencensus::stats::ViewData data = view.GetData();
+  ASSERT_EQ(1, data.exponential_histogram_data().size());
+  const ExponentialHistogram& sketch =
+      data.exponential_histogram_data().begin()->second;
+  EXPECT_EQ(1000, sketch.count());
+  EXPECT_NEAR(500, sketch.Quantile(0.5), 500 * 0.02);
+  EXPECT_NEAR(990, sketch.Quantile(0.99), 990 * 0.02);
+}
+
+TEST_F(StatsManagerTest, DistinctCount) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("distinct_count")
+          .set_aggregation(Aggregation::DistinctCount(key2_))
+          .add_column(key1_);
+  View view(view_descriptor);
+  ASSERT_EQ(ViewData::Type::kInt64, view.GetData().type());
+
+  // key2 is not a column, but its values are still recorded to be counted.
+  // Recordings without it are not counted.
+  for (int i = 0; i < 10; ++i) {
+    Record({{FirstMeasure(), 1.0}},
+           {{key1_, "value1"}, {key2_, absl::StrCat("user", i % 5)}});
+    Record({{FirstMeasure(), 1.0}},
+           {{key1_, "value2"}, {key2_, absl::StrCat("user", i)}});
+    Record({{FirstMeasure(), 1.0}}, {{key1_, "value3"}});
+    if (i % 3 == 0) {
+      testing::TestUtils::Flush();
+    }
+  }
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 5),
+                  ::testing::Pair(::testing::ElementsAre("value2"), 10)));
+}
+
+TEST_F(StatsManagerTest, IntervalDistinctCountInvalid) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("distinct_count-interval")
+          .set_aggregation(Aggregation::DistinctCount(key2_));
+  SetAggregationWindow(AggregationWindow::Interval(absl::Hours(1)),
+                       &view_descriptor);
+  View view(view_descriptor);
+  EXPECT_FALSE(view.IsValid());
+}
+
+TEST_F(StatsManagerTest, IntervalExponentialHistogramInvalid) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kSecondMeasureId)
+          .set_name("exponential_histogram-interval")
+          .set_aggregation(Aggregation::ExponentialHistogram());
+  SetAggregationWindow(AggregationWindow::Interval(absl::Hours(1)),
+                       &view_descriptor);
+  View view(view_descriptor);
+  EXPECT_FALSE(view.IsValid());
+}
+
 TEST_F(StatsManagerTest, Delta) {
   ViewDescriptor view_descriptor = ViewDescriptor()
                                        .set_measure(kFirstMeasureId)
@@ -390,6 +577,115 @@ TEST_F(StatsManagerTest, IntervalDistribution) {
                                                ->second.bucket_counts());
 }
 
+TEST_F(StatsManagerTest, IntervalWindowsShareData) {
+  ViewDescriptor minute_descriptor = ViewDescriptor()
+                                         .set_measure(kFirstMeasureId)
+                                         .set_name("interval-minute")
+                                         .set_aggregation(Aggregation::Count())
+                                         .add_column(key1_);
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(1)),
+                       &minute_descriptor);
+  ViewDescriptor hour_descriptor = minute_descriptor;
+  hour_descriptor.set_name("interval-hour");
+  SetAggregationWindow(AggregationWindow::Interval(absl::Hours(1)),
+                       &hour_descriptor);
+  View minute_view(minute_descriptor);
+  View hour_view(hour_descriptor);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+  testing::TestUtils::Flush();
+
+  EXPECT_THAT(minute_view.GetData().double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 2.0)));
+  EXPECT_THAT(hour_view.GetData().double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 2.0)));
+
+  // Both views are backed by one store.
+  int num_stores = 0;
+  for (const auto& usage : StatsManager::Get()->GetViewMemoryUsage()) {
+    if (usage.name == "interval-minute" || usage.name == "interval-hour") {
+      ++num_stores;
+    }
+  }
+  EXPECT_EQ(1, num_stores);
+}
+
+TEST_F(StatsManagerTest, IntervalReadsShareSnapshot) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("interval-cached")
+                                       .set_aggregation(Aggregation::Count())
+                                       .add_column(key1_);
+  SetAggregationWindow(AggregationWindow::Interval(absl::Hours(1)),
+                       &view_descriptor);
+  View view(view_descriptor);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+  testing::TestUtils::Flush();
+
+  // Reads in quick succession get the same snapshot, as of the first.
+  const ViewData first = view.GetData();
+  const ViewData second = view.GetData();
+  EXPECT_EQ(first.end_time(), second.end_time());
+  EXPECT_THAT(second.double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 1.0)));
+
+  // Merging new data invalidates it.
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+  testing::TestUtils::Flush();
+  const ViewData third = view.GetData();
+  EXPECT_LT(first.end_time(), third.end_time());
+  EXPECT_THAT(third.double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 2.0)));
+}
+
+TEST_F(StatsManagerTest, RollupView) {
+  ViewDescriptor parent_descriptor = ViewDescriptor()
+                                         .set_measure(kFirstMeasureId)
+                                         .set_name("rollup-parent")
+                                         .set_aggregation(Aggregation::Sum())
+                                         .add_column(key1_)
+                                         .add_column(key2_);
+  ViewDescriptor rollup_descriptor = ViewDescriptor()
+                                         .set_measure(kFirstMeasureId)
+                                         .set_name("rollup")
+                                         .set_aggregation(Aggregation::Sum())
+                                         .add_column(key2_)
+                                         .set_rollup(true);
+  std::unique_ptr<View> parent(new View(parent_descriptor));
+  View rollup(rollup_descriptor);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "a"}, {key2_, "x"}});
+  Record({{FirstMeasure(), 2.0}}, {{key1_, "b"}, {key2_, "x"}});
+  Record({{FirstMeasure(), 4.0}}, {{key1_, "a"}, {key2_, "y"}});
+  testing::TestUtils::Flush();
+
+  EXPECT_THAT(rollup.GetData().double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("x"), 3.0),
+                  ::testing::Pair(::testing::ElementsAre("y"), 4.0)));
+  EXPECT_THAT(rollup.GetData({{key2_, "y"}}).double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("y"), 4.0)));
+  // The rollup stores no rows of its own.
+  for (const auto& usage : StatsManager::Get()->GetViewMemoryUsage()) {
+    if (usage.name == "rollup") {
+      EXPECT_EQ(0, usage.rows);
+    }
+  }
+
+  // The rollup keeps the parent's data after the parent view is removed.
+  parent.reset();
+  Record({{FirstMeasure(), 8.0}}, {{key1_, "b"}, {key2_, "y"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(rollup.GetData().double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("x"), 3.0),
+                  ::testing::Pair(::testing::ElementsAre("y"), 12.0)));
+}
+
 TEST_F(StatsManagerTest, IdenticalViews) {
   ViewDescriptor view_descriptor = ViewDescriptor()
                                        .set_measure(kFirstMeasureId)
@@ -434,6 +730,458 @@ TEST_F(StatsManagerTest, IdenticalViews) {
   EXPECT_TRUE(view.GetData().int_data().empty());
 }
 
+TEST_F(StatsManagerTest, DeltaSkipsMeasuresWithoutViews) {
+  const uint64_t first = MeasureRegistryImpl::MeasureToIndex(FirstMeasure());
+  const uint64_t second = MeasureRegistryImpl::MeasureToIndex(SecondMeasure());
+  auto config = std::make_shared<DeltaConfig>();
+  config->measures.resize(std::max(first, second) + 1);
+  config->measures[first].has_views = true;
+  config->columns = {key1_};
+  Delta delta;
+  Delta empty;
+  delta.SwapAndReset(config, &empty);
+  const opencensus::tags::TagMap tags({{key1_, "value1"}});
+
+  delta.Record({{SecondMeasure(), 1}}, tags);
+  EXPECT_TRUE(delta.delta().empty());
+  delta.Record({{FirstMeasure(), 1.0}, {SecondMeasure(), 1}}, tags);
+  ASSERT_EQ(1, delta.delta().size());
+  const std::vector<MeasureData>& row = delta.delta().begin()->second;
+  EXPECT_EQ(1, row[first].count());
+  EXPECT_EQ(0, row[second].count());
+}
+
+TEST_F(StatsManagerTest, DeltaDropsTagsNotUsedAsColumns) {
+  const uint64_t first = MeasureRegistryImpl::MeasureToIndex(FirstMeasure());
+  auto config = std::make_shared<DeltaConfig>();
+  config->measures.resize(first + 1);
+  config->measures[first].has_views = true;
+  config->columns = {key1_, key3_};
+  std::sort(config->columns.begin(), config->columns.end());
+  Delta delta;
+  Delta empty;
+  delta.SwapAndReset(config, &empty);
+
+  delta.Record({{FirstMeasure(), 1.0}},
+               {{key1_, "value1"}, {key2_, "request1"}, {key3_, "value3"}});
+  delta.Record({{FirstMeasure(), 1.0}},
+               {{key1_, "value1"}, {key2_, "request2"}, {key3_, "value3"}});
+  delta.Record({{FirstMeasure(), 1.0}}, {{key2_, "request3"}});
+  EXPECT_THAT(
+      delta.delta(),
+      ::testing::UnorderedElementsAre(
+          ::testing::Key(opencensus::tags::TagMap(
+              {{key1_, "value1"}, {key3_, "value3"}})),
+          ::testing::Key(opencensus::tags::TagMap({}))));
+}
+
+TEST_F(StatsManagerTest, ColumnsAddedAfterRecording) {
+  ViewDescriptor descriptor1 = ViewDescriptor()
+                                   .set_measure(kFirstMeasureId)
+                                   .set_name("columns_added_1")
+                                   .set_aggregation(Aggregation::Count())
+                                   .add_column(key1_);
+  View view1(descriptor1);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}, {key2_, "value2"}});
+  // Data recorded before a view using key2 was added is not merged into it,
+  // so the new view does not see it under an empty value.
+  ViewDescriptor descriptor2 = ViewDescriptor()
+                                   .set_measure(kFirstMeasureId)
+                                   .set_name("columns_added_2")
+                                   .set_aggregation(Aggregation::Count())
+                                   .add_column(key2_);
+  View view2(descriptor2);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}, {key2_, "value2"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view1.GetData().int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 2)));
+  EXPECT_THAT(view2.GetData().int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value2"), 1)));
+}
+
+TEST_F(StatsManagerTest, BoundariesAddedAfterRecording) {
+  ViewDescriptor descriptor1 =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("boundaries_added_1")
+          .set_aggregation(Aggregation::Distribution(
+              BucketBoundaries::Explicit({10})));
+  View view1(descriptor1);
+  Record({{FirstMeasure(), 1.0}});
+  // The new boundaries apply from the next delta; the delta recorded without
+  // them is merged only into view1.
+  ViewDescriptor descriptor2 =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("boundaries_added_2")
+          .set_aggregation(Aggregation::Distribution(
+              BucketBoundaries::Explicit({5})));
+  View view2(descriptor2);
+  Record({{FirstMeasure(), 7.0}});
+  testing::TestUtils::Flush();
+  ASSERT_EQ(1, view1.GetData().distribution_data().size());
+  EXPECT_THAT(
+      view1.GetData().distribution_data().begin()->second.bucket_counts(),
+      ::testing::ElementsAre(2, 0));
+  ASSERT_EQ(1, view2.GetData().distribution_data().size());
+  EXPECT_THAT(
+      view2.GetData().distribution_data().begin()->second.bucket_counts(),
+      ::testing::ElementsAre(0, 1));
+}
+
+TEST(ActiveMeasuresTest, SetAndContains) {
+  ActiveMeasures active;
+  EXPECT_FALSE(active.Contains(0));
+  active.Set(0, true);
+  active.Set(100000, true);
+  EXPECT_TRUE(active.Contains(0));
+  EXPECT_FALSE(active.Contains(1));
+  EXPECT_TRUE(active.Contains(100000));
+  EXPECT_FALSE(active.Contains(100001));
+  active.Set(0, false);
+  EXPECT_FALSE(active.Contains(0));
+  EXPECT_TRUE(active.Contains(100000));
+  // Beyond the bitmap's capacity, measures are assumed active.
+  EXPECT_TRUE(active.Contains(uint64_t{1} << 40));
+}
+
+TEST_F(StatsManagerTest, RowsReusedAcrossHarvests) {
+  ViewDescriptor view_descriptor =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("distribution")
+          .set_aggregation(
+              Aggregation::Distribution(BucketBoundaries::Explicit({10})))
+          .add_column(key1_);
+  View view(view_descriptor);
+
+  // Records the same tag sets over several harvests, so that rows kept from
+  // earlier harvests are reused.
+  for (int i = 0; i < 5; ++i) {
+    Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+    if (i < 2) {
+      Record({{FirstMeasure(), 20.0}}, {{key1_, "value2"}});
+    }
+    testing::TestUtils::Flush();
+  }
+  // Harvests with no data must not change the view.
+  testing::TestUtils::Flush();
+  testing::TestUtils::Flush();
+  const auto data = view.GetData().distribution_data();
+  ASSERT_EQ(2, data.size());
+  const Distribution& value1 = data.at({"value1"});
+  EXPECT_EQ(5, value1.count());
+  EXPECT_DOUBLE_EQ(1, value1.mean());
+  EXPECT_DOUBLE_EQ(1, value1.max());
+  EXPECT_THAT(value1.bucket_counts(), ::testing::ElementsAre(5, 0));
+  const Distribution& value2 = data.at({"value2"});
+  EXPECT_EQ(2, value2.count());
+  EXPECT_DOUBLE_EQ(20, value2.min());
+  EXPECT_THAT(value2.bucket_counts(), ::testing::ElementsAre(0, 2));
+}
+
+TEST_F(StatsManagerTest, SnapshotsUnchangedByLaterRecords) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("snapshot")
+                                       .set_aggregation(Aggregation::Sum())
+                                       .add_column(key1_);
+  View view(view_descriptor);
+  Record({{FirstMeasure(), 1.0}}, {{key1_, "value1"}});
+  testing::TestUtils::Flush();
+  const ViewData snapshot = view.GetData();
+  const ViewData copy = snapshot;
+  EXPECT_EQ(&snapshot.double_data(), &copy.double_data());
+
+  Record({{FirstMeasure(), 2.0}}, {{key1_, "value1"}});
+  Record({{FirstMeasure(), 3.0}}, {{key1_, "value2"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(snapshot.double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 1.0)));
+  EXPECT_THAT(view.GetData().double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("value1"), 3.0),
+                  ::testing::Pair(::testing::ElementsAre("value2"), 3.0)));
+}
+
+TEST_F(StatsManagerTest, BoundMeasure) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("sum")
+                                       .set_aggregation(Aggregation::Sum())
+                                       .add_column(key1_);
+  View view(view_descriptor);
+  const BoundMeasure<double> bound(FirstMeasure(), {{key1_, "value1"}});
+
+  bound.Record(1.0);
+  bound.Record(2.0);
+  Record({{FirstMeasure(), 4.0}}, {{key1_, "value1"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 7.0)));
+
+  // The cached row must be invalidated by the flush.
+  bound.Record(8.0);
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 15.0)));
+
+  // Adding a view changes the delta configuration while the binding is live.
+  ViewDescriptor distribution_descriptor =
+      ViewDescriptor()
+          .set_measure(kFirstMeasureId)
+          .set_name("distribution")
+          .set_aggregation(
+              Aggregation::Distribution(BucketBoundaries::Explicit({10})))
+          .add_column(key1_);
+  View distribution_view(distribution_descriptor);
+  bound.Record(16.0);
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 31.0)));
+  const auto distribution_data = distribution_view.GetData().distribution_data();
+  ASSERT_EQ(1, distribution_data.size());
+  EXPECT_EQ(1, distribution_data.begin()->second.count());
+  EXPECT_THAT(distribution_data.begin()->second.bucket_counts(),
+              ::testing::ElementsAre(0, 1));
+}
+
+TEST_F(StatsManagerTest, BoundCounter) {
+  ViewDescriptor count_descriptor = ViewDescriptor()
+                                        .set_measure(kSecondMeasureId)
+                                        .set_name("counter_count")
+                                        .set_aggregation(Aggregation::Count())
+                                        .add_column(key1_);
+  View count_view(count_descriptor);
+  ViewDescriptor sum_descriptor = ViewDescriptor()
+                                      .set_measure(kSecondMeasureId)
+                                      .set_name("counter_sum")
+                                      .set_aggregation(Aggregation::Sum())
+                                      .add_column(key1_);
+  View sum_view(sum_descriptor);
+  {
+    const BoundCounter counter(SecondMeasure(), {{key1_, "value1"}});
+    counter.Add(1);
+    counter.Add(2);
+    Record({{SecondMeasure(), 4}}, {{key1_, "value1"}});
+    testing::TestUtils::Flush();
+    EXPECT_THAT(count_view.GetData().int_data(),
+                ::testing::UnorderedElementsAre(::testing::Pair(
+                    ::testing::ElementsAre("value1"), 3)));
+    EXPECT_THAT(sum_view.GetData().int_data(),
+                ::testing::UnorderedElementsAre(::testing::Pair(
+                    ::testing::ElementsAre("value1"), 7)));
+
+    // Values added before destruction are still recorded.
+    counter.Add(8);
+  }
+  testing::TestUtils::Flush();
+  EXPECT_THAT(count_view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 4)));
+  EXPECT_THAT(sum_view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre("value1"), 15)));
+}
+
+TEST_F(StatsManagerTest, RecordBatch) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("sum")
+                                       .set_aggregation(Aggregation::Sum())
+                                       .add_column(key1_);
+  View view(view_descriptor);
+
+  std::vector<std::pair<opencensus::tags::TagMap, std::vector<Measurement>>>
+      batch;
+  batch.emplace_back(opencensus::tags::TagMap({{key1_, "value1"}}),
+                     std::vector<Measurement>(
+                         {{FirstMeasure(), 1.0}, {FirstMeasure(), 2.0}}));
+  batch.emplace_back(opencensus::tags::TagMap({{key1_, "value2"}}),
+                     std::vector<Measurement>({{FirstMeasure(), 4.0}}));
+  batch.emplace_back(
+      opencensus::tags::TagMap({{key1_, "value1"}}),
+      std::vector<Measurement>({{FirstMeasure(), 8.0}, {SecondMeasure(), 1}}));
+  RecordBatch(batch);
+  testing::TestUtils::Flush();
+  EXPECT_THAT(
+      view.GetData().double_data(),
+      ::testing::UnorderedElementsAre(
+          ::testing::Pair(::testing::ElementsAre("value1"), 11.0),
+          ::testing::Pair(::testing::ElementsAre("value2"), 4.0)));
+}
+
+TEST_F(StatsManagerTest, RecordBatchAt) {
+  ViewDescriptor sum_descriptor = ViewDescriptor()
+                                      .set_measure(kFirstMeasureId)
+                                      .set_name("sum")
+                                      .set_aggregation(Aggregation::Sum())
+                                      .add_column(key1_);
+  View sum(sum_descriptor);
+  ViewDescriptor interval_descriptor = sum_descriptor;
+  interval_descriptor.set_name("interval-sum");
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(1)),
+                       &interval_descriptor);
+  View interval(interval_descriptor);
+
+  const absl::Time now = absl::Now();
+  const opencensus::tags::TagMap tags({{key1_, "value1"}});
+  std::vector<TimedMeasurements> batch;
+  batch.push_back({now - absl::Seconds(10), tags, {{FirstMeasure(), 1.0}}});
+  batch.push_back({now, tags, {{FirstMeasure(), 2.0}, {SecondMeasure(), 1}}});
+  batch.push_back({now - absl::Hours(1), tags, {{FirstMeasure(), 4.0}}});
+  batch.push_back({now - absl::Seconds(10),
+                   opencensus::tags::TagMap({{key1_, "value2"}}),
+                   {{FirstMeasure(), 8.0}}});
+  RecordBatchAt(batch);
+  // The data is merged without waiting for a harvest.
+  EXPECT_THAT(
+      sum.GetData().double_data(),
+      ::testing::UnorderedElementsAre(
+          ::testing::Pair(::testing::ElementsAre("value1"), 7.0),
+          ::testing::Pair(::testing::ElementsAre("value2"), 8.0)));
+  // The interval view does not count data from before its window.
+  EXPECT_THAT(
+      interval.GetData().double_data(),
+      ::testing::UnorderedElementsAre(
+          ::testing::Pair(::testing::ElementsAre("value1"), 3.0),
+          ::testing::Pair(::testing::ElementsAre("value2"), 8.0)));
+}
+
+TEST_F(StatsManagerTest, RecordSpan) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("sum")
+                                       .set_aggregation(Aggregation::Sum())
+                                       .add_column(key1_);
+  View view(view_descriptor);
+
+  std::vector<Measurement> measurements;
+  for (int i = 1; i <= 3; ++i) {
+    measurements.push_back({FirstMeasure(), static_cast<double>(i)});
+  }
+  measurements.push_back({SecondMeasure(), 1});
+  Record(measurements, {{key1_, "value1"}});
+  {
+    opencensus::tags::WithTagMap wt({{key1_, "value2"}});
+    Record(absl::MakeConstSpan(measurements).subspan(2));
+  }
+  testing::TestUtils::Flush();
+  EXPECT_THAT(
+      view.GetData().double_data(),
+      ::testing::UnorderedElementsAre(
+          ::testing::Pair(::testing::ElementsAre("value1"), 6.0),
+          ::testing::Pair(::testing::ElementsAre("value2"), 3.0)));
+}
+
+TEST_F(StatsManagerTest, MultithreadedRecording) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("count")
+                                       .set_aggregation(Aggregation::Count())
+                                       .add_column(key1_);
+  View view(view_descriptor);
+
+  const int num_threads = 8;
+  const int records_per_thread = 1000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([this, i]() {
+      for (int j = 0; j < records_per_thread; ++j) {
+        Record({{FirstMeasure(), 1.0}}, {{key1_, i % 2 ? "odd" : "even"}});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("even"),
+                                  num_threads / 2 * records_per_thread),
+                  ::testing::Pair(::testing::ElementsAre("odd"),
+                                  num_threads / 2 * records_per_thread)));
+}
+
+TEST_F(StatsManagerTest, ConcurrentFlushAndViewRegistration) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("count")
+                                       .set_aggregation(Aggregation::Count());
+  View view(view_descriptor);
+
+  const int num_threads = 4;
+  const int records_per_thread = 200;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([i]() {
+      for (int j = 0; j < records_per_thread; ++j) {
+        Record({{FirstMeasure(), 1.0}});
+        if (j % 50 == 0) {
+          testing::TestUtils::Flush();
+          // Registering distribution views forces configuration changes while
+          // other threads are recording and flushing.
+          View distribution_view(
+              ViewDescriptor()
+                  .set_measure(kFirstMeasureId)
+                  .set_name("distribution")
+                  .set_aggregation(Aggregation::Distribution(
+                      BucketBoundaries::Explicit({1.0 * i, 1000.0 + j}))));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(
+                  ::testing::ElementsAre(), num_threads * records_per_thread)));
+}
+
+#if !defined(_WIN32)
+TEST_F(StatsManagerTest, ForkedChildStartsFresh) {
+  ViewDescriptor view_descriptor = ViewDescriptor()
+                                       .set_measure(kFirstMeasureId)
+                                       .set_name("forked_count")
+                                       .set_aggregation(Aggregation::Count());
+  View view(view_descriptor);
+  Record({{FirstMeasure(), 1.0}});
+  testing::TestUtils::Flush();
+  // Not yet harvested at the fork.
+  Record({{FirstMeasure(), 1.0}});
+
+  const pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    // Report failures in the child through its exit code.
+    if (!view.GetData().int_data().empty()) {
+      _exit(1);
+    }
+    Record({{FirstMeasure(), 1.0}});
+    testing::TestUtils::Flush();
+    const auto& data = view.GetData().int_data();
+    _exit(data.size() == 1 && data.begin()->second == 1 ? 0 : 2);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().int_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre(), 2)));
+}
+#endif
+
 TEST(StatsManagerDeathTest, UnregisteredMeasure) {
   const std::string measure_name = "new_measure_name";
   ViewDescriptor view_descriptor = ViewDescriptor()
@@ -0,0 +1,201 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/stats_persistence.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/stats/internal/view_snapshot.h"
+#include "opencensus/stats/stats_exporter.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+// Saves a snapshot of the registered views on every export.
+class PersistenceHandler final : public StatsExporter::Handler {
+ public:
+  PersistenceHandler(absl::string_view path, absl::Duration interval)
+      : path_(path), interval_(interval) {}
+
+  // Handlers are not called concurrently with themselves, so buffer_ needs no
+  // lock.
+  void ExportViewData(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& data) override {
+    ViewSnapshot::Encode(data, &buffer_);
+    StatsPersistence::WriteSnapshot(path_, buffer_);
+  }
+
+  absl::Duration ExportInterval() const override { return interval_; }
+
+ private:
+  const std::string path_;
+  const absl::Duration interval_;
+  std::string buffer_;
+};
+
+// Flushes the directory containing 'path' to disk, so that a rename into it
+// survives a host crash.
+bool SyncParentDirectory(const std::string& path) {
+  const size_t slash = path.rfind('/');
+  std::string dir = ".";
+  if (slash == 0) {
+    dir = "/";
+  } else if (slash != std::string::npos) {
+    dir = path.substr(0, slash);
+  }
+  const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+// static
+StatsPersistence* StatsPersistence::Get() {
+  static StatsPersistence* global_stats_persistence = new StatsPersistence;
+  return global_stats_persistence;
+}
+
+bool StatsPersistence::Enable(absl::string_view path,
+                              absl::Duration interval) {
+  {
+    absl::MutexLock l(&mu_);
+    if (enabled_) {
+      std::cerr << "StatsConfig::EnablePersistence() called more than once.\n";
+      return false;
+    }
+    enabled_ = true;
+    if (!ReadSnapshot(std::string(path), &restored_)) {
+      return false;
+    }
+  }
+  // Registered outside the lock, since exports may create views.
+  StatsExporter::RegisterPushHandler(
+      absl::make_unique<PersistenceHandler>(path, interval));
+  return true;
+}
+
+std::unique_ptr<ViewDataImpl> StatsPersistence::Restore(
+    const ViewDescriptor& descriptor) {
+  absl::MutexLock l(&mu_);
+  if (restored_.empty()) {
+    return nullptr;
+  }
+  return restored_.Take(descriptor, absl::Now());
+}
+
+// static
+bool StatsPersistence::ReadSnapshot(const std::string& path,
+                                    ViewSnapshot* snapshot) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    std::cerr << "Failed to open stats snapshot \"" << path
+              << "\": " << strerror(errno) << "\n";
+    return false;
+  }
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok && st.st_size > 0) {
+    void* mapping =
+        mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = mapping != MAP_FAILED;
+    if (ok) {
+      if (!snapshot->Parse(absl::string_view(static_cast<char*>(mapping),
+                                             st.st_size))) {
+        std::cerr << "Ignoring malformed stats snapshot \"" << path
+                  << "\".\n";
+      }
+      munmap(mapping, st.st_size);
+    }
+  }
+  if (!ok) {
+    std::cerr << "Failed to read stats snapshot \"" << path
+              << "\": " << strerror(errno) << "\n";
+  }
+  close(fd);
+  return ok;
+}
+
+// static
+bool StatsPersistence::WriteSnapshot(const std::string& path,
+                                     absl::string_view snapshot) {
+  // The pid keeps processes sharing 'path' from writing the same temporary
+  // file.
+  const std::string temp_path = absl::StrCat(path, ".", getpid(), ".tmp");
+  const int fd =
+      open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  bool ok = fd >= 0 && ftruncate(fd, snapshot.size()) == 0;
+  if (ok) {
+    void* mapping = mmap(nullptr, snapshot.size(), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+    ok = mapping != MAP_FAILED;
+    if (ok) {
+      memcpy(mapping, snapshot.data(), snapshot.size());
+      ok = msync(mapping, snapshot.size(), MS_SYNC) == 0;
+      munmap(mapping, snapshot.size());
+    }
+  }
+  // The data must be on disk before the rename is, or a host crash could
+  // replace the old snapshot with a truncated one.
+  ok = ok && fsync(fd) == 0;
+  if (fd >= 0) {
+    close(fd);
+  }
+  ok = ok && rename(temp_path.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    std::cerr << "Failed to write stats snapshot \"" << path
+              << "\": " << strerror(errno) << "\n";
+    unlink(temp_path.c_str());
+    return false;
+  }
+  if (!SyncParentDirectory(path)) {
+    std::cerr << "Failed to sync stats snapshot \"" << path
+              << "\": " << strerror(errno) << "\n";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,71 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_STATS_PERSISTENCE_H_
+#define OPENCENSUS_STATS_INTERNAL_STATS_PERSISTENCE_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/stats/internal/view_snapshot.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+// StatsPersistence implements StatsConfig::EnablePersistence(): it holds the
+// views restored from the snapshot file until StatsManager creates them, and
+// registers a push handler that saves snapshots of the views registered for
+// export.
+//
+// StatsPersistence is thread-safe.
+class StatsPersistence final {
+ public:
+  static StatsPersistence* Get();
+
+  // See StatsConfig::EnablePersistence().
+  bool Enable(absl::string_view path, absl::Duration interval)
+      LOCKS_EXCLUDED(mu_);
+
+  // Returns the restored data for a new view with 'descriptor' (see
+  // ViewSnapshot::Take()), or nullptr.
+  std::unique_ptr<ViewDataImpl> Restore(const ViewDescriptor& descriptor)
+      LOCKS_EXCLUDED(mu_);
+
+  // Reads the snapshot in the file at 'path' into *snapshot. Returns true if
+  // the file was read, or does not exist.
+  static bool ReadSnapshot(const std::string& path, ViewSnapshot* snapshot);
+  // Replaces the file at 'path' with 'snapshot', writing and syncing it to a
+  // temporary file first so that a crash, even of the host, cannot leave a
+  // partial snapshot. Returns false on failure.
+  static bool WriteSnapshot(const std::string& path,
+                            absl::string_view snapshot);
+
+ private:
+  StatsPersistence() = default;
+
+  absl::Mutex mu_;
+  bool enabled_ GUARDED_BY(mu_) = false;
+  ViewSnapshot restored_ GUARDED_BY(mu_);
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_STATS_PERSISTENCE_H_
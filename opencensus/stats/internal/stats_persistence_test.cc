@@ -0,0 +1,87 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/stats_persistence.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/internal/view_snapshot.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(StatsPersistenceTest, RestoresAndSavesViews) {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  const std::string path = absl::StrCat(
+      dir == nullptr ? "/tmp" : dir, "/oc_stats_persistence_test_", getpid());
+  const MeasureDouble measure =
+      MeasureDouble::Register("test/persisted", "", "");
+  const opencensus::tags::TagKey key =
+      opencensus::tags::TagKey::Register("key");
+  const ViewDescriptor descriptor = ViewDescriptor()
+                                        .set_name("test/persisted_sum")
+                                        .set_measure("test/persisted")
+                                        .set_aggregation(Aggregation::Sum())
+                                        .add_column(key);
+
+  // Save a snapshot as an earlier process would have.
+  std::string encoded;
+  ViewSnapshot::Encode(
+      {{descriptor,
+        testing::TestUtils::MakeViewData(descriptor, {{{"a"}, 5}})}},
+      &encoded);
+  ASSERT_TRUE(StatsPersistence::WriteSnapshot(path, encoded));
+
+  ASSERT_TRUE(StatsConfig::EnablePersistence(path));
+  EXPECT_FALSE(StatsConfig::EnablePersistence(path));
+  descriptor.RegisterForExport();
+  View view(descriptor);
+  EXPECT_EQ(absl::UnixEpoch(), view.GetData().start_time());
+  Record({{measure, 2.0}}, {{key, "a"}});
+  Record({{measure, 3.0}}, {{key, "b"}});
+  testing::TestUtils::Flush();
+  EXPECT_THAT(view.GetData().double_data(),
+              UnorderedElementsAre(Pair(std::vector<std::string>{"a"}, 7),
+                                   Pair(std::vector<std::string>{"b"}, 3)));
+
+  // Shutting down saves the views registered for export.
+  ASSERT_TRUE(StatsExporter::Shutdown(absl::Now() + absl::Seconds(10)));
+  ViewSnapshot saved;
+  ASSERT_TRUE(StatsPersistence::ReadSnapshot(path, &saved));
+  const auto data = saved.Take(descriptor, absl::Now());
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(absl::UnixEpoch(), data->start_time());
+  EXPECT_THAT(data->double_data(),
+              UnorderedElementsAre(Pair(std::vector<std::string>{"a"}, 7),
+                                   Pair(std::vector<std::string>{"b"}, 3)));
+  unlink(path.c_str());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
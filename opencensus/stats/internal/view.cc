@@ -22,6 +22,7 @@
 #include "absl/time/time.h"
 #include "opencensus/stats/distribution.h"
 #include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -44,7 +45,18 @@ const ViewData View::GetData() {
     ABSL_ASSERT(0);
     return ViewData(absl::make_unique<ViewDataImpl>(absl::Now(), descriptor_));
   }
-  return ViewData(handle_->GetData());
+  return ViewData(handle_->GetData(descriptor_));
+}
+
+const ViewData View::GetData(const opencensus::tags::TagMap& filter) {
+  if (!IsValid()) {
+    std::cerr << "View::GetData() called on invalid view.\n";
+    ABSL_ASSERT(0);
+    return ViewData(absl::make_unique<ViewDataImpl>(absl::Now(), descriptor_));
+  }
+  return ViewData(
+      handle_->GetData(descriptor_,
+                       ViewDataImpl::MakeRowFilter(descriptor_, filter)));
 }
 
 }  // namespace stats
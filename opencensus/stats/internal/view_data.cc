@@ -35,7 +35,9 @@ ViewData::Type ViewData::type() const {
       return Type::kInt64;
     case ViewDataImpl::Type::kDistribution:
       return Type::kDistribution;
-    case ViewDataImpl::Type::kStatsObject:
+    case ViewDataImpl::Type::kExponentialHistogram:
+      return Type::kExponentialHistogram;
+    case ViewDataImpl::Type::kInterval:
       // This DCHECKs in the constructor. Returning kDouble here is
       // safe, albeit incorrect--the double_data() accessor will return an empty
       // map.
@@ -79,15 +81,33 @@ const ViewData::DataMap<Distribution>& ViewData::distribution_data() const {
   }
 }
 
+const ViewData::DataMap<ExponentialHistogram>&
+ViewData::exponential_histogram_data() const {
+  if (impl_->type() == ViewDataImpl::Type::kExponentialHistogram) {
+    return impl_->exponential_histogram_data();
+  } else {
+    std::cerr << "Accessing exponential_histogram_data from a "
+                 "non-exponential-histogram ViewData.\n";
+    ABSL_ASSERT(0);
+    static DataMap<ExponentialHistogram> empty_map;
+    return empty_map;
+  }
+}
+
 absl::Time ViewData::start_time() const { return impl_->start_time(); }
 absl::Time ViewData::end_time() const { return impl_->end_time(); }
 
-ViewData::ViewData(const ViewData& other)
-    : impl_(absl::make_unique<ViewDataImpl>(*other.impl_)) {}
+int64_t ViewData::dropped_rows() const { return impl_->dropped_rows(); }
+
+int64_t ViewData::expired_rows() const { return impl_->expired_rows(); }
+
+uint32_t ViewData::sample_one_in() const { return impl_->sample_one_in(); }
+
+ViewData::ViewData(const ViewData& other) : impl_(other.impl_) {}
 
-ViewData::ViewData(std::unique_ptr<ViewDataImpl> data)
+ViewData::ViewData(std::shared_ptr<const ViewDataImpl> data)
     : impl_(std::move(data)) {
-  ABSL_ASSERT(impl_->type() != ViewDataImpl::Type::kStatsObject);
+  ABSL_ASSERT(impl_->type() != ViewDataImpl::Type::kInterval);
 }
 
 }  // namespace stats
@@ -0,0 +1,653 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/view_data_codec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+constexpr char kMagic[] = "ocvd";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+
+// Frame flags.
+constexpr uint8_t kDeltaFlag = 1;
+// Row kinds.
+constexpr uint8_t kValueRow = 0;
+constexpr uint8_t kRemovedRow = 1;
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void PutDouble(double value, std::string* out) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  char bytes[sizeof(bits)];
+  for (size_t i = 0; i < sizeof(bits); ++i) {
+    bytes[i] = static_cast<char>(bits >> (8 * i));
+  }
+  out->append(bytes, sizeof(bytes));
+}
+
+void PutString(absl::string_view value, std::string* out) {
+  PutVarint(value.size(), out);
+  out->append(value.data(), value.size());
+}
+
+// Reads values written by Put*() from the front of 'in', failing (and reading
+// zeros) once the input runs out or is malformed.
+class Reader {
+ public:
+  explicit Reader(absl::string_view in) : in_(in) {}
+
+  bool ok() const { return ok_; }
+  absl::string_view remaining() const { return in_; }
+
+  uint8_t GetByte() {
+    if (in_.empty()) return Fail();
+    const uint8_t value = static_cast<uint8_t>(in_[0]);
+    in_.remove_prefix(1);
+    return value;
+  }
+
+  uint64_t GetVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (in_.empty()) return Fail();
+      const uint8_t byte = static_cast<uint8_t>(in_[0]);
+      in_.remove_prefix(1);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    return Fail();
+  }
+
+  int64_t GetZigZag() { return UnZigZag(GetVarint()); }
+
+  // Marks the input as malformed.
+  uint64_t Fail() {
+    ok_ = false;
+    in_ = absl::string_view();
+    return 0;
+  }
+
+  double GetDouble() {
+    if (in_.size() < sizeof(uint64_t)) return Fail();
+    uint64_t bits = 0;
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      bits |= static_cast<uint64_t>(static_cast<uint8_t>(in_[i])) << (8 * i);
+    }
+    in_.remove_prefix(sizeof(bits));
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  absl::string_view GetBytes(uint64_t size) {
+    if (in_.size() < size) {
+      Fail();
+      return absl::string_view();
+    }
+    const absl::string_view value = in_.substr(0, size);
+    in_.remove_prefix(size);
+    return value;
+  }
+
+  absl::string_view GetString() { return GetBytes(GetVarint()); }
+
+  // Reads a count of elements that each take at least one byte, failing if
+  // there are fewer bytes left, so that a malformed count cannot make the
+  // caller allocate more than the input's size.
+  uint64_t GetCount() {
+    const uint64_t count = GetVarint();
+    if (count > in_.size()) return Fail();
+    return count;
+  }
+
+ private:
+  absl::string_view in_;
+  bool ok_ = true;
+};
+
+bool RowDataEqual(double a, double b) { return a == b; }
+
+bool RowDataEqual(int64_t a, int64_t b) { return a == b; }
+
+bool RowDataEqual(const Distribution& a, const Distribution& b) {
+  return a.count() == b.count() && a.mean() == b.mean() &&
+         a.sum_of_squared_deviation() == b.sum_of_squared_deviation() &&
+         a.min() == b.min() && a.max() == b.max() &&
+         a.bucket_counts() == b.bucket_counts();
+}
+
+bool RowDataEqual(const ExponentialHistogram& a,
+                  const ExponentialHistogram& b) {
+  return a.count() == b.count() && a.sum() == b.sum() &&
+         a.min() == b.min() && a.max() == b.max() &&
+         a.scale() == b.scale() && a.zero_count() == b.zero_count() &&
+         a.positive_buckets().offset == b.positive_buckets().offset &&
+         a.positive_buckets().counts == b.positive_buckets().counts &&
+         a.negative_buckets().offset == b.negative_buckets().offset &&
+         a.negative_buckets().counts == b.negative_buckets().counts;
+}
+
+// Append the value of a row. Where 'previous' is not null, integers and counts
+// are written as their change from it; doubles and ExponentialHistograms are
+// always written whole.
+void PutValue(double value, const double* /*previous*/, std::string* out) {
+  PutDouble(value, out);
+}
+
+void PutValue(int64_t value, const int64_t* previous, std::string* out) {
+  PutVarint(ZigZag(value - (previous == nullptr ? 0 : *previous)), out);
+}
+
+void PutValue(const Distribution& value, const Distribution* previous,
+              std::string* out) {
+  const std::vector<uint64_t>& counts = value.bucket_counts();
+  if (previous != nullptr &&
+      previous->bucket_counts().size() != counts.size()) {
+    previous = nullptr;
+  }
+  PutVarint(
+      ZigZag(static_cast<int64_t>(
+          value.count() - (previous == nullptr ? 0 : previous->count()))),
+      out);
+  PutDouble(value.mean(), out);
+  PutDouble(value.sum_of_squared_deviation(), out);
+  PutDouble(value.min(), out);
+  PutDouble(value.max(), out);
+  uint64_t num_changed = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (counts[i] != (previous == nullptr ? 0 : previous->bucket_counts()[i])) {
+      ++num_changed;
+    }
+  }
+  PutVarint(num_changed, out);
+  // Each bucket's index is written as its distance from the one before.
+  size_t next = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    const uint64_t before =
+        previous == nullptr ? 0 : previous->bucket_counts()[i];
+    if (counts[i] != before) {
+      PutVarint(i - next, out);
+      PutVarint(ZigZag(static_cast<int64_t>(counts[i] - before)), out);
+      next = i + 1;
+    }
+  }
+}
+
+void PutBuckets(const ExponentialHistogram::Buckets& buckets,
+                std::string* out) {
+  PutVarint(ZigZag(buckets.offset), out);
+  PutVarint(buckets.counts.size(), out);
+  for (uint64_t count : buckets.counts) {
+    PutVarint(count, out);
+  }
+}
+
+void PutValue(const ExponentialHistogram& value,
+              const ExponentialHistogram* /*previous*/, std::string* out) {
+  PutVarint(value.count(), out);
+  PutDouble(value.sum(), out);
+  PutDouble(value.min(), out);
+  PutDouble(value.max(), out);
+  PutVarint(ZigZag(value.scale()), out);
+  PutVarint(value.zero_count(), out);
+  PutBuckets(value.positive_buckets(), out);
+  PutBuckets(value.negative_buckets(), out);
+}
+
+// Reads buckets written by PutBuckets(), failing if there are more than
+// 'max_buckets'.
+void GetBuckets(uint32_t max_buckets, Reader* reader, int* offset,
+                std::vector<uint64_t>* counts) {
+  *offset = static_cast<int>(reader->GetZigZag());
+  const uint64_t size = reader->GetCount();
+  if (size > max_buckets) {
+    reader->Fail();
+    return;
+  }
+  counts->resize(size);
+  for (uint64_t& count : *counts) {
+    count = reader->GetVarint();
+  }
+}
+
+uint32_t NumBuckets(const Aggregation& aggregation) {
+  switch (aggregation.type()) {
+    case Aggregation::Type::kDistribution:
+      return aggregation.bucket_boundaries().num_buckets();
+    case Aggregation::Type::kExponentialHistogram:
+    case Aggregation::Type::kQuantiles:
+      return aggregation.max_buckets();
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+ViewDataEncoder::ViewDataEncoder(const ViewDescriptor& descriptor)
+    : name_(descriptor.name()), num_columns_(descriptor.num_columns()) {}
+
+void ViewDataEncoder::Encode(const ViewData& data, std::string* out) {
+  EncodeFrame(data, true, out);
+}
+
+void ViewDataEncoder::EncodeFull(const ViewData& data, std::string* out) {
+  EncodeFrame(data, false, out);
+}
+
+void ViewDataEncoder::EncodeFrame(const ViewData& data, bool delta,
+                                  std::string* out) {
+  const ViewData* previous =
+      delta && previous_ != nullptr && previous_->type() == data.type()
+          ? previous_.get()
+          : nullptr;
+  codes_.resize(num_columns_);
+  dictionaries_.resize(num_columns_);
+  for (size_t column = 0; column < num_columns_; ++column) {
+    codes_[column].clear();
+    dictionaries_[column].clear();
+  }
+  rows_.clear();
+  uint64_t num_rows = 0;
+  switch (data.type()) {
+    case ViewData::Type::kDouble:
+      num_rows = AppendRows(data.double_data(), previous == nullptr
+                                                    ? nullptr
+                                                    : &previous->double_data());
+      break;
+    case ViewData::Type::kInt64:
+      num_rows = AppendRows(data.int_data(), previous == nullptr
+                                                 ? nullptr
+                                                 : &previous->int_data());
+      break;
+    case ViewData::Type::kDistribution:
+      num_rows = AppendRows(data.distribution_data(),
+                            previous == nullptr
+                                ? nullptr
+                                : &previous->distribution_data());
+      break;
+    case ViewData::Type::kExponentialHistogram:
+      num_rows = AppendRows(data.exponential_histogram_data(),
+                            previous == nullptr
+                                ? nullptr
+                                : &previous->exponential_histogram_data());
+      break;
+  }
+
+  header_.clear();
+  header_.push_back(static_cast<char>(previous == nullptr ? 0 : kDeltaFlag));
+  header_.push_back(static_cast<char>(data.type()));
+  PutVarint(sequence_, &header_);
+  PutString(name_, &header_);
+  PutVarint(ZigZag(absl::ToUnixNanos(data.start_time())), &header_);
+  PutVarint(ZigZag(absl::ToInt64Nanoseconds(data.end_time() -
+                                            data.start_time())),
+            &header_);
+  PutVarint(ZigZag(data.dropped_rows()), &header_);
+  PutVarint(ZigZag(data.expired_rows()), &header_);
+  PutVarint(NumBuckets(data.aggregation()), &header_);
+  PutVarint(num_columns_, &header_);
+  for (const auto& dictionary : dictionaries_) {
+    PutVarint(dictionary.size(), &header_);
+    for (absl::string_view tag_value : dictionary) {
+      PutString(tag_value, &header_);
+    }
+  }
+  PutVarint(num_rows, &header_);
+
+  out->append(kMagic, kMagicSize);
+  PutVarint(header_.size() + rows_.size(), out);
+  out->append(header_);
+  out->append(rows_);
+  ++sequence_;
+  previous_.reset(new ViewData(data));
+}
+
+template <typename DataValueT>
+uint64_t ViewDataEncoder::AppendRows(
+    const ViewData::DataMap<DataValueT>& rows,
+    const ViewData::DataMap<DataValueT>* previous) {
+  uint64_t num_rows = 0;
+  for (const auto& row : rows) {
+    const DataValueT* before = nullptr;
+    if (previous != nullptr) {
+      const auto it = previous->find(row.first);
+      if (it != previous->end()) {
+        if (RowDataEqual(row.second, it->second)) continue;
+        before = &it->second;
+      }
+    }
+    rows_.push_back(static_cast<char>(kValueRow));
+    AppendCodes(row.first);
+    PutValue(row.second, before, &rows_);
+    ++num_rows;
+  }
+  if (previous != nullptr) {
+    for (const auto& row : *previous) {
+      if (rows.find(row.first) == rows.end()) {
+        rows_.push_back(static_cast<char>(kRemovedRow));
+        AppendCodes(row.first);
+        ++num_rows;
+      }
+    }
+  }
+  return num_rows;
+}
+
+void ViewDataEncoder::AppendCodes(const std::vector<std::string>& tag_values) {
+  for (size_t column = 0; column < num_columns_; ++column) {
+    const absl::string_view tag_value =
+        column < tag_values.size() ? tag_values[column] : absl::string_view();
+    const auto it = codes_[column].emplace(tag_value,
+                                           dictionaries_[column].size());
+    if (it.second) {
+      dictionaries_[column].push_back(tag_value);
+    }
+    PutVarint(it.first->second, &rows_);
+  }
+}
+
+bool ViewDataFrame::Parse(absl::string_view* buffer) {
+  if (buffer->substr(0, kMagicSize) != absl::string_view(kMagic, kMagicSize)) {
+    return false;
+  }
+  Reader frame_reader(buffer->substr(kMagicSize));
+  const absl::string_view frame =
+      frame_reader.GetBytes(frame_reader.GetVarint());
+  if (!frame_reader.ok()) {
+    return false;
+  }
+
+  Reader reader(frame);
+  const uint8_t flags = reader.GetByte();
+  const uint8_t type = reader.GetByte();
+  delta_ = (flags & kDeltaFlag) != 0;
+  type_ = static_cast<ViewData::Type>(type);
+  sequence_ = reader.GetVarint();
+  view_name_ = reader.GetString();
+  start_time_ = absl::FromUnixNanos(reader.GetZigZag());
+  end_time_ = start_time_ + absl::Nanoseconds(reader.GetZigZag());
+  dropped_rows_ = reader.GetZigZag();
+  expired_rows_ = reader.GetZigZag();
+  num_buckets_ = static_cast<uint32_t>(reader.GetVarint());
+  dictionaries_.resize(reader.GetCount());
+  for (auto& dictionary : dictionaries_) {
+    dictionary.resize(reader.GetCount());
+    for (absl::string_view& tag_value : dictionary) {
+      tag_value = reader.GetString();
+    }
+  }
+  num_rows_ = reader.GetCount();
+  if (!reader.ok() ||
+      type > static_cast<uint8_t>(ViewData::Type::kExponentialHistogram)) {
+    return false;
+  }
+  rows_ = reader.remaining();
+  rows_read_ = 0;
+  ok_ = true;
+  *buffer = frame_reader.remaining();
+  return true;
+}
+
+bool ViewDataFrame::NextRow(Row* row) {
+  if (!ok_ || rows_read_ == num_rows_) {
+    return false;
+  }
+  Reader reader(rows_);
+  const uint8_t kind = reader.GetByte();
+  row->removed = kind == kRemovedRow;
+  row->codes.resize(dictionaries_.size());
+  for (size_t column = 0; column < dictionaries_.size(); ++column) {
+    const uint64_t code = reader.GetVarint();
+    if (code >= dictionaries_[column].size()) {
+      ok_ = false;
+      return false;
+    }
+    row->codes[column] = static_cast<uint32_t>(code);
+  }
+  if (kind == kValueRow) {
+    switch (type_) {
+      case ViewData::Type::kDouble:
+        row->double_value = reader.GetDouble();
+        break;
+      case ViewData::Type::kInt64:
+        row->int_value = reader.GetZigZag();
+        break;
+      case ViewData::Type::kDistribution: {
+        row->count = reader.GetZigZag();
+        row->mean = reader.GetDouble();
+        row->sum_of_squared_deviation = reader.GetDouble();
+        row->min = reader.GetDouble();
+        row->max = reader.GetDouble();
+        row->buckets.resize(reader.GetCount());
+        uint64_t next = 0;
+        for (auto& bucket : row->buckets) {
+          next += reader.GetVarint();
+          if (next >= num_buckets_) {
+            ok_ = false;
+            return false;
+          }
+          bucket.first = static_cast<uint32_t>(next);
+          bucket.second = reader.GetZigZag();
+          ++next;
+        }
+        break;
+      }
+      case ViewData::Type::kExponentialHistogram:
+        row->count = static_cast<int64_t>(reader.GetVarint());
+        row->sum = reader.GetDouble();
+        row->min = reader.GetDouble();
+        row->max = reader.GetDouble();
+        row->scale = static_cast<int>(reader.GetZigZag());
+        row->zero_count = reader.GetVarint();
+        GetBuckets(num_buckets_, &reader, &row->positive_offset,
+                   &row->positive_counts);
+        GetBuckets(num_buckets_, &reader, &row->negative_offset,
+                   &row->negative_counts);
+        if (row->scale < ExponentialHistogram::kMinScale ||
+            row->scale > ExponentialHistogram::kMaxScale) {
+          ok_ = false;
+          return false;
+        }
+        break;
+    }
+  } else if (kind != kRemovedRow) {
+    ok_ = false;
+    return false;
+  }
+  if (!reader.ok()) {
+    ok_ = false;
+    return false;
+  }
+  rows_ = reader.remaining();
+  ++rows_read_;
+  return true;
+}
+
+ViewDataDecoder::ViewDataDecoder(const ViewDescriptor& descriptor)
+    : descriptor_(descriptor) {}
+
+ViewDataDecoder::~ViewDataDecoder() = default;
+
+bool ViewDataDecoder::Apply(ViewDataFrame* frame) {
+  const Aggregation& aggregation = descriptor_.aggregation();
+  bool matches = frame->view_name() == descriptor_.name() &&
+                 frame->num_columns() == descriptor_.num_columns() &&
+                 frame->num_buckets() == NumBuckets(aggregation);
+  switch (frame->type()) {
+    case ViewData::Type::kDouble:
+    case ViewData::Type::kInt64:
+      matches = matches && NumBuckets(aggregation) == 0;
+      break;
+    case ViewData::Type::kDistribution:
+      matches = matches &&
+                aggregation.type() == Aggregation::Type::kDistribution;
+      break;
+    case ViewData::Type::kExponentialHistogram:
+      matches = matches &&
+                (aggregation.type() ==
+                     Aggregation::Type::kExponentialHistogram ||
+                 aggregation.type() == Aggregation::Type::kQuantiles);
+      break;
+  }
+  if (frame->is_delta()) {
+    matches = matches && data_ != nullptr &&
+              frame->sequence() == sequence_ + 1 &&
+              static_cast<int>(frame->type()) ==
+                  static_cast<int>(data_->type());
+  }
+  if (!matches) {
+    data_.reset();
+    return false;
+  }
+
+  if (!frame->is_delta()) {
+    data_.reset(new ViewDataImpl(
+        frame->start_time(), descriptor_,
+        static_cast<ViewDataImpl::Type>(frame->type())));
+  } else if (data_.use_count() > 1) {
+    data_ = std::make_shared<ViewDataImpl>(*data_);
+  }
+  sequence_ = frame->sequence();
+  data_->start_time_ = frame->start_time();
+  data_->end_time_ = frame->end_time();
+  data_->dropped_rows_ = frame->dropped_rows();
+  data_->expired_rows_ = frame->expired_rows();
+  if (!ApplyRows(frame)) {
+    data_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool ViewDataDecoder::ApplyRows(ViewDataFrame* frame) {
+  ViewDataImpl& data = *data_;
+  key_.resize(frame->num_columns());
+  while (frame->NextRow(&row_)) {
+    for (size_t column = 0; column < key_.size(); ++column) {
+      const absl::string_view tag_value =
+          frame->dictionary(column)[row_.codes[column]];
+      key_[column].assign(tag_value.data(), tag_value.size());
+    }
+    if (row_.removed) {
+      data.EraseRow(key_);
+      continue;
+    }
+    switch (data.type()) {
+      case ViewDataImpl::Type::kDouble:
+        data.double_data_[key_] = row_.double_value;
+        break;
+      case ViewDataImpl::Type::kInt64:
+        data.int_data_[key_] += row_.int_value;
+        break;
+      case ViewDataImpl::Type::kDistribution: {
+        auto it = data.distribution_data_.find(key_);
+        if (it == data.distribution_data_.end()) {
+          it = data.distribution_data_
+                   .emplace(key_, Distribution(
+                                      &data.aggregation_.bucket_boundaries()))
+                   .first;
+        }
+        Distribution& value = it->second;
+        value.count_ += row_.count;
+        value.mean_ = row_.mean;
+        value.sum_of_squared_deviation_ = row_.sum_of_squared_deviation;
+        value.min_ = row_.min;
+        value.max_ = row_.max;
+        for (const auto& bucket : row_.buckets) {
+          value.bucket_counts_[bucket.first] += bucket.second;
+        }
+        break;
+      }
+      case ViewDataImpl::Type::kExponentialHistogram: {
+        auto it = data.exponential_histogram_data_.find(key_);
+        if (it == data.exponential_histogram_data_.end()) {
+          it = data.exponential_histogram_data_
+                   .emplace(key_, ExponentialHistogram(
+                                      data.aggregation_.max_buckets()))
+                   .first;
+        }
+        ExponentialHistogram& value = it->second;
+        value.count_ = row_.count;
+        value.sum_ = row_.sum;
+        value.min_ = row_.min;
+        value.max_ = row_.max;
+        value.scale_ = row_.scale;
+        value.zero_count_ = row_.zero_count;
+        value.positive_.offset = row_.positive_offset;
+        value.positive_.counts = row_.positive_counts;
+        value.negative_.offset = row_.negative_offset;
+        value.negative_.counts = row_.negative_counts;
+        break;
+      }
+      case ViewDataImpl::Type::kInterval:
+        return false;
+    }
+  }
+  return frame->ok();
+}
+
+bool ViewDataDecoder::Decode(absl::string_view buffer) {
+  while (!buffer.empty()) {
+    ViewDataFrame frame;
+    if (!frame.Parse(&buffer)) {
+      data_.reset();
+      return false;
+    }
+    if (!Apply(&frame)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ViewData ViewDataDecoder::data() const { return ViewData(data_); }
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,276 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/view_data_codec.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+constexpr char kDoubleMeasure[] = "test/double";
+constexpr char kIntMeasure[] = "test/int";
+
+class ViewDataCodecTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    MeasureDouble::Register(kDoubleMeasure, "", "");
+    MeasureInt64::Register(kIntMeasure, "", "");
+  }
+
+  ViewDescriptor Descriptor(absl::string_view measure,
+                            const Aggregation& aggregation) {
+    return ViewDescriptor()
+        .set_name("view")
+        .set_measure(measure)
+        .set_aggregation(aggregation)
+        .add_column(key1_)
+        .add_column(key2_);
+  }
+
+  // Encodes 'data' as a full frame and decodes it.
+  ViewData RoundTrip(const ViewDescriptor& descriptor, const ViewData& data) {
+    ViewDataEncoder encoder(descriptor);
+    std::string encoded;
+    encoder.Encode(data, &encoded);
+    ViewDataDecoder decoder(descriptor);
+    EXPECT_TRUE(decoder.Decode(encoded));
+    EXPECT_TRUE(decoder.has_data());
+    return decoder.data();
+  }
+
+  const opencensus::tags::TagKey key1_ =
+      opencensus::tags::TagKey::Register("key1");
+  const opencensus::tags::TagKey key2_ =
+      opencensus::tags::TagKey::Register("key2");
+};
+
+TEST_F(ViewDataCodecTest, RoundTripSum) {
+  const auto descriptor = Descriptor(kDoubleMeasure, Aggregation::Sum());
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, 1.5}, {{"b", "x"}, -2}});
+  const ViewData decoded = RoundTrip(descriptor, data);
+  EXPECT_EQ(ViewData::Type::kDouble, decoded.type());
+  EXPECT_EQ(data.start_time(), decoded.start_time());
+  EXPECT_EQ(data.end_time(), decoded.end_time());
+  EXPECT_THAT(decoded.double_data(),
+              UnorderedElementsAre(
+                  Pair(std::vector<std::string>{"a", "x"}, 1.5),
+                  Pair(std::vector<std::string>{"b", "x"}, -2)));
+}
+
+TEST_F(ViewDataCodecTest, RoundTripCount) {
+  const auto descriptor = Descriptor(kIntMeasure, Aggregation::Count());
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, 1}, {{"a", "x"}, 1}, {{"", "y"}, 1}});
+  const ViewData decoded = RoundTrip(descriptor, data);
+  EXPECT_THAT(decoded.int_data(),
+              UnorderedElementsAre(Pair(std::vector<std::string>{"a", "x"}, 2),
+                                   Pair(std::vector<std::string>{"", "y"}, 1)));
+}
+
+TEST_F(ViewDataCodecTest, RoundTripDistribution) {
+  const auto descriptor = Descriptor(
+      kDoubleMeasure,
+      Aggregation::Distribution(BucketBoundaries::Explicit({0, 10, 100})));
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, -1}, {{"a", "x"}, 500}, {{"b", "x"}, 5}});
+  const ViewData decoded = RoundTrip(descriptor, data);
+  ASSERT_EQ(2, decoded.distribution_data().size());
+  for (const auto& row : data.distribution_data()) {
+    const auto it = decoded.distribution_data().find(row.first);
+    ASSERT_NE(decoded.distribution_data().end(), it);
+    EXPECT_EQ(row.second.DebugString(), it->second.DebugString());
+    EXPECT_EQ(row.second.bucket_counts(), it->second.bucket_counts());
+  }
+}
+
+TEST_F(ViewDataCodecTest, RoundTripExponentialHistogram) {
+  const auto descriptor =
+      Descriptor(kDoubleMeasure, Aggregation::ExponentialHistogram(16));
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, 3}, {{"a", "x"}, -7}, {{"a", "x"}, 0}});
+  const ViewData decoded = RoundTrip(descriptor, data);
+  ASSERT_EQ(1, decoded.exponential_histogram_data().size());
+  EXPECT_EQ(data.exponential_histogram_data().begin()->second.DebugString(),
+            decoded.exponential_histogram_data().begin()->second.DebugString());
+}
+
+TEST_F(ViewDataCodecTest, DeltaFrames) {
+  const auto descriptor = Descriptor(kIntMeasure, Aggregation::Count());
+  const ViewData first = testing::TestUtils::MakeViewData(
+      descriptor,
+      {{{"same", "x"}, 1}, {{"changed", "x"}, 1}, {{"gone", "x"}, 1}});
+  const ViewData second = testing::TestUtils::MakeViewData(
+      descriptor, {{{"same", "x"}, 1},
+                   {{"changed", "x"}, 1},
+                   {{"changed", "x"}, 1},
+                   {{"new", "x"}, 1}});
+  ViewDataEncoder encoder(descriptor);
+  std::string encoded;
+  encoder.Encode(first, &encoded);
+  const size_t first_size = encoded.size();
+  encoder.Encode(second, &encoded);
+
+  // The second frame holds only the changed, new and removed rows.
+  absl::string_view buffer = encoded;
+  ViewDataFrame frame;
+  ASSERT_TRUE(frame.Parse(&buffer));
+  EXPECT_FALSE(frame.is_delta());
+  EXPECT_EQ(3, frame.num_rows());
+  ASSERT_TRUE(frame.Parse(&buffer));
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_TRUE(frame.is_delta());
+  EXPECT_EQ(1, frame.sequence());
+  EXPECT_EQ(3, frame.num_rows());
+
+  ViewDataDecoder decoder(descriptor);
+  ASSERT_TRUE(decoder.Decode(absl::string_view(encoded).substr(0, first_size)));
+  const ViewData decoded_first = decoder.data();
+  ASSERT_TRUE(decoder.Decode(absl::string_view(encoded).substr(first_size)));
+  EXPECT_THAT(
+      decoder.data().int_data(),
+      UnorderedElementsAre(Pair(std::vector<std::string>{"same", "x"}, 1),
+                           Pair(std::vector<std::string>{"changed", "x"}, 2),
+                           Pair(std::vector<std::string>{"new", "x"}, 1)));
+  // Data returned earlier is unaffected.
+  EXPECT_EQ(3, decoded_first.int_data().size());
+  EXPECT_EQ(1, decoded_first.int_data().at({"changed", "x"}));
+}
+
+TEST_F(ViewDataCodecTest, DeltaDistribution) {
+  const auto descriptor = Descriptor(
+      kDoubleMeasure,
+      Aggregation::Distribution(BucketBoundaries::Explicit({0, 10, 100})));
+  const ViewData first =
+      testing::TestUtils::MakeViewData(descriptor, {{{"a", "x"}, 5}});
+  const ViewData second = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, 5}, {{"a", "x"}, 50}});
+  ViewDataEncoder encoder(descriptor);
+  std::string encoded;
+  encoder.Encode(first, &encoded);
+  encoder.Encode(second, &encoded);
+  ViewDataDecoder decoder(descriptor);
+  ASSERT_TRUE(decoder.Decode(encoded));
+  const Distribution& decoded =
+      decoder.data().distribution_data().at({"a", "x"});
+  EXPECT_EQ(second.distribution_data().begin()->second.DebugString(),
+            decoded.DebugString());
+}
+
+TEST_F(ViewDataCodecTest, DeltaRequiresPreviousFrame) {
+  const auto descriptor = Descriptor(kIntMeasure, Aggregation::Count());
+  const ViewData data =
+      testing::TestUtils::MakeViewData(descriptor, {{{"a", "x"}, 1}});
+  ViewDataEncoder encoder(descriptor);
+  std::string full;
+  std::string delta;
+  encoder.Encode(data, &full);
+  encoder.Encode(data, &delta);
+
+  ViewDataDecoder decoder(descriptor);
+  EXPECT_FALSE(decoder.Decode(delta));
+  EXPECT_FALSE(decoder.has_data());
+  // A full frame restarts decoding.
+  std::string restarted;
+  encoder.EncodeFull(data, &restarted);
+  ASSERT_TRUE(decoder.Decode(restarted));
+  EXPECT_EQ(1, decoder.data().int_data().at({"a", "x"}));
+}
+
+TEST_F(ViewDataCodecTest, ReadsInPlace) {
+  const auto descriptor = Descriptor(kDoubleMeasure, Aggregation::Sum());
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, 1}, {{"b", "x"}, 2}});
+  ViewDataEncoder encoder(descriptor);
+  std::string encoded;
+  encoder.Encode(data, &encoded);
+
+  absl::string_view buffer = encoded;
+  ViewDataFrame frame;
+  ASSERT_TRUE(frame.Parse(&buffer));
+  EXPECT_EQ("view", frame.view_name());
+  ASSERT_EQ(2, frame.num_columns());
+  ASSERT_EQ(1, frame.dictionary(1).size());
+  EXPECT_EQ("x", frame.dictionary(1)[0]);
+  // Tag values point into the buffer.
+  EXPECT_GE(frame.dictionary(1)[0].data(), encoded.data());
+  EXPECT_LT(frame.dictionary(1)[0].data(), encoded.data() + encoded.size());
+
+  ViewDataFrame::Row row;
+  double sum = 0;
+  while (frame.NextRow(&row)) {
+    EXPECT_FALSE(row.removed);
+    sum += row.double_value;
+  }
+  EXPECT_TRUE(frame.ok());
+  EXPECT_EQ(3, sum);
+}
+
+TEST_F(ViewDataCodecTest, RejectsOtherViews) {
+  const auto descriptor = Descriptor(kIntMeasure, Aggregation::Count());
+  const ViewData data =
+      testing::TestUtils::MakeViewData(descriptor, {{{"a", "x"}, 1}});
+  ViewDataEncoder encoder(descriptor);
+  std::string encoded;
+  encoder.Encode(data, &encoded);
+
+  ViewDataDecoder renamed(Descriptor(kIntMeasure, Aggregation::Count())
+                              .set_name("other"));
+  EXPECT_FALSE(renamed.Decode(encoded));
+  ViewDataDecoder distribution(Descriptor(
+      kDoubleMeasure,
+      Aggregation::Distribution(BucketBoundaries::Explicit({0}))));
+  EXPECT_FALSE(distribution.Decode(encoded));
+}
+
+TEST_F(ViewDataCodecTest, RejectsMalformedFrames) {
+  const auto descriptor = Descriptor(
+      kDoubleMeasure,
+      Aggregation::Distribution(BucketBoundaries::Explicit({0, 10, 100})));
+  const ViewData data = testing::TestUtils::MakeViewData(
+      descriptor, {{{"a", "x"}, -1}, {{"b", "y"}, 500}});
+  ViewDataEncoder encoder(descriptor);
+  std::string encoded;
+  encoder.Encode(data, &encoded);
+
+  for (size_t size = 1; size < encoded.size(); ++size) {
+    ViewDataDecoder decoder(descriptor);
+    EXPECT_FALSE(decoder.Decode(encoded.substr(0, size))) << size;
+  }
+  // Corrupting any byte must not crash, though not every corruption is
+  // detected.
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    std::string corrupted = encoded;
+    corrupted[i] = static_cast<char>(corrupted[i] ^ 0xff);
+    ViewDataDecoder decoder(descriptor);
+    decoder.Decode(corrupted);
+  }
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
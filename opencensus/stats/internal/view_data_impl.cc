@@ -14,19 +14,266 @@
 
 #include "opencensus/stats/internal/view_data_impl.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/internal/interval_buckets.h"
 #include "opencensus/stats/measure_descriptor.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
 
+namespace {
+
+// Returns a map key holding copies of 'tag_values'.
+std::vector<std::string> MakeKey(
+    absl::Span<const absl::string_view> tag_values) {
+  return std::vector<std::string>(tag_values.begin(), tag_values.end());
+}
+
+// Returns the bytes allocated by 's', which is none for short strings stored
+// inline.
+size_t StringHeapBytes(const std::string& s) {
+  const char* const object = reinterpret_cast<const char*>(&s);
+  if (s.data() >= object && s.data() < object + sizeof(s)) {
+    return 0;
+  }
+  return s.capacity() + 1;
+}
+
+size_t RowHeapBytes(double) { return 0; }
+
+size_t RowHeapBytes(int64_t) { return 0; }
+
+size_t RowHeapBytes(const Distribution& distribution) {
+  return distribution.bucket_counts().capacity() * sizeof(uint64_t) +
+         distribution.exemplars().capacity() * sizeof(Exemplar);
+}
+
+size_t RowHeapBytes(const ExponentialHistogram& histogram) {
+  return (histogram.positive_buckets().counts.capacity() +
+          histogram.negative_buckets().counts.capacity()) *
+         sizeof(uint64_t);
+}
+
+size_t RowHeapBytes(const IntervalRow& row) {
+  return IntervalBuckets::kNumSlots *
+         (row.num_doubles() * sizeof(double) +
+          row.num_counts() * sizeof(uint64_t));
+}
+
+// A node_hash_map has a slot pointer and a control byte per unit of capacity,
+// and allocates a node for each row.
+template <typename DataValueT>
+size_t DataMapBytes(const ViewDataImpl::DataMap<DataValueT>& map) {
+  size_t bytes = map.capacity() * (sizeof(void*) + 1);
+  for (const auto& row : map) {
+    bytes += sizeof(row) + row.first.capacity() * sizeof(std::string) +
+             RowHeapBytes(row.second);
+    for (const std::string& tag_value : row.first) {
+      bytes += StringHeapBytes(tag_value);
+    }
+  }
+  return bytes;
+}
+
+bool RowDataEqual(double a, double b) { return a == b; }
+
+bool RowDataEqual(int64_t a, int64_t b) { return a == b; }
+
+bool RowDataEqual(const Distribution& a, const Distribution& b) {
+  return a.count() == b.count() && a.mean() == b.mean() &&
+         a.sum_of_squared_deviation() == b.sum_of_squared_deviation() &&
+         a.min() == b.min() && a.max() == b.max() &&
+         a.bucket_counts() == b.bucket_counts();
+}
+
+bool RowDataEqual(const ExponentialHistogram& a,
+                  const ExponentialHistogram& b) {
+  return a.count() == b.count() && a.sum() == b.sum() &&
+         a.min() == b.min() && a.max() == b.max() &&
+         a.scale() == b.scale() && a.zero_count() == b.zero_count() &&
+         a.positive_buckets().offset == b.positive_buckets().offset &&
+         a.positive_buckets().counts == b.positive_buckets().counts &&
+         a.negative_buckets().offset == b.negative_buckets().offset &&
+         a.negative_buckets().counts == b.negative_buckets().counts;
+}
+
+// Copies the rows of 'current' that are absent from 'previous' or differ there
+// into 'changed'.
+template <typename DataValueT>
+void CopyChangedRows(
+    const ViewDataImpl::DataMap<DataValueT>& current,
+    const ViewDataImpl::DataMap<DataValueT>& previous,
+    ViewDataImpl::DataMap<DataValueT>* changed) {
+  for (const auto& row : current) {
+    const auto it = previous.find(row.first);
+    if (it == previous.end() || !RowDataEqual(row.second, it->second)) {
+      changed->emplace(row.first, row.second);
+    }
+  }
+}
+
+// Copies the rows of 'source' that match 'filter' into 'matching'.
+template <typename DataValueT>
+void CopyMatchingRows(const ViewDataImpl::DataMap<DataValueT>& source,
+                      const ViewDataImpl::RowFilter& filter,
+                      ViewDataImpl::DataMap<DataValueT>* matching) {
+  for (const auto& row : source) {
+    if (ViewDataImpl::RowMatches(filter, row.first)) {
+      matching->emplace(row.first, row.second);
+    }
+  }
+}
+
+// Appends each row's value of 'column' in 'map' to '*values'.
+template <typename DataValueT>
+void AppendColumnValues(const ViewDataImpl::DataMap<DataValueT>& map,
+                        int column, std::vector<std::string>* values) {
+  for (const auto& row : map) {
+    values->push_back(row.first[column]);
+  }
+}
+
+// The Merge() kernels for the views other than interval views: the type of
+// their rows, and how data is added to a row.
+struct SumDoubleKernel {
+  typedef double Value;
+  static void Add(const MeasureData& data, double* row) { *row += data.sum(); }
+};
+
+struct LastValueDoubleKernel {
+  typedef double Value;
+  static void Add(const MeasureData& data, double* row) {
+    *row = data.last_value();
+  }
+};
+
+struct CountKernel {
+  typedef int64_t Value;
+  static void Add(const MeasureData& data, int64_t* row) {
+    *row += data.count();
+  }
+};
+
+struct SumInt64Kernel {
+  typedef int64_t Value;
+  static void Add(const MeasureData& data, int64_t* row) {
+    *row += data.int_sum();
+  }
+};
+
+struct LastValueInt64Kernel {
+  typedef int64_t Value;
+  static void Add(const MeasureData& data, int64_t* row) {
+    *row = data.int_last_value();
+  }
+};
+
+struct DistributionKernel {
+  typedef Distribution Value;
+  static void Add(const MeasureData& data, Distribution* row) {
+    data.AddToDistribution(row);
+  }
+};
+
+struct ExponentialHistogramKernel {
+  typedef ExponentialHistogram Value;
+  static void Add(const MeasureData& data, ExponentialHistogram* row) {
+    data.AddToExponentialHistogram(row);
+  }
+};
+
+}  // namespace
+
+template <>
+ViewDataImpl::DataMap<double>* ViewDataImpl::mutable_rows<double>() {
+  ABSL_ASSERT(type_ == Type::kDouble);
+  return &double_data_;
+}
+
+template <>
+ViewDataImpl::DataMap<int64_t>* ViewDataImpl::mutable_rows<int64_t>() {
+  ABSL_ASSERT(type_ == Type::kInt64);
+  return &int_data_;
+}
+
+template <>
+ViewDataImpl::DataMap<Distribution>*
+ViewDataImpl::mutable_rows<Distribution>() {
+  ABSL_ASSERT(type_ == Type::kDistribution);
+  return &distribution_data_;
+}
+
+template <>
+ViewDataImpl::DataMap<ExponentialHistogram>*
+ViewDataImpl::mutable_rows<ExponentialHistogram>() {
+  ABSL_ASSERT(type_ == Type::kExponentialHistogram);
+  return &exponential_histogram_data_;
+}
+
+template <>
+double ViewDataImpl::EmptyRow<double>() const {
+  return 0;
+}
+
+template <>
+int64_t ViewDataImpl::EmptyRow<int64_t>() const {
+  return 0;
+}
+
+template <>
+Distribution ViewDataImpl::EmptyRow<Distribution>() const {
+  return Distribution(&aggregation_.bucket_boundaries());
+}
+
+template <>
+ExponentialHistogram ViewDataImpl::EmptyRow<ExponentialHistogram>() const {
+  return ExponentialHistogram(aggregation_.max_buckets());
+}
+
+// static
+ViewDataImpl::RowFilter ViewDataImpl::MakeRowFilter(
+    const ViewDescriptor& descriptor, const opencensus::tags::TagMap& tags) {
+  RowFilter filter;
+  filter.reserve(tags.tag_views().size());
+  for (const auto& tag : tags.tag_views()) {
+    const auto& columns = descriptor.columns();
+    const auto column = std::find(columns.begin(), columns.end(), tag.first);
+    filter.emplace_back(
+        column == columns.end() ? -1 : column - columns.begin(),
+        std::string(tag.second));
+  }
+  return filter;
+}
+
+// static
+bool ViewDataImpl::RowMatches(const RowFilter& filter,
+                              const std::vector<std::string>& tag_values) {
+  for (const auto& condition : filter) {
+    if (condition.first < 0 ||
+        tag_values[condition.first] != condition.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
 ViewDataImpl::Type ViewDataImpl::TypeForDescriptor(
     const ViewDescriptor& descriptor) {
   switch (descriptor.aggregation_window_.type()) {
@@ -42,12 +289,16 @@ ViewDataImpl::Type ViewDataImpl::TypeForDescriptor(
               return ViewDataImpl::Type::kInt64;
           }
         case Aggregation::Type::kCount:
+        case Aggregation::Type::kDistinctCount:
           return ViewDataImpl::Type::kInt64;
         case Aggregation::Type::kDistribution:
           return ViewDataImpl::Type::kDistribution;
+        case Aggregation::Type::kExponentialHistogram:
+        case Aggregation::Type::kQuantiles:
+          return ViewDataImpl::Type::kExponentialHistogram;
       }
     case AggregationWindow::Type::kInterval:
-      return ViewDataImpl::Type::kStatsObject;
+      return ViewDataImpl::Type::kInterval;
   }
   ABSL_ASSERT(false && "Bad ViewDataImpl type.");
   return ViewDataImpl::Type::kDouble;
@@ -55,10 +306,32 @@ ViewDataImpl::Type ViewDataImpl::TypeForDescriptor(
 
 ViewDataImpl::ViewDataImpl(absl::Time start_time,
                            const ViewDescriptor& descriptor)
+    : ViewDataImpl(start_time, descriptor, TypeForDescriptor(descriptor)) {}
+
+ViewDataImpl::ViewDataImpl(absl::Time start_time,
+                           const ViewDescriptor& descriptor, Type type)
     : aggregation_(descriptor.aggregation()),
       aggregation_window_(descriptor.aggregation_window_),
-      type_(TypeForDescriptor(descriptor)),
-      start_time_(start_time) {
+      type_(type),
+      merge_(SelectMerge(type_, aggregation_)),
+      start_time_(start_time),
+      max_rows_(descriptor.max_rows()),
+      overflow_tag_values_(max_rows_ > 0 ? descriptor.num_columns() : 0,
+                           ViewDescriptor::kOverflowTagValue),
+      row_ttl_(descriptor.row_ttl()) {
+  // The overflow row is the only one past the limit.
+  expected_rows_ = max_rows_ > 0 ? std::min(descriptor.expected_rows(),
+                                            max_rows_ + 1)
+                                 : descriptor.expected_rows();
+  if (descriptor.top_k() > 0) {
+    const std::vector<opencensus::tags::TagKey>& columns = descriptor.columns();
+    const auto column = std::find(columns.begin(), columns.end(),
+                                  *descriptor.top_k_column());
+    if (column != columns.end()) {
+      top_k_ = descriptor.top_k();
+      top_k_column_ = column - columns.begin();
+    }
+  }
   switch (type_) {
     case Type::kDouble: {
       new (&double_data_) DataMap<double>();
@@ -72,45 +345,119 @@ ViewDataImpl::ViewDataImpl(absl::Time start_time,
       new (&distribution_data_) DataMap<Distribution>();
       break;
     }
-    case Type::kStatsObject: {
-      new (&interval_data_) DataMap<IntervalStatsObject>();
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_) DataMap<ExponentialHistogram>();
       break;
     }
+    case Type::kInterval: {
+      new (&interval_data_) DataMap<IntervalRow>();
+      interval_levels_.emplace_back(aggregation_window_.duration(),
+                                    start_time);
+      break;
+    }
+  }
+  ReserveRows();
+}
+
+void ViewDataImpl::ReserveRows() {
+  if (expected_rows_ == 0) {
+    return;
   }
+  switch (type_) {
+    case Type::kDouble:
+      double_data_.reserve(expected_rows_);
+      break;
+    case Type::kInt64:
+      int_data_.reserve(expected_rows_);
+      break;
+    case Type::kDistribution:
+      distribution_data_.reserve(expected_rows_);
+      break;
+    case Type::kExponentialHistogram:
+      exponential_histogram_data_.reserve(expected_rows_);
+      break;
+    case Type::kInterval:
+      interval_data_.reserve(expected_rows_);
+      break;
+  }
+}
+
+ViewDataImpl::ViewDataImpl(const ViewDataImpl& other, absl::Time now,
+                           const RowFilter* filter)
+    : ViewDataImpl(other, other.aggregation_window().duration(), now, filter) {
 }
 
-ViewDataImpl::ViewDataImpl(const ViewDataImpl& other, absl::Time now)
+ViewDataImpl::ViewDataImpl(const ViewDataImpl& other, absl::Duration window,
+                           absl::Time now, const RowFilter* filter)
     : aggregation_(other.aggregation()),
-      aggregation_window_(other.aggregation_window()),
+      aggregation_window_(AggregationWindow::Interval(window)),
       type_(other.aggregation().type() == Aggregation::Type::kDistribution
                 ? Type::kDistribution
                 : Type::kDouble),
-      start_time_(std::max(other.start_time(),
-                           now - other.aggregation_window().duration())),
-      end_time_(now) {
-  ABSL_ASSERT(aggregation_window_.type() == AggregationWindow::Type::kInterval);
+      merge_(SelectMerge(type_, aggregation_)),
+      end_time_(now),
+      max_rows_(other.max_rows_),
+      overflow_tag_values_(other.overflow_tag_values_),
+      dropped_rows_(other.dropped_rows_),
+      row_ttl_(other.row_ttl_),
+      expired_rows_(other.expired_rows_),
+      sample_one_in_(other.sample_one_in_) {
+  ABSL_ASSERT(other.aggregation_window().type() ==
+              AggregationWindow::Type::kInterval);
+  int level = other.FindIntervalLevel(window);
+  ABSL_ASSERT(level >= 0 && "Window was not added to the interval view.");
+  level = std::max(level, 0);
+  const ViewDataImpl::IntervalLevel& source = other.interval_levels_[level];
+  start_time_ = std::max(source.start_time, now - window);
+  // The level's own ring, and the unfinished current bucket of each finer
+  // level, which lies within the level's current bucket.
+  std::vector<double> weights(
+      IntervalRow::LevelSlot(other.interval_levels_.size(), 0), 0);
+  const IntervalBuckets::Weights level_weights =
+      source.buckets.SlotWeights(now);
+  std::copy(level_weights.begin(), level_weights.end(),
+            weights.begin() + IntervalRow::LevelSlot(level, 0));
+  for (int finer = 0; finer < level; ++finer) {
+    weights[IntervalRow::LevelSlot(
+        finer, other.interval_levels_[finer].buckets.current_slot())] =
+        level_weights[source.buckets.current_slot()];
+  }
   switch (aggregation_.type()) {
-    case Aggregation::Type::kSum:
+    case Aggregation::Type::kSum: {
+      new (&double_data_) DataMap<double>();
+      for (const auto& row : other.interval_data()) {
+        if (filter != nullptr && !RowMatches(*filter, row.first)) {
+          continue;
+        }
+        double_data_[row.first] = row.second.WeightedDouble(0, weights);
+      }
+      break;
+    }
     case Aggregation::Type::kCount: {
       new (&double_data_) DataMap<double>();
       for (const auto& row : other.interval_data()) {
-        row.second.SumInto(absl::Span<double>(&double_data_[row.first], 1),
-                           now);
+        if (filter != nullptr && !RowMatches(*filter, row.first)) {
+          continue;
+        }
+        double_data_[row.first] = row.second.WeightedCount(0, weights);
       }
       break;
     }
     case Aggregation::Type::kDistribution: {
       new (&distribution_data_) DataMap<Distribution>();
       for (const auto& row : other.interval_data()) {
+        if (filter != nullptr && !RowMatches(*filter, row.first)) {
+          continue;
+        }
         const std::pair<DataMap<Distribution>::iterator, bool>& it =
             distribution_data_.emplace(
                 row.first, Distribution(&aggregation_.bucket_boundaries()));
         Distribution& distribution = it.first->second;
         row.second.DistributionInto(
-            &distribution.count_, &distribution.mean_,
+            weights, &distribution.count_, &distribution.mean_,
             &distribution.sum_of_squared_deviation_, &distribution.min_,
             &distribution.max_,
-            absl::Span<uint64_t>(distribution.bucket_counts_), now);
+            absl::Span<uint64_t>(distribution.bucket_counts_));
       }
       break;
     }
@@ -118,6 +465,19 @@ ViewDataImpl::ViewDataImpl(const ViewDataImpl& other, absl::Time now)
       std::cerr << "Interval/LastValue is not supported.\n";
       ABSL_ASSERT(0 && "Interval/LastValue is not supported.\n");
       break;
+    case Aggregation::Type::kExponentialHistogram:
+    case Aggregation::Type::kQuantiles:
+      // Rejected by StatsManager::AddConsumer().
+      std::cerr << "Interval/ExponentialHistogram is not supported.\n";
+      ABSL_ASSERT(0 && "Interval/ExponentialHistogram is not supported.\n");
+      new (&double_data_) DataMap<double>();
+      break;
+    case Aggregation::Type::kDistinctCount:
+      // Rejected by StatsManager::AddConsumer().
+      std::cerr << "Interval/DistinctCount is not supported.\n";
+      ABSL_ASSERT(0 && "Interval/DistinctCount is not supported.\n");
+      new (&double_data_) DataMap<double>();
+      break;
   }
 }
 
@@ -135,8 +495,12 @@ ViewDataImpl::~ViewDataImpl() {
       distribution_data_.~DataMap<Distribution>();
       break;
     }
-    case Type::kStatsObject: {
-      interval_data_.~DataMap<IntervalStatsObject>();
+    case Type::kExponentialHistogram: {
+      exponential_histogram_data_.~DataMap<ExponentialHistogram>();
+      break;
+    }
+    case Type::kInterval: {
+      interval_data_.~DataMap<IntervalRow>();
       break;
     }
   }
@@ -147,12 +511,302 @@ std::unique_ptr<ViewDataImpl> ViewDataImpl::GetDeltaAndReset(absl::Time now) {
   return absl::WrapUnique(new ViewDataImpl(this, now));
 }
 
+void ViewDataImpl::TakeDeltaAndReset(absl::Time now, ViewDataImpl* delta) {
+  ABSL_ASSERT(delta->type_ == type_);
+  // Clearing delta's maps before the swap hands their storage to this.
+  switch (type_) {
+    case Type::kDouble: {
+      delta->double_data_.clear();
+      double_data_.swap(delta->double_data_);
+      break;
+    }
+    case Type::kInt64: {
+      delta->int_data_.clear();
+      int_data_.swap(delta->int_data_);
+      break;
+    }
+    case Type::kDistribution: {
+      delta->distribution_data_.clear();
+      distribution_data_.swap(delta->distribution_data_);
+      break;
+    }
+    case Type::kExponentialHistogram: {
+      delta->exponential_histogram_data_.clear();
+      exponential_histogram_data_.swap(delta->exponential_histogram_data_);
+      break;
+    }
+    case Type::kInterval: {
+      std::cerr << "TakeDeltaAndReset should not be called on ViewDataImpl "
+                   "for interval stats.";
+      ABSL_ASSERT(0);
+      break;
+    }
+  }
+  delta->start_time_ = start_time_;
+  delta->end_time_ = now;
+  delta->dropped_rows_ = dropped_rows_;
+  delta->expired_rows_ = expired_rows_;
+  delta->sample_one_in_ = sample_one_in_;
+  delta->row_update_times_.clear();
+  delta->distinct_sketches_.clear();
+  start_time_ = now;
+  end_time_ = now;
+  dropped_rows_ = 0;
+  row_update_times_.clear();
+  distinct_sketches_.clear();
+  top_k_counts_.clear();
+  top_k_order_.clear();
+  // Large maps are freed rather than kept by clear(), so the map taken from
+  // 'delta' may need reserving again.
+  ReserveRows();
+}
+
+std::unique_ptr<ViewDataImpl> ViewDataImpl::ChangedRowsSince(
+    const ViewDataImpl& previous) const {
+  // Need to use WrapUnique because this is a private constructor.
+  return absl::WrapUnique(new ViewDataImpl(*this, previous));
+}
+
+ViewDataImpl::ViewDataImpl(const ViewDataImpl& current,
+                           const ViewDataImpl& previous)
+    : aggregation_(current.aggregation_),
+      aggregation_window_(current.aggregation_window_),
+      type_(current.type_),
+      merge_(SelectMerge(type_, aggregation_)),
+      start_time_(current.start_time_),
+      end_time_(current.end_time_),
+      max_rows_(current.max_rows_),
+      overflow_tag_values_(current.overflow_tag_values_),
+      dropped_rows_(current.dropped_rows_),
+      row_ttl_(current.row_ttl_),
+      expired_rows_(current.expired_rows_),
+      sample_one_in_(current.sample_one_in_) {
+  ABSL_ASSERT(type_ == previous.type_);
+  switch (type_) {
+    case Type::kDouble: {
+      new (&double_data_) DataMap<double>();
+      CopyChangedRows(current.double_data_, previous.double_data_,
+                      &double_data_);
+      break;
+    }
+    case Type::kInt64: {
+      new (&int_data_) DataMap<int64_t>();
+      CopyChangedRows(current.int_data_, previous.int_data_, &int_data_);
+      break;
+    }
+    case Type::kDistribution: {
+      new (&distribution_data_) DataMap<Distribution>();
+      CopyChangedRows(current.distribution_data_, previous.distribution_data_,
+                      &distribution_data_);
+      break;
+    }
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_) DataMap<ExponentialHistogram>();
+      CopyChangedRows(current.exponential_histogram_data_,
+                      previous.exponential_histogram_data_,
+                      &exponential_histogram_data_);
+      break;
+    }
+    case Type::kInterval: {
+      std::cerr << "ChangedRowsSince should not be called on ViewDataImpl for "
+                   "interval stats.";
+      ABSL_ASSERT(0);
+      break;
+    }
+  }
+}
+
+std::unique_ptr<ViewDataImpl> ViewDataImpl::MatchingRows(
+    const RowFilter& filter) const {
+  // Need to use WrapUnique because this is a private constructor.
+  return absl::WrapUnique(new ViewDataImpl(*this, filter));
+}
+
+ViewDataImpl::ViewDataImpl(const ViewDataImpl& other, const RowFilter& filter)
+    : aggregation_(other.aggregation_),
+      aggregation_window_(other.aggregation_window_),
+      type_(other.type_),
+      merge_(SelectMerge(type_, aggregation_)),
+      start_time_(other.start_time_),
+      end_time_(other.end_time_),
+      max_rows_(other.max_rows_),
+      overflow_tag_values_(other.overflow_tag_values_),
+      dropped_rows_(other.dropped_rows_),
+      row_ttl_(other.row_ttl_),
+      expired_rows_(other.expired_rows_),
+      sample_one_in_(other.sample_one_in_) {
+  switch (type_) {
+    case Type::kDouble: {
+      new (&double_data_) DataMap<double>();
+      CopyMatchingRows(other.double_data_, filter, &double_data_);
+      break;
+    }
+    case Type::kInt64: {
+      new (&int_data_) DataMap<int64_t>();
+      CopyMatchingRows(other.int_data_, filter, &int_data_);
+      break;
+    }
+    case Type::kDistribution: {
+      new (&distribution_data_) DataMap<Distribution>();
+      CopyMatchingRows(other.distribution_data_, filter, &distribution_data_);
+      break;
+    }
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_) DataMap<ExponentialHistogram>();
+      CopyMatchingRows(other.exponential_histogram_data_, filter,
+                       &exponential_histogram_data_);
+      break;
+    }
+    case Type::kInterval: {
+      std::cerr << "MatchingRows should not be called on ViewDataImpl for "
+                   "interval stats.";
+      ABSL_ASSERT(0);
+      new (&interval_data_) DataMap<IntervalRow>();
+      break;
+    }
+  }
+}
+
+std::unique_ptr<ViewDataImpl> ViewDataImpl::RollUp(
+    absl::Span<const int> columns) const {
+  // Need to use WrapUnique because this is a private constructor.
+  return absl::WrapUnique(new ViewDataImpl(*this, columns));
+}
+
+ViewDataImpl::ViewDataImpl(const ViewDataImpl& other,
+                           absl::Span<const int> columns)
+    : aggregation_(other.aggregation_),
+      aggregation_window_(other.aggregation_window_),
+      type_(other.type_),
+      merge_(SelectMerge(type_, aggregation_)),
+      start_time_(other.start_time_),
+      end_time_(other.end_time_),
+      max_rows_(other.max_rows_),
+      overflow_tag_values_(max_rows_ > 0 ? columns.size() : 0,
+                           ViewDescriptor::kOverflowTagValue),
+      dropped_rows_(other.dropped_rows_),
+      row_ttl_(other.row_ttl_),
+      expired_rows_(other.expired_rows_),
+      sample_one_in_(other.sample_one_in_) {
+  ABSL_ASSERT(aggregation_.type() != Aggregation::Type::kLastValue);
+  switch (type_) {
+    case Type::kDouble: {
+      new (&double_data_) DataMap<double>();
+      RollUpRows(other.double_data_, columns, EmptyRow<double>(),
+                 &double_data_);
+      break;
+    }
+    case Type::kInt64: {
+      new (&int_data_) DataMap<int64_t>();
+      RollUpRows(other.int_data_, columns, EmptyRow<int64_t>(), &int_data_);
+      break;
+    }
+    case Type::kDistribution: {
+      new (&distribution_data_) DataMap<Distribution>();
+      RollUpRows(other.distribution_data_, columns, EmptyRow<Distribution>(),
+                 &distribution_data_);
+      break;
+    }
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_) DataMap<ExponentialHistogram>();
+      RollUpRows(other.exponential_histogram_data_, columns,
+                 EmptyRow<ExponentialHistogram>(),
+                 &exponential_histogram_data_);
+      break;
+    }
+    case Type::kInterval: {
+      std::cerr << "RollUp should not be called on ViewDataImpl for interval "
+                   "stats.";
+      ABSL_ASSERT(0);
+      new (&interval_data_) DataMap<IntervalRow>();
+      break;
+    }
+  }
+}
+
+// static
+template <typename DataValueT>
+void ViewDataImpl::RollUpRows(const DataMap<DataValueT>& source,
+                              absl::Span<const int> columns,
+                              const DataValueT& empty,
+                              DataMap<DataValueT>* target) {
+  std::vector<std::string> key(columns.size());
+  for (const auto& row : source) {
+    for (int i = 0; i < columns.size(); ++i) {
+      key[i] = row.first[columns[i]];
+    }
+    auto it = target->find(key);
+    if (it == target->end()) {
+      it = target->emplace(key, empty).first;
+    }
+    MergeRow(row.second, &it->second);
+  }
+}
+
+// static
+void ViewDataImpl::MergeRow(const Distribution& source, Distribution* target) {
+  if (source.count_ == 0) {
+    return;
+  }
+  if (target->count_ == 0) {
+    target->mean_ = source.mean_;
+    target->sum_of_squared_deviation_ = source.sum_of_squared_deviation_;
+  } else {
+    // Combine statistics using the parallel algorithm.
+    const double source_count = source.count_;
+    const double target_count = target->count_;
+    const double total_count = source_count + target_count;
+    const double delta = source.mean_ - target->mean_;
+    target->sum_of_squared_deviation_ +=
+        source.sum_of_squared_deviation_ +
+        delta * delta * source_count * target_count / total_count;
+    target->mean_ += delta * source_count / total_count;
+  }
+  target->count_ += source.count_;
+  target->min_ = std::min(target->min_, source.min_);
+  target->max_ = std::max(target->max_, source.max_);
+  for (int i = 0; i < source.bucket_counts_.size(); ++i) {
+    target->bucket_counts_[i] += source.bucket_counts_[i];
+  }
+  if (!source.exemplars_.empty()) {
+    // Keep the most recent exemplar of each bucket.
+    if (target->exemplars_.empty()) {
+      target->exemplars_ = source.exemplars_;
+      return;
+    }
+    for (int i = 0; i < source.exemplars_.size(); ++i) {
+      if (source.exemplars_[i].span_context.IsValid() &&
+          (!target->exemplars_[i].span_context.IsValid() ||
+           source.exemplars_[i].timestamp > target->exemplars_[i].timestamp)) {
+        target->exemplars_[i] = source.exemplars_[i];
+      }
+    }
+  }
+}
+
+// static
+void ViewDataImpl::MergeRow(const ExponentialHistogram& source,
+                            ExponentialHistogram* target) {
+  target->Merge(source);
+}
+
 ViewDataImpl::ViewDataImpl(const ViewDataImpl& other)
     : aggregation_(other.aggregation_),
       aggregation_window_(other.aggregation_window_),
       type_(other.type()),
+      merge_(SelectMerge(type_, aggregation_)),
       start_time_(other.start_time_),
-      end_time_(other.end_time_) {
+      end_time_(other.end_time_),
+      max_rows_(other.max_rows_),
+      overflow_tag_values_(other.overflow_tag_values_),
+      dropped_rows_(other.dropped_rows_),
+      top_k_(other.top_k_),
+      top_k_column_(other.top_k_column_),
+      top_k_counts_(other.top_k_counts_),
+      top_k_order_(other.top_k_order_),
+      row_ttl_(other.row_ttl_),
+      expired_rows_(other.expired_rows_),
+      sample_one_in_(other.sample_one_in_) {
   switch (type_) {
     case Type::kDouble: {
       new (&double_data_) DataMap<double>(other.double_data_);
@@ -166,86 +820,495 @@ ViewDataImpl::ViewDataImpl(const ViewDataImpl& other)
       new (&distribution_data_) DataMap<Distribution>(other.distribution_data_);
       break;
     }
-    case Type::kStatsObject: {
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_)
+          DataMap<ExponentialHistogram>(other.exponential_histogram_data_);
+      break;
+    }
+    case Type::kInterval: {
       std::cerr
-          << "StatsObject ViewDataImpl cannot (and should not) be copied. "
+          << "Interval ViewDataImpl cannot (and should not) be copied. "
              "(Possibly failed to convert to export data type?)";
       ABSL_ASSERT(0);
-      break;
+      return;
     }
   }
+  for (const auto& row : other.row_update_times_) {
+    row_update_times_.emplace(FindKey(*row.first), row.second);
+  }
+  for (const auto& row : other.distinct_sketches_) {
+    distinct_sketches_.emplace(FindKey(*row.first), row.second);
+  }
+}
+
+template <typename DataValueT>
+typename ViewDataImpl::DataMap<DataValueT>::iterator ViewDataImpl::FindRow(
+    DataMap<DataValueT>* map, absl::Span<const absl::string_view>* tag_values) {
+  auto it = map->find(*tag_values);
+  if (it == map->end() && max_rows_ > 0 && map->size() >= max_rows_) {
+    ++dropped_rows_;
+    *tag_values = overflow_tag_values_;
+    it = map->find(*tag_values);
+  }
+  return it;
+}
+
+void ViewDataImpl::MarkRowUpdated(const std::vector<std::string>& key,
+                                  absl::Time now) {
+  if (row_ttl_ != absl::InfiniteDuration()) {
+    // Data merged as of an earlier time does not move the update time back.
+    absl::Time& update_time = row_update_times_[&key];
+    update_time = std::max(update_time, now);
+  }
 }
 
-void ViewDataImpl::Merge(const std::vector<std::string>& tag_values,
+void ViewDataImpl::Merge(absl::Span<const absl::string_view> tag_values,
                          const MeasureData& data, absl::Time now) {
   end_time_ = std::max(end_time_, now);
-  switch (type_) {
-    case Type::kDouble: {
-      if (aggregation_.type() == Aggregation::Type::kSum) {
-        double_data_[tag_values] += data.sum();
-      } else {
-        ABSL_ASSERT(aggregation_.type() == Aggregation::Type::kLastValue);
-        double_data_[tag_values] = data.last_value();
+  if (top_k_ > 0) {
+    CountTopKValue(tag_values[top_k_column_], data.count());
+  }
+  if (merge_ != nullptr) {
+    (this->*merge_)(tag_values, data, now);
+  } else {
+    ABSL_ASSERT(false && "Invalid aggregation for type.");
+  }
+}
+
+// static
+ViewDataImpl::MergeFunction ViewDataImpl::SelectMerge(
+    Type type, const Aggregation& aggregation) {
+  switch (type) {
+    case Type::kDouble:
+      if (aggregation.type() == Aggregation::Type::kSum) {
+        return &ViewDataImpl::MergeRows<SumDoubleKernel>;
       }
-      break;
-    }
-    case Type::kInt64: {
-      switch (aggregation_.type()) {
-        case Aggregation::Type::kCount: {
-          int_data_[tag_values] += data.count();
-          break;
-        }
-        case Aggregation::Type::kSum: {
-          int_data_[tag_values] += data.sum();
-          break;
-        }
-        case Aggregation::Type::kLastValue: {
-          int_data_[tag_values] = data.last_value();
-          break;
-        }
+      return &ViewDataImpl::MergeRows<LastValueDoubleKernel>;
+    case Type::kInt64:
+      switch (aggregation.type()) {
+        case Aggregation::Type::kCount:
+          return &ViewDataImpl::MergeRows<CountKernel>;
+        case Aggregation::Type::kSum:
+          return &ViewDataImpl::MergeRows<SumInt64Kernel>;
+        case Aggregation::Type::kLastValue:
+          return &ViewDataImpl::MergeRows<LastValueInt64Kernel>;
         default:
-          ABSL_ASSERT(false && "Invalid aggregation for type.");
+          // DistinctCount views are merged into by MergeDistinct().
+          return nullptr;
       }
+    case Type::kDistribution:
+      return &ViewDataImpl::MergeRows<DistributionKernel>;
+    case Type::kExponentialHistogram:
+      return &ViewDataImpl::MergeRows<ExponentialHistogramKernel>;
+    case Type::kInterval:
+      return &ViewDataImpl::MergeIntervalRows;
+  }
+  return nullptr;
+}
+
+template <typename Kernel>
+void ViewDataImpl::MergeRows(absl::Span<const absl::string_view> tag_values,
+                             const MeasureData& data, absl::Time now) {
+  typedef typename Kernel::Value Value;
+  DataMap<Value>* rows = mutable_rows<Value>();
+  typename DataMap<Value>::iterator it = FindRow(rows, &tag_values);
+  if (it == rows->end()) {
+    it = rows->emplace(MakeKey(tag_values), EmptyRow<Value>()).first;
+  }
+  MarkRowUpdated(it->first, now);
+  Kernel::Add(data, &it->second);
+}
+
+void ViewDataImpl::MergeIntervalRows(
+    absl::Span<const absl::string_view> tag_values, const MeasureData& data,
+    absl::Time now) {
+  AdvanceIntervalLevels(now);
+  DataMap<IntervalRow>::iterator it = FindRow(&interval_data_, &tag_values);
+  if (it == interval_data_.end()) {
+    it = interval_data_.emplace(MakeKey(tag_values), MakeIntervalRow()).first;
+  }
+  MarkRowUpdated(it->first, now);
+  // Present data is added only to the finest level, and rolled up from
+  // there. Data for a finished bucket (e.g. from RecordBatchAt()) is added to
+  // that bucket's slot at each level where it has finished but is still in
+  // the ring, since those slots have already rolled up, and then to the
+  // current slot of the first level where it has not.
+  for (int level = 0; level < interval_levels_.size(); ++level) {
+    const IntervalBuckets& buckets = interval_levels_[level].buckets;
+    const int behind = buckets.BucketsBehind(now);
+    if (behind < IntervalBuckets::kNumSlots) {
+      AddToIntervalRow(data,
+                       IntervalRow::LevelSlot(level, buckets.Slot(behind)),
+                       &it->second);
+    }
+    if (behind == 0) {
       break;
     }
-    case Type::kDistribution: {
-      DataMap<Distribution>::iterator it = distribution_data_.find(tag_values);
-      if (it == distribution_data_.end()) {
-        it = distribution_data_.emplace_hint(
-            it, tag_values, Distribution(&aggregation_.bucket_boundaries()));
-      }
-      data.AddToDistribution(&it->second);
-      break;
-    }
-    case Type::kStatsObject: {
-      DataMap<IntervalStatsObject>::iterator it =
-          interval_data_.find(tag_values);
-      if (aggregation_.type() == Aggregation::Type::kDistribution) {
-        const auto& buckets = aggregation_.bucket_boundaries();
-        if (it == interval_data_.end()) {
-          it = interval_data_.emplace_hint(
-              it, std::piecewise_construct, std::make_tuple(tag_values),
-              std::make_tuple(buckets.num_buckets() + 5,
-                              aggregation_window_.duration(), now));
-        }
-        auto window = it->second.MutableCurrentBucket(now);
-        data.AddToDistribution(
-            buckets, &window[0], &window[1], &window[2], &window[3], &window[4],
-            absl::Span<double>(&window[5], buckets.num_buckets()));
-      } else {
-        if (it == interval_data_.end()) {
-          it = interval_data_.emplace_hint(
-              it, std::piecewise_construct, std::make_tuple(tag_values),
-              std::make_tuple(1, aggregation_window_.duration(), now));
-        }
-        if (aggregation_ == Aggregation::Count()) {
-          it->second.MutableCurrentBucket(now)[0] += data.count();
+  }
+}
+
+void ViewDataImpl::CountTopKValue(absl::string_view value, int64_t weight) {
+  if (value == ViewDescriptor::kOtherTagValue) {
+    return;
+  }
+  auto it = top_k_counts_.find(value);
+  if (it != top_k_counts_.end()) {
+    top_k_order_.erase({it->second, it->first});
+    it->second += weight;
+    top_k_order_.emplace(it->second, it->first);
+    return;
+  }
+  int64_t count = weight;
+  if (top_k_counts_.size() >= top_k_) {
+    // The new value inherits the evicted value's count, which bounds how
+    // often it may have been recorded while not kept.
+    const auto least = top_k_order_.begin();
+    count += least->first;
+    switch (type_) {
+      case Type::kDouble:
+        FoldRows(least->second, EmptyRow<double>(), &double_data_);
+        break;
+      case Type::kInt64:
+        FoldRows(least->second, EmptyRow<int64_t>(), &int_data_);
+        break;
+      case Type::kDistribution:
+        FoldRows(least->second, EmptyRow<Distribution>(), &distribution_data_);
+        break;
+      case Type::kExponentialHistogram:
+        FoldRows(least->second, EmptyRow<ExponentialHistogram>(),
+                 &exponential_histogram_data_);
+        break;
+      case Type::kInterval:
+        // Rejected by StatsManager::AddConsumer().
+        ABSL_ASSERT(0 && "Interval views do not support top_k.");
+        break;
+    }
+    top_k_counts_.erase(least->second);
+    top_k_order_.erase(least);
+  }
+  top_k_counts_.emplace(std::string(value), count);
+  top_k_order_.emplace(count, std::string(value));
+}
+
+void ViewDataImpl::RebuildTopK() {
+  top_k_counts_.clear();
+  top_k_order_.clear();
+  if (top_k_ == 0) {
+    return;
+  }
+  std::vector<std::string> values;
+  switch (type_) {
+    case Type::kDouble:
+      AppendColumnValues(double_data_, top_k_column_, &values);
+      break;
+    case Type::kInt64:
+      AppendColumnValues(int_data_, top_k_column_, &values);
+      break;
+    case Type::kDistribution:
+      AppendColumnValues(distribution_data_, top_k_column_, &values);
+      break;
+    case Type::kExponentialHistogram:
+      AppendColumnValues(exponential_histogram_data_, top_k_column_, &values);
+      break;
+    case Type::kInterval:
+      break;
+  }
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+  for (const std::string& value : values) {
+    CountTopKValue(value, 1);
+  }
+}
+
+template <typename DataValueT>
+void ViewDataImpl::FoldRows(absl::string_view value, const DataValueT& empty,
+                            DataMap<DataValueT>* map) {
+  // Collected first, since adding rows may rehash the map.
+  std::vector<const std::vector<std::string>*> keys;
+  for (const auto& row : *map) {
+    if (row.first[top_k_column_] == value) {
+      keys.push_back(&row.first);
+    }
+  }
+  std::vector<std::string> other_key;
+  for (const std::vector<std::string>* key : keys) {
+    other_key = *key;
+    other_key[top_k_column_] = ViewDescriptor::kOtherTagValue;
+    auto other = map->find(other_key);
+    if (other == map->end()) {
+      other = map->emplace(other_key, empty).first;
+    }
+    auto row = map->find(*key);
+    MergeRow(row->second, &other->second);
+    const auto update_time = row_update_times_.find(key);
+    if (update_time != row_update_times_.end()) {
+      MarkRowUpdated(other->first, update_time->second);
+      row_update_times_.erase(update_time);
+    }
+    map->erase(row);
+  }
+}
+
+void ViewDataImpl::MergeDistinct(
+    absl::Span<const absl::string_view> tag_values, absl::string_view value,
+    absl::Time now) {
+  ABSL_ASSERT(aggregation_.type() == Aggregation::Type::kDistinctCount);
+  end_time_ = std::max(end_time_, now);
+  DataMap<int64_t>::iterator it = FindRow(&int_data_, &tag_values);
+  if (it == int_data_.end()) {
+    it = int_data_.emplace(MakeKey(tag_values), 0).first;
+  }
+  MarkRowUpdated(it->first, now);
+  std::shared_ptr<DistinctCountSketch>& sketch =
+      distinct_sketches_[&it->first];
+  if (sketch == nullptr) {
+    sketch = std::make_shared<DistinctCountSketch>(aggregation_.precision());
+  } else if (sketch.use_count() > 1) {
+    sketch = std::make_shared<DistinctCountSketch>(*sketch);
+  }
+  sketch->Add(value);
+  it->second = sketch->Estimate();
+}
+
+void ViewDataImpl::AddToIntervalRow(const MeasureData& data, int slot,
+                                    IntervalRow* row) const {
+  switch (aggregation_.type()) {
+    case Aggregation::Type::kDistribution: {
+      const absl::Span<double> doubles = row->doubles(slot);
+      const absl::Span<uint64_t> counts = row->counts(slot);
+      data.AddToDistribution(aggregation_.bucket_boundaries(), &counts[0],
+                             &doubles[0], &doubles[1], &doubles[2],
+                             &doubles[3], counts.subspan(1));
+      break;
+    }
+    case Aggregation::Type::kCount:
+      row->counts(slot)[0] += data.count();
+      break;
+    default:
+      row->doubles(slot)[0] += data.sum();
+      break;
+  }
+}
+
+IntervalRow ViewDataImpl::MakeIntervalRow() const {
+  const int num_levels = interval_levels_.size();
+  switch (aggregation_.type()) {
+    case Aggregation::Type::kDistribution:
+      // Mean, sum of squared deviation, min, and max; count and histogram.
+      return IntervalRow(4, 1 + aggregation_.bucket_boundaries().num_buckets(),
+                         num_levels);
+    case Aggregation::Type::kCount:
+      return IntervalRow(0, 1, num_levels);
+    default:
+      return IntervalRow(1, 0, num_levels);
+  }
+}
+
+void ViewDataImpl::AdvanceIntervalLevels(absl::Time now) {
+  const bool distribution =
+      aggregation_.type() == Aggregation::Type::kDistribution;
+  // Advancing the shared clocks only touches rows when the finest crosses
+  // into a new bucket, once for all rows. A coarser level's bucket boundaries
+  // are also boundaries of each finer level's, so it can only advance if they
+  // do.
+  for (int level = 0; level < interval_levels_.size(); ++level) {
+    IntervalBuckets& buckets = interval_levels_[level].buckets;
+    const int finished_slot =
+        IntervalRow::LevelSlot(level, buckets.current_slot());
+    const int num_stale_slots = buckets.Advance(now);
+    if (num_stale_slots == 0) {
+      return;
+    }
+    // The finished bucket lies within the next level's current bucket, which
+    // has not advanced yet.
+    const bool roll_up = level + 1 < interval_levels_.size();
+    const int roll_up_slot =
+        roll_up ? IntervalRow::LevelSlot(
+                      level + 1,
+                      interval_levels_[level + 1].buckets.current_slot())
+                : 0;
+    for (auto& row : interval_data_) {
+      if (roll_up) {
+        if (distribution) {
+          row.second.AddDistributionSlot(finished_slot, roll_up_slot);
         } else {
-          it->second.MutableCurrentBucket(now)[0] += data.sum();
+          row.second.AddSlot(finished_slot, roll_up_slot);
         }
       }
-      break;
+      row.second.Clear(buckets.current_slot(), num_stale_slots, level);
+    }
+  }
+}
+
+int ViewDataImpl::FindIntervalLevel(absl::Duration window) const {
+  const absl::Duration bucket_interval =
+      IntervalBuckets::BucketInterval(window);
+  for (int level = 0; level < interval_levels_.size(); ++level) {
+    if (interval_levels_[level].buckets.bucket_interval() == bucket_interval) {
+      return level;
+    }
+  }
+  return -1;
+}
+
+bool ViewDataImpl::AddIntervalWindow(absl::Duration window, absl::Time now) {
+  ABSL_ASSERT(type_ == Type::kInterval);
+  if (FindIntervalLevel(window) >= 0) {
+    return true;
+  }
+  const absl::Duration bucket_interval =
+      IntervalBuckets::BucketInterval(window);
+  int level = 0;
+  for (const IntervalLevel& existing : interval_levels_) {
+    if (!IntervalBuckets::Nest(window, existing.window)) {
+      return false;
     }
+    if (existing.buckets.bucket_interval() < bucket_interval) {
+      ++level;
+    }
+  }
+  // Bring the existing levels up to 'now' first, so that the new level's
+  // current bucket is where finer levels' current buckets roll up to.
+  AdvanceIntervalLevels(now);
+  // IntervalBuckets are not assignable, so the levels are rebuilt.
+  std::vector<IntervalLevel> levels;
+  levels.reserve(interval_levels_.size() + 1);
+  for (int i = 0; i <= interval_levels_.size(); ++i) {
+    if (i == level) {
+      levels.emplace_back(window, now);
+    }
+    if (i < interval_levels_.size()) {
+      levels.push_back(interval_levels_[i]);
+    }
+  }
+  interval_levels_.swap(levels);
+  for (auto& row : interval_data_) {
+    row.second.InsertLevel(level);
+  }
+  return true;
+}
+
+void ViewDataImpl::ExpireRows(absl::Time now) {
+  if (row_ttl_ == absl::InfiniteDuration()) {
+    return;
+  }
+  const absl::Time cutoff = now - row_ttl_;
+  for (auto it = row_update_times_.begin(); it != row_update_times_.end();) {
+    if (it->second < cutoff) {
+      EraseRow(*it->first);
+      ++expired_rows_;
+      row_update_times_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool ViewDataImpl::HasExpiredRows(absl::Time now) const {
+  if (row_ttl_ == absl::InfiniteDuration()) {
+    return false;
+  }
+  const absl::Time cutoff = now - row_ttl_;
+  for (const auto& row : row_update_times_) {
+    if (row.second < cutoff) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::vector<std::string>* ViewDataImpl::FindKey(
+    const std::vector<std::string>& key) const {
+  switch (type_) {
+    case Type::kDouble: {
+      const auto it = double_data_.find(key);
+      return it == double_data_.end() ? nullptr : &it->first;
+    }
+    case Type::kInt64: {
+      const auto it = int_data_.find(key);
+      return it == int_data_.end() ? nullptr : &it->first;
+    }
+    case Type::kDistribution: {
+      const auto it = distribution_data_.find(key);
+      return it == distribution_data_.end() ? nullptr : &it->first;
+    }
+    case Type::kExponentialHistogram: {
+      const auto it = exponential_histogram_data_.find(key);
+      return it == exponential_histogram_data_.end() ? nullptr : &it->first;
+    }
+    case Type::kInterval: {
+      const auto it = interval_data_.find(key);
+      return it == interval_data_.end() ? nullptr : &it->first;
+    }
+  }
+  return nullptr;
+}
+
+size_t ViewDataImpl::num_rows() const {
+  switch (type_) {
+    case Type::kDouble:
+      return double_data_.size();
+    case Type::kInt64:
+      return int_data_.size();
+    case Type::kDistribution:
+      return distribution_data_.size();
+    case Type::kExponentialHistogram:
+      return exponential_histogram_data_.size();
+    case Type::kInterval:
+      return interval_data_.size();
+  }
+  return 0;
+}
+
+size_t ViewDataImpl::ApproximateBytes() const {
+  size_t bytes =
+      sizeof(*this) +
+      row_update_times_.capacity() *
+          (sizeof(*row_update_times_.begin()) + 1);
+  bytes += interval_levels_.capacity() * sizeof(IntervalLevel);
+  bytes += distinct_sketches_.capacity() *
+           (sizeof(*distinct_sketches_.begin()) + 1);
+  for (const auto& row : distinct_sketches_) {
+    bytes += sizeof(DistinctCountSketch) + row.second->HeapBytes();
+  }
+  bytes += top_k_counts_.capacity() * (sizeof(*top_k_counts_.begin()) + 1);
+  for (const auto& value : top_k_order_) {
+    // The value is held twice: here and in top_k_counts_.
+    bytes += 4 * sizeof(void*) + sizeof(value) + 2 * value.second.capacity();
+  }
+  switch (type_) {
+    case Type::kDouble:
+      return bytes + DataMapBytes(double_data_);
+    case Type::kInt64:
+      return bytes + DataMapBytes(int_data_);
+    case Type::kDistribution:
+      return bytes + DataMapBytes(distribution_data_);
+    case Type::kExponentialHistogram:
+      return bytes + DataMapBytes(exponential_histogram_data_);
+    case Type::kInterval:
+      return bytes + DataMapBytes(interval_data_);
+  }
+  return bytes;
+}
+
+void ViewDataImpl::EraseRow(const std::vector<std::string>& key) {
+  switch (type_) {
+    case Type::kDouble:
+      double_data_.erase(key);
+      break;
+    case Type::kInt64:
+      distinct_sketches_.erase(FindKey(key));
+      int_data_.erase(key);
+      break;
+    case Type::kDistribution:
+      distribution_data_.erase(key);
+      break;
+    case Type::kExponentialHistogram:
+      exponential_histogram_data_.erase(key);
+      break;
+    case Type::kInterval:
+      interval_data_.erase(key);
+      break;
   }
 }
 
@@ -253,33 +1316,35 @@ ViewDataImpl::ViewDataImpl(ViewDataImpl* source, absl::Time now)
     : aggregation_(source->aggregation_),
       aggregation_window_(source->aggregation_window_),
       type_(source->type_),
-      start_time_(source->start_time_),
-      end_time_(now) {
+      merge_(SelectMerge(type_, aggregation_)),
+      max_rows_(source->max_rows_),
+      overflow_tag_values_(source->overflow_tag_values_),
+      row_ttl_(source->row_ttl_) {
   switch (type_) {
     case Type::kDouble: {
       new (&double_data_) DataMap<double>();
-      double_data_.swap(source->double_data_);
       break;
     }
     case Type::kInt64: {
       new (&int_data_) DataMap<int64_t>();
-      int_data_.swap(source->int_data_);
       break;
     }
     case Type::kDistribution: {
       new (&distribution_data_) DataMap<Distribution>();
-      distribution_data_.swap(source->distribution_data_);
       break;
     }
-    case Type::kStatsObject: {
+    case Type::kExponentialHistogram: {
+      new (&exponential_histogram_data_) DataMap<ExponentialHistogram>();
+      break;
+    }
+    case Type::kInterval: {
       std::cerr << "GetDeltaAndReset should not be called on ViewDataImpl for "
                    "interval stats.";
       ABSL_ASSERT(0);
-      break;
+      return;
     }
   }
-  source->start_time_ = now;
-  source->end_time_ = now;
+  source->TakeDeltaAndReset(now, this);
 }
 
 }  // namespace stats
@@ -15,21 +15,31 @@
 #ifndef OPENCENSUS_STATS_INTERNAL_VIEW_DATA_IMPL_H_
 #define OPENCENSUS_STATS_INTERNAL_VIEW_DATA_IMPL_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/base/macros.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
-#include "opencensus/common/internal/stats_object.h"
+#include "absl/types/span.h"
 #include "opencensus/common/internal/string_vector_hash.h"
+#include "opencensus/common/memory_resource.h"
 #include "opencensus/stats/aggregation.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
 #include "opencensus/stats/internal/aggregation_window.h"
+#include "opencensus/stats/internal/distinct_count_sketch.h"
+#include "opencensus/stats/internal/interval_buckets.h"
 #include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -44,12 +54,24 @@ class ViewDataImpl {
  public:
   // A convenience alias for the type of the map from tags to data.
   template <typename DataValueT>
-  using DataMap = std::unordered_map<std::vector<std::string>, DataValueT,
-                                     common::StringVectorHash>;
-  // 4 is the number of buckets to group observations into (see
-  // opencensus/common/internal/stats_object.h for details)--this balances the
-  // precision of estimates against resource use.
-  typedef common::StatsObject<4> IntervalStatsObject;
+  using DataMap = absl::node_hash_map<
+      std::vector<std::string>, DataValueT, common::StringVectorHash,
+      common::StringVectorEqual,
+      common::ResourceAllocator<
+          std::pair<const std::vector<std::string>, DataValueT>,
+          common::MemorySubsystem::kStatsViews>>;
+
+  // Selects rows by tag values: a row matches if, for each (column index,
+  // value) pair, its tag value in that column is 'value'. A negative column
+  // index matches no rows.
+  typedef std::vector<std::pair<int, std::string>> RowFilter;
+  // Returns the filter selecting the rows of a view with 'descriptor' whose
+  // value for each key of 'tags' is that key's value in 'tags'. Keys that are
+  // not columns of the view match no rows.
+  static RowFilter MakeRowFilter(const ViewDescriptor& descriptor,
+                                 const opencensus::tags::TagMap& tags);
+  static bool RowMatches(const RowFilter& filter,
+                         const std::vector<std::string>& tag_values);
 
   // Constructs an empty ViewDataImpl for internal use from the descriptor. A
   // ViewData can be constructed directly from such a ViewDataImpl for
@@ -58,8 +80,13 @@ class ViewDataImpl {
   ViewDataImpl(absl::Time start_time, const ViewDescriptor& descriptor);
   // Constructs a ViewDataImpl capturing the state of 'other' at 'now'. Requires
   // 'other' to have an interval aggregation window (and thus type()
-  // kStatsObject).
-  ViewDataImpl(const ViewDataImpl& other, absl::Time now);
+  // kInterval). If 'filter' is not null, only rows matching it are captured.
+  ViewDataImpl(const ViewDataImpl& other, absl::Time now,
+               const RowFilter* filter = nullptr);
+  // As above, for the window 'window' of 'other', which must be its own or
+  // one added with AddIntervalWindow().
+  ViewDataImpl(const ViewDataImpl& other, absl::Duration window,
+               absl::Time now, const RowFilter* filter = nullptr);
 
   ViewDataImpl(const ViewDataImpl& other);
   ~ViewDataImpl();
@@ -67,6 +94,27 @@ class ViewDataImpl {
   // Returns a copy of the present state of the object and resets data() and
   // start_time().
   std::unique_ptr<ViewDataImpl> GetDeltaAndReset(absl::Time now);
+  // Like GetDeltaAndReset(), but moves the present state into '*delta',
+  // discarding its previous contents, and keeps delta's emptied storage for
+  // further data rather than allocating. 'delta' must have been constructed
+  // from the same descriptor.
+  void TakeDeltaAndReset(absl::Time now, ViewDataImpl* delta);
+
+  // Returns a copy of this holding only the rows that are absent from
+  // 'previous' or whose data differs there. Requires 'previous' to be an
+  // earlier snapshot of the same view, with the same non-interval type().
+  std::unique_ptr<ViewDataImpl> ChangedRowsSince(
+      const ViewDataImpl& previous) const;
+
+  // Returns a copy of this holding only the rows matching 'filter'. Requires a
+  // non-interval type().
+  std::unique_ptr<ViewDataImpl> MatchingRows(const RowFilter& filter) const;
+
+  // Returns the data of this aggregated over all columns but 'columns', in
+  // that order: each row of the result combines the rows of this with its
+  // values in those columns. Requires a non-interval type() and an
+  // aggregation other than LastValue.
+  std::unique_ptr<ViewDataImpl> RollUp(absl::Span<const int> columns) const;
 
   const Aggregation& aggregation() const { return aggregation_; }
   const AggregationWindow& aggregation_window() const {
@@ -77,7 +125,8 @@ class ViewDataImpl {
     kDouble,
     kInt64,
     kDistribution,
-    kStatsObject,  // Used for aggregating data, should not be exported.
+    kExponentialHistogram,
+    kInterval,  // Used for aggregating data, should not be exported.
   };
   Type type() const { return type_; }
 
@@ -98,40 +147,224 @@ class ViewDataImpl {
     ABSL_ASSERT(type_ == Type::kDistribution);
     return distribution_data_;
   }
-  const DataMap<IntervalStatsObject>& interval_data() const {
-    ABSL_ASSERT(type_ == Type::kStatsObject);
+  const DataMap<ExponentialHistogram>& exponential_histogram_data() const {
+    ABSL_ASSERT(type_ == Type::kExponentialHistogram);
+    return exponential_histogram_data_;
+  }
+  const DataMap<IntervalRow>& interval_data() const {
+    ABSL_ASSERT(type_ == Type::kInterval);
     return interval_data_;
   }
 
   absl::Time start_time() const { return start_time_; }
   absl::Time end_time() const { return end_time_; }
 
+  // The number of Merge() calls whose tag values were folded into the overflow
+  // row because the descriptor's max_rows() had been reached.
+  int64_t dropped_rows() const { return dropped_rows_; }
+  // The number of rows removed by ExpireRows().
+  int64_t expired_rows() const { return expired_rows_; }
+  // The rate at which the measure's recordings were sampled, as of the latest
+  // data merged (see ViewData::sample_one_in()).
+  uint32_t sample_one_in() const { return sample_one_in_; }
+  void set_sample_one_in(uint32_t one_in) { sample_one_in_ = one_in; }
+
+  // The number of rows in whichever map is in use.
+  size_t num_rows() const;
+  // Approximates the bytes held by this object, including its rows' tag values
+  // and data.
+  size_t ApproximateBytes() const;
+
   // Merges bulk data for the given tag values at 'now'. tag_values must be
-  // ordered according to the order of keys in the ViewDescriptor.
-  // TODO: Change to take Span<string_view> when heterogenous lookup is
-  // supported.
-  void Merge(const std::vector<std::string>& tag_values,
+  // ordered according to the order of keys in the ViewDescriptor. Only rows
+  // not already present copy the tag values. 'now' may be before earlier
+  // merges: interval views then add the data to the bucket containing 'now'
+  // while that is still kept, and drop it after, and other views add it as
+  // usual without moving end_time() back.
+  void Merge(absl::Span<const absl::string_view> tag_values,
              const MeasureData& data, absl::Time now);
+  // For DistinctCount views, adds 'value' to the sketch of the row for the
+  // given tag values at 'now', and sets the row to the sketch's estimate.
+  void MergeDistinct(absl::Span<const absl::string_view> tag_values,
+                     absl::string_view value, absl::Time now);
+
+  // Removes rows that have not been merged into for the descriptor's
+  // row_ttl() as of 'now'. Does nothing if the descriptor has no row_ttl().
+  void ExpireRows(absl::Time now);
+  // Returns true if ExpireRows(now) would remove any rows.
+  bool HasExpiredRows(absl::Time now) const;
+
+  // For interval views, adds 'window' to the windows that can be captured
+  // from this, as of 'now'. Each row keeps a ring of buckets per window, and
+  // data is added only to the finest; as each finished bucket is rolled up
+  // into the next coarser ring, adding data costs the same however many
+  // windows there are. Returns false, adding nothing, if the buckets of
+  // 'window' do not nest with those of the windows already added (see
+  // IntervalBuckets::Nest()).
+  bool AddIntervalWindow(absl::Duration window, absl::Time now);
 
  private:
-  // Implements GetDeltaAndReset(), copying aggregation_ and swapping data_ and
-  // start/end times. This is private so that it can be given a more descriptive
-  // name in the public API.
+  friend class ViewDataDecoder;  // ViewDataDecoder rebuilds decoded data.
+  friend class ViewSnapshot;     // ViewSnapshot restores saved data.
+
+  // Implements the public constructor, with 'type' overriding the type for
+  // 'descriptor' (e.g. kDouble for data decoded from an interval view).
+  ViewDataImpl(absl::Time start_time, const ViewDescriptor& descriptor,
+               Type type);
+  // Implements GetDeltaAndReset(), copying aggregation_ and taking the data and
+  // start/end times with TakeDeltaAndReset(). This is private so that it can be
+  // given a more descriptive name in the public API.
   ViewDataImpl(ViewDataImpl* source, absl::Time now);
+  // Implements ChangedRowsSince().
+  ViewDataImpl(const ViewDataImpl& current, const ViewDataImpl& previous);
+  // Implements MatchingRows().
+  ViewDataImpl(const ViewDataImpl& other, const RowFilter& filter);
+  // Implements RollUp().
+  ViewDataImpl(const ViewDataImpl& other, absl::Span<const int> columns);
+
+  // Adds the rows of 'source' into 'target' under their values in 'columns',
+  // starting rows absent from 'target' at 'empty'.
+  template <typename DataValueT>
+  static void RollUpRows(const DataMap<DataValueT>& source,
+                         absl::Span<const int> columns,
+                         const DataValueT& empty, DataMap<DataValueT>* target);
+  // Combine the data of one row into another, for RollUpRows().
+  static void MergeRow(double source, double* target) { *target += source; }
+  static void MergeRow(int64_t source, int64_t* target) { *target += source; }
+  static void MergeRow(const Distribution& source, Distribution* target);
+  static void MergeRow(const ExponentialHistogram& source,
+                       ExponentialHistogram* target);
 
   Type TypeForDescriptor(const ViewDescriptor& descriptor);
 
+  // Merge() adds data through the kernel for the view's type and aggregation,
+  // selected once by the constructors, so that merging does not switch on
+  // them. MergeRows() is the kernel for views whose rows are
+  // Kernel::Value, which adds data to a row with Kernel::Add() (see
+  // view_data_impl.cc), and MergeIntervalRows() that for interval views.
+  typedef void (ViewDataImpl::*MergeFunction)(
+      absl::Span<const absl::string_view> tag_values, const MeasureData& data,
+      absl::Time now);
+  // Returns null for a type and aggregation that cannot be merged into.
+  static MergeFunction SelectMerge(Type type, const Aggregation& aggregation);
+  template <typename Kernel>
+  void MergeRows(absl::Span<const absl::string_view> tag_values,
+                 const MeasureData& data, absl::Time now);
+  void MergeIntervalRows(absl::Span<const absl::string_view> tag_values,
+                         const MeasureData& data, absl::Time now);
+  // The map of rows, which must be the one in use, and a row with no data,
+  // for views whose rows are DataValueT.
+  template <typename DataValueT>
+  DataMap<DataValueT>* mutable_rows();
+  template <typename DataValueT>
+  DataValueT EmptyRow() const;
+  // Reserves the map of rows in use for expected_rows_.
+  void ReserveRows();
+
+  // Returns the row of 'map' for '*tag_values', or map->end() if there is none
+  // and one may be added. If the row limit has been reached, substitutes the
+  // overflow row's tag values into '*tag_values' and looks up that row.
+  template <typename DataValueT>
+  typename DataMap<DataValueT>::iterator FindRow(
+      DataMap<DataValueT>* map,
+      absl::Span<const absl::string_view>* tag_values);
+  // Records that the row with 'key' was updated at 'now', if rows expire.
+  void MarkRowUpdated(const std::vector<std::string>& key, absl::Time now);
+  // Counts 'weight' recordings of 'value' of the top-k column, first evicting
+  // the least counted value (see FoldRows()) if 'value' is new and top_k_
+  // values are already kept.
+  void CountTopKValue(absl::string_view value, int64_t weight);
+  // Rebuilds the top-k summary of data restored without it, counting each
+  // value of the top-k column once and folding away rows past top_k_ values.
+  void RebuildTopK();
+  // Folds each row of 'map' with 'value' for the top-k column into the row
+  // with kOtherTagValue there instead, starting that row at 'empty'.
+  template <typename DataValueT>
+  void FoldRows(absl::string_view value, const DataValueT& empty,
+                DataMap<DataValueT>* map);
+  // Returns an empty row with the layout for this interval view.
+  IntervalRow MakeIntervalRow() const;
+  // Adds 'data' to row slot 'slot' of 'row', an interval row of this view.
+  void AddToIntervalRow(const MeasureData& data, int slot,
+                        IntervalRow* row) const;
+  // Advances the buckets of each interval level to 'now', rolling each
+  // finished bucket up into the next level and clearing stale slots.
+  void AdvanceIntervalLevels(absl::Time now);
+  // Returns the index of the interval level for 'window', or -1.
+  int FindIntervalLevel(absl::Duration window) const;
+
+  // Returns the key of the row matching 'key' in whichever map is in use, or
+  // nullptr.
+  const std::vector<std::string>* FindKey(
+      const std::vector<std::string>& key) const;
+  // Removes the row with 'key' from whichever map is in use.
+  void EraseRow(const std::vector<std::string>& key);
+
   const Aggregation aggregation_;
   const AggregationWindow aggregation_window_;
   const Type type_;
+  const MergeFunction merge_;
   union {
     DataMap<double> double_data_;
     DataMap<int64_t> int_data_;
     DataMap<Distribution> distribution_data_;
-    DataMap<IntervalStatsObject> interval_data_;
+    DataMap<ExponentialHistogram> exponential_histogram_data_;
+    DataMap<IntervalRow> interval_data_;
   };
   absl::Time start_time_;
   absl::Time end_time_;
+
+  // If type_ is kInterval, a bucket clock for each level of interval_data_'s
+  // rows, from the finest buckets to the coarsest. Each level's buckets are
+  // made up of whole buckets of the level before, which roll up into them as
+  // they finish, so a level's data for the window ending now is its own ring
+  // plus the current bucket of each finer level.
+  struct IntervalLevel {
+    IntervalLevel(absl::Duration window, absl::Time start)
+        : window(window), buckets(window, start), start_time(start) {}
+
+    // The window the level was added for. Windows with the same bucket
+    // interval share a level.
+    absl::Duration window;
+    IntervalBuckets buckets;
+    // When the level was added, before which it has no data.
+    absl::Time start_time;
+  };
+  std::vector<IntervalLevel> interval_levels_;
+
+  // The row limit, or 0 for none.
+  const int max_rows_;
+  // If max_rows_ is set, a kOverflowTagValue for each column.
+  const std::vector<absl::string_view> overflow_tag_values_;
+  int64_t dropped_rows_ = 0;
+  // The number of rows to reserve for (see ViewDescriptor::expected_rows()),
+  // including in the maps left behind by TakeDeltaAndReset(). 0 in copies.
+  size_t expected_rows_ = 0;
+
+  // The number of values of column top_k_column_ kept, or 0 for all.
+  int top_k_ = 0;
+  int top_k_column_ = -1;
+  // If top_k_ is set, the space-saving summary of that column's values: each
+  // kept value's count of recordings (including those of the values it
+  // displaced, so an overestimate), and the same ordered by count.
+  absl::flat_hash_map<std::string, int64_t> top_k_counts_;
+  std::set<std::pair<int64_t, std::string>> top_k_order_;
+
+  const absl::Duration row_ttl_;
+  // If row_ttl_ is finite, the last update time of each row, keyed by the
+  // address of the row's key (which is stable in a node_hash_map). Copies
+  // rebuild it with the addresses of their own keys.
+  absl::flat_hash_map<const std::vector<std::string>*, absl::Time>
+      row_update_times_;
+  int64_t expired_rows_ = 0;
+  uint32_t sample_one_in_ = 1;
+
+  // For DistinctCount views, the sketch behind each row of int_data_, keyed
+  // like row_update_times_. Copies share sketches, and MergeDistinct() copies
+  // a shared sketch before adding to it.
+  absl::flat_hash_map<const std::vector<std::string>*,
+                      std::shared_ptr<DistinctCountSketch>>
+      distinct_sketches_;
 };
 
 }  // namespace stats
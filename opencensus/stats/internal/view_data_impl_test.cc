@@ -14,8 +14,14 @@
 
 #include "opencensus/stats/internal/view_data_impl.h"
 
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -26,6 +32,8 @@
 #include "opencensus/stats/internal/set_aggregation_window.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -37,7 +45,17 @@ void AddToViewDataImpl(double value, const std::vector<std::string>& tags,
                        ViewDataImpl* data) {
   MeasureData measure_data = MeasureData(boundaries);
   measure_data.Add(value);
-  data->Merge(tags, measure_data, time);
+  const std::vector<absl::string_view> tag_values(tags.begin(), tags.end());
+  data->Merge(tag_values, measure_data, time);
+}
+
+void AddInt64ToViewDataImpl(int64_t value,
+                            const std::vector<std::string>& tags,
+                            absl::Time time, ViewDataImpl* data) {
+  MeasureData measure_data = MeasureData({});
+  measure_data.AddInt64(value);
+  const std::vector<absl::string_view> tag_values(tags.begin(), tags.end());
+  data->Merge(tag_values, measure_data, time);
 }
 
 TEST(ViewDataImplTest, Sum) {
@@ -83,6 +101,183 @@ TEST(ViewDataImplTest, Count) {
                                               ::testing::Pair(tags2, 1)));
 }
 
+TEST(ViewDataImplTest, MaxRows) {
+  const absl::Time time = absl::UnixEpoch();
+  const auto descriptor = ViewDescriptor()
+                              .set_aggregation(Aggregation::Sum())
+                              .add_column(tags::TagKey::Register("k1"))
+                              .add_column(tags::TagKey::Register("k2"))
+                              .set_max_rows(2);
+  ViewDataImpl data(time, descriptor);
+  const std::vector<std::string> tags1({"value1", "value2a"});
+  const std::vector<std::string> tags2({"value1", "value2b"});
+  const std::vector<std::string> tags3({"value1", "value2c"});
+  const std::vector<std::string> tags4({"value1", "value2d"});
+  const std::vector<std::string> overflow(
+      {ViewDescriptor::kOverflowTagValue, ViewDescriptor::kOverflowTagValue});
+
+  AddToViewDataImpl(1, tags1, time, {}, &data);
+  AddToViewDataImpl(2, tags2, time, {}, &data);
+  AddToViewDataImpl(4, tags3, time, {}, &data);
+  AddToViewDataImpl(8, tags4, time, {}, &data);
+  // Existing rows are still updated once the limit is reached.
+  AddToViewDataImpl(16, tags1, time, {}, &data);
+
+  EXPECT_THAT(data.double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags1, 17),
+                                              ::testing::Pair(tags2, 2),
+                                              ::testing::Pair(overflow, 12)));
+  EXPECT_EQ(2, data.dropped_rows());
+
+  const auto delta = data.GetDeltaAndReset(time);
+  EXPECT_EQ(2, delta->dropped_rows());
+  EXPECT_EQ(0, data.dropped_rows());
+  AddToViewDataImpl(1, tags3, time, {}, &data);
+  EXPECT_THAT(data.double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags3, 1)));
+}
+
+TEST(ViewDataImplTest, TopK) {
+  const absl::Time time = absl::UnixEpoch();
+  const tags::TagKey key = tags::TagKey::Register("k2");
+  const auto descriptor = ViewDescriptor()
+                              .set_aggregation(Aggregation::Sum())
+                              .add_column(tags::TagKey::Register("k1"))
+                              .add_column(key)
+                              .set_top_k(key, 2);
+  ViewDataImpl data(time, descriptor);
+  const std::string other = ViewDescriptor::kOtherTagValue;
+
+  AddToViewDataImpl(1, {"a", "x"}, time, {}, &data);
+  AddToViewDataImpl(2, {"b", "x"}, time, {}, &data);
+  AddToViewDataImpl(4, {"a", "y"}, time, {}, &data);
+  AddToViewDataImpl(1, {"a", "x"}, time, {}, &data);
+  // "z" displaces "y", the least recorded value, and takes its count of 1.
+  AddToViewDataImpl(8, {"a", "z"}, time, {}, &data);
+  EXPECT_THAT(data.double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a", "x"), 2),
+                  ::testing::Pair(::testing::ElementsAre("b", "x"), 2),
+                  ::testing::Pair(::testing::ElementsAre("a", other), 4),
+                  ::testing::Pair(::testing::ElementsAre("a", "z"), 8)));
+
+  // With a count of 2, "z" is now the least recorded value.
+  AddToViewDataImpl(16, {"b", "w"}, time, {}, &data);
+  EXPECT_THAT(data.double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a", "x"), 2),
+                  ::testing::Pair(::testing::ElementsAre("b", "x"), 2),
+                  ::testing::Pair(::testing::ElementsAre("a", other), 12),
+                  ::testing::Pair(::testing::ElementsAre("b", "w"), 16)));
+}
+
+TEST(ViewDataImplTest, TakeDeltaAndReset) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const absl::Time time1 = start_time + absl::Seconds(1);
+  const absl::Time time2 = start_time + absl::Seconds(2);
+  const auto descriptor = ViewDescriptor()
+                              .set_aggregation(Aggregation::Sum())
+                              .add_column(tags::TagKey::Register("k1"));
+  ViewDataImpl data(start_time, descriptor);
+  ViewDataImpl delta(start_time, descriptor);
+  const std::vector<std::string> tags1({"value1"});
+  const std::vector<std::string> tags2({"value2"});
+
+  AddToViewDataImpl(1, tags1, start_time, {}, &data);
+  data.TakeDeltaAndReset(time1, &delta);
+  EXPECT_EQ(start_time, delta.start_time());
+  EXPECT_EQ(time1, delta.end_time());
+  EXPECT_THAT(delta.double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1)));
+  EXPECT_EQ(time1, data.start_time());
+  EXPECT_TRUE(data.double_data().empty());
+
+  // The previous delta's contents are discarded.
+  AddToViewDataImpl(2, tags2, time1, {}, &data);
+  data.TakeDeltaAndReset(time2, &delta);
+  EXPECT_EQ(time1, delta.start_time());
+  EXPECT_EQ(time2, delta.end_time());
+  EXPECT_THAT(delta.double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags2, 2)));
+  EXPECT_TRUE(data.double_data().empty());
+}
+
+TEST(ViewDataImplTest, MatchingRows) {
+  const absl::Time time = absl::UnixEpoch();
+  const auto key1 = tags::TagKey::Register("k1");
+  const auto key2 = tags::TagKey::Register("k2");
+  const auto descriptor = ViewDescriptor()
+                              .set_aggregation(Aggregation::Sum())
+                              .add_column(key1)
+                              .add_column(key2);
+  ViewDataImpl data(time, descriptor);
+  const std::vector<std::string> tags1({"value1", "value2a"});
+  const std::vector<std::string> tags2({"value1", "value2b"});
+  const std::vector<std::string> tags3({"value3", "value2a"});
+  AddToViewDataImpl(1, tags1, time, {}, &data);
+  AddToViewDataImpl(2, tags2, time, {}, &data);
+  AddToViewDataImpl(3, tags3, time, {}, &data);
+
+  EXPECT_THAT(
+      data.MatchingRows(ViewDataImpl::MakeRowFilter(descriptor, {}))
+          ->double_data(),
+      ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1),
+                                      ::testing::Pair(tags2, 2),
+                                      ::testing::Pair(tags3, 3)));
+  EXPECT_THAT(data.MatchingRows(ViewDataImpl::MakeRowFilter(
+                                    descriptor, {{key1, "value1"}}))
+                  ->double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1),
+                                              ::testing::Pair(tags2, 2)));
+  EXPECT_THAT(data.MatchingRows(ViewDataImpl::MakeRowFilter(
+                                    descriptor, {{key2, "value2a"}}))
+                  ->double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1),
+                                              ::testing::Pair(tags3, 3)));
+  EXPECT_THAT(
+      data.MatchingRows(ViewDataImpl::MakeRowFilter(
+                            descriptor, {{key1, "value1"}, {key2, "value2a"}}))
+          ->double_data(),
+      ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1)));
+  // Keys that are not columns match no rows.
+  EXPECT_TRUE(data.MatchingRows(ViewDataImpl::MakeRowFilter(
+                                    descriptor,
+                                    {{tags::TagKey::Register("k3"), "v"}}))
+                  ->double_data()
+                  .empty());
+}
+
+TEST(ViewDataImplTest, RowTtl) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const auto descriptor = ViewDescriptor()
+                              .set_aggregation(Aggregation::Count())
+                              .add_column(tags::TagKey::Register("k1"))
+                              .set_row_ttl(absl::Seconds(10));
+  ViewDataImpl data(start_time, descriptor);
+  const std::vector<std::string> tags1({"value1"});
+  const std::vector<std::string> tags2({"value2"});
+
+  AddToViewDataImpl(1, tags1, start_time, {}, &data);
+  AddToViewDataImpl(1, tags2, start_time, {}, &data);
+  AddToViewDataImpl(1, tags2, start_time + absl::Seconds(5), {}, &data);
+  data.ExpireRows(start_time + absl::Seconds(10));
+  EXPECT_EQ(2, data.int_data().size());
+  EXPECT_EQ(0, data.expired_rows());
+
+  data.ExpireRows(start_time + absl::Seconds(12));
+  EXPECT_THAT(data.int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags2, 2)));
+  EXPECT_EQ(1, data.expired_rows());
+
+  // An expired row starts again from zero.
+  AddToViewDataImpl(1, tags1, start_time + absl::Seconds(12), {}, &data);
+  data.ExpireRows(start_time + absl::Seconds(20));
+  EXPECT_THAT(data.int_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1)));
+  EXPECT_EQ(2, data.expired_rows());
+  EXPECT_EQ(2, ViewDataImpl(data).expired_rows());
+}
+
 TEST(ViewDataImplTest, Distribution) {
   const absl::Time start_time = absl::UnixEpoch();
   const absl::Time end_time = absl::UnixEpoch() + absl::Seconds(1);
@@ -145,9 +340,9 @@ TEST(ViewDataImplTest, LastValueInt64) {
   const std::vector<std::string> tags1({"value1", "value2a"});
   const std::vector<std::string> tags2({"value1", "value2b"});
 
-  AddToViewDataImpl(1, tags1, start_time, {}, &data);
-  AddToViewDataImpl(5, tags1, end_time, {}, &data);
-  AddToViewDataImpl(15, tags2, end_time, {}, &data);
+  AddInt64ToViewDataImpl(1, tags1, start_time, &data);
+  AddInt64ToViewDataImpl(5, tags1, end_time, &data);
+  AddInt64ToViewDataImpl(15, tags2, end_time, &data);
 
   EXPECT_EQ(Aggregation::LastValue(), data.aggregation());
   EXPECT_EQ(AggregationWindow::Cumulative(), data.aggregation_window());
@@ -158,7 +353,73 @@ TEST(ViewDataImplTest, LastValueInt64) {
                                               ::testing::Pair(tags2, 15)));
 }
 
-TEST(ViewDataImplTest, StatsObjectToCount) {
+TEST(ViewDataImplTest, SumInt64IsExact) {
+  const absl::Time time = absl::UnixEpoch();
+  const std::string measure_name = "sum_int_exact";
+  MeasureInt64::Register(measure_name, "", "");
+  const auto descriptor = ViewDescriptor()
+                              .set_measure(measure_name)
+                              .set_aggregation(Aggregation::Sum());
+  ViewDataImpl data(time, descriptor);
+  const std::vector<std::string> tags({"value"});
+  // 2^53 + 1 is not representable as a double.
+  const int64_t large = (int64_t{1} << 53) + 1;
+  AddInt64ToViewDataImpl(large, tags, time, &data);
+  AddInt64ToViewDataImpl(2, tags, time, &data);
+  EXPECT_THAT(data.int_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, large + 2)));
+}
+
+TEST(ViewDataImplTest, RollUp) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const auto descriptor = ViewDescriptor().set_aggregation(Aggregation::Sum());
+  ViewDataImpl data(start_time, descriptor);
+  AddToViewDataImpl(1, {"a", "x"}, start_time, {}, &data);
+  AddToViewDataImpl(2, {"a", "y"}, start_time, {}, &data);
+  AddToViewDataImpl(4, {"b", "x"}, start_time, {}, &data);
+
+  const std::unique_ptr<ViewDataImpl> first = data.RollUp({0});
+  EXPECT_EQ(Aggregation::Sum(), first->aggregation());
+  EXPECT_EQ(start_time, first->start_time());
+  EXPECT_THAT(first->double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("a"), 3),
+                  ::testing::Pair(::testing::ElementsAre("b"), 4)));
+  const std::unique_ptr<ViewDataImpl> reordered = data.RollUp({1, 0});
+  EXPECT_THAT(reordered->double_data(),
+              ::testing::UnorderedElementsAre(
+                  ::testing::Pair(::testing::ElementsAre("x", "a"), 1),
+                  ::testing::Pair(::testing::ElementsAre("y", "a"), 2),
+                  ::testing::Pair(::testing::ElementsAre("x", "b"), 4)));
+  const std::unique_ptr<ViewDataImpl> total = data.RollUp({});
+  EXPECT_THAT(total->double_data(),
+              ::testing::ElementsAre(
+                  ::testing::Pair(::testing::IsEmpty(), 7)));
+}
+
+TEST(ViewDataImplTest, RollUpDistribution) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const BucketBoundaries buckets = BucketBoundaries::Explicit({2});
+  const auto descriptor =
+      ViewDescriptor().set_aggregation(Aggregation::Distribution(buckets));
+  ViewDataImpl data(start_time, descriptor);
+  AddToViewDataImpl(1, {"a", "x"}, start_time, {buckets}, &data);
+  AddToViewDataImpl(3, {"a", "y"}, start_time, {buckets}, &data);
+  AddToViewDataImpl(5, {"a", "y"}, start_time, {buckets}, &data);
+
+  const std::unique_ptr<ViewDataImpl> rollup = data.RollUp({0});
+  ASSERT_EQ(1, rollup->distribution_data().size());
+  const Distribution& distribution =
+      rollup->distribution_data().begin()->second;
+  EXPECT_EQ(3, distribution.count());
+  EXPECT_DOUBLE_EQ(3, distribution.mean());
+  EXPECT_DOUBLE_EQ(8, distribution.sum_of_squared_deviation());
+  EXPECT_EQ(1, distribution.min());
+  EXPECT_EQ(5, distribution.max());
+  EXPECT_THAT(distribution.bucket_counts(), ::testing::ElementsAre(1, 2));
+}
+
+TEST(ViewDataImplTest, IntervalToCount) {
   const absl::Duration interval = absl::Minutes(1);
   const absl::Time start_time = absl::UnixEpoch();
   absl::Time time = start_time;
@@ -191,9 +452,14 @@ TEST(ViewDataImplTest, StatsObjectToCount) {
   EXPECT_THAT(export_data2.double_data(),
               ::testing::UnorderedElementsAre(::testing::Pair(tags1, 1),
                                               ::testing::Pair(tags2, 0)));
+
+  const ViewDataImpl::RowFilter filter = {{1, "value2b"}};
+  const ViewDataImpl filtered_data(data, time, &filter);
+  EXPECT_THAT(filtered_data.double_data(),
+              ::testing::UnorderedElementsAre(::testing::Pair(tags2, 0)));
 }
 
-TEST(ViewDataImplTest, StatsObjectToSum) {
+TEST(ViewDataImplTest, IntervalToSum) {
   const absl::Duration interval = absl::Minutes(1);
   const absl::Time start_time = absl::UnixEpoch();
   absl::Time time = start_time;
@@ -228,7 +494,7 @@ TEST(ViewDataImplTest, StatsObjectToSum) {
                                               ::testing::Pair(tags2, 0)));
 }
 
-TEST(ViewDataImplTest, StatsObjectToDistribution) {
+TEST(ViewDataImplTest, IntervalToDistribution) {
   const absl::Duration interval = absl::Minutes(1);
   const absl::Time start_time = absl::UnixEpoch();
   absl::Time time = start_time;
@@ -293,6 +559,139 @@ TEST(ViewDataImplTest, StatsObjectToDistribution) {
   EXPECT_THAT(distribution_2_2.bucket_counts(), ::testing::ElementsAre(0, 0));
 }
 
+TEST(ViewDataImplTest, IntervalWindowsShareRows) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const auto descriptor = ViewDescriptor().set_aggregation(Aggregation::Count());
+  auto minute_descriptor = descriptor;
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(1)),
+                       &minute_descriptor);
+  ViewDataImpl data(start_time, minute_descriptor);
+  EXPECT_TRUE(data.AddIntervalWindow(absl::Minutes(10), start_time));
+  EXPECT_TRUE(data.AddIntervalWindow(absl::Minutes(10), start_time));
+  // 22.5-second buckets do not nest with 15-second ones.
+  EXPECT_FALSE(data.AddIntervalWindow(absl::Seconds(90), start_time));
+  const std::vector<std::string> tags({"value"});
+
+  AddToViewDataImpl(1, tags, start_time, {}, &data);
+  AddToViewDataImpl(1, tags, start_time + absl::Seconds(30), {}, &data);
+  AddToViewDataImpl(1, tags, start_time + absl::Seconds(35), {}, &data);
+  AddToViewDataImpl(1, tags, start_time + absl::Seconds(200), {}, &data);
+
+  const absl::Time time = start_time + absl::Seconds(200);
+  const ViewDataImpl minute(data, absl::Minutes(1), time);
+  EXPECT_EQ(AggregationWindow::Interval(absl::Minutes(1)),
+            minute.aggregation_window());
+  EXPECT_EQ(time - absl::Minutes(1), minute.start_time());
+  EXPECT_THAT(minute.double_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, 1)));
+  const ViewDataImpl ten_minutes(data, absl::Minutes(10), time);
+  EXPECT_EQ(AggregationWindow::Interval(absl::Minutes(10)),
+            ten_minutes.aggregation_window());
+  EXPECT_EQ(start_time, ten_minutes.start_time());
+  EXPECT_THAT(ten_minutes.double_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, 4)));
+  // The 10-minute window interpolates the oldest bucket, [0s, 150s), as a
+  // separate 10-minute view would.
+  const ViewDataImpl later(data, absl::Minutes(10),
+                           start_time + absl::Seconds(700));
+  EXPECT_THAT(later.double_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, 2)));
+}
+
+TEST(ViewDataImplTest, IntervalWindowsMatchSeparateViews) {
+  const absl::Time start_time = absl::UnixEpoch();
+  const BucketBoundaries buckets = BucketBoundaries::Explicit({10});
+  const auto descriptor =
+      ViewDescriptor().set_aggregation(Aggregation::Distribution(buckets));
+  std::vector<absl::Duration> windows = {absl::Minutes(1), absl::Minutes(10),
+                                         absl::Hours(1)};
+  std::vector<std::unique_ptr<ViewDataImpl>> separate;
+  for (const absl::Duration window : windows) {
+    auto window_descriptor = descriptor;
+    SetAggregationWindow(AggregationWindow::Interval(window),
+                         &window_descriptor);
+    separate.push_back(
+        absl::make_unique<ViewDataImpl>(start_time, window_descriptor));
+  }
+  auto shared_descriptor = descriptor;
+  SetAggregationWindow(AggregationWindow::Interval(windows[1]),
+                       &shared_descriptor);
+  ViewDataImpl shared(start_time, shared_descriptor);
+  EXPECT_TRUE(shared.AddIntervalWindow(windows[2], start_time));
+  EXPECT_TRUE(shared.AddIntervalWindow(windows[0], start_time));
+  const std::vector<std::string> tags({"value"});
+
+  const auto expect_same = [&](absl::Time time) {
+    for (int i = 0; i < windows.size(); ++i) {
+      SCOPED_TRACE(absl::FormatDuration(windows[i]));
+      const ViewDataImpl expected(*separate[i], time);
+      const ViewDataImpl actual(shared, windows[i], time);
+      ASSERT_EQ(1, actual.distribution_data().size());
+      const Distribution& expected_distribution =
+          expected.distribution_data().begin()->second;
+      const Distribution& actual_distribution =
+          actual.distribution_data().begin()->second;
+      EXPECT_EQ(expected_distribution.count(), actual_distribution.count());
+      EXPECT_NEAR(expected_distribution.mean(), actual_distribution.mean(),
+                  1e-9);
+      EXPECT_NEAR(expected_distribution.sum_of_squared_deviation(),
+                  actual_distribution.sum_of_squared_deviation(), 1e-6);
+      EXPECT_EQ(expected_distribution.min(), actual_distribution.min());
+      EXPECT_EQ(expected_distribution.max(), actual_distribution.max());
+      EXPECT_EQ(expected_distribution.bucket_counts(),
+                actual_distribution.bucket_counts());
+    }
+  };
+  absl::Time time = start_time;
+  for (int i = 0; i < 200; ++i) {
+    const double value = i % 7 * 3;
+    AddToViewDataImpl(value, tags, time, {buckets}, &shared);
+    for (auto& data : separate) {
+      AddToViewDataImpl(value, tags, time, {buckets}, data.get());
+    }
+    if (i % 40 == 39) {
+      expect_same(time);
+    }
+    time += absl::Seconds(37.5);
+  }
+}
+
+TEST(ViewDataImplTest, IntervalPastData) {
+  const absl::Time start_time = absl::UnixEpoch();
+  auto descriptor = ViewDescriptor().set_aggregation(Aggregation::Count());
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(10)),
+                       &descriptor);
+  ViewDataImpl separate(start_time, descriptor);
+  SetAggregationWindow(AggregationWindow::Interval(absl::Minutes(1)),
+                       &descriptor);
+  ViewDataImpl shared(start_time, descriptor);
+  EXPECT_TRUE(shared.AddIntervalWindow(absl::Minutes(10), start_time));
+  const std::vector<std::string> tags({"value"});
+
+  const absl::Time time = start_time + absl::Minutes(20);
+  // The present; a finished 15-second bucket, within the current 150-second
+  // one; a finished 150-second bucket; and a time before both windows.
+  for (const absl::Duration ago : {absl::ZeroDuration(), absl::Seconds(20),
+                                   absl::Minutes(5), absl::Hours(2)}) {
+    AddToViewDataImpl(1, tags, time - ago, {}, &shared);
+    AddToViewDataImpl(1, tags, time - ago, {}, &separate);
+  }
+  EXPECT_EQ(time, shared.end_time());
+  EXPECT_THAT(ViewDataImpl(shared, absl::Minutes(1), time).double_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, 2)));
+  EXPECT_THAT(ViewDataImpl(shared, absl::Minutes(10), time).double_data(),
+              ::testing::ElementsAre(::testing::Pair(tags, 3)));
+  // The shared rows roll up as a separate view would have counted the data.
+  for (const absl::Duration later :
+       {absl::Seconds(100), absl::Minutes(4), absl::Minutes(7)}) {
+    AddToViewDataImpl(1, tags, time + later, {}, &shared);
+    AddToViewDataImpl(1, tags, time + later, {}, &separate);
+    const ViewDataImpl expected(separate, time + later);
+    const ViewDataImpl actual(shared, absl::Minutes(10), time + later);
+    EXPECT_EQ(expected.double_data(), actual.double_data());
+  }
+}
+
 }  // namespace
 }  // namespace stats
 }  // namespace opencensus
@@ -39,6 +39,9 @@ namespace stats {
 // TODO: FIXME: Distinguish never-set values, and add an IsValid()
 // method checking required fields.
 
+const char ViewDescriptor::kOverflowTagValue[] = "__overflow__";
+const char ViewDescriptor::kOtherTagValue[] = "__other__";
+
 ViewDescriptor::ViewDescriptor()
     : aggregation_(Aggregation::Sum()),
       aggregation_window_(AggregationWindow::Cumulative()) {}
@@ -69,6 +72,38 @@ ViewDescriptor& ViewDescriptor::add_column(opencensus::tags::TagKey tag_key) {
   return *this;
 }
 
+ViewDescriptor& ViewDescriptor::set_max_rows(int max_rows) {
+  max_rows_ = max_rows > 0 ? max_rows : 0;
+  return *this;
+}
+
+ViewDescriptor& ViewDescriptor::set_expected_rows(int rows) {
+  expected_rows_ = rows > 0 ? rows : 0;
+  return *this;
+}
+
+ViewDescriptor& ViewDescriptor::set_top_k(opencensus::tags::TagKey column,
+                                          int k) {
+  if (k > 0) {
+    top_k_ = k;
+    top_k_column_ = column;
+  } else {
+    top_k_ = 0;
+    top_k_column_.reset();
+  }
+  return *this;
+}
+
+ViewDescriptor& ViewDescriptor::set_row_ttl(absl::Duration ttl) {
+  row_ttl_ = ttl > absl::ZeroDuration() ? ttl : absl::InfiniteDuration();
+  return *this;
+}
+
+ViewDescriptor& ViewDescriptor::set_rollup(bool rollup) {
+  rollup_ = rollup;
+  return *this;
+}
+
 ViewDescriptor& ViewDescriptor::set_description(absl::string_view description) {
   description_ = std::string(description);
   return *this;
@@ -93,14 +128,24 @@ std::string ViewDescriptor::DebugString() const {
                     [](std::string* out, opencensus::tags::TagKey key) {
                       return out->append(key.name());
                     }),
-      "\n  description: \"", description_, "\"");
+      max_rows_ > 0 ? absl::StrCat("\n  max rows: ", max_rows_) : "",
+      top_k_ > 0 ? absl::StrCat("\n  top ", top_k_, " of: ",
+                                top_k_column_->name())
+                 : "",
+      row_ttl_ != absl::InfiniteDuration()
+          ? absl::StrCat("\n  row ttl: ", absl::FormatDuration(row_ttl_))
+          : "",
+      rollup_ ? "\n  rollup" : "", "\n  description: \"", description_, "\"");
 }
 
 bool ViewDescriptor::operator==(const ViewDescriptor& other) const {
   return name_ == other.name_ && measure_id_ == other.measure_id_ &&
          aggregation_ == other.aggregation_ &&
          aggregation_window_ == other.aggregation_window_ &&
-         columns_ == other.columns_ && description_ == other.description_;
+         columns_ == other.columns_ && max_rows_ == other.max_rows_ &&
+         top_k_ == other.top_k_ && top_k_column_ == other.top_k_column_ &&
+         row_ttl_ == other.row_ttl_ && rollup_ == other.rollup_ &&
+         description_ == other.description_;
 }
 
 }  // namespace stats
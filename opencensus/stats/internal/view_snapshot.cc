@@ -0,0 +1,321 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/view_snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/internal/aggregation_window.h"
+#include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+namespace {
+
+constexpr char kMagic[] = "ocviews1";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+
+template <typename T>
+void Put(T value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(absl::string_view value, std::string* out) {
+  Put<uint32_t>(value.size(), out);
+  out->append(value.data(), value.size());
+}
+
+void PutCounts(const std::vector<uint64_t>& counts, std::string* out) {
+  Put<uint32_t>(counts.size(), out);
+  out->append(reinterpret_cast<const char*>(counts.data()),
+              counts.size() * sizeof(uint64_t));
+}
+
+// Reads values written by Put*() from the front of 'in', failing (and reading
+// zeros) once the input runs out.
+class Reader {
+ public:
+  explicit Reader(absl::string_view in) : in_(in) {}
+
+  bool ok() const { return ok_; }
+  bool done() const { return in_.empty(); }
+
+  template <typename T>
+  T Get() {
+    T value = T();
+    if (in_.size() < sizeof(value)) {
+      ok_ = false;
+      in_ = absl::string_view();
+    } else {
+      memcpy(&value, in_.data(), sizeof(value));
+      in_.remove_prefix(sizeof(value));
+    }
+    return value;
+  }
+
+  absl::string_view GetString() {
+    const uint32_t size = Get<uint32_t>();
+    if (in_.size() < size) {
+      ok_ = false;
+      in_ = absl::string_view();
+      return absl::string_view();
+    }
+    const absl::string_view value = in_.substr(0, size);
+    in_.remove_prefix(size);
+    return value;
+  }
+
+  // Reads counts into *counts, which must hold at most 'max_size'.
+  void GetCounts(size_t max_size, std::vector<uint64_t>* counts) {
+    const uint32_t size = Get<uint32_t>();
+    if (size > max_size || in_.size() / sizeof(uint64_t) < size) {
+      ok_ = false;
+      in_ = absl::string_view();
+      return;
+    }
+    counts->resize(size);
+    memcpy(counts->data(), in_.data(), size * sizeof(uint64_t));
+    in_.remove_prefix(size * sizeof(uint64_t));
+  }
+
+ private:
+  absl::string_view in_;
+  bool ok_ = true;
+};
+
+template <typename DataValueT>
+void PutRows(const ViewData::DataMap<DataValueT>& rows,
+             void (*put_value)(const DataValueT&, std::string*),
+             std::string* out) {
+  Put<uint32_t>(rows.size(), out);
+  for (const auto& row : rows) {
+    for (const auto& tag_value : row.first) {
+      PutString(tag_value, out);
+    }
+    put_value(row.second, out);
+  }
+}
+
+void PutDouble(const double& value, std::string* out) { Put(value, out); }
+
+void PutInt64(const int64_t& value, std::string* out) { Put(value, out); }
+
+}  // namespace
+
+// static
+void ViewSnapshot::Encode(
+    const std::vector<std::pair<ViewDescriptor, ViewData>>& views,
+    std::string* out) {
+  out->assign(kMagic, kMagicSize);
+  std::string data;
+  for (const auto& view : views) {
+    const ViewDescriptor& descriptor = view.first;
+    // DistinctCount rows hold only estimates, which cannot be added to.
+    if (descriptor.aggregation_window_.type() !=
+            AggregationWindow::Type::kCumulative ||
+        descriptor.aggregation().type() == Aggregation::Type::kDistinctCount) {
+      continue;
+    }
+    const ViewData& view_data = view.second;
+    data.clear();
+    Put(static_cast<uint8_t>(view_data.type()), &data);
+    Put(absl::ToUnixNanos(view_data.start_time()), &data);
+    Put(absl::ToUnixNanos(view_data.end_time()), &data);
+    switch (view_data.type()) {
+      case ViewData::Type::kDouble:
+        PutRows(view_data.double_data(), &PutDouble, &data);
+        break;
+      case ViewData::Type::kInt64:
+        PutRows(view_data.int_data(), &PutInt64, &data);
+        break;
+      case ViewData::Type::kDistribution:
+        PutRows<Distribution>(
+            view_data.distribution_data(),
+            [](const Distribution& value, std::string* out) {
+              Put(value.count(), out);
+              Put(value.mean(), out);
+              Put(value.sum_of_squared_deviation(), out);
+              Put(value.min(), out);
+              Put(value.max(), out);
+              PutCounts(value.bucket_counts(), out);
+            },
+            &data);
+        break;
+      case ViewData::Type::kExponentialHistogram:
+        PutRows<ExponentialHistogram>(
+            view_data.exponential_histogram_data(),
+            [](const ExponentialHistogram& value, std::string* out) {
+              Put(value.count(), out);
+              Put(value.sum(), out);
+              Put(value.min(), out);
+              Put(value.max(), out);
+              Put<int32_t>(value.scale(), out);
+              Put(value.zero_count(), out);
+              Put<int32_t>(value.positive_buckets().offset, out);
+              PutCounts(value.positive_buckets().counts, out);
+              Put<int32_t>(value.negative_buckets().offset, out);
+              PutCounts(value.negative_buckets().counts, out);
+            },
+            &data);
+        break;
+    }
+    PutString(descriptor.name(), out);
+    PutString(Fingerprint(descriptor), out);
+    PutString(data, out);
+  }
+}
+
+bool ViewSnapshot::Parse(absl::string_view snapshot) {
+  views_.clear();
+  if (snapshot.substr(0, kMagicSize) != absl::string_view(kMagic, kMagicSize)) {
+    return false;
+  }
+  Reader reader(snapshot.substr(kMagicSize));
+  while (!reader.done()) {
+    const absl::string_view name = reader.GetString();
+    SavedView view;
+    view.fingerprint = std::string(reader.GetString());
+    view.data = std::string(reader.GetString());
+    if (!reader.ok()) {
+      views_.clear();
+      return false;
+    }
+    views_[std::string(name)] = std::move(view);
+  }
+  return true;
+}
+
+std::unique_ptr<ViewDataImpl> ViewSnapshot::Take(
+    const ViewDescriptor& descriptor, absl::Time now) {
+  const auto it = views_.find(descriptor.name());
+  if (it == views_.end()) {
+    return nullptr;
+  }
+  const SavedView view = std::move(it->second);
+  views_.erase(it);
+  if (descriptor.aggregation_window_.type() !=
+          AggregationWindow::Type::kCumulative ||
+      view.fingerprint != Fingerprint(descriptor)) {
+    return nullptr;
+  }
+
+  Reader reader(view.data);
+  const auto type = static_cast<ViewData::Type>(reader.Get<uint8_t>());
+  const absl::Time start_time = absl::FromUnixNanos(reader.Get<int64_t>());
+  const absl::Time end_time = absl::FromUnixNanos(reader.Get<int64_t>());
+  auto data = absl::make_unique<ViewDataImpl>(start_time, descriptor);
+  data->end_time_ = end_time;
+  if (!reader.ok() ||
+      static_cast<int>(type) != static_cast<int>(data->type())) {
+    return nullptr;
+  }
+  const uint32_t num_rows = reader.Get<uint32_t>();
+  std::vector<std::string> key(descriptor.num_columns());
+  for (uint32_t i = 0; i < num_rows && reader.ok(); ++i) {
+    for (auto& tag_value : key) {
+      tag_value = std::string(reader.GetString());
+    }
+    const std::vector<std::string>* row_key = nullptr;
+    switch (data->type()) {
+      case ViewDataImpl::Type::kDouble:
+        row_key =
+            &data->double_data_.emplace(key, reader.Get<double>()).first->first;
+        break;
+      case ViewDataImpl::Type::kInt64:
+        row_key =
+            &data->int_data_.emplace(key, reader.Get<int64_t>()).first->first;
+        break;
+      case ViewDataImpl::Type::kDistribution: {
+        Distribution value(&data->aggregation_.bucket_boundaries());
+        value.count_ = reader.Get<uint64_t>();
+        value.mean_ = reader.Get<double>();
+        value.sum_of_squared_deviation_ = reader.Get<double>();
+        value.min_ = reader.Get<double>();
+        value.max_ = reader.Get<double>();
+        const size_t num_buckets = value.bucket_counts_.size();
+        reader.GetCounts(num_buckets, &value.bucket_counts_);
+        if (value.bucket_counts_.size() != num_buckets) {
+          return nullptr;
+        }
+        row_key = &data->distribution_data_.emplace(key, std::move(value))
+                       .first->first;
+        break;
+      }
+      case ViewDataImpl::Type::kExponentialHistogram: {
+        ExponentialHistogram value(data->aggregation_.max_buckets());
+        value.count_ = reader.Get<uint64_t>();
+        value.sum_ = reader.Get<double>();
+        value.min_ = reader.Get<double>();
+        value.max_ = reader.Get<double>();
+        value.scale_ = reader.Get<int32_t>();
+        value.zero_count_ = reader.Get<uint64_t>();
+        value.positive_.offset = reader.Get<int32_t>();
+        reader.GetCounts(value.max_buckets_, &value.positive_.counts);
+        value.negative_.offset = reader.Get<int32_t>();
+        reader.GetCounts(value.max_buckets_, &value.negative_.counts);
+        if (value.scale_ < ExponentialHistogram::kMinScale ||
+            value.scale_ > ExponentialHistogram::kMaxScale) {
+          return nullptr;
+        }
+        row_key =
+            &data->exponential_histogram_data_.emplace(key, std::move(value))
+                 .first->first;
+        break;
+      }
+      case ViewDataImpl::Type::kInterval:
+        return nullptr;
+    }
+    data->MarkRowUpdated(*row_key, now);
+  }
+  if (!reader.ok() || !reader.done()) {
+    return nullptr;
+  }
+  data->RebuildTopK();
+  return data;
+}
+
+// static
+std::string ViewSnapshot::Fingerprint(const ViewDescriptor& descriptor) {
+  std::string fingerprint =
+      absl::StrCat(descriptor.measure_descriptor().name(), "\n",
+                   descriptor.aggregation().DebugString(), "\n",
+                   descriptor.max_rows());
+  for (const auto& column : descriptor.columns()) {
+    absl::StrAppend(&fingerprint, "\n", column.name());
+  }
+  // Added only when set, so that older snapshots still match other views.
+  if (descriptor.top_k() > 0) {
+    absl::StrAppend(&fingerprint, "\ntop ", descriptor.top_k(), " of ",
+                    descriptor.top_k_column()->name());
+  }
+  return fingerprint;
+}
+
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,83 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_INTERNAL_VIEW_SNAPSHOT_H_
+#define OPENCENSUS_STATS_INTERNAL_VIEW_SNAPSHOT_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/internal/view_data_impl.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+// ViewSnapshot encodes the data of cumulative views in a compact binary
+// format, for persisting it across restarts (see
+// StatsConfig::EnablePersistence()), and holds the views decoded from such a
+// snapshot until views with matching descriptors are created.
+//
+// A snapshot is a magic number followed by one record per view: the view's
+// name; a fingerprint of its measure, aggregation, row limits, and columns;
+// its data type and start and end times; and its rows, each the tag values
+// followed by the value. Integers and doubles are stored in host byte order,
+// so snapshots are not portable between architectures.
+//
+// ViewSnapshot is thread-compatible.
+class ViewSnapshot final {
+ public:
+  // Replaces *out with a snapshot of the cumulative views in 'views'; views
+  // with other aggregation windows, or with DistinctCount aggregations (whose
+  // sketches are not saved), are skipped.
+  static void Encode(
+      const std::vector<std::pair<ViewDescriptor, ViewData>>& views,
+      std::string* out);
+
+  // Replaces the views held with those in 'snapshot'. Returns false, leaving
+  // none, if the snapshot is malformed.
+  bool Parse(absl::string_view snapshot);
+
+  bool empty() const { return views_.empty(); }
+
+  // Returns the data saved for the view named descriptor.name(), as of 'now'
+  // for the purposes of row expiry, and no longer holds it. Returns nullptr if
+  // there is none, if 'descriptor' is not cumulative or differs from the saved
+  // view's in anything but its description, or if the data is malformed.
+  std::unique_ptr<ViewDataImpl> Take(const ViewDescriptor& descriptor,
+                                     absl::Time now);
+
+ private:
+  struct SavedView {
+    std::string fingerprint;
+    // The encoded data type, times, and rows.
+    std::string data;
+  };
+
+  // Identifies the parts of 'descriptor' that the saved data depends on.
+  static std::string Fingerprint(const ViewDescriptor& descriptor);
+
+  std::unordered_map<std::string, SavedView> views_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_INTERNAL_VIEW_SNAPSHOT_H_
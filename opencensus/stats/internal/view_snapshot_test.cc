@@ -0,0 +1,180 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/stats/internal/view_snapshot.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/internal/set_aggregation_window.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+
+namespace opencensus {
+namespace stats {
+namespace {
+
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+constexpr char kDoubleMeasure[] = "test/double";
+constexpr char kIntMeasure[] = "test/int";
+
+class ViewSnapshotTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    MeasureDouble::Register(kDoubleMeasure, "", "");
+    MeasureInt64::Register(kIntMeasure, "", "");
+  }
+
+  ViewDescriptor Descriptor(absl::string_view name, absl::string_view measure,
+                            const Aggregation& aggregation) {
+    return ViewDescriptor()
+        .set_name(name)
+        .set_measure(measure)
+        .set_aggregation(aggregation)
+        .add_column(key_);
+  }
+
+  const opencensus::tags::TagKey key_ =
+      opencensus::tags::TagKey::Register("key");
+  const absl::Time now_ = absl::UnixEpoch() + absl::Hours(1);
+};
+
+TEST_F(ViewSnapshotTest, RoundTrip) {
+  const auto sum = Descriptor("sum", kDoubleMeasure, Aggregation::Sum());
+  const auto count = Descriptor("count", kIntMeasure, Aggregation::Count());
+  const auto distribution = Descriptor(
+      "distribution", kDoubleMeasure,
+      Aggregation::Distribution(BucketBoundaries::Explicit({0, 10})));
+  const auto histogram = Descriptor(
+      "histogram", kDoubleMeasure, Aggregation::ExponentialHistogram(16));
+  const std::vector<std::pair<ViewDescriptor, ViewData>> views = {
+      {sum, testing::TestUtils::MakeViewData(sum, {{{"a"}, 1.5}, {{"b"}, 2}})},
+      {count, testing::TestUtils::MakeViewData(count, {{{"a"}, 1}})},
+      {distribution,
+       testing::TestUtils::MakeViewData(
+           distribution, {{{"a"}, -1}, {{"a"}, 5}, {{"a"}, 20}})},
+      {histogram,
+       testing::TestUtils::MakeViewData(histogram, {{{"a"}, 3}, {{"a"}, -7}})},
+  };
+  std::string encoded;
+  ViewSnapshot::Encode(views, &encoded);
+  ViewSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Parse(encoded));
+
+  auto data = snapshot.Take(sum, now_);
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(absl::UnixEpoch(), data->start_time());
+  EXPECT_THAT(data->double_data(),
+              UnorderedElementsAre(Pair(std::vector<std::string>{"a"}, 1.5),
+                                   Pair(std::vector<std::string>{"b"}, 2)));
+  // Each view can only be taken once.
+  EXPECT_EQ(nullptr, snapshot.Take(sum, now_));
+
+  data = snapshot.Take(count, now_);
+  ASSERT_NE(nullptr, data);
+  EXPECT_THAT(data->int_data(),
+              UnorderedElementsAre(Pair(std::vector<std::string>{"a"}, 1)));
+
+  data = snapshot.Take(distribution, now_);
+  ASSERT_NE(nullptr, data);
+  ASSERT_EQ(1, data->distribution_data().size());
+  const Distribution& restored = data->distribution_data().begin()->second;
+  const Distribution& saved =
+      views[2].second.distribution_data().begin()->second;
+  EXPECT_EQ(saved.count(), restored.count());
+  EXPECT_EQ(saved.mean(), restored.mean());
+  EXPECT_EQ(saved.sum_of_squared_deviation(),
+            restored.sum_of_squared_deviation());
+  EXPECT_EQ(-1, restored.min());
+  EXPECT_EQ(20, restored.max());
+  EXPECT_THAT(restored.bucket_counts(), ::testing::ElementsAre(1, 1, 1));
+  EXPECT_EQ(saved.DebugString(), restored.DebugString());
+
+  data = snapshot.Take(histogram, now_);
+  ASSERT_NE(nullptr, data);
+  ASSERT_EQ(1, data->exponential_histogram_data().size());
+  EXPECT_EQ(views[3]
+                .second.exponential_histogram_data()
+                .begin()
+                ->second.DebugString(),
+            data->exponential_histogram_data().begin()->second.DebugString());
+  EXPECT_TRUE(snapshot.empty());
+}
+
+TEST_F(ViewSnapshotTest, ChangedDescriptorIsNotRestored) {
+  const auto sum = Descriptor("view", kDoubleMeasure, Aggregation::Sum());
+  std::string encoded;
+  ViewSnapshot::Encode({{sum, testing::TestUtils::MakeViewData(
+                                  sum, {{{"a"}, 1}})}},
+                       &encoded);
+  ViewSnapshot snapshot;
+
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  EXPECT_EQ(nullptr,
+            snapshot.Take(Descriptor("view", kDoubleMeasure,
+                                     Aggregation::Count()),
+                          now_));
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  EXPECT_EQ(nullptr,
+            snapshot.Take(ViewDescriptor(sum).add_column(
+                              opencensus::tags::TagKey::Register("other")),
+                          now_));
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  EXPECT_EQ(nullptr, snapshot.Take(ViewDescriptor(sum).set_max_rows(10), now_));
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  auto delta = sum;
+  SetAggregationWindow(AggregationWindow::Delta(), &delta);
+  EXPECT_EQ(nullptr, snapshot.Take(delta, now_));
+
+  // Only the description may change.
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  EXPECT_NE(nullptr,
+            snapshot.Take(ViewDescriptor(sum).set_description("new"), now_));
+}
+
+TEST_F(ViewSnapshotTest, SkipsNonCumulativeViews) {
+  auto delta = Descriptor("delta", kDoubleMeasure, Aggregation::Sum());
+  SetAggregationWindow(AggregationWindow::Delta(), &delta);
+  std::string encoded;
+  ViewSnapshot::Encode({{delta, testing::TestUtils::MakeViewData(
+                                    delta, {{{"a"}, 1}})}},
+                       &encoded);
+  ViewSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Parse(encoded));
+  EXPECT_TRUE(snapshot.empty());
+}
+
+TEST_F(ViewSnapshotTest, Malformed) {
+  const auto sum = Descriptor("view", kDoubleMeasure, Aggregation::Sum());
+  std::string encoded;
+  ViewSnapshot::Encode({{sum, testing::TestUtils::MakeViewData(
+                                  sum, {{{"a"}, 1}})}},
+                       &encoded);
+  ViewSnapshot snapshot;
+  EXPECT_FALSE(snapshot.Parse("garbage"));
+  EXPECT_FALSE(snapshot.Parse(encoded.substr(0, encoded.size() - 1)));
+  EXPECT_TRUE(snapshot.empty());
+  EXPECT_TRUE(snapshot.Parse(encoded.substr(0, 8)));
+  EXPECT_TRUE(snapshot.empty());
+}
+
+}  // namespace
+}  // namespace stats
+}  // namespace opencensus
@@ -0,0 +1,45 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_KILL_SWITCH_FILE_H_
+#define OPENCENSUS_STATS_KILL_SWITCH_FILE_H_
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace stats {
+
+// Reads kill switches from the file at 'path' now and, if 'interval' is
+// positive, whenever it has changed when checked every 'interval', so that
+// operators can shed instrumentation cost by editing a file. Each line of the
+// file is one of
+//   measure <measure name>
+//   view <view name>
+//   span <span name>
+// and blank lines and lines starting with '#' are ignored. Each read replaces
+// all disabled names, as by StatsConfig::SetDisabledMeasures(),
+// StatsConfig::SetDisabledViews() and TraceConfig::SetDisabledSpanNames(); a
+// missing file disables nothing. A file that cannot be read or has another
+// kind of line is reported on stderr and ignored, keeping the previous names.
+//
+// Should be called once. Returns false if the file could not be applied now
+// or if called before.
+bool EnableKillSwitchFile(absl::string_view path,
+                          absl::Duration interval = absl::Seconds(10));
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_KILL_SWITCH_FILE_H_
@@ -75,6 +75,7 @@ class Measure final {
  private:
   friend class Measurement;
   friend class MeasureRegistryImpl;
+  friend class StatsDefinitions;
   explicit Measure(uint64_t id);
 
   const uint64_t id_;
@@ -101,6 +102,9 @@ class Measurement final {
  private:
   friend class StatsManager;
   friend class Delta;
+  friend class ActiveMeasures;
+  friend class MeasureSampling;
+  friend class MeasureRegistryImpl;
 
   const uint64_t id_;
   union {
@@ -0,0 +1,67 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_OVERHEAD_GOVERNOR_H_
+#define OPENCENSUS_STATS_OVERHEAD_GOVERNOR_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace opencensus {
+namespace stats {
+
+// OverheadGovernorParams configure EnableOverheadGovernor().
+struct OverheadGovernorParams final {
+  // The CPU the library may use, as a fraction of one CPU (e.g. 0.02 for 2%).
+  double cpu_budget = 0.02;
+
+  // How often the overhead is measured and the level adjusted.
+  absl::Duration check_interval = absl::Seconds(1);
+
+  // The highest level, at most 63.
+  int max_level = 8;
+
+  // The sampling period given to common::OverheadProfiler if it is off when
+  // the governor is enabled (see OverheadProfiler::SetSamplingPeriod()).
+  uint32_t profiler_sampling_period = 1000;
+};
+
+// Starts a governor that keeps the library's own CPU use within
+// params.cpu_budget by degrading instrumentation while it is exceeded. Every
+// params.check_interval it estimates the CPU spent by the library since the
+// last check: on the calling threads in Record(), StartSpan(), AddAttribute()
+// and Span::End(), as estimated by common::OverheadProfiler, plus that spent
+// in the library's scheduled tasks (harvests, view and span exports). Span
+// handlers running on their own threads are not counted.
+//
+// The governor has a level, initially 0. Each check over budget raises it by
+// one, up to params.max_level, and each check under half the budget lowers it
+// by one, so that it recovers once load drops without oscillating. At level L
+// the probability of the default ProbabilitySampler is halved L times (see
+// TraceConfig::SetSamplingReduction()) and harvest intervals are multiplied
+// by 2^min(L, 3), which also delays view data by up to that factor.
+//
+// Should be called once. Returns false if called before or if
+// params.check_interval is not positive.
+bool EnableOverheadGovernor(
+    const OverheadGovernorParams& params = OverheadGovernorParams());
+
+// Returns the governor's current level, or 0 if it is not enabled.
+int OverheadGovernorLevel();
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_OVERHEAD_GOVERNOR_H_
@@ -15,8 +15,14 @@
 #ifndef OPENCENSUS_STATS_RECORDING_H_
 #define OPENCENSUS_STATS_RECORDING_H_
 
+#include <cstdint>
 #include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "opencensus/stats/measure.h"
 #include "opencensus/tags/tag_map.h"
 
@@ -32,14 +38,166 @@ namespace stats {
 // integral values against MeasureInt64s, to prevent silent loss of precision.
 // If a record call fails to compile, ensure that all types match (using
 // static_cast to double or int64_t if necessary).
-void Record(std::initializer_list<Measurement> measurements);
+//
+// If the current Span is sampled, the values recorded also become exemplars of
+// the buckets of Distribution views, linking them to its trace.
+//
+// Measurements assembled at runtime can be passed as a span (e.g. of a
+// std::vector<Measurement>), recording them all with one lookup of the tags:
+//
+//   std::vector<Measurement> measurements;
+//   for (const auto& counter : counters) {
+//     measurements.push_back({counter.measure, counter.value});
+//   }
+//   Record(measurements);
+//
+// When built with OPENCENSUS_NOOP defined (see opencensus/trace/span.h), the
+// recording functions in this file are inline no-ops.
+#ifndef OPENCENSUS_NOOP
+void Record(absl::Span<const Measurement> measurements);
+#else
+inline void Record(absl::Span<const Measurement> /*measurements*/) {}
+#endif
+inline void Record(std::initializer_list<Measurement> measurements) {
+  Record(absl::Span<const Measurement>(measurements));
+}
 
 // Records a list of Measurements under the specified 'tags'. The current
 // Context's tags are ignored. e.g:
 //
 //   Record({{measure_double, 2.5}}, {{key, "value"}});
-void Record(std::initializer_list<Measurement> measurements,
-            opencensus::tags::TagMap tags);
+#ifndef OPENCENSUS_NOOP
+void Record(absl::Span<const Measurement> measurements,
+            const opencensus::tags::TagMap& tags);
+#else
+inline void Record(absl::Span<const Measurement> /*measurements*/,
+                   const opencensus::tags::TagMap& /*tags*/) {}
+#endif
+inline void Record(std::initializer_list<Measurement> measurements,
+                   const opencensus::tags::TagMap& tags) {
+  Record(absl::Span<const Measurement>(measurements), tags);
+}
+
+// Records a batch of Measurements, each group under its own TagMap. This is
+// equivalent to calling Record() for each element of 'batch', but is cheaper
+// for large batches, e.g. when a batch job finishes many work items at once:
+//
+//   std::vector<std::pair<TagMap, std::vector<Measurement>>> batch;
+//   for (const auto& item : items) {
+//     batch.emplace_back(TagMap({{key, item.type()}}),
+//                        std::vector<Measurement>({{latency, item.ms()}}));
+//   }
+//   RecordBatch(batch);
+#ifndef OPENCENSUS_NOOP
+void RecordBatch(
+    absl::Span<const std::pair<opencensus::tags::TagMap,
+                               std::vector<Measurement>>>
+        batch);
+#else
+inline void RecordBatch(
+    absl::Span<const std::pair<opencensus::tags::TagMap,
+                               std::vector<Measurement>>>
+    /*batch*/) {}
+#endif
+
+// Measurements made at 'time' under 'tags', for RecordBatchAt().
+struct TimedMeasurements {
+  absl::Time time;
+  opencensus::tags::TagMap tags;
+  std::vector<Measurement> measurements;
+};
+
+// Records a batch of Measurements as of their own times rather than the
+// present, e.g. to backfill or bulk-ingest events logged elsewhere. Elements
+// are grouped by their time truncated to the quarter second, and each group
+// is merged straight into the views before RecordBatchAt() returns, rather
+// than waiting for the next harvest.
+//
+// Interval views count data in the bucket of its time while that bucket is
+// within their window, and drop older data; bucketing is exact for windows of
+// whole seconds. Cumulative views count all data. Views added after
+// RecordBatchAt() is called do not see its data, and no exemplars are
+// recorded.
+#ifndef OPENCENSUS_NOOP
+void RecordBatchAt(absl::Span<const TimedMeasurements> batch);
+#else
+inline void RecordBatchAt(absl::Span<const TimedMeasurements> /*batch*/) {}
+#endif
+
+class BoundTags;
+
+// BoundMeasure records values against a single Measure under a fixed TagMap.
+// It caches where its data is stored, so recording through a BoundMeasure is
+// cheaper than calling Record() with the same tags repeatedly. Binding is
+// relatively expensive and should be done once per tag combination, e.g.:
+//
+//   static BoundMeasure<double>* latency = new BoundMeasure<double>(
+//       LatencyMeasure(), {{method_key, "Get"}});
+//   latency->Record(2.5);
+//
+// BoundMeasure is thread-safe.
+template <typename MeasureT>
+class BoundMeasure final {
+ public:
+  BoundMeasure(Measure<MeasureT> measure, opencensus::tags::TagMap tags);
+  ~BoundMeasure();
+
+  BoundMeasure(const BoundMeasure&) = delete;
+  BoundMeasure& operator=(const BoundMeasure&) = delete;
+
+  // Records 'value' under the bound tags. As with Record(), only floating point
+  // values may be recorded against MeasureDoubles and only integral values
+  // against MeasureInt64s.
+  template <typename T>
+  void Record(T value) const {
+#ifndef OPENCENSUS_NOOP
+    RecordMeasurement(Measurement(measure_, value));
+#else
+    // Still rejects values of the wrong type.
+    static_cast<void>(Measurement(measure_, value));
+#endif
+  }
+
+ private:
+  void RecordMeasurement(Measurement measurement) const;
+
+  const Measure<MeasureT> measure_;
+  const std::unique_ptr<BoundTags> bound_tags_;
+};
+
+extern template class BoundMeasure<double>;
+extern template class BoundMeasure<int64_t>;
+
+class CounterCells;
+
+// BoundCounter records values against an int64 Measure under a fixed TagMap,
+// for the hottest counters (e.g. requests or bytes served). Values accumulate
+// in uncontended per-shard cells with no locking and no lookup, and are
+// added to the measure's views at each harvest. e.g.:
+//
+//   static BoundCounter* requests =
+//       new BoundCounter(RequestsMeasure(), {{method_key, "Get"}});
+//   requests->Add(1);
+//
+// Count and Sum views of the measure see the values exactly. Other
+// aggregations see each harvest's values as that many values of their mean,
+// no exemplars are recorded, and the overhead profiler does not sample Add().
+//
+// BoundCounter is thread-safe.
+class BoundCounter final {
+ public:
+  BoundCounter(MeasureInt64 measure, opencensus::tags::TagMap tags);
+  // Values added since the last harvest are recorded by the next one.
+  ~BoundCounter();
+
+  BoundCounter(const BoundCounter&) = delete;
+  BoundCounter& operator=(const BoundCounter&) = delete;
+
+  void Add(int64_t value) const;
+
+ private:
+  const std::unique_ptr<CounterCells> cells_;
+};
 
 }  // namespace stats
 }  // namespace opencensus
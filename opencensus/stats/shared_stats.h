@@ -0,0 +1,94 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_SHARED_STATS_H_
+#define OPENCENSUS_STATS_SHARED_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace opencensus {
+namespace stats {
+
+struct SharedStatsOptions final {
+  // The distinct (measure, tag values) rows the region can hold, over all
+  // processes. Data for further rows is dropped and counted by
+  // SharedStats::NumDroppedRows().
+  size_t max_rows = 4096;
+  // The bytes of a row's key: the measure name and its tag keys and values,
+  // each with a 4-byte length. Rows with longer keys are dropped.
+  size_t max_key_bytes = 256;
+  // The histogram buckets a row can hold, over all the Distribution views of
+  // its measure. Measures with more buckets are shared as their count, sum
+  // and mean, which the collecting process's histograms count in the bucket of
+  // the mean.
+  size_t max_histogram_buckets = 64;
+};
+
+// SharedStats aggregates stats across the processes of a prefork server, so
+// that their data is exported once, by one process, rather than once per
+// worker:
+//
+//   // In the parent, after registering views and before forking:
+//   SharedStats::Initialize();
+//   ...fork workers...
+//   // In each worker:
+//   SharedStats::StartPublishing();
+//   // In the one process that exports (the parent or a designated child):
+//   SharedStats::StartCollecting();
+//   ...register the stats exporters...
+//
+// Processes keep recording into their own buffers, so Record() costs the
+// same. Each harvest in a publishing process adds its data to rows of counters
+// and histograms in shared memory, keyed by measure name and tag values, in
+// place of merging it into the process's views; each harvest in the
+// collecting process moves the rows' data into its views, alongside its own
+// recorded data. Views are aggregated by the collecting process, so only it
+// needs views with the aggregations to export, and the processes' data is
+// combined as if recorded in one process. Histograms are shared only for
+// measures with the same Distribution views in both processes; exemplars are
+// not shared.
+//
+// The shared memory is mapped once, by Initialize(), and its rows are never
+// freed. Its size is proportional to SharedStatsOptions, but memory is only
+// committed for rows in use.
+class SharedStats final {
+ public:
+  // Maps the shared region, which processes forked afterwards inherit.
+  // Returns false if it cannot be mapped, or if called before.
+  static bool Initialize(const SharedStatsOptions& options = {});
+
+  // Publishes this process's recorded data to the region instead of merging
+  // it into its views, and stops this process's push exports (without a
+  // final export, since its views no longer receive data). Returns false if
+  // Initialize() was not called.
+  static bool StartPublishing();
+
+  // Merges the data published to the region into this process's views, from
+  // the next harvest. Only one process may collect. Returns false if
+  // Initialize() was not called.
+  static bool StartCollecting();
+
+  // The rows of published data dropped because the region was full, a key was
+  // too long, or a row stayed locked by a process that died, over all
+  // processes.
+  static uint64_t NumDroppedRows();
+
+  SharedStats() = delete;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_SHARED_STATS_H_
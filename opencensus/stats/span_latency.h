@@ -0,0 +1,43 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_SPAN_LATENCY_H_
+#define OPENCENSUS_STATS_SPAN_LATENCY_H_
+
+namespace opencensus {
+namespace stats {
+
+// The name of the span latency measure, in milliseconds, and of its
+// Distribution view, whose columns are the span name and canonical status
+// code (e.g. "DEADLINE_EXCEEDED").
+constexpr char kSpanLatencyMeasureName[] = "opencensus.io/span/latency";
+constexpr char kSpanNameTagKey[] = "opencensus_span_name";
+constexpr char kSpanStatusTagKey[] = "opencensus_span_status";
+
+// Registers the span latency measure and view for export, and from then on
+// records the latency of each Span as it ends, measured from the start and
+// end times the Span records anyway. Each span name and status is recorded
+// through a BoundMeasure bound on first use, so ending a Span costs no tag
+// lookup or TagMap construction.
+//
+// Only Spans that record events (see Span::IsRecording()) are measured, so
+// the counts are those of the sampled Spans; use a higher sampling rate for
+// the spans whose rate matters. Calling this more than once has no further
+// effect. Thread-safe.
+void RegisterSpanLatencyViewForExport();
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_SPAN_LATENCY_H_
@@ -19,15 +19,20 @@
 // a long include list.
 #include "opencensus/stats/aggregation.h"         // IWYU pragma: export
 #include "opencensus/stats/bucket_boundaries.h"   // IWYU pragma: export
+#include "opencensus/stats/callback_gauge.h"      // IWYU pragma: export
+#include "opencensus/stats/columnar_view_data.h"  // IWYU pragma: export
 #include "opencensus/stats/measure.h"             // IWYU pragma: export
 #include "opencensus/stats/measure_descriptor.h"  // IWYU pragma: export
 #include "opencensus/stats/measure_registry.h"    // IWYU pragma: export
 #include "opencensus/stats/recording.h"           // IWYU pragma: export
+#include "opencensus/stats/stats_config.h"        // IWYU pragma: export
+#include "opencensus/stats/stats_definitions.h"   // IWYU pragma: export
 #include "opencensus/stats/stats_exporter.h"      // IWYU pragma: export
 #include "opencensus/stats/tag_key.h"             // IWYU pragma: export
 #include "opencensus/stats/tag_set.h"             // IWYU pragma: export
 #include "opencensus/stats/view.h"                // IWYU pragma: export
 #include "opencensus/stats/view_data.h"           // IWYU pragma: export
+#include "opencensus/stats/view_data_codec.h"     // IWYU pragma: export
 #include "opencensus/stats/view_descriptor.h"     // IWYU pragma: export
 
 #endif  // OPENCENSUS_STATS_STATS_H_
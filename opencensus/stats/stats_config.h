@@ -0,0 +1,180 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_STATS_CONFIG_H_
+#define OPENCENSUS_STATS_STATS_CONFIG_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace stats {
+
+// HarvestParams control how often recorded data is propagated from the
+// recording buffers to views.
+struct HarvestParams final {
+  // The regular interval between harvests.
+  absl::Duration interval = absl::Seconds(5);
+
+  // If non-zero, a harvest is started early once the number of distinct tag
+  // sets recorded since the last harvest exceeds this. This bounds the memory
+  // used by recording buffers and the length of the following merge.
+  uint64_t max_pending_tag_sets = 0;
+
+  // If greater than 'interval', the harvest interval doubles after each
+  // harvest that finds no recorded data, up to this value, and returns to
+  // 'interval' once data is recorded again. This reduces wakeups in idle
+  // processes at the cost of delaying the first data after an idle period.
+  absl::Duration max_idle_interval = absl::ZeroDuration();
+
+  // The number of threads merging each harvest into views, including the
+  // harvest thread. Measures are divided among the threads, so values above 1
+  // shorten harvests of many views and tag sets spread over several measures.
+  // Helper threads only run during merges.
+  int merge_threads = 1;
+
+  // If non-zero, each measure's data is merged in chunks of this many tag
+  // sets, releasing the measure's lock between chunks, so that reads of its
+  // views (e.g. an exporter's GetData()) wait for at most one chunk rather
+  // than the whole merge.
+  uint64_t merge_chunk_size = 0;
+
+  // With chunked merges, whether reads during a merge see each view's data
+  // either entirely before or entirely after the harvest. Cumulative and
+  // interval views return their pre-harvest data until the merge finishes,
+  // at the cost of copying it once per harvest; delta views, whose reads reset
+  // them, wait for the merge to finish. If false, reads may see part of a
+  // harvest, with the rest appearing in the next read.
+  bool consistent_merge_reads = true;
+
+  // If non-zero, the number of distinct tag sets expected per harvest
+  // interval. Recording buffers reserve room for them up front, so that the
+  // first harvests after a restart are not slowed by their hash tables
+  // growing as tag sets first appear. See also
+  // ViewDescriptor::set_expected_rows() and StatsConfig::PrewarmTagSets().
+  uint64_t expected_tag_sets = 0;
+};
+
+// The approximate memory held by the stats library, as returned by
+// StatsConfig::GetMemoryUsage().
+struct StatsMemoryUsage final {
+  struct View {
+    std::string name;
+    int64_t rows = 0;
+    int64_t bytes = 0;
+  };
+  struct Delta {
+    int64_t tag_sets = 0;
+    int64_t bytes = 0;
+  };
+
+  // The data of each view, in no particular order. A view's rows grow with the
+  // cardinality of its columns' tag values.
+  std::vector<View> views;
+  // The recording buffers: the delta being recorded into, and the emptied
+  // buffers of merged deltas, whose tag sets are kept so that recording them
+  // again does not allocate.
+  Delta active_delta;
+  Delta last_delta;
+};
+
+class StatsConfig final {
+ public:
+  // Sets the parameters used for harvesting recorded data. The new parameters
+  // take effect immediately.
+  static void SetHarvestParams(const HarvestParams& params);
+
+  // Registers views of the library's own metrics for export and starts
+  // recording them. The views, named opencensus.io/internal/..., track spans
+  // dropped before export, the span export queue depth, stats harvest lag,
+  // merge latency and tag sets per harvest, stats export latency and overruns,
+  // exporter RPC latency and errors (by the opencensus_exporter tag), and the
+  // memory usage reported by GetMemoryUsage() and
+  // TraceConfig::GetMemoryUsage() (by the opencensus_view, opencensus_delta,
+  // and opencensus_span_store tags), which is measured on each harvest and
+  // span export. Until this is called, the library records none of them.
+  // Calling it again has no effect.
+  static void RegisterInternalViewsForExport();
+
+  // Adds empty rows for 'tag_sets' to the recording buffers, so that the first
+  // recordings under them do not allocate, e.g. for tag sets known to be
+  // recorded right after a restart. Only the tags used as columns by a view
+  // are kept, so this should be called once the views are created. Rows
+  // that receive no data are dropped by the next harvest, and empty rows are
+  // never merged into views.
+  static void PrewarmTagSets(
+      const std::vector<opencensus::tags::TagMap>& tag_sets);
+
+  // Returns the approximate memory held by each view's data and by the
+  // recording buffers. Each view and buffer is locked briefly in turn, so the
+  // result is not a consistent snapshot.
+  static StatsMemoryUsage GetMemoryUsage();
+
+  // Keeps the data of cumulative views across restarts, so that counters do
+  // not reset on every deploy. The data saved in the file at 'path' by an
+  // earlier process is restored into each cumulative view created afterwards
+  // whose name, measure, aggregation, row limit, and columns are unchanged,
+  // along with its start time. Every 'interval', and on
+  // StatsExporter::Shutdown(), the data of the views registered for export is
+  // saved to 'path'. This should be called once, before the views are
+  // created. Returns false, saving nothing, if 'path' exists but cannot be
+  // read.
+  static bool EnablePersistence(absl::string_view path,
+                                absl::Duration interval = absl::Seconds(10));
+
+  // Kill switches, to shed the cost of stats under overload without a
+  // redeploy (see also EnableKillSwitchFile() in kill_switch_file.h). Each
+  // call replaces the names of the previous one, including names of measures
+  // and views created later.
+  //
+  // Values recorded for a disabled measure are dropped: Record() returns
+  // after checking a bitmap if none of its measures is recorded, without
+  // reading the tags or taking a lock. Its views keep their data.
+  static void SetDisabledMeasures(const std::vector<std::string>& names);
+
+  // Disabled views keep their data but stop merging recorded values, and a
+  // measure whose views are all disabled is not recorded, as if disabled
+  // itself. Views with the same measure, aggregation, window and columns
+  // share their data, and are disabled by the name of the first created.
+  static void SetDisabledViews(const std::vector<std::string>& names);
+
+  // Records only about 1 in N recordings of each named measure, for measures
+  // recorded so often that recording every value costs too much. Each call
+  // replaces the rates of the previous one, including those of measures
+  // created later; measures not named, or with N at most 1, record every
+  // value.
+  //
+  // Every recording path samples, by a per-thread countdown that draws a
+  // random number only for the recordings kept. The views' counts, sums and
+  // bucket counts are scaled up by N as they are merged, so they estimate the
+  // full data, and ViewData::sample_one_in() reports N. Min, max, LastValue
+  // and DistinctCount data come from the kept recordings only. A new rate
+  // applies from the next delta, though threads may record a few values at
+  // the previous one. Processes whose data is combined should sample alike.
+  static void SetMeasureSampling(
+      const std::vector<std::pair<std::string, uint32_t>>& rates);
+
+  StatsConfig() = delete;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_STATS_CONFIG_H_
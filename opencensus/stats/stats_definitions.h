@@ -0,0 +1,121 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_STATS_DEFINITIONS_H_
+#define OPENCENSUS_STATS_STATS_DEFINITIONS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "opencensus/stats/aggregation.h"
+#include "opencensus/stats/measure.h"
+#include "opencensus/stats/measure_descriptor.h"
+#include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_key.h"
+
+namespace opencensus {
+namespace stats {
+
+// MeasureDefinition and ViewDefinition are literal types, so that a library's
+// measures, tag keys, and views can be declared as constexpr arrays and
+// registered together by a StatsDefinitions. Measures, tag keys, and views are
+// referred to by their index in those arrays, typically named by an enum:
+//
+//   enum Measures { kLatency, kRequests };
+//   constexpr MeasureDefinition kMeasures[] = {
+//       {"example.com/latency", "Request latency.", "ms",
+//        MeasureDescriptor::Type::kDouble},
+//       {"example.com/requests", "Requests.", "1",
+//        MeasureDescriptor::Type::kInt64},
+//   };
+//   enum TagKeys { kMethod };
+//   constexpr const char* kTagKeys[] = {"method"};
+//   constexpr int kByMethod[] = {kMethod};
+//   constexpr ViewDefinition kViews[] = {
+//       {"example.com/latency/sum", "Total latency.", kLatency,
+//        &Aggregation::Sum, kByMethod},
+//   };
+//
+//   const StatsDefinitions& Stats() {
+//     static const StatsDefinitions* stats = [] {
+//       auto* stats = new StatsDefinitions(kMeasures, kTagKeys, kViews);
+//       stats->RegisterViewsForExport();
+//       return stats;
+//     }();
+//     return *stats;
+//   }
+//
+//   Record({{Stats().measure_double(kLatency), 12.5}},
+//          {{Stats().tag_key(kMethod), "get"}});
+struct MeasureDefinition {
+  // See Measure<MeasureT>::Register() for the meaning of the fields.
+  const char* name;
+  const char* description;
+  const char* units;
+  MeasureDescriptor::Type type;
+};
+
+struct ViewDefinition {
+  const char* name;
+  const char* description;
+  // The index of the view's measure in the StatsDefinitions' measures.
+  int measure;
+  // Returns the view's aggregation, e.g. &Aggregation::Count.
+  Aggregation (*aggregation)();
+  // The indices of the view's columns in the StatsDefinitions' tag keys.
+  absl::Span<const int> columns;
+};
+
+// StatsDefinitions registers a set of measure and tag key definitions at once,
+// and builds the descriptors of a set of view definitions. Measures are
+// registered in one batch, and the Measure, TagKey, or ViewDescriptor for a
+// definition is then a vector lookup by its constant index rather than a
+// registry lookup by name.
+//
+// StatsDefinitions is immutable, and is intended to be created once, at
+// startup, and never destroyed.
+class StatsDefinitions final {
+ public:
+  // Registers 'measures' and 'tag_keys', and builds the descriptors of 'views'.
+  // Measures whose names are already registered are invalid, as with
+  // Measure<MeasureT>::Register().
+  StatsDefinitions(absl::Span<const MeasureDefinition> measures,
+                   absl::Span<const char* const> tag_keys,
+                   absl::Span<const ViewDefinition> views);
+
+  // Returns the measure at 'index'; the measure is invalid if it failed to
+  // register or is of the other type.
+  MeasureDouble measure_double(int index) const;
+  MeasureInt64 measure_int64(int index) const;
+
+  opencensus::tags::TagKey tag_key(int index) const {
+    return tag_keys_[index];
+  }
+  const ViewDescriptor& view(int index) const { return views_[index]; }
+
+  // Registers all the views for export. Libraries defining views that their
+  // users choose to export (e.g. RPC instrumentation) can leave this to them.
+  void RegisterViewsForExport() const;
+
+ private:
+  std::vector<uint64_t> measure_ids_;
+  std::vector<opencensus::tags::TagKey> tag_keys_;
+  std::vector<ViewDescriptor> views_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_STATS_DEFINITIONS_H_
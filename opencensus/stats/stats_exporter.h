@@ -16,13 +16,17 @@
 #define OPENCENSUS_STATS_STATS_EXPORTER_H_
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "opencensus/stats/view.h"
 #include "opencensus/stats/view_data.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -44,17 +48,85 @@ class StatsExporter final {
     virtual ~Handler() = default;
     virtual void ExportViewData(
         const std::vector<std::pair<ViewDescriptor, ViewData>>& data) = 0;
+
+    // Exports data as ExportViewData() does, but shares ownership of it. The
+    // data is shared with the other handlers and never modified. The default
+    // calls ExportViewData(*data). Handlers that export asynchronously can
+    // override this to retain the data, rather than copy it, until they are
+    // done with it; ExportViewData() is then only called by this default.
+    virtual void ExportViewDataBatch(
+        std::shared_ptr<const std::vector<std::pair<ViewDescriptor, ViewData>>>
+            data) {
+      ExportViewData(*data);
+    }
+
+    // Called when a view is registered for export, and for each view already
+    // registered when the handler is, so that the handler can prepare to
+    // export it (e.g. by registering it with its backend) before its first
+    // export. Called with the exporter's lock held, so it must not block or
+    // call StatsExporter.
+    virtual void ViewAdded(const ViewDescriptor& descriptor) {}
+
+    // If this returns true, ExportViewData() is passed only the rows of
+    // cumulative views that are new or have changed since the previous export
+    // (views with no such rows are omitted), rather than every row of every
+    // view. Delta views are passed in full, since all their rows are new.
+    // This suits exporters whose backend retains the last value of each row.
+    virtual bool ExportChangedRowsOnly() const { return false; }
+
+    // How often ExportViewData() is called (at least every second). The first
+    // export comes at a random point within the first interval, so that
+    // processes started together do not export in lockstep.
+    virtual absl::Duration ExportInterval() const { return absl::Seconds(10); }
+
+    // Handlers are called concurrently, each on its own thread, with shared
+    // data. An export that has not returned after ExportDeadline() (capped at
+    // ExportInterval()) counts as an overrun; a handler that is still
+    // exporting is skipped by later exports until it returns.
+    // (In common::Scheduler's manual mode, handlers are instead called in
+    // turn on the thread running the export, and an overrun is counted when
+    // an export returns late.)
+    virtual absl::Duration ExportDeadline() const {
+      return absl::InfiniteDuration();
+    }
   };
 
-  // Registers a new handler. Every few seconds, each registered handler will be
-  // called with the present data for each registered view. This should only be
-  // called by push exporters' Register() methods.
+  // Registers a new handler. Every Handler::ExportInterval(), the handler will
+  // be called with the present data for each registered view. Data recorded
+  // before each export is flushed first, so exports do not lag behind
+  // recording. This should only be called by push exporters' Register()
+  // methods.
   static void RegisterPushHandler(std::unique_ptr<Handler> handler);
 
   // Retrieves current data for all registered views, for implementing pull
   // exporters.
   static std::vector<std::pair<ViewDescriptor, ViewData>> GetViewData();
 
+  // Retrieves current data for the registered view (or callback gauge) 'name',
+  // holding only the rows whose value for each key of 'filter' is that key's
+  // value in 'filter'; keys that are not columns of the view match no rows.
+  // Returns nullopt if there is no such view. Only the one view is read and
+  // only the matching rows are copied, so this suits frequent reads of a few
+  // rows, e.g. by health checks:
+  //
+  //   auto data = StatsExporter::GetViewData("example.com/errors",
+  //                                          {{method_key, "Get"}});
+  static absl::optional<std::pair<ViewDescriptor, ViewData>> GetViewData(
+      absl::string_view name, const opencensus::tags::TagMap& filter = {});
+
+  // Returns the names of all registered views and callback gauges, sorted, so
+  // that pull exporters can page through them and read one view at a time
+  // with GetViewData(name).
+  static std::vector<std::string> GetViewNames();
+
+  // Stops periodic exports and runs one final export for each push handler,
+  // of all data recorded before the call, due by 'deadline'. A handler still
+  // busy with an earlier export is waited for until 'deadline'. Returns true
+  // if every handler finished its final export in time. Recording and
+  // GetViewData() keep working, so pull exporters are unaffected; push exports
+  // cannot be restarted, but later calls run another final export.
+  static bool Shutdown(absl::Time deadline);
+
  private:
   friend class StatsExporterTest;
 
@@ -14,12 +14,15 @@
 
 #include "opencensus/stats/testing/test_utils.h"
 
+#include <cstdint>
 #include <initializer_list>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/internal/delta_producer.h"
@@ -33,15 +36,40 @@ namespace testing {
 ViewData TestUtils::MakeViewData(
     const ViewDescriptor& descriptor,
     std::initializer_list<std::pair<std::vector<std::string>, double>> values) {
+  return MakeViewData(descriptor, values, nullptr);
+}
+
+// static
+ViewData TestUtils::MakeViewDataWithExemplars(
+    const ViewDescriptor& descriptor,
+    std::initializer_list<std::pair<std::vector<std::string>, double>> values,
+    const opencensus::trace::SpanContext& span_context, absl::Time timestamp) {
+  const ExemplarAttachment attachment{span_context, timestamp};
+  return MakeViewData(descriptor, values, &attachment);
+}
+
+// static
+ViewData TestUtils::MakeViewData(
+    const ViewDescriptor& descriptor,
+    std::initializer_list<std::pair<std::vector<std::string>, double>> values,
+    const ExemplarAttachment* attachment) {
   auto impl = absl::make_unique<ViewDataImpl>(absl::UnixEpoch(), descriptor);
   std::vector<BucketBoundaries> boundaries = {
       descriptor.aggregation().bucket_boundaries()};
   for (const auto& value : values) {
-    MeasureData measure_data = MeasureData(boundaries);
-    measure_data.Add(value.second);
-    impl->Merge(value.first, measure_data, absl::UnixEpoch());
+    MeasureData measure_data =
+        MeasureData(boundaries, descriptor.aggregation().max_buckets());
+    if (descriptor.measure_descriptor().type() ==
+        MeasureDescriptor::Type::kInt64) {
+      measure_data.AddInt64(static_cast<int64_t>(value.second), attachment);
+    } else {
+      measure_data.Add(value.second, attachment);
+    }
+    const std::vector<absl::string_view> tag_values(value.first.begin(),
+                                                    value.first.end());
+    impl->Merge(tag_values, measure_data, absl::UnixEpoch());
   }
-  if (impl->type() == ViewDataImpl::Type::kStatsObject) {
+  if (impl->type() == ViewDataImpl::Type::kInterval) {
     return ViewData(absl::make_unique<ViewDataImpl>(*impl, absl::UnixEpoch()));
   } else {
     return ViewData(std::move(impl));
@@ -58,6 +86,23 @@ void TestUtils::AddToDistribution(Distribution* distribution, double value) {
   distribution->Add(value);
 }
 
+// static
+ExponentialHistogram TestUtils::MakeExponentialHistogram(int max_buckets) {
+  return ExponentialHistogram(max_buckets);
+}
+
+// static
+void TestUtils::AddToExponentialHistogram(ExponentialHistogram* histogram,
+                                          double value) {
+  histogram->Add(value);
+}
+
+// static
+void TestUtils::MergeExponentialHistogram(const ExponentialHistogram& source,
+                                          ExponentialHistogram* destination) {
+  destination->Merge(source);
+}
+
 // static
 void TestUtils::Flush() { DeltaProducer::Get()->Flush(); }
 
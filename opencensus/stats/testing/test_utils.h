@@ -20,10 +20,14 @@
 #include <utility>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "opencensus/stats/bucket_boundaries.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
+#include "opencensus/stats/internal/measure_data.h"
 #include "opencensus/stats/internal/view_data_impl.h"
 #include "opencensus/stats/view_data.h"
+#include "opencensus/trace/span_context.h"
 
 namespace opencensus {
 namespace stats {
@@ -35,15 +39,38 @@ class TestUtils final {
       const ViewDescriptor& descriptor,
       std::initializer_list<std::pair<std::vector<std::string>, double>>
           values);
+  // Like MakeViewData(), but each value is also recorded as an exemplar of
+  // 'span_context' at 'timestamp'.
+  static ViewData MakeViewDataWithExemplars(
+      const ViewDescriptor& descriptor,
+      std::initializer_list<std::pair<std::vector<std::string>, double>>
+          values,
+      const opencensus::trace::SpanContext& span_context,
+      absl::Time timestamp);
 
   static Distribution MakeDistribution(const BucketBoundaries* buckets);
 
   static void AddToDistribution(Distribution* distribution, double value);
 
+  static ExponentialHistogram MakeExponentialHistogram(int max_buckets);
+
+  static void AddToExponentialHistogram(ExponentialHistogram* histogram,
+                                        double value);
+
+  static void MergeExponentialHistogram(const ExponentialHistogram& source,
+                                        ExponentialHistogram* destination);
+
   // Flushes the DeltaProducer, propagating recorded stats to views.
   static void Flush();
 
   TestUtils() = delete;
+
+ private:
+  static ViewData MakeViewData(
+      const ViewDescriptor& descriptor,
+      std::initializer_list<std::pair<std::vector<std::string>, double>>
+          values,
+      const ExemplarAttachment* attachment);
 };
 
 }  // namespace testing
@@ -18,6 +18,7 @@
 #include "opencensus/stats/internal/stats_manager.h"
 #include "opencensus/stats/view_data.h"
 #include "opencensus/stats/view_descriptor.h"
+#include "opencensus/tags/tag_map.h"
 
 namespace opencensus {
 namespace stats {
@@ -47,8 +48,12 @@ class View {
 
   // Returns a snapshot of the View's data.
   const ViewData GetData();
-
-  // TODO: Consider a means of querying one tagset to avoid copying.
+  // Returns a snapshot of only the rows whose value for each key of 'filter'
+  // is that key's value in 'filter'. Only the matching rows are copied, so
+  // this is cheaper than GetData() for reading a few rows of a large view
+  // that is being recorded to. Keys that are not columns of the view match no
+  // rows.
+  const ViewData GetData(const opencensus::tags::TagMap& filter);
 
   const ViewDescriptor& descriptor() { return descriptor_; }
 
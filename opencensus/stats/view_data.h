@@ -18,35 +18,44 @@
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "absl/container/node_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
-#include "opencensus/common/internal/stats_object.h"
 #include "opencensus/common/internal/string_vector_hash.h"
+#include "opencensus/common/memory_resource.h"
 #include "opencensus/stats/aggregation.h"
 #include "opencensus/stats/distribution.h"
+#include "opencensus/stats/exponential_histogram.h"
 
 namespace opencensus {
 namespace stats {
 
 // Forward declarations of friends.
+class StatsExporterImpl;
+class ViewDataDecoder;
 class ViewDataImpl;
 namespace testing {
 class TestUtils;
 }
 
 // ViewData is an immutable snapshot of data for a particular View, aggregated
-// according to the View's Aggregation and AggregationWindow.
+// according to the View's Aggregation and AggregationWindow. Copies of a
+// ViewData share its data, so they are cheap.
 class ViewData {
  public:
   // Maps a vector of tag values (corresponding to the columns of the
   // ViewDescriptor of the View generating this ViewData, in that order) to
   // data.
   template <typename DataValueT>
-  using DataMap = std::unordered_map<std::vector<std::string>, DataValueT,
-                                     common::StringVectorHash>;
+  using DataMap = absl::node_hash_map<
+      std::vector<std::string>, DataValueT, common::StringVectorHash,
+      common::StringVectorEqual,
+      common::ResourceAllocator<
+          std::pair<const std::vector<std::string>, DataValueT>,
+          common::MemorySubsystem::kStatsViews>>;
 
   const Aggregation& aggregation() const;
 
@@ -54,6 +63,7 @@ class ViewData {
     kDouble,
     kInt64,
     kDistribution,
+    kExponentialHistogram,
   };
   Type type() const;
 
@@ -65,18 +75,35 @@ class ViewData {
   const DataMap<double>& double_data() const;
   const DataMap<int64_t>& int_data() const;
   const DataMap<Distribution>& distribution_data() const;
+  const DataMap<ExponentialHistogram>& exponential_histogram_data() const;
 
   absl::Time start_time() const;
   absl::Time end_time() const;
 
+  // The number of recordings aggregated into the overflow row (see
+  // ViewDescriptor::set_max_rows()) instead of their own rows. For interval
+  // views this counts since the view was created.
+  int64_t dropped_rows() const;
+  // The number of rows removed for going without data for the view's
+  // ViewDescriptor::row_ttl(), since the view was created.
+  int64_t expired_rows() const;
+  // N if the view's measure is recorded 1 in N (see
+  // StatsConfig::SetMeasureSampling()) as of the latest data merged, else 1.
+  // The data is already scaled up by that rate: each recording kept counts as
+  // N recordings of its value, so counts and sums are unbiased estimates, with
+  // a relative error around 1/sqrt(count / N).
+  uint32_t sample_one_in() const;
+
   ViewData(const ViewData& other);
 
  private:
   friend class View;  // Allowed to call the private constructor.
+  friend class StatsExporterImpl;
+  friend class ViewDataDecoder;
   friend class testing::TestUtils;
-  explicit ViewData(std::unique_ptr<ViewDataImpl> data);
+  explicit ViewData(std::shared_ptr<const ViewDataImpl> data);
 
-  const std::unique_ptr<ViewDataImpl> impl_;
+  const std::shared_ptr<const ViewDataImpl> impl_;
 };
 
 }  // namespace stats
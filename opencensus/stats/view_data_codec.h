@@ -0,0 +1,233 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_STATS_VIEW_DATA_CODEC_H_
+#define OPENCENSUS_STATS_VIEW_DATA_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/view_data.h"
+#include "opencensus/stats/view_descriptor.h"
+
+namespace opencensus {
+namespace stats {
+
+class ViewDataImpl;
+
+// ViewDataEncoder, ViewDataFrame and ViewDataDecoder ship successive snapshots
+// of a view's data between processes (e.g. from forked workers to their
+// parent, to a local agent, or through a spool file) in a compact binary
+// format.
+//
+// The encoder writes one frame per snapshot. A full frame holds every row of
+// the snapshot. A delta frame holds only the rows added or changed since the
+// encoder's previous frame, and lists the rows removed (e.g. expired) since;
+// the counts of Distributions and Int64 values are written as their change.
+// A delta frame can thus only be decoded after the frame before it, so delta
+// frames suit ordered streams, while full frames stand alone.
+//
+// Within a frame, the tag values of each column are dictionary-encoded, so
+// each distinct value is written once; integers and counts are varints
+// (zigzag-encoded where they may be negative); and histogram buckets are
+// sparse, writing only the Distribution buckets whose count (or change) is
+// nonzero, and the populated range of ExponentialHistogram buckets.
+// Doubles are written as 8 little-endian bytes, so frames are portable between
+// architectures. Exemplars are not encoded.
+//
+// Frames are self-delimiting, so a stream or file of them can be read by
+// parsing one after another. ViewDataFrame reads a frame in place, e.g. from a
+// memory-mapped file, without copying its tag values.
+
+// ViewDataEncoder encodes the snapshots of one view.
+//
+// ViewDataEncoder is thread-compatible.
+class ViewDataEncoder final {
+ public:
+  // Encodes snapshots of the view described by 'descriptor'.
+  explicit ViewDataEncoder(const ViewDescriptor& descriptor);
+
+  // Appends to *out a delta frame for 'data' against the data of the previous
+  // call, or a full frame if this is the first call. Every call must pass a
+  // snapshot of the same view.
+  void Encode(const ViewData& data, std::string* out);
+  // As above, always appending a full frame, e.g. to start a new stream.
+  void EncodeFull(const ViewData& data, std::string* out);
+
+ private:
+  void EncodeFrame(const ViewData& data, bool delta, std::string* out);
+  // Appends the rows of 'rows' to rows_: all of them if 'previous' is null,
+  // and otherwise those absent from or different in 'previous', followed by
+  // the rows of 'previous' absent from 'rows'. Returns the number appended.
+  template <typename DataValueT>
+  uint64_t AppendRows(const ViewData::DataMap<DataValueT>& rows,
+                      const ViewData::DataMap<DataValueT>* previous);
+  // Appends the codes of 'tag_values' to rows_, adding the values to the
+  // dictionaries as needed.
+  void AppendCodes(const std::vector<std::string>& tag_values);
+
+  const std::string name_;
+  const size_t num_columns_;
+  uint64_t sequence_ = 0;
+  // The data of the previous frame.
+  std::unique_ptr<ViewData> previous_;
+  // Scratch space, kept to reuse its storage: the dictionary of each column,
+  // mapping tag values to their codes in order of first appearance, and the
+  // encoded header and rows.
+  std::vector<absl::flat_hash_map<absl::string_view, uint32_t>> codes_;
+  std::vector<std::vector<absl::string_view>> dictionaries_;
+  std::string header_;
+  std::string rows_;
+};
+
+// ViewDataFrame reads a frame in place. The buffer it was parsed from must
+// outlive it.
+//
+// ViewDataFrame is thread-compatible.
+class ViewDataFrame final {
+ public:
+  // A row of the frame, as read by NextRow(). Which of the value fields are
+  // set depends on type(); in delta frames, 'int_value' and a Distribution's
+  // 'count' and bucket counts are changes rather than values.
+  struct Row {
+    // Whether the row was removed since the previous frame, in which case it
+    // has no value.
+    bool removed = false;
+    // The index in dictionary(column) of the row's tag value in each column.
+    std::vector<uint32_t> codes;
+
+    double double_value = 0;
+    int64_t int_value = 0;
+
+    // The statistics of a Distribution or ExponentialHistogram. 'mean' and
+    // 'sum_of_squared_deviation' are those of a Distribution, and 'sum',
+    // 'scale' and 'zero_count' those of an ExponentialHistogram.
+    int64_t count = 0;
+    double mean = 0;
+    double sum_of_squared_deviation = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+    int scale = 0;
+    uint64_t zero_count = 0;
+    // The (index, count) of the nonzero buckets of a Distribution, in
+    // increasing order of index; the positive and negative bucket ranges of an
+    // ExponentialHistogram, as in ExponentialHistogram::Buckets.
+    std::vector<std::pair<uint32_t, int64_t>> buckets;
+    int positive_offset = 0;
+    std::vector<uint64_t> positive_counts;
+    int negative_offset = 0;
+    std::vector<uint64_t> negative_counts;
+  };
+
+  // Parses the frame at the front of '*buffer' and advances '*buffer' past
+  // it. Returns false, leaving '*buffer' unchanged, if it does not start with
+  // a complete frame. The rows are checked as they are read.
+  bool Parse(absl::string_view* buffer);
+
+  bool is_delta() const { return delta_; }
+  // The number of frames written by the encoder before this one.
+  uint64_t sequence() const { return sequence_; }
+  absl::string_view view_name() const { return view_name_; }
+  ViewData::Type type() const { return type_; }
+  absl::Time start_time() const { return start_time_; }
+  absl::Time end_time() const { return end_time_; }
+  int64_t dropped_rows() const { return dropped_rows_; }
+  int64_t expired_rows() const { return expired_rows_; }
+  // The number of buckets of a Distribution, or the maximum number of each
+  // of the positive and negative buckets of an ExponentialHistogram.
+  uint32_t num_buckets() const { return num_buckets_; }
+
+  size_t num_columns() const { return dictionaries_.size(); }
+  // The distinct tag values of 'column', pointing into the frame.
+  const std::vector<absl::string_view>& dictionary(size_t column) const {
+    return dictionaries_[column];
+  }
+
+  // The number of rows, including removed rows.
+  size_t num_rows() const { return num_rows_; }
+  // Reads the next row into '*row', reusing its storage. Returns false once
+  // all rows have been read, or if a row is malformed (see ok()).
+  bool NextRow(Row* row);
+  // False if NextRow() found a malformed row.
+  bool ok() const { return ok_; }
+
+ private:
+  bool delta_ = false;
+  uint64_t sequence_ = 0;
+  absl::string_view view_name_;
+  ViewData::Type type_ = ViewData::Type::kDouble;
+  absl::Time start_time_;
+  absl::Time end_time_;
+  int64_t dropped_rows_ = 0;
+  int64_t expired_rows_ = 0;
+  uint32_t num_buckets_ = 0;
+  std::vector<std::vector<absl::string_view>> dictionaries_;
+  size_t num_rows_ = 0;
+  size_t rows_read_ = 0;
+  // The rows not yet read.
+  absl::string_view rows_;
+  bool ok_ = true;
+};
+
+// ViewDataDecoder rebuilds the snapshots of one view from its frames.
+//
+// ViewDataDecoder is thread-compatible.
+class ViewDataDecoder final {
+ public:
+  // Decodes frames of the view described by 'descriptor', which must match
+  // the encoder's in its name, aggregation and number of columns.
+  explicit ViewDataDecoder(const ViewDescriptor& descriptor);
+  ~ViewDataDecoder();
+
+  // Applies 'frame', which must not have been read from yet. Returns false if
+  // the frame is for another view or does not match the descriptor, if it is a
+  // delta frame that does not follow the last frame applied, or if it is
+  // malformed; data() is then empty until the next full frame.
+  bool Apply(ViewDataFrame* frame);
+  // Parses and applies each frame in 'buffer'. Returns false as soon as one
+  // fails to parse or apply.
+  bool Decode(absl::string_view buffer);
+
+  // Whether a frame has been applied since the decoder was created or last
+  // failed.
+  bool has_data() const { return data_ != nullptr; }
+  // The snapshot as of the last frame applied. Requires has_data().
+  ViewData data() const;
+
+ private:
+  // Applies the rows of 'frame' to data_, which must be of its type.
+  bool ApplyRows(ViewDataFrame* frame);
+
+  const ViewDescriptor descriptor_;
+  // The current snapshot, shared with the ViewData returned by data() until
+  // the next frame, which copies it if it is still shared.
+  std::shared_ptr<ViewDataImpl> data_;
+  uint64_t sequence_ = 0;
+  // Scratch space for reading rows.
+  ViewDataFrame::Row row_;
+  std::vector<std::string> key_;
+};
+
+}  // namespace stats
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_STATS_VIEW_DATA_CODEC_H_
@@ -21,6 +21,8 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "opencensus/stats/aggregation.h"
 #include "opencensus/stats/internal/aggregation_window.h"
 #include "opencensus/stats/measure_descriptor.h"
@@ -75,6 +77,59 @@ class ViewDescriptor final {
     return columns_;
   }
 
+  // Limits the number of distinct rows (combinations of tag values) the view
+  // stores to 'max_rows'. Data recorded for further rows is aggregated into a
+  // single overflow row, whose tag values are all kOverflowTagValue, and counted
+  // in ViewData::dropped_rows(). 0 (the default) means no limit.
+  ViewDescriptor& set_max_rows(int max_rows);
+  int max_rows() const { return max_rows_; }
+
+  // Hints that the view will hold about 'rows' rows, so that its storage is
+  // sized up front rather than grown as tag sets first appear, e.g. after a
+  // restart. Only affects memory and the latency of the first harvests; not
+  // part of the view's identity. 0 (the default) gives no hint.
+  ViewDescriptor& set_expected_rows(int rows);
+  int expected_rows() const { return expected_rows_; }
+
+  // The tag value of every column in the overflow row.
+  static const char kOverflowTagValue[];
+
+  // Keeps rows only for the 'k' most recorded values of 'column', which must
+  // be one of the view's columns, in memory proportional to 'k' however many
+  // values the column takes. The values are chosen by the space-saving
+  // algorithm: a value not yet kept displaces the least recorded one, whose
+  // rows are folded into rows with kOtherTagValue for 'column', so rarely
+  // recorded values may briefly be kept in place of slightly more common
+  // ones. Non-positive 'k' (the default) keeps every value. Not supported
+  // with LastValue or DistinctCount aggregations or interval windows.
+  ViewDescriptor& set_top_k(opencensus::tags::TagKey column, int k);
+  int top_k() const { return top_k_; }
+  const absl::optional<opencensus::tags::TagKey>& top_k_column() const {
+    return top_k_column_;
+  }
+
+  // The tag value of the top-k column in rows folded from values not kept.
+  static const char kOtherTagValue[];
+
+  // Sets a time-to-live for rows: rows that receive no data for 'ttl' are
+  // removed when stats are next harvested, and counted in
+  // ViewData::expired_rows(). Non-positive or infinite values (the default)
+  // disable expiry.
+  ViewDescriptor& set_row_ttl(absl::Duration ttl);
+  absl::Duration row_ttl() const { return row_ttl_; }
+
+  // Declares that the view may be computed from another view of the same
+  // measure, aggregation, aggregation window, max_rows(), top_k() and
+  // row_ttl() whose columns include all of this view's columns (e.g. a view
+  // by "method" from one by "method", "status", and "region"). If such a view
+  // is active when this one is created, this view's data is aggregated from
+  // that view's rows whenever it is read, instead of being merged separately
+  // on every harvest, which saves memory and merge work at the cost of reads.
+  // Views with LastValue aggregation or a delta window are not computed this
+  // way.
+  ViewDescriptor& set_rollup(bool rollup);
+  bool rollup() const { return rollup_; }
+
   // Sets a human-readable description for the view.
   ViewDescriptor& set_description(absl::string_view description);
   const std::string& description() const { return description_; }
@@ -101,6 +156,7 @@ class ViewDescriptor final {
  private:
   friend class StatsManager;
   friend class ViewDataImpl;
+  friend class ViewSnapshot;
   friend void SetAggregationWindow(const AggregationWindow&, ViewDescriptor*);
 
   std::string name_;
@@ -109,6 +165,12 @@ class ViewDescriptor final {
   Aggregation aggregation_;
   AggregationWindow aggregation_window_;
   std::vector<opencensus::tags::TagKey> columns_;
+  int max_rows_ = 0;
+  int expected_rows_ = 0;
+  int top_k_ = 0;
+  absl::optional<opencensus::tags::TagKey> top_k_column_;
+  absl::Duration row_ttl_ = absl::InfiniteDuration();
+  bool rollup_ = false;
   std::string description_;
 };
 
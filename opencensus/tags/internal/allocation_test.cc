@@ -0,0 +1,50 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tracks the steady-state heap allocations of the tagging hot paths, so that
+// changes which add allocations are caught.
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/allocation_counter.h"
+#include "opencensus/tags/propagation/grpc_tags_bin.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+
+namespace opencensus {
+namespace tags {
+namespace {
+
+using ::opencensus::common::AllocationsPerOperation;
+
+TEST(AllocationTest, WithTagMap) {
+  static const TagKey key = TagKey::Register("key");
+  const TagMap tags({{key, "value"}});
+  // The new Context's node and its shared copy of the tags.
+  EXPECT_EQ(2, AllocationsPerOperation([&tags]() { WithTagMap wt(tags); }));
+}
+
+TEST(AllocationTest, GrpcTagsBinEncoder) {
+  static const TagKey key = TagKey::Register("key");
+  const TagMap tags({{key, "a value too long for short string storage"}});
+  // The returned string.
+  EXPECT_EQ(1, AllocationsPerOperation(
+                   [&tags]() { propagation::ToGrpcTagsBinHeader(tags); }));
+}
+
+}  // namespace
+}  // namespace tags
+}  // namespace opencensus
@@ -0,0 +1,159 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/tags/propagation/grpc_tags_bin.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace tags {
+namespace propagation {
+
+namespace {
+
+constexpr char kVersionId = 0;
+constexpr char kTagFieldId = 0;
+constexpr size_t kMaxTagLen = 255;
+
+void AppendVarint(uint32_t n, std::string* out) {
+  while (n >= 0x80) {
+    out->push_back(static_cast<char>((n & 0x7f) | 0x80));
+    n >>= 7;
+  }
+  out->push_back(static_cast<char>(n));
+}
+
+void AppendLengthPrefixed(absl::string_view s, std::string* out) {
+  AppendVarint(s.size(), out);
+  out->append(s.data(), s.size());
+}
+
+// Parses a varint from the front of *input and removes it. Returns false if
+// *input does not start with a varint of at most 32 bits.
+bool ParseVarint(absl::string_view* input, uint32_t* n) {
+  *n = 0;
+  for (int shift = 0; shift < 32; shift += 7) {
+    if (input->empty()) return false;
+    const uint8_t byte = static_cast<uint8_t>(input->front());
+    input->remove_prefix(1);
+    *n |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool IsValidTag(absl::string_view s) {
+  if (s.size() > kMaxTagLen) return false;
+  for (char c : s) {
+    if (c < 0x20 || c > 0x7e) return false;
+  }
+  return true;
+}
+
+// Parses a length-prefixed string from the front of *input and removes it.
+bool ParseLengthPrefixed(absl::string_view* input, absl::string_view* s) {
+  uint32_t len;
+  if (!ParseVarint(input, &len) || len > input->size()) return false;
+  *s = input->substr(0, len);
+  input->remove_prefix(len);
+  return IsValidTag(*s);
+}
+
+}  // namespace
+
+bool FromGrpcTagsBinHeader(absl::string_view header, TagMap* tags) {
+  if (header.empty() || header[0] != kVersionId) {
+    return false;  // Missing or unsupported version.
+  }
+  header.remove_prefix(1);
+  std::vector<std::pair<absl::string_view, absl::string_view>> parsed;
+  size_t total_len = 0;
+  while (!header.empty() && header[0] == kTagFieldId) {
+    header.remove_prefix(1);
+    absl::string_view key;
+    absl::string_view value;
+    if (!ParseLengthPrefixed(&header, &key) || key.empty() ||
+        !ParseLengthPrefixed(&header, &value)) {
+      return false;
+    }
+    total_len += key.size() + value.size();
+    if (total_len > kMaxGrpcTagsBinTagsLen) {
+      return false;
+    }
+    parsed.emplace_back(key, value);
+  }
+  // Keys are never registered here, since registrations last for the lifetime
+  // of the process and the peer chooses the keys.
+  std::vector<std::pair<TagKey, std::string>> tag_vector;
+  tag_vector.reserve(parsed.size());
+  for (const auto& key_value : parsed) {
+    const absl::optional<TagKey> key = TagKey::Lookup(key_value.first);
+    if (key.has_value()) {
+      tag_vector.emplace_back(*key, std::string(key_value.second));
+    }
+  }
+  // Keep the last value of duplicate keys, which are adjacent after a stable
+  // sort.
+  std::stable_sort(tag_vector.begin(), tag_vector.end(),
+                   [](const std::pair<TagKey, std::string>& a,
+                      const std::pair<TagKey, std::string>& b) {
+                     return a.first < b.first;
+                   });
+  size_t unique = 0;
+  for (size_t i = 0; i < tag_vector.size(); ++i) {
+    if (i + 1 < tag_vector.size() &&
+        tag_vector[i].first == tag_vector[i + 1].first) {
+      continue;
+    }
+    if (unique != i) tag_vector[unique] = std::move(tag_vector[i]);
+    ++unique;
+  }
+  tag_vector.erase(tag_vector.begin() + unique, tag_vector.end());
+  *tags = TagMap(std::move(tag_vector));
+  return true;
+}
+
+std::string ToGrpcTagsBinHeader(const TagMap& tags) {
+  size_t total_len = 0;
+  for (const auto& tag : tags.tag_views()) {
+    total_len += tag.first.name().size() + tag.second.size();
+  }
+  if (total_len > kMaxGrpcTagsBinTagsLen) {
+    return std::string();
+  }
+  std::string header;
+  // Each tag has a field id and 2 varint lengths of at most 2 bytes each.
+  header.reserve(1 + total_len + 5 * tags.tag_views().size());
+  header.push_back(kVersionId);
+  for (const auto& tag : tags.tag_views()) {
+    header.push_back(kTagFieldId);
+    AppendLengthPrefixed(tag.first.name(), &header);
+    AppendLengthPrefixed(tag.second, &header);
+  }
+  return header;
+}
+
+}  // namespace propagation
+}  // namespace tags
+}  // namespace opencensus
@@ -0,0 +1,64 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/tags/propagation/grpc_tags_bin.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace tags {
+namespace propagation {
+namespace {
+
+// Returns a TagMap with n tags.
+TagMap MakeTagMap(int n) {
+  std::vector<std::pair<TagKey, std::string>> tags;
+  tags.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    tags.emplace_back(TagKey::Register(absl::StrCat("key", i)),
+                      absl::StrCat("val", i));
+  }
+  return TagMap(std::move(tags));
+}
+
+void BM_ToGrpcTagsBinHeader(benchmark::State& state) {
+  const TagMap tags = MakeTagMap(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ToGrpcTagsBinHeader(tags));
+  }
+}
+BENCHMARK(BM_ToGrpcTagsBinHeader)->RangeMultiplier(2)->Range(1, 32);
+
+void BM_FromGrpcTagsBinHeader(benchmark::State& state) {
+  const std::string header = ToGrpcTagsBinHeader(MakeTagMap(state.range(0)));
+  TagMap tags({});
+  for (auto _ : state) {
+    FromGrpcTagsBinHeader(header, &tags);
+  }
+}
+BENCHMARK(BM_FromGrpcTagsBinHeader)->RangeMultiplier(2)->Range(1, 32);
+
+}  // namespace
+}  // namespace propagation
+}  // namespace tags
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,105 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/tags/propagation/grpc_tags_bin.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace tags {
+namespace propagation {
+namespace {
+
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(GrpcTagsBinTest, RoundTrip) {
+  const TagKey key1 = TagKey::Register("key1");
+  const TagKey key2 = TagKey::Register("key2");
+  const TagMap tags({{key1, "value1"}, {key2, ""}});
+  const std::string header = ToGrpcTagsBinHeader(tags);
+  TagMap parsed({});
+  ASSERT_TRUE(FromGrpcTagsBinHeader(header, &parsed));
+  EXPECT_EQ(tags, parsed);
+}
+
+TEST(GrpcTagsBinTest, Encoding) {
+  const TagKey key = TagKey::Register("k");
+  EXPECT_EQ(std::string("\0\0\1k\2v1", 7),
+            ToGrpcTagsBinHeader(TagMap({{key, "v1"}})));
+  EXPECT_EQ(std::string("\0", 1), ToGrpcTagsBinHeader(TagMap({})));
+}
+
+TEST(GrpcTagsBinTest, LastValueWinsAndUnknownFieldsStopParsing) {
+  const TagKey key = TagKey::Register("k");
+  TagMap parsed({});
+  ASSERT_TRUE(FromGrpcTagsBinHeader(
+      std::string("\0\0\1k\1a\0\1k\1b\1garbage", 19), &parsed));
+  EXPECT_THAT(parsed.tags(), UnorderedElementsAre(Pair(key, "b")));
+}
+
+TEST(GrpcTagsBinTest, UnregisteredKeysDropped) {
+  const TagKey key = TagKey::Register("k");
+  TagMap parsed({});
+  ASSERT_TRUE(FromGrpcTagsBinHeader(
+      std::string("\0\0\1k\1a\0\7unknown\1b", 17), &parsed));
+  EXPECT_THAT(parsed.tags(), UnorderedElementsAre(Pair(key, "a")));
+  EXPECT_FALSE(TagKey::Lookup("unknown").has_value());
+}
+
+TEST(GrpcTagsBinTest, ExpectedFailures) {
+  const TagMap original({{TagKey::Register("k"), "v"}});
+  TagMap parsed = original;
+#define INVALID(str) EXPECT_FALSE(FromGrpcTagsBinHeader(str, &parsed))
+  INVALID(absl::string_view()) << "missing version.";
+  INVALID(std::string("\1", 1)) << "unsupported version.";
+  INVALID(std::string("\0\0\3k", 4)) << "truncated key.";
+  INVALID(std::string("\0\0\1k", 4)) << "missing value.";
+  INVALID(std::string("\0\0\0\1v", 5)) << "empty key.";
+  INVALID(std::string("\0\0\1\n\1v", 6)) << "unprintable key.";
+  INVALID(std::string("\0\0\1k\xff", 5)) << "truncated varint.";
+#undef INVALID
+  EXPECT_EQ(original, parsed);
+}
+
+TEST(GrpcTagsBinTest, Limits) {
+  const std::string long_value(255, 'v');
+  std::string header(1, '\0');
+  // 2 bytes of key and 255 of value per tag.
+  for (int i = 0; i * 257 <= kMaxGrpcTagsBinTagsLen; ++i) {
+    header += std::string("\0\2", 2) + static_cast<char>('a' + i / 26) +
+              static_cast<char>('a' + i % 26) + "\xff\x01" + long_value;
+  }
+  TagMap parsed({});
+  EXPECT_FALSE(FromGrpcTagsBinHeader(header, &parsed));
+
+  std::vector<std::pair<TagKey, std::string>> tags;
+  for (int i = 0; i * 257 <= kMaxGrpcTagsBinTagsLen; ++i) {
+    tags.emplace_back(TagKey::Register("key" + std::to_string(i)), long_value);
+  }
+  EXPECT_EQ("", ToGrpcTagsBinHeader(TagMap(tags)));
+}
+
+}  // namespace
+}  // namespace propagation
+}  // namespace tags
+}  // namespace opencensus
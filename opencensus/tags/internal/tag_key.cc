@@ -18,11 +18,12 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
-#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "opencensus/common/internal/append_only_vector.h"
 
 namespace opencensus {
 namespace tags {
@@ -35,16 +36,18 @@ class TagKeyRegistry {
   }
 
   TagKey Register(absl::string_view name) LOCKS_EXCLUDED(mu_);
+  absl::optional<TagKey> Lookup(absl::string_view name) LOCKS_EXCLUDED(mu_);
 
-  const std::string& TagKeyName(TagKey key) const LOCKS_EXCLUDED(mu_) {
-    absl::ReaderMutexLock l(&mu_);
+  // Does not lock, since registered names never change or move.
+  const std::string& TagKeyName(TagKey key) const {
     return registered_tag_keys_[key.id_];
   }
 
  private:
-  mutable absl::Mutex mu_;
-  // The registered tag keys. Tag key ids are indices into this vector.
-  std::vector<std::string> registered_tag_keys_ GUARDED_BY(mu_);
+  absl::Mutex mu_;
+  // The registered tag keys. Tag key ids are indices into this vector. Appends
+  // are guarded by mu_; reads are not.
+  common::AppendOnlyVector<std::string> registered_tag_keys_;
   // A map from names to IDs.
   // TODO: change to string_view when a suitable hash is available.
   std::unordered_map<std::string, uint64_t> id_map_ GUARDED_BY(mu_);
@@ -55,18 +58,28 @@ TagKey TagKeyRegistry::Register(absl::string_view name) {
   const std::string string_name(name);
   const auto it = id_map_.find(string_name);
   if (it == id_map_.end()) {
-    const uint64_t id = registered_tag_keys_.size();
-    registered_tag_keys_.emplace_back(name);
+    const uint64_t id = registered_tag_keys_.push_back(string_name);
     id_map_.emplace_hint(it, string_name, id);
     return TagKey(id);
   }
   return TagKey(it->second);
 }
 
+absl::optional<TagKey> TagKeyRegistry::Lookup(absl::string_view name) {
+  absl::ReaderMutexLock l(&mu_);
+  const auto it = id_map_.find(std::string(name));
+  if (it == id_map_.end()) return absl::nullopt;
+  return TagKey(it->second);
+}
+
 TagKey TagKey::Register(absl::string_view name) {
   return TagKeyRegistry::Get()->Register(name);
 }
 
+absl::optional<TagKey> TagKey::Lookup(absl::string_view name) {
+  return TagKeyRegistry::Get()->Lookup(name);
+}
+
 const std::string& TagKey::name() const {
   return TagKeyRegistry::Get()->TagKeyName(*this);
 }
@@ -39,6 +39,14 @@ TEST(TagKeyTest, Inequality) {
   EXPECT_NE(k1.hash(), k2.hash());
 }
 
+TEST(TagKeyTest, Lookup) {
+  EXPECT_FALSE(TagKey::Lookup("lookup_key").has_value());
+  // Lookup() does not register.
+  EXPECT_FALSE(TagKey::Lookup("lookup_key").has_value());
+  const TagKey key = TagKey::Register("lookup_key");
+  EXPECT_EQ(key, TagKey::Lookup("lookup_key"));
+}
+
 }  // namespace
 }  // namespace tags
 }  // namespace opencensus
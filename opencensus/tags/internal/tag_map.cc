@@ -15,63 +15,349 @@
 #include "opencensus/tags/tag_map.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
+#include <new>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "opencensus/common/internal/hash_mix.h"
 #include "opencensus/tags/tag_key.h"
 
 namespace opencensus {
 namespace tags {
+namespace {
 
-TagMap::TagMap(
-    std::initializer_list<std::pair<TagKey, absl::string_view>> tags) {
-  tags_.reserve(tags.size());
+// An interned tag value: a reference count followed by the value's bytes, so
+// that a view of the value leads back to its count.
+struct InternedValue {
+  explicit InternedValue(size_t size) : refs(1), size(size) {}
+
+  char* data() { return reinterpret_cast<char*>(this + 1); }
+  absl::string_view value() { return absl::string_view(data(), size); }
+
+  static InternedValue* Of(absl::string_view value) {
+    return reinterpret_cast<InternedValue*>(const_cast<char*>(value.data())) -
+           1;
+  }
+
+  // Only drops to 0 under the registry's mutex, which is held exclusively to
+  // find and free values without references.
+  std::atomic<int64_t> refs;
+  const size_t size;
+};
+
+// The process-wide table of interned tag values. Each value is freed when its
+// last reference is released.
+class TagValueRegistry {
+ public:
+  static TagValueRegistry* Get() {
+    static TagValueRegistry* global_tag_value_registry = new TagValueRegistry;
+    return global_tag_value_registry;
+  }
+
+  // Replaces each value in 'tags' with a view of its interned copy, taking a
+  // reference to it.
+  void Intern(absl::Span<std::pair<TagKey, absl::string_view>> tags)
+      LOCKS_EXCLUDED(mu_);
+
+  // Takes another reference to an interned value; the caller must hold one.
+  static void Ref(absl::string_view value) {
+    InternedValue::Of(value)->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Releases a reference to an interned value, freeing it if it was the last.
+  void Unref(absl::string_view value) LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Looks up each value in 'tags', replacing those already interned. Returns
+  // true if all were found.
+  bool InternExisting(absl::Span<std::pair<TagKey, absl::string_view>> tags)
+      const SHARED_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  // Keyed by views of the values themselves.
+  absl::flat_hash_map<absl::string_view, InternedValue*> values_
+      GUARDED_BY(mu_);
+};
+
+void TagValueRegistry::Intern(
+    absl::Span<std::pair<TagKey, absl::string_view>> tags) {
+  {
+    // Most values are already held, so try under a shared lock first.
+    absl::ReaderMutexLock l(&mu_);
+    if (InternExisting(tags)) {
+      return;
+    }
+  }
+  absl::MutexLock l(&mu_);
+  for (auto& tag : tags) {
+    auto it = values_.find(tag.second);
+    if (it == values_.end()) {
+      void* storage = ::operator new(sizeof(InternedValue) + tag.second.size());
+      InternedValue* interned = new (storage) InternedValue(tag.second.size());
+      std::copy(tag.second.begin(), tag.second.end(), interned->data());
+      it = values_.emplace(interned->value(), interned).first;
+    } else {
+      it->second->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    tag.second = it->first;
+  }
+}
+
+bool TagValueRegistry::InternExisting(
+    absl::Span<std::pair<TagKey, absl::string_view>> tags) const {
+  // All or nothing, so that Intern() can redo every tag under the exclusive
+  // lock without counting any twice.
   for (const auto& tag : tags) {
-    tags_.emplace_back(tag.first, std::string(tag.second));
+    if (values_.find(tag.second) == values_.end()) {
+      return false;
+    }
   }
-  Initialize();
+  for (auto& tag : tags) {
+    const auto it = values_.find(tag.second);
+    // Values are only freed under the exclusive lock, so those found here
+    // keep at least one reference until this one is added.
+    it->second->refs.fetch_add(1, std::memory_order_relaxed);
+    tag.second = it->first;
+  }
+  return true;
 }
 
-TagMap::TagMap(std::vector<std::pair<TagKey, std::string>> tags)
-    : tags_(std::move(tags)) {
-  Initialize();
+void TagValueRegistry::Unref(absl::string_view value) {
+  InternedValue* interned = InternedValue::Of(value);
+  int64_t refs = interned->refs.load(std::memory_order_relaxed);
+  while (refs > 1) {
+    if (interned->refs.compare_exchange_weak(refs, refs - 1,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  // Possibly the last reference: drop it under the lock, so that no lookup
+  // finds the value while it is freed. A lookup may have taken another
+  // reference meanwhile.
+  absl::MutexLock l(&mu_);
+  if (interned->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    values_.erase(interned->value());
+    interned->~InternedValue();
+    ::operator delete(interned);
+  }
 }
 
-void TagMap::Initialize() {
-  std::sort(tags_.begin(), tags_.end());
+// Mixes a tag into the hash of a TagMap. Interned values are equal exactly when
+// their addresses are.
+void MixTag(const std::pair<TagKey, absl::string_view>& tag,
+            common::HashMix* mixer) {
+  mixer->Mix(tag.first.hash());
+  mixer->Mix(std::hash<const char*>()(tag.second.data()));
+}
 
+void AssertNoDuplicateKeys(
+    absl::Span<const std::pair<TagKey, absl::string_view>> tags) {
 #ifndef NDEBUG
-  auto compare_keys = [](const std::pair<TagKey, std::string>& a,
-                         const std::pair<TagKey, std::string>& b) {
+  auto compare_keys = [](const std::pair<TagKey, absl::string_view>& a,
+                         const std::pair<TagKey, absl::string_view>& b) {
     return a.first == b.first;
   };
-  assert(std::adjacent_find(tags_.begin(), tags_.end(), compare_keys) ==
-             tags_.end() &&
+  assert(std::adjacent_find(tags.begin(), tags.end(), compare_keys) ==
+             tags.end() &&
          "Duplicate keys are not allowed in TagMap.");
 #endif
+}
+
+}  // namespace
+
+constexpr size_t TagMap::kInlineTags;
+
+TagMap::TagMap(
+    std::initializer_list<std::pair<TagKey, absl::string_view>> tags)
+    : tags_(tags) {
+  Initialize();
+}
+
+TagMap::TagMap(std::vector<std::pair<TagKey, std::string>> tags) {
+  tags_.reserve(tags.size());
+  for (const auto& tag : tags) {
+    tags_.emplace_back(tag.first, tag.second);
+  }
+  Initialize();
+}
+
+TagMap::TagMap(const TagMap& other)
+    : hash_(other.hash_), tags_(other.tags_) {
+  for (const auto& tag : tags_) {
+    TagValueRegistry::Ref(tag.second);
+  }
+}
+
+TagMap::TagMap(TagMap&& other) noexcept
+    : hash_(other.hash_),
+      tags_(std::move(other.tags_)),
+      tag_copies_(other.tag_copies_.exchange(nullptr,
+                                             std::memory_order_relaxed)) {
+  // The references move with the tags.
+  other.tags_.clear();
+}
+
+TagMap& TagMap::operator=(TagMap other) noexcept {
+  std::swap(hash_, other.hash_);
+  tags_.swap(other.tags_);
+  // The copies of the old tags are freed with 'other'.
+  const auto* copies = tag_copies_.load(std::memory_order_relaxed);
+  tag_copies_.store(other.tag_copies_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  other.tag_copies_.store(copies, std::memory_order_relaxed);
+  return *this;
+}
+
+TagMap::~TagMap() {
+  delete tag_copies_.load(std::memory_order_relaxed);
+  if (tags_.empty()) return;
+  TagValueRegistry* registry = TagValueRegistry::Get();
+  for (const auto& tag : tags_) {
+    registry->Unref(tag.second);
+  }
+}
+
+const std::vector<std::pair<TagKey, std::string>>& TagMap::tags() const {
+  const std::vector<std::pair<TagKey, std::string>>* copies =
+      tag_copies_.load(std::memory_order_acquire);
+  if (copies == nullptr) {
+    auto* new_copies = new std::vector<std::pair<TagKey, std::string>>;
+    new_copies->reserve(tags_.size());
+    for (const auto& tag : tags_) {
+      new_copies->emplace_back(tag.first, std::string(tag.second));
+    }
+    // Concurrent first calls may both make copies; one keeps its own.
+    if (tag_copies_.compare_exchange_strong(copies, new_copies,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+      copies = new_copies;
+    } else {
+      delete new_copies;
+    }
+  }
+  return *copies;
+}
+
+void TagMap::Initialize() {
+  TagValueRegistry::Get()->Intern(absl::MakeSpan(tags_));
+  std::sort(tags_.begin(), tags_.end());
+  AssertNoDuplicateKeys(tags_);
 
-  std::hash<std::string> hasher;
   common::HashMix mixer;
   for (const auto& tag : tags_) {
-    mixer.Mix(tag.first.hash());
-    mixer.Mix(hasher(tag.second));
+    MixTag(tag, &mixer);
   }
   hash_ = mixer.get();
 }
 
+TagMap TagMap::WithAdditionalTags(
+    std::initializer_list<std::pair<TagKey, absl::string_view>> tags) const {
+  return Merge(TagVector(tags));
+}
+
+TagMap TagMap::WithAdditionalTags(
+    std::vector<std::pair<TagKey, std::string>> tags) const {
+  TagVector additions;
+  additions.reserve(tags.size());
+  for (const auto& tag : tags) {
+    additions.emplace_back(tag.first, tag.second);
+  }
+  return Merge(std::move(additions));
+}
+
+TagMap TagMap::Merge(TagVector additions) const {
+  // Only the additions need interning and sorting; there are usually few. Their
+  // references pass to the merged TagMap, and the kept tags take new ones.
+  TagValueRegistry::Get()->Intern(absl::MakeSpan(additions));
+  std::sort(additions.begin(), additions.end());
+  AssertNoDuplicateKeys(additions);
+
+  TagVector merged;
+  merged.reserve(tags_.size() + additions.size());
+  common::HashMix mixer;
+  auto existing = tags_.begin();
+  auto added = additions.begin();
+  while (existing != tags_.end() || added != additions.end()) {
+    if (added == additions.end() ||
+        (existing != tags_.end() && existing->first < added->first)) {
+      TagValueRegistry::Ref(existing->second);
+      merged.push_back(*existing++);
+    } else {
+      if (existing != tags_.end() && existing->first == added->first) {
+        ++existing;
+      }
+      merged.push_back(*added++);
+    }
+    MixTag(merged.back(), &mixer);
+  }
+  return TagMap(std::move(merged), mixer.get());
+}
+
+bool TagMap::HasOnlyKeys(const std::vector<TagKey>& keys) const {
+  auto key = keys.begin();
+  for (const auto& tag : tags_) {
+    while (key != keys.end() && *key < tag.first) {
+      ++key;
+    }
+    if (key == keys.end() || *key != tag.first) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TagMap TagMap::WithOnlyKeys(const std::vector<TagKey>& keys) const {
+  // Both lists are sorted, so a single merge pass selects the tags; the values
+  // are already interned.
+  TagVector selected;
+  common::HashMix mixer;
+  auto key = keys.begin();
+  for (const auto& tag : tags_) {
+    while (key != keys.end() && *key < tag.first) {
+      ++key;
+    }
+    if (key == keys.end()) {
+      break;
+    }
+    if (*key == tag.first) {
+      TagValueRegistry::Ref(tag.second);
+      selected.push_back(tag);
+      MixTag(tag, &mixer);
+    }
+  }
+  return TagMap(std::move(selected), mixer.get());
+}
+
 std::size_t TagMap::Hash::operator()(const TagMap& tags) const {
   return tags.hash_;
 }
 
 bool TagMap::operator==(const TagMap& other) const {
-  return tags_ == other.tags_;
+  if (hash_ != other.hash_ || tags_.size() != other.tags_.size()) {
+    return false;
+  }
+  for (int i = 0; i < tags_.size(); ++i) {
+    if (tags_[i].first != other.tags_[i].first ||
+        tags_[i].second.data() != other.tags_[i].second.data()) {
+      return false;
+    }
+  }
+  return true;
 }
 
 std::string TagMap::DebugString() const {
@@ -79,7 +365,8 @@ std::string TagMap::DebugString() const {
       "{",
       absl::StrJoin(
           tags_, ", ",
-          [](std::string* o, std::pair<const TagKey&, const std::string&> kv) {
+          [](std::string* o,
+             std::pair<const TagKey&, const absl::string_view&> kv) {
             absl::StrAppend(o, "\"", kv.first.name(), "\": \"", kv.second,
                             "\"");
           }),
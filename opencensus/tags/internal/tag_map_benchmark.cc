@@ -14,11 +14,16 @@
 
 #include "opencensus/tags/tag_map.h"
 
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "benchmark/benchmark.h"
+#include "opencensus/common/internal/hash_mix.h"
+#include "opencensus/common/internal/string_vector_hash.h"
 #include "opencensus/tags/tag_key.h"
 
 namespace opencensus {
@@ -41,6 +46,104 @@ void BM_MakeTagMap(benchmark::State& state) {
 }
 BENCHMARK(BM_MakeTagMap)->RangeMultiplier(2)->Range(1, 32);
 
+// Returns a TagMap with N tags.
+TagMap MakeTagMap(int n) {
+  std::vector<std::pair<TagKey, std::string>> tags;
+  tags.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    tags.emplace_back(TagKey::Register(absl::StrCat("key", i)),
+                      absl::StrCat("val", i));
+  }
+  return TagMap(std::move(tags));
+}
+
+// Deriving a TagMap with one more tag by copying the tags and constructing a
+// new TagMap...
+void BM_AddTagByConstruction(benchmark::State& state) {
+  const TagMap base = MakeTagMap(state.range(0));
+  const TagKey key = TagKey::Register("added_key");
+  for (auto _ : state) {
+    std::vector<std::pair<TagKey, std::string>> tags;
+    tags.reserve(base.tag_views().size() + 1);
+    for (const auto& tag : base.tag_views()) {
+      tags.emplace_back(tag.first, std::string(tag.second));
+    }
+    tags.emplace_back(key, "added_value");
+    TagMap tm(std::move(tags));
+    benchmark::DoNotOptimize(tm);
+  }
+}
+BENCHMARK(BM_AddTagByConstruction)->RangeMultiplier(2)->Range(1, 32);
+
+// ...and by merging.
+void BM_AddTagWithAdditionalTags(benchmark::State& state) {
+  const TagMap base = MakeTagMap(state.range(0));
+  const TagKey key = TagKey::Register("added_key");
+  for (auto _ : state) {
+    TagMap tm = base.WithAdditionalTags({{key, "added_value"}});
+    benchmark::DoNotOptimize(tm);
+  }
+}
+BENCHMARK(BM_AddTagWithAdditionalTags)->RangeMultiplier(2)->Range(1, 32);
+
+// Copying a TagMap, as contexts and stats deltas do. Up to
+// TagMap::kInlineTags tags are copied without allocating.
+void BM_CopyTagMap(benchmark::State& state) {
+  const TagMap base = MakeTagMap(state.range(0));
+  for (auto _ : state) {
+    TagMap copy(base);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_CopyTagMap)->DenseRange(1, 8);
+
+// Looks up TagMaps which differ only in their first tag, as is common when a
+// key like the method varies and the rest do not, as Delta does.
+void BM_TagMapLookup(benchmark::State& state) {
+  const TagKey k1 = TagKey::Register("key1");
+  const TagKey k2 = TagKey::Register("key2");
+  std::vector<TagMap> tag_maps;
+  std::unordered_map<TagMap, int, TagMap::Hash> map;
+  for (int i = 0; i < state.range(0); ++i) {
+    tag_maps.push_back(TagMap({{k1, absl::StrCat("val", i)}, {k2, "val"}}));
+    map.emplace(tag_maps.back(), i);
+  }
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(tag_maps[i]));
+    if (++i == tag_maps.size()) i = 0;
+  }
+}
+BENCHMARK(BM_TagMapLookup)->RangeMultiplier(4)->Range(4, 1024);
+
+// A/B of hashing tag values as ViewDataImpl::DataMap does, and with
+// std::hash<std::string>.
+struct StdStringVectorHash {
+  std::size_t operator()(const std::vector<std::string>& container) const {
+    std::hash<std::string> hasher;
+    common::HashMix mixer;
+    for (const auto& elem : container) {
+      mixer.Mix(hasher(elem));
+    }
+    return mixer.get();
+  }
+};
+
+template <typename Hasher>
+void BM_StringVectorHash(benchmark::State& state) {
+  std::vector<std::string> values;
+  for (int i = 0; i < state.range(0); ++i) {
+    values.push_back(absl::StrCat("/service.Method", i));
+  }
+  const Hasher hasher;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hasher(values));
+  }
+}
+BENCHMARK_TEMPLATE(BM_StringVectorHash, common::StringVectorHash)
+    ->Range(1, 8);
+BENCHMARK_TEMPLATE(BM_StringVectorHash, StdStringVectorHash)->Range(1, 8);
+
 }  // namespace
 }  // namespace tags
 }  // namespace opencensus
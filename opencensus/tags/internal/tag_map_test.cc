@@ -14,12 +14,16 @@
 
 #include "opencensus/tags/tag_map.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -39,15 +43,69 @@ TEST(TagMapTest, TagsSorted) {
   TagKey k1 = TagKey::Register("b");
   TagKey k2 = TagKey::Register("c");
   TagKey k3 = TagKey::Register("a");
-  const std::vector<std::pair<TagKey, std::string>> expected = {
+  const std::vector<std::pair<TagKey, absl::string_view>> expected = {
       {k1, "v"}, {k2, "v"}, {k3, "v"}};
   const std::vector<std::pair<TagKey, std::string>> tags(
       {{k2, "v"}, {k3, "v"}, {k1, "v"}});
-  EXPECT_THAT(TagMap(tags).tags(), ::testing::ElementsAreArray(expected));
-  EXPECT_THAT(TagMap({{k2, "v"}, {k1, "v"}, {k3, "v"}}).tags(),
+  EXPECT_THAT(TagMap(tags).tag_views(), ::testing::ElementsAreArray(expected));
+  EXPECT_THAT(TagMap({{k2, "v"}, {k1, "v"}, {k3, "v"}}).tag_views(),
               ::testing::ElementsAreArray(expected));
 }
 
+TEST(TagMapTest, ValuesInterned) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  std::string value = "interned";
+  TagMap ts1({{k1, value}});
+  TagMap ts2(std::vector<std::pair<TagKey, std::string>>({{k2, value}}));
+  EXPECT_EQ(ts1.tag_views()[0].second.data(),
+            ts2.tag_views()[0].second.data());
+  EXPECT_NE(value.data(), ts1.tag_views()[0].second.data());
+  // Values outlive the strings they were constructed from.
+  value = "overwritten";
+  EXPECT_EQ("interned", ts1.tag_views()[0].second);
+  EXPECT_EQ("interned", ts2.tag_views()[0].second);
+}
+
+TEST(TagMapTest, TagsCopiesViews) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  TagMap tags({{k2, "v2"}, {k1, "v1"}});
+  const std::vector<std::pair<TagKey, std::string>>& copies = tags.tags();
+  ASSERT_EQ(2, copies.size());
+  for (size_t i = 0; i < copies.size(); ++i) {
+    EXPECT_EQ(tags.tag_views()[i].first, copies[i].first);
+    EXPECT_EQ(tags.tag_views()[i].second, copies[i].second);
+  }
+  // Later calls return the same copies.
+  EXPECT_EQ(&copies, &tags.tags());
+  // Copies, moves and assignments give the right tags.
+  TagMap copy = tags;
+  EXPECT_EQ(copies, copy.tags());
+  TagMap moved = std::move(tags);
+  EXPECT_EQ(&copies, &moved.tags());
+  copy = TagMap({{k1, "v3"}});
+  EXPECT_THAT(copy.tags(), ::testing::ElementsAre(::testing::Pair(k1, "v3")));
+}
+
+TEST(TagMapTest, ValuesHeldByCopies) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  std::unique_ptr<TagMap> original(
+      new TagMap(std::vector<std::pair<TagKey, std::string>>({{k1, "held"}})));
+  TagMap copy = *original;
+  TagMap merged = original->WithAdditionalTags({{k2, "added"}});
+  TagMap selected = merged.WithOnlyKeys({k2});
+  original.reset();
+  // The copies keep the values after the TagMap that interned them is gone.
+  EXPECT_EQ("held", copy.tags()[0].second);
+  EXPECT_EQ(TagMap({{k1, "held"}}), copy);
+  TagMap moved = std::move(merged);
+  EXPECT_EQ(TagMap({{k1, "held"}, {k2, "added"}}), moved);
+  copy = selected;
+  EXPECT_EQ(TagMap({{k2, "added"}}), copy);
+}
+
 TEST(TagMapTest, EqualityDisregardsOrder) {
   TagKey k1 = TagKey::Register("k1");
   TagKey k2 = TagKey::Register("k2");
@@ -82,6 +140,14 @@ TEST(TagMapTest, HashRespectsKeyValuePairings) {
   EXPECT_NE(TagMap::Hash()(ts1), TagMap::Hash()(ts2));
 }
 
+TEST(TagMapTest, HashRespectsEveryTag) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  TagMap ts1({{k1, "v1"}, {k2, "v"}});
+  TagMap ts2({{k1, "v2"}, {k2, "v"}});
+  EXPECT_NE(TagMap::Hash()(ts1), TagMap::Hash()(ts2));
+}
+
 TEST(TagMapTest, UnorderedMap) {
   // Test that the operators and hash are compatible with std::unordered_map.
   TagKey key = TagKey::Register("key");
@@ -104,6 +170,71 @@ TEST(TagMapTest, DebugStringContainsTags) {
   EXPECT_THAT(s, HasSubstr("value2"));
 }
 
+TEST(TagMapTest, WithAdditionalTags) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  TagKey k3 = TagKey::Register("k3");
+  const TagMap tags({{k1, "v1"}, {k3, "v3"}});
+  const TagMap added = tags.WithAdditionalTags({{k2, "v2"}});
+  EXPECT_EQ(TagMap({{k1, "v1"}, {k2, "v2"}, {k3, "v3"}}), added);
+  EXPECT_EQ(TagMap::Hash()(TagMap({{k1, "v1"}, {k2, "v2"}, {k3, "v3"}})),
+            TagMap::Hash()(added));
+  EXPECT_EQ(TagMap({{k1, "v1"}, {k3, "v3"}}), tags);
+
+  // Additions replace the values of existing keys.
+  std::string value = "new";
+  const TagMap replaced = tags.WithAdditionalTags(
+      std::vector<std::pair<TagKey, std::string>>({{k3, value}, {k1, "v1"}}));
+  EXPECT_EQ(TagMap({{k1, "v1"}, {k3, "new"}}), replaced);
+  EXPECT_NE(value.data(), replaced.tag_views()[1].second.data());
+
+  EXPECT_EQ(tags, tags.WithAdditionalTags({}));
+  EXPECT_EQ(tags, TagMap({}).WithAdditionalTags({{k3, "v3"}, {k1, "v1"}}));
+}
+
+TEST(TagMapTest, WithOnlyKeys) {
+  TagKey k1 = TagKey::Register("k1");
+  TagKey k2 = TagKey::Register("k2");
+  TagKey k3 = TagKey::Register("k3");
+  const TagMap tags({{k1, "v1"}, {k3, "v3"}});
+  std::vector<TagKey> keys = {k3, k2};
+  std::sort(keys.begin(), keys.end());
+  EXPECT_FALSE(tags.HasOnlyKeys(keys));
+  const TagMap selected = tags.WithOnlyKeys(keys);
+  EXPECT_EQ(TagMap({{k3, "v3"}}), selected);
+  EXPECT_EQ(TagMap::Hash()(TagMap({{k3, "v3"}})), TagMap::Hash()(selected));
+  EXPECT_TRUE(selected.HasOnlyKeys(keys));
+
+  keys.push_back(k1);
+  std::sort(keys.begin(), keys.end());
+  EXPECT_TRUE(tags.HasOnlyKeys(keys));
+  EXPECT_EQ(tags, tags.WithOnlyKeys(keys));
+  EXPECT_EQ(TagMap({}), tags.WithOnlyKeys({}));
+  EXPECT_TRUE(TagMap({}).HasOnlyKeys({}));
+}
+
+TEST(TagMapTest, MoreTagsThanInline) {
+  std::vector<std::pair<TagKey, std::string>> tags;
+  for (int i = 0; i <= TagMap::kInlineTags; ++i) {
+    tags.emplace_back(TagKey::Register(absl::StrCat("inline_k", i)),
+                      absl::StrCat("v", i));
+  }
+  const TagMap first(std::vector<std::pair<TagKey, std::string>>(
+      tags.begin(), tags.end() - 1));
+  ASSERT_EQ(TagMap::kInlineTags, first.tags().size());
+  const TagMap all = first.WithAdditionalTags({tags.back()});
+  EXPECT_EQ(TagMap(tags), all);
+  TagMap copy = all;
+  EXPECT_EQ(all, copy);
+  EXPECT_EQ(TagMap::kInlineTags + 1, copy.tags().size());
+  copy = first;
+  EXPECT_EQ(first, copy);
+  EXPECT_EQ(first, all.WithOnlyKeys({first.tags()[0].first,
+                                     first.tags()[1].first,
+                                     first.tags()[2].first,
+                                     first.tags()[3].first}));
+}
+
 TEST(TagMapDeathTest, DuplicateKeysNotAllowed) {
   TagKey k = TagKey::Register("k");
   EXPECT_DEBUG_DEATH(
@@ -26,8 +26,9 @@ using ::opencensus::tags::TagMap;
 namespace opencensus {
 namespace tags {
 
+#ifndef OPENCENSUS_NOOP
 WithTagMap::WithTagMap(const TagMap& tags, bool cond)
-    : swapped_tags_(tags)
+    : swapped_context_(cond ? Context::Current().ReplaceTags(tags) : Context())
 #ifndef NDEBUG
       ,
       original_context_(Context::InternalMutableCurrent())
@@ -38,7 +39,8 @@ WithTagMap::WithTagMap(const TagMap& tags, bool cond)
 }
 
 WithTagMap::WithTagMap(TagMap&& tags, bool cond)
-    : swapped_tags_(std::move(tags))
+    : swapped_context_(cond ? Context::Current().ReplaceTags(std::move(tags))
+                            : Context())
 #ifndef NDEBUG
       ,
       original_context_(Context::InternalMutableCurrent())
@@ -60,9 +62,10 @@ WithTagMap::~WithTagMap() {
 void WithTagMap::ConditionalSwap() {
   if (cond_) {
     using std::swap;
-    swap(Context::InternalMutableCurrent()->tags_, swapped_tags_);
+    swap(*Context::InternalMutableCurrent(), swapped_context_);
   }
 }
+#endif  // OPENCENSUS_NOOP
 
 }  // namespace tags
 }  // namespace opencensus
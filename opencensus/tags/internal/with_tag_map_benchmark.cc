@@ -17,6 +17,7 @@
 #include <cstdlib>
 
 #include "benchmark/benchmark.h"
+#include "opencensus/tags/context_util.h"
 #include "opencensus/tags/tag_key.h"
 #include "opencensus/tags/tag_map.h"
 
@@ -72,6 +73,15 @@ void BM_WithTagMapConstructAndMove(benchmark::State& state) {
 }
 BENCHMARK(BM_WithTagMapConstructAndMove);
 
+void BM_GetCurrentTagMap(benchmark::State& state) {
+  const auto tags = Tags();
+  WithTagMap wt(tags);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetCurrentTagMap());
+  }
+}
+BENCHMARK(BM_GetCurrentTagMap);
+
 }  // namespace
 }  // namespace tags
 }  // namespace opencensus
@@ -0,0 +1,58 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TAGS_PROPAGATION_GRPC_TAGS_BIN_H_
+#define OPENCENSUS_TAGS_PROPAGATION_GRPC_TAGS_BIN_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/tags/tag_map.h"
+
+namespace opencensus {
+namespace tags {
+namespace propagation {
+
+// The maximum total length of the keys and values in a grpc-tags-bin header.
+constexpr int kMaxGrpcTagsBinTagsLen = 8192;
+
+// Parses the value of the binary grpc-tags-bin header into *tags. Returns
+// false, leaving *tags unchanged, if the header is malformed, has an
+// unsupported version, or its keys and values exceed kMaxGrpcTagsBinTagsLen.
+// If a key appears more than once, the last value wins.
+//
+// The format is a version byte (0), followed by any number of tags, each
+// encoded as:
+//   00                 (tag field)
+//   varint key length, key bytes
+//   varint value length, value bytes
+// Parsing stops at the first field with an unknown id. Keys and values must be
+// printable ASCII and at most 255 characters long, and keys must not be empty.
+//
+// Tags whose keys have not been registered in this process (with
+// TagKey::Register()) are dropped, so that peers cannot grow the registry.
+//
+// See also:
+// https://github.com/census-instrumentation/opencensus-specs/blob/master/encodings/BinaryEncoding.md
+bool FromGrpcTagsBinHeader(absl::string_view header, TagMap* tags);
+
+// Returns a value for the grpc-tags-bin header, or an empty string if the keys
+// and values of 'tags' exceed kMaxGrpcTagsBinTagsLen.
+std::string ToGrpcTagsBinHeader(const TagMap& tags);
+
+}  // namespace propagation
+}  // namespace tags
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TAGS_PROPAGATION_GRPC_TAGS_BIN_H_
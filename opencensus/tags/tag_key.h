@@ -20,6 +20,7 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace opencensus {
 namespace tags {
@@ -33,6 +34,11 @@ class TagKey final {
   // equal TagKeys.
   static TagKey Register(absl::string_view name);
 
+  // Returns the tag key registered with 'name', or nullopt if there is none.
+  // Unlike Register(), never adds to the registry, which is never freed, so it
+  // is safe to call with names from untrusted sources.
+  static absl::optional<TagKey> Lookup(absl::string_view name);
+
   const std::string& name() const;
 
   bool operator==(TagKey other) const { return id_ == other.id_; }
@@ -15,13 +15,16 @@
 #ifndef OPENCENSUS_TAGS_TAG_MAP_H_
 #define OPENCENSUS_TAGS_TAG_MAP_H_
 
+#include <atomic>
 #include <cstddef>
 #include <initializer_list>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "opencensus/tags/tag_key.h"
 
 namespace opencensus {
@@ -30,8 +33,21 @@ namespace tags {
 // TagMap represents an immutable map of TagKeys to tag values (strings), and
 // provides efficient equality and hash operations. A TagMap is expensive to
 // construct, and should be shared between uses where possible.
+//
+// Tag values are interned: each distinct value is stored once while any TagMap
+// holds it, and TagMaps hold counted references to the interned copies.
+// Hashing and equality therefore compare value addresses rather than contents.
+// Copying a TagMap takes a reference to each of its values, and a value is
+// freed with the last TagMap holding it, so values from requests or remote
+// peers use memory only while tags, stats deltas or view rows refer to them.
+//
+// Up to kInlineTags tags are stored inline, so typical TagMaps (including the
+// copies held by contexts and as stats delta keys) make no heap allocation
+// beyond interning values not currently held.
 class TagMap final {
  public:
+  static constexpr size_t kInlineTags = 4;
+
   // Both constructors are not explicit so that Record({}, {{"k", "v"}}) works.
   // This constructor is needed because even though we copy to a vector
   // internally because c++ cannot deduce the conversion needed.
@@ -41,12 +57,39 @@ class TagMap final {
   // TagMaps. It takes the argument by value to allow it to be moved.
   TagMap(std::vector<std::pair<TagKey, std::string>> tags);
 
+  TagMap(const TagMap& other);
+  TagMap(TagMap&& other) noexcept;
+  TagMap& operator=(TagMap other) noexcept;
+  ~TagMap();
+
   // Accesses the tags sorted by key (in an implementation-defined, not
-  // lexicographic, order).
-  const std::vector<std::pair<TagKey, std::string>>& tags() const {
+  // lexicographic, order). The span and the values it views are valid for the
+  // lifetime of the TagMap.
+  absl::Span<const std::pair<TagKey, absl::string_view>> tag_views() const {
     return tags_;
   }
 
+  // Returns copies of the tags, in the same order as tag_views(), valid for
+  // the lifetime of the TagMap. The copies are made by the first call, so
+  // prefer tag_views().
+  const std::vector<std::pair<TagKey, std::string>>& tags() const;
+
+  // Returns a TagMap holding the tags of this one and 'tags', whose values
+  // replace those of keys already present. Because this TagMap is already
+  // sorted, 'tags' is merged into it in linear time, which is cheaper than
+  // constructing a TagMap from the combined tags.
+  TagMap WithAdditionalTags(
+      std::initializer_list<std::pair<TagKey, absl::string_view>> tags) const;
+  TagMap WithAdditionalTags(
+      std::vector<std::pair<TagKey, std::string>> tags) const;
+
+  // Returns true if every tag's key is in 'keys', which must be sorted by
+  // TagKey::operator< and hold no duplicates.
+  bool HasOnlyKeys(const std::vector<TagKey>& keys) const;
+  // Returns a TagMap holding only the tags whose keys are in 'keys', which must
+  // be sorted as for HasOnlyKeys().
+  TagMap WithOnlyKeys(const std::vector<TagKey>& keys) const;
+
   struct Hash {
     std::size_t operator()(const TagMap& tags) const;
   };
@@ -59,11 +102,26 @@ class TagMap final {
   std::string DebugString() const;
 
  private:
+  typedef absl::InlinedVector<std::pair<TagKey, absl::string_view>,
+                              kInlineTags>
+      TagVector;
+
+  // Takes sorted, interned tags, each holding a reference that the TagMap
+  // adopts, and their hash.
+  TagMap(TagVector tags, std::size_t hash)
+      : hash_(hash), tags_(std::move(tags)) {}
+
   void Initialize();
+  // Returns this TagMap with 'additions', which may be in any order, merged
+  // in.
+  TagMap Merge(TagVector additions) const;
 
   std::size_t hash_;
-  // TODO: add an option to store string_views to avoid copies.
-  std::vector<std::pair<TagKey, std::string>> tags_;
+  // Values are views of interned strings, each holding one reference.
+  TagVector tags_;
+  // The copies returned by tags(), or null until it is first called.
+  mutable std::atomic<const std::vector<std::pair<TagKey, std::string>>*>
+      tag_copies_{nullptr};
 };
 
 }  // namespace tags
@@ -47,15 +47,26 @@ class WithTagMap {
   WithTagMap& operator=(const WithTagMap&) = delete;
   WithTagMap& operator=(WithTagMap&&) = delete;
 
+#ifndef OPENCENSUS_NOOP
   void ConditionalSwap();
 
-  TagMap swapped_tags_;
+  // The Context to install, and then the one to restore.
+  ::opencensus::context::Context swapped_context_;
 #ifndef NDEBUG
   const ::opencensus::context::Context* original_context_;
 #endif
   const bool cond_;
+#endif
 };
 
+#ifdef OPENCENSUS_NOOP
+// Built with OPENCENSUS_NOOP (see opencensus/trace/span.h), WithTagMap does
+// nothing.
+inline WithTagMap::WithTagMap(const TagMap& /*tags*/, bool /*cond*/) {}
+inline WithTagMap::WithTagMap(TagMap&& /*tags*/, bool /*cond*/) {}
+inline WithTagMap::~WithTagMap() {}
+#endif
+
 }  // namespace tags
 }  // namespace opencensus
 
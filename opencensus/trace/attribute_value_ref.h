@@ -26,6 +26,21 @@
 namespace opencensus {
 namespace trace {
 
+// StaticString marks a string whose storage outlives every span it is passed
+// to, such as a string literal. Spans keep a reference to a StaticString
+// attribute key or value instead of copying it. e.g.:
+//   span.AddAttribute(StaticString("http.method"), StaticString("GET"));
+// StaticString is thread-compatible.
+class StaticString final {
+ public:
+  constexpr explicit StaticString(absl::string_view value) : value_(value) {}
+
+  constexpr absl::string_view value() const { return value_; }
+
+ private:
+  absl::string_view value_;
+};
+
 // AttributeValueRef represents a reference to the value of an Attribute. It can
 // be one of the supported types: string, bool, or int64. In the case of string,
 // AttributeValueRef holds an absl::string_view, and the caller must ensure that
@@ -56,6 +71,12 @@ class AttributeValueRef final {
   AttributeValueRef(const char* string_value)
       : string_value_(string_value), type_(Type::kString) {}
 
+  // Construct from StaticString, which spans reference rather than copy.
+  AttributeValueRef(StaticString string_value)
+      : string_value_(string_value.value()),
+        type_(Type::kString),
+        is_static_(true) {}
+
   // Construct from std::string.
   template <typename Allocator>
   AttributeValueRef(const std::basic_string<char, std::char_traits<char>,
@@ -81,8 +102,10 @@ class AttributeValueRef final {
   absl::string_view string_value() const;
   bool bool_value() const;
   int64_t int_value() const;
+  // True if constructed from a StaticString.
+  bool is_static() const { return is_static_; }
 
-  // Equality of type and value.
+  // Equality of type and value. Whether values are static is not compared.
   bool operator==(const AttributeValueRef& v) const;
   bool operator!=(const AttributeValueRef& v) const;
 
@@ -97,6 +120,7 @@ class AttributeValueRef final {
     bool bool_value_;
   };
   Type type_;
+  bool is_static_ = false;
 };
 
 }  // namespace trace
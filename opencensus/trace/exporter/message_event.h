@@ -58,6 +58,17 @@ class MessageEvent final {
   uint32_t uncompressed_size_;
 };
 
+// The number and total sizes of the MessageEvents added to a Span, including
+// those that were dropped.
+struct MessageEventTotals {
+  int64_t sent_messages = 0;
+  int64_t sent_compressed_bytes = 0;
+  int64_t sent_uncompressed_bytes = 0;
+  int64_t received_messages = 0;
+  int64_t received_compressed_bytes = 0;
+  int64_t received_uncompressed_bytes = 0;
+};
+
 }  // namespace exporter
 }  // namespace trace
 }  // namespace opencensus
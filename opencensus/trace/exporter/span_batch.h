@@ -0,0 +1,275 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_EXPORTER_SPAN_BATCH_H_
+#define OPENCENSUS_TRACE_EXPORTER_SPAN_BATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/trace/attribute_value_ref.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/trace/trace_id.h"
+
+namespace opencensus {
+namespace trace {
+namespace exporter {
+
+// SpanBatch holds a batch of spans for export, like a vector of SpanData, but
+// with the strings of all its spans copied into a few large blocks, and their
+// attributes, annotations, message events and links in one flat array each,
+// rather than in allocations of their own. Building and destroying a batch
+// thus costs a few allocations however many spans and events it holds.
+//
+// Accessors return views into the batch, which are valid for its lifetime.
+// SpanBatch is immutable once built, and is shared with handlers as a
+// shared_ptr<const SpanBatch> (see SpanExporter::Handler::ExportSpanBatch()).
+class SpanBatch final {
+ private:
+  // The first and number of a span's (or event's) elements of one of the
+  // batch's arrays, until Build() resolves them.
+  struct Range {
+    uint32_t begin = 0;
+    uint32_t size = 0;
+  };
+
+ public:
+  class AttributeView final {
+   public:
+    absl::string_view key() const { return key_; }
+    AttributeValueRef value() const { return value_; }
+
+   private:
+    friend class SpanBatch;
+    AttributeView(absl::string_view key, AttributeValueRef value)
+        : key_(key), value_(value) {}
+
+    absl::string_view key_;
+    AttributeValueRef value_;
+  };
+
+  class AnnotationView final {
+   public:
+    absl::Time timestamp() const { return timestamp_; }
+    absl::string_view description() const { return description_; }
+    absl::Span<const AttributeView> attributes() const { return attributes_; }
+
+   private:
+    friend class SpanBatch;
+    AnnotationView(absl::Time timestamp, absl::string_view description)
+        : timestamp_(timestamp), description_(description) {}
+
+    absl::Time timestamp_;
+    absl::string_view description_;
+    Range attribute_range_;
+    absl::Span<const AttributeView> attributes_;
+  };
+
+  class MessageEventView final {
+   public:
+    absl::Time timestamp() const { return timestamp_; }
+    const MessageEvent& event() const { return event_; }
+
+   private:
+    friend class SpanBatch;
+    MessageEventView(absl::Time timestamp, const MessageEvent& event)
+        : timestamp_(timestamp), event_(event) {}
+
+    absl::Time timestamp_;
+    MessageEvent event_;
+  };
+
+  class LinkView final {
+   public:
+    Link::Type type() const { return type_; }
+    TraceId trace_id() const { return trace_id_; }
+    SpanId span_id() const { return span_id_; }
+    absl::Span<const AttributeView> attributes() const { return attributes_; }
+
+   private:
+    friend class SpanBatch;
+    LinkView(Link::Type type, TraceId trace_id, SpanId span_id)
+        : type_(type), trace_id_(trace_id), span_id_(span_id) {}
+
+    Link::Type type_;
+    TraceId trace_id_;
+    SpanId span_id_;
+    Range attribute_range_;
+    absl::Span<const AttributeView> attributes_;
+  };
+
+  // A span of the batch. The accessors match those of SpanData.
+  class SpanView final {
+   public:
+    absl::string_view name() const { return name_; }
+    SpanContext context() const { return context_; }
+    SpanId parent_span_id() const { return parent_span_id_; }
+
+    absl::Span<const AnnotationView> annotations() const {
+      return annotations_;
+    }
+    int num_annotations_dropped() const { return num_annotations_dropped_; }
+    absl::Span<const MessageEventView> message_events() const {
+      return message_events_;
+    }
+    int num_message_events_dropped() const {
+      return num_message_events_dropped_;
+    }
+    const MessageEventTotals& message_event_totals() const {
+      return message_event_totals_;
+    }
+    absl::Span<const LinkView> links() const { return links_; }
+    int num_links_dropped() const { return num_links_dropped_; }
+    absl::Span<const AttributeView> attributes() const { return attributes_; }
+    int num_attributes_dropped() const { return num_attributes_dropped_; }
+    int64_t num_bytes_dropped() const { return num_bytes_dropped_; }
+
+    bool has_ended() const { return has_ended_; }
+    absl::Time start_time() const { return start_time_; }
+    absl::Time end_time() const { return end_time_; }
+    StatusCode status_code() const { return status_code_; }
+    absl::string_view status_message() const { return status_message_; }
+    bool has_remote_parent() const { return has_remote_parent_; }
+
+   private:
+    friend class SpanBatch;
+    SpanView(absl::string_view name, const SpanContext& context,
+             SpanId parent_span_id, bool has_remote_parent,
+             absl::Time start_time)
+        : name_(name),
+          context_(context),
+          parent_span_id_(parent_span_id),
+          start_time_(start_time),
+          has_remote_parent_(has_remote_parent) {}
+
+    absl::string_view name_;
+    SpanContext context_;
+    SpanId parent_span_id_;
+    Range annotation_range_;
+    Range message_event_range_;
+    Range link_range_;
+    Range attribute_range_;
+    absl::Span<const AnnotationView> annotations_;
+    absl::Span<const MessageEventView> message_events_;
+    absl::Span<const LinkView> links_;
+    absl::Span<const AttributeView> attributes_;
+    MessageEventTotals message_event_totals_;
+    int num_annotations_dropped_ = 0;
+    int num_message_events_dropped_ = 0;
+    int num_links_dropped_ = 0;
+    int num_attributes_dropped_ = 0;
+    int64_t num_bytes_dropped_ = 0;
+    absl::Time start_time_;
+    absl::Time end_time_;
+    StatusCode status_code_ = StatusCode::OK;
+    absl::string_view status_message_;
+    bool has_remote_parent_;
+    bool has_ended_ = false;
+  };
+
+  // Builds a SpanBatch one span at a time. Strings passed to the builder are
+  // copied into the batch, except StaticStrings and span names (which are
+  // interned), which are referenced. Used by the span exporter; visible for
+  // testing.
+  class Builder final {
+   public:
+    // 'num_spans' reserves room for that many spans.
+    explicit Builder(size_t num_spans = 0);
+
+    // Starts the next span. Until the next StartSpan() or Build(), the calls
+    // below add to it.
+    void StartSpan(absl::string_view name, const SpanContext& context,
+                   SpanId parent_span_id, bool has_remote_parent,
+                   absl::Time start_time);
+    void AddAttribute(absl::string_view key, AttributeValueRef value);
+    void AddAnnotation(absl::Time timestamp, const Annotation& annotation);
+    void AddMessageEvent(absl::Time timestamp, const MessageEvent& event);
+    void AddLink(const Link& link);
+    void SetDropped(int num_attributes_dropped, int num_annotations_dropped,
+                    int num_message_events_dropped, int num_links_dropped,
+                    int64_t num_bytes_dropped);
+    void SetMessageEventTotals(const MessageEventTotals& totals);
+    // Marks the span as ended.
+    void EndSpan(absl::Time end_time, const Status& status);
+
+    // Adds a copy of 'span', as a whole.
+    void AddSpan(const SpanData& span);
+
+    // Returns the batch. The builder must not be used afterwards.
+    std::shared_ptr<const SpanBatch> Build();
+
+   private:
+    // Returns a copy of 'value' in the batch's blocks.
+    absl::string_view CopyString(absl::string_view value);
+    // Returns 'value', with a string value copied unless static.
+    AttributeValueRef CopyValue(AttributeValueRef value);
+    AttributeValueRef CopyValue(const AttributeValue& value);
+    // Copies 'attributes' to the end of 'target', one of the batch's
+    // attribute arrays, and returns their range.
+    template <typename Map>
+    Range CopyAttributes(const Map& attributes,
+                         std::vector<AttributeView>* target);
+
+    std::unique_ptr<SpanBatch> batch_;
+    // The unused part of the last block.
+    char* next_ = nullptr;
+    size_t remaining_ = 0;
+  };
+
+  SpanBatch(const SpanBatch&) = delete;
+  SpanBatch(SpanBatch&&) = delete;
+  SpanBatch& operator=(const SpanBatch&) = delete;
+  SpanBatch& operator=(SpanBatch&&) = delete;
+
+  const std::vector<SpanView>& spans() const { return spans_; }
+  size_t size() const { return spans_.size(); }
+  bool empty() const { return spans_.empty(); }
+
+ private:
+  SpanBatch() = default;
+
+  // Points the spans' and events' views at their elements of the arrays.
+  void Resolve();
+
+  std::vector<SpanView> spans_;
+  // The spans' attributes, and separately those of annotations and links, so
+  // that each span's attributes stay contiguous whatever order they are added
+  // in.
+  std::vector<AttributeView> attributes_;
+  std::vector<AttributeView> event_attributes_;
+  std::vector<AnnotationView> annotations_;
+  std::vector<MessageEventView> message_events_;
+  std::vector<LinkView> links_;
+  // The blocks holding the batch's strings.
+  std::vector<std::unique_ptr<char[]>> blocks_;
+};
+
+}  // namespace exporter
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_EXPORTER_SPAN_BATCH_H_
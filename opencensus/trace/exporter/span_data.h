@@ -15,6 +15,7 @@
 #ifndef OPENCENSUS_TRACE_EXPORTER_SPAN_DATA_H_
 #define OPENCENSUS_TRACE_EXPORTER_SPAN_DATA_H_
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -77,15 +78,17 @@ class SpanData final {
     int dropped_events_count_;
   };
 
-  // The constructor is visible for test purposes. Users are expected to get
-  // SpanData from a Span object.
+  // Users are expected to get SpanData from a Span object; the constructor is
+  // visible for tests and for spans passed to SpanExporter::ExportSpans().
   SpanData(absl::string_view name, SpanContext context, SpanId parent_span_id,
            TimeEvents<Annotation>&& annotations,
            TimeEvents<MessageEvent>&& message_events, std::vector<Link>&& links,
            int num_links_dropped,
            std::unordered_map<std::string, AttributeValue>&& attributes,
            int num_attributes_dropped, bool has_ended, absl::Time start_time,
-           absl::Time end_time, Status status, bool has_remote_parent);
+           absl::Time end_time, Status status, bool has_remote_parent,
+           int64_t num_bytes_dropped = 0,
+           MessageEventTotals message_event_totals = MessageEventTotals());
 
   // --- Accessors ---
 
@@ -107,6 +110,10 @@ class SpanData final {
   // was sent.
   const TimeEvents<MessageEvent>& message_events() const;
 
+  // The totals of all message events, including those not in
+  // message_events() (see StartSpanOptions::summarize_message_events).
+  const MessageEventTotals& message_event_totals() const;
+
   // Links to spans in other traces.
   const std::vector<Link>& links() const;
 
@@ -120,6 +127,10 @@ class SpanData final {
   // The number of attributes that were dropped.
   int num_attributes_dropped() const;
 
+  // The bytes of attribute keys and values and annotation descriptions that
+  // were truncated or dropped (see TraceParams::max_span_bytes).
+  int64_t num_bytes_dropped() const;
+
   // True if the span ended.
   bool has_ended() const;
 
@@ -140,15 +151,18 @@ class SpanData final {
   std::string DebugString() const;
 
  private:
-  std::string name_;
+  // Interned, so that copies share the name.
+  absl::string_view name_;
   SpanContext context_;
   SpanId parent_span_id_;
   TimeEvents<Annotation> annotations_;
   TimeEvents<MessageEvent> message_events_;
+  MessageEventTotals message_event_totals_;
   std::vector<Link> links_;
   std::unordered_map<std::string, AttributeValue> attributes_;
   int num_links_dropped_;
   int num_attributes_dropped_;
+  int64_t num_bytes_dropped_;
   absl::Time start_time_;
   absl::Time end_time_;
   Status status_;
@@ -15,10 +15,17 @@
 #ifndef OPENCENSUS_TRACE_EXPORTER_SPAN_EXPORTER_H_
 #define OPENCENSUS_TRACE_EXPORTER_SPAN_EXPORTER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "absl/time/time.h"
+#include "opencensus/trace/exporter/span_batch.h"
 #include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/span_priority.h"
 
 namespace opencensus {
 namespace trace {
@@ -35,11 +42,144 @@ class SpanExporter final {
    public:
     virtual ~Handler() = default;
     virtual void Export(const std::vector<SpanData>& spans) = 0;
+
+    // Exports a batch of spans, which is shared with the other handlers and
+    // never modified. The default calls Export(*spans). Handlers that export
+    // asynchronously can override this to retain the batch, rather than copy
+    // it, until they are done with it; Export() is then only called by this
+    // default.
+    virtual void ExportBatch(
+        std::shared_ptr<const std::vector<SpanData>> spans) {
+      Export(*spans);
+    }
+
+    // If this returns true, each batch is passed to ExportSpanBatch() as a
+    // SpanBatch, instead of to ExportBatch() as SpanData. A SpanBatch keeps
+    // the strings and events of all its spans in a few allocations, so
+    // handlers that only read spans to serialize them can avoid an allocation
+    // per attribute and event. Read once, when the handler is registered.
+    virtual bool ExportsSpanBatches() const { return false; }
+    virtual void ExportSpanBatch(std::shared_ptr<const SpanBatch> batch) {}
+
+    // If this returns true, the handler is also passed chunks of long-running
+    // spans (see Options::running_span_flush_interval) by ExportSpanChunks():
+    // SpanData that have not ended, each with the annotations and message
+    // events its span recorded since its previous chunk, ending at the time
+    // the chunk was taken. A span's chunks and the span itself, once ended,
+    // share its SpanContext; the ended span only holds the events recorded
+    // after its last chunk. Read once, when the handler is registered.
+    virtual bool ExportsSpanChunks() const { return false; }
+    virtual void ExportSpanChunks(const std::vector<SpanData>& chunks) {}
+  };
+
+  // Options controlling how ended spans are buffered and batched for export.
+  struct Options {
+    // What to do with an ended span when the buffer is full.
+    enum class DropPolicy {
+      kDropNewest,  // Drop the span being ended.
+      kDropOldest,  // Drop the oldest buffered span to make room.
+    };
+
+    // The maximum number of ended spans buffered for export, rounded up to a
+    // power of 2.
+    size_t buffer_capacity = 2048;
+    DropPolicy drop_policy = DropPolicy::kDropNewest;
+    // The maximum number of spans passed to each Handler::Export() call. The
+    // export also runs early once this many spans are buffered.
+    size_t batch_size = 64;
+    // The maximum time spans are buffered before being exported.
+    absl::Duration flush_interval = absl::Seconds(5);
+    // If true, the spans exported together are ordered by trace ID, so that
+    // the spans of a trace that ended before the same export reach handlers
+    // adjacent, and mostly in the same batch. Spans are only reordered within
+    // an export, so this adds no latency.
+    bool group_by_trace = false;
+
+    // Incremental export of long-running spans. If finite, and a handler
+    // exports span chunks, each export also takes a chunk of every running
+    // span that has recorded annotations or message events and that started,
+    // or took its last chunk, at least running_span_flush_interval ago. The
+    // events in the chunk are then freed, so that a span lasting hours holds
+    // at most an interval's worth of events, and its progress is visible
+    // before it ends. Handlers that do not export chunks never see the
+    // chunked events. Spans started with StartSpanOptions::single_writer are
+    // not chunked.
+    absl::Duration running_span_flush_interval = absl::InfiniteDuration();
+
+    // Backlog feedback. If backlog_high_water is positive, the default
+    // ProbabilitySampler is throttled while handlers cannot keep up: each
+    // export that starts with more than backlog_high_water spans in the
+    // backlog (the buffer, plus the batches awaiting the slowest handler)
+    // halves its probability once more, up to backlog_max_halvings times, and
+    // each export that starts with at most half as many doubles it back. This
+    // adds to TraceConfig::SetSamplingReduction(), and like it does not affect
+    // custom samplers or Spans whose parent is sampled.
+    size_t backlog_high_water = 0;
+    int backlog_max_halvings = 8;
+
+    // Tail-based sampling. If tail_sampling_wait is positive, ended spans are
+    // held until tail_sampling_wait after the first span of their trace ended,
+    // and the trace is then exported only if one of its spans took at least
+    // tail_sampling_min_latency or, if tail_sampling_errors, ended with a
+    // status other than OK. Other traces are dropped without being converted
+    // for export, so sampling (more) spans with a Sampler and exporting only
+    // the interesting traces costs little more than recording them. Spans of
+    // a kept trace that end later are exported without waiting. At most
+    // tail_sampling_max_spans spans are held; beyond that, the traces held
+    // longest are decided early. Decisions are made by the export task, so
+    // traces reach handlers up to flush_interval after the wait.
+    absl::Duration tail_sampling_wait = absl::ZeroDuration();
+    absl::Duration tail_sampling_min_latency = absl::InfiniteDuration();
+    bool tail_sampling_errors = true;
+    size_t tail_sampling_max_spans = 16384;
+
+    // Priority lanes. If priority_lanes is set, the buffer holds the ended
+    // spans of each SpanPriority apart, and exports drain the higher
+    // priorities first. A span has the priority given by StartSpanOptions,
+    // raised to SpanPriority::kHigh if it ended with a status other than OK or
+    // took at least the slow span threshold for its name: the entry for its
+    // name in slow_span_thresholds, or else slow_span_threshold. While the
+    // buffer is full, an ended span drops a buffered span of the lowest lower
+    // priority to make room, and is otherwise handled by drop_policy within
+    // its own priority, so that error and slow spans are the last dropped.
+    bool priority_lanes = false;
+    absl::Duration slow_span_threshold = absl::InfiniteDuration();
+    std::unordered_map<std::string, absl::Duration> slow_span_thresholds;
   };
 
-  // This should only be called by Handler's Register() method.
+  // Sets the options for span export. buffer_capacity, drop_policy and the
+  // tail sampling and priority lane options take effect only if called before
+  // the first handler is registered; the other options take effect from the
+  // next export.
+  static void SetOptions(const Options& options);
+
+  // This should only be called by Handler's Register() method. Handlers export
+  // on threads of their own, except in common::Scheduler's manual mode, where
+  // they are called on the thread running the export.
   static void RegisterHandler(std::unique_ptr<Handler> handler);
 
+  // Exports spans built elsewhere, e.g. received by a proxy or collector from
+  // processes in other runtimes, so that they can be forwarded through the
+  // registered handlers. The spans skip the span stores, the buffer of ended
+  // spans and tail sampling: they are split into batches of batch_size on the
+  // calling thread and posted straight to each handler's queue. Batches a
+  // handler's full queue drops count towards NumDroppedSpans(). Does nothing
+  // before the first handler is registered or after Shutdown().
+  static void ExportSpans(std::vector<SpanData> spans);
+
+  // Returns the number of ended spans dropped because the buffer was full.
+  static uint64_t NumDroppedSpans();
+  // Returns the number of ended spans of 'priority' dropped because the buffer
+  // was full. Only counted with Options::priority_lanes.
+  static uint64_t NumDroppedSpans(SpanPriority priority);
+
+  // Stops accepting ended spans and periodic exports, exports the spans
+  // already buffered, and waits until 'deadline' for every handler to finish
+  // exporting them. Spans ending concurrently with Shutdown() may be dropped.
+  // Returns true if all handlers finished in time. Export cannot be restarted;
+  // later calls wait for the handlers again.
+  static bool Shutdown(absl::Time deadline);
+
  private:
   friend class SpanExporterTestPeer;
 
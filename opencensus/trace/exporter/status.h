@@ -44,6 +44,9 @@ class Status final {
   // Returns the canonical code for this Status value.
   StatusCode CanonicalCode() const { return code_; }
 
+  // Returns the name of the canonical code, e.g. "DEADLINE_EXCEEDED".
+  absl::string_view CanonicalCodeString() const;
+
   // Compares both code and message.
   bool operator==(const Status& that) const;
   bool operator!=(const Status& that) const;
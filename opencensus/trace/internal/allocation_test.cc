@@ -0,0 +1,143 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tracks the steady-state heap allocations of the tracing hot paths, so that
+// changes which add allocations are caught.
+
+#include <cstdint>
+#include <string>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/allocation_counter.h"
+#include "opencensus/trace/attribute_value_ref.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_batch.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/propagation/cloud_trace_context.h"
+#include "opencensus/trace/propagation/grpc_trace_bin.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/trace/with_span.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+using ::opencensus::common::AllocationsPerOperation;
+
+TEST(AllocationTest, UnsampledSpan) {
+  static NeverSampler sampler;
+  EXPECT_EQ(0, AllocationsPerOperation([]() {
+              auto span = Span::StartSpan("Unsampled", nullptr, {&sampler});
+              span.AddAttribute("key", 123);
+              span.End();
+            }));
+}
+
+TEST(AllocationTest, SampledSpan) {
+  static AlwaysSampler sampler;
+  // The SpanImpl and its entry in the running span store. Ended spans are
+  // occasionally sampled into the local span store, which may allocate.
+  EXPECT_LE(AllocationsPerOperation([]() {
+              auto span = Span::StartSpan("Sampled", nullptr, {&sampler});
+              span.End();
+            }),
+            2.5);
+}
+
+TEST(AllocationTest, AddAttribute) {
+  static AlwaysSampler sampler;
+  auto span = Span::StartSpan("AddAttribute", nullptr, {&sampler});
+  // Overwriting an attribute reuses its storage.
+  EXPECT_EQ(0, AllocationsPerOperation(
+                   [&span]() { span.AddAttribute("key", 123); }));
+  EXPECT_EQ(0, AllocationsPerOperation([&span]() {
+              span.AddAttribute(StaticString("static_key"),
+                                StaticString("value"));
+            }));
+  span.End();
+}
+
+TEST(AllocationTest, LazyAnnotationOnUnsampledSpan) {
+  static NeverSampler sampler;
+  auto span = Span::StartSpan("Unsampled", nullptr, {&sampler});
+  EXPECT_EQ(0, AllocationsPerOperation([&span]() {
+              span.AddAnnotation([]() { return std::string(100, 'a'); });
+              span.AddAttribute("key", []() { return std::string(100, 'a'); });
+            }));
+  span.End();
+}
+
+TEST(AllocationTest, WithSpan) {
+  static AlwaysSampler sampler;
+  auto span = Span::StartSpan("WithSpan", nullptr, {&sampler});
+  EXPECT_EQ(0, AllocationsPerOperation([&span]() { WithSpan ws(span); }));
+  span.End();
+}
+
+TEST(AllocationTest, PropagationEncoders) {
+  static AlwaysSampler sampler;
+  auto span = Span::StartSpan("Propagation", nullptr, {&sampler});
+  const SpanContext ctx = span.context();
+  uint8_t grpc_trace_bin[propagation::kGrpcTraceBinHeaderLen];
+  char trace_parent[propagation::kTraceParentHeaderLen];
+  char cloud_trace[propagation::kMaxCloudTraceContextHeaderLen];
+  EXPECT_EQ(0, AllocationsPerOperation([&]() {
+              propagation::ToGrpcTraceBinHeader(ctx, grpc_trace_bin);
+              propagation::ToTraceParentHeader(ctx, trace_parent);
+              propagation::ToCloudTraceContextHeader(ctx, cloud_trace);
+            }));
+  span.End();
+}
+
+TEST(AllocationTest, SpanBatch) {
+  const exporter::Annotation annotation(
+      "An annotation description",
+      {{"annotation_key",
+        exporter::AttributeValue(AttributeValueRef("annotation value"))}});
+  const exporter::MessageEvent message_event(
+      exporter::MessageEvent::Type::SENT, 1, 100, 200);
+  const std::string value(20, 'v');
+  const exporter::Status status(StatusCode::UNKNOWN, "error message");
+  // Building and destroying a batch of 1000 spans, with 7000 strings, costs
+  // a few allocations per array and block rather than one per string.
+  EXPECT_LE(AllocationsPerOperation(
+                [&]() {
+                  exporter::SpanBatch::Builder builder(1000);
+                  for (int i = 0; i < 1000; ++i) {
+                    builder.StartSpan("SpanBatch", SpanContext(), SpanId(),
+                                      false, absl::UnixEpoch());
+                    builder.AddAttribute("key1", value);
+                    builder.AddAttribute("key2", value);
+                    builder.AddAttribute("key3", 123);
+                    builder.AddAnnotation(absl::UnixEpoch(), annotation);
+                    builder.AddMessageEvent(absl::UnixEpoch(), message_event);
+                    builder.EndSpan(absl::UnixEpoch(), status);
+                  }
+                  builder.Build();
+                },
+                10, 1),
+            64);
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
@@ -14,6 +14,7 @@
 
 #include "opencensus/trace/internal/attribute_list.h"
 
+#include <string>
 #include <utility>
 
 #include "absl/strings/string_view.h"
@@ -21,6 +22,81 @@
 namespace opencensus {
 namespace trace {
 
+constexpr int AttributeList::kInlineAttributes;
+
+namespace {
+
+// The value stored in place of a StaticString value.
+exporter::AttributeValue OwnedValue(AttributeValueRef value) {
+  return exporter::AttributeValue(value.is_static() ? AttributeValueRef(false)
+                                                    : value);
+}
+
+}  // namespace
+
+AttributeList::Attribute::Attribute(absl::string_view key,
+                                    AttributeValueRef value)
+    : owned_key_(key),
+      value_(OwnedValue(value)),
+      static_value_(value.is_static() ? value.string_value()
+                                      : absl::string_view()),
+      is_static_value_(value.is_static()) {}
+
+AttributeList::Attribute::Attribute(StaticString key, AttributeValueRef value)
+    : static_key_(key.value().data() != nullptr ? key.value() : ""),
+      value_(OwnedValue(value)),
+      static_value_(value.is_static() ? value.string_value()
+                                      : absl::string_view()),
+      is_static_value_(value.is_static()) {}
+
+exporter::AttributeValue AttributeList::Attribute::value() const {
+  if (is_static_value_) {
+    return exporter::AttributeValue(AttributeValueRef(static_value_));
+  }
+  return value_;
+}
+
+AttributeValueRef AttributeList::Attribute::value_ref() const {
+  if (is_static_value_) {
+    return AttributeValueRef(StaticString(static_value_));
+  }
+  switch (value_.type()) {
+    case exporter::AttributeValue::Type::kString:
+      return AttributeValueRef(value_.string_value());
+    case exporter::AttributeValue::Type::kBool:
+      return AttributeValueRef(value_.bool_value());
+    case exporter::AttributeValue::Type::kInt:
+      break;
+  }
+  return AttributeValueRef(value_.int_value());
+}
+
+void AttributeList::Attribute::set_value(AttributeValueRef value) {
+  value_ = OwnedValue(value);
+  is_static_value_ = value.is_static();
+  static_value_ = is_static_value_ ? value.string_value() : absl::string_view();
+}
+
+std::pair<std::string, exporter::AttributeValue>
+AttributeList::Attribute::Release() {
+  std::string key = static_key_.data() != nullptr ? std::string(static_key_)
+                                                  : std::move(owned_key_);
+  if (is_static_value_) {
+    return {std::move(key),
+            exporter::AttributeValue(AttributeValueRef(static_value_))};
+  }
+  return {std::move(key), std::move(value_)};
+}
+
+size_t AttributeList::Attribute::OwnedBytes() const {
+  size_t bytes = owned_key_.size();
+  if (!is_static_value_ &&
+      value_.type() == exporter::AttributeValue::Type::kString) {
+    bytes += value_.string_value().size();
+  }
+  return bytes;
+}
+
 uint32_t AttributeList::num_attributes_dropped() const {
   return total_recorded_attributes_ - attributes_.size();
 }
@@ -30,25 +106,66 @@ uint32_t AttributeList::num_attributes_added() const {
 }
 
 void AttributeList::AddAttribute(absl::string_view key,
-                                 exporter::AttributeValue&& value) {
+                                 AttributeValueRef value) {
   // Blank span has 0 max attributes.
-  if (max_attributes_ == 0) {
+  if (max_attributes() == 0) {
+    return;
+  }
+  Attribute* existing = Find(key);
+  if (!FitToBudget(key, existing == nullptr, &value)) {
     return;
   }
+  if (existing != nullptr) {
+    existing->set_value(value);
+  } else {
+    Append(Attribute(key, value));
+  }
+}
 
-  std::string key_string(key);
-  auto it = attributes_.find(key_string);
-  if (it != attributes_.end()) {
-    it->second = std::move(value);
+void AttributeList::AddAttribute(StaticString key, AttributeValueRef value) {
+  if (max_attributes() == 0) {
     return;
   }
+  Attribute* existing = Find(key.value());
+  if (!FitToBudget(key.value(), existing == nullptr, &value)) {
+    return;
+  }
+  if (existing != nullptr) {
+    existing->set_value(value);
+  } else {
+    Append(Attribute(key, value));
+  }
+}
+
+AttributeList::Attribute* AttributeList::Find(absl::string_view key) {
+  for (auto& attribute : attributes_) {
+    if (attribute.key() == key) {
+      return &attribute;
+    }
+  }
+  return nullptr;
+}
+
+bool AttributeList::FitToBudget(absl::string_view key, bool is_new,
+                                AttributeValueRef* value) {
+  if (byte_budget_ == nullptr || !byte_budget_->limited()) {
+    return true;
+  }
+  *value = byte_budget_->TruncateValue(*value);
+  if (byte_budget_->TryConsume(ByteBudget::AttributeBytes(key, *value))) {
+    return true;
+  }
+  if (is_new) {
+    total_recorded_attributes_++;
+  }
+  return false;
+}
 
-  if (attributes_.size() >= max_attributes_) {
-    // TODO: This should be changed to a LRU mechanism.  Just remove
-    // first element for now.
+void AttributeList::Append(Attribute attribute) {
+  if (attributes_.size() >= max_attributes()) {
     attributes_.erase(attributes_.begin());
   }
-  attributes_.insert({key_string, std::move(value)});
+  attributes_.push_back(std::move(attribute));
   total_recorded_attributes_++;
 }
 
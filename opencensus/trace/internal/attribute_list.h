@@ -15,12 +15,17 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_ATTRIBUTE_LIST_H_
 #define OPENCENSUS_TRACE_INTERNAL_ATTRIBUTE_LIST_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <utility>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
+#include "opencensus/trace/attribute_value_ref.h"
 #include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/internal/byte_budget.h"
+#include "opencensus/trace/internal/fixed_trace_limits.h"
 
 namespace opencensus {
 namespace trace {
@@ -28,10 +33,63 @@ namespace trace {
 // Stores a list of AttributesValues that are recorded within a span. The
 // AttributeValues are stored in an unordered fashion and accessed with a
 // string key. AttributeList is thread-compatible.
+// AttributeList holds up to max_attributes attributes, evicting the oldest
+// when full. Spans carry few attributes, so they are kept in insertion order in
+// a flat array, the first kInlineAttributes inline, and keys are found by
+// linear search. Keys and string values passed as StaticString are referenced
+// rather than copied, and only copied when converted to SpanData. If given a
+// ByteBudget, string values are truncated and attributes beyond the budget
+// dropped before anything is copied. If the limits are fixed at compile time
+// (see fixed_trace_limits.h), max_attributes is fixed and all attributes are
+// stored inline.
 class AttributeList final {
  public:
-  explicit AttributeList(uint32_t max_attributes = 0)
-      : total_recorded_attributes_(0), max_attributes_(max_attributes) {}
+  static constexpr int kInlineAttributes =
+      kFixedMaxAttributes != 0 ? kFixedMaxAttributes : 8;
+
+  // An attribute, whose key and string value are either owned or refer to a
+  // StaticString.
+  class Attribute final {
+   public:
+    Attribute(absl::string_view key, AttributeValueRef value);
+    Attribute(StaticString key, AttributeValueRef value);
+
+    absl::string_view key() const {
+      return static_key_.data() != nullptr ? static_key_ : owned_key_;
+    }
+    // Returns a copy of the value.
+    exporter::AttributeValue value() const;
+    // Returns the value without copying it, valid until the attribute is
+    // changed. A static string value is returned as static.
+    AttributeValueRef value_ref() const;
+    void set_value(AttributeValueRef value);
+
+    // Returns the key and value, moving out owned storage.
+    std::pair<std::string, exporter::AttributeValue> Release();
+
+    // The bytes of the key and string value held by this attribute, as opposed
+    // to a StaticString.
+    size_t OwnedBytes() const;
+
+   private:
+    // Null unless the key is static.
+    absl::string_view static_key_;
+    std::string owned_key_;
+    // Holds a placeholder if is_static_value_.
+    exporter::AttributeValue value_;
+    absl::string_view static_value_;
+    bool is_static_value_;
+  };
+
+  typedef absl::InlinedVector<Attribute, kInlineAttributes> Attributes;
+
+  // 'byte_budget', if not null, must outlive the AttributeList.
+  explicit AttributeList(uint32_t max_attributes = 0,
+                         ByteBudget* byte_budget = nullptr)
+      : total_recorded_attributes_(0),
+        max_attributes_(kFixedMaxAttributes != 0 ? kFixedMaxAttributes
+                                                 : max_attributes),
+        byte_budget_(byte_budget) {}
 
   // Returns the number of the dropped attributes.
   uint32_t num_attributes_dropped() const;
@@ -39,22 +97,36 @@ class AttributeList final {
   // Returns the number of recorded attributes, including dropped attributes.
   uint32_t num_attributes_added() const;
 
-  // Adds an AttributeValue to the list or updates an existing AttributeValue.
-  // If max_attributes_ is exceeded, it will evict one of the previous
-  // AttributeValues.
-  void AddAttribute(absl::string_view key, exporter::AttributeValue&& value);
-
-  // Returns an unordered map of all the attributes that are currently contained
-  // within the list.
-  const std::unordered_map<std::string, exporter::AttributeValue>& attributes()
-      const {
-    return attributes_;
+  // The maximum number of attributes held; 0 if attributes are not recorded.
+  uint32_t max_attributes() const {
+    return kFixedMaxAttributes != 0 ? kFixedMaxAttributes : max_attributes_;
   }
 
+  // Adds an AttributeValue to the list or updates an existing AttributeValue.
+  // If max_attributes_ is exceeded, it will evict the oldest AttributeValue.
+  // A new attribute that does not fit in the byte budget counts as dropped.
+  void AddAttribute(absl::string_view key, AttributeValueRef value);
+  void AddAttribute(StaticString key, AttributeValueRef value);
+
+  // Returns the attributes currently contained within the list, oldest first.
+  const Attributes& attributes() const { return attributes_; }
+  Attributes* mutable_attributes() { return &attributes_; }
+
  private:
+  // Returns the attribute with 'key', or nullptr if there is none.
+  Attribute* Find(absl::string_view key);
+  // Appends a new attribute, evicting the oldest if full.
+  void Append(Attribute attribute);
+  // Truncates *value and consumes the attribute's bytes from the byte budget,
+  // if any. Returns false, counting a new attribute as dropped, if it does not
+  // fit.
+  bool FitToBudget(absl::string_view key, bool is_new,
+                   AttributeValueRef* value);
+
   uint32_t total_recorded_attributes_;
   const uint32_t max_attributes_;
-  std::unordered_map<std::string, exporter::AttributeValue> attributes_;
+  ByteBudget* const byte_budget_;
+  Attributes attributes_;
 };
 
 }  // namespace trace
@@ -0,0 +1,133 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/attribute_list.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/attribute_value_ref.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/internal/byte_budget.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+exporter::AttributeValue Value(AttributeValueRef value) {
+  return exporter::AttributeValue(value);
+}
+
+std::vector<std::pair<std::string, exporter::AttributeValue>> Released(
+    AttributeList* attributes) {
+  std::vector<std::pair<std::string, exporter::AttributeValue>> released;
+  for (auto& attribute : *attributes->mutable_attributes()) {
+    released.push_back(attribute.Release());
+  }
+  return released;
+}
+
+TEST(AttributeListTest, Blank) {
+  AttributeList attributes;
+  attributes.AddAttribute("key", 1);
+  EXPECT_TRUE(attributes.attributes().empty());
+  EXPECT_EQ(0, attributes.num_attributes_added());
+}
+
+TEST(AttributeListTest, UpdatesExistingKey) {
+  AttributeList attributes(2);
+  attributes.AddAttribute("key1", 1);
+  attributes.AddAttribute("key2", 2);
+  attributes.AddAttribute("key1", 3);
+  EXPECT_THAT(Released(&attributes),
+              ElementsAre(Pair("key1", Value(3)), Pair("key2", Value(2))));
+  EXPECT_EQ(2, attributes.num_attributes_added());
+  EXPECT_EQ(0, attributes.num_attributes_dropped());
+}
+
+TEST(AttributeListTest, EvictsOldest) {
+  AttributeList attributes(AttributeList::kInlineAttributes + 1);
+  for (int i = 0; i < AttributeList::kInlineAttributes + 3; ++i) {
+    attributes.AddAttribute(std::to_string(i), i);
+  }
+  ASSERT_EQ(AttributeList::kInlineAttributes + 1,
+            attributes.attributes().size());
+  EXPECT_EQ("2", attributes.attributes().front().key());
+  EXPECT_EQ(std::to_string(AttributeList::kInlineAttributes + 2),
+            attributes.attributes().back().key());
+  EXPECT_EQ(2, attributes.num_attributes_dropped());
+}
+
+TEST(AttributeListTest, StaticStringsAreReferenced) {
+  static const char kKey[] = "static_key";
+  static const char kValue[] = "static_value";
+  AttributeList attributes(3);
+  attributes.AddAttribute(StaticString(kKey), StaticString(kValue));
+  std::string dynamic_key = "dynamic_key";
+  std::string dynamic_value = "dynamic_value";
+  attributes.AddAttribute(dynamic_key, StaticString(kValue));
+  attributes.AddAttribute(StaticString("static_key2"), dynamic_value);
+  dynamic_key = "changed";
+  dynamic_value = "changed";
+
+  EXPECT_EQ(kKey, attributes.attributes()[0].key().data());
+  EXPECT_EQ("dynamic_key", attributes.attributes()[1].key());
+  EXPECT_EQ(Value("dynamic_value"), attributes.attributes()[2].value());
+  // A dynamic value replaces a static one under a static key.
+  attributes.AddAttribute(StaticString(kKey), std::string("replaced"));
+  EXPECT_THAT(
+      Released(&attributes),
+      ElementsAre(Pair("static_key", Value("replaced")),
+                  Pair("dynamic_key", Value("static_value")),
+                  Pair("static_key2", Value("dynamic_value"))));
+}
+
+TEST(AttributeListTest, ByteBudget) {
+  ByteBudget budget(/*max_value_bytes=*/4, /*max_total_bytes=*/16);
+  AttributeList attributes(8, &budget);
+  attributes.AddAttribute("key1", "abcdef");
+  attributes.AddAttribute(StaticString("key2"), StaticString("ghijkl"));
+  EXPECT_EQ(4, budget.bytes_dropped());
+  // Only the key counts for other types, but it does not fit.
+  attributes.AddAttribute("key3", 3);
+  EXPECT_EQ(8, budget.bytes_dropped());
+  EXPECT_EQ(1, attributes.num_attributes_dropped());
+  EXPECT_THAT(Released(&attributes),
+              ElementsAre(Pair("key1", Value("abcd")),
+                          Pair("key2", Value("ghij"))));
+}
+
+TEST(ByteBudgetTest, TruncatesAtCharacterBoundary) {
+  ByteBudget budget(/*max_value_bytes=*/4, /*max_total_bytes=*/0);
+  EXPECT_TRUE(budget.limited());
+  // "abc" followed by a 2-byte character.
+  EXPECT_EQ("abc", budget.Truncate("abc\xc3\xa9"));
+  EXPECT_EQ(2, budget.bytes_dropped());
+  EXPECT_EQ("ab\xc3\xa9", budget.Truncate("ab\xc3\xa9"));
+  EXPECT_EQ(2, budget.bytes_dropped());
+  // No total limit.
+  EXPECT_TRUE(budget.TryConsume(1 << 30));
+  EXPECT_FALSE(ByteBudget(0, 0).limited());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
@@ -0,0 +1,149 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/baggage.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+
+namespace {
+
+bool IsOptionalWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+absl::string_view TrimOptionalWhitespace(absl::string_view s) {
+  while (!s.empty() && IsOptionalWhitespace(s.front())) s.remove_prefix(1);
+  while (!s.empty() && IsOptionalWhitespace(s.back())) s.remove_suffix(1);
+  return s;
+}
+
+// Returns true for the tchar characters of HTTP tokens (RFC 7230).
+bool IsTokenChar(char c) {
+  if (absl::ascii_isalnum(c)) return true;
+  switch (c) {
+    case '!':
+    case '#':
+    case '$':
+    case '%':
+    case '&':
+    case '\'':
+    case '*':
+    case '+':
+    case '-':
+    case '.':
+    case '^':
+    case '_':
+    case '`':
+    case '|':
+    case '~':
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsValidKey(absl::string_view key) {
+  if (key.empty()) return false;
+  for (char c : key) {
+    if (!IsTokenChar(c)) return false;
+  }
+  return true;
+}
+
+// Returns true if value consists of baggage-octets and valid percent-encoded
+// octets.
+bool IsValidValue(absl::string_view value) {
+  for (size_t i = 0; i < value.size(); ++i) {
+    const char c = value[i];
+    if (c == '%') {
+      if (i + 2 >= value.size() || !absl::ascii_isxdigit(value[i + 1]) ||
+          !absl::ascii_isxdigit(value[i + 2])) {
+        return false;
+      }
+      i += 2;
+    } else if (c < 0x21 || c > 0x7e || c == '"' || c == ',' || c == ';' ||
+               c == '\\') {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FromBaggageHeader(absl::string_view header,
+                       std::vector<BaggageEntry>* entries) {
+  entries->clear();
+  if (header.size() > kMaxBaggageHeaderLen) {
+    return false;
+  }
+  while (true) {
+    const size_t comma = header.find(',');
+    absl::string_view member = TrimOptionalWhitespace(header.substr(0, comma));
+    if (member.empty() || entries->size() >= kMaxBaggageEntries) {
+      return false;
+    }
+    BaggageEntry entry;
+    const size_t semicolon = member.find(';');
+    if (semicolon != absl::string_view::npos) {
+      entry.properties = TrimOptionalWhitespace(member.substr(semicolon + 1));
+      member = member.substr(0, semicolon);
+    }
+    const size_t equals = member.find('=');
+    if (equals == absl::string_view::npos) {
+      return false;
+    }
+    entry.key = TrimOptionalWhitespace(member.substr(0, equals));
+    entry.value = TrimOptionalWhitespace(member.substr(equals + 1));
+    if (!IsValidKey(entry.key) || !IsValidValue(entry.value)) {
+      return false;
+    }
+    entries->push_back(entry);
+    if (comma == absl::string_view::npos) break;
+    header.remove_prefix(comma + 1);
+  }
+  return true;
+}
+
+std::string ToBaggageHeader(absl::Span<const BaggageEntry> entries) {
+  size_t len = 0;
+  for (const auto& entry : entries) {
+    len += entry.key.size() + entry.value.size() + entry.properties.size() + 3;
+  }
+  std::string header;
+  header.reserve(len);
+  for (const auto& entry : entries) {
+    if (!header.empty()) header.push_back(',');
+    header.append(entry.key.data(), entry.key.size());
+    header.push_back('=');
+    header.append(entry.value.data(), entry.value.size());
+    if (!entry.properties.empty()) {
+      header.push_back(';');
+      header.append(entry.properties.data(), entry.properties.size());
+    }
+  }
+  return header;
+}
+
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
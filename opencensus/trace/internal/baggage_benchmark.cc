@@ -0,0 +1,51 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/baggage.h"
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+namespace {
+
+constexpr char kHeader[] =
+    "userId=alice,serverNode=DF%2028,isProduction=false;ttl=60";
+
+void BM_FromBaggageHeader(benchmark::State& state) {
+  std::vector<BaggageEntry> entries;
+  while (state.KeepRunning()) {
+    FromBaggageHeader(kHeader, &entries);
+  }
+}
+BENCHMARK(BM_FromBaggageHeader);
+
+void BM_ToBaggageHeader(benchmark::State& state) {
+  std::vector<BaggageEntry> entries;
+  FromBaggageHeader(kHeader, &entries);
+  while (state.KeepRunning()) {
+    ToBaggageHeader(entries);
+  }
+}
+BENCHMARK(BM_ToBaggageHeader);
+
+}  // namespace
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
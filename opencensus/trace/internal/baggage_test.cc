@@ -0,0 +1,79 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/baggage.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+namespace {
+
+TEST(BaggageTest, ParseAndSerialize) {
+  const std::string header =
+      "userId=alice, serverNode = DF%2028,isProduction=false;ttl=60";
+  std::vector<BaggageEntry> entries;
+  ASSERT_TRUE(FromBaggageHeader(header, &entries));
+  ASSERT_EQ(3, entries.size());
+  EXPECT_EQ("userId", entries[0].key);
+  EXPECT_EQ("alice", entries[0].value);
+  EXPECT_EQ("", entries[0].properties);
+  EXPECT_EQ("serverNode", entries[1].key);
+  EXPECT_EQ("DF%2028", entries[1].value) << "values are not decoded.";
+  EXPECT_EQ("isProduction", entries[2].key);
+  EXPECT_EQ("false", entries[2].value);
+  EXPECT_EQ("ttl=60", entries[2].properties);
+  // Entries point into the header.
+  EXPECT_EQ(header.data(), entries[0].key.data());
+  EXPECT_EQ("userId=alice,serverNode=DF%2028,isProduction=false;ttl=60",
+            ToBaggageHeader(entries));
+}
+
+TEST(BaggageTest, Limits) {
+  std::string header = "k=v";
+  for (int i = 1; i < kMaxBaggageEntries; ++i) {
+    header += ",k=v";
+  }
+  std::vector<BaggageEntry> entries;
+  EXPECT_TRUE(FromBaggageHeader(header, &entries));
+  EXPECT_EQ(kMaxBaggageEntries, entries.size());
+  EXPECT_FALSE(FromBaggageHeader(header + ",k=v", &entries))
+      << "too many entries.";
+  EXPECT_FALSE(FromBaggageHeader(
+      "k=" + std::string(kMaxBaggageHeaderLen, 'v'), &entries))
+      << "too long.";
+}
+
+TEST(BaggageTest, ExpectedFailures) {
+  std::vector<BaggageEntry> entries;
+#define INVALID(str) EXPECT_FALSE(FromBaggageHeader(str, &entries))
+  INVALID("") << "no members.";
+  INVALID("key") << "missing '='.";
+  INVALID("=value") << "empty key.";
+  INVALID("k,ey=value") << "empty member.";
+  INVALID("k(ey)=value") << "key is not a token.";
+  INVALID("key=val ue") << "space in value.";
+  INVALID("key=value%2") << "truncated percent-encoding.";
+  INVALID("key=value%zz") << "invalid percent-encoding.";
+#undef INVALID
+}
+
+}  // namespace
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
@@ -0,0 +1,168 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_BOUNDED_QUEUE_H_
+#define OPENCENSUS_TRACE_INTERNAL_BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace opencensus {
+namespace trace {
+
+// BoundedQueue is a fixed-capacity, lock-free FIFO queue for any number of
+// producers and consumers (Dmitry Vyukov's bounded MPMC queue). Each slot
+// carries a sequence number saying whether it is ready to be written or read
+// for a given lap of the ring, so pushes and pops only contend on their
+// respective position counters.
+//
+// BoundedQueue is thread-safe.
+template <typename T>
+class BoundedQueue final {
+ public:
+  // The capacity is rounded up to a power of 2, and is at least 2.
+  explicit BoundedQueue(size_t capacity);
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Moves *value into the queue and returns true, or returns false, leaving
+  // *value unchanged, if the queue is full.
+  bool TryPush(T* value);
+  // Moves the oldest value into *value and returns true, or returns false if
+  // the queue is empty.
+  bool TryPop(T* value);
+
+  // The number of values in the queue, which may be out of date as soon as it
+  // is returned.
+  size_t SizeApprox() const;
+
+  // The bytes held by the queue itself, not counting heap data owned by the
+  // queued values.
+  size_t ApproximateBytes() const {
+    return sizeof(*this) + capacity() * sizeof(Slot);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t RoundUpCapacity(size_t capacity);
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  // The positions are padded onto separate cache lines, so that producers and
+  // consumers do not contend.
+  char pad0_[64];
+  std::atomic<size_t> push_position_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> pop_position_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+};
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : mask_(RoundUpCapacity(capacity) - 1),
+      slots_(new Slot[mask_ + 1]),
+      push_position_(0),
+      pop_position_(0) {
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+// static
+template <typename T>
+size_t BoundedQueue<T>::RoundUpCapacity(size_t capacity) {
+  size_t rounded = 2;
+  while (rounded < capacity) {
+    rounded *= 2;
+  }
+  return rounded;
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPush(T* value) {
+  size_t position = push_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const intptr_t lap = static_cast<intptr_t>(sequence) -
+                         static_cast<intptr_t>(position);
+    if (lap == 0) {
+      // The slot is free in this lap; claim it.
+      if (push_position_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lap < 0) {
+      // The slot still holds the value from the previous lap.
+      return false;
+    } else {
+      position = push_position_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->value = std::move(*value);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPop(T* value) {
+  size_t position = pop_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const intptr_t lap = static_cast<intptr_t>(sequence) -
+                         static_cast<intptr_t>(position + 1);
+    if (lap == 0) {
+      // The slot has been written in this lap; claim it.
+      if (pop_position_.compare_exchange_weak(position, position + 1,
+                                              std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lap < 0) {
+      // The slot has not been written yet.
+      return false;
+    } else {
+      position = pop_position_.load(std::memory_order_relaxed);
+    }
+  }
+  *value = std::move(slot->value);
+  // Release any resources held by the moved-from value now.
+  slot->value = T();
+  slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+size_t BoundedQueue<T>::SizeApprox() const {
+  const size_t pop = pop_position_.load(std::memory_order_relaxed);
+  const size_t push = push_position_.load(std::memory_order_relaxed);
+  return push > pop ? push - pop : 0;
+}
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_BOUNDED_QUEUE_H_
@@ -0,0 +1,92 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/bounded_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+TEST(BoundedQueueTest, RoundsUpCapacity) {
+  EXPECT_EQ(2, BoundedQueue<int>(0).capacity());
+  EXPECT_EQ(8, BoundedQueue<int>(5).capacity());
+  EXPECT_EQ(8, BoundedQueue<int>(8).capacity());
+}
+
+TEST(BoundedQueueTest, Fifo) {
+  BoundedQueue<std::unique_ptr<int>> queue(4);
+  int value;
+  // Run several laps of the ring.
+  for (int lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i) {
+      auto element = std::unique_ptr<int>(new int(i));
+      ASSERT_TRUE(queue.TryPush(&element));
+      EXPECT_EQ(nullptr, element);
+    }
+    auto extra = std::unique_ptr<int>(new int(4));
+    EXPECT_FALSE(queue.TryPush(&extra));
+    EXPECT_NE(nullptr, extra);
+    EXPECT_EQ(4, queue.SizeApprox());
+    for (int i = 0; i < 4; ++i) {
+      std::unique_ptr<int> element;
+      ASSERT_TRUE(queue.TryPop(&element));
+      value = *element;
+      EXPECT_EQ(i, value);
+    }
+    std::unique_ptr<int> element;
+    EXPECT_FALSE(queue.TryPop(&element));
+  }
+}
+
+TEST(BoundedQueueTest, MultipleProducers) {
+  constexpr int kNumThreads = 4;
+  constexpr int kPerThread = 10000;
+  BoundedQueue<int> queue(64);
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kNumThreads; ++t) {
+    producers.emplace_back([&queue]() {
+      for (int i = 0; i < kPerThread; ++i) {
+        int value = 1;
+        while (!queue.TryPush(&value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  int sum = 0;
+  while (sum < kNumThreads * kPerThread) {
+    int value;
+    if (queue.TryPop(&value)) {
+      sum += value;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(kNumThreads * kPerThread, sum);
+  EXPECT_EQ(0, queue.SizeApprox());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
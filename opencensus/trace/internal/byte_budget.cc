@@ -0,0 +1,68 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/byte_budget.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/trace/attribute_value_ref.h"
+
+namespace opencensus {
+namespace trace {
+
+absl::string_view ByteBudget::Truncate(absl::string_view value) {
+  if (max_value_bytes_ == 0 || value.size() <= max_value_bytes_) {
+    return value;
+  }
+  // Back up over continuation bytes, so that a multibyte character is not
+  // split and the value stays valid UTF-8.
+  size_t size = max_value_bytes_;
+  while (size > 0 && (static_cast<uint8_t>(value[size]) & 0xC0) == 0x80) {
+    --size;
+  }
+  bytes_dropped_ += value.size() - size;
+  return value.substr(0, size);
+}
+
+AttributeValueRef ByteBudget::TruncateValue(AttributeValueRef value) {
+  if (value.type() != AttributeValueRef::Type::kString) {
+    return value;
+  }
+  const absl::string_view truncated = Truncate(value.string_value());
+  if (value.is_static()) {
+    return AttributeValueRef(StaticString(truncated));
+  }
+  return AttributeValueRef(truncated);
+}
+
+bool ByteBudget::TryConsume(size_t bytes) {
+  if (max_total_bytes_ != 0 && bytes_consumed_ + bytes > max_total_bytes_) {
+    bytes_dropped_ += bytes;
+    return false;
+  }
+  bytes_consumed_ += bytes;
+  return true;
+}
+
+size_t ByteBudget::AttributeBytes(absl::string_view key,
+                                  AttributeValueRef value) {
+  return key.size() + (value.type() == AttributeValueRef::Type::kString
+                           ? value.string_value().size()
+                           : 0);
+}
+
+}  // namespace trace
+}  // namespace opencensus
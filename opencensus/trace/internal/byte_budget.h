@@ -0,0 +1,85 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_BYTE_BUDGET_H_
+#define OPENCENSUS_TRACE_INTERNAL_BYTE_BUDGET_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/trace/attribute_value_ref.h"
+
+namespace opencensus {
+namespace trace {
+
+// ByteBudget enforces the byte limits of TraceParams on the strings recorded
+// in a span: each string value is truncated to max_value_bytes, and once
+// max_total_bytes of keys, values and descriptions have been recorded, further
+// attributes and annotations are dropped. A limit of 0 means no limit. Limits
+// are applied before the data is copied into the span, and the bytes truncated
+// or dropped are counted.
+//
+// ByteBudget is thread-compatible.
+class ByteBudget final {
+ public:
+  ByteBudget(uint32_t max_value_bytes, uint32_t max_total_bytes)
+      : max_value_bytes_(max_value_bytes), max_total_bytes_(max_total_bytes) {}
+
+  // True if either limit is set. If not, nothing needs to be truncated or
+  // counted.
+  bool limited() const {
+    return max_value_bytes_ != 0 || max_total_bytes_ != 0;
+  }
+
+  // True if max_total_bytes have been recorded, so that any further non-empty
+  // string would be dropped.
+  bool exhausted() const {
+    return max_total_bytes_ != 0 && bytes_consumed_ >= max_total_bytes_;
+  }
+
+  // Returns 'value' truncated to at most max_value_bytes, at a UTF-8 character
+  // boundary, counting the bytes removed as dropped.
+  absl::string_view Truncate(absl::string_view value);
+  // Like Truncate() for string values; other values are returned as they are.
+  // A StaticString value remains static.
+  AttributeValueRef TruncateValue(AttributeValueRef value);
+
+  // Records 'bytes' more bytes if they fit in max_total_bytes, and returns
+  // true; otherwise counts them as dropped and returns false.
+  bool TryConsume(size_t bytes);
+
+  // Returns 'bytes' recorded earlier to the budget, once the data holding them
+  // has been exported and freed.
+  void Release(size_t bytes) {
+    bytes_consumed_ -= std::min<uint64_t>(bytes, bytes_consumed_);
+  }
+
+  // The bytes of an attribute's key and, if a string, its value.
+  static size_t AttributeBytes(absl::string_view key, AttributeValueRef value);
+
+  uint64_t bytes_dropped() const { return bytes_dropped_; }
+
+ private:
+  const uint32_t max_value_bytes_;
+  const uint32_t max_total_bytes_;
+  uint64_t bytes_consumed_ = 0;
+  uint64_t bytes_dropped_ = 0;
+};
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_BYTE_BUDGET_H_
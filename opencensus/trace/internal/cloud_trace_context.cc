@@ -14,18 +14,20 @@
 
 #include "opencensus/trace/propagation/cloud_trace_context.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <string>
 
+#include "opencensus/trace/internal/hex.h"
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/span_id.h"
 #include "opencensus/trace/trace_id.h"
 #include "opencensus/trace/trace_options.h"
 
 #include "absl/base/internal/endian.h"
-#include "absl/strings/ascii.h"
-#include "absl/strings/escaping.h"
-#include "absl/strings/numbers.h"
-#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 namespace opencensus {
 namespace trace {
@@ -33,14 +35,6 @@ namespace propagation {
 
 namespace {
 
-// Returns true if the string only contains valid hex digits.
-bool IsHexDigits(absl::string_view s) {
-  for (int i = 0; i < s.length(); ++i) {
-    if (!absl::ascii_isxdigit(s[i])) return false;
-  }
-  return true;
-}
-
 // Returns a SpanId which is a big-endian encoding of a decimal number.
 SpanId FromDecimal(uint64_t n) {
   uint8_t buf[8];
@@ -55,55 +49,114 @@ uint64_t ToDecimal(const SpanId& span_id) {
   return absl::big_endian::ToHost64(n);
 }
 
+// Writes the decimal representation of n to out, and returns the number of
+// digits written.
+int WriteDecimal(uint64_t n, char* out) {
+  char digits[20];
+  int len = 0;
+  do {
+    digits[len++] = static_cast<char>('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  for (int i = 0; i < len; ++i) {
+    out[i] = digits[len - 1 - i];
+  }
+  return len;
+}
+
+// Parses the decimal number at the start of s into *n, without a sign or
+// whitespace, and returns the number of characters it spans. Returns 0 if s
+// does not start with a digit, or if the number does not fit in a uint64_t.
+size_t ParseDecimal(absl::string_view s, uint64_t* n) {
+  size_t i = 0;
+  while (i < s.size() && s[i] == '0') ++i;
+  // Up to 19 significant digits cannot overflow, so need no checks.
+  const size_t unchecked_end = std::min(s.size(), i + 19);
+  uint64_t value = 0;
+  for (; i < unchecked_end; ++i) {
+    const uint8_t digit = static_cast<uint8_t>(s[i] - '0');
+    if (digit > 9) break;
+    value = value * 10 + digit;
+  }
+  if (i == unchecked_end && i < s.size()) {
+    const uint8_t digit = static_cast<uint8_t>(s[i] - '0');
+    if (digit <= 9) {
+      if (value > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+        return 0;
+      }
+      value = value * 10 + digit;
+      ++i;
+      if (i < s.size() && static_cast<uint8_t>(s[i] - '0') <= 9) {
+        return 0;  // More than 20 significant digits.
+      }
+    }
+  }
+  *n = value;
+  return i;
+}
+
 }  // namespace
 
 SpanContext FromCloudTraceContextHeader(absl::string_view header) {
-  constexpr int kTraceIdLen = 16;
-  constexpr int kTraceIdLenHex = 2 * kTraceIdLen;
-  constexpr int kOptionsLen = 4;  // e.g. ";o=1"
+  constexpr size_t kSpanIdOfs = TraceId::kHexSize + 1;
+  constexpr size_t kOptionsLen = 4;  // e.g. ";o=1"
   static SpanContext invalid;
 
-  if (header.size() < kTraceIdLenHex + 2 || header[kTraceIdLenHex] != '/') {
+  if (header.size() <= kSpanIdOfs || header[TraceId::kHexSize] != '/') {
     // Too short to contain a valid trace_id/span_id, or missing slash.
     return invalid;
   }
 
-  // Check if options are present.
-  absl::string_view options = header.substr(header.size() - kOptionsLen);
-  uint8_t sampled = 0;
-  if (options[0] == ';' && options[1] == 'o' && options[2] == '=') {
-    if (options.back() < '0' || options.back() > '3') {
-      return invalid;  // Invalid option.
-    }
-    if (options.back() == '1' || options.back() == '3') {
-      sampled = 1;
-    }
-    // Remove from header to make parsing span_id easier.
-    header = header.substr(0, header.size() - kOptionsLen);
+  // Parse trace_id.
+  uint8_t trace_id[TraceId::kSize];
+  if (!DecodeHex(header.substr(0, TraceId::kHexSize),
+                 /*allow_uppercase=*/true, trace_id)) {
+    return invalid;  // Invalid hex digit.
   }
 
   // Parse decimal span_id.
-  absl::string_view span_id = header.substr(kTraceIdLenHex + 1);
-  uint64_t n_span_id;
-  if (!absl::SimpleAtoi(span_id, &n_span_id) || n_span_id == 0) {
+  uint64_t span_id;
+  const size_t span_id_len = ParseDecimal(header.substr(kSpanIdOfs), &span_id);
+  if (span_id_len == 0 || span_id == 0) {
     return invalid;  // Invalid span_id.
   }
 
-  // Parse trace_id.
-  absl::string_view trace_id = header.substr(0, kTraceIdLenHex);
-  if (!IsHexDigits(trace_id)) {
-    return invalid;  // Invalid hex digit.
+  // Parse options, if present.
+  const absl::string_view options = header.substr(kSpanIdOfs + span_id_len);
+  uint8_t sampled = 0;
+  if (!options.empty()) {
+    if (options.size() != kOptionsLen || options[0] != ';' ||
+        options[1] != 'o' || options[2] != '=') {
+      return invalid;  // Malformed options, or trailing characters.
+    }
+    const uint8_t value = static_cast<uint8_t>(options[3] - '0');
+    if (value > 3) {
+      return invalid;  // Invalid option.
+    }
+    // Only 1 and 3 enable tracing.
+    sampled = value & 1;
   }
-  std::string trace_id_binary = absl::HexStringToBytes(trace_id);
 
-  return SpanContext(
-      TraceId(reinterpret_cast<const uint8_t*>(trace_id_binary.data())),
-      FromDecimal(n_span_id), TraceOptions(&sampled));
+  return SpanContext(TraceId(trace_id), FromDecimal(span_id),
+                     TraceOptions(&sampled));
 }
 
 std::string ToCloudTraceContextHeader(const SpanContext& ctx) {
-  return absl::StrCat(ctx.trace_id().ToHex(), "/", ToDecimal(ctx.span_id()),
-                      ctx.trace_options().IsSampled() ? ";o=1" : ";o=0");
+  char header[kMaxCloudTraceContextHeaderLen];
+  const int len = ToCloudTraceContextHeader(ctx, header);
+  return std::string(header, len);
+}
+
+int ToCloudTraceContextHeader(const SpanContext& ctx, char* out) {
+  ctx.trace_id().ToHex(out);
+  int len = TraceId::kHexSize;
+  out[len++] = '/';
+  len += WriteDecimal(ToDecimal(ctx.span_id()), out + len);
+  out[len++] = ';';
+  out[len++] = 'o';
+  out[len++] = '=';
+  out[len++] = ctx.trace_options().IsSampled() ? '1' : '0';
+  return len;
 }
 
 }  // namespace propagation
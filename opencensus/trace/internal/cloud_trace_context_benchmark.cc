@@ -14,6 +14,10 @@
 
 #include "opencensus/trace/propagation/cloud_trace_context.h"
 
+#include <cstdint>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
 #include "benchmark/benchmark.h"
 
 namespace opencensus {
@@ -25,6 +29,9 @@ constexpr char kXCTCFull[] =
     "12345678901234567890123456789012/18446744073709551615;o=1";
 constexpr char kXCTCNoOptions[] =
     "12345678901234567890123456789012/18446744073709551615";
+constexpr char kXCTCShortSpanId[] = "12345678901234567890123456789012/123;o=1";
+constexpr char kXCTCInvalidSpanId[] =
+    "12345678901234567890123456789012/18446744073709551616;o=1";
 constexpr char kXCTCInvalidTraceId[] =
     "1234567890123456789012345678901x/18446744073709551615;o=1";
 
@@ -42,6 +49,32 @@ void BM_FromCloudTraceContext_NoOptions(benchmark::State& state) {
 }
 BENCHMARK(BM_FromCloudTraceContext_NoOptions);
 
+void BM_FromCloudTraceContext_ShortSpanId(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    FromCloudTraceContextHeader(kXCTCShortSpanId);
+  }
+}
+BENCHMARK(BM_FromCloudTraceContext_ShortSpanId);
+
+void BM_FromCloudTraceContext_InvalidSpanId(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    FromCloudTraceContextHeader(kXCTCInvalidSpanId);
+  }
+}
+BENCHMARK(BM_FromCloudTraceContext_InvalidSpanId);
+
+// The span_id conversion FromCloudTraceContextHeader used before it parsed the
+// header in one pass, for comparison with the benchmarks above.
+void BM_SimpleAtoiSpanId(benchmark::State& state) {
+  const absl::string_view span_id =
+      absl::string_view(kXCTCNoOptions).substr(33);
+  uint64_t n;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(absl::SimpleAtoi(span_id, &n));
+  }
+}
+BENCHMARK(BM_SimpleAtoiSpanId);
+
 void BM_FromCloudTraceContext_InvalidTraceId(benchmark::State& state) {
   while (state.KeepRunning()) {
     FromCloudTraceContextHeader(kXCTCInvalidTraceId);
@@ -57,6 +90,15 @@ void BM_ToCloudTraceContext(benchmark::State& state) {
 }
 BENCHMARK(BM_ToCloudTraceContext);
 
+void BM_ToCloudTraceContextBuffer(benchmark::State& state) {
+  auto ctx = FromCloudTraceContextHeader(kXCTCFull);
+  char buf[kMaxCloudTraceContextHeaderLen];
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(ToCloudTraceContextHeader(ctx, buf));
+  }
+}
+BENCHMARK(BM_ToCloudTraceContextBuffer);
+
 }  // namespace
 }  // namespace propagation
 }  // namespace trace
@@ -14,6 +14,7 @@
 
 #include "opencensus/trace/propagation/cloud_trace_context.h"
 
+#include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "opencensus/trace/span_context.h"
@@ -60,6 +61,32 @@ TEST(CloudTraceContextTest, ParseMaxValues) {
       << "o=3 is canonicalized to o=1";
 }
 
+TEST(CloudTraceContextTest, ParseLeadingZeros) {
+  SpanContext ctx = FromCloudTraceContextHeader(
+      "01020304050607081112131415161718/000000000000000000000000123;o=1");
+  EXPECT_THAT(ctx, IsValid());
+  EXPECT_EQ("01020304050607081112131415161718-000000000000007b-01",
+            ctx.ToString());
+}
+
+TEST(CloudTraceContextTest, ToBuffer) {
+  constexpr char header[] =
+      "ffffffffffffffffffffffffffffffff/18446744073709551615;o=1";
+  char buf[kMaxCloudTraceContextHeaderLen];
+  const int len =
+      ToCloudTraceContextHeader(FromCloudTraceContextHeader(header), buf);
+  EXPECT_EQ(kMaxCloudTraceContextHeaderLen, len);
+  EXPECT_EQ(header, absl::string_view(buf, len));
+  EXPECT_EQ(
+      "0102030405060708111213141516171a/7;o=0",
+      absl::string_view(
+          buf, ToCloudTraceContextHeader(
+                   FromCloudTraceContextHeader(
+                       "0102030405060708111213141516171A/7"),
+                   buf)))
+      << "uppercase hex is accepted and canonicalized to lowercase";
+}
+
 TEST(CloudTraceContextTest, ExpectedFailures) {
 #define INVALID(str) EXPECT_THAT(FromCloudTraceContextHeader(str), IsInvalid())
   INVALID("");
@@ -74,6 +101,18 @@ TEST(CloudTraceContextTest, ExpectedFailures) {
   INVALID("12345678901234567890123456789012/123/123") << "too many slashes.";
   INVALID("12345678901234567890123456789012/18446744073709551617;o=1")
       << "span_id is too large. (uint64max + 1)";
+  INVALID("12345678901234567890123456789012/18446744073709551620;o=1")
+      << "span_id is too large. (uint64max + 5)";
+  INVALID("12345678901234567890123456789012/99999999999999999999;o=1")
+      << "span_id is too large. (20 digits)";
+  INVALID("12345678901234567890123456789012/123456789012345678901;o=1")
+      << "span_id is too large. (21 digits)";
+  INVALID("12345678901234567890123456789012/+123;o=1")
+      << "span_id must not have a sign.";
+  INVALID("12345678901234567890123456789012/123 ;o=1")
+      << "span_id must not have whitespace.";
+  INVALID("12345678901234567890123456789012/456;o=1x")
+      << "trailing characters.";
   INVALID("12345678901234567890123456789012/456;") << "missing options.";
   INVALID("12345678901234567890123456789012/456;o=")
       << "missing options value.";
@@ -0,0 +1,52 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/disabled_span_names.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+
+namespace opencensus {
+namespace trace {
+
+DisabledSpanNames* DisabledSpanNames::Get() {
+  static DisabledSpanNames* global_disabled_span_names = new DisabledSpanNames;
+  return global_disabled_span_names;
+}
+
+DisabledSpanNames::DisabledSpanNames() { Set({}); }
+
+void DisabledSpanNames::Set(const std::vector<std::string>& names) {
+  auto snapshot = absl::make_unique<Snapshot>();
+  for (const std::string& name : names) {
+    snapshot->length_bits |= uint64_t{1} << (name.size() % 64);
+    snapshot->names.insert(name);
+  }
+  absl::MutexLock l(&mu_);
+  for (const auto& existing : snapshots_) {
+    if (existing->names == snapshot->names) {
+      current_.store(existing.get(), std::memory_order_release);
+      return;
+    }
+  }
+  snapshots_.push_back(std::move(snapshot));
+  current_.store(snapshots_.back().get(), std::memory_order_release);
+}
+
+}  // namespace trace
+}  // namespace opencensus
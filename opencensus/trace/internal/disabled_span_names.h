@@ -0,0 +1,72 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_DISABLED_SPAN_NAMES_H_
+#define OPENCENSUS_TRACE_INTERNAL_DISABLED_SPAN_NAMES_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace opencensus {
+namespace trace {
+
+// DisabledSpanNames is a singleton holding the span names disabled by
+// TraceConfig::SetDisabledSpanNames(), which StartSpan checks first.
+//
+// As in TraceParamsImpl, the set is published as an immutable snapshot read
+// with a single acquire load; snapshots are never freed, and equal sets share
+// one. Each snapshot has a bitmap of the lengths (mod 64) of its names, tested
+// before a name is hashed, so that while no names are disabled, or only names
+// of other lengths, the check costs a load and a bit test.
+class DisabledSpanNames final {
+ public:
+  static DisabledSpanNames* Get();
+
+  // Replaces the set of disabled names.
+  void Set(const std::vector<std::string>& names) LOCKS_EXCLUDED(mu_);
+
+  bool Contains(absl::string_view name) const {
+    const Snapshot* snapshot = current_.load(std::memory_order_acquire);
+    if (((snapshot->length_bits >> (name.size() % 64)) & 1) == 0) {
+      return false;
+    }
+    return snapshot->names.contains(name);
+  }
+
+ private:
+  struct Snapshot {
+    uint64_t length_bits = 0;
+    absl::flat_hash_set<std::string> names;
+  };
+
+  DisabledSpanNames();
+
+  absl::Mutex mu_;
+  // Every distinct set that has been set.
+  std::vector<std::unique_ptr<const Snapshot>> snapshots_ GUARDED_BY(mu_);
+  std::atomic<const Snapshot*> current_;
+};
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_DISABLED_SPAN_NAMES_H_
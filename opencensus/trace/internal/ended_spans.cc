@@ -0,0 +1,185 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/ended_spans.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/trace/internal/local_span_store_impl.h"
+#include "opencensus/trace/internal/running_span_store_impl.h"
+#include "opencensus/trace/internal/span_exporter_impl.h"
+#include "opencensus/trace/internal/span_impl.h"
+
+namespace opencensus {
+namespace trace {
+
+// The spans staged by one thread. Only its owner adds to it, so mu is only
+// contended while Flush() takes the spans.
+struct EndedSpans::ThreadBatch {
+  // Registers the batch.
+  ThreadBatch();
+  // Unregisters the batch and hands over its spans.
+  ~ThreadBatch();
+
+  const std::thread::id owner = std::this_thread::get_id();
+  absl::Mutex mu;
+  std::vector<std::shared_ptr<SpanImpl>> spans GUARDED_BY(mu);
+};
+
+// The batches of the live threads. Locked before any batch's mu.
+struct EndedSpans::Registry {
+  // Registers the fork handler.
+  Registry();
+
+  // The common::Scheduler fork handler. The child discards the staged spans,
+  // as the span stores and exporter discard the parent's, and the batches of
+  // the parent's other threads, which never exit.
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+
+  absl::Mutex mu;
+  std::vector<ThreadBatch*> batches GUARDED_BY(mu);
+};
+
+std::atomic<size_t> EndedSpans::batch_size_{0};
+
+EndedSpans::ThreadBatch::ThreadBatch() {
+  Registry* registry = GetRegistry();
+  absl::MutexLock l(&registry->mu);
+  registry->batches.push_back(this);
+}
+
+EndedSpans::ThreadBatch::~ThreadBatch() {
+  Registry* registry = GetRegistry();
+  {
+    absl::MutexLock l(&registry->mu);
+    registry->batches.erase(std::find(registry->batches.begin(),
+                                      registry->batches.end(), this));
+  }
+  std::vector<std::shared_ptr<SpanImpl>> staged;
+  {
+    absl::MutexLock l(&mu);
+    staged.swap(spans);
+  }
+  Dispatch(absl::MakeSpan(staged));
+}
+
+EndedSpans::Registry::Registry() {
+  common::Scheduler::Get()->AddForkHandler(
+      {[this] { PrepareFork(); }, [this] { ParentAfterFork(); },
+       [this] { ChildAfterFork(); }, nullptr});
+}
+
+void EndedSpans::Registry::PrepareFork() {
+  mu.Lock();
+  for (ThreadBatch* batch : batches) {
+    batch->mu.Lock();
+  }
+}
+
+void EndedSpans::Registry::ParentAfterFork() {
+  for (ThreadBatch* batch : batches) {
+    batch->mu.Unlock();
+  }
+  mu.Unlock();
+}
+
+void EndedSpans::Registry::ChildAfterFork() {
+  std::vector<ThreadBatch*> live;
+  for (ThreadBatch* batch : batches) {
+    batch->spans.clear();
+    common::Scheduler::ReinitMutexInChild(&batch->mu);
+    if (batch->owner == std::this_thread::get_id()) {
+      live.push_back(batch);
+    }
+  }
+  batches.swap(live);
+  common::Scheduler::ReinitMutexInChild(&mu);
+}
+
+// static
+EndedSpans::Registry* EndedSpans::GetRegistry() {
+  static Registry* registry = new Registry;
+  return registry;
+}
+
+// static
+void EndedSpans::SetBatchSize(size_t batch_size) {
+  batch_size_.store(batch_size, std::memory_order_relaxed);
+  Flush();
+}
+
+// static
+void EndedSpans::Flush() {
+  std::vector<std::shared_ptr<SpanImpl>> staged;
+  {
+    Registry* registry = GetRegistry();
+    absl::MutexLock l(&registry->mu);
+    for (ThreadBatch* batch : registry->batches) {
+      absl::MutexLock batch_lock(&batch->mu);
+      std::move(batch->spans.begin(), batch->spans.end(),
+                std::back_inserter(staged));
+      batch->spans.clear();
+    }
+  }
+  OPENCENSUS_PROBE1(ended_spans_flush, staged.size());
+  Dispatch(absl::MakeSpan(staged));
+}
+
+// static
+void EndedSpans::Dispatch(const std::shared_ptr<SpanImpl>& span) {
+  exporter::RunningSpanStoreImpl::Get()->RemoveSpan(span);
+  exporter::LocalSpanStoreImpl::Get()->AddSpan(span);
+  exporter::SpanExporterImpl::Get()->AddSpan(span);
+}
+
+// static
+void EndedSpans::Dispatch(absl::Span<std::shared_ptr<SpanImpl>> spans) {
+  if (spans.empty()) return;
+  exporter::RunningSpanStoreImpl::Get()->RemoveSpans(spans);
+  exporter::LocalSpanStoreImpl::Get()->AddSpans(spans);
+  // Last, since the exporter takes the spans.
+  exporter::SpanExporterImpl::Get()->AddSpans(spans);
+}
+
+// static
+void EndedSpans::Stage(const std::shared_ptr<SpanImpl>& span) {
+  static thread_local ThreadBatch batch;
+  std::vector<std::shared_ptr<SpanImpl>> full;
+  {
+    absl::MutexLock l(&batch.mu);
+    batch.spans.push_back(span);
+    if (batch.spans.size() < batch_size_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    full.swap(batch.spans);
+    batch.spans.reserve(full.size());
+  }
+  Dispatch(absl::MakeSpan(full));
+}
+
+}  // namespace trace
+}  // namespace opencensus
@@ -0,0 +1,75 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_ENDED_SPANS_H_
+#define OPENCENSUS_TRACE_INTERNAL_ENDED_SPANS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "absl/types/span.h"
+#include "opencensus/trace/internal/span_impl.h"
+
+namespace opencensus {
+namespace trace {
+
+// EndedSpans hands the spans ended by Span::End() to their consumers: the
+// running span store, which removes them, the local span store, which samples
+// them, and the span exporter, which queues them.
+//
+// By default each span is handed over as it ends, taking a lock in each store.
+// With SetBatchSize(), each thread stages the spans it ends in a batch of its
+// own, which is handed to the three consumers together once full, so that
+// each takes its locks once per batch rather than once per span. The batches
+// of all threads are also handed over whenever the span stores are queried
+// and before each export, so staging delays neither, and when a thread exits.
+//
+// This class is thread-safe.
+class EndedSpans final {
+ public:
+  // Sets how many ended spans each thread stages before handing them over;
+  // 0 or 1 hands each span over as it ends. Spans already staged are handed
+  // over.
+  static void SetBatchSize(size_t batch_size);
+
+  // Hands 'span', which has just ended, to the consumers now or with the
+  // calling thread's batch.
+  static void Add(const std::shared_ptr<SpanImpl>& span) {
+    if (batch_size_.load(std::memory_order_relaxed) <= 1) {
+      Dispatch(span);
+    } else {
+      Stage(span);
+    }
+  }
+
+  // Hands the spans staged by every thread to the consumers.
+  static void Flush();
+
+ private:
+  struct ThreadBatch;
+  struct Registry;
+
+  static void Dispatch(const std::shared_ptr<SpanImpl>& span);
+  static void Dispatch(absl::Span<std::shared_ptr<SpanImpl>> spans);
+  static void Stage(const std::shared_ptr<SpanImpl>& span);
+  static Registry* GetRegistry();
+
+  static std::atomic<size_t> batch_size_;
+};
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_ENDED_SPANS_H_
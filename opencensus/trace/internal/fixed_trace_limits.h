@@ -0,0 +1,69 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_FIXED_TRACE_LIMITS_H_
+#define OPENCENSUS_TRACE_INTERNAL_FIXED_TRACE_LIMITS_H_
+
+#include <cstdint>
+
+// Builds that define OPENCENSUS_TRACE_FIXED_LIMITS (e.g. bazel
+// --config=fixed_trace_limits) fix the maximum numbers of attributes,
+// annotations, message events and links per span at compile time. Spans then
+// store all their events and attributes inline and never allocate for them,
+// at the cost of reserving room for the maximum in every span. The count
+// limits of TraceParams are replaced by these. Each limit can be set with its
+// own define, and defaults to that of the default TraceParams; keep them small,
+// since a message event takes about 40 bytes and an annotation about 100.
+//
+// The define must be set for the whole program.
+
+#ifdef OPENCENSUS_TRACE_FIXED_LIMITS
+#ifndef OPENCENSUS_TRACE_MAX_ATTRIBUTES
+#define OPENCENSUS_TRACE_MAX_ATTRIBUTES 32
+#endif
+#ifndef OPENCENSUS_TRACE_MAX_ANNOTATIONS
+#define OPENCENSUS_TRACE_MAX_ANNOTATIONS 32
+#endif
+#ifndef OPENCENSUS_TRACE_MAX_MESSAGE_EVENTS
+#define OPENCENSUS_TRACE_MAX_MESSAGE_EVENTS 128
+#endif
+#ifndef OPENCENSUS_TRACE_MAX_LINKS
+#define OPENCENSUS_TRACE_MAX_LINKS 32
+#endif
+#endif
+
+namespace opencensus {
+namespace trace {
+
+#ifdef OPENCENSUS_TRACE_FIXED_LIMITS
+constexpr uint32_t kFixedMaxAttributes = OPENCENSUS_TRACE_MAX_ATTRIBUTES;
+constexpr uint32_t kFixedMaxAnnotations = OPENCENSUS_TRACE_MAX_ANNOTATIONS;
+constexpr uint32_t kFixedMaxMessageEvents =
+    OPENCENSUS_TRACE_MAX_MESSAGE_EVENTS;
+constexpr uint32_t kFixedMaxLinks = OPENCENSUS_TRACE_MAX_LINKS;
+static_assert(kFixedMaxAttributes > 0 && kFixedMaxAnnotations > 0 &&
+                  kFixedMaxMessageEvents > 0 && kFixedMaxLinks > 0,
+              "Fixed trace limits must be positive.");
+#else
+// 0 means the limit is read from the TraceParams.
+constexpr uint32_t kFixedMaxAttributes = 0;
+constexpr uint32_t kFixedMaxAnnotations = 0;
+constexpr uint32_t kFixedMaxMessageEvents = 0;
+constexpr uint32_t kFixedMaxLinks = 0;
+#endif
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_FIXED_TRACE_LIMITS_H_
@@ -0,0 +1,41 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_HEX_H_
+#define OPENCENSUS_TRACE_INTERNAL_HEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace trace {
+
+// Table-driven hex encoding and decoding for the propagation formats, which
+// write into caller-provided buffers instead of allocating strings.
+
+// Writes the 2 * n lowercase hex digits of bytes[0, n) to out.
+void EncodeHex(const uint8_t* bytes, size_t n, char* out);
+
+// Decodes hex, which must have an even length, into the hex.size() / 2 bytes
+// at out. Returns false, leaving out in an unspecified state, if hex contains
+// a character that is not a hex digit, or an uppercase digit and
+// allow_uppercase is false.
+bool DecodeHex(absl::string_view hex, bool allow_uppercase, uint8_t* out);
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_HEX_H_
@@ -0,0 +1,91 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/tags/tag_map.h"
+#include "opencensus/tags/with_tag_map.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/with_span.h"
+
+// Measures the cost of instrumenting an operation: starting a Span, making it
+// current along with a TagMap, annotating it, recording a measurement and
+// ending it. This is built twice, as instrumentation_benchmark and as
+// instrumentation_noop_benchmark with OPENCENSUS_NOOP defined, where the
+// instrumented benchmarks should match BM_Uninstrumented.
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+opencensus::stats::MeasureInt64 LatencyMeasure() {
+  static const opencensus::stats::MeasureInt64 measure =
+      opencensus::stats::MeasureInt64::Register(
+          "instrumentation_benchmark/latency", "", "ms");
+  return measure;
+}
+
+opencensus::tags::TagKey MethodKey() {
+  static const opencensus::tags::TagKey key =
+      opencensus::tags::TagKey::Register("method");
+  return key;
+}
+
+void BM_Uninstrumented(benchmark::State& state) {
+  int64_t work = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++work);
+  }
+}
+BENCHMARK(BM_Uninstrumented);
+
+void Instrumented(benchmark::State& state, Sampler* sampler) {
+  const opencensus::stats::MeasureInt64 measure = LatencyMeasure();
+  const opencensus::tags::TagMap tags({{MethodKey(), "Get"}});
+  int64_t work = 0;
+  for (auto _ : state) {
+    auto span = Span::StartSpan("MySpan", /*parent=*/nullptr, {sampler});
+    {
+      WithSpan ws(span);
+      opencensus::tags::WithTagMap wt(tags);
+      benchmark::DoNotOptimize(++work);
+      span.AddAttribute("key", "value");
+      span.AddAnnotation("Done.");
+      opencensus::stats::Record({{measure, work}});
+    }
+    span.End();
+  }
+}
+
+void BM_InstrumentedUnsampled(benchmark::State& state) {
+  static NeverSampler sampler;
+  Instrumented(state, &sampler);
+}
+BENCHMARK(BM_InstrumentedUnsampled);
+
+void BM_InstrumentedSampled(benchmark::State& state) {
+  static AlwaysSampler sampler;
+  Instrumented(state, &sampler);
+}
+BENCHMARK(BM_InstrumentedSampled);
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
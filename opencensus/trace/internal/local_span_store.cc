@@ -14,9 +14,11 @@
 
 #include "opencensus/trace/internal/local_span_store.h"
 
+#include <functional>
 #include <vector>
 
 #include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/internal/ended_spans.h"
 #include "opencensus/trace/internal/local_span_store_impl.h"
 
 namespace opencensus {
@@ -24,20 +26,38 @@ namespace trace {
 namespace exporter {
 
 LocalSpanStore::Summary LocalSpanStore::GetSummary() {
+  EndedSpans::Flush();
   return LocalSpanStoreImpl::Get()->GetSummary();
 }
 
 std::vector<SpanData> LocalSpanStore::GetLatencySampledSpans(
     const LocalSpanStore::LatencyFilter& filter) {
+  EndedSpans::Flush();
   return LocalSpanStoreImpl::Get()->GetLatencySampledSpans(filter);
 }
 
 std::vector<SpanData> LocalSpanStore::GetErrorSampledSpans(
     const LocalSpanStore::ErrorFilter& filter) {
+  EndedSpans::Flush();
   return LocalSpanStoreImpl::Get()->GetErrorSampledSpans(filter);
 }
 
+void LocalSpanStore::VisitLatencySampledSpans(
+    const LatencyFilter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) {
+  EndedSpans::Flush();
+  LocalSpanStoreImpl::Get()->VisitLatencySampledSpans(filter, offset, visitor);
+}
+
+void LocalSpanStore::VisitErrorSampledSpans(
+    const ErrorFilter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) {
+  EndedSpans::Flush();
+  LocalSpanStoreImpl::Get()->VisitErrorSampledSpans(filter, offset, visitor);
+}
+
 std::vector<SpanData> LocalSpanStore::GetSpans() {
+  EndedSpans::Flush();
   return LocalSpanStoreImpl::Get()->GetSpans();
 }
 
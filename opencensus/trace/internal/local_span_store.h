@@ -15,6 +15,7 @@
 #ifndef OPENCENSUS_TRACE_EXPORTER_LOCAL_SPAN_STORE_H_
 #define OPENCENSUS_TRACE_EXPORTER_LOCAL_SPAN_STORE_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -99,6 +100,19 @@ class LocalSpanStore {
   // Returns SpanData for the sampled spans that match the error filter.
   static std::vector<SpanData> GetErrorSampledSpans(const ErrorFilter& filter);
 
+  // Like GetLatencySampledSpans() and GetErrorSampledSpans(), but skips the
+  // first 'offset' matching spans, and calls 'visitor' with each of the rest
+  // instead of returning them. Spans are converted one at a time, without
+  // holding the store's lock, so that pages can be rendered without copying
+  // every sample. Within a span name and bucket, spans are visited most
+  // recent first.
+  static void VisitLatencySampledSpans(
+      const LatencyFilter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor);
+  static void VisitErrorSampledSpans(
+      const ErrorFilter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor);
+
   // Returns SpanData for all spans in the local span store.
   static std::vector<SpanData> GetSpans();
 };
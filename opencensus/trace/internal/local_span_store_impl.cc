@@ -14,9 +14,13 @@
 
 #include "opencensus/trace/internal/local_span_store_impl.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <queue>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -27,6 +31,8 @@
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/scheduler.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/status.h"
 #include "opencensus/trace/internal/span_impl.h"
@@ -39,7 +45,6 @@ namespace trace {
 namespace exporter {
 
 namespace {
-constexpr int kMaxSpans = 128;
 
 using ErrorFilter = LocalSpanStore::ErrorFilter;
 using LatencyBucketBoundary = LocalSpanStore::LatencyBucketBoundary;
@@ -75,17 +80,44 @@ LatencyBucketBoundary GetLatencyBucketBoundary(absl::Duration latency) {
   return LatencyBucketBoundary::k100s_plus;
 }
 
-// Increment the counter corresponding to the given key. Sets it to 1 if the key
-// wasn't present before.
-template <typename Key, typename Hash>
-void MapIncrement(const Key& key, std::unordered_map<Key, int, Hash>* map) {
-  auto iter_inserted = map->insert({key, 1});
-  if (!iter_inserted.second) {
-    // Was not inserted: needs to be incremented instead.
-    ++iter_inserted.first->second;
+// Converts a latency filter bound to a Duration, saturating at the largest
+// finite Duration.
+absl::Duration NanosToDuration(uint64_t ns) {
+  return absl::Nanoseconds(static_cast<int64_t>(std::min<uint64_t>(
+      ns, std::numeric_limits<int64_t>::max())));
+}
+
+// Adds 'sample' to the front of 'samples', evicting the oldest sample if it
+// holds max_samples spans.
+template <typename Samples>
+void AddSample(typename Samples::value_type&& sample, size_t max_samples,
+               Samples* samples) {
+  if (samples->size() >= max_samples) {
+    samples->pop_back();
+  }
+  samples->emplace_front(std::move(sample));
+}
+
+// Appends the spans in 'samples' for which 'matches' returns true, until 'out'
+// holds max_spans spans. The first *skip matching spans are skipped instead,
+// decrementing *skip.
+template <typename Samples, typename Predicate>
+void AppendMatching(const Samples& samples,
+                    const Predicate& matches, size_t max_spans, size_t* skip,
+                    std::vector<std::shared_ptr<SpanImpl>>* out) {
+  for (const auto& sample : samples) {
+    if (out->size() >= max_spans) return;
+    if (matches(sample)) {
+      if (*skip > 0) {
+        --*skip;
+      } else {
+        out->push_back(sample.span);
+      }
+    }
   }
 }
 
+
 }  // namespace
 
 LocalSpanStoreImpl* LocalSpanStoreImpl::Get() {
@@ -93,68 +125,263 @@ LocalSpanStoreImpl* LocalSpanStoreImpl::Get() {
   return global_running_span_store;
 }
 
+LocalSpanStoreImpl::LocalSpanStoreImpl() {
+  common::Scheduler::Get()->AddForkHandler(
+      {[this] { PrepareFork(); }, [this] { ParentAfterFork(); },
+       [this] { ChildAfterFork(); }, nullptr});
+}
+
+void LocalSpanStoreImpl::PrepareFork() { mu_.Lock(); }
+
+void LocalSpanStoreImpl::ParentAfterFork() { mu_.Unlock(); }
+
+void LocalSpanStoreImpl::ChildAfterFork() {
+  samples_.clear();
+  common::Scheduler::ReinitMutexInChild(&mu_);
+}
+
+constexpr int LocalSpanStoreImpl::kNumLatencyBuckets;
+constexpr size_t LocalSpanStoreImpl::kMaxLatencySamples;
+constexpr size_t LocalSpanStoreImpl::kMaxErrorSamples;
+constexpr size_t LocalSpanStoreImpl::kMaxSpanNames;
+
 void LocalSpanStoreImpl::AddSpan(const std::shared_ptr<SpanImpl>& span) {
+  // Read the span before taking the lock.
+  Sample sample = {span, span->latency()};
+  const StatusCode code = span->status_code();
+  absl::MutexLock l(&mu_);
+  AddSampleLocked(std::move(sample), code);
+}
+
+void LocalSpanStoreImpl::AddSpans(
+    absl::Span<const std::shared_ptr<SpanImpl>> spans) {
+  // Read the spans before taking the lock.
+  std::vector<std::pair<Sample, StatusCode>> samples;
+  samples.reserve(spans.size());
+  for (const auto& span : spans) {
+    samples.push_back({{span, span->latency()}, span->status_code()});
+  }
   absl::MutexLock l(&mu_);
-  if (spans_.size() >= kMaxSpans) {
-    spans_.pop_back();  // Make room.
+  for (auto& sample : samples) {
+    AddSampleLocked(std::move(sample.first), sample.second);
+  }
+}
+
+void LocalSpanStoreImpl::AddSampleLocked(Sample sample, StatusCode code) {
+  const absl::string_view name = sample.span->name();
+  auto it = samples_.find(name);
+  if (it == samples_.end()) {
+    if (samples_.size() >= kMaxSpanNames) {
+      return;
+    }
+    it = samples_.insert({name, PerSpanNameSamples()}).first;
+  }
+  if (code == StatusCode::OK) {
+    const LatencyBucketBoundary bucket =
+        GetLatencyBucketBoundary(sample.latency);
+    AddSample(std::move(sample), kMaxLatencySamples,
+              &it->second.latency_samples[bucket]);
+  } else {
+    AddSample(std::move(sample), kMaxErrorSamples,
+              &it->second.error_samples[code]);
   }
-  spans_.emplace_front(span->ToSpanData());
 }
 
 Summary LocalSpanStoreImpl::GetSummary() const {
   Summary summary;
   absl::MutexLock l(&mu_);
-  for (const auto& span : spans_) {
-    PerSpanNameSummary& curr = GetPerSpanNameSummary(span.name(), &summary);
-    const absl::Duration latency = span.end_time() - span.start_time();
-    MapIncrement(GetLatencyBucketBoundary(latency),
-                 &curr.number_of_latency_sampled_spans);
-    MapIncrement(span.status().CanonicalCode(),
-                 &curr.number_of_error_sampled_spans);
+  for (const auto& name_samples : samples_) {
+    PerSpanNameSummary& curr =
+        GetPerSpanNameSummary(name_samples.first, &summary);
+    const PerSpanNameSamples& samples = name_samples.second;
+    for (int bucket = 0; bucket < kNumLatencyBuckets; ++bucket) {
+      if (!samples.latency_samples[bucket].empty()) {
+        curr.number_of_latency_sampled_spans[static_cast<LatencyBucketBoundary>(
+            bucket)] = samples.latency_samples[bucket].size();
+      }
+    }
+    for (const auto& code_samples : samples.error_samples) {
+      if (!code_samples.second.empty()) {
+        curr.number_of_error_sampled_spans[code_samples.first] =
+            code_samples.second.size();
+      }
+    }
   }
   return summary;
 }
 
 std::vector<SpanData> LocalSpanStoreImpl::GetLatencySampledSpans(
     const LatencyFilter& filter) const {
-  std::vector<SpanData> out;
+  return ToSpanData(LatencySampledSpans(filter, 0));
+}
+
+std::vector<SpanData> LocalSpanStoreImpl::GetErrorSampledSpans(
+    const ErrorFilter& filter) const {
+  return ToSpanData(ErrorSampledSpans(filter, 0));
+}
+
+void LocalSpanStoreImpl::VisitLatencySampledSpans(
+    const LatencyFilter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) const {
+  VisitSpans(LatencySampledSpans(filter, offset), visitor);
+}
+
+void LocalSpanStoreImpl::VisitErrorSampledSpans(
+    const ErrorFilter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) const {
+  VisitSpans(ErrorSampledSpans(filter, offset), visitor);
+}
+
+std::vector<std::shared_ptr<SpanImpl>> LocalSpanStoreImpl::LatencySampledSpans(
+    const LatencyFilter& filter, int offset) const {
+  if (filter.max_spans_to_return <= 0 ||
+      filter.lower_latency_ns >= filter.upper_latency_ns) {
+    return {};
+  }
+  const size_t max_spans = filter.max_spans_to_return;
+  size_t skip = std::max(offset, 0);
+  // Only the buckets overlapping [lower_latency_ns, upper_latency_ns) can hold
+  // matching spans.
+  const int first_bucket =
+      GetLatencyBucketBoundary(NanosToDuration(filter.lower_latency_ns));
+  const int last_bucket =
+      GetLatencyBucketBoundary(NanosToDuration(filter.upper_latency_ns - 1));
+  auto matches = [&filter](const Sample& sample) {
+    const uint64_t latency_ns = sample.latency / absl::Nanoseconds(1);
+    return latency_ns >= filter.lower_latency_ns &&
+           latency_ns < filter.upper_latency_ns;
+  };
+  std::vector<std::shared_ptr<SpanImpl>> out;
   absl::MutexLock l(&mu_);
-  for (const auto& span : spans_) {
-    uint64_t latency_ns =
-        (span.end_time() - span.start_time()) / absl::Nanoseconds(1);
-    if ((filter.span_name.empty() || (span.name() == filter.span_name)) &&
-        latency_ns >= filter.lower_latency_ns &&
-        latency_ns < filter.upper_latency_ns) {
-      out.emplace_back(span);
+  auto visit = [&](const PerSpanNameSamples& samples) {
+    for (int bucket = first_bucket; bucket <= last_bucket; ++bucket) {
+      AppendMatching(samples.latency_samples[bucket], matches, max_spans,
+                     &skip, &out);
+    }
+  };
+  if (!filter.span_name.empty()) {
+    auto it = samples_.find(filter.span_name);
+    if (it != samples_.end()) visit(it->second);
+  } else {
+    for (const auto& name_samples : samples_) {
+      visit(name_samples.second);
     }
-    if (out.size() >= filter.max_spans_to_return) break;
   }
   return out;
 }
 
-std::vector<SpanData> LocalSpanStoreImpl::GetErrorSampledSpans(
-    const ErrorFilter& filter) const {
-  std::vector<SpanData> out;
+std::vector<std::shared_ptr<SpanImpl>> LocalSpanStoreImpl::ErrorSampledSpans(
+    const ErrorFilter& filter, int offset) const {
+  if (filter.max_spans_to_return <= 0) {
+    return {};
+  }
+  const size_t max_spans = filter.max_spans_to_return;
+  size_t skip = std::max(offset, 0);
+  auto matches = [](const Sample&) { return true; };
+  std::vector<std::shared_ptr<SpanImpl>> out;
   absl::MutexLock l(&mu_);
-  for (const auto& span : spans_) {
-    if ((filter.span_name.empty() || (span.name() == filter.span_name)) &&
-        filter.canonical_code == span.status().CanonicalCode()) {
-      out.emplace_back(span);
+  auto visit = [&](const PerSpanNameSamples& samples) {
+    if (filter.all_errors) {
+      for (const auto& code_samples : samples.error_samples) {
+        AppendMatching(code_samples.second, matches, max_spans, &skip, &out);
+      }
+    } else {
+      auto it = samples.error_samples.find(filter.canonical_code);
+      if (it != samples.error_samples.end()) {
+        AppendMatching(it->second, matches, max_spans, &skip, &out);
+      }
+    }
+  };
+  if (!filter.span_name.empty()) {
+    auto it = samples_.find(filter.span_name);
+    if (it != samples_.end()) visit(it->second);
+  } else {
+    for (const auto& name_samples : samples_) {
+      visit(name_samples.second);
     }
-    if (out.size() >= filter.max_spans_to_return) break;
   }
   return out;
 }
 
 std::vector<SpanData> LocalSpanStoreImpl::GetSpans() const {
-  absl::MutexLock l(&mu_);
-  std::vector<SpanData> out(spans_.begin(), spans_.end());
-  return out;
+  std::vector<std::shared_ptr<SpanImpl>> out;
+  {
+    absl::MutexLock l(&mu_);
+    auto append = [&out](const Samples& samples) {
+      for (const auto& sample : samples) {
+        out.push_back(sample.span);
+      }
+    };
+    for (const auto& name_samples : samples_) {
+      for (const auto& samples : name_samples.second.latency_samples) {
+        append(samples);
+      }
+      for (const auto& code_samples : name_samples.second.error_samples) {
+        append(code_samples.second);
+      }
+    }
+  }
+  return ToSpanData(out);
+}
+
+TraceMemoryUsage::Store LocalSpanStoreImpl::MemoryUsage() const {
+  TraceMemoryUsage::Store usage;
+  usage.bytes = sizeof(*this);
+  std::vector<std::shared_ptr<SpanImpl>> spans;
+  {
+    absl::MutexLock l(&mu_);
+    usage.bytes += samples_.capacity() * (sizeof(*samples_.begin()) + 1);
+    const auto append = [&spans](const Samples& samples) {
+      for (const Sample& sample : samples) {
+        spans.push_back(sample.span);
+      }
+    };
+    for (const auto& name_samples : samples_) {
+      const PerSpanNameSamples& samples = name_samples.second;
+      for (const Samples& bucket_samples : samples.latency_samples) {
+        append(bucket_samples);
+      }
+      usage.bytes +=
+          samples.error_samples.bucket_count() * sizeof(void*) +
+          samples.error_samples.size() *
+              (sizeof(*samples.error_samples.begin()) + sizeof(void*));
+      for (const auto& code_samples : samples.error_samples) {
+        append(code_samples.second);
+      }
+    }
+  }
+  // As with queries, the spans are measured without holding mu_.
+  usage.spans = spans.size();
+  usage.bytes += spans.size() * sizeof(Sample);
+  for (const auto& span : spans) {
+    usage.bytes += span->ApproximateBytes();
+  }
+  return usage;
 }
 
 void LocalSpanStoreImpl::ClearForTesting() {
   absl::MutexLock l(&mu_);
-  spans_.clear();
+  samples_.clear();
+}
+
+// static
+void LocalSpanStoreImpl::VisitSpans(
+    const std::vector<std::shared_ptr<SpanImpl>>& spans,
+    const std::function<void(const SpanData&)>& visitor) {
+  for (const auto& span : spans) {
+    visitor(span->ToSpanData());
+  }
+}
+
+// static
+std::vector<SpanData> LocalSpanStoreImpl::ToSpanData(
+    const std::vector<std::shared_ptr<SpanImpl>>& spans) {
+  std::vector<SpanData> out;
+  out.reserve(spans.size());
+  for (const auto& span : spans) {
+    out.push_back(span->ToSpanData());
+  }
+  return out;
 }
 
 }  // namespace exporter
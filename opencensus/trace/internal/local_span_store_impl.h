@@ -17,8 +17,10 @@
 
 #include "opencensus/trace/internal/local_span_store.h"
 
+#include <array>
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -27,15 +29,19 @@
 
 #include "absl/base/internal/endian.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/memory_resource.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/status.h"
 #include "opencensus/trace/internal/span_impl.h"
 #include "opencensus/trace/span.h"
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_config.h"
 
 namespace opencensus {
 namespace trace {
@@ -43,6 +49,14 @@ namespace exporter {
 
 // LocalSpanStoreImpl implements the LocalSpanStore API.
 //
+// Ended spans are sampled per span name: successful spans into a bounded
+// reservoir per LatencyBucketBoundary, and failed spans into a bounded
+// reservoir per StatusCode. Each reservoir keeps its most recent spans, so a
+// frequent span name only evicts its own samples, and queries only visit the
+// reservoirs they select. Samples hold the ended SpanImpl, which no longer
+// changes, and are only converted to SpanData when queried, so that Span::End()
+// does not copy spans that are evicted before anyone looks at them.
+//
 // This class is thread-safe and a singleton.
 class LocalSpanStoreImpl {
  public:
@@ -51,6 +65,9 @@ class LocalSpanStoreImpl {
 
   // Adds a new running Span. Only Span::End should call this.
   void AddSpan(const std::shared_ptr<SpanImpl>& span) LOCKS_EXCLUDED(mu_);
+  // As AddSpan(), for spans ended together, taking the lock once.
+  void AddSpans(absl::Span<const std::shared_ptr<SpanImpl>> spans)
+      LOCKS_EXCLUDED(mu_);
 
   // Returns a summary of the data available in the LocalSpanStore.
   LocalSpanStore::Summary GetSummary() const LOCKS_EXCLUDED(mu_);
@@ -64,17 +81,83 @@ class LocalSpanStoreImpl {
 
   std::vector<SpanData> GetSpans() const LOCKS_EXCLUDED(mu_);
 
+  // See LocalSpanStore::VisitLatencySampledSpans() and
+  // VisitErrorSampledSpans().
+  void VisitLatencySampledSpans(
+      const LocalSpanStore::LatencyFilter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor) const
+      LOCKS_EXCLUDED(mu_);
+  void VisitErrorSampledSpans(
+      const LocalSpanStore::ErrorFilter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor) const
+      LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of sampled spans and the approximate bytes they and
+  // the store hold.
+  TraceMemoryUsage::Store MemoryUsage() const LOCKS_EXCLUDED(mu_);
+
  private:
   friend class LocalSpanStoreImplTestPeer;
 
-  // Private so only Get() can call it.
-  LocalSpanStoreImpl() {}
+  // Private so only Get() can call it. Registers the fork handler.
+  LocalSpanStoreImpl();
+
+  // The common::Scheduler fork handler. The child clears the store, so that
+  // its pages show only its own spans.
+  void PrepareFork() EXCLUSIVE_LOCK_FUNCTION(mu_);
+  void ParentAfterFork() UNLOCK_FUNCTION(mu_);
+  void ChildAfterFork() UNLOCK_FUNCTION(mu_);
 
   // Clears all currently active spans from the store.
   void ClearForTesting() LOCKS_EXCLUDED(mu_);
 
+  // Selects the spans matching a query, skipping the first 'offset'.
+  std::vector<std::shared_ptr<SpanImpl>> LatencySampledSpans(
+      const LocalSpanStore::LatencyFilter& filter, int offset) const
+      LOCKS_EXCLUDED(mu_);
+  std::vector<std::shared_ptr<SpanImpl>> ErrorSampledSpans(
+      const LocalSpanStore::ErrorFilter& filter, int offset) const
+      LOCKS_EXCLUDED(mu_);
+
+  // Converts spans selected by a query, which is done without holding mu_.
+  static std::vector<SpanData> ToSpanData(
+      const std::vector<std::shared_ptr<SpanImpl>>& spans);
+  // Like ToSpanData(), but passes each span to 'visitor' as it is converted.
+  static void VisitSpans(const std::vector<std::shared_ptr<SpanImpl>>& spans,
+                         const std::function<void(const SpanData&)>& visitor);
+
+  static constexpr int kNumLatencyBuckets =
+      LocalSpanStore::LatencyBucketBoundary::k100s_plus + 1;
+  // The number of spans kept in each reservoir.
+  static constexpr size_t kMaxLatencySamples = 8;
+  static constexpr size_t kMaxErrorSamples = 4;
+  // Spans with names beyond the first kMaxSpanNames are not sampled, to bound
+  // the store's memory.
+  static constexpr size_t kMaxSpanNames = 256;
+
+  struct Sample {
+    std::shared_ptr<SpanImpl> span;
+    absl::Duration latency;
+  };
+  // Samples the span of 'sample', which ended with 'code'.
+  void AddSampleLocked(Sample sample, StatusCode code)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // A reservoir of sampled spans, most recent first.
+  typedef std::deque<
+      Sample,
+      common::ResourceAllocator<Sample, common::MemorySubsystem::kSpanStores>>
+      Samples;
+
+  struct PerSpanNameSamples {
+    std::array<Samples, kNumLatencyBuckets> latency_samples;
+    std::unordered_map<StatusCode, Samples, std::hash<int>> error_samples;
+  };
+
   mutable absl::Mutex mu_;
-  std::deque<SpanData> spans_ GUARDED_BY(mu_);
+  // Keyed by interned span names, which outlive the store.
+  absl::flat_hash_map<absl::string_view, PerSpanNameSamples> samples_
+      GUARDED_BY(mu_);
 };
 
 }  // namespace exporter
@@ -14,6 +14,12 @@
 
 #include "opencensus/trace/internal/local_span_store.h"
 
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "gtest/gtest.h"
 #include "opencensus/trace/internal/local_span_store_impl.h"
 #include "opencensus/trace/sampler.h"
@@ -43,8 +49,111 @@ TEST(LocalSpanStoreTest, GetSummary) {
   EXPECT_EQ(1, summary.per_span_name_summary.size());
   EXPECT_EQ(1, summary.per_span_name_summary["SpanName"]
                    .number_of_latency_sampled_spans.size());
-  // TODO: EXPECT it ended up in the right bucket in
-  // number_of_latency_sampled_spans[].
+  EXPECT_TRUE(summary.per_span_name_summary["SpanName"]
+                  .number_of_error_sampled_spans.empty());
+}
+
+TEST(LocalSpanStoreTest, SamplesKeepEventsUntilQueried) {
+  exporter::LocalSpanStoreImplTestPeer::ClearForTesting();
+  static AlwaysSampler sampler;
+  {
+    auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
+    span.AddAnnotation("Annotation");
+    span.AddAttribute("key", "value");
+    span.End();
+  }
+
+  const auto spans = LocalSpanStore::GetSpans();
+  ASSERT_EQ(1, spans.size());
+  ASSERT_EQ(1, spans[0].annotations().events().size());
+  EXPECT_EQ("Annotation",
+            spans[0].annotations().events()[0].event().description());
+  EXPECT_EQ(1, spans[0].attributes().count("key"));
+}
+
+TEST(LocalSpanStoreTest, SamplesByLatencyAndError) {
+  exporter::LocalSpanStoreImplTestPeer::ClearForTesting();
+  static AlwaysSampler sampler;
+  // Many successful spans of one name do not evict the samples of others.
+  for (int i = 0; i < 100; ++i) {
+    Span::StartSpan("Hot", /*parent=*/nullptr, {&sampler}).End();
+  }
+  auto failed = Span::StartSpan("Failed", /*parent=*/nullptr, {&sampler});
+  failed.SetStatus(StatusCode::UNAVAILABLE, "unavailable");
+  failed.End();
+  auto slow = Span::StartSpan("Slow", /*parent=*/nullptr, {&sampler});
+  absl::SleepFor(absl::Milliseconds(10));
+  slow.End();
+
+  auto summary = LocalSpanStore::GetSummary();
+  EXPECT_EQ(3, summary.per_span_name_summary.size());
+  EXPECT_EQ(1, summary.per_span_name_summary["Failed"]
+                   .number_of_error_sampled_spans[StatusCode::UNAVAILABLE]);
+  EXPECT_TRUE(summary.per_span_name_summary["Failed"]
+                  .number_of_latency_sampled_spans.empty());
+  int hot_samples = 0;
+  for (const auto& bucket_count :
+       summary.per_span_name_summary["Hot"].number_of_latency_sampled_spans) {
+    hot_samples += bucket_count.second;
+  }
+  EXPECT_GT(hot_samples, 0);
+  EXPECT_LT(hot_samples, 100);
+
+  auto errors = LocalSpanStore::GetErrorSampledSpans(
+      {"", 10, StatusCode::UNAVAILABLE, false});
+  ASSERT_EQ(1, errors.size());
+  EXPECT_EQ("Failed", errors[0].name());
+  EXPECT_EQ(1, LocalSpanStore::GetErrorSampledSpans(
+                   {"Failed", 10, StatusCode::OK, true})
+                   .size());
+  EXPECT_EQ(0, LocalSpanStore::GetErrorSampledSpans(
+                   {"Hot", 10, StatusCode::OK, true})
+                   .size());
+
+  auto slow_spans = LocalSpanStore::GetLatencySampledSpans(
+      {"", 10, 10 * 1000 * 1000, std::numeric_limits<uint64_t>::max()});
+  ASSERT_EQ(1, slow_spans.size());
+  EXPECT_EQ("Slow", slow_spans[0].name());
+  EXPECT_EQ(2, LocalSpanStore::GetLatencySampledSpans(
+                   {"Hot", 2, 0, std::numeric_limits<uint64_t>::max()})
+                   .size());
+}
+
+TEST(LocalSpanStoreTest, VisitSampledSpansPages) {
+  exporter::LocalSpanStoreImplTestPeer::ClearForTesting();
+  static AlwaysSampler sampler;
+  for (int i = 0; i < 3; ++i) {
+    auto span = Span::StartSpan("Failed", /*parent=*/nullptr, {&sampler});
+    span.AddAttribute("index", i);
+    span.SetStatus(StatusCode::UNAVAILABLE, "unavailable");
+    span.End();
+  }
+  std::vector<int64_t> indexes;
+  const auto visitor = [&indexes](const SpanData& span) {
+    indexes.push_back(span.attributes().at("index").int_value());
+  };
+  const LocalSpanStore::ErrorFilter filter = {"Failed", 2,
+                                              StatusCode::UNAVAILABLE, false};
+  // Most recent first.
+  LocalSpanStore::VisitErrorSampledSpans(filter, 0, visitor);
+  EXPECT_EQ(std::vector<int64_t>({2, 1}), indexes);
+  indexes.clear();
+  LocalSpanStore::VisitErrorSampledSpans(filter, 2, visitor);
+  EXPECT_EQ(std::vector<int64_t>({0}), indexes);
+  indexes.clear();
+  LocalSpanStore::VisitErrorSampledSpans(filter, 3, visitor);
+  EXPECT_TRUE(indexes.empty());
+
+  auto ok = Span::StartSpan("Ok", /*parent=*/nullptr, {&sampler});
+  ok.AddAttribute("index", 7);
+  ok.End();
+  LocalSpanStore::VisitLatencySampledSpans(
+      {"Ok", 10, 0, std::numeric_limits<uint64_t>::max()}, 0, visitor);
+  EXPECT_EQ(std::vector<int64_t>({7}), indexes);
+  indexes.clear();
+  LocalSpanStore::VisitLatencySampledSpans(
+      {"Ok", 10, 0, std::numeric_limits<uint64_t>::max()}, 1, visitor);
+  EXPECT_TRUE(indexes.empty());
 }
 
 }  // namespace
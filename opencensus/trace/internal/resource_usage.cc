@@ -0,0 +1,57 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/resource_usage.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace opencensus {
+namespace trace {
+
+namespace {
+
+std::atomic<TraceConfig::ThreadAllocatedBytesFunction> allocated_bytes_fn{
+    nullptr};
+
+int64_t ThreadCpuTimeNanos() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+#endif
+  return -1;
+}
+
+}  // namespace
+
+ThreadResourceUsage GetThreadResourceUsage() {
+  ThreadResourceUsage usage;
+  usage.cpu_time_ns = ThreadCpuTimeNanos();
+  const TraceConfig::ThreadAllocatedBytesFunction fn =
+      allocated_bytes_fn.load(std::memory_order_acquire);
+  usage.allocated_bytes = fn == nullptr ? -1 : fn();
+  return usage;
+}
+
+void SetThreadAllocatedBytesFunction(
+    TraceConfig::ThreadAllocatedBytesFunction fn) {
+  allocated_bytes_fn.store(fn, std::memory_order_release);
+}
+
+}  // namespace trace
+}  // namespace opencensus
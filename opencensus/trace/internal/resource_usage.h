@@ -0,0 +1,44 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_RESOURCE_USAGE_H_
+#define OPENCENSUS_TRACE_INTERNAL_RESOURCE_USAGE_H_
+
+#include <cstdint>
+
+#include "opencensus/trace/trace_config.h"
+
+namespace opencensus {
+namespace trace {
+
+// The resources used by the calling thread so far, as recorded by Spans
+// started with StartSpanOptions::record_resource_usage. Each is -1 if it
+// cannot be measured: CPU time on platforms without
+// CLOCK_THREAD_CPUTIME_ID, and allocations unless a function was installed
+// with TraceConfig::SetThreadAllocatedBytesFunction().
+struct ThreadResourceUsage {
+  int64_t cpu_time_ns;
+  int64_t allocated_bytes;
+};
+
+ThreadResourceUsage GetThreadResourceUsage();
+
+// Implements TraceConfig::SetThreadAllocatedBytesFunction(). Thread-safe.
+void SetThreadAllocatedBytesFunction(
+    TraceConfig::ThreadAllocatedBytesFunction fn);
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_RESOURCE_USAGE_H_
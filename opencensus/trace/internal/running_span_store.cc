@@ -14,9 +14,11 @@
 
 #include "opencensus/trace/internal/running_span_store.h"
 
+#include <functional>
 #include <vector>
 
 #include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/internal/ended_spans.h"
 #include "opencensus/trace/internal/running_span_store_impl.h"
 
 namespace opencensus {
@@ -24,13 +26,22 @@ namespace trace {
 namespace exporter {
 
 RunningSpanStore::Summary RunningSpanStore::GetSummary() {
+  EndedSpans::Flush();
   return RunningSpanStoreImpl::Get()->GetSummary();
 }
 
 std::vector<SpanData> RunningSpanStore::GetRunningSpans(const Filter& filter) {
+  EndedSpans::Flush();
   return RunningSpanStoreImpl::Get()->GetRunningSpans(filter);
 }
 
+void RunningSpanStore::VisitRunningSpans(
+    const Filter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) {
+  EndedSpans::Flush();
+  RunningSpanStoreImpl::Get()->VisitRunningSpans(filter, offset, visitor);
+}
+
 }  // namespace exporter
 }  // namespace trace
 }  // namespace opencensus
@@ -15,6 +15,7 @@
 #ifndef OPENCENSUS_TRACE_EXPORTER_RUNNING_SPAN_STORE_H_
 #define OPENCENSUS_TRACE_EXPORTER_RUNNING_SPAN_STORE_H_
 
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -63,6 +64,15 @@ class RunningSpanStore {
 
   // Returns SpanData for the running spans that match the filter.
   static std::vector<SpanData> GetRunningSpans(const Filter& filter);
+
+  // Calls 'visitor' with the SpanData of each running span that matches the
+  // filter, skipping the first 'offset' matches. Spans are converted one at a
+  // time, without holding the store's locks, so that pages of a large store
+  // can be rendered without copying all of it. The order of running spans is
+  // unspecified and may change as spans start and end.
+  static void VisitRunningSpans(
+      const Filter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor);
 };
 
 }  // namespace exporter
@@ -14,7 +14,10 @@
 
 #include "opencensus/trace/internal/running_span_store_impl.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -23,8 +26,13 @@
 
 #include "absl/base/internal/endian.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/scheduler.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/internal/span_impl.h"
 #include "opencensus/trace/span_context.h"
@@ -48,52 +56,251 @@ RunningSpanStoreImpl* RunningSpanStoreImpl::Get() {
   return global_running_span_store;
 }
 
+constexpr size_t RunningSpanStoreImpl::kNumShards;
+
+RunningSpanStoreImpl::RunningSpanStoreImpl() {
+  common::Scheduler::Get()->AddForkHandler(
+      {[this] { PrepareFork(); }, [this] { ParentAfterFork(); },
+       [this] { ChildAfterFork(); }, nullptr});
+}
+
+void RunningSpanStoreImpl::PrepareFork() {
+  for (Shard& shard : shards_) {
+    shard.mu.Lock();
+  }
+}
+
+void RunningSpanStoreImpl::ParentAfterFork() {
+  for (Shard& shard : shards_) {
+    shard.mu.Unlock();
+  }
+}
+
+void RunningSpanStoreImpl::ChildAfterFork() {
+  for (Shard& shard : shards_) {
+    shard.spans_by_name.clear();
+    common::Scheduler::ReinitMutexInChild(&shard.mu);
+  }
+}
+
+// static
+size_t RunningSpanStoreImpl::ShardIndex(uintptr_t key) {
+  // The low bits of addresses are mostly constant because of alignment; mix
+  // them into the high bits and use those.
+  const uint64_t hash = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+  return static_cast<size_t>(hash >> 60) % kNumShards;
+}
+
 void RunningSpanStoreImpl::AddSpan(const std::shared_ptr<SpanImpl>& span) {
-  absl::MutexLock l(&mu_);
-  spans_.insert({GetKey(span.get()), span});
+  const uintptr_t key = GetKey(span.get());
+  Shard& shard = ShardFor(key);
+  absl::MutexLock l(&shard.mu);
+  shard.spans_by_name[span->name()].insert({key, span});
+}
+
+void RunningSpanStoreImpl::AddSpans(
+    absl::Span<const std::shared_ptr<SpanImpl>> spans) {
+  static_assert(kNumShards <= 32, "Shards must fit in a uint32_t mask.");
+  absl::InlinedVector<uint8_t, 64> shard_indices;
+  shard_indices.reserve(spans.size());
+  uint32_t shards = 0;
+  for (const auto& span : spans) {
+    const size_t index = ShardIndex(GetKey(span.get()));
+    shard_indices.push_back(static_cast<uint8_t>(index));
+    shards |= uint32_t{1} << index;
+  }
+  for (size_t index = 0; index < kNumShards; ++index) {
+    if ((shards & (uint32_t{1} << index)) == 0) continue;
+    Shard& shard = shards_[index];
+    absl::MutexLock l(&shard.mu);
+    for (size_t i = 0; i < spans.size(); ++i) {
+      if (shard_indices[i] != index) continue;
+      shard.spans_by_name[spans[i]->name()].insert(
+          {GetKey(spans[i].get()), spans[i]});
+    }
+  }
 }
 
 bool RunningSpanStoreImpl::RemoveSpan(const std::shared_ptr<SpanImpl>& span) {
-  absl::MutexLock l(&mu_);
-  auto iter = spans_.find(GetKey(span.get()));
-  if (iter == spans_.end()) {
-    return false;  // Not tracked.
+  const uintptr_t key = GetKey(span.get());
+  Shard& shard = ShardFor(key);
+  std::shared_ptr<SpanImpl> removed;
+  {
+    absl::MutexLock l(&shard.mu);
+    auto name_iter = shard.spans_by_name.find(span->name());
+    if (name_iter == shard.spans_by_name.end()) {
+      return false;  // Not tracked.
+    }
+    auto iter = name_iter->second.find(key);
+    if (iter == name_iter->second.end()) {
+      return false;  // Not tracked.
+    }
+    // Release the reference outside the lock.
+    removed = std::move(iter->second);
+    name_iter->second.erase(iter);
   }
-  spans_.erase(iter);
   return true;
 }
 
+void RunningSpanStoreImpl::RemoveSpans(
+    absl::Span<const std::shared_ptr<SpanImpl>> spans) {
+  static_assert(kNumShards <= 32, "Shards must fit in a uint32_t mask.");
+  absl::InlinedVector<uint8_t, 64> shard_indices;
+  shard_indices.reserve(spans.size());
+  uint32_t shards = 0;
+  for (const auto& span : spans) {
+    const size_t index = ShardIndex(GetKey(span.get()));
+    shard_indices.push_back(static_cast<uint8_t>(index));
+    shards |= uint32_t{1} << index;
+  }
+  // Release the references outside the locks.
+  std::vector<std::shared_ptr<SpanImpl>> removed;
+  removed.reserve(spans.size());
+  for (size_t index = 0; index < kNumShards; ++index) {
+    if ((shards & (uint32_t{1} << index)) == 0) continue;
+    Shard& shard = shards_[index];
+    absl::MutexLock l(&shard.mu);
+    for (size_t i = 0; i < spans.size(); ++i) {
+      if (shard_indices[i] != index) continue;
+      auto name_iter = shard.spans_by_name.find(spans[i]->name());
+      if (name_iter == shard.spans_by_name.end()) continue;
+      auto iter = name_iter->second.find(GetKey(spans[i].get()));
+      if (iter == name_iter->second.end()) continue;
+      removed.push_back(std::move(iter->second));
+      name_iter->second.erase(iter);
+    }
+  }
+}
+
 RunningSpanStore::Summary RunningSpanStoreImpl::GetSummary() const {
-  RunningSpanStore::Summary summary;
-  absl::MutexLock l(&mu_);
-  for (const auto& addr_span : spans_) {
-    const std::string& name = addr_span.second->name_constref();
-    auto it = summary.per_span_name_summary.find(name);
-    if (it != summary.per_span_name_summary.end()) {
-      it->second.num_running_spans++;
-    } else {
-      summary.per_span_name_summary[name] = {1};
+  // Count by interned name first, so that each name is copied once.
+  absl::flat_hash_map<absl::string_view, int> counts;
+  for (const Shard& shard : shards_) {
+    absl::MutexLock l(&shard.mu);
+    for (const auto& name_spans : shard.spans_by_name) {
+      if (!name_spans.second.empty()) {
+        counts[name_spans.first] += name_spans.second.size();
+      }
     }
   }
+  RunningSpanStore::Summary summary;
+  for (const auto& name_and_count : counts) {
+    summary.per_span_name_summary[std::string(name_and_count.first)] = {
+        name_and_count.second};
+  }
   return summary;
 }
 
 std::vector<SpanData> RunningSpanStoreImpl::GetRunningSpans(
     const RunningSpanStore::Filter& filter) const {
   std::vector<SpanData> running_spans;
-  absl::MutexLock l(&mu_);
-  for (const auto& it : spans_) {
-    if (running_spans.size() >= filter.max_spans_to_return) break;
-    if (filter.span_name.empty() || (it.second->name() == filter.span_name)) {
-      running_spans.emplace_back(it.second->ToSpanData());
+  VisitRunningSpans(filter, 0, [&running_spans](const SpanData& span) {
+    running_spans.push_back(span);
+  });
+  return running_spans;
+}
+
+void RunningSpanStoreImpl::VisitRunningSpans(
+    const RunningSpanStore::Filter& filter, int offset,
+    const std::function<void(const SpanData&)>& visitor) const {
+  if (filter.max_spans_to_return <= 0) {
+    return;
+  }
+  const size_t max_spans = filter.max_spans_to_return;
+  size_t skip = std::max(offset, 0);
+  // Collect the matching spans first, so that they are converted without
+  // holding any shard's lock.
+  std::vector<std::shared_ptr<SpanImpl>> matching;
+  const auto collect = [&](const SpanMap& spans) {
+    for (const auto& it : spans) {
+      if (matching.size() >= max_spans) return;
+      if (skip > 0) {
+        --skip;
+      } else {
+        matching.push_back(it.second);
+      }
+    }
+  };
+  for (const Shard& shard : shards_) {
+    if (matching.size() >= max_spans) break;
+    absl::MutexLock l(&shard.mu);
+    if (filter.span_name.empty()) {
+      for (const auto& name_spans : shard.spans_by_name) {
+        collect(name_spans.second);
+      }
+    } else {
+      const auto it = shard.spans_by_name.find(filter.span_name);
+      if (it != shard.spans_by_name.end()) {
+        collect(it->second);
+      }
+    }
+  }
+  for (const auto& span : matching) {
+    visitor(span->ToSpanData());
+  }
+}
+
+void RunningSpanStoreImpl::TakeChunks(absl::Time now, absl::Duration interval,
+                                      std::vector<SpanData>* chunks) const {
+  std::vector<std::shared_ptr<SpanImpl>> spans;
+  for (const Shard& shard : shards_) {
+    // As in VisitRunningSpans(), chunks are taken without holding the shard's
+    // lock.
+    {
+      absl::MutexLock l(&shard.mu);
+      spans.clear();
+      for (const auto& name_spans : shard.spans_by_name) {
+        for (const auto& it : name_spans.second) {
+          spans.push_back(it.second);
+        }
+      }
+    }
+    for (const auto& span : spans) {
+      span->TakeChunk(now, interval, chunks);
     }
   }
-  return running_spans;
+}
+
+TraceMemoryUsage::Store RunningSpanStoreImpl::MemoryUsage() const {
+  // Each node of a name's map holds the entry and a next pointer.
+  constexpr size_t kNodeBytes =
+      sizeof(std::pair<const uintptr_t, std::shared_ptr<SpanImpl>>) +
+      sizeof(void*);
+  // Each slot of a shard's index holds a name and its map, plus a control
+  // byte.
+  constexpr size_t kSlotBytes =
+      sizeof(std::pair<const absl::string_view, SpanMap>) + 1;
+  TraceMemoryUsage::Store usage;
+  usage.bytes = sizeof(*this);
+  std::vector<std::shared_ptr<SpanImpl>> spans;
+  for (const Shard& shard : shards_) {
+    // As in VisitRunningSpans(), the spans are measured without holding the
+    // shard's lock.
+    {
+      absl::MutexLock l(&shard.mu);
+      usage.bytes += shard.spans_by_name.capacity() * kSlotBytes;
+      spans.clear();
+      for (const auto& name_spans : shard.spans_by_name) {
+        usage.bytes += name_spans.second.bucket_count() * sizeof(void*) +
+                       name_spans.second.size() * kNodeBytes;
+        for (const auto& it : name_spans.second) {
+          spans.push_back(it.second);
+        }
+      }
+    }
+    usage.spans += spans.size();
+    for (const auto& span : spans) {
+      usage.bytes += span->ApproximateBytes();
+    }
+  }
+  return usage;
 }
 
 void RunningSpanStoreImpl::ClearForTesting() {
-  absl::MutexLock l(&mu_);
-  spans_.clear();
+  for (Shard& shard : shards_) {
+    absl::MutexLock l(&shard.mu);
+    shard.spans_by_name.clear();
+  }
 }
 
 }  // namespace exporter
@@ -15,15 +15,25 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_RUNNING_SPAN_STORE_IMPL_H_
 #define OPENCENSUS_TRACE_INTERNAL_RUNNING_SPAN_STORE_IMPL_H_
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/memory_resource.h"
 #include "opencensus/trace/internal/running_span_store.h"
 #include "opencensus/trace/internal/span_impl.h"
+#include "opencensus/trace/trace_config.h"
 
 namespace opencensus {
 namespace trace {
@@ -38,32 +48,83 @@ class RunningSpanStoreImpl {
   static RunningSpanStoreImpl* Get();
 
   // Adds a new running Span.
-  void AddSpan(const std::shared_ptr<SpanImpl>& span) LOCKS_EXCLUDED(mu_);
+  void AddSpan(const std::shared_ptr<SpanImpl>& span);
+  // Adds Spans that started together, locking each shard once.
+  void AddSpans(absl::Span<const std::shared_ptr<SpanImpl>> spans);
 
   // Removes a Span that's no longer running. Returns true on success, false if
   // that Span was not being tracked.
-  bool RemoveSpan(const std::shared_ptr<SpanImpl>& span) LOCKS_EXCLUDED(mu_);
+  bool RemoveSpan(const std::shared_ptr<SpanImpl>& span);
+  // Removes Spans that ended together, locking each shard once.
+  void RemoveSpans(absl::Span<const std::shared_ptr<SpanImpl>> spans);
 
   // Returns a summary of the data available in the RunningSpanStore.
-  RunningSpanStore::Summary GetSummary() const LOCKS_EXCLUDED(mu_);
+  RunningSpanStore::Summary GetSummary() const;
 
   // Returns the running spans that match the filter.
   std::vector<SpanData> GetRunningSpans(
-      const RunningSpanStore::Filter& filter) const LOCKS_EXCLUDED(mu_);
+      const RunningSpanStore::Filter& filter) const;
+
+  // See RunningSpanStore::VisitRunningSpans().
+  void VisitRunningSpans(
+      const RunningSpanStore::Filter& filter, int offset,
+      const std::function<void(const SpanData&)>& visitor) const;
+
+  // Appends a chunk of each running span due one to 'chunks' (see
+  // SpanImpl::TakeChunk()), for the incremental export of long-running spans.
+  void TakeChunks(absl::Time now, absl::Duration interval,
+                  std::vector<SpanData>* chunks) const;
+
+  // Returns the number of running spans and the approximate bytes they and
+  // the store hold.
+  TraceMemoryUsage::Store MemoryUsage() const;
 
  private:
   friend class RunningSpanStoreImplTestPeer;
 
-  RunningSpanStoreImpl() {}
+  // Registers the fork handler.
+  RunningSpanStoreImpl();
 
-  // Clears all currently active spans from the store.
-  void ClearForTesting() LOCKS_EXCLUDED(mu_);
-
-  mutable absl::Mutex mu_;
+  // The common::Scheduler fork handler. The child clears the store, since the
+  // spans started by the parent's other threads never end.
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
 
-  // The key is the memory address of the underlying SpanImpl object.
-  std::unordered_map<uintptr_t, std::shared_ptr<SpanImpl>> spans_
-      GUARDED_BY(mu_);
+  // Clears all currently active spans from the store.
+  void ClearForTesting();
+
+  // Spans are sharded by address, so that starting and ending spans on
+  // different threads rarely contend on the same mutex.
+  static constexpr size_t kNumShards = 16;
+
+  // The spans of one name, keyed by the memory address of the underlying
+  // SpanImpl object.
+  typedef std::unordered_map<
+      uintptr_t, std::shared_ptr<SpanImpl>, std::hash<uintptr_t>,
+      std::equal_to<uintptr_t>,
+      common::ResourceAllocator<
+          std::pair<const uintptr_t, std::shared_ptr<SpanImpl>>,
+          common::MemorySubsystem::kSpanStores>>
+      SpanMap;
+
+  // Padded by a cache line on both sides, so that shards do not share one
+  // wherever the store is allocated (it is not aligned to a cache line).
+  struct Shard {
+    char pad0[64];
+    mutable absl::Mutex mu;
+    // Indexed by interned span name, so that a query filtered by name only
+    // visits spans of that name. A name's map is kept once empty, since span
+    // names are few and spans of a name usually keep starting.
+    absl::flat_hash_map<absl::string_view, SpanMap> spans_by_name
+        GUARDED_BY(mu);
+    char pad1[64];
+  };
+
+  Shard& ShardFor(uintptr_t key) { return shards_[ShardIndex(key)]; }
+  static size_t ShardIndex(uintptr_t key);
+
+  std::array<Shard, kNumShards> shards_;
 };
 
 }  // namespace exporter
@@ -15,7 +15,9 @@
 #include "opencensus/trace/internal/running_span_store.h"
 
 #include <cstdint>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -109,6 +111,75 @@ TEST(RunningSpanStoreTest, GetSummaryAndGetRunningSpans) {
   summary = RunningSpanStore::GetSummary();
   EXPECT_EQ(1, summary.per_span_name_summary["Group1"].num_running_spans);
   EXPECT_EQ(1, summary.per_span_name_summary["Group2"].num_running_spans);
+
+  // A name with no running spans is left out of the summary.
+  span2.End();
+  summary = RunningSpanStore::GetSummary();
+  EXPECT_EQ(0, summary.per_span_name_summary.count("Group1"));
+  EXPECT_EQ(0, RunningSpanStore::GetRunningSpans({"Group1", 10}).size());
+  EXPECT_EQ(1, RunningSpanStore::GetRunningSpans({"", 10}).size());
+  span3.End();
+}
+
+TEST(RunningSpanStoreTest, VisitRunningSpansPages) {
+  AlwaysSampler sampler;
+  StartSpanOptions opts = {&sampler};
+  RunningSpanStoreImplTestPeer::ClearForTesting();
+  std::vector<Span> spans;
+  for (int i = 0; i < 5; ++i) {
+    spans.push_back(Span::StartSpan("Paged", nullptr, opts));
+  }
+  auto other = Span::StartSpan("Other", nullptr, opts);
+
+  std::set<std::string> ids;
+  int visited = 0;
+  const auto visitor = [&](const SpanData& span) {
+    EXPECT_EQ("Paged", span.name());
+    ids.insert(span.context().span_id().ToHex());
+    ++visited;
+  };
+  for (int offset = 0; offset < 5; offset += 2) {
+    RunningSpanStore::VisitRunningSpans({"Paged", 2}, offset, visitor);
+  }
+  // Pages cover every span once while the store does not change.
+  EXPECT_EQ(5, visited);
+  EXPECT_EQ(5, ids.size());
+  visited = 0;
+  RunningSpanStore::VisitRunningSpans({"Paged", 2}, 5, visitor);
+  RunningSpanStore::VisitRunningSpans({"Paged", 0}, 0, visitor);
+  EXPECT_EQ(0, visited);
+
+  for (auto& span : spans) span.End();
+  other.End();
+}
+
+TEST(RunningSpanStoreTest, ConcurrentStartAndEnd) {
+  AlwaysSampler sampler;
+  StartSpanOptions opts = {&sampler};
+  RunningSpanStoreImplTestPeer::ClearForTesting();
+  constexpr int kNumThreads = 4;
+  constexpr int kSpansPerThread = 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&opts]() {
+      std::vector<Span> spans;
+      for (int i = 0; i < kSpansPerThread; ++i) {
+        spans.push_back(Span::StartSpan("Concurrent", nullptr, opts));
+      }
+      // End every other span. The store keeps the others running after the
+      // Span objects are destroyed.
+      for (int i = 0; i < kSpansPerThread; i += 2) {
+        spans[i].End();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto summary = RunningSpanStore::GetSummary();
+  EXPECT_EQ(kNumThreads * kSpansPerThread / 2,
+            summary.per_span_name_summary["Concurrent"].num_running_spans);
+  RunningSpanStoreImplTestPeer::ClearForTesting();
 }
 
 }  // namespace
@@ -14,10 +14,19 @@
 
 #include "opencensus/trace/sampler.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 
 namespace opencensus {
 namespace trace {
@@ -38,15 +47,31 @@ uint64_t CalculateThreshold(double probability) {
          static_cast<uint64_t>(lo_bits);
 }
 
-uint64_t CalculateThresholdFromBuffer(const TraceId& trace_id) {
-  uint8_t buf[TraceId::kSize];
-  trace_id.CopyTo(buf);
-  uint64_t res = 0;
-  // We only use the first 8 bytes of TraceId.
-  for (int i = 0; i < 8; ++i) {
-    res |= (static_cast<uint64_t>(buf[i]) << (i * 8));
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+// Returns the time between tokens for a rate limit of 'spans_per_second', or 0
+// if nothing should be sampled.
+int64_t TokenIntervalNanos(double spans_per_second) {
+  if (!(spans_per_second > 0)) return 0;
+  // Clamp very low rates so that the bucket's arithmetic cannot overflow.
+  const double interval =
+      std::min(kNanosPerSecond / spans_per_second, 1e18);
+  return std::max<int64_t>(1, static_cast<int64_t>(interval));
+}
+
+// Returns true if the decision for a Span with 'parent_context' has already
+// been made, setting *sampled to it. Only Spans without a sampled parent reach
+// samplers, so that means a local parent which was not sampled.
+bool DecidedByParent(const SpanContext* parent_context, bool has_remote_parent,
+                     bool* sampled) {
+  if (parent_context == nullptr) return false;
+  if (parent_context->trace_options().IsSampled()) {
+    *sampled = true;
+    return true;
   }
-  return res;
+  if (has_remote_parent) return false;
+  *sampled = false;
+  return true;
 }
 }  // namespace
 
@@ -59,10 +84,156 @@ bool ProbabilitySampler::ShouldSample(
     const SpanId& span_id ABSL_ATTRIBUTE_UNUSED,
     absl::string_view name ABSL_ATTRIBUTE_UNUSED,
     const std::vector<Span*>& parent_links ABSL_ATTRIBUTE_UNUSED) const {
-  if (threshold_ == 0) return false;
   // All Spans within the same Trace will get the same sampling decision, so
   // full trees of Spans will be sampled.
-  return CalculateThresholdFromBuffer(trace_id) <= threshold_;
+  return ShouldSampleTraceId(trace_id);
+}
+
+RateLimitingSampler::RateLimitingSampler(double spans_per_second)
+    : interval_nanos_(TokenIntervalNanos(spans_per_second)),
+      burst_nanos_(std::max(interval_nanos_, kNanosPerSecond)),
+      empty_time_nanos_(0) {}
+
+bool RateLimitingSampler::ShouldSample(
+    const SpanContext* parent_context, bool has_remote_parent,
+    const TraceId& trace_id ABSL_ATTRIBUTE_UNUSED,
+    const SpanId& span_id ABSL_ATTRIBUTE_UNUSED,
+    absl::string_view name ABSL_ATTRIBUTE_UNUSED,
+    const std::vector<Span*>& parent_links ABSL_ATTRIBUTE_UNUSED) const {
+  bool sampled;
+  if (DecidedByParent(parent_context, has_remote_parent, &sampled)) {
+    return sampled;
+  }
+  if (interval_nanos_ == 0) return false;
+  const int64_t now = absl::GetCurrentTimeNanos();
+  int64_t empty_time = empty_time_nanos_.load(std::memory_order_relaxed);
+  while (true) {
+    // Take a token if one has accrued since the bucket was empty.
+    const int64_t next_empty_time =
+        std::max(empty_time, now - burst_nanos_) + interval_nanos_;
+    if (next_empty_time > now) return false;
+    if (empty_time_nanos_.compare_exchange_weak(empty_time, next_empty_time,
+                                                std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+}
+
+struct AdaptiveSampler::NameState {
+  explicit NameState(int64_t now_nanos) : window_start_nanos(now_nanos) {}
+
+  std::atomic<int64_t> window_start_nanos;
+  // The number of Spans seen since window_start_nanos.
+  std::atomic<uint64_t> window_count{0};
+  // As for ProbabilitySampler. Everything is sampled until the first estimate.
+  std::atomic<uint64_t> threshold{UINT64_MAX};
+};
+
+constexpr int AdaptiveSampler::kMaxSpanNames;
+
+AdaptiveSampler::AdaptiveSampler(double spans_per_second)
+    : spans_per_second_(std::max(0.0, spans_per_second)),
+      early_adjust_count_(
+          std::max<uint64_t>(16, static_cast<uint64_t>(2 * spans_per_second_))),
+      overflow_state_(
+          absl::make_unique<NameState>(absl::GetCurrentTimeNanos())) {}
+
+AdaptiveSampler::~AdaptiveSampler() = default;
+
+bool AdaptiveSampler::ShouldSample(
+    const SpanContext* parent_context, bool has_remote_parent,
+    const TraceId& trace_id, const SpanId& span_id ABSL_ATTRIBUTE_UNUSED,
+    absl::string_view name,
+    const std::vector<Span*>& parent_links ABSL_ATTRIBUTE_UNUSED) const {
+  bool sampled;
+  if (DecidedByParent(parent_context, has_remote_parent, &sampled)) {
+    return sampled;
+  }
+  const int64_t now = absl::GetCurrentTimeNanos();
+  NameState* state = GetState(name, now);
+  const uint64_t count =
+      state->window_count.fetch_add(1, std::memory_order_relaxed) + 1;
+  int64_t window_start = state->window_start_nanos.load(
+      std::memory_order_relaxed);
+  const int64_t elapsed = now - window_start;
+  if ((elapsed >= kNanosPerSecond ||
+       (count >= early_adjust_count_ && elapsed > 0)) &&
+      state->window_start_nanos.compare_exchange_strong(
+          window_start, now, std::memory_order_relaxed)) {
+    // Only the thread that ended the window re-estimates. Spans counted
+    // concurrently may land in either window, which is fine for an estimate.
+    state->window_count.store(0, std::memory_order_relaxed);
+    const double rate = count * static_cast<double>(kNanosPerSecond) / elapsed;
+    const double probability =
+        rate <= spans_per_second_ ? 1.0 : spans_per_second_ / rate;
+    state->threshold.store(CalculateThreshold(probability),
+                           std::memory_order_relaxed);
+  }
+  const uint64_t threshold = state->threshold.load(std::memory_order_relaxed);
+  if (threshold == 0) return false;
+  return ProbabilitySampler::TraceIdValue(trace_id) <= threshold;
+}
+
+AdaptiveSampler::NameState* AdaptiveSampler::GetState(absl::string_view name,
+                                                      int64_t now_nanos) const {
+  {
+    absl::ReaderMutexLock l(&mu_);
+    const auto it = states_.find(name);
+    if (it != states_.end()) return it->second.get();
+  }
+  absl::MutexLock l(&mu_);
+  auto it = states_.find(name);
+  if (it == states_.end()) {
+    if (states_.size() >= kMaxSpanNames) return overflow_state_.get();
+    it = states_
+             .emplace(std::string(name),
+                      absl::make_unique<NameState>(now_nanos))
+             .first;
+  }
+  return it->second.get();
+}
+
+SpanNameSampler::SpanNameSampler(const std::vector<Rule>& rules,
+                                 double default_probability)
+    : default_sampler_(default_probability) {
+  size_t size = 1;
+  while (size < 2 * rules.size()) size *= 2;
+  table_.assign(size, Slot{0, -1});
+  mask_ = size - 1;
+  rules_.reserve(rules.size());
+  for (const Rule& rule : rules) {
+    const size_t hash = absl::Hash<absl::string_view>()(rule.name);
+    Slot& slot = table_[FindSlot(rule.name, hash)];
+    if (slot.rule >= 0) continue;  // The first rule for a name applies.
+    slot = Slot{hash, static_cast<int>(rules_.size())};
+    rules_.emplace_back(rule.name, rule.probability);
+  }
+}
+
+size_t SpanNameSampler::FindSlot(absl::string_view name, size_t hash) const {
+  // The table is at most half full, so the probe ends at an empty slot.
+  size_t i = hash & mask_;
+  while (table_[i].rule >= 0 &&
+         !(table_[i].hash == hash && rules_[table_[i].rule].name == name)) {
+    i = (i + 1) & mask_;
+  }
+  return i;
+}
+
+bool SpanNameSampler::ShouldSample(
+    const SpanContext* parent_context, bool has_remote_parent,
+    const TraceId& trace_id, const SpanId& span_id ABSL_ATTRIBUTE_UNUSED,
+    absl::string_view name,
+    const std::vector<Span*>& parent_links ABSL_ATTRIBUTE_UNUSED) const {
+  bool sampled;
+  if (DecidedByParent(parent_context, has_remote_parent, &sampled)) {
+    return sampled;
+  }
+  const Slot& slot =
+      table_[FindSlot(name, absl::Hash<absl::string_view>()(name))];
+  const ProbabilitySampler& sampler =
+      slot.rule < 0 ? default_sampler_ : rules_[slot.rule].sampler;
+  return sampler.ShouldSampleTraceId(trace_id);
 }
 
 }  // namespace trace
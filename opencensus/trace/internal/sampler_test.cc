@@ -15,11 +15,15 @@
 #include "opencensus/trace/sampler.h"
 
 #include <atomic>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "gtest/gtest.h"
 #include "opencensus/trace/span.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/trace_config.h"
+#include "opencensus/trace/trace_options.h"
 #include "opencensus/trace/trace_params.h"
 
 namespace opencensus {
@@ -70,6 +74,100 @@ TEST(SamplerTest, SampleNth) {
   }
 }
 
+// Returns the number of root Spans out of 'num_spans' with distinct trace IDs
+// that 'sampler' samples.
+int CountSampled(const Sampler& sampler, absl::string_view name,
+                 int num_spans) {
+  int sampled = 0;
+  for (int i = 0; i < num_spans; ++i) {
+    // Spread the trace IDs evenly over the range ProbabilitySampler uses.
+    const uint64_t id = (i + 1) * 0x9E3779B97F4A7C15ull;
+    uint8_t buf[TraceId::kSize] = {};
+    for (int j = 0; j < 8; ++j) {
+      buf[j] = static_cast<uint8_t>(id >> (8 * j));
+    }
+    if (sampler.ShouldSample(nullptr, false, TraceId(buf), SpanId(), name,
+                             {})) {
+      ++sampled;
+    }
+  }
+  return sampled;
+}
+
+TEST(SamplerTest, ParentDecides) {
+  const uint8_t sampled_options[] = {1};
+  const SpanContext sampled_parent{TraceId(), SpanId(),
+                                   TraceOptions(sampled_options)};
+  const SpanContext unsampled_parent;
+  const RateLimitingSampler rate_limiting(1000);
+  const AdaptiveSampler adaptive(1000);
+  const SpanNameSampler span_name({}, 1);
+  for (const Sampler* sampler : std::vector<const Sampler*>(
+           {&rate_limiting, &adaptive, &span_name})) {
+    EXPECT_TRUE(sampler->ShouldSample(&sampled_parent, false, TraceId(),
+                                      SpanId(), "MySpan", {}));
+    EXPECT_FALSE(sampler->ShouldSample(&unsampled_parent, false, TraceId(),
+                                       SpanId(), "MySpan", {}));
+    // Remote parents which were not sampled are sampled independently.
+    EXPECT_TRUE(sampler->ShouldSample(&unsampled_parent, true, TraceId(),
+                                      SpanId(), "MySpan", {}));
+  }
+}
+
+TEST(SamplerTest, RateLimiting) {
+  // The bucket starts with one second of tokens, and refills slowly enough
+  // that at most a few more accrue during the test.
+  const RateLimitingSampler sampler(10);
+  const int sampled = CountSampled(sampler, "MySpan", 10000);
+  EXPECT_GE(sampled, 10);
+  EXPECT_LE(sampled, 20);
+  EXPECT_EQ(0, CountSampled(RateLimitingSampler(0), "MySpan", 100));
+}
+
+TEST(SamplerTest, Adaptive) {
+  const AdaptiveSampler sampler(10);
+  // Everything is sampled until the first estimate, which is made after 16
+  // spans at this rate. Afterwards, spans are seen far faster than 10 per
+  // second, so few more are sampled.
+  const int sampled = CountSampled(sampler, "MySpan", 10000);
+  EXPECT_GE(sampled, 16);
+  EXPECT_LE(sampled, 100);
+  // Names have separate rates.
+  EXPECT_GE(CountSampled(sampler, "OtherSpan", 10), 10);
+}
+
+TEST(SamplerTest, SpanName) {
+  std::vector<SpanNameSampler::Rule> rules = {
+      {"HealthCheck", 0}, {"Get", 0.01}, {"Admin", 1}, {"Get", 1}};
+  // Enough rules for probes to collide.
+  for (int i = 0; i < 100; ++i) {
+    rules.push_back({absl::StrCat("Method", i), 0});
+  }
+  const SpanNameSampler sampler(rules, 0.5);
+  EXPECT_EQ(0, CountSampled(sampler, "HealthCheck", 1000));
+  EXPECT_EQ(1000, CountSampled(sampler, "Admin", 1000));
+  EXPECT_EQ(0, CountSampled(sampler, "Method99", 1000));
+  // The first rule for a name applies.
+  const int get = CountSampled(sampler, "Get", 10000);
+  EXPECT_GE(get, 50);
+  EXPECT_LE(get, 150);
+  // As with ProbabilitySampler, the trace IDs are spread evenly.
+  const int other = CountSampled(sampler, "Other", 1000);
+  EXPECT_GE(other, 450);
+  EXPECT_LE(other, 550);
+  EXPECT_EQ(0, CountSampled(SpanNameSampler({}, 0), "Other", 100));
+}
+
+TEST(SamplerTest, CustomGlobalSampler) {
+  static const NeverSampler* never_sampler = new NeverSampler;
+  TraceConfig::SetCurrentTraceParams(
+      {32, 32, 128, 128, ProbabilitySampler(1.0), never_sampler});
+  EXPECT_FALSE(Span::StartSpan("MySpan").IsSampled());
+  TraceConfig::SetCurrentTraceParams(
+      {32, 32, 128, 128, ProbabilitySampler(1.0), nullptr});
+  EXPECT_TRUE(Span::StartSpan("MySpan").IsSampled());
+}
+
 }  // namespace
 }  // namespace trace
 }  // namespace opencensus
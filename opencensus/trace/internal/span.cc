@@ -16,18 +16,23 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/overhead_profiler.h"
 #include "opencensus/common/internal/random.h"
 #include "opencensus/trace/exporter/annotation.h"
 #include "opencensus/trace/exporter/attribute_value.h"
 #include "opencensus/trace/exporter/link.h"
 #include "opencensus/trace/exporter/message_event.h"
 #include "opencensus/trace/exporter/status.h"
-#include "opencensus/trace/internal/local_span_store_impl.h"
+#include "opencensus/trace/internal/disabled_span_names.h"
+#include "opencensus/trace/internal/ended_spans.h"
 #include "opencensus/trace/internal/running_span_store.h"
 #include "opencensus/trace/internal/running_span_store_impl.h"
-#include "opencensus/trace/internal/span_exporter_impl.h"
+#include "opencensus/trace/internal/span_end_hook.h"
 #include "opencensus/trace/internal/span_impl.h"
 #include "opencensus/trace/internal/trace_config_impl.h"
 #include "opencensus/trace/sampler.h"
@@ -66,6 +71,9 @@ class SpanGenerator {
   static Span Generate(absl::string_view name, const SpanContext* parent_ctx,
                        bool has_remote_parent,
                        const StartSpanOptions& options) {
+    // Read once, so that the sampler and limits come from the same snapshot.
+    const TraceParams& trace_params =
+        TraceConfigImpl::Get()->current_trace_params();
     SpanId span_id = GenerateRandomSpanId();
     TraceId trace_id;
     SpanId parent_span_id;
@@ -83,57 +91,175 @@ class SpanGenerator {
         should_sample = options.sampler->ShouldSample(
             parent_ctx, has_remote_parent, trace_id, span_id, name,
             options.parent_links);
+      } else if (trace_params.custom_sampler == nullptr) {
+        // The default ProbabilitySampler only looks at the TraceId, so decide
+        // inline rather than through a virtual call.
+        should_sample = trace_params.sampler.ShouldSampleTraceId(
+            trace_id, TraceConfigImpl::Get()->sampling_halvings());
       } else {
-        should_sample =
-            TraceConfigImpl::Get()->current_trace_params().sampler.ShouldSample(
-                parent_ctx, has_remote_parent, trace_id, span_id, name,
-                options.parent_links);
+        should_sample = trace_params.custom_sampler->ShouldSample(
+            parent_ctx, has_remote_parent, trace_id, span_id, name,
+            options.parent_links);
       }
       trace_options.SetSampled(should_sample);
     }
     SpanContext context(trace_id, span_id, trace_options);
-    SpanImpl* impl = nullptr;
+    std::shared_ptr<SpanImpl> impl;
     if (trace_options.IsSampled()) {
-      // Only Spans that are sampled are backed by a SpanImpl.
-      impl =
-          new SpanImpl(context, TraceConfigImpl::Get()->current_trace_params(),
-                       name, parent_span_id, has_remote_parent);
+      // Only Spans that are sampled are backed by a SpanImpl. make_shared
+      // allocates the SpanImpl and its reference count together.
+      impl = std::make_shared<SpanImpl>(context, trace_params, name,
+                                        parent_span_id, has_remote_parent,
+                                        options.single_writer,
+                                        options.summarize_message_events,
+                                        options.record_resource_usage,
+                                        options.priority);
     }
     // Add links.
+    if (impl && !options.parent_links.empty()) {
+      absl::InlinedVector<SpanContext, 4> parent_ctxs;
+      parent_ctxs.reserve(options.parent_links.size());
+      for (const auto& parent_link : options.parent_links) {
+        parent_ctxs.push_back(parent_link->context());
+      }
+      impl->AddLinks(parent_ctxs, exporter::Link::Type::kParentLinkedSpan);
+    }
+    if (!options.one_way_parent_links) {
+      for (const auto& parent_link : options.parent_links) {
+        parent_link->AddChildLink(context);
+      }
+    }
+    return Span(context, std::move(impl));
+  }
+
+  static std::vector<Span> GenerateChildren(absl::string_view name,
+                                            const SpanContext& parent_ctx,
+                                            size_t count,
+                                            const StartSpanOptions& options) {
+    std::vector<Span> children;
+    if (count == 0) {
+      return children;
+    }
+    children.reserve(count);
+    const TraceParams& trace_params =
+        TraceConfigImpl::Get()->current_trace_params();
+    std::vector<uint8_t> span_id_buf(count * SpanId::kSize);
+    ::opencensus::common::Random::GetRandom()->GenerateRandomBuffer(
+        span_id_buf.data(), span_id_buf.size());
+    TraceOptions trace_options = parent_ctx.trace_options();
+    if (!trace_options.IsSampled()) {
+      const SpanId first_span_id(span_id_buf.data());
+      bool should_sample = false;
+      if (options.sampler != nullptr) {
+        should_sample = options.sampler->ShouldSample(
+            &parent_ctx, /*has_remote_parent=*/false, parent_ctx.trace_id(),
+            first_span_id, name, options.parent_links);
+      } else if (trace_params.custom_sampler == nullptr) {
+        should_sample = trace_params.sampler.ShouldSampleTraceId(
+            parent_ctx.trace_id(), TraceConfigImpl::Get()->sampling_halvings());
+      } else {
+        should_sample = trace_params.custom_sampler->ShouldSample(
+            &parent_ctx, /*has_remote_parent=*/false, parent_ctx.trace_id(),
+            first_span_id, name, options.parent_links);
+      }
+      trace_options.SetSampled(should_sample);
+    }
+    absl::InlinedVector<SpanContext, 4> parent_ctxs;
     for (const auto& parent_link : options.parent_links) {
-      if (impl) {
-        impl->AddLink(parent_link->context(),
-                      exporter::Link::Type::kParentLinkedSpan,
-                      /*attributes=*/{});
+      parent_ctxs.push_back(parent_link->context());
+    }
+    std::vector<std::shared_ptr<SpanImpl>> impls;
+    for (size_t i = 0; i < count; ++i) {
+      const SpanContext context(
+          parent_ctx.trace_id(),
+          SpanId(span_id_buf.data() + i * SpanId::kSize), trace_options);
+      // Constructed without an impl, so that the Span constructor does not add
+      // it to the running span store; the impls are added together below.
+      children.push_back(Span(context, nullptr));
+      if (trace_options.IsSampled()) {
+        auto impl = std::make_shared<SpanImpl>(
+            context, trace_params, name, parent_ctx.span_id(),
+            /*remote_parent=*/false, options.single_writer,
+            options.summarize_message_events, options.record_resource_usage,
+            options.priority);
+        if (!parent_ctxs.empty()) {
+          impl->AddLinks(parent_ctxs,
+                         exporter::Link::Type::kParentLinkedSpan);
+        }
+        children.back().span_impl_ = impl;
+        impls.push_back(std::move(impl));
+      }
+      if (!options.one_way_parent_links) {
+        for (const auto& parent_link : options.parent_links) {
+          parent_link->AddChildLink(context);
+        }
       }
-      parent_link->AddChildLink(context);
     }
-    return Span(context, impl);
+    if (!impls.empty()) {
+      exporter::RunningSpanStoreImpl::Get()->AddSpans(impls);
+    }
+    return children;
   }
 };
 
+#ifndef OPENCENSUS_NOOP
 Span Span::BlankSpan() { return Span(SpanContext(), nullptr); }
 
 Span Span::StartSpan(absl::string_view name, const Span* parent,
                      const StartSpanOptions& options) {
+  if (DisabledSpanNames::Get()->Contains(name)) {
+    return Span(parent == nullptr ? SpanContext() : parent->context(),
+                nullptr);
+  }
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kStartSpan);
   SpanContext parent_ctx;
   if (parent != nullptr) {
     parent_ctx = parent->context();
   }
-  return SpanGenerator::Generate(name,
-                                 (parent == nullptr) ? nullptr : &parent_ctx,
-                                 /*has_remote_parent=*/false, options);
+  Span span = SpanGenerator::Generate(
+      name, (parent == nullptr) ? nullptr : &parent_ctx,
+      /*has_remote_parent=*/false, options);
+  if (profile.sampled()) {
+    profile.Finish(name);
+  }
+  return span;
 }
 
 Span Span::StartSpanWithRemoteParent(absl::string_view name,
                                      const SpanContext& parent_ctx,
                                      const StartSpanOptions& options) {
-  return SpanGenerator::Generate(name, &parent_ctx,
-                                 /*has_remote_parent=*/true, options);
+  if (DisabledSpanNames::Get()->Contains(name)) {
+    return Span(parent_ctx, nullptr);
+  }
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kStartSpan);
+  Span span = SpanGenerator::Generate(name, &parent_ctx,
+                                      /*has_remote_parent=*/true, options);
+  if (profile.sampled()) {
+    profile.Finish(name);
+  }
+  return span;
 }
 
-Span::Span(const SpanContext& context, SpanImpl* impl)
-    : context_(context), span_impl_(impl) {
+std::vector<Span> Span::StartChildSpans(absl::string_view name,
+                                       const Span& parent, size_t count,
+                                       const StartSpanOptions& options) {
+  if (DisabledSpanNames::Get()->Contains(name)) {
+    return std::vector<Span>(count, Span(parent.context(), nullptr));
+  }
+  const common::ProfiledScope profile(
+      common::OverheadProfiler::Operation::kStartSpan);
+  std::vector<Span> children =
+      SpanGenerator::GenerateChildren(name, parent.context(), count, options);
+  if (profile.sampled()) {
+    profile.Finish(name);
+  }
+  return children;
+}
+
+Span::Span(const SpanContext& context, std::shared_ptr<SpanImpl> impl)
+    : context_(context), span_impl_(std::move(impl)) {
   if (IsRecording()) {
     exporter::RunningSpanStoreImpl::Get()->AddSpan(span_impl_);
   }
@@ -142,13 +268,34 @@ Span::Span(const SpanContext& context, SpanImpl* impl)
 void Span::AddAttribute(absl::string_view key,
                         AttributeValueRef attribute) const {
   if (IsRecording()) {
+    const common::ProfiledScope profile(
+        common::OverheadProfiler::Operation::kAddAttribute);
     span_impl_->AddAttributes({{key, attribute}});
+    if (profile.sampled()) {
+      profile.Finish(span_impl_->name());
+    }
+  }
+}
+
+void Span::AddAttribute(StaticString key, AttributeValueRef attribute) const {
+  if (IsRecording()) {
+    const common::ProfiledScope profile(
+        common::OverheadProfiler::Operation::kAddAttribute);
+    span_impl_->AddAttribute(key, attribute);
+    if (profile.sampled()) {
+      profile.Finish(span_impl_->name());
+    }
   }
 }
 
 void Span::AddAttributes(AttributesRef attributes) const {
   if (IsRecording()) {
+    const common::ProfiledScope profile(
+        common::OverheadProfiler::Operation::kAddAttribute);
     span_impl_->AddAttributes(attributes);
+    if (profile.sampled()) {
+      profile.Finish(span_impl_->name());
+    }
   }
 }
 
@@ -195,6 +342,18 @@ void Span::AddChildLink(const SpanContext& child_ctx,
   }
 }
 
+void Span::AddParentLinks(absl::Span<const SpanContext> parent_ctxs) const {
+  if (IsRecording()) {
+    span_impl_->AddLinks(parent_ctxs, exporter::Link::Type::kParentLinkedSpan);
+  }
+}
+
+void Span::AddChildLinks(absl::Span<const SpanContext> child_ctxs) const {
+  if (IsRecording()) {
+    span_impl_->AddLinks(child_ctxs, exporter::Link::Type::kChildLinkedSpan);
+  }
+}
+
 void Span::SetStatus(StatusCode canonical_code,
                      absl::string_view message) const {
   if (IsRecording()) {
@@ -204,13 +363,16 @@ void Span::SetStatus(StatusCode canonical_code,
 
 void Span::End() const {
   if (IsRecording()) {
-    if (!span_impl_->End()) {
+    const common::ProfiledScope profile(
+        common::OverheadProfiler::Operation::kEndSpan);
+    if (!span_impl_->End(GetSpanEndHook())) {
       // The Span already ended, ignore this call.
       return;
     }
-    exporter::RunningSpanStoreImpl::Get()->RemoveSpan(span_impl_);
-    exporter::LocalSpanStoreImpl::Get()->AddSpan(span_impl_);
-    exporter::SpanExporterImpl::Get()->AddSpan(span_impl_);
+    EndedSpans::Add(span_impl_);
+    if (profile.sampled()) {
+      profile.Finish(span_impl_->name());
+    }
   }
 }
 
@@ -220,6 +382,16 @@ bool Span::IsSampled() const { return context_.trace_options().IsSampled(); }
 
 bool Span::IsRecording() const { return span_impl_ != nullptr; }
 
+bool Span::AcceptsAttributes() const {
+  return IsRecording() && span_impl_->AcceptsAttributes();
+}
+
+bool Span::AcceptsAnnotations() const {
+  return IsRecording() && span_impl_->AcceptsAnnotations();
+}
+
+#endif  // OPENCENSUS_NOOP
+
 void swap(Span& a, Span& b) {
   using std::swap;
   swap(a.context_, b.context_);
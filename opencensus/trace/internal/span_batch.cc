@@ -0,0 +1,239 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/exporter/span_batch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "opencensus/trace/internal/span_name.h"
+
+namespace opencensus {
+namespace trace {
+namespace exporter {
+
+namespace {
+
+// The size of the blocks strings are copied into. Longer strings get a block
+// of their own.
+constexpr size_t kBlockSize = 16 * 1024;
+
+template <typename T>
+absl::Span<const T> Resolved(const std::vector<T>& elements, uint32_t begin,
+                             uint32_t size) {
+  return absl::Span<const T>(elements.data() + begin, size);
+}
+
+}  // namespace
+
+SpanBatch::Builder::Builder(size_t num_spans) : batch_(new SpanBatch) {
+  batch_->spans_.reserve(num_spans);
+}
+
+void SpanBatch::Builder::StartSpan(absl::string_view name,
+                                   const SpanContext& context,
+                                   SpanId parent_span_id,
+                                   bool has_remote_parent,
+                                   absl::Time start_time) {
+  batch_->spans_.push_back(SpanView(InternSpanName(name), context,
+                                    parent_span_id, has_remote_parent,
+                                    start_time));
+  SpanView& span = batch_->spans_.back();
+  span.annotation_range_.begin = batch_->annotations_.size();
+  span.message_event_range_.begin = batch_->message_events_.size();
+  span.link_range_.begin = batch_->links_.size();
+  span.attribute_range_.begin = batch_->attributes_.size();
+}
+
+void SpanBatch::Builder::AddAttribute(absl::string_view key,
+                                      AttributeValueRef value) {
+  assert(!batch_->spans_.empty());
+  batch_->attributes_.push_back(
+      AttributeView(CopyString(key), CopyValue(value)));
+  ++batch_->spans_.back().attribute_range_.size;
+}
+
+void SpanBatch::Builder::AddAnnotation(absl::Time timestamp,
+                                       const Annotation& annotation) {
+  assert(!batch_->spans_.empty());
+  const Range attributes =
+      CopyAttributes(annotation.attributes(), &batch_->event_attributes_);
+  batch_->annotations_.push_back(
+      AnnotationView(timestamp, CopyString(annotation.description())));
+  batch_->annotations_.back().attribute_range_ = attributes;
+  ++batch_->spans_.back().annotation_range_.size;
+}
+
+void SpanBatch::Builder::AddMessageEvent(absl::Time timestamp,
+                                         const MessageEvent& event) {
+  assert(!batch_->spans_.empty());
+  batch_->message_events_.push_back(MessageEventView(timestamp, event));
+  ++batch_->spans_.back().message_event_range_.size;
+}
+
+void SpanBatch::Builder::AddLink(const Link& link) {
+  assert(!batch_->spans_.empty());
+  const Range attributes =
+      CopyAttributes(link.attributes(), &batch_->event_attributes_);
+  batch_->links_.push_back(
+      LinkView(link.type(), link.trace_id(), link.span_id()));
+  batch_->links_.back().attribute_range_ = attributes;
+  ++batch_->spans_.back().link_range_.size;
+}
+
+void SpanBatch::Builder::SetDropped(int num_attributes_dropped,
+                                    int num_annotations_dropped,
+                                    int num_message_events_dropped,
+                                    int num_links_dropped,
+                                    int64_t num_bytes_dropped) {
+  assert(!batch_->spans_.empty());
+  SpanView& span = batch_->spans_.back();
+  span.num_attributes_dropped_ = num_attributes_dropped;
+  span.num_annotations_dropped_ = num_annotations_dropped;
+  span.num_message_events_dropped_ = num_message_events_dropped;
+  span.num_links_dropped_ = num_links_dropped;
+  span.num_bytes_dropped_ = num_bytes_dropped;
+}
+
+void SpanBatch::Builder::SetMessageEventTotals(
+    const MessageEventTotals& totals) {
+  assert(!batch_->spans_.empty());
+  batch_->spans_.back().message_event_totals_ = totals;
+}
+
+void SpanBatch::Builder::EndSpan(absl::Time end_time, const Status& status) {
+  assert(!batch_->spans_.empty());
+  SpanView& span = batch_->spans_.back();
+  span.has_ended_ = true;
+  span.end_time_ = end_time;
+  span.status_code_ = status.CanonicalCode();
+  span.status_message_ = CopyString(status.error_message());
+}
+
+void SpanBatch::Builder::AddSpan(const SpanData& span) {
+  StartSpan(span.name(), span.context(), span.parent_span_id(),
+            span.has_remote_parent(), span.start_time());
+  batch_->spans_.back().attribute_range_ =
+      CopyAttributes(span.attributes(), &batch_->attributes_);
+  for (const auto& annotation : span.annotations().events()) {
+    AddAnnotation(annotation.timestamp(), annotation.event());
+  }
+  for (const auto& event : span.message_events().events()) {
+    AddMessageEvent(event.timestamp(), event.event());
+  }
+  for (const Link& link : span.links()) {
+    AddLink(link);
+  }
+  SetDropped(span.num_attributes_dropped(),
+             span.annotations().dropped_events_count(),
+             span.message_events().dropped_events_count(),
+             span.num_links_dropped(), span.num_bytes_dropped());
+  SetMessageEventTotals(span.message_event_totals());
+  if (span.has_ended()) {
+    EndSpan(span.end_time(), span.status());
+  }
+}
+
+std::shared_ptr<const SpanBatch> SpanBatch::Builder::Build() {
+  batch_->Resolve();
+  return std::shared_ptr<const SpanBatch>(batch_.release());
+}
+
+absl::string_view SpanBatch::Builder::CopyString(absl::string_view value) {
+  if (value.empty()) {
+    return absl::string_view();
+  }
+  if (value.size() > remaining_) {
+    const size_t size = std::max(kBlockSize, value.size());
+    batch_->blocks_.emplace_back(new char[size]);
+    if (value.size() == size) {
+      // Keep the current block for the strings that follow.
+      memcpy(batch_->blocks_.back().get(), value.data(), size);
+      return absl::string_view(batch_->blocks_.back().get(), size);
+    }
+    next_ = batch_->blocks_.back().get();
+    remaining_ = size;
+  }
+  memcpy(next_, value.data(), value.size());
+  const absl::string_view copy(next_, value.size());
+  next_ += value.size();
+  remaining_ -= value.size();
+  return copy;
+}
+
+AttributeValueRef SpanBatch::Builder::CopyValue(AttributeValueRef value) {
+  if (value.type() != AttributeValueRef::Type::kString || value.is_static()) {
+    return value;
+  }
+  return AttributeValueRef(CopyString(value.string_value()));
+}
+
+AttributeValueRef SpanBatch::Builder::CopyValue(const AttributeValue& value) {
+  switch (value.type()) {
+    case AttributeValue::Type::kString:
+      return AttributeValueRef(CopyString(value.string_value()));
+    case AttributeValue::Type::kBool:
+      return AttributeValueRef(value.bool_value());
+    case AttributeValue::Type::kInt:
+      return AttributeValueRef(value.int_value());
+  }
+  return AttributeValueRef(value.int_value());
+}
+
+template <typename Map>
+SpanBatch::Range SpanBatch::Builder::CopyAttributes(
+    const Map& attributes, std::vector<AttributeView>* target) {
+  Range range;
+  range.begin = target->size();
+  range.size = attributes.size();
+  for (const auto& attribute : attributes) {
+    target->push_back(AttributeView(CopyString(attribute.first),
+                                    CopyValue(attribute.second)));
+  }
+  return range;
+}
+
+void SpanBatch::Resolve() {
+  for (AnnotationView& annotation : annotations_) {
+    annotation.attributes_ =
+        Resolved(event_attributes_, annotation.attribute_range_.begin,
+                 annotation.attribute_range_.size);
+  }
+  for (LinkView& link : links_) {
+    link.attributes_ = Resolved(event_attributes_,
+                                link.attribute_range_.begin,
+                                link.attribute_range_.size);
+  }
+  for (SpanView& span : spans_) {
+    span.annotations_ = Resolved(annotations_, span.annotation_range_.begin,
+                                 span.annotation_range_.size);
+    span.message_events_ =
+        Resolved(message_events_, span.message_event_range_.begin,
+                 span.message_event_range_.size);
+    span.links_ =
+        Resolved(links_, span.link_range_.begin, span.link_range_.size);
+    span.attributes_ = Resolved(attributes_, span.attribute_range_.begin,
+                                span.attribute_range_.size);
+  }
+}
+
+}  // namespace exporter
+}  // namespace trace
+}  // namespace opencensus
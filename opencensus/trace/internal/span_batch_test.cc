@@ -0,0 +1,205 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/exporter/span_batch.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/attribute_value_ref.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/trace/trace_id.h"
+
+namespace opencensus {
+namespace trace {
+namespace exporter {
+namespace {
+
+constexpr uint8_t trace_id[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6};
+constexpr uint8_t span_id[] = {11, 22, 33, 44, 55, 66, 77, 88};
+constexpr uint8_t parent_id[] = {1, 1, 1, 1, 1, 1, 1, 1};
+
+TEST(SpanBatchTest, Empty) {
+  const auto batch = SpanBatch::Builder().Build();
+  EXPECT_TRUE(batch->empty());
+  EXPECT_EQ(0, batch->size());
+}
+
+TEST(SpanBatchTest, HoldsSpans) {
+  const SpanContext context{TraceId(trace_id), SpanId(span_id)};
+  const absl::Time start = absl::FromUnixSeconds(100);
+  const absl::Time end = absl::FromUnixSeconds(101);
+  std::shared_ptr<const SpanBatch> batch;
+  {
+    // The builder's inputs go out of scope before the batch is read.
+    std::string key = "key";
+    std::string value = "value";
+    std::string description = "description";
+    SpanBatch::Builder builder;
+    builder.StartSpan("Span1", context, SpanId(parent_id), true, start);
+    builder.AddAttribute(key, value);
+    builder.AddAttribute("int", 123);
+    builder.AddAttribute("static", StaticString("static value"));
+    builder.AddAnnotation(
+        start, Annotation(description, {{"a", AttributeValue("b")}}));
+    builder.AddMessageEvent(
+        end, MessageEvent(MessageEvent::Type::RECEIVED, 7, 10, 20));
+    builder.AddLink(Link(context, Link::Type::kChildLinkedSpan,
+                         {{"link", AttributeValue(true)}}));
+    builder.SetDropped(1, 2, 3, 4, 5);
+    builder.EndSpan(end, Status(StatusCode::NOT_FOUND, "missing"));
+    builder.StartSpan("Span2", context, SpanId(), false, start);
+    key.assign("overwritten");
+    value.assign("overwritten");
+    description.assign("overwritten");
+    batch = builder.Build();
+  }
+  ASSERT_EQ(2, batch->size());
+
+  const SpanBatch::SpanView& span1 = batch->spans()[0];
+  EXPECT_EQ("Span1", span1.name());
+  EXPECT_TRUE(span1.context() == context);
+  EXPECT_TRUE(span1.parent_span_id() == SpanId(parent_id));
+  EXPECT_TRUE(span1.has_remote_parent());
+  EXPECT_TRUE(span1.has_ended());
+  EXPECT_EQ(start, span1.start_time());
+  EXPECT_EQ(end, span1.end_time());
+  EXPECT_EQ(StatusCode::NOT_FOUND, span1.status_code());
+  EXPECT_EQ("missing", span1.status_message());
+
+  ASSERT_EQ(3, span1.attributes().size());
+  EXPECT_EQ("key", span1.attributes()[0].key());
+  EXPECT_EQ("value", span1.attributes()[0].value().string_value());
+  EXPECT_EQ("int", span1.attributes()[1].key());
+  EXPECT_EQ(123, span1.attributes()[1].value().int_value());
+  EXPECT_TRUE(span1.attributes()[2].value().is_static());
+  EXPECT_EQ("static value", span1.attributes()[2].value().string_value());
+
+  ASSERT_EQ(1, span1.annotations().size());
+  EXPECT_EQ(start, span1.annotations()[0].timestamp());
+  EXPECT_EQ("description", span1.annotations()[0].description());
+  const auto& annotation_attributes = span1.annotations()[0].attributes();
+  ASSERT_EQ(1, annotation_attributes.size());
+  EXPECT_EQ("a", annotation_attributes[0].key());
+  EXPECT_EQ("b", annotation_attributes[0].value().string_value());
+
+  ASSERT_EQ(1, span1.message_events().size());
+  EXPECT_EQ(end, span1.message_events()[0].timestamp());
+  EXPECT_EQ(7, span1.message_events()[0].event().id());
+
+  ASSERT_EQ(1, span1.links().size());
+  EXPECT_EQ(Link::Type::kChildLinkedSpan, span1.links()[0].type());
+  EXPECT_TRUE(span1.links()[0].trace_id() == TraceId(trace_id));
+  ASSERT_EQ(1, span1.links()[0].attributes().size());
+  EXPECT_TRUE(span1.links()[0].attributes()[0].value().bool_value());
+
+  EXPECT_EQ(1, span1.num_attributes_dropped());
+  EXPECT_EQ(2, span1.num_annotations_dropped());
+  EXPECT_EQ(3, span1.num_message_events_dropped());
+  EXPECT_EQ(4, span1.num_links_dropped());
+  EXPECT_EQ(5, span1.num_bytes_dropped());
+
+  const SpanBatch::SpanView& span2 = batch->spans()[1];
+  EXPECT_EQ("Span2", span2.name());
+  EXPECT_FALSE(span2.has_ended());
+  EXPECT_FALSE(span2.has_remote_parent());
+  EXPECT_TRUE(span2.attributes().empty());
+  EXPECT_TRUE(span2.annotations().empty());
+  EXPECT_TRUE(span2.message_events().empty());
+  EXPECT_TRUE(span2.links().empty());
+}
+
+TEST(SpanBatchTest, LongStrings) {
+  const std::string long_value(100000, 'x');
+  SpanBatch::Builder builder;
+  builder.StartSpan("Span", SpanContext(), SpanId(), false, absl::UnixEpoch());
+  builder.AddAttribute("before", "short");
+  builder.AddAttribute("long", long_value);
+  builder.AddAttribute("after", "short");
+  const auto batch = builder.Build();
+  const auto& attributes = batch->spans()[0].attributes();
+  ASSERT_EQ(3, attributes.size());
+  EXPECT_EQ("short", attributes[0].value().string_value());
+  EXPECT_EQ(long_value, attributes[1].value().string_value());
+  EXPECT_EQ("after", attributes[2].key());
+  EXPECT_EQ("short", attributes[2].value().string_value());
+}
+
+TEST(SpanBatchTest, LinksBeforeAttributes) {
+  SpanBatch::Builder builder;
+  builder.StartSpan("Span", SpanContext(), SpanId(), false, absl::UnixEpoch());
+  builder.AddLink(Link(SpanContext(), Link::Type::kParentLinkedSpan,
+                       {{"link", AttributeValue(1)}}));
+  builder.AddAttribute("span", 2);
+  const auto batch = builder.Build();
+  const SpanBatch::SpanView& span = batch->spans()[0];
+  ASSERT_EQ(1, span.attributes().size());
+  EXPECT_EQ("span", span.attributes()[0].key());
+  ASSERT_EQ(1, span.links()[0].attributes().size());
+  EXPECT_EQ("link", span.links()[0].attributes()[0].key());
+}
+
+TEST(SpanBatchTest, AddSpanData) {
+  const SpanContext context{TraceId(trace_id), SpanId(span_id)};
+  const absl::Time start = absl::FromUnixSeconds(100);
+  std::vector<SpanData::TimeEvent<Annotation>> annotations;
+  annotations.emplace_back(start, Annotation("annotation"));
+  const SpanData data(
+      "Span", context, SpanId(parent_id),
+      SpanData::TimeEvents<Annotation>(std::move(annotations), 1),
+      SpanData::TimeEvents<MessageEvent>({}, 2),
+      {Link(context, Link::Type::kChildLinkedSpan)}, 3,
+      {{"key", AttributeValue("value")}}, 4, true, start,
+      start + absl::Seconds(1), Status(StatusCode::CANCELLED, "cancelled"),
+      true, 5);
+  SpanBatch::Builder builder;
+  builder.AddSpan(data);
+  const auto batch = builder.Build();
+  ASSERT_EQ(1, batch->size());
+  const SpanBatch::SpanView& span = batch->spans()[0];
+  EXPECT_EQ("Span", span.name());
+  EXPECT_TRUE(span.context() == context);
+  EXPECT_TRUE(span.parent_span_id() == SpanId(parent_id));
+  EXPECT_TRUE(span.has_remote_parent());
+  ASSERT_EQ(1, span.annotations().size());
+  EXPECT_EQ("annotation", span.annotations()[0].description());
+  ASSERT_EQ(1, span.links().size());
+  ASSERT_EQ(1, span.attributes().size());
+  EXPECT_EQ("value", span.attributes()[0].value().string_value());
+  EXPECT_EQ(4, span.num_attributes_dropped());
+  EXPECT_EQ(1, span.num_annotations_dropped());
+  EXPECT_EQ(2, span.num_message_events_dropped());
+  EXPECT_EQ(3, span.num_links_dropped());
+  EXPECT_EQ(5, span.num_bytes_dropped());
+  EXPECT_TRUE(span.has_ended());
+  EXPECT_EQ(StatusCode::CANCELLED, span.status_code());
+  EXPECT_EQ("cancelled", span.status_message());
+}
+
+}  // namespace
+}  // namespace exporter
+}  // namespace trace
+}  // namespace opencensus
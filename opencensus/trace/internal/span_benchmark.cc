@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+#include <vector>
+
 #include "benchmark/benchmark.h"
 #include "opencensus/trace/span.h"
 #include "opencensus/trace/span_context.h"
@@ -28,6 +31,45 @@ void BM_StartEndSpan(benchmark::State& state) {
 }
 BENCHMARK(BM_StartEndSpan);
 
+// The default TraceParams sample with low probability, so almost all of these
+// Spans are unsampled and take the default ProbabilitySampler's fast path.
+void BM_StartEndUnsampledSpan(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan("SpanName");
+    span.End();
+  }
+}
+BENCHMARK(BM_StartEndUnsampledSpan);
+
+void BM_StartEndChildOfUnsampledSpan(benchmark::State& state) {
+  static ::opencensus::trace::NeverSampler sampler;
+  auto parent = ::opencensus::trace::Span::StartSpan(
+      "ParentSpanName", /*parent=*/nullptr, {&sampler});
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan("SpanName", &parent);
+    span.End();
+  }
+  parent.End();
+}
+BENCHMARK(BM_StartEndChildOfUnsampledSpan);
+
+// Spans are started with a SpanNameSampler of state.range(0) rules, which
+// almost never samples them.
+void BM_StartEndSpanWithSpanNameSampler(benchmark::State& state) {
+  std::vector<::opencensus::trace::SpanNameSampler::Rule> rules;
+  for (int i = 0; i < state.range(0); ++i) {
+    rules.push_back({"Rule" + std::to_string(i), 1});
+  }
+  rules.push_back({"SpanName", 1e-9});
+  ::opencensus::trace::SpanNameSampler sampler(rules, 1);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    span.End();
+  }
+}
+BENCHMARK(BM_StartEndSpanWithSpanNameSampler)->Range(1, 1024);
+
 void BM_StartEndSpanAndAddAttribute(benchmark::State& state) {
   static ::opencensus::trace::AlwaysSampler sampler;
   while (state.KeepRunning()) {
@@ -39,6 +81,51 @@ void BM_StartEndSpanAndAddAttribute(benchmark::State& state) {
 }
 BENCHMARK(BM_StartEndSpanAndAddAttribute);
 
+void BM_StartEndSpanAndAddStaticAttribute(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    span.AddAttribute(::opencensus::trace::StaticString("key1"),
+                      ::opencensus::trace::StaticString("value1"));
+    span.End();
+  }
+}
+BENCHMARK(BM_StartEndSpanAndAddStaticAttribute);
+
+void BM_SpanAddAttributes(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    span.AddAttributes({{"key1", "value1"},
+                        {"key2", 123},
+                        {"key3", true},
+                        {"key4", "value4"}});
+    span.End();
+  }
+}
+BENCHMARK(BM_SpanAddAttributes);
+
+// Adds range(0) distinct attributes, evicting the oldest beyond
+// max_attributes.
+void BM_SpanAddDistinctAttributes(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  std::vector<std::string> keys;
+  for (int i = 0; i < state.range(0); ++i) {
+    keys.push_back("key" + std::to_string(i));
+  }
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    for (const auto& key : keys) {
+      span.AddAttribute(key, 123);
+    }
+    span.End();
+  }
+}
+BENCHMARK(BM_SpanAddDistinctAttributes)->Range(1, 64);
+
 void BM_StartEndSpanAndAddAnnotation(benchmark::State& state) {
   static ::opencensus::trace::AlwaysSampler sampler;
   while (state.KeepRunning()) {
@@ -50,6 +137,31 @@ void BM_StartEndSpanAndAddAnnotation(benchmark::State& state) {
 }
 BENCHMARK(BM_StartEndSpanAndAddAnnotation);
 
+// Adds a formatted annotation to a sampled (arg 1) or unsampled (arg 0) span,
+// formatting it eagerly or only if it is recorded.
+template <bool kLazy>
+void BM_SpanAddFormattedAnnotation(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler always_sampler;
+  static ::opencensus::trace::NeverSampler never_sampler;
+  ::opencensus::trace::Sampler* sampler = &never_sampler;
+  if (state.range(0)) sampler = &always_sampler;
+  auto span = ::opencensus::trace::Span::StartSpan(
+      "SpanName", /*parent=*/nullptr, {sampler});
+  int attempt = 0;
+  for (auto _ : state) {
+    ++attempt;
+    if (kLazy) {
+      span.AddAnnotation(
+          [attempt]() { return "Attempt " + std::to_string(attempt); });
+    } else {
+      span.AddAnnotation("Attempt " + std::to_string(attempt));
+    }
+  }
+  span.End();
+}
+BENCHMARK_TEMPLATE(BM_SpanAddFormattedAnnotation, false)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_SpanAddFormattedAnnotation, true)->Arg(0)->Arg(1);
+
 void BM_StartEndSpanAndAddMessageEvent(benchmark::State& state) {
   static ::opencensus::trace::AlwaysSampler sampler;
   while (state.KeepRunning()) {
@@ -77,6 +189,95 @@ void BM_StartEndSpanAndAddLink(benchmark::State& state) {
 }
 BENCHMARK(BM_StartEndSpanAndAddLink);
 
+// Starts a span with range(0) parent links, as a batch consumer linking to its
+// producers. If kOneWay, the producer spans are not given child links.
+template <bool kOneWay>
+void BM_StartEndSpanWithParentLinks(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  std::vector<::opencensus::trace::Span> producers;
+  std::vector<::opencensus::trace::Span*> parent_links;
+  for (int i = 0; i < state.range(0); ++i) {
+    producers.push_back(::opencensus::trace::Span::StartSpan(
+        "Producer", /*parent=*/nullptr, {&sampler}));
+  }
+  for (auto& producer : producers) parent_links.push_back(&producer);
+  const ::opencensus::trace::StartSpanOptions opts(
+      &sampler, parent_links, /*single_writer=*/false,
+      /*summarize_message_events=*/false, /*record_resource_usage=*/false,
+      /*one_way_parent_links=*/kOneWay);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan("SpanName",
+                                                     /*parent=*/nullptr, opts);
+    span.End();
+  }
+  for (auto& producer : producers) producer.End();
+}
+BENCHMARK_TEMPLATE(BM_StartEndSpanWithParentLinks, false)->Range(1, 1024);
+BENCHMARK_TEMPLATE(BM_StartEndSpanWithParentLinks, true)->Range(1, 1024);
+
+// Adds range(0) annotations, evicting the oldest beyond max_annotations.
+void BM_SpanAddAnnotations(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  const int num_events = state.range(0);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    for (int i = 0; i < num_events; ++i) {
+      span.AddAnnotation("This is an annotation.");
+    }
+    span.End();
+  }
+}
+BENCHMARK(BM_SpanAddAnnotations)->Range(1, 256);
+
+// As BM_SpanAddAnnotations, for a single-writer span.
+void BM_SingleWriterSpanAddAnnotations(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  const int num_events = state.range(0);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr,
+        {&sampler, {}, /*single_writer=*/true});
+    for (int i = 0; i < num_events; ++i) {
+      span.AddAnnotation("This is an annotation.");
+    }
+    span.End();
+  }
+}
+BENCHMARK(BM_SingleWriterSpanAddAnnotations)->Range(1, 256);
+
+// Adds range(0) message events, evicting the oldest beyond max_message_events.
+void BM_SpanAddMessageEvents(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  const int num_events = state.range(0);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr, {&sampler});
+    for (int i = 0; i < num_events; ++i) {
+      span.AddSentMessageEvent(i, 456, 789);
+    }
+    span.End();
+  }
+}
+BENCHMARK(BM_SpanAddMessageEvents)->Range(1, 256);
+
+// As BM_SpanAddMessageEvents, for a span that summarizes message events.
+void BM_SummarizedSpanAddMessageEvents(benchmark::State& state) {
+  static ::opencensus::trace::AlwaysSampler sampler;
+  const int num_events = state.range(0);
+  while (state.KeepRunning()) {
+    auto span = ::opencensus::trace::Span::StartSpan(
+        "SpanName", /*parent=*/nullptr,
+        {&sampler, {}, /*single_writer=*/false,
+         /*summarize_message_events=*/true});
+    for (int i = 0; i < num_events; ++i) {
+      span.AddSentMessageEvent(i, 456, 789);
+    }
+    span.End();
+  }
+}
+BENCHMARK(BM_SummarizedSpanAddMessageEvents)->Range(1, 256);
+
 void BM_StartEndSpanAndSetStatus(benchmark::State& state) {
   static ::opencensus::trace::AlwaysSampler sampler;
   while (state.KeepRunning()) {
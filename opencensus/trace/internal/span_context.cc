@@ -14,7 +14,10 @@
 
 #include "opencensus/trace/span_context.h"
 
-#include "absl/strings/str_cat.h"
+#include <cstdint>
+#include <string>
+
+#include "opencensus/trace/internal/hex.h"
 
 namespace opencensus {
 namespace trace {
@@ -32,8 +35,16 @@ bool SpanContext::IsValid() const {
 }
 
 std::string SpanContext::ToString() const {
-  return absl::StrCat(trace_id_.ToHex(), "-", span_id_.ToHex(), "-",
-                      trace_options_.ToHex());
+  // "<trace id>-<span id>-<trace options>", encoded in place.
+  constexpr size_t kSpanIdOfs = TraceId::kHexSize + 1;
+  constexpr size_t kOptionsOfs = kSpanIdOfs + SpanId::kHexSize + 1;
+  std::string out(kOptionsOfs + 2 * TraceOptions::kSize, '-');
+  trace_id_.ToHex(&out[0]);
+  span_id_.ToHex(&out[kSpanIdOfs]);
+  uint8_t options[TraceOptions::kSize];
+  trace_options_.CopyTo(options);
+  EncodeHex(options, TraceOptions::kSize, &out[kOptionsOfs]);
+  return out;
 }
 
 }  // namespace trace
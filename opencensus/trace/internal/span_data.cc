@@ -14,10 +14,12 @@
 
 #include "opencensus/trace/exporter/span_data.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
 #include "absl/strings/str_cat.h"
+#include "opencensus/trace/internal/span_name.h"
 
 namespace opencensus {
 namespace trace {
@@ -32,16 +34,19 @@ SpanData::SpanData(absl::string_view name, SpanContext context,
                    std::unordered_map<std::string, AttributeValue>&& attributes,
                    int num_attributes_dropped, bool has_ended,
                    absl::Time start_time, absl::Time end_time, Status status,
-                   bool has_remote_parent)
-    : name_(name),
+                   bool has_remote_parent, int64_t num_bytes_dropped,
+                   MessageEventTotals message_event_totals)
+    : name_(InternSpanName(name)),
       context_(context),
       parent_span_id_(parent_span_id),
       annotations_(std::move(annotations)),
       message_events_(std::move(message_events)),
+      message_event_totals_(message_event_totals),
       links_(std::move(links)),
       attributes_(std::move(attributes)),
       num_links_dropped_(num_links_dropped),
       num_attributes_dropped_(num_attributes_dropped),
+      num_bytes_dropped_(num_bytes_dropped),
       start_time_(start_time),
       end_time_(end_time),
       status_(std::move(status)),
@@ -62,6 +67,10 @@ const SpanData::TimeEvents<MessageEvent>& SpanData::message_events() const {
   return message_events_;
 }
 
+const MessageEventTotals& SpanData::message_event_totals() const {
+  return message_event_totals_;
+}
+
 const std::vector<Link>& SpanData::links() const { return links_; }
 
 int SpanData::num_links_dropped() const { return num_links_dropped_; }
@@ -73,6 +82,8 @@ const std::unordered_map<std::string, AttributeValue>& SpanData::attributes()
 
 int SpanData::num_attributes_dropped() const { return num_attributes_dropped_; }
 
+int64_t SpanData::num_bytes_dropped() const { return num_bytes_dropped_; }
+
 bool SpanData::has_ended() const { return has_ended_; }
 
 absl::Time SpanData::start_time() const { return start_time_; }
@@ -108,6 +119,13 @@ std::string SpanData::DebugString() const {
 
   StrAppend(&debug_str, "Message events: (",
             message_events().dropped_events_count(), " dropped)\n");
+  const MessageEventTotals& totals = message_event_totals();
+  StrAppend(&debug_str, "  Sent: ", totals.sent_messages, " messages, ",
+            totals.sent_compressed_bytes, " compressed bytes, ",
+            totals.sent_uncompressed_bytes, " uncompressed bytes\n",
+            "  Received: ", totals.received_messages, " messages, ",
+            totals.received_compressed_bytes, " compressed bytes, ",
+            totals.received_uncompressed_bytes, " uncompressed bytes\n");
   for (const auto& message : message_events().events()) {
     StrAppend(&debug_str, "  ", absl::FormatTime(message.timestamp()), ": ",
               message.event().DebugString(), "\n");
@@ -118,6 +136,10 @@ std::string SpanData::DebugString() const {
     StrAppend(&debug_str, "  ", link.DebugString(), "\n");
   }
 
+  if (num_bytes_dropped() > 0) {
+    StrAppend(&debug_str, "Bytes dropped: ", num_bytes_dropped(), "\n");
+  }
+
   StrAppend(&debug_str, "Span ended: ", (has_ended() ? "true" : "false"), "\n");
 
   StrAppend(&debug_str, "Status: ", status().ToString(), "\n");
@@ -0,0 +1,35 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/span_end_hook.h"
+
+#include <atomic>
+
+namespace opencensus {
+namespace trace {
+
+namespace {
+
+std::atomic<SpanEndHook> hook{nullptr};
+
+}  // namespace
+
+void SetSpanEndHook(SpanEndHook new_hook) {
+  hook.store(new_hook, std::memory_order_release);
+}
+
+SpanEndHook GetSpanEndHook() { return hook.load(std::memory_order_acquire); }
+
+}  // namespace trace
+}  // namespace opencensus
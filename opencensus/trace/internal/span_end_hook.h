@@ -0,0 +1,43 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_SPAN_END_HOOK_H_
+#define OPENCENSUS_TRACE_INTERNAL_SPAN_END_HOOK_H_
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/status_code.h"
+
+namespace opencensus {
+namespace trace {
+
+// Receives the name, status code and latency of each recording Span as it
+// ends, from the start and end times the Span records anyway. 'name' is
+// interned, and remains valid for the lifetime of the process. This lets
+// libraries that trace does not depend on derive metrics from Spans (see
+// opencensus/stats/span_latency.h).
+typedef void (*SpanEndHook)(absl::string_view name, StatusCode code,
+                            absl::Duration latency);
+
+// Installs 'hook' (or, if null, removes it). Thread-safe.
+void SetSpanEndHook(SpanEndHook hook);
+
+// Returns the installed hook, or null. This costs one atomic load.
+// Thread-safe.
+SpanEndHook GetSpanEndHook();
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_SPAN_END_HOOK_H_
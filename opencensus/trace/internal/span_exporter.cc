@@ -14,20 +14,48 @@
 
 #include "opencensus/trace/exporter/span_exporter.h"
 
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/time/time.h"
 #include "opencensus/trace/internal/span_exporter_impl.h"
 
 namespace opencensus {
 namespace trace {
 namespace exporter {
 
+// static
+void SpanExporter::SetOptions(const Options& options) {
+  SpanExporterImpl::Get()->SetOptions(options);
+}
+
 // static
 void SpanExporter::RegisterHandler(std::unique_ptr<Handler> handler) {
   SpanExporterImpl::Get()->RegisterHandler(std::move(handler));
 }
 
+// static
+void SpanExporter::ExportSpans(std::vector<SpanData> spans) {
+  SpanExporterImpl::Get()->ExportSpanData(std::move(spans));
+}
+
+// static
+uint64_t SpanExporter::NumDroppedSpans() {
+  return SpanExporterImpl::Get()->NumDroppedSpans();
+}
+
+// static
+uint64_t SpanExporter::NumDroppedSpans(SpanPriority priority) {
+  return SpanExporterImpl::Get()->NumDroppedSpans(priority);
+}
+
+// static
+bool SpanExporter::Shutdown(absl::Time deadline) {
+  return SpanExporterImpl::Get()->Shutdown(deadline);
+}
+
 // static
 void SpanExporter::ExportForTesting() {
   SpanExporterImpl::Get()->ExportForTesting();
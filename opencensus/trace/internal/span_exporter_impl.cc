@@ -14,104 +14,773 @@
 
 #include "opencensus/trace/internal/span_exporter_impl.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/clock.h"
+#include "opencensus/common/internal/probes.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/common/internal/self_metrics.h"
+#include "opencensus/trace/exporter/span_batch.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/internal/ended_spans.h"
+#include "opencensus/trace/internal/running_span_store_impl.h"
+#include "opencensus/trace/internal/trace_config_impl.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/trace/trace_config.h"
+#include "opencensus/trace/trace_id.h"
 
 namespace opencensus {
 namespace trace {
 namespace exporter {
 
-SpanExporterImpl* SpanExporterImpl::span_exporter_ = nullptr;
+namespace {
+
+// How many times AddSpan() drops a span of lower priority or, with
+// DropPolicy::kDropOldest, the oldest span, and retries when other threads keep
+// refilling the queue, before dropping the new span instead.
+constexpr int kMaxDropOldestAttempts = 4;
+
+void RecordStoreMemoryUsage(const TraceMemoryUsage::Store& store,
+                            absl::string_view label) {
+  common::RecordSelfMetric(common::SelfMetric::kSpanStoreSpans, store.spans,
+                           label);
+  common::RecordSelfMetric(common::SelfMetric::kSpanStoreBytes, store.bytes,
+                           label);
+}
+
+// Records the memory held by the span stores and the export queue, once per
+// export cycle.
+void RecordMemoryUsage() {
+  const TraceMemoryUsage usage = TraceConfig::GetMemoryUsage();
+  RecordStoreMemoryUsage(usage.running_spans, "running");
+  RecordStoreMemoryUsage(usage.local_spans, "local");
+  RecordStoreMemoryUsage(usage.export_queue, "export_queue");
+}
+
+}  // namespace
+
+constexpr size_t SpanExporterImpl::HandlerWorker::kMaxPendingBatches;
+
+SpanExporterImpl::HandlerWorker::HandlerWorker(
+    std::unique_ptr<SpanExporter::Handler> handler,
+    std::atomic<uint64_t>* dropped_spans)
+    : handler_(std::move(handler)),
+      exports_span_batches_(handler_->ExportsSpanBatches()),
+      exports_span_chunks_(handler_->ExportsSpanChunks()),
+      dropped_spans_(dropped_spans) {
+  if (!common::Scheduler::Get()->manual_mode()) {
+    thread_ = std::thread(&SpanExporterImpl::HandlerWorker::Run, this);
+  }
+}
+
+SpanExporterImpl::HandlerWorker::~HandlerWorker() {
+  {
+    absl::MutexLock l(&mu_);
+    shutdown_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SpanExporterImpl::HandlerWorker::ExportBatch(Batch batch) {
+  if (batch.chunks) {
+    handler_->ExportSpanChunks(*batch.span_data);
+  } else if (exports_span_batches_) {
+    handler_->ExportSpanBatch(std::move(batch.span_batch));
+  } else {
+    handler_->ExportBatch(std::move(batch.span_data));
+  }
+}
+
+void SpanExporterImpl::HandlerWorker::Post(Batch batch) {
+  absl::MutexLock l(&mu_);
+  if (!thread_.joinable()) {
+    // Exports run one at a time, as on the thread.
+    mu_.Await(absl::Condition(this, &HandlerWorker::Idle));
+    busy_ = true;
+    mu_.Unlock();
+    ExportBatch(std::move(batch));
+    mu_.Lock();
+    busy_ = false;
+    return;
+  }
+  if (pending_.size() >= kMaxPendingBatches) {
+    dropped_spans_->fetch_add(pending_.front().size,
+                              std::memory_order_relaxed);
+    pending_.pop_front();
+  }
+  pending_.push_back(std::move(batch));
+}
+
+void SpanExporterImpl::HandlerWorker::WaitIdle() {
+  absl::MutexLock l(&mu_);
+  mu_.Await(absl::Condition(this, &HandlerWorker::Idle));
+}
+
+bool SpanExporterImpl::HandlerWorker::WaitIdleWithDeadline(
+    absl::Time deadline) {
+  absl::MutexLock l(&mu_);
+  return mu_.AwaitWithDeadline(absl::Condition(this, &HandlerWorker::Idle),
+                               deadline);
+}
+
+size_t SpanExporterImpl::HandlerWorker::PendingSpans() const {
+  absl::MutexLock l(&mu_);
+  size_t spans = 0;
+  for (const Batch& batch : pending_) {
+    spans += batch.size;
+  }
+  return spans;
+}
+
+void SpanExporterImpl::HandlerWorker::PrepareFork() { mu_.Lock(); }
+
+void SpanExporterImpl::HandlerWorker::ParentAfterFork() { mu_.Unlock(); }
+
+void SpanExporterImpl::HandlerWorker::ChildAfterFork() {
+  common::Scheduler::AbandonThread(&thread_);
+  pending_.clear();
+  busy_ = false;
+  common::Scheduler::ReinitMutexInChild(&mu_);
+}
+
+void SpanExporterImpl::HandlerWorker::RestartAfterFork() {
+  if (thread_.joinable() || common::Scheduler::Get()->manual_mode()) {
+    return;
+  }
+  {
+    absl::MutexLock l(&mu_);
+    if (shutdown_) {
+      return;
+    }
+  }
+  thread_ = std::thread(&SpanExporterImpl::HandlerWorker::Run, this);
+}
+
+void SpanExporterImpl::HandlerWorker::Run() {
+  while (true) {
+    Batch batch;
+    {
+      absl::MutexLock l(&mu_);
+      mu_.Await(absl::Condition(this, &HandlerWorker::ReadyOrShutdown));
+      if (shutdown_) {
+        return;
+      }
+      batch = std::move(pending_.front());
+      pending_.pop_front();
+      busy_ = true;
+    }
+    // Passing on the batch releases it before reporting idle, so that the
+    // last handler to finish with it frees it on its own thread (unless the
+    // handler retains it).
+    ExportBatch(std::move(batch));
+    absl::MutexLock l(&mu_);
+    busy_ = false;
+  }
+}
 
 SpanExporterImpl* SpanExporterImpl::Get() {
-  static SpanExporterImpl* global_span_exporter_impl = new SpanExporterImpl(
-      kDefaultBufferSize, absl::Milliseconds(kIntervalWaitTimeInMillis));
+  static SpanExporterImpl* global_span_exporter_impl = new SpanExporterImpl;
   return global_span_exporter_impl;
 }
 
-SpanExporterImpl::SpanExporterImpl(uint32_t buffer_size,
-                                   absl::Duration interval)
-    : buffer_size_(buffer_size), interval_(interval) {}
+SpanExporterImpl::SpanExporterImpl() {
+  common::Scheduler::Get()->AddForkHandler(
+      {[this] { PrepareFork(); }, [this] { ParentAfterFork(); },
+       [this] { ChildAfterFork(); }, [this] { RestartAfterFork(); }});
+}
+
+void SpanExporterImpl::PrepareFork() {
+  handler_mu_.Lock();
+  tail_mu_.Lock();
+  for (const auto& handler : handlers_) {
+    handler->PrepareFork();
+  }
+}
+
+void SpanExporterImpl::ParentAfterFork() {
+  for (const auto& handler : handlers_) {
+    handler->ParentAfterFork();
+  }
+  tail_mu_.Unlock();
+  handler_mu_.Unlock();
+}
+
+void SpanExporterImpl::ChildAfterFork() {
+  for (const auto& handler : handlers_) {
+    handler->ChildAfterFork();
+  }
+  // Other threads may have been pushing to or popping from the lock-free
+  // queue, so it cannot be drained; it is leaked, like the original.
+  SpanQueue* queue = queue_.load(std::memory_order_relaxed);
+  if (queue != nullptr) {
+    queue_.store(new SpanQueue(queue->capacity(), queue->priority_lanes()),
+                 std::memory_order_release);
+  }
+  batch_ready_.store(false, std::memory_order_relaxed);
+  if (tail_sampler_ != nullptr) {
+    tail_sampler_ =
+        absl::make_unique<SpanTailSampler>(tail_sampler_->options());
+  }
+  common::Scheduler::ReinitMutexInChild(&tail_mu_);
+  common::Scheduler::ReinitMutexInChild(&handler_mu_);
+}
+
+void SpanExporterImpl::RestartAfterFork() {
+  absl::MutexLock l(&handler_mu_);
+  for (const auto& handler : handlers_) {
+    handler->RestartAfterFork();
+  }
+}
+
+void SpanExporterImpl::SetOptions(const SpanExporter::Options& options) {
+  absl::MutexLock l(&handler_mu_);
+  options_ = options;
+  options_.batch_size = std::max<size_t>(1, options.batch_size);
+  options_.flush_interval =
+      std::max(options.flush_interval, absl::Milliseconds(1));
+  batch_size_.store(options_.batch_size, std::memory_order_relaxed);
+  group_by_trace_.store(options_.group_by_trace, std::memory_order_relaxed);
+  backlog_high_water_.store(options_.backlog_high_water,
+                            std::memory_order_relaxed);
+  backlog_max_halvings_.store(std::max(0, options_.backlog_max_halvings),
+                              std::memory_order_relaxed);
+}
 
 void SpanExporterImpl::RegisterHandler(
     std::unique_ptr<SpanExporter::Handler> handler) {
+  common::Scheduler::Get()->RestartAfterFork();
   absl::MutexLock l(&handler_mu_);
-  handlers_.emplace_back(std::move(handler));
-  if (!thread_started_) {
-    StartExportThread();
+  handlers_.emplace_back(
+      absl::make_unique<HandlerWorker>(std::move(handler), &dropped_spans_));
+  if (!task_started_) {
+    StartExportTask();
   }
 }
 
+SpanExporterImpl::SpanQueue::SpanQueue(size_t capacity, bool priority_lanes) {
+  lanes_.push_back(absl::make_unique<Lane>(capacity));
+  capacity_ = lanes_[0]->capacity();
+  if (priority_lanes) {
+    // Each lane can take the whole capacity, which TryPush() enforces across
+    // lanes.
+    for (int i = 1; i < kNumSpanPriorities; ++i) {
+      lanes_.push_back(absl::make_unique<Lane>(capacity_));
+    }
+  }
+}
+
+bool SpanExporterImpl::SpanQueue::TryPush(
+    SpanPriority priority, std::shared_ptr<opencensus::trace::SpanImpl>* span) {
+  if (priority_lanes() && SizeApprox() >= capacity_) {
+    return false;
+  }
+  return lane(priority)->TryPush(span);
+}
+
+bool SpanExporterImpl::SpanQueue::TryPop(
+    SpanPriority priority, std::shared_ptr<opencensus::trace::SpanImpl>* span) {
+  return lane(priority)->TryPop(span);
+}
+
+bool SpanExporterImpl::SpanQueue::TryPop(
+    std::shared_ptr<opencensus::trace::SpanImpl>* span) {
+  for (auto it = lanes_.rbegin(); it != lanes_.rend(); ++it) {
+    if ((*it)->TryPop(span)) return true;
+  }
+  return false;
+}
+
+size_t SpanExporterImpl::SpanQueue::SizeApprox() const {
+  size_t size = 0;
+  for (const auto& lane : lanes_) {
+    size += lane->SizeApprox();
+  }
+  return size;
+}
+
+size_t SpanExporterImpl::SpanQueue::ApproximateBytes() const {
+  size_t bytes = sizeof(*this);
+  for (const auto& lane : lanes_) {
+    bytes += lane->ApproximateBytes();
+  }
+  return bytes;
+}
+
 void SpanExporterImpl::AddSpan(
     const std::shared_ptr<opencensus::trace::SpanImpl>& span_impl) {
-  absl::MutexLock l(&span_mu_);
-  if (!collect_spans_) return;
-  spans_.emplace_back(span_impl);
+  common::Scheduler::Get()->RestartAfterFork();
+  SpanQueue* queue = queue_.load(std::memory_order_acquire);
+  if (queue == nullptr) return;
+  std::shared_ptr<opencensus::trace::SpanImpl> span = span_impl;
+  AddToQueue(queue, absl::MakeSpan(&span, 1));
 }
 
-void SpanExporterImpl::StartExportThread() {
-  t_ = std::thread(&SpanExporterImpl::RunWorkerLoop, this);
-  thread_started_ = true;
-  absl::MutexLock l(&span_mu_);
-  collect_spans_ = true;
+void SpanExporterImpl::AddSpans(
+    absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans) {
+  common::Scheduler::Get()->RestartAfterFork();
+  SpanQueue* queue = queue_.load(std::memory_order_acquire);
+  if (queue == nullptr) return;
+  AddToQueue(queue, spans);
 }
 
-bool SpanExporterImpl::IsBufferFull() const {
-  span_mu_.AssertHeld();
-  return spans_.size() >= buffer_size_;
+void SpanExporterImpl::AddToQueue(
+    SpanQueue* queue,
+    absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans) {
+  bool added = false;
+  for (auto& span : spans) {
+    // Without priority lanes, every span goes to the one lane, with no lane
+    // below it.
+    const SpanPriority priority =
+        queue->priority_lanes() ? Priority(*span) : SpanPriority::kLow;
+    added |= Push(queue, priority, &span);
+  }
+  if (!added) {
+    return;
+  }
+  if (queue->SizeApprox() >= batch_size_.load(std::memory_order_relaxed) &&
+      !batch_ready_.load(std::memory_order_relaxed) &&
+      !batch_ready_.exchange(true, std::memory_order_relaxed)) {
+    // Only the thread completing a batch gets here.
+    common::Scheduler::Get()->Wake(export_task_);
+  }
 }
 
-void SpanExporterImpl::RunWorkerLoop() {
-  std::vector<opencensus::trace::exporter::SpanData> span_data_;
-  std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> batch_;
-  // Thread loops forever.
-  // TODO: Add in shutdown mechanism.
-  absl::Time next_forced_export_time = absl::Now() + interval_;
-  while (true) {
+SpanPriority SpanExporterImpl::Priority(
+    const opencensus::trace::SpanImpl& span) const {
+  if (span.priority() == SpanPriority::kHigh ||
+      span.status_code() != StatusCode::OK) {
+    return SpanPriority::kHigh;
+  }
+  const auto it = slow_span_thresholds_.find(span.name());
+  const absl::Duration threshold =
+      it == slow_span_thresholds_.end() ? slow_span_threshold_ : it->second;
+  if (threshold != absl::InfiniteDuration() && span.latency() >= threshold) {
+    return SpanPriority::kHigh;
+  }
+  return span.priority();
+}
+
+bool SpanExporterImpl::Push(
+    SpanQueue* queue, SpanPriority priority,
+    std::shared_ptr<opencensus::trace::SpanImpl>* span) {
+  if (queue->TryPush(priority, span)) {
+    return true;
+  }
+  for (int i = 0; i < kMaxDropOldestAttempts; ++i) {
+    std::shared_ptr<opencensus::trace::SpanImpl> dropped;
+    bool made_room = false;
+    for (int lower = 0; lower < static_cast<int>(priority) && !made_room;
+         ++lower) {
+      const SpanPriority lower_priority = static_cast<SpanPriority>(lower);
+      if (queue->TryPop(lower_priority, &dropped)) {
+        CountDroppedSpan(*queue, lower_priority);
+        made_room = true;
+      }
+    }
+    if (!made_room) {
+      if (!drop_oldest_) break;
+      if (queue->TryPop(priority, &dropped)) {
+        CountDroppedSpan(*queue, priority);
+      }
+    }
+    if (queue->TryPush(priority, span)) {
+      return true;
+    }
+  }
+  CountDroppedSpan(*queue, priority);
+  return false;
+}
+
+void SpanExporterImpl::CountDroppedSpan(const SpanQueue& queue,
+                                        SpanPriority priority) {
+  dropped_spans_.fetch_add(1, std::memory_order_relaxed);
+  if (queue.priority_lanes()) {
+    dropped_spans_by_priority_[static_cast<int>(priority)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+}
+
+void SpanExporterImpl::StartExportTask() {
+  drop_oldest_ = options_.drop_policy ==
+                 SpanExporter::Options::DropPolicy::kDropOldest;
+  slow_span_threshold_ = options_.slow_span_threshold;
+  slow_span_thresholds_.insert(options_.slow_span_thresholds.begin(),
+                               options_.slow_span_thresholds.end());
+  if (options_.tail_sampling_wait > absl::ZeroDuration()) {
+    tail_sampler_ = absl::make_unique<SpanTailSampler>(
+        SpanTailSampler::Options{options_.tail_sampling_wait,
+                                 options_.tail_sampling_min_latency,
+                                 options_.tail_sampling_errors,
+                                 options_.tail_sampling_max_spans});
+  }
+  // The task does nothing until the queue is published.
+  export_task_ = common::Scheduler::Get()->AddTask(
+      [this] { return RunExport(); },
+      absl::Now() + options_.flush_interval);
+  queue_.store(
+      new SpanQueue(options_.buffer_capacity, options_.priority_lanes),
+      std::memory_order_release);
+  task_started_ = true;
+}
+
+absl::Duration SpanExporterImpl::flush_interval() const {
+  absl::MutexLock l(&handler_mu_);
+  return options_.flush_interval;
+}
+
+bool SpanExporterImpl::Shutdown(absl::Time deadline) {
+  {
+    absl::MutexLock l(&handler_mu_);
+    // Keep RegisterHandler() from (re)starting the export task.
+    task_started_ = true;
+  }
+  // Queue the spans still staged by their threads, then stop intake, so that
+  // the final export below covers every span that made it into the queue.
+  EndedSpans::Flush();
+  SpanQueue* queue = queue_.exchange(nullptr, std::memory_order_acq_rel);
+  if (queue != nullptr) {
+    // The export task only converts spans and posts them to the handlers'
+    // queues, so this does not wait for long.
+    common::Scheduler::Get()->RemoveTask(export_task_);
+    ExportQueuedSpans(queue, /*final_export=*/true);
+  }
+  bool idle = true;
+  absl::MutexLock l(&handler_mu_);
+  for (const auto& handler : handlers_) {
+    idle &= handler->WaitIdleWithDeadline(deadline);
+  }
+  return idle;
+}
+
+TraceMemoryUsage::Store SpanExporterImpl::QueueMemoryUsage() const {
+  TraceMemoryUsage::Store usage;
+  const SpanQueue* queue = queue_.load(std::memory_order_acquire);
+  if (queue != nullptr) {
+    usage.spans = queue->SizeApprox();
+    usage.bytes =
+        queue->ApproximateBytes() + usage.spans * sizeof(SpanImpl);
+  }
+  return usage;
+}
+
+absl::Time SpanExporterImpl::RunExport() {
+  EndedSpans::Flush();
+  SpanQueue* queue = queue_.load(std::memory_order_acquire);
+  batch_ready_.store(false, std::memory_order_relaxed);
+  // Schedule the next forced export from the start of this one.
+  const absl::Time next_forced_export_time = absl::Now() + flush_interval();
+  if (queue != nullptr) {
+    ExportQueuedSpans(queue);
+    ExportSpanChunks();
+  }
+  return next_forced_export_time;
+}
+
+void SpanExporterImpl::ExportQueuedSpans(SpanQueue* queue,
+                                         bool final_export) {
+  std::shared_ptr<opencensus::trace::SpanImpl> span;
+  // Bound the work to the spans already queued, so that producers cannot keep
+  // the export going indefinitely.
+  size_t remaining = queue->SizeApprox();
+  common::RecordSelfMetric(common::SelfMetric::kSpanExportQueueDepth,
+                           remaining);
+  const uint64_t dropped = dropped_spans_.load(std::memory_order_relaxed);
+  const uint64_t newly_dropped =
+      dropped -
+      reported_dropped_spans_.exchange(dropped, std::memory_order_relaxed);
+  if (newly_dropped > 0) {
+    common::RecordSelfMetric(common::SelfMetric::kSpansDropped,
+                             newly_dropped);
+  }
+  if (common::SelfMetricsEnabled()) {
+    RecordMemoryUsage();
+  }
+  if (!final_export) {
+    UpdateBacklogFeedback(remaining);
+  }
+  const bool group_by_trace = group_by_trace_.load(std::memory_order_relaxed);
+  if (tail_sampler_ != nullptr) {
+    std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> kept;
     {
-      absl::MutexLock l(&span_mu_);
-      // Wait until batch is full or interval time has been exceeded.
-      span_mu_.AwaitWithDeadline(
-          absl::Condition(this, &SpanExporterImpl::IsBufferFull),
-          next_forced_export_time);
-      next_forced_export_time = absl::Now() + interval_;
-      if (spans_.empty()) {
-        continue;
+      absl::MutexLock l(&tail_mu_);
+      const absl::Time now = absl::Now();
+      while (remaining > 0 && queue->TryPop(&span)) {
+        const absl::Duration latency = span->latency();
+        const bool ok = span->status_code() == StatusCode::OK;
+        const TraceId trace_id = span->context().trace_id();
+        tail_sampler_->Add(trace_id, std::move(span), latency, ok, now, &kept);
+        --remaining;
+      }
+      if (final_export) {
+        tail_sampler_->DecideAll(&kept);
+      } else {
+        tail_sampler_->Decide(now, &kept);
+      }
+    }
+    if (group_by_trace) {
+      GroupByTrace(&kept);
+    }
+    ExportSpans(std::move(kept));
+    return;
+  }
+  if (group_by_trace) {
+    // Grouping needs every span of the export, so pop them all first.
+    std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> spans;
+    spans.reserve(remaining);
+    while (remaining > 0 && queue->TryPop(&span)) {
+      spans.push_back(std::move(span));
+      --remaining;
+    }
+    GroupByTrace(&spans);
+    ExportSpans(std::move(spans));
+    return;
+  }
+  std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> spans;
+  while (remaining > 0) {
+    const size_t batch_size = batch_size_.load(std::memory_order_relaxed);
+    spans.clear();
+    spans.reserve(std::min(batch_size, remaining));
+    while (spans.size() < batch_size && remaining > 0 &&
+           queue->TryPop(&span)) {
+      spans.push_back(std::move(span));
+      --remaining;
+    }
+    if (spans.empty()) {
+      // Another thread dropped the remaining spans.
+      break;
+    }
+    // Handlers export this batch while the next one is converted.
+    Export(absl::MakeSpan(spans));
+  }
+}
+
+void SpanExporterImpl::ExportSpanChunks() {
+  absl::Duration interval;
+  std::vector<HandlerWorker*> handlers;
+  {
+    absl::MutexLock l(&handler_mu_);
+    interval = options_.running_span_flush_interval;
+    if (interval == absl::InfiniteDuration()) {
+      return;
+    }
+    for (const auto& handler : handlers_) {
+      if (handler->exports_span_chunks()) {
+        handlers.push_back(handler.get());
       }
-      std::swap(batch_, spans_);
     }
-    for (const auto& span : batch_) {
-      span_data_.emplace_back(span->ToSpanData());
+  }
+  if (handlers.empty()) {
+    // Nothing would export the chunks, so keep the events in the spans.
+    return;
+  }
+  std::vector<SpanData> chunks;
+  RunningSpanStoreImpl::Get()->TakeChunks(common::Clock::Now(), interval,
+                                          &chunks);
+  size_t begin = 0;
+  while (begin < chunks.size()) {
+    const size_t batch_size = batch_size_.load(std::memory_order_relaxed);
+    const size_t end = begin + std::min(batch_size, chunks.size() - begin);
+    Batch batch;
+    batch.span_data = std::make_shared<const std::vector<SpanData>>(
+        std::make_move_iterator(chunks.begin() + begin),
+        std::make_move_iterator(chunks.begin() + end));
+    batch.size = end - begin;
+    batch.chunks = true;
+    for (HandlerWorker* handler : handlers) {
+      handler->Post(batch);
     }
-    batch_.clear();
-    Export(span_data_);
-    span_data_.clear();
+    begin = end;
   }
 }
 
-void SpanExporterImpl::Export(const std::vector<SpanData>& span_data) {
-  // Call each registered handler.
+void SpanExporterImpl::UpdateBacklogFeedback(size_t backlog) {
+  const size_t high_water = backlog_high_water_.load(std::memory_order_relaxed);
+  int halvings = backlog_halvings_.load(std::memory_order_relaxed);
+  if (high_water == 0) {
+    if (halvings != 0) {
+      // Disabled since the last export.
+      backlog_halvings_.store(0, std::memory_order_relaxed);
+      TraceConfigImpl::Get()->SetBacklogHalvings(0);
+    }
+    return;
+  }
+  // Batches awaiting a slow handler leave the buffer, so count those of the
+  // handler furthest behind.
+  {
+    absl::MutexLock l(&handler_mu_);
+    size_t pending = 0;
+    for (const auto& handler : handlers_) {
+      pending = std::max(pending, handler->PendingSpans());
+    }
+    backlog += pending;
+  }
+  const int max_halvings =
+      backlog_max_halvings_.load(std::memory_order_relaxed);
+  if (backlog > high_water) {
+    ++halvings;
+  } else if (backlog <= high_water / 2) {
+    --halvings;
+  }
+  halvings = std::min(std::max(halvings, 0), max_halvings);
+  backlog_halvings_.store(halvings, std::memory_order_relaxed);
+  TraceConfigImpl::Get()->SetBacklogHalvings(halvings);
+  common::RecordSelfMetric(common::SelfMetric::kSpanBacklogHalvings,
+                           halvings);
+}
+
+void SpanExporterImpl::GroupByTrace(
+    std::vector<std::shared_ptr<opencensus::trace::SpanImpl>>* spans) {
+  // Sort (trace ID, position) pairs rather than the spans, so that trace IDs
+  // are copied out once and ties keep their order.
+  typedef std::pair<std::array<uint8_t, TraceId::kSize>, size_t> Key;
+  std::vector<Key> keys(spans->size());
+  for (size_t i = 0; i < spans->size(); ++i) {
+    (*spans)[i]->context().trace_id().CopyTo(keys[i].first.data());
+    keys[i].second = i;
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> sorted;
+  sorted.reserve(spans->size());
+  for (const Key& key : keys) {
+    sorted.push_back(std::move((*spans)[key.second]));
+  }
+  spans->swap(sorted);
+}
+
+void SpanExporterImpl::ExportSpans(
+    std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> spans) {
+  size_t begin = 0;
+  while (begin < spans.size()) {
+    const size_t batch_size = batch_size_.load(std::memory_order_relaxed);
+    const size_t size = std::min(batch_size, spans.size() - begin);
+    Export(absl::MakeSpan(spans).subspan(begin, size));
+    begin += size;
+  }
+}
+
+std::vector<SpanExporterImpl::HandlerWorker*> SpanExporterImpl::GetHandlers(
+    bool* span_data_needed, bool* span_batch_needed) const {
+  *span_data_needed = false;
+  *span_batch_needed = false;
+  std::vector<HandlerWorker*> handlers;
   absl::MutexLock lock(&handler_mu_);
+  handlers.reserve(handlers_.size());
   for (const auto& handler : handlers_) {
-    handler->Export(span_data);
+    handlers.push_back(handler.get());
+    if (handler->exports_span_batches()) {
+      *span_batch_needed = true;
+    } else {
+      *span_data_needed = true;
+    }
+  }
+  return handlers;
+}
+
+void SpanExporterImpl::ExportSpanData(std::vector<SpanData> spans) {
+  common::Scheduler::Get()->RestartAfterFork();
+  if (queue_.load(std::memory_order_acquire) == nullptr) return;
+  bool span_data_needed;
+  bool span_batch_needed;
+  const std::vector<HandlerWorker*> handlers =
+      GetHandlers(&span_data_needed, &span_batch_needed);
+  size_t begin = 0;
+  while (begin < spans.size()) {
+    const size_t batch_size = batch_size_.load(std::memory_order_relaxed);
+    const size_t end = begin + std::min(batch_size, spans.size() - begin);
+    Batch batch;
+    batch.size = end - begin;
+    if (span_batch_needed) {
+      SpanBatch::Builder builder(batch.size);
+      for (size_t i = begin; i < end; ++i) {
+        builder.AddSpan(spans[i]);
+      }
+      batch.span_batch = builder.Build();
+    }
+    if (span_data_needed) {
+      if (begin == 0 && end == spans.size()) {
+        // The whole input is one batch.
+        batch.span_data =
+            std::make_shared<const std::vector<SpanData>>(std::move(spans));
+      } else {
+        batch.span_data = std::make_shared<const std::vector<SpanData>>(
+            std::make_move_iterator(spans.begin() + begin),
+            std::make_move_iterator(spans.begin() + end));
+      }
+    }
+    for (HandlerWorker* handler : handlers) {
+      handler->Post(batch);
+    }
+    begin = end;
   }
 }
 
+void SpanExporterImpl::Export(
+    absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans) {
+  OPENCENSUS_PROBE1(span_export_batch_begin, spans.size());
+  bool span_data_needed;
+  bool span_batch_needed;
+  const std::vector<HandlerWorker*> handlers =
+      GetHandlers(&span_data_needed, &span_batch_needed);
+  Batch batch;
+  batch.size = spans.size();
+  if (span_batch_needed) {
+    // Built first, since building the SpanData may consume the spans.
+    SpanBatch::Builder builder(spans.size());
+    for (const auto& span : spans) {
+      span->AppendTo(&builder);
+    }
+    batch.span_batch = builder.Build();
+  }
+  if (span_data_needed) {
+    auto span_data = std::make_shared<std::vector<SpanData>>();
+    span_data->reserve(spans.size());
+    for (auto& span_ref : spans) {
+      // Spans reach the queue from Span::End(), so once no Span or store
+      // refers to one, nothing can read it again and its events can be moved.
+      std::shared_ptr<opencensus::trace::SpanImpl> span = std::move(span_ref);
+      span_data->emplace_back(span.use_count() == 1 ? span->ConsumeToSpanData()
+                                                    : span->ToSpanData());
+    }
+    batch.span_data = std::move(span_data);
+  }
+  for (auto& span : spans) {
+    span.reset();
+  }
+  // Handlers are never removed. Post() outside handler_mu_, since it may
+  // export on this thread.
+  for (HandlerWorker* handler : handlers) {
+    handler->Post(batch);
+  }
+  OPENCENSUS_PROBE1(span_export_batch_end, batch.size);
+}
+
 void SpanExporterImpl::ExportForTesting() {
-  std::vector<opencensus::trace::exporter::SpanData> span_data_;
-  std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> batch_;
-  {
-    absl::MutexLock l(&span_mu_);
-    std::swap(batch_, spans_);
+  EndedSpans::Flush();
+  SpanQueue* queue = queue_.load(std::memory_order_acquire);
+  if (queue != nullptr) {
+    ExportQueuedSpans(queue);
+    ExportSpanChunks();
   }
-  span_data_.reserve(batch_.size());
-  for (const auto& span : batch_) {
-    span_data_.emplace_back(span->ToSpanData());
+  absl::MutexLock lock(&handler_mu_);
+  for (const auto& handler : handlers_) {
+    handler->WaitIdle();
   }
-  Export(span_data_);
 }
 
 }  // namespace exporter
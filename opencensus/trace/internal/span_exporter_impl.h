@@ -15,6 +15,10 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_SPAN_EXPORTER_IMPL_H_
 #define OPENCENSUS_TRACE_INTERNAL_SPAN_EXPORTER_IMPL_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
@@ -22,11 +26,18 @@
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "opencensus/trace/exporter/span_batch.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/internal/bounded_queue.h"
 #include "opencensus/trace/internal/span_impl.h"
+#include "opencensus/trace/internal/tail_sampler.h"
+#include "opencensus/trace/span_priority.h"
+#include "opencensus/trace/trace_config.h"
 
 namespace opencensus {
 namespace trace {
@@ -44,20 +55,160 @@ class SpanExporterImpl {
   // Returns the global instance of SpanExporterImpl.
   static SpanExporterImpl* Get();
 
-  // A shared_ptr to the span is added to a list. The actual conversion to
-  // SpanData will take place at a later time via the background thread. This
-  // is intended to be called at the Span::End().
+  // A shared_ptr to the span is added to a bounded queue, or dropped if the
+  // queue is full (see Options::priority_lanes for which span is dropped). The
+  // actual conversion to SpanData will take place at a later time via the
+  // background export task. This is intended to be called at the Span::End(),
+  // and never blocks on the export task.
   void AddSpan(const std::shared_ptr<opencensus::trace::SpanImpl>& span_impl);
+  // As AddSpan(), for spans ended together, which are moved from.
+  void AddSpans(absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans);
+
+  // Converts 'spans' for handlers that export SpanBatches, and posts them to
+  // the handlers in batches of up to batch_size, on the calling thread. Does
+  // nothing unless spans are being collected (see queue_).
+  void ExportSpanData(std::vector<SpanData> spans);
+
+  void SetOptions(const SpanExporter::Options& options);
 
   // Registers a handler with the exporter. This is intended to be done at
   // initialization.
   void RegisterHandler(std::unique_ptr<SpanExporter::Handler> handler);
 
-  static constexpr uint32_t kDefaultBufferSize = 64;
-  static constexpr uint32_t kIntervalWaitTimeInMillis = 5000;
+  // Returns the number of spans queued for export and the approximate bytes
+  // held by the queue and the spans themselves, not counting their events.
+  TraceMemoryUsage::Store QueueMemoryUsage() const;
+
+  uint64_t NumDroppedSpans() const {
+    return dropped_spans_.load(std::memory_order_relaxed);
+  }
+  uint64_t NumDroppedSpans(SpanPriority priority) const {
+    return dropped_spans_by_priority_[static_cast<int>(priority)].load(
+        std::memory_order_relaxed);
+  }
+
+  // Stops intake and the export task, exports the queued spans, and waits
+  // until 'deadline' for the handlers to finish. Returns true if they did.
+  bool Shutdown(absl::Time deadline) LOCKS_EXCLUDED(handler_mu_);
 
  private:
-  SpanExporterImpl(uint32_t buffer_size, absl::Duration interval);
+  typedef BoundedQueue<std::shared_ptr<opencensus::trace::SpanImpl>> Lane;
+
+  // SpanQueue buffers ended spans: in a single lane, or with priority lanes in
+  // one lane per SpanPriority, together holding up to about capacity() spans.
+  // Pops take the highest priority first. Thread-safe and lock-free.
+  class SpanQueue {
+   public:
+    SpanQueue(size_t capacity, bool priority_lanes);
+
+    size_t capacity() const { return capacity_; }
+    bool priority_lanes() const { return lanes_.size() > 1; }
+
+    // Adds '*span' to the lane of 'priority', unless the queue is full.
+    bool TryPush(SpanPriority priority,
+                 std::shared_ptr<opencensus::trace::SpanImpl>* span);
+    // Pops the oldest span of the lane of 'priority'.
+    bool TryPop(SpanPriority priority,
+                std::shared_ptr<opencensus::trace::SpanImpl>* span);
+    // Pops the oldest span of the highest priority lane that has one.
+    bool TryPop(std::shared_ptr<opencensus::trace::SpanImpl>* span);
+
+    size_t SizeApprox() const;
+    size_t ApproximateBytes() const;
+
+   private:
+    Lane* lane(SpanPriority priority) const {
+      return lanes_[priority_lanes() ? static_cast<int>(priority) : 0].get();
+    }
+
+    size_t capacity_;
+    // Indexed by SpanPriority, lowest first.
+    std::vector<std::unique_ptr<Lane>> lanes_;
+  };
+
+  typedef TailSampler<std::shared_ptr<opencensus::trace::SpanImpl>>
+      SpanTailSampler;
+  // A batch of converted spans, shared immutably by all handlers. Only the
+  // representations some handler uses are built.
+  struct Batch {
+    std::shared_ptr<const std::vector<SpanData>> span_data;
+    std::shared_ptr<const SpanBatch> span_batch;
+    size_t size = 0;
+    // If true, span_data holds chunks of running spans, for
+    // Handler::ExportSpanChunks().
+    bool chunks = false;
+  };
+
+  // HandlerWorker runs a handler's exports on a thread of its own, from a
+  // queue of pending batches, so that a slow handler does not delay the
+  // others. In the scheduler's manual mode, it has no thread and exports on the
+  // thread calling Post().
+  class HandlerWorker {
+   public:
+    // Spans in batches dropped because the queue is full are counted in
+    // *dropped_spans.
+    HandlerWorker(std::unique_ptr<SpanExporter::Handler> handler,
+                  std::atomic<uint64_t>* dropped_spans);
+    // Waits for the export in progress, if any, to return. Pending batches are
+    // not exported.
+    ~HandlerWorker();
+
+    // Queues 'batch' for export, dropping the oldest pending batch if
+    // kMaxPendingBatches are already queued.
+    void Post(Batch batch) LOCKS_EXCLUDED(mu_);
+    // Waits until all posted batches have been exported.
+    void WaitIdle() LOCKS_EXCLUDED(mu_);
+    // As WaitIdle(), but gives up at 'deadline'. Returns true if idle.
+    bool WaitIdleWithDeadline(absl::Time deadline) LOCKS_EXCLUDED(mu_);
+
+    // For SpanExporterImpl's fork handler. The child drops the parent's
+    // pending batches and thread, and RestartAfterFork() starts a new thread
+    // (unless in manual mode).
+    void PrepareFork() EXCLUSIVE_LOCK_FUNCTION(mu_);
+    void ParentAfterFork() UNLOCK_FUNCTION(mu_);
+    void ChildAfterFork() UNLOCK_FUNCTION(mu_);
+    void RestartAfterFork() LOCKS_EXCLUDED(mu_);
+
+    // The spans in the batches awaiting export.
+    size_t PendingSpans() const LOCKS_EXCLUDED(mu_);
+
+    // Whether the handler exports SpanBatches rather than SpanData.
+    bool exports_span_batches() const { return exports_span_batches_; }
+    // Whether the handler exports chunks of running spans.
+    bool exports_span_chunks() const { return exports_span_chunks_; }
+
+    static constexpr size_t kMaxPendingBatches = 16;
+
+   private:
+    void Run() LOCKS_EXCLUDED(mu_);
+    // Conditions for mu_.
+    bool Idle() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return pending_.empty() && !busy_;
+    }
+    bool ReadyOrShutdown() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !pending_.empty() || shutdown_;
+    }
+
+    // Exports 'batch' on the calling thread.
+    void ExportBatch(Batch batch);
+
+    const std::unique_ptr<SpanExporter::Handler> handler_;
+    const bool exports_span_batches_;
+    const bool exports_span_chunks_;
+    std::atomic<uint64_t>* const dropped_spans_;
+
+    mutable absl::Mutex mu_;
+    std::deque<Batch> pending_ GUARDED_BY(mu_);
+    // Whether the thread is exporting a batch.
+    bool busy_ GUARDED_BY(mu_) = false;
+    bool shutdown_ GUARDED_BY(mu_) = false;
+
+    // Not started in manual mode.
+    std::thread thread_;
+  };
+
+  // Registers the fork handler.
+  SpanExporterImpl();
   SpanExporterImpl(const SpanExporterImpl&) = delete;
   SpanExporterImpl(SpanExporterImpl&&) = delete;
   SpanExporterImpl& operator=(const SpanExporterImpl&) = delete;
@@ -65,32 +216,107 @@ class SpanExporterImpl {
   friend class Span;
   friend class SpanExporter;  // For ExportForTesting() only.
 
-  void StartExportThread() EXCLUSIVE_LOCKS_REQUIRED(handler_mu_);
-  void RunWorkerLoop();
+  void StartExportTask() EXCLUSIVE_LOCKS_REQUIRED(handler_mu_);
+  // The export task, run on the shared common::Scheduler when a batch is full
+  // or the flush interval has elapsed. Returns the time of its next run.
+  absl::Time RunExport();
+
+  // Pops the spans queued when called and exports them in batches of up to
+  // batch_size, grouped by trace if group_by_trace. With tail sampling, the
+  // spans are passed through the tail sampler first, and only the spans of
+  // traces it keeps are exported; if 'final_export', every trace it holds is
+  // decided.
+  void ExportQueuedSpans(SpanQueue* queue, bool final_export = false);
+
+  // Takes the chunks of running spans due for export, if enabled, and posts
+  // them in batches of up to batch_size to the handlers that export chunks.
+  void ExportSpanChunks() LOCKS_EXCLUDED(handler_mu_);
+
+  // Adds 'spans' to 'queue', moving from them, and wakes the export task if a
+  // batch is ready.
+  void AddToQueue(
+      SpanQueue* queue,
+      absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans);
 
-  // Calls all registered handlers and exports the spans contained in span_data.
-  void Export(const std::vector<SpanData>& span_data);
+  // Returns the priority of the ended span 'span' for the priority lanes.
+  SpanPriority Priority(const opencensus::trace::SpanImpl& span) const;
 
-  // Only for testing purposes: runs the export on the current thread and
-  // returns when complete.
+  // Adds '*span' to the lane of 'priority' of 'queue' if there is room, or
+  // can be made by dropping a span of lower priority or, with
+  // DropPolicy::kDropOldest, the oldest span of the same priority. Counts the
+  // spans dropped, including '*span' if not added.
+  bool Push(SpanQueue* queue, SpanPriority priority,
+            std::shared_ptr<opencensus::trace::SpanImpl>* span);
+  void CountDroppedSpan(const SpanQueue& queue, SpanPriority priority);
+
+  // Adjusts the backlog halvings of the default sampler for a backlog of
+  // 'backlog' spans, if backlog feedback is enabled, and records them.
+  void UpdateBacklogFeedback(size_t backlog);
+
+  // Stably sorts 'spans' by trace ID.
+  static void GroupByTrace(
+      std::vector<std::shared_ptr<opencensus::trace::SpanImpl>>* spans);
+
+  // Converts 'spans' and exports them in batches of up to batch_size.
+  void ExportSpans(
+      std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> spans);
+
+  // Returns the registered handlers, and sets the flags to whether any exports
+  // SpanData and any exports SpanBatches.
+  std::vector<HandlerWorker*> GetHandlers(bool* span_data_needed,
+                                          bool* span_batch_needed) const
+      LOCKS_EXCLUDED(handler_mu_);
+
+  // Converts 'spans' to the representations the registered handlers use, and
+  // posts them to the worker of each handler. Releases the spans.
+  void Export(absl::Span<std::shared_ptr<opencensus::trace::SpanImpl>> spans);
+
+  // Only for testing purposes: converts the queued spans on the current thread
+  // and returns when all handlers have exported them.
   void ExportForTesting();
 
-  // Returns true if the spans_ buffer has filled up.
-  bool IsBufferFull() const;
+  absl::Duration flush_interval() const LOCKS_EXCLUDED(handler_mu_);
+
+  // The common::Scheduler fork handler. The child discards the spans queued
+  // and held for tail sampling by the parent, whose threads may have been
+  // adding to the queue mid-fork.
+  void PrepareFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ParentAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void ChildAfterFork() NO_THREAD_SAFETY_ANALYSIS;
+  void RestartAfterFork() LOCKS_EXCLUDED(handler_mu_);
 
-  static SpanExporterImpl* span_exporter_;
-  const uint32_t buffer_size_;
-  const absl::Duration interval_;
-  mutable absl::Mutex span_mu_;
   mutable absl::Mutex handler_mu_;
-  std::vector<std::shared_ptr<opencensus::trace::SpanImpl>> spans_
-      GUARDED_BY(span_mu_);
-  std::vector<std::unique_ptr<SpanExporter::Handler>> handlers_
-      GUARDED_BY(handler_mu_);
-  bool thread_started_ GUARDED_BY(handler_mu_) = false;
-  // Don't collect spans until an exporter has been registered.
-  bool collect_spans_ GUARDED_BY(span_mu_) = false;
-  std::thread t_ GUARDED_BY(handler_mu_);
+  std::vector<std::unique_ptr<HandlerWorker>> handlers_ GUARDED_BY(handler_mu_);
+  SpanExporter::Options options_ GUARDED_BY(handler_mu_);
+  bool task_started_ GUARDED_BY(handler_mu_) = false;
+
+  // Don't collect spans until an exporter has been registered: the queue is
+  // created and published when the export task starts, and never deleted.
+  std::atomic<SpanQueue*> queue_{nullptr};
+  // Fixed when queue_ is published, and only read after loading it.
+  bool drop_oldest_ = false;
+  absl::Duration slow_span_threshold_ = absl::InfiniteDuration();
+  absl::flat_hash_map<std::string, absl::Duration> slow_span_thresholds_;
+  uint64_t export_task_ = 0;
+  // Fixed when queue_ is published; null unless tail sampling is enabled.
+  // Exports pass spans through it one at a time, holding tail_mu_.
+  absl::Mutex tail_mu_;
+  std::unique_ptr<SpanTailSampler> tail_sampler_ PT_GUARDED_BY(tail_mu_);
+  // A copy of options_.batch_size, read on every AddSpan().
+  std::atomic<size_t> batch_size_{SpanExporter::Options().batch_size};
+  std::atomic<bool> group_by_trace_{false};
+  // Copies of the backlog feedback options, and the current halvings.
+  std::atomic<size_t> backlog_high_water_{0};
+  std::atomic<int> backlog_max_halvings_{0};
+  std::atomic<int> backlog_halvings_{0};
+  std::atomic<uint64_t> dropped_spans_{0};
+  // The spans dropped from the buffer, by priority, with priority lanes.
+  std::atomic<uint64_t> dropped_spans_by_priority_[kNumSpanPriorities] = {};
+  // The value of dropped_spans_ last reported as a self-metric.
+  std::atomic<uint64_t> reported_dropped_spans_{0};
+  // Set by AddSpan() when a full batch is queued, so that only one producer
+  // wakes the export task per batch.
+  std::atomic<bool> batch_ready_{false};
 };
 
 }  // namespace exporter
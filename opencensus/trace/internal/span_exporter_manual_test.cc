@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/exporter/span_exporter.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/common/internal/scheduler.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+
+// Manual mode must be set before the library schedules any task, so these
+// tests are separate from span_exporter_test.
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+// CountingExporter counts exported spans, and keeps the thread they were
+// exported on.
+class CountingExporter : public exporter::SpanExporter::Handler {
+ public:
+  static CountingExporter* Register() {
+    auto handler = absl::make_unique<CountingExporter>();
+    CountingExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  int num_exported() const {
+    absl::MutexLock l(&mu_);
+    return num_exported_;
+  }
+
+  std::thread::id export_thread() const {
+    absl::MutexLock l(&mu_);
+    return export_thread_;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    export_thread_ = std::this_thread::get_id();
+    num_exported_ += spans.size();
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  int num_exported_ GUARDED_BY(mu_) = 0;
+  std::thread::id export_thread_ GUARDED_BY(mu_);
+};
+
+TEST(SpanExporterManualTest, ExportsOnCallingThread) {
+  common::Scheduler::Get()->SetManualMode();
+  exporter::SpanExporter::Options options;
+  options.flush_interval = absl::Milliseconds(10);
+  exporter::SpanExporter::SetOptions(options);
+  CountingExporter* exporter = CountingExporter::Register();
+  AlwaysSampler sampler;
+  StartSpanOptions opts = {&sampler};
+  for (int i = 0; i < 3; ++i) {
+    Span::StartSpan("Span", nullptr, opts).End();
+  }
+
+  // Nothing is exported until the application runs the tasks.
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_EQ(0, exporter->num_exported());
+  const absl::Time give_up = absl::Now() + absl::Seconds(10);
+  while (exporter->num_exported() < 3 && absl::Now() < give_up) {
+    const absl::Time next_run = common::Scheduler::Get()->RunDueTasks();
+    absl::SleepFor(std::min(absl::Milliseconds(10), next_run - absl::Now()));
+  }
+  EXPECT_EQ(3, exporter->num_exported());
+  EXPECT_EQ(std::this_thread::get_id(), exporter->export_thread());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
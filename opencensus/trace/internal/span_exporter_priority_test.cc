@@ -0,0 +1,128 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/exporter/span_exporter.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/span_priority.h"
+#include "opencensus/trace/status_code.h"
+
+// Priority lanes are fixed when the first handler is registered, so these
+// tests are separate from span_exporter_test.
+
+namespace opencensus {
+namespace trace {
+namespace exporter {
+
+class SpanExporterTestPeer {
+ public:
+  static void ExportForTesting() { SpanExporter::ExportForTesting(); }
+};
+
+}  // namespace exporter
+
+namespace {
+
+// NameExporter records the names of exported spans, in order.
+class NameExporter : public exporter::SpanExporter::Handler {
+ public:
+  static NameExporter* Register() {
+    auto handler = absl::make_unique<NameExporter>();
+    NameExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<std::string> TakeNames() {
+    absl::MutexLock l(&mu_);
+    std::vector<std::string> names;
+    names.swap(names_);
+    return names;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    for (const auto& span : spans) {
+      names_.push_back(std::string(span.name()));
+    }
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::string> names_ GUARDED_BY(mu_);
+};
+
+constexpr int kBufferCapacity = 8;
+
+TEST(SpanExporterPriorityTest, DropsLowPrioritySpansFirst) {
+  exporter::SpanExporter::Options options;
+  options.buffer_capacity = kBufferCapacity;
+  // Only export when forced by the test.
+  options.flush_interval = absl::Hours(1);
+  options.priority_lanes = true;
+  options.slow_span_thresholds["Slow"] = absl::ZeroDuration();
+  exporter::SpanExporter::SetOptions(options);
+  NameExporter* exporter = NameExporter::Register();
+
+  AlwaysSampler sampler;
+  const StartSpanOptions low(&sampler, {}, false, false, false, false,
+                             SpanPriority::kLow);
+  const StartSpanOptions normal(&sampler);
+  const StartSpanOptions high(&sampler, {}, false, false, false, false,
+                              SpanPriority::kHigh);
+  for (int i = 0; i < kBufferCapacity; ++i) {
+    Span::StartSpan("Low", nullptr, low).End();
+  }
+  // Error, slow and explicitly high priority spans make room by dropping low
+  // priority ones, even when started as low priority.
+  auto error = Span::StartSpan("Error", nullptr, low);
+  error.SetStatus(StatusCode::UNAVAILABLE);
+  error.End();
+  Span::StartSpan("Slow", nullptr, normal).End();
+  Span::StartSpan("High", nullptr, high).End();
+  EXPECT_EQ(3u, exporter::SpanExporter::NumDroppedSpans(SpanPriority::kLow));
+  // A normal priority span also drops a low priority one.
+  Span::StartSpan("Normal", nullptr, normal).End();
+  EXPECT_EQ(4u, exporter::SpanExporter::NumDroppedSpans(SpanPriority::kLow));
+  EXPECT_EQ(0u, exporter::SpanExporter::NumDroppedSpans(SpanPriority::kNormal));
+  EXPECT_EQ(0u, exporter::SpanExporter::NumDroppedSpans(SpanPriority::kHigh));
+
+  // Once only higher priority spans are left, a low priority span is dropped
+  // itself.
+  for (int i = 0; i < 4; ++i) {
+    Span::StartSpan("High", nullptr, high).End();
+  }
+  Span::StartSpan("Low", nullptr, low).End();
+  EXPECT_EQ(9u, exporter::SpanExporter::NumDroppedSpans(SpanPriority::kLow));
+  EXPECT_EQ(9u, exporter::SpanExporter::NumDroppedSpans());
+
+  // Higher priorities are exported first.
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(std::vector<std::string>({"Error", "Slow", "High", "High", "High",
+                                      "High", "High", "Normal"}),
+            exporter->TakeNames());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
@@ -0,0 +1,97 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/exporter/span_exporter.h"
+
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+
+// Shutdown() is permanent, so these tests are separate from
+// span_exporter_test.
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+// GatedExporter counts exported spans, blocking in Export() while its gate is
+// closed.
+class GatedExporter : public exporter::SpanExporter::Handler {
+ public:
+  static GatedExporter* Register() {
+    auto handler = absl::make_unique<GatedExporter>();
+    GatedExporter* gated = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return gated;
+  }
+
+  void SetOpen(bool open) {
+    absl::MutexLock l(&mu_);
+    open_ = open;
+  }
+
+  int num_exported() const {
+    absl::MutexLock l(&mu_);
+    return num_exported_;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    mu_.Await(absl::Condition(&open_));
+    num_exported_ += spans.size();
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  bool open_ GUARDED_BY(mu_) = true;
+  int num_exported_ GUARDED_BY(mu_) = 0;
+};
+
+TEST(SpanExporterShutdownTest, ExportsQueuedSpans) {
+  exporter::SpanExporter::Options options;
+  // Only export on shutdown.
+  options.flush_interval = absl::Hours(1);
+  exporter::SpanExporter::SetOptions(options);
+  GatedExporter* exporter = GatedExporter::Register();
+  AlwaysSampler sampler;
+  StartSpanOptions opts = {&sampler};
+  for (int i = 0; i < 3; ++i) {
+    Span::StartSpan("Span", nullptr, opts).End();
+  }
+
+  // A blocked handler makes Shutdown() give up at the deadline.
+  exporter->SetOpen(false);
+  EXPECT_FALSE(exporter::SpanExporter::Shutdown(absl::Now() +
+                                                absl::Milliseconds(50)));
+  EXPECT_EQ(0, exporter->num_exported());
+  exporter->SetOpen(true);
+  EXPECT_TRUE(exporter::SpanExporter::Shutdown(absl::InfiniteFuture()));
+  EXPECT_EQ(3, exporter->num_exported());
+
+  // Spans ended after shutdown are not exported.
+  Span::StartSpan("Span", nullptr, opts).End();
+  EXPECT_TRUE(exporter::SpanExporter::Shutdown(absl::InfiniteFuture()));
+  EXPECT_EQ(3, exporter->num_exported());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
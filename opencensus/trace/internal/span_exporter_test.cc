@@ -14,16 +14,46 @@
 
 #include "opencensus/trace/exporter/span_exporter.h"
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "gtest/gtest.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/link.h"
+#include "opencensus/trace/exporter/message_event.h"
 #include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/status.h"
+#include "opencensus/trace/internal/trace_config_impl.h"
 #include "opencensus/trace/sampler.h"
 #include "opencensus/trace/span.h"
+#include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_config.h"
+#include "opencensus/trace/trace_id.h"
 
 namespace opencensus {
 namespace trace {
+namespace exporter {
+
+class SpanExporterTestPeer {
+ public:
+  static void ExportForTesting() { SpanExporter::ExportForTesting(); }
+};
+
+}  // namespace exporter
+
 namespace {
 
 class Counter {
@@ -60,14 +90,202 @@ class MyExporter : public exporter::SpanExporter::Handler {
   }
 };
 
+// TraceIdExporter records the trace IDs of exported spans, in order.
+class TraceIdExporter : public exporter::SpanExporter::Handler {
+ public:
+  static TraceIdExporter* Register() {
+    auto handler = absl::make_unique<TraceIdExporter>();
+    TraceIdExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<TraceId> TakeTraceIds() {
+    absl::MutexLock l(&mu_);
+    std::vector<TraceId> trace_ids;
+    trace_ids.swap(trace_ids_);
+    return trace_ids;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    for (const auto& span : spans) {
+      trace_ids_.push_back(span.context().trace_id());
+    }
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<TraceId> trace_ids_ GUARDED_BY(mu_);
+};
+
+// GatedExporter blocks in Export() while its gate is closed.
+class GatedExporter : public exporter::SpanExporter::Handler {
+ public:
+  static GatedExporter* Register() {
+    auto handler = absl::make_unique<GatedExporter>();
+    GatedExporter* gated = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return gated;
+  }
+
+  void SetOpen(bool open) {
+    absl::MutexLock l(&mu_);
+    open_ = open;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    mu_.Await(absl::Condition(&open_));
+  }
+
+ private:
+  absl::Mutex mu_;
+  bool open_ GUARDED_BY(mu_) = true;
+};
+
+// BatchExporter retains the batches it is passed, as an asynchronous handler
+// would.
+class BatchExporter : public exporter::SpanExporter::Handler {
+ public:
+  static BatchExporter* Register() {
+    auto handler = absl::make_unique<BatchExporter>();
+    BatchExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<std::shared_ptr<const std::vector<exporter::SpanData>>>
+  TakeBatches() {
+    absl::MutexLock l(&mu_);
+    std::vector<std::shared_ptr<const std::vector<exporter::SpanData>>>
+        batches;
+    batches.swap(batches_);
+    return batches;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    ADD_FAILURE() << "Export() called instead of ExportBatch().";
+  }
+
+  void ExportBatch(
+      std::shared_ptr<const std::vector<exporter::SpanData>> spans) override {
+    absl::MutexLock l(&mu_);
+    batches_.push_back(std::move(spans));
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::shared_ptr<const std::vector<exporter::SpanData>>> batches_
+      GUARDED_BY(mu_);
+};
+
+// SpanBatchExporter records the name and attributes of the first span of the
+// SpanBatches it is passed.
+class SpanBatchExporter : public exporter::SpanExporter::Handler {
+ public:
+  static SpanBatchExporter* Register() {
+    auto handler = absl::make_unique<SpanBatchExporter>();
+    SpanBatchExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<std::string> TakeNames() {
+    absl::MutexLock l(&mu_);
+    std::vector<std::string> names;
+    names.swap(names_);
+    return names;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    ADD_FAILURE() << "Export() called instead of ExportSpanBatch().";
+  }
+
+  bool ExportsSpanBatches() const override { return true; }
+
+  void ExportSpanBatch(
+      std::shared_ptr<const exporter::SpanBatch> batch) override {
+    absl::MutexLock l(&mu_);
+    for (const auto& span : batch->spans()) {
+      std::string name(span.name());
+      for (const auto& attribute : span.attributes()) {
+        name.append(" ").append(std::string(attribute.key()));
+      }
+      names_.push_back(name);
+    }
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<std::string> names_ GUARDED_BY(mu_);
+};
+
+// ChunkExporter keeps the chunks of running spans it is passed.
+class ChunkExporter : public exporter::SpanExporter::Handler {
+ public:
+  static ChunkExporter* Register() {
+    auto handler = absl::make_unique<ChunkExporter>();
+    ChunkExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<exporter::SpanData> TakeChunks() {
+    absl::MutexLock l(&mu_);
+    std::vector<exporter::SpanData> chunks;
+    chunks.swap(chunks_);
+    return chunks;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {}
+
+  bool ExportsSpanChunks() const override { return true; }
+
+  void ExportSpanChunks(
+      const std::vector<exporter::SpanData>& chunks) override {
+    absl::MutexLock l(&mu_);
+    chunks_.insert(chunks_.end(), chunks.begin(), chunks.end());
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<exporter::SpanData> chunks_ GUARDED_BY(mu_);
+};
+
 class SpanExporterTest : public ::testing::Test {
  protected:
   static void SetUpTestCase() {
+    exporter::SpanExporter::Options options;
+    options.buffer_capacity = kBufferCapacity;
+    // Only export when forced by the test.
+    options.flush_interval = absl::Hours(1);
+    exporter::SpanExporter::SetOptions(options);
     // Only register once.
     MyExporter::Register();
+    gated_exporter_ = GatedExporter::Register();
+    trace_id_exporter_ = TraceIdExporter::Register();
+    batch_exporter_ = BatchExporter::Register();
+    span_batch_exporter_ = SpanBatchExporter::Register();
+    chunk_exporter_ = ChunkExporter::Register();
   }
+
+  static GatedExporter* gated_exporter_;
+  static TraceIdExporter* trace_id_exporter_;
+  static BatchExporter* batch_exporter_;
+  static SpanBatchExporter* span_batch_exporter_;
+  static ChunkExporter* chunk_exporter_;
+
+  static constexpr int kBufferCapacity = 8;
 };
 
+constexpr int SpanExporterTest::kBufferCapacity;
+GatedExporter* SpanExporterTest::gated_exporter_ = nullptr;
+TraceIdExporter* SpanExporterTest::trace_id_exporter_ = nullptr;
+BatchExporter* SpanExporterTest::batch_exporter_ = nullptr;
+SpanBatchExporter* SpanExporterTest::span_batch_exporter_ = nullptr;
+ChunkExporter* SpanExporterTest::chunk_exporter_ = nullptr;
+
 TEST_F(SpanExporterTest, BasicExportTest) {
   ::opencensus::trace::AlwaysSampler sampler;
   ::opencensus::trace::StartSpanOptions opts = {&sampler};
@@ -81,13 +299,253 @@ TEST_F(SpanExporterTest, BasicExportTest) {
   span2.End();
   span1.End();
 
-  for (int i = 0; i < 10; ++i) {
-    if (Counter::Get()->value() >= 3) break;
-    absl::SleepFor(absl::Seconds(1));
-  }
+  exporter::SpanExporterTestPeer::ExportForTesting();
   EXPECT_EQ(3, Counter::Get()->value());
 }
 
+TEST_F(SpanExporterTest, DropsNewestSpansWhenFull) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  const int initial_count = Counter::Get()->value();
+  const uint64_t initial_dropped = exporter::SpanExporter::NumDroppedSpans();
+  for (int i = 0; i < kBufferCapacity + 2; ++i) {
+    ::opencensus::trace::Span::StartSpan("Span", nullptr, opts).End();
+  }
+  EXPECT_EQ(initial_dropped + 2, exporter::SpanExporter::NumDroppedSpans());
+
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(initial_count + kBufferCapacity, Counter::Get()->value());
+}
+
+TEST_F(SpanExporterTest, BlockedHandlerDoesNotDelayOthers) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  const int initial_count = Counter::Get()->value();
+  gated_exporter_->SetOpen(false);
+  ::opencensus::trace::Span::StartSpan("Span", nullptr, opts).End();
+  // ExportForTesting() returns once both handlers have exported.
+  std::thread export_thread(&exporter::SpanExporterTestPeer::ExportForTesting);
+  for (int i = 0; i < 100; ++i) {
+    if (Counter::Get()->value() > initial_count) break;
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(initial_count + 1, Counter::Get()->value());
+  gated_exporter_->SetOpen(true);
+  export_thread.join();
+}
+
+TEST_F(SpanExporterTest, GroupsByTrace) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  trace_id_exporter_->TakeTraceIds();
+  exporter::SpanExporter::Options options;
+  options.flush_interval = absl::Hours(1);
+  options.group_by_trace = true;
+  exporter::SpanExporter::SetOptions(options);
+
+  // End the spans of two traces interleaved.
+  auto root1 = ::opencensus::trace::Span::StartSpan("Root1", nullptr, opts);
+  auto root2 = ::opencensus::trace::Span::StartSpan("Root2", nullptr, opts);
+  for (int i = 0; i < 2; ++i) {
+    ::opencensus::trace::Span::StartSpan("Child", &root1, opts).End();
+    ::opencensus::trace::Span::StartSpan("Child", &root2, opts).End();
+  }
+  root1.End();
+  root2.End();
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  const std::vector<TraceId> trace_ids = trace_id_exporter_->TakeTraceIds();
+  ASSERT_EQ(6, trace_ids.size());
+  // Each trace's spans are adjacent.
+  EXPECT_TRUE(trace_ids[0] == trace_ids[1]);
+  EXPECT_TRUE(trace_ids[0] == trace_ids[2]);
+  EXPECT_FALSE(trace_ids[2] == trace_ids[3]);
+  EXPECT_TRUE(trace_ids[3] == trace_ids[4]);
+  EXPECT_TRUE(trace_ids[3] == trace_ids[5]);
+
+  options.group_by_trace = false;
+  exporter::SpanExporter::SetOptions(options);
+}
+
+TEST_F(SpanExporterTest, BacklogThrottlesSampling) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  exporter::SpanExporter::Options options;
+  options.flush_interval = absl::Hours(1);
+  options.backlog_high_water = 4;
+  options.backlog_max_halvings = 2;
+  exporter::SpanExporter::SetOptions(options);
+  auto end_spans = [&opts](int n) {
+    for (int i = 0; i < n; ++i) {
+      ::opencensus::trace::Span::StartSpan("Span", nullptr, opts).End();
+    }
+  };
+
+  // Each export over the high-water mark halves once more, up to the maximum.
+  for (int expected : {1, 2, 2}) {
+    end_spans(5);
+    exporter::SpanExporterTestPeer::ExportForTesting();
+    EXPECT_EQ(expected, TraceConfigImpl::Get()->sampling_halvings());
+  }
+  // Between half and the high-water mark, the halvings are kept.
+  end_spans(3);
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(2, TraceConfigImpl::Get()->sampling_halvings());
+  // Each export at or below half recovers one.
+  end_spans(2);
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(1, TraceConfigImpl::Get()->sampling_halvings());
+  // They add to the sampling reduction.
+  TraceConfig::SetSamplingReduction(3);
+  EXPECT_EQ(4, TraceConfigImpl::Get()->sampling_halvings());
+  TraceConfig::SetSamplingReduction(0);
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(0, TraceConfigImpl::Get()->sampling_halvings());
+
+  // Disabling the feedback restores the sampler.
+  end_spans(5);
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(1, TraceConfigImpl::Get()->sampling_halvings());
+  options.backlog_high_water = 0;
+  exporter::SpanExporter::SetOptions(options);
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(0, TraceConfigImpl::Get()->sampling_halvings());
+}
+
+TEST_F(SpanExporterTest, HandlersRetainBatches) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  batch_exporter_->TakeBatches();
+
+  ::opencensus::trace::Span::StartSpan("Retained", nullptr, opts).End();
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  const auto batches = batch_exporter_->TakeBatches();
+  ASSERT_EQ(1, batches.size());
+  ASSERT_EQ(1, batches[0]->size());
+  EXPECT_EQ("Retained", (*batches[0])[0].name());
+}
+
+TEST_F(SpanExporterTest, ExportsSpanBatches) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  span_batch_exporter_->TakeNames();
+  const int initial_count = Counter::Get()->value();
+
+  auto span = ::opencensus::trace::Span::StartSpan("Batched", nullptr, opts);
+  span.AddAttribute("key", "value");
+  span.End();
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(std::vector<std::string>{"Batched key"},
+            span_batch_exporter_->TakeNames());
+  // Handlers exporting SpanData receive the span too.
+  EXPECT_EQ(initial_count + 1, Counter::Get()->value());
+}
+
+TEST_F(SpanExporterTest, ExportsSpanData) {
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  batch_exporter_->TakeBatches();
+  span_batch_exporter_->TakeNames();
+
+  std::vector<exporter::SpanData> spans;
+  for (const char* name : {"Forwarded1", "Forwarded2"}) {
+    spans.emplace_back(
+        name, SpanContext(), SpanId(),
+        exporter::SpanData::TimeEvents<exporter::Annotation>({}, 0),
+        exporter::SpanData::TimeEvents<exporter::MessageEvent>({}, 0),
+        std::vector<exporter::Link>(), 0,
+        std::unordered_map<std::string, exporter::AttributeValue>(
+            {{"key", exporter::AttributeValue("value")}}),
+        0, true, absl::UnixEpoch(), absl::UnixEpoch(), exporter::Status(),
+        false);
+  }
+  exporter::SpanExporter::ExportSpans(std::move(spans));
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  const auto batches = batch_exporter_->TakeBatches();
+  ASSERT_EQ(1, batches.size());
+  ASSERT_EQ(2, batches[0]->size());
+  EXPECT_EQ("Forwarded2", (*batches[0])[1].name());
+  EXPECT_EQ((std::vector<std::string>{"Forwarded1 key", "Forwarded2 key"}),
+            span_batch_exporter_->TakeNames());
+}
+
+TEST_F(SpanExporterTest, ExportsChunksOfRunningSpans) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  batch_exporter_->TakeBatches();
+  exporter::SpanExporter::Options options;
+  options.flush_interval = absl::Hours(1);
+  options.running_span_flush_interval = absl::Milliseconds(1);
+  exporter::SpanExporter::SetOptions(options);
+
+  auto span = ::opencensus::trace::Span::StartSpan("Running", nullptr, opts);
+  span.AddAnnotation("first");
+  span.AddAnnotation("second");
+  absl::SleepFor(absl::Milliseconds(2));
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  std::vector<exporter::SpanData> chunks = chunk_exporter_->TakeChunks();
+  ASSERT_EQ(1, chunks.size());
+  EXPECT_EQ("Running", chunks[0].name());
+  EXPECT_FALSE(chunks[0].has_ended());
+  ASSERT_EQ(2, chunks[0].annotations().events().size());
+  EXPECT_EQ("second",
+            chunks[0].annotations().events()[1].event().description());
+  EXPECT_EQ(0, chunks[0].annotations().dropped_events_count());
+  // Other handlers only see spans once they end.
+  EXPECT_TRUE(batch_exporter_->TakeBatches().empty());
+
+  // A span without new events has no chunk.
+  absl::SleepFor(absl::Milliseconds(2));
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_TRUE(chunk_exporter_->TakeChunks().empty());
+
+  // The ended span holds the events recorded after its last chunk.
+  span.AddAnnotation("third");
+  span.End();
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_TRUE(chunk_exporter_->TakeChunks().empty());
+  const auto batches = batch_exporter_->TakeBatches();
+  ASSERT_EQ(1, batches.size());
+  ASSERT_EQ(1, batches[0]->size());
+  const exporter::SpanData& ended = (*batches[0])[0];
+  EXPECT_TRUE(ended.has_ended());
+  ASSERT_EQ(1, ended.annotations().events().size());
+  EXPECT_EQ("third", ended.annotations().events()[0].event().description());
+  EXPECT_EQ(0, ended.annotations().dropped_events_count());
+
+  options.running_span_flush_interval = absl::InfiniteDuration();
+  exporter::SpanExporter::SetOptions(options);
+}
+
+#if !defined(_WIN32)
+TEST_F(SpanExporterTest, ExportsInForkedChild) {
+  ::opencensus::trace::AlwaysSampler sampler;
+  ::opencensus::trace::StartSpanOptions opts = {&sampler};
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  const int initial_count = Counter::Get()->value();
+  // Queued in the parent, and only exported there.
+  ::opencensus::trace::Span::StartSpan("Parent", nullptr, opts).End();
+
+  const pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    // The handlers' threads are restarted when the span ends.
+    ::opencensus::trace::Span::StartSpan("Child", nullptr, opts).End();
+    exporter::SpanExporterTestPeer::ExportForTesting();
+    _exit(Counter::Get()->value() == initial_count + 1 ? 0 : 1);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  exporter::SpanExporterTestPeer::ExportForTesting();
+  EXPECT_EQ(initial_count + 1, Counter::Get()->value());
+}
+#endif
+
 }  // namespace
 }  // namespace trace
 }  // namespace opencensus
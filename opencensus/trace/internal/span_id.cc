@@ -17,32 +17,33 @@
 #include <cstring>
 #include <string>
 
-#include "absl/strings/escaping.h"
-#include "absl/strings/string_view.h"
+#include "opencensus/trace/internal/hex.h"
 
 namespace opencensus {
 namespace trace {
 
-SpanId::SpanId(const uint8_t *buf) { memcpy(rep_, buf, kSize); }
+constexpr size_t SpanId::kSize;
+constexpr size_t SpanId::kHexSize;
 
-std::string SpanId::ToHex() const {
-  return absl::BytesToHexString(
-      absl::string_view(reinterpret_cast<const char *>(rep_), kSize));
+SpanId::SpanId(const uint8_t *buf) {
+  static_assert(kSize == sizeof(uint64_t),
+                "Internal representation must be 8 bytes.");
+  memcpy(&rep_, buf, kSize);
 }
 
-bool SpanId::operator==(const SpanId &that) const {
-  return memcmp(rep_, that.rep_, kSize) == 0;
+std::string SpanId::ToHex() const {
+  std::string hex(kHexSize, '\0');
+  ToHex(&hex[0]);
+  return hex;
 }
 
-bool SpanId::IsValid() const {
-  static_assert(kSize == 8,
-                "IsValid assumes the internal representation is 8 bytes.");
-  uint64_t tmp;
-  memcpy(&tmp, rep_, kSize);
-  return tmp != 0;
+void SpanId::ToHex(char *out) const {
+  uint8_t bytes[kSize];
+  CopyTo(bytes);
+  EncodeHex(bytes, kSize, out);
 }
 
-void SpanId::CopyTo(uint8_t *buf) const { memcpy(buf, rep_, kSize); }
+void SpanId::CopyTo(uint8_t *buf) const { memcpy(buf, &rep_, kSize); }
 
 }  // namespace trace
 }  // namespace opencensus
@@ -12,14 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "benchmark/benchmark.h"
+#include "opencensus/common/internal/random.h"
 #include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_id.h"
 
 namespace opencensus {
 namespace trace {
 namespace {
 
 constexpr uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+constexpr uint8_t trace_id[] = {1, 2,  3,  4,  5,  6,  7,  8,
+                                9, 10, 11, 12, 13, 14, 15, 16};
 
 void BM_SpanIdDefaultConstructor(benchmark::State& state) {
   while (state.KeepRunning()) {
@@ -43,6 +51,25 @@ void BM_SpanIdToHex(benchmark::State& state) {
 }
 BENCHMARK(BM_SpanIdToHex);
 
+void BM_SpanIdToHexBuffer(benchmark::State& state) {
+  char buf[SpanId::kHexSize];
+  SpanId id(span_id);
+  while (state.KeepRunning()) {
+    id.ToHex(buf);
+    benchmark::DoNotOptimize(buf);
+  }
+}
+BENCHMARK(BM_SpanIdToHexBuffer);
+
+void BM_SpanIdHash(benchmark::State& state) {
+  const absl::Hash<SpanId> hash;
+  SpanId id(span_id);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(hash(id));
+  }
+}
+BENCHMARK(BM_SpanIdHash);
+
 void BM_SpanIdCompareEqual(benchmark::State& state) {
   bool b;
   SpanId id1(span_id);
@@ -79,6 +106,69 @@ void BM_SpanIdCopyTo(benchmark::State& state) {
 }
 BENCHMARK(BM_SpanIdCopyTo);
 
+// Generates a SpanId as span creation does, from multiple threads.
+void BM_SpanIdGenerateRandom(benchmark::State& state) {
+  uint8_t buf[SpanId::kSize];
+  while (state.KeepRunning()) {
+    ::opencensus::common::Random::GetRandom()->GenerateRandomBuffer(
+        buf, SpanId::kSize);
+    benchmark::DoNotOptimize(SpanId(buf));
+  }
+}
+BENCHMARK(BM_SpanIdGenerateRandom)->ThreadRange(1, 16);
+
+void BM_TraceIdToHexBuffer(benchmark::State& state) {
+  char buf[TraceId::kHexSize];
+  TraceId id(trace_id);
+  while (state.KeepRunning()) {
+    id.ToHex(buf);
+    benchmark::DoNotOptimize(buf);
+  }
+}
+BENCHMARK(BM_TraceIdToHexBuffer);
+
+void BM_TraceIdCompareEqual(benchmark::State& state) {
+  TraceId id1(trace_id);
+  TraceId id2(trace_id);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(id1 == id2);
+  }
+}
+BENCHMARK(BM_TraceIdCompareEqual);
+
+void BM_TraceIdIsValid(benchmark::State& state) {
+  TraceId id(trace_id);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(id.IsValid());
+  }
+}
+BENCHMARK(BM_TraceIdIsValid);
+
+void BM_TraceIdHash(benchmark::State& state) {
+  const absl::Hash<TraceId> hash;
+  TraceId id(trace_id);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(hash(id));
+  }
+}
+BENCHMARK(BM_TraceIdHash);
+
+// Looks up a trace in a set, as the tail sampler does for each span.
+void BM_TraceIdSetLookup(benchmark::State& state) {
+  absl::flat_hash_set<TraceId> ids;
+  uint8_t buf[TraceId::kSize];
+  for (int i = 0; i < state.range(0); ++i) {
+    ::opencensus::common::Random::GetRandom()->GenerateRandomBuffer(
+        buf, TraceId::kSize);
+    ids.insert(TraceId(buf));
+  }
+  TraceId id(trace_id);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(ids.count(id));
+  }
+}
+BENCHMARK(BM_TraceIdSetLookup)->Range(16, 4096);
+
 }  // namespace
 }  // namespace trace
 }  // namespace opencensus
@@ -14,13 +14,26 @@
 
 #include "opencensus/trace/span_id.h"
 
+#include <cstring>
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "gtest/gtest.h"
+#include "opencensus/trace/trace_id.h"
 
 namespace opencensus {
 namespace trace {
 namespace {
 
 constexpr uint8_t span_id[] = {1, 2, 3, 4, 5, 6, 7, 8};
+constexpr uint8_t trace_id[] = {1, 2,  3,  4,  5,  6,  7,  8,
+                                9, 10, 11, 12, 13, 14, 15, 16};
+
+static_assert(!SpanId().IsValid() && SpanId() == SpanId(),
+              "Invalid SpanIds compare at compile time.");
+static_assert(!TraceId().IsValid() && TraceId() == TraceId(),
+              "Invalid TraceIds compare at compile time.");
 
 TEST(SpanIdTest, Equality) {
   SpanId id1;
@@ -42,6 +55,49 @@ TEST(SpanIdTest, IsValid) {
 TEST(SpanIdTest, ToHex) {
   SpanId id(span_id);
   EXPECT_EQ("0102030405060708", id.ToHex());
+  std::string hex(SpanId::kHexSize, '\0');
+  id.ToHex(&hex[0]);
+  EXPECT_EQ("0102030405060708", hex);
+}
+
+TEST(SpanIdTest, CopyTo) {
+  uint8_t buf[SpanId::kSize];
+  SpanId(span_id).CopyTo(buf);
+  EXPECT_EQ(0, memcmp(span_id, buf, SpanId::kSize));
+}
+
+TEST(SpanIdTest, Hash) {
+  const uint8_t other[] = {8, 7, 6, 5, 4, 3, 2, 1};
+  const absl::Hash<SpanId> hash;
+  EXPECT_EQ(hash(SpanId(span_id)), hash(SpanId(span_id)));
+  EXPECT_NE(hash(SpanId(span_id)), hash(SpanId(other)));
+  absl::flat_hash_set<SpanId> ids = {SpanId(span_id), SpanId(other)};
+  EXPECT_EQ(1, ids.count(SpanId(span_id)));
+  EXPECT_EQ(0, ids.count(SpanId()));
+}
+
+TEST(TraceIdTest, EqualityAndHex) {
+  const TraceId id(trace_id);
+  EXPECT_TRUE(id.IsValid());
+  EXPECT_TRUE(id == TraceId(trace_id));
+  EXPECT_TRUE(id != TraceId());
+  EXPECT_EQ("0102030405060708090a0b0c0d0e0f10", id.ToHex());
+  uint8_t buf[TraceId::kSize];
+  id.CopyTo(buf);
+  EXPECT_EQ(0, memcmp(trace_id, buf, TraceId::kSize));
+}
+
+TEST(TraceIdTest, Hash) {
+  uint8_t low_only[TraceId::kSize] = {0};
+  low_only[15] = 1;
+  uint8_t high_only[TraceId::kSize] = {0};
+  high_only[0] = 1;
+  const absl::Hash<TraceId> hash;
+  EXPECT_EQ(hash(TraceId(trace_id)), hash(TraceId(trace_id)));
+  EXPECT_NE(hash(TraceId(low_only)), hash(TraceId(high_only)));
+  absl::flat_hash_set<TraceId> ids = {TraceId(low_only), TraceId(high_only)};
+  EXPECT_EQ(2, ids.size());
+  EXPECT_EQ(1, ids.count(TraceId(high_only)));
 }
 
 }  // namespace
@@ -14,46 +14,118 @@
 
 #include "opencensus/trace/internal/span_impl.h"
 
-#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include "absl/time/clock.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "opencensus/common/internal/clock.h"
 #include "opencensus/trace/attribute_value_ref.h"
 #include "opencensus/trace/exporter/attribute_value.h"
 #include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/internal/byte_budget.h"
 #include "opencensus/trace/internal/local_span_store_impl.h"
+#include "opencensus/trace/internal/resource_usage.h"
 #include "opencensus/trace/internal/running_span_store_impl.h"
 #include "opencensus/trace/internal/span_exporter_impl.h"
+#include "opencensus/trace/internal/span_name.h"
+#include "opencensus/trace/internal/trace_events.h"
 #include "opencensus/trace/span.h"
 
 namespace opencensus {
 namespace trace {
 
 namespace {
-template <typename T>
-std::vector<T> CopyTraceEvents(const std::deque<T>& events) {
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+std::vector<T> CopyTraceEvents(
+    const TraceEvents<T, kInlineEvents, kMaxEvents>& events) {
   std::vector<T> trace_events;
   trace_events.reserve(events.size());
-  for (const auto& event : events) {
-    trace_events.emplace_back(event);
+  for (size_t i = 0; i < events.size(); ++i) {
+    trace_events.emplace_back(events[i]);
   }
   return trace_events;
 }
 
-template <typename T>
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
 std::vector<exporter::SpanData::TimeEvent<T>> CopyEventWithTime(
-    const std::deque<EventWithTime<T>>& events) {
+    const TraceEvents<EventWithTime<T>, kInlineEvents, kMaxEvents>& events) {
   std::vector<exporter::SpanData::TimeEvent<T>> time_events;
   time_events.reserve(events.size());
-  for (const auto& event : events) {
-    auto tmp_event = event.event;
-    time_events.emplace_back(event.time, std::move(tmp_event));
+  for (size_t i = 0; i < events.size(); ++i) {
+    auto tmp_event = events[i].event;
+    time_events.emplace_back(events[i].time, std::move(tmp_event));
   }
   return time_events;
 }
 
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+std::vector<T> MoveTraceEvents(
+    TraceEvents<T, kInlineEvents, kMaxEvents>* events) {
+  std::vector<T> trace_events;
+  trace_events.reserve(events->size());
+  for (size_t i = 0; i < events->size(); ++i) {
+    trace_events.emplace_back(std::move((*events)[i]));
+  }
+  return trace_events;
+}
+
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+std::vector<exporter::SpanData::TimeEvent<T>> MoveEventWithTime(
+    TraceEvents<EventWithTime<T>, kInlineEvents, kMaxEvents>* events) {
+  std::vector<exporter::SpanData::TimeEvent<T>> time_events;
+  time_events.reserve(events->size());
+  for (size_t i = 0; i < events->size(); ++i) {
+    time_events.emplace_back((*events)[i].time, std::move((*events)[i].event));
+  }
+  return time_events;
+}
+
+// Approximates the heap bytes of an attribute map: each node holds the pair
+// and a next pointer, plus the key and any string value.
+size_t AttributeMapBytes(
+    const std::unordered_map<std::string, exporter::AttributeValue>& map) {
+  size_t bytes = map.bucket_count() * sizeof(void*);
+  for (const auto& attribute : map) {
+    bytes += sizeof(attribute) + sizeof(void*) + attribute.first.size();
+    if (attribute.second.type() == exporter::AttributeValue::Type::kString) {
+      bytes += attribute.second.string_value().size();
+    }
+  }
+  return bytes;
+}
+
+// Copies the attributes of 'list' to a map.
+std::unordered_map<std::string, exporter::AttributeValue> CopyAttributeList(
+    const AttributeList& list) {
+  std::unordered_map<std::string, exporter::AttributeValue> attributes;
+  attributes.reserve(list.attributes().size());
+  for (const auto& attribute : list.attributes()) {
+    attributes.emplace(std::string(attribute.key()), attribute.value());
+  }
+  return attributes;
+}
+
+// The bytes of an annotation counted against the span's ByteBudget.
+size_t AnnotationBudgetBytes(const exporter::Annotation& annotation) {
+  size_t bytes = annotation.description().size();
+  for (const auto& attribute : annotation.attributes()) {
+    bytes += attribute.first.size();
+    if (attribute.second.type() == exporter::AttributeValue::Type::kString) {
+      bytes += attribute.second.string_value().size();
+    }
+  }
+  return bytes;
+}
+
 // Deep-copies an initializer_list of absl::string_view keys and
 // AttributeValueRefs (cheap, used in the API) to an unordered_map that owns all
 // of the data in it. If the same key appears multiple times, the last value
@@ -77,49 +149,124 @@ std::unordered_map<std::string, exporter::AttributeValue> CopyAttributes(
 
 SpanImpl::SpanImpl(const SpanContext& context, const TraceParams& trace_params,
                    absl::string_view name, const SpanId& parent_span_id,
-                   bool remote_parent)
-    : start_time_(absl::Now()),
-      name_(name),
+                   bool remote_parent, bool single_writer,
+                   bool summarize_message_events, bool record_resource_usage,
+                   SpanPriority priority)
+    : start_time_(common::Clock::Now()),
+      name_(InternSpanName(name)),
       parent_span_id_(parent_span_id),
       context_(context),
       annotations_(trace_params.max_annotations),
       message_events_(trace_params.max_message_events),
       links_(trace_params.max_links),
-      attributes_(trace_params.max_attributes),
+      byte_budget_(trace_params.max_attribute_value_bytes,
+                   trace_params.max_span_bytes),
+      attributes_(trace_params.max_attributes, &byte_budget_),
       has_ended_(false),
-      remote_parent_(remote_parent) {}
+      last_chunk_time_(start_time_),
+      remote_parent_(remote_parent),
+      single_writer_(single_writer),
+      summarize_message_events_(summarize_message_events),
+      priority_(priority),
+      resource_usage_start_(
+          record_resource_usage
+              ? new ResourceUsageStart{std::this_thread::get_id(),
+                                       GetThreadResourceUsage()}
+              : nullptr) {}
 
 void SpanImpl::AddAttributes(AttributesRef attributes) {
-  absl::MutexLock l(&mu_);
+  absl::MutexLockMaybe l(writer_mu());
   if (!has_ended_) {
     for (const auto& attr : attributes) {
-      attributes_.AddAttribute(attr.first,
-                               exporter::AttributeValue(attr.second));
+      attributes_.AddAttribute(attr.first, attr.second);
     }
   }
 }
 
+void SpanImpl::AddAttribute(StaticString key, AttributeValueRef value) {
+  absl::MutexLockMaybe l(writer_mu());
+  if (!has_ended_) {
+    attributes_.AddAttribute(key, value);
+  }
+}
+
+bool SpanImpl::AcceptsAttributes() const {
+  absl::MutexLockMaybe l(writer_mu());
+  return !has_ended_ && attributes_.max_attributes() != 0 &&
+         !byte_budget_.exhausted();
+}
+
+bool SpanImpl::AcceptsAnnotations() const {
+  absl::MutexLockMaybe l(writer_mu());
+  return !has_ended_ && annotations_.max_events() != 0 &&
+         !byte_budget_.exhausted();
+}
+
 void SpanImpl::AddAnnotation(absl::string_view description,
                              AttributesRef attributes) {
-  absl::MutexLock l(&mu_);
-  if (!has_ended_) {
+  absl::MutexLockMaybe l(writer_mu());
+  if (has_ended_) {
+    return;
+  }
+  if (!byte_budget_.limited()) {
     annotations_.AddEvent(EventWithTime<exporter::Annotation>(
-        absl::Now(),
+        common::Clock::Now(),
         exporter::Annotation(description, CopyAttributes(attributes))));
+    return;
   }
+  // Truncate and size the annotation before copying any of it.
+  const absl::string_view truncated_description =
+      byte_budget_.Truncate(description);
+  size_t bytes = truncated_description.size();
+  absl::InlinedVector<std::pair<absl::string_view, AttributeValueRef>, 4>
+      truncated_attributes;
+  truncated_attributes.reserve(attributes.size());
+  for (const auto& attribute : attributes) {
+    truncated_attributes.emplace_back(
+        attribute.first, byte_budget_.TruncateValue(attribute.second));
+    bytes += ByteBudget::AttributeBytes(truncated_attributes.back().first,
+                                        truncated_attributes.back().second);
+  }
+  if (!byte_budget_.TryConsume(bytes)) {
+    return;
+  }
+  annotations_.AddEvent(EventWithTime<exporter::Annotation>(
+      common::Clock::Now(),
+      exporter::Annotation(truncated_description,
+                           CopyAttributes(truncated_attributes))));
 }
 
 void SpanImpl::AddMessageEvent(exporter::MessageEvent::Type type,
                                uint32_t message_id,
                                uint32_t compressed_message_size,
                                uint32_t uncompressed_message_size) {
-  absl::MutexLock l(&mu_);
-  if (!has_ended_) {
-    message_events_.AddEvent(EventWithTime<exporter::MessageEvent>(
-        absl::Now(),
-        exporter::MessageEvent(type, message_id, compressed_message_size,
-                               uncompressed_message_size)));
+  MessageCounters& counters = type == exporter::MessageEvent::Type::SENT
+                                  ? sent_messages_
+                                  : received_messages_;
+  const auto count = [&]() {
+    counters.compressed_bytes.fetch_add(compressed_message_size,
+                                        std::memory_order_relaxed);
+    counters.uncompressed_bytes.fetch_add(uncompressed_message_size,
+                                          std::memory_order_relaxed);
+    return counters.messages.fetch_add(1, std::memory_order_relaxed);
+  };
+  if (summarize_message_events_ &&
+      counters.messages.load(std::memory_order_relaxed) >=
+          kSampledMessageEvents) {
+    count();
+    return;
+  }
+  absl::MutexLockMaybe l(writer_mu());
+  if (has_ended_) {
+    return;
   }
+  if (count() >= kSampledMessageEvents && summarize_message_events_) {
+    return;
+  }
+  message_events_.AddEvent(EventWithTime<exporter::MessageEvent>(
+      common::Clock::Now(),
+      exporter::MessageEvent(type, message_id, compressed_message_size,
+                             uncompressed_message_size)));
 }
 
 void SpanImpl::AddLink(const SpanContext& context, exporter::Link::Type type,
@@ -130,22 +277,70 @@ void SpanImpl::AddLink(const SpanContext& context, exporter::Link::Type type,
   }
 }
 
-void SpanImpl::SetStatus(exporter::Status&& status) {
+void SpanImpl::AddLinks(absl::Span<const SpanContext> contexts,
+                        exporter::Link::Type type) {
   absl::MutexLock l(&mu_);
+  if (has_ended_) {
+    return;
+  }
+  // Only the newest max_links can be kept; skip building the others.
+  size_t first = 0;
+  if (contexts.size() > links_.max_events()) {
+    first = contexts.size() - links_.max_events();
+    links_.SkipEvents(first);
+  }
+  for (size_t i = first; i < contexts.size(); ++i) {
+    links_.AddEvent(exporter::Link(contexts[i], type));
+  }
+}
+
+void SpanImpl::SetStatus(exporter::Status&& status) {
+  absl::MutexLockMaybe l(writer_mu());
   if (!has_ended_) {
     status_ = std::move(status);
   }
 }
 
-bool SpanImpl::End() {
-  absl::MutexLock l(&mu_);
-  if (has_ended_) {
-    assert(false && "Invalid attempt to End() the same Span more than once.");
-    // In non-debug builds, just ignore the second End().
-    return false;
+bool SpanImpl::End(SpanEndHook hook) {
+  // Read before locking, since it may make system calls.
+  const bool record_resource_usage =
+      resource_usage_start_ != nullptr &&
+      resource_usage_start_->thread == std::this_thread::get_id();
+  ThreadResourceUsage end_usage;
+  if (record_resource_usage) {
+    end_usage = GetThreadResourceUsage();
+  }
+  absl::Duration latency;
+  StatusCode code;
+  {
+    absl::MutexLock l(&mu_);
+    if (has_ended_) {
+      assert(false &&
+             "Invalid attempt to End() the same Span more than once.");
+      // In non-debug builds, just ignore the second End().
+      return false;
+    }
+    if (record_resource_usage) {
+      const ThreadResourceUsage& start = resource_usage_start_->usage;
+      if (start.cpu_time_ns >= 0 && end_usage.cpu_time_ns >= 0) {
+        attributes_.AddAttribute(
+            StaticString(kThreadCpuTimeAttribute),
+            end_usage.cpu_time_ns - start.cpu_time_ns);
+      }
+      if (start.allocated_bytes >= 0 && end_usage.allocated_bytes >= 0) {
+        attributes_.AddAttribute(
+            StaticString(kThreadAllocatedBytesAttribute),
+            end_usage.allocated_bytes - start.allocated_bytes);
+      }
+    }
+    has_ended_ = true;
+    end_time_ = common::Clock::Now();
+    latency = end_time_ - start_time_;
+    code = status_.CanonicalCode();
+  }
+  if (hook != nullptr) {
+    hook(name_, code, latency);
   }
-  has_ended_ = true;
-  end_time_ = absl::Now();
   return true;
 }
 
@@ -154,22 +349,183 @@ bool SpanImpl::HasEnded() const {
   return has_ended_;
 }
 
+absl::Duration SpanImpl::latency() const {
+  absl::MutexLock l(&mu_);
+  assert(has_ended_);
+  return end_time_ - start_time_;
+}
+
+StatusCode SpanImpl::status_code() const {
+  absl::MutexLock l(&mu_);
+  assert(has_ended_);
+  return status_.CanonicalCode();
+}
+
+exporter::MessageEventTotals SpanImpl::message_event_totals() const {
+  exporter::MessageEventTotals totals;
+  totals.sent_messages =
+      sent_messages_.messages.load(std::memory_order_relaxed);
+  totals.sent_compressed_bytes =
+      sent_messages_.compressed_bytes.load(std::memory_order_relaxed);
+  totals.sent_uncompressed_bytes =
+      sent_messages_.uncompressed_bytes.load(std::memory_order_relaxed);
+  totals.received_messages =
+      received_messages_.messages.load(std::memory_order_relaxed);
+  totals.received_compressed_bytes =
+      received_messages_.compressed_bytes.load(std::memory_order_relaxed);
+  totals.received_uncompressed_bytes =
+      received_messages_.uncompressed_bytes.load(std::memory_order_relaxed);
+  return totals;
+}
+
+int SpanImpl::message_events_dropped() const {
+  if (!summarize_message_events_) {
+    return message_events_.num_events_dropped();
+  }
+  const int64_t total =
+      sent_messages_.messages.load(std::memory_order_relaxed) +
+      received_messages_.messages.load(std::memory_order_relaxed);
+  const int64_t recorded = message_events_.size() + message_events_chunked_;
+  return static_cast<int>(std::max<int64_t>(0, total - recorded));
+}
+
 exporter::SpanData SpanImpl::ToSpanData() const {
   absl::MutexLock l(&mu_);
-  // Make a deep copy of attributes.
-  std::unordered_map<std::string, exporter::AttributeValue> attributes =
-      attributes_.attributes();
+  if (single_writer_ && !has_ended_) {
+    // The owning thread may be writing the other data.
+    return exporter::SpanData(
+        name_, context_, parent_span_id_,
+        exporter::SpanData::TimeEvents<exporter::Annotation>({}, 0),
+        exporter::SpanData::TimeEvents<exporter::MessageEvent>({}, 0),
+        CopyTraceEvents(links_), links_.num_events_dropped(), {}, 0,
+        has_ended_, start_time_, end_time_, exporter::Status(),
+        remote_parent_);
+  }
   return exporter::SpanData(
       name_, context_, parent_span_id_,
       exporter::SpanData::TimeEvents<exporter::Annotation>(
-          CopyEventWithTime(annotations_.events()),
+          CopyEventWithTime(annotations_),
           annotations_.num_events_dropped()),
       exporter::SpanData::TimeEvents<exporter::MessageEvent>(
-          CopyEventWithTime(message_events_.events()),
-          message_events_.num_events_dropped()),
-      CopyTraceEvents(links_.events()), links_.num_events_dropped(),
+          CopyEventWithTime(message_events_), message_events_dropped()),
+      CopyTraceEvents(links_), links_.num_events_dropped(),
+      CopyAttributeList(attributes_), attributes_.num_attributes_dropped(),
+      has_ended_,
+      start_time_, end_time_, status_, remote_parent_,
+      byte_budget_.bytes_dropped(), message_event_totals());
+}
+
+bool SpanImpl::TakeChunk(absl::Time now, absl::Duration interval,
+                         std::vector<exporter::SpanData>* chunks) {
+  absl::MutexLock l(&mu_);
+  if (has_ended_ || single_writer_ || now - last_chunk_time_ < interval ||
+      (annotations_.size() == 0 && message_events_.size() == 0)) {
+    return false;
+  }
+  if (byte_budget_.limited()) {
+    // The freed annotations no longer count towards max_span_bytes.
+    size_t bytes = 0;
+    for (size_t i = 0; i < annotations_.size(); ++i) {
+      bytes += AnnotationBudgetBytes(annotations_[i].event);
+    }
+    byte_budget_.Release(bytes);
+  }
+  chunks->emplace_back(
+      name_, context_, parent_span_id_,
+      exporter::SpanData::TimeEvents<exporter::Annotation>(
+          MoveEventWithTime(&annotations_), annotations_.num_events_dropped()),
+      exporter::SpanData::TimeEvents<exporter::MessageEvent>(
+          MoveEventWithTime(&message_events_), message_events_dropped()),
+      CopyTraceEvents(links_), links_.num_events_dropped(),
+      CopyAttributeList(attributes_), attributes_.num_attributes_dropped(),
+      /*has_ended=*/false, start_time_, now, status_, remote_parent_,
+      byte_budget_.bytes_dropped(), message_event_totals());
+  if (summarize_message_events_) {
+    message_events_chunked_ += message_events_.size();
+  }
+  annotations_.Clear();
+  message_events_.Clear();
+  last_chunk_time_ = now;
+  return true;
+}
+
+void SpanImpl::AppendTo(exporter::SpanBatch::Builder* builder) const {
+  absl::MutexLock l(&mu_);
+  builder->StartSpan(name_, context_, parent_span_id_, remote_parent_,
+                     start_time_);
+  for (size_t i = 0; i < links_.size(); ++i) {
+    builder->AddLink(links_[i]);
+  }
+  if (single_writer_ && !has_ended_) {
+    // The owning thread may be writing the other data.
+    builder->SetDropped(0, 0, 0, links_.num_events_dropped(), 0);
+    return;
+  }
+  for (const auto& attribute : attributes_.attributes()) {
+    builder->AddAttribute(attribute.key(), attribute.value_ref());
+  }
+  for (size_t i = 0; i < annotations_.size(); ++i) {
+    builder->AddAnnotation(annotations_[i].time, annotations_[i].event);
+  }
+  for (size_t i = 0; i < message_events_.size(); ++i) {
+    builder->AddMessageEvent(message_events_[i].time,
+                             message_events_[i].event);
+  }
+  builder->SetDropped(attributes_.num_attributes_dropped(),
+                      annotations_.num_events_dropped(),
+                      message_events_dropped(), links_.num_events_dropped(),
+                      byte_budget_.bytes_dropped());
+  builder->SetMessageEventTotals(message_event_totals());
+  if (has_ended_) {
+    builder->EndSpan(end_time_, status_);
+  }
+}
+
+size_t SpanImpl::ApproximateBytes() const {
+  absl::MutexLock l(&mu_);
+  size_t bytes = sizeof(SpanImpl) + links_.HeapBytes();
+  for (size_t i = 0; i < links_.size(); ++i) {
+    bytes += AttributeMapBytes(links_[i].attributes());
+  }
+  if (single_writer_ && !has_ended_) {
+    // The owning thread may be writing the other data.
+    return bytes;
+  }
+  bytes += status_.error_message().size() + annotations_.HeapBytes() +
+           message_events_.HeapBytes();
+  for (size_t i = 0; i < annotations_.size(); ++i) {
+    const exporter::Annotation& annotation = annotations_[i].event;
+    bytes += annotation.description().size() +
+             AttributeMapBytes(annotation.attributes());
+  }
+  const AttributeList::Attributes& attributes = attributes_.attributes();
+  if (attributes.size() > AttributeList::kInlineAttributes) {
+    bytes += attributes.capacity() * sizeof(AttributeList::Attribute);
+  }
+  for (const auto& attribute : attributes) {
+    bytes += attribute.OwnedBytes();
+  }
+  return bytes;
+}
+
+exporter::SpanData SpanImpl::ConsumeToSpanData() {
+  absl::MutexLock l(&mu_);
+  assert(has_ended_);
+  std::unordered_map<std::string, exporter::AttributeValue> attributes;
+  attributes.reserve(attributes_.attributes().size());
+  for (auto& attribute : *attributes_.mutable_attributes()) {
+    attributes.insert(attribute.Release());
+  }
+  return exporter::SpanData(
+      name_, context_, parent_span_id_,
+      exporter::SpanData::TimeEvents<exporter::Annotation>(
+          MoveEventWithTime(&annotations_), annotations_.num_events_dropped()),
+      exporter::SpanData::TimeEvents<exporter::MessageEvent>(
+          MoveEventWithTime(&message_events_), message_events_dropped()),
+      MoveTraceEvents(&links_), links_.num_events_dropped(),
       std::move(attributes), attributes_.num_attributes_dropped(), has_ended_,
-      start_time_, end_time_, status_, remote_parent_);
+      start_time_, end_time_, std::move(status_), remote_parent_,
+      byte_budget_.bytes_dropped(), message_event_totals());
 }
 
 }  // namespace trace
@@ -15,25 +15,39 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_SPAN_IMPL_H_
 #define OPENCENSUS_TRACE_INTERNAL_SPAN_IMPL_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "opencensus/trace/exporter/annotation.h"
 #include "opencensus/trace/exporter/attribute_value.h"
 #include "opencensus/trace/exporter/link.h"
 #include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_batch.h"
 #include "opencensus/trace/exporter/span_data.h"
 #include "opencensus/trace/exporter/status.h"
 #include "opencensus/trace/internal/attribute_list.h"
+#include "opencensus/trace/internal/byte_budget.h"
+#include "opencensus/trace/internal/span_end_hook.h"
 #include "opencensus/trace/internal/event_with_time.h"
+#include "opencensus/trace/internal/fixed_trace_limits.h"
+#include "opencensus/trace/internal/resource_usage.h"
 #include "opencensus/trace/internal/trace_events.h"
 #include "opencensus/trace/span.h"
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/span_id.h"
+#include "opencensus/trace/span_priority.h"
+#include "opencensus/trace/status_code.h"
 #include "opencensus/trace/trace_config.h"
 #include "opencensus/trace/trace_params.h"
 
@@ -65,38 +79,61 @@ class SpanImpl final {
 
   // SpanContext sets the TraceId, SpanId, and TraceOptions for the span.
   // TraceParams sets the maximum number of attributes, annotations, network
-  // events, and links. The name allows for a user provided description of the
-  // span.
+  // events, and links, and the byte limits. The name allows for a user
+  // provided description of the span. If single_writer is true, all calls
+  // other than AddLink() and the accessors must come from one thread at a time
+  // (see StartSpanOptions::single_writer), and do not lock. If
+  // summarize_message_events is true, message events beyond the first
+  // kSampledMessageEvents of each type are only counted. If
+  // record_resource_usage is true, the thread's resource usage between the
+  // constructor and End() is added as attributes. 'priority' is the span's
+  // priority for export.
   SpanImpl(const SpanContext& context, const TraceParams& trace_params,
            absl::string_view name, const SpanId& parent_span_id,
-           bool remote_parent);
+           bool remote_parent, bool single_writer = false,
+           bool summarize_message_events = false,
+           bool record_resource_usage = false,
+           SpanPriority priority = SpanPriority::kNormal);
+
+  static constexpr int64_t kSampledMessageEvents = 4;
 
   void AddAttributes(AttributesRef attributes) LOCKS_EXCLUDED(mu_);
+  void AddAttribute(StaticString key, AttributeValueRef value)
+      LOCKS_EXCLUDED(mu_);
 
   void AddAnnotation(absl::string_view description, AttributesRef attributes)
       LOCKS_EXCLUDED(mu_);
 
+  // Returns false if an attribute or annotation added now would certainly not
+  // be recorded: the span has ended, its TraceParams allow none, or its byte
+  // budget is used up.
+  bool AcceptsAttributes() const LOCKS_EXCLUDED(mu_);
+  bool AcceptsAnnotations() const LOCKS_EXCLUDED(mu_);
+
   void AddMessageEvent(exporter::MessageEvent::Type type, uint32_t message_id,
                        uint32_t compressed_message_size,
-                       uint32_t uncompressed_message_size);
+                       uint32_t uncompressed_message_size) LOCKS_EXCLUDED(mu_);
 
   void AddLink(const SpanContext& context, exporter::Link::Type type,
                AttributesRef attributes) LOCKS_EXCLUDED(mu_);
+  // Adds a link without attributes to each context, under a single lock.
+  void AddLinks(absl::Span<const SpanContext> contexts,
+                exporter::Link::Type type) LOCKS_EXCLUDED(mu_);
 
   void SetStatus(exporter::Status&& status) LOCKS_EXCLUDED(mu_);
 
   // Returns true on success (if this is the first time the Span has ended) and
-  // also marks the end of the Span and sets its end_time_.
-  bool End() LOCKS_EXCLUDED(mu_);
+  // also marks the end of the Span and sets its end_time_. On success, calls
+  // 'hook' (if not null) with the span's latency and status.
+  bool End(SpanEndHook hook = nullptr) LOCKS_EXCLUDED(mu_);
 
   // Returns true if the span has ended.
   bool HasEnded() const LOCKS_EXCLUDED(mu_);
 
+  // The interned name, valid for the lifetime of the process (see
+  // InternSpanName()).
   absl::string_view name() const { return name_; }
 
-  // Returns the name of the span as a constref string.
-  const std::string& name_constref() const { return name_; }
-
   // Returns the SpanContext associated with this Span.
   SpanContext context() const { return context_; }
 
@@ -109,8 +146,63 @@ class SpanImpl final {
   friend class ::opencensus::trace::SpanTestPeer;
 
   // Makes a deep copy of span contents and returns copied data in SpanData.
+  // For a single-writer span that has not ended, only the context, name, times
+  // and links are copied.
   exporter::SpanData ToSpanData() const LOCKS_EXCLUDED(mu_);
 
+  // Like ToSpanData(), but moves the recorded events and attributes out of the
+  // span instead of copying them. Requires that the span has ended and that the
+  // caller holds the only reference to it, since the span's events are left in
+  // a moved-from state.
+  exporter::SpanData ConsumeToSpanData() LOCKS_EXCLUDED(mu_);
+
+  // For the incremental export of a long-running span: moves the annotations
+  // and message events recorded since the last chunk into a partial span
+  // appended to 'chunks', which has not ended and whose end time is 'now', and
+  // frees them. The chunk also has copies of the span's attributes and links.
+  // Returns false without taking a chunk if the span has ended, is
+  // single-writer, has no new events, or started or took its last chunk less
+  // than 'interval' before 'now'.
+  bool TakeChunk(absl::Time now, absl::Duration interval,
+                 std::vector<exporter::SpanData>* chunks) LOCKS_EXCLUDED(mu_);
+
+  // Adds the span to 'builder', copying its strings into the batch. As with
+  // ToSpanData(), only the context, name, times and links of a single-writer
+  // span that has not ended are added.
+  void AppendTo(exporter::SpanBatch::Builder* builder) const
+      LOCKS_EXCLUDED(mu_);
+
+  // Approximates the bytes held by the span, including its events and
+  // attributes. For a single-writer span that has not ended, only the span
+  // itself and its links are counted.
+  size_t ApproximateBytes() const LOCKS_EXCLUDED(mu_);
+
+  // The time between the start and end of the span, and its status code.
+  // Requires that the span has ended.
+  absl::Duration latency() const LOCKS_EXCLUDED(mu_);
+  StatusCode status_code() const LOCKS_EXCLUDED(mu_);
+
+  // The priority given by StartSpanOptions.
+  SpanPriority priority() const { return priority_; }
+
+  // The counters of the message events of one type.
+  struct MessageCounters {
+    std::atomic<int64_t> messages{0};
+    std::atomic<int64_t> compressed_bytes{0};
+    std::atomic<int64_t> uncompressed_bytes{0};
+  };
+
+  // Returns the current message event totals.
+  exporter::MessageEventTotals message_event_totals() const;
+  // The number of message events counted but not held in message_events_.
+  int message_events_dropped() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the mutex to hold while the owning thread records events: none for
+  // single-writer spans, whose events are published by End().
+  absl::Mutex* writer_mu() const LOCK_RETURNED(mu_) {
+    return single_writer_ ? nullptr : &mu_;
+  }
+
   mutable absl::Mutex mu_;
   // The start time of the span.
   const absl::Time start_time_;
@@ -118,26 +210,55 @@ class SpanImpl final {
   absl::Time end_time_ GUARDED_BY(mu_);
   // The status of the span. Only set if start_options_.record_events is true.
   exporter::Status status_ GUARDED_BY(mu_);
-  // The displayed name of the span.
-  const std::string name_;
+  // The displayed name of the span, interned.
+  const absl::string_view name_;
   // The parent SpanId of this span. Parent SpanId will be not valid if this is
   // a root span.
   const SpanId parent_span_id_;
   // TraceId, SpanId, and TraceOptions for the current span.
   const SpanContext context_;
-  // Queue of recorded annotations.
-  TraceEvents<EventWithTime<exporter::Annotation>> annotations_ GUARDED_BY(mu_);
-  // Queue of recorded network events.
-  TraceEvents<EventWithTime<exporter::MessageEvent>> message_events_
-      GUARDED_BY(mu_);
+  // Queue of recorded annotations. The event queues are stored inline if their
+  // limits are fixed (see fixed_trace_limits.h).
+  TraceEvents<EventWithTime<exporter::Annotation>, 2, kFixedMaxAnnotations>
+      annotations_ GUARDED_BY(mu_);
+  // Queue of recorded network events. These are small and often come in
+  // request/response pairs, so more are stored inline.
+  TraceEvents<EventWithTime<exporter::MessageEvent>, 4, kFixedMaxMessageEvents>
+      message_events_ GUARDED_BY(mu_);
+  // The totals of all message events. Updated with relaxed atomics, under mu_
+  // unless summarize_message_events_ is set.
+  MessageCounters sent_messages_;
+  MessageCounters received_messages_;
   // Queue of recorded links to parent and child spans.
-  TraceEvents<exporter::Link> links_ GUARDED_BY(mu_);
+  TraceEvents<exporter::Link, 1, kFixedMaxLinks> links_ GUARDED_BY(mu_);
+  // The byte limits of attributes and annotations. Declared before
+  // attributes_, which refers to it.
+  ByteBudget byte_budget_ GUARDED_BY(mu_);
   // Set of recorded attributes.
   AttributeList attributes_ GUARDED_BY(mu_);
   // Marks if the span has ended.
   bool has_ended_ GUARDED_BY(mu_);
+  // The end time of the last chunk taken by TakeChunk(), or the start time.
+  absl::Time last_chunk_time_ GUARDED_BY(mu_);
+  // The message events moved into chunks, which message_events_dropped() must
+  // not count.
+  int64_t message_events_chunked_ GUARDED_BY(mu_) = 0;
   // True if the parent Span is in a different process.
   const bool remote_parent_;
+  // True if events are recorded without locking. Other threads may only read
+  // the data guarded by mu_ (other than links_, which is always accessed under
+  // mu_) once has_ended_ is set.
+  const bool single_writer_;
+  // True if message events after the first few are only counted.
+  const bool summarize_message_events_;
+  const SpanPriority priority_;
+  // If resource usage is recorded, the starting thread and its usage at the
+  // start; null otherwise.
+  struct ResourceUsageStart {
+    std::thread::id thread;
+    ThreadResourceUsage usage;
+  };
+  const std::unique_ptr<const ResourceUsageStart> resource_usage_start_;
 };
 
 }  // namespace trace
@@ -0,0 +1,95 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the memory held per sampled span while it runs, as estimated by
+// TraceConfig::GetMemoryUsage() ("approx_bytes_per_span"), as the growth of the
+// heap ("heap_bytes_per_span"), and as the growth of the resident set
+// ("rss_bytes_per_span"), which stays near zero while memory freed by earlier
+// iterations is reused.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/common/internal/process_memory.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/trace_config.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+using ::opencensus::common::HeapBytesInUse;
+using ::opencensus::common::ResidentMemoryBytes;
+
+// Starts state.range(0) sampled spans, each with state.range(1) attributes and
+// annotations, and reports the bytes per span while they are running.
+void BM_SampledSpanMemory(benchmark::State& state) {
+  static AlwaysSampler sampler;
+  const int num_spans = state.range(0);
+  const int num_events = state.range(1);
+  std::vector<std::string> keys(num_events);
+  for (int i = 0; i < num_events; ++i) {
+    keys[i] = absl::StrCat("attribute_key_", i);
+  }
+  std::vector<Span> spans;
+  spans.reserve(num_spans);
+  int64_t approximate_bytes = 0;
+  int64_t heap_bytes = 0;
+  int64_t resident_bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    const int64_t start_approximate =
+        TraceConfig::GetMemoryUsage().running_spans.bytes;
+    state.ResumeTiming();
+
+    const int64_t start_heap = HeapBytesInUse();
+    const int64_t start = ResidentMemoryBytes();
+    for (int i = 0; i < num_spans; ++i) {
+      spans.push_back(Span::StartSpan("MemorySpan", nullptr, {&sampler}));
+      for (int j = 0; j < num_events; ++j) {
+        spans.back().AddAttribute(keys[j], j);
+        spans.back().AddAnnotation("annotation");
+      }
+    }
+    resident_bytes += ResidentMemoryBytes() - start;
+    heap_bytes += HeapBytesInUse() - start_heap;
+
+    state.PauseTiming();
+    approximate_bytes +=
+        TraceConfig::GetMemoryUsage().running_spans.bytes - start_approximate;
+    for (const Span& span : spans) {
+      span.End();
+    }
+    spans.clear();
+    state.ResumeTiming();
+  }
+  const double total = static_cast<double>(num_spans) * state.iterations();
+  state.counters["approx_bytes_per_span"] = approximate_bytes / total;
+  state.counters["heap_bytes_per_span"] = heap_bytes / total;
+  state.counters["rss_bytes_per_span"] = resident_bytes / total;
+}
+BENCHMARK(BM_SampledSpanMemory)
+    ->ArgNames({"spans", "events"})
+    ->ArgsProduct({{1000, 10000}, {0, 4, 32}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/span_name.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace opencensus {
+namespace trace {
+
+namespace {
+
+// The number of entries in each thread's direct-mapped cache. Services use a
+// few hundred distinct names at most, most of them rarely.
+constexpr size_t kCacheSize = 64;
+
+// The process-wide table of interned span names.
+class SpanNameTable {
+ public:
+  static SpanNameTable* Get() {
+    static SpanNameTable* global_span_name_table = new SpanNameTable;
+    return global_span_name_table;
+  }
+
+  absl::string_view Intern(absl::string_view name) LOCKS_EXCLUDED(mu_) {
+    {
+      // Most names have been seen before, so try under a shared lock first.
+      absl::ReaderMutexLock l(&mu_);
+      const auto it = names_.find(name);
+      if (it != names_.end()) {
+        return *it;
+      }
+    }
+    absl::MutexLock l(&mu_);
+    return *names_.insert(std::string(name)).first;
+  }
+
+ private:
+  absl::Mutex mu_;
+  // Node-based, so that interned names never move.
+  absl::node_hash_set<std::string> names_ GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+absl::string_view InternSpanName(absl::string_view name) {
+  static thread_local std::array<absl::string_view, kCacheSize> cache;
+  absl::string_view& entry =
+      cache[absl::Hash<absl::string_view>()(name) % kCacheSize];
+  if (entry.data() == nullptr || entry != name) {
+    entry = SpanNameTable::Get()->Intern(name);
+  }
+  return entry;
+}
+
+}  // namespace trace
+}  // namespace opencensus
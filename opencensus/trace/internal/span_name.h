@@ -0,0 +1,35 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_SPAN_NAME_H_
+#define OPENCENSUS_TRACE_INTERNAL_SPAN_NAME_H_
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace trace {
+
+// Returns a view of the process-wide interned copy of 'name', so that spans,
+// SpanData, and the span stores share one copy of each distinct span name.
+// Interned names are never freed, so the returned view remains valid for the
+// lifetime of the process; avoid unbounded sets of span names.
+//
+// Each thread caches recently interned names, so interning a name the thread
+// has seen recently takes no lock. Thread-safe.
+absl::string_view InternSpanName(absl::string_view name);
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_SPAN_NAME_H_
@@ -0,0 +1,52 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/span_name.h"
+
+#include <string>
+#include <thread>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+TEST(SpanNameTest, EqualNamesShareStorage) {
+  std::string name = "span_name_test";
+  const absl::string_view interned = InternSpanName(name);
+  EXPECT_EQ("span_name_test", interned);
+  EXPECT_NE(name.data(), interned.data());
+  // The interned copy does not depend on the caller's storage.
+  name = "changed";
+  EXPECT_EQ("span_name_test", interned);
+  EXPECT_EQ(interned.data(), InternSpanName("span_name_test").data());
+  EXPECT_NE(interned.data(), InternSpanName("other_span_name").data());
+  EXPECT_EQ("", InternSpanName(""));
+}
+
+TEST(SpanNameTest, SharedAcrossThreads) {
+  const absl::string_view interned = InternSpanName("shared_span_name");
+  absl::string_view other_thread_interned;
+  std::thread t([&other_thread_interned] {
+    other_thread_interned = InternSpanName("shared_span_name");
+  });
+  t.join();
+  EXPECT_EQ(interned.data(), other_thread_interned.data());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
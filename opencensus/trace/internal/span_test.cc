@@ -14,15 +14,23 @@
 
 #include "opencensus/trace/span.h"
 
+#include <atomic>
 #include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
 #include "opencensus/trace/attribute_value_ref.h"
 #include "opencensus/trace/exporter/attribute_value.h"
 #include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/internal/running_span_store.h"
 #include "opencensus/trace/internal/span_impl.h"
+#include "opencensus/trace/internal/trace_config_impl.h"
 #include "opencensus/trace/span_id.h"
+#include "opencensus/trace/trace_config.h"
 #include "opencensus/trace/trace_id.h"
 #include "opencensus/trace/trace_options.h"
 
@@ -42,6 +50,10 @@ class SpanTestPeer {
   static exporter::SpanData ToSpanData(Span* span) {
     return span->span_impl_for_test()->ToSpanData();
   }
+
+  static exporter::SpanData ConsumeToSpanData(Span* span) {
+    return span->span_impl_for_test()->ConsumeToSpanData();
+  }
 };
 
 namespace {
@@ -73,6 +85,42 @@ TEST(SpanTest, ChildInheritsSamplingFromParent) {
             SpanTestPeer::GetParentSpanId(&child_span));
 }
 
+TEST(SpanTest, StartChildSpans) {
+  AlwaysSampler sampler;
+  auto root_span =
+      Span::StartSpan("FanOutRoot", /*parent=*/nullptr, {&sampler});
+  std::vector<Span> children =
+      Span::StartChildSpans("FanOutChild", root_span, 20);
+  ASSERT_EQ(20, children.size());
+  std::set<std::string> span_ids;
+  for (auto& child : children) {
+    EXPECT_TRUE(child.IsSampled());
+    EXPECT_EQ(root_span.context().trace_id(), child.context().trace_id());
+    EXPECT_EQ(root_span.context().span_id(),
+              SpanTestPeer::GetParentSpanId(&child));
+    span_ids.insert(child.context().span_id().ToHex());
+  }
+  EXPECT_EQ(20, span_ids.size());
+  const exporter::RunningSpanStore::Filter filter = {"FanOutChild", 100};
+  EXPECT_EQ(20, exporter::RunningSpanStore::GetRunningSpans(filter).size());
+  for (const auto& child : children) {
+    child.End();
+  }
+  EXPECT_TRUE(exporter::RunningSpanStore::GetRunningSpans(filter).empty());
+
+  // Children of an unsampled parent share one sampling decision.
+  NeverSampler never;
+  auto unsampled_root =
+      Span::StartSpan("FanOutRoot", /*parent=*/nullptr, {&never});
+  children = Span::StartChildSpans("FanOutChild", unsampled_root, 3, {&never});
+  ASSERT_EQ(3, children.size());
+  for (const auto& child : children) {
+    EXPECT_FALSE(child.IsRecording());
+    EXPECT_EQ(unsampled_root.context().trace_id(), child.context().trace_id());
+  }
+  EXPECT_TRUE(Span::StartChildSpans("FanOutChild", root_span, 0).empty());
+}
+
 TEST(SpanTest, AddAttributesLastValueWins) {
   AlwaysSampler sampler;
   auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
@@ -108,6 +156,37 @@ TEST(SpanTest, AddAttributesWithArrayAndVector) {
             data.attributes().at("another_key").string_value());
 }
 
+TEST(SpanTest, AddStaticStringAttributes) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
+  span.AddAttribute(StaticString("static_key"), StaticString("static_value"));
+  span.AddAttribute(StaticString("int_key"), 123);
+  span.AddAttributes({{"key", StaticString("value")}});
+  const auto data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ("static_value", data.attributes().at("static_key").string_value());
+  EXPECT_EQ(123, data.attributes().at("int_key").int_value());
+  EXPECT_EQ("value", data.attributes().at("key").string_value());
+}
+
+TEST(SpanTest, SingleWriterPublishesOnEnd) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan("SpanName", /*parent=*/nullptr,
+                              {&sampler, {}, /*single_writer=*/true});
+  span.AddAttribute("key", "value");
+  span.AddAnnotation("Annotation text.");
+  span.AddSentMessageEvent(1, 2, 3);
+  // Data is not visible to other threads until the span ends.
+  auto data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ("SpanName", data.name());
+  EXPECT_TRUE(data.attributes().empty());
+  EXPECT_TRUE(data.annotations().events().empty());
+  span.End();
+  data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ("value", data.attributes().at("key").string_value());
+  EXPECT_EQ(1, data.annotations().events().size());
+  EXPECT_EQ(1, data.message_events().events().size());
+}
+
 TEST(SpanTest, AddAnnotationLastAttributeWins) {
   AlwaysSampler sampler;
   auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
@@ -167,6 +246,71 @@ TEST(SpanTest, ParentLinksFromOptions) {
   }
 }
 
+TEST(SpanTest, OneWayParentLinks) {
+  AlwaysSampler sampler;
+  auto parent = Span::StartSpan("Parent", /*parent=*/nullptr, {&sampler});
+  auto span = Span::StartSpan(
+      "MyRootSpan", /*parent=*/nullptr,
+      {&sampler, {&parent}, /*single_writer=*/false,
+       /*summarize_message_events=*/false, /*record_resource_usage=*/false,
+       /*one_way_parent_links=*/true});
+  auto data = SpanTestPeer::ToSpanData(&span);
+  ASSERT_EQ(1, data.links().size());
+  EXPECT_EQ(exporter::Link::Type::kParentLinkedSpan, data.links()[0].type());
+  EXPECT_EQ(parent.context().span_id(), data.links()[0].span_id());
+  EXPECT_EQ(0, SpanTestPeer::ToSpanData(&parent).links().size());
+}
+
+TEST(SpanTest, AddLinksKeepsNewest) {
+  const TraceParams saved = TraceConfigImpl::Get()->current_trace_params();
+  TraceConfig::SetCurrentTraceParams(
+      TraceParams{32, 32, 128, /*max_links=*/2, ProbabilitySampler(1.0)});
+  auto span = Span::StartSpan("SpanName");
+  TraceConfig::SetCurrentTraceParams(saved);
+  std::vector<SpanContext> ctxs;
+  for (int i = 0; i < 3; ++i) {
+    auto linked = Span::StartSpan("Linked");
+    ctxs.push_back(linked.context());
+    linked.End();
+  }
+  span.AddChildLinks({});
+  span.AddParentLinks(ctxs);
+  span.End();
+  span.AddChildLinks(ctxs);
+
+  const exporter::SpanData data = SpanTestPeer::ToSpanData(&span);
+  ASSERT_EQ(2, data.links().size());
+  EXPECT_EQ(1, data.num_links_dropped());
+  EXPECT_EQ(ctxs[1].span_id(), data.links()[0].span_id());
+  EXPECT_EQ(ctxs[2].span_id(), data.links()[1].span_id());
+  EXPECT_EQ(exporter::Link::Type::kParentLinkedSpan, data.links()[1].type());
+}
+
+TEST(SpanTest, DisabledSpanNames) {
+  AlwaysSampler sampler;
+  TraceConfig::SetDisabledSpanNames({"Disabled"});
+  auto parent = Span::StartSpan("Parent", /*parent=*/nullptr, {&sampler});
+  auto span = Span::StartSpan("Disabled", &parent, {&sampler});
+  EXPECT_FALSE(span.IsRecording());
+  // Children of the disabled span attach to its parent.
+  EXPECT_EQ(parent.context(), span.context());
+  auto root = Span::StartSpan("Disabled", /*parent=*/nullptr, {&sampler});
+  EXPECT_FALSE(root.context().IsValid());
+  auto remote = Span::StartSpanWithRemoteParent("Disabled", parent.context(),
+                                                {&sampler});
+  EXPECT_FALSE(remote.IsRecording());
+  // Names of the same length are hashed and compared.
+  auto other = Span::StartSpan("Enabled!", /*parent=*/nullptr, {&sampler});
+  EXPECT_TRUE(other.IsRecording());
+  other.End();
+
+  TraceConfig::SetDisabledSpanNames({});
+  auto enabled = Span::StartSpan("Disabled", &parent, {&sampler});
+  EXPECT_TRUE(enabled.IsRecording());
+  enabled.End();
+  parent.End();
+}
+
 TEST(SpanTest, FullSpanTest) {
   AlwaysSampler sampler;
   auto linked_span1 = Span::StartSpan("link1");
@@ -350,6 +494,221 @@ TEST(SpanTest, CheckSpanData) {
   EXPECT_EQ(333, attributes.at("test3").int_value());
 }
 
+TEST(SpanTest, ConsumeToSpanDataMatchesCopy) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan("test_span", nullptr, {&sampler});
+  span.AddAttribute("key", "value");
+  span.AddAnnotation("annotation", {{"annotation_key", 123}});
+  span.AddSentMessageEvent(1, 2, 3);
+  span.AddChildLink(span.context());
+  span.SetStatus(StatusCode::CANCELLED, "cancelled");
+  span.End();
+
+  const exporter::SpanData copied = SpanTestPeer::ToSpanData(&span);
+  const exporter::SpanData consumed = SpanTestPeer::ConsumeToSpanData(&span);
+  EXPECT_EQ(copied.DebugString(), consumed.DebugString());
+  EXPECT_EQ("value", consumed.attributes().at("key").string_value());
+  ASSERT_EQ(1, consumed.annotations().events().size());
+  EXPECT_EQ("annotation",
+            consumed.annotations().events()[0].event().description());
+  EXPECT_EQ(copied.annotations().events()[0].timestamp(),
+            consumed.annotations().events()[0].timestamp());
+  ASSERT_EQ(1, consumed.message_events().events().size());
+  EXPECT_EQ(3, consumed.message_events()
+                   .events()[0]
+                   .event()
+                   .uncompressed_size());
+  ASSERT_EQ(1, consumed.links().size());
+  EXPECT_EQ(span.context().span_id(), consumed.links()[0].span_id());
+  EXPECT_EQ(StatusCode::CANCELLED, consumed.status().CanonicalCode());
+}
+
+TEST(SpanTest, ByteLimits) {
+  const TraceParams saved = TraceConfigImpl::Get()->current_trace_params();
+  TraceConfig::SetCurrentTraceParams(
+      TraceParams{32, 32, 128, 128, ProbabilitySampler(1.0), nullptr,
+                  /*max_attribute_value_bytes=*/5, /*max_span_bytes=*/25});
+  auto span = Span::StartSpan("SpanName");
+  // 9 bytes, 3 truncated.
+  span.AddAttribute("key1", "12345678");
+  // 16 bytes, 11 truncated.
+  span.AddAnnotation("annotation", {{"key", "value value"}, {"int", 1}});
+  // Neither fits, so all of their 10 and 7 bytes are dropped.
+  span.AddAttribute("key2", "123456");
+  span.AddAnnotation("dropped");
+  span.End();
+  TraceConfig::SetCurrentTraceParams(saved);
+
+  const exporter::SpanData data = SpanTestPeer::ConsumeToSpanData(&span);
+  ASSERT_EQ(1, data.attributes().size());
+  EXPECT_EQ("12345", data.attributes().at("key1").string_value());
+  EXPECT_EQ(1, data.num_attributes_dropped());
+  ASSERT_EQ(1, data.annotations().events().size());
+  const exporter::Annotation& annotation =
+      data.annotations().events()[0].event();
+  EXPECT_EQ("annot", annotation.description());
+  EXPECT_EQ("value", annotation.attributes().at("key").string_value());
+  EXPECT_EQ(1, annotation.attributes().at("int").int_value());
+  EXPECT_EQ(3 + 11 + 10 + 7, data.num_bytes_dropped());
+}
+
+TEST(SpanTest, MessageEventTotals) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
+  span.AddSentMessageEvent(1, 10, 20);
+  span.AddSentMessageEvent(2, 30, 40);
+  span.AddReceivedMessageEvent(1, 5, 6);
+  span.End();
+  // Not counted once the span has ended.
+  span.AddSentMessageEvent(3, 30, 40);
+
+  const exporter::SpanData data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ(3, data.message_events().events().size());
+  EXPECT_EQ(0, data.message_events().dropped_events_count());
+  const auto& totals = data.message_event_totals();
+  EXPECT_EQ(2, totals.sent_messages);
+  EXPECT_EQ(40, totals.sent_compressed_bytes);
+  EXPECT_EQ(60, totals.sent_uncompressed_bytes);
+  EXPECT_EQ(1, totals.received_messages);
+  EXPECT_EQ(5, totals.received_compressed_bytes);
+  EXPECT_EQ(6, totals.received_uncompressed_bytes);
+}
+
+TEST(SpanTest, SummarizeMessageEvents) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan(
+      "SpanName", /*parent=*/nullptr,
+      {&sampler, {}, /*single_writer=*/false,
+       /*summarize_message_events=*/true});
+  for (int i = 0; i < 100; ++i) {
+    span.AddSentMessageEvent(i, 1, 2);
+  }
+  for (int i = 0; i < 10; ++i) {
+    span.AddReceivedMessageEvent(i, 3, 4);
+  }
+  span.End();
+
+  const exporter::SpanData data = SpanTestPeer::ConsumeToSpanData(&span);
+  // The first few of each type are recorded.
+  const auto& events = data.message_events().events();
+  ASSERT_EQ(2 * SpanImpl::kSampledMessageEvents, events.size());
+  EXPECT_EQ(exporter::MessageEvent::Type::SENT, events[0].event().type());
+  EXPECT_EQ(0, events[0].event().id());
+  EXPECT_EQ(exporter::MessageEvent::Type::RECEIVED,
+            events.back().event().type());
+  EXPECT_EQ(110 - 2 * SpanImpl::kSampledMessageEvents,
+            data.message_events().dropped_events_count());
+  const auto& totals = data.message_event_totals();
+  EXPECT_EQ(100, totals.sent_messages);
+  EXPECT_EQ(100, totals.sent_compressed_bytes);
+  EXPECT_EQ(200, totals.sent_uncompressed_bytes);
+  EXPECT_EQ(10, totals.received_messages);
+  EXPECT_EQ(30, totals.received_compressed_bytes);
+  EXPECT_EQ(40, totals.received_uncompressed_bytes);
+}
+
+int64_t FakeAllocatedBytes() {
+  static std::atomic<int64_t> bytes(0);
+  return bytes += 100;
+}
+
+TEST(SpanTest, RecordResourceUsage) {
+  TraceConfig::SetThreadAllocatedBytesFunction(&FakeAllocatedBytes);
+  AlwaysSampler sampler;
+  const StartSpanOptions options(&sampler, {}, /*single_writer=*/false,
+                                 /*summarize_message_events=*/false,
+                                 /*record_resource_usage=*/true);
+  auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, options);
+  // Use some CPU time.
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < 1000000; ++i) {
+    sum += i;
+  }
+  span.End();
+  auto other_thread = Span::StartSpan("SpanName", /*parent=*/nullptr, options);
+  std::thread([&other_thread]() { other_thread.End(); }).join();
+  auto not_recorded = Span::StartSpan("SpanName", /*parent=*/nullptr,
+                                      {&sampler});
+  not_recorded.End();
+  TraceConfig::SetThreadAllocatedBytesFunction(nullptr);
+
+  const exporter::SpanData data = SpanTestPeer::ToSpanData(&span);
+  ASSERT_EQ(1, data.attributes().count(kThreadCpuTimeAttribute));
+  EXPECT_GT(data.attributes().at(kThreadCpuTimeAttribute).int_value(), 0);
+  ASSERT_EQ(1, data.attributes().count(kThreadAllocatedBytesAttribute));
+  EXPECT_EQ(100,
+            data.attributes().at(kThreadAllocatedBytesAttribute).int_value());
+  EXPECT_TRUE(SpanTestPeer::ToSpanData(&other_thread).attributes().empty())
+      << "Not recorded when ended on another thread.";
+  EXPECT_TRUE(SpanTestPeer::ToSpanData(&not_recorded).attributes().empty());
+}
+
+TEST(SpanTest, LazyAttributesAndAnnotations) {
+  AlwaysSampler sampler;
+  auto span = Span::StartSpan("SpanName", /*parent=*/nullptr, {&sampler});
+  span.AddAttribute("key", []() { return absl::StrCat("val", "ue"); });
+  span.AddAttribute(StaticString("static_key"), []() { return 123; });
+  span.AddAnnotation([]() { return absl::StrCat("anno", "tation"); },
+                     {{"key", "value"}});
+  span.End();
+  int calls = 0;
+  span.AddAttribute("ended", [&calls]() {
+    ++calls;
+    return "value";
+  });
+  span.AddAnnotation([&calls]() {
+    ++calls;
+    return "ended";
+  });
+  EXPECT_EQ(0, calls) << "Not called once the span has ended.";
+
+  const exporter::SpanData data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ(2, data.attributes().size());
+  EXPECT_EQ("value", data.attributes().at("key").string_value());
+  EXPECT_EQ(123, data.attributes().at("static_key").int_value());
+  ASSERT_EQ(1, data.annotations().events().size());
+  const exporter::Annotation& annotation =
+      data.annotations().events()[0].event();
+  EXPECT_EQ("annotation", annotation.description());
+  EXPECT_EQ("value", annotation.attributes().at("key").string_value());
+}
+
+TEST(SpanTest, LazyNotCalledUnlessRecorded) {
+  int calls = 0;
+  auto make_value = [&calls]() {
+    ++calls;
+    return std::string("value");
+  };
+  NeverSampler never_sampler;
+  auto unsampled =
+      Span::StartSpan("SpanName", /*parent=*/nullptr, {&never_sampler});
+  unsampled.AddAttribute("key", make_value);
+  unsampled.AddAnnotation(make_value);
+  unsampled.End();
+  Span::BlankSpan().AddAnnotation(make_value);
+  EXPECT_EQ(0, calls);
+
+  const TraceParams saved = TraceConfigImpl::Get()->current_trace_params();
+  TraceConfig::SetCurrentTraceParams(
+      TraceParams{32, 0, 128, 128, ProbabilitySampler(1.0), nullptr,
+                  /*max_attribute_value_bytes=*/0, /*max_span_bytes=*/10});
+  auto span = Span::StartSpan("SpanName");
+  TraceConfig::SetCurrentTraceParams(saved);
+  // max_annotations is 0.
+  span.AddAnnotation(make_value);
+  EXPECT_EQ(0, calls);
+  // 10 bytes, using up the byte budget.
+  span.AddAttribute("key12", make_value);
+  EXPECT_EQ(1, calls);
+  span.AddAttribute("k", make_value);
+  EXPECT_EQ(1, calls);
+  span.End();
+
+  const exporter::SpanData data = SpanTestPeer::ToSpanData(&span);
+  EXPECT_EQ(1, data.attributes().size());
+  EXPECT_EQ("value", data.attributes().at("key12").string_value());
+}
+
 TEST(SpanTest, BlankSpan) {
   auto parent = Span::StartSpan("parent");
   auto span = Span::BlankSpan();
@@ -65,6 +65,10 @@ absl::string_view CodeToString(StatusCode code) {
 
 }  // namespace
 
+absl::string_view Status::CanonicalCodeString() const {
+  return CodeToString(code_);
+}
+
 std::string Status::ToString() const {
   if (ok()) {
     return "OK";
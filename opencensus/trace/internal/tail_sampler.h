@@ -0,0 +1,165 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_INTERNAL_TAIL_SAMPLER_H_
+#define OPENCENSUS_TRACE_INTERNAL_TAIL_SAMPLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/trace_id.h"
+
+namespace opencensus {
+namespace trace {
+
+// TailSampler implements tail-based sampling of ended spans: rather than
+// deciding whether to export a trace when it starts, it holds the spans of each
+// trace until a decision wait after the first of them was added, then passes
+// on the whole trace if any of its spans was slow or failed, and drops it
+// otherwise. Spans are held as they were queued for export (SpanExporterImpl
+// holds shared_ptrs to SpanImpl), so dropped traces are never converted to
+// SpanData.
+//
+// Spans of a kept trace added within a decision wait after it was kept are
+// passed on at once. Spans of a dropped trace added later start a new
+// decision. At most max_spans spans are held; beyond that, the traces held
+// longest are decided early.
+//
+// TailSampler is thread-compatible.
+template <typename SpanT>
+class TailSampler final {
+ public:
+  struct Options {
+    absl::Duration decision_wait;
+    // Traces with a span at least this slow are kept.
+    absl::Duration min_latency;
+    // If true, traces with a span whose status is not OK are kept.
+    bool keep_errors;
+    size_t max_spans;
+  };
+
+  explicit TailSampler(const Options& options) : options_(options) {}
+
+  TailSampler(const TailSampler&) = delete;
+  TailSampler& operator=(const TailSampler&) = delete;
+
+  // Adds an ended span of trace 'trace_id', with its latency and whether its
+  // status is OK. Spans passed on at once, and the spans of traces decided
+  // early to make room, are appended to *out.
+  void Add(const TraceId& trace_id, SpanT span, absl::Duration latency,
+           bool ok, absl::Time now, std::vector<SpanT>* out);
+
+  // Decides the traces whose decision wait ended by 'now', appending the spans
+  // of those kept to *out.
+  void Decide(absl::Time now, std::vector<SpanT>* out);
+
+  // Decides every trace held, e.g. at shutdown.
+  void DecideAll(std::vector<SpanT>* out) {
+    Decide(absl::InfiniteFuture(), out);
+  }
+
+  const Options& options() const { return options_; }
+  size_t num_held_spans() const { return num_held_spans_; }
+  uint64_t num_dropped_spans() const { return num_dropped_spans_; }
+
+ private:
+  struct Trace {
+    bool keep;
+    std::vector<SpanT> spans;
+  };
+
+  // Decides the trace at the front of decisions_.
+  void DecideFront(absl::Time now, std::vector<SpanT>* out);
+
+  const Options options_;
+  absl::flat_hash_map<TraceId, Trace> traces_;
+  // The traces in traces_ by decision time, earliest first.
+  std::deque<std::pair<absl::Time, TraceId>> decisions_;
+  // Recently kept traces, with the time until which their later spans are
+  // passed on, earliest first.
+  absl::flat_hash_map<TraceId, absl::Time> kept_;
+  std::deque<std::pair<absl::Time, TraceId>> kept_expiry_;
+  size_t num_held_spans_ = 0;
+  uint64_t num_dropped_spans_ = 0;
+};
+
+template <typename SpanT>
+void TailSampler<SpanT>::Add(const TraceId& trace_id, SpanT span,
+                             absl::Duration latency, bool ok, absl::Time now,
+                             std::vector<SpanT>* out) {
+  const auto kept = kept_.find(trace_id);
+  if (kept != kept_.end() && kept->second > now) {
+    out->push_back(std::move(span));
+    return;
+  }
+  auto it = traces_.find(trace_id);
+  if (it == traces_.end()) {
+    it = traces_.emplace(trace_id, Trace{false, {}}).first;
+    decisions_.emplace_back(now + options_.decision_wait, trace_id);
+  }
+  it->second.keep |= latency >= options_.min_latency ||
+                     (!ok && options_.keep_errors);
+  it->second.spans.push_back(std::move(span));
+  ++num_held_spans_;
+  while (num_held_spans_ > options_.max_spans && !decisions_.empty()) {
+    DecideFront(now, out);
+  }
+}
+
+template <typename SpanT>
+void TailSampler<SpanT>::Decide(absl::Time now, std::vector<SpanT>* out) {
+  while (!decisions_.empty() && decisions_.front().first <= now) {
+    DecideFront(now, out);
+  }
+  while (!kept_expiry_.empty() && kept_expiry_.front().first <= now) {
+    const auto it = kept_.find(kept_expiry_.front().second);
+    // A trace kept again later has a later expiry.
+    if (it != kept_.end() && it->second <= now) {
+      kept_.erase(it);
+    }
+    kept_expiry_.pop_front();
+  }
+}
+
+template <typename SpanT>
+void TailSampler<SpanT>::DecideFront(absl::Time now, std::vector<SpanT>* out) {
+  const TraceId trace_id = decisions_.front().second;
+  decisions_.pop_front();
+  const auto it = traces_.find(trace_id);
+  Trace& trace = it->second;
+  num_held_spans_ -= trace.spans.size();
+  if (trace.keep) {
+    for (SpanT& span : trace.spans) {
+      out->push_back(std::move(span));
+    }
+    if (now != absl::InfiniteFuture()) {
+      const absl::Time expiry = now + options_.decision_wait;
+      kept_[trace_id] = expiry;
+      kept_expiry_.emplace_back(expiry, trace_id);
+    }
+  } else {
+    num_dropped_spans_ += trace.spans.size();
+  }
+  traces_.erase(it);
+}
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_INTERNAL_TAIL_SAMPLER_H_
@@ -0,0 +1,202 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/tail_sampler.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/trace/trace_id.h"
+
+// Tail sampling is enabled before the first handler is registered, so these
+// tests are separate from span_exporter_test.
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+TraceId MakeTraceId(uint8_t n) {
+  const uint8_t bytes[TraceId::kSize] = {n, 0, 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 1};
+  return TraceId(bytes);
+}
+
+TailSampler<int>::Options TestOptions() {
+  TailSampler<int>::Options options;
+  options.decision_wait = absl::Seconds(10);
+  options.min_latency = absl::Seconds(1);
+  options.keep_errors = true;
+  options.max_spans = 100;
+  return options;
+}
+
+TEST(TailSamplerTest, KeepsSlowAndFailedTraces) {
+  TailSampler<int> sampler(TestOptions());
+  const absl::Time start = absl::UnixEpoch();
+  std::vector<int> out;
+  // Trace 1 is fast and OK, trace 2 has a slow span, and trace 3 a failed one.
+  sampler.Add(MakeTraceId(1), 10, absl::Milliseconds(1), true, start, &out);
+  sampler.Add(MakeTraceId(2), 20, absl::Milliseconds(1), true, start, &out);
+  sampler.Add(MakeTraceId(1), 11, absl::Milliseconds(1), true, start, &out);
+  sampler.Add(MakeTraceId(2), 21, absl::Seconds(2), true, start, &out);
+  sampler.Add(MakeTraceId(3), 30, absl::Milliseconds(1), false, start, &out);
+  EXPECT_EQ(5, sampler.num_held_spans());
+
+  sampler.Decide(start + absl::Seconds(9), &out);
+  EXPECT_THAT(out, IsEmpty());
+  sampler.Decide(start + absl::Seconds(10), &out);
+  EXPECT_THAT(out, ElementsAre(20, 21, 30));
+  EXPECT_EQ(0, sampler.num_held_spans());
+  EXPECT_EQ(2, sampler.num_dropped_spans());
+}
+
+TEST(TailSamplerTest, IgnoresErrorsIfConfigured) {
+  TailSampler<int>::Options options = TestOptions();
+  options.keep_errors = false;
+  TailSampler<int> sampler(options);
+  std::vector<int> out;
+  sampler.Add(MakeTraceId(1), 10, absl::Milliseconds(1), false,
+              absl::UnixEpoch(), &out);
+  sampler.DecideAll(&out);
+  EXPECT_THAT(out, IsEmpty());
+  EXPECT_EQ(1, sampler.num_dropped_spans());
+}
+
+TEST(TailSamplerTest, PassesOnLateSpansOfKeptTraces) {
+  TailSampler<int> sampler(TestOptions());
+  const absl::Time start = absl::UnixEpoch();
+  std::vector<int> out;
+  sampler.Add(MakeTraceId(1), 10, absl::Seconds(2), true, start, &out);
+  sampler.Add(MakeTraceId(2), 20, absl::Milliseconds(1), true, start, &out);
+  sampler.Decide(start + absl::Seconds(10), &out);
+  EXPECT_THAT(out, ElementsAre(10));
+  out.clear();
+
+  // A late span of the kept trace is passed on at once, while one of the
+  // dropped trace starts a new decision.
+  const absl::Time later = start + absl::Seconds(15);
+  sampler.Add(MakeTraceId(1), 11, absl::Milliseconds(1), true, later, &out);
+  sampler.Add(MakeTraceId(2), 21, absl::Milliseconds(1), true, later, &out);
+  EXPECT_THAT(out, ElementsAre(11));
+  EXPECT_EQ(1, sampler.num_held_spans());
+  out.clear();
+
+  // Once the decision wait has passed again, the kept trace is forgotten.
+  sampler.Decide(start + absl::Seconds(20), &out);
+  sampler.Add(MakeTraceId(1), 12, absl::Milliseconds(1), true,
+              start + absl::Seconds(20), &out);
+  EXPECT_THAT(out, IsEmpty());
+  sampler.DecideAll(&out);
+  EXPECT_THAT(out, IsEmpty());
+  EXPECT_EQ(3, sampler.num_dropped_spans());
+}
+
+TEST(TailSamplerTest, DecidesOldestTracesWhenFull) {
+  TailSampler<int>::Options options = TestOptions();
+  options.max_spans = 2;
+  TailSampler<int> sampler(options);
+  const absl::Time start = absl::UnixEpoch();
+  std::vector<int> out;
+  sampler.Add(MakeTraceId(1), 10, absl::Seconds(2), true, start, &out);
+  sampler.Add(MakeTraceId(2), 20, absl::Milliseconds(1), true, start, &out);
+  EXPECT_THAT(out, IsEmpty());
+  // Trace 1 is decided early to make room.
+  sampler.Add(MakeTraceId(3), 30, absl::Seconds(2), true, start, &out);
+  EXPECT_THAT(out, ElementsAre(10));
+  EXPECT_EQ(2, sampler.num_held_spans());
+  // Then trace 2, which is dropped.
+  sampler.Add(MakeTraceId(3), 31, absl::Milliseconds(1), true, start, &out);
+  EXPECT_THAT(out, ElementsAre(10));
+  EXPECT_EQ(1, sampler.num_dropped_spans());
+  // Trace 1 was kept, so its later spans are passed on.
+  sampler.Add(MakeTraceId(1), 11, absl::Milliseconds(1), true, start, &out);
+  EXPECT_THAT(out, ElementsAre(10, 11));
+  sampler.DecideAll(&out);
+  EXPECT_THAT(out, ElementsAre(10, 11, 30, 31));
+}
+
+// NameExporter records the names of exported spans.
+class NameExporter : public exporter::SpanExporter::Handler {
+ public:
+  static NameExporter* Register() {
+    auto handler = absl::make_unique<NameExporter>();
+    NameExporter* exporter = handler.get();
+    exporter::SpanExporter::RegisterHandler(std::move(handler));
+    return exporter;
+  }
+
+  std::vector<std::string> names() const {
+    absl::MutexLock l(&mu_);
+    return names_;
+  }
+
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    absl::MutexLock l(&mu_);
+    for (const auto& span : spans) {
+      names_.emplace_back(span.name());
+    }
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  std::vector<std::string> names_ GUARDED_BY(mu_);
+};
+
+TEST(TailSamplerExportTest, ExportsOnlyKeptTraces) {
+  exporter::SpanExporter::Options options;
+  options.flush_interval = absl::Hours(1);
+  options.tail_sampling_wait = absl::Hours(1);
+  options.tail_sampling_min_latency = absl::Milliseconds(10);
+  exporter::SpanExporter::SetOptions(options);
+  NameExporter* exporter = NameExporter::Register();
+  AlwaysSampler sampler;
+  StartSpanOptions opts = {&sampler};
+
+  Span fast = Span::StartSpan("Fast", nullptr, opts);
+  Span::StartSpan("FastChild", &fast, opts).End();
+  fast.End();
+  Span failed = Span::StartSpan("Failed", nullptr, opts);
+  Span failed_child = Span::StartSpan("FailedChild", &failed, opts);
+  failed_child.SetStatus(StatusCode::INTERNAL, "failed");
+  failed_child.End();
+  failed.End();
+  Span slow = Span::StartSpan("Slow", nullptr, opts);
+  absl::SleepFor(absl::Milliseconds(20));
+  slow.End();
+
+  // Shutdown decides every held trace.
+  EXPECT_TRUE(exporter::SpanExporter::Shutdown(absl::InfiniteFuture()));
+  EXPECT_THAT(exporter->names(),
+              UnorderedElementsAre("Failed", "FailedChild", "Slow"));
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
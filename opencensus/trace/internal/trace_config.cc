@@ -13,6 +13,17 @@
 // limitations under the License.
 
 #include "opencensus/trace/trace_config.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "opencensus/trace/internal/disabled_span_names.h"
+#include "opencensus/trace/internal/ended_spans.h"
+#include "opencensus/trace/internal/local_span_store_impl.h"
+#include "opencensus/trace/internal/resource_usage.h"
+#include "opencensus/trace/internal/running_span_store_impl.h"
+#include "opencensus/trace/internal/span_exporter_impl.h"
 #include "opencensus/trace/internal/trace_config_impl.h"
 #include "opencensus/trace/trace_params.h"
 
@@ -23,5 +34,31 @@ void TraceConfig::SetCurrentTraceParams(const TraceParams& params) {
   TraceConfigImpl::Get()->SetCurrentTraceParams(params);
 }
 
+TraceMemoryUsage TraceConfig::GetMemoryUsage() {
+  TraceMemoryUsage usage;
+  usage.running_spans = exporter::RunningSpanStoreImpl::Get()->MemoryUsage();
+  usage.local_spans = exporter::LocalSpanStoreImpl::Get()->MemoryUsage();
+  usage.export_queue = exporter::SpanExporterImpl::Get()->QueueMemoryUsage();
+  return usage;
+}
+
+void TraceConfig::SetThreadAllocatedBytesFunction(
+    ThreadAllocatedBytesFunction fn) {
+  ::opencensus::trace::SetThreadAllocatedBytesFunction(fn);
+}
+
+void TraceConfig::SetDisabledSpanNames(const std::vector<std::string>& names) {
+  DisabledSpanNames::Get()->Set(names);
+}
+
+void TraceConfig::SetSamplingReduction(int halvings) {
+  TraceConfigImpl::Get()->SetSamplingHalvings(
+      std::min(std::max(halvings, 0), 63));
+}
+
+void TraceConfig::SetEndedSpanBatchSize(int batch_size) {
+  EndedSpans::SetBatchSize(std::max(batch_size, 0));
+}
+
 }  // namespace trace
 }  // namespace opencensus
@@ -16,6 +16,7 @@
 
 #include <cstdint>
 
+#include "opencensus/trace/internal/fixed_trace_limits.h"
 #include "opencensus/trace/sampler.h"
 #include "opencensus/trace/trace_params.h"
 
@@ -28,14 +29,30 @@ constexpr uint32_t kMaxAnnotations = 32;
 constexpr uint32_t kMaxMessageEvents = 128;
 constexpr uint32_t kMaxLinks = 32;
 constexpr double kDefaultSamplingProbability = 1e-4;
+// No byte limits by default.
+constexpr uint32_t kMaxAttributeValueBytes = 0;
+constexpr uint32_t kMaxSpanBytes = 0;
 
 TraceParams MakeDefaultTraceParams() {
   return TraceParams{kMaxAttributes, kMaxAnnotations, kMaxMessageEvents,
                      kMaxLinks,
-                     ProbabilitySampler{kDefaultSamplingProbability}};
+                     ProbabilitySampler{kDefaultSamplingProbability},
+                     /*custom_sampler=*/nullptr, kMaxAttributeValueBytes,
+                     kMaxSpanBytes};
 }
 }  // namespace
 
+// static
+TraceParams TraceConfigImpl::WithFixedLimits(TraceParams params) {
+  if (kFixedMaxAttributes != 0) params.max_attributes = kFixedMaxAttributes;
+  if (kFixedMaxAnnotations != 0) params.max_annotations = kFixedMaxAnnotations;
+  if (kFixedMaxMessageEvents != 0) {
+    params.max_message_events = kFixedMaxMessageEvents;
+  }
+  if (kFixedMaxLinks != 0) params.max_links = kFixedMaxLinks;
+  return params;
+}
+
 TraceConfigImpl* TraceConfigImpl::Get() {
   static TraceConfigImpl* global_trace_params =
       new TraceConfigImpl(MakeDefaultTraceParams());
@@ -15,6 +15,8 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_TRACE_CONFIG_IMPL_H_
 #define OPENCENSUS_TRACE_INTERNAL_TRACE_CONFIG_IMPL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #include "opencensus/trace/internal/trace_params_impl.h"
@@ -32,17 +34,40 @@ class TraceConfigImpl {
   static TraceConfigImpl* Get();
 
   void SetCurrentTraceParams(const TraceParams& params) {
-    current_trace_params_.Set(params);
+    current_trace_params_.Set(WithFixedLimits(params));
   }
 
-  TraceParams current_trace_params() const {
+  // The reference remains valid forever; see TraceParamsImpl.
+  const TraceParams& current_trace_params() const {
     return current_trace_params_.Get();
   }
 
+  // See TraceConfig::SetSamplingReduction().
+  void SetSamplingHalvings(int halvings) {
+    sampling_halvings_.store(halvings, std::memory_order_relaxed);
+  }
+  // Set by the span exporter's backlog feedback (see
+  // SpanExporter::Options::backlog_high_water).
+  void SetBacklogHalvings(int halvings) {
+    backlog_halvings_.store(halvings, std::memory_order_relaxed);
+  }
+  // The halvings of both, applied to the default ProbabilitySampler.
+  int sampling_halvings() const {
+    return std::min(63, sampling_halvings_.load(std::memory_order_relaxed) +
+                            backlog_halvings_.load(std::memory_order_relaxed));
+  }
+
  private:
-  TraceConfigImpl(const TraceParams& params) : current_trace_params_(params) {}
+  TraceConfigImpl(const TraceParams& params)
+      : current_trace_params_(WithFixedLimits(params)) {}
+
+  // Returns 'params' with the count limits that are fixed at compile time, if
+  // any (see fixed_trace_limits.h).
+  static TraceParams WithFixedLimits(TraceParams params);
 
   TraceParamsImpl current_trace_params_;
+  std::atomic<int> sampling_halvings_{0};
+  std::atomic<int> backlog_halvings_{0};
 };
 
 }  // namespace trace
@@ -15,10 +15,14 @@
 #include "opencensus/trace/trace_config.h"
 
 #include <atomic>
+#include <cstdint>
+#include <string>
 #include <thread>
 
 #include "absl/time/clock.h"
 #include "gtest/gtest.h"
+#include "opencensus/trace/internal/running_span_store.h"
+#include "opencensus/trace/internal/trace_config_impl.h"
 #include "opencensus/trace/span.h"
 #include "opencensus/trace/trace_params.h"
 
@@ -62,6 +66,76 @@ TEST(TraceConfigTest, MultiThreaded) {
   }
 }
 
+TEST(TraceConfigTest, SnapshotsAreImmutableAndShared) {
+  TraceConfig::SetCurrentTraceParams(
+      {1, 2, 3, 4, ProbabilitySampler(1.0), nullptr});
+  const TraceParams& first = TraceConfigImpl::Get()->current_trace_params();
+  TraceConfig::SetCurrentTraceParams(
+      {5, 6, 7, 8, ProbabilitySampler(0.0), nullptr});
+  const TraceParams& second = TraceConfigImpl::Get()->current_trace_params();
+  EXPECT_EQ(5, second.max_attributes);
+  EXPECT_EQ(8, second.max_links);
+  // Earlier snapshots remain readable and unchanged.
+  EXPECT_EQ(1, first.max_attributes);
+  EXPECT_EQ(4, first.max_links);
+  // Equal TraceParams reuse a snapshot.
+  TraceConfig::SetCurrentTraceParams(
+      {1, 2, 3, 4, ProbabilitySampler(1.0), nullptr});
+  EXPECT_EQ(&first, &TraceConfigImpl::Get()->current_trace_params());
+}
+
+TEST(TraceConfigTest, MemoryUsage) {
+  static ProbabilitySampler sampler(1.0);
+  auto span = Span::StartSpan("MemoryUsageSpan", nullptr, {&sampler});
+  const TraceMemoryUsage started = TraceConfig::GetMemoryUsage();
+  EXPECT_GE(started.running_spans.spans, 1);
+  EXPECT_GT(started.running_spans.bytes, 0);
+
+  // The span's events are counted.
+  span.AddAnnotation(std::string(1000, 'a'));
+  const TraceMemoryUsage annotated = TraceConfig::GetMemoryUsage();
+  EXPECT_GE(annotated.running_spans.bytes,
+            started.running_spans.bytes + 1000);
+
+  // Once ended, the span moves to the local span store.
+  span.End();
+  const TraceMemoryUsage ended = TraceConfig::GetMemoryUsage();
+  EXPECT_EQ(started.running_spans.spans - 1, ended.running_spans.spans);
+  EXPECT_GE(ended.local_spans.spans, 1);
+  EXPECT_GT(ended.local_spans.bytes, 1000);
+}
+
+TEST(TraceConfigTest, EndedSpanBatches) {
+  static ProbabilitySampler sampler(1.0);
+  TraceConfig::SetEndedSpanBatchSize(3);
+  const int64_t running = TraceConfig::GetMemoryUsage().running_spans.spans;
+  const auto end_span = [] {
+    Span::StartSpan("EndedSpanBatchesSpan", nullptr, {&sampler}).End();
+  };
+
+  // Ended spans are staged until the thread's batch is full.
+  end_span();
+  end_span();
+  EXPECT_EQ(running + 2, TraceConfig::GetMemoryUsage().running_spans.spans);
+  end_span();
+  EXPECT_EQ(running, TraceConfig::GetMemoryUsage().running_spans.spans);
+
+  // Querying a span store hands over the spans staged.
+  end_span();
+  EXPECT_EQ(running + 1, TraceConfig::GetMemoryUsage().running_spans.spans);
+  exporter::RunningSpanStore::GetSummary();
+  EXPECT_EQ(running, TraceConfig::GetMemoryUsage().running_spans.spans);
+
+  // So does a thread exiting.
+  std::thread thread(end_span);
+  thread.join();
+  EXPECT_EQ(running, TraceConfig::GetMemoryUsage().running_spans.spans);
+
+  TraceConfig::SetEndedSpanBatchSize(0);
+  end_span();
+  EXPECT_EQ(running, TraceConfig::GetMemoryUsage().running_spans.spans);
+}
+
 }  // namespace
 }  // namespace trace
 }  // namespace opencensus
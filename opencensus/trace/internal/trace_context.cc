@@ -14,60 +14,46 @@
 
 #include "opencensus/trace/propagation/trace_context.h"
 
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "opencensus/trace/internal/hex.h"
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/span_id.h"
 #include "opencensus/trace/trace_id.h"
 #include "opencensus/trace/trace_options.h"
 
-#include "absl/strings/ascii.h"
-#include "absl/strings/escaping.h"
-#include "absl/strings/str_cat.h"
-
 namespace opencensus {
 namespace trace {
 namespace propagation {
 
 namespace {
 
-// Returns true if the string only contains valid lowercase hex digits.
-bool IsLowercaseHexDigits(absl::string_view s) {
-  for (int i = 0; i < s.length(); ++i) {
-    if (!((s[i] >= '0' && s[i] <= '9') || (s[i] >= 'a' && s[i] <= 'f'))) {
-      return false;
-    }
-  }
-  return true;
-}
-
-// Returns true if the converted string was valid hex.
-bool FromHex(absl::string_view hex, std::string* bin) {
-  if (!IsLowercaseHexDigits(hex)) return false;
-  *bin = absl::HexStringToBytes(hex);
-  return true;
-}
+constexpr int kDelimiterLen = 1;
+constexpr char kDelimiter = '-';
+constexpr int kVersionLen = 1;
+constexpr int kTraceIdLen = 16;
+constexpr int kSpanIdLen = 8;
+constexpr int kTraceOptionsLen = 1;
+constexpr int kVersionLenHex = 2 * kVersionLen;
+constexpr int kTraceIdLenHex = 2 * kTraceIdLen;
+constexpr int kSpanIdLenHex = 2 * kSpanIdLen;
+constexpr int kTraceOptionsLenHex = 2 * kTraceOptionsLen;
+constexpr int kTotalLenInHexDigits = kVersionLenHex + kTraceIdLenHex +
+                                     kSpanIdLenHex + kTraceOptionsLenHex +
+                                     3 * kDelimiterLen;
+constexpr int kVersionOfs = 0;
+constexpr int kTraceIdOfs = kVersionOfs + kVersionLenHex + kDelimiterLen;
+constexpr int kSpanIdOfs = kTraceIdOfs + kTraceIdLenHex + kDelimiterLen;
+constexpr int kOptionsOfs = kSpanIdOfs + kSpanIdLenHex + kDelimiterLen;
+static_assert(kOptionsOfs + kTraceOptionsLenHex == kTotalLenInHexDigits,
+              "bad offsets");
+static_assert(kTotalLenInHexDigits == kTraceParentHeaderLen, "bad length");
 
 }  // namespace
 
 SpanContext FromTraceParentHeader(absl::string_view header) {
-  constexpr int kDelimiterLen = 1;
-  constexpr char kDelimiter = '-';
-  constexpr int kVersionLen = 1;
-  constexpr int kTraceIdLen = 16;
-  constexpr int kSpanIdLen = 8;
-  constexpr int kTraceOptionsLen = 1;
-  constexpr int kVersionLenHex = 2 * kVersionLen;
-  constexpr int kTraceIdLenHex = 2 * kTraceIdLen;
-  constexpr int kSpanIdLenHex = 2 * kSpanIdLen;
-  constexpr int kTraceOptionsLenHex = 2 * kTraceOptionsLen;
-  constexpr int kTotalLenInHexDigits = kVersionLenHex + kTraceIdLenHex +
-                                       kSpanIdLenHex + kTraceOptionsLenHex +
-                                       3 * kDelimiterLen;
-  constexpr int kVersionOfs = 0;
-  constexpr int kTraceIdOfs = kVersionOfs + kVersionLenHex + kDelimiterLen;
-  constexpr int kSpanIdOfs = kTraceIdOfs + kTraceIdLenHex + kDelimiterLen;
-  constexpr int kOptionsOfs = kSpanIdOfs + kSpanIdLenHex + kDelimiterLen;
-  static_assert(kOptionsOfs + kTraceOptionsLenHex == kTotalLenInHexDigits,
-                "bad offsets");
   static SpanContext invalid;
   if (header.size() != kTotalLenInHexDigits || header[kVersionOfs] != '0' ||
       header[kVersionOfs + 1] != '0' ||
@@ -76,20 +62,38 @@ SpanContext FromTraceParentHeader(absl::string_view header) {
       header[kOptionsOfs - kDelimiterLen] != kDelimiter) {
     return invalid;  // Invalid length, version or format.
   }
-  std::string trace_id_bin, span_id_bin, options_bin;
-  if (!FromHex(header.substr(kTraceIdOfs, kTraceIdLenHex), &trace_id_bin) ||
-      !FromHex(header.substr(kSpanIdOfs, kSpanIdLenHex), &span_id_bin) ||
-      !FromHex(header.substr(kOptionsOfs, kTraceOptionsLenHex), &options_bin)) {
+  uint8_t trace_id_bin[kTraceIdLen];
+  uint8_t span_id_bin[kSpanIdLen];
+  uint8_t options_bin[kTraceOptionsLen];
+  if (!DecodeHex(header.substr(kTraceIdOfs, kTraceIdLenHex),
+                 /*allow_uppercase=*/false, trace_id_bin) ||
+      !DecodeHex(header.substr(kSpanIdOfs, kSpanIdLenHex),
+                 /*allow_uppercase=*/false, span_id_bin) ||
+      !DecodeHex(header.substr(kOptionsOfs, kTraceOptionsLenHex),
+                 /*allow_uppercase=*/false, options_bin)) {
     return invalid;  // Invalid hex.
   }
-  return SpanContext(
-      TraceId(reinterpret_cast<const uint8_t*>(trace_id_bin.data())),
-      SpanId(reinterpret_cast<const uint8_t*>(span_id_bin.data())),
-      TraceOptions(reinterpret_cast<const uint8_t*>(options_bin.data())));
+  return SpanContext(TraceId(trace_id_bin), SpanId(span_id_bin),
+                     TraceOptions(options_bin));
 }
 
 std::string ToTraceParentHeader(const SpanContext& ctx) {
-  return absl::StrCat("00-", ctx.ToString());
+  std::string header(kTraceParentHeaderLen, '\0');
+  ToTraceParentHeader(ctx, &header[0]);
+  return header;
+}
+
+void ToTraceParentHeader(const SpanContext& ctx, char* out) {
+  out[kVersionOfs] = '0';
+  out[kVersionOfs + 1] = '0';
+  out[kTraceIdOfs - kDelimiterLen] = kDelimiter;
+  ctx.trace_id().ToHex(out + kTraceIdOfs);
+  out[kSpanIdOfs - kDelimiterLen] = kDelimiter;
+  ctx.span_id().ToHex(out + kSpanIdOfs);
+  out[kOptionsOfs - kDelimiterLen] = kDelimiter;
+  uint8_t options[kTraceOptionsLen];
+  ctx.trace_options().CopyTo(options);
+  EncodeHex(options, kTraceOptionsLen, out + kOptionsOfs);
 }
 
 }  // namespace propagation
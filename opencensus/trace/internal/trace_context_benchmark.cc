@@ -39,6 +39,25 @@ void BM_ToTraceParentHeader(benchmark::State& state) {
 }
 BENCHMARK(BM_ToTraceParentHeader);
 
+void BM_ToTraceParentHeaderBuffer(benchmark::State& state) {
+  auto ctx = FromTraceParentHeader(kHeader);
+  char buf[kTraceParentHeaderLen];
+  while (state.KeepRunning()) {
+    ToTraceParentHeader(ctx, buf);
+    benchmark::DoNotOptimize(buf);
+  }
+}
+BENCHMARK(BM_ToTraceParentHeaderBuffer);
+
+void BM_TraceParentRoundTrip(benchmark::State& state) {
+  char buf[kTraceParentHeaderLen];
+  while (state.KeepRunning()) {
+    ToTraceParentHeader(FromTraceParentHeader(kHeader), buf);
+    benchmark::DoNotOptimize(buf);
+  }
+}
+BENCHMARK(BM_TraceParentRoundTrip);
+
 }  // namespace
 }  // namespace propagation
 }  // namespace trace
@@ -14,6 +14,7 @@
 
 #include "opencensus/trace/propagation/trace_context.h"
 
+#include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "opencensus/trace/span_context.h"
@@ -48,6 +49,15 @@ TEST(TraceParentTest, ParseTraceDisabled) {
   EXPECT_EQ(header, ToTraceParentHeader(ctx));
 }
 
+TEST(TraceParentTest, ToBuffer) {
+  constexpr char header[] =
+      "00-404142434445464748494a4b4c4d4e4f-6162636465666768-01";
+  SpanContext ctx = FromTraceParentHeader(header);
+  char buf[kTraceParentHeaderLen];
+  ToTraceParentHeader(ctx, buf);
+  EXPECT_EQ(header, absl::string_view(buf, sizeof(buf)));
+}
+
 TEST(TraceParentTest, ExpectedFailures) {
 #define INVALID(str) EXPECT_THAT(FromTraceParentHeader(str), IsInvalid())
   INVALID("");
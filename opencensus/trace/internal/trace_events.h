@@ -15,21 +15,30 @@
 #ifndef OPENCENSUS_TRACE_INTERNAL_TRACE_EVENTS_H_
 #define OPENCENSUS_TRACE_INTERNAL_TRACE_EVENTS_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <utility>
 
+#include "absl/container/inlined_vector.h"
+
 namespace opencensus {
 namespace trace {
 
-// A fixed size FIFO queue of events of type T.  T must have a valid copy
-// constructor. TraceEvents is thread-compatible.
-template <typename T>
+// TraceEvents is a FIFO of at most max_events events, which evicts the oldest
+// event when full. Events are kept in a contiguous ring buffer, whose first
+// kInlineEvents events are stored inline, so spans with few events do not
+// allocate for them.
+//
+// If kMaxEvents is not 0, max_events is fixed at kMaxEvents whatever the
+// constructor is given, and all events are stored inline: adding one never
+// allocates.
+template <typename T, size_t kInlineEvents = 2, uint32_t kMaxEvents = 0>
 class TraceEvents final {
  public:
-  TraceEvents() : total_recorded_events_(0), max_events_(0) {}
+  TraceEvents() : TraceEvents(0) {}
   explicit TraceEvents(uint32_t max_events)
-      : total_recorded_events_(0), max_events_(max_events) {}
+      : total_recorded_events_(0),
+        max_events_(kMaxEvents != 0 ? kMaxEvents : max_events) {}
 
   // Returns the number of the dropped events.
   uint32_t num_events_dropped() const;
@@ -37,63 +46,119 @@ class TraceEvents final {
   // dropped.
   uint32_t num_events_recorded() const;
 
+  // The maximum number of events held; 0 if events are not recorded.
+  uint32_t max_events() const {
+    return kMaxEvents != 0 ? kMaxEvents : max_events_;
+  }
+
   // Adds an event to the event queue. If max_events_ is exceeded, an event
   // will be evicted in a FIFO manner.
   void AddEvent(const T& event);
   void AddEvent(T&& event);
 
-  // Returns a vector of populate with all the events currently in the queue.
-  const std::deque<T>& events() const;
+  // Counts 'n' events as recorded and evicted without storing them, for the
+  // oldest events of a batch that the rest of the batch would evict anyway.
+  // Must be followed by adding at least max_events() events.
+  void SkipEvents(uint32_t n) {
+    if (max_events() != 0) total_recorded_events_ += n;
+  }
+
+  // Removes the events in the queue, e.g. once they have been exported, and
+  // frees the memory they held. They are no longer counted as recorded, nor
+  // as dropped.
+  void Clear();
+
+  // The number of events currently in the queue.
+  size_t size() const { return events_.size(); }
+  // Returns the i-th oldest event currently in the queue. Requires i < size().
+  const T& operator[](size_t i) const;
+  T& operator[](size_t i);
+
+  // The bytes allocated for events that do not fit inline, not counting heap
+  // data owned by the events themselves.
+  size_t HeapBytes() const {
+    return events_.size() > kInlineCapacity ? events_.capacity() * sizeof(T)
+                                            : 0;
+  }
 
  private:
+  static constexpr size_t kInlineCapacity =
+      kMaxEvents != 0 ? kMaxEvents : kInlineEvents;
+  typedef absl::InlinedVector<T, kInlineCapacity> Events;
+
+  // Adds 'event', overwriting the oldest event if the queue is full.
+  template <typename U>
+  void Add(U&& event);
+
   uint32_t total_recorded_events_;
   uint32_t max_events_;
-  std::deque<T> events_;
+  // Once events_ holds max_events_ events, the index of the oldest.
+  size_t oldest_ = 0;
+  Events events_;
 };
 
-template <typename T>
-inline uint32_t TraceEvents<T>::num_events_dropped() const {
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline uint32_t TraceEvents<T, kInlineEvents, kMaxEvents>::num_events_dropped()
+    const {
   return total_recorded_events_ - events_.size();
 }
 
-template <typename T>
-inline uint32_t TraceEvents<T>::num_events_recorded() const {
-  return num_events_recorded;
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline uint32_t
+TraceEvents<T, kInlineEvents, kMaxEvents>::num_events_recorded() const {
+  return total_recorded_events_;
 }
 
-template <typename T>
-inline void TraceEvents<T>::AddEvent(const T& event) {
-  // Blank span has 0 max events.
-  if (max_events_ == 0) {
-    return;
-  }
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline void TraceEvents<T, kInlineEvents, kMaxEvents>::AddEvent(
+    const T& event) {
+  Add(event);
+}
 
-  if (events_.size() >= max_events_) {
-    events_.pop_front();
-  }
-  events_.emplace_back(event);
-  total_recorded_events_++;
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline void TraceEvents<T, kInlineEvents, kMaxEvents>::AddEvent(T&& event) {
+  Add(std::move(event));
 }
 
-template <typename T>
-inline void TraceEvents<T>::AddEvent(T&& event) {
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline void TraceEvents<T, kInlineEvents, kMaxEvents>::Clear() {
+  total_recorded_events_ -= events_.size();
+  Events().swap(events_);
+  oldest_ = 0;
+}
+
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline const T& TraceEvents<T, kInlineEvents, kMaxEvents>::operator[](
+    size_t i) const {
+  i += oldest_;
+  return events_[i < events_.size() ? i : i - events_.size()];
+}
+
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+inline T& TraceEvents<T, kInlineEvents, kMaxEvents>::operator[](size_t i) {
+  i += oldest_;
+  return events_[i < events_.size() ? i : i - events_.size()];
+}
+
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+template <typename U>
+inline void TraceEvents<T, kInlineEvents, kMaxEvents>::Add(U&& event) {
   // Blank span has 0 max events.
-  if (max_events_ == 0) {
+  if (max_events() == 0) {
     return;
   }
 
-  if (events_.size() >= max_events_) {
-    events_.pop_front();
+  if (events_.size() < max_events()) {
+    events_.emplace_back(std::forward<U>(event));
+  } else {
+    events_[oldest_] = std::forward<U>(event);
+    if (++oldest_ == events_.size()) {
+      oldest_ = 0;
+    }
   }
-  events_.emplace_back(std::move(event));
   total_recorded_events_++;
 }
 
-template <typename T>
-inline const std::deque<T>& TraceEvents<T>::events() const {
-  return events_;
-}
-
 }  // namespace trace
 }  // namespace opencensus
 
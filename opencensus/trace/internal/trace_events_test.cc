@@ -0,0 +1,94 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/internal/trace_events.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+template <typename T, size_t kInlineEvents, uint32_t kMaxEvents>
+std::vector<T> Events(const TraceEvents<T, kInlineEvents, kMaxEvents>& events) {
+  std::vector<T> out;
+  for (size_t i = 0; i < events.size(); ++i) {
+    out.push_back(events[i]);
+  }
+  return out;
+}
+
+TEST(TraceEventsTest, Blank) {
+  TraceEvents<int> events;
+  events.AddEvent(1);
+  EXPECT_EQ(0, events.size());
+  EXPECT_EQ(0, events.num_events_recorded());
+  EXPECT_EQ(0, events.num_events_dropped());
+}
+
+TEST(TraceEventsTest, EvictsOldest) {
+  TraceEvents<std::string, 2> events(3);
+  events.AddEvent("a");
+  events.AddEvent("b");
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("a", "b"));
+  events.AddEvent("c");
+  events.AddEvent("d");
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("b", "c", "d"));
+  const std::string e = "e";
+  events.AddEvent(e);
+  events.AddEvent("f");
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("d", "e", "f"));
+  events.AddEvent("g");
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("e", "f", "g"));
+  EXPECT_EQ(7, events.num_events_recorded());
+  EXPECT_EQ(4, events.num_events_dropped());
+}
+
+TEST(TraceEventsTest, Clear) {
+  TraceEvents<std::string, 2> events(3);
+  for (const char* event : {"a", "b", "c", "d"}) {
+    events.AddEvent(event);
+  }
+  events.Clear();
+  EXPECT_EQ(0, events.size());
+  EXPECT_EQ(0, events.HeapBytes());
+  EXPECT_EQ(1, events.num_events_recorded());
+  EXPECT_EQ(1, events.num_events_dropped());
+  events.AddEvent("e");
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("e"));
+  EXPECT_EQ(1, events.num_events_dropped());
+}
+
+TEST(TraceEventsTest, FixedMaxEvents) {
+  // The runtime limit is ignored.
+  TraceEvents<std::string, 1, 3> events(1);
+  EXPECT_EQ(3, events.max_events());
+  for (const char* event : {"a", "b", "c", "d"}) {
+    events.AddEvent(event);
+  }
+  EXPECT_THAT(Events(events), ::testing::ElementsAre("b", "c", "d"));
+  EXPECT_EQ(1, events.num_events_dropped());
+  // All events are stored inline.
+  EXPECT_EQ(0, events.HeapBytes());
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
@@ -17,33 +17,37 @@
 #include <cstring>
 #include <string>
 
-#include "absl/strings/escaping.h"
-#include "absl/strings/string_view.h"
+#include "opencensus/trace/internal/hex.h"
 
 namespace opencensus {
 namespace trace {
 
-TraceId::TraceId(const uint8_t *buf) { memcpy(rep_, buf, kSize); }
+constexpr size_t TraceId::kSize;
+constexpr size_t TraceId::kHexSize;
 
-std::string TraceId::ToHex() const {
-  return absl::BytesToHexString(
-      absl::string_view(reinterpret_cast<const char *>(rep_), kSize));
+TraceId::TraceId(const uint8_t *buf) {
+  static_assert(kSize == 2 * sizeof(uint64_t),
+                "Internal representation must be 16 bytes.");
+  memcpy(&high_, buf, sizeof(high_));
+  memcpy(&low_, buf + sizeof(high_), sizeof(low_));
 }
 
-bool TraceId::operator==(const TraceId &that) const {
-  return memcmp(rep_, that.rep_, kSize) == 0;
+std::string TraceId::ToHex() const {
+  std::string hex(kHexSize, '\0');
+  ToHex(&hex[0]);
+  return hex;
 }
 
-bool TraceId::IsValid() const {
-  static_assert(kSize == 16, "Internal representation must be 16 bytes.");
-  uint64_t tmp1;
-  uint64_t tmp2;
-  memcpy(&tmp1, &rep_[0], 8);
-  memcpy(&tmp2, &rep_[8], 8);
-  return (tmp1 != 0 || tmp2 != 0);
+void TraceId::ToHex(char *out) const {
+  uint8_t bytes[kSize];
+  CopyTo(bytes);
+  EncodeHex(bytes, kSize, out);
 }
 
-void TraceId::CopyTo(uint8_t *buf) const { memcpy(buf, rep_, kSize); }
+void TraceId::CopyTo(uint8_t *buf) const {
+  memcpy(buf, &high_, sizeof(high_));
+  memcpy(buf + sizeof(high_), &low_, sizeof(low_));
+}
 
 }  // namespace trace
 }  // namespace opencensus
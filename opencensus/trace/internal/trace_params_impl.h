@@ -16,8 +16,12 @@
 #define OPENCENSUS_TRACE_INTERNAL_TRACE_PARAMS_IMPL_H_
 
 #include <atomic>
-#include <cstdint>
+#include <memory>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
 #include "opencensus/trace/sampler.h"
 #include "opencensus/trace/trace_params.h"
 
@@ -27,40 +31,50 @@ namespace trace {
 // TraceParamsImpl is used by TraceConfigImpl to hold the currently active
 // TraceParams.
 //
-// TraceParamsImpl can be updated or retrieved via a TraceParams object.  Atomic
-// reads or updates of multiple parameters are not supported, because reading
-// from TraceParamsImpl happens on every StartSpan and we don't want to have a
-// global lock.
+// Reading from TraceParamsImpl happens on every StartSpan, so the active
+// TraceParams is published as an immutable snapshot which readers get with a
+// single acquire load, without locking. Updates replace the snapshot as a
+// whole. Snapshots are never freed, so that readers never need to coordinate
+// with writers; instead, equal TraceParams share a snapshot, so memory is
+// bounded by the number of distinct TraceParams set.
 class TraceParamsImpl final {
  public:
   explicit TraceParamsImpl(const TraceParams& p) { Set(p); }
 
-  // TraceParamsImpl can be updated non-atomically: the
-  // individual elements are updated separately.
-  void Set(const TraceParams& p) {
-    max_attributes_.store(p.max_attributes, std::memory_order_release);
-    max_annotations_.store(p.max_annotations, std::memory_order_release);
-    max_message_events_.store(p.max_message_events, std::memory_order_release);
-    max_links_.store(p.max_links, std::memory_order_release);
-    probability_threshold_.store(p.sampler.threshold_,
-                                 std::memory_order_release);
+  void Set(const TraceParams& p) LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    for (const auto& snapshot : snapshots_) {
+      if (Equal(*snapshot, p)) {
+        current_.store(snapshot.get(), std::memory_order_release);
+        return;
+      }
+    }
+    snapshots_.push_back(absl::make_unique<const TraceParams>(p));
+    current_.store(snapshots_.back().get(), std::memory_order_release);
   }
 
-  TraceParams Get() const {
-    return TraceParams{max_attributes_.load(std::memory_order_acquire),
-                       max_annotations_.load(std::memory_order_acquire),
-                       max_message_events_.load(std::memory_order_acquire),
-                       max_links_.load(std::memory_order_acquire),
-                       ProbabilitySampler(probability_threshold_.load(
-                           std::memory_order_acquire))};
+  // Returns the active TraceParams. The reference remains valid forever,
+  // though it may no longer be the active TraceParams.
+  const TraceParams& Get() const {
+    return *current_.load(std::memory_order_acquire);
   }
 
  private:
-  std::atomic<uint32_t> max_attributes_;
-  std::atomic<uint32_t> max_annotations_;
-  std::atomic<uint32_t> max_message_events_;
-  std::atomic<uint32_t> max_links_;
-  std::atomic<uint64_t> probability_threshold_;
+  static bool Equal(const TraceParams& a, const TraceParams& b) {
+    return a.max_attributes == b.max_attributes &&
+           a.max_annotations == b.max_annotations &&
+           a.max_message_events == b.max_message_events &&
+           a.max_links == b.max_links &&
+           a.sampler.threshold_ == b.sampler.threshold_ &&
+           a.custom_sampler == b.custom_sampler &&
+           a.max_attribute_value_bytes == b.max_attribute_value_bytes &&
+           a.max_span_bytes == b.max_span_bytes;
+  }
+
+  absl::Mutex mu_;
+  // Every distinct TraceParams that has been set.
+  std::vector<std::unique_ptr<const TraceParams>> snapshots_ GUARDED_BY(mu_);
+  std::atomic<const TraceParams*> current_;
 };
 
 }  // namespace trace
@@ -0,0 +1,200 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the whole trace pipeline under load: spans are started, given
+// events, and ended on the benchmark threads, then converted and exported to
+// a no-op handler by the SpanExporter's threads.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/exporter/span_exporter.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace {
+
+// One in this many End() calls is timed for the latency percentiles.
+constexpr int kLatencySampleInterval = 16;
+// Threads add to spans_ended in batches of this many spans to avoid
+// contending on it.
+constexpr int kEndedBatch = 64;
+// How often the pipeline depth is sampled.
+constexpr absl::Duration kDepthSampleInterval = absl::Milliseconds(1);
+
+// Spans ended by the benchmark and exported to the handler, since the process
+// started. Their difference, less the spans the exporter dropped, is the
+// number of ended spans waiting in the export pipeline.
+std::atomic<uint64_t> spans_ended{0};
+std::atomic<uint64_t> spans_exported{0};
+
+class CountingHandler : public exporter::SpanExporter::Handler {
+ public:
+  void Export(const std::vector<exporter::SpanData>& spans) override {
+    spans_exported.fetch_add(spans.size(), std::memory_order_relaxed);
+  }
+};
+
+int64_t PipelineDepth() {
+  return static_cast<int64_t>(spans_ended.load(std::memory_order_relaxed) -
+                              spans_exported.load(std::memory_order_relaxed) -
+                              exporter::SpanExporter::NumDroppedSpans());
+}
+
+void RegisterHandler() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    // A large buffer, so that a backlog shows as depth rather than drops.
+    exporter::SpanExporter::Options options;
+    options.buffer_capacity = 1 << 16;
+    exporter::SpanExporter::SetOptions(options);
+    exporter::SpanExporter::RegisterHandler(
+        absl::make_unique<CountingHandler>());
+  });
+}
+
+// Samples the pipeline depth until destroyed.
+class DepthSampler {
+ public:
+  DepthSampler()
+      : thread_([this] {
+          while (!stop_.load(std::memory_order_relaxed)) {
+            const int64_t depth = std::max<int64_t>(0, PipelineDepth());
+            max_ = std::max(max_, depth);
+            sum_ += depth;
+            ++samples_;
+            absl::SleepFor(kDepthSampleInterval);
+          }
+        }) {}
+
+  // Stops sampling.
+  void Stop() {
+    stop_ = true;
+    thread_.join();
+  }
+
+  int64_t max() const { return max_; }
+  double mean() const {
+    return samples_ == 0 ? 0 : static_cast<double>(sum_) / samples_;
+  }
+
+ private:
+  std::atomic<bool> stop_{false};
+  int64_t max_ = 0;
+  int64_t sum_ = 0;
+  int64_t samples_ = 0;
+  std::thread thread_;
+};
+
+DepthSampler* depth_sampler = nullptr;
+
+double Percentile(std::vector<int64_t>* samples, double p) {
+  if (samples->empty()) {
+    return 0;
+  }
+  const size_t rank = std::min(samples->size() - 1,
+                               static_cast<size_t>(p * samples->size()));
+  std::nth_element(samples->begin(), samples->begin() + rank, samples->end());
+  return (*samples)[rank];
+}
+
+// Arguments are the number of annotations per span and the target rate of
+// spans per second for each thread (0 for as fast as possible).
+void BM_TracePipeline(benchmark::State& state) {
+  static AlwaysSampler sampler;
+  const int num_events = state.range(0);
+  const int64_t rate = state.range(1);
+  if (state.thread_index() == 0) {
+    RegisterHandler();
+    depth_sampler = new DepthSampler();
+  }
+  const absl::Duration period =
+      rate > 0 ? absl::Seconds(1) / rate : absl::ZeroDuration();
+  absl::Time next_start = absl::Now();
+  std::vector<int64_t> end_latencies_ns;
+  int iteration = 0;
+  int unreported_ended = 0;
+  for (auto _ : state) {
+    if (rate > 0) {
+      const absl::Time now = absl::Now();
+      if (now < next_start) {
+        absl::SleepFor(next_start - now);
+      }
+      // Do not burst to catch up after a stall.
+      next_start = std::max(next_start, now) + period;
+    }
+    auto span = Span::StartSpan("PipelineSpan", /*parent=*/nullptr,
+                                {&sampler});
+    for (int i = 0; i < num_events; ++i) {
+      span.AddAnnotation("event");
+    }
+    if (iteration % kLatencySampleInterval == 0) {
+      const auto start = std::chrono::steady_clock::now();
+      span.End();
+      end_latencies_ns.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+    } else {
+      span.End();
+    }
+    if (++unreported_ended == kEndedBatch) {
+      spans_ended.fetch_add(kEndedBatch, std::memory_order_relaxed);
+      unreported_ended = 0;
+    }
+    ++iteration;
+  }
+  spans_ended.fetch_add(unreported_ended, std::memory_order_relaxed);
+  state.counters["spans"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+  // Percentiles are per thread, averaged over threads.
+  state.counters["end_p50_ns"] = benchmark::Counter(
+      Percentile(&end_latencies_ns, 0.5), benchmark::Counter::kAvgThreads);
+  state.counters["end_p99_ns"] = benchmark::Counter(
+      Percentile(&end_latencies_ns, 0.99), benchmark::Counter::kAvgThreads);
+  state.counters["end_p999_ns"] = benchmark::Counter(
+      Percentile(&end_latencies_ns, 0.999), benchmark::Counter::kAvgThreads);
+  if (state.thread_index() == 0) {
+    depth_sampler->Stop();
+    state.counters["depth_mean"] = depth_sampler->mean();
+    state.counters["depth_max"] = depth_sampler->max();
+    delete depth_sampler;
+    depth_sampler = nullptr;
+    state.counters["dropped"] = exporter::SpanExporter::NumDroppedSpans();
+  }
+}
+BENCHMARK(BM_TracePipeline)
+    ->ArgNames({"events", "rate"})
+    ->ArgsProduct({{0, 8}, {0, 10000}})
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace trace
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,120 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/trace_state.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+
+namespace {
+
+constexpr size_t kMaxKeyLen = 256;
+constexpr size_t kMaxValueLen = 256;
+
+bool IsOptionalWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+absl::string_view TrimOptionalWhitespace(absl::string_view s) {
+  while (!s.empty() && IsOptionalWhitespace(s.front())) s.remove_prefix(1);
+  while (!s.empty() && IsOptionalWhitespace(s.back())) s.remove_suffix(1);
+  return s;
+}
+
+bool IsKeyStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+bool IsKeyChar(char c) {
+  return IsKeyStart(c) || c == '_' || c == '-' || c == '*' || c == '/' ||
+         c == '@';
+}
+
+bool IsValidKey(absl::string_view key) {
+  if (key.empty() || key.size() > kMaxKeyLen || !IsKeyStart(key[0])) {
+    return false;
+  }
+  for (char c : key) {
+    if (!IsKeyChar(c)) return false;
+  }
+  return true;
+}
+
+bool IsValidValue(absl::string_view value) {
+  if (value.empty() || value.size() > kMaxValueLen || value.back() == ' ') {
+    return false;
+  }
+  for (char c : value) {
+    if (c < 0x20 || c > 0x7e || c == ',' || c == '=') return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FromTraceStateHeader(absl::string_view header,
+                          std::vector<TraceStateEntry>* entries) {
+  entries->clear();
+  while (true) {
+    const size_t comma = header.find(',');
+    const absl::string_view member =
+        TrimOptionalWhitespace(header.substr(0, comma));
+    // Empty members are allowed, and ignored.
+    if (!member.empty()) {
+      const size_t equals = member.find('=');
+      if (equals == absl::string_view::npos ||
+          entries->size() >= kMaxTraceStateEntries) {
+        return false;
+      }
+      const TraceStateEntry entry = {member.substr(0, equals),
+                                     member.substr(equals + 1)};
+      if (!IsValidKey(entry.key) || !IsValidValue(entry.value)) {
+        return false;
+      }
+      for (const auto& other : *entries) {
+        if (other.key == entry.key) return false;  // Duplicate key.
+      }
+      entries->push_back(entry);
+    }
+    if (comma == absl::string_view::npos) break;
+    header.remove_prefix(comma + 1);
+  }
+  return true;
+}
+
+std::string ToTraceStateHeader(absl::Span<const TraceStateEntry> entries) {
+  size_t len = 0;
+  for (const auto& entry : entries) {
+    len += entry.key.size() + entry.value.size() + 2;
+  }
+  std::string header;
+  header.reserve(len);
+  for (const auto& entry : entries) {
+    if (!header.empty()) header.push_back(',');
+    header.append(entry.key.data(), entry.key.size());
+    header.push_back('=');
+    header.append(entry.value.data(), entry.value.size());
+  }
+  return header;
+}
+
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
@@ -0,0 +1,51 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/trace_state.h"
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+namespace {
+
+constexpr char kHeader[] =
+    "congo=t61rcWkgMzE,rojo=00f067aa0ba902b7,tenant@vendor=opaque-value";
+
+void BM_FromTraceStateHeader(benchmark::State& state) {
+  std::vector<TraceStateEntry> entries;
+  while (state.KeepRunning()) {
+    FromTraceStateHeader(kHeader, &entries);
+  }
+}
+BENCHMARK(BM_FromTraceStateHeader);
+
+void BM_ToTraceStateHeader(benchmark::State& state) {
+  std::vector<TraceStateEntry> entries;
+  FromTraceStateHeader(kHeader, &entries);
+  while (state.KeepRunning()) {
+    ToTraceStateHeader(entries);
+  }
+}
+BENCHMARK(BM_ToTraceStateHeader);
+
+}  // namespace
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
+
+BENCHMARK_MAIN();
@@ -0,0 +1,81 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/trace/propagation/trace_state.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+namespace {
+
+TEST(TraceStateTest, ParseAndSerialize) {
+  const std::string header = "congo=t61rcWkgMzE, rojo=00f067aa0ba902b7";
+  std::vector<TraceStateEntry> entries;
+  ASSERT_TRUE(FromTraceStateHeader(header, &entries));
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("congo", entries[0].key);
+  EXPECT_EQ("t61rcWkgMzE", entries[0].value);
+  EXPECT_EQ("rojo", entries[1].key);
+  EXPECT_EQ("00f067aa0ba902b7", entries[1].value);
+  // Entries point into the header.
+  EXPECT_EQ(header.data(), entries[0].key.data());
+  EXPECT_EQ("congo=t61rcWkgMzE,rojo=00f067aa0ba902b7",
+            ToTraceStateHeader(entries));
+}
+
+TEST(TraceStateTest, EmptyMembersAreIgnored) {
+  std::vector<TraceStateEntry> entries;
+  ASSERT_TRUE(FromTraceStateHeader("", &entries));
+  EXPECT_TRUE(entries.empty());
+  ASSERT_TRUE(FromTraceStateHeader(" ,tenant@vendor=a b, ,", &entries));
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ("tenant@vendor", entries[0].key);
+  EXPECT_EQ("a b", entries[0].value);
+}
+
+TEST(TraceStateTest, TooManyEntries) {
+  std::string header;
+  for (int i = 0; i < kMaxTraceStateEntries; ++i) {
+    header += "k" + std::to_string(i) + "=v,";
+  }
+  std::vector<TraceStateEntry> entries;
+  EXPECT_TRUE(FromTraceStateHeader(header, &entries));
+  EXPECT_EQ(kMaxTraceStateEntries, entries.size());
+  header += "last=v";
+  EXPECT_FALSE(FromTraceStateHeader(header, &entries));
+}
+
+TEST(TraceStateTest, ExpectedFailures) {
+  std::vector<TraceStateEntry> entries;
+#define INVALID(str) EXPECT_FALSE(FromTraceStateHeader(str, &entries))
+  INVALID("novalue") << "missing '='.";
+  INVALID("key=") << "empty value.";
+  INVALID("=value") << "empty key.";
+  INVALID("Key=value") << "uppercase key.";
+  INVALID("_key=value") << "key must start with a letter or digit.";
+  INVALID("key=val=ue") << "'=' in value.";
+  INVALID("key=value ,key=other") << "duplicate key.";
+  INVALID(std::string("key=") + std::string(257, 'v')) << "value too long.";
+#undef INVALID
+}
+
+}  // namespace
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
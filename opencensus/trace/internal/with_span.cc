@@ -26,8 +26,10 @@ using ::opencensus::trace::Span;
 namespace opencensus {
 namespace trace {
 
+#ifndef OPENCENSUS_NOOP
 WithSpan::WithSpan(const Span& span, bool cond)
-    : swapped_span_(span)
+    : borrowed_node_(cond ? Context::Current().node_ : nullptr, &span),
+      swapped_context_(cond ? Context(&borrowed_node_) : Context())
 #ifndef NDEBUG
       ,
       original_context_(Context::InternalMutableCurrent())
@@ -49,9 +51,10 @@ WithSpan::~WithSpan() {
 void WithSpan::ConditionalSwap() {
   if (cond_) {
     using std::swap;
-    swap(Context::InternalMutableCurrent()->span_, swapped_span_);
+    swap(*Context::InternalMutableCurrent(), swapped_context_);
   }
 }
+#endif  // OPENCENSUS_NOOP
 
 }  // namespace trace
 }  // namespace opencensus
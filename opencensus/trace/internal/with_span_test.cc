@@ -27,7 +27,7 @@ namespace context {
 class ContextTestPeer {
  public:
   static const opencensus::trace::SpanContext& CurrentCtx() {
-    return Context::InternalMutableCurrent()->span_.context();
+    return Context::InternalMutableCurrent()->span().context();
   }
 };
 }  // namespace context
@@ -0,0 +1,70 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_PROPAGATION_BAGGAGE_H_
+#define OPENCENSUS_TRACE_PROPAGATION_BAGGAGE_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+
+// Implementation of the W3C baggage header:
+// https://www.w3.org/TR/baggage/
+
+// The maximum number of list members and the maximum length of a baggage
+// header.
+constexpr int kMaxBaggageEntries = 64;
+constexpr int kMaxBaggageHeaderLen = 8192;
+
+// A baggage list member. All fields point into the parsed header, which must
+// outlive the entry. value is still percent-encoded, and properties is the
+// unparsed text after the first ';', if any.
+struct BaggageEntry {
+  absl::string_view key;
+  absl::string_view value;
+  absl::string_view properties;
+};
+
+// Parses the value of the "baggage: ..." header into *entries, in header
+// order, without copying. Returns false, leaving *entries unspecified, if the
+// header is malformed, longer than kMaxBaggageHeaderLen, or has more than
+// kMaxBaggageEntries members.
+//
+// The input format is a comma-separated list of members, with optional
+// whitespace around each part:
+//   key=value[;property[=value]]...
+// where key is an HTTP token and value consists of URL-safe characters and
+// percent-encoded octets.
+//
+// Example: "userId=alice,serverNode=DF%2028,isProduction=false;ttl=60"
+//
+// entries is cleared first; reusing it across calls avoids allocating.
+bool FromBaggageHeader(absl::string_view header,
+                       std::vector<BaggageEntry>* entries);
+
+// Returns a value for the baggage header. Entries are not validated, and
+// values must already be percent-encoded.
+std::string ToBaggageHeader(absl::Span<const BaggageEntry> entries);
+
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_PROPAGATION_BAGGAGE_H_
@@ -46,6 +46,20 @@ SpanContext FromCloudTraceContextHeader(absl::string_view header);
 // Returns a value for the X-Cloud-Trace-Context header.
 std::string ToCloudTraceContextHeader(const SpanContext& ctx);
 
+// The maximum length of the X-Cloud-Trace-Context value:
+//    32 (trace_id)
+//  +  1 (slash)
+//  + 20 (span_id, up to 2^64 - 1 in decimal)
+//  +  4 (options)
+//  ----
+//    57
+constexpr int kMaxCloudTraceContextHeaderLen = 57;
+
+// Fills a pre-allocated buffer with the value for the X-Cloud-Trace-Context
+// header, without a terminating NUL, and returns the number of bytes written.
+// The buffer must be at least kMaxCloudTraceContextHeaderLen bytes long.
+int ToCloudTraceContextHeader(const SpanContext& ctx, char* out);
+
 }  // namespace propagation
 }  // namespace trace
 }  // namespace opencensus
@@ -44,6 +44,23 @@ SpanContext FromTraceParentHeader(absl::string_view header);
 // Returns a value for the traceparent header.
 std::string ToTraceParentHeader(const SpanContext& ctx);
 
+// The length of the traceparent value:
+//    2 (version)
+//  + 1 (delimiter)
+//  + 32 (trace_id)
+//  + 1 (delimiter)
+//  + 16 (span_id)
+//  + 1 (delimiter)
+//  + 2 (trace_options)
+//  ----
+//    55
+constexpr int kTraceParentHeaderLen = 55;
+
+// Fills a pre-allocated buffer with the value for the traceparent header,
+// without a terminating NUL. The buffer must be at least kTraceParentHeaderLen
+// bytes long.
+void ToTraceParentHeader(const SpanContext& ctx, char* out);
+
 }  // namespace propagation
 }  // namespace trace
 }  // namespace opencensus
@@ -0,0 +1,65 @@
+// Copyright 2018, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_PROPAGATION_TRACE_STATE_H_
+#define OPENCENSUS_TRACE_PROPAGATION_TRACE_STATE_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace opencensus {
+namespace trace {
+namespace propagation {
+
+// Implementation of the tracestate header of the TraceContext propagation
+// protocol: https://www.w3.org/TR/trace-context/#tracestate-header
+
+// The maximum number of list members in a tracestate header.
+constexpr int kMaxTraceStateEntries = 32;
+
+// A tracestate list member. key and value point into the parsed header, which
+// must outlive the entry.
+struct TraceStateEntry {
+  absl::string_view key;
+  absl::string_view value;
+};
+
+// Parses the value of the "tracestate: ..." header into *entries, in header
+// order (most recently updated first), without copying. Returns false, leaving
+// *entries unspecified, if the header is malformed, has duplicate keys, or has
+// more than kMaxTraceStateEntries members.
+//
+// The input format is a comma-separated list of key=value members, with
+// optional whitespace around members:
+//   - key: up to 256 characters from [a-z0-9_-*/@], starting with [a-z0-9].
+//   - value: up to 256 printable ASCII characters other than ',' and '=',
+//     not ending with a space.
+//
+// Example: "congo=t61rcWkgMzE,rojo=00f067aa0ba902b7"
+//
+// entries is cleared first; reusing it across calls avoids allocating.
+bool FromTraceStateHeader(absl::string_view header,
+                          std::vector<TraceStateEntry>* entries);
+
+// Returns a value for the tracestate header. Entries are not validated.
+std::string ToTraceStateHeader(absl::Span<const TraceStateEntry> entries);
+
+}  // namespace propagation
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_PROPAGATION_TRACE_STATE_H_
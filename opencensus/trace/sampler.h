@@ -15,11 +15,17 @@
 #ifndef OPENCENSUS_TRACE_SAMPLER_H_
 #define OPENCENSUS_TRACE_SAMPLER_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "opencensus/trace/span_context.h"
 #include "opencensus/trace/span_id.h"
 #include "opencensus/trace/trace_id.h"
@@ -59,8 +65,33 @@ class ProbabilitySampler final : public Sampler {
 
  private:
   friend class TraceParamsImpl;  // For the global ProbabilitySampler.
+  friend class SpanGenerator;    // For ShouldSampleTraceId().
+  friend class AdaptiveSampler;  // For TraceIdValue().
+  friend class SpanNameSampler;  // For ShouldSampleTraceId().
   explicit ProbabilitySampler(uint64_t threshold) : threshold_(threshold) {}
 
+  // The decision of ShouldSample(), which only depends on the TraceId. Inline,
+  // so that starting a Span with the default sampler makes no virtual call.
+  // Each of 'halvings' (at most 63) halves the probability; since the
+  // threshold shrinks, the traces sampled are a subset of those sampled with
+  // fewer halvings.
+  bool ShouldSampleTraceId(const TraceId& trace_id, int halvings = 0) const {
+    const uint64_t threshold = threshold_ >> halvings;
+    return threshold != 0 && TraceIdValue(trace_id) <= threshold;
+  }
+
+  // The first 8 bytes of 'trace_id' as a little-endian integer, compared
+  // against thresholds.
+  static uint64_t TraceIdValue(const TraceId& trace_id) {
+    uint8_t buf[TraceId::kSize];
+    trace_id.CopyTo(buf);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(buf[i]) << (i * 8);
+    }
+    return value;
+  }
+
   // Probability is converted to a value between [0, UINT64_MAX].
   const uint64_t threshold_;
 };
@@ -93,6 +124,121 @@ class NeverSampler final : public Sampler {
   }
 };
 
+// Samples at most spans_per_second Spans per second across the process, using
+// a token bucket that holds up to one second's worth of tokens, so that traffic
+// spikes do not multiply the number of sampled Spans. Only root Spans and
+// Spans with remote parents are sampled by it: a Span whose local parent was
+// not sampled is not sampled either, so that sampled traces are complete.
+// Lock-free.
+class RateLimitingSampler final : public Sampler {
+ public:
+  explicit RateLimitingSampler(double spans_per_second);
+
+  bool ShouldSample(const SpanContext* parent_context, bool has_remote_parent,
+                    const TraceId& trace_id, const SpanId& span_id,
+                    absl::string_view name,
+                    const std::vector<Span*>& parent_links) const override;
+
+ private:
+  // The time between tokens, or 0 if nothing is sampled.
+  const int64_t interval_nanos_;
+  // The most time the bucket can have refilled for.
+  const int64_t burst_nanos_;
+  // The time at which the bucket was (or will be, after a burst) empty. Tokens
+  // accrue from then, up to burst_nanos_.
+  mutable std::atomic<int64_t> empty_time_nanos_;
+};
+
+// Samples Spans with a probability that is adjusted separately for each Span
+// name, aiming for about spans_per_second sampled Spans of each name per
+// second. The probability is re-estimated from the observed rate of each name
+// at least once per second, and sooner after a spike. As with
+// ProbabilitySampler, the decision is derived from the trace ID, and as with
+// RateLimitingSampler, only root Spans and Spans with remote parents are
+// sampled by it. Lookups of known names take a shared lock.
+class AdaptiveSampler final : public Sampler {
+ public:
+  explicit AdaptiveSampler(double spans_per_second);
+  ~AdaptiveSampler() override;
+
+  bool ShouldSample(const SpanContext* parent_context, bool has_remote_parent,
+                    const TraceId& trace_id, const SpanId& span_id,
+                    absl::string_view name,
+                    const std::vector<Span*>& parent_links) const override;
+
+ private:
+  struct NameState;
+
+  // The number of names tracked separately; further names share a state.
+  static constexpr int kMaxSpanNames = 1024;
+
+  NameState* GetState(absl::string_view name, int64_t now_nanos) const
+      LOCKS_EXCLUDED(mu_);
+
+  const double spans_per_second_;
+  // The number of Spans seen in a window after which the probability is
+  // re-estimated without waiting for the window to end.
+  const uint64_t early_adjust_count_;
+  mutable absl::Mutex mu_;
+  mutable absl::flat_hash_map<std::string, std::unique_ptr<NameState>> states_
+      GUARDED_BY(mu_);
+  const std::unique_ptr<NameState> overflow_state_;
+};
+
+// Samples Spans with a probability chosen by their name, e.g. never for health
+// checks, rarely for hot RPCs, and always for rare admin paths:
+//
+//   static const SpanNameSampler* sampler = new SpanNameSampler(
+//       {{"HealthCheck", 0}, {"Get", 1e-4}, {"Admin", 1}}, 1e-3);
+//
+// Spans whose name has no rule are sampled with 'default_probability'; if
+// several rules have the same name, the first applies. The rules are compiled
+// into an immutable hash table when the sampler is constructed, so
+// ShouldSample() costs one hash of the name, usually a single probe, and a
+// threshold comparison on the trace ID as for ProbabilitySampler, and takes no
+// lock. As with RateLimitingSampler, only root Spans and Spans with remote
+// parents are sampled by it, so that sampled traces are complete. Use it as
+// TraceParams::custom_sampler.
+class SpanNameSampler final : public Sampler {
+ public:
+  struct Rule {
+    std::string name;
+    double probability;
+  };
+
+  SpanNameSampler(const std::vector<Rule>& rules, double default_probability);
+
+  bool ShouldSample(const SpanContext* parent_context, bool has_remote_parent,
+                    const TraceId& trace_id, const SpanId& span_id,
+                    absl::string_view name,
+                    const std::vector<Span*>& parent_links) const override;
+
+ private:
+  struct CompiledRule {
+    CompiledRule(const std::string& name, double probability)
+        : name(name), sampler(probability) {}
+
+    std::string name;
+    ProbabilitySampler sampler;
+  };
+  // A slot of the open-addressed table: the hash of a rule's name and its
+  // index in rules_, or -1 if the slot is empty.
+  struct Slot {
+    size_t hash;
+    int rule;
+  };
+
+  // Returns the slot of the rule for 'name', whose hash is 'hash', or else
+  // the empty slot where it would be added.
+  size_t FindSlot(absl::string_view name, size_t hash) const;
+
+  std::vector<CompiledRule> rules_;
+  // At most half full, with a power of 2 size.
+  std::vector<Slot> table_;
+  size_t mask_;
+  const ProbabilitySampler default_sampler_;
+};
+
 }  // namespace trace
 }  // namespace opencensus
 
@@ -17,6 +17,8 @@
 
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
@@ -24,6 +26,7 @@
 #include "opencensus/trace/attribute_value_ref.h"
 #include "opencensus/trace/sampler.h"
 #include "opencensus/trace/span_context.h"
+#include "opencensus/trace/span_priority.h"
 #include "opencensus/trace/status_code.h"
 #include "opencensus/trace/trace_config.h"
 #include "opencensus/trace/trace_params.h"
@@ -51,11 +54,32 @@ class SpanTestPeer;
 using AttributesRef =
     absl::Span<const std::pair<absl::string_view, AttributeValueRef>>;
 
+namespace span_internal {
+
+// Enables the lazy overloads of Span::AddAttribute() and AddAnnotation() for
+// callables whose result converts to T.
+template <typename Fn, typename T>
+using EnableIfReturns = typename std::enable_if<std::is_convertible<
+    decltype(std::declval<Fn&>()()), T>::value>::type;
+
+}  // namespace span_internal
+
 // Options for Starting a Span.
 struct StartSpanOptions {
   StartSpanOptions(Sampler* sampler = nullptr,  // Default Sampler.
-                   const std::vector<Span*>& parent_links = {})
-      : sampler(sampler), parent_links(parent_links) {}
+                   const std::vector<Span*>& parent_links = {},
+                   bool single_writer = false,
+                   bool summarize_message_events = false,
+                   bool record_resource_usage = false,
+                   bool one_way_parent_links = false,
+                   SpanPriority priority = SpanPriority::kNormal)
+      : sampler(sampler),
+        parent_links(parent_links),
+        single_writer(single_writer),
+        summarize_message_events(summarize_message_events),
+        record_resource_usage(record_resource_usage),
+        one_way_parent_links(one_way_parent_links),
+        priority(priority) {}
 
   // The Sampler to use. It must remain valid for the duration of the
   // StartSpan() call. If nullptr, use the default Sampler from TraceConfig.
@@ -65,10 +89,51 @@ struct StartSpanOptions {
   const Sampler* sampler;
 
   // Pointers to Spans in *other Traces* that are parents of this Span. They
-  // must remain valid for the duration of the StartSpan() call.
+  // must remain valid for the duration of the StartSpan() call. The new Span
+  // gets a parent link to each, added under one lock, and each gets a child
+  // link to the new Span unless one_way_parent_links is set.
   const std::vector<Span*> parent_links;
+
+  // If true, the caller promises that the Span's attributes, annotations,
+  // message events and status are only set, and End() is only called, by one
+  // thread at a time (usually the thread that started it). These are then
+  // recorded without locking. In exchange, the Span's data other than its
+  // links is only visible to span stores (e.g. the running span store in
+  // zpages) once it has ended.
+  const bool single_writer;
+
+  // If true, only the first few message events in each direction are recorded
+  // individually; the rest are only counted in the Span's message totals (see
+  // SpanData::message_event_totals()). This bounds the cost of long-lived
+  // streams, whose further message events each cost a few atomic additions
+  // and no lock. Message events added concurrently with End() may be counted.
+  const bool summarize_message_events;
+
+  // If true and the Span records events, the CPU time used and bytes
+  // allocated by the thread between starting and ending the Span are added
+  // as the kThreadCpuTimeAttribute and kThreadAllocatedBytesAttribute
+  // attributes when it ends. This reads the thread's CPU clock at start and
+  // end, and allocations only if TraceConfig::SetThreadAllocatedBytesFunction()
+  // installed a function. Nothing is recorded if the Span ends on another
+  // thread.
+  const bool record_resource_usage;
+
+  // If true, the parent_links Spans are not given a child link to the new
+  // Span, so starting it locks none of them. Use this when linking a Span to
+  // many others (e.g. a batch consumer to its producers): the parent links
+  // recorded on the new Span are enough to join the two sides when exported.
+  const bool one_way_parent_links;
+
+  // The priority of the Span in the buffer of spans awaiting export, if
+  // SpanExporter::Options::priority_lanes is set (see span_priority.h). A Span
+  // that ends with an error or is slow gets SpanPriority::kHigh regardless.
+  const SpanPriority priority;
 };
 
+// The attributes added by StartSpanOptions::record_resource_usage.
+constexpr char kThreadCpuTimeAttribute[] = "thread.cpu_time_ns";
+constexpr char kThreadAllocatedBytesAttribute[] = "thread.allocated_bytes";
+
 // Span represents an operation. A Trace consists of one or more Spans.
 //
 // A Span is uniquely identified by a SpanContext.
@@ -111,6 +176,15 @@ class Span final {
       absl::string_view name, const SpanContext& parent_ctx,
       const StartSpanOptions& options = StartSpanOptions());
 
+  // Constructs 'count' children of 'parent' named 'name', e.g. one per backend
+  // of a fan-out, more cheaply than as many StartSpan() calls: the trace
+  // parameters are read once, the span IDs are generated together, and the
+  // recording children are added to the running span store together. The
+  // children share one sampling decision, taken as for the first of them.
+  static std::vector<Span> StartChildSpans(
+      absl::string_view name, const Span& parent, size_t count,
+      const StartSpanOptions& options = StartSpanOptions());
+
   // Spans can be copied, in order to e.g. hand the Span off to a callback.
   Span(const Span&) = default;
   Span& operator=(const Span&) = default;
@@ -123,16 +197,45 @@ class Span final {
   // Attempts to insert an attribute into the Span, unless it already exists in
   // which case it will update the value of that attribute. If the max number of
   // attributes is exceeded, one of the previous attributes will be evicted.
-  // AddAttributes is faster due to batching.
+  // AddAttributes is faster due to batching. Keys and string values passed as
+  // StaticString are referenced rather than copied.
   void AddAttribute(absl::string_view key, AttributeValueRef attribute) const;
+  void AddAttribute(StaticString key, AttributeValueRef attribute) const;
   void AddAttributes(AttributesRef attributes) const;
 
+  // Like AddAttribute(), but 'make_value' is only called if the attribute may
+  // be recorded: the Span is recording, has not ended, and has room under its
+  // TraceParams limits. It returns anything convertible to AttributeValueRef,
+  // such as a std::string. Attributes skipped because the byte budget is used
+  // up are not counted as dropped. This avoids formatting values for Spans
+  // that are not recording, at the cost of an extra check under the Span's
+  // lock when it is, e.g.:
+  //   span.AddAttribute("peer", [&]() { return peer.ToString(); });
+  template <typename ValueFn,
+            typename = span_internal::EnableIfReturns<ValueFn,
+                                                      AttributeValueRef>>
+  void AddAttribute(absl::string_view key, ValueFn&& make_value) const;
+  template <typename ValueFn,
+            typename = span_internal::EnableIfReturns<ValueFn,
+                                                      AttributeValueRef>>
+  void AddAttribute(StaticString key, ValueFn&& make_value) const;
+
   // Adds an Annotation to the Span. If the max number of Annotations is
   // exceeded, an Annotation will be evicted in a FIFO manner.
   // In future, there will be a limit of 4 attributes per annotation.
   void AddAnnotation(absl::string_view description,
                      AttributesRef attributes = {}) const;
 
+  // Like AddAnnotation(), but 'make_description' is only called if the
+  // annotation may be recorded (see the lazy AddAttribute()). It returns
+  // anything convertible to absl::string_view, such as a std::string, e.g.:
+  //   span.AddAnnotation([&]() { return absl::StrCat("Retry ", attempt); });
+  template <typename DescriptionFn,
+            typename = span_internal::EnableIfReturns<DescriptionFn,
+                                                      absl::string_view>>
+  void AddAnnotation(DescriptionFn&& make_description,
+                     AttributesRef attributes = {}) const;
+
   // Adds a MessageEvent to the Span. If the max number of MessageEvents is
   // exceeded, a MessageEvent will be evicted in a FIFO manner.
   void AddSentMessageEvent(uint32_t message_id,
@@ -150,6 +253,12 @@ class Span final {
   void AddChildLink(const SpanContext& child_ctx,
                     AttributesRef attributes = {}) const;
 
+  // Adds a Link without attributes to each SpanContext, as one update of the
+  // Span rather than one per Link. The linked Spans are not changed. Beyond
+  // the max number of Links, only the last ones are kept.
+  void AddParentLinks(absl::Span<const SpanContext> parent_ctxs) const;
+  void AddChildLinks(absl::Span<const SpanContext> child_ctxs) const;
+
   // Sets the status of the Span. See status_code.h for canonical codes.
   void SetStatus(StatusCode canonical_code,
                  absl::string_view message = "") const;
@@ -172,11 +281,16 @@ class Span final {
 
  private:
   Span() = delete;
-  Span(const SpanContext& context, SpanImpl* impl);
+  Span(const SpanContext& context, std::shared_ptr<SpanImpl> impl);
 
   // Returns span_impl_, only used for testing.
   std::shared_ptr<SpanImpl> span_impl_for_test() { return span_impl_; }
 
+  // Used by the lazy overloads: false if an attribute or annotation would
+  // certainly be dropped.
+  bool AcceptsAttributes() const;
+  bool AcceptsAnnotations() const;
+
   // Swaps contents, used for Context.
   friend void swap(Span& a, Span& b);
 
@@ -198,6 +312,94 @@ class Span final {
   friend class ::opencensus::CensusContext;
 };
 
+template <typename ValueFn, typename>
+void Span::AddAttribute(absl::string_view key, ValueFn&& make_value) const {
+  if (AcceptsAttributes()) {
+    AddAttribute(key, AttributeValueRef(make_value()));
+  }
+}
+
+template <typename ValueFn, typename>
+void Span::AddAttribute(StaticString key, ValueFn&& make_value) const {
+  if (AcceptsAttributes()) {
+    AddAttribute(key, AttributeValueRef(make_value()));
+  }
+}
+
+template <typename DescriptionFn, typename>
+void Span::AddAnnotation(DescriptionFn&& make_description,
+                         AttributesRef attributes) const {
+  if (AcceptsAnnotations()) {
+    AddAnnotation(absl::string_view(make_description()), attributes);
+  }
+}
+
+#ifdef OPENCENSUS_NOOP
+// When built with OPENCENSUS_NOOP defined (e.g. bazel --config=noop), Spans
+// never record and these inline definitions replace those in span.cc, so that
+// instrumentation compiles away. As with disabled span names, a started Span
+// takes its parent's context, which still propagates. The define must be set
+// for the whole program.
+inline Span Span::BlankSpan() { return Span(SpanContext(), nullptr); }
+
+inline Span Span::StartSpan(absl::string_view /*name*/, const Span* parent,
+                            const StartSpanOptions& /*options*/) {
+  return Span(parent == nullptr ? SpanContext() : parent->context(), nullptr);
+}
+
+inline Span Span::StartSpanWithRemoteParent(
+    absl::string_view /*name*/, const SpanContext& parent_ctx,
+    const StartSpanOptions& /*options*/) {
+  return Span(parent_ctx, nullptr);
+}
+
+inline std::vector<Span> Span::StartChildSpans(
+    absl::string_view /*name*/, const Span& parent, size_t count,
+    const StartSpanOptions& /*options*/) {
+  return std::vector<Span>(count, Span(parent.context(), nullptr));
+}
+
+inline Span::Span(const SpanContext& context, std::shared_ptr<SpanImpl> impl)
+    : context_(context), span_impl_(std::move(impl)) {}
+
+inline void Span::AddAttribute(absl::string_view /*key*/,
+                               AttributeValueRef /*attribute*/) const {}
+inline void Span::AddAttribute(StaticString /*key*/,
+                               AttributeValueRef /*attribute*/) const {}
+inline void Span::AddAttributes(AttributesRef /*attributes*/) const {}
+inline void Span::AddAnnotation(absl::string_view /*description*/,
+                                AttributesRef /*attributes*/) const {}
+inline void Span::AddSentMessageEvent(
+    uint32_t /*message_id*/, uint32_t /*compressed_message_size*/,
+    uint32_t /*uncompressed_message_size*/) const {}
+inline void Span::AddReceivedMessageEvent(
+    uint32_t /*message_id*/, uint32_t /*compressed_message_size*/,
+    uint32_t /*uncompressed_message_size*/) const {}
+inline void Span::AddParentLink(const SpanContext& /*parent_ctx*/,
+                                AttributesRef /*attributes*/) const {}
+inline void Span::AddChildLink(const SpanContext& /*child_ctx*/,
+                               AttributesRef /*attributes*/) const {}
+inline void Span::AddParentLinks(
+    absl::Span<const SpanContext> /*parent_ctxs*/) const {}
+inline void Span::AddChildLinks(
+    absl::Span<const SpanContext> /*child_ctxs*/) const {}
+inline void Span::SetStatus(StatusCode /*canonical_code*/,
+                            absl::string_view /*message*/) const {}
+inline void Span::End() const {}
+
+inline const SpanContext& Span::context() const { return context_; }
+
+inline bool Span::IsSampled() const {
+  return context_.trace_options().IsSampled();
+}
+
+inline bool Span::IsRecording() const { return false; }
+
+inline bool Span::AcceptsAttributes() const { return false; }
+
+inline bool Span::AcceptsAnnotations() const { return false; }
+#endif  // OPENCENSUS_NOOP
+
 }  // namespace trace
 }  // namespace opencensus
 
@@ -15,38 +15,60 @@
 #ifndef OPENCENSUS_TRACE_SPAN_ID_H_
 #define OPENCENSUS_TRACE_SPAN_ID_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
 
 namespace opencensus {
 namespace trace {
 
 // SpanId represents an opaque 64-bit span identifier that uniquely identifies a
 // span within a trace. SpanId is immutable.
+//
+// SpanIds are stored as a 64-bit word, so that comparing, validating, and
+// hashing them are word operations; they support absl::Hash for use as keys of
+// absl hash containers.
 class SpanId final {
  public:
   // The size in bytes of the SpanId.
   static constexpr size_t kSize = 8;
+  // The length of the hex representation of the SpanId.
+  static constexpr size_t kHexSize = 2 * kSize;
 
   // An invalid SpanId (all zeros).
-  SpanId() : rep_{0} {}
+  constexpr SpanId() : rep_(0) {}
 
   // Creates a SpanId by copying the first kSize bytes from the buffer.
   explicit SpanId(const uint8_t* buf);
 
   // Returns a 16-char hex string of the SpanId value.
   std::string ToHex() const;
+  // Writes the kHexSize lowercase hex digits of the SpanId to out, without a
+  // terminator.
+  void ToHex(char* out) const;
 
-  bool operator==(const SpanId& that) const;
+  constexpr bool operator==(const SpanId& that) const {
+    return rep_ == that.rep_;
+  }
+  constexpr bool operator!=(const SpanId& that) const {
+    return rep_ != that.rep_;
+  }
 
   // Returns false if the SpanId is all zeros.
-  bool IsValid() const;
+  constexpr bool IsValid() const { return rep_ != 0; }
 
   // Copies the opaque SpanId data to a buffer, which must hold kSize bytes.
   void CopyTo(uint8_t* buf) const;
 
+  template <typename H>
+  friend H AbslHashValue(H h, const SpanId& id) {
+    return H::combine(std::move(h), id.rep_);
+  }
+
  private:
-  uint8_t rep_[kSize];
+  // The bytes, in host byte order.
+  uint64_t rep_;
 };
 
 }  // namespace trace
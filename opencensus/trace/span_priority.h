@@ -0,0 +1,40 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_TRACE_SPAN_PRIORITY_H_
+#define OPENCENSUS_TRACE_SPAN_PRIORITY_H_
+
+#include <cstdint>
+
+namespace opencensus {
+namespace trace {
+
+// The priority of an ended Span in the buffer of spans awaiting export, when
+// SpanExporter::Options::priority_lanes is set. While the buffer is full, a
+// Span makes room by dropping a Span of lower priority, and higher priority
+// Spans are exported first.
+enum class SpanPriority : uint8_t {
+  kLow = 0,
+  kNormal = 1,
+  // Also given to Spans that end with a status other than OK, or that take at
+  // least their name's slow span threshold.
+  kHigh = 2,
+};
+
+constexpr int kNumSpanPriorities = 3;
+
+}  // namespace trace
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_TRACE_SPAN_PRIORITY_H_
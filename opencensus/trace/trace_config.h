@@ -15,18 +15,81 @@
 #ifndef OPENCENSUS_TRACE_TRACE_CONFIG_H_
 #define OPENCENSUS_TRACE_TRACE_CONFIG_H_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "opencensus/trace/trace_params.h"
 
 namespace opencensus {
 namespace trace {
 
+// The approximate memory held by the span stores and the span exporter's
+// queue, as returned by TraceConfig::GetMemoryUsage(). A span held by more
+// than one of them is counted in each.
+struct TraceMemoryUsage final {
+  struct Store {
+    int64_t spans = 0;
+    int64_t bytes = 0;
+  };
+
+  // Spans that have started but not ended (see RunningSpanStore). The events
+  // and attributes of single-writer spans are only counted once they end.
+  Store running_spans;
+  // Ended spans sampled by the LocalSpanStore.
+  Store local_spans;
+  // Ended spans waiting in the span exporter's queue. Since the queue is
+  // lock-free, the queued spans are counted by size rather than content.
+  Store export_queue;
+};
+
 // TraceConfig holds the currently active TraceParams.
 // TraceConfig is thread-safe.
 class TraceConfig {
  public:
-  // Sets the currently active TraceParams. Doing this is not atomic: individual
-  // parts of the active TraceParams are updated separately.
+  // Sets the currently active TraceParams. All parts of the active TraceParams
+  // are updated together. In builds that fix the count limits at compile time
+  // (OPENCENSUS_TRACE_FIXED_LIMITS), those of 'params' are ignored.
   static void SetCurrentTraceParams(const TraceParams& params);
+
+  // Returns the approximate memory held by the span stores and the export
+  // queue. Each store is locked briefly in turn, so the counts are not a
+  // consistent snapshot across stores.
+  static TraceMemoryUsage GetMemoryUsage();
+
+  // Returns the bytes allocated by the calling thread so far, e.g. from the
+  // allocator's per-thread statistics. Must be thread-safe.
+  typedef int64_t (*ThreadAllocatedBytesFunction)();
+
+  // Sets the function that Spans started with
+  // StartSpanOptions::record_resource_usage use to measure their allocations.
+  // If null (the default), allocations are not recorded.
+  static void SetThreadAllocatedBytesFunction(
+      ThreadAllocatedBytesFunction fn);
+
+  // Disables the span names in 'names', replacing those of any earlier call,
+  // to shed the cost of tracing them under overload. StartSpan() for a
+  // disabled name returns before sampling or allocating a Span that records
+  // nothing, with its parent's SpanContext (or an invalid one, for a root
+  // span), so that its children attach to the parent. The check costs a load
+  // and a bit test unless a disabled name has the same length (mod 64).
+  static void SetDisabledSpanNames(const std::vector<std::string>& names);
+
+  // Halves the probability of the current TraceParams' ProbabilitySampler
+  // 'halvings' times (clamped to [0, 63]), to shed the cost of tracing under
+  // overload without replacing the sampler; 0 restores it. Only applies while
+  // TraceParams has no custom sampler, to Spans whose parent is not sampled.
+  // Used by stats::EnableOverheadGovernor().
+  static void SetSamplingReduction(int halvings);
+
+  // Stages up to 'batch_size' Spans ended on each thread before handing them
+  // to the span stores and the span exporter together, so that each takes its
+  // locks once per batch rather than once per Span; 0 or 1 (the default) hands
+  // each Span over as it ends. The Spans staged by all threads are handed over
+  // whenever the span stores are queried and before each export, and a
+  // thread's when it exits. Until then, GetMemoryUsage() counts an ended Span
+  // as running.
+  static void SetEndedSpanBatchSize(int batch_size);
 };
 
 }  // namespace trace
@@ -15,38 +15,61 @@
 #ifndef OPENCENSUS_TRACE_TRACE_ID_H_
 #define OPENCENSUS_TRACE_TRACE_ID_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
 
 namespace opencensus {
 namespace trace {
 
 // TraceId represents an opaque 128-bit trace identifier. The trace identifier
 // remains constant across the trace. TraceId is immutable.
+//
+// TraceIds are stored as two 64-bit words, so that comparing, validating, and
+// hashing them are word operations; they support absl::Hash for use as keys of
+// absl hash containers.
 class TraceId final {
  public:
   // The size in bytes of the TraceId.
   static constexpr size_t kSize = 16;
+  // The length of the hex representation of the TraceId.
+  static constexpr size_t kHexSize = 2 * kSize;
 
   // An invalid TraceId (all zeros).
-  TraceId() : rep_{0} {}
+  constexpr TraceId() : high_(0), low_(0) {}
 
   // Creates a TraceId by copying the first kSize bytes from the buffer.
   explicit TraceId(const uint8_t* buf);
 
   // Returns a 32-char hex string of the TraceId value.
   std::string ToHex() const;
+  // Writes the kHexSize lowercase hex digits of the TraceId to out, without a
+  // terminator.
+  void ToHex(char* out) const;
 
-  bool operator==(const TraceId& that) const;
+  constexpr bool operator==(const TraceId& that) const {
+    return high_ == that.high_ && low_ == that.low_;
+  }
+  constexpr bool operator!=(const TraceId& that) const {
+    return !(*this == that);
+  }
 
   // Returns false if the TraceId is all zeros.
-  bool IsValid() const;
+  constexpr bool IsValid() const { return (high_ | low_) != 0; }
 
   // Copies the opaque TraceId data to a buffer, which must hold kSize bytes.
   void CopyTo(uint8_t* buf) const;
 
+  template <typename H>
+  friend H AbslHashValue(H h, const TraceId& id) {
+    return H::combine(std::move(h), id.high_, id.low_);
+  }
+
  private:
-  uint8_t rep_[kSize];
+  // The first and last 8 bytes, in host byte order.
+  uint64_t high_;
+  uint64_t low_;
 };
 
 }  // namespace trace
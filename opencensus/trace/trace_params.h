@@ -23,8 +23,9 @@ namespace opencensus {
 namespace trace {
 
 // TraceParams holds the limits for attributes, annotations, message_events,
-// links, and a ProbabilitySampler. For performance, only ProbabilitySampler is
-// supported as the globally active sampler.
+// links, and the bytes recorded in a span, and the globally active sampler: a
+// ProbabilitySampler, or optionally another Sampler such as a
+// RateLimitingSampler, AdaptiveSampler, or SpanNameSampler.
 //
 // The currently active TraceParams is set in TraceConfig.
 struct TraceParams final {
@@ -33,6 +34,18 @@ struct TraceParams final {
   uint32_t max_message_events;
   uint32_t max_links;
   ProbabilitySampler sampler;
+  // If not nullptr, used instead of 'sampler'. Because Spans may be started
+  // concurrently with changes to the TraceParams, it must never be destroyed
+  // once it has been active.
+  const Sampler* custom_sampler;
+  // The maximum length in bytes of a string attribute value or annotation
+  // description; longer strings are truncated. 0 means no limit.
+  uint32_t max_attribute_value_bytes;
+  // The maximum total bytes of attribute keys and string values and
+  // annotation descriptions recorded in a span, after truncation. Attributes
+  // and annotations that do not fit are dropped. 0 means no limit. The bytes
+  // truncated or dropped are reported by SpanData::num_bytes_dropped().
+  uint32_t max_span_bytes;
 };
 
 }  // namespace trace
@@ -25,6 +25,10 @@ namespace trace {
 // until the WithSpan object is destroyed. If the condition is false, it doesn't
 // do anything.
 //
+// WithSpan borrows the Span rather than copying it, so activating it does not
+// allocate or touch the Span's reference count; the Span must outlive the
+// WithSpan. Copies of the current Context (e.g. via Wrap()) copy the Span.
+//
 // Because WithSpan changes the current (thread local) context, NEVER allocate a
 // WithSpan in one thread and deallocate in another. A simple way to ensure this
 // is to only ever stack-allocate it.
@@ -37,6 +41,8 @@ namespace trace {
 class WithSpan {
  public:
   explicit WithSpan(const Span& span, bool cond = true);
+  // A temporary Span would be destroyed while it is current.
+  WithSpan(const Span&& span, bool cond = true) = delete;
   ~WithSpan();
 
   // No Span&& constructor because it encourages "consuming" the Span with a
@@ -50,15 +56,26 @@ class WithSpan {
   WithSpan& operator=(const WithSpan&) = delete;
   WithSpan& operator=(WithSpan&&) = delete;
 
+#ifndef OPENCENSUS_NOOP
   void ConditionalSwap();
 
-  Span swapped_span_;
+  // Installed as the current Context while this WithSpan is active.
+  ::opencensus::context::Context::Node borrowed_node_;
+  // The Context to install, and then the one to restore.
+  ::opencensus::context::Context swapped_context_;
 #ifndef NDEBUG
   const ::opencensus::context::Context* original_context_;
 #endif
   const bool cond_;
+#endif
 };
 
+#ifdef OPENCENSUS_NOOP
+// Built with OPENCENSUS_NOOP (see span.h), WithSpan does nothing.
+inline WithSpan::WithSpan(const Span& /*span*/, bool /*cond*/) {}
+inline WithSpan::~WithSpan() {}
+#endif
+
 }  // namespace trace
 }  // namespace opencensus
 
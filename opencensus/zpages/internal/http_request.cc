@@ -0,0 +1,120 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/http_request.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace zpages {
+
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+}  // namespace
+
+bool HttpRequest::Parse(absl::string_view head) {
+  const absl::string_view line = head.substr(0, head.find_first_of("\r\n"));
+  const std::vector<absl::string_view> parts =
+      absl::StrSplit(line, ' ', absl::SkipEmpty());
+  if (parts.size() != 3 || !absl::StartsWith(parts[2], "HTTP/") ||
+      parts[1].empty() || parts[1][0] != '/') {
+    return false;
+  }
+  method_ = std::string(parts[0]);
+  const absl::string_view target = parts[1];
+  const size_t query_start = target.find('?');
+  path_ = UrlDecode(target.substr(0, query_start));
+  params_.clear();
+  if (query_start == absl::string_view::npos) {
+    return true;
+  }
+  for (absl::string_view param :
+       absl::StrSplit(target.substr(query_start + 1), '&', absl::SkipEmpty())) {
+    const size_t eq = param.find('=');
+    const std::string name = UrlDecode(param.substr(0, eq));
+    // The first value of a repeated parameter wins.
+    params_.emplace(name, eq == absl::string_view::npos
+                              ? std::string()
+                              : UrlDecode(param.substr(eq + 1)));
+  }
+  return true;
+}
+
+std::string HttpRequest::Param(absl::string_view name) const {
+  const auto it = params_.find(std::string(name));
+  return it == params_.end() ? std::string() : it->second;
+}
+
+int HttpRequest::IntParam(absl::string_view name, int default_value, int min,
+                          int max) const {
+  int value;
+  if (!absl::SimpleAtoi(Param(name), &value)) {
+    return default_value;
+  }
+  return std::min(std::max(value, min), max);
+}
+
+std::string UrlEncode(absl::string_view text) {
+  static constexpr char kHexDigits[] = "0123456789ABCDEF";
+  std::string encoded;
+  encoded.reserve(text.size());
+  for (const char c : text) {
+    if (absl::ascii_isalnum(c) || c == '-' || c == '_' || c == '.' ||
+        c == '~') {
+      encoded.push_back(c);
+    } else {
+      const unsigned char byte = static_cast<unsigned char>(c);
+      encoded.push_back('%');
+      encoded.push_back(kHexDigits[byte >> 4]);
+      encoded.push_back(kHexDigits[byte & 0xf]);
+    }
+  }
+  return encoded;
+}
+
+std::string UrlDecode(absl::string_view text) {
+  std::string decoded;
+  decoded.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '+') {
+      decoded.push_back(' ');
+    } else if (text[i] == '%' && i + 2 < text.size() &&
+               HexValue(text[i + 1]) >= 0 && HexValue(text[i + 2]) >= 0) {
+      decoded.push_back(static_cast<char>(HexValue(text[i + 1]) * 16 +
+                                          HexValue(text[i + 2])));
+      i += 2;
+    } else {
+      decoded.push_back(text[i]);
+    }
+  }
+  return decoded;
+}
+
+}  // namespace zpages
+}  // namespace opencensus
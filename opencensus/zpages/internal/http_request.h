@@ -0,0 +1,64 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_ZPAGES_INTERNAL_HTTP_REQUEST_H_
+#define OPENCENSUS_ZPAGES_INTERNAL_HTTP_REQUEST_H_
+
+#include <map>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace zpages {
+
+// HttpRequest holds the parts of an HTTP request that z-pages use: the method,
+// the path, and the decoded query parameters.
+//
+// Thread-compatible.
+class HttpRequest final {
+ public:
+  // Parses the request line at the start of 'head', e.g.
+  // "GET /tracez?name=foo HTTP/1.1". Returns false if it is malformed.
+  bool Parse(absl::string_view head);
+
+  const std::string& method() const { return method_; }
+  const std::string& path() const { return path_; }
+
+  // Returns the query parameter 'name', or "" if it is absent.
+  std::string Param(absl::string_view name) const;
+  // Returns the integer query parameter 'name', clamped to [min, max], or
+  // 'default_value' if it is absent or not an integer.
+  int IntParam(absl::string_view name, int default_value, int min,
+               int max) const;
+
+ private:
+  std::string method_;
+  std::string path_;
+  std::map<std::string, std::string> params_;
+};
+
+// Percent-encodes all but unreserved characters of 'text', for use in a query
+// parameter (or, since the result has no HTML special characters, in an HTML
+// attribute).
+std::string UrlEncode(absl::string_view text);
+
+// Decodes a percent-encoded query component, in which '+' is a space.
+// Malformed escapes are kept as they are.
+std::string UrlDecode(absl::string_view text);
+
+}  // namespace zpages
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_ZPAGES_INTERNAL_HTTP_REQUEST_H_
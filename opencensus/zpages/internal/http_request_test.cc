@@ -0,0 +1,73 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/http_request.h"
+
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace zpages {
+namespace {
+
+TEST(HttpRequestTest, Parse) {
+  HttpRequest request;
+  ASSERT_TRUE(request.Parse(
+      "GET /tracez?name=a%20b&type=running&limit=5&name=c HTTP/1.1\r\n"
+      "Host: localhost\r\n\r\n"));
+  EXPECT_EQ("GET", request.method());
+  EXPECT_EQ("/tracez", request.path());
+  // The first value of a repeated parameter wins.
+  EXPECT_EQ("a b", request.Param("name"));
+  EXPECT_EQ("running", request.Param("type"));
+  EXPECT_EQ("", request.Param("missing"));
+  EXPECT_EQ(5, request.IntParam("limit", 20, 1, 100));
+
+  ASSERT_TRUE(request.Parse("GET / HTTP/1.0\r\n\r\n"));
+  EXPECT_EQ("/", request.path());
+  EXPECT_EQ("", request.Param("name"));
+}
+
+TEST(HttpRequestTest, Malformed) {
+  HttpRequest request;
+  EXPECT_FALSE(request.Parse(""));
+  EXPECT_FALSE(request.Parse("GET /tracez\r\n\r\n"));
+  EXPECT_FALSE(request.Parse("GET tracez HTTP/1.1\r\n\r\n"));
+  EXPECT_FALSE(request.Parse("GET /tracez FTP/1.1\r\n\r\n"));
+}
+
+TEST(HttpRequestTest, IntParam) {
+  HttpRequest request;
+  ASSERT_TRUE(request.Parse(
+      "GET /statsz?big=1000&small=-3&bad=1x&empty= HTTP/1.1\r\n\r\n"));
+  EXPECT_EQ(100, request.IntParam("big", 7, 0, 100));
+  EXPECT_EQ(0, request.IntParam("small", 7, 0, 100));
+  EXPECT_EQ(7, request.IntParam("bad", 7, 0, 100));
+  EXPECT_EQ(7, request.IntParam("empty", 7, 0, 100));
+  EXPECT_EQ(7, request.IntParam("missing", 7, 0, 100));
+}
+
+TEST(HttpRequestTest, UrlEncoding) {
+  EXPECT_EQ("a-b_c.d~e", UrlEncode("a-b_c.d~e"));
+  EXPECT_EQ("grpc.io%2Fclient%20%3C%26%3E%22",
+            UrlEncode("grpc.io/client <&>\""));
+  EXPECT_EQ("\xff", UrlDecode(UrlEncode("\xff")));
+  EXPECT_EQ("grpc.io/client <&>", UrlDecode("grpc.io%2fclient+%3C%26%3E"));
+  // Malformed escapes are kept.
+  EXPECT_EQ("100%", UrlDecode("100%"));
+  EXPECT_EQ("%zz%4", UrlDecode("%zz%4"));
+}
+
+}  // namespace
+}  // namespace zpages
+}  // namespace opencensus
@@ -0,0 +1,107 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/page_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace zpages {
+
+constexpr size_t PageWriter::kChunkSize;
+
+PageWriter::PageWriter(Sink sink) : sink_(std::move(sink)) {
+  buffer_.reserve(kChunkSize);
+}
+
+PageWriter::~PageWriter() { Flush(); }
+
+void PageWriter::WriteEscaped(absl::string_view text) {
+  for (const char c : text) {
+    switch (c) {
+      case '&':
+        buffer_.append("&amp;");
+        break;
+      case '<':
+        buffer_.append("&lt;");
+        break;
+      case '>':
+        buffer_.append("&gt;");
+        break;
+      case '"':
+        buffer_.append("&quot;");
+        break;
+      case '\'':
+        buffer_.append("&#39;");
+        break;
+      default:
+        buffer_.push_back(c);
+    }
+  }
+  MaybeFlush();
+}
+
+bool PageWriter::Flush() {
+  if (ok_ && !buffer_.empty()) {
+    ok_ = sink_(buffer_);
+  }
+  buffer_.clear();
+  return ok_;
+}
+
+void WritePageHeader(absl::string_view title, PageWriter* out) {
+  out->Write(
+      "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>");
+  out->WriteEscaped(title);
+  out->Write(
+      "</title><style>"
+      "body{font-family:sans-serif;font-size:14px}"
+      "table{border-collapse:collapse;margin-bottom:1em}"
+      "th,td{border:1px solid #ccc;padding:2px 6px;text-align:left;"
+      "vertical-align:top}"
+      "th{background:#eee}td.num{text-align:right}"
+      ".event{color:#555}"
+      "</style></head><body>\n"
+      "<p><a href=\"/tracez\">tracez</a> | <a href=\"/rpcz\">rpcz</a> | "
+      "<a href=\"/statsz\">statsz</a></p>\n<h1>");
+  out->WriteEscaped(title);
+  out->Write("</h1>\n");
+}
+
+void WritePageFooter(PageWriter* out) { out->Write("</body></html>\n"); }
+
+void WritePager(absl::string_view base_url, int offset, int limit,
+                bool has_more, PageWriter* out) {
+  if (offset == 0 && !has_more) {
+    return;
+  }
+  out->Write("<p>");
+  if (offset > 0) {
+    out->Write("<a href=\"", base_url, "offset=", std::max(0, offset - limit),
+               "&amp;limit=", limit, "\">&laquo; Previous</a> ");
+  }
+  if (has_more) {
+    out->Write("<a href=\"", base_url, "offset=", offset + limit,
+               "&amp;limit=", limit, "\">Next &raquo;</a>");
+  }
+  out->Write("</p>\n");
+}
+
+}  // namespace zpages
+}  // namespace opencensus
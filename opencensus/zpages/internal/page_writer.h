@@ -0,0 +1,86 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_ZPAGES_INTERNAL_PAGE_WRITER_H_
+#define OPENCENSUS_ZPAGES_INTERNAL_PAGE_WRITER_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace opencensus {
+namespace zpages {
+
+// PageWriter buffers the HTML of a page and passes it to a sink in chunks of
+// about kChunkSize bytes, so that pages are sent while they are rendered
+// rather than built up in memory. Once the sink fails (e.g. because the client
+// went away), further output is discarded and ok() returns false, so that
+// renderers can stop early.
+//
+// Thread-compatible.
+class PageWriter final {
+ public:
+  // Sends a chunk of output, returning false on failure.
+  typedef std::function<bool(absl::string_view)> Sink;
+
+  static constexpr size_t kChunkSize = 16 * 1024;
+
+  explicit PageWriter(Sink sink);
+  // Flushes any buffered output.
+  ~PageWriter();
+
+  PageWriter(const PageWriter&) = delete;
+  PageWriter& operator=(const PageWriter&) = delete;
+
+  // Appends the arguments verbatim, as absl::StrAppend() would.
+  template <typename... Args>
+  void Write(const Args&... args) {
+    absl::StrAppend(&buffer_, args...);
+    MaybeFlush();
+  }
+  // Appends 'text' with HTML special characters escaped.
+  void WriteEscaped(absl::string_view text);
+
+  // Passes buffered output to the sink. Returns ok().
+  bool Flush();
+  bool ok() const { return ok_; }
+
+ private:
+  void MaybeFlush() {
+    if (buffer_.size() >= kChunkSize) Flush();
+  }
+
+  const Sink sink_;
+  std::string buffer_;
+  bool ok_ = true;
+};
+
+// Writes the start of a page titled 'title' (which is escaped), with links to
+// the other pages, and the end of a page.
+void WritePageHeader(absl::string_view title, PageWriter* out);
+void WritePageFooter(PageWriter* out);
+
+// Writes links to the previous and next pages of a list, if any. 'base_url'
+// holds the query parameters other than offset and limit, e.g. "/statsz?" or
+// "/tracez?name=foo&amp;", already escaped for an HTML attribute.
+void WritePager(absl::string_view base_url, int offset, int limit,
+                bool has_more, PageWriter* out);
+
+}  // namespace zpages
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_ZPAGES_INTERNAL_PAGE_WRITER_H_
@@ -0,0 +1,96 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/page_writer.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace zpages {
+namespace {
+
+using ::testing::HasSubstr;
+
+TEST(PageWriterTest, WritesInChunks) {
+  std::vector<std::string> chunks;
+  {
+    PageWriter out([&chunks](absl::string_view chunk) {
+      chunks.emplace_back(chunk);
+      return true;
+    });
+    out.Write("<p>", 42, "</p>");
+    EXPECT_TRUE(chunks.empty());
+    out.Write(std::string(PageWriter::kChunkSize, 'x'));
+    ASSERT_EQ(1, chunks.size());
+    EXPECT_EQ(PageWriter::kChunkSize + 9, chunks[0].size());
+    out.Write("end");
+  }
+  // The rest is flushed on destruction.
+  ASSERT_EQ(2, chunks.size());
+  EXPECT_EQ("end", chunks[1]);
+}
+
+TEST(PageWriterTest, WriteEscaped) {
+  std::string page;
+  {
+    PageWriter out([&page](absl::string_view chunk) {
+      page.append(chunk.data(), chunk.size());
+      return true;
+    });
+    out.WriteEscaped("<a href=\"x\">Tom & Jerry's</a>");
+  }
+  EXPECT_EQ("&lt;a href=&quot;x&quot;&gt;Tom &amp; Jerry&#39;s&lt;/a&gt;",
+            page);
+}
+
+TEST(PageWriterTest, StopsAfterSinkFails) {
+  int calls = 0;
+  PageWriter out([&calls](absl::string_view) {
+    ++calls;
+    return false;
+  });
+  out.Write("a");
+  EXPECT_TRUE(out.ok());
+  EXPECT_FALSE(out.Flush());
+  EXPECT_FALSE(out.ok());
+  out.Write(std::string(PageWriter::kChunkSize, 'x'));
+  EXPECT_FALSE(out.Flush());
+  EXPECT_EQ(1, calls);
+}
+
+TEST(PageWriterTest, Pager) {
+  std::string page;
+  {
+    PageWriter out([&page](absl::string_view chunk) {
+      page.append(chunk.data(), chunk.size());
+      return true;
+    });
+    WritePager("/statsz?", 0, 10, /*has_more=*/false, &out);
+    out.Flush();
+    EXPECT_EQ("", page);
+    WritePager("/tracez?name=a&amp;", 5, 10, /*has_more=*/true, &out);
+  }
+  EXPECT_THAT(page, HasSubstr("\"/tracez?name=a&amp;offset=0&amp;limit=10\""));
+  EXPECT_THAT(page,
+              HasSubstr("\"/tracez?name=a&amp;offset=15&amp;limit=10\""));
+}
+
+}  // namespace
+}  // namespace zpages
+}  // namespace opencensus
@@ -0,0 +1,290 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/statsz_page.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+
+namespace {
+
+using ::opencensus::stats::Distribution;
+using ::opencensus::stats::ExponentialHistogram;
+using ::opencensus::stats::StatsExporter;
+using ::opencensus::stats::ViewData;
+using ::opencensus::stats::ViewDescriptor;
+
+constexpr int kDefaultViewLimit = 50;
+constexpr int kMaxViewLimit = 500;
+constexpr int kDefaultRowLimit = 100;
+constexpr int kMaxRowLimit = 1000;
+// The rows of each view shown on /rpcz, which links to the rest.
+constexpr int kRpczRowLimit = 20;
+
+constexpr char kRpcViewPrefix[] = "grpc.io/";
+
+std::string FormatTimestamp(absl::Time time) {
+  return absl::FormatTime("%Y-%m-%d %H:%M:%E6S", time, absl::UTCTimeZone());
+}
+
+size_t NumRows(const ViewData& data) {
+  switch (data.type()) {
+    case ViewData::Type::kDouble:
+      return data.double_data().size();
+    case ViewData::Type::kInt64:
+      return data.int_data().size();
+    case ViewData::Type::kDistribution:
+      return data.distribution_data().size();
+    case ViewData::Type::kExponentialHistogram:
+      return data.exponential_histogram_data().size();
+  }
+  return 0;
+}
+
+// Functions to write the value columns of different aggregation types.
+void WriteValueHeaders(ViewData::Type type, PageWriter* out) {
+  switch (type) {
+    case ViewData::Type::kDouble:
+    case ViewData::Type::kInt64:
+      out->Write("<th>Value</th>");
+      return;
+    case ViewData::Type::kDistribution:
+      out->Write("<th>Count</th><th>Mean</th><th>Min</th><th>Max</th>");
+      return;
+    case ViewData::Type::kExponentialHistogram:
+      out->Write("<th>Count</th><th>Mean</th><th>p50</th><th>p90</th>"
+                 "<th>p99</th>");
+      return;
+  }
+}
+void WriteValue(double value, PageWriter* out) {
+  out->Write("<td class=\"num\">", value, "</td>");
+}
+void WriteValue(int64_t value, PageWriter* out) {
+  out->Write("<td class=\"num\">", value, "</td>");
+}
+void WriteValue(const Distribution& value, PageWriter* out) {
+  out->Write("<td class=\"num\">", value.count(), "</td><td class=\"num\">",
+             value.mean(), "</td>");
+  if (value.count() == 0) {
+    out->Write("<td></td><td></td>");
+  } else {
+    out->Write("<td class=\"num\">", value.min(), "</td><td class=\"num\">",
+               value.max(), "</td>");
+  }
+}
+void WriteValue(const ExponentialHistogram& value, PageWriter* out) {
+  out->Write("<td class=\"num\">", value.count(), "</td>");
+  if (value.count() == 0) {
+    out->Write("<td></td><td></td><td></td><td></td>");
+    return;
+  }
+  out->Write("<td class=\"num\">", value.sum() / value.count(), "</td>");
+  for (const double q : {0.5, 0.9, 0.99}) {
+    out->Write("<td class=\"num\">", value.Quantile(q), "</td>");
+  }
+}
+
+// Writes rows [offset, offset + limit) of 'data', in order of tag values so
+// that pages of successive reads line up. Only pointers to the rows are
+// sorted, and only as far as the page requires. Returns true if there are more
+// rows.
+template <typename DataValueT>
+bool WriteRows(const ViewDescriptor& descriptor, ViewData::Type type,
+               const ViewData::DataMap<DataValueT>& data, int offset,
+               int limit, PageWriter* out) {
+  out->Write("<table><tr>");
+  for (const auto& column : descriptor.columns()) {
+    out->Write("<th>");
+    out->WriteEscaped(column.name());
+    out->Write("</th>");
+  }
+  WriteValueHeaders(type, out);
+  out->Write("</tr>\n");
+  typedef typename ViewData::DataMap<DataValueT>::value_type Row;
+  std::vector<const Row*> rows;
+  rows.reserve(data.size());
+  for (const Row& row : data) {
+    rows.push_back(&row);
+  }
+  const size_t begin = std::min<size_t>(offset, rows.size());
+  const size_t end = std::min<size_t>(begin + limit, rows.size());
+  std::partial_sort(
+      rows.begin(), rows.begin() + end, rows.end(),
+      [](const Row* a, const Row* b) { return a->first < b->first; });
+  for (size_t i = begin; i < end && out->ok(); ++i) {
+    out->Write("<tr>");
+    for (const std::string& tag_value : rows[i]->first) {
+      out->Write("<td>");
+      out->WriteEscaped(tag_value);
+      out->Write("</td>");
+    }
+    WriteValue(rows[i]->second, out);
+    out->Write("</tr>\n");
+  }
+  out->Write("</table>\n");
+  return end < rows.size();
+}
+
+bool WriteRows(const ViewDescriptor& descriptor, const ViewData& data,
+               int offset, int limit, PageWriter* out) {
+  switch (data.type()) {
+    case ViewData::Type::kDouble:
+      return WriteRows(descriptor, data.type(), data.double_data(), offset,
+                       limit, out);
+    case ViewData::Type::kInt64:
+      return WriteRows(descriptor, data.type(), data.int_data(), offset, limit,
+                       out);
+    case ViewData::Type::kDistribution:
+      return WriteRows(descriptor, data.type(), data.distribution_data(),
+                       offset, limit, out);
+    case ViewData::Type::kExponentialHistogram:
+      return WriteRows(descriptor, data.type(),
+                       data.exponential_histogram_data(), offset, limit, out);
+  }
+  return false;
+}
+
+std::string ViewUrl(absl::string_view name) {
+  return absl::StrCat("/statsz?name=", UrlEncode(name));
+}
+
+void WriteViewDescription(const ViewDescriptor& descriptor,
+                          const ViewData& data, PageWriter* out) {
+  out->Write("<p>");
+  if (!descriptor.description().empty()) {
+    out->WriteEscaped(descriptor.description());
+    out->Write("<br>");
+  }
+  out->Write("Measure: ");
+  out->WriteEscaped(descriptor.measure_descriptor().name());
+  out->Write(" (");
+  out->WriteEscaped(descriptor.measure_descriptor().units());
+  out->Write(")<br>Aggregation: ");
+  out->WriteEscaped(descriptor.aggregation().DebugString());
+  out->Write("<br>From ", FormatTimestamp(data.start_time()), " to ",
+             FormatTimestamp(data.end_time()), "</p>\n");
+}
+
+// Renders a page of the views whose names start with 'prefix', reading one
+// view at a time. If 'row_limit' is positive, the first rows of each view are
+// shown too.
+void WriteViews(const HttpRequest& request, absl::string_view base_url,
+                absl::string_view prefix, int row_limit, PageWriter* out) {
+  const int offset =
+      request.IntParam("offset", 0, 0, std::numeric_limits<int>::max());
+  const int limit =
+      request.IntParam("limit", kDefaultViewLimit, 1, kMaxViewLimit);
+  std::vector<std::string> names = StatsExporter::GetViewNames();
+  names.erase(std::remove_if(names.begin(), names.end(),
+                             [prefix](const std::string& name) {
+                               return !absl::StartsWith(name, prefix);
+                             }),
+              names.end());
+  if (names.empty()) {
+    out->Write("<p>No matching views are registered.</p>\n");
+    return;
+  }
+  const size_t begin = std::min<size_t>(offset, names.size());
+  const size_t end = std::min<size_t>(begin + limit, names.size());
+  if (row_limit <= 0) {
+    out->Write("<table><tr><th>View</th><th>Measure</th><th>Aggregation</th>"
+               "<th>Rows</th></tr>\n");
+  }
+  for (size_t i = begin; i < end && out->ok(); ++i) {
+    // The view may have been removed since it was listed.
+    const auto data = StatsExporter::GetViewData(names[i]);
+    if (!data.has_value()) continue;
+    const ViewDescriptor& descriptor = data->first;
+    if (row_limit <= 0) {
+      out->Write("<tr><td><a href=\"", ViewUrl(names[i]), "\">");
+      out->WriteEscaped(names[i]);
+      out->Write("</a></td><td>");
+      out->WriteEscaped(descriptor.measure_descriptor().name());
+      out->Write("</td><td>");
+      out->WriteEscaped(descriptor.aggregation().DebugString());
+      out->Write("</td><td class=\"num\">", NumRows(data->second),
+                 "</td></tr>\n");
+      continue;
+    }
+    out->Write("<h2><a href=\"", ViewUrl(names[i]), "\">");
+    out->WriteEscaped(names[i]);
+    out->Write("</a></h2>\n");
+    WriteViewDescription(descriptor, data->second, out);
+    if (WriteRows(descriptor, data->second, 0, row_limit, out)) {
+      out->Write("<p><a href=\"", ViewUrl(names[i]), "\">All ",
+                 NumRows(data->second), " rows</a></p>\n");
+    }
+  }
+  if (row_limit <= 0) {
+    out->Write("</table>\n");
+  }
+  WritePager(base_url, offset, limit, end < names.size(), out);
+}
+
+void WriteView(const HttpRequest& request, PageWriter* out) {
+  const std::string name = request.Param("name");
+  out->Write("<h2>");
+  out->WriteEscaped(name);
+  out->Write("</h2>\n");
+  const auto data = StatsExporter::GetViewData(name);
+  if (!data.has_value()) {
+    out->Write("<p>No such view.</p>\n");
+    return;
+  }
+  WriteViewDescription(data->first, data->second, out);
+  const int offset =
+      request.IntParam("offset", 0, 0, std::numeric_limits<int>::max());
+  const int limit =
+      request.IntParam("limit", kDefaultRowLimit, 1, kMaxRowLimit);
+  const bool has_more =
+      WriteRows(data->first, data->second, offset, limit, out);
+  WritePager(absl::StrCat(ViewUrl(name), "&amp;"), offset, limit, has_more,
+             out);
+}
+
+}  // namespace
+
+void RenderStatsz(const HttpRequest& request, PageWriter* out) {
+  WritePageHeader("Stats", out);
+  if (request.Param("name").empty()) {
+    WriteViews(request, "/statsz?", "", /*row_limit=*/0, out);
+  } else {
+    WriteView(request, out);
+  }
+  WritePageFooter(out);
+}
+
+void RenderRpcz(const HttpRequest& request, PageWriter* out) {
+  WritePageHeader("RPC stats", out);
+  WriteViews(request, "/rpcz?", kRpcViewPrefix, kRpczRowLimit, out);
+  WritePageFooter(out);
+}
+
+}  // namespace zpages
+}  // namespace opencensus
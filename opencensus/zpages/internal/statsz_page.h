@@ -0,0 +1,36 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_ZPAGES_INTERNAL_STATSZ_PAGE_H_
+#define OPENCENSUS_ZPAGES_INTERNAL_STATSZ_PAGE_H_
+
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+
+// Renders /statsz. Without parameters, renders a page of at most 'limit' of
+// the registered views (and callback gauges), starting at 'offset' in name
+// order. With 'name', renders a page of that view's rows.
+void RenderStatsz(const HttpRequest& request, PageWriter* out);
+
+// Renders /rpcz: a page of the gRPC views (those named "grpc.io/..."), with
+// the rows of each.
+void RenderRpcz(const HttpRequest& request, PageWriter* out);
+
+}  // namespace zpages
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_ZPAGES_INTERNAL_STATSZ_PAGE_H_
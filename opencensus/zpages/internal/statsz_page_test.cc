@@ -0,0 +1,130 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/statsz_page.h"
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/stats/stats.h"
+#include "opencensus/stats/testing/test_utils.h"
+#include "opencensus/tags/tag_key.h"
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+std::string Render(void (*render)(const HttpRequest&, PageWriter*),
+                   absl::string_view request_line) {
+  HttpRequest request;
+  EXPECT_TRUE(request.Parse(request_line));
+  std::string page;
+  {
+    PageWriter out([&page](absl::string_view chunk) {
+      page.append(chunk.data(), chunk.size());
+      return true;
+    });
+    render(request, &out);
+  }
+  return page;
+}
+
+class StatszPageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    static const stats::MeasureDouble measure =
+        stats::MeasureDouble::Register("zpages_test_latency", "", "ms");
+    const auto method = opencensus::tags::TagKey::Register("method");
+    count_ = stats::ViewDescriptor()
+                 .set_name("example.com/count")
+                 .set_measure("zpages_test_latency")
+                 .set_aggregation(stats::Aggregation::Count())
+                 .add_column(method)
+                 .set_description("Calls & stuff");
+    rpc_ = stats::ViewDescriptor()
+               .set_name("grpc.io/client/roundtrip_latency")
+               .set_measure("zpages_test_latency")
+               .set_aggregation(stats::Aggregation::Distribution(
+                   stats::BucketBoundaries::Explicit({10})))
+               .add_column(method);
+    count_.RegisterForExport();
+    rpc_.RegisterForExport();
+    stats::Record({{measure, 2.0}}, {{method, "Get"}});
+    stats::Record({{measure, 4.0}}, {{method, "Get"}});
+    stats::Record({{measure, 1.0}}, {{method, "<Put>"}});
+    stats::testing::TestUtils::Flush();
+  }
+
+  void TearDown() override {
+    stats::StatsExporter::RemoveView(count_.name());
+    stats::StatsExporter::RemoveView(rpc_.name());
+  }
+
+  stats::ViewDescriptor count_;
+  stats::ViewDescriptor rpc_;
+};
+
+TEST_F(StatszPageTest, ListsViews) {
+  const std::string page = Render(RenderStatsz, "GET /statsz HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("<a href=\"/statsz?name=example.com%2Fcount\">"
+                              "example.com/count</a>"));
+  EXPECT_THAT(page, HasSubstr("grpc.io/client/roundtrip_latency</a>"));
+  // The number of rows.
+  EXPECT_THAT(page, HasSubstr("<td class=\"num\">2</td>"));
+
+  const std::string first =
+      Render(RenderStatsz, "GET /statsz?limit=1 HTTP/1.1");
+  EXPECT_THAT(first, HasSubstr("example.com/count</a>"));
+  EXPECT_THAT(first, Not(HasSubstr("grpc.io/client/roundtrip_latency</a>")));
+  EXPECT_THAT(first, HasSubstr("offset=1&amp;limit=1\">Next"));
+}
+
+TEST_F(StatszPageTest, ViewRows) {
+  std::string page = Render(
+      RenderStatsz, "GET /statsz?name=example.com%2Fcount HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("Calls &amp; stuff"));
+  EXPECT_THAT(page, HasSubstr("<th>method</th><th>Value</th>"));
+  // Rows are sorted by tag values.
+  EXPECT_THAT(page, HasSubstr("<tr><td>&lt;Put&gt;</td><td class=\"num\">1</td>"
+                              "</tr>\n<tr><td>Get</td><td class=\"num\">2"));
+
+  page = Render(RenderStatsz,
+                "GET /statsz?name=example.com%2Fcount&limit=1 HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("&lt;Put&gt;"));
+  EXPECT_THAT(page, Not(HasSubstr("<td>Get</td>")));
+  EXPECT_THAT(page, HasSubstr("offset=1&amp;limit=1\">Next"));
+
+  page = Render(RenderStatsz, "GET /statsz?name=missing HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("No such view."));
+}
+
+TEST_F(StatszPageTest, Rpcz) {
+  const std::string page = Render(RenderRpcz, "GET /rpcz HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("grpc.io/client/roundtrip_latency</a></h2>"));
+  EXPECT_THAT(page, Not(HasSubstr("example.com/count")));
+  EXPECT_THAT(page, HasSubstr("<th>Count</th><th>Mean</th>"));
+  EXPECT_THAT(page, HasSubstr("<tr><td>Get</td><td class=\"num\">2</td>"
+                              "<td class=\"num\">3</td>"));
+}
+
+}  // namespace
+}  // namespace zpages
+}  // namespace opencensus
@@ -0,0 +1,276 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/tracez_page.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "opencensus/trace/exporter/annotation.h"
+#include "opencensus/trace/exporter/attribute_value.h"
+#include "opencensus/trace/exporter/message_event.h"
+#include "opencensus/trace/exporter/span_data.h"
+#include "opencensus/trace/internal/local_span_store.h"
+#include "opencensus/trace/internal/running_span_store.h"
+#include "opencensus/trace/status_code.h"
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+
+namespace {
+
+using ::opencensus::trace::exporter::Annotation;
+using ::opencensus::trace::exporter::AttributeValue;
+using ::opencensus::trace::exporter::LocalSpanStore;
+using ::opencensus::trace::exporter::MessageEvent;
+using ::opencensus::trace::exporter::RunningSpanStore;
+using ::opencensus::trace::exporter::SpanData;
+
+constexpr int kDefaultLimit = 20;
+constexpr int kMaxLimit = 100;
+
+constexpr int kNumLatencyBuckets =
+    LocalSpanStore::LatencyBucketBoundary::k100s_plus + 1;
+
+struct LatencyBucket {
+  const char* label;
+  uint64_t lower_ns;
+  uint64_t upper_ns;
+};
+
+// Indexed by LocalSpanStore::LatencyBucketBoundary.
+const LatencyBucket kLatencyBuckets[kNumLatencyBuckets] = {
+    {"[0, 10us)", 0, 10000},
+    {"[10us, 100us)", 10000, 100000},
+    {"[100us, 1ms)", 100000, 1000000},
+    {"[1ms, 10ms)", 1000000, 10000000},
+    {"[10ms, 100ms)", 10000000, 100000000},
+    {"[100ms, 1s)", 100000000, 1000000000},
+    {"[1s, 10s)", 1000000000, 10000000000},
+    {"[10s, 100s)", 10000000000, 100000000000},
+    {"[100s, inf)", 100000000000, std::numeric_limits<uint64_t>::max()},
+};
+
+std::string FormatTimestamp(absl::Time time) {
+  return absl::FormatTime("%Y-%m-%d %H:%M:%E6S", time, absl::UTCTimeZone());
+}
+
+// Writes a table cell holding 'count', linking to the spans it counts.
+void WriteCountCell(int count, absl::string_view url, PageWriter* out) {
+  if (count == 0) {
+    out->Write("<td class=\"num\">0</td>");
+  } else {
+    out->Write("<td class=\"num\"><a href=\"", url, "\">", count, "</a></td>");
+  }
+}
+
+void WriteSummary(PageWriter* out) {
+  const RunningSpanStore::Summary running = RunningSpanStore::GetSummary();
+  const LocalSpanStore::Summary sampled = LocalSpanStore::GetSummary();
+  std::set<std::string> names;
+  for (const auto& name_summary : running.per_span_name_summary) {
+    names.insert(name_summary.first);
+  }
+  for (const auto& name_summary : sampled.per_span_name_summary) {
+    names.insert(name_summary.first);
+  }
+  if (names.empty()) {
+    out->Write("<p>No spans have been recorded.</p>\n");
+    return;
+  }
+  out->Write("<table><tr><th>Span name</th><th>Running</th>");
+  for (const LatencyBucket& bucket : kLatencyBuckets) {
+    out->Write("<th>", bucket.label, "</th>");
+  }
+  out->Write("<th>Errors</th></tr>\n");
+  for (const std::string& name : names) {
+    const std::string base_url =
+        absl::StrCat("/tracez?name=", UrlEncode(name), "&amp;type=");
+    out->Write("<tr><td>");
+    out->WriteEscaped(name);
+    out->Write("</td>");
+    const auto running_it = running.per_span_name_summary.find(name);
+    WriteCountCell(running_it == running.per_span_name_summary.end()
+                       ? 0
+                       : running_it->second.num_running_spans,
+                   absl::StrCat(base_url, "running"), out);
+    const auto sampled_it = sampled.per_span_name_summary.find(name);
+    const LocalSpanStore::PerSpanNameSummary empty;
+    const LocalSpanStore::PerSpanNameSummary& summary =
+        sampled_it == sampled.per_span_name_summary.end() ? empty
+                                                          : sampled_it->second;
+    for (int bucket = 0; bucket < kNumLatencyBuckets; ++bucket) {
+      const auto it = summary.number_of_latency_sampled_spans.find(
+          static_cast<LocalSpanStore::LatencyBucketBoundary>(bucket));
+      WriteCountCell(
+          it == summary.number_of_latency_sampled_spans.end() ? 0 : it->second,
+          absl::StrCat(base_url, "latency&amp;bucket=", bucket), out);
+    }
+    int errors = 0;
+    for (const auto& code_count : summary.number_of_error_sampled_spans) {
+      errors += code_count.second;
+    }
+    WriteCountCell(errors, absl::StrCat(base_url, "error"), out);
+    out->Write("</tr>\n");
+    if (!out->ok()) return;
+  }
+  out->Write("</table>\n");
+}
+
+void WriteAttributes(
+    const std::unordered_map<std::string, AttributeValue>& attributes,
+    PageWriter* out) {
+  // Sorted, so that the attributes of similar spans line up.
+  std::vector<const std::pair<const std::string, AttributeValue>*> sorted;
+  sorted.reserve(attributes.size());
+  for (const auto& attribute : attributes) {
+    sorted.push_back(&attribute);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<const std::string, AttributeValue>* a,
+               const std::pair<const std::string, AttributeValue>* b) {
+              return a->first < b->first;
+            });
+  for (const auto* attribute : sorted) {
+    out->Write(" ");
+    out->WriteEscaped(attribute->first);
+    out->Write("=");
+    out->WriteEscaped(attribute->second.DebugString());
+  }
+}
+
+void WriteEvent(absl::Time start, absl::Time time, const Annotation& event,
+                PageWriter* out) {
+  out->Write("<tr class=\"event\"><td>",
+             absl::FormatDuration(time - start), "</td><td>");
+  out->WriteEscaped(event.description());
+  WriteAttributes(event.attributes(), out);
+  out->Write("</td></tr>\n");
+}
+
+void WriteEvent(absl::Time start, absl::Time time, const MessageEvent& event,
+                PageWriter* out) {
+  out->Write("<tr class=\"event\"><td>",
+             absl::FormatDuration(time - start), "</td><td>");
+  out->WriteEscaped(event.DebugString());
+  out->Write("</td></tr>\n");
+}
+
+// Writes a span and its events, merged in time order.
+void WriteSpan(const SpanData& span, absl::Time now, PageWriter* out) {
+  const absl::Time start = span.start_time();
+  const absl::Duration latency =
+      (span.has_ended() ? span.end_time() : now) - start;
+  out->Write("<tr><td>", FormatTimestamp(start), "<br>",
+             absl::FormatDuration(latency),
+             span.has_ended() ? "" : " (running)",
+             "</td><td>trace_id=", span.context().trace_id().ToHex(),
+             " span_id=", span.context().span_id().ToHex(),
+             " parent_span_id=", span.parent_span_id().ToHex(), " status=");
+  out->WriteEscaped(span.status().ToString());
+  WriteAttributes(span.attributes(), out);
+  out->Write("</td></tr>\n");
+  const auto& annotations = span.annotations().events();
+  const auto& messages = span.message_events().events();
+  auto annotation = annotations.begin();
+  auto message = messages.begin();
+  while (annotation != annotations.end() || message != messages.end()) {
+    if (message == messages.end() ||
+        (annotation != annotations.end() &&
+         annotation->timestamp() <= message->timestamp())) {
+      WriteEvent(start, annotation->timestamp(), annotation->event(), out);
+      ++annotation;
+    } else {
+      WriteEvent(start, message->timestamp(), message->event(), out);
+      ++message;
+    }
+  }
+}
+
+void WriteSpans(const HttpRequest& request, PageWriter* out) {
+  const std::string name = request.Param("name");
+  const std::string type = request.Param("type");
+  const int offset =
+      request.IntParam("offset", 0, 0, std::numeric_limits<int>::max());
+  const int limit = request.IntParam("limit", kDefaultLimit, 1, kMaxLimit);
+  const int bucket =
+      request.IntParam("bucket", 0, 0, kNumLatencyBuckets - 1);
+  const absl::Time now = absl::Now();
+
+  out->Write("<h2>");
+  out->WriteEscaped(name);
+  out->Write(": ");
+  if (type == "latency") {
+    out->Write(kLatencyBuckets[bucket].label);
+  } else {
+    out->WriteEscaped(type);
+  }
+  out->Write("</h2>\n<table><tr><th>Start, latency</th><th>Span</th></tr>\n");
+  // One more span than fits is requested to tell whether there is a next page.
+  int visited = 0;
+  const auto visitor = [&](const SpanData& span) {
+    if (++visited <= limit && out->ok()) {
+      WriteSpan(span, now, out);
+    }
+  };
+  if (type == "running") {
+    RunningSpanStore::VisitRunningSpans({name, limit + 1}, offset, visitor);
+  } else if (type == "latency") {
+    LocalSpanStore::VisitLatencySampledSpans(
+        {name, limit + 1, kLatencyBuckets[bucket].lower_ns,
+         kLatencyBuckets[bucket].upper_ns},
+        offset, visitor);
+  } else if (type == "error") {
+    LocalSpanStore::VisitErrorSampledSpans(
+        {name, limit + 1, trace::StatusCode::OK, /*all_errors=*/true}, offset,
+        visitor);
+  }
+  out->Write("</table>\n");
+  if (visited == 0) {
+    out->Write("<p>No matching spans.</p>\n");
+  }
+  std::string base_url =
+      absl::StrCat("/tracez?name=", UrlEncode(name), "&amp;type=",
+                   UrlEncode(type), "&amp;");
+  if (type == "latency") {
+    absl::StrAppend(&base_url, "bucket=", bucket, "&amp;");
+  }
+  WritePager(base_url, offset, limit, visited > limit, out);
+}
+
+}  // namespace
+
+void RenderTracez(const HttpRequest& request, PageWriter* out) {
+  WritePageHeader("Trace spans", out);
+  if (request.Param("name").empty() && request.Param("type").empty()) {
+    WriteSummary(out);
+  } else {
+    WriteSpans(request, out);
+  }
+  WritePageFooter(out);
+}
+
+}  // namespace zpages
+}  // namespace opencensus
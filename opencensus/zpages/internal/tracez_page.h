@@ -0,0 +1,34 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_ZPAGES_INTERNAL_TRACEZ_PAGE_H_
+#define OPENCENSUS_ZPAGES_INTERNAL_TRACEZ_PAGE_H_
+
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+
+// Renders /tracez. Without parameters, renders a table of the number of
+// running, latency-sampled and error-sampled spans of each span name. With
+// 'name' and 'type' ("running", "latency" with a 'bucket' index of
+// LocalSpanStore::LatencyBucketBoundary, or "error"), renders a page of at most
+// 'limit' of those spans starting at 'offset', one span at a time.
+void RenderTracez(const HttpRequest& request, PageWriter* out);
+
+}  // namespace zpages
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_ZPAGES_INTERNAL_TRACEZ_PAGE_H_
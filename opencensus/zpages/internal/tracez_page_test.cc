@@ -0,0 +1,108 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/internal/tracez_page.h"
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencensus/trace/sampler.h"
+#include "opencensus/trace/span.h"
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+
+namespace opencensus {
+namespace zpages {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+std::string Render(absl::string_view request_line) {
+  HttpRequest request;
+  EXPECT_TRUE(request.Parse(request_line));
+  std::string page;
+  {
+    PageWriter out([&page](absl::string_view chunk) {
+      page.append(chunk.data(), chunk.size());
+      return true;
+    });
+    RenderTracez(request, &out);
+  }
+  return page;
+}
+
+TEST(TracezPageTest, Summary) {
+  static trace::AlwaysSampler sampler;
+  auto running = trace::Span::StartSpan("Running<Span>", nullptr, {&sampler});
+  auto failed = trace::Span::StartSpan("Failed", nullptr, {&sampler});
+  failed.SetStatus(trace::StatusCode::UNAVAILABLE, "unavailable");
+  failed.End();
+
+  const std::string page = Render("GET /tracez HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("<td>Running&lt;Span&gt;</td>"));
+  EXPECT_THAT(page,
+              HasSubstr("href=\"/tracez?name=Running%3CSpan%3E&amp;"
+                        "type=running\">1</a>"));
+  EXPECT_THAT(page,
+              HasSubstr("href=\"/tracez?name=Failed&amp;type=error\">1</a>"));
+  running.End();
+}
+
+TEST(TracezPageTest, SpansArePaged) {
+  static trace::AlwaysSampler sampler;
+  for (int i = 0; i < 3; ++i) {
+    auto span = trace::Span::StartSpan("Paged", nullptr, {&sampler});
+    span.AddAnnotation("annotation", {{"index", i}});
+    span.SetStatus(trace::StatusCode::INTERNAL, "internal");
+    span.End();
+  }
+
+  std::string page =
+      Render("GET /tracez?name=Paged&type=error&limit=2 HTTP/1.1");
+  // Most recent first.
+  EXPECT_THAT(page, HasSubstr("index=2"));
+  EXPECT_THAT(page, HasSubstr("index=1"));
+  EXPECT_THAT(page, Not(HasSubstr("index=0")));
+  EXPECT_THAT(page, HasSubstr("status=INTERNAL"));
+  EXPECT_THAT(page, HasSubstr("offset=2&amp;limit=2\">Next"));
+  EXPECT_THAT(page, Not(HasSubstr("Previous")));
+
+  page = Render("GET /tracez?name=Paged&type=error&limit=2&offset=2 HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("index=0"));
+  EXPECT_THAT(page, Not(HasSubstr("index=1")));
+  EXPECT_THAT(page, Not(HasSubstr("Next")));
+  EXPECT_THAT(page, HasSubstr("offset=0&amp;limit=2\">&laquo; Previous"));
+
+  page = Render("GET /tracez?name=Paged&type=latency&bucket=0 HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("No matching spans."));
+}
+
+TEST(TracezPageTest, RunningSpans) {
+  static trace::AlwaysSampler sampler;
+  auto span = trace::Span::StartSpan("StillRunning", nullptr, {&sampler});
+  span.AddAttribute("key", "value");
+  const std::string page =
+      Render("GET /tracez?name=StillRunning&type=running HTTP/1.1");
+  EXPECT_THAT(page, HasSubstr("(running)"));
+  EXPECT_THAT(page, HasSubstr("key=&quot;value&quot;"));
+  EXPECT_THAT(page, HasSubstr(span.context().span_id().ToHex()));
+  span.End();
+}
+
+}  // namespace
+}  // namespace zpages
+}  // namespace opencensus
@@ -0,0 +1,237 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/zpages_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "opencensus/zpages/internal/http_request.h"
+#include "opencensus/zpages/internal/page_writer.h"
+#include "opencensus/zpages/internal/statsz_page.h"
+#include "opencensus/zpages/internal/tracez_page.h"
+
+namespace opencensus {
+namespace zpages {
+
+namespace {
+
+// Requests are small, so longer ones are rejected rather than buffered.
+constexpr size_t kMaxRequestBytes = 8192;
+constexpr int kSocketTimeoutSeconds = 5;
+constexpr int kListenBacklog = 16;
+
+void SetError(std::string* error, absl::string_view what) {
+  if (error != nullptr) {
+    *error = absl::StrCat(what, ": ", strerror(errno));
+  }
+}
+
+// Sends all of 'data', returning false if the client went away or timed out.
+bool SendAll(int fd, absl::string_view data) {
+  while (!data.empty()) {
+    const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data.remove_prefix(sent);
+  }
+  return true;
+}
+
+// Reads the request head, up to the blank line that ends it. Returns false if
+// the client went away, timed out, or sent too much.
+bool ReadRequestHead(int fd, std::string* head) {
+  char buffer[1024];
+  while (head->find("\r\n\r\n") == std::string::npos &&
+         head->find("\n\n") == std::string::npos) {
+    if (head->size() >= kMaxRequestBytes) {
+      return false;
+    }
+    const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) {
+      return false;
+    }
+    head->append(buffer, received);
+  }
+  return true;
+}
+
+void SendError(int fd, absl::string_view status) {
+  SendAll(fd, absl::StrCat("HTTP/1.1 ", status,
+                           "\r\nContent-Type: text/plain\r\n"
+                           "Connection: close\r\n\r\n",
+                           status, "\n"));
+}
+
+void RenderIndex(PageWriter* out) {
+  WritePageHeader("z-pages", out);
+  out->Write(
+      "<ul><li><a href=\"/tracez\">tracez</a>: running and sampled spans</li>"
+      "<li><a href=\"/rpcz\">rpcz</a>: gRPC stats</li>"
+      "<li><a href=\"/statsz\">statsz</a>: all views</li></ul>\n");
+  WritePageFooter(out);
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<ZPagesServer> ZPagesServer::Start(
+    const ZPagesServerOptions& options, std::string* error) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(options.port);
+  if (options.port < 0 || options.port > 65535 ||
+      inet_pton(AF_INET, options.address.c_str(), &addr.sin_addr) != 1) {
+    if (error != nullptr) {
+      *error = absl::StrCat("invalid address ", options.address, ":",
+                            options.port);
+    }
+    return nullptr;
+  }
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    SetError(error, "socket() failed");
+    return nullptr;
+  }
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  socklen_t addr_len = sizeof(addr);
+  int wake_fds[2];
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    SetError(error, absl::StrCat("bind() to ", options.address, ":",
+                                 options.port, " failed"));
+  } else if (listen(fd, kListenBacklog) != 0) {
+    SetError(error, "listen() failed");
+  } else if (getsockname(fd, reinterpret_cast<sockaddr*>(&addr),
+                         &addr_len) != 0) {
+    SetError(error, "getsockname() failed");
+  } else if (pipe(wake_fds) != 0) {
+    SetError(error, "pipe() failed");
+  } else {
+    return std::unique_ptr<ZPagesServer>(
+        new ZPagesServer(fd, ntohs(addr.sin_port), wake_fds[0], wake_fds[1]));
+  }
+  close(fd);
+  return nullptr;
+}
+
+ZPagesServer::ZPagesServer(int listen_fd, int port, int wake_read_fd,
+                           int wake_write_fd)
+    : listen_fd_(listen_fd),
+      port_(port),
+      wake_read_fd_(wake_read_fd),
+      wake_write_fd_(wake_write_fd),
+      thread_(&ZPagesServer::Run, this) {}
+
+ZPagesServer::~ZPagesServer() {
+  const char wake = 0;
+  while (write(wake_write_fd_, &wake, 1) < 0 && errno == EINTR) {
+  }
+  thread_.join();
+  close(listen_fd_);
+  close(wake_read_fd_);
+  close(wake_write_fd_);
+}
+
+void ZPagesServer::Run() {
+  pollfd fds[2];
+  fds[0].fd = listen_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = wake_read_fd_;
+  fds[1].events = POLLIN;
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    if ((fds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd >= 0) {
+      ServeConnection(fd);
+      close(fd);
+    }
+  }
+}
+
+void ZPagesServer::ServeConnection(int fd) {
+  timeval timeout;
+  timeout.tv_sec = kSocketTimeoutSeconds;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string head;
+  if (!ReadRequestHead(fd, &head)) {
+    return;
+  }
+  HttpRequest request;
+  if (!request.Parse(head)) {
+    SendError(fd, "400 Bad Request");
+    return;
+  }
+  if (request.method() != "GET") {
+    SendError(fd, "405 Method Not Allowed");
+    return;
+  }
+  void (*render)(const HttpRequest&, PageWriter*) = nullptr;
+  if (request.path() == "/tracez") {
+    render = RenderTracez;
+  } else if (request.path() == "/rpcz") {
+    render = RenderRpcz;
+  } else if (request.path() == "/statsz") {
+    render = RenderStatsz;
+  } else if (request.path() != "/") {
+    SendError(fd, "404 Not Found");
+    return;
+  }
+  // Without a Content-Length, the page ends when the connection is closed,
+  // so it can be sent as it is rendered.
+  if (!SendAll(fd,
+               "HTTP/1.1 200 OK\r\n"
+               "Content-Type: text/html; charset=utf-8\r\n"
+               "Cache-Control: no-cache\r\n"
+               "Connection: close\r\n\r\n")) {
+    return;
+  }
+  PageWriter out([fd](absl::string_view chunk) { return SendAll(fd, chunk); });
+  if (render == nullptr) {
+    RenderIndex(&out);
+  } else {
+    render(request, &out);
+  }
+}
+
+}  // namespace zpages
+}  // namespace opencensus
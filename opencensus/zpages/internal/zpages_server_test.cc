@@ -0,0 +1,103 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "opencensus/zpages/zpages_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace opencensus {
+namespace zpages {
+namespace {
+
+using ::testing::EndsWith;
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+
+// Sends 'request' to the server and returns the whole response.
+std::string Fetch(int port, absl::string_view request) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_GE(fd, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  EXPECT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  EXPECT_EQ(request.size(), send(fd, request.data(), request.size(), 0));
+  std::string response;
+  char buffer[4096];
+  ssize_t received;
+  while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, received);
+  }
+  close(fd);
+  return response;
+}
+
+TEST(ZPagesServerTest, ServesPages) {
+  std::string error;
+  auto server = ZPagesServer::Start(ZPagesServerOptions(), &error);
+  ASSERT_NE(nullptr, server) << error;
+  EXPECT_GT(server->port(), 0);
+
+  for (absl::string_view path : {"/", "/tracez", "/rpcz", "/statsz"}) {
+    const std::string response = Fetch(
+        server->port(), std::string("GET ") + std::string(path) +
+                            " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_THAT(response, StartsWith("HTTP/1.1 200 OK\r\n")) << path;
+    EXPECT_THAT(response, HasSubstr("Content-Type: text/html")) << path;
+    EXPECT_THAT(response, EndsWith("</body></html>\n")) << path;
+  }
+}
+
+TEST(ZPagesServerTest, Errors) {
+  auto server = ZPagesServer::Start(ZPagesServerOptions());
+  ASSERT_NE(nullptr, server);
+  EXPECT_THAT(Fetch(server->port(), "GET /missing HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.1 404 Not Found\r\n"));
+  EXPECT_THAT(Fetch(server->port(), "POST /tracez HTTP/1.1\r\n\r\n"),
+              StartsWith("HTTP/1.1 405 Method Not Allowed\r\n"));
+  EXPECT_THAT(Fetch(server->port(), "nonsense\r\n\r\n"),
+              StartsWith("HTTP/1.1 400 Bad Request\r\n"));
+}
+
+TEST(ZPagesServerTest, InvalidOptions) {
+  ZPagesServerOptions options;
+  options.address = "not an address";
+  std::string error;
+  EXPECT_EQ(nullptr, ZPagesServer::Start(options, &error));
+  EXPECT_THAT(error, HasSubstr("invalid address"));
+
+  // The port is taken.
+  auto server = ZPagesServer::Start(ZPagesServerOptions());
+  ASSERT_NE(nullptr, server);
+  options.address = "127.0.0.1";
+  options.port = server->port();
+  EXPECT_EQ(nullptr, ZPagesServer::Start(options, &error));
+  EXPECT_THAT(error, HasSubstr("bind()"));
+}
+
+}  // namespace
+}  // namespace zpages
+}  // namespace opencensus
@@ -0,0 +1,93 @@
+// Copyright 2019, OpenCensus Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OPENCENSUS_ZPAGES_ZPAGES_SERVER_H_
+#define OPENCENSUS_ZPAGES_ZPAGES_SERVER_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace opencensus {
+namespace zpages {
+
+struct ZPagesServerOptions {
+  // The numeric IPv4 address to listen on. Z-pages expose span names,
+  // attributes and stats, so the default only accepts local connections.
+  std::string address = "127.0.0.1";
+  // The port to listen on; 0 picks a free port (see ZPagesServer::port()).
+  int port = 0;
+};
+
+// ZPagesServer is a minimal embedded HTTP server for in-process debugging
+// pages:
+//
+//   /tracez  A summary of the running and sampled spans of each span name,
+//            linking to pages of the spans themselves.
+//   /rpcz    The gRPC views (named "grpc.io/...") and their rows.
+//   /statsz  All registered views and callback gauges, linking to pages of
+//            each view's rows.
+//
+// Pages are rendered directly from the span stores and views and streamed to
+// the client as they are rendered: span pages convert one span at a time, and
+// views are read one at a time, so that looking at a loaded server does not
+// copy everything it holds. Long lists are paginated with the 'offset' and
+// 'limit' query parameters.
+//
+// Connections are served one at a time on a thread of the server's own, and
+// time out after a few seconds, so that a slow client cannot hold the thread.
+//
+// Example:
+//   ZPagesServerOptions options;
+//   options.port = 8888;
+//   std::string error;
+//   auto zpages = ZPagesServer::Start(options, &error);
+//   if (zpages == nullptr) std::cerr << error << "\n";
+//
+// ZPagesServer is thread-safe.
+class ZPagesServer final {
+ public:
+  // Starts serving. Returns nullptr, setting *error (if not null), if the
+  // address cannot be listened on.
+  static std::unique_ptr<ZPagesServer> Start(const ZPagesServerOptions& options,
+                                             std::string* error = nullptr);
+
+  // Stops serving, waiting for the connection being served, if any.
+  ~ZPagesServer();
+
+  ZPagesServer(const ZPagesServer&) = delete;
+  ZPagesServer& operator=(const ZPagesServer&) = delete;
+
+  // The port being listened on.
+  int port() const { return port_; }
+
+ private:
+  ZPagesServer(int listen_fd, int port, int wake_read_fd, int wake_write_fd);
+
+  // Accepts and serves connections until the destructor writes to the wake
+  // pipe.
+  void Run();
+  void ServeConnection(int fd);
+
+  const int listen_fd_;
+  const int port_;
+  const int wake_read_fd_;
+  const int wake_write_fd_;
+  std::thread thread_;
+};
+
+}  // namespace zpages
+}  // namespace opencensus
+
+#endif  // OPENCENSUS_ZPAGES_ZPAGES_SERVER_H_